@@ -1,7 +1,18 @@
+#include <algorithm>
+#include <atomic>
+#include <fstream>
 #include <iostream>
 #include <cstdlib>
 #include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
+#if !_WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #include <boost/algorithm/string.hpp>
 #include <boost/program_options.hpp>
@@ -10,13 +21,19 @@
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/uuid/string_generator.hpp>
 
+#include "agent_profiler.h"
+#include "hw_counters.h"
 #include "cyclus.h"
 #include "hdf5_back.h"
+#include "metrics_exporter.h"
+#include "mpi_solver.h"
+#include "parquet_back.h"
 #include "pyhooks.h"
 #include "pyne.h"
 #include "query_backend.h"
 #include "sim_init.h"
 #include "sqlite_back.h"
+#include "stream_back.h"
 #include "xml_file_loader.h"
 #include "xml_flat_loader.h"
 
@@ -26,6 +43,38 @@ namespace fs = boost::filesystem;
 
 using namespace cyclus;
 
+#if CYCLUS_HAS_MPI
+// Initializes MPI if it is on and, when main returns, tells the ranks
+// serving exchange subgraphs to stop and finalizes MPI.
+class MpiSession {
+ public:
+  MpiSession(bool on, int* argc, char*** argv)
+      : on_(on), rank_(0), serving_(false) {
+    if (on_) {
+      MPI_Init(argc, argv);
+      MPI_Comm_rank(MPI_COMM_WORLD, &rank_);
+    }
+  }
+
+  ~MpiSession() {
+    if (!on_)
+      return;
+    if (serving_)
+      MpiSolver::Stop(MPI_COMM_WORLD);
+    MPI_Finalize();
+  }
+
+  bool on() const { return on_; }
+  int rank() const { return rank_; }
+  void serving() { serving_ = true; }
+
+ private:
+  bool on_;
+  int rank_;
+  bool serving_;
+};
+#endif
+
 struct ArgInfo {
   po::variables_map vm;  // Holds parsed/specified cli opts and values
   po::options_description desc;  // Holds cli opts description
@@ -33,6 +82,8 @@ struct ArgInfo {
   std::string schema_path;
   std::string output_path;
   std::string restart;
+  std::string compile;
+  std::string compiled;
 };
 
 // Describes and parses cli arguments. Returns the error code that main should
@@ -46,6 +97,59 @@ int EarlyExitArgs(const ArgInfo& ai);
 // Using cli flags, retrieves and sets global params for the simulation.
 void GetSimInfo(ArgInfo* ai);
 
+// Sets the tables the recorder records from the --record-tables and
+// --skip-tables flags.
+void FilterTables(const ArgInfo& ai, Recorder* rec);
+
+// Sets the tables indexed in a sqlite output from the --index-tables flag,
+// which takes precedence over those set in the input file.
+void IndexTables(const ArgInfo& ai, FullBackend* back);
+
+// Indexes the lineage of the resources in a sqlite or hdf5 output if the
+// --index-lineage flag is given.
+void IndexLineage(const ArgInfo& ai, FullBackend* back);
+
+// Prints the rows, bytes, and backend time of each table recorded, largest
+// first.
+void PrintRecorderStats(const std::map<std::string, TableStats>& stats);
+
+// Opens the hdf5, parquet, or sqlite database at path, depending on its
+// extension. Hdf5 files are written in SWMR mode if swmr is true.
+FullBackend* OpenBackend(std::string path, bool swmr = false);
+
+// Connects a stream backend to the TCP server at addr, given as host:port.
+StreamBack* OpenStream(const std::string& addr);
+
+// The state variables set by a variant of a sweep, by prototype.
+struct Variant {
+  std::string name;
+  int seed;
+  std::map<std::string, std::map<std::string, std::string> > values;
+};
+
+// Reads the variants of a sweep file. Each line names a variant and lists
+// the state variables it sets, as [prototype]:[variable]=[value], and
+// optionally the seed of its random streams, as seed=[value]. Blank lines and
+// lines starting with # are ignored.
+std::vector<Variant> ReadSweep(std::string path);
+
+// Runs the simulation in si up to the sweep time, forks a process for each
+// variant of the sweep that runs the rest of it with the variant's state
+// variables set, and then runs the unchanged simulation, which records to
+// rec, to its end. Returns the error code that main should return.
+int RunSweep(const ArgInfo& ai, SimInit* si, Recorder* rec);
+
+// Like RunSweep, but runs the variants on threads of this process, which
+// share the loaded archetypes, recipes, and decay caches, and writes them all
+// to back, each under its own simulation id.
+int RunEnsemble(const ArgInfo& ai, SimInit* si, Recorder* rec,
+                RecBackend* back);
+
+// Returns true if any agent of the simulation in ctx is a Python archetype,
+// whose objects are registered with the interpreter by agent id alone, so
+// they cannot be forked onto threads of one process.
+bool HasPyAgents(Context* ctx);
+
 static std::string usage = "Usage:   cyclus [opts] [input-file]";
 
 //-----------------------------------------------------------------------
@@ -74,9 +178,46 @@ int main(int argc, char* argv[]) {
     return ret;
   }
 
+  if (ai.vm.count("no-output") > 0 &&
+      (ai.compile != "" || ai.vm.count("output-path") > 0 ||
+       ai.vm.count("sweep") > 0)) {
+    std::cerr << "--no-output cannot be combined with --compile, "
+              << "--output-path, or --sweep\n";
+    return 1;
+  }
+
+  if (ai.vm.count("ensemble") > 0 &&
+      (ai.vm.count("sweep") == 0 || ai.restart != "")) {
+    std::cerr << "--ensemble needs --sweep and cannot be combined with "
+              << "--restart\n";
+    return 1;
+  }
+
+  if (ai.vm.count("mpi") > 0) {
+#if CYCLUS_HAS_MPI
+    if (ai.restart != "" || ai.compile != "" || ai.compiled != "" ||
+        ai.vm.count("sweep") > 0) {
+      std::cerr << "--mpi cannot be combined with --restart, --compile, "
+                << "--compiled, or --sweep\n";
+      return 1;
+    }
+#else
+    std::cerr << "--mpi: this build of cyclus has no MPI support\n";
+    return 1;
+#endif
+  }
+#if CYCLUS_HAS_MPI
+  MpiSession mpi(ai.vm.count("mpi") > 0, &argc, &argv);
+  if (mpi.rank() > 0) {
+    // the other ranks only load the simulation for its solver
+    ai.output_path = ":memory:";
+  }
+#endif
+
   // Process positional args
   std::string infile;
-  if (ai.vm.count("input-file") == 0 && ai.restart == "") {
+  if (ai.vm.count("input-file") == 0 && ai.restart == "" &&
+      ai.compiled == "") {
     std::cout << "No input file specified.\n"
               << usage << "\n\n"
               << ai.desc << "\n";
@@ -121,40 +262,75 @@ int main(int argc, char* argv[]) {
   std::cout << "           .  C. ,                                                            " << std::endl;
   std::cout << "              :                                                               " << std::endl;
 
+  // Try to detect schema type
+  if (ai.compiled == "") {
+    InitPhase phase("DetectSchema");
+    std::stringstream input;
+    LoadStringstreamFromFile(input, infile, format);
+    boost::shared_ptr<XMLParser> parser =
+        boost::shared_ptr<XMLParser>(new XMLParser());
+    parser->Init(input);
+    InfileTree tree(*parser);
+    std::string schema_type =
+        OptionalQuery<std::string>(&tree, "/simulation/schematype", "");
+    if (schema_type == "flat" && !ai.flat_schema) {
+      std::cout << "flat schema tag detected - switching to flat input schema\n";
+      ai.flat_schema = true;
+      if (ai.schema_path != Env::rng_schema(ai.flat_schema)) {
+        ai.schema_path = Env::rng_schema(ai.flat_schema);
+      }
+    }
+  }
+
   // Create db backends and recorder
   FullBackend* fback = NULL;
   RecBackend::Deleter bdel;
   Recorder rec;  // Must be after backend deleter because ~Rec does flushing
 
-  std::string ext = fs::path(ai.output_path).extension().string();
-  std::string stem = fs::path(ai.output_path).stem().string();
-  if (ext == ".h5") {
-    fback = new Hdf5Back(ai.output_path.c_str());
-  } else {
-    fback = new SqliteBack(ai.output_path);
-  }
+  // a compiled input is the initial state of the simulation recorded to its
+  // own database, rather than to the output
+  std::string dbpath = ai.compile == "" ? ai.output_path : ai.compile;
+  fback = OpenBackend(dbpath, ai.vm.count("hdf5-swmr") > 0);
   rec.RegisterBackend(fback);
   bdel.Add(fback);
-
-  // Try to detect schema type
-  std::stringstream input;
-  LoadStringstreamFromFile(input, infile, format);
-  boost::shared_ptr<XMLParser> parser =
-      boost::shared_ptr<XMLParser>(new XMLParser());
-  parser->Init(input);
-  InfileTree tree(*parser);
-  std::string schema_type =
-      OptionalQuery<std::string>(&tree, "/simulation/schematype", "");
-  if (schema_type == "flat" && !ai.flat_schema) {
-    std::cout << "flat schema tag detected - switching to flat input schema\n";
-    ai.flat_schema = true;
-    if (ai.schema_path != Env::rng_schema(ai.flat_schema)) {
-      ai.schema_path = Env::rng_schema(ai.flat_schema);
+  StreamBack* sback = NULL;
+  if (ai.vm.count("stream") > 0) {
+    try {
+      sback = OpenStream(ai.vm["stream"].as<std::string>());
+    } catch (cyclus::Error err) {
+      std::cerr << err.what() << "\n";
+      return 1;
     }
+    rec.RegisterBackend(sback);
+    bdel.Add(sback);
+  }
+  if (ai.vm.count("record-async") > 0) {
+    rec.set_async(true);
+  }
+  rec.set_collect_stats(ai.vm.count("record-stats") > 0);
+  if (ai.vm.count("no-output") == 0) {
+    // without output, the simulation must still be loaded from all of the
+    // tables of its initial state, and so they are only filtered afterwards
+    FilterTables(ai, &rec);
   }
 
   SimInit si;
-  if (ai.restart == "") {
+  if (ai.compiled != "") {
+    // Copy the initial state from the compiled input and start from it
+    try {
+      InitPhase phase("LoadCompiled");
+      FullBackend* cback = OpenBackend(ai.compiled);
+      RecBackend::Deleter cdel;
+      cdel.Add(cback);
+      QueryResult qr = cback->Query("Info", NULL);
+      SimInit::LoadCompiled(cback, qr.GetVal<boost::uuids::uuid>("SimId"),
+                            &rec);
+    } catch (cyclus::Error e) {
+      CLOG(LEV_ERROR) << e.what();
+      return 1;
+    }
+    si.Init(&rec, fback);
+  } else if (ai.restart == "") {
     // Read input file and initialize db and simulation from input file
     bool ms_print;
     if(ai.vm.count("rng-print") >= 1){
@@ -172,40 +348,140 @@ int main(int argc, char* argv[]) {
       CLOG(LEV_ERROR) << e.what();
       return 1;
     }
+
+    if (ai.compile != "") {
+      rec.Close();
+      PyStop();
+      std::cout << std::endl;
+      std::cout << "Status: Cyclus input compiled successfully!" << std::endl;
+      std::cout << "Compiled input location: " << ai.compile << std::endl;
+      return 0;
+    }
     si.Init(&rec, fback);
   } else {
-    // Read output db and restart simulation from specified simid and timestep
+    // Read output db and restart simulation from specified simid and timestep,
+    // or from the latest complete checkpoint if they are left out
     std::vector<std::string> parts;
     boost::split(parts, ai.restart, boost::is_any_of(":"));
-    if (parts.size() != 3) {
-      std::cerr << "invalid restart spec: need 3 parts [db-file]:[sim-id]:[timestep]\n";
+    if (parts.size() > 3) {
+      std::cerr << "invalid restart spec: need [db-file][:[sim-id][:[timestep]]]\n";
       return 1;
     }
 
     fs::path dbfile = parts[0];
     boost::uuids::string_generator gen;
-    boost::uuids::uuid simid;
-    int t;
+    boost::uuids::uuid simid = boost::uuids::nil_uuid();
+    int t = -1;
     try {
-      simid = gen(parts[1]);
-      t = boost::lexical_cast<int>(parts[2]);
+      if (parts.size() > 1) {
+        simid = gen(parts[1]);
+      }
+      if (parts.size() > 2) {
+        t = boost::lexical_cast<int>(parts[2]);
+      }
     } catch (std::exception err) {
       std::cerr << "invalid restart spec: simid or time is invalid\n";
       return 1;
     }
-    FullBackend* rback = NULL;
-    RecBackend::Deleter bdel;
+    // prototypes may be loaded lazily from rback while the simulation runs
+    FullBackend* rback = OpenBackend(dbfile.string());
+    bdel.Add(rback);
 
-    std::string ext = dbfile.extension().string();
-    if (ext == ".h5") {
-      rback = new Hdf5Back(dbfile.c_str());
-    } else {
-      rback = new SqliteBack(dbfile.c_str());
+    if (t < 0) {
+      t = SimInit::LatestCheckpoint(rback, &simid);
+      if (t < 0) {
+        std::cerr << "no complete checkpoint to restart from in "
+                  << dbfile.string() << "\n";
+        return 1;
+      }
+      std::cout << "restarting " << simid << " from checkpoint at time " << t
+                << "\n";
     }
-    bdel.Add(rback);
 
     si.Restart(rback, simid, t);
     si.recorder()->RegisterBackend(fback);
+    if (sback != NULL) {
+      si.recorder()->RegisterBackend(sback);
+    }
+    if (ai.vm.count("record-async") > 0) {
+      si.recorder()->set_async(true);
+    }
+    si.recorder()->set_collect_stats(ai.vm.count("record-stats") > 0);
+    FilterTables(ai, si.recorder());
+  }
+
+  IndexTables(ai, fback);
+  IndexLineage(ai, fback);
+  if (ai.vm.count("no-output") > 0) {
+    Recorder* out = ai.restart == "" ? &rec : si.recorder();
+    FilterTables(ai, out);
+    out->set_silent(true);
+  }
+
+  if (ai.vm.count("profile-startup") > 0) {
+    const InitTimings& timings = SimInit::init_timings();
+    std::cout << "Startup timings:" << std::endl;
+    for (int i = 0; i < timings.size(); ++i) {
+      std::cout << "  " << timings[i].first << ": " << timings[i].second
+                << " s" << std::endl;
+    }
+    SimInit::RecordInitTimings(si.context());
+  }
+  if (ai.vm.count("profile-agents") > 0) {
+    si.context()->profile_agents(true);
+  }
+  if (ai.vm.count("profile-counters") > 0) {
+    si.context()->count_hardware(true);
+  }
+  if (ai.vm.count("memory-usage") > 0) {
+    si.context()->sample_memory(ai.vm["memory-usage"].as<int>());
+  }
+  if (ai.vm.count("trace") > 0) {
+    si.context()->trace(ai.vm["trace"].as<std::string>());
+  }
+  if (ai.vm.count("threads") > 0) {
+    si.context()->threads(ai.vm["threads"].as<int>());
+  }
+
+#if CYCLUS_HAS_MPI
+  if (mpi.rank() > 0) {
+    MpiSolver::Serve(si.context()->solver(), MPI_COMM_WORLD);
+    PyStop();
+    return 0;
+  } else if (mpi.on()) {
+    si.context()->solver(new MpiSolver(si.context()->solver(),
+                                       MPI_COMM_WORLD));
+    mpi.serving();
+  }
+#endif
+
+  boost::shared_ptr<MetricsExporter> metrics;
+  if (ai.vm.count("metrics-port") > 0) {
+    try {
+      metrics.reset(new MetricsExporter(
+          si.context(), ai.restart == "" ? &rec : si.recorder(),
+          ai.vm["metrics-port"].as<int>()));
+    } catch (cyclus::Error err) {
+      std::cerr << err.what() << "\n";
+      return 1;
+    }
+    std::cout << "Serving metrics at http://localhost:" << metrics->port()
+              << "/metrics" << std::endl;
+  }
+
+  if (ai.vm.count("sweep") > 0 && ai.vm.count("ensemble") > 0 &&
+      HasPyAgents(si.context())) {
+    std::cerr << "Warning: --ensemble cannot run Python archetypes, running "
+              << "the variants in processes of their own instead\n";
+  } else if (ai.vm.count("sweep") > 0 && ai.vm.count("ensemble") > 0) {
+    int ret = RunEnsemble(ai, &si, &rec, fback);
+    PyStop();
+    return ret;
+  }
+  if (ai.vm.count("sweep") > 0) {
+    int ret = RunSweep(ai, &si, ai.restart == "" ? &rec : si.recorder());
+    PyStop();
+    return ret;
   }
 
   char* CYCLUS_NO_CATCH = getenv("CYCLUS_NO_CATCH");
@@ -220,13 +496,26 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  if (si.context()->profiler() != NULL) {
+    si.context()->profiler()->Summarize(std::cout);
+  }
+  if (si.context()->hw_counters() != NULL) {
+    si.context()->hw_counters()->Summarize(std::cout);
+  }
+  if (ai.vm.count("record-stats") > 0) {
+    Recorder* out = ai.restart == "" ? &rec : si.recorder();
+    out->Close();
+    PrintRecorderStats(out->stats());
+  }
   rec.Flush();
 
   PyStop();
 
   std::cout << std::endl;
   std::cout << "Status: Cyclus run successful!" << std::endl;
-  std::cout << "Output location: " << ai.output_path << std::endl;
+  std::cout << "Output location: "
+            << (ai.vm.count("no-output") > 0 ? "none" : ai.output_path)
+            << std::endl;
   std::cout << "Simulation ID: " << boost::lexical_cast<std::string>
                (si.context()->sim_id()) << std::endl;
 
@@ -238,7 +527,13 @@ int ParseCliArgs(ArgInfo* ai, int argc, char* argv[]) {
       ("help,h", "produce help message")
       ("version,V", "print cyclus core and dependency versions and quit")
       ("restart", po::value<std::string>(),
-       "restart from the specified simulation snapshot [db-file]:[sim-id]:[timestep]")
+       "restart from the specified simulation snapshot [db-file]:[sim-id]:[timestep],"
+       " or from the latest complete checkpoint if the time or sim-id are left out")
+      ("compile", po::value<std::string>(),
+       "validate and initialize the input file, write the initial state of"
+       " the simulation to the given .sqlite or .h5 file, and quit")
+      ("compiled", po::value<std::string>(),
+       "run the simulation from an input file written by --compile")
       ("schema",
        "dump the cyclus master schema including all installed module schemas")
       ("agent-schema", po::value<std::string>(),
@@ -258,7 +553,76 @@ int ParseCliArgs(ArgInfo* ai, int argc, char* argv[]) {
       ("no-mem", "exclude memory log statement from logger output")
       ("verb,v", po::value<std::string>(),
        "log verbosity. integer from 0 (quiet) to 11 (verbose).")
-      ("output-path,o", po::value<std::string>(), "output path")
+      ("log-sink", po::value<std::string>(),
+       "write log lines on a background thread to stdout, stderr, or the "
+       "file at this path, without flushing each line")
+      ("output-path,o", po::value<std::string>(),
+       "output path; .h5 files are written with HDF5, .parquet directories "
+       "with Parquet, and all others with sqlite")
+      ("no-output",
+       "write no output: the simulation is loaded from an in-memory database "
+       "and, once loaded, records only the tables named by --record-tables, "
+       "for measuring throughput and for screening runs")
+      ("hdf5-swmr",
+       "write .h5 output in HDF5 single-writer/multiple-reader mode, so that "
+       "it may be read while the simulation runs")
+      ("record-async", "write output to the database on a background thread")
+      ("record-tables", po::value<std::string>(),
+       "only record the tables in this comma separated list")
+      ("skip-tables", po::value<std::string>(),
+       "never record the tables in this comma separated list")
+      ("index-tables", po::value<std::string>(),
+       "index the key columns of the tables in this comma separated list, "
+       "where a trailing * matches any suffix, in sqlite output; 'none' "
+       "indexes nothing")
+      ("index-lineage",
+       "index the parents, children, and transactions of every resource in "
+       "sqlite or hdf5 output, for fast ancestor and descendant queries")
+      ("record-stats",
+       "print and record the rows, bytes, and write time of each table")
+      ("profile-startup", "print and record the time spent in each startup phase")
+      ("profile-agents",
+       "print and record the time agents spend in each phase and exchange "
+       "callback, by prototype")
+      ("profile-counters",
+       "print and record the cycles, instructions, cache misses, and branch "
+       "misses of each time step and resource exchange phase (Linux only)")
+      ("memory-usage", po::value<int>(),
+       "record the live objects and approximate bytes of compositions, "
+       "resources, output data, exchange graphs, and agents to the "
+       "MemoryUsage table every this many time steps")
+      ("metrics-port", po::value<int>(),
+       "serve live metrics of the simulation (steps per second, exchange "
+       "time and trades per step, recorder queue depth, rows written, and "
+       "resident memory) in the OpenMetrics text format at /metrics on this "
+       "port, e.g. for Prometheus to scrape")
+      ("stream", po::value<std::string>(),
+       "also stream the output, as it is written, to the TCP server at this "
+       "host:port, e.g. for a live dashboard or message bus bridge")
+      ("trace", po::value<std::string>(),
+       "write a Chrome trace-event JSON timeline of the phases of each time "
+       "step, resource exchange, snapshot, and output write to this file")
+      ("sweep", po::value<std::string>(),
+       "run the simulation up to --sweep-time once, then run each variant in"
+       " the given sweep file from there in its own process, writing to the"
+       " output path with the variant name appended")
+      ("sweep-time", po::value<int>()->default_value(0),
+       "the timestep at which the variants of a sweep branch off")
+      ("threads", po::value<int>(),
+       "the number of threads the parallel parts of each time step are run "
+       "on, overriding the threads control parameter; defaults to the number "
+       "of cores")
+      ("jobs,j", po::value<int>(),
+       "the number of sweep variants to run at once, defaults to the number"
+       " of cores")
+      ("ensemble",
+       "run the variants of --sweep on threads of this process, sharing the "
+       "loaded archetypes, recipes, and decay caches, and write them all to "
+       "the output path, each under its own simulation id")
+      ("mpi",
+       "when run with mpirun, solve the independent parts of each resource "
+       "exchange on all of the MPI ranks, with the simulation itself and all "
+       "output on rank 0")
       ("input-file,i", po::value<std::string>(),
        "input file, may be a path or a raw string")
       ("format,f", po::value<std::string>()->default_value("none"),
@@ -280,6 +644,9 @@ int ParseCliArgs(ArgInfo* ai, int argc, char* argv[]) {
       ("py-to-json", po::value<std::string>(), "*.py input file")
       ("py-to-xml", po::value<std::string>(), "*.py input file")
       ("xml-to-py", po::value<std::string>(), "*.xml input file")
+      ("write-recipes", po::value<std::string>(),
+       "write the recipes of the input file to the given binary recipe"
+       " library and quit")
       ;
 
   po::variables_map vm;
@@ -476,6 +843,30 @@ int EarlyExitArgs(const ArgInfo& ai) {
       std::cout << err.what() << "\n";
     }
     return 0;
+  } else if (ai.vm.count("write-recipes")) {
+    std::string libfile(ai.vm["write-recipes"].as<std::string>());
+    if (ai.vm.count("input-file") == 0) {
+      std::cout << "No input file specified.\n";
+      return 1;
+    }
+    try {
+      std::stringstream input;
+      LoadStringstreamFromFile(input, ai.vm["input-file"].as<std::string>(),
+                               ai.vm["format"].as<std::string>());
+      XMLParser parser;
+      parser.Init(input);
+      InfileTree tree(parser);
+      std::map<std::string, Composition::Ptr> recipes;
+      std::vector<InfileTree*> qes = tree.SubTrees("/*/recipe");
+      for (int i = 0; i < qes.size(); ++i) {
+        recipes[qes[i]->GetString("name")] = ReadRecipe(qes[i]);
+      }
+      WriteRecipeLibrary(libfile, recipes);
+    } catch (cyclus::Error err) {
+      std::cout << err.what() << "\n";
+      return 1;
+    }
+    return 0;
   } else if (ai.vm.count("metadata")) {
     try {
       Json::Value root = DiscoverMetadataInCyclusPath();
@@ -501,6 +892,12 @@ void GetSimInfo(ArgInfo* ai) {
   if (ai->vm.count("restart") > 0) {
     ai->restart = ai->vm["restart"].as<std::string>();
   }
+  if (ai->vm.count("compile") > 0) {
+    ai->compile = ai->vm["compile"].as<std::string>();
+  }
+  if (ai->vm.count("compiled") > 0) {
+    ai->compiled = ai->vm["compiled"].as<std::string>();
+  }
 
   // Logging params
   if (ai->vm.count("no-agent")) {
@@ -509,6 +906,13 @@ void GetSimInfo(ArgInfo* ai) {
   if (ai->vm.count("no-mem")) {
     Logger::NoMem() = true;
   }
+  if (ai->vm.count("memory-usage")) {
+    // on before the simulation is loaded, so that its objects are counted
+    MemUsage::enabled(true);
+  }
+  if (ai->vm.count("log-sink")) {
+    Logger::SetSink(ai->vm["log-sink"].as<std::string>());
+  }
   if (ai->vm.count("verb")) {
     std::string v_level = ai->vm["verb"].as<std::string>();
     if (v_level.length() < 3) {
@@ -516,6 +920,11 @@ void GetSimInfo(ArgInfo* ai) {
     } else {
       Logger::ReportLevel() = Logger::ToLogLevel(v_level);
     }
+    if (Logger::ReportLevel() > CYCLUS_MIN_LOG_LEVEL) {
+      std::cerr << "Warning: log levels above "
+                << Logger::ToString((LogLevel)CYCLUS_MIN_LOG_LEVEL)
+                << " were not compiled in\n";
+    }
   }
 
   // Warning params
@@ -528,5 +937,388 @@ void GetSimInfo(ArgInfo* ai) {
   ai->output_path = "cyclus.sqlite";
   if (ai->vm.count("output-path")) {
     ai->output_path = ai->vm["output-path"].as<std::string>();
+  } else if (ai->vm.count("no-output")) {
+    ai->output_path = ":memory:";
+  }
+}
+
+void FilterTables(const ArgInfo& ai, Recorder* rec) {
+  std::set<std::string> allow;
+  std::set<std::string> deny;
+  std::vector<std::string> names;
+  if (ai.vm.count("record-tables") > 0) {
+    boost::split(names, ai.vm["record-tables"].as<std::string>(),
+                 boost::is_any_of(","));
+    allow.insert(names.begin(), names.end());
+  }
+  if (ai.vm.count("skip-tables") > 0) {
+    boost::split(names, ai.vm["skip-tables"].as<std::string>(),
+                 boost::is_any_of(","));
+    deny.insert(names.begin(), names.end());
+  }
+  allow.erase("");
+  deny.erase("");
+  rec->FilterTables(allow, deny);
+}
+
+void IndexTables(const ArgInfo& ai, FullBackend* back) {
+  SqliteBack* sqlback = dynamic_cast<SqliteBack*>(back);
+  if (sqlback == NULL || ai.vm.count("index-tables") == 0) {
+    return;
+  }
+  std::vector<std::string> names;
+  boost::split(names, ai.vm["index-tables"].as<std::string>(),
+               boost::is_any_of(","));
+  std::set<std::string> tables(names.begin(), names.end());
+  tables.erase("");
+  tables.erase("none");
+  sqlback->index_tables(tables);
+}
+
+void IndexLineage(const ArgInfo& ai, FullBackend* back) {
+  if (ai.vm.count("index-lineage") == 0) {
+    return;
+  }
+  SqliteBack* sqlback = dynamic_cast<SqliteBack*>(back);
+  Hdf5Back* h5back = dynamic_cast<Hdf5Back*>(back);
+  if (sqlback != NULL) {
+    sqlback->index_lineage(true);
+  } else if (h5back != NULL) {
+    h5back->set_index_lineage(true);
+  }
+}
+
+StreamBack* OpenStream(const std::string& addr) {
+  size_t colon = addr.rfind(':');
+  int port = 0;
+  if (colon != std::string::npos) {
+    port = std::atoi(addr.c_str() + colon + 1);
+  }
+  if (colon == std::string::npos || colon == 0 || port <= 0) {
+    throw ValueError("--stream takes host:port, not '" + addr + "'");
+  }
+  return new StreamBack(addr.substr(0, colon), port);
+}
+
+FullBackend* OpenBackend(std::string path, bool swmr) {
+  if (fs::path(path).extension().string() == ".h5") {
+    return new Hdf5Back(path, true, Hdf5Layout(),
+                        swmr ? HDF5_SWMR_WRITE : HDF5_WRITE);
+  } else if (fs::path(path).extension().string() == ".parquet") {
+#if CYCLUS_HAS_PARQUET
+    return new ParquetBack(path);
+#else
+    throw ValueError("cannot write '" + path + "': this build of cyclus has "
+                     "no parquet support");
+#endif
+  }
+  return new SqliteBack(path);
+}
+
+std::vector<Variant> ReadSweep(std::string path) {
+  std::ifstream f(path.c_str());
+  if (!f.good()) {
+    throw IOError("could not open sweep file " + path);
+  }
+
+  std::vector<Variant> variants;
+  std::string line;
+  while (std::getline(f, line)) {
+    boost::trim(line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::vector<std::string> tokens;
+    boost::split(tokens, line, boost::is_space(), boost::token_compress_on);
+    Variant v;
+    v.name = tokens[0];
+    v.seed = -1;
+    // the name is part of the variant's output path
+    if (v.name.find('/') != std::string::npos ||
+        v.name.find("..") != std::string::npos) {
+      throw ValueError("invalid variant name '" + v.name + "': it may not "
+                       "contain '/' or '..'");
+    }
+    for (int i = 1; i < tokens.size(); ++i) {
+      if (boost::starts_with(tokens[i], "seed=")) {
+        try {
+          v.seed = boost::lexical_cast<int>(tokens[i].substr(5));
+        } catch (const boost::bad_lexical_cast&) {
+          v.seed = -1;
+        }
+        if (v.seed < 0) {
+          throw ValueError("invalid seed '" + tokens[i].substr(5) + "' in "
+                           "variant " + v.name);
+        }
+        continue;
+      }
+      size_t eq = tokens[i].find('=');
+      size_t colon = tokens[i].rfind(':', eq);
+      if (eq == std::string::npos || colon == std::string::npos) {
+        throw ValueError("invalid sweep setting '" + tokens[i] + "' in " +
+                         "variant " + v.name +
+                         ": need [prototype]:[variable]=[value]");
+      }
+      v.values[tokens[i].substr(0, colon)]
+              [tokens[i].substr(colon + 1, eq - colon - 1)] =
+          tokens[i].substr(eq + 1);
+    }
+    variants.push_back(v);
+  }
+  return variants;
+}
+
+#if !_WIN32
+// Runs the rest of the simulation in ctx with the state variables of v set,
+// writing to path. Returns the exit code of the variant's process.
+static int RunVariant(Context* ctx, const Variant& v, std::string path) {
+  try {
+    RecBackend::Deleter bdel;
+    Recorder rec;  // Must be after backend deleter because ~Rec does flushing
+    FullBackend* back = OpenBackend(path);
+    bdel.Add(back);
+    rec.RegisterBackend(back);
+
+    SimInit si;
+    si.Fork(ctx, &rec, v.seed);
+    std::map<std::string, std::map<std::string, std::string> >::const_iterator
+        it;
+    for (it = v.values.begin(); it != v.values.end(); ++it) {
+      SimInit::SetState(si.context(), it->first, it->second);
+    }
+    si.timer()->RunSim();
+    rec.Flush();
+    std::cout << "Variant " << v.name << " finished, output location: "
+              << path << std::endl;
+  } catch (cyclus::Error e) {
+    std::cerr << "variant " << v.name << " failed: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Waits for one of the running variants to finish, and returns the number of
+// variants that failed: 1 if it failed and 0 otherwise. If waiting fails,
+// every running variant is given up on and counted as failed.
+static int WaitVariant(std::map<pid_t, std::string>* running) {
+  int status;
+  pid_t pid = waitpid(-1, &status, 0);
+  if (pid < 0) {
+    int n = running->size();
+    running->clear();
+    return n;
+  }
+  running->erase(pid);
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : 1;
+}
+#endif
+
+int RunSweep(const ArgInfo& ai, SimInit* si, Recorder* rec) {
+#if _WIN32
+  std::cerr << "sweeps are not supported on this platform\n";
+  return 1;
+#else
+  int jobs = std::thread::hardware_concurrency();
+  if (ai.vm.count("jobs") > 0) {
+    jobs = ai.vm["jobs"].as<int>();
+  }
+  jobs = std::max(jobs, 1);
+
+  std::vector<Variant> variants;
+  try {
+    variants = ReadSweep(ai.vm["sweep"].as<std::string>());
+    si->timer()->RunUntil(ai.vm["sweep-time"].as<int>());
+  } catch (cyclus::Error e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+
+  // nothing recorded by the common part of the simulation is left for the
+  // variants to write
+  rec->Flush();
+  std::cout.flush();
+  std::cerr.flush();
+
+  fs::path out(ai.output_path);
+  std::map<pid_t, std::string> running;
+  int nfailed = 0;
+  for (int i = 0; i < variants.size(); ++i) {
+    while (running.size() >= jobs) {
+      nfailed += WaitVariant(&running);
+    }
+    std::string path = (out.parent_path() / (out.stem().string() + "-" +
+                        variants[i].name + out.extension().string())).string();
+    pid_t pid = fork();
+    if (pid < 0) {
+      std::cerr << "could not start variant " << variants[i].name << "\n";
+      ++nfailed;
+    } else if (pid == 0) {
+      // leave the parent's backends and interpreter state alone on the way out
+      int ret = RunVariant(si->context(), variants[i], path);
+      std::cout.flush();
+      std::cerr.flush();
+      _exit(ret);
+    } else {
+      running[pid] = variants[i].name;
+    }
+  }
+  while (!running.empty()) {
+    nfailed += WaitVariant(&running);
+  }
+
+  try {
+    si->timer()->RunSim();
+  } catch (cyclus::Error err) {
+    std::cerr << err.what() << "\n";
+    return 1;
+  }
+  rec->Flush();
+
+  std::cout << std::endl;
+  std::cout << "Status: Cyclus sweep finished with " << nfailed
+            << " of " << variants.size() << " variants failed" << std::endl;
+  std::cout << "Output location: " << ai.output_path << std::endl;
+  std::cout << "Simulation ID: " << boost::lexical_cast<std::string>
+               (si->context()->sim_id()) << std::endl;
+  return nfailed == 0 ? 0 : 1;
+#endif
+}
+
+// Serializes the writes of the simulations of an ensemble to their shared
+// backend, which is left for its owner to close.
+class SharedBackend : public RecBackend {
+ public:
+  SharedBackend(RecBackend* back, std::mutex* mu) : back_(back), mu_(mu) {}
+
+  virtual void Notify(const DatumGroups& groups) {
+    std::lock_guard<std::mutex> lock(*mu_);
+    back_->Notify(groups);
+  }
+
+  virtual std::string Name() { return back_->Name(); }
+
+  virtual void Flush() {
+    std::lock_guard<std::mutex> lock(*mu_);
+    back_->Flush();
+  }
+
+  virtual void Close() {}
+
+ private:
+  RecBackend* back_;
+  std::mutex* mu_;
+};
+
+int RunEnsemble(const ArgInfo& ai, SimInit* si, Recorder* rec,
+                RecBackend* back) {
+  int jobs = std::thread::hardware_concurrency();
+  if (ai.vm.count("jobs") > 0) {
+    jobs = ai.vm["jobs"].as<int>();
+  }
+  // the variants may share compositions, whose counts may not be atomic
+  jobs = CYCLUS_ATOMIC_REFCOUNT ? std::max(jobs, 1) : 1;
+
+  std::vector<Variant> variants;
+  try {
+    variants = ReadSweep(ai.vm["sweep"].as<std::string>());
+    si->timer()->RunUntil(ai.vm["sweep-time"].as<int>());
+  } catch (cyclus::Error e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+  rec->Flush();
+
+  // the variants are forked one at a time, since forking reads the state of
+  // the common simulation, and then run at once
+  std::mutex fork_mu;
+  std::mutex back_mu;
+  std::atomic<int> next(0);
+  std::atomic<int> nfailed(0);
+  auto worker = [&]() {
+    for (int i = next++; i < variants.size(); i = next++) {
+      const Variant& v = variants[i];
+      try {
+        SharedBackend shared(back, &back_mu);
+        Recorder vrec;  // after its backend, since ~Recorder flushes
+        vrec.RegisterBackend(&shared);
+        SimInit vsi;
+        {
+          std::lock_guard<std::mutex> lock(fork_mu);
+          vsi.Fork(si->context(), &vrec, v.seed);
+          std::map<std::string,
+                   std::map<std::string, std::string> >::const_iterator it;
+          for (it = v.values.begin(); it != v.values.end(); ++it) {
+            SimInit::SetState(vsi.context(), it->first, it->second);
+          }
+        }
+        vsi.timer()->RunSim();
+        vrec.Flush();
+        std::lock_guard<std::mutex> lock(back_mu);
+        std::cout << "Variant " << v.name << " finished, simulation ID: "
+                  << vrec.sim_id() << std::endl;
+      } catch (cyclus::Error e) {
+        std::lock_guard<std::mutex> lock(back_mu);
+        std::cerr << "variant " << v.name << " failed: " << e.what()
+                  << std::endl;
+        ++nfailed;
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < std::min<int>(jobs, variants.size()); ++i) {
+    threads.push_back(std::thread(worker));
+  }
+  for (int i = 0; i < threads.size(); ++i) {
+    threads[i].join();
+  }
+
+  try {
+    si->timer()->RunSim();
+  } catch (cyclus::Error err) {
+    std::cerr << err.what() << "\n";
+    return 1;
+  }
+  rec->Flush();
+
+  std::cout << std::endl;
+  std::cout << "Status: Cyclus ensemble finished with " << nfailed
+            << " of " << variants.size() << " variants failed" << std::endl;
+  std::cout << "Output location: " << ai.output_path << std::endl;
+  std::cout << "Simulation ID: " << boost::lexical_cast<std::string>
+               (si->context()->sim_id()) << std::endl;
+  return nfailed == 0 ? 0 : 1;
+}
+
+bool HasPyAgents(Context* ctx) {
+  std::set<std::string> seen;
+  const std::vector<Agent*>& agents = ctx->agents();
+  for (int i = 0; i < agents.size(); ++i) {
+    std::string spec = agents[i]->spec();
+    if (seen.insert(spec).second &&
+        DynamicModule::IsPyAgent(AgentSpec(spec))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PrintRecorderStats(const std::map<std::string, TableStats>& stats) {
+  std::vector<std::pair<uint64_t, std::string> > order;
+  std::map<std::string, TableStats>::const_iterator it;
+  for (it = stats.begin(); it != stats.end(); ++it) {
+    order.push_back(std::make_pair(it->second.bytes, it->first));
+  }
+  std::sort(order.rbegin(), order.rend());
+
+  std::cout << "Recorder stats (table: rows, MB, backend s):" << std::endl;
+  for (int i = 0; i < order.size(); ++i) {
+    const TableStats& st = stats.find(order[i].second)->second;
+    double secs = 0;
+    std::map<std::string, double>::const_iterator b;
+    for (b = st.notify_secs.begin(); b != st.notify_secs.end(); ++b) {
+      secs += b->second;
+    }
+    std::cout << "  " << order[i].second << ": " << st.rows << ", "
+              << st.bytes / 1e6 << ", " << secs << std::endl;
   }
 }
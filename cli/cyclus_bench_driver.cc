@@ -0,0 +1,28 @@
+#include <stdlib.h>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "env.h"
+#include "logger.h"
+
+int main(int argc, char* argv[]) {
+  cyclus::Logger::ReportLevel() = cyclus::LEV_ERROR;
+  cyclus::Env::SetNucDataPath();
+
+  // Add the build path to the environment, as the unit tests do, so that
+  // benchmarks can load the agents that were built with them
+  std::string bench_env = "CYCLUS_PATH=" + cyclus::Env::GetBuildPath();
+  std::string curr_var = cyclus::Env::GetEnv("CYCLUS_PATH");
+  if (curr_var != "") {
+    bench_env += ":" + curr_var;
+  }
+  putenv(const_cast<char*>(bench_env.c_str()));
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
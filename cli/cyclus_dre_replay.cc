@@ -0,0 +1,239 @@
+// Runs exchange solvers against exchange graphs dumped from simulations (see
+// the CYCLUS_DRE_DUMP environment variable), reporting the time each solve
+// took, the objective value it found, and the quantity it matched, along with
+// the matches made in the simulation where they were dumped too.
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "env.h"
+#include "error.h"
+#include "exchange_graph.h"
+#include "graph_dump.h"
+#include "greedy_solver.h"
+#include "logger.h"
+#include "platform.h"
+#if CYCLUS_HAS_COIN
+#include "prog_solver.h"
+#endif
+
+namespace po = boost::program_options;
+using namespace cyclus;
+
+namespace {
+
+// A dumped graph, kept serialized so that every solve starts from the graph
+// as it was dumped.
+struct Dump {
+  int time;
+  std::string restype;
+  std::string bytes;
+  int nnodes;
+  int narcs;
+  // the matches made in the simulation, or -1 if they weren't dumped
+  int captured;
+  double captured_flow;
+};
+
+// returns the total quantity matched in g
+double Flow(ExchangeGraph& g) {
+  double flow = 0;
+  const std::vector<Match>& matches = g.matches();
+  for (int i = 0; i < matches.size(); ++i) {
+    flow += matches[i].second;
+  }
+  return flow;
+}
+
+ExchangeSolver* MakeSolver(const std::string& name, bool exclusive) {
+  if (name == "greedy") {
+    return new GreedySolver(exclusive);
+  }
+#if CYCLUS_HAS_COIN
+  if (name == "cbc" || name == "clp") {
+    return new ProgSolver(name, exclusive);
+  }
+#endif
+  throw ValueError("unknown solver '" + name + "'");
+}
+
+ExchangeGraph::Ptr Load(const Dump& d) {
+  std::istringstream in(d.bytes);
+  int time;
+  std::string restype;
+  ExchangeGraph::Ptr g;
+  LoadGraph(in, &time, &restype, &g);
+  return g;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Logger::ReportLevel() = LEV_ERROR;
+  Env::SetNucDataPath();
+
+  po::options_description desc(
+      "Usage: cyclus_dre_replay [options] DUMP...\n\n"
+      "Solves the exchange graphs dumped to each DUMP file with each solver,"
+      "\nand prints the seconds each solve took, its objective value and the"
+      "\nquantity it matched, and the matches made in the simulation if they"
+      "\nwere dumped");
+  desc.add_options()
+      ("help,h", "produce help message")
+      ("solver,s", po::value<std::vector<std::string> >(),
+       "a solver to run: greedy, or cbc or clp where Coin-OR is available;"
+       " may be given many times (default: greedy)")
+      ("time,t", po::value<std::vector<int> >(),
+       "only solve the graphs dumped at this time step; may be given many "
+       "times")
+      ("repeat,r", po::value<int>()->default_value(1),
+       "solve each graph this many times, reporting the fastest")
+      ("no-exclusive-orders", "solve without exclusive orders")
+      ("threads", po::value<int>(),
+       "the number of threads independent subproblems are solved on")
+      ("csv", po::value<std::string>(), "also write the results to this file")
+      ("dump", po::value<std::vector<std::string> >(), "graph dump files");
+  po::positional_options_description p;
+  p.add("dump", -1);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv)
+                  .options(desc).positional(p).run(), vm);
+    po::notify(vm);
+  } catch (std::exception& e) {
+    std::cerr << e.what() << "\n" << desc << "\n";
+    return 1;
+  }
+  if (vm.count("help") > 0 || vm.count("dump") == 0) {
+    std::cout << desc << "\n";
+    return vm.count("help") > 0 ? 0 : 1;
+  }
+
+  std::vector<std::string> solvers(1, "greedy");
+  if (vm.count("solver") > 0) {
+    solvers = vm["solver"].as<std::vector<std::string> >();
+  }
+  std::set<int> times;
+  if (vm.count("time") > 0) {
+    std::vector<int> t = vm["time"].as<std::vector<int> >();
+    times.insert(t.begin(), t.end());
+  }
+  int repeat = std::max(1, vm["repeat"].as<int>());
+  bool exclusive = vm.count("no-exclusive-orders") == 0;
+
+  std::vector<Dump> dumps;
+  try {
+    std::vector<std::string> paths = vm["dump"].as<std::vector<std::string> >();
+    for (int i = 0; i < paths.size(); ++i) {
+      std::ifstream in(paths[i].c_str(), std::ios::binary);
+      if (!in) {
+        throw IOError("could not open '" + paths[i] + "'");
+      }
+      Dump d;
+      ExchangeGraph::Ptr g;
+      while (LoadGraph(in, &d.time, &d.restype, &g)) {
+        if (!times.empty() && times.count(d.time) == 0) {
+          continue;
+        }
+        std::ostringstream out;
+        DumpGraph(out, d.time, d.restype, *g);
+        d.bytes = out.str();
+        d.nnodes = g->flat().nodes.size();
+        d.narcs = g->arcs().size();
+        d.captured = -1;
+        d.captured_flow = 0;
+        if (!g->matches().empty()) {
+          d.captured = g->matches().size();
+          d.captured_flow = Flow(*g);
+        }
+        dumps.push_back(d);
+      }
+    }
+  } catch (Error& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+
+  std::ofstream csv;
+  if (vm.count("csv") > 0) {
+    csv.open(vm["csv"].as<std::string>().c_str());
+    csv << "Time,ResourceType,Nodes,Arcs,Solver,Seconds,Objective,Matches,"
+        << "Flow\n";
+  }
+  std::cout << std::setw(6) << "Time" << std::setw(10) << "Resource"
+            << std::setw(8) << "Nodes" << std::setw(8) << "Arcs"
+            << std::setw(8) << "Solver" << std::setw(12) << "Seconds"
+            << std::setw(16) << "Objective" << std::setw(9) << "Matches"
+            << std::setw(14) << "Flow" << "\n";
+
+  std::vector<double> totals(solvers.size(), 0);
+  try {
+    for (int i = 0; i < dumps.size(); ++i) {
+      const Dump& d = dumps[i];
+      if (d.captured >= 0) {
+        std::cout << std::setw(6) << d.time << std::setw(10) << d.restype
+                  << std::setw(8) << d.nnodes << std::setw(8) << d.narcs
+                  << std::setw(8) << "sim" << std::setw(12) << "-"
+                  << std::setw(16) << "-" << std::setw(9) << d.captured
+                  << std::setw(14) << d.captured_flow << "\n";
+        if (csv.is_open()) {
+          csv << d.time << "," << d.restype << "," << d.nnodes << ","
+              << d.narcs << ",sim,,," << d.captured << "," << d.captured_flow
+              << "\n";
+        }
+      }
+      for (int s = 0; s < solvers.size(); ++s) {
+        boost::shared_ptr<ExchangeSolver> solver(
+            MakeSolver(solvers[s], exclusive));
+        if (vm.count("threads") > 0) {
+          solver->threads(vm["threads"].as<int>());
+        }
+        double best = -1;
+        double obj = 0;
+        int nmatches = 0;
+        double flow = 0;
+        for (int r = 0; r < repeat; ++r) {
+          ExchangeGraph::Ptr g = Load(d);
+          std::chrono::steady_clock::time_point start =
+              std::chrono::steady_clock::now();
+          obj = solver->Solve(g.get());
+          double secs = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start).count();
+          best = best < 0 ? secs : std::min(best, secs);
+          nmatches = g->matches().size();
+          flow = Flow(*g);
+        }
+        totals[s] += best;
+        std::cout << std::setw(6) << d.time << std::setw(10) << d.restype
+                  << std::setw(8) << d.nnodes << std::setw(8) << d.narcs
+                  << std::setw(8) << solvers[s] << std::setw(12) << best
+                  << std::setw(16) << obj << std::setw(9) << nmatches
+                  << std::setw(14) << flow << "\n";
+        if (csv.is_open()) {
+          csv << d.time << "," << d.restype << "," << d.nnodes << ","
+              << d.narcs << "," << solvers[s] << "," << best << "," << obj
+              << "," << nmatches << "," << flow << "\n";
+        }
+      }
+    }
+  } catch (Error& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+
+  std::cout << "\n" << dumps.size() << " graphs solved\n";
+  for (int s = 0; s < solvers.size(); ++s) {
+    std::cout << "  " << solvers[s] << ": " << totals[s] << " s\n";
+  }
+  return 0;
+}
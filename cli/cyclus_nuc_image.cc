@@ -0,0 +1,42 @@
+// Writes the nuclear data image (see cyclus::NucImage) for a nuclear data
+// library, so that the kernel can map it rather than have pyne load the
+// library in every process.
+//
+// Usage: cyclus_nuc_image [nuc_data.h5 [image]]
+//
+// The library defaults to the one cyclus finds (see Env::nuc_data), and the
+// image to the file beside the library where cyclus looks for it.
+#include <iostream>
+#include <string>
+
+#include "env.h"
+#include "error.h"
+#include "nuc_image.h"
+
+using cyclus::Env;
+using cyclus::NucImage;
+
+int main(int argc, char* argv[]) {
+  if (argc > 3) {
+    std::cerr << "usage: cyclus_nuc_image [nuc_data.h5 [image]]\n";
+    return 1;
+  }
+  try {
+    if (argc > 1) {
+      Env::SetNucDataPath(argv[1]);
+    } else {
+      Env::SetNucDataPath();
+    }
+    std::string path = argc > 2 ? std::string(argv[2]) :
+                       NucImage::PathFor(pyne::NUC_DATA_PATH);
+    NucImage::Write(path);
+    NucImage img(path);
+    std::cout << "wrote " << path << " with "
+              << img.size(NucImage::ATOMIC_MASS) << " nuclides and "
+              << img.size(NucImage::BRANCH_RATIO) << " decay branches\n";
+  } catch (cyclus::Error& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -515,12 +515,17 @@ class VarDeclarationFilter(Filter):
         classname = cg.classname()
         vtype, vname = self.match.groups()
         cg.var_annotations = None
-        shape = cg.context.get(classname, {}).get('vars', {})\
-                          .get(vname, {}).get('shape', None)
-        if shape is None:
+        clsctx = cg.context.get(classname, {})
+        info = clsctx.get('vars', {}).get(vname, {})
+        shape = info.get('shape', None)
+        tracked = SnapshotDirtyFilter.tracked(clsctx, info)
+        if shape is None and not tracked:
             return
         s = statement + sep + '\n'
-        s += '  std::vector<int> cycpp_shape_{0};\n'.format(vname)
+        if shape is not None:
+            s += '  std::vector<int> cycpp_shape_{0};\n'.format(vname)
+        if tracked:
+            s += '  {0} cycpp_snap_{1};\n'.format(vtype.strip(), vname)
         return s
 
     def transform(self, statement, sep):
@@ -1102,6 +1107,18 @@ class InitFromDbFilter(CodeGeneratorFilter):
         cap_buffs = {}
         impl += self.shapes_impl(ctx, ind)
         impl += ind + '{0}::QueryResult qr = b->Query("Info", NULL);\n'.format(CYCNS)
+        # the columns read are looked up once, and then read by index
+        cols = []
+        for member, info in ctx.items():
+            if not isinstance(info, Mapping) or self.pragmaname in info:
+                continue
+            t = info['type']
+            key = t if isinstance(t, STRING_TYPES) else t[0]
+            if key not in BUFFERS or '{col}' in self.res_impl.get(key, ''):
+                cols.append(member)
+        if len(cols) > 0:
+            impl += ind + 'std::vector<int> cycpp_cols = qr.FieldIndexes({{{0}}});\n'\
+                        .format(', '.join('"{0}"'.format(c) for c in cols))
         for member, info in ctx.items():
             if not isinstance(info, Mapping):
                 # this member is a variable alias pointer
@@ -1121,7 +1138,8 @@ class InitFromDbFilter(CodeGeneratorFilter):
             tstr = type_to_str(t)
             if tstr.endswith('>'):
                 tstr += ' '
-            impl += ind + '{0} = qr.GetVal<{1}>("{0}");\n'.format(member, tstr)
+            impl += ind + '{0} = qr.GetVal<{1}>(cycpp_cols[{2}]);\n'.format(
+                member, tstr, cols.index(member))
 
         for b, info in cap_buffs.items():
             t_info = info['type']
@@ -1130,7 +1148,9 @@ class InitFromDbFilter(CodeGeneratorFilter):
             if t_impl is None:
                 msg = 'type {0!r} could not be found for InitFromDb() code gen.'
                 raise TypeError(msg.format(t_info))
-            t_impl = t_impl.format(var=b, tstr=type_to_str(t_info), **info)
+            col = 'cycpp_cols[{0}]'.format(cols.index(b)) if b in cols else ''
+            t_impl = t_impl.format(var=b, tstr=type_to_str(t_info), col=col,
+                                   **info)
             impl += ind + t_impl.replace('\n', '\n' + ind).strip(' ')
 
         return impl
@@ -1139,7 +1159,7 @@ class InitFromDbFilter(CodeGeneratorFilter):
         CYCNS + '::toolkit::ResourceBuff': '{var}.set_capacity({capacity});\n',
         CYCNS + '::toolkit::ResBuf': '{var}.capacity({capacity});\n',
         CYCNS + '::toolkit::ResMap': (
-            '{var}.obj_ids(qr.GetVal<{tstr}>("{var}"))\n;'),
+            '{var}.obj_ids(qr.GetVal<{tstr}>({col}))\n;'),
         }
 
 
@@ -1891,6 +1911,199 @@ class SnapshotFilter(CodeGeneratorFilter):
         }
 
 
+class SnapshotDirtyFilter(CodeGeneratorFilter):
+    """Filter for handling SnapshotDirty() code generation:
+        #pragma cyclus [def|decl|impl] snapshotdirty [classname]
+
+    Code is only generated for classes noted with {"track_changes": True}.
+    Each state variable of these is compared against a copy of it taken at the
+    last snapshot. Other classes keep Agent::SnapshotDirty(), which reports
+    every snapshot as changed.
+    """
+    methodname = 'SnapshotDirty'
+    pragmaname = 'snapshotdirty'
+    methodrtn = 'bool'
+
+    def transform(self, statement, sep):
+        rtn = super(SnapshotDirtyFilter, self).transform(statement, sep)
+        if not self.machine.context.get(self.given_classname, {})\
+                                   .get('track_changes', False):
+            return ""
+        return rtn
+
+    @staticmethod
+    def tracked(clsctx, info):
+        """Whether the state variable with annotations info in the class with
+        annotations clsctx is compared against a copy of itself.
+        """
+        if not clsctx.get('track_changes', False):
+            return False
+        if not isinstance(info, Mapping) or 'type' not in info:
+            return False
+        t = info['type']
+        key = t if isinstance(t, STRING_TYPES) else t[0]
+        return (key not in BUFFERS and 'snapshot' not in info and
+                SnapshotDirtyFilter.pragmaname not in info)
+
+    def impl(self, ind="  "):
+        cg = self.machine
+        clsctx = cg.context[self.given_classname]
+        impl = ind + "bool dirty = false;\n"
+        for member, info in clsctx['vars'].items():
+            if not isinstance(info, Mapping):
+                # this member is a variable alias pointer
+                continue
+            if self.pragmaname in info:
+                impl += info[self.pragmaname]
+                continue
+            if self.tracked(clsctx, info):
+                impl += (ind + "if ({0} != cycpp_snap_{0}) {{\n" +
+                         ind + "  cycpp_snap_{0} = {0};\n" +
+                         ind + "  dirty = true;\n" +
+                         ind + "}}\n").format(member)
+                continue
+            # buffers are inventories, whose changes the kernel sees itself,
+            # except for ResMaps, which also snapshot their object ids
+            t = info['type']
+            key = t if isinstance(t, STRING_TYPES) else t[0]
+            if key in BUFFERS and SnapshotFilter.res_exprs.get(key) is None:
+                continue
+            impl += ind + "dirty = true;  // {0} cannot be compared\n".format(
+                member)
+        impl += ind + "return dirty;\n"
+        return impl
+
+
+class BinaryFilter(CodeGeneratorFilter):
+    """Base for the filters of the binary state methods, SnapshotBinary() and
+    InitFromBinary(). These are only generated for classes whose state
+    variables all have types the database supports and no custom snapshot or
+    initfromdb code; all others keep the Agent methods, which have no binary
+    state.
+    """
+    templates = {'std::vector', 'std::set', 'std::list', 'std::pair',
+                 'std::map'}
+
+    def transform(self, statement, sep):
+        rtn = super(BinaryFilter, self).transform(statement, sep)
+        if not self.supported(self.machine.context.get(self.given_classname,
+                                                       {})):
+            return ""
+        return rtn
+
+    def supported(self, clsctx):
+        """Whether the class with annotations clsctx has a binary state."""
+        if 'vars' not in clsctx:
+            return False
+        for member, info in clsctx['vars'].items():
+            if not isinstance(info, Mapping):
+                # this member is a variable alias pointer
+                continue
+            if 'snapshot' in info or 'initfromdb' in info:
+                return False
+            t = info['type']
+            key = t if isinstance(t, STRING_TYPES) else t[0]
+            if key in BUFFERS:
+                # inventories are not state, but ResMaps' object ids are
+                if SnapshotFilter.res_exprs.get(key) is not None:
+                    return False
+                continue
+            if not self.supported_type(t):
+                return False
+        return True
+
+    def supported_type(self, t):
+        if isinstance(t, STRING_TYPES):
+            return t in PRIMITIVES
+        return t[0] in self.templates and all(map(self.supported_type, t[1:]))
+
+    def members(self, clsctx):
+        """The state variables written, with their annotations, in order."""
+        rtn = []
+        for member, info in clsctx['vars'].items():
+            if not isinstance(info, Mapping):
+                continue
+            t = info['type']
+            key = t if isinstance(t, STRING_TYPES) else t[0]
+            if key not in BUFFERS:
+                rtn.append((member, info))
+        return rtn
+
+    def layout(self, clsctx):
+        """A 64 bit FNV-1a hash of the class name and the names and types of the
+        members written, which is written ahead of them, so that the binary
+        state of other builds of the class is not misread.
+        """
+        s = self.given_classname
+        for member, info in self.members(clsctx):
+            s += ';{0}:{1}'.format(member, type_to_str(info['type']))
+        h = 0xcbf29ce484222325
+        for c in bytearray(s.encode('utf-8')):
+            h = ((h ^ c) * 0x100000001b3) & 0xffffffffffffffff
+        return '0x{0:016x}ULL'.format(h)
+
+
+class SnapshotBinaryFilter(BinaryFilter):
+    """Filter for handling SnapshotBinary() code generation:
+        #pragma cyclus [def|decl|impl] snapshotbinary [classname]
+    """
+    methodname = 'SnapshotBinary'
+    pragmaname = 'snapshotbinary'
+    methodrtn = 'bool'
+
+    def methodargs(self):
+        return CYCNS + '::BinaryWriter* w'
+
+    def impl(self, ind="  "):
+        clsctx = self.machine.context[self.given_classname]
+        impl = ind + 'w->PutRaw<boost::uint64_t>({0});\n'.format(
+            self.layout(clsctx))
+        for member, info in self.members(clsctx):
+            impl += ind + 'w->Put({0});\n'.format(member)
+        impl += ind + 'return true;\n'
+        return impl
+
+
+class InitFromBinaryFilter(BinaryFilter):
+    """Filter for handling InitFromBinary() code generation:
+        #pragma cyclus [def|decl|impl] initfrombinary [classname]
+    """
+    methodname = 'InitFromBinary'
+    pragmaname = 'initfrombinary'
+    methodrtn = 'void'
+
+    def methodargs(self):
+        return CYCNS + '::BinaryReader* r'
+
+    def impl(self, ind="  "):
+        clsctx = self.machine.context[self.given_classname]
+        ctx = clsctx['vars']
+        impl = ind + 'if (r->GetRaw<boost::uint64_t>() != {0}) {{\n'.format(
+            self.layout(clsctx))
+        impl += ind + '  throw {0}::IOError("binary state of {1} was written by '\
+                      'another build");\n'.format(CYCNS, self.given_classname)
+        impl += ind + '}\n'
+        impl += self.shapes_impl(ctx, ind)
+        for member, info in self.members(clsctx):
+            impl += ind + 'r->Get(&{0});\n'.format(member)
+
+        # buffers are sized as in InitFrom(QueryableBackend*)
+        for member, info in ctx.items():
+            if not isinstance(info, Mapping):
+                continue
+            t = info['type']
+            key = t if isinstance(t, STRING_TYPES) else t[0]
+            if key not in BUFFERS:
+                continue
+            if 'capacity' not in info:
+                info = dict(info)
+                info['capacity'] = 1e300
+            t_impl = InitFromDbFilter.res_impl[key].format(
+                var=member, tstr=type_to_str(t), col='', **info)
+            impl += ind + t_impl.replace('\n', '\n' + ind).strip(' ')
+        return impl
+
+
 class SnapshotInvFilter(CodeGeneratorFilter):
     """Filter for handling SnapshotInv() code generation:
         #pragma cyclus [def|decl|impl] snapshotinv [classname]
@@ -2042,6 +2255,9 @@ class CodeGenerator(object):
                                 # SnapshotInv has to come before Snapshot for some
                                 # regex reason I don't understand
                                 SnapshotInvFilter(self),
+                                SnapshotDirtyFilter(self),
+                                SnapshotBinaryFilter(self),
+                                InitFromBinaryFilter(self),
                                 SnapshotFilter(self),
                                 ]
         self.filters = self.codegen_filters + [ClassFilter(self),
@@ -5,12 +5,16 @@ handling. -- scopatz 2017-01-02, for more information see.
 see https://github.com/cython/cython/issues/1573
 """
 from __future__ import unicode_literals, print_function
+import io
 import time
 import json
+import struct
 from functools import wraps
 from collections.abc import Set, Sequence
 
-from cyclus.system import asyncio
+import numpy as np
+
+from cyclus.system import asyncio, pyarrow
 from cyclus import lib
 from cyclus.jsoncpp import FastWriter
 
@@ -169,6 +173,94 @@ async def send_table_data(state, table, conds=None, orient='split'):
     await send_message(state, "table_data", params=params, data=data)
 
 
+def rows_as_frame(event, params, cols):
+    """Packs the columns of some rows into a binary frame. The frame is the
+    length of a JSON header as a 4 byte little-endian unsigned integer, the
+    header, and the rows, as an Arrow IPC stream if pyarrow is available or
+    as a NumPy .npz archive otherwise. The header holds the event name, the
+    params, the number of rows, and the format of the rows, "arrow" or
+    "npz".
+    """
+    nrows = len(next(iter(cols.values()))) if len(cols) > 0 else 0
+    buf = io.BytesIO()
+    if pyarrow is not None:
+        fmt = 'arrow'
+        batch = pyarrow.RecordBatch.from_arrays(
+            [pyarrow.array(c) for c in cols.values()], names=list(cols.keys()))
+        with pyarrow.ipc.new_stream(buf, batch.schema) as writer:
+            writer.write_batch(batch)
+    else:
+        fmt = 'npz'
+        np.savez(buf, **{name: np.asarray(c) for name, c in cols.items()})
+    header = json.dumps({'event': event, 'params': params, 'nrows': nrows,
+                         'format': fmt}).encode('utf-8')
+    return struct.pack('<I', len(header)) + header + buf.getvalue()
+
+
+def new_rows_as_frame(state, table, client):
+    """Returns a frame of the rows of a table that client has not been sent
+    yet, or None if there are none.
+    """
+    try:
+        cols = state.memory_backend.new_rows(table, client=client)
+    except KeyError:
+        # nothing has been recorded to the table yet
+        return None
+    if len(cols) == 0 or len(next(iter(cols.values()))) == 0:
+        return None
+    params = {'table': table, 'client': client}
+    return rows_as_frame('table_rows', params, cols)
+
+
+@action
+async def stream_tables(state, tables, period=1.0, client=None):
+    """Streams the rows recorded to tables as the simulation runs. At most
+    once every period seconds, the rows added to each table since they were
+    last sent are sent as one binary "table_rows" frame per table (see
+    rows_as_frame()), so that long runs can be followed without resending
+    whole tables. Tables must be stored by the in-memory backend. Streaming
+    again replaces the current stream; stop_stream ends it.
+
+    Parameters
+    ----------
+    tables : str, set, or sequence of str
+        The names of the tables to stream.
+    period : float, optional
+        The least time between frames of a table, in seconds.
+    client : str or None, optional
+        The client whose high-water marks are used, so that each client of
+        a simulation is sent every row once.
+    """
+    tables = sorted(ensure_tables(tables))
+    old = state.tasks.pop('stream', None)
+    if old is not None:
+        old.cancel()
+
+    async def stream():
+        while True:
+            for table in tables:
+                task = state.loop.run_in_executor(
+                    state.executor, new_rows_as_frame, state, table, client)
+                await asyncio.wait([task])
+                frame = task.result()
+                if frame is not None:
+                    await state.send_queue.put(frame)
+            await asyncio.sleep(period)
+
+    state.tasks['stream'] = asyncio.ensure_future(stream())
+
+
+@action
+async def stop_stream(state, client=None):
+    """Stops streaming tables. The client's high-water marks are forgotten,
+    so that streaming again starts from the first row of each table.
+    """
+    task = state.tasks.pop('stream', None)
+    if task is not None:
+        task.cancel()
+    state.memory_backend.reset_marks(client=client)
+
+
 @action
 async def sleep(state, n):
     """Asynchronously sleeps for n seconds."""
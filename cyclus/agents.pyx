@@ -20,7 +20,7 @@ from copy import deepcopy
 from collections import Mapping
 
 from cyclus cimport cpp_cyclus
-from cyclus.cpp_cyclus cimport shared_ptr, reinterpret_pointer_cast
+from cyclus.cpp_cyclus cimport shared_ptr, intrusive_ptr, static_pointer_cast
 from cyclus cimport lib
 from cyclus import lib
 from cyclus cimport cpp_typesystem
@@ -52,9 +52,86 @@ cdef cpp_cyclus.PrefMap[cpp_cyclus.Product].type* _GET_PROD_PREFS_PTR = NULL
 cdef dict _GET_PROD_PREFS = {}
 
 
+cdef void _adjust_material_pref_view(object agent,
+        cpp_cyclus.PrefMap[cpp_cyclus.Material].type& prefs) except *:
+    # passes a vectorized view of the prefs in place of a dict
+    cdef ts.PrefView view = ts.material_pref_map_to_view(prefs)
+    agent.adjust_material_prefs(view)
+    view.apply()
+
+cdef void _adjust_product_pref_view(object agent,
+        cpp_cyclus.PrefMap[cpp_cyclus.Product].type& prefs) except *:
+    # passes a vectorized view of the prefs in place of a dict
+    cdef ts.PrefView view = ts.product_pref_map_to_view(prefs)
+    agent.adjust_product_prefs(view)
+    view.apply()
+
+cdef int _GET_MAT_BIDS_VIEW_TIME = -9999999999
+cdef cpp_cyclus.CommodMap[cpp_cyclus.Material].type* _GET_MAT_BIDS_VIEW_PTR = NULL
+cdef ts.RequestView _GET_MAT_BIDS_VIEW = None
+
+cdef int _GET_PROD_BIDS_VIEW_TIME = -9999999999
+cdef cpp_cyclus.CommodMap[cpp_cyclus.Product].type* _GET_PROD_BIDS_VIEW_PTR = NULL
+cdef ts.RequestView _GET_PROD_BIDS_VIEW = None
+
+
+cdef std_set[shared_ptr[cpp_cyclus.BidPortfolio[cpp_cyclus.Material]]] _get_material_bids_view(
+        object agent, int time,
+        cpp_cyclus.CommodMap[cpp_cyclus.Material].type& commod_requests,
+        cpp_cyclus.Trader* bidder) except *:
+    # passes a vectorized view of the requests in place of a dict, caching it
+    # for the other bidders of the exchange
+    global _GET_MAT_BIDS_VIEW_TIME, _GET_MAT_BIDS_VIEW_PTR, _GET_MAT_BIDS_VIEW
+    cdef std_set[shared_ptr[cpp_cyclus.BidPortfolio[cpp_cyclus.Material]]] ports
+    cdef shared_ptr[cpp_cyclus.BidPortfolio[cpp_cyclus.Material]] port
+    if time != _GET_MAT_BIDS_VIEW_TIME or &commod_requests != _GET_MAT_BIDS_VIEW_PTR:
+        _GET_MAT_BIDS_VIEW = ts.material_commod_map_to_view(commod_requests)
+        _GET_MAT_BIDS_VIEW_TIME = time
+        _GET_MAT_BIDS_VIEW_PTR = &commod_requests
+    cdef ts.RequestView view = _GET_MAT_BIDS_VIEW
+    pybids = agent.get_material_bids(view)
+    if pybids is None:
+        return ports
+    elif isinstance(pybids, Mapping) or hasattr(pybids, 'dtype'):
+        pybids = [pybids]
+    for b in pybids:
+        port = ts.material_bid_arrays_to_cpp(b, view, bidder)
+        if port.get().bids().size() > 0:
+            ports.insert(port)
+    return ports
+
+
+cdef std_set[shared_ptr[cpp_cyclus.BidPortfolio[cpp_cyclus.Product]]] _get_product_bids_view(
+        object agent, int time,
+        cpp_cyclus.CommodMap[cpp_cyclus.Product].type& commod_requests,
+        cpp_cyclus.Trader* bidder) except *:
+    # passes a vectorized view of the requests in place of a dict, caching it
+    # for the other bidders of the exchange
+    global _GET_PROD_BIDS_VIEW_TIME, _GET_PROD_BIDS_VIEW_PTR, _GET_PROD_BIDS_VIEW
+    cdef std_set[shared_ptr[cpp_cyclus.BidPortfolio[cpp_cyclus.Product]]] ports
+    cdef shared_ptr[cpp_cyclus.BidPortfolio[cpp_cyclus.Product]] port
+    if time != _GET_PROD_BIDS_VIEW_TIME or &commod_requests != _GET_PROD_BIDS_VIEW_PTR:
+        _GET_PROD_BIDS_VIEW = ts.product_commod_map_to_view(commod_requests)
+        _GET_PROD_BIDS_VIEW_TIME = time
+        _GET_PROD_BIDS_VIEW_PTR = &commod_requests
+    cdef ts.RequestView view = _GET_PROD_BIDS_VIEW
+    pybids = agent.get_product_bids(view)
+    if pybids is None:
+        return ports
+    elif isinstance(pybids, Mapping) or hasattr(pybids, 'dtype'):
+        pybids = [pybids]
+    for b in pybids:
+        port = ts.product_bid_arrays_to_cpp(b, view, bidder)
+        if port.get().bids().size() > 0:
+            ports.insert(port)
+    return ports
+
 #
 # Shims
 #
+# The C++ simulation runs without the GIL (see Timer::RunSim), so every shim
+# method that may be called from C++ takes it with "with gil".
+#
 cdef cppclass CyclusAgentShim "CyclusAgentShim" (cpp_cyclus.Agent):
     # A C++ class that acts as an Agent. It implements the Agent virtual
     # methods and dispatches the work to a Python/Cython object
@@ -63,11 +140,11 @@ cdef cppclass CyclusAgentShim "CyclusAgentShim" (cpp_cyclus.Agent):
     CyclusAgentShim(cpp_cyclus.Context* ctx):  # C++BASES cyclus::Agent(ctx)
         pass
 
-    std_string version() except +:
+    std_string version() except + with gil:
         rtn = (<object> this.self).version
         return str_py_to_cpp(rtn)
 
-    cpp_cyclus.Agent* Clone() except +:
+    cpp_cyclus.Agent* Clone() except + with gil:
         cdef lib._Context ctx = lib.Context(init=False)
         (<lib._Context> ctx).ptx = this.context()
         cdef _Agent a = type(<object> this.self)(ctx)
@@ -76,11 +153,11 @@ cdef cppclass CyclusAgentShim "CyclusAgentShim" (cpp_cyclus.Agent):
         lib._AGENT_REFS[a.id] = a
         return dynamic_cast[agent_ptr]((<_Agent> a).shim)
 
-    void InitFromAgent "InitFrom" (CyclusAgentShim* a) except +:
+    void InitFromAgent "InitFrom" (CyclusAgentShim* a) except + with gil:
         cpp_cyclus.Agent.InitFromAgent(a)
         (<object> this.self).init_from_agent(<object> a.self)
 
-    void InfileToDb(cpp_cyclus.InfileTree* tree, cpp_cyclus.DbInit di) except +:
+    void InfileToDb(cpp_cyclus.InfileTree* tree, cpp_cyclus.DbInit di) except + with gil:
         cpp_cyclus.Agent.InfileToDb(tree, di)
         # wrap interface
         cdef lib._InfileTree py_tree = lib.InfileTree(free=False)
@@ -90,7 +167,7 @@ cdef cppclass CyclusAgentShim "CyclusAgentShim" (cpp_cyclus.Agent):
         # call generic python
         (<object> this.self).infile_to_db(py_tree, py_di)
 
-    void InitFrom(cpp_cyclus.QueryableBackend* b) except +:
+    void InitFrom(cpp_cyclus.QueryableBackend* b) except + with gil:
         cpp_cyclus.Agent.InitFrom(b)
         cdef cpp_cyclus.QueryResult qr = b.Query(std_string(<char*> "Info"), NULL)
         res, _ = lib.single_query_result_to_py(qr, 0)
@@ -99,43 +176,46 @@ cdef cppclass CyclusAgentShim "CyclusAgentShim" (cpp_cyclus.Agent):
         self.init_from_dict(res)
         lib._AGENT_REFS[self.id] = self
 
-    void Snapshot(cpp_cyclus.DbInit di) except +:
+    void Snapshot(cpp_cyclus.DbInit di) except + with gil:
         cdef lib._DbInit py_di = lib.DbInit(free=False)
         py_di.ptx = &di
         (<object> this.self).snapshot(py_di)
 
-    void InitInv(cpp_cyclus.Inventories& invs) except +:
+    void InitInv(cpp_cyclus.Inventories& invs) except + with gil:
         pyinvs = lib.inventories_to_py(invs)
         (<object> this.self).init_inv(pyinvs)
 
-    cpp_cyclus.Inventories SnapshotInv() except +:
+    cpp_cyclus.Inventories SnapshotInv() except + with gil:
         pyinvs = (<object> this.self).snapshot_inv()
         return lib.inventories_to_cpp(pyinvs)
 
-    std_string schema() except +:
+    std_string schema() except + with gil:
         pyschema = (<object> this.self).schema
         return str_py_to_cpp(pyschema)
 
-    cpp_jsoncpp.Value annotations() except +:
+    cpp_jsoncpp.Value annotations() except + with gil:
         pyanno = (<object> this.self).annotations_json
         return lib.str_to_json_value(pyanno)
 
-    void Build(cpp_cyclus.Agent* parent) except +:
+    void Build(cpp_cyclus.Agent* parent) except + with gil:
         cpp_cyclus.Agent.Build(parent)
         pyrent = lib.agent_to_py(parent, None)
         (<object> this.self).build(pyrent)
 
-    void EnterNotify() except +:
+    void EnterNotify() except + with gil:
         cpp_cyclus.Agent.EnterNotify()
         (<object> this.self).enter_notify()
 
-    void BuildNotify() except +:
+    void BuildNotify() except + with gil:
         (<object> this.self).build_notify()
 
-    void DecomNotify() except +:
+    void DecomNotify() except + with gil:
         (<object> this.self).decom_notify()
 
-    void AdjustMatlPrefs(cpp_cyclus.PrefMap[cpp_cyclus.Material].type& prefs) except +:
+    void AdjustMatlPrefs(cpp_cyclus.PrefMap[cpp_cyclus.Material].type& prefs) except + with gil:
+        if getattr(<object> this.self, 'vectorized_prefs', False):
+            _adjust_material_pref_view(<object> this.self, prefs)
+            return
         # cache the commod_reqs wrappers globally
         global _GET_MAT_PREFS_TIME, _GET_MAT_PREFS_PTR, _GET_MAT_PREFS
         cdef int curr_time = this.context().time()
@@ -156,7 +236,10 @@ cdef cppclass CyclusAgentShim "CyclusAgentShim" (cpp_cyclus.Agent):
         for (req, bid), pref in updates.items():
             prefs[(<ts._MaterialRequest> req).ptx][(<ts._MaterialBid> bid).ptx] = pref
 
-    void AdjustProductPrefs(cpp_cyclus.PrefMap[cpp_cyclus.Product].type& prefs) except +:
+    void AdjustProductPrefs(cpp_cyclus.PrefMap[cpp_cyclus.Product].type& prefs) except + with gil:
+        if getattr(<object> this.self, 'vectorized_prefs', False):
+            _adjust_product_pref_view(<object> this.self, prefs)
+            return
         # cache the commod_reqs wrappers globally
         global _GET_PROD_PREFS_TIME, _GET_PROD_PREFS_PTR, _GET_PROD_PREFS
         cdef int curr_time = this.context().time()
@@ -186,11 +269,11 @@ cdef cppclass CyclusRegionShim "CyclusRegionShim" (cpp_cyclus.Region):
     CyclusRegionShim(cpp_cyclus.Context* ctx):  # C++BASES cyclus::Region(ctx)
         pass
 
-    std_string version() except +:
+    std_string version() except + with gil:
         rtn = (<object> this.self).version
         return str_py_to_cpp(rtn)
 
-    cpp_cyclus.Agent* Clone() except +:
+    cpp_cyclus.Agent* Clone() except + with gil:
         cdef lib._Context ctx = lib.Context(init=False)
         (<lib._Context> ctx).ptx = this.context()
         cdef _Region a = type(<object> this.self)(ctx)
@@ -200,11 +283,11 @@ cdef cppclass CyclusRegionShim "CyclusRegionShim" (cpp_cyclus.Region):
         return dynamic_cast[agent_ptr](
                 reinterpret_cast[region_shim_ptr]((<_Agent> a).shim))
 
-    void InitFromAgent "InitFrom" (CyclusRegionShim* a) except +:
+    void InitFromAgent "InitFrom" (CyclusRegionShim* a) except + with gil:
         cpp_cyclus.Region.InitFromAgent(a)
         (<object> this.self).init_from_agent(<object> a.self)
 
-    void InfileToDb(cpp_cyclus.InfileTree* tree, cpp_cyclus.DbInit di) except +:
+    void InfileToDb(cpp_cyclus.InfileTree* tree, cpp_cyclus.DbInit di) except + with gil:
         cpp_cyclus.Region.InfileToDb(tree, di)
         # wrap interface
         cdef lib._InfileTree py_tree = lib.InfileTree(free=False)
@@ -214,7 +297,7 @@ cdef cppclass CyclusRegionShim "CyclusRegionShim" (cpp_cyclus.Region):
         # call generic python
         (<object> this.self).infile_to_db(py_tree, py_di)
 
-    void InitFrom(cpp_cyclus.QueryableBackend* b) except +:
+    void InitFrom(cpp_cyclus.QueryableBackend* b) except + with gil:
         cpp_cyclus.Region.InitFrom(b)
         cdef cpp_cyclus.QueryResult qr = b.Query(std_string(<char*> "Info"), NULL)
         res, _ = lib.single_query_result_to_py(qr, 0)
@@ -223,43 +306,46 @@ cdef cppclass CyclusRegionShim "CyclusRegionShim" (cpp_cyclus.Region):
         self.init_from_dict(res)
         lib._AGENT_REFS[self.id] = self
 
-    void Snapshot(cpp_cyclus.DbInit di) except +:
+    void Snapshot(cpp_cyclus.DbInit di) except + with gil:
         cdef lib._DbInit py_di = lib.DbInit(free=False)
         py_di.ptx = &di
         (<object> this.self).snapshot(py_di)
 
-    void InitInv(cpp_cyclus.Inventories& invs) except +:
+    void InitInv(cpp_cyclus.Inventories& invs) except + with gil:
         pyinvs = lib.inventories_to_py(invs)
         (<object> this.self).init_inv(pyinvs)
 
-    cpp_cyclus.Inventories SnapshotInv() except +:
+    cpp_cyclus.Inventories SnapshotInv() except + with gil:
         pyinvs = (<object> this.self).snapshot_inv()
         return lib.inventories_to_cpp(pyinvs)
 
-    std_string schema() except +:
+    std_string schema() except + with gil:
         pyschema = (<object> this.self).schema
         return str_py_to_cpp(pyschema)
 
-    cpp_jsoncpp.Value annotations() except +:
+    cpp_jsoncpp.Value annotations() except + with gil:
         pyanno = (<object> this.self).annotations_json
         return lib.str_to_json_value(pyanno)
 
-    void Build(cpp_cyclus.Agent* parent) except +:
+    void Build(cpp_cyclus.Agent* parent) except + with gil:
         cpp_cyclus.Region.Build(parent)
         pyrent = lib.agent_to_py(parent, None)
         (<object> this.self).build(pyrent)
 
-    void EnterNotify() except +:
+    void EnterNotify() except + with gil:
         cpp_cyclus.Region.EnterNotify()
         (<object> this.self).enter_notify()
 
-    void BuildNotify() except +:
+    void BuildNotify() except + with gil:
         (<object> this.self).build_notify()
 
-    void DecomNotify() except +:
+    void DecomNotify() except + with gil:
         (<object> this.self).decom_notify()
 
-    void AdjustMatlPrefs(cpp_cyclus.PrefMap[cpp_cyclus.Material].type& prefs) except +:
+    void AdjustMatlPrefs(cpp_cyclus.PrefMap[cpp_cyclus.Material].type& prefs) except + with gil:
+        if getattr(<object> this.self, 'vectorized_prefs', False):
+            _adjust_material_pref_view(<object> this.self, prefs)
+            return
         # cache the commod_reqs wrappers globally
         global _GET_MAT_PREFS_TIME, _GET_MAT_PREFS_PTR, _GET_MAT_PREFS
         cdef int curr_time = this.context().time()
@@ -280,7 +366,10 @@ cdef cppclass CyclusRegionShim "CyclusRegionShim" (cpp_cyclus.Region):
         for (req, bid), pref in updates.items():
             prefs[(<ts._MaterialRequest> req).ptx][(<ts._MaterialBid> bid).ptx] = pref
 
-    void AdjustProductPrefs(cpp_cyclus.PrefMap[cpp_cyclus.Product].type& prefs) except +:
+    void AdjustProductPrefs(cpp_cyclus.PrefMap[cpp_cyclus.Product].type& prefs) except + with gil:
+        if getattr(<object> this.self, 'vectorized_prefs', False):
+            _adjust_product_pref_view(<object> this.self, prefs)
+            return
         # cache the commod_reqs wrappers globally
         global _GET_PROD_PREFS_TIME, _GET_PROD_PREFS_PTR, _GET_PROD_PREFS
         cdef int curr_time = this.context().time()
@@ -301,13 +390,13 @@ cdef cppclass CyclusRegionShim "CyclusRegionShim" (cpp_cyclus.Region):
         for (req, bid), pref in updates.items():
             prefs[(<ts._ProductRequest> req).ptx][(<ts._ProductBid> bid).ptx] = pref
 
-    void Tick() except +:
+    void Tick() except + with gil:
         (<object> this.self).tick()
 
-    void Tock() except +:
+    void Tock() except + with gil:
         (<object> this.self).tock()
 
-    void Decision() except +:
+    void Decision() except + with gil:
         (<object> this.self).decision()
 
 
@@ -319,11 +408,11 @@ cdef cppclass CyclusInstitutionShim "CyclusInstitutionShim" (cpp_cyclus.Institut
     CyclusInstitutionShim(cpp_cyclus.Context* ctx):  # C++BASES cyclus::Institution(ctx)
         pass
 
-    std_string version() except +:
+    std_string version() except + with gil:
         rtn = (<object> this.self).version
         return str_py_to_cpp(rtn)
 
-    cpp_cyclus.Agent* Clone() except +:
+    cpp_cyclus.Agent* Clone() except + with gil:
         cdef lib._Context ctx = lib.Context(init=False)
         (<lib._Context> ctx).ptx = this.context()
         cdef _Institution a = type(<object> this.self)(ctx)
@@ -333,11 +422,11 @@ cdef cppclass CyclusInstitutionShim "CyclusInstitutionShim" (cpp_cyclus.Institut
         return dynamic_cast[agent_ptr](
                 reinterpret_cast[institution_shim_ptr]((<_Agent> a).shim))
 
-    void InitFromAgent "InitFrom" (CyclusInstitutionShim* a) except +:
+    void InitFromAgent "InitFrom" (CyclusInstitutionShim* a) except + with gil:
         cpp_cyclus.Institution.InitFromAgent(a)
         (<object> this.self).init_from_agent(<object> a.self)
 
-    void InfileToDb(cpp_cyclus.InfileTree* tree, cpp_cyclus.DbInit di) except +:
+    void InfileToDb(cpp_cyclus.InfileTree* tree, cpp_cyclus.DbInit di) except + with gil:
         cpp_cyclus.Institution.InfileToDb(tree, di)
         # wrap interface
         cdef lib._InfileTree py_tree = lib.InfileTree(free=False)
@@ -347,7 +436,7 @@ cdef cppclass CyclusInstitutionShim "CyclusInstitutionShim" (cpp_cyclus.Institut
         # call generic python
         (<object> this.self).infile_to_db(py_tree, py_di)
 
-    void InitFrom(cpp_cyclus.QueryableBackend* b) except +:
+    void InitFrom(cpp_cyclus.QueryableBackend* b) except + with gil:
         cpp_cyclus.Institution.InitFrom(b)
         cdef cpp_cyclus.QueryResult qr = b.Query(std_string(<char*> "Info"), NULL)
         res, _ = lib.single_query_result_to_py(qr, 0)
@@ -356,43 +445,46 @@ cdef cppclass CyclusInstitutionShim "CyclusInstitutionShim" (cpp_cyclus.Institut
         self.init_from_dict(res)
         lib._AGENT_REFS[self.id] = self
 
-    void Snapshot(cpp_cyclus.DbInit di) except +:
+    void Snapshot(cpp_cyclus.DbInit di) except + with gil:
         cdef lib._DbInit py_di = lib.DbInit(free=False)
         py_di.ptx = &di
         (<object> this.self).snapshot(py_di)
 
-    void InitInv(cpp_cyclus.Inventories& invs) except +:
+    void InitInv(cpp_cyclus.Inventories& invs) except + with gil:
         pyinvs = lib.inventories_to_py(invs)
         (<object> this.self).init_inv(pyinvs)
 
-    cpp_cyclus.Inventories SnapshotInv() except +:
+    cpp_cyclus.Inventories SnapshotInv() except + with gil:
         pyinvs = (<object> this.self).snapshot_inv()
         return lib.inventories_to_cpp(pyinvs)
 
-    std_string schema() except +:
+    std_string schema() except + with gil:
         pyschema = (<object> this.self).schema
         return str_py_to_cpp(pyschema)
 
-    cpp_jsoncpp.Value annotations() except +:
+    cpp_jsoncpp.Value annotations() except + with gil:
         pyanno = (<object> this.self).annotations_json
         return lib.str_to_json_value(pyanno)
 
-    void Build(cpp_cyclus.Agent* parent) except +:
+    void Build(cpp_cyclus.Agent* parent) except + with gil:
         cpp_cyclus.Institution.Build(parent)
         pyrent = lib.agent_to_py(parent, None)
         (<object> this.self).build(pyrent)
 
-    void EnterNotify() except +:
+    void EnterNotify() except + with gil:
         cpp_cyclus.Institution.EnterNotify()
         (<object> this.self).enter_notify()
 
-    void BuildNotify() except +:
+    void BuildNotify() except + with gil:
         (<object> this.self).build_notify()
 
-    void DecomNotify() except +:
+    void DecomNotify() except + with gil:
         (<object> this.self).decom_notify()
 
-    void AdjustMatlPrefs(cpp_cyclus.PrefMap[cpp_cyclus.Material].type& prefs) except +:
+    void AdjustMatlPrefs(cpp_cyclus.PrefMap[cpp_cyclus.Material].type& prefs) except + with gil:
+        if getattr(<object> this.self, 'vectorized_prefs', False):
+            _adjust_material_pref_view(<object> this.self, prefs)
+            return
         # cache the commod_reqs wrappers globally
         global _GET_MAT_PREFS_TIME, _GET_MAT_PREFS_PTR, _GET_MAT_PREFS
         cdef int curr_time = this.context().time()
@@ -413,7 +505,10 @@ cdef cppclass CyclusInstitutionShim "CyclusInstitutionShim" (cpp_cyclus.Institut
         for (req, bid), pref in updates.items():
             prefs[(<ts._MaterialRequest> req).ptx][(<ts._MaterialBid> bid).ptx] = pref
 
-    void AdjustProductPrefs(cpp_cyclus.PrefMap[cpp_cyclus.Product].type& prefs) except +:
+    void AdjustProductPrefs(cpp_cyclus.PrefMap[cpp_cyclus.Product].type& prefs) except + with gil:
+        if getattr(<object> this.self, 'vectorized_prefs', False):
+            _adjust_product_pref_view(<object> this.self, prefs)
+            return
         # cache the commod_reqs wrappers globally
         global _GET_PROD_PREFS_TIME, _GET_PROD_PREFS_PTR, _GET_PROD_PREFS
         cdef int curr_time = this.context().time()
@@ -434,14 +529,14 @@ cdef cppclass CyclusInstitutionShim "CyclusInstitutionShim" (cpp_cyclus.Institut
         for (req, bid), pref in updates.items():
             prefs[(<ts._ProductRequest> req).ptx][(<ts._ProductBid> bid).ptx] = pref
 
-    void Tick() except +:
+    void Tick() except + with gil:
         (<object> this.self).tick()
 
-    void Tock() except +:
+    void Tock() except + with gil:
         cpp_cyclus.Institution.Tock()
         (<object> this.self).tock()
 
-    void Decision() except +:
+    void Decision() except + with gil:
         (<object> this.self).decision()
 
 
@@ -461,11 +556,11 @@ cdef cppclass CyclusFacilityShim "CyclusFacilityShim" (cpp_cyclus.Facility):
     CyclusFacilityShim(cpp_cyclus.Context* ctx):  # C++BASES cyclus::Facility(ctx)
         pass
 
-    std_string version() except +:
+    std_string version() except + with gil:
         rtn = (<object> this.self).version
         return str_py_to_cpp(rtn)
 
-    cpp_cyclus.Agent* Clone() except +:
+    cpp_cyclus.Agent* Clone() except + with gil:
         cdef lib._Context ctx = lib.Context(init=False)
         (<lib._Context> ctx).ptx = this.context()
         cdef _Facility a = type(<object> this.self)(ctx)
@@ -475,11 +570,11 @@ cdef cppclass CyclusFacilityShim "CyclusFacilityShim" (cpp_cyclus.Facility):
         return dynamic_cast[agent_ptr](
                 reinterpret_cast[facility_shim_ptr]((<_Agent> a).shim))
 
-    void InitFromAgent "InitFrom" (CyclusFacilityShim* a) except +:
+    void InitFromAgent "InitFrom" (CyclusFacilityShim* a) except + with gil:
         cpp_cyclus.Facility.InitFromAgent(a)
         (<object> this.self).init_from_agent(<object> a.self)
 
-    void InfileToDb(cpp_cyclus.InfileTree* tree, cpp_cyclus.DbInit di) except +:
+    void InfileToDb(cpp_cyclus.InfileTree* tree, cpp_cyclus.DbInit di) except + with gil:
         cpp_cyclus.Facility.InfileToDb(tree, di)
         # wrap interface
         cdef lib._InfileTree py_tree = lib.InfileTree(free=False)
@@ -489,7 +584,7 @@ cdef cppclass CyclusFacilityShim "CyclusFacilityShim" (cpp_cyclus.Facility):
         # call generic python
         (<object> this.self).infile_to_db(py_tree, py_di)
 
-    void InitFrom(cpp_cyclus.QueryableBackend* b) except +:
+    void InitFrom(cpp_cyclus.QueryableBackend* b) except + with gil:
         cpp_cyclus.Facility.InitFrom(b)
         cdef cpp_cyclus.QueryResult qr = b.Query(std_string(<char*> "Info"), NULL)
         res, _ = lib.single_query_result_to_py(qr, 0)
@@ -498,43 +593,46 @@ cdef cppclass CyclusFacilityShim "CyclusFacilityShim" (cpp_cyclus.Facility):
         self.init_from_dict(res)
         lib._AGENT_REFS[self.id] = self
 
-    void Snapshot(cpp_cyclus.DbInit di) except +:
+    void Snapshot(cpp_cyclus.DbInit di) except + with gil:
         cdef lib._DbInit py_di = lib.DbInit(free=False)
         py_di.ptx = &di
         (<object> this.self).snapshot(py_di)
 
-    void InitInv(cpp_cyclus.Inventories& invs) except +:
+    void InitInv(cpp_cyclus.Inventories& invs) except + with gil:
         pyinvs = lib.inventories_to_py(invs)
         (<object> this.self).init_inv(pyinvs)
 
-    cpp_cyclus.Inventories SnapshotInv() except +:
+    cpp_cyclus.Inventories SnapshotInv() except + with gil:
         pyinvs = (<object> this.self).snapshot_inv()
         return lib.inventories_to_cpp(pyinvs)
 
-    std_string schema() except +:
+    std_string schema() except + with gil:
         pyschema = (<object> this.self).schema
         return str_py_to_cpp(pyschema)
 
-    cpp_jsoncpp.Value annotations() except +:
+    cpp_jsoncpp.Value annotations() except + with gil:
         pyanno = (<object> this.self).annotations_json
         return lib.str_to_json_value(pyanno)
 
-    void Build(cpp_cyclus.Agent* parent) except +:
+    void Build(cpp_cyclus.Agent* parent) except + with gil:
         cpp_cyclus.Facility.Build(parent)
         pyrent = lib.agent_to_py(parent, None)
         (<object> this.self).build(pyrent)
 
-    void EnterNotify() except +:
+    void EnterNotify() except + with gil:
         cpp_cyclus.Facility.EnterNotify()
         (<object> this.self).enter_notify()
 
-    void BuildNotify() except +:
+    void BuildNotify() except + with gil:
         (<object> this.self).build_notify()
 
-    void DecomNotify() except +:
+    void DecomNotify() except + with gil:
         (<object> this.self).decom_notify()
 
-    void AdjustMatlPrefs(cpp_cyclus.PrefMap[cpp_cyclus.Material].type& prefs) except +:
+    void AdjustMatlPrefs(cpp_cyclus.PrefMap[cpp_cyclus.Material].type& prefs) except + with gil:
+        if getattr(<object> this.self, 'vectorized_prefs', False):
+            _adjust_material_pref_view(<object> this.self, prefs)
+            return
         # cache the commod_reqs wrappers globally
         global _GET_MAT_PREFS_TIME, _GET_MAT_PREFS_PTR, _GET_MAT_PREFS
         cdef int curr_time = this.context().time()
@@ -555,7 +653,10 @@ cdef cppclass CyclusFacilityShim "CyclusFacilityShim" (cpp_cyclus.Facility):
         for (req, bid), pref in updates.items():
             prefs[(<ts._MaterialRequest> req).ptx][(<ts._MaterialBid> bid).ptx] = pref
 
-    void AdjustProductPrefs(cpp_cyclus.PrefMap[cpp_cyclus.Product].type& prefs) except +:
+    void AdjustProductPrefs(cpp_cyclus.PrefMap[cpp_cyclus.Product].type& prefs) except + with gil:
+        if getattr(<object> this.self, 'vectorized_prefs', False):
+            _adjust_product_pref_view(<object> this.self, prefs)
+            return
         # cache the commod_reqs wrappers globally
         global _GET_PROD_PREFS_TIME, _GET_PROD_PREFS_PTR, _GET_PROD_PREFS
         cdef int curr_time = this.context().time()
@@ -576,20 +677,20 @@ cdef cppclass CyclusFacilityShim "CyclusFacilityShim" (cpp_cyclus.Facility):
         for (req, bid), pref in updates.items():
             prefs[(<ts._ProductRequest> req).ptx][(<ts._ProductBid> bid).ptx] = pref
 
-    void Tick() except +:
+    void Tick() except + with gil:
         (<object> this.self).tick()
 
-    void Tock() except +:
+    void Tock() except + with gil:
         (<object> this.self).tock()
 
-    void Decision() except +:
+    void Decision() except + with gil:
         (<object> this.self).decision()
 
-    cpp_bool CheckDecommissionCondition() except +:
+    cpp_bool CheckDecommissionCondition() except + with gil:
         rtn = (<object> this.self).check_decomission_condition()
         return bool_to_cpp(rtn)
 
-    std_set[shared_ptr[cpp_cyclus.RequestPortfolio[cpp_cyclus.Material]]] GetMatlRequests() except +:
+    std_set[shared_ptr[cpp_cyclus.RequestPortfolio[cpp_cyclus.Material]]] GetMatlRequests() except + with gil:
         pyportfolios = (<object> this.self).get_material_requests()
         cdef std_set[shared_ptr[cpp_cyclus.RequestPortfolio[cpp_cyclus.Material]]] ports = \
             std_set[shared_ptr[cpp_cyclus.RequestPortfolio[cpp_cyclus.Material]]]()
@@ -603,7 +704,7 @@ cdef cppclass CyclusFacilityShim "CyclusFacilityShim" (cpp_cyclus.Facility):
                 ))
         return ports
 
-    std_set[shared_ptr[cpp_cyclus.RequestPortfolio[cpp_cyclus.Product]]] GetProductRequests() except +:
+    std_set[shared_ptr[cpp_cyclus.RequestPortfolio[cpp_cyclus.Product]]] GetProductRequests() except + with gil:
         pyportfolios = (<object> this.self).get_product_requests()
         cdef std_set[shared_ptr[cpp_cyclus.RequestPortfolio[cpp_cyclus.Product]]] ports = \
             std_set[shared_ptr[cpp_cyclus.RequestPortfolio[cpp_cyclus.Product]]]()
@@ -614,10 +715,13 @@ cdef cppclass CyclusFacilityShim "CyclusFacilityShim" (cpp_cyclus.Facility):
             ports.insert(ts.product_request_portfolio_to_cpp(normport, this))
         return ports
 
-    std_set[shared_ptr[cpp_cyclus.BidPortfolio[cpp_cyclus.Material]]] GetMatlBids(cpp_cyclus.CommodMap[cpp_cyclus.Material].type& commod_requests) except +:
+    std_set[shared_ptr[cpp_cyclus.BidPortfolio[cpp_cyclus.Material]]] GetMatlBids(cpp_cyclus.CommodMap[cpp_cyclus.Material].type& commod_requests) except + with gil:
         # cache the commod_reqs wrappers globally
         global _GET_MAT_BIDS_TIME, _GET_MAT_BIDS_PTR, _GET_MAT_BIDS
         cdef int curr_time = this.context().time()
+        if getattr(<object> this.self, 'vectorized_exchange', False):
+            return _get_material_bids_view(<object> this.self, curr_time, commod_requests,
+                dynamic_cast[trader_ptr](reinterpret_cast[facility_shim_ptr](<CyclusFacilityShim*> this)))
         cdef cpp_cyclus.CommodMap[cpp_cyclus.Material].type* curr_ptr = &commod_requests
         if curr_time == _GET_MAT_BIDS_TIME and curr_ptr == _GET_MAT_BIDS_PTR:
             pyreq = _GET_MAT_BIDS
@@ -644,10 +748,12 @@ cdef cppclass CyclusFacilityShim "CyclusFacilityShim" (cpp_cyclus.Facility):
                 ))
         return ports
 
-    std_set[shared_ptr[cpp_cyclus.BidPortfolio[cpp_cyclus.Product]]] GetProductBids(cpp_cyclus.CommodMap[cpp_cyclus.Product].type& commod_requests) except +:
+    std_set[shared_ptr[cpp_cyclus.BidPortfolio[cpp_cyclus.Product]]] GetProductBids(cpp_cyclus.CommodMap[cpp_cyclus.Product].type& commod_requests) except + with gil:
         # cache the commod_reqs wrappers globally
         global _GET_PROD_BIDS_TIME, _GET_PROD_BIDS_PTR, _GET_PROD_BIDS
         cdef int curr_time = this.context().time()
+        if getattr(<object> this.self, 'vectorized_exchange', False):
+            return _get_product_bids_view(<object> this.self, curr_time, commod_requests, this)
         cdef cpp_cyclus.CommodMap[cpp_cyclus.Product].type* curr_ptr = &commod_requests
         if curr_time == _GET_PROD_BIDS_TIME and curr_ptr == _GET_PROD_BIDS_PTR:
             pyreq = _GET_PROD_BIDS
@@ -670,7 +776,7 @@ cdef cppclass CyclusFacilityShim "CyclusFacilityShim" (cpp_cyclus.Facility):
             ports.insert(ts.product_bid_portfolio_to_cpp(normport, this))
         return ports
 
-    void GetMatlTrades(const std_vector[cpp_cyclus.Trade[cpp_cyclus.Material]]& trades, std_vector[std_pair[cpp_cyclus.Trade[cpp_cyclus.Material], shared_ptr[cpp_cyclus.Material]]]& responses) except +:
+    void GetMatlTrades(const std_vector[cpp_cyclus.Trade[cpp_cyclus.Material]]& trades, std_vector[std_pair[cpp_cyclus.Trade[cpp_cyclus.Material], intrusive_ptr[cpp_cyclus.Material]]]& responses) except + with gil:
         pytrades = ts.material_trade_vector_to_py(trades)
         pyresp = (<object> this.self).get_material_trades(pytrades)
         if pyresp is None or len(pyresp) == 0:
@@ -679,13 +785,13 @@ cdef cppclass CyclusFacilityShim "CyclusFacilityShim" (cpp_cyclus.Facility):
             pyresp = dict(pyresp)
         for trade, resp in pyresp.items():
             responses.push_back(std_pair[cpp_cyclus.Trade[cpp_cyclus.Material],
-                                         shared_ptr[cpp_cyclus.Material]](
+                                         intrusive_ptr[cpp_cyclus.Material]](
                 deref((<ts._MaterialTrade> trade).ptx),
-                reinterpret_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
+                static_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
                     (<ts._Material> resp).ptx)
                 ))
 
-    void GetProductTrades(const std_vector[cpp_cyclus.Trade[cpp_cyclus.Product]]& trades, std_vector[std_pair[cpp_cyclus.Trade[cpp_cyclus.Product], shared_ptr[cpp_cyclus.Product]]]& responses) except +:
+    void GetProductTrades(const std_vector[cpp_cyclus.Trade[cpp_cyclus.Product]]& trades, std_vector[std_pair[cpp_cyclus.Trade[cpp_cyclus.Product], intrusive_ptr[cpp_cyclus.Product]]]& responses) except + with gil:
         pytrades = ts.product_trade_vector_to_py(trades)
         pyresp = (<object> this.self).get_product_trades(pytrades)
         if pyresp is None or len(pyresp) == 0:
@@ -694,17 +800,17 @@ cdef cppclass CyclusFacilityShim "CyclusFacilityShim" (cpp_cyclus.Facility):
             pyresp = dict(pyresp)
         for trade, resp in pyresp.items():
             responses.push_back(std_pair[cpp_cyclus.Trade[cpp_cyclus.Product],
-                                         shared_ptr[cpp_cyclus.Product]](
+                                         intrusive_ptr[cpp_cyclus.Product]](
                 deref((<ts._ProductTrade> trade).ptx),
-                reinterpret_pointer_cast[cpp_cyclus.Product, cpp_cyclus.Resource](
+                static_pointer_cast[cpp_cyclus.Product, cpp_cyclus.Resource](
                     (<ts._Product> resp).ptx)
                 ))
 
-    void AcceptMatlTrades(const std_vector[std_pair[cpp_cyclus.Trade[cpp_cyclus.Material], shared_ptr[cpp_cyclus.Material]]]& responses) except +:
+    void AcceptMatlTrades(const std_vector[std_pair[cpp_cyclus.Trade[cpp_cyclus.Material], intrusive_ptr[cpp_cyclus.Material]]]& responses) except + with gil:
         pyresp = ts.material_responses_to_py(responses)
         (<object> this.self).accept_material_trades(pyresp)
 
-    void AcceptProductTrades(const std_vector[std_pair[cpp_cyclus.Trade[cpp_cyclus.Product], shared_ptr[cpp_cyclus.Product]]]& responses) except +:
+    void AcceptProductTrades(const std_vector[std_pair[cpp_cyclus.Trade[cpp_cyclus.Product], intrusive_ptr[cpp_cyclus.Product]]]& responses) except + with gil:
         pyresp = ts.product_responses_to_py(responses)
         (<object> this.self).accept_product_trades(pyresp)
 
@@ -745,9 +851,9 @@ cdef class _Agent(lib._Agent):
             if var.value is not None:
                 pass
             elif var.default is None:
-                var.value = ts.new_py_inst(var.uniquetypeid)
+                var.value = var.coerce(ts.new_py_inst(var.uniquetypeid))
             else:
-                var.value = var.default
+                var.value = var.coerce(var.default)
             self.__dict__[name] = var
             svs.append((name, var))
         self._statevars = tuple(svs)
@@ -809,14 +915,15 @@ cdef class _Agent(lib._Agent):
                 if var.default is None:
                     raise RuntimeError('state variables marked as internal '
                                        'must have a default')
-                var.value = var.default
+                var.value = var.coerce(var.default)
                 continue
             query = var.alias if isinstance(var.alias, str) else var.alias[0]
             if var.default is not None and sub.nmatches(query) == 0:
-                var.value = var.default
+                var.value = var.coerce(var.default)
                 continue
             else:
-                var.value = self._read_from_infile(sub, var.alias, var.type, var.uitype)
+                var.value = var.coerce(self._read_from_infile(sub, var.alias,
+                                                              var.type, var.uitype))
         # Write out to db
         datum = di.new_datum("Info")
         for name, var in self._statevars:
@@ -1027,11 +1134,16 @@ cdef class _Agent(lib._Agent):
         pass
 
     def adjust_material_prefs(self, prefs):
-        """Product preferences adjustment."""
+        """Material preferences adjustment. prefs is a dict mapping (request,
+        bid) tuples to preferences, and the changed preferences are returned
+        in a dict like it. If the agent's vectorized_prefs attribute is True,
+        prefs is instead a typesystem.PrefView, whose pref array is changed
+        in place, which is much faster for large exchanges.
+        """
         return None
 
     def adjust_product_prefs(self, prefs):
-        """Product preferences adjustment."""
+        """Product preferences adjustment, like adjust_material_prefs()."""
         return None
 
 
@@ -1659,13 +1771,17 @@ class Facility(_Facility):
 
     def get_material_bids(self, requests):
         """Returns material bids for this agent on this time step.
-        This may be overridden is subclasses.
+        This may be overridden is subclasses. If the agent's
+        vectorized_exchange attribute is True, requests is a
+        typesystem.RequestView of arrays rather than a dict of request
+        objects, and the bids are returned as arrays too, which is much
+        faster for large exchanges.
         """
         return []
 
     def get_product_bids(self, requests):
         """Returns product bids for this agent on this time step.
-        This may be overridden is subclasses.
+        This may be overridden is subclasses, like get_material_bids().
         """
         return []
 
@@ -51,6 +51,16 @@ cdef extern from "cyclus.h" namespace "boost":
 
     shared_ptr[T] reinterpret_pointer_cast[T,U](shared_ptr[U])
 
+    # resources and compositions count their own references
+    cdef cppclass intrusive_ptr[T]:
+        intrusive_ptr()
+        intrusive_ptr(T*)
+        T* get()
+        T& operator*()
+        swap(intrusive_ptr&)
+
+    intrusive_ptr[T] static_pointer_cast[T,U](intrusive_ptr[U])
+
 cdef extern from "version.h" namespace "cyclus::version":
 
     const char* describe() except +
@@ -127,6 +137,13 @@ cdef extern from "cyclus.h" namespace "cyclus":
         CmpOpCode opcode
         hold_any val
 
+    cdef cppclass Agg:
+        Agg() except +
+        Agg(std_string, std_string) except +
+
+        std_string op
+        std_string field
+
     cdef cppclass QueryResult:
         QueryResult() except +
 
@@ -147,15 +164,35 @@ cdef extern from "cyclus.h" namespace "cyclus":
         DbTypes dbtype
         vector[int] shape
 
+    cdef cppclass QueryCursor:
+        QueryResult Next(int) except +
+
+    cdef cppclass Lineage:
+        vector[int] resources
+        vector[int] depths
+        vector[int] transactions
+
     cdef cppclass QueryableBackend:
         QueryResult Query(std_string, vector[Cond]*) except +
+        QueryResult Query(std_string, vector[Cond]*, vector[std_string]*) except +
+        shared_ptr[QueryCursor] Cursor(std_string, vector[Cond]*,
+                                       vector[std_string]*) except +
+        QueryResult Aggregate(std_string, vector[Cond]*, vector[std_string]*,
+                              const vector[Agg]&) except +
         map[std_string, DbTypes] ColumnTypes(std_string) except +
         list[ColumnInfo] Schema(std_string)
         set[std_string] Tables() except +
+        Lineage Ancestors(int, int, vector[Cond]*) except +
+        Lineage Descendants(int, int, vector[Cond]*) except +
 
     cdef cppclass FullBackend(QueryableBackend, RecBackend):
         FullBackend() except +
 
+    cdef cppclass TableStats:
+        uint64_t rows
+        uint64_t bytes
+        map[std_string, double] notify_secs
+
     cdef cppclass Recorder:
         Recorder() except +
         Recorder(cpp_bool) except +
@@ -167,6 +204,9 @@ cdef extern from "cyclus.h" namespace "cyclus":
         uuid sim_id() except +
         Datum* NewDatum(std_string)
         void RegisterBackend(RecBackend*) except +
+        cpp_bool collect_stats() except +
+        void set_collect_stats(cpp_bool) except +
+        map[std_string, TableStats] stats() except +
         void Flush() except +
         void Close() except +
 
@@ -175,12 +215,40 @@ cdef extern from "sqlite_back.h" namespace "cyclus":
 
     cdef cppclass SqliteBack(FullBackend):
         SqliteBack(std_string) except +
+        SqliteBack(std_string, cpp_bool) except +
+        cpp_bool readonly()
+        void index_lineage(cpp_bool)
+        cpp_bool index_lineage()
+
+
+cdef extern from "column_store.h" namespace "cyclus":
+
+    cdef cppclass StoreColumn "cyclus::ColumnStore::Column":
+        std_string name()
+        cpp_bool boxed()
+        DbTypes type()
+        size_t itemsize()
+        size_t size()
+        shared_ptr[vector[char]] buffer()
+        vector[hold_any]& values()
+
+    cdef cppclass ColumnStore(RecBackend):
+        ColumnStore() except +
+        set[std_string] Tables()
+        vector[StoreColumn]* table(std_string)
+        size_t nrows(std_string)
+        void Drop(std_string)
+        void Clear()
 
 
 cdef extern from "hdf5_back.h" namespace "cyclus":
 
     cdef cppclass Hdf5Back(FullBackend):
         Hdf5Back(std_string) except +
+        void set_index_lineage(cpp_bool)
+        cpp_bool index_lineage()
+        @staticmethod
+        void MergeShards(std_string, vector[std_string]) except +
 
 
 cdef extern from "dynamic_module.h" namespace "cyclus":
@@ -261,6 +329,12 @@ cdef extern from "logger.h" namespace "cyclus":
         @staticmethod
         void SetNoMem(cpp_bool) except +
         @staticmethod
+        void SetSink(std_string) except +
+        @staticmethod
+        std_string Sink() except +
+        @staticmethod
+        void FlushLog() except +
+        @staticmethod
         LogLevel ToLogLevel(std_string) except +
         @staticmethod
         std_string ToString(LogLevel) except +
@@ -277,6 +351,9 @@ cdef extern from "pyhooks.h" namespace "cyclus":
    cdef void PyAppendInitTab() except +
    cdef void PyImportInit() except +
    cdef void PyImportCallInit() except +
+   cdef void PyNotifyEventLoop()
+   cdef double EventLoopInterval()
+   cdef void SetEventLoopInterval(double)
 
 
 cdef extern from "pyhooks.h" namespace "cyclus::toolkit":
@@ -337,6 +414,7 @@ cdef extern from "timer.h" namespace "cyclus":
     cdef cppclass Timer:
         Timer() except +
         void RunSim() except +
+        void RunUntil(int) except +
 
 
 cdef extern from "sim_init.h" namespace "cyclus":
@@ -344,6 +422,7 @@ cdef extern from "sim_init.h" namespace "cyclus":
     cdef cppclass SimInit:
         SimInit() except +
         void Init(Recorder*, QueryableBackend*) except +
+        void Fork(Context*, Recorder*) except +
         Timer* timer() except +
         Context* context() except +
 
@@ -371,18 +450,18 @@ cdef extern from "resource.h" namespace "cyclus":
     ctypedef std_string ResourceType
 
     cdef cppclass Resource:
-        ctypedef shared_ptr[Resource] Ptr
+        ctypedef intrusive_ptr[Resource] Ptr
         Resource()
         const int obj_id()
         const int state_id()
         void BumpStateId()
         int qual_id()
         const ResourceType type()
-        shared_ptr[Resource] Clone()
+        intrusive_ptr[Resource] Clone()
         void Record(Context*)
         std_string units()
         double quantity()
-        shared_ptr[Resource] ExtractRes(double)
+        intrusive_ptr[Resource] ExtractRes(double)
 
 
 cdef extern from "composition.h" namespace "cyclus":
@@ -391,16 +470,16 @@ cdef extern from "composition.h" namespace "cyclus":
     ctypedef map[Nuc, double] CompMap
 
     cdef cppclass Composition:
-        ctypedef shared_ptr[Composition] Ptr
+        ctypedef intrusive_ptr[Composition] Ptr
         @staticmethod
-        shared_ptr[Composition] CreateFromAtom(CompMap)
+        intrusive_ptr[Composition] CreateFromAtom(CompMap)
         @staticmethod
-        shared_ptr[Composition] CreateFromMass(CompMap)
+        intrusive_ptr[Composition] CreateFromMass(CompMap)
         int id()
         CompMap& atom()
         CompMap& mass()
-        shared_ptr[Composition] Decay(int)
-        shared_ptr[Composition] Decay(int, uint64_t)
+        intrusive_ptr[Composition] Decay(int)
+        intrusive_ptr[Composition] Decay(int, uint64_t)
         void Record(Context*)
 
 
@@ -409,16 +488,16 @@ cdef extern from "material.h" namespace "cyclus":
     cdef cppclass Agent
 
     cdef cppclass Material(Resource):
-        ctypedef shared_ptr[Material] Ptr
+        ctypedef intrusive_ptr[Material] Ptr
         const ResourceType kType
         @staticmethod
-        shared_ptr[Material] Create(Agent*, double, Composition.Ptr)
+        intrusive_ptr[Material] Create(Agent*, double, Composition.Ptr)
         @staticmethod
-        shared_ptr[Material] CreateUntracked(double, Composition.Ptr)
-        shared_ptr[Material] ExtractQty(double)
-        shared_ptr[Material] ExtractComp(double, Composition.Ptr)
-        shared_ptr[Material] ExtractComp(double, Composition.Ptr, double)
-        void Absorb(shared_ptr[Material])
+        intrusive_ptr[Material] CreateUntracked(double, Composition.Ptr)
+        intrusive_ptr[Material] ExtractQty(double)
+        intrusive_ptr[Material] ExtractComp(double, Composition.Ptr)
+        intrusive_ptr[Material] ExtractComp(double, Composition.Ptr, double)
+        void Absorb(intrusive_ptr[Material])
         void Transmute(Composition.Ptr)
         void Decay(int)
         int prev_decay_time()
@@ -431,15 +510,15 @@ cdef extern from "product.h" namespace "cyclus":
     cdef cppclass Agent
 
     cdef cppclass Product(Resource):
-        ctypedef shared_ptr[Product] Ptr
+        ctypedef intrusive_ptr[Product] Ptr
         const ResourceType kType
         @staticmethod
-        shared_ptr[Product] Create(Agent*, double, std_string)
+        intrusive_ptr[Product] Create(Agent*, double, std_string)
         @staticmethod
-        shared_ptr[Product] CreateUntracked(double, std_string)
+        intrusive_ptr[Product] CreateUntracked(double, std_string)
         const std_string& quality()
-        shared_ptr[Product] Extract(double)
-        void Absorb(shared_ptr[Product])
+        intrusive_ptr[Product] Extract(double)
+        void Absorb(intrusive_ptr[Product])
 
 
 cdef extern from "request.h" namespace "cyclus":
@@ -536,6 +615,7 @@ cdef extern from "capacity_constraint.h" namespace "cyclus":
         double convert(shared_ptr[T], const Arc*)
         double convert(shared_ptr[T], const Arc*,
                        const ExchangeTranslationContext[T]*)
+        bint offer_only()
 
     cdef cppclass TrvialConverter[T](Converter[T]):
         pass
@@ -788,8 +868,10 @@ cdef extern from "context.h" namespace "cyclus":
         uuid sim_id() except +
         int time()
         uint64_t dt()
+        int step()
+        uint64_t step_secs()
         const set[Trader*] traders()
-        shared_ptr[Composition] GetRecipe(std_string)
+        intrusive_ptr[Composition] GetRecipe(std_string)
         void SchedBuild(Agent*, std_string)
         void SchedBuild(Agent*, std_string, int)
         void SchedDecom(Agent*)
@@ -853,7 +935,7 @@ cdef extern from "toolkit/resource_buff.h" namespace "cyclus::toolkit":
         Manifest PopN(int)
         Resource.Ptr Pop(AccessDir)
         shared_ptr[T] Pop[T]()
-        void Push(shared_ptr[Resource])
+        void Push(intrusive_ptr[Resource])
         void PushAll[B](vector[B])
 
 cdef extern from "toolkit/resource_buff.h" namespace "cyclus::toolkit::ResourceBuff":
@@ -882,7 +964,7 @@ cdef extern from "toolkit/res_buf.h" namespace "cyclus::toolkit":
         shared_ptr[T] Peek()
         shared_ptr[T] Pop()
         shared_ptr[T] PopBack()
-        void Push(shared_ptr[Resource])
+        void Push(intrusive_ptr[Resource])
         # cannot overload template and non-template functions in Cython.
         # it is probably bad design on Cyclus's part anyway.
         #void Push[B](vector[B])
@@ -930,6 +1012,8 @@ cdef extern from "toolkit/timeseries.h" namespace "cyclus::toolkit":
     void RecordTimeSeriesPower "cyclus::toolkit::RecordTimeSeries<cyclus::toolkit::POWER>" (Agent*, double)
     void RecordTimeSeriesEnrichSWU "cyclus::toolkit::RecordTimeSeries<cyclus::toolkit::ENRICH_SWU>" (Agent*, double)
     void RecordTimeSeriesEnrichFeed "cyclus::toolkit::RecordTimeSeries<cyclus::toolkit::ENRICH_FEED>" (Agent*, double)
+    void SetPyTimeSeriesListeners(std_string, cpp_bool)
+    void SetPyBatchTimeSeriesListeners(std_string, cpp_bool)
 #
 # Some cutsom pyne wrapping
 #
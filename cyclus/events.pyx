@@ -7,6 +7,7 @@ from functools import wraps
 
 import cyclus.system
 from cyclus.system import asyncio
+from cyclus.lib import notify_event_loop
 
 # A SimState instance representing the current simuation.
 STATE = None
@@ -29,6 +30,9 @@ def loop():
     while 'pause' in STATE.tasks or not STATE.action_queue.empty():
         PyErr_CheckSignals()
         time.sleep(STATE.frequency)
+    # the hook is only called again once there is work for it
+    if STATE.repeating_actions:
+        notify_event_loop()
 
 
 #
@@ -49,11 +53,13 @@ if cyclus.system.PY_VERSION_TUPLE >= (3, 5, 0):
         register_tables=actions.register_tables,
         registry_request=actions.send_registry_action,
         sleep=actions.sleep,
+        stream_tables=actions.stream_tables,
         table_data=actions.send_table_data,
         table_names_request=actions.send_table_names,
         )
     MONITOR_ACTIONS.update(
         shutdown=actions.shutdown,
+        stop_stream=actions.stop_stream,
         unpause=actions.unpause,
         )
     del actions
@@ -158,13 +158,13 @@ class TypeSystem(object):
         return cyt
 
     def possibly_shared_cython_type(self, t):
-        """Returns the Cython type, or if it is a shared pointer type,
-        return the shared pointer version.
+        """Returns the Cython type, or if it is a resource type, which is
+        handled through reference counted pointers, return the pointer version.
         """
         if self._use_shared_ptr[t]:
             cyt = self._shared_ptrs.get(t, None)
             if cyt is None:
-                self._shared_ptrs[t] = 'shared_ptr[' + self.cython_type(t) + ']'
+                self._shared_ptrs[t] = 'intrusive_ptr[' + self.cython_type(t) + ']'
                 cyt = self._shared_ptrs[t]
         else:
             cyt = self.cython_type(t)
@@ -547,14 +547,14 @@ TO_PY_CONVERTERS = {
     'cyclus::Material': (
         'cdef _Material pyx_{var}',
         'pyx_{var} = Material()\n'
-        'pyx_{var}.ptx = cpp_cyclus.reinterpret_pointer_cast[cpp_cyclus.Resource, '
+        'pyx_{var}.ptx = cpp_cyclus.static_pointer_cast[cpp_cyclus.Resource, '
                             'cpp_cyclus.Material]({var})\n'
         'py_{var} = pyx_{var}\n',
         'py_{var}'),
     'cyclus::Product': (
         'cdef _Product pyx_{var}',
         'pyx_{var} = Product()\n'
-        'pyx_{var}.ptx = cpp_cyclus.reinterpret_pointer_cast[cpp_cyclus.Resource, '
+        'pyx_{var}.ptx = cpp_cyclus.static_pointer_cast[cpp_cyclus.Resource, '
                             'cpp_cyclus.Product]({var})\n'
         'py_{var} = pyx_{var}\n',
         'py_{var}'),
@@ -668,16 +668,16 @@ TO_CPP_CONVERTERS = {
     'boost::uuids::uuid': ('', '', 'uuid_py_to_cpp({var})'),
     'cyclus::Material': (
         'cdef _Material py{var}\n'
-        'cdef shared_ptr[cpp_cyclus.Material] cpp{var}\n',
+        'cdef intrusive_ptr[cpp_cyclus.Material] cpp{var}\n',
         'py{var} = <_Material> {var}\n'
-        'cpp{var} = reinterpret_pointer_cast[cpp_cyclus.Material, '
+        'cpp{var} = static_pointer_cast[cpp_cyclus.Material, '
                          'cpp_cyclus.Resource](py{var}.ptx)\n',
         'cpp{var}'),
     'cyclus::Product': (
         'cdef _Material py{var}\n'
-        'cdef shared_ptr[cpp_cyclus.Product] cpp{var}\n',
+        'cdef intrusive_ptr[cpp_cyclus.Product] cpp{var}\n',
         'py{var} = <_Product> {var}\n'
-        'cpp{var} = reinterpret_pointer_cast[cpp_cyclus.Product, '
+        'cpp{var} = static_pointer_cast[cpp_cyclus.Product, '
                          'cpp_cyclus.Resource](py{var}.ptx)\n',
         'cpp{var}'),
     'cyclus::toolkit::ResourceBuff': (
@@ -937,7 +937,7 @@ from cpython.pycapsule cimport PyCapsule_New, PyCapsule_GetPointer
 # local imports
 from cyclus cimport cpp_typesystem
 from cyclus cimport cpp_cyclus
-from cyclus.cpp_cyclus cimport shared_ptr, reinterpret_pointer_cast
+from cyclus.cpp_cyclus cimport shared_ptr, intrusive_ptr, static_pointer_cast
 from cyclus cimport lib
 
 
@@ -1042,7 +1042,7 @@ class Resource(_Resource):
     """
 
 
-cdef shared_ptr[cpp_cyclus.Composition] composition_ptr_from_py(object comp,
+cdef intrusive_ptr[cpp_cyclus.Composition] composition_ptr_from_py(object comp,
                                                                 object basis):
     """Converts a dict-like to a composition."""
     if not isinstance(comp, dict):
@@ -1054,7 +1054,7 @@ cdef shared_ptr[cpp_cyclus.Composition] composition_ptr_from_py(object comp,
         k = nucname.id(key)
         v = val
         c[k] = v
-    cdef shared_ptr[cpp_cyclus.Composition] p
+    cdef intrusive_ptr[cpp_cyclus.Composition] p
     if basis == 'mass':
         p = cpp_cyclus.Composition.CreateFromMass(c)
     elif basis == 'atom':
@@ -1065,7 +1065,7 @@ cdef shared_ptr[cpp_cyclus.Composition] composition_ptr_from_py(object comp,
     return p
 
 
-cdef object composition_from_cpp(shared_ptr[cpp_cyclus.Composition] comp, object basis):
+cdef object composition_from_cpp(intrusive_ptr[cpp_cyclus.Composition] comp, object basis):
     """Converts a composition to a dict."""
     cdef cpp_cyclus.CompMap c
     if basis == 'mass':
@@ -1090,9 +1090,9 @@ cdef class _Material(_Resource):
         "this" pointer). All future output data recorded will be done using the
         creator's context.
         """
-        cdef shared_ptr[cpp_cyclus.Composition] comp = composition_ptr_from_py(c, basis)
+        cdef intrusive_ptr[cpp_cyclus.Composition] comp = composition_ptr_from_py(c, basis)
         cdef _Material mat = Material()
-        mat.ptx = cpp_cyclus.reinterpret_pointer_cast[cpp_cyclus.Resource,
+        mat.ptx = cpp_cyclus.static_pointer_cast[cpp_cyclus.Resource,
                                                       cpp_cyclus.Material](
                     cpp_cyclus.Material.Create(lib.dynamic_agent_ptr(creator),
                                                quantity, comp))
@@ -1104,9 +1104,9 @@ cdef class _Material(_Resource):
         """Creates a new material resource that does not actually exist as part of
         the simulation and is untracked.
         """
-        cdef shared_ptr[cpp_cyclus.Composition] comp = composition_ptr_from_py(c, basis)
+        cdef intrusive_ptr[cpp_cyclus.Composition] comp = composition_ptr_from_py(c, basis)
         cdef _Material mat = Material()
-        mat.ptx = reinterpret_pointer_cast[cpp_cyclus.Resource, cpp_cyclus.Material](
+        mat.ptx = static_pointer_cast[cpp_cyclus.Resource, cpp_cyclus.Material](
                     cpp_cyclus.Material.CreateUntracked(quantity, comp))
         rtn = mat
         return rtn
@@ -1124,30 +1124,30 @@ cdef class _Material(_Resource):
         not a Resource.
         """
         cdef _Material res = Material()
-        res.ptx = reinterpret_pointer_cast[cpp_cyclus.Resource, cpp_cyclus.Material](
-                  reinterpret_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
+        res.ptx = static_pointer_cast[cpp_cyclus.Resource, cpp_cyclus.Material](
+                  static_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
                     self.ptx).get().ExtractQty(quantity))
         respy = res
         return respy
 
     def extract_comp(self, double qty, c, basis='mass', threshold=None):
         """Creates a new material by extracting from this one. """
-        cdef shared_ptr[cpp_cyclus.Composition] comp = composition_ptr_from_py(c, basis)
+        cdef intrusive_ptr[cpp_cyclus.Composition] comp = composition_ptr_from_py(c, basis)
         cdef double t
         t = cpp_cyclus.eps_rsrc() if threshold is None else threshold
         cdef _Material res = Material()
-        res.ptx = reinterpret_pointer_cast[cpp_cyclus.Resource, cpp_cyclus.Material](
-                  reinterpret_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
+        res.ptx = static_pointer_cast[cpp_cyclus.Resource, cpp_cyclus.Material](
+                  static_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
                     self.ptx).get().ExtractComp(qty, comp, t))
         respy = res
         return respy
 
     def absorb(self, _Material mat):
         """Combines material mat with this one.  mat's quantity becomes zero."""
-        cdef shared_ptr[cpp_cyclus.Material] p = \
-            reinterpret_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
+        cdef intrusive_ptr[cpp_cyclus.Material] p = \
+            static_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
                 mat.ptx)
-        reinterpret_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
+        static_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
             self.ptx).get().Absorb(p)
 
     def transmute(self, c, basis='mass'):
@@ -1155,8 +1155,8 @@ cdef class _Material(_Resource):
         this method for things like converting fresh to spent fuel via burning in
         a reactor.
         """
-        cdef shared_ptr[cpp_cyclus.Composition] comp = composition_ptr_from_py(c, basis)
-        reinterpret_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
+        cdef intrusive_ptr[cpp_cyclus.Composition] comp = composition_ptr_from_py(c, basis)
+        static_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
             self.ptx).get().Transmute(comp)
 
     def decay(self, int curr_time):
@@ -1169,7 +1169,7 @@ cdef class _Material(_Resource):
         simulation decay mode is set to "never" or none of the nuclides' decay
         constants are significant with respect to the time delta.
         """
-        reinterpret_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
+        static_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
             self.ptx).get().Decay(curr_time)
 
     @property
@@ -1178,18 +1178,18 @@ cdef class _Material(_Resource):
         for the material.  This is not necessarily synonymous with the last time
         step the material's Decay function was called.
         """
-        return reinterpret_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
+        return static_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
             self.ptx).get().prev_decay_time()
 
     def decay_heat(self):
         """Returns a double with the decay heat of the material in units of W/kg."""
-        return reinterpret_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
+        return static_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
             self.ptx).get().DecayHeat()
 
     def comp(self, basis='mass'):
         """Returns the nuclide composition of this material."""
         rtn = composition_from_cpp(
-                reinterpret_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
+                static_pointer_cast[cpp_cyclus.Material, cpp_cyclus.Resource](
                     self.ptx).get().comp(), basis)
         return rtn
 
@@ -1212,7 +1212,7 @@ cdef class _Product(_Resource):
         creator's context.
         """
         cdef _Product prod = Product()
-        prod.ptx = reinterpret_pointer_cast[cpp_cyclus.Resource, cpp_cyclus.Product](
+        prod.ptx = static_pointer_cast[cpp_cyclus.Resource, cpp_cyclus.Product](
                     cpp_cyclus.Product.Create(lib.dynamic_agent_ptr(creator),
                                               quantity, str_py_to_cpp(quality)))
         rtn = prod
@@ -1224,7 +1224,7 @@ cdef class _Product(_Resource):
         the simulation and is untracked.
         """
         cdef _Product prod = Product()
-        prod.ptx = reinterpret_pointer_cast[cpp_cyclus.Resource, cpp_cyclus.Product](
+        prod.ptx = static_pointer_cast[cpp_cyclus.Resource, cpp_cyclus.Product](
                     cpp_cyclus.Product.CreateUntracked(quantity,
                                                        str_py_to_cpp(quality)))
         rtn = prod
@@ -1243,17 +1243,17 @@ cdef class _Product(_Resource):
         new product object with the same quality/type.
         """
         cdef _Product res = Product()
-        res.ptx = reinterpret_pointer_cast[cpp_cyclus.Product, cpp_cyclus.Resource](
+        res.ptx = static_pointer_cast[cpp_cyclus.Product, cpp_cyclus.Resource](
                     self.ptx).get().ExtractRes(qty)
         respy = res
         return respy
 
     def absorb(self, _Product other):
         """Absorbs the contents of the given 'other' resource into this resource."""
-        cdef shared_ptr[cpp_cyclus.Product] p = \
-            reinterpret_pointer_cast[cpp_cyclus.Product, cpp_cyclus.Resource](
+        cdef intrusive_ptr[cpp_cyclus.Product] p = \
+            static_pointer_cast[cpp_cyclus.Product, cpp_cyclus.Resource](
                 other.ptx)
-        reinterpret_pointer_cast[cpp_cyclus.Product, cpp_cyclus.Resource](
+        static_pointer_cast[cpp_cyclus.Product, cpp_cyclus.Resource](
             self.ptx).get().Absorb(p)
 
 
@@ -1360,12 +1360,12 @@ cdef class _{{tclassname}}:
 
     def push_all(self, rs):
         """Pushes one or more resource objects to the store."""
-        cdef std_vector[shared_ptr[cpp_cyclus.Resource]] v
+        cdef std_vector[intrusive_ptr[cpp_cyclus.Resource]] v
         cdef _Resource cpp_r
         for r in rs:
             cpp_r = <_Resource> r
             v.push_back(cpp_r.ptx)
-        self.ptx.PushAll[shared_ptr[cpp_cyclus.Resource]](v)
+        self.ptx.PushAll[intrusive_ptr[cpp_cyclus.Resource]](v)
 
     def pop_all_res(self):
         """A consistent interface for popping all of the resources from the buffer.
@@ -1421,13 +1421,13 @@ cdef class _{{tclassname}}:
         """
         cdef _{{rcname}} r = {{rcname}}()
         if qty < 0.0:
-            r.ptx = reinterpret_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
+            r.ptx = static_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
                         self.ptx.Pop())
         elif eps < 0.0:
-            r.ptx = reinterpret_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
+            r.ptx = static_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
                         self.ptx.Pop(qty))
         else:
-            r.ptx = reinterpret_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
+            r.ptx = static_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
                         self.ptx.Pop(qty, eps))
         rtn = r
         return rtn
@@ -1436,10 +1436,10 @@ cdef class _{{tclassname}}:
         """Pops the specified number of {{rcname}}s from the buffer."""
         cdef _{{rcname}} x
         cdef list v = []
-        cdef std_vector[shared_ptr[{{ts.cython_type(r)}}]] rs = self.ptx.PopN(n)
+        cdef std_vector[intrusive_ptr[{{ts.cython_type(r)}}]] rs = self.ptx.PopN(n)
         for r in rs:
             x = {{rcname}}()
-            x.ptx = reinterpret_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
+            x.ptx = static_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
                     r)
             v.append(x)
         rtn = v
@@ -1462,7 +1462,7 @@ cdef class _{{tclassname}}:
         without actually removing it from the buffer.
         """
         cdef _{{rcname}} r = {{rcname}}()
-        r.ptx = reinterpret_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
+        r.ptx = static_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
                     self.ptx.Peek())
         rtn = r
         return rtn
@@ -1470,7 +1470,7 @@ cdef class _{{tclassname}}:
     def pop_back(self):
         """Same as Pop, except it returns the most recently added resource."""
         cdef _{{rcname}} r = {{rcname}}()
-        r.ptx = reinterpret_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
+        r.ptx = static_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
                     self.ptx.PopBack())
         rtn = r
         return rtn
@@ -1512,24 +1512,24 @@ cdef class _{{tclassname}}:
         for kr in deref(self.ptx):
             ktn = {{ ts.funcname(k) }}_to_py(kr.first)
             r = {{rcname}}()
-            r.ptx = reinterpret_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
+            r.ptx = static_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
                         kr.second)
             rtn = r
             yield (ktn, rtn)
 
     def __getitem__(self, key):
         cdef {{ ts.cython_type(k) }} k = {{ ts.funcname(k) }}_to_cpp(key)
-        cdef shared_ptr[{{rcytype}}] p = deref(self.ptx)[k]
+        cdef intrusive_ptr[{{rcytype}}] p = deref(self.ptx)[k]
         cdef _{{rcname}} r = {{rcname}}()
-        r.ptx = reinterpret_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
+        r.ptx = static_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
                     p)
         rtn = r
         return rtn
 
     def __setitem__(self, key, _{{rcname}} value):
         cdef {{ ts.cython_type(k) }} k = {{ ts.funcname(k) }}_to_cpp(key)
-        cdef shared_ptr[{{rcytype}}] p = \
-            reinterpret_pointer_cast[{{ts.cython_type(r)}}, cpp_cyclus.Resource](
+        cdef intrusive_ptr[{{rcytype}}] p = \
+            static_pointer_cast[{{ts.cython_type(r)}}, cpp_cyclus.Resource](
                 (value.ptx))
         deref(self.ptx)[k] = p
 
@@ -1545,11 +1545,11 @@ cdef class _{{tclassname}}:
         """Returns a vector of the values in the map"""
         cdef _{{rcname}} x
         cdef list v = []
-        cdef std_vector[shared_ptr[{{ts.cython_type(r)}}]] rs = self.ptx.Values()
+        cdef std_vector[intrusive_ptr[{{ts.cython_type(r)}}]] rs = self.ptx.Values()
         for r in rs:
             x = {{rcname}}()
             x.ptx = \
-                reinterpret_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
+                static_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
                     r)
             v.append(x)
         rtn = v
@@ -1561,7 +1561,7 @@ cdef class _{{tclassname}}:
         """
         cdef _Resource x
         cdef list v = []
-        cdef std_vector[shared_ptr[cpp_cyclus.Resource]] rs = self.ptx.ResValues()
+        cdef std_vector[intrusive_ptr[cpp_cyclus.Resource]] rs = self.ptx.ResValues()
         for r in rs:
             x = Resource()
             x.ptx = r
@@ -1574,7 +1574,7 @@ cdef class _{{tclassname}}:
         cdef {{ ts.cython_type(k) }} k = {{ ts.funcname(k) }}_to_cpp(key)
         cdef _{{rcname}} r = {{rcname}}()
         r.ptx = \
-            reinterpret_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
+            static_pointer_cast[cpp_cyclus.Resource, {{ts.cython_type(r)}}](
                 self.ptx.Pop(k))
         rtn = r
         return rtn
@@ -1589,8 +1589,8 @@ cdef class _{{tclassname}}:
         """A consistent interface for pushing many resources into the buffer.
         For ResMap, this calls ResValues(vals).
         """
-        cdef std_vector[shared_ptr[cpp_cyclus.Resource]] cpp_rs = \
-            std_vector[shared_ptr[cpp_cyclus.Resource]]()
+        cdef std_vector[intrusive_ptr[cpp_cyclus.Resource]] cpp_rs = \
+            std_vector[intrusive_ptr[cpp_cyclus.Resource]]()
         for r in rs:
             cpp_rs.push_back((<_Resource> r).ptx)
         self.ptx.ResValues(cpp_rs)
@@ -1954,11 +1954,18 @@ cdef class StateVar:
         return obj.__dict__[self.name].value
 
     def __set__(self, obj, val):
+        val = self.coerce(val)
         if obj is None:
             self.value = val
         else:
             obj.__dict__[self.name].value = val
 
+    cpdef object coerce(self, object val):
+        """Converts a value to the representation this state variable keeps,
+        which is the value itself unless a subclass says otherwise.
+        """
+        return val
+
     cpdef dict to_dict(self):
         """Returns a representation of this state variable as a dict."""
         return {'value': self.value,
@@ -2026,6 +2033,17 @@ cdef class {{tclassname}}(StateVar):
             {{pyname}}=self.{{pyname}},
             {%- endif -%}{%- endfor -%}
             )
+{% if t in array_dtypes %}
+
+    cpdef object coerce(self, object val):
+        """Keeps the value as a contiguous {{array_dtypes[t]}} array, which
+        is handed to C++ with a single copy rather than element by element.
+        Arrays of that dtype are kept as they are, without copying.
+        """
+        if val is None:
+            return val
+        return np.ascontiguousarray(val, dtype={{array_dtypes[t]}})
+{% endif %}
 
 {% endif %}{% endfor %}
 
@@ -2188,7 +2206,7 @@ cdef class _{{rclsname}}Request:
         if self._target is not None:
             return self._target
         cdef _{{rclsname}} r = {{rclsname}}()
-        r.ptx = cpp_cyclus.reinterpret_pointer_cast[cpp_cyclus.Resource,
+        r.ptx = cpp_cyclus.static_pointer_cast[cpp_cyclus.Resource,
                                                     {{cyr}}](self.ptx.target())
         self._target = r
         return self._target
@@ -2267,13 +2285,13 @@ cdef shared_ptr[cpp_cyclus.RequestPortfolio[{{cyr}}]] {{ ts.funcname(r) }}_reque
             )
     cdef std_string commod
     cdef _{{rclsname}} targ
-    cdef shared_ptr[{{cyr}}] targ_ptr
+    cdef intrusive_ptr[{{cyr}}] targ_ptr
     # add requests
     for name, reqs in pyport['commodities'].items():
         commod = str_py_to_cpp(name)
         for req in reqs:
             targ = <_{{rclsname}}> req['target']
-            targ_ptr = reinterpret_pointer_cast[{{ts.cython_type(r)}},
+            targ_ptr = static_pointer_cast[{{ts.cython_type(r)}},
                                                 cpp_cyclus.Resource](targ.ptx)
             if req['cost'] is not None:
                 raise ValueError('setting cost functions from Python is not yet '
@@ -2293,11 +2311,11 @@ cdef shared_ptr[cpp_cyclus.BidPortfolio[{{cyr}}]] {{ ts.funcname(r) }}_bid_portf
             new cpp_cyclus.BidPortfolio[{{cyr}}]()
             )
     #cdef _{{rclsname}}
-    cdef shared_ptr[{{cyr}}] offer_ptr
+    cdef intrusive_ptr[{{cyr}}] offer_ptr
     # add requests
     for bid in pyport['bids']:
         #targ = <_{{rclsname}}> req['target']
-        offer_ptr = reinterpret_pointer_cast[{{ts.cython_type(r)}},
+        offer_ptr = static_pointer_cast[{{ts.cython_type(r)}},
                                              cpp_cyclus.Resource](
                         (<_{{rclsname}}> bid['offer']).ptx)
         port.get().AddBid((<_{{rclsname}}Request> bid['request']).ptx,
@@ -2335,7 +2353,7 @@ cdef class _{{rclsname}}Bid:
         if self._offer is not None:
             return self._offer
         cdef _{{rclsname}} r = {{rclsname}}()
-        r.ptx = cpp_cyclus.reinterpret_pointer_cast[cpp_cyclus.Resource,
+        r.ptx = cpp_cyclus.static_pointer_cast[cpp_cyclus.Resource,
                                                     {{cyr}}](
                     self.ptx.offer())
         self._offer = r
@@ -2397,6 +2415,169 @@ cdef dict {{rfname}}_pref_map_to_py(cpp_cyclus.PrefMap[{{cyr}}].type& pm):
     return rtn
 
 
+cdef PrefView {{rfname}}_pref_map_to_view(cpp_cyclus.PrefMap[{{cyr}}].type& pm):
+    """Makes a vectorized view of a {{rfname}} prefmap. The view refers to
+    the preferences in pm, which must outlive it.
+    """
+    cdef std_map[cpp_cyclus.Request[{{cyr}}]*, std_map[cpp_cyclus.Bid[{{cyr}}]*, double]].iterator rit
+    cdef std_map[cpp_cyclus.Bid[{{cyr}}]*, double].iterator bit
+    cdef PrefView v = PrefView()
+    cdef np.int64_t[::1] req
+    cdef np.int64_t j = 0
+    cdef size_t n = 0
+    rit = pm.begin()
+    while rit != pm.end():
+        n += deref(rit).second.size()
+        inc(rit)
+    v._kind = '{{rfname}}'
+    v.request = np.empty(n, dtype=np.int64)
+    v.pref = np.empty(n, dtype=np.float64)
+    v._orig = np.empty(n, dtype=np.float64)
+    v._ptrs.reserve(n)
+    v._bid_ptrs.reserve(n)
+    v._req_ptrs.reserve(pm.size())
+    req = v.request
+    rit = pm.begin()
+    while rit != pm.end():
+        v._req_ptrs.push_back(<void*> deref(rit).first)
+        bit = deref(rit).second.begin()
+        while bit != deref(rit).second.end():
+            req[v._ptrs.size()] = j
+            v._bid_ptrs.push_back(<void*> deref(bit).first)
+            v._ptrs.push_back(&deref(bit).second)
+            inc(bit)
+        j += 1
+        inc(rit)
+    v.refresh()
+    return v
+
+
+cdef RequestView {{rfname}}_commod_map_to_view(cpp_cyclus.CommodMap[{{cyr}}].type& m):
+    """Makes a vectorized view of the requests of a {{rfname}} exchange. The
+    view refers to the requests in m, which must outlive it.
+    """
+    cdef std_map[std_string, std_vector[cpp_cyclus.Request[{{cyr}}]*]].iterator it
+    cdef cpp_cyclus.Request[{{cyr}}]* req
+    cdef RequestView v = RequestView()
+    cdef np.int64_t[:] rid
+    cdef np.int32_t[:] commod
+    cdef double[:] qty
+    cdef double[:] pref
+    cdef np.uint8_t[:] excl
+    cdef size_t i = 0
+    cdef size_t j
+    cdef size_t n = 0
+    cdef np.int32_t c = 0
+    it = m.begin()
+    while it != m.end():
+        n += deref(it).second.size()
+        inc(it)
+    v._kind = '{{rfname}}'
+    v.commodities = []
+    v.data = np.empty(n, dtype=request_dtype)
+    rid = v.data['request']
+    commod = v.data['commodity']
+    qty = v.data['qty']
+    pref = v.data['pref']
+    excl = v.data['exclusive'].view(np.uint8)
+    v._req_ptrs.reserve(n)
+    it = m.begin()
+    while it != m.end():
+        v.commodities.append(std_string_to_py(deref(it).first))
+        for j in range(deref(it).second.size()):
+            req = deref(it).second[j]
+            v._req_ptrs.push_back(<void*> req)
+            rid[i] = i
+            commod[i] = c
+            qty[i] = req.target().get().quantity()
+            pref[i] = req.preference()
+            excl[i] = req.exclusive()
+            i += 1
+        c += 1
+        inc(it)
+    return v
+
+
+cdef shared_ptr[cpp_cyclus.BidPortfolio[{{cyr}}]] {{rfname}}_bid_arrays_to_cpp(object bids, RequestView view, cpp_cyclus.Trader* bidder):
+    """Converts bids on the requests of view, given as arrays, to a
+    portfolio. See RequestView for the form of bids.
+    """
+    cdef shared_ptr[cpp_cyclus.BidPortfolio[{{cyr}}]] port = \
+        shared_ptr[cpp_cyclus.BidPortfolio[{{cyr}}]](
+            new cpp_cyclus.BidPortfolio[{{cyr}}]()
+            )
+    cdef std_vector[intrusive_ptr[{{cyr}}]] offers
+    cdef intrusive_ptr[{{cyr}}] like
+    cdef intrusive_ptr[{{cyr}}] offer_ptr
+    cdef cpp_cyclus.Request[{{cyr}}]* req
+    cdef np.int64_t[:] r
+    cdef double[:] q
+    cdef double[:] p
+    cdef np.uint8_t[:] ex
+    cdef np.int64_t[:] o
+    cdef np.int64_t nreqs = view._req_ptrs.size()
+    cdef Py_ssize_t i, n
+    if isinstance(bids, np.ndarray):
+        names = bids.dtype.names or ()
+        extras = {}
+    else:
+        names = bids
+        extras = bids
+    r = np.asarray(bids['request'], dtype=np.int64)
+    q = np.asarray(bids['qty'], dtype=np.float64)
+    n = r.shape[0]
+    if q.shape[0] != n:
+        raise ValueError('bids need as many quantities as requests')
+    if 'pref' in names:
+        p = np.asarray(bids['pref'], dtype=np.float64)
+    else:
+        p = np.full(n, np.nan)
+    if 'exclusive' in names:
+        ex = np.asarray(bids['exclusive'], dtype=np.bool_).view(np.uint8)
+    else:
+        ex = np.zeros(n, dtype=np.uint8)
+    if 'offer' in names:
+        o = np.asarray(bids['offer'], dtype=np.int64)
+    else:
+        o = np.full(n, -1, dtype=np.int64)
+    if p.shape[0] != n or ex.shape[0] != n or o.shape[0] != n:
+        raise ValueError('every field of the bids must have one value per bid')
+    for x in extras.get('offers', ()):
+        offers.push_back(static_pointer_cast[{{cyr}}, cpp_cyclus.Resource](
+            (<_{{rclsname}}> x).ptx))
+    # add bids, offering the request's target, or the given offer, with the
+    # quantity bid, and sharing it when the quantity matches
+    for i in range(n):
+        if r[i] < 0 or r[i] >= nreqs:
+            raise IndexError('bid {0} is on request {1}, but there are {2} '
+                             'requests'.format(i, r[i], nreqs))
+        req = <cpp_cyclus.Request[{{cyr}}]*> view._req_ptrs[r[i]]
+        if o[i] < 0:
+            like = req.target()
+        elif <size_t> o[i] < offers.size():
+            like = offers[o[i]]
+        else:
+            raise IndexError('bid {0} has offer {1}, but there are {2} '
+                             'offers'.format(i, o[i], offers.size()))
+        if like.get().quantity() == q[i]:
+            offer_ptr = like
+        else:
+            {%- if r == 'MATERIAL' %}
+            offer_ptr = {{cyr}}.CreateUntracked(q[i], like.get().comp())
+            {%- else %}
+            offer_ptr = {{cyr}}.CreateUntracked(q[i], like.get().quality())
+            {%- endif %}
+        port.get().AddBid(req, offer_ptr, bidder, ex[i] != 0, p[i])
+    # add constraints
+    constraints = extras.get('constraints', ())
+    if isinstance(constraints, (int, float)):
+        constraints = (constraints,)
+    for constr in constraints:
+        port.get().AddConstraint(
+            cpp_cyclus.CapacityConstraint[{{cyr}}](constr))
+    return port
+
+
 cdef class _{{rclsname}}Trade:
 
     def __cinit__(self):
@@ -2458,7 +2639,7 @@ cdef tuple {{rfname}}_trade_vector_to_py(const std_vector[cpp_cyclus.Trade[{{cyr
     return rtn
 
 
-cdef dict {{rfname}}_responses_to_py(const std_vector[std_pair[cpp_cyclus.Trade[{{cyr}}], shared_ptr[{{cyr}}]]]& responses):
+cdef dict {{rfname}}_responses_to_py(const std_vector[std_pair[cpp_cyclus.Trade[{{cyr}}], intrusive_ptr[{{cyr}}]]]& responses):
     """Converts a vector of pairs of (trades, {{rfname}}) to a dict"""
     cdef dict rtn = {}
     cdef int i, n
@@ -2467,7 +2648,7 @@ cdef dict {{rfname}}_responses_to_py(const std_vector[std_pair[cpp_cyclus.Trade[
         t = {{rclsname}}Trade()
         (<_{{rclsname}}Trade> t).ptx = const_cast[{{rfname}}_trade_ptr](&(responses[i].first))
         r = {{rclsname}}()
-        (<_{{rclsname}}> r).ptx = reinterpret_pointer_cast[cpp_cyclus.Resource,
+        (<_{{rclsname}}> r).ptx = static_pointer_cast[cpp_cyclus.Resource,
                                                            {{cyr}}](responses[i].second)
         rtn[t] = r
     return rtn
@@ -2475,6 +2656,150 @@ cdef dict {{rfname}}_responses_to_py(const std_vector[std_pair[cpp_cyclus.Trade[
 {% endfor %}
 
 
+cdef class PrefView:
+    """A vectorized view of the preferences of the arcs of a resource
+    exchange, which agents whose vectorized_prefs attribute is True are
+    passed by adjust_material_prefs() and adjust_product_prefs() in place of
+    a dict.
+
+    Arc i goes from the request requests[request[i]] to the bid bids[i], and
+    has the preference pref[i]. pref may be changed in place; the changed
+    preferences are applied to the exchange when the adjustment returns. The
+    request and bid objects are only made when they are first asked for.
+    """
+
+    def __cinit__(self):
+        self._requests = None
+        self._bids = None
+
+    def __len__(self):
+        return self._ptrs.size()
+
+    @property
+    def requests(self):
+        """The distinct requests of the exchange, in the order the request
+        array indexes them.
+        """
+        cdef size_t i
+        if self._requests is not None:
+            return self._requests
+        reqs = []
+        {%- for r in ts.resources %}
+        {% if not loop.first %}el{% endif %}if self._kind == '{{ ts.funcname(r) }}':
+            for i in range(self._req_ptrs.size()):
+                x = {{ ts.classname(r) }}Request()
+                (<_{{ ts.classname(r) }}Request> x).ptx = \
+                    <cpp_cyclus.Request[{{ ts.cython_type(r) }}]*> self._req_ptrs[i]
+                reqs.append(x)
+        {%- endfor %}
+        self._requests = reqs
+        return reqs
+
+    @property
+    def bids(self):
+        """The bid of each arc."""
+        cdef size_t i
+        if self._bids is not None:
+            return self._bids
+        bids = []
+        {%- for r in ts.resources %}
+        {% if not loop.first %}el{% endif %}if self._kind == '{{ ts.funcname(r) }}':
+            for i in range(self._bid_ptrs.size()):
+                x = {{ ts.classname(r) }}Bid()
+                (<_{{ ts.classname(r) }}Bid> x).ptx = \
+                    <cpp_cyclus.Bid[{{ ts.cython_type(r) }}]*> self._bid_ptrs[i]
+                bids.append(x)
+        {%- endfor %}
+        self._bids = bids
+        return bids
+
+    cdef void refresh(self):
+        """Reads the preferences of the exchange into pref."""
+        cdef double[::1] p = self.pref
+        cdef double[::1] o = self._orig
+        cdef size_t i
+        for i in range(self._ptrs.size()):
+            p[i] = self._ptrs[i][0]
+            o[i] = p[i]
+
+    cdef int apply(self) except -1:
+        """Writes the preferences changed in pref to the exchange, returning
+        the number changed.
+        """
+        cdef double[::1] p = self.pref
+        cdef double[::1] o = self._orig
+        cdef size_t i
+        cdef int n = 0
+        if p.shape[0] != self._ptrs.size():
+            raise ValueError("the preferences of a view may only be changed "
+                             "in place")
+        for i in range(self._ptrs.size()):
+            if p[i] != o[i]:
+                self._ptrs[i][0] = p[i]
+                o[i] = p[i]
+                n += 1
+        return n
+
+
+request_dtype = np.dtype([('request', np.int64), ('commodity', np.int32),
+                           ('qty', np.float64), ('pref', np.float64),
+                           ('exclusive', np.bool_)])
+
+
+cdef class RequestView:
+    """A vectorized view of the requests of a resource exchange, which
+    agents whose vectorized_exchange attribute is True are passed by
+    get_material_bids() and get_product_bids() in place of a dict.
+
+    Row i of the structured array data describes request i: its index,
+    'request', the index of its commodity in commodities, 'commodity', the
+    quantity of its target, 'qty', its preference, 'pref', and whether it is
+    exclusive, 'exclusive'. The request and target objects are only made when
+    they are first asked for.
+
+    Bids on the requests are returned the same way, as a structured array or
+    a dict of arrays, with the fields 'request', the index of the request
+    bid on, and 'qty', the quantity offered, and optionally 'pref', the
+    bid's preference (NaN for none), 'exclusive', and 'offer'. Each bid
+    offers its request's target with the quantity bid, or if its 'offer' is
+    not negative, the resource that it indexes in the sequence that a dict
+    of bids maps 'offers' to, again with the quantity bid. Offers whose
+    quantity matches are shared rather than copied. A dict of bids may also
+    map 'constraints' to the capacity constraints of the portfolio.
+    """
+
+    def __cinit__(self):
+        self._requests = None
+
+    def __len__(self):
+        return self._req_ptrs.size()
+
+    @property
+    def requests(self):
+        """The requests of the exchange, in the order data describes them."""
+        if self._requests is None:
+            self._requests = [self._request(i)
+                              for i in range(self._req_ptrs.size())]
+        return self._requests
+
+    def target(self, i):
+        """Returns the target of request i, without making the others."""
+        if self._requests is not None:
+            return self._requests[i].target
+        return self._request(i).target
+
+    cdef object _request(self, Py_ssize_t i):
+        if i < 0 or <size_t> i >= self._req_ptrs.size():
+            raise IndexError('request index out of range')
+        {%- for r in ts.resources %}
+        {% if not loop.first %}el{% endif %}if self._kind == '{{ ts.funcname(r) }}':
+            x = {{ ts.classname(r) }}Request()
+            (<_{{ ts.classname(r) }}Request> x).ptx = \
+                <cpp_cyclus.Request[{{ ts.cython_type(r) }}]*> self._req_ptrs[i]
+        {%- endfor %}
+        return x
+
+
 cpdef tuple request_types = ({% for r in ts.resources %}{{ ts.classname(r) }}Request, {% endfor %})
 cpdef tuple bid_types = ({% for r in ts.resources %}{{ ts.classname(r) }}Bid, {% endfor %})
 cpdef tuple trade_types = ({% for r in ts.resources %}{{ ts.classname(r) }}Trade, {% endfor %})
@@ -2506,6 +2831,25 @@ def prepare_type_representation(cpptype, othertype):
 '''.lstrip())
 
 
+ARRAY_DTYPES = {
+    'int': 'np.intc',
+    'float': 'np.float32',
+    'double': 'np.float64',
+    }
+
+def array_dtypes(ts):
+    """Returns a dict mapping the unique types that are vectors of numbers to
+    the NumPy dtypes that their state variables keep values as.
+    """
+    dtypes = {}
+    for t in ts.uniquetypes:
+        n = ts.norms[t]
+        if not isinstance(n, unicode_types) and n[0] == 'std::vector' and \
+                n[1] in ARRAY_DTYPES:
+            dtypes[t] = ARRAY_DTYPES[n[1]]
+    return dtypes
+
+
 def typesystem_pyx(ts, ns):
     """Creates the Cython wrapper for the Cyclus type system."""
     nonuser_annotations = ('type', 'uniquetypeid')
@@ -2528,6 +2872,7 @@ def typesystem_pyx(ts, ns):
                                 key=lambda x: (x[0][0], x[1])),
         groupby=itertools.groupby,
         firstfirst=lambda x: x[0][0],
+        array_dtypes=array_dtypes(ts),
         )
     rtn = TYPESYSTEM_PYX.render(ctx)
     return rtn
@@ -2540,17 +2885,17 @@ TYPESYSTEM_PXD = JENV.from_string('''
 # local imports
 from cyclus cimport cpp_typesystem
 from cyclus cimport cpp_cyclus
-from cyclus.cpp_cyclus cimport shared_ptr, reinterpret_pointer_cast
+from cyclus.cpp_cyclus cimport shared_ptr, intrusive_ptr, static_pointer_cast
 
 #
 # Resources & Inventories
 #
 
 cdef class _Resource:
-    cdef shared_ptr[cpp_cyclus.Resource] ptx
+    cdef intrusive_ptr[cpp_cyclus.Resource] ptx
 
-cdef shared_ptr[cpp_cyclus.Composition] composition_ptr_from_py(object, object)
-cdef object composition_from_cpp(shared_ptr[cpp_cyclus.Composition] comp, object basis)
+cdef intrusive_ptr[cpp_cyclus.Composition] composition_ptr_from_py(object, object)
+cdef object composition_from_cpp(intrusive_ptr[cpp_cyclus.Composition] comp, object basis)
 
 cdef class _Material(_Resource):
     pass
@@ -2632,6 +2977,7 @@ cdef class StateVar:
     {% for pyname, cppname, typename, _ in annotations %}
     cdef public {{typename}} {{pyname}} {% if pyname != cppname %}"{{cppname}}"{% endif %}
     {%- endfor %}
+    cpdef object coerce(self, object val)
     cpdef dict to_dict(self)
     cpdef StateVar copy(self)
 
@@ -2641,6 +2987,7 @@ cdef class StateVar:
 {% if t in ts.resources %}{% set tclassname = tclassname + 'StateVar'%}{% endif %}
 cdef class {{tclassname}}(StateVar):
     cpdef {{tclassname}} copy(self)
+    {% if t in array_dtypes %}cpdef object coerce(self, object val){% endif %}
 {% endif %}{% endfor %}
 
 
@@ -2662,6 +3009,27 @@ cdef class {{tclassname}}Inv(Inventory):
 #
 # Requests & Bids
 #
+cdef class PrefView:
+    cdef std_vector[double*] _ptrs
+    cdef std_vector[void*] _req_ptrs
+    cdef std_vector[void*] _bid_ptrs
+    cdef object _kind
+    cdef object _requests
+    cdef object _bids
+    cdef object _orig
+    cdef readonly object request
+    cdef readonly object pref
+    cdef void refresh(self)
+    cdef int apply(self) except -1
+
+cdef class RequestView:
+    cdef std_vector[void*] _req_ptrs
+    cdef object _kind
+    cdef object _requests
+    cdef readonly object commodities
+    cdef readonly object data
+    cdef object _request(self, Py_ssize_t i)
+
 {% for r in ts.resources %}
 {% set cyr = ts.cython_type(r) %}
 {% set rclsname = ts.classname(r) %}
@@ -2688,6 +3056,9 @@ cdef class _{{rclsname}}Bid:
     cdef object _exclusive
 
 cdef dict {{rfname}}_pref_map_to_py(cpp_cyclus.PrefMap[{{cyr}}].type& pm)
+cdef PrefView {{rfname}}_pref_map_to_view(cpp_cyclus.PrefMap[{{cyr}}].type& pm)
+cdef RequestView {{rfname}}_commod_map_to_view(cpp_cyclus.CommodMap[{{cyr}}].type& m)
+cdef shared_ptr[cpp_cyclus.BidPortfolio[{{cyr}}]] {{rfname}}_bid_arrays_to_cpp(object bids, RequestView view, cpp_cyclus.Trader* bidder)
 
 ctypedef cpp_cyclus.Trade[{{cyr}}]* {{rfname}}_trade_ptr
 
@@ -2698,7 +3069,7 @@ cdef class _{{rclsname}}Trade:
 
 
 cdef tuple {{rfname}}_trade_vector_to_py(const std_vector[cpp_cyclus.Trade[{{cyr}}]]& trades)
-cdef dict {{rfname}}_responses_to_py(const std_vector[std_pair[cpp_cyclus.Trade[{{cyr}}], shared_ptr[{{cyr}}]]]& responses)
+cdef dict {{rfname}}_responses_to_py(const std_vector[std_pair[cpp_cyclus.Trade[{{cyr}}], intrusive_ptr[{{cyr}}]]]& responses)
 
 {% endfor %}
 
@@ -2719,6 +3090,7 @@ def typesystem_pxd(ts, ns):
         sorted=sorted,
         enumerate=enumerate,
         annotations=ANNOTATIONS,
+        array_dtypes=array_dtypes(ts),
         )
     rtn = TYPESYSTEM_PXD.render(ctx)
     return rtn
@@ -28,11 +28,17 @@ cdef class _Datum:
     cdef list _fieldnames
 
 cdef object query_result_to_py(cpp_cyclus.QueryResult)
+cdef object query_result_to_columns(cpp_cyclus.QueryResult& qr)
 cdef object single_query_result_to_py(cpp_cyclus.QueryResult qr, int row)
 
 cdef class _FullBackend:
     cdef void * ptx
 
+cdef class _QueryCursor:
+    cdef cpp_cyclus.shared_ptr[cpp_cyclus.QueryCursor] ptx
+    # keeps the backend alive for as long as the cursor
+    cdef object backend
+
 cdef class _SqliteBack(_FullBackend):
     pass
 
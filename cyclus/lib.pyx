@@ -35,7 +35,7 @@ from cyclus cimport jsoncpp
 from cyclus import jsoncpp
 
 from cyclus cimport cpp_cyclus
-from cyclus.cpp_cyclus cimport shared_ptr
+from cyclus.cpp_cyclus cimport shared_ptr, intrusive_ptr
 from cyclus cimport cpp_typesystem
 from cyclus cimport typesystem as ts
 from cyclus import typesystem as ts
@@ -168,6 +168,56 @@ cdef object query_result_to_py(cpp_cyclus.QueryResult qr):
     return rtn
 
 
+cdef object query_result_to_columns(cpp_cyclus.QueryResult& qr):
+    """Converts a query result object to a dictionary mapping fields to
+    columns and a list of field names in order. Columns of fixed width types
+    are filled into typed NumPy arrays without making a Python object for
+    each value, and string columns are decoded straight from the results;
+    other columns are lists of converted values.
+    """
+    cdef int i, j
+    cdef int nrows = qr.rows.size()
+    cdef int ncols = qr.fields.size()
+    cdef cpp_cyclus.DbTypes t
+    cdef int[::1] ivals
+    cdef float[::1] fvals
+    cdef double[::1] dvals
+    cdef np.uint8_t[::1] bvals
+    cdef dict res = {}
+    cdef list fields = []
+    for j in range(ncols):
+        f = qr.fields[j].decode()
+        fields.append(f)
+        t = qr.types[j]
+        if t == cpp_typesystem.INT:
+            col = np.empty(nrows, dtype=np.intc)
+            ivals = col
+            for i in range(nrows):
+                ivals[i] = qr.rows[i][j].cast[int]()
+        elif t == cpp_typesystem.DOUBLE:
+            col = np.empty(nrows, dtype=np.float64)
+            dvals = col
+            for i in range(nrows):
+                dvals[i] = qr.rows[i][j].cast[double]()
+        elif t == cpp_typesystem.FLOAT:
+            col = np.empty(nrows, dtype=np.float32)
+            fvals = col
+            for i in range(nrows):
+                fvals[i] = qr.rows[i][j].cast[float]()
+        elif t == cpp_typesystem.BOOL:
+            col = np.empty(nrows, dtype=np.bool_)
+            bvals = col.view(np.uint8)
+            for i in range(nrows):
+                bvals[i] = qr.rows[i][j].cast[cpp_bool]()
+        elif t == cpp_typesystem.STRING or t == cpp_typesystem.VL_STRING:
+            col = [qr.rows[i][j].cast[std_string]().decode()
+                   for i in range(nrows)]
+        else:
+            col = [db_to_py(qr.rows[i][j], t) for i in range(nrows)]
+        res[f] = col
+    return res, fields
+
+
 cdef object single_query_result_to_py(cpp_cyclus.QueryResult qr, int row):
     """Converts a query result object with only one row to a dictionary mapping
     fields to values and a list of field names in order.
@@ -188,6 +238,30 @@ cdef object single_query_result_to_py(cpp_cyclus.QueryResult qr, int row):
     return rtn
 
 
+cdef int _query_args(cpp_cyclus.FullBackend* back, std_string tab, object conds,
+                     object fields, std_vector[cpp_cyclus.Cond]* cpp_conds,
+                     std_vector[std_string]* cpp_fields) except -1:
+    """Converts the conditions and fields of a query to C++. Conditions on
+    columns that the table does not have are skipped.
+    """
+    cdef std_string field
+    cdef std_map[std_string, cpp_cyclus.DbTypes] coltypes
+    if conds is not None:
+        coltypes = back.ColumnTypes(tab)
+        for cond in conds:
+            cond0 = cond[0].encode()
+            cond1 = cond[1].encode()
+            field = std_string(<const char*> cond0)
+            if coltypes.count(field) == 0:
+                continue  # skips non-existent columns
+            cpp_conds.push_back(cpp_cyclus.Cond(field, cond1,
+                py_to_any(cond[2], coltypes[field])))
+    if fields is not None:
+        for f in fields:
+            cpp_fields.push_back(str_py_to_cpp(f))
+    return 0
+
+
 cdef class _FullBackend:
 
     def __cinit__(self):
@@ -203,7 +277,7 @@ cdef class _FullBackend:
         del cpp_ptx
         self.ptx = NULL
 
-    def query(self, table, conds=None):
+    def query(self, table, conds=None, fields=None):
         """Queries a database table.
 
         Parameters
@@ -212,6 +286,9 @@ cdef class _FullBackend:
             The table name.
         conds : iterable, optional
             A list of conditions.
+        fields : iterable, optional
+            The names of the columns to return, in order. All columns are
+            returned if this is None.
 
         Returns
         -------
@@ -219,34 +296,143 @@ cdef class _FullBackend:
             Pandas DataFrame the represents the table
         """
         cdef std_string tab = str(table).encode()
-        cdef std_string field
         cdef cpp_cyclus.QueryResult qr
         cdef std_vector[cpp_cyclus.Cond] cpp_conds
-        cdef std_vector[cpp_cyclus.Cond]* conds_ptx
-        cdef std_map[std_string, cpp_cyclus.DbTypes] coltypes
-        # set up the conditions
-        if conds is None:
-            conds_ptx = NULL
-        else:
-            coltypes = (<cpp_cyclus.FullBackend*> self.ptx).ColumnTypes(tab)
-            for cond in conds:
-                cond0 = cond[0].encode()
-                cond1 = cond[1].encode()
-                field = std_string(<const char*> cond0)
-                if coltypes.count(field) == 0:
-                    continue  # skips non-existent columns
-                cpp_conds.push_back(cpp_cyclus.Cond(field, cond1,
-                    py_to_any(cond[2], coltypes[field])))
-            if cpp_conds.size() == 0:
-                conds_ptx = NULL
-            else:
-                conds_ptx = &cpp_conds
+        cdef std_vector[cpp_cyclus.Cond]* conds_ptx = NULL
+        cdef std_vector[std_string] cpp_fields
+        cdef std_vector[std_string]* fields_ptx = NULL
+        _query_args(<cpp_cyclus.FullBackend*> self.ptx, tab, conds, fields,
+                    &cpp_conds, &cpp_fields)
+        if cpp_conds.size() > 0:
+            conds_ptx = &cpp_conds
+        if fields is not None:
+            fields_ptx = &cpp_fields
         # query, convert, and return
-        qr = (<cpp_cyclus.FullBackend*> self.ptx).Query(tab, conds_ptx)
-        res, fields = query_result_to_py(qr)
+        qr = (<cpp_cyclus.FullBackend*> self.ptx).Query(tab, conds_ptx,
+                                                        fields_ptx)
+        res, fields = query_result_to_columns(qr)
         results = pd.DataFrame(res, columns=fields)
         return results
 
+    def cursor(self, table, conds=None, fields=None):
+        """Opens a cursor that reads the rows of a query in batches, rather
+        than all at once. This takes the same arguments as query().
+
+        Returns
+        -------
+        cursor : QueryCursor
+            A cursor over the matching rows.
+        """
+        cdef std_string tab = str(table).encode()
+        cdef std_vector[cpp_cyclus.Cond] cpp_conds
+        cdef std_vector[cpp_cyclus.Cond]* conds_ptx = NULL
+        cdef std_vector[std_string] cpp_fields
+        cdef std_vector[std_string]* fields_ptx = NULL
+        _query_args(<cpp_cyclus.FullBackend*> self.ptx, tab, conds, fields,
+                    &cpp_conds, &cpp_fields)
+        if cpp_conds.size() > 0:
+            conds_ptx = &cpp_conds
+        if fields is not None:
+            fields_ptx = &cpp_fields
+        cur = QueryCursor()
+        (<_QueryCursor> cur).ptx = (<cpp_cyclus.FullBackend*> self.ptx).Cursor(
+            tab, conds_ptx, fields_ptx)
+        (<_QueryCursor> cur).backend = self
+        return cur
+
+    def aggregate(self, table, aggs, conds=None, group_by=None):
+        """Aggregates the rows of a database table without reading them all
+        into Python.
+
+        Parameters
+        ----------
+        table : str
+            The table name.
+        aggs : iterable
+            The aggregates, each either "count" or an (op, field) pair, where
+            op is one of "count", "sum", "min", and "max".
+        conds : iterable, optional
+            A list of conditions.
+        group_by : iterable, optional
+            The names of the columns to group the rows by. All the matching
+            rows form a single group if this is None.
+
+        Returns
+        -------
+        results : pd.DataFrame
+            The group_by columns followed by one column per aggregate, named
+            e.g. "sum(Quantity)" or "count", with one row per group.
+        """
+        cdef std_string tab = str(table).encode()
+        cdef cpp_cyclus.QueryResult qr
+        cdef std_vector[cpp_cyclus.Cond] cpp_conds
+        cdef std_vector[cpp_cyclus.Cond]* conds_ptx = NULL
+        cdef std_vector[std_string] cpp_group_by
+        cdef std_vector[std_string]* group_by_ptx = NULL
+        cdef std_vector[cpp_cyclus.Agg] cpp_aggs
+        _query_args(<cpp_cyclus.FullBackend*> self.ptx, tab, conds, group_by,
+                    &cpp_conds, &cpp_group_by)
+        if cpp_conds.size() > 0:
+            conds_ptx = &cpp_conds
+        if group_by is not None:
+            group_by_ptx = &cpp_group_by
+        for agg in aggs:
+            if isinstance(agg, str):
+                agg = (agg, "")
+            cpp_aggs.push_back(cpp_cyclus.Agg(str_py_to_cpp(agg[0]),
+                                              str_py_to_cpp(agg[1])))
+        qr = (<cpp_cyclus.FullBackend*> self.ptx).Aggregate(tab, conds_ptx,
+                                                            group_by_ptx,
+                                                            cpp_aggs)
+        res, fields = query_result_to_columns(qr)
+        return pd.DataFrame(res, columns=fields)
+
+    def ancestors(self, resource_id, max_depth=-1, conds=None):
+        """Finds the resources a resource was made from, those they were made
+        from, and so on, reading only the pages of the lineage index that
+        hold them if the database has one.
+
+        Parameters
+        ----------
+        resource_id : int
+            The id of the resource.
+        max_depth : int, optional
+            The most generations to go back, or -1 for all of them.
+        conds : iterable, optional
+            A list of conditions on the Resources table, e.g., on SimId.
+
+        Returns
+        -------
+        resources : pd.DataFrame
+            The ResourceId and Depth, in generations, of each resource
+            reached, nearest first.
+        transactions : list of int
+            The ids of the transactions of the resource and of those reached.
+        """
+        return self._lineage(resource_id, max_depth, conds, True)
+
+    def descendants(self, resource_id, max_depth=-1, conds=None):
+        """Finds the resources made from a resource, those made from them, and
+        so on. This takes the same arguments and returns the same results as
+        ancestors().
+        """
+        return self._lineage(resource_id, max_depth, conds, False)
+
+    def _lineage(self, int resource_id, int max_depth, conds, bint up):
+        cdef std_vector[cpp_cyclus.Cond] cpp_conds
+        cdef std_vector[std_string] cpp_fields
+        cdef cpp_cyclus.Lineage l
+        cdef cpp_cyclus.FullBackend* back = <cpp_cyclus.FullBackend*> self.ptx
+        _query_args(back, b"Resources", conds, None, &cpp_conds, &cpp_fields)
+        if up:
+            l = back.Ancestors(resource_id, max_depth, &cpp_conds)
+        else:
+            l = back.Descendants(resource_id, max_depth, &cpp_conds)
+        resources = pd.DataFrame({"ResourceId": list(l.resources),
+                                  "Depth": list(l.depths)},
+                                 columns=["ResourceId", "Depth"])
+        return resources, list(l.transactions)
+
     def schema(self, table):
         cdef std_string ctable = str_py_to_cpp(table)
         cdef std_list[cpp_cyclus.ColumnInfo] cis = (<cpp_cyclus.QueryableBackend*> self.ptx).Schema(ctable)
@@ -278,6 +464,39 @@ cdef class _FullBackend:
         self._tables = value
 
 
+cdef class _QueryCursor:
+
+    def next(self, int n=10000):
+        """Reads the next batch of rows.
+
+        Parameters
+        ----------
+        n : int, optional
+            The largest number of rows to return.
+
+        Returns
+        -------
+        results : pd.DataFrame
+            The next rows of the query, which is empty once every row has been
+            read.
+        """
+        cdef cpp_cyclus.QueryResult qr = deref(self.ptx).Next(n)
+        res, fields = query_result_to_columns(qr)
+        return pd.DataFrame(res, columns=fields)
+
+    def batches(self, int n=10000):
+        """Iterates over the remaining rows, n at a time, as DataFrames."""
+        while True:
+            df = self.next(n)
+            if len(df) == 0:
+                return
+            yield df
+
+
+class QueryCursor(_QueryCursor, object):
+    """A cursor over the rows of a database query."""
+
+
 class FullBackend(_FullBackend, object):
     """Full backend cyclus database interface."""
 
@@ -290,10 +509,12 @@ class FullBackend(_FullBackend, object):
 
 cdef class _SqliteBack(_FullBackend):
 
-    def __cinit__(self, path):
-        """Full backend C++ constructor"""
+    def __cinit__(self, path, readonly=False):
+        """Full backend C++ constructor. A read-only backend opens an existing
+        database for queries only, which any number of threads may run at once.
+        """
         cdef std_string cpp_path = str(path).encode()
-        self.ptx = new cpp_cyclus.SqliteBack(cpp_path)
+        self.ptx = new cpp_cyclus.SqliteBack(cpp_path, bool(readonly))
 
     def __dealloc__(self):
         """Full backend C++ destructor."""
@@ -320,6 +541,22 @@ cdef class _SqliteBack(_FullBackend):
         name = name.decode()
         return name
 
+    @property
+    def readonly(self):
+        """Whether the backend only queries its database."""
+        return (<cpp_cyclus.SqliteBack*> self.ptx).readonly()
+
+    @property
+    def index_lineage(self):
+        """Whether the lineage of the resources written is indexed when the
+        backend is closed, for fast ancestors() and descendants() queries.
+        """
+        return (<cpp_cyclus.SqliteBack*> self.ptx).index_lineage()
+
+    @index_lineage.setter
+    def index_lineage(self, value):
+        (<cpp_cyclus.SqliteBack*> self.ptx).index_lineage(bool(value))
+
 
 class SqliteBack(_SqliteBack, FullBackend):
     """SQLite backend cyclus database interface."""
@@ -356,11 +593,104 @@ cdef class _Hdf5Back(_FullBackend):
         name = name.decode()
         return name
 
+    @property
+    def index_lineage(self):
+        """Whether the lineage of the resources written is indexed when the
+        backend is closed, for fast ancestors() and descendants() queries.
+        """
+        return (<cpp_cyclus.Hdf5Back*> self.ptx).index_lineage()
+
+    @index_lineage.setter
+    def index_lineage(self, value):
+        (<cpp_cyclus.Hdf5Back*> self.ptx).set_index_lineage(bool(value))
+
 
 class Hdf5Back(_Hdf5Back, FullBackend):
     """HDF5 backend cyclus database interface."""
 
 
+def merge_hdf5_shards(path, shards):
+    """Writes an HDF5 database at path that reads as one database holding
+    the rows of all the given closed HDF5 databases, e.g., those written by
+    the workers of an ensemble, in order. The tables of the merged database
+    are virtual datasets reading those of the shards, which must stay where
+    they are for it to be read.
+    """
+    cdef std_vector[std_string] cpp_shards
+    for shard in shards:
+        cpp_shards.push_back(str_py_to_cpp(shard))
+    cpp_cyclus.Hdf5Back.MergeShards(str_py_to_cpp(path), cpp_shards)
+
+
+# the array and value columns of the tables of dense output, which mirror
+# CompositionsWriter and InventoryWriter
+_DENSE_TABLES = {
+    'DenseCompositions': ('MassFracs', 'MassFrac'),
+    'DenseInventory': ('Masses', 'Quantity'),
+    }
+
+
+def read_dense(db, table, conds=None, wide=False):
+    """Reads a table of dense output, DenseCompositions or DenseInventory,
+    whose rows hold the values of all their nuclides in an array, unpacking
+    the arrays with numpy rather than row by row. Querying the classic
+    Compositions or ExplicitInventory table of such a database rebuilds the
+    same long format rows in C++.
+
+    Parameters
+    ----------
+    db : FullBackend
+        The database.
+    table : str
+        The dense table.
+    conds : iterable, optional
+        A list of conditions on the columns of the dense table.
+    wide : bool, optional
+        Whether to return one column per nuclide rather than one row.
+
+    Returns
+    -------
+    results : pd.DataFrame
+        In long format, the SimId and key columns of the dense table, then
+        NucId and the value (MassFrac or Quantity) of each nuclide with a
+        non-zero value. In wide format, the SimId and key columns followed
+        by a column of values per NucId, which is zero for nuclides a row
+        does not hold.
+    """
+    data, value = _DENSE_TABLES[table]
+    rows = db.query(table, conds)
+    simconds = [c for c in (conds or ()) if c[0] == 'SimId']
+    index = db.query('NuclideIndex', simconds or None)
+    keys = [f for f in rows.columns if f != data]
+    frames = []
+    for simid, group in rows.groupby('SimId', sort=False):
+        nucs = index[index.SimId == simid]
+        nucids = np.zeros(nucs.NucIndex.max() + 1 if len(nucs) > 0 else 0,
+                          dtype=int)
+        nucids[nucs.NucIndex.values] = nucs.NucId.values
+        matrix = np.zeros((len(group), len(nucids)))
+        for i, vals in enumerate(group[data]):
+            matrix[i, :len(vals)] = vals
+        values = pd.DataFrame(matrix, columns=pd.Index(nucids, name='NucId'))
+        group = group[keys].reset_index(drop=True)
+        if wide:
+            frames.append(pd.concat([group, values], axis=1))
+            continue
+        stacked = values.stack()
+        stacked = stacked[stacked != 0]
+        rownums = stacked.index.get_level_values(0)
+        frame = group.iloc[rownums].reset_index(drop=True)
+        frame['NucId'] = stacked.index.get_level_values(1).values
+        frame[value] = stacked.values
+        frames.append(frame)
+    if len(frames) == 0:
+        return pd.DataFrame(columns=keys if wide else keys + ['NucId', value])
+    results = pd.concat(frames, ignore_index=True)
+    if wide:
+        results = results.fillna(0)
+    return results
+
+
 cdef class _Recorder:
 
     def __cinit__(self, bint inject_sim_id=True):
@@ -400,6 +730,41 @@ cdef class _Recorder:
     def inject_sim_id(self, value):
         (<cpp_cyclus.Recorder*> self.ptx).inject_sim_id(<bint> value)
 
+    @property
+    def collect_stats(self):
+        """Whether output counters are kept per table. They are recorded to
+        the RecorderStats table on close."""
+        return (<cpp_cyclus.Recorder*> self.ptx).collect_stats()
+
+    @collect_stats.setter
+    def collect_stats(self, value):
+        (<cpp_cyclus.Recorder*> self.ptx).set_collect_stats(<bint> value)
+
+    def stats(self):
+        """Returns the output counters of the tables recorded, as a dict of
+        table names to dicts with 'rows', 'bytes', and 'notify_time' keys. The
+        notify time is a dict of seconds by backend name.
+        """
+        cdef std_map[std_string, cpp_cyclus.TableStats] cpp_stats = \
+            (<cpp_cyclus.Recorder*> self.ptx).stats()
+        cdef std_map[std_string, cpp_cyclus.TableStats].iterator it = \
+            cpp_stats.begin()
+        cdef std_map[std_string, double].iterator b
+        stats = {}
+        while it != cpp_stats.end():
+            secs = {}
+            b = deref(it).second.notify_secs.begin()
+            while b != deref(it).second.notify_secs.end():
+                secs[std_string_to_py(deref(b).first)] = deref(b).second
+                inc(b)
+            stats[std_string_to_py(deref(it).first)] = {
+                'rows': deref(it).second.rows,
+                'bytes': deref(it).second.bytes,
+                'notify_time': secs,
+                }
+            inc(it)
+        return stats
+
     def new_datum(self, title):
         """Returns a new datum instance."""
         cdef std_string cpp_title = str_py_to_cpp(title)
@@ -737,6 +1102,23 @@ cdef class _Logger:
     def no_mem(self, bint nm):
         cpp_cyclus.Logger.SetNoMem(nm)
 
+    @property
+    def sink(self):
+        """Where log lines are written asynchronously: 'stdout', 'stderr', or
+        the path of a file. An empty string writes each line to stdout
+        synchronously, which is the default.
+        """
+        return std_string_to_py(cpp_cyclus.Logger.Sink())
+
+    @sink.setter
+    def sink(self, value):
+        cpp_cyclus.Logger.SetSink(str_py_to_cpp(value or ""))
+
+    @staticmethod
+    def flush():
+        """Waits until every line logged so far has been written."""
+        cpp_cyclus.Logger.FlushLog()
+
     @staticmethod
     def to_log_level(text):
         """Converts a string into a corresponding LogLevel value.
@@ -823,6 +1205,29 @@ def py_import_call_init():
     """
     cpp_cyclus.PyImportCallInit()
 
+
+def notify_event_loop():
+    """Marks that the event loop hook has work to do, so that it is called
+    at the next time step (see set_event_loop_interval). Queuing an action
+    on a SimState's action queue calls this.
+    """
+    cpp_cyclus.PyNotifyEventLoop()
+
+
+def get_event_loop_interval():
+    """Returns the least number of wall-clock seconds between calls of the
+    event loop hook.
+    """
+    return cpp_cyclus.EventLoopInterval()
+
+
+def set_event_loop_interval(double secs):
+    """Sets the least number of wall-clock seconds between calls of the
+    event loop hook, which otherwise runs at every time step that it has
+    work to do at. Actions queued meanwhile wait for the interval to pass.
+    """
+    cpp_cyclus.SetEventLoopInterval(secs)
+
 #
 # XML
 #
@@ -1196,6 +1601,13 @@ cdef class _Timer:
         """Runs the simulation."""
         self.ptx.RunSim()
 
+    def run_until(self, end):
+        """Runs the timesteps before end and leaves the simulation between
+        timesteps, where it can be forked. Calling run_sim() afterwards
+        finishes the simulation.
+        """
+        self.ptx.RunUntil(end)
+
 
 class Timer(_Timer):
     """Controls simulation timestepping and inter-timestep phases.
@@ -1209,12 +1621,18 @@ class Timer(_Timer):
 
 cdef class _SimInit:
 
-    def __cinit__(self, recorder, backend):
+    def __cinit__(self, recorder, backend=None, fork=None):
         self.ptx = new cpp_cyclus.SimInit()
-        self.ptx.Init(
-            <cpp_cyclus.Recorder *> (<_Recorder> recorder).ptx,
-            <cpp_cyclus.QueryableBackend *> (<_FullBackend> backend).ptx,
-            )
+        if fork is not None:
+            self.ptx.Fork(
+                (<_Context> fork).ptx,
+                <cpp_cyclus.Recorder *> (<_Recorder> recorder).ptx,
+                )
+        else:
+            self.ptx.Init(
+                <cpp_cyclus.Recorder *> (<_Recorder> recorder).ptx,
+                <cpp_cyclus.QueryableBackend *> (<_FullBackend> backend).ptx,
+                )
         self._timer = None
         self._context = None
 
@@ -1251,8 +1669,12 @@ class SimInit(_SimInit):
     ----------
     recorder : Recorder
         The recorder class for the simulation.
-    backend : QueryableBackend
+    backend : QueryableBackend, optional
         A backend to use for this simulation.
+    fork : Context, optional
+        A simulation, between timesteps, to copy in memory instead of
+        initializing from the backend. The copy records to recorder under its
+        simulation id.
     """
 
 #
@@ -1309,10 +1731,10 @@ cdef cpp_cyclus.Inventories inventories_to_cpp(object pyinvs):
     """Converts a dict of lists of resources to inventories."""
     cdef cpp_cyclus.Inventories invs = cpp_cyclus.Inventories()
     cdef std_string name
-    cdef std_vector[shared_ptr[cpp_cyclus.Resource]] value
+    cdef std_vector[intrusive_ptr[cpp_cyclus.Resource]] value
     for pyname, pyvalue in pyinvs.items():
         name = str_py_to_cpp(pyname)
-        value = std_vector[shared_ptr[cpp_cyclus.Resource]]()
+        value = std_vector[intrusive_ptr[cpp_cyclus.Resource]]()
         for r in pyvalue:
             value.push_back((<ts._Resource> r).ptx)
     return invs
@@ -1637,6 +2059,16 @@ cdef class _Context:
         """The length of timer per time step, in seconds."""
         return self.ptx.dt()
 
+    @property
+    def step(self):
+        """The length of the current step of the timer, in time steps."""
+        return self.ptx.step()
+
+    @property
+    def step_secs(self):
+        """The length of the current step of the timer, in seconds."""
+        return self.ptx.step_secs()
+
     def get_recipe(self, name, basis='mass'):
         """Retrieve a registered recipe. This is intended for retrieving
         compositions loaded from an input file(s) at the start of a
@@ -1961,16 +2393,95 @@ def record_time_series(object tstype, object agent, object value):
             cpp_cyclus.RecordTimeSeriesEnrichFeed(a_ptr, value)
 
 
-TIME_SERIES_LISTENERS = defaultdict(list)
+class _TimeSeriesListenerList(list):
+    """The Python listeners of a time series. Tells cyclus whether there are
+    any when they change, so that series without listeners don't call into
+    Python.
+    """
+
+    def __init__(self, tsname, *args):
+        super(_TimeSeriesListenerList, self).__init__(*args)
+        self.tsname = tsname
+        self._changed()
+
+    def _changed(self):
+        cpp_cyclus.SetPyTimeSeriesListeners(ts.std_string_to_cpp(self.tsname),
+                                            len(self) > 0)
+
+
+class _BatchTimeSeriesListenerList(_TimeSeriesListenerList):
+    """The batched Python listeners of a time series."""
+
+    def _changed(self):
+        cpp_cyclus.SetPyBatchTimeSeriesListeners(
+            ts.std_string_to_cpp(self.tsname), len(self) > 0)
+
+
+def _listener_list_method(name):
+    meth = getattr(list, name)
+    def wrapper(self, *args):
+        rtn = meth(self, *args)
+        self._changed()
+        return rtn
+    wrapper.__name__ = name
+    return wrapper
+
+for _name in ('append', 'extend', 'insert', 'pop', 'remove', 'clear',
+              '__setitem__', '__delitem__', '__iadd__', '__imul__'):
+    setattr(_TimeSeriesListenerList, _name, _listener_list_method(_name))
+del _name
+
+
+class _TimeSeriesListenerDict(dict):
+    """Python time series listener lists by series name."""
+
+    _list_type = _TimeSeriesListenerList
+
+    def __missing__(self, tsname):
+        lst = self[tsname] = self._list_type(tsname)
+        return lst
+
+    def __setitem__(self, tsname, fns):
+        if not isinstance(fns, self._list_type):
+            fns = self._list_type(tsname, fns)
+        super(_TimeSeriesListenerDict, self).__setitem__(tsname, fns)
+
+    def __delitem__(self, tsname):
+        lst = dict.__getitem__(self, tsname)
+        super(_TimeSeriesListenerDict, self).__delitem__(tsname)
+        del lst[:]
+
+
+class _BatchTimeSeriesListenerDict(_TimeSeriesListenerDict):
+    """Batched Python time series listener lists by series name."""
+
+    _list_type = _BatchTimeSeriesListenerList
+
+
+TIME_SERIES_LISTENERS = _TimeSeriesListenerDict()
+
+# Listeners called once per time step with every numeric value recorded to a
+# series during the step, as f(agent_ids, time, values, tsname), where
+# agent_ids and values are NumPy arrays. This is much cheaper than a call per
+# value for series that many agents record to.
+TIME_SERIES_BATCH_LISTENERS = _BatchTimeSeriesListenerDict()
 
 def call_listeners(tsname, agent, time, value):
     """Calls the time series listener functions of cyclus agents.
     """
-    vec = TIME_SERIES_LISTENERS[tsname]
+    vec = TIME_SERIES_LISTENERS.get(tsname, ())
     for f in vec:
         f(agent, time, value, tsname)
 
 
+def call_batch_listeners(tsname, time, agent_ids, values):
+    """Calls the batched time series listener functions of cyclus agents.
+    """
+    vec = TIME_SERIES_BATCH_LISTENERS.get(tsname, ())
+    for f in vec:
+        f(agent_ids, time, values, tsname)
+
+
 EXT_BACKENDS = {'.h5': Hdf5Back, '.sqlite': SqliteBack}
 
 def dbopen(fname):
@@ -180,6 +180,13 @@ class Verbosity(Action):
         logger.report_level = ns.verbosity
 
 
+class LogSink(Action):
+    """Sets where log lines are written asynchronously"""
+
+    def __call__(self, parser, ns, values, option_string=None):
+        Logger().sink = values
+
+
 class WarnLimit(Action):
     """Sets warning limit"""
 
@@ -343,6 +350,10 @@ def make_parser():
                    help='exclude memory log statement from logger output')
     p.add_argument('-v', '--verb', action=Verbosity, dest='verbosity',
                    help='log verbosity. integer from 0 (quiet) to 11 (verbose)')
+    p.add_argument('--log-sink', action=LogSink,
+                   help='write log lines on a background thread to stdout, '
+                        'stderr, or the file at this path, without flushing '
+                        'each line')
     p.add_argument('-o', '--output-path', dest='output_path',
                    default='cyclus.sqlite', help='output path')
     p.add_argument('--input-file', dest='input_file', default=None,
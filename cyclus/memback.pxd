@@ -19,12 +19,25 @@ cdef cppclass CyclusMemBack "CyclusMemBack" (cpp_cyclus.RecBackend):
     void Flush() except +
     void Close() except +
     # Extra interface
-    dict Init() except +
-    PyObject* cache
+    object Init() except +
+    cpp_cyclus.ColumnStore* store
     cpp_bool store_all_tables
     std_set[std_string] registry
 
 
+cdef class _ColumnBuffer:
+    cdef cpp_cyclus.shared_ptr[std_vector[char]] buf
+    cdef Py_ssize_t shape[1]
+    cdef Py_ssize_t strides[1]
+    cdef bytes fmt
+
+
+cdef class _TableCache:
+    cdef cpp_cyclus.ColumnStore* store
+    cdef dict frames
+    cdef dict frame_rows
+
+
 cdef class _MemBack(lib._FullBackend):
     pass  # pointer declared on full backend
     #cpdef dict cache
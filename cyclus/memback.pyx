@@ -7,11 +7,12 @@ from libcpp.utility cimport pair as std_pair
 from libcpp.string cimport string as std_string
 from libcpp cimport bool as cpp_bool
 
-from cpython cimport (PyObject, PyDict_New, PyDict_Contains,
-    PyDict_GetItemString, PyDict_SetItemString, PyString_FromString,
-    PyBytes_FromString, PyDict_GetItem, PyDict_SetItem)
+from cpython cimport PyObject
+from cpython.buffer cimport PyBUF_FORMAT, PyBUF_WRITABLE
+from cython.operator cimport dereference as deref
 
 from cyclus cimport cpp_cyclus
+from cyclus cimport cpp_typesystem
 from cyclus cimport lib
 from cyclus import lib
 
@@ -20,7 +21,7 @@ from cyclus.typesystem cimport (py_to_any, any_to_py, str_py_to_cpp,
     std_set_std_string_to_cpp)
 
 from collections import deque
-from collections.abc import Set
+from collections.abc import MutableMapping, Set
 from ast import (Name, Compare, Load, Eq, NotEq, Lt, LtE, Gt, GtE,
     BinOp, BitAnd, Expression)
 
@@ -33,75 +34,174 @@ np.import_array()
 np.import_ufunc()
 
 
+cdef class _ColumnBuffer:
+    """Exposes the typed buffer of a column store column through the buffer
+    protocol, so that NumPy arrays can view it without copying. The buffer is
+    read-only and is not changed when more rows are recorded.
+    """
+
+    def __getbuffer__(self, Py_buffer* view, int flags):
+        cdef std_vector[char]* v = self.buf.get()
+        if flags & PyBUF_WRITABLE:
+            raise BufferError("column buffers are read-only")
+        view.buf = <void*> &deref(v)[0]
+        view.obj = self
+        view.len = v.size()
+        view.readonly = 1
+        view.itemsize = self.strides[0]
+        view.format = self.fmt if flags & PyBUF_FORMAT else NULL
+        view.ndim = 1
+        view.shape = self.shape
+        view.strides = self.strides
+        view.suboffsets = NULL
+        view.internal = NULL
+
+    def __releasebuffer__(self, Py_buffer* view):
+        pass
+
+
+cdef object column_to_py(cpp_cyclus.StoreColumn* col):
+    """Converts a column store column to a NumPy array that shares its buffer,
+    or to a list if the column is boxed.
+    """
+    cdef _ColumnBuffer buf
+    cdef cpp_cyclus.hold_any val
+    if col.boxed():
+        return [any_to_py(val) for val in col.values()]
+    if col.type() == cpp_typesystem.BOOL:
+        fmt = b'?'
+    elif col.type() == cpp_typesystem.INT:
+        fmt = b'q'
+    else:
+        fmt = b'd'
+    if col.size() == 0:
+        return np.empty(0, dtype=fmt.decode())
+    buf = _ColumnBuffer()
+    buf.buf = col.buffer()
+    buf.shape[0] = col.size()
+    buf.strides[0] = col.itemsize()
+    buf.fmt = fmt
+    return np.asarray(buf)
+
+
+cdef class _TableCache:
+    """The tables of a memory backend, by name. Tables recorded by a
+    simulation are held in a C++ column store and only converted to
+    DataFrames when they are looked up; other DataFrames, e.g. from a
+    fallback backend, may be stored here directly.
+    """
+
+    def __cinit__(self):
+        self.store = new cpp_cyclus.ColumnStore()
+        self.frames = {}
+        self.frame_rows = {}
+
+    def __dealloc__(self):
+        del self.store
+
+    def columns(self, table):
+        """Returns the columns of a recorded table as a dict mapping names to
+        values, in order. Numeric and boolean columns are NumPy arrays that
+        share memory with the store rather than copies.
+        """
+        cdef std_string ctable = str_py_to_cpp(table)
+        cdef std_vector[cpp_cyclus.StoreColumn]* tbl = self.store.table(ctable)
+        cdef size_t i
+        if tbl == NULL:
+            raise KeyError(table)
+        cols = {}
+        for i in range(tbl.size()):
+            name = std_string_to_py(deref(tbl)[i].name())
+            cols[name] = column_to_py(&deref(tbl)[i])
+        return cols
+
+    def __getitem__(self, table):
+        cdef std_string ctable = str_py_to_cpp(table)
+        cdef size_t nrows
+        if self.store.table(ctable) == NULL:
+            return self.frames[table]
+        nrows = self.store.nrows(ctable)
+        if self.frame_rows.get(table, None) != nrows:
+            cols = self.columns(table)
+            self.frames[table] = pd.DataFrame(cols, columns=list(cols.keys()))
+            self.frame_rows[table] = nrows
+        return self.frames[table]
+
+    def __setitem__(self, table, value):
+        self.store.Drop(str_py_to_cpp(table))
+        self.frame_rows.pop(table, None)
+        self.frames[table] = value
+
+    def __delitem__(self, table):
+        cdef std_string ctable = str_py_to_cpp(table)
+        if self.store.table(ctable) == NULL and table not in self.frames:
+            raise KeyError(table)
+        self.store.Drop(ctable)
+        self.frame_rows.pop(table, None)
+        self.frames.pop(table, None)
+
+    def __contains__(self, table):
+        return table in self.frames or \
+            self.store.table(str_py_to_cpp(table)) != NULL
+
+    def keys(self):
+        keys = set(self.frames.keys())
+        keys.update(std_set_std_string_to_py(self.store.Tables()))
+        return keys
+
+    def __iter__(self):
+        return iter(self.keys())
+
+    def __len__(self):
+        return len(self.keys())
+
+    def get(self, table, default=None):
+        return self[table] if table in self else default
+
+    def items(self):
+        return [(k, self[k]) for k in self.keys()]
+
+    def values(self):
+        return [self[k] for k in self.keys()]
+
+    def clear(self):
+        self.store.Clear()
+        self.frames.clear()
+        self.frame_rows.clear()
+
+
+MutableMapping.register(_TableCache)
+
+
 cdef cppclass CyclusMemBack "CyclusMemBack" (cpp_cyclus.RecBackend):
     # A C++ class that acts as a rec backend, but stores its data in
     # memory in a Python friendly format.
 
-    dict Init():
+    object Init():
         """Initilaizer that returns cache, so that we can keep an extra
         reference to it around.
         """
         this.store_all_tables = 1  # set to true, by default
-        c = {}
-        this.cache = <PyObject*> c
+        c = _TableCache()
+        this.store = (<_TableCache> c).store
         return c
 
     void Notify(cpp_cyclus.DatumList data):
-        """Stores the data in a cache."""
-        cdef std_map[std_string, cpp_cyclus.DatumList] groups
-        cdef std_pair[std_string, cpp_cyclus.DatumList] group
+        """Appends the data of the stored tables to the column store."""
+        cdef cpp_cyclus.DatumList kept
         cdef cpp_cyclus.Datum* d
-        cdef std_pair[const char*, cpp_cyclus.hold_any] val
-        cdef std_string name, cpp_field
-        cdef dict g, res
-        cdef PyObject* pyobval
-        cdef object results, pyval
-        cdef int key_exists, i
-        cdef list fields
-        # check if there is anything to do
-        if not this.store_all_tables and this.registry.size() == 0:
+        if this.store == NULL or data.size() == 0:
             return
-        if data.size() == 0:
-            return
-        # combine into like groups
         if this.store_all_tables:
-            for d in data:
-                name = d.title()
-                groups[name].push_back(d)
-        else:
-            for d in data:
-                name = d.title()
-                if this.registry.count(name) == 0:
-                    continue
-                groups[name].push_back(d)
-            if groups.size() == 0:
-                # no tables seen that are in the registry
-                return
-        # convert groups
-        for group in groups:
-            # init group
-            res = {}
-            fields = []
-            d = group.second.front()
-            for cpp_field in d.fields():
-                field = std_string_to_py(cpp_field)
-                fields.append(field)
-                res[field] = []
-            # fill group
-            name = group.first
-            for d in group.second:
-                i = 0
-                for val in d.vals():
-                    res[fields[i]].append(any_to_py(val.second))
-                    i += 1
-            results = pd.DataFrame(res, columns=fields[:])
-            pyname = std_string_to_py(name)
-            key_exists = PyDict_Contains(<object> this.cache, pyname)
-            if key_exists:
-                pyobval = PyDict_GetItem(<object> this.cache, pyname)
-                pyval = <object> pyobval
-                results = pyval.append(results, ignore_index=True)
-            PyDict_SetItem(<object> this.cache, pyname, results)
+            this.store.Notify(data)
+            return
+        if this.registry.size() == 0:
+            return
+        for d in data:
+            if this.registry.count(d.title()) > 0:
+                kept.push_back(d)
+        if kept.size() > 0:
+            this.store.Notify(kept)
 
     std_string Name():
         """The name of the backend"""
@@ -112,9 +212,8 @@ cdef cppclass CyclusMemBack "CyclusMemBack" (cpp_cyclus.RecBackend):
         pass
 
     void Close():
-        """Closes the In-memory backend by setting the cache to None."""
-        c = None
-        this.cache = <PyObject*> c
+        """Closes the In-memory backend by releasing the cache."""
+        this.store = NULL
 
 
 cdef class _MemBack(lib._FullBackend):
@@ -127,6 +226,7 @@ cdef class _MemBack(lib._FullBackend):
         self.fallback = fallback
         self._query_code_cache = {}
         self._query_code_lru = deque()
+        self._marks = {}
 
     def __dealloc__(self):
         # Note that we have to do it this way since self.ptx is void*
@@ -180,6 +280,47 @@ cdef class _MemBack(lib._FullBackend):
         else:
             return None
 
+    def columns(self, table):
+        """Returns the columns of a table recorded to this backend as a dict
+        mapping column names to values. Numeric and boolean columns are
+        read-only NumPy arrays that share memory with the backend, so no
+        DataFrame needs to be built.
+        """
+        return self.cache.columns(table)
+
+    def new_rows(self, table, client=None):
+        """Returns the rows recorded to a table since the last call for the
+        same client, as a dict mapping column names to values like
+        columns(), and moves the client's high-water mark past them. This
+        lets many clients each follow a growing table without being sent
+        the rows they already have.
+
+        Parameters
+        ----------
+        table : str
+            The table name.
+        client : hashable, optional
+            The client whose high-water mark is used.
+        """
+        cols = self.cache.columns(table)
+        nrows = len(next(iter(cols.values()))) if len(cols) > 0 else 0
+        key = (client, table)
+        start = self._marks.get(key, 0)
+        if start > nrows:
+            # the table was cleared and recorded to again
+            start = 0
+        self._marks[key] = nrows
+        if start == 0:
+            return cols
+        return {name: col[start:] for name, col in cols.items()}
+
+    def reset_marks(self, client=None):
+        """Forgets the high-water marks of a client, so that the next call to
+        new_rows() returns every row of a table again.
+        """
+        for key in [k for k in self._marks if k[0] == client]:
+            del self._marks[key]
+
     @property
     def tables(self):
         """Retrieves the set of tables present in the database."""
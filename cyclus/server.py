@@ -81,6 +81,20 @@ in seconds::
      "data": ["table0", "table1", ...]
     }
 
+**table_rows:** The rows recorded to a streamed table since it was last sent,
+as a binary frame rather than a JSON string. The frame starts with the length
+of a JSON header as a 4 byte little-endian unsigned integer, followed by the
+header::
+
+    {"event": "table_rows",
+     "params": {"table": "<name>", "client": "<client>" or null},
+     "nrows": n,
+     "format": "arrow" or "npz"
+    }
+
+and then the rows, as an Arrow IPC stream or, where pyarrow is not installed,
+a NumPy .npz archive.
+
 
 Client Events
 -------------
@@ -121,6 +135,23 @@ A registry event from the server will follow the completion of this event::
      "params": {"when": "empty" or "now"}
      }
 
+**stop_stream:** Stops streaming tables and forgets which rows the client
+has been sent::
+
+    {"event": "stop_stream",
+     "params": {"client": "<client>" or null}
+     }
+
+**stream_tables:** Streams the new rows of tables in the in-memory backend
+registry as table_rows frames, at most once every period seconds per table,
+until stop_stream. Each client with its own name is sent every row once::
+
+    {"event": "stream_tables",
+     "params": {"tables": ["table0", "table1", ...],
+                "period": 1.0,
+                "client": "<client>" or null}
+     }
+
 **table_names_request:** A simple reqest for the table names present in the
 file system backend::
 
@@ -345,6 +376,10 @@ def make_parser():
     p.add_argument('-i', '--initial-actions', action=EventCLIAction,
                    dest='initial_actions', default=(),
                    help='list of initial actions to queue')
+    p.add_argument('--event-loop-interval', type=float,
+                   dest='event_loop_interval', default=None,
+                   help='least number of seconds between calls of the event '
+                        'loop from the simulation')
     p.add_argument('input_file', nargs= '?', default='<no-input-file>', help='path to input file')
     return p
 
@@ -385,6 +420,7 @@ def main(args=None):
     cyclus.events.STATE = state = SimState(input_file=ns.input_file,
                                            output_path=ns.output_path,
                                            memory_backend=True,
+                                           event_loop_interval=ns.event_loop_interval,
                                            debug=ns.debug)
     # load initial and repeating actions
     for kind, params in ns.initial_actions:
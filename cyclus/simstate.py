@@ -1,16 +1,21 @@
 """Tools for representing and driving the simulation."""
 from __future__ import print_function, unicode_literals
 import os
+import time
 import queue
 import atexit
 import sys
+import multiprocessing
+from concurrent.futures import ProcessPoolExecutor
 
 #from cyclus.system import curio
 from cyclus.lib import (DynamicModule, Env, version, load_string_from_file,
+    AgentSpec, dbopen,
     Recorder, Timer, Context, set_warn_limit, discover_specs, XMLParser,
     discover_specs_in_cyclus_path, discover_metadata_in_cyclus_path, Logger,
     set_warn_limit, set_warn_as_error, xml_to_json, json_to_xml,
-    Hdf5Back, SqliteBack, InfileTree, SimInit, XMLFileLoader, XMLFlatLoader)
+    Hdf5Back, SqliteBack, InfileTree, SimInit, XMLFileLoader, XMLFlatLoader,
+    notify_event_loop, set_event_loop_interval)
 from cyclus.memback import MemBack
 
 
@@ -69,6 +74,10 @@ class SimState(object):
         None, a new empty list is instantiated.
     heartbeat_frequency : float or int, optional
         The frequency with which to send heartbeat events.
+    event_loop_interval : float or None, optional
+        The least number of seconds between calls of cyclus.events.loop(),
+        which is otherwise called at every timestep with queued or repeating
+        actions. None leaves the interval as it is.
     debug : bool, optional
         Whether the simulation should provide debugging information.
 
@@ -100,7 +109,8 @@ class SimState(object):
     def __init__(self, input_file=None, input_format=None, output_path=None,
                  memory_backend=False, registry=True, schema_path=None,
                  flat_schema=False, frequency=0.001, repeating_actions=None,
-                 heartbeat_frequency=5, debug=False, print_ms = False):
+                 heartbeat_frequency=5, event_loop_interval=None,
+                 debug=False, print_ms = False):
         ensure_close_dynamic_modules()
         self.input_file = input_file
         self.input_format = input_format
@@ -120,6 +130,8 @@ class SimState(object):
         self.repeating_actions = [] if repeating_actions is None \
                                     else repeating_actions
         self.heartbeat_frequency = heartbeat_frequency
+        if event_loop_interval is not None:
+            set_event_loop_interval(event_loop_interval)
         self.debug = debug
         self.rec = self.file_backend = self.si = None
         self.tasks = {}
@@ -192,6 +204,8 @@ class SimState(object):
 
     def run(self):
         """Starts running the simulation."""
+        # lets the event loop run at the first time step
+        notify_event_loop()
         self.si.timer.run_sim()
         self.rec.flush()
 
@@ -209,7 +223,7 @@ class SimState(object):
     def action_queue(self):
         """A queue for pending actions."""
         if self._action_queue is None:
-            self._action_queue = queue.Queue()
+            self._action_queue = ActionQueue()
         return self._action_queue
 
     @property
@@ -218,3 +232,125 @@ class SimState(object):
         if self._monitor_queue is None:
             self._monitor_queue = queue.Queue()
         return self._monitor_queue
+
+
+class ActionQueue(queue.Queue):
+    """A queue of pending actions, which marks that the event loop has work
+    to do as actions are put on it.
+    """
+
+    def put(self, item, block=True, timeout=None):
+        super(ActionQueue, self).put(item, block=block, timeout=timeout)
+        notify_event_loop()
+
+
+def _pool_init(archetypes):
+    """Warms up a worker process of a SimPool by setting up the environment
+    and loading the archetype libraries, so that simulations do not pay for
+    it.
+    """
+    Env.set_nuc_data_path()
+    ensure_close_dynamic_modules()
+    dm = DynamicModule()
+    for spec in archetypes:
+        dm.exists(AgentSpec(spec))
+
+
+def _pool_run(kwargs, tables):
+    """Runs a simulation in a worker process of a SimPool."""
+    start = time.time()
+    state = SimState(**kwargs)
+    state.load()
+    state.run()
+    rtn = {'output_path': state.output_path,
+           'seconds': time.time() - start,
+           'pid': os.getpid()}
+    # closes the output, so that it can be read back below
+    state.rec.close()
+    if tables:
+        with dbopen(state.output_path) as db:
+            rtn['tables'] = {t: db.query(t) for t in tables}
+    return rtn
+
+
+class SimPool(object):
+    """A pool of warm worker processes that run simulations, for services
+    that run many short simulations, where starting a process and loading
+    archetypes would otherwise take longer than the simulations themselves.
+
+    Each worker loads the given archetype libraries once, then runs
+    simulations one after another, each with its own recorder, backends,
+    and context. Since the cyclus core keeps some process wide state,
+    simulations run concurrently in separate workers rather than on
+    threads of one process.
+
+    Parameters
+    ----------
+    nworkers : int or None, optional
+        The number of worker processes, by default the number of CPUs.
+    archetypes : iterable of str, optional
+        The specs of the archetypes to load in every worker up front, e.g.
+        ``[':agents:Source', ':agents:Sink']``. By default, the archetypes
+        found in CYCLUS_PATH are loaded.
+    mp_context : str, optional
+        The multiprocessing start method of the workers. Workers are spawned
+        by default, since forking a process that runs threads is unsafe.
+    """
+
+    def __init__(self, nworkers=None, archetypes=None, mp_context='spawn'):
+        if archetypes is None:
+            archetypes = discover_specs_in_cyclus_path()
+        self.archetypes = sorted(archetypes)
+        self._executor = ProcessPoolExecutor(
+            max_workers=nworkers,
+            mp_context=multiprocessing.get_context(mp_context),
+            initializer=_pool_init, initargs=(self.archetypes,))
+
+    def submit(self, input_file, output_path=None, input_format=None,
+               tables=None, **kwargs):
+        """Queues a simulation to run on the next free worker.
+
+        Parameters
+        ----------
+        input_file : str
+            The path to the input file or a raw string of the input file.
+        output_path : str or None, optional
+            The path to the output database, which should differ between
+            simulations that run at the same time.
+        input_format : str or None, optional
+            The format of the input file, if it is a raw string.
+        tables : iterable of str, optional
+            The tables to read from the output and return as DataFrames.
+        kwargs : optional
+            Other SimState arguments, except the in-memory backend, which
+            cannot be sent between processes.
+
+        Returns
+        -------
+        future : concurrent.futures.Future
+            The future of a dict with the output path of the simulation, the
+            seconds it took, the id of the process it ran in, and the tables
+            asked for, keyed by name.
+        """
+        kwargs.update(input_file=input_file, output_path=output_path,
+                      input_format=input_format, memory_backend=False)
+        return self._executor.submit(_pool_run, kwargs,
+                                     None if tables is None else list(tables))
+
+    def run(self, *args, **kwargs):
+        """Runs a simulation and waits for it to finish, taking the arguments
+        of submit() and returning the result of its future.
+        """
+        return self.submit(*args, **kwargs).result()
+
+    def close(self, wait=True):
+        """Shuts the workers down, by default after the queued simulations
+        have run.
+        """
+        self._executor.shutdown(wait=wait)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc, tb):
+        self.close()
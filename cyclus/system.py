@@ -25,6 +25,11 @@ else:
     except ImportError:
         websockets = None
 
+try:
+    import pyarrow
+except ImportError:
+    pyarrow = None
+
 if PY_VERSION_TUPLE < (3, 2, 0):
     concurrent_futures = None
 else:
@@ -81,6 +81,8 @@ def install_cyclus(args):
             cmake_cmd += ['-DCMAKE_BUILD_TYPE=' + args.build_type]
         if args.core_version:
             cmake_cmd += ['-DCORE_VERSION=' + args.core_version]
+        if args.min_log_level:
+            cmake_cmd += ['-DCYCLUS_MIN_LOG_LEVEL=' + args.min_log_level]
         if args.D is not None:
             cmake_cmd += ['-D' + x for x in args.D]
         if args.cmake_debug:
@@ -191,6 +193,11 @@ def main():
     parser.add_argument('--core-version', dest='core_version', default=None,
                         help='Sets the core version number.')
 
+    parser.add_argument('--min-log-level', dest='min_log_level', default=None,
+                        help='the least severe log level compiled in, e.g. '
+                             'LEV_INFO5; more verbose log statements compile '
+                             'to nothing.')
+
     parser.add_argument('-D', metavar='VAR', action='append',
                         help='Set enviornment variable(s).')
     parser.add_argument('--cmake-debug', action='store_true', default=False,
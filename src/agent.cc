@@ -6,15 +6,26 @@
 #include <sstream>
 #include <string>
 
+#include "block_pool.h"
 #include "context.h"
 #include "error.h"
 #include "logger.h"
+#include "material.h"
 #include "resource.h"
+#include "table_writer.h"
+#include "toolkit/spatial_index.h"
 
 namespace cyclus {
 
-// static members
-int Agent::next_id_ = 0;
+void* Agent::operator new(std::size_t size) {
+  return BlockPool::Agents()->Alloc(size);
+}
+
+void Agent::operator delete(void* p, std::size_t size) {
+  if (p != NULL) {
+    BlockPool::Agents()->Free(p, size);
+  }
+}
 
 void Agent::InitFrom(Agent* m) {
   prototype_ = m->prototype_;
@@ -33,6 +44,26 @@ std::string Agent::InformErrorMsg(std::string msg) {
   return ret.str();
 }
 
+InvSummaries Agent::SummarizeInv() {
+  InvSummaries sums;
+  Inventories invs = SnapshotInv();
+  Inventories::iterator it;
+  for (it = invs.begin(); it != invs.end(); ++it) {
+    const std::vector<Resource::Ptr>& rs = it->second;
+    if (rs.empty() || ResCast<Material>(rs[0]) == NULL) {
+      continue;  // skip non-material inventories
+    }
+    std::vector<Material::Ptr> mats;
+    mats.reserve(rs.size());
+    for (int i = 0; i < rs.size(); i++) {
+      mats.push_back(ResCast<Material>(rs[i]));
+    }
+    InvSummary& sum = sums[it->first];
+    sum.quantity = Material::SumMass(mats, &sum.mass);
+  }
+  return sums;
+}
+
 void Agent::InfileToDb(InfileTree* qe, DbInit di) {
   std::string proto = qe->GetString("name");
   int lifetime = OptionalQuery<int>(qe, "lifetime", -1);
@@ -49,6 +80,10 @@ void Agent::InitFrom(QueryableBackend* b) {
   lifetime_ = qr.GetVal<int>("Lifetime");
 }
 
+void Agent::InitFromBinary(BinaryReader* r) {
+  throw IOError("agents of archetype " + spec_ + " have no binary state");
+}
+
 void Agent::Snapshot(DbInit di) {
   di.NewDatum("Agent")
       ->AddVal("Prototype", prototype_)
@@ -58,20 +93,21 @@ void Agent::Snapshot(DbInit di) {
 
 Agent::Agent(Context* ctx)
     : ctx_(ctx),
-      id_(next_id_++),
+      id_(ctx->ids().Next(IdAllocator::AGENT)),
       kind_("Agent"),
       parent_id_(-1),
       enter_time_(-1),
       lifetime_(-1),
       parent_(NULL),
       spec_("UNSPECIFIED") {
-  ctx_->agent_list_.insert(this);
+  ctx_->agents_.Add(this);
   MLOG(LEV_DEBUG3) << "Agent ID=" << id_ << ", ptr=" << this << " created.";
 }
 
 Agent::~Agent() {
   MLOG(LEV_DEBUG3) << "Deleting agent '" << prototype() << "' ID=" << id_;
-  context()->agent_list_.erase(this);
+  context()->agents_.Erase(this);
+  context()->positions().Erase(id_);
 
   std::set<Agent*>::iterator it;
   if (parent_ != NULL) {
@@ -211,15 +247,13 @@ std::vector<std::string> Agent::GetTreePrintOuts(Agent* m) {
 }
 
 void Agent::AddToTable() {
-  ctx_->NewDatum("AgentEntry")
-      ->AddVal("AgentId", id_)
-      ->AddVal("Kind", kind_)
-      ->AddVal("Spec", spec_)
-      ->AddVal("Prototype", prototype_)
-      ->AddVal("ParentId", parent_id_)
-      ->AddVal("Lifetime", lifetime_)
-      ->AddVal("EnterTime", enter_time_)
-      ->Record();
+  if (ctx_->built_ != NULL) {
+    // recorded along with the rest of the batch (see Context::BuildAgents)
+    ctx_->built_->push_back(this);
+    return;
+  }
+  ctx_->tables().agent_entry.Record(id_, kind_, spec_, prototype_,
+                                    parent_id_, lifetime_, enter_time_);
 }
 
 }  // namespace cyclus
@@ -1,6 +1,7 @@
 #ifndef CYCLUS_SRC_AGENT_H_
 #define CYCLUS_SRC_AGENT_H_
 
+#include <cstddef>
 #include <map>
 #include <set>
 #include <string>
@@ -8,10 +9,13 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include "binary_state.h"
+#include "composition.h"
 #include "db_init.h"
 #include "dynamic_module.h"
 #include "infile_tree.h"
 #include "exchange_context.h"
+#include "mem_usage.h"
 #include "pyne.h"
 #include "query_backend.h"
 #include "resource.h"
@@ -48,7 +52,19 @@ typedef std::map<std::string, std::vector<Resource::Ptr> > Inventories;
 /// functions all do inter-related things.  Notably, the #InfileToDb, #InitFrom,
 /// and #Snapshot functions must all write/read to/from the same database tables
 /// (and table schemas).
-class Agent : public StateWrangler, virtual public Ider {
+/// The total quantity of the material in an inventory and the mass of each
+/// nuclide in it, in kg.
+struct InvSummary {
+  InvSummary() : quantity(0) {}
+
+  double quantity;
+  CompMap mass;
+};
+
+typedef std::map<std::string, InvSummary> InvSummaries;
+
+class Agent : public StateWrangler, virtual public Ider,
+              private MemCounted<Agent, MemUsage::AGENT> {
   friend class SimInit;
   friend class ::SimInitTest;
 
@@ -62,6 +78,17 @@ class Agent : public StateWrangler, virtual public Ider {
   /// etc. All subclass destructors should also be virtual.
   virtual ~Agent();
 
+  /// Agents are allocated from pools of same-sized blocks, so that the memory
+  /// of decommissioned agents is reused by the next agents of the same type
+  /// to be built, and agents of one type built together sit next to each
+  /// other in memory. Pooled memory is kept for the life of the process.
+  /// Setting the CYCLUS_NO_AGENT_POOL environment variable allocates every
+  /// agent from the general heap instead, e.g. for memory checkers.
+  /// @{
+  static void* operator new(std::size_t size);
+  static void operator delete(void* p, std::size_t size);
+  /// @}
+
   virtual std::string version() { return "unspecified"; }
 
   /// Returns a newly created/allocated prototype that is an exact copy of this.
@@ -270,6 +297,51 @@ class Agent : public StateWrangler, virtual public Ider {
   /// @warning This function MUST NOT modify the agent's internal state.
   virtual Inventories SnapshotInv() = 0;
 
+  /// Whether this agent's Snapshot may be called concurrently with those of
+  /// other agents. When snapshots are taken on several threads (see
+  /// SimInit::Snapshot), agents that return true are serialized on a pool of
+  /// threads and all others on the simulation thread. Their datums are
+  /// recorded in the usual agent order either way.
+  ///
+  /// @warning thread-safe snapshots may only read the agent's own state; in
+  /// particular, they must not call into Python or query other agents.
+  virtual bool ThreadSafeSnapshot() { return false; }
+
+  /// Returns whether the state recorded by Snapshot may have changed since
+  /// this was last called. With delta snapshots (see SimInit::Snapshot), it is
+  /// called for every agent at every snapshot, and agents that return false
+  /// and whose inventories are unchanged are not snapshot at all. The default
+  /// returns true. The cycpp preprocessor implements it for archetypes with
+  /// the class annotation "track_changes" (see cycpp.py).
+  virtual bool SnapshotDirty() { return true; }
+
+  /// Writes the state recorded by Snapshot in a binary form that only
+  /// InitFromBinary reads back, returning false, having written nothing, if
+  /// the agent has no such form. Where the state is only read back by the same
+  /// build of the archetype, i.e., in state images (see SimInit::Snapshot) and
+  /// in forked simulations (see SimInit::Fork), this takes the place of
+  /// Snapshot and InitFrom(QueryableBackend*), which convert every value to
+  /// and from database rows. The default returns false. The cycpp
+  /// preprocessor implements both methods for archetypes whose state
+  /// variables all have types the database supports and no custom snapshot or
+  /// initfromdb code (see cycpp.py).
+  virtual bool SnapshotBinary(BinaryWriter* w) { return false; }
+
+  /// Initializes the agent's state from what SnapshotBinary of an agent of
+  /// the same archetype wrote. Like InitFrom(QueryableBackend*), it is called
+  /// after Agent::InitFrom(QueryableBackend*).
+  ///
+  /// @throws IOError if r does not hold the state written by SnapshotBinary
+  /// of this build of the archetype
+  virtual void InitFromBinary(BinaryReader* r);
+
+  /// Summarizes the material inventories of this agent for explicit
+  /// inventory recording, leaving out inventories that hold no material.
+  /// The default sums up the materials returned by SnapshotInv without
+  /// copying them. Agents can override it to summarize their inventories
+  /// without gathering them first, e.g. with ResBuf::SumMass.
+  virtual InvSummaries SummarizeInv();
+
   /// recursively prints the parent-child tree
   std::string PrintChildren();
 
@@ -329,6 +401,23 @@ class Agent : public StateWrangler, virtual public Ider {
   /// default implementation for material preferences.
   virtual void AdjustProductPrefs(PrefMap<Product>::type& prefs) {}
 
+  /// Sparse alternative to AdjustMatlPrefs for agents that change only a few
+  /// of the preferences they are shown, such as institutions and regions
+  /// adjusting their children's requests. Rather than modifying prefs, an
+  /// agent records the preferences it changes in changes and returns true.
+  /// The default returns false, in which case AdjustMatlPrefs is called
+  /// instead.
+  virtual bool ChangeMatlPrefs(const PrefMap<Material>::type& prefs,
+                               PrefChanges<Material>* changes) {
+    return false;
+  }
+
+  /// Sparse alternative to AdjustProductPrefs; see ChangeMatlPrefs.
+  virtual bool ChangeProductPrefs(const PrefMap<Product>::type& prefs,
+                                  PrefChanges<Product>* changes) {
+    return false;
+  }
+
   /// Returns an agent's xml rng schema for initializing from input files. All
   /// concrete agents should override this function. This must validate the same
   /// xml input that the InfileToDb function receives.
@@ -458,9 +547,6 @@ class Agent : public StateWrangler, virtual public Ider {
   /// connects an agent to its parent.
   void Connect(Agent* parent);
 
-  /// Stores the next available facility ID
-  static int next_id_;
-
   /// children of this agent
   std::set<Agent*> children_;
 
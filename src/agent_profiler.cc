@@ -0,0 +1,95 @@
+#include "agent_profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+#include "agent.h"
+#include "context.h"
+
+namespace cyclus {
+
+AgentProfiler::AgentProfiler()
+    : start_ticks_(Now()), start_(std::chrono::steady_clock::now()) {}
+
+const char* AgentProfiler::CallName(Call c) {
+  static const char* names[NUM_CALLS] = {
+      "Tick", "Tock", "Decision", "Requests", "Bids", "Preferences",
+      "Trades", "AcceptTrades"};
+  return names[c];
+}
+
+void AgentProfiler::Add(Agent* a, Call c, uint64_t ticks) {
+  std::lock_guard<std::mutex> lock(mu_);
+  std::unordered_map<int, Entry*>::iterator it = by_agent_.find(a->id());
+  if (it == by_agent_.end()) {
+    Entry* e = &entries_[a->prototype()];
+    e->spec = a->spec();
+    it = by_agent_.insert(std::make_pair(a->id(), e)).first;
+  }
+  Total& t = it->second->totals[c];
+  t.calls++;
+  t.ticks += ticks;
+}
+
+double AgentProfiler::SecondsPerTick() const {
+  double secs = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start_).count();
+  uint64_t ticks = Now() - start_ticks_;
+  return ticks == 0 ? 0 : secs / ticks;
+}
+
+std::map<std::string, AgentProfiler::Entry> AgentProfiler::entries() {
+  std::lock_guard<std::mutex> lock(mu_);
+  return entries_;
+}
+
+void AgentProfiler::Record(Context* ctx) {
+  double spt = SecondsPerTick();
+  std::map<std::string, Entry> all = entries();
+  std::map<std::string, Entry>::iterator it;
+  for (it = all.begin(); it != all.end(); ++it) {
+    for (int c = 0; c < NUM_CALLS; ++c) {
+      const Total& t = it->second.totals[c];
+      if (t.calls == 0)
+        continue;
+      ctx->NewDatum("AgentProfile")
+          ->AddVal("Prototype", it->first)
+          ->AddVal("Spec", it->second.spec)
+          ->AddVal("Call", std::string(CallName(static_cast<Call>(c))))
+          ->AddVal("Calls", static_cast<int>(t.calls))
+          ->AddVal("Seconds", t.ticks * spt)
+          ->Record();
+    }
+  }
+}
+
+void AgentProfiler::Summarize(std::ostream& out, int nprotos) {
+  double spt = SecondsPerTick();
+  std::map<std::string, Entry> all = entries();
+  std::vector<std::pair<uint64_t, std::string> > order;
+  std::map<std::string, Entry>::iterator it;
+  for (it = all.begin(); it != all.end(); ++it) {
+    uint64_t ticks = 0;
+    for (int c = 0; c < NUM_CALLS; ++c)
+      ticks += it->second.totals[c].ticks;
+    order.push_back(std::make_pair(ticks, it->first));
+  }
+  std::sort(order.rbegin(), order.rend());
+
+  out << "Agent profile (prototype [spec]: total s; call s (calls)):\n";
+  for (int i = 0; i < order.size() && i < nprotos; ++i) {
+    const Entry& e = all[order[i].second];
+    out << "  " << order[i].second << " [" << e.spec << "]: "
+        << order[i].first * spt << " s;";
+    for (int c = 0; c < NUM_CALLS; ++c) {
+      if (e.totals[c].calls == 0)
+        continue;
+      out << " " << CallName(static_cast<Call>(c)) << " "
+          << e.totals[c].ticks * spt << " (" << e.totals[c].calls << ")";
+    }
+    out << "\n";
+  }
+}
+
+}  // namespace cyclus
@@ -0,0 +1,126 @@
+#ifndef CYCLUS_SRC_AGENT_PROFILER_H_
+#define CYCLUS_SRC_AGENT_PROFILER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace cyclus {
+
+class Agent;
+class Context;
+
+/// Accumulates the time agents spend in their time step phases and resource
+/// exchange callbacks, per prototype. Calls are timed with the processor's
+/// time stamp counter where there is one, which costs a few nanoseconds, and
+/// the counts are converted to seconds over the life of the profiler.
+///
+/// Profiling is turned on with Context::profile_agents. The timer records
+/// the totals to the AgentProfile table at the end of the simulation, one
+/// row per prototype and call.
+class AgentProfiler {
+ public:
+  /// The calls that are timed.
+  enum Call {
+    TICK = 0,
+    TOCK,
+    DECISION,
+    REQUESTS,  ///< GetMatlRequests and GetProductRequests
+    BIDS,  ///< GetMatlBids and GetProductBids
+    PREFS,  ///< preference adjustment, by the trader and its parents
+    TRADES,  ///< GetMatlTrades and GetProductTrades
+    ACCEPT,  ///< AcceptMatlTrades and AcceptProductTrades
+    NUM_CALLS,
+  };
+
+  /// The totals of a call of the agents of a prototype.
+  struct Total {
+    Total() : calls(0), ticks(0) {}
+    uint64_t calls;
+    uint64_t ticks;
+  };
+
+  /// The totals of the calls of the agents of a prototype.
+  struct Entry {
+    std::string spec;
+    Total totals[NUM_CALLS];
+  };
+
+  AgentProfiler();
+
+  /// Returns the name of a call, as recorded.
+  static const char* CallName(Call c);
+
+  /// Returns the current value of the counter calls are timed with.
+  static inline uint64_t Now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+  }
+
+  /// Adds a call of agent a that took ticks counter ticks. Calls may be
+  /// added from many threads at once.
+  void Add(Agent* a, Call c, uint64_t ticks);
+
+  /// Returns the number of seconds per counter tick.
+  double SecondsPerTick() const;
+
+  /// Returns the totals, by prototype.
+  std::map<std::string, Entry> entries();
+
+  /// Records the totals to the AgentProfile table.
+  void Record(Context* ctx);
+
+  /// Prints the prototypes that took the most time, and the time of each
+  /// of their calls.
+  void Summarize(std::ostream& out, int nprotos = 20);
+
+ private:
+  std::mutex mu_;
+  std::map<std::string, Entry> entries_;
+
+  /// the entry of each agent id
+  std::unordered_map<int, Entry*> by_agent_;
+
+  /// the counter and the clock when the profiler was created, to convert
+  /// ticks to seconds
+  uint64_t start_ticks_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+/// Times a call of an agent while it is in scope, if profiler isn't NULL.
+class ProfileCall {
+ public:
+  ProfileCall(AgentProfiler* profiler, Agent* a, AgentProfiler::Call c)
+      : profiler_(profiler), agent_(a), call_(c), start_(0) {
+    if (profiler_ != NULL)
+      start_ = AgentProfiler::Now();
+  }
+
+  ~ProfileCall() {
+    if (profiler_ != NULL && agent_ != NULL)
+      profiler_->Add(agent_, call_, AgentProfiler::Now() - start_);
+  }
+
+ private:
+  AgentProfiler* profiler_;
+  Agent* agent_;
+  AgentProfiler::Call call_;
+  uint64_t start_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_AGENT_PROFILER_H_
@@ -0,0 +1,116 @@
+#include "agent_registry.h"
+
+#include <algorithm>
+
+#include "agent.h"
+
+namespace cyclus {
+
+bool AgentRegistry::Slots::Insert(Agent* a) {
+  if (Has(a))
+    return false;
+  pos_[a] = agents_.size();
+  agents_.push_back(a);
+  return true;
+}
+
+void AgentRegistry::Slots::Reserve(size_t n) {
+  // at least double, so that many small batches still grow geometrically
+  size_t want = agents_.size() + n;
+  if (want > agents_.capacity()) {
+    agents_.reserve(std::max(want, 2 * agents_.capacity()));
+  }
+  if (want > pos_.bucket_count() * pos_.max_load_factor()) {
+    pos_.reserve(std::max(want, 2 * pos_.size()));
+  }
+}
+
+bool AgentRegistry::Slots::Erase(Agent* a) {
+  std::unordered_map<Agent*, size_t>::iterator it = pos_.find(a);
+  if (it == pos_.end())
+    return false;
+  size_t i = it->second;
+  pos_.erase(it);
+  Agent* last = agents_.back();
+  agents_.pop_back();
+  if (last != a) {
+    agents_[i] = last;
+    pos_[last] = i;
+  }
+  return true;
+}
+
+void AgentRegistry::Add(Agent* a) {
+  all_.Insert(a);
+}
+
+void AgentRegistry::Reserve(int n) {
+  if (n <= 0)
+    return;
+  all_.Reserve(n);
+  live_.Reserve(n);
+  size_t want = keys_.size() + n;
+  if (want > keys_.bucket_count() * keys_.max_load_factor()) {
+    keys_.reserve(std::max(want, 2 * keys_.size()));
+  }
+}
+
+bool AgentRegistry::Erase(Agent* a) {
+  Exit(a);
+  return all_.Erase(a);
+}
+
+void AgentRegistry::Enter(Agent* a) {
+  if (!all_.Has(a) || !live_.Insert(a))
+    return;
+  Keys& k = keys_[a];
+  k.kind = a->kind();
+  k.prototype = a->prototype();
+  k.spec = a->spec();
+  kinds_[k.kind].Insert(a);
+  prototypes_[k.prototype].Insert(a);
+  specs_[k.spec].Insert(a);
+}
+
+void AgentRegistry::Exit(Agent* a) {
+  if (!live_.Erase(a))
+    return;
+  std::unordered_map<Agent*, Keys>::iterator it = keys_.find(a);
+  Erase(&kinds_, it->second.kind, a);
+  Erase(&prototypes_, it->second.prototype, a);
+  Erase(&specs_, it->second.spec, a);
+  keys_.erase(it);
+}
+
+const AgentRegistry::Agents& AgentRegistry::OfKind(
+    const std::string& kind) const {
+  return Find(kinds_, kind);
+}
+
+const AgentRegistry::Agents& AgentRegistry::OfPrototype(
+    const std::string& prototype) const {
+  return Find(prototypes_, prototype);
+}
+
+const AgentRegistry::Agents& AgentRegistry::OfSpec(
+    const std::string& spec) const {
+  return Find(specs_, spec);
+}
+
+const AgentRegistry::Agents& AgentRegistry::Find(const Index& index,
+                                                 const std::string& key) {
+  static const Agents none;
+  Index::const_iterator it = index.find(key);
+  return it == index.end() ? none : it->second.agents();
+}
+
+void AgentRegistry::Erase(Index* index, const std::string& key, Agent* a) {
+  Index::iterator it = index->find(key);
+  if (it == index->end())
+    return;
+  it->second.Erase(a);
+  if (it->second.empty())
+    index->erase(it);
+}
+
+}  // namespace cyclus
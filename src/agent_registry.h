@@ -0,0 +1,119 @@
+#ifndef CYCLUS_SRC_AGENT_REGISTRY_H_
+#define CYCLUS_SRC_AGENT_REGISTRY_H_
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cyclus {
+
+class Agent;
+
+/// AgentRegistry keeps the agents of a simulation in dense arrays: every
+/// agent, including prototypes and agents not yet built, and the live
+/// agents, those that have entered the simulation and not yet left it. The
+/// live agents are also indexed by kind, prototype and spec, so that finding
+/// them takes time in the number found rather than in the number of agents.
+///
+/// Agents are added and removed in constant time, the last agent of an
+/// array taking the place of one removed, so the arrays are in no
+/// particular order. The context registers every agent as it is created and
+/// deleted, and marks it live as it enters the simulation (see
+/// Agent::EnterNotify) and leaves it (see Agent::Decommission).
+class AgentRegistry {
+ public:
+  typedef std::vector<Agent*> Agents;
+
+  /// Returns the number of agents registered.
+  inline int size() const { return all_.agents().size(); }
+
+  /// Returns whether an agent is registered.
+  inline bool Has(Agent* a) const { return all_.Has(a); }
+
+  /// Returns whether an agent is live.
+  inline bool IsLive(Agent* a) const { return live_.Has(a); }
+
+  /// Registers an agent.
+  void Add(Agent* a);
+
+  /// Makes room for n more agents, registered and live, so that building
+  /// them in a batch doesn't grow the arrays and indices step by step.
+  void Reserve(int n);
+
+  /// Unregisters an agent, live or not, returning whether it was
+  /// registered.
+  bool Erase(Agent* a);
+
+  /// Marks a registered agent live, indexing it by its kind, prototype and
+  /// spec, which are fixed once it enters the simulation.
+  void Enter(Agent* a);
+
+  /// Marks a live agent as no longer live.
+  void Exit(Agent* a);
+
+  /// Returns every registered agent.
+  inline const Agents& all() const { return all_.agents(); }
+
+  /// Returns the live agents.
+  inline const Agents& live() const { return live_.agents(); }
+
+  /// Returns the live agents of a kind, e.g., "Facility".
+  const Agents& OfKind(const std::string& kind) const;
+
+  /// Returns the live agents of a prototype.
+  const Agents& OfPrototype(const std::string& prototype) const;
+
+  /// Returns the live agents of an archetype spec.
+  const Agents& OfSpec(const std::string& spec) const;
+
+ private:
+  /// A dense array of agents with the position of each in it.
+  class Slots {
+   public:
+    inline bool Has(Agent* a) const { return pos_.count(a) > 0; }
+    inline bool empty() const { return agents_.empty(); }
+    inline const Agents& agents() const { return agents_; }
+
+    /// Adds an agent, returning whether it wasn't there already.
+    bool Insert(Agent* a);
+
+    /// Makes room for n more agents.
+    void Reserve(size_t n);
+
+    /// Removes an agent, moving the last one into its place, and returns
+    /// whether it was there.
+    bool Erase(Agent* a);
+
+   private:
+    Agents agents_;
+    std::unordered_map<Agent*, size_t> pos_;
+  };
+
+  typedef std::map<std::string, Slots> Index;
+
+  /// The keys a live agent is indexed by, as it entered.
+  struct Keys {
+    std::string kind;
+    std::string prototype;
+    std::string spec;
+  };
+
+  /// Returns the agents of key in index.
+  static const Agents& Find(const Index& index, const std::string& key);
+
+  /// Removes an agent from the agents of key in index, dropping the key once
+  /// it has none.
+  static void Erase(Index* index, const std::string& key, Agent* a);
+
+  Slots all_;
+  Slots live_;
+  std::unordered_map<Agent*, Keys> keys_;
+  Index kinds_;
+  Index prototypes_;
+  Index specs_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_AGENT_REGISTRY_H_
@@ -38,6 +38,8 @@ DEALINGS IN THE SOFTWARE.
 WARNING: this file was modified by Robert Carlsen for Cyclus from the
 original Boost 1.54.0
 (http://www.boost.org/doc/libs/1_54_0/boost/spirit/home/support/detail/hold_any.hpp).
+It stores values of up to small_size bytes (strings and small PODs among
+them) inline rather than on the heap, and can be moved from.
 ==============================================================================*/
 #if !defined(BOOST_SPIRIT_HOLD_ANY_MAY_02_2007_0857AM)
 #define BOOST_SPIRIT_HOLD_ANY_MAY_02_2007_0857AM
@@ -60,6 +62,8 @@ original Boost 1.54.0
 #include <algorithm>
 #include <iosfwd>
 #include <string>
+#include <type_traits>
+#include <utility>
 
 ///////////////////////////////////////////////////////////////////////////////
 #if BOOST_WORKAROUND(BOOST_MSVC, >= 1400)
@@ -95,6 +99,21 @@ namespace boost { namespace spirit
             void (*destruct)(void**);
             void (*clone)(void* const*, void**);
             void (*move)(void* const*, void**);
+            // moves the value at src into dest, which holds no value, and
+            // leaves src holding no value
+            void (*move_construct)(void**, void**);
+        };
+
+        // the bytes a hold_any stores values in inline
+        static const std::size_t small_size = 32;
+
+        // the inline storage of a hold_any, which overlays its pointer to
+        // values stored on the heap
+        union small_storage
+        {
+            void* ptr;
+            double align;
+            char bytes[small_size];
         };
 
         // static functions for small value-types
@@ -128,6 +147,12 @@ namespace boost { namespace spirit
                     *reinterpret_cast<T*>(dest) =
                         *reinterpret_cast<T const*>(src);
                 }
+                static void move_construct(void** src, void** dest)
+                {
+                    T* x = reinterpret_cast<T*>(src);
+                    new (dest) T(std::move(*x));
+                    x->~T();
+                }
             };
         };
 
@@ -161,13 +186,24 @@ namespace boost { namespace spirit
                     **reinterpret_cast<T**>(dest) =
                         **reinterpret_cast<T* const*>(src);
                 }
+                static void move_construct(void** src, void** dest)
+                {
+                    *dest = *src;
+                    *src = 0;
+                }
             };
         };
 
         template <typename T>
         struct get_table
         {
-            typedef mpl::bool_<(sizeof(T) <= sizeof(void*))> is_small;
+            // values are stored inline if they fit and can be moved without
+            // throwing, so that moving a hold_any never throws
+            typedef mpl::bool_<(sizeof(T) <= small_size &&
+                                std::alignment_of<T>::value <=
+                                    std::alignment_of<small_storage>::value &&
+                                std::is_nothrow_move_constructible<T>::value)>
+                is_small;
 
             template <typename Char>
             static fxn_ptr_table<Char>* get()
@@ -179,6 +215,7 @@ namespace boost { namespace spirit
                     fxns<is_small>::template type<T, Char>::destruct,
                     fxns<is_small>::template type<T, Char>::clone,
                     fxns<is_small>::template type<T, Char>::move,
+                    fxns<is_small>::template type<T, Char>::move_construct,
                 };
                 return &static_table;
             }
@@ -195,13 +232,19 @@ namespace boost { namespace spirit
     public:
         // constructors
         template <typename T>
-        basic_hold_any(T const& x)
-          : table(spirit::detail::get_table<T>::template get<Char>()), object(0)
+        basic_hold_any(T&& x,
+                       typename std::enable_if<!std::is_same<
+                           typename std::decay<T>::type,
+                           basic_hold_any>::value>::type* = 0)
+          : table(spirit::detail::get_table<
+                typename std::decay<T>::type>::template get<Char>()),
+            object(0)
         {
-            if (spirit::detail::get_table<T>::is_small::value)
-                new (&object) T(x);
+            typedef typename std::decay<T>::type V;
+            if (spirit::detail::get_table<V>::is_small::value)
+                new (&object) V(std::forward<T>(x));
             else
-                object = new T(x);
+                object = new V(std::forward<T>(x));
         }
 
         basic_hold_any(const char* x)
@@ -223,6 +266,13 @@ namespace boost { namespace spirit
             assign(x);
         }
 
+        basic_hold_any(basic_hold_any&& x) noexcept
+          : table(x.table), object(0)
+        {
+            table->move_construct(&x.object, &object);
+            x.table = spirit::detail::get_table<spirit::detail::empty>::template get<Char>();
+        }
+
         ~basic_hold_any()
         {
             table->static_delete(&object);
@@ -266,8 +316,8 @@ namespace boost { namespace spirit
             }
             else {
                 if (spirit::detail::get_table<T>::is_small::value) {
-                    // create copy on-top of object pointer itself
-                    table->destruct(&object); // first destruct the old content
+                    // create copy in the inline storage
+                    reset();                  // first delete the old content
                     new (&object) T(x);
                 }
                 else {
@@ -292,11 +342,25 @@ namespace boost { namespace spirit
             return assign(x);
         }
 
+        // move assignment operator
+        basic_hold_any& operator=(basic_hold_any&& x) noexcept
+        {
+            if (&x != this) {
+                reset();
+                x.table->move_construct(&x.object, &object);
+                table = x.table;
+                x.table = spirit::detail::get_table<spirit::detail::empty>::template get<Char>();
+            }
+            return *this;
+        }
+
         // utility functions
         basic_hold_any& swap(basic_hold_any& x)
         {
-            std::swap(table, x.table);
-            std::swap(object, x.object);
+            // values stored inline may not be relocatable bitwise
+            basic_hold_any tmp(std::move(x));
+            x = std::move(*this);
+            *this = std::move(tmp);
             return *this;
         }
 
@@ -352,7 +416,13 @@ namespace boost { namespace spirit
 #endif
         // fields
         spirit::detail::fxn_ptr_table<Char>* table;
-        void* object;
+        union
+        {
+            // values larger than small_size are stored on the heap, and
+            // smaller ones in storage, starting at object
+            void* object;
+            spirit::detail::small_storage storage;
+        };
     };
 
     // boost::any-like casting
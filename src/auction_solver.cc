@@ -0,0 +1,500 @@
+#include "auction_solver.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <sstream>
+
+#include "context.h"
+#include "cyc_limits.h"
+#include "error.h"
+#include "exchange_graph.h"
+#include "flow_solver.h"
+#include "logger.h"
+#include "task_scheduler.h"
+
+namespace cyclus {
+
+const double AuctionSolver::kDefaultGap = 1e-3;
+
+namespace {
+
+// 1e15 is the largest request capacity the ProgTranslator passes to solvers
+const double kMaxCap = 1e15;
+
+const double kInf = std::numeric_limits<double>::infinity();
+
+// the relative tolerance below which demand is met and supply and arcs are
+// used up, so that round off doesn't leave slivers to bid on
+const double kTol = 1e-9;
+
+// each auction's epsilon is this many times smaller than the last's
+const double kEpsFactor = 5;
+
+// the fewest bidders or sellers per thread worth splitting a round over
+const int kMinPerThread = 2048;
+
+// the rounds per arc after which an auction gives up on converging
+const int kMaxRoundsPerArc = 100;
+
+// calls fn with the ranges of [0, n) split over up to nthreads threads of
+// sched
+void ParallelFor(TaskScheduler* sched, int n, int nthreads,
+                 const std::function<void(int, int)>& fn) {
+  nthreads = std::min(std::min(nthreads, sched->threads()), n / kMinPerThread);
+  if (nthreads <= 1) {
+    fn(0, n);
+    return;
+  }
+  int chunk = (n + nthreads - 1) / nthreads;
+  sched->ParallelFor(nthreads, [&](int i) {
+    fn(i * chunk, std::min(n, (i + 1) * chunk));
+  });
+}
+
+// supply held by a bidder over an arc, at the price it bid
+struct Holding {
+  int bidder;
+  int arc;
+  double qty;
+  double price;
+};
+
+inline bool HigherPrice(const Holding& l, const Holding& r) {
+  return l.price > r.price;
+}
+
+// a bidder's bid in a round, over no arc if it doesn't bid
+struct Bid {
+  int arc;
+  double qty;
+  double price;
+};
+
+// The auction of a transportation problem, in flow units. Bidders are
+// request groups and sellers are supply groups.
+class Auction {
+ public:
+  Auction(int nbidders, int nsellers, int narcs, int nthreads,
+          TaskScheduler* sched)
+      : nthreads(nthreads),
+        sched(sched),
+        demand(nbidders, 0),
+        arc_start(nbidders + 1, 0),
+        cap(nsellers, kInf),
+        benefit(narcs, 0),
+        arc_cap(narcs, 0),
+        arc_seller(narcs, -1),
+        unmet(nbidders, 0),
+        bids(nbidders),
+        held(narcs, 0),
+        holdings(nsellers),
+        load(nsellers, 0),
+        floor(nsellers, 0),
+        price(nsellers, 0),
+        bidders(nsellers),
+        rejects(nsellers) {}
+
+  // updates the price of a seller's supply, which is that of its cheapest
+  // holding once it is sold out
+  inline void Reprice(int s) {
+    if (!Full(s)) {
+      price[s] = floor[s];
+    } else {
+      price[s] = holdings[s].empty() ? kInf : holdings[s].back().price;
+    }
+  }
+
+  inline bool Full(int s) const {
+    return cap[s] - load[s] <= kTol * cap[s];
+  }
+
+  // starts a new auction with epsilon eps from the prices of the last one,
+  // where sellers that didn't sell out start over from zero
+  void Reset(double eps) {
+    this->eps = eps;
+    for (int s = 0; s != cap.size(); s++) {
+      floor[s] = Full(s) ? price[s] : 0;
+      holdings[s].clear();
+      load[s] = 0;
+      Reprice(s);
+    }
+    std::fill(held.begin(), held.end(), 0);
+    unmet = demand;
+  }
+
+  // runs bidding rounds until no bidder bids or max_rounds have been run,
+  // and returns the number of rounds run. Since prices only rise during an
+  // auction, only the bidders that bid or were outbid in a round can bid in
+  // the next.
+  int Run(int max_rounds) {
+    int nbidders = demand.size();
+    std::vector<int> active(nbidders);
+    for (int b = 0; b != nbidders; b++) {
+      active[b] = b;
+    }
+    std::vector<char> queued(nbidders, 0);
+    std::vector<int> next;
+    std::vector<int> sellers;
+    int rounds = 0;
+    for (; rounds < max_rounds && !active.empty(); rounds++) {
+      ParallelFor(sched, active.size(), nthreads, [this, &active](int begin,
+                                                                   int end) {
+        for (int i = begin; i != end; i++) {
+          MakeBid(active[i]);
+        }
+      });
+
+      next.clear();
+      sellers.clear();
+      for (int i = 0; i != active.size(); i++) {
+        int b = active[i];
+        if (bids[b].arc < 0)
+          continue;
+        int s = arc_seller[bids[b].arc];
+        if (bidders[s].empty())
+          sellers.push_back(s);
+        bidders[s].push_back(b);
+        queued[b] = 1;
+        next.push_back(b);
+      }
+      if (sellers.empty())
+        break;
+
+      ParallelFor(sched, sellers.size(), nthreads, [this, &sellers](int begin,
+                                                                    int end) {
+        for (int i = begin; i != end; i++) {
+          Sell(sellers[i]);
+        }
+      });
+      for (int i = 0; i != sellers.size(); i++) {
+        int s = sellers[i];
+        for (int j = 0; j != rejects[s].size(); j++) {
+          int b = rejects[s][j].first;
+          unmet[b] += rejects[s][j].second;
+          if (!queued[b]) {
+            queued[b] = 1;
+            next.push_back(b);
+          }
+        }
+        rejects[s].clear();
+        bidders[s].clear();
+      }
+      for (int i = 0; i != next.size(); i++) {
+        queued[next[i]] = 0;
+      }
+      active.swap(next);
+    }
+    return rounds;
+  }
+
+  // lowers the prices of sellers that haven't sold out to zero, as they
+  // would be in an exact solution, and returns whether any were lowered.
+  // Bidders that would now rather buy elsewhere give up their holdings.
+  bool ReleaseUnsold() {
+    bool lowered = false;
+    for (int s = 0; s != cap.size(); s++) {
+      if (!Full(s) && floor[s] > 0) {
+        floor[s] = 0;
+        price[s] = 0;
+        lowered = true;
+      }
+    }
+    if (!lowered)
+      return false;
+
+    int nbidders = demand.size();
+    std::vector<double> best(nbidders, 0);
+    for (int b = 0; b != nbidders; b++) {
+      for (int i = arc_start[b]; i != arc_start[b + 1]; i++) {
+        int a = arcs[i];
+        if (arc_cap[a] - held[a] > kTol * arc_cap[a])
+          best[b] = std::max(best[b], benefit[a] - price[arc_seller[a]]);
+      }
+    }
+    for (int s = 0; s != cap.size(); s++) {
+      std::vector<Holding>& h = holdings[s];
+      int kept = 0;
+      for (int i = 0; i != h.size(); i++) {
+        if (best[h[i].bidder] - (benefit[h[i].arc] - price[s]) > eps) {
+          unmet[h[i].bidder] += h[i].qty;
+          held[h[i].arc] -= h[i].qty;
+          load[s] -= h[i].qty;
+        } else {
+          h[kept++] = h[i];
+        }
+      }
+      h.resize(kept);
+    }
+    for (int s = 0; s != cap.size(); s++) {
+      Reprice(s);
+    }
+    return true;
+  }
+
+  int nthreads;
+  TaskScheduler* sched;
+  double eps;
+
+  // the problem: each bidder's demand and arcs, in CSR form, each seller's
+  // capacity, and each arc's benefit over leaving demand unmet, capacity,
+  // and seller
+  std::vector<double> demand;
+  std::vector<int> arc_start;
+  std::vector<int> arcs;
+  std::vector<double> cap;
+  std::vector<double> benefit;
+  std::vector<double> arc_cap;
+  std::vector<int> arc_seller;
+
+  // the state of the auction
+  std::vector<double> unmet;
+  std::vector<Bid> bids;
+  std::vector<double> held;
+  std::vector<std::vector<Holding> > holdings;
+  std::vector<double> load;
+  std::vector<double> floor;
+  std::vector<double> price;
+  std::vector<std::vector<int> > bidders;
+  std::vector<std::vector<std::pair<int, double> > > rejects;
+
+ private:
+  // bids for bidder b's most profitable arc, if any is profitable, at a
+  // price that leaves it just as profitable as the next best option
+  void MakeBid(int b) {
+    Bid& bid = bids[b];
+    bid.arc = -1;
+    if (unmet[b] <= kTol * demand[b])
+      return;
+    double best = 0;
+    double second = 0;  // leaving the demand unmet
+    for (int i = arc_start[b]; i != arc_start[b + 1]; i++) {
+      int a = arcs[i];
+      if (arc_cap[a] - held[a] <= kTol * arc_cap[a])
+        continue;
+      double profit = benefit[a] - price[arc_seller[a]];
+      if (profit > best) {
+        second = best;
+        best = profit;
+        bid.arc = a;
+      } else if (profit > second) {
+        second = profit;
+      }
+    }
+    if (bid.arc < 0)
+      return;
+    bid.qty = std::min(unmet[b], arc_cap[bid.arc] - held[bid.arc]);
+    bid.price = price[arc_seller[bid.arc]] + best - second + eps;
+    unmet[b] -= bid.qty;
+  }
+
+  // accepts the highest bids of seller s's holdings and this round's bids,
+  // up to its capacity, and rejects the rest
+  void Sell(int s) {
+    std::vector<Holding>& h = holdings[s];
+    for (int i = 0; i != bidders[s].size(); i++) {
+      int b = bidders[s][i];
+      Holding hold = {b, bids[b].arc, bids[b].qty, bids[b].price};
+      h.push_back(hold);
+      held[hold.arc] += hold.qty;
+    }
+    // earlier holdings keep their supply over bids at the same price
+    std::stable_sort(h.begin(), h.end(), HigherPrice);
+    double sold = 0;
+    int i = 0;
+    for (; i != h.size() && sold < cap[s]; i++) {
+      double rest = cap[s] - sold;
+      if (h[i].qty > rest) {
+        rejects[s].push_back(std::make_pair(h[i].bidder, h[i].qty - rest));
+        held[h[i].arc] -= h[i].qty - rest;
+        h[i].qty = rest;
+      }
+      sold += h[i].qty;
+    }
+    for (int j = i; j != h.size(); j++) {
+      rejects[s].push_back(std::make_pair(h[j].bidder, h[j].qty));
+      held[h[j].arc] -= h[j].qty;
+    }
+    h.resize(i);
+    load[s] = sold;
+    Reprice(s);
+  }
+};
+
+}  // namespace
+
+AuctionSolver::AuctionSolver(bool exclusive_orders, double gap,
+                             ExchangeSolver* fallback)
+    : ExchangeSolver(exclusive_orders),
+      gap_(gap),
+      fallback_(fallback),
+      rounds_(0) {
+  if (gap <= 0) {
+    std::stringstream ss;
+    ss << "the optimality gap of the auction solver must be positive, got "
+       << gap;
+    throw ValueError(ss.str());
+  }
+}
+
+AuctionSolver::~AuctionSolver() {
+  delete fallback_;
+}
+
+ExchangeSolver* AuctionSolver::Clone() {
+  ExchangeSolver* fallback = NULL;
+  if (fallback_ != NULL) {
+    fallback = fallback_->Clone();
+    if (fallback == NULL)
+      return NULL;
+  }
+  AuctionSolver* s = new AuctionSolver(exclusive_orders_, gap_, fallback);
+  s->verbose_ = verbose_;
+  s->threads_ = threads_;
+  return s;
+}
+
+double AuctionSolver::SolveGraph() {
+  rounds_ = 0;
+  std::vector<double> group_ucap;
+  if (!IsTransportation(graph_, exclusive_orders_, &group_ucap)) {
+    if (fallback_ == NULL) {
+      throw ValueError("the exchange is not a transportation problem and the "
+                       "auction solver has no fallback");
+    }
+    CLOG(LEV_DEBUG1) << "Exchange is not a transportation problem, handing "
+                     << "it to the fallback solver.";
+    return SolveGraphWith(fallback_);
+  }
+
+  const FlatExchangeGraph& f = graph_->flat();
+  std::vector<Arc>& arcs = graph_->arcs();
+  int ngroups = f.groups.size();
+  int nrequests = graph_->request_groups().size();
+  double pseudo_cost = PseudoCost();
+
+  // number the request groups with demand as bidders and the supply groups
+  // as sellers
+  std::vector<int> number(ngroups, -1);
+  int nbidders = 0;
+  int nsellers = 0;
+  for (int g = 0; g != ngroups; g++) {
+    if (g >= nrequests) {
+      number[g] = nsellers++;
+    } else if (!f.groups[g]->capacities().empty() &&
+               f.groups[g]->HasArcs()) {
+      number[g] = nbidders++;
+    }
+  }
+
+  // solvers without a simulation only start threads for auctions large
+  // enough to split
+  int narcs = arcs.size();
+  TaskScheduler* sched = sim_ctx() != NULL ? sim_ctx()->scheduler() : NULL;
+  std::unique_ptr<TaskScheduler> own;
+  if (sched == NULL) {
+    bool split = std::max(nbidders, nsellers) >= 2 * kMinPerThread;
+    own.reset(new TaskScheduler(split ? threads() : 1));
+    sched = own.get();
+  }
+  Auction auc(nbidders, nsellers, narcs, threads(), sched);
+  std::vector<double> cost(narcs, 0);
+  std::vector<double> unmet_cost(nbidders, 0);
+  for (int g = 0; g != ngroups; g++) {
+    if (number[g] < 0)
+      continue;
+    const std::vector<double>& caps = f.groups[g]->capacities();
+    if (g >= nrequests) {
+      if (!caps.empty())
+        auc.cap[number[g]] = caps[0] / group_ucap[g];
+    } else {
+      auc.demand[number[g]] = std::min(caps[0], kMaxCap) / group_ucap[g];
+      unmet_cost[number[g]] = pseudo_cost * group_ucap[g];
+    }
+  }
+
+  // the arcs of each bidder that are cheaper than leaving demand unmet
+  std::vector<int> bidder(narcs, -1);
+  double max_benefit = 0;
+  double min_cost = kInf;
+  for (int a = 0; a != narcs; a++) {
+    int ug = f.node_group[f.arc_unode[a]];
+    int vg = f.node_group[f.arc_vnode[a]];
+    if (ug < 0 || vg < 0 || ug >= nrequests || number[ug] < 0)
+      continue;
+    double pref = f.arc_pref[a];
+    if (pref <= 0) {
+      std::stringstream ss;
+      ss << "Preference value found to be nonpositive (" << pref
+         << "). Preferences must be positive when using an optimization "
+         << "solver.";
+      throw ValueError(ss.str());
+    }
+    cost[a] = ExchangeSolver::Cost(arcs[a], exclusive_orders_);
+    double benefit = unmet_cost[number[ug]] - cost[a];
+    if (benefit <= 0)
+      continue;
+    bidder[a] = number[ug];
+    auc.benefit[a] = benefit;
+    auc.arc_cap[a] = f.node_qty[f.arc_unode[a]];
+    auc.arc_seller[a] = number[vg];
+    auc.arc_start[bidder[a] + 1]++;
+    max_benefit = std::max(max_benefit, benefit);
+    min_cost = std::min(min_cost, cost[a]);
+  }
+  for (int b = 0; b != nbidders; b++) {
+    auc.arc_start[b + 1] += auc.arc_start[b];
+  }
+  auc.arcs.resize(auc.arc_start[nbidders]);
+  std::vector<int> next(auc.arc_start.begin(), auc.arc_start.end() - 1);
+  for (int a = 0; a != narcs; a++) {
+    if (bidder[a] >= 0)
+      auc.arcs[next[bidder[a]]++] = a;
+  }
+
+  if (!auc.arcs.empty()) {
+    // scale epsilon down to the one that bounds the gap
+    double final_eps = gap_ * min_cost;
+    double eps = std::max(final_eps, max_benefit / kEpsFactor);
+    int max_rounds = kMaxRoundsPerArc * (auc.arcs.size() + nsellers);
+    while (true) {
+      auc.Reset(eps);
+      int n = auc.Run(max_rounds);
+      rounds_ += n;
+      // settle the prices of unsold supply at each epsilon, rather than
+      // raising them back from zero by the last one
+      while (n < max_rounds && auc.ReleaseUnsold()) {
+        n = auc.Run(max_rounds);
+        rounds_ += n;
+      }
+      if (n >= max_rounds) {
+        CLOG(LEV_WARN) << "The exchange auction did not converge in "
+                       << max_rounds << " rounds, its solution may be "
+                       << "further from optimal than the gap.";
+      }
+      if (eps <= final_eps || n >= max_rounds)
+        break;
+      eps = std::max(final_eps, eps / kEpsFactor);
+    }
+  }
+
+  double obj = 0;
+  for (int a = 0; a != narcs; a++) {
+    if (bidder[a] < 0)
+      continue;
+    obj += cost[a] * auc.held[a];
+    if (auc.held[a] > eps())
+      graph_->AddMatch(arcs[a], auc.held[a]);
+  }
+  for (int b = 0; b != nbidders; b++) {
+    obj += unmet_cost[b] * auc.unmet[b];
+  }
+  if (verbose_) {
+    CLOG(LEV_INFO1) << "Auction exchange objective: " << obj << " after "
+                    << rounds_ << " bidding rounds.";
+  }
+  return obj;
+}
+
+}  // namespace cyclus
@@ -0,0 +1,63 @@
+#ifndef CYCLUS_SRC_AUCTION_SOLVER_H_
+#define CYCLUS_SRC_AUCTION_SOLVER_H_
+
+#include <vector>
+
+#include "exchange_solver.h"
+
+namespace cyclus {
+
+/// @brief The AuctionSolver finds near optimal solutions of resource
+/// exchanges that are transportation problems (see IsTransportation) with a
+/// parallel auction, for exchanges too large to solve exactly every time
+/// step, and hands every other exchange to a fallback solver.
+///
+/// Request groups bid for the supply of supply groups in rounds, each
+/// offering to pay a price a little above the supply group's current price
+/// for the arc that is worth the most to it, i.e., whose cost is furthest
+/// below the pseudo cost of leaving its demand unmet (see
+/// ExchangeSolver::PseudoCost). Supply groups accept the highest bids up to
+/// their capacity, outbidding earlier ones, which raises their prices, until
+/// no request group with unmet demand can make a worthwhile bid. Bids are
+/// made and accepted concurrently, on as many threads as the solver has (see
+/// ExchangeSolver::threads), if the exchange is large enough.
+///
+/// Prices rise by at least epsilon with each bid, which is scaled down from
+/// a large value over several auctions, each starting from the prices of the
+/// last, so that early auctions settle prices coarsely and quickly. The last
+/// auction's epsilon bounds the cost of the solution to within gap times the
+/// cost of its flow above the optimal cost.
+class AuctionSolver : public ExchangeSolver {
+ public:
+  /// the default relative optimality gap
+  static const double kDefaultGap;
+
+  /// @param exclusive_orders whether exclusive orders are enforced
+  /// @param gap the relative optimality gap, which must be positive
+  /// @param fallback the solver of graphs that are not transportation
+  /// problems, which the AuctionSolver deletes, or NULL to throw a
+  /// ValueError for them instead
+  AuctionSolver(bool exclusive_orders, double gap, ExchangeSolver* fallback);
+  virtual ~AuctionSolver();
+
+  /// @brief returns a new solver with the same configuration and a copy of
+  /// the fallback, or NULL if the fallback cannot be copied
+  virtual ExchangeSolver* Clone();
+
+  inline double gap() const { return gap_; }
+
+  /// @brief the number of bidding rounds of the last graph solved
+  inline int rounds() const { return rounds_; }
+
+ protected:
+  virtual double SolveGraph();
+
+ private:
+  double gap_;
+  ExchangeSolver* fallback_;
+  int rounds_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_AUCTION_SOLVER_H_
@@ -5,6 +5,7 @@
 #include <boost/weak_ptr.hpp>
 #include <limits>
 
+#include "block_pool.h"
 #include "request.h"
 
 namespace cyclus {
@@ -19,6 +20,19 @@ template <class T> class BidPortfolio;
 /// bidder.
 template <class T> class Bid {
  public:
+  /// Bids are allocated from the exchange's block pool (see
+  /// BlockPool::Exchange).
+  /// @{
+  static void* operator new(std::size_t size) {
+    return BlockPool::Exchange()->Alloc(size);
+  }
+  static void operator delete(void* p, std::size_t size) {
+    if (p != NULL) {
+      BlockPool::Exchange()->Free(p, size);
+    }
+  }
+  /// @}
+
   /// @brief a factory method for a bid
   /// @param request the request being responded to by this bid
   /// @param offer the resource being offered in response to the request
@@ -31,8 +45,7 @@ template <class T> class Bid {
   ///        requests callback cost function. Bidders should not
   ///        arbitrarily set this preference.
   inline static Bid<T>* Create(Request<T>* request,
-                               boost::shared_ptr<T>
-                                   offer,
+                               typename T::Ptr offer,
                                Trader* bidder,
                                typename BidPortfolio<T>::Ptr portfolio,
                                bool exclusive,
@@ -47,8 +60,7 @@ template <class T> class Bid {
   /// @param portfolio the porftolio of which this bid is a part
   /// @param exclusive flag for whether the bid is exclusive
   inline static Bid<T>* Create(Request<T>* request,
-                               boost::shared_ptr<T>
-                                   offer,
+                               typename T::Ptr offer,
                                Trader* bidder,
                                typename BidPortfolio<T>::Ptr portfolio,
                                bool exclusive = false) {
@@ -57,14 +69,14 @@ template <class T> class Bid {
   }
   /// @brief a factory method for a bid for a bid without a portfolio
   /// @warning this factory should generally only be used for testing
-  inline static Bid<T>* Create(Request<T>* request, boost::shared_ptr<T> offer,
+  inline static Bid<T>* Create(Request<T>* request, typename T::Ptr offer,
                                Trader* bidder, bool exclusive,
                                double preference) {
     return new Bid<T>(request, offer, bidder, exclusive, preference);
   }
   /// @brief a factory method for a bid for a bid without a portfolio
   /// @warning this factory should generally only be used for testing
-  inline static Bid<T>* Create(Request<T>* request, boost::shared_ptr<T> offer,
+  inline static Bid<T>* Create(Request<T>* request, typename T::Ptr offer,
                                Trader* bidder, bool exclusive = false) {
     return Create(request, offer, bidder, exclusive,
                   std::numeric_limits<double>::quiet_NaN());
@@ -74,7 +86,7 @@ template <class T> class Bid {
   inline Request<T>* request() const { return request_; }
 
   /// @return the bid object for the request
-  inline boost::shared_ptr<T> offer() const { return offer_; }
+  inline typename T::Ptr offer() const { return offer_; }
 
   /// @return the agent responding the request
   inline Trader* bidder() const { return bidder_; }
@@ -90,7 +102,7 @@ template <class T> class Bid {
 
  private:
   /// @brief constructors are private to require use of factory methods
-  Bid(Request<T>* request, boost::shared_ptr<T> offer, Trader* bidder,
+  Bid(Request<T>* request, typename T::Ptr offer, Trader* bidder,
       bool exclusive, double preference)
       : request_(request),
         offer_(offer),
@@ -98,7 +110,7 @@ template <class T> class Bid {
         exclusive_(exclusive),
         preference_(preference) {}
   /// @brief constructors are private to require use of factory methods
-  Bid(Request<T>* request, boost::shared_ptr<T> offer, Trader* bidder,
+  Bid(Request<T>* request, typename T::Ptr offer, Trader* bidder,
       bool exclusive = false)
       : request_(request),
         offer_(offer),
@@ -106,7 +118,7 @@ template <class T> class Bid {
         exclusive_(exclusive),
         preference_(std::numeric_limits<double>::quiet_NaN()) {}
 
-  Bid(Request<T>* request, boost::shared_ptr<T> offer, Trader* bidder,
+  Bid(Request<T>* request, typename T::Ptr offer, Trader* bidder,
       typename BidPortfolio<T>::Ptr portfolio, bool exclusive, double preference)
       : request_(request),
         offer_(offer),
@@ -115,7 +127,7 @@ template <class T> class Bid {
         exclusive_(exclusive),
         preference_(preference) {}
 
-  Bid(Request<T>* request, boost::shared_ptr<T> offer, Trader* bidder,
+  Bid(Request<T>* request, typename T::Ptr offer, Trader* bidder,
       typename BidPortfolio<T>::Ptr portfolio, bool exclusive = false)
       : request_(request),
         offer_(offer),
@@ -125,7 +137,7 @@ template <class T> class Bid {
         preference_(std::numeric_limits<double>::quiet_NaN()) {}
 
   Request<T>* request_;
-  boost::shared_ptr<T> offer_;
+  typename T::Ptr offer_;
   Trader* bidder_;
   boost::weak_ptr<BidPortfolio<T>> portfolio_;
   bool exclusive_;
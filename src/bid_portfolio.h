@@ -7,6 +7,7 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include "block_pool.h"
 #include "bid.h"
 #include "capacity_constraint.h"
 #include "error.h"
@@ -33,6 +34,19 @@ class BidPortfolio : public boost::enable_shared_from_this<BidPortfolio<T>> {
  public:
   typedef boost::shared_ptr<BidPortfolio<T>> Ptr;
 
+  /// Portfolios are allocated from the exchange's block pool (see
+  /// BlockPool::Exchange).
+  /// @{
+  static void* operator new(std::size_t size) {
+    return BlockPool::Exchange()->Alloc(size);
+  }
+  static void operator delete(void* p, std::size_t size) {
+    if (p != NULL) {
+      BlockPool::Exchange()->Free(p, size);
+    }
+  }
+  /// @}
+
   /// @brief default constructor
   BidPortfolio() : bidder_(NULL) {}
 
@@ -53,7 +67,7 @@ class BidPortfolio : public boost::enable_shared_from_this<BidPortfolio<T>> {
   ///        bid arc.
   /// @throws KeyError if a bid is added from a different bidder than the
   /// original
-  Bid<T>* AddBid(Request<T>* request, boost::shared_ptr<T> offer,
+  Bid<T>* AddBid(Request<T>* request, typename T::Ptr offer,
                  Trader* bidder, bool exclusive, double preference) {
     Bid<T>* b = Bid<T>::Create(request, offer, bidder, this->shared_from_this(),
                                exclusive, preference);
@@ -76,7 +90,7 @@ class BidPortfolio : public boost::enable_shared_from_this<BidPortfolio<T>> {
   /// @param exclusive indicates whether the bid is exclusive
   /// @throws KeyError if a bid is added from a different bidder than the
   /// original
-  Bid<T>* AddBid(Request<T>* request, boost::shared_ptr<T> offer,
+  Bid<T>* AddBid(Request<T>* request, typename T::Ptr offer,
                  Trader* bidder, bool exclusive = false) {
     return AddBid(request, offer, bidder, exclusive,
                   std::numeric_limits<double>::quiet_NaN());
@@ -0,0 +1,218 @@
+#ifndef CYCLUS_SRC_BINARY_STATE_H_
+#define CYCLUS_SRC_BINARY_STATE_H_
+
+#include <cstring>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/uuid/uuid.hpp>
+
+#include "blob.h"
+#include "error.h"
+
+namespace cyclus {
+
+/// Appends values to a buffer in a compact binary form, which BinaryReader
+/// reads back. Fixed size values are stored as they are in memory, i.e., in
+/// the byte order of the machine, and strings and containers are prefixed
+/// with their sizes. Nothing describes the values, so they must be read in
+/// the order and with the types they were written in. This is the form of
+/// state images (see StateImageWriter) and of the state written by
+/// Agent::SnapshotBinary.
+///
+/// Values of the primitive types that the database supports, i.e., int,
+/// bool, float, double, std::string, boost::uuids::uuid, and Blob, and of
+/// vectors, sets, lists, pairs, and maps of them, nested to any depth, can be
+/// written.
+class BinaryWriter {
+ public:
+  explicit BinaryWriter(std::string* buf) : buf_(buf) {}
+
+  /// Appends the bytes of v as they are in memory.
+  template <class T>
+  void PutRaw(T v) {
+    buf_->append(reinterpret_cast<const char*>(&v), sizeof(T));
+  }
+
+  void Put(int v) { PutRaw<boost::int32_t>(v); }
+  void Put(bool v) { PutRaw<boost::uint8_t>(v); }
+  void Put(double v) { PutRaw<double>(v); }
+  void Put(float v) { PutRaw<float>(v); }
+
+  void Put(const std::string& v) {
+    PutRaw<boost::uint32_t>(v.size());
+    buf_->append(v);
+  }
+
+  void Put(const boost::uuids::uuid& v) {
+    buf_->append(reinterpret_cast<const char*>(v.data), v.size());
+  }
+
+  void Put(const Blob& v) { Put(v.str()); }
+
+  template <class T>
+  void Put(const std::vector<T>& v) { PutSeq(v); }
+
+  template <class T>
+  void Put(const std::set<T>& v) { PutSeq(v); }
+
+  template <class T>
+  void Put(const std::list<T>& v) { PutSeq(v); }
+
+  template <class K, class V>
+  void Put(const std::pair<K, V>& v) {
+    Put(v.first);
+    Put(v.second);
+  }
+
+  template <class K, class V>
+  void Put(const std::map<K, V>& v) {
+    PutRaw<boost::uint32_t>(v.size());
+    typename std::map<K, V>::const_iterator it;
+    for (it = v.begin(); it != v.end(); ++it) {
+      Put(it->first);
+      Put(it->second);
+    }
+  }
+
+ private:
+  template <class C>
+  void PutSeq(const C& v) {
+    PutRaw<boost::uint32_t>(v.size());
+    typename C::const_iterator it;
+    for (it = v.begin(); it != v.end(); ++it) {
+      // a reference to the element, or to a copy of a std::vector<bool> bit
+      const typename C::value_type& x = *it;
+      Put(x);
+    }
+  }
+
+  std::string* buf_;
+};
+
+/// Reads values written by a BinaryWriter from a span of memory, which need
+/// not be aligned, e.g., a record of a mapped state image. Containers are
+/// emptied before they are read into.
+class BinaryReader {
+ public:
+  BinaryReader(const char* begin, const char* end) : p_(begin), end_(end) {}
+
+  /// Reads a value written by BinaryWriter::PutRaw.
+  /// @throws IOError if the span ends before the value
+  template <class T>
+  T GetRaw() {
+    Need(sizeof(T));
+    T v;
+    std::memcpy(&v, p_, sizeof(T));
+    p_ += sizeof(T);
+    return v;
+  }
+
+  /// Skips over the next n bytes, returning where they start.
+  /// @throws IOError if the span ends before them
+  const char* Skip(std::size_t n) {
+    Need(n);
+    const char* p = p_;
+    p_ += n;
+    return p;
+  }
+
+  /// Whether the whole span has been read.
+  inline bool done() const { return p_ == end_; }
+
+  void Get(int* v) { *v = GetRaw<boost::int32_t>(); }
+  void Get(bool* v) { *v = GetRaw<boost::uint8_t>() != 0; }
+  void Get(double* v) { *v = GetRaw<double>(); }
+  void Get(float* v) { *v = GetRaw<float>(); }
+
+  void Get(std::string* v) {
+    boost::uint32_t n = GetRaw<boost::uint32_t>();
+    v->assign(Skip(n), n);
+  }
+
+  void Get(boost::uuids::uuid* v) {
+    std::memcpy(v->data, Skip(v->size()), v->size());
+  }
+
+  void Get(Blob* v) {
+    std::string s;
+    Get(&s);
+    *v = Blob(s);
+  }
+
+  template <class T>
+  void Get(std::vector<T>* v) {
+    boost::uint32_t n = GetRaw<boost::uint32_t>();
+    v->clear();
+    v->resize(n);
+    for (boost::uint32_t i = 0; i < n; ++i) {
+      Get(&(*v)[i]);
+    }
+  }
+
+  void Get(std::vector<bool>* v) {
+    boost::uint32_t n = GetRaw<boost::uint32_t>();
+    v->clear();
+    v->reserve(n);
+    for (boost::uint32_t i = 0; i < n; ++i) {
+      v->push_back(GetRaw<boost::uint8_t>() != 0);
+    }
+  }
+
+  template <class T>
+  void Get(std::set<T>* v) {
+    boost::uint32_t n = GetRaw<boost::uint32_t>();
+    v->clear();
+    for (boost::uint32_t i = 0; i < n; ++i) {
+      T x;
+      Get(&x);
+      v->insert(v->end(), x);
+    }
+  }
+
+  template <class T>
+  void Get(std::list<T>* v) {
+    boost::uint32_t n = GetRaw<boost::uint32_t>();
+    v->clear();
+    for (boost::uint32_t i = 0; i < n; ++i) {
+      v->push_back(T());
+      Get(&v->back());
+    }
+  }
+
+  template <class K, class V>
+  void Get(std::pair<K, V>* v) {
+    Get(&v->first);
+    Get(&v->second);
+  }
+
+  template <class K, class V>
+  void Get(std::map<K, V>* v) {
+    boost::uint32_t n = GetRaw<boost::uint32_t>();
+    v->clear();
+    for (boost::uint32_t i = 0; i < n; ++i) {
+      K k;
+      Get(&k);
+      Get(&(*v)[k]);
+    }
+  }
+
+ private:
+  void Need(std::size_t n) {
+    if (static_cast<std::size_t>(end_ - p_) < n) {
+      throw IOError("binary state is truncated");
+    }
+  }
+
+  const char* p_;
+  const char* end_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_BINARY_STATE_H_
@@ -0,0 +1,64 @@
+#include "block_pool.h"
+
+#include <new>
+
+#include "env.h"
+
+namespace cyclus {
+
+BlockPool::BlockPool(const std::string& disable_env, int chunk_blocks)
+    : enabled_(Env::GetEnv(disable_env).empty()),
+      chunk_blocks_(chunk_blocks) {}
+
+void* BlockPool::Alloc(std::size_t size) {
+  if (!enabled_) {
+    return ::operator new(size);
+  }
+  size = BlockSize(size);
+  std::lock_guard<std::mutex> lock(mu_);
+  std::vector<void*>& blocks = free_[size];
+  if (blocks.empty()) {
+    // the blocks are handed out from the start of the chunk first
+    char* chunk = static_cast<char*>(::operator new(size * chunk_blocks_));
+    for (int i = chunk_blocks_ - 1; i >= 0; i--) {
+      blocks.push_back(chunk + i * size);
+    }
+  }
+  void* p = blocks.back();
+  blocks.pop_back();
+  return p;
+}
+
+void BlockPool::Free(void* p, std::size_t size) {
+  if (!enabled_) {
+    ::operator delete(p);
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mu_);
+  free_[BlockSize(size)].push_back(p);
+}
+
+std::size_t BlockPool::BlockSize(std::size_t size) {
+  const std::size_t align = alignof(std::max_align_t);
+  return (size + align - 1) / align * align;
+}
+
+// The pools are created on first use and never destroyed, so that objects
+// deleted during static destruction can still be returned to them.
+
+BlockPool* BlockPool::Agents() {
+  static BlockPool* pool = new BlockPool("CYCLUS_NO_AGENT_POOL", 32);
+  return pool;
+}
+
+BlockPool* BlockPool::Exchange() {
+  static BlockPool* pool = new BlockPool("CYCLUS_NO_EXCHANGE_POOL", 256);
+  return pool;
+}
+
+BlockPool* BlockPool::Resources() {
+  static BlockPool* pool = new BlockPool("CYCLUS_NO_RESOURCE_POOL", 256);
+  return pool;
+}
+
+}  // namespace cyclus
@@ -0,0 +1,64 @@
+#ifndef CYCLUS_SRC_BLOCK_POOL_H_
+#define CYCLUS_SRC_BLOCK_POOL_H_
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cyclus {
+
+/// Free lists of same-sized blocks, keyed by block size, for classes whose
+/// objects are made and destroyed in bulk to allocate from through their own
+/// operator new and operator delete. Blocks are carved out of chunks of many
+/// blocks at a time, so that objects made together sit next to each other in
+/// memory, and freed blocks are kept for the next objects of the same size
+/// rather than returned to the general heap. Pools are safe to use from many
+/// threads at once.
+class BlockPool {
+ public:
+  /// @param disable_env an environment variable that, when set, allocates
+  /// every block from the general heap instead, e.g. for memory checkers
+  /// @param chunk_blocks the number of blocks carved out of each chunk
+  BlockPool(const std::string& disable_env, int chunk_blocks);
+
+  /// Returns a block of at least size bytes, maximally aligned.
+  void* Alloc(std::size_t size);
+
+  /// Returns the block p, allocated with Alloc(size), to the pool.
+  void Free(void* p, std::size_t size);
+
+  /// Returns false if the pool hands every allocation to the general heap.
+  bool enabled() const { return enabled_; }
+
+  /// Returns the pool that agents are allocated from (see
+  /// Agent::operator new). Setting CYCLUS_NO_AGENT_POOL disables it.
+  static BlockPool* Agents();
+
+  /// Returns the pool that the objects made anew in every resource exchange
+  /// are allocated from: requests, bids, their portfolios, and the nodes of
+  /// the exchange graph. Since all of them are destroyed once the exchange
+  /// is done, each exchange reuses the blocks of the one before, like an
+  /// arena reset every time step. Setting CYCLUS_NO_EXCHANGE_POOL disables
+  /// it.
+  static BlockPool* Exchange();
+
+  /// Returns the pool that materials are allocated from (see
+  /// Material::operator new), which are split, combined, and traded by the
+  /// thousands every time step. Setting CYCLUS_NO_RESOURCE_POOL disables it.
+  static BlockPool* Resources();
+
+ private:
+  /// rounds size up so that every block is maximally aligned.
+  static std::size_t BlockSize(std::size_t size);
+
+  bool enabled_;
+  int chunk_blocks_;
+  std::mutex mu_;
+  std::unordered_map<std::size_t, std::vector<void*> > free_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_BLOCK_POOL_H_
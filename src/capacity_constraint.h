@@ -1,6 +1,8 @@
 #ifndef CYCLUS_SRC_CAPACITY_CONSTRAINT_H_
 #define CYCLUS_SRC_CAPACITY_CONSTRAINT_H_
 
+#include <atomic>
+
 #include <boost/shared_ptr.hpp>
 
 #include "error.h"
@@ -23,10 +25,19 @@ struct Converter {
   ///
   /// @warning it is up to the user to inherit default parameters
   virtual double convert(
-      boost::shared_ptr<T> offer,
+      typename T::Ptr offer,
       Arc const * a = NULL,
       ExchangeTranslationContext<T> const * ctx = NULL) const = 0;
 
+  /// @brief whether convert depends on nothing but the offer, i.e., neither
+  /// on the arc nor on the exchange context. The conversions of such
+  /// converters are computed once per offered resource object and reused for
+  /// every arc of an exchange (see TranslateCapacities), which pays off for
+  /// converters that do costly composition math. Defaults to false.
+  virtual bool offer_only() const {
+    return false;
+  }
+
   /// @brief operator== is available for subclassing, see
   /// cyclus::TrivialConverter for an example
   virtual bool operator==(Converter& other) const {
@@ -44,7 +55,7 @@ template<class T>
 struct TrivialConverter : public Converter<T> {
   /// @returns the quantity of resource offer
   inline virtual double convert(
-      boost::shared_ptr<T> offer,
+      typename T::Ptr offer,
       Arc const * a = NULL,
       ExchangeTranslationContext<T> const * ctx = NULL) const  {
     return offer->quantity();
@@ -99,7 +110,7 @@ class CapacityConstraint {
   }
 
   inline double convert(
-      boost::shared_ptr<T> offer,
+      typename T::Ptr offer,
       Arc const * a = NULL,
       ExchangeTranslationContext<T> const * ctx = NULL) const {
     return converter_->convert(offer, a, ctx);
@@ -114,10 +125,10 @@ class CapacityConstraint {
   double capacity_;
   typename Converter<T>::Ptr converter_;
   int id_;
-  static int next_id_;
+  static std::atomic<int> next_id_;
 };
 
-template<class T> int CapacityConstraint<T>::next_id_ = 0;
+template<class T> std::atomic<int> CapacityConstraint<T>::next_id_(0);
 
 /// @brief CapacityConstraint-CapacityConstraint equality operator
 template<class T>
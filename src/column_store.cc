@@ -0,0 +1,130 @@
+#include "column_store.h"
+
+#include <stdint.h>
+#include <cstring>
+#include <typeinfo>
+
+#include "error.h"
+
+namespace cyclus {
+
+ColumnStore::Column::Column(const std::string& name,
+                            const boost::spirit::hold_any& v)
+    : name_(name),
+      type_(BLOB),
+      itemsize_(0) {
+  const std::type_info& t = v.type();
+  if (t == typeid(bool)) {
+    type_ = BOOL;
+    itemsize_ = sizeof(bool);
+  } else if (t == typeid(int)) {
+    type_ = INT;
+    itemsize_ = sizeof(int64_t);
+  } else if (t == typeid(float)) {
+    type_ = FLOAT;
+    itemsize_ = sizeof(double);
+  } else if (t == typeid(double)) {
+    type_ = DOUBLE;
+    itemsize_ = sizeof(double);
+  }
+  if (!boxed())
+    data_.reset(new std::vector<char>());
+}
+
+bool ColumnStore::Column::Matches(const boost::spirit::hold_any& v) const {
+  if (boxed())
+    return true;
+  const std::type_info& t = v.type();
+  return (type_ == BOOL && t == typeid(bool)) ||
+         (type_ == INT && t == typeid(int)) ||
+         (type_ == FLOAT && t == typeid(float)) ||
+         (type_ == DOUBLE && t == typeid(double));
+}
+
+void ColumnStore::Column::Append(const boost::spirit::hold_any& v) {
+  if (!Matches(v)) {
+    throw ValueError("value of type " + std::string(v.type().name()) +
+                     " does not match the type of column '" + name_ + "'");
+  } else if (boxed()) {
+    boxed_.push_back(v);
+    return;
+  }
+
+  bool b;
+  int64_t i;
+  double d;
+  const void* p;
+  if (type_ == BOOL) {
+    b = v.cast<bool>();
+    p = &b;
+  } else if (type_ == INT) {
+    i = v.cast<int>();
+    p = &i;
+  } else if (type_ == FLOAT) {
+    d = v.cast<float>();
+    p = &d;
+  } else {
+    d = v.cast<double>();
+    p = &d;
+  }
+
+  // buffers that have been handed out are copied rather than changed
+  if (!data_.unique())
+    data_.reset(new std::vector<char>(*data_));
+  size_t n = data_->size();
+  data_->resize(n + itemsize_);
+  std::memcpy(&(*data_)[n], p, itemsize_);
+}
+
+void ColumnStore::Notify(const DatumGroups& groups) {
+  DatumGroups::const_iterator g;
+  for (g = groups.begin(); g != groups.end(); ++g) {
+    Table& tbl = tables_[g->title()];
+    DatumGroups::Group::const_iterator it;
+    for (it = g->begin(); it != g->end(); ++it) {
+      Datum* d = *it;
+      const Datum::Vals& vals = d->vals();
+      if (tbl.empty()) {
+        for (int i = 0; i < vals.size(); ++i)
+          tbl.push_back(Column(vals[i].first, vals[i].second));
+      } else if (tbl.size() != vals.size()) {
+        throw ValueError("datum for table '" + d->title() + "' has " +
+                         "a different number of fields than the table");
+      }
+      // check the whole row first so that a bad datum is never half recorded
+      for (int i = 0; i < vals.size(); ++i) {
+        if (tbl[i].name() != vals[i].first) {
+          throw ValueError("datum for table '" + d->title() + "' has field '" +
+                           vals[i].first + "' where the table has '" +
+                           tbl[i].name() + "'");
+        } else if (!tbl[i].Matches(vals[i].second)) {
+          throw ValueError("datum for table '" + d->title() + "' has a " +
+                           "value of the wrong type for field '" +
+                           tbl[i].name() + "'");
+        }
+      }
+      for (int i = 0; i < vals.size(); ++i)
+        tbl[i].Append(vals[i].second);
+    }
+  }
+}
+
+std::set<std::string> ColumnStore::Tables() const {
+  std::set<std::string> rtn;
+  std::map<std::string, Table>::const_iterator it;
+  for (it = tables_.begin(); it != tables_.end(); ++it)
+    rtn.insert(it->first);
+  return rtn;
+}
+
+ColumnStore::Table* ColumnStore::table(const std::string& title) {
+  std::map<std::string, Table>::iterator it = tables_.find(title);
+  return it == tables_.end() ? NULL : &it->second;
+}
+
+size_t ColumnStore::nrows(const std::string& title) {
+  Table* tbl = table(title);
+  return tbl == NULL || tbl->empty() ? 0 : (*tbl)[0].size();
+}
+
+}  // namespace cyclus
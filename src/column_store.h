@@ -0,0 +1,119 @@
+#ifndef CYCLUS_SRC_COLUMN_STORE_H_
+#define CYCLUS_SRC_COLUMN_STORE_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "any.hpp"
+#include "query_backend.h"
+#include "rec_backend.h"
+
+namespace cyclus {
+
+/// An in-memory recorder backend that keeps every table column by column.
+///
+/// BOOL, INT, FLOAT, and DOUBLE columns are held in contiguous typed buffers
+/// (of bool, int64_t, and double values respectively, matching the default
+/// NumPy dtypes) so that they can be handed to other code, such as NumPy
+/// arrays, without copying. Values of every other type are kept boxed. A
+/// buffer that has been handed out is never modified: the next append to
+/// its column copies it first.
+class ColumnStore : public RecBackend {
+ public:
+  /// The values of a single column of a table.
+  class Column {
+   public:
+    typedef boost::shared_ptr<std::vector<char> > Buffer;
+
+    /// Creates a column whose values have the same type as v.
+    Column(const std::string& name, const boost::spirit::hold_any& v);
+
+    /// The name of the column.
+    const std::string& name() const { return name_; }
+
+    /// Whether the values are kept boxed rather than in a typed buffer.
+    bool boxed() const { return itemsize_ == 0; }
+
+    /// The type of the values of an unboxed column.
+    DbTypes type() const { return type_; }
+
+    /// The number of bytes per value in buffer(), or zero if boxed.
+    size_t itemsize() const { return itemsize_; }
+
+    /// The number of values in the column.
+    size_t size() const {
+      return boxed() ? boxed_.size() : data_->size() / itemsize_;
+    }
+
+    /// Returns the contiguous values of an unboxed column. The buffer must
+    /// not be modified and is left unchanged by later appends.
+    Buffer buffer() { return data_; }
+
+    /// Returns the values of a boxed column.
+    const std::vector<boost::spirit::hold_any>& values() const {
+      return boxed_;
+    }
+
+    /// Whether v has the column's type.
+    bool Matches(const boost::spirit::hold_any& v) const;
+
+    /// Appends a value to the column.
+    ///
+    /// @throws ValueError if v is not of the column's type
+    void Append(const boost::spirit::hold_any& v);
+
+   private:
+    std::string name_;
+    DbTypes type_;
+    size_t itemsize_;
+    Buffer data_;
+    std::vector<boost::spirit::hold_any> boxed_;
+  };
+
+  /// The columns of a single table, in the order they were recorded.
+  typedef std::vector<Column> Table;
+
+  virtual ~ColumnStore() {}
+
+  using RecBackend::Notify;
+
+  /// Appends every datum to its table's columns.
+  ///
+  /// @throws ValueError if a datum's fields do not match the columns of a
+  /// table that already holds rows
+  virtual void Notify(const DatumGroups& groups);
+
+  virtual std::string Name() { return "ColumnStore"; }
+
+  /// No-op, since all data are kept in memory.
+  virtual void Flush() {}
+
+  /// No-op; the recorded tables remain available until Clear is called.
+  virtual void Close() {}
+
+  /// Returns the names of all recorded tables.
+  std::set<std::string> Tables() const;
+
+  /// Returns the named table, or NULL if no rows have been recorded to it.
+  Table* table(const std::string& title);
+
+  /// Returns the number of rows recorded to the named table.
+  size_t nrows(const std::string& title);
+
+  /// Discards the named table.
+  void Drop(const std::string& title) { tables_.erase(title); }
+
+  /// Discards every table.
+  void Clear() { tables_.clear(); }
+
+ private:
+  std::map<std::string, Table> tables_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_COLUMN_STORE_H_
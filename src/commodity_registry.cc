@@ -0,0 +1,63 @@
+#include "commodity_registry.h"
+
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include "error.h"
+
+namespace cyclus {
+
+namespace {
+
+// the names by id and ids by name of the interned commodities, which are
+// made on first use so that commodities may be interned during static
+// initialization
+struct Registry {
+  Registry() { Add(""); }
+
+  int Add(const std::string& name) {
+    int id = names.size();
+    names.push_back(name);
+    ids[name] = id;
+    return id;
+  }
+
+  std::mutex mutex;
+  std::vector<std::string> names;
+  std::unordered_map<std::string, int> ids;
+};
+
+Registry& registry() {
+  static Registry* r = new Registry();
+  return *r;
+}
+
+}  // namespace
+
+int CommodityRegistry::Intern(const std::string& name) {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  std::unordered_map<std::string, int>::iterator it = r.ids.find(name);
+  return it != r.ids.end() ? it->second : r.Add(name);
+}
+
+std::string CommodityRegistry::Name(int id) {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  if (id < 0 || id >= r.names.size()) {
+    std::stringstream ss;
+    ss << "no commodity has the id " << id;
+    throw KeyError(ss.str());
+  }
+  return r.names[id];
+}
+
+int CommodityRegistry::size() {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  return r.names.size();
+}
+
+}  // namespace cyclus
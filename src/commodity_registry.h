@@ -0,0 +1,34 @@
+#ifndef CYCLUS_SRC_COMMODITY_REGISTRY_H_
+#define CYCLUS_SRC_COMMODITY_REGISTRY_H_
+
+#include <string>
+
+namespace cyclus {
+
+/// Interns commodity names into small integer ids, so that the resource
+/// exchange can group and compare commodities by integer rather than string
+/// operations. Requests, exchange nodes, and toolkit commodities are given
+/// the id of their commodity as they are made, and the greedy
+/// preconditioner looks commodity weights up by id.
+///
+/// Ids are shared by every simulation in the process and are never
+/// reclaimed. The empty commodity always has id 0, and every other
+/// commodity is given the next id the first time it is interned. Names may
+/// be interned from many threads at once.
+class CommodityRegistry {
+ public:
+  /// Returns the id of a commodity, interning it if it is new.
+  static int Intern(const std::string& name);
+
+  /// Returns the name of the commodity with an id.
+  ///
+  /// @throws KeyError if no commodity has the id
+  static std::string Name(int id);
+
+  /// Returns the number of commodities interned, including the empty one.
+  static int size();
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_COMMODITY_REGISTRY_H_
@@ -5,6 +5,7 @@
 
 #include "cyc_arithmetic.h"
 #include "error.h"
+#include "nuc_registry.h"
 #include "pyne.h"
 
 // Undefines isnan from pyne
@@ -133,5 +134,156 @@ bool AlmostEq(const CompMap& v1, const CompMap& v2, double threshold) {
   return true;
 }
 
+CompVec Add(const CompVec& v1, const CompVec& v2) {
+  return Combine(v1, 1, v2, 1);
+}
+
+CompVec Sub(const CompVec& v1, const CompVec& v2) {
+  return Combine(v1, 1, v2, -1);
+}
+
+CompVec Combine(const CompVec& v1, double w1, const CompVec& v2, double w2) {
+  const std::vector<Nuc>& n1 = v1.nucs();
+  const std::vector<Nuc>& n2 = v2.nucs();
+  const double* q1 = v1.vals().empty() ? NULL : &v1.vals()[0];
+  const double* q2 = v2.vals().empty() ? NULL : &v2.vals()[0];
+  size_t s1 = n1.size();
+  size_t s2 = n2.size();
+
+  CompVec out;
+  if (n1 == n2) {
+    // compositions built from one another usually share their nuclides,
+    // which reduces the merge to a simple loop over the quantities
+    out = v1;
+    double* q = s1 == 0 ? NULL : &out.vals()[0];
+    for (size_t i = 0; i < s1; ++i) {
+      q[i] = q1[i] * w1 + q2[i] * w2;
+    }
+    return out;
+  }
+
+  out.Reserve(s1 + s2);
+  size_t i = 0;
+  size_t j = 0;
+  while (i < s1 && j < s2) {
+    if (n1[i] < n2[j]) {
+      out.Append(n1[i], q1[i] * w1);
+      ++i;
+    } else if (n2[j] < n1[i]) {
+      out.Append(n2[j], q2[j] * w2);
+      ++j;
+    } else {
+      out.Append(n1[i], q1[i] * w1 + q2[j] * w2);
+      ++i;
+      ++j;
+    }
+  }
+  for (; i < s1; ++i) {
+    out.Append(n1[i], q1[i] * w1);
+  }
+  for (; j < s2; ++j) {
+    out.Append(n2[j], q2[j] * w2);
+  }
+  return out;
+}
+
+double Sum(const CompVec& v) {
+  return CycArithmetic::KahanSum(v.vals());
+}
+
+void ApplyThreshold(CompVec* v, double threshold) {
+  if (threshold < 0) {
+    std::stringstream ss;
+    ss << "The threshold cannot be negative. The value provided was '"
+       << threshold << "'.";
+    throw ValueError(ss.str());
+  }
+
+  const std::vector<Nuc>& nucs = v->nucs();
+  const std::vector<double>& vals = v->vals();
+  CompVec out;
+  out.Reserve(nucs.size());
+  for (size_t i = 0; i < nucs.size(); ++i) {
+    if (std::abs(vals[i]) > threshold) {
+      out.Append(nucs[i], vals[i]);
+    }
+  }
+  if (out.size() != v->size())
+    *v = out;
+}
+
+void Normalize(CompVec* v, double val) {
+  double mult = NormFactor(Sum(*v), val);
+  if (mult == 1.0)
+    return;
+  std::vector<double>& vals = v->vals();
+  double* q = vals.empty() ? NULL : &vals[0];
+  for (size_t i = 0; i < vals.size(); ++i) {
+    q[i] *= mult;
+  }
+}
+
+bool ValidNucs(const CompVec& v) {
+  const std::vector<Nuc>& nucs = v.nucs();
+  for (size_t i = 0; i < nucs.size(); ++i) {
+    if (!pyne::nucname::isnuclide(nucs[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool AllPositive(const CompVec& v) {
+  const std::vector<double>& vals = v.vals();
+  for (size_t i = 0; i < vals.size(); ++i) {
+    if (vals[i] < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+double AtomicMass(Nuc nuc) {
+  return NucRegistry::Instance().AtomicMass(nuc);
+}
+
+void AtomicMasses(const Nuc* nucs, size_t n, double* masses) {
+  NucRegistry& reg = NucRegistry::Instance();
+  for (size_t i = 0; i < n; ++i) {
+    masses[i] = reg.atomic_mass(reg.Index(nucs[i]));
+  }
+}
+
+CompVec MassToAtom(const CompVec& v) {
+  CompVec out(v);
+  size_t n = v.size();
+  if (n == 0)
+    return out;
+  std::vector<double>& vals = out.vals();
+  AtomicMasses(&v.nucs()[0], n, &vals[0]);
+  // kept free of lookups so that the division vectorizes
+  const double* q = &v.vals()[0];
+  double* a = &vals[0];
+  for (size_t i = 0; i < n; ++i) {
+    a[i] = q[i] / a[i];
+  }
+  return out;
+}
+
+CompVec AtomToMass(const CompVec& v) {
+  CompVec out(v);
+  size_t n = v.size();
+  if (n == 0)
+    return out;
+  std::vector<double>& vals = out.vals();
+  AtomicMasses(&v.nucs()[0], n, &vals[0]);
+  const double* q = &v.vals()[0];
+  double* m = &vals[0];
+  for (size_t i = 0; i < n; ++i) {
+    m[i] *= q[i];
+  }
+  return out;
+}
+
 }  // namespace compmath
 }  // namespace cyclus
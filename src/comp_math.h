@@ -49,6 +49,57 @@ bool AllPositive(const CompMap& v);
 /// normalization is performed.
 bool AlmostEq(const CompMap& v1, const CompMap& v2, double threshold);
 
+/// Does component-wise addition of the nuclide quantities of v1 and v2 with a
+/// single merge over their arrays and returns the result.  No normalization
+/// is done.
+CompVec Add(const CompVec& v1, const CompVec& v2);
+
+/// Does component-wise subtraction of the nuclide quantities of v1 and v2
+/// with a single merge over their arrays and returns the result.  No
+/// normalization is done.
+CompVec Sub(const CompVec& v1, const CompVec& v2);
+
+/// Returns the component-wise sum w1 * v1 + w2 * v2, computed with a single
+/// merge over the arrays of v1 and v2.
+CompVec Combine(const CompVec& v1, double w1, const CompVec& v2, double w2);
+
+/// Sums the quantities of all nuclides without normalization
+double Sum(const CompVec& v);
+
+/// Nuclides with quantities below threshold are removed.
+void ApplyThreshold(CompVec* v, double threshold);
+
+/// The sum of quantities of all nuclides of v is normalized to val.
+void Normalize(CompVec* v, double val = 1.0);
+
+/// Returns the factor that Normalize would scale quantities summing to sum
+/// by in order to normalize them to val.
+inline double NormFactor(double sum, double val = 1.0) {
+  return (sum != val && sum != 0) ? val / sum : 1.0;
+}
+
+/// Returns true if all nuclide keys in v are valid.
+bool ValidNucs(const CompVec& v);
+
+/// Returns true if all nuclides in v have quantities greater than or equal to
+/// zero.
+bool AllPositive(const CompVec& v);
+
+/// Returns the atomic mass of nuc in g/mol, as kept by the NucRegistry.
+double AtomicMass(Nuc nuc);
+
+/// Sets masses[i] to the atomic mass of nucs[i] in g/mol for each of the n
+/// nuclides.
+void AtomicMasses(const Nuc* nucs, size_t n, double* masses);
+
+/// Returns the atom composition with the same ratios as the mass composition
+/// v.  No normalization is done.
+CompVec MassToAtom(const CompVec& v);
+
+/// Returns the mass composition with the same ratios as the atom composition
+/// v.  No normalization is done.
+CompVec AtomToMass(const CompVec& v);
+
 }  // namespace compmath
 }  // namespace cyclus
 
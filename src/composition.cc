@@ -1,10 +1,20 @@
 #include "composition.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+
 #include "comp_math.h"
 #include "context.h"
 #include "decayer.h"
+#include "env.h"
 #include "error.h"
+#include "nuc_registry.h"
+#include "pyne.h"
 #include "recorder.h"
+#include "sparse_cram.h"
+#include "table_writer.h"
 
 extern "C" {
 #include "cram.hpp"
@@ -12,7 +22,355 @@ extern "C" {
 
 namespace cyclus {
 
-int Composition::next_id_ = 1;
+CompVec::CompVec(const CompMap& v) {
+  Reserve(v.size());
+  for (CompMap::const_iterator it = v.begin(); it != v.end(); ++it) {
+    Append(it->first, it->second);
+  }
+}
+
+CompMap CompVec::ToMap() const {
+  CompMap v;
+  for (size_t i = 0; i < nucs_.size(); ++i) {
+    v.insert(v.end(), std::make_pair(nucs_[i], vals_[i]));
+  }
+  return v;
+}
+
+double CompVec::Get(Nuc nuc) const {
+  std::vector<Nuc>::const_iterator it =
+      std::lower_bound(nucs_.begin(), nucs_.end(), nuc);
+  if (it == nucs_.end() || *it != nuc)
+    return 0;
+  return vals_[it - nucs_.begin()];
+}
+
+namespace {
+
+// Returns the CRAM decay matrix for a decay of t seconds.
+std::vector<double> DecayMatrix(double t) {
+  std::vector<double> decay_matrix (pyne_cram_transmute_info.nnz);
+  for (int i=0; i < pyne_cram_transmute_info.nnz; ++i) {
+    decay_matrix[i] = -pyne_cram_transmute_info.decay_matrix[i] * t;
+  }
+  return decay_matrix;
+}
+
+// Returns the CRAM nuclide indices ordered by nuclide id.
+const std::vector<int>& SortedCramIndices() {
+  static std::vector<int> idx;
+  static std::once_flag once;
+  std::call_once(once, []() {
+    std::vector<std::pair<Nuc, int> > nucs;
+    for (int i = 0; i < pyne_cram_transmute_info.n; ++i) {
+      nucs.push_back(std::make_pair((pyne_cram_transmute_info.nucids)[i], i));
+    }
+    std::sort(nucs.begin(), nucs.end());
+    for (size_t j = 0; j < nucs.size(); ++j) {
+      idx.push_back(nucs[j].second);
+    }
+  });
+  return idx;
+}
+
+// Converts the dense CRAM vector n back to a sorted composition, keeping
+// only the nuclides with positive quantities.
+CompVec FromCram(const std::vector<double>& n) {
+  const std::vector<int>& idx = SortedCramIndices();
+  CompVec out;
+  for (size_t j = 0; j < idx.size(); ++j) {
+    if (n[idx[j]] > 0.0) {
+      out.Append((pyne_cram_transmute_info.nucids)[idx[j]], n[idx[j]]);
+    }
+  }
+  return out;
+}
+
+// Decays the atom composition v with the given decay matrix.
+CompVec Transmute(const CompVec& v, std::vector<double>& decay_matrix) {
+  // Get intial condition vector
+  std::vector<double> n0 (pyne_cram_transmute_info.n, 0.0);
+  int i = -1;
+  for (size_t j = 0; j < v.size(); ++j) {
+    i = pyne_cram_transmute_nucid_to_i(v.nucs()[j]);
+    if (i < 0) {
+      continue;
+    }
+    n0[i] = v.vals()[j];
+  }
+
+  // perform decay
+  std::vector<double> n1 (pyne_cram_transmute_info.n);
+  pyne_cram_expm_multiply14(decay_matrix.data(), n0.data(), n1.data());
+  return FromCram(n1);
+}
+
+// Decays the atom compositions vs for t seconds with the sparse solver,
+// sharing one pass over the decay matrix between them all.
+std::vector<CompVec> SparseTransmute(const std::vector<const CompVec*>& vs,
+                                     double t) {
+  const SparseCram& solver = SparseCram::Instance();
+  size_t nvec = vs.size();
+  std::vector<double> n0(solver.n() * nvec, 0.0);
+  for (size_t v = 0; v < nvec; ++v) {
+    for (size_t j = 0; j < vs[v]->size(); ++j) {
+      int i = pyne_cram_transmute_nucid_to_i(vs[v]->nucs()[j]);
+      if (i < 0) {
+        continue;
+      }
+      n0[i * nvec + v] = vs[v]->vals()[j];
+    }
+  }
+
+  std::vector<double> n1(n0.size());
+  solver.Expm(t, nvec, n0.data(), n1.data());
+  std::vector<CompVec> out(nvec);
+  std::vector<double> n(solver.n());
+  for (size_t v = 0; v < nvec; ++v) {
+    for (int i = 0; i < solver.n(); ++i) {
+      n[i] = n1[i * nvec + v];
+    }
+    out[v] = FromCram(n);
+  }
+  return out;
+}
+
+// Guards the decay lines of all compositions.
+std::mutex& DecayLineMutex() {
+  static std::mutex mu;
+  return mu;
+}
+
+// process-wide decay chain metrics, see Composition::decay_chains
+std::atomic<uint64_t> chain_count(0);
+std::atomic<uint64_t> chain_entries(0);
+std::atomic<uint64_t> chain_swept(0);
+
+// Scales the quantities of v by mult.
+void Scale(CompVec* v, double mult) {
+  if (mult == 1)
+    return;
+  std::vector<double>& vals = v->vals();
+  for (size_t j = 0; j < vals.size(); ++j) {
+    vals[j] *= mult;
+  }
+}
+
+}  // namespace
+
+DecayCache::DecayCache() : capacity_(kDefaultCapacity), hits_(0), misses_(0) {
+  std::string size = Env::GetEnv("CYCLUS_DECAY_CACHE_SIZE");
+  if (!size.empty())
+    capacity_ = std::strtoul(size.c_str(), NULL, 10);
+}
+
+DecayCache& DecayCache::Instance() {
+  static DecayCache cache;
+  return cache;
+}
+
+uint64_t DecayCache::Hash(const CompVec& v, double t) {
+  // FNV-1a over the raw bytes of the time and both arrays
+  uint64_t h = 14695981039346656037ULL;
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(&t);
+  for (size_t i = 0; i < sizeof(t); ++i) {
+    h = (h ^ p[i]) * 1099511628211ULL;
+  }
+  if (v.empty())
+    return h;
+  p = reinterpret_cast<const unsigned char*>(&v.nucs()[0]);
+  for (size_t i = 0; i < v.size() * sizeof(Nuc); ++i) {
+    h = (h ^ p[i]) * 1099511628211ULL;
+  }
+  p = reinterpret_cast<const unsigned char*>(&v.vals()[0]);
+  for (size_t i = 0; i < v.size() * sizeof(double); ++i) {
+    h = (h ^ p[i]) * 1099511628211ULL;
+  }
+  return h;
+}
+
+bool DecayCache::Get(const CompVec& v, double t, CompVec* decayed) {
+  uint64_t h = Hash(v, t);
+  std::lock_guard<std::mutex> lock(mutex_);
+  Index::iterator it = index_.find(h);
+  if (it == index_.end() || it->second->t != t ||
+      it->second->comp.nucs() != v.nucs() ||
+      it->second->comp.vals() != v.vals()) {
+    ++misses_;
+    return false;
+  }
+  // move the entry to the front as the most recently used
+  entries_.splice(entries_.begin(), entries_, it->second);
+  *decayed = it->second->decayed;
+  ++hits_;
+  return true;
+}
+
+void DecayCache::Put(const CompVec& v, double t, const CompVec& decayed) {
+  if (capacity_ == 0)
+    return;
+  uint64_t h = Hash(v, t);
+  std::lock_guard<std::mutex> lock(mutex_);
+  Index::iterator it = index_.find(h);
+  if (it != index_.end()) {
+    // replaces an entry that collided with this one
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+  Entry e;
+  e.hash = h;
+  e.t = t;
+  e.comp = v;
+  e.decayed = decayed;
+  entries_.push_front(e);
+  index_[h] = entries_.begin();
+  Evict();
+}
+
+void DecayCache::capacity(size_t n) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = n;
+  Evict();
+}
+
+size_t DecayCache::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+void DecayCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  index_.clear();
+  hits_ = 0;
+  misses_ = 0;
+}
+
+void DecayCache::Evict() {
+  while (entries_.size() > capacity_) {
+    index_.erase(entries_.back().hash);
+    entries_.pop_back();
+  }
+}
+
+DecayTransfer::DecayTransfer() {}
+
+DecayTransfer& DecayTransfer::Instance() {
+  static DecayTransfer transfer;
+  return transfer;
+}
+
+CompVec DecayTransfer::Decay(const CompVec& v, double t) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<double> n1(pyne_cram_transmute_info.n, 0.0);
+  std::vector<double> decay_matrix;
+  for (size_t j = 0; j < v.size(); ++j) {
+    int i = pyne_cram_transmute_nucid_to_i(v.nucs()[j]);
+    if (i < 0) {
+      continue;
+    }
+
+    std::pair<double, int> key(t, i);
+    Columns::iterator it = cols_.find(key);
+    if (it == cols_.end()) {
+      // decay one atom of the nuclide to find its column of the matrix
+      if (decay_matrix.empty())
+        decay_matrix = DecayMatrix(t);
+      std::vector<double> e(pyne_cram_transmute_info.n, 0.0);
+      std::vector<double> col(pyne_cram_transmute_info.n);
+      e[i] = 1;
+      pyne_cram_expm_multiply14(decay_matrix.data(), e.data(), col.data());
+      Column& c = cols_[key];
+      for (int k = 0; k < pyne_cram_transmute_info.n; ++k) {
+        if (col[k] != 0) {
+          c.rows.push_back(k);
+          c.vals.push_back(col[k]);
+        }
+      }
+      it = cols_.find(key);
+    }
+
+    const Column& c = it->second;
+    double q = v.vals()[j];
+    for (size_t k = 0; k < c.rows.size(); ++k) {
+      n1[c.rows[k]] += q * c.vals[k];
+    }
+  }
+  return FromCram(n1);
+}
+
+size_t DecayTransfer::ncolumns() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return cols_.size();
+}
+
+void DecayTransfer::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cols_.clear();
+}
+
+const double CompInterner::kTol = 1e-12;
+
+CompInterner::CompInterner()
+    : enabled_(Env::GetEnv("CYCLUS_NO_COMP_INTERNING").empty()),
+      nkeys_(0) {}
+
+uint64_t CompInterner::Hash(const Key& k) {
+  // FNV-1a over the nuclides and rounded fractions
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i = 0; i < k.size(); ++i) {
+    h = (h ^ static_cast<uint64_t>(k[i].first)) * 1099511628211ULL;
+    h = (h ^ static_cast<uint64_t>(k[i].second)) * 1099511628211ULL;
+  }
+  return h;
+}
+
+int CompInterner::Intern(Composition* c) {
+  int id = c->id();
+  if (!enabled_)
+    return id;
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unordered_map<int, int>::iterator it = qual_ids_.find(id);
+  if (it != qual_ids_.end())
+    return it->second;
+
+  const CompVec& v = c->mass_vec();
+  double norm = compmath::NormFactor(compmath::Sum(v));
+  Key k;
+  k.reserve(v.size());
+  for (size_t i = 0; i < v.size(); ++i) {
+    k.push_back(std::make_pair(v.nucs()[i],
+                               std::llround(v.vals()[i] * norm / kTol)));
+  }
+
+  int qual_id = id;
+  std::vector<Entry>& bucket = entries_[Hash(k)];
+  for (size_t i = 0; i < bucket.size(); ++i) {
+    if (bucket[i].key == k) {
+      qual_id = bucket[i].id;
+      break;
+    }
+  }
+  if (qual_id == id) {
+    Entry e;
+    e.key.swap(k);
+    e.id = id;
+    bucket.push_back(e);
+    ++nkeys_;
+    // compositions loaded from a previous simulation come already recorded
+    if (c->recorded_ && c->recorded_in_ == NULL)
+      recorded_.insert(id);
+  }
+  qual_ids_[id] = qual_id;
+  return qual_id;
+}
+
+bool CompInterner::MarkRecorded(int qual_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return recorded_.insert(qual_id).second;
+}
+
+std::atomic<int> Composition::next_id_(1);
 
 Composition::Ptr Composition::CreateFromAtom(CompMap v) {
   if (!compmath::ValidNucs(v))
@@ -38,46 +396,214 @@ Composition::Ptr Composition::CreateFromMass(CompMap v) {
   return c;
 }
 
+Composition::Ptr Composition::CreateFromAtom(CompVec v) {
+  if (!compmath::ValidNucs(v))
+    throw ValueError("invalid nuclide in CompVec");
+
+  if (!compmath::AllPositive(v))
+    throw ValueError("negative quantity in CompVec");
+
+  Composition::Ptr c(new Composition());
+  c->atom_vec_ = std::move(v);
+  return c;
+}
+
+Composition::Ptr Composition::CreateFromMass(CompVec v) {
+  if (!compmath::ValidNucs(v))
+    throw ValueError("invalid nuclide in CompVec");
+
+  if (!compmath::AllPositive(v))
+    throw ValueError("negative quantity in CompVec");
+
+  Composition::Ptr c(new Composition());
+  c->mass_vec_ = std::move(v);
+  return c;
+}
+
 int Composition::id() {
   return id_;
 }
 
+// Each lazy conversion is done once, under the composition's lock, so that
+// compositions may be shared between threads.
 const CompMap& Composition::atom() {
-  if (atom_.size() == 0) {
-    CompMap::iterator it;
-    for (it = mass_.begin(); it != mass_.end(); ++it) {
-      Nuc nuc = it->first;
-      atom_[nuc] = it->second / pyne::atomic_mass(nuc);
+  if (!atom_ready_) {
+    std::lock_guard<std::recursive_mutex> lock(mu_);
+    if (atom_.size() == 0) {
+      atom_ = atom_vec().ToMap();
     }
+    atom_ready_ = true;
   }
   return atom_;
 }
 
 const CompMap& Composition::mass() {
-  if (mass_.size() == 0) {
-    CompMap::iterator it;
-    for (it = atom_.begin(); it != atom_.end(); ++it) {
-      Nuc nuc = it->first;
-      mass_[nuc] = it->second * pyne::atomic_mass(nuc);
+  if (!mass_ready_) {
+    std::lock_guard<std::recursive_mutex> lock(mu_);
+    if (mass_.size() == 0) {
+      mass_ = mass_vec().ToMap();
     }
+    mass_ready_ = true;
   }
   return mass_;
 }
 
-Composition::Ptr Composition::Decay(int delta, uint64_t secs_per_timestep) {
+const CompVec& Composition::atom_vec() {
+  if (!atom_vec_ready_) {
+    std::lock_guard<std::recursive_mutex> lock(mu_);
+    if (atom_vec_.empty()) {
+      if (!atom_.empty()) {
+        atom_vec_ = CompVec(atom_);
+      } else {
+        if (mass_vec_.empty())
+          mass_vec_ = CompVec(mass_);
+        atom_vec_ = compmath::MassToAtom(mass_vec_);
+      }
+    }
+    atom_vec_ready_ = true;
+  }
+  return atom_vec_;
+}
+
+const CompVec& Composition::mass_vec() {
+  if (!mass_vec_ready_) {
+    std::lock_guard<std::recursive_mutex> lock(mu_);
+    if (mass_vec_.empty()) {
+      if (!mass_.empty()) {
+        mass_vec_ = CompVec(mass_);
+      } else {
+        if (atom_vec_.empty())
+          atom_vec_ = CompVec(atom_);
+        mass_vec_ = compmath::AtomToMass(atom_vec_);
+      }
+    }
+    mass_vec_ready_ = true;
+  }
+  return mass_vec_;
+}
+
+double Composition::max_decay_const() {
+  if (max_decay_const_ < 0) {
+    // nuclides without decay data give NaN, which is skipped
+    double lambda = 0;
+    NucRegistry& reg = NucRegistry::Instance();
+    const std::vector<Nuc>& nucs = atom_vec().nucs();
+    for (size_t i = 0; i < nucs.size(); ++i) {
+      double l = reg.decay_const(reg.Index(nucs[i]));
+      if (l > lambda)
+        lambda = l;
+    }
+    max_decay_const_ = lambda;
+  }
+  return max_decay_const_;
+}
+
+double Composition::decay_heat() {
+  if (decay_heat_ < 0) {
+    // as pyne::Material::decay_heat, in MW, for 1 kg = 1000 g of material;
+    // nuclides without decay data give NaN, which is skipped
+    const CompVec& v = mass_vec();
+    double sum = compmath::Sum(v);
+    double heat = 0;
+    if (sum > 0) {
+      NucRegistry& reg = NucRegistry::Instance();
+      const std::vector<Nuc>& nucs = v.nucs();
+      const std::vector<double>& vals = v.vals();
+      for (size_t i = 0; i < nucs.size(); ++i) {
+        int j = reg.Index(nucs[i]);
+        double h = vals[i] * reg.decay_const(j) * reg.q_val(j) /
+                   reg.atomic_mass(j);
+        if (!std::isnan(h))
+          heat += h;
+      }
+      heat *= 1000 * pyne::N_A / pyne::MeV_per_MJ / sum;
+    }
+    decay_heat_ = heat;
+  }
+  return decay_heat_;
+}
+
+Composition::Chain::Chain() {
+  chain_count++;
+}
+
+Composition::Chain::~Chain() {
+  chain_count--;
+  chain_entries -= comps_.size();
+}
+
+Composition::Ptr Composition::Chain::Find(int tot_decay) {
+  std::map<int, Composition*>::iterator it = comps_.find(tot_decay);
+  if (it == comps_.end() || !it->second->TryAddRef())
+    return Ptr();
+  return Ptr(it->second, false);
+}
+
+Composition::Ptr Composition::Chain::Insert(int tot_decay, Ptr c) {
+  std::pair<std::map<int, Composition*>::iterator, bool> ins =
+      comps_.insert(std::make_pair(tot_decay, c.get()));
+  if (ins.second) {
+    chain_entries++;
+    return c;
+  }
+  if (ins.first->second->TryAddRef())
+    return Ptr(ins.first->second, false);
+  // the composition there is being destroyed and won't erase c's entry
+  ins.first->second = c.get();
+  return c;
+}
+
+void Composition::Chain::Erase(int tot_decay, const Composition* c) {
+  std::map<int, Composition*>::iterator it = comps_.find(tot_decay);
+  if (it != comps_.end() && it->second == c) {
+    comps_.erase(it);
+    chain_swept++;
+    chain_entries--;
+  }
+}
+
+std::map<int, Composition::Ptr> Composition::Chain::Live() {
+  std::map<int, Ptr> live;
+  std::map<int, Composition*>::iterator it;
+  for (it = comps_.begin(); it != comps_.end(); ++it) {
+    if (it->second->TryAddRef())
+      live[it->first] = Ptr(it->second, false);
+  }
+  return live;
+}
+
+uint64_t Composition::decay_chains() {
+  return chain_count;
+}
+
+uint64_t Composition::decay_chain_entries() {
+  return chain_entries;
+}
+
+uint64_t Composition::decay_chain_swept() {
+  return chain_swept;
+}
+
+Composition::Ptr Composition::Decay(int delta, uint64_t secs_per_timestep,
+                                    bool transfer) {
   int tot_decay = prev_decay_ + delta;
-  if (decay_line_->count(tot_decay) == 1) {
-    // decay_line_ has cached, pre-computed result of this decay
-    return (*decay_line_)[tot_decay];
+  {
+    std::lock_guard<std::mutex> lock(DecayLineMutex());
+    Ptr cached = decay_line_->Find(tot_decay);
+    if (cached != NULL) {
+      // decay_line_ has cached, pre-computed result of this decay
+      return cached;
+    }
   }
 
   // Calculate a new decayed composition and insert it into the decay chain.
   // It will automagically appear in the decay chain for all other compositions
   // that are a part of this decay chain because decay_line_ is a pointer that
-  // all compositions in the chain share.
-  Composition::Ptr decayed = NewDecay(delta, secs_per_timestep);
-  (*decay_line_)[tot_decay] = decayed;
-  return decayed;
+  // all compositions in the chain share. If another thread got there first,
+  // its result is kept.
+  Composition::Ptr decayed = NewDecay(delta, secs_per_timestep, transfer);
+  std::lock_guard<std::mutex> lock(DecayLineMutex());
+  return decay_line_->Insert(tot_decay, decayed);
 }
 
 Composition::Ptr Composition::Decay(int delta) {
@@ -85,81 +611,199 @@ Composition::Ptr Composition::Decay(int delta) {
 }
 
 void Composition::Record(Context* ctx) {
-  if (recorded_) {
+  CompInterner& interner = ctx->comp_interner();
+  if (recorded_ && (recorded_in_ == NULL || recorded_in_ == &interner)) {
     return;
   }
+  int qual_id = interner.Intern(this);
+  recorded_in_ = &interner;
   recorded_ = true;
-
-  CompMap::const_iterator it;
-  CompMap cm = mass();  // force lazy evaluation now
-  compmath::Normalize(&cm, 1);
-  for (it = cm.begin(); it != cm.end(); ++it) {
-    ctx->NewDatum("Compositions")
-        ->AddVal("QualId", id())
-        ->AddVal("NucId", it->first)
-        ->AddVal("MassFrac", it->second)
-        ->Record();
+  if (!interner.MarkRecorded(qual_id)) {
+    return;
   }
+
+  CompVec cv = mass_vec();  // force lazy evaluation now
+  compmath::Normalize(&cv, 1);
+  ctx->tables().compositions.Record(qual_id, cv.nucs(), cv.vals());
 }
 
-Composition::Composition() : prev_decay_(0), recorded_(false) {
-  id_ = next_id_;
-  next_id_++;
+Composition::Composition()
+    : prev_decay_(0),
+      recorded_(false),
+      recorded_in_(NULL),
+      atom_ready_(false),
+      mass_ready_(false),
+      atom_vec_ready_(false),
+      mass_vec_ready_(false),
+      max_decay_const_(-1),
+      decay_heat_(-1) {
+  id_ = next_id_++;
   decay_line_ = ChainPtr(new Chain());
 }
 
+Composition::~Composition() {
+  std::lock_guard<std::mutex> lock(DecayLineMutex());
+  decay_line_->Erase(prev_decay_, this);
+}
+
 Composition::Composition(int prev_decay, ChainPtr decay_line)
     : recorded_(false),
+      recorded_in_(NULL),
+      atom_ready_(false),
+      mass_ready_(false),
+      atom_vec_ready_(false),
+      mass_vec_ready_(false),
       prev_decay_(prev_decay),
-      decay_line_(decay_line) {
-  id_ = next_id_;
-  next_id_++;
+      decay_line_(decay_line),
+      max_decay_const_(-1),
+      decay_heat_(-1) {
+  id_ = next_id_++;
 }
 
-Composition::Ptr Composition::NewDecay(int delta, uint64_t secs_per_timestep) {
+Composition::Ptr Composition::NewDecay(int delta, uint64_t secs_per_timestep,
+                                       bool transfer) {
   int tot_decay = prev_decay_ + delta;
-  atom();  // force evaluation of atom-composition if not calculated already
+  // force evaluation of atom-composition if not calculated already
+  const CompVec& atoms = atom_vec();
 
   // the new composition is a part of this decay chain and so is created with a
   // pointer to the exact same decay_line_.
   Composition::Ptr decayed(new Composition(tot_decay, decay_line_));
 
   // FIXME this is only here for testing, see issue #761
-  if (atom_.size() == 0)
+  if (atoms.empty())
     return decayed;
 
-  // Get intial condition vector
-  std::vector<double> n0 (pyne_cram_transmute_info.n, 0.0);
-  CompMap::const_iterator it;
-  int i = -1;
-  for (it = atom_.begin(); it != atom_.end(); ++it) {
-    i = pyne_cram_transmute_nucid_to_i(it->first);
-    if (i < 0) {
+  // decay is linear, so decaying the normalized composition and scaling the
+  // result by the original total lets identical recipes share one result
+  CompVec norm(atoms);
+  double total = compmath::Sum(norm);
+  compmath::Normalize(&norm, 1);
+  double t = static_cast<double>(secs_per_timestep) * delta;
+
+  CompVec result;
+  DecayCache& cache = DecayCache::Instance();
+  if (!cache.Get(norm, t, &result)) {
+    if (transfer) {
+      result = DecayTransfer::Instance().Decay(norm, t);
+    } else if (SparseCram::enabled()) {
+      result = SparseTransmute(std::vector<const CompVec*>(1, &norm), t)[0];
+    } else {
+      std::vector<double> decay_matrix = DecayMatrix(t);
+      result = Transmute(norm, decay_matrix);
+    }
+    cache.Put(norm, t, result);
+  }
+  Scale(&result, total);
+  decayed->atom_vec_ = result;
+  return decayed;
+}
+
+std::vector<Composition::Ptr> Composition::Decay(
+    const std::vector<Ptr>& comps, const std::vector<int>& deltas,
+    uint64_t secs_per_timestep, bool transfer) {
+  if (comps.size() != deltas.size())
+    throw ValueError("batch decay needs one time delta per composition");
+
+  // declared before the lock, so that it is released first if this throws
+  // and the compositions only held here erase themselves from their chains
+  std::vector<Ptr> out(comps.size());
+  std::lock_guard<std::mutex> lock(DecayLineMutex());
+
+  // find the decays not yet cached along their decay lines, each only once
+  std::map<std::pair<Chain*, int>, size_t> firsts;
+  std::vector<size_t> dups;
+  std::vector<size_t> todo;
+  for (size_t i = 0; i < comps.size(); ++i) {
+    Composition* c = comps[i].get();
+    int tot_decay = c->prev_decay_ + deltas[i];
+    Ptr cached = c->decay_line_->Find(tot_decay);
+    if (cached != NULL) {
+      out[i] = cached;
+      continue;
+    }
+    std::pair<Chain*, int> key(c->decay_line_.get(), tot_decay);
+    if (firsts.count(key) > 0) {
+      dups.push_back(i);
       continue;
     }
-    n0[i] = it->second;
+    firsts[key] = i;
+    c->atom_vec();  // forces evaluation of the atom composition
+    if (c->atom_vec_.empty()) {
+      // FIXME this is only here for testing, see issue #761
+      out[i] = c->decay_line_->Insert(
+          tot_decay, Ptr(new Composition(tot_decay, c->decay_line_)));
+    } else {
+      todo.push_back(i);
+    }
   }
 
-  // get decay matrix
-  double t = static_cast<double>(secs_per_timestep) * delta;
-  std::vector<double> decay_matrix (pyne_cram_transmute_info.nnz);
-  for (i=0; i < pyne_cram_transmute_info.nnz; ++i) {
-    decay_matrix[i] = -pyne_cram_transmute_info.decay_matrix[i] * t;
+  // look up the normalized compositions in the decay cache and gather the
+  // misses by decay time so that each decay matrix is built only once
+  DecayCache& cache = DecayCache::Instance();
+  std::vector<CompVec> results(todo.size());
+  std::vector<double> totals(todo.size());
+  std::vector<CompVec> norms(todo.size());
+  std::map<double, std::vector<size_t> > misses;
+  for (size_t j = 0; j < todo.size(); ++j) {
+    size_t i = todo[j];
+    norms[j] = comps[i]->atom_vec_;
+    totals[j] = compmath::Sum(norms[j]);
+    compmath::Normalize(&norms[j], 1);
+    double t = static_cast<double>(secs_per_timestep) * deltas[i];
+    if (!cache.Get(norms[j], t, &results[j]))
+      misses[t].push_back(j);
   }
 
-  // perform decay
-  std::vector<double> n1 (pyne_cram_transmute_info.n);
-  pyne_cram_expm_multiply14(decay_matrix.data(), n0.data(), n1.data());
+  std::map<double, std::vector<size_t> >::iterator m_it;
+  for (m_it = misses.begin(); m_it != misses.end(); ++m_it) {
+    double t = m_it->first;
+    const std::vector<size_t>& js = m_it->second;
+    if (!transfer && SparseCram::enabled()) {
+      // decays every miss for this time in one batch
+      std::vector<const CompVec*> vs(js.size());
+      for (size_t k = 0; k < js.size(); ++k) {
+        vs[k] = &norms[js[k]];
+      }
+      std::vector<CompVec> decayed = SparseTransmute(vs, t);
+      for (size_t k = 0; k < js.size(); ++k) {
+        results[js[k]] = decayed[k];
+        cache.Put(norms[js[k]], t, results[js[k]]);
+      }
+      continue;
+    }
 
-  // convert back to map
-  CompMap cm;
-  for (i=0; i < pyne_cram_transmute_info.n; ++i) {
-    if (n1[i] > 0.0) {
-      cm[(pyne_cram_transmute_info.nucids)[i]] = n1[i];
+    std::vector<double> decay_matrix;
+    if (!transfer)
+      decay_matrix = DecayMatrix(t);
+    for (size_t k = 0; k < js.size(); ++k) {
+      // identical compositions from different decay lines share a result
+      if (k > 0 && cache.Get(norms[js[k]], t, &results[js[k]]))
+        continue;
+      if (transfer) {
+        results[js[k]] = DecayTransfer::Instance().Decay(norms[js[k]], t);
+      } else {
+        results[js[k]] = Transmute(norms[js[k]], decay_matrix);
+      }
+      cache.Put(norms[js[k]], t, results[js[k]]);
     }
   }
-  decayed->atom_ = cm;
-  return decayed;
+
+  for (size_t j = 0; j < todo.size(); ++j) {
+    size_t i = todo[j];
+    Composition* c = comps[i].get();
+    int tot_decay = c->prev_decay_ + deltas[i];
+    Ptr decayed(new Composition(tot_decay, c->decay_line_));
+    Scale(&results[j], totals[j]);
+    decayed->atom_vec_ = results[j];
+    out[i] = c->decay_line_->Insert(tot_decay, decayed);
+  }
+
+  for (size_t k = 0; k < dups.size(); ++k) {
+    size_t i = dups[k];
+    out[i] = comps[i]->decay_line_->Find(comps[i]->prev_decay_ + deltas[i]);
+  }
+  return out;
 }
 
 }  // namespace cyclus
@@ -1,14 +1,25 @@
 #ifndef CYCLUS_SRC_COMPOSITION_H_
 #define CYCLUS_SRC_COMPOSITION_H_
 
+#include <atomic>
+#include <list>
 #include <map>
+#include <mutex>
 #include <stdint.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <boost/intrusive_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include "intrusive_base.h"
+#include "mem_usage.h"
+
 class SimInitTest;
 
 namespace cyclus {
 
+class Composition;
 class Context;
 
 typedef int Nuc;
@@ -16,11 +27,207 @@ typedef int Nuc;
 /// a raw definition of nuclides and corresponding (dimensionless quantities).
 typedef std::map<Nuc, double> CompMap;
 
+/// A flat representation of a CompMap: parallel, contiguous arrays of
+/// nuclides, which are kept sorted and unique, and their quantities. Walking
+/// and combining CompVecs touches contiguous memory only and so is much
+/// cheaper than walking a CompMap for compositions with many nuclides.
+class CompVec {
+ public:
+  CompVec() {}
+
+  /// Creates a CompVec holding the same nuclides and quantities as v.
+  explicit CompVec(const CompMap& v);
+
+  /// Returns a CompMap holding the same nuclides and quantities.
+  CompMap ToMap() const;
+
+  /// The sorted nuclides.
+  inline const std::vector<Nuc>& nucs() const { return nucs_; }
+
+  /// The quantity of each nuclide, in the order of nucs().
+  inline const std::vector<double>& vals() const { return vals_; }
+  inline std::vector<double>& vals() { return vals_; }
+
+  inline size_t size() const { return nucs_.size(); }
+  inline bool empty() const { return nucs_.empty(); }
+
+  /// Returns the quantity of nuc, or zero if it is not present.
+  double Get(Nuc nuc) const;
+
+  /// Adds nuc with quantity val. nuc must be greater than every nuclide
+  /// already present.
+  inline void Append(Nuc nuc, double val) {
+    nucs_.push_back(nuc);
+    vals_.push_back(val);
+  }
+
+  inline void Reserve(size_t n) {
+    nucs_.reserve(n);
+    vals_.reserve(n);
+  }
+
+  inline void Clear() {
+    nucs_.clear();
+    vals_.clear();
+  }
+
+ private:
+  std::vector<Nuc> nucs_;
+  std::vector<double> vals_;
+};
+
+/// A process-wide, bounded cache of decay results shared by all compositions.
+/// Entries are keyed by the normalized atom composition that was decayed and
+/// the decay time in seconds, so that separately created but identical
+/// compositions, such as the same recipe used by many agents, are only ever
+/// decayed once. When full, the least recently used entry is evicted. The
+/// capacity defaults to kDefaultCapacity entries and may be set with the
+/// CYCLUS_DECAY_CACHE_SIZE environment variable; zero disables the cache.
+class DecayCache {
+ public:
+  static const size_t kDefaultCapacity = 1024;
+
+  /// Returns the cache shared by the whole process.
+  static DecayCache& Instance();
+
+  /// Looks up the result of decaying the normalized atom composition v for t
+  /// seconds. Returns true and sets decayed on a hit.
+  bool Get(const CompVec& v, double t, CompVec* decayed);
+
+  /// Stores the result of decaying the normalized atom composition v for t
+  /// seconds.
+  void Put(const CompVec& v, double t, const CompVec& decayed);
+
+  /// The maximum number of entries kept.
+  inline size_t capacity() const { return capacity_; }
+  void capacity(size_t n);
+
+  /// The number of entries currently kept.
+  size_t size();
+
+  /// The number of lookups that found, or did not find, a result.
+  inline uint64_t hits() const { return hits_; }
+  inline uint64_t misses() const { return misses_; }
+
+  /// Discards every entry and resets the hit and miss counters.
+  void Clear();
+
+ private:
+  struct Entry {
+    uint64_t hash;
+    double t;
+    CompVec comp;
+    CompVec decayed;
+  };
+  typedef std::list<Entry> Entries;
+  typedef std::map<uint64_t, Entries::iterator> Index;
+
+  DecayCache();
+
+  static uint64_t Hash(const CompVec& v, double t);
+
+  /// Drops the least recently used entries beyond the capacity.
+  void Evict();
+
+  std::mutex mutex_;
+  size_t capacity_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+  Entries entries_;
+  Index index_;
+};
+
+/// Process-wide decay transfer matrices. Decay is linear, so decaying a
+/// composition for a fixed time is a matrix-vector product: column j of the
+/// matrix holds the decay products of one atom of nuclide j. Decays asked to
+/// use them (see Composition::Decay) are calculated as sparse products with
+/// these matrices instead of by a full decay solve. Each column is calculated the first time its
+/// nuclide is decayed for a given time and is then kept, so that a
+/// simulation, whose time step duration is fixed, soon decays every
+/// composition without solving at all.
+class DecayTransfer {
+ public:
+  /// Returns the matrices shared by the whole process.
+  static DecayTransfer& Instance();
+
+  /// Returns the atom composition v decayed for t seconds.
+  CompVec Decay(const CompVec& v, double t);
+
+  /// The number of matrix columns calculated so far, over all decay times.
+  size_t ncolumns();
+
+  /// Discards every calculated column.
+  void Clear();
+
+ private:
+  /// The nonzero entries of one column, by decay solver nuclide index.
+  struct Column {
+    std::vector<int> rows;
+    std::vector<double> vals;
+  };
+  typedef std::map<std::pair<double, int>, Column> Columns;
+
+  DecayTransfer();
+
+  std::mutex mutex_;
+  Columns cols_;
+};
+
+/// Gives compositions with the same content a single id, so that they share
+/// one QualId in output and their Compositions rows are recorded only once.
+/// Two compositions have the same content when each of their normalized mass
+/// fractions rounds to the same multiple of kTol. The shared id is that of the
+/// first such composition interned. Each context keeps its own interner (see
+/// Context::comp_interner), so that every simulation records the rows of the
+/// compositions it uses. Interning can be turned off by setting the
+/// CYCLUS_NO_COMP_INTERNING environment variable, in which case every
+/// composition keeps its own id. Compositions may be interned from many
+/// threads at once.
+class CompInterner {
+ public:
+  /// The tolerance to which normalized mass fractions are compared.
+  static const double kTol;
+
+  CompInterner();
+
+  /// Whether compositions with the same content share an id.
+  inline bool enabled() const { return enabled_; }
+  inline void enabled(bool e) { enabled_ = e; }
+
+  /// Returns the id shared by every composition with the same content as c.
+  int Intern(Composition* c);
+
+  /// Marks the compositions interned under qual_id as recorded, returning
+  /// false if they already were.
+  bool MarkRecorded(int qual_id);
+
+  /// The number of distinct contents interned.
+  inline size_t size() const { return nkeys_; }
+
+ private:
+  typedef std::vector<std::pair<Nuc, int64_t> > Key;
+  struct Entry {
+    Key key;
+    int id;
+  };
+
+  static uint64_t Hash(const Key& k);
+
+  std::mutex mutex_;
+  bool enabled_;
+  size_t nkeys_;
+  std::unordered_map<uint64_t, std::vector<Entry> > entries_;
+  // interned ids by composition id, so that each composition is hashed once
+  std::unordered_map<int, int> qual_ids_;
+  std::unordered_set<int> recorded_;
+};
+
 /// An immutable object responsible for holding a nuclide composition. It tracks
 /// decay lineages to prevent duplicate calculations and output recording and is
 /// able to record its composition data to output when told.  Each composition
 /// keeps a pointer to references to every other composition that is a result of
-/// decaying this or a previously decayed-from composition.
+/// decaying this or a previously decayed-from composition. Compositions may be
+/// shared and decayed by many threads at once.
 ///
 /// Compositions are immutable and thus their state must be created/defined
 /// entirely at their creation. Compositions are created by passing in a
@@ -35,12 +242,16 @@ typedef std::map<Nuc, double> CompMap;
 /// Composition c = Composition::CreateFromAtom(v);
 /// @endcode
 ///
-class Composition {
+class Composition : IntrusiveBase<Composition>,
+                    private MemCounted<Composition, MemUsage::COMPOSITION> {
+  friend class CompInterner;
   friend class SimInit;
   friend class ::SimInitTest;
 
  public:
-  typedef boost::shared_ptr<Composition> Ptr;
+  typedef boost::intrusive_ptr<Composition> Ptr;
+
+  ~Composition();
 
   /// Creates a new composition from v with its components having appropriate
   /// atom-based ratios. v does not need to be normalized to any particular
@@ -52,10 +263,20 @@ class Composition {
   /// value.
   static Ptr CreateFromMass(CompMap v);
 
+  /// Creates a new composition from v with its components having appropriate
+  /// atom-based ratios, without building a CompMap. v is moved, rather than
+  /// copied, into the composition when passed as a temporary.
+  static Ptr CreateFromAtom(CompVec v);
+
+  /// Creates a new composition from v with its components having appropriate
+  /// mass-based ratios, without building a CompMap. v is moved, rather than
+  /// copied, into the composition when passed as a temporary.
+  static Ptr CreateFromMass(CompVec v);
+
   /// Returns a unique id associated with this composition.  Note that multiple
   /// material objects can share the same composition. Also Note that the id is
   /// not the same for two compositions that were separately created from the
-  /// same CompMap.
+  /// same CompMap; use CompInterner to get an id shared by both.
   int id();
 
   /// Returns the unnormalized atom composition.
@@ -64,6 +285,24 @@ class Composition {
   /// Returns the unnormalized mass composition.
   const CompMap& mass();
 
+  /// Returns the unnormalized atom composition as a CompVec. Prefer this over
+  /// atom() in code that walks or combines compositions.
+  const CompVec& atom_vec();
+
+  /// Returns the unnormalized mass composition as a CompVec. Prefer this over
+  /// mass() in code that walks or combines compositions.
+  const CompVec& mass_vec();
+
+  /// Returns the largest decay constant (in 1/s) of the composition's
+  /// nuclides. It is looked up once and then shared by every material that
+  /// holds the composition.
+  double max_decay_const();
+
+  /// Returns the decay heat of one kg of the composition, in the units of
+  /// Material::DecayHeat. Like max_decay_const, it is computed once and then
+  /// shared by every material that holds the composition.
+  double decay_heat();
+
   /// Returns a decayed version of this composition (decayed delta timesteps)
   /// assuming a time step is 1/12 of one year in duration. This composition
   /// remains unchanged.
@@ -71,17 +310,74 @@ class Composition {
 
   /// Returns a decayed version of this composition (decayed
   /// delta timesteps) using the seconds to timestep conversion specified.
-  Ptr Decay(int delta, uint64_t secs_per_timestep);
+  /// If transfer is true, the decay is calculated with the DecayTransfer
+  /// matrices.
+  Ptr Decay(int delta, uint64_t secs_per_timestep, bool transfer = false);
+
+  /// Returns decayed versions of many compositions at once: the i-th result
+  /// is comps[i] decayed deltas[i] timesteps of secs_per_timestep seconds.
+  /// Repeated decays are only calculated once, results already cached along
+  /// a composition's decay line or in the DecayCache are reused, and each
+  /// decay matrix is built only once per distinct time delta. If transfer is
+  /// true, the decays are calculated with the DecayTransfer matrices.
+  ///
+  /// @throws ValueError if comps and deltas differ in length
+  static std::vector<Ptr> Decay(const std::vector<Ptr>& comps,
+                                const std::vector<int>& deltas,
+                                uint64_t secs_per_timestep,
+                                bool transfer = false);
 
   /// Records the composition in output database Compositions table (if
-  /// not done previously).
+  /// not done previously), under the id interned for it by ctx. Nothing is
+  /// recorded if a composition with the same content already was. A
+  /// composition shared by many simulations, e.g., forked ones, is recorded
+  /// once in each.
   void Record(Context* ctx);
 
+  /// The number of decay chains alive in the process, the entries they hold,
+  /// and the number of entries dropped from them so far as their
+  /// compositions were destroyed.
+  /// @{
+  static uint64_t decay_chains();
+  static uint64_t decay_chain_entries();
+  static uint64_t decay_chain_swept();
+  /// @}
+
  protected:
   /// a chain containing compositions that are a result of decay from a common
   /// ancestor composition. The key is the total amount of time a composition
-  /// has been decayed from its root parent.
-  typedef std::map<int, Composition::Ptr> Chain;
+  /// has been decayed from its root parent. Since every composition holds its
+  /// chain, the chain holds its compositions without a reference: each
+  /// composition drops its entry when it is destroyed, i.e., once no material
+  /// or other holder keeps it. A chain thus keeps only the decays still in use
+  /// rather than every decay ever calculated. Chains are guarded by a
+  /// process-wide mutex.
+  class Chain {
+   public:
+    Chain();
+    ~Chain();
+
+    /// Returns the composition decayed for tot_decay, or a NULL pointer if
+    /// there is none or it is being destroyed.
+    Ptr Find(int tot_decay);
+
+    /// Adds c as the composition decayed for tot_decay, unless a live one is
+    /// already present, and returns whichever is kept.
+    Ptr Insert(int tot_decay, Ptr c);
+
+    /// Drops the entry for tot_decay if it is c, which is being destroyed.
+    void Erase(int tot_decay, const Composition* c);
+
+    /// The number of entries, including those of compositions being
+    /// destroyed.
+    inline size_t size() const { return comps_.size(); }
+
+    /// Returns the live compositions by total decay.
+    std::map<int, Ptr> Live();
+
+   private:
+    std::map<int, Composition*> comps_;
+  };
 
   typedef boost::shared_ptr<Chain> ChainPtr;
 
@@ -95,16 +391,35 @@ class Composition {
   Composition(int prev_decay, ChainPtr decay_line);
 
   /// Performs a decay calculation and creates a new decayed composition.
-  Ptr NewDecay(int delta, uint64_t secs_per_timestep);
+  Ptr NewDecay(int delta, uint64_t secs_per_timestep, bool transfer);
 
-  static int next_id_;
+  static std::atomic<int> next_id_;
   int id_;
-  bool recorded_;
+  std::atomic<bool> recorded_;
+  // the interner of the simulation the composition was last recorded in, or
+  // NULL if it was loaded from one that already recorded it
+  std::atomic<const CompInterner*> recorded_in_;
+  // each composition is lazily available both as a CompMap and as a
+  // CompVec; whichever was given at creation is the source of the others.
+  // mu_ guards the conversions, after which the ready flags are set.
+  std::recursive_mutex mu_;
+  std::atomic<bool> atom_ready_;
+  std::atomic<bool> mass_ready_;
+  std::atomic<bool> atom_vec_ready_;
+  std::atomic<bool> mass_vec_ready_;
   CompMap atom_;
   CompMap mass_;
+  CompVec atom_vec_;
+  CompVec mass_vec_;
 
   /// the total time delta this composition has been decayed from its root ancestor.
   int prev_decay_;
+
+  /// the largest decay constant of the nuclides, or negative if not yet known.
+  std::atomic<double> max_decay_const_;
+
+  /// the decay heat per kg, or negative if not yet known.
+  std::atomic<double> decay_heat_;
 };
 
 }  // namespace cyclus
@@ -1,14 +1,29 @@
 #include "context.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <vector>
 #include <boost/uuid/uuid_generators.hpp>
 
+#include "agent_profiler.h"
+#include "env.h"
 #include "error.h"
 #include "exchange_solver.h"
+#include "hw_counters.h"
 #include "logger.h"
+#include "material.h"
+#include "mem_usage.h"
 #include "pyhooks.h"
+#include "res_tracker.h"
 #include "sim_init.h"
+#include "sparse_cram.h"
+#include "table_writer.h"
+#include "task_scheduler.h"
 #include "timer.h"
+#include "tracer.h"
+#include "trader.h"
+#include "toolkit/spatial_index.h"
+#include "toolkit/timeseries.h"
 #include "version.h"
 
 namespace cyclus {
@@ -25,6 +40,17 @@ SimInfo::SimInfo()
       branch_time(-1),
       explicit_inventory(false),
       explicit_inventory_compact(false),
+      dre_timings(false),
+      dre_regions(false),
+      compact_output(false),
+      dense_output(false),
+      checkpoint_steps(0),
+      checkpoint_secs(0),
+      seed(0),
+      threads(0),
+      max_trade_distance(0),
+      decay_transfer(false),
+      sparse_decay(false),
       parent_sim(boost::uuids::nil_uuid()),
       parent_type("init") {}
 
@@ -38,6 +64,17 @@ SimInfo::SimInfo(int dur, int y0, int m0, std::string handle)
       handle(handle),
       explicit_inventory(false),
       explicit_inventory_compact(false),
+      dre_timings(false),
+      dre_regions(false),
+      compact_output(false),
+      dense_output(false),
+      checkpoint_steps(0),
+      checkpoint_secs(0),
+      seed(0),
+      threads(0),
+      max_trade_distance(0),
+      decay_transfer(false),
+      sparse_decay(false),
       parent_sim(boost::uuids::nil_uuid()),
       parent_type("init") {}
 
@@ -51,6 +88,17 @@ SimInfo::SimInfo(int dur, int y0, int m0, std::string handle, std::string d)
       handle(handle),
       explicit_inventory(false),
       explicit_inventory_compact(false),
+      dre_timings(false),
+      dre_regions(false),
+      compact_output(false),
+      dense_output(false),
+      checkpoint_steps(0),
+      checkpoint_secs(0),
+      seed(0),
+      threads(0),
+      max_trade_distance(0),
+      decay_transfer(false),
+      sparse_decay(false),
       parent_sim(boost::uuids::nil_uuid()),
       parent_type("init") {}
 
@@ -67,43 +115,252 @@ SimInfo::SimInfo(int dur, boost::uuids::uuid parent_sim,
       branch_time(branch_time),
       explicit_inventory(false),
       explicit_inventory_compact(false),
+      dre_timings(false),
+      dre_regions(false),
+      compact_output(false),
+      dense_output(false),
+      checkpoint_steps(0),
+      checkpoint_secs(0),
+      seed(0),
+      threads(0),
+      max_trade_distance(0),
+      decay_transfer(false),
+      sparse_decay(false),
       handle(handle) {}
 
 Context::Context(Timer* ti, Recorder* rec)
     : ti_(ti),
       rec_(rec),
+      tables_(NULL),
+      built_(NULL),
       solver_(NULL),
+      coalescer_(NULL),
+      series_agg_(NULL),
+      positions_(new toolkit::SpatialIndex()),
+      max_trade_km_(0),
+      profiler_(NULL),
+      hw_counters_(NULL),
+      tracer_(NULL),
+      scheduler_(NULL),
+      threads_(0),
+      mem_period_(0),
       trans_id_(0),
-      si_(0) {}
+      decay_sweep_(!Env::GetEnv("CYCLUS_DECAY_SWEEP").empty()),
+      si_(0),
+      decay_mode_(DECAY_MANUAL) {
+  coalesce_resources(!Env::GetEnv("CYCLUS_COALESCE_RESOURCES").empty());
+}
 
 Context::~Context() {
   if (solver_ != NULL) {
     delete solver_;
   }
 
+  // materials outliving the context, e.g. held from Python, mustn't
+  // unregister themselves from it
+  {
+    std::lock_guard<std::mutex> lock(swept_mu_);
+    std::unordered_set<Material*>::iterator it;
+    for (it = swept_.begin(); it != swept_.end(); ++it) {
+      (*it)->swept_ = false;
+    }
+    swept_.clear();
+  }
+
   // initiate deletion of agents that don't have parents.
   // dealloc will propagate through hierarchy as agents delete their children
   std::vector<Agent*> to_del;
-  std::set<Agent*>::iterator it;
-  for (it = agent_list_.begin(); it != agent_list_.end(); ++it) {
-    if ((*it)->parent() == NULL) {
-      to_del.push_back(*it);
+  const std::vector<Agent*>& all = agents_.all();
+  for (int i = 0; i < all.size(); ++i) {
+    if (all[i]->parent() == NULL) {
+      to_del.push_back(all[i]);
     }
   }
   for (int i = 0; i < to_del.size(); ++i) {
     DelAgent(to_del[i]);
   }
+
+  delete coalescer_;
+  delete series_agg_;
+  delete positions_;
+  delete profiler_;
+  delete hw_counters_;
+  if (tracer_ != NULL) {
+    rec_->set_tracer(NULL);
+    delete tracer_;
+  }
+  delete tables_;
+  delete scheduler_;
+}
+
+TaskScheduler* Context::scheduler() {
+  if (scheduler_ == NULL)
+    scheduler_ = new TaskScheduler(threads_);
+  return scheduler_;
+}
+
+int Context::threads() {
+  return scheduler()->threads();
+}
+
+void Context::threads(int n) {
+  delete scheduler_;
+  scheduler_ = NULL;
+  threads_ = n;
+}
+
+void Context::coalesce_resources(bool on) {
+  if (on && coalescer_ == NULL) {
+    coalescer_ = new ResCoalescer();
+  } else if (!on && coalescer_ != NULL) {
+    coalescer_->Flush(this);
+    delete coalescer_;
+    coalescer_ = NULL;
+  }
+}
+
+void Context::SweepDecay() {
+  std::vector<Material*> mats;
+  {
+    std::lock_guard<std::mutex> lock(swept_mu_);
+    mats.assign(swept_.begin(), swept_.end());
+  }
+  // in a fixed order, so that the decayed states are recorded in the same
+  // order every run
+  std::sort(mats.begin(), mats.end(), [](Material* a, Material* b) {
+    return a->obj_id() < b->obj_id();
+  });
+  Material::DecayAll(mats, time());
+}
+
+void Context::profile_agents(bool on) {
+  delete profiler_;
+  profiler_ = on ? new AgentProfiler() : NULL;
+}
+
+void Context::count_hardware(bool on) {
+  delete hw_counters_;
+  hw_counters_ = on ? new HwCounters() : NULL;
+}
+
+void Context::sample_memory(int period) {
+  mem_period_ = period > 0 ? period : 0;
+  if (mem_period_ > 0) {
+    MemUsage::enabled(true);
+  }
+}
+
+void Context::trace(const std::string& path) {
+  Tracer* t = path.empty() ? NULL : new Tracer(path);
+  rec_->set_tracer(t);
+  delete tracer_;
+  tracer_ = t;
+}
+
+void Context::RegisterTrader(Trader* e) {
+  static const ResourceType types[] = {Material::kType, Product::kType};
+  std::lock_guard<std::mutex> lock(traders_mu_);
+  traders_.insert(e);
+  for (int i = 0; i < sizeof(types) / sizeof(types[0]); ++i) {
+    std::pair<Trader*, ResourceType> key(e, types[i]);
+    bid_commods_.erase(key);
+    if (!e->TradesResource(types[i])) {
+      type_traders_[types[i]].erase(e);
+      continue;
+    }
+    type_traders_[types[i]].insert(e);
+    std::set<std::string> commods;
+    if (e->BidCommods(types[i], &commods)) {
+      bid_commods_[key] = commods;
+    }
+  }
+}
+
+void Context::UnregisterTrader(Trader* e) {
+  std::lock_guard<std::mutex> lock(traders_mu_);
+  traders_.erase(e);
+  std::map<ResourceType, std::set<Trader*> >::iterator it;
+  for (it = type_traders_.begin(); it != type_traders_.end(); ++it) {
+    it->second.erase(e);
+    bid_commods_.erase(std::make_pair(e, it->first));
+  }
+}
+
+const std::set<Trader*>& Context::traders(const ResourceType& type) const {
+  static const std::set<Trader*> none;
+  std::map<ResourceType, std::set<Trader*> >::const_iterator it =
+      type_traders_.find(type);
+  return it == type_traders_.end() ? none : it->second;
+}
+
+const std::set<std::string>* Context::bid_commods(
+    Trader* e, const ResourceType& type) const {
+  std::map<std::pair<Trader*, ResourceType>, std::set<std::string> >::
+      const_iterator it = bid_commods_.find(std::make_pair(e, type));
+  return it == bid_commods_.end() ? NULL : &it->second;
 }
 
 void Context::DelAgent(Agent* m) {
-  int n = agent_list_.erase(m);
-  if (n == 1) {
+  if (agents_.Erase(m)) {
     PyDelAgent(m->id());
     delete m;
     m = NULL;
   }
 }
 
+std::vector<Agent*> Context::BuildAgents(std::string proto_name,
+                                         Agent* parent, int count) {
+  std::vector<Agent*> agents;
+  if (count <= 0) {
+    return agents;
+  }
+  Agent* proto = GetPrototype(proto_name);
+  agents.reserve(count);
+  agents_.Reserve(count);
+  ti_->ReserveTimeListeners(count);
+
+  // agents built by those of the batch join it, and nested batches leave
+  // their rows to the outermost one
+  std::vector<Agent*> built;
+  bool outer = built_ == NULL;
+  if (outer) {
+    built.reserve(count);
+    built_ = &built;
+  }
+  try {
+    for (int i = 0; i < count; ++i) {
+      Agent* m = proto->Clone();
+      m->Build(parent);
+      if (parent != NULL) {
+        parent->BuildNotify(m);
+      }
+      agents.push_back(m);
+    }
+  } catch (...) {
+    // the agents built before the failure stay in the simulation
+    if (outer) {
+      built_ = NULL;
+      RecordEntries(built);
+    }
+    throw;
+  }
+  if (outer) {
+    built_ = NULL;
+    RecordEntries(built);
+  }
+  return agents;
+}
+
+void Context::RecordEntries(const std::vector<Agent*>& built) {
+  TableWriter<int, std::string, std::string, std::string, int, int, int>& w =
+      tables().agent_entry;
+  for (int i = 0; i < built.size(); ++i) {
+    Agent* m = built[i];
+    w.Record(m->id(), m->kind(), m->spec(), m->prototype(), m->parent_id(),
+             m->lifetime(), m->enter_time());
+  }
+}
+
 void Context::SchedBuild(Agent* parent, std::string proto_name, int t) {
   if (t == -1) {
     t = time() + 1;
@@ -118,6 +375,22 @@ void Context::SchedBuild(Agent* parent, std::string proto_name, int t) {
       ->Record();
 }
 
+void Context::SchedBuilds(Agent* parent, std::string proto_name, int count,
+                          const std::vector<int>& times) {
+  int pid = (parent != NULL) ? parent->id() : -1;
+  ti_->SchedBuilds(parent, proto_name, count, times);
+  for (int i = 0; i < times.size(); ++i) {
+    for (int k = 0; k < count; ++k) {
+      NewDatum("BuildSchedule")
+          ->AddVal("ParentId", pid)
+          ->AddVal("Prototype", proto_name)
+          ->AddVal("SchedTime", time())
+          ->AddVal("BuildTime", times[i])
+          ->Record();
+    }
+  }
+}
+
 void Context::SchedDecom(Agent* m, int t) {
   if (t == -1) {
     t = time();
@@ -139,11 +412,13 @@ void Context::AddPrototype(std::string name, Agent* p) {
 }
 
 void Context::AddPrototype(std::string name, Agent* p, bool overwrite) {
-  if (!overwrite && protos_.find(name) != protos_.end()) {
+  if (!overwrite && (protos_.find(name) != protos_.end() ||
+                     lazy_protos_.find(name) != lazy_protos_.end())) {
     throw KeyError("Prototype name " + name + " has already been added" +
                    " and cannot be overwritten.");
   }
 
+  lazy_protos_.erase(name);
   protos_[name] = p;
   // explicit snapshot required for in situ (non-xml) prototype addition
   SimInit::SnapAgent(p);
@@ -163,19 +438,53 @@ void Context::AddPrototype(std::string name, Agent* p, bool overwrite) {
   }
 }
 
+void Context::AddLazyPrototype(std::string name,
+                               std::function<Agent*()> init) {
+  if (protos_.find(name) != protos_.end() ||
+      lazy_protos_.find(name) != lazy_protos_.end()) {
+    throw KeyError("Prototype name " + name + " has already been added" +
+                   " and cannot be overwritten.");
+  }
+  lazy_protos_[name] = init;
+}
+
+Agent* Context::GetPrototype(std::string name) {
+  std::map<std::string, Agent*>::iterator it = protos_.find(name);
+  if (it != protos_.end()) {
+    return it->second;
+  }
+
+  std::map<std::string, std::function<Agent*()> >::iterator lazy =
+      lazy_protos_.find(name);
+  if (lazy == lazy_protos_.end()) {
+    throw KeyError("Invalid prototype name " + name);
+  }
+  // the prototype's state was recorded when it was first added, so it is
+  // not recorded again
+  Agent* p = lazy->second();
+  lazy_protos_.erase(lazy);
+  protos_[name] = p;
+  return p;
+}
+
 void Context::AddRecipe(std::string name, Composition::Ptr c) {
-  recipes_[name] = c;
+  {
+    std::lock_guard<std::mutex> lock(recipes_mu_);
+    recipes_[name] = c;
+  }
   NewDatum("Recipes")
       ->AddVal("Recipe", name)
-      ->AddVal("QualId", c->id())
+      ->AddVal("QualId", comp_interner_.Intern(c.get()))
       ->Record();
 }
 
 Composition::Ptr Context::GetRecipe(std::string name) {
-  if (recipes_.count(name) == 0) {
+  std::lock_guard<std::mutex> lock(recipes_mu_);
+  std::map<std::string, Composition::Ptr>::iterator it = recipes_.find(name);
+  if (it == recipes_.end()) {
     throw KeyError("Invalid recipe name " + name);
   }
-  return recipes_[name];
+  return it->second;
 }
 
 void Context::InitSim(SimInfo si) {
@@ -187,6 +496,7 @@ void Context::InitSim(SimInfo si) {
       ->AddVal("ParentSimId", si.parent_sim)
       ->AddVal("ParentType", si.parent_type)
       ->AddVal("BranchTime", si.branch_time)
+      ->AddVal("Seed", si.seed)
       ->AddVal("CyclusVersion", std::string(version::core()))
       ->AddVal("CyclusVersionDescribe", std::string(version::describe()))
       ->AddVal("SqliteVersion", std::string(version::sqlite3()))
@@ -200,11 +510,84 @@ void Context::InitSim(SimInfo si) {
       ->AddVal("Decay", si.decay)
       ->Record();
 
+  NewDatum("InfoDecayTransfer")
+      ->AddVal("DecayTransfer", si.decay_transfer)
+      ->Record();
+
+  NewDatum("InfoSparseDecay")
+      ->AddVal("SparseDecay", si.sparse_decay)
+      ->Record();
+  SparseCram::enabled(si.sparse_decay ||
+                      !Env::GetEnv("CYCLUS_SPARSE_DECAY").empty());
+
   NewDatum("InfoExplicitInv")
       ->AddVal("RecordInventory", si.explicit_inventory)
       ->AddVal("RecordInventoryCompact", si.explicit_inventory_compact)
       ->Record();
 
+  NewDatum("InfoDreTimings")
+      ->AddVal("RecordDreTimings", si.dre_timings)
+      ->Record();
+
+  NewDatum("InfoDreRegions")
+      ->AddVal("PartitionRegions", si.dre_regions)
+      ->Record();
+
+  NewDatum("InfoDreCoarsen")
+      ->AddVal("Coarsen", si.dre_coarsen)
+      ->Record();
+
+  NewDatum("InfoCompactOutput")
+      ->AddVal("CompactOutput", si.compact_output)
+      ->Record();
+
+  NewDatum("InfoDenseOutput")
+      ->AddVal("DenseOutput", si.dense_output)
+      ->Record();
+
+  NewDatum("InfoCheckpoints")
+      ->AddVal("Steps", si.checkpoint_steps)
+      ->AddVal("Seconds", si.checkpoint_secs)
+      ->Record();
+
+  NewDatum("InfoThreads")
+      ->AddVal("Threads", si.threads)
+      ->Record();
+  threads(si.threads);
+
+  // the environment overrides the input file
+  std::string km = Env::GetEnv("CYCLUS_MAX_TRADE_DISTANCE");
+  if (!km.empty()) {
+    si.max_trade_distance = std::atof(km.c_str());
+  }
+  max_trade_distance(si.max_trade_distance);
+  NewDatum("InfoTradeDistance")
+      ->AddVal("MaxKilometers", max_trade_km_)
+      ->Record();
+
+  std::map<int, int>::const_iterator step;
+  for (step = si.step_schedule.begin(); step != si.step_schedule.end();
+       ++step) {
+    NewDatum("InfoStepSchedule")
+        ->AddVal("Start", step->first)
+        ->AddVal("Length", step->second)
+        ->Record();
+  }
+
+  delete series_agg_;
+  series_agg_ = NULL;
+  std::map<std::string, TimeSeriesAgg>::iterator ts;
+  for (ts = si.timeseries.begin(); ts != si.timeseries.end(); ++ts) {
+    NewDatum("InfoTimeSeries")
+        ->AddVal("Series", ts->first)
+        ->AddVal("Mode", ts->second.mode)
+        ->AddVal("Period", ts->second.period)
+        ->AddVal("ByInstitution", ts->second.by_institution)
+        ->Record();
+  }
+  if (!si.timeseries.empty())
+    series_agg_ = new toolkit::TimeSeriesAggregator(si.timeseries);
+
   // TODO: when the backends get uint64_t support, the static_cast here should
   // be removed.
   NewDatum("TimeStepDur")
@@ -221,13 +604,32 @@ void Context::InitSim(SimInfo si) {
       ->Record();
 
   si_ = si;
+  // the core table writers follow the output schema of the simulation
+  delete tables_;
+  tables_ = NULL;
+  if (si.decay == "never") {
+    decay_mode_ = DECAY_NEVER;
+  } else if (si.decay == "lazy") {
+    decay_mode_ = DECAY_LAZY;
+  } else {
+    decay_mode_ = DECAY_MANUAL;
+  }
   ti_->Initialize(this, si);
 }
 
+int Context::step() {
+  return ti_->step();
+}
+
 int Context::time() {
   return ti_->time();
 }
 
+RandomStream Context::random(const Agent* a, int stream) {
+  return RandomStream(static_cast<uint32_t>(si_.seed), a->id(), time(),
+                      stream);
+}
+
 void Context::RegisterTimeListener(TimeListener* tl) {
   ti_->RegisterTimeListener(tl);
 }
@@ -236,10 +638,33 @@ void Context::UnregisterTimeListener(TimeListener* tl) {
   ti_->UnregisterTimeListener(tl);
 }
 
+void Context::SleepUntil(TimeListener* tl, int t) {
+  ti_->SleepUntil(tl, t);
+}
+
+bool Context::asleep(Agent* a) {
+  return ti_->asleep(a->id());
+}
+
 Datum* Context::NewDatum(std::string title) {
   return rec_->NewDatum(title);
 }
 
+Datum* Context::NewDatum(Recorder::Table* t) {
+  return rec_->NewDatum(t);
+}
+
+Recorder::Table* Context::GetTable(const std::string& title) {
+  return rec_->GetTable(title);
+}
+
+CoreTables& Context::tables() {
+  if (tables_ == NULL) {
+    tables_ = new CoreTables(rec_, si_.compact_output, si_.dense_output);
+  }
+  return *tables_;
+}
+
 void Context::Snapshot() {
   ti_->Snapshot();
 }
@@ -248,4 +673,14 @@ void Context::KillSim() {
   ti_->KillSim();
 }
 
+void Context::RegisterObserver(SimObserver* o) {
+  if (std::find(observers_.begin(), observers_.end(), o) == observers_.end())
+    observers_.push_back(o);
+}
+
+void Context::UnregisterObserver(SimObserver* o) {
+  observers_.erase(std::remove(observers_.begin(), observers_.end(), o),
+                   observers_.end());
+}
+
 }  // namespace cyclus
@@ -1,9 +1,14 @@
 #ifndef CYCLUS_SRC_CONTEXT_H_
 #define CYCLUS_SRC_CONTEXT_H_
 
+#include <atomic>
+#include <functional>
 #include <map>
+#include <mutex>
 #include <set>
 #include <string>
+#include <unordered_set>
+#include <vector>
 #include <stdint.h>
 
 #ifndef CYCPP
@@ -15,8 +20,11 @@
 
 #include "composition.h"
 #include "agent.h"
+#include "agent_registry.h"
 #include "greedy_solver.h"
+#include "id_allocator.h"
 #include "pyhooks.h"
+#include "random_stream.h"
 #include "recorder.h"
 
 const uint64_t kDefaultTimeStepDur = 2629846;
@@ -25,14 +33,54 @@ class SimInitTest;
 
 namespace cyclus {
 
+struct CoreTables;
 class Datum;
+class AgentProfiler;
 class ExchangeSolver;
 class Recorder;
+class ResCoalescer;
+class HwCounters;
+class Material;
+class TaskScheduler;
+class Tracer;
 class Trader;
 class Timer;
 class TimeListener;
 class SimInit;
+class SimObserver;
 class DynamicModule;
+template <class T> class TradeExecutor;
+
+namespace toolkit {
+class SpatialIndex;
+class TimeSeriesAggregator;
+}
+
+/// The ways materials may be decayed, as set by SimInfo::decay.
+enum DecayMode {
+  DECAY_NEVER,  ///< materials are never decayed
+  DECAY_MANUAL,  ///< materials are decayed only when Decay is called
+  DECAY_LAZY,  ///< materials are also decayed when their comp is observed
+};
+
+/// How the values of a time series are recorded to its TimeSeries table; see
+/// toolkit::RecordTimeSeries.
+struct TimeSeriesAgg {
+  TimeSeriesAgg() : mode("all"), period(1), by_institution(false) {}
+
+  /// One of "all" (every value, the default), "sample" (only the values
+  /// recorded at every period-th time step), or "sum", "min", "max", or
+  /// "mean" (one row per window of period time steps, reducing the values
+  /// recorded in it).
+  std::string mode;
+
+  /// The number of time steps in each sample or window.
+  int period;
+
+  /// Whether windows are reduced over all the facilities of an institution,
+  /// recorded under the institution's id, rather than per agent.
+  bool by_institution;
+};
 
 /// Container for a static simulation-global parameters that both describe
 /// the simulation and affect its behavior.
@@ -78,6 +126,14 @@ class SimInfo {
   /// "manual" if use of the decay function is allowed, "never" otherwise
   std::string decay;
 
+  /// True if compositions should be decayed with precomputed decay transfer
+  /// matrices (see DecayTransfer) rather than by a full decay solve each time.
+  bool decay_transfer;
+
+  /// True if compositions should be decayed with the sparse CRAM solver (see
+  /// SparseCram). The solver is shared by all the simulations of a process.
+  bool sparse_decay;
+
   /// length of the simulation in timesteps (months)
   int duration;
 
@@ -100,6 +156,17 @@ class SimInfo {
   /// Duration in seconds of a single time step in the simulation.
   uint64_t dt;
 
+  /// The lengths, in time steps, of the steps the timer takes, keyed by the
+  /// time from which each length applies, e.g., {0: 12, 240: 1, 360: 12}
+  /// for yearly steps but for monthly ones through years 20 to 30. Times are
+  /// still counted in time steps of dt seconds, steps of n time steps
+  /// advancing time by n from one multiple of n after the key to the next,
+  /// so agents see the time jump. A step is cut short by the builds,
+  /// decommissionings and wakeups scheduled within it and by the end of the
+  /// simulation. Times before the first key, or all times if empty, are run
+  /// one time step at a time.
+  std::map<int, int> step_schedule;
+
   /// Epsilon in the simulation.
   double eps;
 
@@ -114,6 +181,61 @@ class SimInfo {
   /// every time step in a table (i.e. agent ID, Time, Quantity,
   /// Composition-object and/or reference).
   bool explicit_inventory_compact;
+
+  /// True if the time spent in each phase of every resource exchange, along
+  /// with the size of the exchange graph, should be recorded every time step
+  /// in the DreTimings table.
+  bool dre_timings;
+
+  /// True if the trades within each region should be solved before, and take
+  /// precedence over, the trades between regions (see
+  /// ExchangeManager::partition_regions).
+  bool dre_regions;
+
+  /// How the identical request groups of the requesters of each institution
+  /// are merged before solving (see ExchangeManager::coarsen): not at all if
+  /// empty, "in_order" to fill the requesters of each merged group one after
+  /// the other, or "proportional" to share its flow evenly among them.
+  std::string dre_coarsen;
+
+  /// True if the Resources and Transactions tables should be recorded in
+  /// their compact form, i.e., in the CompactResources and CompactTransactions
+  /// tables with their strings replaced by ids into lookup tables (see
+  /// ResourcesWriter and TransactionsWriter).
+  bool compact_output;
+
+  /// True if the Compositions and ExplicitInventory tables should be recorded
+  /// in their dense form, i.e., in the DenseCompositions and DenseInventory
+  /// tables with one row per composition or inventory holding the values of
+  /// all its nuclides in an array, whose positions the NuclideIndex table
+  /// maps to nuclides (see CompositionsWriter and InventoryWriter).
+  bool dense_output;
+
+  /// If positive, a checkpoint (a snapshot flushed to the output database) is
+  /// taken at the start of every this many time steps.
+  int checkpoint_steps;
+
+  /// If positive, a checkpoint is taken at the start of the first time step
+  /// that begins at least this many wall-clock seconds after the previous
+  /// one.
+  double checkpoint_secs;
+
+  /// The seed of the random streams of the agents (see Context::random), not
+  /// negative. Simulations with the same seed draw the same numbers.
+  int seed;
+
+  /// The number of threads the parallel work of the simulation is run on
+  /// (see Context::scheduler), or 0 for as many as the hardware supports.
+  int threads;
+
+  /// The farthest, in kilometers, that the requests of agents placed on the
+  /// map are offered to bidders that are also placed, or 0 if there is no
+  /// limit (see Context::max_trade_distance).
+  double max_trade_distance;
+
+  /// How each time series is recorded, keyed by series name (e.g. "Power").
+  /// Series not in the map record every value.
+  std::map<std::string, TimeSeriesAgg> timeseries;
 };
 
 /// A simulation context provides access to necessary simulation-global
@@ -133,6 +255,8 @@ class Context {
   friend class SimInit;
   friend class Agent;
   friend class Timer;
+  friend class Material;
+  template <class T> friend class TradeExecutor;
 
   /// Creates a new context working with the specified timer and datum manager.
   /// The timer does not have to be initialized (yet).
@@ -156,33 +280,47 @@ class Context {
   void AddPrototype(std::string name, Agent* m, bool overwrite);
   /// @}
 
+  /// Adds a prototype whose state has already been recorded, deferring its
+  /// construction and initialization by init until it is first used (e.g.
+  /// by CreateAgent). Its state is not recorded again.
+  /// @throws if a prototype name has already been added
+  void AddLazyPrototype(std::string name, std::function<Agent*()> init);
+
+  /// Returns the named prototype, initializing it first if it was added
+  /// lazily.
+  /// @throws KeyError if no prototype of that name has been added
+  Agent* GetPrototype(std::string name);
+
   /// Registers an agent as a participant in resource exchanges. Agents should
-  /// register from their Deploy method.
-  inline void RegisterTrader(Trader* e) {
-    traders_.insert(e);
-  }
+  /// register from their Deploy method. The resource types and commodities
+  /// the trader takes part in (see Trader::TradesResource and
+  /// Trader::BidCommods) are asked for now; registering a trader again asks
+  /// for them afresh.
+  void RegisterTrader(Trader* e);
 
   /// Unregisters an agent as a participant in resource exchanges.
-  inline void UnregisterTrader(Trader* e) {
-    traders_.erase(e);
-  }
+  void UnregisterTrader(Trader* e);
 
   /// @return the current set of traders registered for resource exchange.
   inline const std::set<Trader*>& traders() const {
     return traders_;
   }
 
+  /// @return the traders registered for exchanges of resources of a type.
+  const std::set<Trader*>& traders(const ResourceType& type) const;
+
+  /// @return the commodities of resources of a type that a registered
+  /// trader bids on, or NULL if it may bid on any (see Trader::BidCommods).
+  const std::set<std::string>* bid_commods(Trader* e,
+                                           const ResourceType& type) const;
+
   /// Create a new agent by cloning the named prototype. The returned agent is
   /// not initialized as a simulation participant.
   ///
   /// @warning this method should generally NOT be used by agents.
   template <class T>
   T* CreateAgent(std::string proto_name) {
-    if (protos_.count(proto_name) == 0) {
-      throw KeyError("Invalid prototype name " + proto_name);
-    }
-
-    Agent* m = protos_[proto_name];
+    Agent* m = GetPrototype(proto_name);
     T* casted(NULL);
     Agent* clone = m->Clone();
     casted = dynamic_cast<T*>(clone);
@@ -194,6 +332,18 @@ class Context {
     return casted;
   }
 
+  /// Builds count agents of the named prototype for parent, as though each
+  /// were created by CreateAgent, built, and its parent notified of it in
+  /// turn, and returns them in the order built. The prototype is looked up
+  /// once, the agent registry and the timer make room for the whole batch up
+  /// front, and the AgentEntry rows of the batch are recorded together once
+  /// it is built, so that initial fleets of thousands of identical
+  /// facilities load quickly.
+  ///
+  /// @warning this method should generally NOT be used by agents.
+  std::vector<Agent*> BuildAgents(std::string proto_name, Agent* parent,
+                                  int count);
+
   /// Destructs and cleans up m (and it's children recursively).
   ///
   /// @warning this method should generally NOT be used by agents.
@@ -204,6 +354,13 @@ class Context {
   /// next build phase (i.e. the start of the next timestep).
   void SchedBuild(Agent* parent, std::string proto_name, int t = -1);
 
+  /// Schedules count agents of the named prototype to be built for the
+  /// specified parent at each of the given timesteps. This is the same as
+  /// calling SchedBuild count times for each timestep, but much cheaper for
+  /// large deployment schedules.
+  void SchedBuilds(Agent* parent, std::string proto_name, int count,
+                   const std::vector<int>& times);
+
   /// Schedules the given Agent to be decommissioned at the specified timestep
   /// t. The default t=-1 results in the decommission being scheduled for the
   /// next decommission phase (i.e. the end of the current timestep).
@@ -227,6 +384,14 @@ class Context {
   /// Agents should unregister from their Decommission method.
   void UnregisterTimeListener(TimeListener* tl);
 
+  /// Puts a registered time listener to sleep until timestep t; see
+  /// Timer::SleepUntil. Agents with nothing to do for a while should sleep
+  /// rather than return early from every Tick and Tock.
+  void SleepUntil(TimeListener* tl, int t);
+
+  /// Returns true if the agent is a time listener that is asleep.
+  bool asleep(Agent* a);
+
   /// Initializes the simulation time parameters. Should only be called once -
   /// NOT idempotent.
   void InitSim(SimInfo si);
@@ -235,16 +400,180 @@ class Context {
   virtual int time();
 
   /// Returns the duration of a single time step in seconds.
-  inline uint64_t dt() {return si_.dt;};
-
-  /// Return static simulation info.
-  inline SimInfo sim_info() const {
+  inline uint64_t dt() const {return si_.dt;};
+
+  /// Returns the length, in time steps, of the current step of the timer,
+  /// i.e., the time the next step starts at less the current time (see
+  /// SimInfo::step_schedule). It is 1 unless the simulation has a step
+  /// schedule, and may be cut short by builds, decommissionings and wakeups
+  /// scheduled during the step. Agents doing per time step work, e.g.,
+  /// producing material, should do step() times as much.
+  int step();
+
+  /// Returns the length of the current step of the timer in seconds.
+  inline uint64_t step_secs() { return step() * dt(); }
+
+  /// Returns the duration of the simulation in time steps.
+  inline int duration() const {return si_.duration;};
+
+  /// Returns the decay mode, parsed from SimInfo::decay once by InitSim.
+  inline DecayMode decay_mode() const {return decay_mode_;};
+
+  /// Returns whether the simulation's compositions are decayed with the
+  /// DecayTransfer matrices (see SimInfo::decay_transfer).
+  inline bool decay_transfer() const {return si_.decay_transfer;};
+
+  /// Returns whether, in lazy decay mode, the materials alive at the end of
+  /// each Tick are all decayed to the current time in one batch (see
+  /// Material::DecayAll), so that reading them during the rest of the time
+  /// step needs no decay. Defaults to whether the CYCLUS_DECAY_SWEEP
+  /// environment variable is set. Only materials created while it is on are
+  /// swept, so it should be set before the simulation starts.
+  inline bool decay_sweep() const { return decay_sweep_; }
+  inline void decay_sweep(bool on) { decay_sweep_ = on; }
+
+  /// Decays the materials swept by decay_sweep to the current time in one
+  /// batch. Called by the timer at the end of each Tick.
+  void SweepDecay();
+
+  /// Returns the random stream of agent a for the current time step, keyed
+  /// by the seed of the simulation (see SimInfo::seed), a's id, the time
+  /// step, and stream. The numbers an agent draws thus depend on nothing but
+  /// these, e.g., not on the order in which agents run, or on their threads,
+  /// so simulations with the same seed draw the same numbers. Since the same
+  /// arguments give the same numbers, an agent drawing from more than one
+  /// stream in a time step should number them.
+  RandomStream random(const Agent* a, int stream = 0);
+
+  /// Return static simulation info. Frequently run code should prefer the
+  /// dt, duration, decay_mode, and decay_transfer accessors.
+  inline const SimInfo& sim_info() const {
     return si_;
   }
 
   /// See Recorder::NewDatum documentation.
   Datum* NewDatum(std::string title);
 
+  /// Creates a new datum for a table, skipping the title lookup. See
+  /// Recorder::NewDatum documentation.
+  Datum* NewDatum(Recorder::Table* t);
+
+  /// Returns the table of a title, for creating its datums without looking
+  /// up their title each time. See Recorder::GetTable documentation.
+  Recorder::Table* GetTable(const std::string& title);
+
+  /// Returns typed writers for the fixed-schema tables recorded by the
+  /// kernel (Transactions, Resources, etc.).
+  CoreTables& tables();
+
+  /// Returns the interner giving compositions with the same content a single
+  /// QualId in this simulation's output.
+  inline CompInterner& comp_interner() { return comp_interner_; }
+
+  /// Returns the allocator handing out the ids of this simulation's agents,
+  /// resources, and product qualities.
+  inline IdAllocator& ids() { return ids_; }
+
+  /// Returns the coalescer that resource trackers buffer their records in,
+  /// or NULL if every resource state is recorded right away (the default).
+  /// Coalescing is turned on by setting the CYCLUS_COALESCE_RESOURCES
+  /// environment variable; the timer flushes the coalescer at the end of
+  /// every time step.
+  inline ResCoalescer* coalescer() { return coalescer_; }
+
+  /// Turns coalesced resource tracking on or off, flushing any buffered
+  /// records when turning it off.
+  void coalesce_resources(bool on);
+
+  /// Returns the profiler timing the phase calls and exchange callbacks of
+  /// agents, or NULL if they aren't profiled (the default).
+  inline AgentProfiler* profiler() { return profiler_; }
+
+  /// Turns agent profiling on or off. Turning it on again starts afresh.
+  void profile_agents(bool on);
+
+  /// Returns the hardware counters that the phases of each time step and
+  /// resource exchange are counted with, or NULL if they aren't counted (the
+  /// default).
+  inline HwCounters* hw_counters() { return hw_counters_; }
+
+  /// Turns counting the hardware events of each phase on or off. Turning it
+  /// on again starts afresh.
+  void count_hardware(bool on);
+
+  /// Returns the tracer that the phases of the simulation are traced to, or
+  /// NULL if they aren't traced (the default).
+  inline Tracer* tracer() { return tracer_; }
+
+  /// Traces the phases of the simulation, and the writes of the recorder,
+  /// to a Chrome trace-event JSON file at path, which the timer writes at
+  /// the end of the simulation. An empty path turns tracing off.
+  void trace(const std::string& path);
+
+  /// Returns the scheduler that the parallel work of the simulation is run
+  /// on, which archetypes may run theirs on too. It is created as it is
+  /// first needed.
+  TaskScheduler* scheduler();
+
+  /// @brief the number of threads the scheduler runs work on, which the
+  /// threads control parameter sets, or the --threads command line option.
+  /// Setting it replaces the scheduler, so it must not be running any work.
+  /// @{
+  int threads();
+  void threads(int n);
+  /// @}
+
+  /// Returns the number of time steps between the samples of memory usage
+  /// that the timer records, or 0 if memory usage isn't sampled (the
+  /// default).
+  inline int memory_period() const { return mem_period_; }
+
+  /// Records the counts of MemUsage to the MemoryUsage table every period
+  /// time steps, turning counting on. A period of 0 stops sampling.
+  void sample_memory(int period);
+
+  /// Returns the aggregator of the time series that aren't recorded value by
+  /// value (see SimInfo::timeseries), or NULL if there are none. The timer
+  /// records the windows that have ended at the end of every time step.
+  inline toolkit::TimeSeriesAggregator* series_aggregator() {
+    return series_agg_;
+  }
+
+  /// Returns the index of the positions of the agents that have placed
+  /// themselves on the map. The resource exchange uses it to limit the
+  /// distance requests are offered over (see max_trade_distance). Agents are
+  /// removed from it as they are deleted.
+  inline toolkit::SpatialIndex& positions() { return *positions_; }
+
+  /// Returns the farthest, in kilometers, that the requests of agents placed
+  /// on the map (see positions) are offered to bidders that are also placed,
+  /// or 0 if there is no limit (the default). Requests of unplaced agents
+  /// are offered to every bidder, and unplaced bidders are offered every
+  /// request. The limit is set by InitSim from SimInfo::max_trade_distance,
+  /// or from the CYCLUS_MAX_TRADE_DISTANCE environment variable, which
+  /// overrides it.
+  inline double max_trade_distance() const { return max_trade_km_; }
+
+  /// Sets the farthest that requests are offered, in kilometers. Distances
+  /// of 0 or less remove the limit.
+  inline void max_trade_distance(double km) {
+    max_trade_km_ = km > 0 ? km : 0;
+  }
+
+  /// Registers an observer that the timer notifies as time steps and their
+  /// phases begin and end. The context doesn't own the observer, which must
+  /// be unregistered or outlive the simulation.
+  void RegisterObserver(SimObserver* o);
+
+  /// Stops notifying an observer. Observers may unregister themselves while
+  /// they are notified.
+  void UnregisterObserver(SimObserver* o);
+
+  /// Returns the registered observers, in the order they were registered.
+  inline const std::vector<SimObserver*>& observers() const {
+    return observers_;
+  }
+
   /// Schedules a snapshot of simulation state to output database to occur at
   /// the beginning of the next timestep.
   void Snapshot();
@@ -257,6 +586,9 @@ class Context {
     return trans_id_++;
   }
 
+  /// Returns the number of transactions made so far.
+  inline int ntransactions() const { return trans_id_; }
+
   /// Returns the exchange solver associated with this context
   ExchangeSolver* solver() {
     if (solver_ == NULL) {
@@ -283,35 +615,121 @@ class Context {
     return n_specs_[impl];
   }
 
+  /// @return every agent of the simulation, including prototypes and
+  /// agents not yet built, in no particular order
+  inline const std::vector<Agent*>& agents() const { return agents_.all(); }
+
+  /// @return the agents currently in the simulation, in no particular order
+  inline const std::vector<Agent*>& live_agents() const {
+    return agents_.live();
+  }
+
+  /// @return the agents of a given kind (e.g., "Facility") currently in the
+  /// simulation
+  inline const std::vector<Agent*>& AgentsOfKind(
+      const std::string& kind) const {
+    return agents_.OfKind(kind);
+  }
+
+  /// @return the agents of a given prototype currently in the simulation
+  inline const std::vector<Agent*>& AgentsOfPrototype(
+      const std::string& prototype) const {
+    return agents_.OfPrototype(prototype);
+  }
+
+  /// @return the agents of a given implementation currently in the
+  /// simulation
+  inline const std::vector<Agent*>& AgentsOfSpec(
+      const std::string& impl) const {
+    return agents_.OfSpec(impl);
+  }
+
  private:
   /// Registers an agent as a participant in the simulation.
   inline void RegisterAgent(Agent* a) {
     n_prototypes_[a->prototype()]++;
     n_specs_[a->spec()]++;
+    agents_.Enter(a);
   }
 
   /// Unregisters an agent as a participant in the simulation.
   inline void UnregisterAgent(Agent* a) {
     n_prototypes_[a->prototype()]--;
     n_specs_[a->spec()]--;
+    agents_.Exit(a);
   }
 
+  /// Records the AgentEntry rows of agents deferred by BuildAgents.
+  void RecordEntries(const std::vector<Agent*>& built);
+
   /// contains archetype specs of all agents for which version have already
   /// been recorded in the db
   std::set<std::string> rec_ver_;
 
+  /// the serialized state of each agent as of its last recorded delta
+  /// snapshot, and the time it was recorded, keyed by agent id
+  std::map<int, std::pair<std::string, int> > snap_states_;
+
+  /// the resource states in each inventory as of the delta snapshot its
+  /// rows were last recorded in, and the time of that snapshot, keyed by
+  /// agent id and inventory name
+  std::map<std::pair<int, std::string>, std::pair<std::vector<int>, int> >
+      snap_invs_;
+
+  /// the serialized kernel state and inventories of each agent as of its
+  /// last delta snapshot, keyed by agent id, which tells along with
+  /// Agent::SnapshotDirty whether its state can have changed since
+  std::map<int, std::string> snap_kernel_;
+
   std::map<std::string, Agent*> protos_;
+  /// prototypes not yet initialized, keyed by name
+  std::map<std::string, std::function<Agent*()> > lazy_protos_;
   std::map<std::string, Composition::Ptr> recipes_;
-  std::set<Agent*> agent_list_;
+  /// every agent, indexed for the lookups above
+  AgentRegistry agents_;
   std::set<Trader*> traders_;
+  /// the traders taking part in the exchanges of each resource type
+  std::map<ResourceType, std::set<Trader*> > type_traders_;
+  /// the commodities of each resource type that each trader that names them
+  /// bids on
+  std::map<std::pair<Trader*, ResourceType>, std::set<std::string> >
+      bid_commods_;
+  /// guard the recipes and traders, which time listeners running
+  /// concurrently may add
+  std::mutex recipes_mu_;
+  std::mutex traders_mu_;
   std::map<std::string, int> n_prototypes_;
   std::map<std::string, int> n_specs_;
 
   SimInfo si_;
+  DecayMode decay_mode_;
   Timer* ti_;
   ExchangeSolver* solver_;
   Recorder* rec_;
-  int trans_id_;
+  CoreTables* tables_;
+  /// the agents built so far by BuildAgents, whose AgentEntry rows are yet
+  /// to be recorded, or NULL outside of it
+  std::vector<Agent*>* built_;
+  CompInterner comp_interner_;
+  IdAllocator ids_;
+  ResCoalescer* coalescer_;
+  toolkit::TimeSeriesAggregator* series_agg_;
+  toolkit::SpatialIndex* positions_;
+  double max_trade_km_;
+  AgentProfiler* profiler_;
+  HwCounters* hw_counters_;
+  Tracer* tracer_;
+  TaskScheduler* scheduler_;
+  int threads_;
+  std::vector<SimObserver*> observers_;
+  bool decay_sweep_;
+
+  /// the materials to sweep, which register themselves as they are created
+  /// and may be created by agents ticking on many threads
+  std::mutex swept_mu_;
+  std::unordered_set<Material*> swept_;
+  int mem_period_;
+  std::atomic<int> trans_id_;
 };
 
 }  // namespace cyclus
@@ -6,6 +6,7 @@
 #include "bid.h"
 #include "bid_portfolio.h"
 #include "capacity_constraint.h"
+#include "column_store.h"
 #include "comp_math.h"
 #include "composition.h"
 #include "context.h"
@@ -28,6 +29,7 @@ extern "C" {
 #include "logger.h"
 #include "material.h"
 #include "mock_sim.h"
+#include "nuc_registry.h"
 #include "agent.h"
 #include "pyhooks.h"
 #include "pyne.h"
@@ -38,7 +40,9 @@ extern "C" {
 #include "request.h"
 #include "request_portfolio.h"
 #include "resource.h"
+#include "sim_observer.h"
 #include "state_wrangler.h"
+#include "task_scheduler.h"
 #include "time_listener.h"
 #include "trade.h"
 #include "trader.h"
@@ -9,36 +9,67 @@ namespace cyclus {
 typedef boost::singleton_pool<Datum, sizeof(Datum)> DatumPool;
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-Datum* Datum::AddValBase(const char* field, boost::spirit::hold_any val,
-                         std::vector<int>* shape) {
-  vals_.push_back(std::pair<const char*, boost::spirit::hold_any>(field, val));
-  std::vector<int> s;
+boost::spirit::hold_any* Datum::NextSlot(const char* field,
+                                         std::vector<int>* shape) {
+  if (n_ == vals_.size()) {
+    vals_.push_back(Entry(field, boost::spirit::hold_any()));
+    fields_.push_back(std::string());
+    shapes_.push_back(Shape());
+  }
+
+  Entry& e = vals_[n_];
+  e.first = field;
+  fields_[n_] = field;
   if (shape == NULL)
-    shapes_.push_back(s);
+    shapes_[n_].clear();
   else
-    shapes_.push_back(*shape);
-  return this;
+    shapes_[n_] = *shape;
+  n_++;
+  return &e.second;
+}
+
+const char* Datum::InternField(const std::string& field) {
+  return manager_->Intern(field);
+}
+
+void Datum::Trim() {
+  if (n_ < vals_.size()) {
+    vals_.resize(n_);
+    shapes_.resize(n_);
+    fields_.resize(n_);
+  }
 }
 
 Datum* Datum::AddVal(const char* field, boost::spirit::hold_any val,
                      std::vector<int>* shape) {
-  fields_.push_back(std::string(field));
-  return AddValBase(field, val, shape);
+  if (skip_)
+    return this;
+  *NextSlot(field, shape) = std::move(val);
+  return this;
 }
 
 Datum* Datum::AddVal(std::string field, boost::spirit::hold_any val,
                      std::vector<int>* shape) {
-  fields_.push_back(field);
-  return AddValBase(field.c_str(), val, shape);
+  if (skip_)
+    return this;
+  return AddVal(InternField(field), val, shape);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Datum::Record() {
+  if (skip_)
+    return;
+  Trim();
   manager_->AddDatum(this);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-Datum::Datum(Recorder* m, std::string title) : title_(title), manager_(m) {
+Datum::Datum(Recorder* m, std::string title)
+    : title_(title),
+      manager_(m),
+      table_(NULL),
+      n_(0),
+      skip_(false) {
   // The (vect) size to reserve is chosen to be just bigger than most/all cyclus
   // core tables.  This prevents extra reallocations in the underlying
   // vector as vals are added to the datum.
@@ -50,7 +81,7 @@ Datum::Datum(Recorder* m, std::string title) : title_(title), manager_(m) {
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Datum::~Datum() {}
 
-std::string Datum::title() {
+const std::string& Datum::title() {
   return title_;
 }
 
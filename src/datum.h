@@ -6,14 +6,16 @@
 #include <vector>
 
 #include "any.hpp"
+#include "mem_usage.h"
 #include "recorder.h"
 
 namespace cyclus {
 
 /// Used to specify and send a collection of key-value pairs to the
 /// Recorder for recording.
-class Datum {
+class Datum : private MemCounted<Datum, MemUsage::DATUM> {
   friend class Recorder;
+  friend class DatumGroups;
 
  public:
   typedef std::pair<const char*, boost::spirit::hold_any> Entry;
@@ -51,13 +53,49 @@ class Datum {
   Datum* AddVal(std::string field, boost::spirit::hold_any val,
                 std::vector<int>* shape = NULL);
 
+  /// Typed variants of AddVal that copy val directly into the storage left
+  /// behind by a previous use of this (recycled) datum rather than boxing it
+  /// into a temporary hold_any first.  Field names passed as std::string are
+  /// interned by the recorder.
+  /// \{
+  template <typename T>
+  Datum* AddVal(const char* field, const T& val,
+                std::vector<int>* shape = NULL) {
+    if (skip_)
+      return this;
+    boost::spirit::hold_any* slot = NextSlot(field, shape);
+    T* x = boost::spirit::any_cast<T>(slot);
+    if (x != NULL) {
+      *x = val;
+    } else {
+      *slot = val;
+    }
+    return this;
+  }
+
+  template <typename T>
+  Datum* AddVal(std::string field, const T& val,
+                std::vector<int>* shape = NULL) {
+    if (skip_)
+      return this;
+    return AddVal(InternField(field), val, shape);
+  }
+
+  Datum* AddVal(const char* field, const char* val,
+                std::vector<int>* shape = NULL) {
+    if (skip_)
+      return this;
+    return AddVal(field, std::string(val), shape);
+  }
+  /// \}
+
   /// Record this datum to its Recorder. Recorded Datum objects of the same
   /// title (e.g. same table) must not contain any fields that were not
   /// present in the first datum recorded of that title.
   void Record();
 
   /// Returns the datum's title as specified during the datum's creation.
-  std::string title();
+  const std::string& title();
 
   /// Returns a vector of all field-value pairs that have been added to this datum.
   const Vals& vals();
@@ -76,14 +114,30 @@ class Datum {
   /// Datum objects should generally not be created using a constructor (i.e.
   /// use the recorder interface).
   Datum(Recorder* m, std::string title);
-  Datum* AddValBase(const char* field, boost::spirit::hold_any val,
-                    std::vector<int>* shape = NULL);
+
+  /// Returns the value slot for the next field, reusing the entry (and its
+  /// value storage) from the previous use of this datum if there is one.
+  boost::spirit::hold_any* NextSlot(const char* field, std::vector<int>* shape);
+
+  /// Returns a stable pointer for field owned by the recorder.
+  const char* InternField(const std::string& field);
+
+  /// Drops entries left over from a previous use of this datum that were not
+  /// overwritten.
+  void Trim();
 
   Recorder* manager_;
+  Recorder::Table* table_;
   std::string title_;
   Vals vals_;
   Shapes shapes_;
   Fields fields_;
+
+  /// number of entries added since this datum was (re)issued.
+  size_t n_;
+
+  /// whether this is the no-op datum of a table filtered out by the recorder.
+  bool skip_;
 };
 
 }  // namespace cyclus
@@ -6,6 +6,8 @@
 #include "env.h"
 #include "error.h"
 #include "logger.h"
+#include "nuc_image.h"
+#include "nuc_registry.h"
 #include "uniform_taylor.h"
 
 namespace cyclus {
@@ -61,12 +63,22 @@ void Decayer::AddNucToMaps(int nuc) {
     return;
 
   col = parent_.size() + 1;
-  parent_[nuc] = std::make_pair(col, pyne::decay_const(nuc));
+  parent_[nuc] = std::make_pair(col, NucRegistry::Instance().DecayConst(nuc));
   AddNucToList(nuc);
 
+  std::vector< std::pair<int, double> > dvec;
+  NucImage* img = NucImage::Instance();
+  if (img != NULL && img->Branches(nuc, &dvec)) {
+    for (i = 0; i < dvec.size(); i++) {
+      AddNucToMaps(dvec[i].first);
+    }
+    daughters_[col] = dvec;
+    return;
+  }
+
   i = 0;
   daughters = pyne::decay_children(nuc);
-  std::vector< std::pair<int, double> > dvec(daughters.size());
+  dvec.resize(daughters.size());
   for (d = daughters.begin(); d != daughters.end(); ++d) {
     daughter = *d;
     AddNucToMaps(daughter);
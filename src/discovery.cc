@@ -1,7 +1,10 @@
 #include "discovery.h"
 
+#include <algorithm>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <sstream>
 #include <streambuf>
 #include <vector>
 
@@ -17,6 +20,7 @@
 #include "platform.h"
 #include "recorder.h"
 #include "timer.h"
+#include "version.h"
 
 namespace cyclus {
 
@@ -77,11 +81,88 @@ std::set<std::string> DiscoverSpecs(std::string p, std::string lib) {
   return specs;
 }
 
-std::set<std::string> DiscoverSpecsInDir(std::string d) {
+namespace {
+
+namespace fs = boost::filesystem;
+
+// Returns the file that indexes what was discovered in directory d, or an
+// empty path if the CYCLUS_DISCOVERY_CACHE environment variable is unset.
+fs::path IndexPath(const std::string& d) {
+  std::string cache = Env::GetEnv("CYCLUS_DISCOVERY_CACHE");
+  if (cache.empty()) {
+    return fs::path();
+  }
+  fs::path abs = fs::absolute(d);
+  std::stringstream name;
+  name << "discovery-" << std::hex << std::hash<std::string>()(abs.string())
+       << ".json";
+  return fs::path(cache) / name.str();
+}
+
+// Reads the index of directory d. An empty index is returned if there is
+// none or if it was written for another directory or version of cyclus.
+Json::Value LoadIndex(const fs::path& f, const std::string& d) {
+  Json::Value index(Json::objectValue);
+  if (f.empty()) {
+    return index;
+  }
+  std::ifstream in(f.string().c_str());
+  Json::Reader reader;
+  if (!in || !reader.parse(in, index, false) || !index.isObject() ||
+      index["dir"].asString() != fs::absolute(d).string() ||
+      index["version"].asString() != version::core()) {
+    index = Json::Value(Json::objectValue);
+  }
+  return index;
+}
+
+// Writes the index of directory d. It is written under a temporary name and
+// then moved into place so that concurrent readers never see a partial
+// index; failures leave any existing index unchanged.
+void SaveIndex(const fs::path& f, const std::string& d, Json::Value libs) {
+  if (f.empty()) {
+    return;
+  }
+  Json::Value index(Json::objectValue);
+  index["dir"] = fs::absolute(d).string();
+  index["version"] = version::core();
+  index["libs"] = libs;
+
+  boost::system::error_code errc;
+  fs::create_directories(f.parent_path(), errc);
+  fs::path tmp = f;
+  tmp += "." + fs::unique_path().string();
+  {
+    std::ofstream out(tmp.string().c_str());
+    out << Json::FastWriter().write(index);
+    if (!out) {
+      fs::remove(tmp, errc);
+      return;
+    }
+  }
+  fs::rename(tmp, f, errc);
+  if (errc) {
+    fs::remove(tmp, errc);
+  }
+}
+
+// Identifies the version of a library file that was scanned.
+std::string LibStamp(const fs::path& lib) {
+  boost::system::error_code errc;
+  std::stringstream ss;
+  ss << fs::last_write_time(lib, errc) << ":" << fs::file_size(lib, errc);
+  return ss.str();
+}
+
+// Finds every module library in directory d and returns an entry for each,
+// keyed by the library's path, that holds its stamp and archetype specs
+// along with any cached metadata. Entries of old whose stamps still match
+// are reused rather than rescanned. changed is set if any entry differs from
+// old.
+Json::Value IndexDir(std::string d, Json::Value& old, bool* changed) {
   using std::string;
   using std::set;
-  namespace fs = boost::filesystem;
-  set<string> specs;
+  Json::Value libs(Json::objectValue);
   set<string> libspecs;
   fs::path pth;
   boost::system::error_code errc;
@@ -110,6 +191,13 @@ std::set<std::string> DiscoverSpecsInDir(std::string d) {
     } else if (!boost::algorithm::ends_with(pthstr, SUFFIX)) {
       continue;
     }
+
+    string stamp = LibStamp(pth);
+    if (old.isMember(pthstr) && old[pthstr]["stamp"].asString() == stamp) {
+      libs[pthstr] = old[pthstr];
+      continue;
+    }
+
     string p = pth.parent_path().string();
     string lib = pth.filename().string();
     if (d.length() < p.length())
@@ -117,11 +205,43 @@ std::set<std::string> DiscoverSpecsInDir(std::string d) {
     else
       p = "";
     lib = lib.substr(3, lib.rfind(".") - 3);  // remove 'lib' prefix and suffix
+    libspecs.clear();
     try {
       libspecs = DiscoverSpecs(p, lib);
     } catch (cyclus::IOError& e) {}
+
+    Json::Value entry(Json::objectValue);
+    entry["stamp"] = stamp;
+    entry["specs"] = Json::Value(Json::arrayValue);
     for (set<string>::iterator ls = libspecs.begin(); ls != libspecs.end(); ++ls) {
-      specs.insert(*ls);
+      entry["specs"].append(*ls);
+    }
+    libs[pthstr] = entry;
+    *changed = true;
+  }
+  if (libs.size() != old.size()) {
+    *changed = true;  // libraries were removed
+  }
+  return libs;
+}
+
+}  // namespace
+
+std::set<std::string> DiscoverSpecsInDir(std::string d) {
+  fs::path f = IndexPath(d);
+  Json::Value old = LoadIndex(f, d)["libs"];
+  bool changed = false;
+  Json::Value libs = IndexDir(d, old, &changed);
+  if (changed) {
+    SaveIndex(f, d, libs);
+  }
+
+  std::set<std::string> specs;
+  std::vector<std::string> paths = libs.getMemberNames();
+  for (int i = 0; i < paths.size(); ++i) {
+    Json::Value& libspecs = libs[paths[i]]["specs"];
+    for (int j = 0; j < libspecs.size(); ++j) {
+      specs.insert(libspecs[j].asString());
     }
   }
   return specs;
@@ -144,7 +264,6 @@ std::set<std::string> DiscoverSpecsInCyclusPath() {
 }
 
 Json::Value DiscoverMetadataInCyclusPath() {
-  std::set<std::string> specs = cyclus::DiscoverSpecsInCyclusPath();
   Json::Value root(Json::objectValue);
   Json::Value spec(Json::arrayValue);
   Json::Value anno(Json::objectValue);
@@ -152,19 +271,49 @@ Json::Value DiscoverMetadataInCyclusPath() {
   Recorder rec;
   Timer ti;
   Context* ctx = new Context(&ti, &rec);
-  std::string s;
-  std::set<std::string>::iterator it;
-
-  for (it = specs.begin(); it != specs.end(); ++it) {
-    s = *it;
-    Agent* m = DynamicModule::Make(ctx, s);
-    spec.append(s);
-    anno[s] = m->annotations();
-    schm[s] = m->schema();
-    ctx->DelAgent(m);
+
+  // specs are looked up along CYCLUS_PATH in order, so the metadata of a spec
+  // found in several directories comes from the first of them
+  std::vector<std::string> cycpath = Env::cyclus_path();
+  for (int i = 0; i < cycpath.size(); ++i) {
+    std::string d = cycpath[i].length() == 0 ? "." : cycpath[i];
+    fs::path f = IndexPath(d);
+    Json::Value old = LoadIndex(f, d)["libs"];
+    bool changed = false;
+    Json::Value libs = IndexDir(d, old, &changed);
+
+    std::vector<std::string> paths = libs.getMemberNames();
+    for (int j = 0; j < paths.size(); ++j) {
+      Json::Value& entry = libs[paths[j]];
+      Json::Value& libspecs = entry["specs"];
+      for (int k = 0; k < libspecs.size(); ++k) {
+        std::string s = libspecs[k].asString();
+        if (anno.isMember(s)) {
+          continue;
+        }
+        if (!entry["annotations"].isMember(s) || !entry["schema"].isMember(s)) {
+          Agent* m = DynamicModule::Make(ctx, s);
+          entry["annotations"][s] = m->annotations();
+          entry["schema"][s] = m->schema();
+          ctx->DelAgent(m);
+          changed = true;
+        }
+        anno[s] = entry["annotations"][s];
+        schm[s] = entry["schema"][s];
+      }
+    }
+    if (changed) {
+      SaveIndex(f, d, libs);
+    }
   }
   delete ctx;
 
+  std::vector<std::string> specs = anno.getMemberNames();
+  std::sort(specs.begin(), specs.end());
+  for (int i = 0; i < specs.size(); ++i) {
+    spec.append(specs[i]);
+  }
+
   root["specs"] = spec;
   root["annotations"] = anno;
   root["schema"] = schm;
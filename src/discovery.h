@@ -22,6 +22,9 @@ std::set<std::string> DiscoverArchetypes(const std::string s);
 std::set<std::string> DiscoverSpecs(std::string p, std::string lib);
 
 /// Discover archetype specifications that live recursively in modules in a dir.
+/// If the CYCLUS_DISCOVERY_CACHE environment variable names a directory, what
+/// is found is indexed there and only libraries whose modification time or
+/// size has changed since are rescanned.
 std::set<std::string> DiscoverSpecsInDir(std::string d);
 
 /// Discover archetype specifications that live recursively in CYCLUS_PATH directories.
@@ -34,6 +37,8 @@ std::set<std::string> DiscoverSpecsInCyclusPath();
 ///   "annotations": {"<spec1>": <annotation dict1>, ...},
 ///   "schema": {"<spec1>": "<schema1>"}
 ///  }
+/// The annotations and schemas are indexed along with the specs, so unchanged
+/// libraries are not loaded again when CYCLUS_DISCOVERY_CACHE is set.
 Json::Value DiscoverMetadataInCyclusPath();
 
 }  // namespace cyclus
@@ -7,6 +7,7 @@
 #include "context.h"
 #include "env.h"
 #include "agent.h"
+#include "exchange_solver.h"
 #include "platform.h"
 #include "pyhooks.h"
 
@@ -50,7 +51,7 @@ AgentSpec::AgentSpec(std::string str_spec) {
   alias_ = agent_;
 }
 
-std::string AgentSpec::Sanitize() {
+std::string AgentSpec::Sanitize() const {
   std::string s = str();
   boost::replace_all(s, "/", "_");
   boost::replace_all(s, "-", "_");
@@ -63,12 +64,14 @@ std::string AgentSpec::LibPath() {
   return (fs::path(path_) / fs::path("lib" + lib_ + SUFFIX)).string();
 }
 
-std::string AgentSpec::str() {
+std::string AgentSpec::str() const {
   return path_ + ":" + lib_ + ":" + agent_;
 }
 
 std::map<std::string, DynamicModule*> DynamicModule::modules_;
 std::map<std::string, AgentCtor*> DynamicModule::man_ctors_;
+std::map<std::string, DynamicModule*> DynamicModule::solver_modules_;
+std::map<std::string, SolverCtor*> DynamicModule::man_solver_ctors_;
 
 Agent* DynamicModule::Make(Context* ctx, AgentSpec spec) {
   if (man_ctors_.count(spec.str()) > 0) {  // for testing
@@ -94,6 +97,22 @@ Agent* DynamicModule::Make(Context* ctx, AgentSpec spec) {
   return a;
 }
 
+ExchangeSolver* DynamicModule::MakeSolver(AgentSpec spec,
+                                          bool exclusive_orders,
+                                          std::string options) {
+  SolverCtor* ctor;
+  if (man_solver_ctors_.count(spec.str()) > 0) {  // for testing
+    ctor = man_solver_ctors_[spec.str()];
+  } else {
+    if (solver_modules_.count(spec.str()) == 0) {
+      DynamicModule* dyn = new DynamicModule(spec, "solver");
+      solver_modules_[spec.str()] = dyn;
+    }
+    ctor = reinterpret_cast<SolverCtor*>(solver_modules_[spec.str()]->ctor_);
+  }
+  return ctor(exclusive_orders, options);
+}
+
 bool DynamicModule::Exists(AgentSpec spec) {
   bool rtn = true;
   try {
@@ -112,6 +131,12 @@ void DynamicModule::CloseAll() {
   }
   modules_.clear();
   man_ctors_.clear();
+  for (it = solver_modules_.begin(); it != solver_modules_.end(); it++) {
+    it->second->CloseLibrary();
+    delete it->second;
+  }
+  solver_modules_.clear();
+  man_solver_ctors_.clear();
   ClearPyAgentRefs();
 }
 
@@ -123,15 +148,22 @@ bool DynamicModule::IsPyAgent(AgentSpec spec) {
   return rtn;
 }
 
-DynamicModule::DynamicModule(AgentSpec spec)
-    : module_library_(0),
+DynamicModule::DynamicModule(AgentSpec spec, std::string kind)
+    : kind_(kind),
+      name_(spec.agent()),
+      module_library_(0),
       ctor_(NULL) {
   path_ = Env::FindModule(spec.LibPath(), spec.lib());
   if (boost::starts_with(path_, "<py>")) {
+    if (kind_ == "solver") {
+      throw ValueError("solver plugin '" + spec.str() +
+                       "' must be a C++ module library");
+    }
     /// python module, so no need to do more
     return;
   }
-  ctor_name_ = "Construct" + spec.agent();
+  ctor_name_ = (kind_ == "solver" ? "ConstructSolver" : "Construct") +
+               spec.agent();
   OpenLibrary();
   SetConstructor();
 }
@@ -13,9 +13,26 @@ namespace cyclus {
 
 class Agent;
 class Context;
+class ExchangeSolver;
 
 typedef Agent* AgentCtor(Context*);
 
+/// The constructor of a solver plugin, which a module library exports with C
+/// linkage as ConstructSolver<name> for the solver spec ":lib:name". It
+/// returns a new solver that enforces exclusive orders or not, configured by
+/// the free-form options string of the input file. For example:
+///
+/// @code
+/// extern "C" cyclus::ExchangeSolver* ConstructSolverMySolver(
+///     bool exclusive_orders, std::string options) {
+///   return new MySolver(exclusive_orders, options);
+/// }
+/// @endcode
+///
+/// Plugin solvers should implement ExchangeSolver::Clone, which restarted
+/// and branched simulations rely on.
+typedef ExchangeSolver* SolverCtor(bool, std::string);
+
 class InfileTree;
 
 class AgentSpec {
@@ -26,9 +43,9 @@ class AgentSpec {
             std::string alias);
   AgentSpec(std::string str_spec);
 
-  std::string Sanitize();
+  std::string Sanitize() const;
   std::string LibPath();
-  std::string str();
+  std::string str() const;
 
   std::string path() { return path_; }
   std::string lib() { return lib_; }
@@ -63,12 +80,19 @@ class DynamicModule {
   /// Returns a newly constructed agent for the given module spec.
   static Agent* Make(Context* ctx, AgentSpec spec);
 
+  /// Returns a newly constructed solver for the given solver plugin spec (see
+  /// SolverCtor).
+  ///
+  /// @throws ValueError if the spec is for a Python module
+  static ExchangeSolver* MakeSolver(AgentSpec spec, bool exclusive_orders,
+                                    std::string options);
+
   /// Tests that an agent spec really exists.
   static bool Exists(AgentSpec spec);
 
   /// Closes all statically loaded dynamic modules. This should always be called
-  /// before process termination.  This must be called AFTER all agents have
-  /// been destructed.
+  /// before process termination.  This must be called AFTER all agents and
+  /// plugin solvers have been destructed.
   static void CloseAll();
 
   /// Tests that an agent spec is for a Python Agent. This will also return false
@@ -80,8 +104,9 @@ class DynamicModule {
 
  private:
   /// Creates a new dynamically loadable module.
-  /// @param name the name of the module
-  DynamicModule(AgentSpec spec);
+  /// @param spec the spec of the module
+  /// @param kind what the module constructs, "agent" or "solver"
+  DynamicModule(AgentSpec spec, std::string kind = "agent");
 
   /// construct an instance of this module
   /// @return a fresh instance
@@ -99,16 +124,27 @@ class DynamicModule {
   /// for testing - see sim_init_tests
   static std::map<std::string, AgentCtor*> man_ctors_;
 
+  /// all dynamically loaded solver plugins, by spec
+  static std::map<std::string, DynamicModule*> solver_modules_;
+
+  /// for testing - see dynamic_module_tests
+  static std::map<std::string, SolverCtor*> man_solver_ctors_;
+
   /// the name of the module
   std::string path_;
 
   /// the name of the module
   std::string ctor_name_;
 
+  /// what the module constructs and the name of what it constructs, for
+  /// error messages
+  std::string kind_;
+  std::string name_;
+
   /// the library to open and close
   void* module_library_;
 
-  /// a functor for the constructor
+  /// a functor for the constructor, which is a SolverCtor for solvers
   AgentCtor* ctor_;
 
   /// uses dlopen to open the module shared lib
@@ -33,4 +33,9 @@ std::map<Warnings, std::string> warn_prefixes() {
 }
 std::map<Warnings, std::string> warn_prefix = warn_prefixes();
 
+std::mutex& warn_mutex() {
+  static std::mutex mu;
+  return mu;
+}
+
 }  // namespace cyclus
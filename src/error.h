@@ -4,6 +4,7 @@
 #include <exception>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <string>
 
 namespace cyclus {
@@ -109,6 +110,10 @@ std::map<Warnings, std::string> warn_prefixes();
 /// The number of warnings issues for each kind.
 extern std::map<Warnings, std::string> warn_prefix;
 
+/// Guards the warning counts, since warnings may be issued by agents running
+/// on many threads.
+std::mutex& warn_mutex();
+
 /// Issue a warning with the approriate message, accoring to the current
 /// warning settings.
 template <Warnings T>
@@ -131,6 +136,7 @@ void Warn(const std::string& msg) {
         throw Error(msg);
     }
   }
+  std::lock_guard<std::mutex> lock(warn_mutex());
   unsigned int cnt = warn_count[T]++;
   if (cnt < warn_limit) {
     std::cerr << warn_prefix[T] << ": " << msg << "\n";
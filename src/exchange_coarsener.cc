@@ -0,0 +1,359 @@
+#include "exchange_coarsener.h"
+
+#include <algorithm>
+#include <limits>
+#include <set>
+
+#include "error.h"
+#include "logger.h"
+
+namespace cyclus {
+
+namespace {
+
+typedef std::map<ExchangeNode::Ptr, std::vector<Arc> > NodeArcs;
+
+// an arc of a request node and what it must share with an arc of another node
+// for the two to be merged
+struct ArcSignature {
+  std::vector<double> sig;
+  Arc arc;
+
+  bool operator<(const ArcSignature& other) const { return sig < other.sig; }
+};
+
+// the unit capacities of a node for an arc, without adding any
+const std::vector<double>& UnitCaps(const ExchangeNode::Ptr& n, const Arc& a) {
+  static const std::vector<double> none;
+  std::map<Arc, std::vector<double> >::const_iterator it =
+      n->unit_capacities.find(a);
+  return it == n->unit_capacities.end() ? none : it->second;
+}
+
+// the preference of a request node for an arc
+double Pref(const ExchangeNode::Ptr& u, const Arc& a) {
+  std::map<Arc, double>::const_iterator it = u->prefs.find(a);
+  return it == u->prefs.end() ? a.pref() : it->second;
+}
+
+void Append(std::vector<double>* sig, const std::vector<double>& vals) {
+  sig->push_back(vals.size());
+  sig->insert(sig->end(), vals.begin(), vals.end());
+}
+
+// a copy of a node, without its arcs, standing for times such nodes
+ExchangeNode::Ptr Copy(const ExchangeNode::Ptr& n, int times) {
+  double qty = n->qty < std::numeric_limits<double>::max() / times ?
+               n->qty * times : std::numeric_limits<double>::max();
+  ExchangeNode::Ptr c(
+      new ExchangeNode(qty, n->exclusive, n->commod_id(), n->agent_id));
+  c->index = n->index;
+  return c;
+}
+
+// appends what a request group must share with another for the two to be
+// merged to sig, and the arcs of each of its nodes, in the order of their
+// signatures, to arcs, returning false if the group cannot be merged
+bool Signature(RequestGroup* g, int key, const NodeArcs& node_arcs,
+               const std::map<ExchangeNodeGroup*, int>& supply_ids,
+               std::vector<double>* sig,
+               std::vector<std::vector<Arc> >* arcs) {
+  if (key < 0 || !g->excl_node_groups().empty())
+    return false;
+  sig->push_back(key);
+  sig->push_back(g->qty());
+  Append(sig, g->capacities());
+  const std::vector<ExchangeNode::Ptr>& nodes = g->nodes();
+  sig->push_back(nodes.size());
+  for (int k = 0; k < nodes.size(); ++k) {
+    const ExchangeNode::Ptr& u = nodes[k];
+    if (u->exclusive)
+      return false;
+    sig->push_back(u->commod_id());
+    sig->push_back(u->qty);
+
+    std::vector<ArcSignature> sigs;
+    NodeArcs::const_iterator it = node_arcs.find(u);
+    if (it != node_arcs.end()) {
+      const std::vector<Arc>& uarcs = it->second;
+      for (int i = 0; i < uarcs.size(); ++i) {
+        const Arc& a = uarcs[i];
+        ExchangeNode::Ptr v = a.vnode();
+        std::map<ExchangeNodeGroup*, int>::const_iterator sit =
+            supply_ids.find(v->group);
+        NodeArcs::const_iterator vit = node_arcs.find(v);
+        if (v->exclusive || sit == supply_ids.end() ||
+            vit == node_arcs.end() || vit->second.size() != 1) {
+          return false;
+        }
+        ArcSignature s;
+        s.arc = a;
+        s.sig.push_back(sit->second);
+        s.sig.push_back(a.pref());
+        s.sig.push_back(Pref(u, a));
+        s.sig.push_back(v->commod_id());
+        s.sig.push_back(v->qty);
+        Append(&s.sig, UnitCaps(u, a));
+        Append(&s.sig, UnitCaps(v, a));
+        sigs.push_back(s);
+      }
+    }
+    std::stable_sort(sigs.begin(), sigs.end());
+
+    sig->push_back(sigs.size());
+    arcs->push_back(std::vector<Arc>());
+    for (int i = 0; i < sigs.size(); ++i) {
+      sig->insert(sig->end(), sigs[i].sig.begin(), sigs[i].sig.end());
+      arcs->back().push_back(sigs[i].arc);
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+ExchangeCoarsener::ExchangeCoarsener(Split split)
+    : split_(split),
+      merged_(0) {}
+
+ExchangeGraph::Ptr ExchangeCoarsener::Coarsen(ExchangeGraph* fine,
+                                              const std::vector<int>& keys) {
+  const std::vector<RequestGroup::Ptr>& rgs = fine->request_groups();
+  const std::vector<ExchangeNodeGroup::Ptr>& sgs = fine->supply_groups();
+  if (keys.size() < rgs.size())
+    throw ValueError("every request group needs a key to coarsen a graph");
+
+  coarse_.reset(new ExchangeGraph());
+  fine_arcs_.clear();
+  arc_agg_.clear();
+  aggs_.clear();
+  merged_ = 0;
+
+  std::map<ExchangeNodeGroup*, int> supply_ids;
+  for (int i = 0; i < sgs.size(); ++i) {
+    supply_ids[sgs[i].get()] = i;
+  }
+
+  // sort the request groups into classes of equivalent groups, numbered in
+  // the order of their first group
+  const NodeArcs& node_arcs = fine->node_arc_map();
+  std::vector<std::vector<std::vector<Arc> > > arcs(rgs.size());
+  std::map<std::vector<double>, int> class_ids;
+  std::vector<std::vector<int> > classes;
+  for (int i = 0; i < rgs.size(); ++i) {
+    std::vector<double> sig;
+    int c = classes.size();
+    if (Signature(rgs[i].get(), keys[i], node_arcs, supply_ids, &sig,
+                  &arcs[i])) {
+      c = class_ids.insert(std::make_pair(sig, c)).first->second;
+    }
+    if (c == classes.size())
+      classes.push_back(std::vector<int>());
+    classes[c].push_back(i);
+  }
+
+  // the coarse node of each fine node; the nodes of the groups of a class
+  // all have the node of the same position in the aggregate as theirs
+  std::map<ExchangeNode*, ExchangeNode::Ptr> nodes;
+
+  // the arcs of each position of an aggregate, by group, the aggregate they
+  // belong to, and the position and group of each arc merged
+  std::vector<std::vector<Arc> > slots;
+  std::vector<int> slot_agg;
+  std::map<Arc, std::pair<int, int> > slot_of;
+
+  for (int c = 0; c < classes.size(); ++c) {
+    const std::vector<int>& members = classes[c];
+    int n = members.size();
+    RequestGroup::Ptr first = rgs[members[0]];
+    RequestGroup::Ptr g(new RequestGroup(first->qty() * n));
+    const std::vector<double>& caps = first->capacities();
+    for (int i = 0; i < caps.size(); ++i) {
+      g->AddCapacity(caps[i] * n);
+    }
+
+    const std::vector<ExchangeNode::Ptr>& unodes = first->nodes();
+    for (int k = 0; k < unodes.size(); ++k) {
+      ExchangeNode::Ptr u = Copy(unodes[k], n);
+      g->AddExchangeNode(u);
+      for (int j = 0; j < n; ++j) {
+        nodes[rgs[members[j]]->nodes()[k].get()] = u;
+      }
+      if (n == 1)
+        continue;
+
+      const std::vector<Arc>& uarcs = arcs[members[0]][k];
+      for (int p = 0; p < uarcs.size(); ++p) {
+        int s = slots.size();
+        slots.push_back(std::vector<Arc>());
+        slot_agg.push_back(aggs_.size());
+        ExchangeNode::Ptr v = Copy(uarcs[p].vnode(), n);
+        for (int j = 0; j < n; ++j) {
+          const Arc& a = arcs[members[j]][k][p];
+          slots[s].push_back(a);
+          slot_of[a] = std::make_pair(s, j);
+          nodes[a.vnode().get()] = v;
+        }
+      }
+    }
+
+    if (n > 1) {
+      Aggregate agg;
+      agg.group = g;
+      agg.size = n;
+      aggs_.push_back(agg);
+      merged_ += n - 1;
+    }
+    coarse_->AddRequestGroup(g);
+  }
+
+  // aggregate bids take the place of the first of the bids they merge
+  for (int i = 0; i < sgs.size(); ++i) {
+    const ExchangeNodeGroup::Ptr& fg = sgs[i];
+    ExchangeNodeGroup::Ptr g(new ExchangeNodeGroup());
+    g->capacities() = fg->capacities();
+    const std::vector<ExchangeNode::Ptr>& vnodes = fg->nodes();
+    for (int j = 0; j < vnodes.size(); ++j) {
+      std::map<ExchangeNode*, ExchangeNode::Ptr>::iterator it =
+          nodes.find(vnodes[j].get());
+      if (it == nodes.end()) {
+        ExchangeNode::Ptr v = Copy(vnodes[j], 1);
+        nodes[vnodes[j].get()] = v;
+        g->AddExchangeNode(v);
+      } else if (it->second->group == NULL) {
+        g->AddExchangeNode(it->second);
+      }
+    }
+    const std::vector<std::vector<ExchangeNode::Ptr> >& excl =
+        fg->excl_node_groups();
+    for (int j = 0; j < excl.size(); ++j) {
+      std::vector<ExchangeNode::Ptr> vs;
+      for (int k = 0; k < excl[j].size(); ++k) {
+        vs.push_back(nodes[excl[j][k].get()]);
+      }
+      g->AddExclGroup(vs);
+    }
+    coarse_->AddSupplyGroup(g);
+  }
+
+  // arcs keep their order, the arc of an aggregate taking the place of the
+  // arc of its first group
+  const std::vector<Arc>& farcs = fine->arcs();
+  for (int i = 0; i < farcs.size(); ++i) {
+    const Arc& a = farcs[i];
+    std::map<Arc, std::pair<int, int> >::iterator sit = slot_of.find(a);
+    if (sit != slot_of.end() && sit->second.second != 0)
+      continue;
+
+    ExchangeNode::Ptr fu = a.unode();
+    ExchangeNode::Ptr fv = a.vnode();
+    ExchangeNode::Ptr& u = nodes[fu.get()];
+    ExchangeNode::Ptr& v = nodes[fv.get()];
+    if (u == NULL)
+      u = Copy(fu, 1);
+    if (v == NULL)
+      v = Copy(fv, 1);
+    Arc arc(u, v);
+    arc.pref(a.pref());
+    u->unit_capacities[arc] = UnitCaps(fu, a);
+    v->unit_capacities[arc] = UnitCaps(fv, a);
+    if (fu->prefs.count(a) > 0)
+      u->prefs[arc] = fu->prefs[a];
+    coarse_->AddArc(arc);
+
+    int id = fine_arcs_.size();
+    if (sit == slot_of.end()) {
+      fine_arcs_.push_back(std::vector<Arc>(1, a));
+      arc_agg_.push_back(-1);
+    } else {
+      int s = sit->second.first;
+      fine_arcs_.push_back(slots[s]);
+      arc_agg_.push_back(slot_agg[s]);
+      aggs_[slot_agg[s]].arcs.push_back(id);
+    }
+  }
+
+  CLOG(LEV_DEBUG1) << "Coarsened " << rgs.size() << " request groups into "
+                   << classes.size() << ".";
+
+  coarse_->Flatten();
+  return coarse_;
+}
+
+void ExchangeCoarsener::Refine(const std::vector<Match>& coarse,
+                               std::vector<Match>* fine) const {
+  const std::map<Arc, int>& arc_ids = coarse_->arc_ids();
+  std::vector<int> ids(coarse.size());
+  std::vector<double> flows(fine_arcs_.size(), 0);
+  for (int i = 0; i < coarse.size(); ++i) {
+    std::map<Arc, int>::const_iterator it = arc_ids.find(coarse[i].first);
+    if (it == arc_ids.end())
+      throw KeyError("the match is not of the coarsened graph");
+    ids[i] = it->second;
+    flows[ids[i]] += coarse[i].second;
+  }
+
+  // groups filled in order each take a copy of the aggregate's flow scaled
+  // down to their size, until the flow is used up
+  std::vector<double> filled(aggs_.size(), 0);
+  if (split_ == IN_ORDER) {
+    for (int k = 0; k < aggs_.size(); ++k) {
+      filled[k] = Usage(aggs_[k], flows) * aggs_[k].size;
+    }
+  }
+
+  for (int i = 0; i < coarse.size(); ++i) {
+    const std::vector<Arc>& arcs = fine_arcs_[ids[i]];
+    int k = arc_agg_[ids[i]];
+    if (k < 0) {
+      fine->push_back(coarse[i]);
+      fine->back().first = arcs[0];
+      continue;
+    }
+    int n = arcs.size();
+    for (int j = 0; j < n; ++j) {
+      double share = 1.0 / n;
+      if (split_ == IN_ORDER && filled[k] > 0)
+        share = std::max(0.0, std::min(1.0, filled[k] - j)) / filled[k];
+      double qty = coarse[i].second * share;
+      if (qty > 0)
+        fine->push_back(Match(arcs[j], qty));
+    }
+  }
+}
+
+double ExchangeCoarsener::Usage(const Aggregate& agg,
+                                const std::vector<double>& flows) const {
+  const std::vector<double>& caps = agg.group->capacities();
+  std::vector<double> used(caps.size(), 0);
+  std::map<ExchangeNode*, double> node_flows;
+  double most = 0;
+  for (int i = 0; i < agg.arcs.size(); ++i) {
+    int id = agg.arcs[i];
+    double f = flows[id];
+    if (f <= 0)
+      continue;
+    const Arc& a = coarse_->arcs()[id];
+    ExchangeNode::Ptr u = a.unode();
+    ExchangeNode::Ptr v = a.vnode();
+    const std::vector<double>& ucaps = UnitCaps(u, a);
+    for (int c = 0; c < ucaps.size() && c < caps.size(); ++c) {
+      used[c] += ucaps[c] * f;
+    }
+    node_flows[u.get()] += f;
+    if (v->qty > 0)
+      most = std::max(most, f / v->qty);
+  }
+  for (int c = 0; c < caps.size(); ++c) {
+    if (caps[c] > 0)
+      most = std::max(most, used[c] / caps[c]);
+  }
+  std::map<ExchangeNode*, double>::iterator it;
+  for (it = node_flows.begin(); it != node_flows.end(); ++it) {
+    if (it->first->qty > 0)
+      most = std::max(most, it->second / it->first->qty);
+  }
+  return std::min(most, 1.0);
+}
+
+}  // namespace cyclus
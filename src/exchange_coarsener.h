@@ -0,0 +1,116 @@
+#ifndef CYCLUS_SRC_EXCHANGE_COARSENER_H_
+#define CYCLUS_SRC_EXCHANGE_COARSENER_H_
+
+#include <map>
+#include <vector>
+
+#include "exchange_graph.h"
+
+namespace cyclus {
+
+/// @class ExchangeCoarsener
+///
+/// @brief An ExchangeCoarsener shrinks an ExchangeGraph by merging equivalent
+/// request groups into aggregate groups, so that exchanges in which many
+/// identical facilities, e.g., the hundreds of reactors of one institution,
+/// each make the same requests are solved as if a single, larger facility
+/// made them. The matches of the smaller graph are then split back among the
+/// groups that were merged (see Refine).
+///
+/// Request groups are merged if they were given the same non-negative key
+/// (the ExchangeTranslator keys each group by the institution of its
+/// requester) and if they pose the same problem: the same quantity and
+/// capacities, and nodes of the same commodities and quantities whose arcs,
+/// taken in any order, have the same preferences and unit capacities and lead
+/// to bids of the same supply groups with the same quantities. Groups with
+/// exclusive requests, or with arcs to exclusive bids or to bids that other
+/// requests share, are never merged, since their flow cannot be split.
+///
+/// In an aggregate group, each capacity and quantity is the sum of those of
+/// the groups merged, and each bid the sum of the bids of the same position,
+/// which are all removed from their supply group. The aggregate keeps the
+/// agent ids and request numbers of the first group merged. Since the groups
+/// merged are identical, any flow through the aggregate can be split among
+/// them without violating their constraints or those of the suppliers.
+///
+/// @code
+/// ExchangeCoarsener coarsener;
+/// ExchangeGraph::Ptr coarse = coarsener.Coarsen(fine.get(), keys);
+/// solver->Solve(coarse.get());
+/// std::vector<Match> matches;
+/// coarsener.Refine(coarse->matches(), &matches);  // matches of fine
+/// @endcode
+class ExchangeCoarsener {
+ public:
+  /// @brief how the flow through an aggregate is split among its groups
+  enum Split {
+    IN_ORDER,  /// default flag, filling the groups one after the other in
+               /// the order of the fine graph, as a greedy solver would
+    PROPORTIONAL  /// a flag for sharing the flow evenly among the groups
+  };
+
+  explicit ExchangeCoarsener(Split split = IN_ORDER);
+
+  /// @brief how the flow through an aggregate is split among its groups
+  /// @{
+  inline Split split() const { return split_; }
+  inline void split(Split split) { split_ = split; }
+  /// @}
+
+  /// @brief returns the coarsened version of a graph, whose groups, nodes and
+  /// arcs are all new. The fine graph must outlive the coarsener and must not
+  /// change before its matches are refined.
+  ///
+  /// @param fine the graph to coarsen
+  /// @param keys the key of each request group of fine, in order, where
+  /// groups with negative keys are never merged
+  /// @throws ValueError if there are fewer keys than request groups
+  ExchangeGraph::Ptr Coarsen(ExchangeGraph* fine,
+                             const std::vector<int>& keys);
+
+  /// @brief translates matches of the last coarsened graph into matches of
+  /// the fine graph, appending them to fine. The flow along the arcs of an
+  /// aggregate is split among the arcs of the groups it was merged from
+  /// according to the split flag.
+  void Refine(const std::vector<Match>& coarse,
+              std::vector<Match>* fine) const;
+
+  /// @brief the number of request groups of the last graph coarsened that
+  /// were merged into another
+  inline int merged() const { return merged_; }
+
+ private:
+  /// an aggregate request group of the coarse graph
+  struct Aggregate {
+    /// the aggregate group
+    RequestGroup::Ptr group;
+
+    /// the ids of the arcs of the aggregate in the coarse graph
+    std::vector<int> arcs;
+
+    /// the number of groups merged
+    int size;
+  };
+
+  /// returns the largest fraction of any capacity or quantity of aggregate
+  /// that the given flows, by coarse arc id, use
+  double Usage(const Aggregate& agg, const std::vector<double>& flows) const;
+
+  Split split_;
+  ExchangeGraph::Ptr coarse_;
+  int merged_;
+
+  /// the arcs of the fine graph that each arc of the coarse graph stands for,
+  /// by coarse arc id; a single arc, or the arcs of each group merged into an
+  /// aggregate, in order
+  std::vector<std::vector<Arc> > fine_arcs_;
+
+  /// the aggregate of each arc of the coarse graph, by coarse arc id, or -1
+  std::vector<int> arc_agg_;
+
+  std::vector<Aggregate> aggs_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_EXCHANGE_COARSENER_H_
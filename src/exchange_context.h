@@ -5,6 +5,7 @@
 #include <map>
 #include <cmath>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -28,6 +29,50 @@ struct PrefMap {
   typedef Bid<T>* bid_ptr;
 };
 
+/// A sparse set of preference changes made by an agent during preference
+/// adjustment. Each change sets the preference of a single (request, bid)
+/// arc, so applying them costs only as much as the number of changed arcs.
+template <class T>
+class PrefChanges {
+ public:
+  struct Change {
+    Change(Request<T>* r, Bid<T>* b, double p) : request(r), bid(b), pref(p) {}
+    Request<T>* request;
+    Bid<T>* bid;
+    double pref;
+  };
+
+  /// Sets the preference of the arc between request r and bid b.
+  inline void Set(Request<T>* r, Bid<T>* b, double pref) {
+    changes_.push_back(Change(r, b, pref));
+  }
+
+  /// The changes, in the order they were set.
+  inline const std::vector<Change>& changes() const { return changes_; }
+
+  inline size_t size() const { return changes_.size(); }
+  inline bool empty() const { return changes_.empty(); }
+  inline void clear() { changes_.clear(); }
+
+  /// Applies every change to prefs. Changes to arcs that are not already in
+  /// prefs are ignored, since preference adjustment cannot create arcs.
+  void ApplyTo(typename PrefMap<T>::type& prefs) const {
+    typename std::vector<Change>::const_iterator it;
+    for (it = changes_.begin(); it != changes_.end(); ++it) {
+      typename PrefMap<T>::type::iterator r_it = prefs.find(it->request);
+      if (r_it == prefs.end())
+        continue;
+      typename std::map<Bid<T>*, double>::iterator b_it =
+          r_it->second.find(it->bid);
+      if (b_it != r_it->second.end())
+        b_it->second = it->pref;
+    }
+  }
+
+ private:
+  std::vector<Change> changes_;
+};
+
 template <class T>
 struct CommodMap {
   typedef std::map<std::string, std::vector<Request<T>*> > type;
@@ -46,9 +91,19 @@ struct CommodMap {
 /// Exchange. The second phase, Response to Request for Bids, is assisted by
 /// grouping requests by commodity type. The third phase, preference adjustment,
 /// is assisted by grouping bids by the requester being responded to.
+///
+/// Requests and bids are numbered densely as they are added. Every bid is the
+/// arc between itself and the request it responds to, and the preference of
+/// each arc is stored in a flat array indexed by arc, i.e., bid, number. The
+/// arcs of each requester form a contiguous span of an index, which is built
+/// once all bids are added. The nested PrefMap that archetypes adjust is
+/// built from a requester's span when needed (see ViewPrefs and StorePrefs).
 template <class T>
 struct ExchangeContext {
  public:
+  ExchangeContext()
+      : trader_prefs(this), bids_by_request(this), indexed_(true) {}
+
   /// @brief adds a request to the context
   void AddRequestPortfolio(const typename RequestPortfolio<T>::Ptr port) {
     requests.push_back(port);
@@ -66,6 +121,7 @@ struct ExchangeContext {
     assert(pr->requester() != NULL);
     requesters.insert(pr->requester());
     commod_requests[pr->commodity()].push_back(pr);
+    RequestIndex(pr);
   }
 
   /// @brief adds a bid to the context
@@ -87,13 +143,147 @@ struct ExchangeContext {
     assert(pb->bidder() != NULL);
     bidders.insert(pb->bidder());
 
-    bids_by_request[pb->request()].push_back(pb);
+    Request<T>* r = pb->request();
+    int ri = RequestIndex(r);
+    request_bids_[ri].push_back(pb);
+
+    Trader* t = r->requester();
+    typename std::unordered_map<Trader*, int>::iterator t_it =
+        trader_index_.find(t);
+    if (t_it == trader_index_.end()) {
+      t_it = trader_index_.insert(
+          std::make_pair(t, static_cast<int>(trader_index_.size()))).first;
+    }
 
     double bid_pref = pb->preference();
-    trader_prefs[pb->request()->requester()][pb->request()].insert(
-        std::make_pair(pb, std::isnan(bid_pref) ? pb->request()->preference() : bid_pref));
+    arc_index_[pb] = arc_bids_.size();
+    arc_bids_.push_back(pb);
+    arc_traders_.push_back(t_it->second);
+    prefs_.push_back(std::isnan(bid_pref) ? r->preference() : bid_pref);
+    indexed_ = false;
+  }
+
+  /// @brief the number of requests in the context
+  inline int nrequests() const { return request_list_.size(); }
+
+  /// @brief the number of request r, or -1 if it is not in the context
+  inline int request_index(Request<T>* r) const {
+    typename std::unordered_map<Request<T>*, int>::const_iterator it =
+        request_index_.find(r);
+    return it == request_index_.end() ? -1 : it->second;
+  }
+
+  /// @brief the request numbered i
+  inline Request<T>* request(int i) const { return request_list_[i]; }
+
+  /// @brief the number of arcs, i.e., bids, in the context
+  inline int narcs() const { return arc_bids_.size(); }
+
+  /// @brief the arc of bid b, or -1 if it is not in the context
+  inline int arc(Bid<T>* b) const {
+    typename std::unordered_map<Bid<T>*, int>::const_iterator it =
+        arc_index_.find(b);
+    return it == arc_index_.end() ? -1 : it->second;
+  }
+
+  /// @brief the bid of arc a
+  inline Bid<T>* arc_bid(int a) const { return arc_bids_[a]; }
+
+  /// @brief the preference of arc a
+  /// @{
+  inline double pref(int a) const { return prefs_[a]; }
+  inline void pref(int a, double p) { prefs_[a] = p; }
+  /// @}
+
+  /// @brief the arcs of the requests of requester t, as the span [first,
+  /// second), in the order the bids were added
+  std::pair<const int*, const int*> TraderArcs(Trader* t) {
+    Index();
+    typename std::unordered_map<Trader*, int>::const_iterator it =
+        trader_index_.find(t);
+    if (it == trader_index_.end() || trader_arcs_.empty()) {
+      return std::pair<const int*, const int*>(NULL, NULL);
+    }
+    const int* arcs = &trader_arcs_[0];
+    return std::make_pair(arcs + trader_starts_[it->second],
+                          arcs + trader_starts_[it->second + 1]);
+  }
+
+  /// @brief replaces prefs with the preferences of the arcs of requester t
+  void ViewPrefs(Trader* t, typename PrefMap<T>::type* prefs) {
+    prefs->clear();
+    std::pair<const int*, const int*> span = TraderArcs(t);
+    for (const int* a = span.first; a != span.second; ++a) {
+      Bid<T>* b = arc_bids_[*a];
+      (*prefs)[b->request()][b] = prefs_[*a];
+    }
+  }
+
+  /// @brief stores the preferences of the arcs of requester t from prefs,
+  /// e.g., once an archetype has adjusted a map given by ViewPrefs. Arcs
+  /// missing from prefs get a preference of zero; arcs in prefs that are not
+  /// the requester's are ignored, since preference adjustment cannot create
+  /// arcs.
+  void StorePrefs(Trader* t, const typename PrefMap<T>::type& prefs) {
+    std::pair<const int*, const int*> span = TraderArcs(t);
+    typename PrefMap<T>::type::const_iterator r_it = prefs.end();
+    for (const int* a = span.first; a != span.second; ++a) {
+      Bid<T>* b = arc_bids_[*a];
+      // the arcs of a request are usually next to each other
+      if (r_it == prefs.end() || r_it->first != b->request()) {
+        r_it = prefs.find(b->request());
+      }
+      double p = 0;
+      if (r_it != prefs.end()) {
+        typename std::map<Bid<T>*, double>::const_iterator b_it =
+            r_it->second.find(b);
+        if (b_it != r_it->second.end()) {
+          p = b_it->second;
+        }
+      }
+      prefs_[*a] = p;
+    }
   }
 
+  /// @brief A PrefMap-style view of the preferences of each requester. The
+  /// maps it gives are copies, rebuilt on each access; changing them does not
+  /// change the context's preferences (see StorePrefs).
+  class TraderPrefs {
+   public:
+    explicit TraderPrefs(ExchangeContext<T>* ctx) : ctx_(ctx) {}
+
+    typename PrefMap<T>::type& operator[](Trader* t) {
+      typename PrefMap<T>::type& prefs = views_[t];
+      ctx_->ViewPrefs(t, &prefs);
+      return prefs;
+    }
+
+   private:
+    ExchangeContext<T>* ctx_;
+    std::map<Trader*, typename PrefMap<T>::type> views_;
+  };
+
+  /// @brief A view of the bids for each request, in the order they were
+  /// added.
+  class BidsByRequest {
+   public:
+    explicit BidsByRequest(ExchangeContext<T>* ctx) : ctx_(ctx) {}
+
+    const std::vector<Bid<T>*>& operator[](Request<T>* r) const {
+      static const std::vector<Bid<T>*> none;
+      typename std::unordered_map<Request<T>*, int>::const_iterator it =
+          ctx_->request_index_.find(r);
+      return it == ctx_->request_index_.end() ? none
+                                              : ctx_->request_bids_[it->second];
+    }
+
+    /// @brief whether there are no bids
+    bool empty() const { return ctx_->arc_bids_.empty(); }
+
+   private:
+    const ExchangeContext<T>* ctx_;
+  };
+
   /// @brief a reference to an exchange's set of requests
   std::vector<typename RequestPortfolio<T>::Ptr> requests;
 
@@ -109,12 +299,70 @@ struct ExchangeContext {
   /// @brief maps commodity name to requests for that commodity
   typename CommodMap<T>::type commod_requests;
 
+  /// @brief maps requester to the preferences of its requests' arcs
+  TraderPrefs trader_prefs;
+
   /// @brief maps request to all bids for request
-  std::map< Request<T>*, std::vector<Bid<T>*> >
-      bids_by_request;
+  BidsByRequest bids_by_request;
 
-  /// @brief maps commodity name to requests for that commodity
-  std::map<Trader*, typename PrefMap<T>::type> trader_prefs;
+ private:
+  // the views hold pointers to the context
+  ExchangeContext(const ExchangeContext&);
+  ExchangeContext& operator=(const ExchangeContext&);
+
+  /// numbers r if it is new
+  int RequestIndex(Request<T>* r) {
+    std::pair<typename std::unordered_map<Request<T>*, int>::iterator, bool>
+        ins = request_index_.insert(
+            std::make_pair(r, static_cast<int>(request_bids_.size())));
+    if (ins.second) {
+      request_list_.push_back(r);
+      request_bids_.push_back(std::vector<Bid<T>*>());
+    }
+    return ins.first->second;
+  }
+
+  /// groups the arcs by requester, keeping their order, if bids were added
+  /// since the last time
+  void Index() {
+    if (indexed_) {
+      return;
+    }
+    int ntraders = trader_index_.size();
+    trader_starts_.assign(ntraders + 1, 0);
+    for (int a = 0; a < arc_traders_.size(); ++a) {
+      trader_starts_[arc_traders_[a] + 1]++;
+    }
+    for (int i = 0; i < ntraders; ++i) {
+      trader_starts_[i + 1] += trader_starts_[i];
+    }
+    std::vector<int> next(trader_starts_.begin(), trader_starts_.end() - 1);
+    trader_arcs_.resize(arc_traders_.size());
+    for (int a = 0; a < arc_traders_.size(); ++a) {
+      trader_arcs_[next[arc_traders_[a]]++] = a;
+    }
+    indexed_ = true;
+  }
+
+  /// the number of each request, and each request and its bids by number
+  std::unordered_map<Request<T>*, int> request_index_;
+  std::vector<Request<T>*> request_list_;
+  std::vector<std::vector<Bid<T>*> > request_bids_;
+
+  /// the number of each requester that bids were made to
+  std::unordered_map<Trader*, int> trader_index_;
+
+  /// the bid, requester number, and preference of each arc, and the arc of
+  /// each bid
+  std::vector<Bid<T>*> arc_bids_;
+  std::vector<int> arc_traders_;
+  std::vector<double> prefs_;
+  std::unordered_map<Bid<T>*, int> arc_index_;
+
+  /// the arcs grouped by requester number, and where each group starts
+  std::vector<int> trader_arcs_;
+  std::vector<int> trader_starts_;
+  bool indexed_;
 };
 
 }  // namespace cyclus
@@ -3,47 +3,171 @@
 #include <algorithm>
 #include <boost/math/special_functions/next.hpp>
 
+#include "commodity_registry.h"
 #include "cyc_limits.h"
 #include "error.h"
 #include "logger.h"
 
 namespace cyclus {
 
+namespace {
+
+int FlatGroupId(FlatExchangeGraph* f, ExchangeNodeGroup* g) {
+  if (g == NULL)
+    return -1;
+  std::vector<ExchangeNodeGroup*>::iterator it =
+      std::find(f->groups.begin(), f->groups.end(), g);
+  if (it != f->groups.end())
+    return it - f->groups.begin();
+  f->groups.push_back(g);
+  return f->groups.size() - 1;
+}
+
+int FlatNodeId(FlatExchangeGraph* f, const ExchangeNode::Ptr& n) {
+  int id = f->node_id(n.get());
+  if (id >= 0)
+    return id;
+  id = f->nodes.size();
+  f->node_ids[n.get()] = id;
+  f->nodes.push_back(n);
+  f->node_group.push_back(FlatGroupId(f, n->group));
+  f->node_qty.push_back(n->qty);
+  f->node_agent_id.push_back(n->agent_id);
+  return id;
+}
+
+void AppendUnitCaps(const ExchangeNode& n, const Arc& a,
+                    std::vector<int>* start, std::vector<double>* caps) {
+  std::map<Arc, std::vector<double> >::const_iterator it =
+      n.unit_capacities.find(a);
+  if (it != n.unit_capacities.end())
+    caps->insert(caps->end(), it->second.begin(), it->second.end());
+  start->push_back(caps->size());
+}
+
+int FindRoot(std::vector<int>* parents, int i) {
+  std::vector<int>& p = *parents;
+  while (p[i] != i) {
+    p[i] = p[p[i]];  // path halving
+    i = p[i];
+  }
+  return i;
+}
+
+void Unite(std::vector<int>* parents, int i, int j) {
+  i = FindRoot(parents, i);
+  j = FindRoot(parents, j);
+  if (i != j)
+    (*parents)[std::max(i, j)] = std::min(i, j);
+}
+
+bool SameNodes(const FlatExchangeGraph& f,
+               const std::vector<ExchangeNode::Ptr>& l,
+               const FlatExchangeGraph& g,
+               const std::vector<ExchangeNode::Ptr>& r) {
+  if (l.size() != r.size())
+    return false;
+  for (int i = 0; i != l.size(); i++) {
+    if (f.node_id(l[i].get()) != g.node_id(r[i].get()))
+      return false;
+  }
+  return true;
+}
+
+// FNV-1a over the raw bytes of n values
+template <class T>
+void Fnv(const T* v, size_t n, uint64_t* h) {
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(v);
+  for (size_t i = 0; i < n * sizeof(T); ++i) {
+    *h = (*h ^ p[i]) * 1099511628211ULL;
+  }
+}
+
+template <class T>
+void Fnv(const std::vector<T>& v, uint64_t* h) {
+  size_t n = v.size();
+  Fnv(&n, 1, h);
+  if (!v.empty())
+    Fnv(&v[0], v.size(), h);
+}
+
+template <class T>
+void Fnv(T v, uint64_t* h) {
+  Fnv(&v, 1, h);
+}
+
+}  // namespace
+
 ExchangeNode::ExchangeNode(double qty, bool exclusive, std::string commod,
                            int agent_id)
-    : qty(qty),
+    : group(NULL),
       exclusive(exclusive),
       commod(commod),
       agent_id(agent_id),
-      group(NULL) {}
+      index(-1),
+      qty(qty),
+      commod_id_(CommodityRegistry::Intern(commod)),
+      interned_(commod) {}
+
+ExchangeNode::ExchangeNode(double qty, bool exclusive, int commod_id,
+                           int agent_id)
+    : group(NULL),
+      exclusive(exclusive),
+      commod(CommodityRegistry::Name(commod_id)),
+      agent_id(agent_id),
+      index(-1),
+      qty(qty),
+      commod_id_(commod_id),
+      interned_(commod) {}
 
 ExchangeNode::ExchangeNode(double qty, bool exclusive)
-    : qty(qty),
+    : group(NULL),
       exclusive(exclusive),
       commod(""),
       agent_id(-1),
-      group(NULL) {}
+      index(-1),
+      qty(qty),
+      commod_id_(0),
+      interned_("") {}
 
 ExchangeNode::ExchangeNode(double qty, bool exclusive, std::string commod)
-    : qty(qty),
+    : group(NULL),
       exclusive(exclusive),
       commod(commod),
       agent_id(-1),
-      group(NULL) {}
+      index(-1),
+      qty(qty),
+      commod_id_(CommodityRegistry::Intern(commod)),
+      interned_(commod) {}
 
 ExchangeNode::ExchangeNode(double qty)
-    : qty(qty),
+    : group(NULL),
       exclusive(false),
       commod(""),
       agent_id(-1),
-      group(NULL) {}
+      index(-1),
+      qty(qty),
+      commod_id_(0),
+      interned_("") {}
 
 ExchangeNode::ExchangeNode()
-    : qty(std::numeric_limits<double>::max()),
+    : group(NULL),
       exclusive(false),
       commod(""),
       agent_id(-1),
-      group(NULL) {}
+      index(-1),
+      qty(std::numeric_limits<double>::max()),
+      commod_id_(0),
+      interned_("") {}
+
+int ExchangeNode::commod_id() const {
+  // commod is a public member that may be assigned directly
+  if (commod != interned_) {
+    commod_id_ = CommodityRegistry::Intern(commod);
+    interned_ = commod;
+  }
+  return commod_id_;
+}
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 bool operator==(const ExchangeNode& lhs, const ExchangeNode& rhs) {
@@ -51,14 +175,15 @@ bool operator==(const ExchangeNode& lhs, const ExchangeNode& rhs) {
           lhs.qty == rhs.qty &&
           lhs.exclusive == rhs.exclusive &&
           lhs.group == rhs.group &&
-          lhs.commod == rhs.commod);
+          lhs.commod_id() == rhs.commod_id());
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Arc::Arc(boost::shared_ptr<ExchangeNode> unode,
          boost::shared_ptr<ExchangeNode> vnode)
     : unode_(unode),
-      vnode_(vnode) {
+      vnode_(vnode),
+      pref_(0) {
   exclusive_ = unode->exclusive || vnode->exclusive;
   if (exclusive_) {
     double fqty = unode->qty;
@@ -116,11 +241,13 @@ ExchangeGraph::ExchangeGraph() : next_arc_id_(0) { }
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void ExchangeGraph::AddRequestGroup(RequestGroup::Ptr prs) {
   request_groups_.push_back(prs);
+  flat_.reset();
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void ExchangeGraph::AddSupplyGroup(ExchangeNodeGroup::Ptr pss) {
   supply_groups_.push_back(pss);
+  flat_.reset();
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -131,6 +258,240 @@ void ExchangeGraph::AddArc(const Arc& a) {
   arc_by_id_.insert(std::pair<int, Arc>(id, a));
   node_arc_map_[a.unode()].push_back(a);
   node_arc_map_[a.vnode()].push_back(a);
+  flat_.reset();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool ExchangeGraph::SameProblem(ExchangeGraph& other) {
+  const FlatExchangeGraph& f = flat();
+  const FlatExchangeGraph& g = other.flat();
+  if (request_groups_.size() != other.request_groups_.size() ||
+      f.groups.size() != g.groups.size() ||
+      f.node_group != g.node_group ||
+      f.node_qty != g.node_qty ||
+      f.node_agent_id != g.node_agent_id ||
+      f.arc_unode != g.arc_unode ||
+      f.arc_vnode != g.arc_vnode ||
+      f.arc_pref != g.arc_pref ||
+      f.arc_exclusive != g.arc_exclusive ||
+      f.arc_excl_val != g.arc_excl_val ||
+      f.ucap_start != g.ucap_start ||
+      f.ucaps != g.ucaps ||
+      f.vcap_start != g.vcap_start ||
+      f.vcaps != g.vcaps) {
+    return false;
+  }
+
+  for (int i = 0; i != f.nodes.size(); i++) {
+    const ExchangeNode& l = *f.nodes[i];
+    const ExchangeNode& r = *g.nodes[i];
+    if (l.exclusive != r.exclusive || l.commod_id() != r.commod_id())
+      return false;
+  }
+
+  for (int i = 0; i != arcs_.size(); i++) {
+    if (arcs_[i].pref() != other.arcs_[i].pref())
+      return false;
+  }
+
+  // group membership (in the order nodes were added) is given by node_group,
+  // since solvers may have reordered the nodes of the solved graph
+  for (int i = 0; i != f.groups.size(); i++) {
+    ExchangeNodeGroup* l = f.groups[i];
+    ExchangeNodeGroup* r = g.groups[i];
+    RequestGroup* lreq = dynamic_cast<RequestGroup*>(l);
+    RequestGroup* rreq = dynamic_cast<RequestGroup*>(r);
+    if ((lreq == NULL) != (rreq == NULL) ||
+        (lreq != NULL && lreq->qty() != rreq->qty()) ||
+        l->capacities() != r->capacities()) {
+      return false;
+    }
+    const std::vector< std::vector<ExchangeNode::Ptr> >& lexcl =
+        l->excl_node_groups();
+    const std::vector< std::vector<ExchangeNode::Ptr> >& rexcl =
+        r->excl_node_groups();
+    if (lexcl.size() != rexcl.size())
+      return false;
+    for (int j = 0; j != lexcl.size(); j++) {
+      if (!SameNodes(f, lexcl[j], g, rexcl[j]))
+        return false;
+    }
+  }
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uint64_t ExchangeGraph::Fingerprint() {
+  const FlatExchangeGraph& f = flat();
+  uint64_t h = 14695981039346656037ULL;
+  Fnv(request_groups_.size(), &h);
+  Fnv(f.groups.size(), &h);
+  Fnv(f.node_group, &h);
+  Fnv(f.node_qty, &h);
+  Fnv(f.node_agent_id, &h);
+  Fnv(f.arc_unode, &h);
+  Fnv(f.arc_vnode, &h);
+  Fnv(f.arc_pref, &h);
+  for (int i = 0; i != f.arc_exclusive.size(); i++) {
+    Fnv<bool>(f.arc_exclusive[i], &h);
+  }
+  Fnv(f.arc_excl_val, &h);
+  Fnv(f.ucap_start, &h);
+  Fnv(f.ucaps, &h);
+  Fnv(f.vcap_start, &h);
+  Fnv(f.vcaps, &h);
+  for (int i = 0; i != f.nodes.size(); i++) {
+    Fnv(f.nodes[i]->exclusive, &h);
+    Fnv(f.nodes[i]->commod_id(), &h);
+  }
+  for (int i = 0; i != arcs_.size(); i++) {
+    Fnv(arcs_[i].pref(), &h);
+  }
+  for (int i = 0; i != f.groups.size(); i++) {
+    RequestGroup* req = dynamic_cast<RequestGroup*>(f.groups[i]);
+    Fnv(req != NULL, &h);
+    if (req != NULL)
+      Fnv(req->qty(), &h);
+    Fnv(f.groups[i]->capacities(), &h);
+    const std::vector< std::vector<ExchangeNode::Ptr> >& excl =
+        f.groups[i]->excl_node_groups();
+    Fnv(excl.size(), &h);
+    for (int j = 0; j != excl.size(); j++) {
+      Fnv(excl[j].size(), &h);
+      for (int k = 0; k != excl[j].size(); k++) {
+        Fnv(f.node_id(excl[j][k].get()), &h);
+      }
+    }
+  }
+  return h;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+std::vector<ExchangeGraph::Ptr> ExchangeGraph::Components() {
+  const FlatExchangeGraph& f = flat();
+  int nnodes = f.nodes.size();
+  int narcs = arcs_.size();
+
+  // union-find over nodes and groups (which follow the nodes)
+  std::vector<int> parents(nnodes + f.groups.size());
+  for (int i = 0; i != parents.size(); i++) {
+    parents[i] = i;
+  }
+  for (int i = 0; i != nnodes; i++) {
+    if (f.node_group[i] >= 0)
+      Unite(&parents, i, nnodes + f.node_group[i]);
+  }
+  for (int i = 0; i != narcs; i++) {
+    Unite(&parents, f.arc_unode[i], f.arc_vnode[i]);
+  }
+
+  // number components in order of their first arc
+  std::map<int, int> comp_ids;
+  std::vector<int> arc_comps(narcs);
+  for (int i = 0; i != narcs; i++) {
+    int root = FindRoot(&parents, f.arc_unode[i]);
+    if (comp_ids.count(root) == 0) {
+      int id = comp_ids.size();
+      comp_ids[root] = id;
+    }
+    arc_comps[i] = comp_ids[root];
+  }
+
+  std::vector<Ptr> comps;
+  if (comp_ids.size() < 2)
+    return comps;
+  for (int i = 0; i != comp_ids.size(); i++) {
+    comps.push_back(Ptr(new ExchangeGraph()));
+  }
+
+  std::map<ExchangeNodeGroup*, int> group_ids;
+  for (int i = 0; i != f.groups.size(); i++) {
+    group_ids[f.groups[i]] = i;
+  }
+  for (int i = 0; i != request_groups_.size(); i++) {
+    int root = FindRoot(&parents, nnodes + group_ids[request_groups_[i].get()]);
+    std::map<int, int>::iterator it = comp_ids.find(root);
+    comps[it == comp_ids.end() ? 0 : it->second]->AddRequestGroup(
+        request_groups_[i]);
+  }
+  for (int i = 0; i != supply_groups_.size(); i++) {
+    int root = FindRoot(&parents, nnodes + group_ids[supply_groups_[i].get()]);
+    std::map<int, int>::iterator it = comp_ids.find(root);
+    comps[it == comp_ids.end() ? 0 : it->second]->AddSupplyGroup(
+        supply_groups_[i]);
+  }
+  for (int i = 0; i != narcs; i++) {
+    comps[arc_comps[i]]->AddArc(arcs_[i]);
+  }
+  return comps;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+const FlatExchangeGraph& ExchangeGraph::flat() {
+  if (flat_ == NULL)
+    Flatten();
+  return *flat_;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void ExchangeGraph::Flatten() {
+  flat_.reset(new FlatExchangeGraph());
+  FlatExchangeGraph& f = *flat_;
+
+  // number groups and their nodes in graph order
+  for (int i = 0; i != request_groups_.size(); i++) {
+    FlatGroupId(&f, request_groups_[i].get());
+  }
+  for (int i = 0; i != supply_groups_.size(); i++) {
+    FlatGroupId(&f, supply_groups_[i].get());
+  }
+  for (int i = 0; i != request_groups_.size(); i++) {
+    std::vector<ExchangeNode::Ptr>& nodes = request_groups_[i]->nodes();
+    for (int j = 0; j != nodes.size(); j++) {
+      FlatNodeId(&f, nodes[j]);
+    }
+  }
+  for (int i = 0; i != supply_groups_.size(); i++) {
+    std::vector<ExchangeNode::Ptr>& nodes = supply_groups_[i]->nodes();
+    for (int j = 0; j != nodes.size(); j++) {
+      FlatNodeId(&f, nodes[j]);
+    }
+  }
+
+  // arc columns
+  int narcs = arcs_.size();
+  f.ucap_start.push_back(0);
+  f.vcap_start.push_back(0);
+  for (int i = 0; i != narcs; i++) {
+    const Arc& a = arcs_[i];
+    ExchangeNode::Ptr u = a.unode();
+    ExchangeNode::Ptr v = a.vnode();
+    f.arc_unode.push_back(FlatNodeId(&f, u));
+    f.arc_vnode.push_back(FlatNodeId(&f, v));
+    std::map<Arc, double>::const_iterator p = u->prefs.find(a);
+    f.arc_pref.push_back(p == u->prefs.end() ? 0 : p->second);
+    f.arc_exclusive.push_back(a.exclusive());
+    f.arc_excl_val.push_back(a.excl_val());
+    AppendUnitCaps(*u, a, &f.ucap_start, &f.ucaps);
+    AppendUnitCaps(*v, a, &f.vcap_start, &f.vcaps);
+  }
+
+  // node adjacency, matching the order of node_arc_map()
+  int nnodes = f.nodes.size();
+  f.adj_start.assign(nnodes + 1, 0);
+  for (int i = 0; i != narcs; i++) {
+    f.adj_start[f.arc_unode[i] + 1]++;
+    f.adj_start[f.arc_vnode[i] + 1]++;
+  }
+  for (int i = 0; i != nnodes; i++) {
+    f.adj_start[i + 1] += f.adj_start[i];
+  }
+  std::vector<int> next(f.adj_start.begin(), f.adj_start.end() - 1);
+  f.adj.resize(2 * narcs);
+  for (int i = 0; i != narcs; i++) {
+    f.adj[next[f.arc_unode[i]]++] = i;
+    f.adj[next[f.arc_vnode[i]]++] = i;
+  }
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
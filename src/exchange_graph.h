@@ -1,6 +1,7 @@
 #ifndef CYCLUS_SRC_EXCHANGE_GRAPH_H_
 #define CYCLUS_SRC_EXCHANGE_GRAPH_H_
 
+#include <cstdint>
 #include <limits>
 #include <map>
 #include <string>
@@ -10,6 +11,9 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 
+#include "block_pool.h"
+#include "mem_usage.h"
+
 namespace cyclus {
 
 class ExchangeNodeGroup;
@@ -24,15 +28,31 @@ class Arc;
 /// i.e., the maximum amount of a resource that can be attributed to
 /// it. Finally, nodes can be exclusive, that is to say that they represent a
 /// request or bid that must be exclusively satisfied (it can not be split).
-struct ExchangeNode {
+struct ExchangeNode
+    : private MemCounted<ExchangeNode, MemUsage::EXCHANGE_NODE> {
  public:
   typedef boost::shared_ptr<ExchangeNode> Ptr;
 
+  /// Nodes are allocated from the exchange's block pool (see
+  /// BlockPool::Exchange).
+  /// @{
+  static void* operator new(std::size_t size) {
+    return BlockPool::Exchange()->Alloc(size);
+  }
+  static void operator delete(void* p, std::size_t size) {
+    if (p != NULL) {
+      BlockPool::Exchange()->Free(p, size);
+    }
+  }
+  /// @}
+
   ExchangeNode();
   explicit ExchangeNode(double qty);
   ExchangeNode(double qty, bool exclusive);
   ExchangeNode(double qty, bool exclusive, std::string commod);
   ExchangeNode(double qty, bool exclusive, std::string commod, int agent_id);
+  /// @brief a node of the commodity with an id (see CommodityRegistry)
+  ExchangeNode(double qty, bool exclusive, int commod_id, int agent_id);
 
   /// @brief the parent ExchangeNodeGroup to which this ExchangeNode belongs
   ExchangeNodeGroup* group;
@@ -51,12 +71,26 @@ struct ExchangeNode {
   /// @brief the commodity associated with this exchange node
   std::string commod;
 
+  /// @brief the id of the commodity associated with this exchange node,
+  /// which nodes are compared and grouped by (see CommodityRegistry). It is
+  /// looked up again if commod was assigned since it was last returned.
+  int commod_id() const;
+
   /// @brief the id of the agent associated with this node
   int agent_id;
 
+  /// @brief the number of the request or bid that this node was translated
+  /// from in its exchange (see ExchangeContext), or -1
+  int index;
+
   /// @brief the maximum amount of a resource that can be associated with this
   /// node
   double qty;
+
+ private:
+  /// the id of interned_, the commodity name it was last looked up for
+  mutable int commod_id_;
+  mutable std::string interned_;
 };
 
 /// @brief An arc represents a possible connection between two nodes in the
@@ -64,7 +98,7 @@ struct ExchangeNode {
 /// nodes in a bipartite graph by the set variables U and V (see
 /// http://en.wikipedia.org/wiki/Bipartite_graph). By convention, arc.unode() ==
 /// request node, arc.vnode() == bid node.
-class Arc {
+class Arc : private MemCounted<Arc, MemUsage::ARC> {
  public:
   /// default required for usage in maps
   /// @warning, in general do not use this constructor; it exists for arcs to be
@@ -80,6 +114,7 @@ class Arc {
     vnode_ = other.vnode();
     exclusive_ = other.exclusive();
     excl_val_ = other.excl_val();
+    pref_ = other.pref();
     return *this;
   }
 
@@ -184,6 +219,7 @@ class RequestGroup : public ExchangeNodeGroup {
   explicit RequestGroup(double qty = 0.0);
 
   double qty() { return qty_; }
+  inline void qty(double qty) { qty_ = qty; }
 
   /// @brief Add the node to the ExchangeNodeGroup and informs the node it is a
   /// member of this ExchangeNodeGroup, if the node is exclusive, also add it to
@@ -196,6 +232,74 @@ class RequestGroup : public ExchangeNodeGroup {
 
 typedef std::pair<Arc, double> Match;
 
+/// @class FlatExchangeGraph
+///
+/// @brief A compact, index-based layout of an ExchangeGraph for use by
+/// solvers. Nodes, node groups, and arcs are numbered contiguously and their
+/// attributes are kept in parallel arrays, so that solving requires no
+/// weak_ptr locks or map lookups. Arc ids are positions in
+/// ExchangeGraph::arcs().
+///
+/// Variable-length per-item values are stored in compressed sparse row
+/// form: the values for item i are values[start[i]] through
+/// values[start[i + 1] - 1].
+struct FlatExchangeGraph {
+  /// @brief the nodes of the graph, by node id
+  std::vector<ExchangeNode::Ptr> nodes;
+
+  /// @brief the node id of each node
+  std::map<const ExchangeNode*, int> node_ids;
+
+  /// @brief the group id of each node, or -1 if it has no group
+  std::vector<int> node_group;
+
+  /// @brief the maximum quantity of each node
+  std::vector<double> node_qty;
+
+  /// @brief the agent id of each node
+  std::vector<int> node_agent_id;
+
+  /// @brief the node groups of the graph, by group id
+  std::vector<ExchangeNodeGroup*> groups;
+
+  /// @brief the request (u) and bid (v) node ids of each arc
+  /// @{
+  std::vector<int> arc_unode;
+  std::vector<int> arc_vnode;
+  /// @}
+
+  /// @brief the request node's preference for each arc
+  std::vector<double> arc_pref;
+
+  /// @brief the exclusivity and exclusive value of each arc
+  /// @{
+  std::vector<bool> arc_exclusive;
+  std::vector<double> arc_excl_val;
+  /// @}
+
+  /// @brief the unit capacities of each arc's request node (ucaps) and bid
+  /// node (vcaps), in CSR form by arc id
+  /// @{
+  std::vector<int> ucap_start;
+  std::vector<double> ucaps;
+  std::vector<int> vcap_start;
+  std::vector<double> vcaps;
+  /// @}
+
+  /// @brief the arcs of each node, in the order they were added to the
+  /// graph, in CSR form by node id
+  /// @{
+  std::vector<int> adj_start;
+  std::vector<int> adj;
+  /// @}
+
+  /// @return the node id of n, or -1 if n is not in the graph
+  inline int node_id(const ExchangeNode* n) const {
+    std::map<const ExchangeNode*, int>::const_iterator it = node_ids.find(n);
+    return it == node_ids.end() ? -1 : it->second;
+  }
+};
+
 /// @class ExchangeGraph
 ///
 /// @brief An ExchangeGraph is a resource-neutral representation of a
@@ -219,6 +323,35 @@ class ExchangeGraph {
   /// @brief adds an arc to the graph
   void AddArc(const Arc& a);
 
+  /// @brief returns the compact layout of the graph, building it if the graph
+  /// has not been flattened since it last had groups or arcs added
+  const FlatExchangeGraph& flat();
+
+  /// @brief (re)builds the compact layout of the graph. This must be called
+  /// again if node preferences, quantities, or unit capacities change after
+  /// the graph was flattened.
+  void Flatten();
+
+  /// @brief whether other poses exactly the same problem as this graph, i.e.,
+  /// whether the two graphs are identical but for the identity of their nodes
+  /// and groups, so that the matches of one are a solution to the other. Both
+  /// graphs are compared by their flattened layouts.
+  bool SameProblem(ExchangeGraph& other);
+
+  /// @brief a hash of the problem the graph poses, i.e., of everything
+  /// SameProblem compares, so that graphs posing the same problem have the
+  /// same fingerprint. Graphs with the same fingerprint are very likely, but
+  /// not certain, to pose the same problem.
+  uint64_t Fingerprint();
+
+  /// @brief splits the graph into its independent subproblems, i.e., its
+  /// connected components, where nodes are connected by arcs and by sharing a
+  /// node group. Each component is a new graph sharing the groups and arcs of
+  /// this one, and components are ordered by their first arc. Groups without
+  /// any arcs are added to the first component. No components are returned
+  /// if the graph cannot be split, i.e., if at most one component has arcs.
+  std::vector<Ptr> Components();
+
   /// @brief adds a match for a quanity of flow along an arc
   ///
   /// @param pa the arc corresponding to a match
@@ -270,6 +403,7 @@ class ExchangeGraph {
   std::map<Arc, int> arc_ids_;
   std::map<int, Arc> arc_by_id_;
   int next_arc_id_;
+  boost::shared_ptr<FlatExchangeGraph> flat_;
 };
 
 }  // namespace cyclus
@@ -2,13 +2,24 @@
 #define CYCLUS_SRC_EXCHANGE_MANAGER_H_
 
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
 
 #include "exchange_graph.h"
 #include "exchange_solver.h"
 #include "exchange_translator.h"
+#include "graph_dump.h"
+#include "hw_counters.h"
 #include "resource_exchange.h"
 #include "trade_executor.h"
 #include "trader_management.h"
+#include "tracer.h"
 #include "env.h"
 
 namespace cyclus {
@@ -24,62 +35,404 @@ namespace cyclus {
 /// ExchangeManager<ResourceType> manager(ctx);
 /// manager.Execute();
 /// @endcode
+///
+/// A manager that is executed every timestep runs incrementally by default:
+/// if the translated exchange graph poses exactly the same problem as one of
+/// the graphs solved at the last few executions, as is common in
+/// steady-state scenarios and in cycles that repeat, its matches are reused
+/// rather than solving the graph again. Graphs are looked up by their
+/// fingerprint (see ExchangeGraph::Fingerprint) and then compared in full.
+/// The CYCLUS_DRE_CACHE_SIZE environment variable sets how many graphs are
+/// kept (4 by default), and setting the CYCLUS_NO_INCREMENTAL_DRE
+/// environment variable turns this off.
+///
+/// Thread-safe traders are queried for requests and bids, and thread-safe
+/// suppliers for their responses to trades, on the threads of the context's
+/// scheduler (see Context::scheduler), or on at most the number given by the
+/// CYCLUS_DRE_THREADS environment variable.
+///
+/// If partitioned by region, with the dre_regions control parameter, the
+/// CYCLUS_DRE_REGIONS environment variable, or partition_regions(), the
+/// trades within each region are solved first, each region separately and
+/// concurrently with the others, and only then the trades between regions,
+/// with what is left (see ExchangeSolver::SolvePartitioned). This suits
+/// studies whose regions rarely trade with each other.
+///
+/// Setting the dre_coarsen control parameter, the CYCLUS_DRE_COARSEN
+/// environment variable, which overrides it, or coarsen(), merges the
+/// identical request groups of the requesters of each institution before
+/// solving, e.g., those of hundreds of identical reactors, and splits the
+/// matches of each merged group among its requesters afterwards (see
+/// ExchangeCoarsener). The requesters are filled one after the other, unless
+/// the setting is "proportional", which shares the flow evenly among them.
+/// The coarsened graphs are the ones dumped and reused.
+///
+/// If enabled by the dre_timings control parameter or the CYCLUS_DRE_TIMINGS
+/// environment variable, the wall-clock time spent in each phase of every
+/// execution and the size of the exchange graph are recorded in the
+/// DreTimings table, along with the number of arcs that were pruned during
+/// translation. Setting the CYCLUS_NO_DRE_PRUNING environment variable keeps
+/// every arc with a non-negative preference in the graph. If the context has
+/// a tracer, each phase of every execution is traced as a span, and if it
+/// has hardware counters, the events of each phase are counted.
+///
+/// If the CYCLUS_DRE_DUMP environment variable is set to a path, the
+/// translated graphs are appended to that file before they are solved, and
+/// their matches once they are (see DumpGraph and DumpMatches). This is a
+/// compact binary capture of the requests, bids, preferences and matches of
+/// the exchanges, which the cyclus_dre_replay tool reads, and costs far less
+/// than the DebugRequests and DebugBids tables recorded if the
+/// CYCLUS_DEBUG_DRE environment variable is set. Graphs are dumped at the
+/// time steps in the comma separated list of the CYCLUS_DRE_DUMP_TIMES
+/// environment variable and at every time step that is a multiple of the
+/// CYCLUS_DRE_DUMP_EVERY environment variable, or at every time step if
+/// neither is set. If the CYCLUS_DRE_DUMP_COMMODITIES environment variable
+/// is set to a comma separated list of commodities, only the part of each
+/// graph that trades those is dumped.
 template <class T>
 class ExchangeManager {
  public:
-  ExchangeManager(Context* ctx) : ctx_(ctx), debug_(false) {
+  ExchangeManager(Context* ctx) : ctx_(ctx), debug_(false), reused_(false) {
     debug_ = Env::GetEnv("CYCLUS_DEBUG_DRE").size() > 0;
+    timings_ = ctx->sim_info().dre_timings ||
+               Env::GetEnv("CYCLUS_DRE_TIMINGS").size() > 0;
+    incremental_ = Env::GetEnv("CYCLUS_NO_INCREMENTAL_DRE").size() == 0;
+    std::string cache_size = Env::GetEnv("CYCLUS_DRE_CACHE_SIZE");
+    cache_size_ = cache_size.empty() ? 4 : std::atoi(cache_size.c_str());
+    prune_ = Env::GetEnv("CYCLUS_NO_DRE_PRUNING").size() == 0;
+    std::string coarsen = Env::GetEnv("CYCLUS_DRE_COARSEN");
+    if (coarsen.empty())
+      coarsen = ctx->sim_info().dre_coarsen;
+    coarsen_ = !coarsen.empty();
+    split_ = coarsen == "proportional" ? ExchangeCoarsener::PROPORTIONAL :
+             ExchangeCoarsener::IN_ORDER;
+    regions_ = ctx->sim_info().dre_regions ||
+               Env::GetEnv("CYCLUS_DRE_REGIONS").size() > 0;
+    std::string nthreads = Env::GetEnv("CYCLUS_DRE_THREADS");
+    threads_ = nthreads.empty() ? std::thread::hardware_concurrency() :
+               std::atoi(nthreads.c_str());
+    dump_path_ = Env::GetEnv("CYCLUS_DRE_DUMP");
+    std::stringstream times(Env::GetEnv("CYCLUS_DRE_DUMP_TIMES"));
+    std::string t;
+    while (std::getline(times, t, ',')) {
+      dump_times_.insert(std::atoi(t.c_str()));
+    }
+    dump_every_ = std::atoi(Env::GetEnv("CYCLUS_DRE_DUMP_EVERY").c_str());
+    std::stringstream commods(Env::GetEnv("CYCLUS_DRE_DUMP_COMMODITIES"));
+    while (std::getline(commods, t, ',')) {
+      if (!t.empty())
+        dump_commods_.insert(t);
+    }
   }
 
+  /// @brief the number of threads used to query thread-safe traders and
+  /// suppliers
+  /// @{
+  inline int threads() const { return threads_; }
+  inline void threads(int n) { threads_ = n; }
+  /// @}
+
+  /// @brief whether solutions are reused across executions when the exchange
+  /// is unchanged
+  /// @{
+  inline bool incremental() const { return incremental_; }
+  inline void incremental(bool incremental) {
+    incremental_ = incremental;
+    cache_.clear();
+  }
+  /// @}
+
+  /// @brief the number of recently solved graphs whose solutions may be
+  /// reused
+  /// @{
+  inline int cache_size() const { return cache_size_; }
+  inline void cache_size(int n) {
+    cache_size_ = n;
+    while (cache_.size() > std::max(n, 0))
+      cache_.pop_back();
+  }
+  /// @}
+
+  /// @brief whether the last execution reused the previous solution
+  inline bool reused() const { return reused_; }
+
+  /// @brief whether arcs that can not carry flow or are dominated are pruned
+  /// from the graph before solving
+  /// @{
+  inline bool prune() const { return prune_; }
+  inline void prune(bool prune) { prune_ = prune; }
+  /// @}
+
+  /// @brief whether identical request groups of the same institution are
+  /// merged before solving, and how their matches are split among them
+  /// @{
+  inline bool coarsen() const { return coarsen_; }
+  inline void coarsen(bool coarsen) { coarsen_ = coarsen; }
+  inline ExchangeCoarsener::Split split() const { return split_; }
+  inline void split(ExchangeCoarsener::Split split) { split_ = split; }
+  /// @}
+
+  /// @brief whether trades within regions are solved before, and take
+  /// precedence over, trades between regions
+  /// @{
+  inline bool partition_regions() const { return regions_; }
+  inline void partition_regions(bool regions) { regions_ = regions; }
+  /// @}
+
+  /// @brief whether the time spent in each phase is recorded
+  /// @{
+  inline bool timings() const { return timings_; }
+  inline void timings(bool timings) { timings_ = timings; }
+  /// @}
+
   /// @brief execute the full resource sequence
   void Execute() {
+    reused_ = false;
+    Timings t;
+    if (ctx_->traders(T::kType).empty()) {
+      // no trader takes part in exchanges of this type
+      if (timings_)
+        RecordTimings(t, NULL, ArcPruneCounts());
+      return;
+    }
+    Clock::time_point start;
+    Restart(&start);
+
     // collect resource exchange information
     ResourceExchange<T> exchng(ctx_);
+    exchng.set_threads(threads_);
     exchng.AddAllRequests();
+    t.requests = Lap(&start, "Requests");
     exchng.AddAllBids();
+    t.bids = Lap(&start, "Bids");
     exchng.AdjustAll();
+    t.prefs = Lap(&start, "Preferences");
     CLOG(LEV_DEBUG1) << "done with info gathering";
     
     if (debug_)
       RecordDebugInfo(exchng.ex_ctx());
 
-    if (exchng.Empty())
-      return; // empty exchange, move on
+    if (exchng.Empty()) {
+      // empty exchange, move on
+      if (timings_)
+        RecordTimings(t, NULL, ArcPruneCounts());
+      return;
+    }
 
     // translate graph
+    Restart(&start);
     ExchangeTranslator<T> xlator(&exchng.ex_ctx());
+    xlator.prune(prune_);
+    xlator.coarsen(coarsen_);
+    xlator.coarsener().split(split_);
     CLOG(LEV_DEBUG1) << "translating graph...";
     ExchangeGraph::Ptr graph = xlator.Translate();
     CLOG(LEV_DEBUG1) << "graph translated!";
+    t.translate = Lap(&start, "Translation");
+
+    std::ofstream dump;
+    if (Dumps(ctx_->time())) {
+      dump.open(dump_path_.c_str(), std::ios::binary | std::ios::app);
+      DumpGraph(dump, ctx_->time(), T::kType, *graph, dump_commods_);
+      Restart(&start);
+    }
+
+    bool incremental = incremental_ && cache_size_ > 0;
+    uint64_t fingerprint = incremental ? graph->Fingerprint() : 0;
+    typename std::deque<CacheEntry>::iterator hit = cache_.end();
+    if (incremental) {
+      for (hit = cache_.begin(); hit != cache_.end(); ++hit) {
+        if (hit->fingerprint == fingerprint &&
+            graph->SameProblem(*hit->graph))
+          break;
+      }
+    }
 
-    // solve graph
-    CLOG(LEV_DEBUG1) << "solving graph...";
-    ctx_->solver()->Solve(graph.get());
-    CLOG(LEV_DEBUG1) << "graph solved!";
+    if (hit != cache_.end()) {
+      // warm start: an identical problem has a recent solution
+      CLOG(LEV_DEBUG1) << "graph unchanged, reusing a recent solution";
+      std::vector<Arc>& arcs = graph->arcs();
+      const std::vector<std::pair<int, double> >& matches = hit->matches;
+      for (int i = 0; i != matches.size(); i++) {
+        graph->AddMatch(arcs[matches[i].first], matches[i].second);
+      }
+      CacheEntry e = *hit;
+      cache_.erase(hit);
+      cache_.push_front(e);
+      reused_ = true;
+    } else {
+      // solve graph
+      CLOG(LEV_DEBUG1) << "solving graph...";
+      if (regions_) {
+        ctx_->solver()->SolvePartitioned(graph.get(),
+                                         Regions(exchng.ex_ctx()));
+      } else {
+        ctx_->solver()->Solve(graph.get());
+      }
+      CLOG(LEV_DEBUG1) << "graph solved!";
+    }
+    t.solve = Lap(&start, "Solve");
+
+    if (dump.is_open()) {
+      DumpMatches(dump, *graph, dump_commods_);
+      dump.close();
+    }
+
+    if (incremental && !reused_) {
+      CacheEntry e;
+      e.fingerprint = fingerprint;
+      e.graph = graph;
+      const std::vector<Match>& matches = graph->matches();
+      for (int i = 0; i != matches.size(); i++) {
+        e.matches.push_back(std::make_pair(
+            graph->arc_ids()[matches[i].first], matches[i].second));
+      }
+      cache_.push_front(e);
+      while (cache_.size() > cache_size_)
+        cache_.pop_back();
+    }
 
     // get trades
+    Restart(&start);
     std::vector< Trade<T> > trades;
     xlator.BackTranslateSolution(graph->matches(), trades);
     CLOG(LEV_DEBUG1) << "trades translated!";
+    t.back_translate = Lap(&start, "BackTranslation");
 
     // execute trades!
     TradeExecutor<T> exec(trades);
+    exec.set_threads(threads_);
     exec.ExecuteTrades(ctx_);
+    t.trades = Lap(&start, "Trades");
+
+    if (timings_)
+      RecordTimings(t, graph.get(), xlator.pruned());
   }
 
  private:
+  typedef std::chrono::steady_clock Clock;
+
+  /// a recently solved graph, its fingerprint, and its matches, by arc id
+  struct CacheEntry {
+    uint64_t fingerprint;
+    ExchangeGraph::Ptr graph;
+    std::vector<std::pair<int, double> > matches;
+  };
+
+  /// the wall-clock seconds spent in each phase of an execution
+  struct Timings {
+    Timings()
+        : requests(0),
+          bids(0),
+          prefs(0),
+          translate(0),
+          solve(0),
+          back_translate(0),
+          trades(0) {}
+
+    double requests, bids, prefs, translate, solve, back_translate, trades;
+  };
+
+  /// returns the region of the manager of each trader in the exchange, by
+  /// agent id, leaving out agents that aren't in a region
+  std::map<int, int> Regions(const ExchangeContext<T>& ex) {
+    std::set<Trader*> traders(ex.requesters);
+    traders.insert(ex.bidders.begin(), ex.bidders.end());
+    std::map<int, int> regions;
+    std::set<Trader*>::iterator it;
+    for (it = traders.begin(); it != traders.end(); ++it) {
+      Agent* a = (*it)->manager();
+      for (Agent* p = a; p != NULL; p = p->parent()) {
+        if (p->kind() == "Region") {
+          regions[a->id()] = p->id();
+          break;
+        }
+      }
+    }
+    return regions;
+  }
+
+  /// returns whether the graph of the exchange at time is dumped
+  bool Dumps(int time) const {
+    if (dump_path_.empty())
+      return false;
+    if (dump_times_.empty() && dump_every_ <= 0)
+      return true;
+    return dump_times_.count(time) > 0 ||
+           (dump_every_ > 0 && time % dump_every_ == 0);
+  }
+
+  /// starts timing a phase at now, and counting its hardware events if the
+  /// context has counters
+  void Restart(Clock::time_point* start) {
+    if (ctx_->hw_counters() != NULL)
+      hw_start_ = ctx_->hw_counters()->Read();
+    *start = Clock::now();
+  }
+
+  /// returns the seconds elapsed since start and restarts timing, adding the
+  /// phase to the context's tracer and hardware counters, if any
+  double Lap(Clock::time_point* start, const char* phase) {
+    Clock::time_point now = Clock::now();
+    double secs = std::chrono::duration<double>(now - *start).count();
+    if (ctx_->tracer() != NULL)
+      ctx_->tracer()->Add(phase, "dre", *start, now);
+    if (ctx_->hw_counters() != NULL) {
+      ctx_->hw_counters()->Add("dre", phase, hw_start_, secs);
+      hw_start_ = ctx_->hw_counters()->Read();
+    }
+    *start = now;
+    return secs;
+  }
+
+  /// records the phase timings of an execution, the size of its graph, if one
+  /// was translated, and the number of arcs pruned from it
+  void RecordTimings(const Timings& t, ExchangeGraph* graph,
+                     const ArcPruneCounts& pruned) {
+    int nnodes = 0;
+    int narcs = 0;
+    int ngroups = 0;
+    if (graph != NULL) {
+      const FlatExchangeGraph& f = graph->flat();
+      nnodes = f.nodes.size();
+      narcs = graph->arcs().size();
+      ngroups = graph->request_groups().size() + graph->supply_groups().size();
+    }
+    ctx_->NewDatum("DreTimings")
+        ->AddVal("Time", ctx_->time())
+        ->AddVal("ResourceType", T::kType)
+        ->AddVal("Requests", t.requests)
+        ->AddVal("Bids", t.bids)
+        ->AddVal("Preferences", t.prefs)
+        ->AddVal("Translation", t.translate)
+        ->AddVal("Solve", t.solve)
+        ->AddVal("BackTranslation", t.back_translate)
+        ->AddVal("Trades", t.trades)
+        ->AddVal("NumNodes", nnodes)
+        ->AddVal("NumArcs", narcs)
+        ->AddVal("NumGroups", ngroups)
+        ->AddVal("PrunedPreference", pruned.preference)
+        ->AddVal("PrunedCapacity", pruned.capacity)
+        ->AddVal("PrunedDominated", pruned.dominated)
+        ->AddVal("Reused", reused_)
+        ->Record();
+  }
+
   void RecordDebugInfo(ExchangeContext<T>& exctx) {
+    // the id of each request, formatted once for it and its bids
+    std::map<Request<T>*, std::string> ids;
     typename std::vector<typename RequestPortfolio<T>::Ptr>::iterator it;
     for (it = exctx.requests.begin(); it != exctx.requests.end(); ++it) {
-      std::vector<Request<T>*> reqs = (*it)->requests();
-      typename std::vector<Request<T>*>::iterator it2;
+      const std::vector<Request<T>*>& reqs = (*it)->requests();
+      typename std::vector<Request<T>*>::const_iterator it2;
       for (it2 = reqs.begin(); it2 != reqs.end(); ++it2) {
         Request<T>* r = *it2;
         std::stringstream ss;
         ss << ctx_->time() << "_" << r;
+        const std::string& id = ids[r] = ss.str();
         ctx_->NewDatum("DebugRequests")
           ->AddVal("Time", ctx_->time())
-          ->AddVal("ReqId", ss.str())
+          ->AddVal("ReqId", id)
           ->AddVal("RequesterID", r->requester()->manager()->id())
           ->AddVal("Commodity", r->commodity())
           ->AddVal("Preference", r->preference())
@@ -93,16 +446,19 @@ class ExchangeManager {
 
     typename std::vector<typename BidPortfolio<T>::Ptr>::iterator it3;
     for (it3 = exctx.bids.begin(); it3 != exctx.bids.end(); ++it3) {
-      std::set<Bid<T>*> bids = (*it3)->bids();
-      typename std::set<Bid<T>*>::iterator it4;
+      const std::set<Bid<T>*>& bids = (*it3)->bids();
+      typename std::set<Bid<T>*>::const_iterator it4;
       for (it4 = bids.begin(); it4 != bids.end(); ++it4) {
         Bid<T>* b = *it4;
-        Request<T>* r = b->request();
-        double pref = exctx.trader_prefs[r->requester()][r][b];
-        std::stringstream ss;
-        ss << ctx_->time() << "_" << b->request();
+        double pref = exctx.pref(exctx.arc(b));
+        std::string& id = ids[b->request()];
+        if (id.empty()) {
+          std::stringstream ss;
+          ss << ctx_->time() << "_" << b->request();
+          id = ss.str();
+        }
         ctx_->NewDatum("DebugBids")
-          ->AddVal("ReqId", ss.str())
+          ->AddVal("ReqId", id)
           ->AddVal("BidderId", b->bidder()->manager()->id())
           ->AddVal("BidQuantity", b->offer()->quantity())
           ->AddVal("Exclusive", b->exclusive())
@@ -113,7 +469,30 @@ class ExchangeManager {
   }
 
   bool debug_;
+  bool timings_;
+  bool prune_;
+  bool coarsen_;
+  ExchangeCoarsener::Split split_;
+  bool regions_;
+  bool incremental_;
+  bool reused_;
+  int cache_size_;
+  int threads_;
   Context* ctx_;
+
+  /// the file graphs are dumped to, if any, the time steps they are dumped
+  /// at and the period of those they are dumped at, or all if neither is
+  /// given, and the commodities dumped, or all if empty
+  std::string dump_path_;
+  std::set<int> dump_times_;
+  int dump_every_;
+  std::set<std::string> dump_commods_;
+
+  /// the hardware counts at the start of the phase being timed
+  HwCounters::Values hw_start_;
+
+  /// the graphs most recently solved or reused, most recent first
+  std::deque<CacheEntry> cache_;
 };
 
 }  // namespace cyclus
@@ -1,20 +1,271 @@
 #include "exchange_solver.h"
 
-#include <vector>
+#include <atomic>
+#include <exception>
+#include <limits>
 #include <map>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
 
 #include "context.h"
 #include "exchange_graph.h"
+#include "logger.h"
+#include "task_scheduler.h"
 
 namespace cyclus {
 
+ExchangeSolver::ExchangeSolver(bool exclusive_orders)
+    : exclusive_orders_(exclusive_orders),
+      graph_(NULL),
+      sim_ctx_(NULL),
+      verbose_(false),
+      decompose_(true),
+      threads_(std::max(1u, std::thread::hardware_concurrency())),
+      pseudo_cost_(-1) {}
+
+double ExchangeSolver::Solve(ExchangeGraph* graph) {
+  if (graph != NULL)
+    graph_ = graph;
+  if (decompose_ && graph_ != NULL) {
+    std::vector<ExchangeGraph::Ptr> comps = graph_->Components();
+    if (comps.size() > 1)
+      return SolveComponents(comps);
+  }
+  return this->SolveGraph();
+}
+
+double ExchangeSolver::SolveGraphWith(ExchangeSolver* s) {
+  s->graph_ = graph_;
+  s->sim_ctx_ = sim_ctx_;
+  s->pseudo_cost_ = PseudoCost();
+  double obj = s->SolveGraph();
+  s->pseudo_cost_ = -1;
+  return obj;
+}
+
+double ExchangeSolver::SolveComponents(
+    const std::vector<ExchangeGraph::Ptr>& comps) {
+  CLOG(LEV_DEBUG1) << "Solving " << comps.size()
+                   << " independent exchange subgraphs.";
+  int n = comps.size();
+  std::vector<double> objs(n, 0);
+  std::vector<std::exception_ptr> errs(n);
+  double pseudo_cost = PseudoCost();
+
+  // solves comps[i] with s, which is never asked to decompose further
+  auto solve = [&](ExchangeSolver* s, int i) {
+    s->graph_ = comps[i].get();
+    s->pseudo_cost_ = pseudo_cost;
+    try {
+      objs[i] = s->SolveGraph();
+    } catch (...) {
+      errs[i] = std::current_exception();
+    }
+  };
+
+  ExchangeSolver* first = threads_ > 1 ? Clone() : NULL;
+  if (first == NULL) {
+    ExchangeGraph* graph = graph_;
+    for (int i = 0; i != n; i++) {
+      solve(this, i);
+      if (errs[i])
+        break;
+    }
+    graph_ = graph;
+    pseudo_cost_ = -1;
+  } else {
+    // solvers without a simulation, e.g. in the DRE replay tool, have a
+    // scheduler of their own
+    TaskScheduler* sched = sim_ctx_ != NULL ? sim_ctx_->scheduler() : NULL;
+    std::unique_ptr<TaskScheduler> own;
+    if (sched == NULL) {
+      own.reset(new TaskScheduler(threads_));
+      sched = own.get();
+    }
+    int nthreads = std::min(std::min(threads_, n), sched->threads());
+    std::vector<std::unique_ptr<ExchangeSolver> > solvers;
+    solvers.push_back(std::unique_ptr<ExchangeSolver>(first));
+    for (int i = 1; i < nthreads; i++) {
+      solvers.push_back(std::unique_ptr<ExchangeSolver>(Clone()));
+    }
+    std::atomic<int> next(0);
+    std::atomic<int> nworkers(0);
+    sched->RunWorkers(nthreads, [&]() {
+      ExchangeSolver* s = solvers[nworkers++].get();
+      for (int i = next++; i < n; i = next++) {
+        solve(s, i);
+      }
+    });
+  }
+
+  // merge the solutions in component order
+  double obj = 0;
+  for (int i = 0; i != n; i++) {
+    if (errs[i])
+      std::rethrow_exception(errs[i]);
+    const std::vector<Match>& matches = comps[i]->matches();
+    for (int j = 0; j != matches.size(); j++) {
+      graph_->AddMatch(matches[j].first, matches[j].second);
+    }
+    obj += objs[i];
+  }
+  return obj;
+}
+
+namespace {
+
+// Returns the partition of the agent of n.
+int PartOf(const ExchangeNode& n, const std::map<int, int>& parts) {
+  std::map<int, int>::const_iterator it = parts.find(n.agent_id);
+  return it == parts.end() ? -1 : it->second;
+}
+
+// Takes the flow qty on arc a out of what is left of n and its group,
+// saving their quantities and capacities beforehand, and marks exclusive
+// nodes, and the nodes exclusive with them, as spent.
+void TakeFlow(ExchangeNode* n, const Arc& a, double qty,
+              std::map<ExchangeNode*, double>* qtys,
+              std::map<ExchangeNodeGroup*, std::vector<double> >* caps,
+              std::map<RequestGroup*, double>* req_qtys,
+              std::set<ExchangeNode*>* spent) {
+  if (qtys->count(n) == 0)
+    (*qtys)[n] = n->qty;
+  n->qty = std::max(0.0, n->qty - qty);
+
+  ExchangeNodeGroup* g = n->group;
+  if (g == NULL)
+    return;
+  std::vector<double>& gcaps = g->capacities();
+  if (caps->count(g) == 0)
+    (*caps)[g] = gcaps;
+  std::map<Arc, std::vector<double> >::iterator it =
+      n->unit_capacities.find(a);
+  if (it != n->unit_capacities.end()) {
+    for (int i = 0; i != gcaps.size() && i != it->second.size(); i++) {
+      if (gcaps[i] != std::numeric_limits<double>::max())
+        gcaps[i] = std::max(0.0, gcaps[i] - qty * it->second[i]);
+    }
+  }
+
+  RequestGroup* rg = dynamic_cast<RequestGroup*>(g);
+  if (rg != NULL) {
+    if (req_qtys->count(rg) == 0)
+      (*req_qtys)[rg] = rg->qty();
+    rg->qty(std::max(0.0, rg->qty() - qty));
+  }
+
+  if (n->exclusive) {
+    spent->insert(n);
+    const std::vector<std::vector<ExchangeNode::Ptr> >& excl =
+        g->excl_node_groups();
+    for (int i = 0; i != excl.size(); i++) {
+      bool member = false;
+      for (int j = 0; j != excl[i].size() && !member; j++) {
+        member = excl[i][j].get() == n;
+      }
+      for (int j = 0; j != excl[i].size() && member; j++) {
+        spent->insert(excl[i][j].get());
+      }
+    }
+  }
+}
+
+}  // namespace
+
+double ExchangeSolver::SolvePartitioned(ExchangeGraph* graph,
+                                        const std::map<int, int>& parts) {
+  ExchangeGraph local;
+  for (int i = 0; i != graph->request_groups().size(); i++) {
+    local.AddRequestGroup(graph->request_groups()[i]);
+  }
+  for (int i = 0; i != graph->supply_groups().size(); i++) {
+    local.AddSupplyGroup(graph->supply_groups()[i]);
+  }
+  std::vector<Arc> between;
+  const std::vector<Arc>& arcs = graph->arcs();
+  for (int i = 0; i != arcs.size(); i++) {
+    if (PartOf(*arcs[i].unode(), parts) == PartOf(*arcs[i].vnode(), parts)) {
+      local.AddArc(arcs[i]);
+    } else {
+      between.push_back(arcs[i]);
+    }
+  }
+  CLOG(LEV_DEBUG1) << "Solving " << local.arcs().size()
+                   << " arcs within partitions and " << between.size()
+                   << " between them.";
+
+  double obj = 0;
+  if (!local.arcs().empty())
+    obj += Solve(&local);
+
+  // the trades between partitions get what the local trades left
+  std::map<ExchangeNode*, double> qtys;
+  std::map<ExchangeNodeGroup*, std::vector<double> > caps;
+  std::map<RequestGroup*, double> req_qtys;
+  std::set<ExchangeNode*> spent;
+  const std::vector<Match>& matches = local.matches();
+  for (int i = 0; i != matches.size(); i++) {
+    const Arc& a = matches[i].first;
+    double qty = matches[i].second;
+    graph->AddMatch(a, qty);
+    TakeFlow(a.unode().get(), a, qty, &qtys, &caps, &req_qtys, &spent);
+    TakeFlow(a.vnode().get(), a, qty, &qtys, &caps, &req_qtys, &spent);
+  }
+
+  ExchangeGraph global;
+  for (int i = 0; i != graph->request_groups().size(); i++) {
+    global.AddRequestGroup(graph->request_groups()[i]);
+  }
+  for (int i = 0; i != graph->supply_groups().size(); i++) {
+    global.AddSupplyGroup(graph->supply_groups()[i]);
+  }
+  for (int i = 0; i != between.size(); i++) {
+    if (spent.count(between[i].unode().get()) == 0 &&
+        spent.count(between[i].vnode().get()) == 0)
+      global.AddArc(between[i]);
+  }
+
+  std::exception_ptr err;
+  if (!global.arcs().empty()) {
+    try {
+      obj += Solve(&global);
+    } catch (...) {
+      err = std::current_exception();
+    }
+  }
+
+  std::map<ExchangeNode*, double>::iterator q_it;
+  for (q_it = qtys.begin(); q_it != qtys.end(); ++q_it) {
+    q_it->first->qty = q_it->second;
+  }
+  std::map<ExchangeNodeGroup*, std::vector<double> >::iterator c_it;
+  for (c_it = caps.begin(); c_it != caps.end(); ++c_it) {
+    c_it->first->capacities() = c_it->second;
+  }
+  std::map<RequestGroup*, double>::iterator r_it;
+  for (r_it = req_qtys.begin(); r_it != req_qtys.end(); ++r_it) {
+    r_it->first->qty(r_it->second);
+  }
+  graph_ = graph;
+  if (err)
+    std::rethrow_exception(err);
+
+  const std::vector<Match>& global_matches = global.matches();
+  for (int i = 0; i != global_matches.size(); i++) {
+    graph->AddMatch(global_matches[i].first, global_matches[i].second);
+  }
+  return obj;
+}
+
 double ExchangeSolver::Cost(const Arc& a, bool exclusive_orders) {
   return (exclusive_orders && a.exclusive()) ?
       a.excl_val() / a.pref() : 1.0 / a.pref();  
 }
 
 double ExchangeSolver::PseudoCost() {
-  return PseudoCost(1e-1);
+  return pseudo_cost_ >= 0 ? pseudo_cost_ : PseudoCost(1e-1);
 }
 
 double ExchangeSolver::PseudoCost(double cost_factor) {
@@ -2,6 +2,10 @@
 #define CYCLUS_SRC_EXCHANGE_SOLVER_H_
 
 #include <cstddef>
+#include <map>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
 
 namespace cyclus {
 
@@ -20,10 +24,7 @@ class ExchangeSolver {
   /// return the cost of an arc
   static double Cost(const Arc& a, bool exclusive_orders = kDefaultExclusive);
 
-  explicit ExchangeSolver(bool exclusive_orders = kDefaultExclusive)
-    : exclusive_orders_(exclusive_orders),
-      sim_ctx_(NULL),
-      verbose_(false) {}
+  explicit ExchangeSolver(bool exclusive_orders = kDefaultExclusive);
   virtual ~ExchangeSolver() {}
 
   /// simulation context get/set
@@ -37,13 +38,42 @@ class ExchangeSolver {
   inline void graph(ExchangeGraph* graph) { graph_ = graph; }
   inline ExchangeGraph* graph() const { return graph_; }
 
+  /// whether graphs are split into their independent subproblems (see
+  /// ExchangeGraph::Components), which are then solved separately, by default
+  /// on as many threads as the hardware supports
+  /// @{
+  inline void decompose(bool d) { decompose_ = d; }
+  inline bool decompose() const { return decompose_; }
+  inline void threads(int n) { threads_ = n < 1 ? 1 : n; }
+  inline int threads() const { return threads_; }
+  /// @}
+
   /// @brief interface for solving a given exchange graph
   /// @param a pointer to the graph to be solved
-  double Solve(ExchangeGraph* graph = NULL) {
-    if (graph != NULL)
-      graph_ = graph;
-    return this->SolveGraph();
-  }
+  /// @return the objective value of the solution, i.e., the sum of those of
+  /// its subproblems if the graph was decomposed
+  double Solve(ExchangeGraph* graph = NULL);
+
+  /// @brief solves a graph whose traders are partitioned, e.g., by region,
+  /// in two phases. First the arcs within each partition are solved, each
+  /// partition being an independent subproblem that is solved concurrently
+  /// with the others if the graph is decomposed. Then the arcs between
+  /// partitions are solved with the capacities and quantities left over. The
+  /// matches of both phases are added to the graph, whose capacities and
+  /// quantities are left as they were. Trades within a partition thus take
+  /// precedence over trades between partitions, whatever their preference.
+  /// @param graph the graph to solve
+  /// @param parts the partition of each agent id; agents that aren't listed
+  /// share a partition
+  /// @return the sum of the objective values of both phases
+  double SolvePartitioned(ExchangeGraph* graph,
+                          const std::map<int, int>& parts);
+
+  /// @brief returns a new solver with the same configuration as this one, or
+  /// NULL if the solver cannot be copied. Subproblems of a decomposed graph
+  /// are solved concurrently, by copies of the solver, only if it can be
+  /// copied and are otherwise solved one after another by this solver.
+  virtual ExchangeSolver* Clone() { return NULL; }
 
   /// @brief Calculates the ratio of the maximum objective coefficient to
   /// minimum unit capacity plus an added cost. This is guaranteed to be larger
@@ -52,6 +82,8 @@ class ExchangeSolver {
   /// @param cost_factor the additional cost for false arc costs, i.e., max_cost
   /// * (1 + cost_factor)
   /// @{
+  /// @warning while solving the subproblems of a graph, PseudoCost() returns
+  /// the pseudo cost of the whole graph.
   double PseudoCost();
   double PseudoCost(double cost_factor);
   double PseudoCostByCap(double cost_factor);
@@ -65,10 +97,26 @@ class ExchangeSolver {
   /// @brief Worker function for solving a graph. This must be implemented by
   /// any solver.
   virtual double SolveGraph() = 0;
+
+  /// @brief solves graph_ with another solver, as part of solving it with
+  /// this one, e.g., to hand problems to a fallback solver
+  double SolveGraphWith(ExchangeSolver* s);
+
   ExchangeGraph* graph_;
   bool exclusive_orders_;
   bool verbose_;
   Context* sim_ctx_;
+  bool decompose_;
+  int threads_;
+
+  /// the pseudo cost of the graph being decomposed, if any, or a negative
+  /// value otherwise
+  double pseudo_cost_;
+
+ private:
+  /// solves each of the components of graph_
+  double SolveComponents(const std::vector<boost::shared_ptr<ExchangeGraph> >&
+                             comps);
 };
 
 }  // namespace cyclus
@@ -2,6 +2,8 @@
 #define CYCLUS_SRC_EXCHANGE_TRANSLATION_CONTEXT_H_
 
 #include <map>
+#include <utility>
+#include <vector>
 
 #include "bid.h"
 #include "exchange_graph.h"
@@ -9,18 +11,58 @@
 
 namespace cyclus {
 
+template <class T> struct ExchangeContext;
+
 /// @class ExchangeTranslationContext
 ///
 /// @brief An ExchangeTranslationContext is a simple holder class for any
 /// information needed to translate a ResourceExchange to and from an
 /// ExchangeGraph
+///
+/// Requests and bids that the exchange context ex_ctx has numbered are
+/// translated directly: their nodes are indexed by their numbers (see
+/// ExchangeNode::index), and looked up in the vectors below. Any others,
+/// e.g., of contexts without ex_ctx, are looked up in the maps. Use
+/// request() and bid() to look up the request or bid of any node.
 template <class T>
 struct ExchangeTranslationContext {
  public:
+  ExchangeTranslationContext() : ex_ctx(NULL) {}
+
+  /// @brief the request that node n was translated from
+  inline Request<T>* request(const ExchangeNode::Ptr& n) const {
+    return n->index >= 0 ? requests[n->index] : node_to_request.at(n);
+  }
+
+  /// @brief the bid that node n was translated from
+  inline Bid<T>* bid(const ExchangeNode::Ptr& n) const {
+    return n->index >= 0 ? bids[n->index] : node_to_bid.at(n);
+  }
+
   std::map<Request<T>*, ExchangeNode::Ptr> request_to_node;
   std::map<ExchangeNode::Ptr, Request<T>*> node_to_request;
   std::map<Bid<T>*, ExchangeNode::Ptr> bid_to_node;
   std::map<ExchangeNode::Ptr, Bid<T>*> node_to_bid;
+
+  /// @brief the exchange context that numbers requests and bids, or NULL
+  const ExchangeContext<T>* ex_ctx;
+
+  /// @brief the requests, and their nodes, by number
+  /// @{
+  std::vector<Request<T>*> requests;
+  std::vector<ExchangeNode::Ptr> request_nodes;
+  /// @}
+
+  /// @brief the bids, and their nodes, by number
+  /// @{
+  std::vector<Bid<T>*> bids;
+  std::vector<ExchangeNode::Ptr> bid_nodes;
+  /// @}
+
+  /// @brief the conversions of offers by converters that depend on nothing
+  /// but the offer (see Converter::offer_only), by converter and the object
+  /// id of the offer
+  mutable std::map<std::pair<const void*, int>, double> conversions;
 };
 
 }  // namespace cyclus
@@ -1,11 +1,17 @@
 #ifndef CYCLUS_SRC_EXCHANGE_TRANSLATOR_H_
 #define CYCLUS_SRC_EXCHANGE_TRANSLATOR_H_
 
+#include <map>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 #include "bid.h"
 #include "bid_portfolio.h"
+#include "cyc_limits.h"
 #include "error.h"
+#include "exchange_coarsener.h"
+#include "exchange_context.h"
 #include "exchange_graph.h"
 #include "exchange_translation_context.h"
 #include "logger.h"
@@ -15,9 +21,25 @@
 
 namespace cyclus {
 
-template <class T> class ExchangeContext;
 class Trader;
 
+/// @brief the number of arcs that an ExchangeTranslator removed from its graph
+/// before solving, by reason
+struct ArcPruneCounts {
+  ArcPruneCounts() : preference(0), capacity(0), dominated(0) {}
+
+  /// arcs with a negative preference
+  int preference;
+
+  /// arcs whose bid has no quantity or whose bid portfolio has no remaining
+  /// capacity for it
+  int capacity;
+
+  /// exclusive arcs offering the same resource to the same request as a
+  /// preferred, otherwise identical arc; only one of the two can be used
+  int dominated;
+};
+
 /// @class ExchangeTranslator
 ///
 /// @brief An ExchangeTranslator facilitates translation from a resource
@@ -29,16 +51,49 @@ class Trader;
 /// ExchangeGraph. Accordingly, the solution to the ExchangeGraph, i.e., it's
 /// Matches, can be back-translated to the original Requests and Bids via a
 /// BackTranslateSolution() method.
+///
+/// If coarsening, Translate() instead returns a smaller graph in which the
+/// request groups of identical requesters of the same institution are merged
+/// (see ExchangeCoarsener), and BackTranslateSolution() takes its matches,
+/// splitting those of each merged group among its requesters.
 template <class T>
 class ExchangeTranslator {
  public:
   /// @brief default constructor
   ///
   /// @param ex_ctx the exchance context
-  ExchangeTranslator(ExchangeContext<T>* ex_ctx) {
+  ExchangeTranslator(ExchangeContext<T>* ex_ctx)
+      : prune_(true),
+        coarsen_(false) {
     ex_ctx_ = ex_ctx;
+    xlation_ctx_.ex_ctx = ex_ctx;
   }
 
+  /// @brief whether arcs that can not carry any flow, or that are dominated by
+  /// another arc, are removed during translation. Arcs with negative
+  /// preferences are always removed. Default true.
+  /// @{
+  inline bool prune() const { return prune_; }
+  inline void prune(bool prune) { prune_ = prune; }
+  /// @}
+
+  /// @brief the number of arcs removed during translation
+  inline const ArcPruneCounts& pruned() const { return pruned_; }
+
+  /// @brief whether equivalent request groups of the same institution are
+  /// merged during translation. Default false.
+  /// @{
+  inline bool coarsen() const { return coarsen_; }
+  inline void coarsen(bool coarsen) { coarsen_ = coarsen; }
+  /// @}
+
+  /// @brief the coarsener that merges request groups, whose split flag sets
+  /// how the matches of a merged group are split among its requesters
+  /// @{
+  inline const ExchangeCoarsener& coarsener() const { return coarsener_; }
+  inline ExchangeCoarsener& coarsener() { return coarsener_; }
+  /// @}
+
   /// @brief translate the ExchangeContext into an ExchangeGraph
   ExchangeGraph::Ptr Translate() {
     ExchangeGraph::Ptr graph(new ExchangeGraph());
@@ -48,12 +103,15 @@ class ExchangeTranslator {
         ex_ctx_->requests;
     typename std::vector<typename RequestPortfolio<T>::Ptr>::const_iterator
         rp_it;
+    std::vector<int> institutions;
     for (rp_it = requests.begin(); rp_it != requests.end(); ++rp_it) {
       CapacityConstraint<T> c((*rp_it)->qty(), (*rp_it)->qty_converter());
       (*rp_it)->AddConstraint(c);
 
       RequestGroup::Ptr rs = TranslateRequestPortfolio(xlation_ctx_, *rp_it);
       graph->AddRequestGroup(rs);
+      if (coarsen_)
+        institutions.push_back(Institution(*rp_it));
     }
 
     // add each bid group
@@ -64,28 +122,101 @@ class ExchangeTranslator {
       graph->AddSupplyGroup(ns);
 
       // add each request-bid arc
+      std::vector<Arc> arcs;
       const std::set<Bid<T>*>& bids = (*bp_it)->bids();
       typename std::set<Bid<T>*>::const_iterator b_it;
       for (b_it = bids.begin(); b_it != bids.end(); ++b_it) {
         Bid<T>* bid = *b_it;
         Request<T>* req = bid->request();
-        AddArc(req, bid, graph);
+        Arc a;
+        if (XlateArc(req, bid, &a))
+          arcs.push_back(a);
+      }
+      if (prune_)
+        PruneDominated(&arcs);
+      for (int i = 0; i != arcs.size(); i++) {
+        graph->AddArc(arcs[i]);
       }
     }
 
+    CLOG(LEV_DEBUG1) << "Pruned " << pruned_.preference << " negative "
+                     << "preference, " << pruned_.capacity << " zero "
+                     << "capacity, and " << pruned_.dominated
+                     << " dominated arcs.";
+
+    if (coarsen_) {
+      fine_ = graph;
+      return coarsener_.Coarsen(graph.get(), institutions);
+    }
+    fine_.reset();
+    graph->Flatten();
     return graph;
   }
 
   /// @brief adds a bid-request arc to a graph, if the preference for the arc is
-  /// non-negative
+  /// non-negative (and, if pruning, the arc can carry flow)
   void AddArc(Request<T>* req, Bid<T>* bid, ExchangeGraph::Ptr graph) {
-    double pref =
-        ex_ctx_->trader_prefs.at(req->requester())[req][bid];
+    Arc a;
+    if (XlateArc(req, bid, &a))
+      graph->AddArc(a);
+  }
+
+  /// @brief Provide a vector of Trades given a vector of Matches, of the
+  /// coarsened graph if the last graph translated was coarsened
+  void BackTranslateSolution(const std::vector<Match>& matches,
+                             std::vector< Trade<T> >& ret) {
+    if (fine_ != NULL) {
+      std::vector<Match> refined;
+      coarsener_.Refine(matches, &refined);
+      BackTranslate(refined, ret);
+    } else {
+      BackTranslate(matches, ret);
+    }
+  }
+
+  const ExchangeTranslationContext<T>& translation_ctx() const {
+    return xlation_ctx_;
+  }
+
+  ExchangeTranslationContext<T>& translation_ctx() { return xlation_ctx_; }
+
+ private:
+  /// appends the trade of each match to ret
+  void BackTranslate(const std::vector<Match>& matches,
+                     std::vector< Trade<T> >& ret) {
+    std::vector<Match>::const_iterator m_it;
+    CLOG(LEV_DEBUG1) << "Back traslating " << matches.size()
+                     << " trade matches.";
+    for (m_it = matches.begin(); m_it != matches.end(); ++m_it) {
+      ret.push_back(BackTranslateMatch(xlation_ctx_, *m_it));
+    }
+  }
+
+  /// the id of the institution of a portfolio's requester, or -1 if it has
+  /// none, which keeps its requests from being merged with others
+  static int Institution(const typename RequestPortfolio<T>::Ptr& rp) {
+    if (rp->requester() == NULL ||
+        rp->requester()->manager()->parent() == NULL) {
+      return -1;
+    }
+    return rp->requester()->manager()->parent()->id();
+  }
+
+  /// translates the arc between a request and a bid into arc, unless it is
+  /// removed
+  /// @return whether the arc is kept
+  bool XlateArc(Request<T>* req, Bid<T>* bid, Arc* arc) {
+    int ai = ex_ctx_->arc(bid);
+    if (ai < 0) {
+      throw KeyError("the bid is not in the exchange context");
+    }
+    double pref = ex_ctx_->pref(ai);
     // TODO: make the following check `pref <=0` and remove the `else if` block
     // before release 1.5
     if (pref < 0) {
       CLOG(LEV_DEBUG1) << "Removing arc because of negative preference.";
-      return;
+      pruned_.preference++;
+      return false;
     } else if (pref == 0) {
       std::stringstream ss;
       ss << "0-valued preferences have been deprecated. "
@@ -95,53 +226,186 @@ class ExchangeTranslator {
     }
     // get translated arc
     Arc a = TranslateArc(xlation_ctx_, bid, pref);
+    if (prune_ && !HasCapacity(a)) {
+      CLOG(LEV_DEBUG1) << "Removing arc because its bid has no capacity.";
+      Discard(a);
+      pruned_.capacity++;
+      return false;
+    }
     a.unode()->prefs[a] = pref;  // request node is a.unode()
-    int n_prefs = a.unode()->prefs.size();
     
     CLOG(LEV_DEBUG5) << "Updating preference for one of "
                      << req->requester()->manager()->prototype()
                      << "'s trade nodes:";
     CLOG(LEV_DEBUG5) << "   preference: " << a.unode()->prefs[a];
     
-    graph->AddArc(a);
+    *arc = a;
+    return true;
   }
-  
-  /// @brief Provide a vector of Trades given a vector of Matches
-  void BackTranslateSolution(const std::vector<Match>& matches,
-                             std::vector< Trade<T> >& ret) {
-    std::vector<Match>::const_iterator m_it;
-    CLOG(LEV_DEBUG1) << "Back traslating " << matches.size()
-                     << " trade matches.";
-    for (m_it = matches.begin(); m_it != matches.end(); ++m_it) {
-      ret.push_back(BackTranslateMatch(xlation_ctx_, *m_it));
+
+  /// @brief whether an arc can carry any flow, given its bid's quantity and
+  /// the remaining capacities of the bid's portfolio
+  static bool HasCapacity(const Arc& a) {
+    ExchangeNode::Ptr v = a.vnode();
+    if (v->qty <= 0)
+      return false;
+    std::map<Arc, std::vector<double> >::const_iterator it =
+        v->unit_capacities.find(a);
+    if (v->group == NULL || it == v->unit_capacities.end())
+      return true;
+    const std::vector<double>& ucaps = it->second;
+    const std::vector<double>& caps = v->group->capacities();
+    for (int i = 0; i != ucaps.size() && i != caps.size(); i++) {
+      if (ucaps[i] > 0 && caps[i] <= 0)
+        return false;
     }
+    return true;
   }
 
-  const ExchangeTranslationContext<T>& translation_ctx() const {
-    return xlation_ctx_;
+  /// @brief removes all traces of an arc from its nodes
+  static void Discard(const Arc& a) {
+    a.unode()->unit_capacities.erase(a);
+    a.unode()->prefs.erase(a);
+    a.vnode()->unit_capacities.erase(a);
   }
 
-  ExchangeTranslationContext<T>& translation_ctx() { return xlation_ctx_; }
+  /// @brief removes exclusive arcs that offer the same resource to the same
+  /// request as another arc with the same capacities and an equal or greater
+  /// preference. The bids of such arcs share an exclusive group, so at most
+  /// one of them can be used and the preferred one is always at least as good.
+  /// Of equally preferred arcs, the first is kept.
+  void PruneDominated(std::vector<Arc>* arcs) {
+    typedef std::pair<ExchangeNode*, typename T::Ptr> Key;
+    std::map<Key, std::vector<int> > same;
+    for (int i = 0; i != arcs->size(); i++) {
+      const Arc& a = (*arcs)[i];
+      ExchangeNode::Ptr v = a.vnode();
+      if (!v->exclusive)
+        continue;
+      Bid<T>* bid = xlation_ctx_.bid(v);
+      same[Key(a.unode().get(), bid->offer())].push_back(i);
+    }
+
+    std::vector<bool> dominated(arcs->size(), false);
+    typename std::map<Key, std::vector<int> >::iterator it;
+    for (it = same.begin(); it != same.end(); ++it) {
+      std::vector<int>& ids = it->second;
+      for (int j = 0; j < ids.size(); j++) {
+        for (int k = j + 1; k < ids.size() && !dominated[ids[j]]; k++) {
+          Arc& l = (*arcs)[ids[j]];
+          Arc& r = (*arcs)[ids[k]];
+          if (dominated[ids[k]] || !Equivalent(l, r))
+            continue;
+          dominated[r.pref() <= l.pref() ? ids[k] : ids[j]] = true;
+        }
+      }
+    }
+
+    std::vector<Arc> kept;
+    for (int i = 0; i != arcs->size(); i++) {
+      if (dominated[i]) {
+        Discard((*arcs)[i]);
+        pruned_.dominated++;
+      } else {
+        kept.push_back((*arcs)[i]);
+      }
+    }
+    arcs->swap(kept);
+  }
+
+  /// @brief whether two arcs into the same request have the same flow limits
+  static bool Equivalent(const Arc& l, const Arc& r) {
+    return l.exclusive() == r.exclusive() &&
+           l.excl_val() == r.excl_val() &&
+           l.vnode()->qty == r.vnode()->qty &&
+           UnitCaps(l.unode(), l) == UnitCaps(r.unode(), r) &&
+           UnitCaps(l.vnode(), l) == UnitCaps(r.vnode(), r);
+  }
+
+  /// @brief the unit capacities of a node for an arc, without adding any
+  static std::vector<double> UnitCaps(ExchangeNode::Ptr n, const Arc& a) {
+    std::map<Arc, std::vector<double> >::const_iterator it =
+        n->unit_capacities.find(a);
+    return it == n->unit_capacities.end() ? std::vector<double>() : it->second;
+  }
 
- private:
   ExchangeContext<T>* ex_ctx_;
   ExchangeTranslationContext<T> xlation_ctx_;
+  bool prune_;
+  ArcPruneCounts pruned_;
+  bool coarsen_;
+  ExchangeCoarsener coarsener_;
+
+  /// the graph coarsened by the last translation, if it was
+  ExchangeGraph::Ptr fine_;
 };
 
-/// @brief Adds a request-node mapping
+/// @brief Adds a request-node mapping, indexing the node by the request's
+/// number if the translation context's exchange context has numbered it
 template <class T>
 inline void AddRequest(ExchangeTranslationContext<T>& translation_ctx,
                        Request<T>* r, ExchangeNode::Ptr n) {
-  translation_ctx.request_to_node[r] = n;
-  translation_ctx.node_to_request[n] = r;
+  const ExchangeContext<T>* ex_ctx = translation_ctx.ex_ctx;
+  int i = ex_ctx == NULL ? -1 : ex_ctx->request_index(r);
+  if (i < 0) {
+    translation_ctx.request_to_node[r] = n;
+    translation_ctx.node_to_request[n] = r;
+    return;
+  }
+  if (i >= translation_ctx.requests.size()) {
+    translation_ctx.requests.resize(ex_ctx->nrequests());
+    translation_ctx.request_nodes.resize(ex_ctx->nrequests());
+  }
+  n->index = i;
+  translation_ctx.requests[i] = r;
+  translation_ctx.request_nodes[i] = n;
 }
 
-/// @brief Adds a bid-node mapping
+/// @brief Adds a bid-node mapping, indexing the node by the bid's number if
+/// the translation context's exchange context has numbered it
 template <class T>
 inline void AddBid(ExchangeTranslationContext<T>& translation_ctx,
                        Bid<T>* b, ExchangeNode::Ptr n) {
-  translation_ctx.bid_to_node[b] = n;
-  translation_ctx.node_to_bid[n] = b;
+  const ExchangeContext<T>* ex_ctx = translation_ctx.ex_ctx;
+  int i = ex_ctx == NULL ? -1 : ex_ctx->arc(b);
+  if (i < 0) {
+    translation_ctx.bid_to_node[b] = n;
+    translation_ctx.node_to_bid[n] = b;
+    return;
+  }
+  if (i >= translation_ctx.bids.size()) {
+    translation_ctx.bids.resize(ex_ctx->narcs());
+    translation_ctx.bid_nodes.resize(ex_ctx->narcs());
+  }
+  n->index = i;
+  translation_ctx.bids[i] = b;
+  translation_ctx.bid_nodes[i] = n;
+}
+
+/// @brief the node that request r was translated to
+template <class T>
+inline ExchangeNode::Ptr RequestNode(
+    const ExchangeTranslationContext<T>& translation_ctx, Request<T>* r) {
+  const ExchangeContext<T>* ex_ctx = translation_ctx.ex_ctx;
+  int i = ex_ctx == NULL ? -1 : ex_ctx->request_index(r);
+  if (i >= 0 && i < translation_ctx.request_nodes.size() &&
+      translation_ctx.request_nodes[i] != NULL) {
+    return translation_ctx.request_nodes[i];
+  }
+  return translation_ctx.request_to_node.at(r);
+}
+
+/// @brief the node that bid b was translated to
+template <class T>
+inline ExchangeNode::Ptr BidNode(
+    const ExchangeTranslationContext<T>& translation_ctx, Bid<T>* b) {
+  const ExchangeContext<T>* ex_ctx = translation_ctx.ex_ctx;
+  int i = ex_ctx == NULL ? -1 : ex_ctx->arc(b);
+  if (i >= 0 && i < translation_ctx.bid_nodes.size() &&
+      translation_ctx.bid_nodes[i] != NULL) {
+    return translation_ctx.bid_nodes[i];
+  }
+  return translation_ctx.bid_to_node.at(b);
 }
 
 /// @brief translates a request portfolio by adding request nodes and
@@ -160,9 +424,9 @@ RequestGroup::Ptr TranslateRequestPortfolio(
        ++r_it) {
     Request<T>* r = *r_it;
     ExchangeNode::Ptr n(
-        new ExchangeNode(r->target()->quantity(),
+        new ExchangeNode(r->target_quantity(),
                          r->exclusive(),
-                         r->commodity(),
+                         r->commodity_id(),
                          r->requester()->manager()->id()));
     rs->AddExchangeNode(n);
 
@@ -199,7 +463,7 @@ ExchangeNodeGroup::Ptr TranslateBidPortfolio(
     ExchangeNode::Ptr n(
         new ExchangeNode(b->offer()->quantity(),
                          b->exclusive(),
-                         b->request()->commodity(),
+                         b->request()->commodity_id(),
                          b->bidder()->manager()->id()));
     bs->AddExchangeNode(n);
     AddBid(translation_ctx, *b_it, n);
@@ -241,8 +505,8 @@ template <class T>
 Arc TranslateArc(const ExchangeTranslationContext<T>& translation_ctx,
                  Bid<T>* bid, double pref) {
   Request<T>* req = bid->request();
-  ExchangeNode::Ptr unode = translation_ctx.request_to_node.at(req);
-  ExchangeNode::Ptr vnode = translation_ctx.bid_to_node.at(bid);
+  ExchangeNode::Ptr unode = RequestNode(translation_ctx, req);
+  ExchangeNode::Ptr vnode = BidNode(translation_ctx, bid);
   Arc arc(unode, vnode);
   arc.pref(pref); 
   
@@ -267,14 +531,15 @@ Trade<T> BackTranslateMatch(const ExchangeTranslationContext<T>&
   ExchangeNode::Ptr bid_node = match.first.vnode();
 
   Trade<T> t;
-  t.request = translation_ctx.node_to_request.at(req_node);
-  t.bid = translation_ctx.node_to_bid.at(bid_node);
+  t.request = translation_ctx.request(req_node);
+  t.bid = translation_ctx.bid(bid_node);
   t.amt = match.second;
   return t;
 }
 
 /// @brief updates a node's unit capacities given, a target resource and
-/// constraints
+/// constraints. Converters that depend on nothing but the offer convert each
+/// offered resource object only once per translation context.
 template<typename T>
 void TranslateCapacities(
     typename T::Ptr offer,
@@ -282,12 +547,26 @@ void TranslateCapacities(
     ExchangeNode::Ptr n,
     const Arc& a,
     const ExchangeTranslationContext<T>& ctx) {
+  std::vector<double>& ucaps = n->unit_capacities[a];
   typename std::set< CapacityConstraint<T> >::const_iterator it;
   for (it = constr.begin(); it != constr.end(); ++it) {
+    const Converter<T>* conv = it->converter().get();
+    double converted;
+    if (conv->offer_only()) {
+      std::pair<const void*, int> key(conv, offer->obj_id());
+      std::map<std::pair<const void*, int>, double>::iterator cit =
+          ctx.conversions.find(key);
+      if (cit == ctx.conversions.end()) {
+        cit = ctx.conversions.insert(
+            std::make_pair(key, it->convert(offer, &a, &ctx))).first;
+      }
+      converted = cit->second;
+    } else {
+      converted = it->convert(offer, &a, &ctx);
+    }
     CLOG(cyclus::LEV_DEBUG1) << "Additing unit capacity: "
-                             << it->convert(offer, &a, &ctx) / offer->quantity();
-    n->unit_capacities[a].push_back(it->convert(offer, &a, &ctx) /
-                                    offer->quantity());
+                             << converted / offer->quantity();
+    ucaps.push_back(converted / offer->quantity());
   }
 }
 
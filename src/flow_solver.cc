@@ -0,0 +1,241 @@
+#include "flow_solver.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <sstream>
+#include <utility>
+
+#include "cyc_limits.h"
+#include "error.h"
+#include "exchange_graph.h"
+#include "logger.h"
+
+namespace cyclus {
+
+namespace {
+
+// 1e15 is the largest request capacity the ProgTranslator passes to solvers,
+// which unmet demand is priced up to
+const double kMaxCap = 1e15;
+
+const double kInf = std::numeric_limits<double>::infinity();
+
+// A network of residual edges, each stored next to its reverse so that edge
+// e is reversed by e ^ 1.
+struct Network {
+  explicit Network(int n) : adj(n) {}
+
+  // adds an edge from u to v and returns its id
+  int AddEdge(int u, int v, double cap, double cost) {
+    int e = to.size();
+    to.push_back(v);
+    res.push_back(cap);
+    cost_.push_back(cost);
+    adj[u].push_back(e);
+    to.push_back(u);
+    res.push_back(0);
+    cost_.push_back(-cost);
+    adj[v].push_back(e + 1);
+    return e;
+  }
+
+  // the flow on edge e
+  double flow(int e) const { return res[e ^ 1]; }
+
+  // sends the cheapest flow from s to t that saturates every edge into t, by
+  // successive shortest paths, and returns its cost
+  double MinCostFlow(int s, int t) {
+    int n = adj.size();
+    std::vector<double> pot(n, 0);  // all edges start with nonnegative costs
+    std::vector<double> dist(n);
+    std::vector<int> prev(n);
+    typedef std::pair<double, int> Item;
+    double total = 0;
+    while (true) {
+      // Dijkstra's shortest paths by the reduced costs
+      std::fill(dist.begin(), dist.end(), kInf);
+      std::fill(prev.begin(), prev.end(), -1);
+      std::priority_queue<Item, std::vector<Item>, std::greater<Item> > q;
+      dist[s] = 0;
+      q.push(Item(0, s));
+      while (!q.empty()) {
+        Item it = q.top();
+        q.pop();
+        int u = it.second;
+        if (it.first > dist[u])
+          continue;
+        for (int k = 0; k != adj[u].size(); k++) {
+          int e = adj[u][k];
+          if (res[e] <= 0)
+            continue;
+          int v = to[e];
+          // round off can leave reduced costs slightly negative
+          double d = dist[u] + std::max(0.0, cost_[e] + pot[u] - pot[v]);
+          if (d < dist[v]) {
+            dist[v] = d;
+            prev[v] = e;
+            q.push(Item(d, v));
+          }
+        }
+      }
+      if (prev[t] < 0)
+        break;
+
+      // nodes that can't be reached now never can be again
+      for (int v = 0; v != n; v++) {
+        if (dist[v] < kInf)
+          pot[v] += dist[v];
+      }
+
+      double push = kInf;
+      for (int v = t; v != s; v = to[prev[v] ^ 1]) {
+        push = std::min(push, res[prev[v]]);
+      }
+      for (int v = t; v != s; v = to[prev[v] ^ 1]) {
+        int e = prev[v];
+        res[e] -= push;
+        res[e ^ 1] += push;
+        total += push * cost_[e];
+      }
+    }
+    return total;
+  }
+
+  std::vector<std::vector<int> > adj;
+  std::vector<int> to;
+  std::vector<double> res;
+  std::vector<double> cost_;
+};
+
+}  // namespace
+
+bool IsTransportation(ExchangeGraph* graph, bool exclusive_orders,
+                      std::vector<double>* group_ucaps) {
+  const FlatExchangeGraph& f = graph->flat();
+  int ngroups = f.groups.size();
+  std::vector<double>& scale = *group_ucaps;
+  scale.assign(ngroups, 0);
+  for (int g = 0; g != ngroups; g++) {
+    if (f.groups[g]->capacities().size() > 1)
+      return false;
+  }
+
+  int narcs = f.arc_unode.size();
+  for (int a = 0; a != narcs; a++) {
+    if (exclusive_orders && f.arc_exclusive[a])
+      return false;
+    int nodes[2] = {f.arc_unode[a], f.arc_vnode[a]};
+    const std::vector<int>* starts[2] = {&f.ucap_start, &f.vcap_start};
+    const std::vector<double>* ucaps[2] = {&f.ucaps, &f.vcaps};
+    for (int side = 0; side != 2; side++) {
+      int g = f.node_group[nodes[side]];
+      if (g < 0 || f.groups[g]->capacities().empty())
+        continue;
+      int begin = (*starts[side])[a];
+      int end = (*starts[side])[a + 1];
+      if (end - begin != 1)
+        return false;
+      double ucap = (*ucaps[side])[begin];
+      if (ucap <= 0 || (scale[g] != 0 && scale[g] != ucap))
+        return false;
+      scale[g] = ucap;
+    }
+  }
+  return true;
+}
+
+FlowSolver::FlowSolver(bool exclusive_orders, ExchangeSolver* fallback)
+    : ExchangeSolver(exclusive_orders),
+      fallback_(fallback),
+      nfallbacks_(0) {}
+
+FlowSolver::~FlowSolver() {
+  delete fallback_;
+}
+
+ExchangeSolver* FlowSolver::Clone() {
+  ExchangeSolver* fallback = NULL;
+  if (fallback_ != NULL) {
+    fallback = fallback_->Clone();
+    if (fallback == NULL)
+      return NULL;
+  }
+  FlowSolver* s = new FlowSolver(exclusive_orders_, fallback);
+  s->verbose_ = verbose_;
+  return s;
+}
+
+bool FlowSolver::IsTransportation(ExchangeGraph* graph) {
+  return cyclus::IsTransportation(graph, exclusive_orders_, &group_ucap_);
+}
+
+double FlowSolver::SolveGraph() {
+  if (!IsTransportation(graph_)) {
+    if (fallback_ == NULL) {
+      throw ValueError("the exchange is not a transportation problem and the "
+                       "min-cost-flow solver has no fallback");
+    }
+    CLOG(LEV_DEBUG1) << "Exchange is not a transportation problem, handing "
+                     << "it to the fallback solver.";
+    nfallbacks_++;
+    return SolveGraphWith(fallback_);
+  }
+
+  const FlatExchangeGraph& f = graph_->flat();
+  std::vector<Arc>& arcs = graph_->arcs();
+  int ngroups = f.groups.size();
+  int nrequests = graph_->request_groups().size();
+  double pseudo_cost = PseudoCost();
+
+  // the source, the sink, then a node per group
+  int s = 0;
+  int t = 1;
+  Network net(ngroups + 2);
+  std::vector<int> faux(ngroups, -1);
+  for (int g = 0; g != ngroups; g++) {
+    const std::vector<double>& caps = f.groups[g]->capacities();
+    if (g >= nrequests) {
+      double cap = caps.empty() ? kInf : caps[0] / group_ucap_[g];
+      net.AddEdge(s, g + 2, cap, 0);
+    } else if (!caps.empty() && f.groups[g]->HasArcs()) {
+      // demand is met by the group's arcs or left unmet, at the pseudo cost
+      // of each unit of capacity
+      double cap = std::min(caps[0], kMaxCap) / group_ucap_[g];
+      net.AddEdge(g + 2, t, cap, 0);
+      faux[g] = net.AddEdge(s, g + 2, kInf, pseudo_cost * group_ucap_[g]);
+    }
+  }
+
+  int narcs = arcs.size();
+  std::vector<int> edges(narcs, -1);
+  for (int a = 0; a != narcs; a++) {
+    int ug = f.node_group[f.arc_unode[a]];
+    int vg = f.node_group[f.arc_vnode[a]];
+    if (ug < 0 || vg < 0 || faux[ug] < 0)
+      continue;  // flow could only add cost
+    double pref = f.arc_pref[a];
+    if (pref <= 0) {
+      std::stringstream ss;
+      ss << "Preference value found to be nonpositive (" << pref
+         << "). Preferences must be positive when using an optimization "
+         << "solver.";
+      throw ValueError(ss.str());
+    }
+    edges[a] = net.AddEdge(vg + 2, ug + 2, f.node_qty[f.arc_unode[a]],
+                           ExchangeSolver::Cost(arcs[a], exclusive_orders_));
+  }
+
+  double obj = net.MinCostFlow(s, t);
+  for (int a = 0; a != narcs; a++) {
+    if (edges[a] >= 0 && net.flow(edges[a]) > eps())
+      graph_->AddMatch(arcs[a], net.flow(edges[a]));
+  }
+  if (verbose_) {
+    CLOG(LEV_INFO1) << "Min-cost-flow exchange objective: " << obj;
+  }
+  return obj;
+}
+
+}  // namespace cyclus
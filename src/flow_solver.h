@@ -0,0 +1,69 @@
+#ifndef CYCLUS_SRC_FLOW_SOLVER_H_
+#define CYCLUS_SRC_FLOW_SOLVER_H_
+
+#include <vector>
+
+#include "exchange_solver.h"
+
+namespace cyclus {
+
+/// @brief whether an exchange graph is a transportation problem, i.e.,
+/// whether none of its arcs are exclusive (or exclusive orders are not
+/// enforced), every node group has at most one capacity, and all the arcs of
+/// a group have the same unit capacity in it
+/// @param group_ucaps if the graph is a transportation problem, the unit
+/// capacity of each node group of the flattened graph for its arcs, or 0 if
+/// the group has no capacity
+bool IsTransportation(ExchangeGraph* graph, bool exclusive_orders,
+                      std::vector<double>* group_ucaps);
+
+/// @brief The FlowSolver solves resource exchanges that are transportation
+/// problems exactly, as minimum cost flows, and hands every other exchange to
+/// a fallback solver.
+///
+/// In a transportation problem (see IsTransportation), supply flows from each supply group to the request
+/// groups over the arcs, at the arcs' costs (see ExchangeSolver::Cost), and
+/// request groups may leave demand unmet at the pseudo cost (see
+/// ExchangeSolver::PseudoCost), which is the linear program that the
+/// ProgSolver would otherwise solve with a general solver. It is solved by
+/// successive shortest paths, which finds optimal solutions in a fraction of
+/// the time.
+///
+/// Since decomposed graphs are checked one subproblem at a time, only the
+/// subproblems that are not transportation problems fall back.
+class FlowSolver : public ExchangeSolver {
+ public:
+  /// @param exclusive_orders whether exclusive orders are enforced
+  /// @param fallback the solver of graphs that are not transportation
+  /// problems, which the FlowSolver deletes, or NULL to throw a ValueError
+  /// for them instead
+  FlowSolver(bool exclusive_orders, ExchangeSolver* fallback);
+  virtual ~FlowSolver();
+
+  /// @brief returns a new solver with the same configuration and a copy of
+  /// the fallback, or NULL if the fallback cannot be copied
+  virtual ExchangeSolver* Clone();
+
+  /// @brief whether the graph is a transportation problem that this solver
+  /// solves without its fallback
+  bool IsTransportation(ExchangeGraph* graph);
+
+  /// @brief the number of graphs that were handed to the fallback
+  inline int nfallbacks() const { return nfallbacks_; }
+
+ protected:
+  virtual double SolveGraph();
+
+ private:
+  /// @brief the unit capacity of each node group for its arcs, which is the
+  /// same for all of them, or 0 if the group has no capacity; filled by
+  /// IsTransportation
+  std::vector<double> group_ucap_;
+
+  ExchangeSolver* fallback_;
+  int nfallbacks_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_FLOW_SOLVER_H_
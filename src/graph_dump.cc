@@ -0,0 +1,299 @@
+#include "graph_dump.h"
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "error.h"
+
+namespace cyclus {
+
+namespace {
+
+// marks the start of every dumped graph, with the version of the format
+const char kMagic[4] = {'C', 'Y', 'G', '1'};
+
+// marks the matches that may follow a dumped graph
+const char kMatchesMagic[4] = {'C', 'Y', 'M', '1'};
+
+template <class T>
+void Put(std::ostream& out, T v) {
+  out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+void PutString(std::ostream& out, const std::string& s) {
+  Put<int32_t>(out, s.size());
+  out.write(s.data(), s.size());
+}
+
+void PutDoubles(std::ostream& out, const std::vector<double>& v) {
+  Put<int32_t>(out, v.size());
+  if (!v.empty())
+    out.write(reinterpret_cast<const char*>(&v[0]), v.size() * sizeof(double));
+}
+
+template <class T>
+T Get(std::istream& in) {
+  T v;
+  if (!in.read(reinterpret_cast<char*>(&v), sizeof(T)))
+    throw IOError("graph dump ends early");
+  return v;
+}
+
+int32_t GetSize(std::istream& in) {
+  int32_t n = Get<int32_t>(in);
+  if (n < 0)
+    throw IOError("graph dump is corrupt");
+  return n;
+}
+
+std::string GetString(std::istream& in) {
+  std::string s(GetSize(in), '\0');
+  if (!s.empty() && !in.read(&s[0], s.size()))
+    throw IOError("graph dump ends early");
+  return s;
+}
+
+std::vector<double> GetDoubles(std::istream& in) {
+  std::vector<double> v(GetSize(in));
+  if (!v.empty() &&
+      !in.read(reinterpret_cast<char*>(&v[0]), v.size() * sizeof(double)))
+    throw IOError("graph dump ends early");
+  return v;
+}
+
+bool Dumped(const ExchangeNode& n, const std::set<std::string>& commods) {
+  return commods.empty() || commods.count(n.commod) > 0;
+}
+
+/// returns the nodes of g that are dumped with commods
+std::vector<ExchangeNode*> DumpedNodes(const ExchangeNodeGroup& g,
+                                       const std::set<std::string>& commods) {
+  std::vector<ExchangeNode*> dumped;
+  const std::vector<ExchangeNode::Ptr>& nodes = g.nodes();
+  for (int i = 0; i < nodes.size(); ++i) {
+    if (Dumped(*nodes[i], commods))
+      dumped.push_back(nodes[i].get());
+  }
+  return dumped;
+}
+
+void PutGroup(std::ostream& out, const ExchangeNodeGroup& g,
+              const std::vector<ExchangeNode*>& nodes,
+              std::map<const ExchangeNode*, int32_t>* ids) {
+  PutDoubles(out, g.capacities());
+  Put<int32_t>(out, nodes.size());
+  for (int i = 0; i < nodes.size(); ++i) {
+    const ExchangeNode& n = *nodes[i];
+    int32_t id = ids->size();
+    (*ids)[&n] = id;
+    Put<double>(out, n.qty);
+    Put<uint8_t>(out, n.exclusive);
+    Put<int32_t>(out, n.agent_id);
+    PutString(out, n.commod);
+  }
+  const std::vector<std::vector<ExchangeNode::Ptr> >& excl =
+      g.excl_node_groups();
+  std::vector<std::vector<int32_t> > dumped;
+  for (int i = 0; i < excl.size(); ++i) {
+    std::vector<int32_t> group;
+    for (int j = 0; j < excl[i].size(); ++j) {
+      std::map<const ExchangeNode*, int32_t>::iterator it =
+          ids->find(excl[i][j].get());
+      if (it != ids->end())
+        group.push_back(it->second);
+    }
+    if (!group.empty())
+      dumped.push_back(group);
+  }
+  Put<int32_t>(out, dumped.size());
+  for (int i = 0; i < dumped.size(); ++i) {
+    Put<int32_t>(out, dumped[i].size());
+    for (int j = 0; j < dumped[i].size(); ++j) {
+      Put<int32_t>(out, dumped[i][j]);
+    }
+  }
+}
+
+void GetGroup(std::istream& in, ExchangeNodeGroup* g,
+              std::vector<ExchangeNode::Ptr>* nodes) {
+  std::vector<double> caps = GetDoubles(in);
+  for (int i = 0; i < caps.size(); ++i) {
+    g->AddCapacity(caps[i]);
+  }
+  int32_t nnodes = GetSize(in);
+  for (int i = 0; i < nnodes; ++i) {
+    double qty = Get<double>(in);
+    bool exclusive = Get<uint8_t>(in) != 0;
+    int32_t agent_id = Get<int32_t>(in);
+    std::string commod = GetString(in);
+    ExchangeNode::Ptr n(new ExchangeNode(qty, exclusive, commod, agent_id));
+    // exclusive node groups are restored as dumped, below
+    g->ExchangeNodeGroup::AddExchangeNode(n);
+    nodes->push_back(n);
+  }
+  int32_t nexcl = GetSize(in);
+  for (int i = 0; i < nexcl; ++i) {
+    std::vector<ExchangeNode::Ptr> excl(GetSize(in));
+    for (int j = 0; j < excl.size(); ++j) {
+      int32_t id = Get<int32_t>(in);
+      if (id < 0 || id >= nodes->size())
+        throw IOError("graph dump is corrupt");
+      excl[j] = (*nodes)[id];
+    }
+    g->AddExclGroup(excl);
+  }
+}
+
+}  // namespace
+
+void DumpGraph(std::ostream& out, int time, const std::string& restype,
+               ExchangeGraph& g, const std::set<std::string>& commods) {
+  out.write(kMagic, sizeof(kMagic));
+  Put<int32_t>(out, time);
+  PutString(out, restype);
+
+  std::map<const ExchangeNode*, int32_t> ids;
+  const std::vector<RequestGroup::Ptr>& reqs = g.request_groups();
+  std::vector<std::vector<ExchangeNode*> > nodes(reqs.size());
+  int32_t n = 0;
+  for (int i = 0; i < reqs.size(); ++i) {
+    nodes[i] = DumpedNodes(*reqs[i], commods);
+    n += !nodes[i].empty();
+  }
+  Put<int32_t>(out, n);
+  for (int i = 0; i < reqs.size(); ++i) {
+    if (nodes[i].empty())
+      continue;
+    Put<double>(out, reqs[i]->qty());
+    PutGroup(out, *reqs[i], nodes[i], &ids);
+  }
+  const std::vector<ExchangeNodeGroup::Ptr>& sups = g.supply_groups();
+  nodes.assign(sups.size(), std::vector<ExchangeNode*>());
+  n = 0;
+  for (int i = 0; i < sups.size(); ++i) {
+    nodes[i] = DumpedNodes(*sups[i], commods);
+    n += !nodes[i].empty();
+  }
+  Put<int32_t>(out, n);
+  for (int i = 0; i < sups.size(); ++i) {
+    if (!nodes[i].empty())
+      PutGroup(out, *sups[i], nodes[i], &ids);
+  }
+
+  const std::vector<Arc>& arcs = g.arcs();
+  n = 0;
+  for (int i = 0; i < arcs.size(); ++i) {
+    n += Dumped(*arcs[i].unode(), commods) && Dumped(*arcs[i].vnode(), commods);
+  }
+  Put<int32_t>(out, n);
+  for (int i = 0; i < arcs.size(); ++i) {
+    const Arc& a = arcs[i];
+    ExchangeNode::Ptr u = a.unode();
+    ExchangeNode::Ptr v = a.vnode();
+    if (!Dumped(*u, commods) || !Dumped(*v, commods))
+      continue;
+    Put<int32_t>(out, ids[u.get()]);
+    Put<int32_t>(out, ids[v.get()]);
+    Put<double>(out, a.pref());
+    Put<double>(out, u->prefs[a]);
+    PutDoubles(out, u->unit_capacities[a]);
+    PutDoubles(out, v->unit_capacities[a]);
+  }
+  if (!out)
+    throw IOError("could not write the graph dump");
+}
+
+void DumpMatches(std::ostream& out, ExchangeGraph& g,
+                 const std::set<std::string>& commods) {
+  // the arcs are numbered as they were dumped
+  const std::vector<Arc>& arcs = g.arcs();
+  std::vector<int32_t> dumped(arcs.size(), -1);
+  int32_t n = 0;
+  for (int i = 0; i < arcs.size(); ++i) {
+    if (Dumped(*arcs[i].unode(), commods) && Dumped(*arcs[i].vnode(), commods))
+      dumped[i] = n++;
+  }
+  const std::vector<Match>& matches = g.matches();
+  std::vector<std::pair<int32_t, double> > kept;
+  for (int i = 0; i < matches.size(); ++i) {
+    int32_t a = dumped[g.arc_ids()[matches[i].first]];
+    if (a >= 0)
+      kept.push_back(std::make_pair(a, matches[i].second));
+  }
+  out.write(kMatchesMagic, sizeof(kMatchesMagic));
+  Put<int32_t>(out, kept.size());
+  for (int i = 0; i < kept.size(); ++i) {
+    Put<int32_t>(out, kept[i].first);
+    Put<double>(out, kept[i].second);
+  }
+  if (!out)
+    throw IOError("could not write the graph dump");
+}
+
+bool LoadGraph(std::istream& in, int* time, std::string* restype,
+               ExchangeGraph::Ptr* g) {
+  char magic[sizeof(kMagic)];
+  if (!in.read(magic, sizeof(magic))) {
+    if (in.gcount() == 0)
+      return false;
+    throw IOError("graph dump ends early");
+  }
+  if (std::memcmp(magic, kMagic, sizeof(kMagic)) != 0)
+    throw IOError("not a graph dump, or one of another version");
+  *time = Get<int32_t>(in);
+  *restype = GetString(in);
+
+  ExchangeGraph::Ptr graph(new ExchangeGraph());
+  std::vector<ExchangeNode::Ptr> nodes;
+  int32_t nreqs = GetSize(in);
+  for (int i = 0; i < nreqs; ++i) {
+    RequestGroup::Ptr rg(new RequestGroup(Get<double>(in)));
+    GetGroup(in, rg.get(), &nodes);
+    graph->AddRequestGroup(rg);
+  }
+  int32_t nsups = GetSize(in);
+  for (int i = 0; i < nsups; ++i) {
+    ExchangeNodeGroup::Ptr sg(new ExchangeNodeGroup());
+    GetGroup(in, sg.get(), &nodes);
+    graph->AddSupplyGroup(sg);
+  }
+
+  int32_t narcs = GetSize(in);
+  for (int i = 0; i < narcs; ++i) {
+    int32_t uid = Get<int32_t>(in);
+    int32_t vid = Get<int32_t>(in);
+    if (uid < 0 || uid >= nodes.size() || vid < 0 || vid >= nodes.size())
+      throw IOError("graph dump is corrupt");
+    ExchangeNode::Ptr u = nodes[uid];
+    ExchangeNode::Ptr v = nodes[vid];
+    Arc a(u, v);
+    a.pref(Get<double>(in));
+    u->prefs[a] = Get<double>(in);
+    u->unit_capacities[a] = GetDoubles(in);
+    v->unit_capacities[a] = GetDoubles(in);
+    graph->AddArc(a);
+  }
+
+  // the matches, if they follow
+  std::streampos pos = in.tellg();
+  char next[sizeof(kMatchesMagic)];
+  if (in.read(next, sizeof(next)) &&
+      std::memcmp(next, kMatchesMagic, sizeof(kMatchesMagic)) == 0) {
+    int32_t nmatches = GetSize(in);
+    for (int i = 0; i < nmatches; ++i) {
+      int32_t a = Get<int32_t>(in);
+      if (a < 0 || a >= narcs)
+        throw IOError("graph dump is corrupt");
+      graph->AddMatch(graph->arcs()[a], Get<double>(in));
+    }
+  } else {
+    in.clear();
+    in.seekg(pos);
+  }
+  *g = graph;
+  return true;
+}
+
+}  // namespace cyclus
@@ -0,0 +1,49 @@
+#ifndef CYCLUS_SRC_GRAPH_DUMP_H_
+#define CYCLUS_SRC_GRAPH_DUMP_H_
+
+#include <istream>
+#include <ostream>
+#include <set>
+#include <string>
+
+#include "exchange_graph.h"
+
+namespace cyclus {
+
+/// Appends an exchange graph, translated at the given time step for the
+/// given resource type, to out in a compact binary form that LoadGraph reads
+/// back, so that solvers can be run against real graphs outside of a
+/// simulation (see the cyclus_dre_replay tool). Everything a solver uses is
+/// kept: the groups, their capacities and exclusive node groups, the nodes'
+/// quantities, exclusivity, commodities, and agent ids, and the arcs in
+/// order with their preferences and unit capacities. Matches are kept by
+/// DumpMatches.
+///
+/// If commods isn't empty, only the nodes of those commodities are kept,
+/// with the groups that have any and the arcs between them, which is the
+/// part of the exchange trading those commodities. The groups keep their
+/// capacities whole.
+///
+/// Numbers are written in the byte order of the machine, so dumps are meant
+/// to be read on machines like the one that wrote them.
+void DumpGraph(std::ostream& out, int time, const std::string& restype,
+               ExchangeGraph& g,
+               const std::set<std::string>& commods = std::set<std::string>());
+
+/// Appends the matches of a graph just dumped to out by DumpGraph, with the
+/// same commodities, to out, so that LoadGraph reads the graph back matched
+/// as it was in the simulation.
+void DumpMatches(std::ostream& out, ExchangeGraph& g,
+                 const std::set<std::string>& commods =
+                     std::set<std::string>());
+
+/// Reads the next graph dumped by DumpGraph from in, with the time step and
+/// resource type it was dumped for, and its matches if they were dumped.
+/// Returns false at the end of the input, and throws an IOError if the input
+/// is not a graph dump.
+bool LoadGraph(std::istream& in, int* time, std::string* restype,
+               ExchangeGraph::Ptr* g);
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_GRAPH_DUMP_H_
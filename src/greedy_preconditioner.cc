@@ -5,13 +5,10 @@
 #include <numeric>
 #include <string>
 
-#include <boost/lambda/bind.hpp>
-
+#include "commodity_registry.h"
 #include "cyc_std.h"
 #include "logger.h"
 
-namespace l = boost::lambda;
-
 namespace cyclus {
 
 inline double SumPref(double total, std::pair<Arc, double> pref) {
@@ -32,6 +29,7 @@ GreedyPreconditioner::GreedyPreconditioner(
     : commod_weights_(commod_weights) {
   if (commod_weights_.size() != 0)
     ProcessWeights_(END);
+  IndexWeights_();
 };
 
 GreedyPreconditioner::GreedyPreconditioner(
@@ -40,42 +38,78 @@ GreedyPreconditioner::GreedyPreconditioner(
     : commod_weights_(commod_weights) {
   if (commod_weights_.size() != 0)
     ProcessWeights_(order);
+  IndexWeights_();
 };
 
-void GreedyPreconditioner::Condition(ExchangeGraph* graph) {
-  avg_prefs_.clear();
+namespace {
+
+/// orders positions by their weight in descending order; ties keep their
+/// original relative order when used with a stable sort
+struct WeightComp {
+  explicit WeightComp(const std::vector<double>& wgts) : wgts(wgts) {}
+  bool operator()(int l, int r) const { return wgts[l] > wgts[r]; }
+  const std::vector<double>& wgts;
+};
+
+/// reorders v so that its i-th element is the order[i]-th original element
+template <class T>
+void Permute(const std::vector<int>& order, std::vector<T>* v) {
+  std::vector<T> sorted(v->size());
+  for (int i = 0; i != order.size(); i++) {
+    sorted[i] = (*v)[order[i]];
+  }
+  v->swap(sorted);
+}
+
+/// the positions 0 through n - 1 sorted by descending weight
+std::vector<int> WeightOrder(const std::vector<double>& wgts) {
+  std::vector<int> order(wgts.size());
+  for (int i = 0; i != order.size(); i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), WeightComp(wgts));
+  return order;
+}
+
+}  // namespace
 
+void GreedyPreconditioner::Condition(ExchangeGraph* graph) {
   std::vector<RequestGroup::Ptr>& groups =
       const_cast<std::vector<RequestGroup::Ptr>&>(graph->request_groups());
 
-  std::vector<RequestGroup::Ptr>::iterator it;
-  for (it = groups.begin(); it != groups.end(); ++it) {
+  // each node's and group's weight is computed once, and positions are sorted
+  // by weight rather than comparing nodes and groups directly. Commodity
+  // weights are looked up by id, as NodeWeight would look them up by name.
+  std::vector<double> grp_wgts(groups.size());
+  std::vector<double> node_wgts;
+  for (int g = 0; g != groups.size(); g++) {
     std::vector<ExchangeNode::Ptr>& nodes =
-        const_cast<std::vector<ExchangeNode::Ptr>&>((*it)->nodes());
+        const_cast<std::vector<ExchangeNode::Ptr>&>(groups[g]->nodes());
 
-    // get avg prefs
+    // sort nodes by weight
+    node_wgts.resize(nodes.size());
     for (int i = 0; i != nodes.size(); i++) {
-      avg_prefs_[nodes[i]] = AvgPref(nodes[i]);
+      int id = nodes[i]->commod_id();
+      double commod_wgt = commod_weights_.empty() ? 1 :
+                          id < id_weights_.size() ? id_weights_[id] : 0;
+      double avg_pref = AvgPref(nodes[i]);
+      node_wgts[i] = commod_wgt * (1 + avg_pref / (1 + avg_pref));
     }
+    std::vector<int> order = WeightOrder(node_wgts);
+    Permute(order, &nodes);
 
-    // sort nodes by weight
-    std::stable_sort(
-        nodes.begin(), nodes.end(),
-        l::bind(&GreedyPreconditioner::NodeComp, this, l::_1, l::_2));
-
-    // get avg group weights
-    group_weights_[*it] = GroupWeight(*it, &commod_weights_, &avg_prefs_);
+    // get avg group weights, summed in node order as GroupWeight does
+    double sum = 0;
+    for (int i = 0; i != order.size(); i++) {
+      sum += node_wgts[order[i]];
+    }
+    grp_wgts[g] = nodes.size() > 0 ? sum / nodes.size() : 0;
     CLOG(LEV_DEBUG1) << "Group weight value during graph preconditioning is "
-                     << group_weights_[*it] << ".";
+                     << grp_wgts[g] << ".";
   }
 
   // sort groups by avg weight
-  std::stable_sort(
-      groups.begin(), groups.end(),
-      l::bind(&GreedyPreconditioner::GroupComp, this, l::_1, l::_2));
-
-  // clear graph-specific state
-  group_weights_.clear();
+  Permute(WeightOrder(grp_wgts), &groups);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -114,6 +148,17 @@ void GreedyPreconditioner::ProcessWeights_(WgtOrder order) {
   }
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void GreedyPreconditioner::IndexWeights_() {
+  std::map<std::string, double>::iterator it;
+  for (it = commod_weights_.begin(); it != commod_weights_.end(); ++it) {
+    int id = CommodityRegistry::Intern(it->first);
+    if (id >= id_weights_.size())
+      id_weights_.resize(id + 1, 0);
+    id_weights_[id] = it->second;
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 double GroupWeight(RequestGroup::Ptr g,
                    std::map<std::string, double>* weights,
@@ -3,6 +3,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "exchange_graph.h"
 
@@ -84,18 +85,14 @@ class GreedyPreconditioner {
 
   /// @brief a comparitor for ordering containers of ExchangeNode::Ptrs in
   /// descending order based on their commodity's weight
+  ///
+  /// @warning this computes both weights on every call; Condition() instead
+  /// computes each weight once and sorts by the precomputed weights
   inline bool NodeComp(const ExchangeNode::Ptr l,
                        const ExchangeNode::Ptr r) {
     return
-        NodeWeight(l, &commod_weights_, avg_prefs_[l]) >
-        NodeWeight(r, &commod_weights_, avg_prefs_[r]);
-  }
-
-  /// @brief a comparitor for ordering containers of Request::Ptrs in
-  /// descending order based on their average commodity weight
-  inline bool GroupComp(const RequestGroup::Ptr l,
-                        const RequestGroup::Ptr r) {
-    return group_weights_[l] > group_weights_[r];
+        NodeWeight(l, &commod_weights_, AvgPref(l)) >
+        NodeWeight(r, &commod_weights_, AvgPref(r));
   }
 
  private:
@@ -103,10 +100,15 @@ class GreedyPreconditioner {
   /// direction
   void ProcessWeights_(WgtOrder order);
 
+  /// @brief sets id_weights_ from commod_weights_
+  void IndexWeights_();
+
   bool apply_commod_weights_;
-  std::map<ExchangeNode::Ptr, double> avg_prefs_;
   std::map<std::string, double> commod_weights_;
-  std::map<RequestGroup::Ptr, double> group_weights_;
+
+  /// @brief the commodity weights by commodity id (see CommodityRegistry),
+  /// with 0 for commodities without weights
+  std::vector<double> id_weights_;
 };
 
 }  // namespace cyclus
@@ -38,6 +38,14 @@ GreedySolver::~GreedySolver() {
     delete conditioner_;
 }
 
+ExchangeSolver* GreedySolver::Clone() {
+  GreedyPreconditioner* c = conditioner_ == NULL ? NULL :
+                            new GreedyPreconditioner(*conditioner_);
+  GreedySolver* s = new GreedySolver(exclusive_orders_, c);
+  s->sim_ctx(sim_ctx_);
+  return s;
+}
+
 void GreedySolver::Condition() {
   if (conditioner_ != NULL)
     conditioner_->Condition(graph_);
@@ -62,16 +70,47 @@ double GreedySolver::SolveGraph() {
   Condition();
   obj_ = 0;
   unmatched_ = 0;
-  n_qty_.clear();
-  
+
   Init();
- 
+
+  const FlatExchangeGraph& f = graph_->flat();
+  node_qty_.assign(f.nodes.size(), 0);
+  group_caps_.clear();
+  group_cap_start_.resize(f.groups.size() + 1);
+  for (int i = 0; i != f.groups.size(); i++) {
+    group_cap_start_[i] = group_caps_.size();
+    const std::vector<double>& caps = f.groups[i]->capacities();
+    group_caps_.insert(group_caps_.end(), caps.begin(), caps.end());
+  }
+  group_cap_start_[f.groups.size()] = group_caps_.size();
+  arc_keys_.resize(f.arc_pref.size());
+  for (int i = 0; i != arc_keys_.size(); i++) {
+    arc_keys_[i].pref = f.arc_pref[i];
+    arc_keys_[i].uid = f.node_agent_id[f.arc_unode[i]];
+    arc_keys_[i].vid = f.node_agent_id[f.arc_vnode[i]];
+  }
+  // an exclusive arc is matched only if its capacity exceeds the largest
+  // quantity that is not within float_ulp_eq of its exclusive value
+  excl_floor_.assign(f.arc_pref.size(), 0);
+  for (int i = 0; i != excl_floor_.size(); i++) {
+    if (f.arc_exclusive[i]) {
+      excl_floor_[i] = boost::math::float_advance(f.arc_excl_val[i],
+                                                  -float_ulp_eq);
+    }
+  }
+
   std::for_each(graph_->request_groups().begin(),
                 graph_->request_groups().end(),
                 std::bind1st(
                     std::mem_fun(&GreedySolver::GreedilySatisfySet),
                     this));
 
+  // keep the Arc-based capacity queries consistent with the solution
+  for (int i = 0; i != f.groups.size(); i++) {
+    grp_caps_[f.groups[i]].assign(group_caps_.begin() + group_cap_start_[i],
+                                  group_caps_.begin() + group_cap_start_[i + 1]);
+  }
+
   obj_ += unmatched_ * pseudo_cost;
   return obj_;
 }
@@ -100,106 +139,193 @@ double GreedySolver::Capacity(ExchangeNode::Ptr n, const Arc& a, bool min_cap,
     return n->qty - curr_qty;
   }
 
-  std::vector<double>& unit_caps = n->unit_capacities[a];
+  const std::vector<double>& unit_caps = n->unit_capacities[a];
   const std::vector<double>& group_caps = grp_caps_[n->group];
-  std::vector<double> caps;
-  double grp_cap, u_cap, cap;
+  double max = std::numeric_limits<double>::max();
+  double cap = min_cap ? max : -max;
 
   for (int i = 0; i < unit_caps.size(); i++) {
-    grp_cap = group_caps[i];
-    u_cap = unit_caps[i];
-    cap = grp_cap / u_cap;
+    double grp_cap = group_caps[i];
+    // special case for unlimited capacities
+    double c = (grp_cap == max) ? max : grp_cap / unit_caps[i];
     CLOG(cyclus::LEV_DEBUG1) << "Capacity for node: ";
     CLOG(cyclus::LEV_DEBUG1) << "   group capacity: " << grp_cap;
-    CLOG(cyclus::LEV_DEBUG1) << "    unit capacity: " << u_cap;
-    CLOG(cyclus::LEV_DEBUG1) << "         capacity: " << cap;
+    CLOG(cyclus::LEV_DEBUG1) << "    unit capacity: " << unit_caps[i];
+    CLOG(cyclus::LEV_DEBUG1) << "         capacity: " << c;
+    // the smallest value is constraining for bids, while the largest value
+    // must be met for requests
+    cap = min_cap ? std::min(cap, c) : std::max(cap, c);
+  }
+  return std::min(cap, n->qty - curr_qty);
+}
+
+double GreedySolver::NodeCapacity(int n, const double* ucaps, int ncaps,
+                                  bool min_cap, double curr_qty) {
+  const FlatExchangeGraph& f = graph_->flat();
+  if (f.node_group[n] < 0) {
+    throw cyclus::StateError("An notion of node capacity requires a nodegroup.");
+  }
 
+  if (ncaps == 0) {
+    return f.node_qty[n] - curr_qty;
+  }
+
+  const double* group_caps = group_caps_.data() +
+                             group_cap_start_[f.node_group[n]];
+  double max = std::numeric_limits<double>::max();
+  double cap = min_cap ? max : -max;
+  for (int i = 0; i < ncaps; i++) {
+    double grp_cap = group_caps[i];
     // special case for unlimited capacities
-    if (grp_cap == std::numeric_limits<double>::max()) {
-      caps.push_back(std::numeric_limits<double>::max());
-    } else {
-      caps.push_back(cap);
-    }
+    double c = (grp_cap == max) ? max : grp_cap / ucaps[i];
+    CLOG(cyclus::LEV_DEBUG1) << "Capacity for node: ";
+    CLOG(cyclus::LEV_DEBUG1) << "   group capacity: " << grp_cap;
+    CLOG(cyclus::LEV_DEBUG1) << "    unit capacity: " << ucaps[i];
+    CLOG(cyclus::LEV_DEBUG1) << "         capacity: " << c;
+    // the smallest value is constraining for bids, while the largest value
+    // must be met for requests
+    cap = min_cap ? std::min(cap, c) : std::max(cap, c);
   }
+  return std::min(cap, f.node_qty[n] - curr_qty);
+}
 
-  if (min_cap) {  // the smallest value is constraining (for bids)
-    cap = *std::min_element(caps.begin(), caps.end());
-  } else {  // the largest value must be met (for requests)
-    cap = *std::max_element(caps.begin(), caps.end());
+bool GreedySolver::NodeExceeds(int n, const double* ucaps, int ncaps,
+                               bool min_cap, double curr_qty, double floor) {
+  const FlatExchangeGraph& f = graph_->flat();
+  if (f.node_group[n] < 0) {
+    throw cyclus::StateError("An notion of node capacity requires a nodegroup.");
   }
-  return std::min(cap, n->qty - curr_qty);
+
+  if (f.node_qty[n] - curr_qty <= floor) {
+    return false;
+  }
+
+  const double* group_caps = group_caps_.data() +
+                             group_cap_start_[f.node_group[n]];
+  double max = std::numeric_limits<double>::max();
+  for (int i = 0; i < ncaps; i++) {
+    double grp_cap = group_caps[i];
+    double c = (grp_cap == max) ? max : grp_cap / ucaps[i];
+    // every constraint must exceed floor for bids, while any one suffices for
+    // requests
+    if (min_cap && c <= floor) {
+      return false;
+    } else if (!min_cap && c > floor) {
+      return true;
+    }
+  }
+  return min_cap || ncaps == 0;
 }
 
 void GreedySolver::GetCaps(ExchangeNodeGroup::Ptr g) {
-  for (int i = 0; i != g->nodes().size(); i++) {
-    n_qty_[g->nodes()[i]] = 0;
-  }
   grp_caps_[g.get()] = g->capacities();
 }
 
+namespace {
+
+/// orders positions in a set of nodes by average preference in descending
+/// order, breaking ties as AvgPrefComp does
+struct FlatAvgPrefComp {
+  FlatAvgPrefComp(const std::vector<double>& prefs,
+                  const std::vector<int>& ids)
+      : prefs(prefs), ids(ids) {}
+  bool operator()(int l, int r) const {
+    return (prefs[l] != prefs[r]) ? (prefs[l] > prefs[r]) : (ids[l] > ids[r]);
+  }
+  const std::vector<double>& prefs;
+  const std::vector<int>& ids;
+};
+
+}  // namespace
+
 void GreedySolver::GreedilySatisfySet(RequestGroup::Ptr prs) {
+  const FlatExchangeGraph& f = graph_->flat();
   std::vector<ExchangeNode::Ptr>& nodes = prs->nodes();
-  std::stable_sort(nodes.begin(), nodes.end(), AvgPrefComp);
+
+  // order the request nodes by average preference, computing each average
+  // only once
+  int nnodes = nodes.size();
+  avg_prefs_.resize(nnodes);
+  agent_ids_.resize(nnodes);
+  order_.resize(nnodes);
+  for (int i = 0; i != nnodes; i++) {
+    avg_prefs_[i] = AvgPref(nodes[i]);
+    agent_ids_[i] = nodes[i]->agent_id;
+    order_[i] = i;
+  }
+  std::stable_sort(order_.begin(), order_.end(),
+                   FlatAvgPrefComp(avg_prefs_, agent_ids_));
+  std::vector<ExchangeNode::Ptr> sorted_nodes(nnodes);
+  for (int i = 0; i != nnodes; i++) {
+    sorted_nodes[i] = nodes[order_[i]];
+  }
+  nodes.swap(sorted_nodes);
 
   std::vector<ExchangeNode::Ptr>::iterator req_it = nodes.begin();
   double target = prs->qty();
   double match = 0;
 
-  ExchangeNode::Ptr u, v;
-  std::vector<Arc>::const_iterator arc_it;
-  std::vector<Arc> sorted;
-  double remain, tomatch, excl_val;
+  std::vector<int>::const_iterator arc_it;
+  std::vector<int>& sorted = arc_order_;
+  double remain, tomatch;
 
   CLOG(LEV_DEBUG1) << "Greedy Solving for " << target
                    << " amount of a resource.";
 
   while ((match <= target) && (req_it != nodes.end())) {
-    // this if statement is needed because map.at() will throw if the key does
-    // not exist, which is a corner case for when there is a request with no bid
-    // arcs associated with it
-    if (graph_->node_arc_map().count(*req_it) > 0) {
-      const std::vector<Arc>& arcs = graph_->node_arc_map().at(*req_it);
-      sorted = std::vector<Arc>(arcs);  // make a copy for now
-      std::stable_sort(sorted.begin(), sorted.end(), ReqPrefComp);
+    // requests with no bid arcs on them are skipped
+    int n = f.node_id(req_it->get());
+    if (n >= 0 && f.adj_start[n] != f.adj_start[n + 1]) {
+      sorted.assign(f.adj.begin() + f.adj_start[n],
+                    f.adj.begin() + f.adj_start[n + 1]);
+      std::stable_sort(sorted.begin(), sorted.end(), ArcKeyComp(arc_keys_));
       arc_it = sorted.begin();
 
       while ((match <= target) && (arc_it != sorted.end())) {
         remain = target - match;
-        const Arc& a = *arc_it;
-        u = a.unode();
-        v = a.vnode();
-        // capacity adjustment
-        tomatch = std::min(remain, Capacity(a, n_qty_[u], n_qty_[v]));
-
-        // exclusivity adjustment
-        if (arc_it->exclusive()) {
-          excl_val = a.excl_val();
-
-          // this careful float comparison is vital for preventing false positive
-          // constraint violations w.r.t. exclusivity-related capacity.
-          double dist = boost::math::float_distance(tomatch, excl_val);
-          if (dist >= float_ulp_eq ) {
-            tomatch = 0;
-          } else {
-            tomatch = excl_val;
-          }
+        int a = *arc_it;
+        int u = f.arc_unode[a];
+        int v = f.arc_vnode[a];
+        const double* ucaps = f.ucaps.data() + f.ucap_start[a];
+        int nucaps = f.ucap_start[a + 1] - f.ucap_start[a];
+        const double* vcaps = f.vcaps.data() + f.vcap_start[a];
+        int nvcaps = f.vcap_start[a + 1] - f.vcap_start[a];
+
+        bool min = true;
+        if (f.arc_exclusive[a]) {
+          // exclusive arcs are all or nothing, so it's enough to know whether
+          // the arc's capacity exceeds its floor, which the first binding
+          // constraint decides. the floor keeps the float comparison careful,
+          // which is vital for preventing false positive constraint
+          // violations w.r.t. exclusivity-related capacity.
+          double floor = excl_floor_[a];
+          bool fits = remain > floor &&
+              NodeExceeds(u, ucaps, nucaps, !min, node_qty_[u], floor) &&
+              NodeExceeds(v, vcaps, nvcaps, min, node_qty_[v], floor);
+          tomatch = fits ? f.arc_excl_val[a] : 0;
+        } else {
+          double ucap = NodeCapacity(u, ucaps, nucaps, !min, node_qty_[u]);
+          double vcap = NodeCapacity(v, vcaps, nvcaps, min, node_qty_[v]);
+          CLOG(cyclus::LEV_DEBUG1) << "Capacity for unode of arc: " << ucap;
+          CLOG(cyclus::LEV_DEBUG1) << "Capacity for vnode of arc: " << vcap;
+          tomatch = std::min(remain, std::min(ucap, vcap));
         }
 
         if (tomatch > eps()) {
           CLOG(LEV_DEBUG1) << "Greedy Solver is matching " << tomatch
                            << " amount of a resource.";
-          UpdateCapacity(u, a, tomatch);
-          UpdateCapacity(v, a, tomatch);
-          n_qty_[u] += tomatch;
-          n_qty_[v] += tomatch;
-          graph_->AddMatch(a, tomatch);
+          UpdateNodeCapacity(u, ucaps, nucaps, tomatch);
+          UpdateNodeCapacity(v, vcaps, nvcaps, tomatch);
+          node_qty_[u] += tomatch;
+          node_qty_[v] += tomatch;
+          graph_->AddMatch(graph_->arcs()[a], tomatch);
 
           match += tomatch;
-          UpdateObj(tomatch, u->prefs[a]);
+          UpdateObj(tomatch, f.arc_pref[a]);
         }
         ++arc_it;
       }  // while( (match =< target) && (arc_it != arcs.end()) )
-    }  // if(graph_->node_arc_map().count(*req_it) > 0)
+    }  // if (n >= 0 && f.adj_start[n] != f.adj_start[n + 1])
     ++req_it;
   }  // while( (match =< target) && (req_it != nodes.end()) )
 
@@ -242,4 +368,31 @@ void GreedySolver::UpdateCapacity(ExchangeNode::Ptr n, const Arc& a,
   }
 }
 
+void GreedySolver::UpdateNodeCapacity(int n, const double* ucaps, int ncaps,
+                                      double qty) {
+  using cyclus::IsNegative;
+  using cyclus::ValueError;
+
+  const FlatExchangeGraph& f = graph_->flat();
+  int g = f.node_group[n];
+  double* caps = group_caps_.data() + group_cap_start_[g];
+  assert(ncaps == group_cap_start_[g + 1] - group_cap_start_[g]);
+  for (int i = 0; i < ncaps; i++) {
+    double prev = caps[i];
+    // special case for unlimited capacities
+    caps[i] = (prev == std::numeric_limits<double>::max()) ?
+              std::numeric_limits<double>::max() :
+              prev - qty * ucaps[i];
+  }
+
+  if (IsNegative(f.node_qty[n] - qty)) {
+    std::stringstream ss;
+    ss << "A bid for " << f.nodes[n]->commod << " was set at " << f.node_qty[n]
+       << " but has been matched to a higher value " << qty
+       << ". This could be due to a problem with your "
+       << "bid portfolio constraints.";
+    throw ValueError(ss.str());
+  }
+}
+
 }  // namespace cyclus
@@ -1,6 +1,9 @@
 #ifndef CYCLUS_SRC_GREEDY_SOLVER_H_
 #define CYCLUS_SRC_GREEDY_SOLVER_H_
 
+#include <map>
+#include <vector>
+
 #include "exchange_graph.h"
 #include "exchange_solver.h"
 #include "greedy_preconditioner.h"
@@ -28,8 +31,10 @@ inline bool ReqPrefComp(const Arc& l, const Arc& r) {
   int lv = l.vnode()->agent_id;
   int ru = r.unode()->agent_id;
   int rv = r.vnode()->agent_id;
-  double lpref = l.unode()->prefs[l];
-  double rpref = r.unode()->prefs[r];
+  std::map<Arc, double>::const_iterator lit = l.unode()->prefs.find(l);
+  std::map<Arc, double>::const_iterator rit = r.unode()->prefs.find(r);
+  double lpref = lit == l.unode()->prefs.end() ? 0 : lit->second;
+  double rpref = rit == r.unode()->prefs.end() ? 0 : rit->second;
   return (lpref != rpref) ? (lpref > rpref) : (lu > ru || (lu == ru && lv > rv));
 }
 
@@ -44,6 +49,27 @@ inline bool AvgPrefComp(ExchangeNode::Ptr l, ExchangeNode::Ptr r) {
   return (lpref != rpref) ? (lpref > rpref) : (lid > rid);
 }
 
+/// @brief The sort key of an arc of a flattened ExchangeGraph: the
+/// requester's preference and the agent ids of the arc's nodes.
+struct ArcKey {
+  double pref;
+  int uid;
+  int vid;
+};
+
+/// @brief A comparison function for sorting arc ids in the same order as
+/// ReqPrefComp, given the key of every arc.
+struct ArcKeyComp {
+  explicit ArcKeyComp(const std::vector<ArcKey>& keys) : keys(keys) {}
+  inline bool operator()(int l, int r) const {
+    const ArcKey& lk = keys[l];
+    const ArcKey& rk = keys[r];
+    return (lk.pref != rk.pref) ? (lk.pref > rk.pref) :
+           (lk.uid > rk.uid || (lk.uid == rk.uid && lk.vid > rk.vid));
+  }
+  const std::vector<ArcKey>& keys;
+};
+
 class ExchangeGraph;
 class GreedyPreconditioner;
 
@@ -76,6 +102,10 @@ class GreedySolver: public ExchangeSolver {
   
   virtual ~GreedySolver();
 
+  /// @brief returns a new solver with the same exclusivity and a copy of this
+  /// solver's conditioner, if any
+  virtual ExchangeSolver* Clone();
+
   /// Uses the provided (or a default) GreedyPreconditioner to condition the
   /// solver's ExchangeGraph so that RequestGroups are ordered by average
   /// preference and commodity weight.
@@ -145,10 +175,37 @@ class GreedySolver: public ExchangeSolver {
   void GreedilySatisfySet(RequestGroup::Ptr prs);
   void UpdateCapacity(ExchangeNode::Ptr n, const Arc& a, double qty);
   void UpdateObj(double qty, double pref);
-  
+
+  /// @brief the capacity of node n of the flattened graph, given the unit
+  /// capacities ucaps[0] through ucaps[ncaps - 1] of one of its arcs
+  double NodeCapacity(int n, const double* ucaps, int ncaps, bool min_cap,
+                      double curr_qty);
+
+  /// @brief whether the capacity of node n of the flattened graph, as
+  /// NodeCapacity would compute it, exceeds floor, checking only as many of
+  /// the constraints as it takes to decide
+  bool NodeExceeds(int n, const double* ucaps, int ncaps, bool min_cap,
+                   double curr_qty, double floor);
+
+  /// @brief updates the flattened group capacities of node n for a match of
+  /// qty along an arc with the given unit capacities
+  void UpdateNodeCapacity(int n, const double* ucaps, int ncaps, double qty);
+
   GreedyPreconditioner* conditioner_;
-  std::map<ExchangeNode::Ptr, double> n_qty_;
   std::map<ExchangeNodeGroup*, std::vector<double> > grp_caps_;
+
+  // solve state, indexed by the node and group ids of graph_->flat()
+  std::vector<double> node_qty_;
+  std::vector<double> group_caps_;
+  std::vector<int> group_cap_start_;
+  std::vector<ArcKey> arc_keys_;
+  std::vector<double> excl_floor_;
+
+  // scratch space reused across request groups
+  std::vector<double> avg_prefs_;
+  std::vector<int> agent_ids_;
+  std::vector<int> order_;
+  std::vector<int> arc_order_;
   double obj_;
   double unmatched_;
 };
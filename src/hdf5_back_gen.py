@@ -1063,6 +1063,12 @@ def get_body(t, depth=0, prefix="", base_offset="buf+offset"):
 TEARDOWN_STACK = []
 VARS = []
 
+def h5_lock(acquire):
+    """HDF5 Query: Represents acquiring or releasing the lock that serializes
+    HDF5 library calls made by query threads."""
+    code = "h5lock.lock()" if acquire else "h5lock.unlock()"
+    return ExprStmt(child=Raw(code=code))
+
 def normal_close(t):
     """Represents the generic close to an hdf5 type code block."""
     x = get_variable("x", depth=0, prefix="")
@@ -1072,16 +1078,20 @@ def normal_close(t):
                  value=FuncCall(name=Var(name="CmpConds"),
                                 targs=[Raw(code=t.cpp)],
                             args=[Raw(code="&"+x),
-                                  Raw(code="&(field_conds[qr.fields[j]])")]))),
+                                  Raw(code="col_conds[j]")]))),
         If(cond=Var(name="is_row_selected"),
            body=[ExprStmt(child=Assign(target=Var(name="row[j]"),
                                        value=Var(name=x)))])])
 
+    if len(TEARDOWN_STACK) == 0:
+        return tree
+    tree.nodes.append(h5_lock(True))
     for i in range(len(TEARDOWN_STACK)):
         var_name = TEARDOWN_STACK.pop()
         teardown = ExprStmt(child=FuncCall(name=Var(name="H5Tclose"),
                                            args=[Raw(code=var_name)]))
         tree.nodes.append(teardown)
+    tree.nodes.append(h5_lock(False))
     return tree
 
 def get_teardown(t):
@@ -1629,6 +1639,10 @@ def main_query():
     for type in CANON_TYPES:
         type_node = CANON_TO_NODE[type]
         setup = get_setup(type_node)
+        # only the setup and teardown call into HDF5 (VLRead locks itself),
+        # so the body may run concurrently with other query threads.
+        if len(TEARDOWN_STACK) > 0:
+            setup = Block(nodes=[h5_lock(True), setup, h5_lock(False)])
         body = get_body(type_node)
         teardown = get_teardown(type_node)
         read_x = Block(nodes=[setup, body, teardown])
@@ -1729,6 +1743,23 @@ def main_vl_dataset():
     output = indent(output, INDENT*2)
     return output
 
+def main_vl_prefetch():
+    """HDF5 VL_PREFETCH: Generates the VLPrefetch function code."""
+    CPPGEN = CppGen()
+    output = ""
+    for i in CANON_TYPES:
+        node = CANON_TO_NODE[i]
+        if not DB_TO_VL[node.db]:
+            continue
+        read_many = FuncCall(name=Var(name="VLReadMany"),
+                             targs=[Raw(code=node.cpp), Raw(code=node.db)],
+                             args=[Raw(code="buf"), Raw(code="n"),
+                                   Raw(code="stride")])
+        case_body = ExprStmt(child=read_many)
+        output += CPPGEN.visit(case_template(node, case_body))
+    output = indent(output, INDENT*2)
+    return output
+
 def main_fill_buf():
     """HDF5 FILL_BUF: Generates the FillBuf function code."""
     CPPGEN = CppGen()
@@ -1748,21 +1779,15 @@ def main_fill_buf():
 vl_write_vl_string = """hasher_.Clear();
 hasher_.Update({var});
 Digest {key} = hasher_.digest();
-hid_t {keysds} = VLDataset({t.db}, true);
-hid_t {valsds} = VLDataset({t.db}, false);
-if (vlkeys_[{t.db}].count({key}) != 1) {{
-  AppendVLKey({keysds}, {t.db}, {key});
-  InsertVLVal({valsds}, {t.db}, {key}, {var});
+if (!HasVLKey({t.db}, {key})) {{
+  WriteVLVal({t.db}, {key}, {var});
 }}\n"""
 
 vl_write_blob = """hasher_.Clear();
 hasher_.Update({var});
 Digest {key} = hasher_.digest();
-hid_t {keysds} = VLDataset({t.db}, true);
-hid_t {valsds} = VLDataset({t.db}, false);
-if (vlkeys_[{t.db}].count({key}) != 1) {{
-  AppendVLKey({keysds}, {t.db}, {key});
-  InsertVLVal({valsds}, {t.db}, {key}, ({var}).str());
+if (!HasVLKey({t.db}, {key})) {{
+  WriteVLVal({t.db}, {key}, ({var}).str());
 }}\n"""
 
 VL_SPECIAL_TYPES = {"VL_STRING": vl_write_vl_string,
@@ -1772,28 +1797,23 @@ def vl_write(t, variable, depth=0, prefix="", pointer=False):
     """HDF5 Write: Return code previously found in VLWrite."""
     buf_variable = get_variable("buf", depth=depth, prefix=prefix)
     key_variable = get_variable("key", depth=depth, prefix=prefix)
-    keysds_variable = get_variable("keysds", depth=depth, prefix=prefix)
-    valsds_variable = get_variable("valsds", depth=depth, prefix=prefix)
     if pointer:
         variable = "*" + variable
     node_str = ""
     if t.db in VL_SPECIAL_TYPES:
         node_str = VL_SPECIAL_TYPES[t.db]
     else:
+        # values nested in the buffer are written by VLValToBuf, so it
+        # must be called before the value is written under the lock
         node_str = """hasher_.Clear();
 hasher_.Update({var});
 Digest {key} = hasher_.digest();
-hid_t {keysds} = VLDataset({t.db}, true);
-hid_t {valsds} = VLDataset({t.db}, false);
-if (vlkeys_[{t.db}].count({key}) != 1) {{
+if (!HasVLKey({t.db}, {key})) {{
   hvl_t {buf} = VLValToBuf({var});
-  AppendVLKey({keysds}, {t.db}, {key});
-  InsertVLVal({valsds}, {t.db}, {key}, {buf});
+  WriteVLVal({t.db}, {key}, {buf});
 }}\n"""
     node = Raw(code=node_str.format(var=variable, no_p_var=variable.strip("*"),
-                                    key=key_variable,
-                                    keysds=keysds_variable, t=t,
-                                    valsds=valsds_variable,
+                                    key=key_variable, t=t,
                                     buf=buf_variable))
     return node
 
@@ -2836,6 +2856,7 @@ def setup():
     MAIN_DISPATCH = {"QUERY": main_query,
                      "CREATE": main_create,
                      "VL_DATASET": main_vl_dataset,
+                     "VL_PREFETCH": main_vl_prefetch,
                      "FILL_BUF": main_fill_buf,
                      "WRITE": main_write,
                      "VAL_TO_BUF_H": main_val_to_buf_h,
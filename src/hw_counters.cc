@@ -0,0 +1,163 @@
+#include "hw_counters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "context.h"
+#include "logger.h"
+
+namespace cyclus {
+
+namespace {
+
+#if defined(__linux__)
+// Opens a hardware event of the calling thread in group, or as the leader of
+// a new group if group is -1.
+int OpenEvent(uint64_t config, int group) {
+  struct perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = group == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+}  // namespace
+
+HwCounters::HwCounters() : fd_(-1), nevents_(0) {
+  fds_[0] = fds_[1] = fds_[2] = -1;
+#if defined(__linux__)
+  fd_ = OpenEvent(PERF_COUNT_HW_CPU_CYCLES, -1);
+  if (fd_ < 0) {
+    CLOG(LEV_WARN) << "hardware counters are unavailable: "
+                   << std::strerror(errno);
+    return;
+  }
+  uint64_t configs[3] = {PERF_COUNT_HW_INSTRUCTIONS,
+                         PERF_COUNT_HW_CACHE_MISSES,
+                         PERF_COUNT_HW_BRANCH_MISSES};
+  for (int i = 0; i < 3; ++i) {
+    fds_[i] = OpenEvent(configs[i], fd_);
+    if (fds_[i] < 0) {
+      // e.g. too few counters on this processor to count the whole group
+      CLOG(LEV_WARN) << "hardware counters are unavailable: "
+                     << std::strerror(errno);
+      for (int j = 0; j < i; ++j)
+        close(fds_[j]);
+      close(fd_);
+      fd_ = -1;
+      fds_[0] = fds_[1] = fds_[2] = -1;
+      return;
+    }
+  }
+  nevents_ = 4;
+  ioctl(fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+HwCounters::~HwCounters() {
+#if defined(__linux__)
+  for (int i = 0; i < 3; ++i) {
+    if (fds_[i] >= 0)
+      close(fds_[i]);
+  }
+  if (fd_ >= 0)
+    close(fd_);
+#endif
+}
+
+HwCounters::Values HwCounters::Read() const {
+  Values v;
+#if defined(__linux__)
+  if (fd_ < 0)
+    return v;
+  // nr, time enabled, time running, and the value of each event in order
+  uint64_t buf[3 + 4];
+  if (read(fd_, buf, sizeof(buf)) != sizeof(buf) || buf[0] != nevents_)
+    return v;
+  double scale = buf[2] == 0 ? 0 : static_cast<double>(buf[1]) / buf[2];
+  v.cycles = buf[3] * scale;
+  v.instructions = buf[4] * scale;
+  v.cache_misses = buf[5] * scale;
+  v.branch_misses = buf[6] * scale;
+#endif
+  return v;
+}
+
+void HwCounters::Add(const char* cat, const char* phase, const Values& start,
+                     double secs) {
+  Values now = Read();
+  std::lock_guard<std::mutex> lock(mu_);
+  Total& t = totals_[std::make_pair(std::string(cat), std::string(phase))];
+  t.calls++;
+  t.seconds += secs;
+  // multiplexing scales the counts, which may then step back slightly
+  if (now.cycles > start.cycles)
+    t.values.cycles += now.cycles - start.cycles;
+  if (now.instructions > start.instructions)
+    t.values.instructions += now.instructions - start.instructions;
+  if (now.cache_misses > start.cache_misses)
+    t.values.cache_misses += now.cache_misses - start.cache_misses;
+  if (now.branch_misses > start.branch_misses)
+    t.values.branch_misses += now.branch_misses - start.branch_misses;
+}
+
+std::map<std::pair<std::string, std::string>, HwCounters::Total>
+HwCounters::totals() {
+  std::lock_guard<std::mutex> lock(mu_);
+  return totals_;
+}
+
+void HwCounters::Record(Context* ctx) {
+  std::map<std::pair<std::string, std::string>, Total> all = totals();
+  std::map<std::pair<std::string, std::string>, Total>::iterator it;
+  for (it = all.begin(); it != all.end(); ++it) {
+    const Total& t = it->second;
+    ctx->NewDatum("HardwareCounters")
+        ->AddVal("Category", it->first.first)
+        ->AddVal("Phase", it->first.second)
+        ->AddVal("Calls", static_cast<int>(t.calls))
+        ->AddVal("Seconds", t.seconds)
+        ->AddVal("Cycles", static_cast<double>(t.values.cycles))
+        ->AddVal("Instructions", static_cast<double>(t.values.instructions))
+        ->AddVal("CacheMisses", static_cast<double>(t.values.cache_misses))
+        ->AddVal("BranchMisses", static_cast<double>(t.values.branch_misses))
+        ->Record();
+  }
+}
+
+void HwCounters::Summarize(std::ostream& out) {
+  std::map<std::pair<std::string, std::string>, Total> all = totals();
+  out << "Hardware counters (phase: s; cycles, IPC, cache misses, branch "
+         "misses):\n";
+  std::streamsize prec = out.precision();
+  std::map<std::pair<std::string, std::string>, Total>::iterator it;
+  for (it = all.begin(); it != all.end(); ++it) {
+    const Total& t = it->second;
+    double ipc = t.values.cycles == 0
+                     ? 0
+                     : static_cast<double>(t.values.instructions) /
+                           t.values.cycles;
+    out << "  " << it->first.first << "/" << it->first.second << ": "
+        << t.seconds << " s; " << t.values.cycles << ", " << std::fixed
+        << std::setprecision(2) << ipc << std::defaultfloat
+        << std::setprecision(prec) << ", " << t.values.cache_misses << ", "
+        << t.values.branch_misses << "\n";
+  }
+}
+
+}  // namespace cyclus
@@ -0,0 +1,115 @@
+#ifndef CYCLUS_SRC_HW_COUNTERS_H_
+#define CYCLUS_SRC_HW_COUNTERS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+namespace cyclus {
+
+class Context;
+
+/// Counts the processor cycles, instructions, last level cache misses, and
+/// branch misses of the phases of each time step and each resource exchange,
+/// with the Linux perf_event_open interface, so that the instructions per
+/// cycle and cache behavior of each stage can be seen alongside its time.
+///
+/// The counters count the thread that created the object (the thread the
+/// simulation runs on) in user space only; work handed to other threads,
+/// such as parallel agent phases, is not counted. Where the counters are
+/// unavailable, e.g. on other platforms, in some virtual machines, or when
+/// perf_event_paranoid forbids them, available() is false and phases are
+/// only timed.
+///
+/// Counting is turned on with Context::count_hardware. The timer records the
+/// totals to the HardwareCounters table at the end of the simulation, one
+/// row per phase.
+class HwCounters {
+ public:
+  /// The counts of a group of events.
+  struct Values {
+    Values()
+        : cycles(0), instructions(0), cache_misses(0), branch_misses(0) {}
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t cache_misses;
+    uint64_t branch_misses;
+  };
+
+  /// The totals of a phase.
+  struct Total {
+    Total() : calls(0), seconds(0) {}
+    uint64_t calls;
+    double seconds;
+    Values values;
+  };
+
+  /// Opens the counters of the calling thread.
+  HwCounters();
+  ~HwCounters();
+
+  /// Returns whether the processor's counters could be opened.
+  bool available() const { return fd_ >= 0; }
+
+  /// Returns the counts of the calling thread so far, scaled up for the time
+  /// the counters were multiplexed out, or zeros if they are unavailable.
+  Values Read() const;
+
+  /// Adds a run of phase in category cat that started with the counts start
+  /// and took secs seconds, reading the counts now.
+  void Add(const char* cat, const char* phase, const Values& start,
+           double secs);
+
+  /// Returns the totals, by category and phase.
+  std::map<std::pair<std::string, std::string>, Total> totals();
+
+  /// Records the totals to the HardwareCounters table.
+  void Record(Context* ctx);
+
+  /// Prints the totals of each phase, with its instructions per cycle.
+  void Summarize(std::ostream& out);
+
+ private:
+  // the group leader, counting cycles, and the other events of its group
+  int fd_;
+  int fds_[3];
+  int nevents_;
+
+  std::mutex mu_;
+  std::map<std::pair<std::string, std::string>, Total> totals_;
+};
+
+/// Counts a phase from its creation until it goes out of scope, if counters
+/// isn't NULL.
+class CounterSpan {
+ public:
+  CounterSpan(HwCounters* counters, const char* cat, const char* phase)
+      : counters_(counters), cat_(cat), phase_(phase) {
+    if (counters_ != NULL) {
+      start_ = std::chrono::steady_clock::now();
+      values_ = counters_->Read();
+    }
+  }
+
+  ~CounterSpan() {
+    if (counters_ != NULL) {
+      counters_->Add(cat_, phase_, values_,
+                     std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start_).count());
+    }
+  }
+
+ private:
+  HwCounters* counters_;
+  const char* cat_;
+  const char* phase_;
+  std::chrono::steady_clock::time_point start_;
+  HwCounters::Values values_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_HW_COUNTERS_H_
@@ -0,0 +1,77 @@
+#include "id_allocator.h"
+
+namespace cyclus {
+
+namespace {
+
+thread_local IdAllocator* current_ids = NULL;
+
+}  // namespace
+
+thread_local IdAllocator::Block* IdAllocator::blocks_[NUM_KINDS] = {};
+
+IdAllocator::IdAllocator() {
+  next_[AGENT] = 0;
+  next_[RESOURCE_STATE] = 1;
+  next_[RESOURCE_OBJ] = 1;
+  next_[PRODUCT_QUALITY] = 1;
+}
+
+int IdAllocator::InternQuality(const std::string& quality, bool* added) {
+  std::lock_guard<std::mutex> lock(mu_);
+  std::map<std::string, int>::iterator it = qualities_.find(quality);
+  *added = it == qualities_.end();
+  if (*added) {
+    it = qualities_.insert(std::make_pair(quality, Next(PRODUCT_QUALITY)))
+             .first;
+  }
+  return it->second;
+}
+
+int IdAllocator::QualityId(const std::string& quality) {
+  std::lock_guard<std::mutex> lock(mu_);
+  std::map<std::string, int>::iterator it = qualities_.find(quality);
+  return it == qualities_.end() ? 0 : it->second;
+}
+
+void IdAllocator::SetQuality(const std::string& quality, int id) {
+  std::lock_guard<std::mutex> lock(mu_);
+  qualities_[quality] = id;
+}
+
+void IdAllocator::CopyFrom(IdAllocator* other) {
+  for (int k = 0; k < NUM_KINDS; ++k) {
+    next_[k] = other->next_[k].load();
+  }
+  std::map<std::string, int> qualities;
+  {
+    std::lock_guard<std::mutex> lock(other->mu_);
+    qualities = other->qualities_;
+  }
+  std::lock_guard<std::mutex> lock(mu_);
+  qualities_.swap(qualities);
+}
+
+IdAllocator* IdAllocator::current() {
+  static IdAllocator process;
+  return current_ids != NULL ? current_ids : &process;
+}
+
+IdAllocator::Scope::Scope(IdAllocator* ids) : prev_(current_ids) {
+  current_ids = ids;
+}
+
+IdAllocator::Scope::~Scope() {
+  current_ids = prev_;
+}
+
+IdAllocator::BlockScope::BlockScope(Block* b)
+    : kind_(b->kind_), prev_(blocks_[b->kind_]) {
+  blocks_[kind_] = b;
+}
+
+IdAllocator::BlockScope::~BlockScope() {
+  blocks_[kind_] = prev_;
+}
+
+}  // namespace cyclus
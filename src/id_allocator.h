@@ -0,0 +1,135 @@
+#ifndef CYCLUS_SRC_ID_ALLOCATOR_H_
+#define CYCLUS_SRC_ID_ALLOCATOR_H_
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace cyclus {
+
+/// Hands out the ids of the agents, resources, and product qualities of a
+/// simulation. Each Context has its own, so that independent simulations in
+/// one process (e.g. forks, or simulations run from a pool of Python threads)
+/// number their objects independently and reproducibly.
+///
+/// Ids are handed out atomically, so an allocator may be shared by the
+/// threads running a simulation's phases. Threads that hand out many ids can
+/// reserve a Block of them at a time instead.
+class IdAllocator {
+ public:
+  /// The kinds of ids handed out, each numbered on its own.
+  enum Kind {
+    AGENT = 0,
+    RESOURCE_STATE,
+    RESOURCE_OBJ,
+    PRODUCT_QUALITY,
+    NUM_KINDS,
+  };
+
+  /// Agent ids start at 0, all others at 1.
+  IdAllocator();
+
+  /// Returns the next id of the kind, from the block the calling thread
+  /// draws ids of the kind from (see BlockScope), if it is one of this
+  /// allocator's.
+  inline int Next(Kind k) {
+    Block* b = blocks_[k];
+    return b != NULL && b->ids_ == this ? b->Next() : next_[k]++;
+  }
+
+  /// Reserves n consecutive ids of the kind, returning the first.
+  inline int Reserve(Kind k, int n) { return next_[k].fetch_add(n); }
+
+  /// @brief the id that will be handed out next for the kind
+  /// @{
+  inline int next(Kind k) const { return next_[k].load(); }
+  inline void next(Kind k, int id) { next_[k] = id; }
+  /// @}
+
+  /// Returns the id of the product quality, giving it a new one if it has
+  /// none yet. added is set to whether it did.
+  int InternQuality(const std::string& quality, bool* added);
+
+  /// Returns the id of the product quality, or 0 if it has none.
+  int QualityId(const std::string& quality);
+
+  /// Gives the product quality the id, e.g. as read from a snapshot.
+  void SetQuality(const std::string& quality, int id);
+
+  /// Sets the next ids and product qualities to those of other.
+  void CopyFrom(IdAllocator* other);
+
+  /// Returns the allocator of the simulation run on this thread (see Scope),
+  /// or a process-wide one if there is none. Resources created outside of a
+  /// simulation (e.g. untracked ones) take their ids from it.
+  static IdAllocator* current();
+
+  /// Makes an allocator the current one of the thread for its lifetime.
+  class Scope {
+   public:
+    explicit Scope(IdAllocator* ids);
+    ~Scope();
+
+   private:
+    IdAllocator* prev_;
+  };
+
+  /// Ids of one kind reserved size at a time, for use by a single thread.
+  /// Ids handed out through blocks are unique but, unlike those handed out
+  /// by Next, do not follow the order in which they are asked for.
+  class Block {
+   public:
+    Block(IdAllocator* ids, Kind k, int size)
+        : ids_(ids), kind_(k), size_(size < 1 ? 1 : size), next_(0), end_(0) {}
+
+    /// Reserves the first size ids of the block now rather than when the
+    /// first of them is asked for, e.g. so that the blocks of work done
+    /// concurrently are numbered in the order of the work.
+    inline void Reserve() {
+      next_ = ids_->Reserve(kind_, size_);
+      end_ = next_ + size_;
+    }
+
+    /// Returns the next id in the block, reserving a new block if it is used
+    /// up.
+    inline int Next() {
+      if (next_ == end_) {
+        Reserve();
+      }
+      return next_++;
+    }
+
+   private:
+    friend class IdAllocator;
+    IdAllocator* ids_;
+    Kind kind_;
+    int size_;
+    int next_;
+    int end_;
+  };
+
+  /// Makes the calling thread draw the ids of a block's kind that its
+  /// allocator hands out through Next from the block, for the scope's
+  /// lifetime.
+  class BlockScope {
+   public:
+    explicit BlockScope(Block* b);
+    ~BlockScope();
+
+   private:
+    Kind kind_;
+    Block* prev_;
+  };
+
+ private:
+  std::atomic<int> next_[NUM_KINDS];
+  // the blocks the calling thread draws ids from, by kind, if any
+  static thread_local Block* blocks_[NUM_KINDS];
+  std::mutex mu_;
+  std::map<std::string, int> qualities_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_ID_ALLOCATOR_H_
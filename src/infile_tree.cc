@@ -47,7 +47,19 @@ int InfileTree::NElements() {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 int InfileTree::NMatches(std::string query) {
-  return current_node_->find(query).size();
+  return Find(query).size();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+const std::vector<xmlpp::Node*>& InfileTree::Find(const std::string& query) {
+  std::map<std::string, std::vector<xmlpp::Node*> >::iterator it =
+      matches_.find(query);
+  if (it == matches_.end()) {
+    const xmlpp::NodeSet nodeset = current_node_->find(query);
+    it = matches_.insert(std::make_pair(query, std::vector<xmlpp::Node*>(
+        nodeset.begin(), nodeset.end()))).first;
+  }
+  return it->second;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -56,7 +68,7 @@ std::string InfileTree::GetString(std::string query, int index) {
   using xmlpp::NodeSet;
   using xmlpp::TextNode;
   using xmlpp::Element;
-  const NodeSet nodeset = current_node_->find(query);
+  const std::vector<Node*>& nodeset = Find(query);
   if (nodeset.empty()) {
     throw KeyError("Could not find a node by the name: " + query);
   }
@@ -113,7 +125,7 @@ std::string InfileTree::GetElementName(int index) {
 InfileTree* InfileTree::GetEngineFromQuery(std::string query, int index) {
   using xmlpp::Node;
   using xmlpp::NodeSet;
-  const NodeSet nodeset = current_node_->find(query);
+  const std::vector<Node*>& nodeset = Find(query);
 
   if (nodeset.size() < index + 1) {
     throw ValueError("Index exceeds number of nodes in query: " + query);
@@ -136,4 +148,55 @@ InfileTree* InfileTree::SubTree(std::string query, int index) {
   return qe_child;
 }
 
+std::vector<InfileTree*> InfileTree::SubTrees(std::string query) {
+  int n = NMatches(query);
+  std::vector<InfileTree*> children;
+  children.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    children.push_back(SubTree(query, i));
+  }
+  return children;
+}
+
+std::vector<std::vector<std::string> > InfileTree::GetStrings(
+    std::string query, const std::vector<std::string>& fields) {
+  using xmlpp::Element;
+  using xmlpp::Node;
+  using xmlpp::TextNode;
+  const std::vector<Node*>& nodeset = Find(query);
+  std::vector<std::vector<std::string> > rows(nodeset.size());
+  for (int i = 0; i < nodeset.size(); ++i) {
+    std::vector<std::string>& row = rows[i];
+    row.resize(fields.size());
+    std::vector<bool> found(fields.size(), false);
+    const Node::NodeList children = nodeset[i]->get_children();
+    Node::NodeList::const_iterator it;
+    for (it = children.begin(); it != children.end(); ++it) {
+      const Element* element = dynamic_cast<const Element*>(*it);
+      if (!element) {
+        continue;
+      }
+      std::string name = element->get_name();
+      for (int j = 0; j < fields.size(); ++j) {
+        if (found[j] || fields[j] != name) {
+          continue;
+        }
+        const TextNode* text = element->get_child_text();
+        if (text != NULL) {
+          row[j] = text->get_content();
+        }
+        found[j] = true;
+        break;
+      }
+    }
+    for (int j = 0; j < fields.size(); ++j) {
+      if (!found[j]) {
+        throw KeyError("Could not find a node by the name: " + query + "/" +
+                       fields[j]);
+      }
+    }
+  }
+  return rows;
+}
+
 }  // namespace cyclus
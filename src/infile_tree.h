@@ -1,6 +1,7 @@
 #ifndef CYCLUS_SRC_INFILE_TREE_H_
 #define CYCLUS_SRC_INFILE_TREE_H_
 
+#include <map>
 #include <string>
 #include <vector>
 #include <set>
@@ -53,6 +54,23 @@ class InfileTree {
   /// @return a initialized infile based on the query and index
   InfileTree* SubTree(std::string query, int index = 0);
 
+  /// populates a child infile for every element matching a query, in
+  /// document order. This is equivalent to calling SubTree(query, i) for each
+  /// i < NMatches(query), but evaluates the query only once.
+  /// @param query the query
+  /// @return the initialized infiles, owned by this infile
+  std::vector<InfileTree*> SubTrees(std::string query);
+
+  /// returns, for every element matching a query in document order, the
+  /// content of each of its named child elements. The children of each match
+  /// are read in a single pass, rather than by one query per field.
+  /// @param query the query
+  /// @param fields the names of the child elements to read
+  /// @return a row with one value per field for each match
+  /// @throws KeyError if a match lacks one of the fields
+  virtual std::vector<std::vector<std::string> > GetStrings(
+      std::string query, const std::vector<std::string>& fields);
+
  protected:
   /// constructor given a node
   /// @param node the node to set as the current node
@@ -69,9 +87,16 @@ class InfileTree {
   /// @param node the new current node
   void SetCurrentNode(xmlpp::Node* node);
 
+  /// returns the nodes matching a query from the current node. Each query is
+  /// evaluated once per node and its result reused, so that loops over the
+  /// matches of a query take linear rather than quadratic time.
+  /// @param query the query
+  const std::vector<xmlpp::Node*>& Find(const std::string& query);
+
  private:
   std::set<InfileTree*> spawned_children_;
   xmlpp::Node* current_node_;
+  std::map<std::string, std::vector<xmlpp::Node*> > matches_;
 };
 
 /// @brief a query method for required parameters
@@ -1,10 +1,13 @@
 #ifndef CYCLUS_SRC_INTRUSIVE_BASE_H_
 #define CYCLUS_SRC_INTRUSIVE_BASE_H_
 
+#include <atomic>
+
 #include <boost/intrusive_ptr.hpp>
 #include <boost/assert.hpp>
 
 #include "logger.h"
+#include "platform.h"
 
 namespace cyclus {
 
@@ -42,18 +45,25 @@ namespace cyclus {
 /// // don't worry about deallocation - it will be automatic.
 /// }
 /// @endcode
+///
+/// Reference counts are atomic, so that objects may be shared between the
+/// threads that run agents in parallel (see Timer::threads). Builds
+/// configured with CYCLUS_ATOMIC_REFCOUNT off count with plain integers
+/// instead and run everything on one thread.
 template <class Derived> class IntrusiveBase {
   /// used by boost::intrusive_ptr to increase object's reference count
   friend void intrusive_ptr_add_ref(const Derived* p) {
     BOOST_ASSERT(p);
-    ++((const IntrusiveBase*) p)->counter_;
+    ((const IntrusiveBase*) p)->counter_.fetch_add(
+        1, std::memory_order_relaxed);
   }
 
   /// used by boost::intrusive_ptr to decrease object's reference count
   /// and deallocate the object if the ref count is zero.
   friend void intrusive_ptr_release(const Derived* p) {
     BOOST_ASSERT(p);
-    if (--((const IntrusiveBase*) p)->counter_ == 0) {
+    if (((const IntrusiveBase*) p)->counter_.fetch_sub(
+            1, std::memory_order_acq_rel) == 1) {
       delete p;
     }
   }
@@ -71,9 +81,55 @@ template <class Derived> class IntrusiveBase {
     return *this;
   }
 
+  /// Takes a reference to the object unless it has none left, i.e., unless
+  /// its last one is being released, returning whether it did. This lets a
+  /// cache that holds objects without a reference to them, and that objects
+  /// remove themselves from when they are destroyed, hand them out safely.
+  bool TryAddRef() const {
+    unsigned long n = counter_.load(std::memory_order_relaxed);
+    while (n != 0) {
+      if (counter_.compare_exchange_weak(n, n + 1, std::memory_order_acq_rel))
+        return true;
+    }
+    return false;
+  }
+
  private:
+#if CYCLUS_ATOMIC_REFCOUNT
+  typedef std::atomic<unsigned long> Counter;
+#else
+  /// a plain count with the interface of the atomic one used above
+  class Counter {
+   public:
+    Counter(unsigned long n) : n_(n) {}
+    unsigned long load(std::memory_order) const { return n_; }
+    unsigned long fetch_add(unsigned long d, std::memory_order) {
+      unsigned long n = n_;
+      n_ += d;
+      return n;
+    }
+    unsigned long fetch_sub(unsigned long d, std::memory_order) {
+      unsigned long n = n_;
+      n_ -= d;
+      return n;
+    }
+    bool compare_exchange_weak(unsigned long& expected, unsigned long desired,
+                               std::memory_order) {
+      if (n_ != expected) {
+        expected = n_;
+        return false;
+      }
+      n_ = desired;
+      return true;
+    }
+
+   private:
+    unsigned long n_;
+  };
+#endif
+
   /// tracks an object's reference count
-  mutable unsigned long counter_;
+  mutable Counter counter_;
 };
 
 }  // namespace cyclus
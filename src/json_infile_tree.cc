@@ -0,0 +1,642 @@
+// Implements an infile tree that reads JSON documents in place
+#include "json_infile_tree.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <set>
+#include <sstream>
+
+#include <boost/algorithm/string.hpp>
+
+#include "error.h"
+#include "pyne.h"
+
+namespace cyclus {
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+JsonInfileTree::JsonInfileTree(const std::string& s)
+    : JsonInfileTree(Parse(s)) {}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+JsonInfileTree::JsonInfileTree(boost::shared_ptr<const Json::Value> doc)
+    : InfileTree(static_cast<xmlpp::Node*>(NULL)),
+      doc_(doc) {
+  std::vector<Element> roots;
+  Children(Element("", doc_.get()), &roots);
+  if (roots.size() != 1) {
+    throw ValidationError("JSON input must have exactly one root element");
+  }
+  node_ = roots[0];
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+JsonInfileTree::JsonInfileTree(boost::shared_ptr<const Json::Value> doc,
+                               const Element& node)
+    : InfileTree(static_cast<xmlpp::Node*>(NULL)),
+      doc_(doc),
+      node_(node) {}
+
+JsonInfileTree::~JsonInfileTree() {}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+boost::shared_ptr<const Json::Value> JsonInfileTree::Parse(
+    const std::string& s) {
+  boost::shared_ptr<Json::Value> doc(new Json::Value());
+  Json::Reader reader;
+  if (!reader.parse(s, *doc, false)) {
+    throw ValidationError("Failed to parse JSON input:\n" +
+                          reader.getFormattedErrorMessages());
+  }
+  return doc;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void JsonInfileTree::Children(const Element& e,
+                              std::vector<Element>* children) {
+  if (!e.value->isObject()) {
+    return;
+  }
+  Json::Value::const_iterator it;
+  for (it = e.value->begin(); it != e.value->end(); ++it) {
+    Append(it.memberName(), *it, children);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void JsonInfileTree::Append(const std::string& name, const Json::Value& v,
+                            std::vector<Element>* elements) {
+  if (v.isArray() && v.size() > 0) {
+    for (Json::Value::ArrayIndex i = 0; i < v.size(); ++i) {
+      Append(name, v[i], elements);
+    }
+  } else {
+    elements->push_back(Element(name, &v));
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool JsonInfileTree::Text(const Element& e, std::string* text) {
+  const Json::Value& v = *e.value;
+  std::stringstream ss;
+  if (v.isNull() || v.isObject() || v.isArray()) {
+    return false;
+  } else if (v.isString()) {
+    ss << v.asString();
+  } else if (v.isInt()) {
+    ss << v.asInt64();
+  } else if (v.isUInt()) {
+    ss << v.asUInt64();
+  } else if (v.isDouble()) {
+    ss << v.asDouble();
+  } else if (v.isBool()) {
+    ss << v.asBool();
+  } else {
+    ss << v.asString();
+  }
+  *text = ss.str();
+  // an empty string is an element without text
+  return !text->empty();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+const std::vector<JsonInfileTree::Element>& JsonInfileTree::Find(
+    const std::string& query) {
+  std::map<std::string, std::vector<Element> >::iterator it =
+      matches_.find(query);
+  if (it != matches_.end()) {
+    return it->second;
+  }
+
+  std::vector<std::string> steps;
+  boost::split(steps, query, boost::is_any_of("/"));
+  std::vector<Element> found;
+  int start = 0;
+  if (!query.empty() && query[0] == '/') {
+    found.push_back(Element("", doc_.get()));
+    start = 1;
+  } else {
+    found.push_back(node_);
+  }
+
+  for (int i = start; i < steps.size(); ++i) {
+    const std::string& step = steps[i];
+    if (step == ".") {
+      continue;
+    } else if (step.empty() || step == ".." ||
+               step.find_first_of("[]@():") != std::string::npos) {
+      throw ValueError("Unsupported query of JSON input: " + query);
+    }
+    std::vector<Element> next;
+    for (int j = 0; j < found.size(); ++j) {
+      std::vector<Element> children;
+      Children(found[j], &children);
+      for (int k = 0; k < children.size(); ++k) {
+        if (step == "*" || children[k].name == step) {
+          next.push_back(children[k]);
+        }
+      }
+    }
+    found.swap(next);
+  }
+  return matches_.insert(std::make_pair(query, found)).first->second;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+int JsonInfileTree::NElements() {
+  std::vector<Element> children;
+  Children(node_, &children);
+  return children.size();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+std::string JsonInfileTree::GetElementName(int index) {
+  std::vector<Element> children;
+  Children(node_, &children);
+  if (children.size() < index + 1) {
+    throw ValueError("Index exceeds number of elements in node: " +
+                     node_.name);
+  }
+  return children[index].name;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+int JsonInfileTree::NMatches(std::string query) {
+  return Find(query).size();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+std::string JsonInfileTree::GetString(std::string query, int index) {
+  const std::vector<Element>& found = Find(query);
+  if (found.empty()) {
+    throw KeyError("Could not find a node by the name: " + query);
+  }
+
+  if (found.size() < index + 1) {
+    throw ValueError("Index exceeds number of nodes in query: " + query);
+  }
+
+  std::string text;
+  if (!Text(found[index], &text)) {
+    throw ValueError("Element node " + found[index].name +
+                     " has more content than expected.");
+  }
+  return text;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+std::vector<std::vector<std::string> > JsonInfileTree::GetStrings(
+    std::string query, const std::vector<std::string>& fields) {
+  const std::vector<Element>& found = Find(query);
+  std::vector<std::vector<std::string> > rows(found.size());
+  for (int i = 0; i < found.size(); ++i) {
+    std::vector<std::string>& row = rows[i];
+    row.resize(fields.size());
+    std::vector<bool> have(fields.size(), false);
+    std::vector<Element> children;
+    Children(found[i], &children);
+    for (int k = 0; k < children.size(); ++k) {
+      for (int j = 0; j < fields.size(); ++j) {
+        if (have[j] || fields[j] != children[k].name) {
+          continue;
+        }
+        Text(children[k], &row[j]);
+        have[j] = true;
+        break;
+      }
+    }
+    for (int j = 0; j < fields.size(); ++j) {
+      if (!have[j]) {
+        throw KeyError("Could not find a node by the name: " + query + "/" +
+                       fields[j]);
+      }
+    }
+  }
+  return rows;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+InfileTree* JsonInfileTree::GetEngineFromQuery(std::string query,
+                                               int index) {
+  const std::vector<Element>& found = Find(query);
+  if (found.size() < index + 1) {
+    throw ValueError("Index exceeds number of nodes in query: " + query);
+  }
+  return new JsonInfileTree(doc_, found[index]);
+}
+
+namespace {
+
+// The kinds of content of the elements of the input schema.
+enum Kind {
+  kText,
+  kUInt,
+  kPosInt,
+  kInt,
+  kDouble,
+  kBool,
+  kParent,  // elements given by the rule's children
+  kChoice,  // exactly one element given by the rule's children
+  kConfig,  // exactly one element named for an archetype
+};
+
+// A rule for the elements of a name in the input schema. Lists of rules end
+// with one whose name is NULL.
+struct Rule {
+  const char* name;
+  int min;
+  int max;  // or -1 for no limit
+  Kind kind;
+  const Rule* children;
+  const char* values;  // allowed values, separated by spaces, or NULL
+};
+
+// The master input schema, less the agent configurations, which agents
+// check as they read them.
+const Rule kFilterOpts[] = {
+  {"val", 1, -1, kUInt, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kHdf5Table[] = {
+  {"name", 1, 1, kText, NULL, NULL},
+  {"chunk_rows", 0, 1, kUInt, NULL, NULL},
+  {"deflate", 0, 1, kInt, NULL, NULL},
+  {"shuffle", 0, 1, kBool, NULL, NULL},
+  {"filter", 0, 1, kUInt, NULL, NULL},
+  {"filter_opts", 0, 1, kParent, kFilterOpts, NULL},
+  {"adaptive_width", 0, 1, kUInt, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kHdf5[] = {
+  {"chunk_rows", 0, 1, kUInt, NULL, NULL},
+  {"deflate", 0, 1, kInt, NULL, NULL},
+  {"shuffle", 0, 1, kBool, NULL, NULL},
+  {"filter", 0, 1, kUInt, NULL, NULL},
+  {"filter_opts", 0, 1, kParent, kFilterOpts, NULL},
+  {"adaptive_width", 0, 1, kUInt, NULL, NULL},
+  {"table", 0, -1, kParent, kHdf5Table, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kVals[] = {
+  {"val", 1, -1, kText, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kIndexTables[] = {
+  {"val", 0, -1, kText, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kSqlite[] = {
+  {"index_tables", 0, 1, kParent, kIndexTables, NULL},
+  {"index_on_create", 0, 1, kBool, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kSeries[] = {
+  {"name", 1, 1, kText, NULL, NULL},
+  {"mode", 1, 1, kText, NULL, "all sample sum min max mean"},
+  {"period", 0, 1, kPosInt, NULL, NULL},
+  {"by_institution", 0, 1, kBool, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kStep[] = {
+  {"start", 1, 1, kUInt, NULL, NULL},
+  {"length", 1, 1, kPosInt, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kStepSchedule[] = {
+  {"step", 1, -1, kParent, kStep, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kTimeseries[] = {
+  {"series", 1, -1, kParent, kSeries, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kGreedy[] = {
+  {"preconditioner", 0, 1, kText, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kCoin[] = {
+  {"timeout", 0, 1, kPosInt, NULL, NULL},
+  {"verbose", 0, 1, kBool, NULL, NULL},
+  {"mps", 0, 1, kBool, NULL, NULL},
+  {"threads", 0, 1, kPosInt, NULL, NULL},
+  {"time_limit", 0, 1, kDouble, NULL, NULL},
+  {"gap", 0, 1, kDouble, NULL, NULL},
+  {"presolve", 0, 1, kBool, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kMinCostFlow[] = {
+  {"timeout", 0, 1, kPosInt, NULL, NULL},
+  {"verbose", 0, 1, kBool, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kAuction[] = {
+  {"gap", 0, 1, kDouble, NULL, NULL},
+  {"threads", 0, 1, kPosInt, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kPlugin[] = {
+  {"spec", 1, 1, kText, NULL, NULL},
+  {"options", 0, 1, kText, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kSolvers[] = {
+  {"greedy", 0, 1, kParent, kGreedy, NULL},
+  {"coin-or", 0, 1, kParent, kCoin, NULL},
+  {"min-cost-flow", 0, 1, kParent, kMinCostFlow, NULL},
+  {"auction", 0, 1, kParent, kAuction, NULL},
+  {"plugin", 0, 1, kParent, kPlugin, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kSolver[] = {
+  {"config", 0, 1, kChoice, kSolvers, NULL},
+  {"allow_exclusive_orders", 0, 1, kBool, NULL, NULL},
+  {"exclusive_orders_only", 0, 1, kBool, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kControl[] = {
+  {"simhandle", 0, 1, kText, NULL, NULL},
+  {"duration", 1, 1, kUInt, NULL, NULL},
+  {"startmonth", 1, 1, kUInt, NULL, NULL},
+  {"startyear", 1, 1, kUInt, NULL, NULL},
+  {"decay", 0, 1, kText, NULL, NULL},
+  {"dt", 0, 1, kUInt, NULL, NULL},
+  {"explicit_inventory", 0, 1, kBool, NULL, NULL},
+  {"explicit_inventory_compact", 0, 1, kBool, NULL, NULL},
+  {"dre_timings", 0, 1, kBool, NULL, NULL},
+  {"dre_regions", 0, 1, kBool, NULL, NULL},
+  {"dre_coarsen", 0, 1, kText, NULL, NULL},
+  {"threads", 0, 1, kUInt, NULL, NULL},
+  {"max_trade_distance", 0, 1, kDouble, NULL, NULL},
+  {"compact_output", 0, 1, kBool, NULL, NULL},
+  {"dense_output", 0, 1, kBool, NULL, NULL},
+  {"checkpoint_steps", 0, 1, kUInt, NULL, NULL},
+  {"checkpoint_seconds", 0, 1, kDouble, NULL, NULL},
+  {"decay_transfer", 0, 1, kBool, NULL, NULL},
+  {"sparse_decay", 0, 1, kBool, NULL, NULL},
+  {"seed", 0, 1, kUInt, NULL, NULL},
+  {"step_schedule", 0, 1, kParent, kStepSchedule, NULL},
+  {"timeseries", 0, 1, kParent, kTimeseries, NULL},
+  {"record_tables", 0, 1, kParent, kVals, NULL},
+  {"skip_tables", 0, 1, kParent, kVals, NULL},
+  {"tolerance_generic", 0, 1, kDouble, NULL, NULL},
+  {"tolerance_resource", 0, 1, kDouble, NULL, NULL},
+  {"hdf5", 0, 1, kParent, kHdf5, NULL},
+  {"sqlite", 0, 1, kParent, kSqlite, NULL},
+  {"solver", 0, 1, kParent, kSolver, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kCommodity[] = {
+  {"name", 1, 1, kText, NULL, NULL},
+  {"solution_priority", 1, 1, kDouble, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kSpec[] = {
+  {"path", 0, 1, kText, NULL, NULL},
+  {"lib", 0, 1, kText, NULL, NULL},
+  {"name", 1, 1, kText, NULL, NULL},
+  {"alias", 0, 1, kText, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kArchetypes[] = {
+  {"spec", 1, -1, kParent, kSpec, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kFacility[] = {
+  {"name", 1, 1, kText, NULL, NULL},
+  {"lifetime", 0, 1, kUInt, NULL, NULL},
+  {"config", 1, 1, kConfig, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kEntry[] = {
+  {"prototype", 1, 1, kText, NULL, NULL},
+  {"number", 1, 1, kUInt, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kFacilityList[] = {
+  {"entry", 1, -1, kParent, kEntry, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kInstitution[] = {
+  {"name", 1, 1, kText, NULL, NULL},
+  {"lifetime", 0, 1, kUInt, NULL, NULL},
+  {"initialfacilitylist", 0, 1, kParent, kFacilityList, NULL},
+  {"config", 1, 1, kConfig, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kRegion[] = {
+  {"name", 1, 1, kText, NULL, NULL},
+  {"lifetime", 0, 1, kUInt, NULL, NULL},
+  {"config", 1, 1, kConfig, NULL, NULL},
+  {"institution", 1, -1, kParent, kInstitution, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kNuclide[] = {
+  {"id", 1, 1, kText, NULL, NULL},
+  {"comp", 1, 1, kDouble, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kRecipe[] = {
+  {"name", 1, 1, kText, NULL, NULL},
+  {"basis", 1, 1, kText, NULL, NULL},
+  {"nuclide", 1, -1, kParent, kNuclide, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+const Rule kSimulation[] = {
+  {"schematype", 0, 1, kText, NULL, NULL},
+  {"ui", 0, 1, kText, NULL, NULL},
+  {"control", 1, 1, kParent, kControl, NULL},
+  {"commodity", 0, -1, kParent, kCommodity, NULL},
+  {"archetypes", 1, 1, kParent, kArchetypes, NULL},
+  {"facility", 1, -1, kParent, kFacility, NULL},
+  {"region", 1, -1, kParent, kRegion, NULL},
+  {"recipe", 0, -1, kParent, kRecipe, NULL},
+  {"recipe_library", 0, -1, kText, NULL, NULL},
+  {NULL, 0, 0, kText, NULL, NULL},
+};
+
+// Whether s, which has no surrounding space, is a value of the given kind.
+bool IsKind(const std::string& s, Kind kind) {
+  if (kind == kBool) {
+    return s == "true" || s == "false" || s == "1" || s == "0";
+  } else if (kind == kDouble) {
+    char* end = NULL;
+    std::strtod(s.c_str(), &end);
+    return !s.empty() && *end == '\0';
+  } else if (kind == kText) {
+    return true;
+  }
+
+  int i = 0;
+  if (!s.empty() && (s[0] == '+' || (kind == kInt && s[0] == '-'))) {
+    i = 1;
+  }
+  if (i == s.size()) {
+    return false;
+  }
+  bool zero = true;
+  for (; i < s.size(); ++i) {
+    if (s[i] < '0' || s[i] > '9') {
+      return false;
+    }
+    zero = zero && s[i] == '0';
+  }
+  return kind != kPosInt || !zero;
+}
+
+const char* KindName(Kind kind) {
+  switch (kind) {
+    case kUInt:
+      return "a nonnegative integer";
+    case kPosInt:
+      return "a positive integer";
+    case kInt:
+      return "an integer";
+    case kDouble:
+      return "a number";
+    case kBool:
+      return "a boolean";
+    default:
+      return "text";
+  }
+}
+
+void Check(InfileTree* t, const std::string& path, const Rule* rules,
+           const std::set<std::string>& aliases);
+
+// Checks the i-th element under t matching rule r.
+void CheckElement(InfileTree* t, const std::string& path, const Rule& r,
+                  int i, const std::set<std::string>& aliases) {
+  std::string p = path + "/" + r.name;
+  if (r.kind == kParent) {
+    Check(t->SubTree(r.name, i), p, r.children, aliases);
+    return;
+  } else if (r.kind == kChoice || r.kind == kConfig) {
+    InfileTree* sub = t->SubTree(r.name, i);
+    if (sub->NElements() != 1) {
+      throw ValidationError("JSON input: " + p +
+                            " must have exactly one element");
+    }
+    std::string name = sub->GetElementName(0);
+    if (r.kind == kConfig) {
+      if (aliases.count(name) == 0) {
+        throw ValidationError("JSON input: " + p + "/" + name +
+                              " is not an archetype of the input");
+      }
+      return;
+    }
+    const Rule* c = r.children;
+    for (; c->name != NULL && name != c->name; ++c) {}
+    if (c->name == NULL) {
+      throw ValidationError("JSON input: " + p + "/" + name +
+                            " is not allowed");
+    }
+    CheckElement(sub, p, *c, 0, aliases);
+    return;
+  }
+
+  std::string s;
+  try {
+    s = t->GetString(r.name, i);
+  } catch (const Error& e) {
+    if (r.kind == kText) {
+      return;
+    }
+    throw ValidationError("JSON input: " + p + " must be " +
+                          KindName(r.kind));
+  }
+  boost::trim(s);
+  if (!IsKind(s, r.kind)) {
+    throw ValidationError("JSON input: " + p + " must be " +
+                          KindName(r.kind) + ", not '" + s + "'");
+  }
+  if (r.values != NULL) {
+    std::vector<std::string> values;
+    std::string allowed(r.values);
+    boost::split(values, allowed, boost::is_any_of(" "));
+    if (std::find(values.begin(), values.end(), s) == values.end()) {
+      throw ValidationError("JSON input: " + p + " must be one of: " +
+                            allowed);
+    }
+  }
+}
+
+// Checks the elements under t against rules.
+void Check(InfileTree* t, const std::string& path, const Rule* rules,
+           const std::set<std::string>& aliases) {
+  std::set<std::string> known;
+  for (const Rule* r = rules; r->name != NULL; ++r) {
+    known.insert(r->name);
+    int n = t->NMatches(r->name);
+    if (n < r->min) {
+      throw ValidationError("JSON input: " + path + " must have " +
+                            (r->min == 1 ? "a " : "at least one ") +
+                            r->name + " element");
+    } else if (r->max >= 0 && n > r->max) {
+      throw ValidationError("JSON input: " + path + " may have only one " +
+                            r->name + " element");
+    }
+    for (int i = 0; i < n; ++i) {
+      CheckElement(t, path, *r, i, aliases);
+    }
+  }
+
+  int n = t->NElements();
+  for (int i = 0; i < n; ++i) {
+    std::string name = t->GetElementName(i);
+    if (known.count(name) == 0) {
+      throw ValidationError("JSON input: " + path + "/" + name +
+                            " is not allowed");
+    }
+  }
+}
+
+}  // namespace
+
+void ValidateJsonInput(InfileTree* tree) {
+  if (tree->NMatches("/simulation") != 1) {
+    throw ValidationError("JSON input must have a simulation root element");
+  }
+
+  std::set<std::string> aliases;
+  std::string query = "/simulation/archetypes/spec";
+  int n = tree->NMatches(query);
+  for (int i = 0; i < n; ++i) {
+    InfileTree* spec = tree->SubTree(query, i);
+    if (spec->NMatches("alias") == 1) {
+      aliases.insert(spec->GetString("alias"));
+    } else if (spec->NMatches("name") == 1) {
+      aliases.insert(spec->GetString("name"));
+    }
+  }
+
+  Check(tree->SubTree("/simulation"), "/simulation", kSimulation, aliases);
+}
+
+}  // namespace cyclus
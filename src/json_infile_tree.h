@@ -0,0 +1,115 @@
+#ifndef CYCLUS_SRC_JSON_INFILE_TREE_H_
+#define CYCLUS_SRC_JSON_INFILE_TREE_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "infile_tree.h"
+
+namespace Json {
+class Value;
+}
+
+namespace cyclus {
+
+/// @class JsonInfileTree
+///
+/// An infile tree that reads a JSON document in place, without first
+/// converting it to XML and parsing that into a DOM. The document is read as
+/// though it were the XML that toolkit::JsonToXml makes of it: the members of
+/// an object are its child elements, in order of name, the items of an array
+/// are repeated elements named for the array's member, and scalars are text,
+/// with booleans as 1 or 0.
+///
+/// Queries are paths of element names separated by slashes, with the
+/// wildcard "*" and "." for the current element. They are relative to the
+/// current element unless they start with a slash. This is all of XPath that
+/// the input files are read with.
+class JsonInfileTree : public InfileTree {
+ public:
+  /// constructor given the text of a JSON document
+  /// @param s the JSON document
+  /// @throws ValidationError if s is not JSON or does not have exactly one
+  /// root element
+  explicit JsonInfileTree(const std::string& s);
+
+  /// constructor given a parsed JSON document, which the tree shares
+  /// @param doc the JSON document
+  /// @throws ValidationError if doc does not have exactly one root element
+  explicit JsonInfileTree(boost::shared_ptr<const Json::Value> doc);
+
+  virtual ~JsonInfileTree();
+
+  /// parses the text of a JSON document
+  /// @param s the JSON document
+  /// @throws ValidationError if s is not JSON
+  static boost::shared_ptr<const Json::Value> Parse(const std::string& s);
+
+  virtual int NElements();
+
+  virtual std::string GetElementName(int index = 0);
+
+  virtual int NMatches(std::string query);
+
+  virtual std::string GetString(std::string query, int index = 0);
+
+  virtual std::vector<std::vector<std::string> > GetStrings(
+      std::string query, const std::vector<std::string>& fields);
+
+ protected:
+  virtual InfileTree* GetEngineFromQuery(std::string query, int index);
+
+ private:
+  /// An element of the document: its name and the JSON value that is its
+  /// content.
+  struct Element {
+    Element() : value(NULL) {}
+    Element(const std::string& name, const Json::Value* value)
+        : name(name),
+          value(value) {}
+
+    std::string name;
+    const Json::Value* value;
+  };
+
+  JsonInfileTree(boost::shared_ptr<const Json::Value> doc,
+                 const Element& node);
+
+  /// appends the child elements of e to children, in document order
+  static void Children(const Element& e, std::vector<Element>* children);
+
+  /// appends the elements named name whose content is v to elements. The
+  /// items of arrays, and of arrays within them, are separate elements, but
+  /// an empty array is an element without content, as in toolkit::JsonToXml.
+  static void Append(const std::string& name, const Json::Value& v,
+                     std::vector<Element>* elements);
+
+  /// returns whether e has text content, setting text to it if so
+  static bool Text(const Element& e, std::string* text);
+
+  /// returns the elements matching a query from the current element, each
+  /// query being evaluated once per tree
+  const std::vector<Element>& Find(const std::string& query);
+
+  boost::shared_ptr<const Json::Value> doc_;
+  Element node_;
+  std::map<std::string, std::vector<Element> > matches_;
+};
+
+/// Checks that a JSON input file read by tree matches the structure that the
+/// master input schema requires of the parts of the input that the kernel
+/// reads, i.e., everything but the configuration of the agents: required
+/// elements are present, no more elements are given than allowed, no
+/// unknown elements are given, and values have the required types. Each
+/// agent configuration must name one of the archetypes of the input. Agents
+/// check their own configurations as they read them.
+/// @param tree the root of the input
+/// @throws ValidationError if the input does not match
+void ValidateJsonInput(InfileTree* tree);
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_JSON_INFILE_TREE_H_
@@ -0,0 +1,213 @@
+#include "lineage_index.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <memory>
+
+#include "datum.h"
+#include "error.h"
+#include "recorder.h"
+
+namespace cyclus {
+
+namespace {
+
+typedef std::vector<std::pair<int, int> > Pairs;
+
+void PutVarint(std::string* s, uint32_t x) {
+  while (x >= 0x80) {
+    s->push_back(static_cast<char>((x & 0x7f) | 0x80));
+    x >>= 7;
+  }
+  s->push_back(static_cast<char>(x));
+}
+
+uint32_t GetVarint(const std::string& s, size_t* pos) {
+  uint32_t x = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (*pos >= s.size())
+      throw ValueError("the lineage index has a truncated page");
+    unsigned char b = s[(*pos)++];
+    x |= static_cast<uint32_t>(b & 0x7f) << shift;
+    if ((b & 0x80) == 0)
+      return x;
+  }
+  throw ValueError("the lineage index has a corrupt page");
+}
+
+// zigzag encoding, so that small negative differences stay small
+inline uint32_t ZigZag(int x) {
+  return (static_cast<uint32_t>(x) << 1) ^ static_cast<uint32_t>(x >> 31);
+}
+
+inline int UnZigZag(uint32_t x) {
+  return static_cast<int>(x >> 1) ^ -static_cast<int>(x & 1);
+}
+
+// writes the others paired with id, starting at *i, as differences from id
+void PutRelatives(std::string* s, int id, const Pairs& pairs, size_t* i) {
+  size_t end = *i;
+  while (end < pairs.size() && pairs[end].first == id) {
+    ++end;
+  }
+  PutVarint(s, end - *i);
+  for (; *i < end; ++*i) {
+    PutVarint(s, ZigZag(pairs[*i].second - id));
+  }
+}
+
+void GetRelatives(const std::string& s, size_t* pos, int id,
+                  std::vector<int>* ids) {
+  uint32_t n = GetVarint(s, pos);
+  for (uint32_t i = 0; i < n; ++i) {
+    ids->push_back(id + UnZigZag(GetVarint(s, pos)));
+  }
+}
+
+// returns the value of a field of a row, or NULL if it has none
+const boost::spirit::hold_any* Val(Datum* d, const char* field) {
+  const Datum::Vals& vals = d->vals();
+  for (int i = 0; i < vals.size(); ++i) {
+    if (std::strcmp(vals[i].first, field) == 0)
+      return &vals[i].second;
+  }
+  return NULL;
+}
+
+void RecordPage(Recorder* rec, int page, int nres, const std::string& data) {
+  rec->NewDatum("LineageIndex")
+      ->AddVal("Page", page)
+      ->AddVal("Resources", nres)
+      ->AddVal("Data", Blob(data))
+      ->Record();
+}
+
+void Sort(Pairs* pairs) {
+  std::sort(pairs->begin(), pairs->end());
+  pairs->erase(std::unique(pairs->begin(), pairs->end()), pairs->end());
+}
+
+}  // namespace
+
+void LineageIndexer::Add(const DatumGroups::Group& rows) {
+  const std::string& title = rows.title();
+  bool compact = title == "CompactResources" ||
+                 title == "CompactTransactions";
+  bool resources = title == "Resources" || title == "CompactResources";
+  if (!resources && title != "Transactions" &&
+      title != "CompactTransactions") {
+    return;
+  }
+  const char* parents[] = {compact ? "Parent1Delta" : "Parent1",
+                           compact ? "Parent2Delta" : "Parent2"};
+
+  DatumGroups::Group::const_iterator it;
+  for (it = rows.begin(); it != rows.end(); ++it) {
+    Datum* d = *it;
+    const boost::spirit::hold_any* simid = Val(d, "SimId");
+    Edges& e = sims_[simid == NULL ? boost::uuids::uuid() :
+                     simid->cast<boost::uuids::uuid>()];
+    int id = Val(d, "ResourceId")->cast<int>();
+    if (!resources) {
+      int tid = Val(d, "TransactionId")->cast<int>();
+      e.transactions.push_back(std::make_pair(id, tid));
+      continue;
+    }
+    for (int i = 0; i < 2; ++i) {
+      const boost::spirit::hold_any* v = Val(d, parents[i]);
+      int p = v == NULL ? 0 : v->cast<int>();
+      if (p == 0)
+        continue;
+      // compact rows hold the difference of each parent from the resource
+      e.parents.push_back(std::make_pair(id, compact ? id - p : p));
+    }
+  }
+}
+
+void LineageIndexer::Write(RecBackend* back) {
+  std::map<boost::uuids::uuid, Edges>::iterator it;
+  for (it = sims_.begin(); it != sims_.end(); ++it) {
+    Pairs& parents = it->second.parents;
+    Pairs& transactions = it->second.transactions;
+    Pairs children;
+    for (int i = 0; i < parents.size(); ++i) {
+      children.push_back(std::make_pair(parents[i].second, parents[i].first));
+    }
+    Sort(&parents);
+    Sort(&children);
+    Sort(&transactions);
+
+    std::unique_ptr<Recorder> rec(it->first.is_nil() ?
+                                  new Recorder(false) :
+                                  new Recorder(it->first));
+    rec->RegisterBackend(back);
+    size_t ip = 0;
+    size_t ic = 0;
+    size_t itr = 0;
+    int page = -1;
+    int nres = 0;
+    int prev = 0;
+    std::string data;
+    while (ip < parents.size() || ic < children.size() ||
+           itr < transactions.size()) {
+      int id = INT_MAX;
+      if (ip < parents.size())
+        id = std::min(id, parents[ip].first);
+      if (ic < children.size())
+        id = std::min(id, children[ic].first);
+      if (itr < transactions.size())
+        id = std::min(id, transactions[itr].first);
+
+      if (id / kPageSize != page) {
+        if (nres > 0)
+          RecordPage(rec.get(), page, nres, data);
+        page = id / kPageSize;
+        nres = 0;
+        prev = 0;
+        data.clear();
+      }
+
+      PutVarint(&data, id - prev);
+      prev = id;
+      PutRelatives(&data, id, parents, &ip);
+      PutRelatives(&data, id, children, &ic);
+      size_t end = itr;
+      while (end < transactions.size() && transactions[end].first == id) {
+        ++end;
+      }
+      PutVarint(&data, end - itr);
+      int tprev = 0;
+      for (; itr < end; ++itr) {
+        PutVarint(&data, transactions[itr].second - tprev);
+        tprev = transactions[itr].second;
+      }
+      ++nres;
+    }
+    if (nres > 0)
+      RecordPage(rec.get(), page, nres, data);
+    rec->Flush();
+  }
+  sims_.clear();
+}
+
+void LineageIndexer::DecodePage(const Blob& data,
+                                std::map<int, LineageEntry>* entries) {
+  const std::string& s = data.str();
+  size_t pos = 0;
+  int id = 0;
+  while (pos < s.size()) {
+    id += GetVarint(s, &pos);
+    LineageEntry& e = (*entries)[id];
+    GetRelatives(s, &pos, id, &e.parents);
+    GetRelatives(s, &pos, id, &e.children);
+    uint32_t n = GetVarint(s, &pos);
+    int tid = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      tid += GetVarint(s, &pos);
+      e.transactions.push_back(tid);
+    }
+  }
+}
+
+}  // namespace cyclus
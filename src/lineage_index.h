@@ -0,0 +1,75 @@
+#ifndef CYCLUS_SRC_LINEAGE_INDEX_H_
+#define CYCLUS_SRC_LINEAGE_INDEX_H_
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+
+#include "blob.h"
+#include "rec_backend.h"
+
+namespace cyclus {
+
+/// The parents, children, and transactions of one resource in a lineage
+/// index.
+struct LineageEntry {
+  std::vector<int> parents;
+  std::vector<int> children;
+  std::vector<int> transactions;
+};
+
+/// Builds an index of the lineage of the resources of a simulation, i.e., of
+/// the resources each was made from and into and of the transactions that
+/// moved it, so that the ancestors and descendants of a resource can be
+/// found without scanning the Resources table once per generation (see
+/// QueryableBackend::Ancestors).
+///
+/// Backends that index lineage pass every group of rows they are notified of
+/// to Add, which picks out those of the Resources and Transactions tables or
+/// of their compact forms, and call Write when they are closed. The index is
+/// the LineageIndex table, with one row per page of kPageSize consecutive
+/// resource ids and simulation: its Page number, the number of Resources in
+/// it, and the Data of its entries, a compressed adjacency list. An entry
+/// holds the difference of its resource id from the last one's, then the
+/// number and the differences from the id of its parents and of its
+/// children, and the number and the differences from the previous of its
+/// transactions, all as variable length integers. A traversal thus reads only
+/// the pages of the resources it reaches.
+class LineageIndexer {
+ public:
+  /// The number of resource ids in a page.
+  static const int kPageSize = 1024;
+
+  /// Adds the resources and transactions among a group of rows to the index.
+  void Add(const DatumGroups::Group& rows);
+
+  /// Returns whether any resources or transactions were added.
+  inline bool empty() const { return sims_.empty(); }
+
+  /// Records the index to back, as the LineageIndex table of each simulation
+  /// added, and clears it.
+  void Write(RecBackend* back);
+
+  /// Decodes the entries of a page of the index into entries, by resource id.
+  static void DecodePage(const Blob& data,
+                         std::map<int, LineageEntry>* entries);
+
+ private:
+  /// the (resource, parent) and (resource, transaction) pairs of a
+  /// simulation
+  struct Edges {
+    std::vector<std::pair<int, int> > parents;
+    std::vector<std::pair<int, int> > transactions;
+  };
+
+  /// the edges of each simulation, by id, or of the nil id for rows without
+  /// one
+  std::map<boost::uuids::uuid, Edges> sims_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_LINEAGE_INDEX_H_
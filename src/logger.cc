@@ -1,9 +1,160 @@
 #include "logger.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "error.h"
 
 namespace cyclus {
 
+namespace {
+
+// Writes log lines to a file on a background thread. Lines are handed over
+// through a bounded ring buffer that many threads may push to at once
+// without locking; each cell carries a sequence number saying whether it is
+// free to be written to or holds a line to be read.
+class LogWriter {
+ public:
+  LogWriter(const std::string& sink, int capacity)
+      : sink_(sink), tail_(0), head_(0), written_(0), stop_(false) {
+    size_t n = 1;
+    while (n < static_cast<size_t>(capacity)) {
+      n <<= 1;
+    }
+    mask_ = n - 1;
+    cells_.reset(new Cell[n]);
+    for (size_t i = 0; i < n; ++i) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    owns_ = sink != "stdout" && sink != "stderr";
+    if (sink == "stdout") {
+      f_ = stdout;
+    } else if (sink == "stderr") {
+      f_ = stderr;
+    } else if ((f_ = fopen(sink.c_str(), "w")) == NULL) {
+      throw IOError("could not open log file '" + sink + "'");
+    }
+    thread_ = std::thread(&LogWriter::Run, this);
+  }
+
+  ~LogWriter() {
+    stop_ = true;
+    thread_.join();
+    if (owns_) {
+      fclose(f_);
+    }
+  }
+
+  const std::string& sink() const { return sink_; }
+
+  // Takes the contents of line, waiting while the ring is full.
+  void Push(std::string* line) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Cell* c;
+    while (true) {
+      c = &cells_[pos & mask_];
+      size_t seq = c->seq.load(std::memory_order_acquire);
+      intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (dif == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (dif < 0) {
+        std::this_thread::yield();  // full
+        pos = tail_.load(std::memory_order_relaxed);
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    c->line.swap(*line);
+    c->seq.store(pos + 1, std::memory_order_release);
+  }
+
+  void Flush() {
+    size_t n = tail_.load();
+    while (written_.load() < n) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    std::string line;
+  };
+
+  // the most lines written between flushes
+  static const int kBatch = 1024;
+
+  bool Pop(std::string* line) {
+    Cell& c = cells_[head_ & mask_];
+    if (c.seq.load(std::memory_order_acquire) != head_ + 1) {
+      return false;
+    }
+    line->swap(c.line);
+    c.seq.store(head_ + mask_ + 1, std::memory_order_release);
+    ++head_;
+    return true;
+  }
+
+  void Run() {
+    std::string line;
+    int idle = 0;
+    while (true) {
+      int n = 0;
+      while (n < kBatch && Pop(&line)) {
+        fwrite(line.data(), 1, line.size(), f_);
+        ++n;
+      }
+      if (n > 0) {
+        fflush(f_);
+        written_.store(head_);
+        idle = 0;
+        continue;
+      }
+      if (stop_) {
+        return;
+      }
+      if (++idle < 64) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+  }
+
+  std::string sink_;
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_;
+  std::atomic<size_t> tail_;
+  size_t head_;  // only touched by the writer thread
+  std::atomic<size_t> written_;
+  std::atomic<bool> stop_;
+  FILE* f_;
+  bool owns_;
+  std::thread thread_;
+};
+
+// Owns the writer of the asynchronous sink, if any, and writes its remaining
+// lines when the program exits.
+struct SinkHolder {
+  constexpr SinkHolder() : writer(NULL) {}
+  ~SinkHolder() { delete writer.exchange(NULL); }
+  std::atomic<LogWriter*> writer;
+};
+
+SinkHolder sink_holder;
+
+}  // namespace
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 std::vector<std::string> Logger::level_to_string;
 std::map<std::string, LogLevel> Logger::string_to_level;
@@ -15,30 +166,63 @@ int Logger::spc_per_lev_ = 2;
 int Logger::field_width_ = 6;
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-std::ostringstream& Logger::Get(LogLevel level, std::string prefix) {
-  int ind_level = level - LEV_INFO1;
-  if (ind_level < 0) {
-    ind_level = 0;
-  }
+std::ostringstream& Logger::Get(LogLevel level, const std::string& prefix) {
+  int ind_level = std::max<int>(level - LEV_INFO1, 0);
 
-  int prefix_len = 6;
-  prefix = prefix.substr(0, prefix_len);
-  if (prefix.length() < prefix_len) {
-    prefix = prefix + std::string(prefix_len - prefix.length(), ' ');
+  const int prefix_len = 6;
+  if (level >= 0 && level < level_to_string.size()) {
+    os << level_to_string[level];
+  } else {
+    os << ToString(level);
+  }
+  os << '(';
+  os.write(prefix.data(), std::min<int>(prefix.size(), prefix_len));
+  for (int i = prefix.size(); i < prefix_len; ++i) {
+    os.put(' ');
+  }
+  os << "):";
+  for (int i = 0; i < ind_level * spc_per_lev_; ++i) {
+    os.put(' ');
   }
-  os << ToString(level) << "(" << prefix << "):";
-  os << std::string(ind_level * spc_per_lev_, ' ');
   return os;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Logger::~Logger() {
-  os << std::endl;
+  os << '\n';
+  LogWriter* w = sink_holder.writer.load(std::memory_order_acquire);
+  if (w != NULL) {
+    std::string line = os.str();
+    w->Push(&line);
+    return;
+  }
   // fprintf used to maintain thread safety
   fprintf(stdout, "%s", os.str().c_str());
   fflush(stdout);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Logger::SetSink(const std::string& sink, int capacity) {
+  LogWriter* w = sink.empty() ? NULL : new LogWriter(sink, capacity);
+  delete sink_holder.writer.exchange(w);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+std::string Logger::Sink() {
+  LogWriter* w = sink_holder.writer.load();
+  return w == NULL ? "" : w->sink();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Logger::FlushLog() {
+  LogWriter* w = sink_holder.writer.load();
+  if (w != NULL) {
+    w->Flush();
+  } else {
+    fflush(stdout);
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Logger::Initialize() {
   Logger::AddLevel(LEV_ERROR, "LEV_ERROR");
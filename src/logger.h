@@ -16,6 +16,16 @@
 #include <vector>
 #include <map>
 
+#include "platform.h"
+
+#ifndef CYCLUS_MIN_LOG_LEVEL
+/// The least severe LogLevel that log statements are compiled in for;
+/// statements of more verbose levels compile to nothing, whatever the report
+/// level. Set with the CYCLUS_MIN_LOG_LEVEL CMake option, and defaults to
+/// keeping every level.
+#define CYCLUS_MIN_LOG_LEVEL 11
+#endif
+
 namespace cyclus {
 
 /// @def LOG(level, prefix)
@@ -29,19 +39,25 @@ namespace cyclus {
 /// identifier for the module. Prefixes longer than 6 characters will be
 /// truncated.
 ///
+/// Statements of levels more verbose than CYCLUS_MIN_LOG_LEVEL are removed
+/// at compile time, so they cost nothing in hot loops.
+///
 /// @warning do not place any state-changing expressions with this macro
 /// as they may not run if the report level excludes the specified log
 /// 'level'.
 #define LOG(level, prefix) \
-  if ((level > cyclus::Logger::ReportLevel()) | cyclus::Logger::NoAgent()) ; \
+  if ((level) > CYCLUS_MIN_LOG_LEVEL || \
+      ((level > cyclus::Logger::ReportLevel()) | cyclus::Logger::NoAgent())) ; \
   else cyclus::Logger().Get(level, prefix)
 
 #define CLOG(level) \
-  if (level > cyclus::Logger::ReportLevel()) ; \
+  if ((level) > CYCLUS_MIN_LOG_LEVEL || \
+      level > cyclus::Logger::ReportLevel()) ; \
   else cyclus::Logger().Get(level, "core")
 
 #define MLOG(level) \
-  if ((level > cyclus::Logger::ReportLevel()) | cyclus::Logger::NoMem()) ; \
+  if ((level) > CYCLUS_MIN_LOG_LEVEL || \
+      ((level > cyclus::Logger::ReportLevel()) | cyclus::Logger::NoMem())) ; \
   else cyclus::Logger().Get(level, "memory")
 
 /// @enum LogLevel
@@ -62,9 +78,19 @@ enum LogLevel {
   LEV_DEBUG5  //!< debugging information - most verbose
 };
 
+/// The default number of lines the ring buffer of an asynchronous log sink
+/// holds (see Logger::SetSink).
+static int const kLogRingSize = 8192;
+
 /// A logging tool providing finer grained control over standard output
 /// for debugging and other purposes.
 ///
+/// By default every line is written and flushed to stdout as its Logger is
+/// destroyed. A sink set with SetSink instead hands lines to a background
+/// thread through a lock-free ring buffer, and the thread writes them in
+/// batches without flushing each line, which keeps verbose runs from being
+/// bound by the console.
+///
 /// @warning do not place any state-changing expressions with the LOG
 /// macro as they may not run if the report level excludes the specified level.
 class Logger {
@@ -72,9 +98,9 @@ class Logger {
   Logger() {}
   virtual ~Logger();
 
-  /// Returns a string stream by reference that is flushed to stdout by
+  /// Returns a string stream by reference that is written to the sink by
   /// the Logger class destructor.
-  std::ostringstream& Get(LogLevel level, std::string prefix);
+  std::ostringstream& Get(LogLevel level, const std::string& prefix);
 
   /// Use to get/set the (global) log level report cutoff.
   /// @return the report level cutoff by reference
@@ -112,6 +138,25 @@ class Logger {
     no_agent = nm;
   }
 
+  /// Sets where log lines are written: "stdout" or "stderr", or the path of
+  /// a file, which is truncated. Lines are then written asynchronously, by a
+  /// background thread, through a ring buffer of capacity lines; a logging
+  /// thread only waits when the buffer is full. An empty sink restores the
+  /// default of writing each line to stdout synchronously. The lines of the
+  /// previous sink are written before it is replaced. The sink must not be
+  /// set while other threads are logging.
+  ///
+  /// Lines still in the buffer are written when the sink is replaced or the
+  /// program exits normally, and are lost if it is killed.
+  static void SetSink(const std::string& sink, int capacity = kLogRingSize);
+
+  /// Returns the asynchronous sink log lines are written to, or an empty
+  /// string if they are written to stdout synchronously.
+  static std::string Sink();
+
+  /// Waits until every line logged so far has been written and flushed.
+  static void FlushLog();
+
   /// Converts a string into a corresponding LogLevel value.
   ///
   /// For strings that do not correspond to any particular LogLevel enum value,
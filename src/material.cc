@@ -2,17 +2,34 @@
 
 #include <math.h>
 
+#include "block_pool.h"
 #include "comp_math.h"
 #include "context.h"
 #include "decayer.h"
 #include "error.h"
 #include "logger.h"
+#include "table_writer.h"
 
 namespace cyclus {
 
 const ResourceType Material::kType = "Material";
 
-Material::~Material() {}
+Material::~Material() {
+  if (swept_) {
+    std::lock_guard<std::mutex> lock(ctx_->swept_mu_);
+    ctx_->swept_.erase(this);
+  }
+}
+
+void* Material::operator new(std::size_t size) {
+  return BlockPool::Resources()->Alloc(size);
+}
+
+void Material::operator delete(void* p, std::size_t size) {
+  if (p != NULL) {
+    BlockPool::Resources()->Free(p, size);
+  }
+}
 
 Material::Ptr Material::Create(Agent* creator, double quantity,
                                Composition::Ptr c) {
@@ -28,7 +45,9 @@ Material::Ptr Material::CreateUntracked(double quantity,
 }
 
 int Material::qual_id() const {
-  return comp_->id();
+  if (ctx_ == NULL)
+    return comp_->id();
+  return ctx_->comp_interner().Intern(comp_.get());
 }
 
 const ResourceType Material::type() const {
@@ -39,16 +58,14 @@ Resource::Ptr Material::Clone() const {
   Material* m = new Material(*this);
   Resource::Ptr c(m);
   m->tracker_.DontTrack();
+  m->swept_ = false;
   return c;
 }
 
 void Material::Record(Context* ctx) const {
   // Note that no time field is needed because the resource ID changes
   // every time the resource changes - state_id by itself is already unique.
-  ctx_->NewDatum("MaterialInfo")
-      ->AddVal("ResourceId", state_id())
-      ->AddVal("PrevDecayTime", prev_decay_time_)
-      ->Record();
+  ctx_->tables().material_info.Record(state_id(), prev_decay_time_);
 
   comp_->Record(ctx);
 }
@@ -61,6 +78,15 @@ double Material::quantity() const {
   return qty_;
 }
 
+bool Material::SameComp(Composition::Ptr c0, Composition::Ptr c1) {
+  if (c0 == c1) {
+    return true;
+  }
+  const CompVec& v0 = c0->mass_vec();
+  const CompVec& v1 = c1->mass_vec();
+  return v0.nucs() == v1.nucs() && v0.vals() == v1.vals();
+}
+
 Resource::Ptr Material::ExtractRes(double qty) {
   return boost::static_pointer_cast<Resource>(ExtractQty(qty));
 }
@@ -76,12 +102,12 @@ Material::Ptr Material::ExtractComp(double qty, Composition::Ptr c,
   }
 
   // TODO: decide if ExtractComp should force lazy-decay by calling comp()
-  if (comp_ != c) {
-    CompMap v(comp_->mass());
-    compmath::Normalize(&v, qty_);
-    CompMap otherv(c->mass());
-    compmath::Normalize(&otherv, qty);
-    CompMap newv = compmath::Sub(v, otherv);
+  if (comp_ != c && !SameComp(comp_, c)) {
+    const CompVec& v = comp_->mass_vec();
+    const CompVec& otherv = c->mass_vec();
+    CompVec newv = compmath::Combine(
+        v, compmath::NormFactor(compmath::Sum(v), qty_),
+        otherv, -compmath::NormFactor(compmath::Sum(otherv), qty));
     compmath::ApplyThreshold(&newv, threshold);
     comp_ = Composition::CreateFromMass(newv);
   }
@@ -104,12 +130,16 @@ void Material::Absorb(Material::Ptr mat) {
   Composition::Ptr c0 = comp();
   Composition::Ptr c1 = mat->comp();
 
-  if (c0 != c1) {
-    CompMap v(c0->mass());
-    compmath::Normalize(&v, qty_);
-    CompMap otherv(c1->mass());
-    compmath::Normalize(&otherv, mat->qty_);
-    comp_ = Composition::CreateFromMass(compmath::Add(v, otherv));
+  if (mat->qty_ == 0 || SameComp(c0, c1)) {
+    // the composition is unchanged
+  } else if (qty_ == 0) {
+    comp_ = c1;
+  } else {
+    const CompVec& v = c0->mass_vec();
+    const CompVec& otherv = c1->mass_vec();
+    comp_ = Composition::CreateFromMass(compmath::Combine(
+        v, compmath::NormFactor(compmath::Sum(v), qty_),
+        otherv, compmath::NormFactor(compmath::Sum(otherv), mat->qty_)));
   }
 
   // Set the decay time to the value of the material that had the larger
@@ -118,6 +148,7 @@ void Material::Absorb(Material::Ptr mat) {
   // prev decay time prior to the current simulation time step.
   if (qty_ < mat->qty_) {
     prev_decay_time_ = mat->prev_decay_time_;
+    checked_time_ = -1;
   }
 
   qty_ += mat->qty_;
@@ -142,68 +173,164 @@ void Material::Transmute(Composition::Ptr c) {
 }
 
 void Material::Decay(int curr_time) {
-  if (ctx_ != NULL && ctx_->sim_info().decay == "never") {
+  int dt;
+  uint64_t secs_per_timestep;
+  bool needed = NeedsDecay(&curr_time, &dt, &secs_per_timestep);
+  checked_time_ = curr_time;
+  if (!needed) {
     return;
-  } else if (curr_time < 0 && ctx_ == NULL) {
-    throw ValueError("decay cannot use default time with NULL context");
   }
 
-  if (curr_time < 0) {
-    curr_time = ctx_->time();
+  prev_decay_time_ = curr_time; // this must go before Transmute call
+  Composition::Ptr decayed =
+      comp_->Decay(dt, secs_per_timestep, decay_transfer());
+  Transmute(decayed);
+}
+
+void Material::DecayAll(const std::vector<Material::Ptr>& mats,
+                        int curr_time) {
+  std::vector<Material*> ms(mats.size());
+  for (size_t i = 0; i < mats.size(); ++i) {
+    ms[i] = mats[i].get();
   }
+  DecayAll(ms, curr_time);
+}
 
-  int dt = curr_time - prev_decay_time_;
-  if (dt == 0) {
-    return;
+void Material::DecayAll(const std::vector<Material*>& mats, int curr_time) {
+  // gather the materials that need a decay calculation, grouped by the
+  // duration of their time steps and how their simulation decays them
+  std::map<std::pair<uint64_t, bool>, std::vector<size_t> > groups;
+  std::vector<int> times(mats.size());
+  std::vector<int> deltas(mats.size());
+  for (size_t i = 0; i < mats.size(); ++i) {
+    uint64_t secs_per_timestep;
+    times[i] = curr_time;
+    if (mats[i]->NeedsDecay(&times[i], &deltas[i], &secs_per_timestep)) {
+      groups[std::make_pair(secs_per_timestep, mats[i]->decay_transfer())]
+          .push_back(i);
+    }
+    mats[i]->checked_time_ = times[i];
   }
 
-  double eps = 1e-3;
-  const CompMap c = comp_->atom();
+  std::map<std::pair<uint64_t, bool>, std::vector<size_t> >::iterator it;
+  for (it = groups.begin(); it != groups.end(); ++it) {
+    const std::vector<size_t>& idx = it->second;
+    std::vector<Composition::Ptr> comps;
+    std::vector<int> dts;
+    comps.reserve(idx.size());
+    dts.reserve(idx.size());
+    for (size_t j = 0; j < idx.size(); ++j) {
+      comps.push_back(mats[idx[j]]->comp_);
+      dts.push_back(deltas[idx[j]]);
+    }
+    std::vector<Composition::Ptr> decayed =
+        Composition::Decay(comps, dts, it->first.first, it->first.second);
+    for (size_t j = 0; j < idx.size(); ++j) {
+      Material* m = mats[idx[j]];
+      m->prev_decay_time_ = times[idx[j]];  // this must go before Transmute
+      m->Transmute(decayed[j]);
+    }
+  }
+}
 
-  // If composition has too many nuclides (i.e. > 100), it is cheaper to
-  // just do the decay rather than check all the decay constants.
-  bool decay = c.size() > 100;
+double Material::SumMass(const std::vector<Material::Ptr>& mats,
+                         CompMap* mass) {
+  std::map<Composition::Ptr, double> qtys;
+  double tot = 0;
+  for (size_t i = 0; i < mats.size(); ++i) {
+    Material* m = mats[i].get();
+    qtys[m->PeekComp()] += m->qty_;
+    tot += m->qty_;
+  }
 
-  uint64_t secs_per_timestep = kDefaultTimeStepDur;
-  if (ctx_ != NULL) {
-    secs_per_timestep = ctx_->sim_info().dt;
-  }
-
-  if (!decay) {
-    // Only do the decay calc if one of the nuclides would change in number
-    // density more than fraction eps.
-    // i.e. decay if   (1 - eps) > exp(-lambda*dt)
-    CompMap::const_reverse_iterator it;
-    for (it = c.rbegin(); it != c.rend(); ++it) {
-      int nuc = it->first;
-      double lambda_timesteps = pyne::decay_const(nuc) * static_cast<double>(secs_per_timestep);
-      double change = 1.0 - std::exp(-lambda_timesteps * static_cast<double>(dt));
-      if (change >= eps) {
-        decay = true;
-        break;
-      }
+  std::map<Composition::Ptr, double>::iterator it;
+  for (it = qtys.begin(); it != qtys.end(); ++it) {
+    const CompVec& v = it->first->mass_vec();
+    double sum = compmath::Sum(v);
+    if (sum <= 0) {
+      continue;
     }
-    if (!decay) {
-      return;
+    double f = it->second / sum;
+    const std::vector<Nuc>& nucs = v.nucs();
+    const std::vector<double>& vals = v.vals();
+    for (size_t i = 0; i < v.size(); ++i) {
+      (*mass)[nucs[i]] += vals[i] * f;
     }
   }
+  return tot;
+}
 
-  prev_decay_time_ = curr_time; // this must go before Transmute call
-  Composition::Ptr decayed = comp_->Decay(dt, secs_per_timestep);
-  Transmute(decayed);
+double Material::DecayHeat(const std::vector<Material::Ptr>& mats) {
+  std::map<Composition::Ptr, double> qtys;
+  for (size_t i = 0; i < mats.size(); ++i) {
+    qtys[mats[i]->PeekComp()] += mats[i]->qty_;
+  }
+  double heat = 0;
+  std::map<Composition::Ptr, double>::iterator it;
+  for (it = qtys.begin(); it != qtys.end(); ++it) {
+    heat += it->second * it->first->decay_heat();
+  }
+  return heat;
 }
 
-double Material::DecayHeat() {
-  double decay_heat = 0.;
-  // Pyne decay heat operates with grams, cyclus generally in kilograms.
-  pyne::Material p_map = pyne::Material(comp_->mass(), qty_ * 1000);
-  std::map<int, double> dec_heat = p_map.decay_heat();
-  for (auto nuc : dec_heat) {
-    if (!std::isnan(nuc.second)) {
-      decay_heat += nuc.second;
+Composition::Ptr Material::PeekComp() {
+  if (ctx_ != NULL && ctx_->decay_mode() == DECAY_LAZY) {
+    int t = -1;
+    int dt;
+    uint64_t secs_per_timestep;
+    if (NeedsDecay(&t, &dt, &secs_per_timestep)) {
+      return comp_->Decay(dt, secs_per_timestep, decay_transfer());
     }
   }
-  return decay_heat;
+  return comp_;
+}
+
+bool Material::decay_transfer() const {
+  return ctx_ != NULL && ctx_->decay_transfer();
+}
+
+bool Material::NeedsDecay(int* curr_time, int* dt,
+                          uint64_t* secs_per_timestep) {
+  if (ctx_ != NULL && ctx_->decay_mode() == DECAY_NEVER) {
+    return false;
+  } else if (*curr_time < 0 && ctx_ == NULL) {
+    throw ValueError("decay cannot use default time with NULL context");
+  }
+
+  if (*curr_time < 0) {
+    *curr_time = ctx_->time();
+  }
+
+  *dt = *curr_time - prev_decay_time_;
+  if (*dt == 0) {
+    return false;
+  }
+
+  *secs_per_timestep = kDefaultTimeStepDur;
+  if (ctx_ != NULL) {
+    *secs_per_timestep = ctx_->dt();
+  }
+
+  double eps = 1e-3;
+  const CompVec& c = comp_->atom_vec();
+
+  // If composition has too many nuclides (i.e. > 100), it is cheaper to
+  // just do the decay rather than check all the decay constants.
+  if (c.size() > 100) {
+    return true;
+  }
+
+  // Only do the decay calc if one of the nuclides would change in number
+  // density more than fraction eps.
+  // i.e. decay if   (1 - eps) > exp(-lambda*dt)
+  // The change grows with lambda, so only the largest one needs checking.
+  double lambda_timesteps = comp_->max_decay_const() * static_cast<double>(*secs_per_timestep);
+  double change = 1.0 - std::exp(-lambda_timesteps * static_cast<double>(*dt));
+  return change >= eps;
+}
+
+double Material::DecayHeat() {
+  return qty_ * PeekComp()->decay_heat();
 }
 
 Composition::Ptr Material::comp() const {
@@ -212,20 +339,29 @@ Composition::Ptr Material::comp() const {
 }
 
 Composition::Ptr Material::comp() {
-  if (ctx_ != NULL && ctx_->sim_info().decay == "lazy") {
+  if (ctx_ != NULL && ctx_->decay_mode() == DECAY_LAZY &&
+      checked_time_ != ctx_->time()) {
     Decay(-1);
   }
   return comp_;
 }
 
 Material::Material(Context* ctx, double quantity, Composition::Ptr c)
-    : qty_(quantity),
+    : Resource(ctx),
+      qty_(quantity),
       comp_(c),
       tracker_(ctx, this),
       ctx_(ctx),
-      prev_decay_time_(0) {
+      prev_decay_time_(0),
+      checked_time_(-1),
+      swept_(false) {
   if (ctx != NULL) {
     prev_decay_time_ = ctx->time();
+    if (ctx->decay_sweep()) {
+      std::lock_guard<std::mutex> lock(ctx->swept_mu_);
+      ctx->swept_.insert(this);
+      swept_ = true;
+    }
   } else {
     tracker_.DontTrack();
   }
@@ -1,11 +1,14 @@
 #ifndef CYCLUS_SRC_MATERIAL_H_
 #define CYCLUS_SRC_MATERIAL_H_
 
+#include <cstddef>
 #include <list>
-#include <boost/shared_ptr.hpp>
+#include <vector>
+#include <boost/intrusive_ptr.hpp>
 
 #include "composition.h"
 #include "cyc_limits.h"
+#include "mem_usage.h"
 #include "resource.h"
 #include "res_tracker.h"
 
@@ -68,15 +71,25 @@ const double ug = kg* .000000001;
 ///   Material::Ptr mox = bucket.ExtractComp(qty, comp);
 ///   @endcode
 ///
-class Material: public Resource {
+class Material: public Resource,
+                private MemCounted<Material, MemUsage::MATERIAL> {
+  friend class Context;
   friend class SimInit;
 
  public:
-  typedef boost::shared_ptr<Material> Ptr;
+  typedef boost::intrusive_ptr<Material> Ptr;
   static const ResourceType kType;
 
   virtual ~Material();
 
+  /// Materials are allocated from a pool of same-sized blocks (see
+  /// BlockPool::Resources), so that the memory of materials absorbed or
+  /// decayed away is reused by the next ones made.
+  /// @{
+  static void* operator new(std::size_t size);
+  static void operator delete(void* p, std::size_t size);
+  /// @}
+
   /// Creates a new material resource that is "live" and tracked. creator is a
   /// pointer to the agent creating the resource (usually will be the caller's
   /// "this" pointer). All future output data recorded will be done using the
@@ -138,16 +151,41 @@ class Material: public Resource {
   /// constants are significant with respect to the time delta.
   void Decay(int curr_time);
 
+  /// Decays many materials at once, with the same result as calling
+  /// Decay(curr_time) on each of them. Materials sharing a composition and
+  /// time delta are decayed with a single calculation, and each decay matrix
+  /// is built only once per distinct time delta.
+  static void DecayAll(const std::vector<Ptr>& mats, int curr_time = -1);
+  static void DecayAll(const std::vector<Material*>& mats,
+                       int curr_time = -1);
+
+  /// Returns the total quantity of mats and adds the mass of each nuclide
+  /// in them, in kg, to mass. With lazy decay, compositions are decayed to
+  /// the current time as comp() would, but the materials are left unchanged
+  /// and nothing is recorded. Quantities of materials sharing a composition
+  /// are added up first, so that each distinct composition is walked once.
+  static double SumMass(const std::vector<Ptr>& mats, CompMap* mass);
+
   /// Returns the last time step on which a decay calculation was performed
   /// for the material.  This is not necessarily synonymous with the last time
   /// step the material's Decay function was called.
   int prev_decay_time() { return prev_decay_time_; }
 
   /// Returns a double with the decay heat of the material in units of
-  /// W/kg.
+  /// W/kg. The decay heat per kg is cached on the composition (see
+  /// Composition::decay_heat), so that it is computed once for all the
+  /// materials sharing it. With lazy decay, the composition is decayed to the
+  /// current time as SumMass does.
   double DecayHeat();
 
-  /// Returns the nuclide composition of this material.
+  /// Returns the total decay heat of mats, as the sum of their DecayHeat,
+  /// adding up the quantities of materials sharing a composition first.
+  static double DecayHeat(const std::vector<Ptr>& mats);
+
+  /// Returns the nuclide composition of this material. In lazy decay mode,
+  /// the composition is first decayed to the current time, which is checked
+  /// only on the first call of each time step; later calls in the same time
+  /// step return it as it is.
   Composition::Ptr comp();
 
   /// DEPRECATED - use non-const comp() function.
@@ -157,10 +195,36 @@ class Material: public Resource {
   Material(Context* ctx, double quantity, Composition::Ptr c);
 
  private:
+  /// Returns true if a decay calculation is needed for Decay(curr_time), in
+  /// which case curr_time is resolved to the time to decay to, and dt and
+  /// secs_per_timestep are set to the time delta of the decay.
+  bool NeedsDecay(int* curr_time, int* dt, uint64_t* secs_per_timestep);
+
+  /// Returns true if the material's decays use the DecayTransfer matrices, as
+  /// set for the simulation of its context.
+  bool decay_transfer() const;
+
+  /// Returns the composition decayed to the current time, as comp() would
+  /// with lazy decay, but without changing the material or recording
+  /// anything. Otherwise returns comp_ as it is.
+  Composition::Ptr PeekComp();
+
+  /// Returns true if c0 and c1 are the same composition or hold identical
+  /// mass compositions, so that mixing them needs no composition arithmetic.
+  static bool SameComp(Composition::Ptr c0, Composition::Ptr c1);
+
   Context* ctx_;
   double qty_;
   Composition::Ptr comp_;
   int prev_decay_time_;
+
+  /// the time the composition was last brought up to date, whether or not
+  /// that needed a decay calculation
+  int checked_time_;
+
+  /// whether the material is registered with its context to be swept (see
+  /// Context::decay_sweep)
+  bool swept_;
   ResTracker tracker_;
 };
 
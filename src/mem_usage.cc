@@ -0,0 +1,119 @@
+#include "mem_usage.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#if !_WIN32
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "context.h"
+
+namespace cyclus {
+
+std::atomic<bool> MemUsage::enabled_(false);
+std::atomic<int64_t> MemUsage::counts_[NUM_KINDS];
+std::atomic<int64_t> MemUsage::bytes_[NUM_KINDS];
+std::atomic<int64_t> MemUsage::peak_counts_[NUM_KINDS];
+std::atomic<int64_t> MemUsage::peak_bytes_[NUM_KINDS];
+
+namespace {
+
+void RaisePeak(std::atomic<int64_t>* peak, int64_t v) {
+  int64_t p = peak->load(std::memory_order_relaxed);
+  while (v > p &&
+         !peak->compare_exchange_weak(p, v, std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+void MemUsage::Count(Kind k, int64_t n, int64_t bytes) {
+  int64_t c = counts_[k].fetch_add(n, std::memory_order_relaxed) + n;
+  int64_t b = bytes_[k].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  if (n > 0) {
+    RaisePeak(&peak_counts_[k], c);
+    RaisePeak(&peak_bytes_[k], b);
+  }
+}
+
+const char* MemUsage::KindName(Kind k) {
+  static const char* names[NUM_KINDS] = {
+      "Composition", "Material", "Product", "Datum", "ExchangeNode", "Arc",
+      "Agent"};
+  return names[k];
+}
+
+MemUsage::Counts MemUsage::Get(Kind k) {
+  Counts c;
+  // objects created while counting was off make counts low, never negative
+  c.count = std::max<int64_t>(counts_[k].load(), 0);
+  c.bytes = std::max<int64_t>(bytes_[k].load(), 0);
+  c.peak_count = std::max(c.count, peak_counts_[k].load());
+  c.peak_bytes = std::max(c.bytes, peak_bytes_[k].load());
+  return c;
+}
+
+int64_t MemUsage::ResidentBytes() {
+#if defined(__linux__)
+  FILE* f = fopen("/proc/self/statm", "r");
+  if (f == NULL) {
+    return 0;
+  }
+  long size = 0;
+  long resident = 0;
+  int n = fscanf(f, "%ld %ld", &size, &resident);
+  fclose(f);
+  return n == 2 ? static_cast<int64_t>(resident) * sysconf(_SC_PAGESIZE) : 0;
+#elif !_WIN32
+  // the peak, which is the best there is without platform specific calls
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  return usage.ru_maxrss;
+#else
+  return static_cast<int64_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+  return 0;
+#endif
+}
+
+void MemUsage::Record(Context* ctx) {
+  for (int k = 0; k < NUM_KINDS; ++k) {
+    Counts c = Get(static_cast<Kind>(k));
+    ctx->NewDatum("MemoryUsage")
+        ->AddVal("Time", ctx->time())
+        ->AddVal("Kind", std::string(KindName(static_cast<Kind>(k))))
+        ->AddVal("Count", static_cast<int>(c.count))
+        ->AddVal("Bytes", static_cast<double>(c.bytes))
+        ->AddVal("PeakCount", static_cast<int>(c.peak_count))
+        ->AddVal("PeakBytes", static_cast<double>(c.peak_bytes))
+        ->Record();
+    peak_counts_[k] = c.count;
+    peak_bytes_[k] = c.bytes;
+  }
+  int64_t rss = ResidentBytes();
+  ctx->NewDatum("MemoryUsage")
+      ->AddVal("Time", ctx->time())
+      ->AddVal("Kind", std::string("Process"))
+      ->AddVal("Count", 1)
+      ->AddVal("Bytes", static_cast<double>(rss))
+      ->AddVal("PeakCount", 1)
+      ->AddVal("PeakBytes", static_cast<double>(rss))
+      ->Record();
+}
+
+void MemUsage::Reset() {
+  for (int k = 0; k < NUM_KINDS; ++k) {
+    counts_[k] = 0;
+    bytes_[k] = 0;
+    peak_counts_[k] = 0;
+    peak_bytes_[k] = 0;
+  }
+}
+
+}  // namespace cyclus
@@ -0,0 +1,102 @@
+#ifndef CYCLUS_SRC_MEM_USAGE_H_
+#define CYCLUS_SRC_MEM_USAGE_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace cyclus {
+
+class Context;
+
+/// Counts the live objects of the kinds that dominate the memory of large
+/// simulations, and their approximate bytes, so that the subsystem holding
+/// the memory of a run can be told. The bytes are the sizes of the objects
+/// themselves, not of what they own on the heap, e.g. the nuclide maps of a
+/// composition. The process's resident memory is recorded alongside, for
+/// scale.
+///
+/// Counting is off by default, when it costs a branch per construction and
+/// destruction. It should be turned on before the simulation's objects are
+/// created (see Context::sample_memory), since objects that were created
+/// while it was off are still uncounted when they are destroyed.
+class MemUsage {
+ public:
+  /// The kinds of objects counted.
+  enum Kind {
+    COMPOSITION = 0,
+    MATERIAL,
+    PRODUCT,
+    DATUM,
+    EXCHANGE_NODE,
+    ARC,
+    AGENT,
+    NUM_KINDS,
+  };
+
+  /// The live objects of a kind, and the most that were live at once since
+  /// the last time they were recorded.
+  struct Counts {
+    int64_t count;
+    int64_t bytes;
+    int64_t peak_count;
+    int64_t peak_bytes;
+  };
+
+  /// Returns whether objects are counted.
+  static inline bool enabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  /// Turns counting on or off.
+  static void enabled(bool on) { enabled_ = on; }
+
+  /// Adds n objects of a kind taking bytes bytes, if counting. Both may be
+  /// negative.
+  static inline void Add(Kind k, int64_t n, int64_t bytes) {
+    if (enabled()) {
+      Count(k, n, bytes);
+    }
+  }
+
+  /// Returns the name of a kind, as recorded.
+  static const char* KindName(Kind k);
+
+  /// Returns the counts of a kind.
+  static Counts Get(Kind k);
+
+  /// Returns the resident memory of the process, in bytes, or 0 where it
+  /// can't be found.
+  static int64_t ResidentBytes();
+
+  /// Records the counts of every kind, and the resident memory of the
+  /// process as the "Process" kind, to the MemoryUsage table at the current
+  /// time step, and starts the peaks afresh.
+  static void Record(Context* ctx);
+
+  /// Sets every count to zero.
+  static void Reset();
+
+ private:
+  static void Count(Kind k, int64_t n, int64_t bytes);
+
+  static std::atomic<bool> enabled_;
+  static std::atomic<int64_t> counts_[NUM_KINDS];
+  static std::atomic<int64_t> bytes_[NUM_KINDS];
+  static std::atomic<int64_t> peak_counts_[NUM_KINDS];
+  static std::atomic<int64_t> peak_bytes_[NUM_KINDS];
+};
+
+/// A base class that counts the live objects of the class T deriving from
+/// it as kind K, at no cost in size.
+template <class T, MemUsage::Kind K>
+class MemCounted {
+ protected:
+  MemCounted() { MemUsage::Add(K, 1, sizeof(T)); }
+  MemCounted(const MemCounted&) { MemUsage::Add(K, 1, sizeof(T)); }
+  ~MemCounted() { MemUsage::Add(K, -1, -static_cast<int64_t>(sizeof(T))); }
+  MemCounted& operator=(const MemCounted&) { return *this; }
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_MEM_USAGE_H_
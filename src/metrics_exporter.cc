@@ -0,0 +1,251 @@
+#include "metrics_exporter.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#if !_WIN32
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include "context.h"
+#include "error.h"
+#include "logger.h"
+#include "mem_usage.h"
+#include "recorder.h"
+
+namespace cyclus {
+
+namespace {
+
+// the number of time steps that the steps per second are averaged over
+const int kRateSteps = 16;
+
+// how long the serving thread waits for a connection before checking whether
+// to stop, in milliseconds
+const int kPollMillis = 200;
+
+#if defined(MSG_NOSIGNAL)
+// closed connections mustn't kill the process with SIGPIPE
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0;
+#endif
+
+void Metric(std::ostream& out, const char* name, const char* type,
+            const char* help, double value) {
+  bool counter = std::strcmp(type, "counter") == 0;
+  out << "# TYPE " << name << " " << type << "\n"
+      << "# HELP " << name << " " << help << "\n"
+      << name << (counter ? "_total " : " ") << value << "\n";
+}
+
+}  // namespace
+
+MetricsExporter::MetricsExporter(Context* ctx, Recorder* rec, int port)
+    : ctx_(ctx),
+      rec_(rec),
+      fd_(-1),
+      port_(port),
+      stop_(false),
+      trans_start_(0),
+      time_(0),
+      steps_(0),
+      dre_secs_(0),
+      dre_secs_total_(0),
+      trades_(0),
+      trades_total_(0),
+      queue_depth_(0) {
+#if _WIN32
+  throw IOError("the metrics exporter needs POSIX sockets");
+#else
+  fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd_ < 0) {
+    throw IOError(std::string("could not open the metrics socket: ") +
+                  std::strerror(errno));
+  }
+  int yes = 1;
+  setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  struct sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  socklen_t len = sizeof(addr);
+  if (bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), len) != 0 ||
+      listen(fd_, 8) != 0 ||
+      getsockname(fd_, reinterpret_cast<struct sockaddr*>(&addr), &len) != 0) {
+    std::string err = std::strerror(errno);
+    close(fd_);
+    std::stringstream ss;
+    ss << "could not serve metrics on port " << port << ": " << err;
+    throw IOError(ss.str());
+  }
+  port_ = ntohs(addr.sin_port);
+  trans_start_ = ctx_->ntransactions();
+  ctx_->RegisterObserver(this);
+  thread_ = std::thread(&MetricsExporter::Serve, this);
+  CLOG(LEV_INFO1) << "Serving metrics on port " << port_;
+#endif
+}
+
+MetricsExporter::~MetricsExporter() {
+  ctx_->UnregisterObserver(this);
+#if !_WIN32
+  stop_ = true;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+#endif
+}
+
+void MetricsExporter::OnStepBegin(Context* ctx, int time) {
+  trans_start_ = ctx->ntransactions();
+}
+
+void MetricsExporter::OnPhaseEnd(Context* ctx, int time, const char* phase,
+                                 double secs) {
+  if (std::strcmp(phase, "ResourceExchange") != 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mu_);
+  dre_secs_ = secs;
+  dre_secs_total_ += secs;
+}
+
+void MetricsExporter::OnStepEnd(Context* ctx, int time) {
+  int trades = ctx->ntransactions() - trans_start_;
+  uint64_t depth = rec_->queue_depth();
+  Clock::time_point now = Clock::now();
+  std::lock_guard<std::mutex> lock(mu_);
+  time_ = time;
+  steps_++;
+  trades_ = trades;
+  trades_total_ += trades;
+  queue_depth_ = depth;
+  step_ends_.push_back(now);
+  if (step_ends_.size() > kRateSteps) {
+    step_ends_.pop_front();
+  }
+}
+
+std::string MetricsExporter::Render() {
+  std::stringstream out;
+  out.precision(15);
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    double rate = 0;
+    if (step_ends_.size() > 1) {
+      double secs = std::chrono::duration<double>(step_ends_.back() -
+                                                  step_ends_.front()).count();
+      rate = secs > 0 ? (step_ends_.size() - 1) / secs : 0;
+    }
+    Metric(out, "cyclus_time_step", "gauge", "The last time step run.",
+           time_);
+    Metric(out, "cyclus_steps", "counter", "The time steps run.", steps_);
+    Metric(out, "cyclus_steps_per_second", "gauge",
+           "The time steps run per second, over the last few steps.", rate);
+    Metric(out, "cyclus_step_dre_seconds", "gauge",
+           "The seconds the last resource exchange took.", dre_secs_);
+    Metric(out, "cyclus_dre_seconds", "counter",
+           "The seconds all resource exchanges took.", dre_secs_total_);
+    Metric(out, "cyclus_step_trades", "gauge",
+           "The trades made in the last time step.", trades_);
+    Metric(out, "cyclus_trades", "counter", "The trades made.",
+           trades_total_);
+    Metric(out, "cyclus_recorder_queue_depth", "gauge",
+           "The rows recorded but not yet written at the end of the last "
+           "time step.", queue_depth_);
+  }
+  Metric(out, "cyclus_rows_written", "counter",
+         "The rows written to the output backends.", rec_->rows_written());
+  Metric(out, "cyclus_resident_memory_bytes", "gauge",
+         "The resident memory of the process.",
+         static_cast<double>(MemUsage::ResidentBytes()));
+  out << "# EOF\n";
+  return out.str();
+}
+
+void MetricsExporter::Serve() {
+#if !_WIN32
+  while (!stop_) {
+    struct pollfd pfd;
+    pfd.fd = fd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, kPollMillis) <= 0) {
+      continue;
+    }
+    int conn = accept(fd_, NULL, NULL);
+    if (conn < 0) {
+      continue;
+    }
+    try {
+      Answer(conn);
+    } catch (std::exception& e) {
+      CLOG(LEV_WARN) << "could not serve metrics: " << e.what();
+    }
+    close(conn);
+  }
+#endif
+}
+
+void MetricsExporter::Answer(int fd) {
+#if !_WIN32
+  // slow or idle clients mustn't keep others waiting
+  struct timeval timeout = {1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  // only the request line matters
+  std::string req;
+  char buf[1024];
+  while (req.find("\r\n") == std::string::npos && req.size() < 8192) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) {
+      return;
+    }
+    req.append(buf, n);
+  }
+  std::string line = req.substr(0, req.find("\r\n"));
+
+  std::string status = "200 OK";
+  std::string type = "application/openmetrics-text; version=1.0.0; "
+                     "charset=utf-8";
+  std::string body;
+  if (line.compare(0, 4, "GET ") != 0) {
+    status = "405 Method Not Allowed";
+    type = "text/plain";
+  } else if (line.compare(4, 9, "/metrics ") != 0 &&
+             line.compare(4, 9, "/metrics?") != 0) {
+    status = "404 Not Found";
+    type = "text/plain";
+    body = "metrics are served at /metrics\n";
+  } else {
+    body = Render();
+  }
+  std::stringstream resp;
+  resp << "HTTP/1.1 " << status << "\r\n"
+       << "Content-Type: " << type << "\r\n"
+       << "Content-Length: " << body.size() << "\r\n"
+       << "Connection: close\r\n\r\n"
+       << body;
+  std::string out = resp.str();
+  size_t sent = 0;
+  while (sent < out.size()) {
+    ssize_t n = send(fd, out.data() + sent, out.size() - sent, kSendFlags);
+    if (n <= 0) {
+      return;
+    }
+    sent += n;
+  }
+#endif
+}
+
+}  // namespace cyclus
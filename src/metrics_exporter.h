@@ -0,0 +1,100 @@
+#ifndef CYCLUS_SRC_METRICS_EXPORTER_H_
+#define CYCLUS_SRC_METRICS_EXPORTER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "sim_observer.h"
+
+namespace cyclus {
+
+class Context;
+class Recorder;
+
+/// Serves live metrics of a running simulation over HTTP in the OpenMetrics
+/// text format, for Prometheus and compatible scrapers to collect during
+/// long runs. The metrics are:
+///
+/// - cyclus_time_step: the last time step run
+/// - cyclus_steps_total: the time steps run
+/// - cyclus_steps_per_second: the time steps run per second, over the last
+///   few steps
+/// - cyclus_step_dre_seconds: the seconds the resource exchange of the last
+///   time step took, and cyclus_dre_seconds_total those of every step
+/// - cyclus_step_trades: the trades made in the last time step, and
+///   cyclus_trades_total those made so far
+/// - cyclus_recorder_queue_depth: the rows recorded but not yet written to
+///   the backends at the end of the last time step
+/// - cyclus_rows_written_total: the rows written to the backends
+/// - cyclus_resident_memory_bytes: the resident memory of the process
+///
+/// The exporter observes the simulation (see SimObserver) and is registered
+/// with the context for as long as it exists. The metrics are gathered on
+/// the simulation's thread at the end of each time step, which costs a few
+/// clock reads, and served from a background thread, so scrapes never hold
+/// up the simulation.
+class MetricsExporter : public SimObserver {
+ public:
+  /// Starts serving the metrics of the simulation of ctx, whose output is
+  /// recorded by rec, on the given TCP port of every network interface. Port
+  /// 0 picks a free port.
+  ///
+  /// @throws IOError if the port can't be listened on, or on platforms
+  /// without POSIX sockets
+  MetricsExporter(Context* ctx, Recorder* rec, int port);
+
+  /// Stops serving and unregisters the exporter from the context.
+  virtual ~MetricsExporter();
+
+  /// Returns the port the metrics are served on.
+  int port() const { return port_; }
+
+  /// Returns the metrics in the OpenMetrics text format.
+  std::string Render();
+
+  virtual void OnStepBegin(Context* ctx, int time);
+  virtual void OnPhaseEnd(Context* ctx, int time, const char* phase,
+                          double secs);
+  virtual void OnStepEnd(Context* ctx, int time);
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  /// accepts connections and answers them until stop_ is set.
+  void Serve();
+
+  /// answers a request on the connection fd.
+  void Answer(int fd);
+
+  Context* ctx_;
+  Recorder* rec_;
+  int fd_;
+  int port_;
+  std::atomic<bool> stop_;
+  std::thread thread_;
+
+  /// the transactions made before the current time step began
+  int trans_start_;
+
+  /// guards the metrics below, which are read by the serving thread.
+  std::mutex mu_;
+  int time_;
+  uint64_t steps_;
+  double dre_secs_;
+  double dre_secs_total_;
+  int trades_;
+  uint64_t trades_total_;
+  uint64_t queue_depth_;
+
+  /// the times the last few time steps ended, oldest first
+  std::deque<Clock::time_point> step_ends_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_METRICS_EXPORTER_H_
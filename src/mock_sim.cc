@@ -3,6 +3,8 @@
 #include "cyclus.h"
 #include "sim_init.h"
 #include "pyhooks.h"
+#include <algorithm>
+#include <chrono>
 #include <sstream>
 
 namespace cyclus {
@@ -33,6 +35,82 @@ void InitAgent(Agent* a, std::stringstream& config, Recorder* rec,
   a->InitFrom(&pi);
 }
 
+namespace {
+
+/// the phases of a time step, in the order they run in
+const char* kPhases[] = {"Build", "Tick", "ResourceExchange", "Tock",
+                         "Decision", "Decom"};
+const int kNumPhases = sizeof(kPhases) / sizeof(kPhases[0]);
+
+/// Adds up the time of each phase of the time steps of a benchmark.
+class PhaseTimer : public SimObserver {
+ public:
+  explicit PhaseTimer(MockBenchmark* b) : b_(b) {}
+
+  virtual void OnStepBegin(Context* ctx, int time) { b_->steps++; }
+
+  virtual void OnPhaseEnd(Context* ctx, int time, const char* phase,
+                          double secs) {
+    MockBenchmark::Timing& t = b_->phases[phase];
+    t.calls++;
+    t.secs += secs;
+  }
+
+ private:
+  MockBenchmark* b_;
+};
+
+}  // namespace
+
+///////// MockBenchmark ////////////
+
+void MockBenchmark::Write(std::ostream& out) const {
+  out << "agent " << agent_id << "\n";
+  out << "steps " << steps << "\n";
+  out << "wall " << wall_secs << "\n";
+
+  std::map<std::string, Timing> ph = phases;
+  for (int i = 0; i < kNumPhases; ++i) {
+    const Timing& t = ph[kPhases[i]];
+    out << "phase " << kPhases[i] << " " << t.calls << " " << t.secs << "\n";
+    ph.erase(kPhases[i]);
+  }
+  std::map<std::string, Timing>::const_iterator it;
+  for (it = ph.begin(); it != ph.end(); ++it) {
+    out << "phase " << it->first << " " << it->second.calls << " "
+        << it->second.secs << "\n";
+  }
+
+  for (int c = 0; c < AgentProfiler::NUM_CALLS; ++c) {
+    const char* name =
+        AgentProfiler::CallName(static_cast<AgentProfiler::Call>(c));
+    Timing t;
+    if (callbacks.count(name) > 0) {
+      t = callbacks.at(name);
+    }
+    out << "callback " << name << " " << t.calls << " " << t.secs << "\n";
+  }
+
+  for (int k = 0; k < MemUsage::NUM_KINDS; ++k) {
+    const char* name = MemUsage::KindName(static_cast<MemUsage::Kind>(k));
+    int64_t count = 0;
+    int64_t bytes = 0;
+    std::map<std::string, MemUsage::Counts>::const_iterator m =
+        memory.find(name);
+    if (m != memory.end()) {
+      count = m->second.peak_count;
+      bytes = m->second.peak_bytes;
+    }
+    out << "memory " << name << " " << count << " " << bytes << "\n";
+  }
+
+  std::map<std::string, uint64_t>::const_iterator tab;
+  for (tab = tables.begin(); tab != tables.end(); ++tab) {
+    out << "table " << tab->first << " " << tab->second << "\n";
+  }
+  out << "rows " << rows << "\n";
+}
+
 ///////// MockAgent ////////////
 
 int MockAgent::nextid_ = 0;
@@ -225,6 +303,79 @@ int MockSim::Run() {
   return id;
 }
 
+MockBenchmark MockSim::Benchmark() {
+  MockBenchmark b;
+  PhaseTimer phases(&b);
+
+  bool counting = MemUsage::enabled();
+  if (!counting) {
+    MemUsage::Reset();
+    MemUsage::enabled(true);
+  }
+  MemUsage::Counts start[MemUsage::NUM_KINDS];
+  for (int k = 0; k < MemUsage::NUM_KINDS; ++k) {
+    start[k] = MemUsage::Get(static_cast<MemUsage::Kind>(k));
+  }
+  bool stats = rec_.collect_stats();
+  rec_.set_collect_stats(true);
+  std::map<std::string, TableStats> before = rec_.stats();
+  ctx_.profile_agents(true);
+  ctx_.RegisterObserver(&phases);
+
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  try {
+    b.agent_id = Run();
+  } catch (...) {
+    ctx_.UnregisterObserver(&phases);
+    ctx_.profile_agents(false);
+    rec_.set_collect_stats(stats);
+    MemUsage::enabled(counting);
+    throw;
+  }
+  b.wall_secs = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - t0).count();
+  ctx_.UnregisterObserver(&phases);
+
+  AgentProfiler* prof = ctx_.profiler();
+  std::map<std::string, AgentProfiler::Entry> entries = prof->entries();
+  std::map<std::string, AgentProfiler::Entry>::iterator e =
+      entries.find(agent->prototype());
+  if (e != entries.end()) {
+    double spt = prof->SecondsPerTick();
+    for (int c = 0; c < AgentProfiler::NUM_CALLS; ++c) {
+      MockBenchmark::Timing& t = b.callbacks[AgentProfiler::CallName(
+          static_cast<AgentProfiler::Call>(c))];
+      t.calls = e->second.totals[c].calls;
+      t.secs = e->second.totals[c].ticks * spt;
+    }
+  }
+  ctx_.profile_agents(false);
+
+  for (int k = 0; k < MemUsage::NUM_KINDS; ++k) {
+    MemUsage::Kind kind = static_cast<MemUsage::Kind>(k);
+    MemUsage::Counts c = MemUsage::Get(kind);
+    c.count -= start[k].count;
+    c.bytes -= start[k].bytes;
+    c.peak_count = std::max<int64_t>(c.peak_count - start[k].count, 0);
+    c.peak_bytes = std::max<int64_t>(c.peak_bytes - start[k].bytes, 0);
+    b.memory[MemUsage::KindName(kind)] = c;
+  }
+  MemUsage::enabled(counting);
+
+  std::map<std::string, TableStats> after = rec_.stats();
+  std::map<std::string, TableStats>::iterator it;
+  for (it = after.begin(); it != after.end(); ++it) {
+    uint64_t n = it->second.rows - before[it->first].rows;
+    if (n == 0 || it->first == "AgentProfile") {
+      continue;
+    }
+    b.tables[it->first] = n;
+    b.rows += n;
+  }
+  rec_.set_collect_stats(stats);
+  return b;
+}
+
 Material::Ptr MockSim::GetMaterial(int resid) {
   return SimInit::BuildMaterial(back_, resid);
 }
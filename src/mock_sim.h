@@ -1,7 +1,13 @@
 #ifndef CYCLUS_SRC_MOCK_SIM_H_
 #define CYCLUS_SRC_MOCK_SIM_H_
 
+#include <map>
+#include <ostream>
+#include <string>
+
+#include "agent_profiler.h"
 #include "cyclus.h"
+#include "mem_usage.h"
 #include "sqlite_back.h"
 #include "timer.h"
 
@@ -69,6 +75,71 @@ class MockAgent {
   SqliteBack* back_;
 };
 
+/// MockBenchmark holds the measurements of a mock simulation run with
+/// MockSim::Benchmark: where the time of each time step went, how long the
+/// callbacks of the agent being tested took, how many objects the run kept
+/// in memory, and how many rows it recorded.
+struct MockBenchmark {
+  /// The time of a phase or callback: how many times it ran and the seconds
+  /// it took in all.
+  struct Timing {
+    Timing() : calls(0), secs(0) {}
+    uint64_t calls;
+    double secs;
+  };
+
+  MockBenchmark() : agent_id(-1), steps(0), wall_secs(0), rows(0) {}
+
+  /// the id of the agent being tested
+  int agent_id;
+
+  /// the number of time steps run
+  int steps;
+
+  /// the seconds the whole run took
+  double wall_secs;
+
+  /// the time of each time step phase of the kernel (see
+  /// SimObserver::OnPhaseEnd), by name
+  std::map<std::string, Timing> phases;
+
+  /// the time of the agent being tested in each of its time step phases and
+  /// exchange callbacks (see AgentProfiler::Call), by name
+  std::map<std::string, Timing> callbacks;
+
+  /// the most objects of each kind that MemUsage counts that were in memory
+  /// at once during the run, above what there were when it started, by name
+  std::map<std::string, MemUsage::Counts> memory;
+
+  /// the rows recorded to each table, by name, other than the AgentProfile
+  /// rows of the callback timings
+  std::map<std::string, uint64_t> tables;
+
+  /// the rows recorded to all of the tables
+  uint64_t rows;
+
+  /// Writes the measurements as lines of whitespace separated fields, in an
+  /// order that doesn't change from run to run so that the reports of
+  /// different runs can be compared line by line:
+  ///
+  /// @code
+  /// agent <id>
+  /// steps <n>
+  /// wall <secs>
+  /// phase <name> <calls> <secs>
+  /// callback <name> <calls> <secs>
+  /// memory <kind> <peak objects> <peak bytes>
+  /// table <name> <rows>
+  /// rows <rows>
+  /// @endcode
+  ///
+  /// Phases and callbacks are written in the order they run in, memory
+  /// kinds in the order of MemUsage::Kind, and tables in order of name.
+  /// Every phase, callback and memory kind is written, even when it is
+  /// zero.
+  void Write(std::ostream& out) const;
+};
+
 /// MockSim is a helper for running full simulations entirely in-code to test
 /// archetypes/agents without having to deal with input files, output database
 /// files, and other pieces of the full Cyclus stack.  This is especially
@@ -210,6 +281,24 @@ class MockSim {
   /// use in queries.
   int Run();
 
+  /// Runs the simulation, as Run, measuring where its time goes, its memory
+  /// and its output, so that an archetype can be profiled in isolation
+  /// against the trading partners added with AddSource and AddSink. The
+  /// agents are profiled (see Context::profile_agents) and objects are
+  /// counted (see MemUsage) for the run, which makes it a little slower than
+  /// Run; both are turned off again afterwards.
+  ///
+  /// @code
+  ///
+  /// cyclus::MockSim sim(cyclus::AgentSpec(":agents:Source"), config, 1000);
+  /// for (int i = 0; i < 10; ++i) {
+  ///   sim.AddSink("enriched_u").capacity(1).Finalize();
+  /// }
+  /// sim.Benchmark().Write(std::cout);
+  ///
+  /// @endcode
+  MockBenchmark Benchmark();
+
   /// Reconstructs a material object from the simulation results database with
   /// the given resource state id.
   Material::Ptr GetMaterial(int resid);
@@ -0,0 +1,203 @@
+#include "mpi_solver.h"
+#if CYCLUS_HAS_MPI
+
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "context.h"
+#include "error.h"
+#include "exchange_graph.h"
+#include "graph_dump.h"
+#include "logger.h"
+
+namespace cyclus {
+
+namespace {
+
+// the tags of the messages from rank 0 (solve, stop) and back (result, error)
+const int kSolveTag = 1;
+const int kStopTag = 2;
+const int kResultTag = 3;
+const int kErrorTag = 4;
+
+template <class T>
+void Put(std::ostream& out, T v) {
+  out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <class T>
+T Get(std::istream& in) {
+  T v;
+  if (!in.read(reinterpret_cast<char*>(&v), sizeof(T)))
+    throw IOError("exchange solution from another rank ends early");
+  return v;
+}
+
+// Receives the next message from rank src of comm, whatever its length.
+std::string Recv(int src, MPI_Comm comm, MPI_Status* st) {
+  MPI_Probe(src, MPI_ANY_TAG, comm, st);
+  int n;
+  MPI_Get_count(st, MPI_CHAR, &n);
+  std::string msg(n, '\0');
+  MPI_Recv(&msg[0], n, MPI_CHAR, src, st->MPI_TAG, comm, MPI_STATUS_IGNORE);
+  return msg;
+}
+
+}  // namespace
+
+MpiSolver::MpiSolver(ExchangeSolver* local, MPI_Comm comm)
+    : local_(local),
+      comm_(comm) {
+  MPI_Comm_size(comm_, &size_);
+  // the components are handed out in SolveGraph
+  decompose_ = false;
+}
+
+MpiSolver::~MpiSolver() {
+  delete local_;
+}
+
+double MpiSolver::SolveGraph() {
+  local_->sim_ctx(sim_ctx_);
+  std::vector<ExchangeGraph::Ptr> comps;
+  if (size_ > 1)
+    comps = graph_->Components();
+  if (comps.empty())
+    return local_->Solve(graph_);
+
+  int n = comps.size();
+  CLOG(LEV_DEBUG1) << "Solving " << n << " independent exchange subgraphs on "
+                   << size_ << " ranks.";
+  int time = sim_ctx_ == NULL ? 0 : sim_ctx_->time();
+  std::vector<std::string> sent(n);
+  std::vector<MPI_Request> reqs;
+  reqs.reserve(n);
+  for (int i = 0; i != n; i++) {
+    int rank = i % size_;
+    if (rank == 0)
+      continue;
+    std::stringstream ss;
+    DumpGraph(ss, time, "", *comps[i]);
+    sent[i] = ss.str();
+    reqs.push_back(MPI_REQUEST_NULL);
+    MPI_Isend(&sent[i][0], sent[i].size(), MPI_CHAR, rank, kSolveTag, comm_,
+              &reqs.back());
+  }
+
+  // solve this rank's share while the others solve theirs, holding on to
+  // errors until every reply has been received, so that none is left for
+  // the next exchange
+  std::vector<double> objs(n, 0);
+  std::vector<std::exception_ptr> errs(n);
+  for (int i = 0; i < n; i += size_) {
+    try {
+      objs[i] = local_->Solve(comps[i].get());
+    } catch (...) {
+      errs[i] = std::current_exception();
+    }
+  }
+
+  // the replies from each rank arrive in the order the subgraphs were sent.
+  // They are received while the later subgraphs are still being sent, since
+  // a rank given several blocks on sending each reply before it receives its
+  // next subgraph.
+  for (int i = 0; i != n; i++) {
+    int rank = i % size_;
+    if (rank == 0)
+      continue;
+    MPI_Status st;
+    std::string msg = Recv(rank, comm_, &st);
+    try {
+      if (st.MPI_TAG == kErrorTag)
+        throw StateError("rank " + std::to_string(rank) + " failed to solve "
+                         "an exchange subgraph: " + msg);
+      std::stringstream in(msg);
+      objs[i] = Get<double>(in);
+      int32_t nmatches = Get<int32_t>(in);
+      const std::vector<Arc>& arcs = comps[i]->arcs();
+      for (int32_t j = 0; j != nmatches; j++) {
+        int32_t arc = Get<int32_t>(in);
+        double qty = Get<double>(in);
+        if (arc < 0 || arc >= arcs.size())
+          throw IOError("exchange solution from another rank is corrupt");
+        comps[i]->AddMatch(arcs[arc], qty);
+      }
+    } catch (...) {
+      errs[i] = std::current_exception();
+    }
+  }
+  MPI_Waitall(reqs.size(), &reqs[0], MPI_STATUSES_IGNORE);
+
+  // merge the solutions in component order
+  double obj = 0;
+  for (int i = 0; i != n; i++) {
+    if (errs[i])
+      std::rethrow_exception(errs[i]);
+    const std::vector<Match>& matches = comps[i]->matches();
+    for (int j = 0; j != matches.size(); j++) {
+      graph_->AddMatch(matches[j].first, matches[j].second);
+    }
+    obj += objs[i];
+  }
+  return obj;
+}
+
+void MpiSolver::Serve(ExchangeSolver* s, MPI_Comm comm) {
+  while (true) {
+    MPI_Status st;
+    std::string msg = Recv(0, comm, &st);
+    if (st.MPI_TAG == kStopTag)
+      return;
+
+    std::stringstream out;
+    int tag = kResultTag;
+    try {
+      std::stringstream in(msg);
+      int time;
+      std::string restype;
+      ExchangeGraph::Ptr g;
+      if (!LoadGraph(in, &time, &restype, &g))
+        throw IOError("empty exchange subgraph from rank 0");
+      double obj = s->Solve(g.get());
+
+      // arcs go back as their position in the graph, which rank 0 shares
+      typedef std::pair<const ExchangeNode*, const ExchangeNode*> Ends;
+      std::map<Ends, int32_t> ids;
+      const std::vector<Arc>& arcs = g->arcs();
+      for (int32_t i = 0; i != arcs.size(); i++) {
+        ids.insert(std::make_pair(
+            Ends(arcs[i].unode().get(), arcs[i].vnode().get()), i));
+      }
+      const std::vector<Match>& matches = g->matches();
+      Put<double>(out, obj);
+      Put<int32_t>(out, matches.size());
+      for (int i = 0; i != matches.size(); i++) {
+        const Arc& a = matches[i].first;
+        Put<int32_t>(out, ids[Ends(a.unode().get(), a.vnode().get())]);
+        Put<double>(out, matches[i].second);
+      }
+    } catch (std::exception& e) {
+      out.str(e.what());
+      tag = kErrorTag;
+    }
+    std::string reply = out.str();
+    MPI_Send(&reply[0], reply.size(), MPI_CHAR, 0, tag, comm);
+  }
+}
+
+void MpiSolver::Stop(MPI_Comm comm) {
+  int size;
+  MPI_Comm_size(comm, &size);
+  for (int rank = 1; rank < size; rank++) {
+    MPI_Send(NULL, 0, MPI_CHAR, rank, kStopTag, comm);
+  }
+}
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_HAS_MPI
@@ -0,0 +1,58 @@
+#ifndef CYCLUS_SRC_MPI_SOLVER_H_
+#define CYCLUS_SRC_MPI_SOLVER_H_
+
+#include "platform.h"
+#if CYCLUS_HAS_MPI
+
+#include <mpi.h>
+
+#include "exchange_solver.h"
+
+namespace cyclus {
+
+/// @class MpiSolver
+///
+/// @brief an exchange solver that spreads the independent subproblems of
+/// each exchange (see ExchangeGraph::Components) over the ranks of an MPI
+/// communicator. The simulation itself runs on rank 0, whose solver this is,
+/// while every other rank waits in Serve for subproblems to solve.
+///
+/// The subproblems are handed out round robin, rank 0 keeping its share, and
+/// are sent in the compact form of DumpGraph, i.e., as the commodities,
+/// quantities, preferences, and capacities of their requests and bids. Only
+/// the flow on each arc comes back. Graphs that cannot be split, and all
+/// graphs when there is only one rank, are solved on rank 0 by the wrapped
+/// solver.
+///
+/// @warning subproblems solved on other ranks use their own pseudo cost
+/// rather than that of the whole graph, so solvers that price unmet demand
+/// with it may trade slightly differently than they would undistributed.
+class MpiSolver : public ExchangeSolver {
+ public:
+  /// @param local the solver for the subproblems kept on rank 0, of which
+  /// the MpiSolver takes ownership
+  /// @param comm the communicator whose other ranks are serving
+  MpiSolver(ExchangeSolver* local, MPI_Comm comm);
+  virtual ~MpiSolver();
+
+  /// @brief solves the subproblems sent from rank 0 of comm with s, until
+  /// rank 0 calls Stop. Errors solving a subproblem are sent back to rank 0,
+  /// where they are thrown.
+  static void Serve(ExchangeSolver* s, MPI_Comm comm);
+
+  /// @brief tells every rank of comm that is serving to return
+  static void Stop(MPI_Comm comm);
+
+ protected:
+  virtual double SolveGraph();
+
+ private:
+  ExchangeSolver* local_;
+  MPI_Comm comm_;
+  int size_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_HAS_MPI
+#endif  // CYCLUS_SRC_MPI_SOLVER_H_
@@ -0,0 +1,246 @@
+#include "nuc_image.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+
+#if !_WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "error.h"
+#include "pyne.h"
+
+extern "C" {
+#include "cram.hpp"
+}
+
+namespace cyclus {
+
+namespace {
+
+const char kMagic[8] = {'C', 'Y', 'C', 'N', 'U', 'C', 'I', 'M'};
+const uint32_t kVersion = 1;
+
+// the image starts with this header, followed by the entries of each family,
+// all in native byte order
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t nfamilies;
+  struct {
+    uint64_t offset;
+    uint64_t count;
+  } families[NucImage::NFAMILIES];
+};
+
+bool EntryLess(const NucImage::Entry& a, const NucImage::Entry& b) {
+  return a.nuc < b.nuc || (a.nuc == b.nuc && a.child < b.child);
+}
+
+}  // namespace
+
+NucImage::NucImage(const std::string& path)
+    : data_(NULL),
+      len_(0),
+      mapped_(false) {
+#if !_WIN32
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw IOError("could not open nuclear data image " + path);
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    len_ = st.st_size;
+    data_ = mmap(NULL, len_, PROT_READ, MAP_SHARED, fd, 0);
+    if (data_ == MAP_FAILED) {
+      data_ = NULL;
+    } else {
+      mapped_ = true;
+    }
+  }
+  close(fd);
+#endif
+  if (data_ == NULL) {
+    std::ifstream f(path.c_str(), std::ios::binary | std::ios::ate);
+    if (!f)
+      throw IOError("could not open nuclear data image " + path);
+    len_ = f.tellg();
+    data_ = std::malloc(len_ > 0 ? len_ : 1);
+    f.seekg(0);
+    f.read(static_cast<char*>(data_), len_);
+  }
+
+  const Header* h = static_cast<const Header*>(data_);
+  bool valid = len_ >= sizeof(Header) &&
+               std::memcmp(h->magic, kMagic, sizeof(kMagic)) == 0 &&
+               h->version == kVersion && h->nfamilies == NFAMILIES;
+  for (int f = 0; valid && f != NFAMILIES; f++) {
+    uint64_t off = h->families[f].offset;
+    uint64_t n = h->families[f].count;
+    valid = off % sizeof(Entry) == 0 && off <= len_ &&
+            n <= (len_ - off) / sizeof(Entry);
+    if (valid) {
+      families_[f] = reinterpret_cast<const Entry*>(
+          static_cast<const char*>(data_) + off);
+      sizes_[f] = n;
+    }
+  }
+  if (!valid) {
+    Release();
+    throw IOError(path + " is not a valid nuclear data image");
+  }
+}
+
+NucImage::~NucImage() {
+  Release();
+}
+
+void NucImage::Release() {
+#if !_WIN32
+  if (mapped_) {
+    munmap(data_, len_);
+    data_ = NULL;
+  }
+#endif
+  std::free(data_);
+  data_ = NULL;
+}
+
+NucImage* NucImage::Instance() {
+  static NucImage* img = NULL;
+  static bool opened = false;
+  static std::mutex mu;
+  std::lock_guard<std::mutex> lock(mu);
+  if (!opened) {
+    opened = true;
+    std::string path = PathFor(pyne::NUC_DATA_PATH);
+    if (std::getenv("CYCLUS_NO_NUC_IMAGE") == NULL &&
+        pyne::file_exists(path)) {
+      img = new NucImage(path);
+    }
+  }
+  return img;
+}
+
+std::string NucImage::PathFor(const std::string& nuc_data) {
+  std::string::size_type dot = nuc_data.rfind('.');
+  std::string::size_type sep = nuc_data.find_last_of("/\\");
+  if (dot == std::string::npos || (sep != std::string::npos && dot < sep))
+    return nuc_data + ".img";
+  return nuc_data.substr(0, dot) + ".img";
+}
+
+std::pair<const NucImage::Entry*, const NucImage::Entry*> NucImage::Find(
+    Family f, Nuc nuc) const {
+  Entry lo = {nuc, std::numeric_limits<int32_t>::min(), 0};
+  Entry hi = {nuc, std::numeric_limits<int32_t>::max(), 0};
+  const Entry* begin = families_[f];
+  const Entry* end = begin + sizes_[f];
+  return std::make_pair(std::lower_bound(begin, end, lo, EntryLess),
+                        std::upper_bound(begin, end, hi, EntryLess));
+}
+
+bool NucImage::Get(Family f, Nuc nuc, double* val) const {
+  std::pair<const Entry*, const Entry*> r = Find(f, nuc);
+  if (r.first == r.second)
+    return false;
+  *val = r.first->val;
+  return true;
+}
+
+bool NucImage::Branches(Nuc nuc,
+                        std::vector<std::pair<Nuc, double> >* children) const {
+  // every nuclide covered has a decay constant, children or not
+  double lambda;
+  if (!Get(DECAY_CONST, nuc, &lambda))
+    return false;
+  std::pair<const Entry*, const Entry*> r = Find(BRANCH_RATIO, nuc);
+  children->clear();
+  for (const Entry* e = r.first; e != r.second; ++e) {
+    children->push_back(std::make_pair(e->child, e->val));
+  }
+  return true;
+}
+
+void NucImage::Write(const std::string& path, std::vector<Nuc> nucs) {
+  if (nucs.empty()) {
+    pyne::atomic_mass(10010000);  // loads the whole map
+    std::set<Nuc> all;
+    std::map<int, double>::iterator it;
+    for (it = pyne::atomic_mass_map.begin(); it != pyne::atomic_mass_map.end();
+         ++it) {
+      all.insert(it->first);
+    }
+    for (int i = 0; i < pyne_cram_transmute_info.n; ++i) {
+      all.insert((pyne_cram_transmute_info.nucids)[i]);
+    }
+    nucs.assign(all.begin(), all.end());
+  }
+  std::sort(nucs.begin(), nucs.end());
+  nucs.erase(std::unique(nucs.begin(), nucs.end()), nucs.end());
+
+  std::vector<Entry> fams[NFAMILIES];
+  for (int i = 0; i != nucs.size(); i++) {
+    Nuc nuc = nucs[i];
+    Entry e = {nuc, 0, pyne::atomic_mass(nuc)};
+    fams[ATOMIC_MASS].push_back(e);
+    e.val = pyne::q_val(nuc);
+    fams[Q_VAL].push_back(e);
+    // nuclides that pyne has no decay data for are left to pyne
+    std::set<int> children;
+    try {
+      e.val = pyne::decay_const(nuc);
+      children = pyne::decay_children(nuc);
+    } catch (std::exception& err) {
+      continue;
+    }
+    fams[DECAY_CONST].push_back(e);
+    std::set<int>::iterator c;
+    for (c = children.begin(); c != children.end(); ++c) {
+      Entry b = {nuc, *c, pyne::branch_ratio(nuc, *c)};
+      fams[BRANCH_RATIO].push_back(b);
+    }
+  }
+
+  Header h;
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, kMagic, sizeof(kMagic));
+  h.version = kVersion;
+  h.nfamilies = NFAMILIES;
+  uint64_t off = sizeof(Header);
+  for (int f = 0; f != NFAMILIES; f++) {
+    std::sort(fams[f].begin(), fams[f].end(), EntryLess);
+    h.families[f].offset = off;
+    h.families[f].count = fams[f].size();
+    off += fams[f].size() * sizeof(Entry);
+  }
+
+  // written beside the final path and then moved over it, so that processes
+  // mapping an older image are never shown a partial one
+  std::string tmp = path + ".tmp";
+  {
+    std::ofstream out(tmp.c_str(), std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    for (int f = 0; f != NFAMILIES; f++) {
+      if (!fams[f].empty()) {
+        out.write(reinterpret_cast<const char*>(&fams[f][0]),
+                  fams[f].size() * sizeof(Entry));
+      }
+    }
+    if (!out)
+      throw IOError("could not write nuclear data image " + tmp);
+  }
+  if (std::rename(tmp.c_str(), path.c_str()) != 0)
+    throw IOError("could not move nuclear data image to " + path);
+}
+
+}  // namespace cyclus
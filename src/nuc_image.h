@@ -0,0 +1,100 @@
+#ifndef CYCLUS_SRC_NUC_IMAGE_H_
+#define CYCLUS_SRC_NUC_IMAGE_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "composition.h"
+
+namespace cyclus {
+
+/// A read-only image of the nuclear data the kernel looks up, i.e., atomic
+/// masses, decay constants, Q values, and decay branch ratios, kept as one
+/// sorted array per kind of data in a compact binary file. The file is mapped
+/// into memory rather than read, so that opening it costs next to nothing and
+/// its pages are shared by every process using it, e.g., by the workers of a
+/// sweep, where pyne would otherwise open nuc_data.h5 and fill its maps in
+/// each one.
+///
+/// Images are made from pyne's data with Write (see the cyclus_nuc_image
+/// program, which is run at build time) and hold exactly the values pyne
+/// gives for the nuclides they cover. Lookups of other nuclides fail, so that
+/// callers fall back to pyne.
+class NucImage {
+ public:
+  /// The kinds of data held, one array each.
+  enum Family {
+    ATOMIC_MASS = 0,  ///< atomic masses in g/mol
+    DECAY_CONST,  ///< decay constants in 1/s
+    Q_VAL,  ///< energies released per decay in MeV
+    BRANCH_RATIO,  ///< branch ratios from parent to child nuclides
+    NFAMILIES
+  };
+
+  /// An entry of a family array: the value of a nuclide, or for branch ratios
+  /// the value from the nuclide to a child. Arrays are sorted by (nuc, child).
+  struct Entry {
+    int32_t nuc;
+    int32_t child;
+    double val;
+  };
+
+  /// Maps the image at path into memory.
+  ///
+  /// @throws IOError if the file cannot be opened or is not a valid image
+  explicit NucImage(const std::string& path);
+  ~NucImage();
+
+  /// Returns the image shared by the whole process, which is the one beside
+  /// the nuclear data library, i.e., pyne::NUC_DATA_PATH with its extension
+  /// replaced by ".img", or NULL if there is none. The image is opened on the
+  /// first call, and so the data path must be set before then (see
+  /// Env::SetNucDataPath). Setting the environment variable
+  /// CYCLUS_NO_NUC_IMAGE makes this always return NULL.
+  static NucImage* Instance();
+
+  /// Returns the path of the image for the nuclear data library at
+  /// nuc_data.
+  static std::string PathFor(const std::string& nuc_data);
+
+  /// Sets *val to the value of nuc in family f, which must not be
+  /// BRANCH_RATIO, returning false if the image does not cover nuc.
+  bool Get(Family f, Nuc nuc, double* val) const;
+
+  /// Sets *children to the children of nuc and the branch ratios to them, in
+  /// the order of the children, returning false if the image does not cover
+  /// nuc. Nuclides covered but without children give an empty list.
+  bool Branches(Nuc nuc, std::vector<std::pair<Nuc, double> >* children) const;
+
+  /// The number of entries in family f.
+  inline int size(Family f) const { return sizes_[f]; }
+
+  /// Writes the image of pyne's data for nucs to path, or for all nuclides
+  /// with an atomic mass in the nuclear data library and those known to the
+  /// decay solver if nucs is empty.
+  ///
+  /// @throws IOError if the file cannot be written
+  static void Write(const std::string& path,
+                    std::vector<Nuc> nucs = std::vector<Nuc>());
+
+ private:
+  /// Returns the range of entries of nuc in family f.
+  std::pair<const Entry*, const Entry*> Find(Family f, Nuc nuc) const;
+
+  /// Unmaps or frees the image.
+  void Release();
+
+  void* data_;
+  uint64_t len_;
+  /// whether data_ was mapped rather than read into memory
+  bool mapped_;
+  const Entry* families_[NFAMILIES];
+  int sizes_[NFAMILIES];
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_NUC_IMAGE_H_
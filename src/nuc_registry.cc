@@ -0,0 +1,104 @@
+#include "nuc_registry.h"
+
+#include <limits>
+
+#include "error.h"
+#include "nuc_image.h"
+#include "pyne.h"
+
+extern "C" {
+#include "cram.hpp"
+}
+
+namespace cyclus {
+
+NucRegistry::NucRegistry()
+    : size_(0),
+      masses_loaded_(false),
+      consts_loaded_(false),
+      q_vals_loaded_(false) {
+  nucs_.reserve(kCapacity);
+  masses_.reserve(kCapacity);
+  consts_.reserve(kCapacity);
+  q_vals_.reserve(kCapacity);
+  for (int i = 0; i < pyne_cram_transmute_info.n; ++i) {
+    Add((pyne_cram_transmute_info.nucids)[i]);
+  }
+}
+
+NucRegistry& NucRegistry::Instance() {
+  static NucRegistry reg;
+  return reg;
+}
+
+double NucRegistry::AtomicMassOf(Nuc nuc) {
+  double v;
+  NucImage* img = NucImage::Instance();
+  if (img != NULL && img->Get(NucImage::ATOMIC_MASS, nuc, &v))
+    return v;
+  return pyne::atomic_mass(nuc);
+}
+
+double NucRegistry::DecayConstOf(Nuc nuc) {
+  double v;
+  NucImage* img = NucImage::Instance();
+  if (img != NULL && img->Get(NucImage::DECAY_CONST, nuc, &v))
+    return v;
+  return pyne::decay_const(nuc);
+}
+
+double NucRegistry::QValOf(Nuc nuc) {
+  double v;
+  NucImage* img = NucImage::Instance();
+  if (img != NULL && img->Get(NucImage::Q_VAL, nuc, &v))
+    return v;
+  return pyne::q_val(nuc);
+}
+
+int NucRegistry::Index(Nuc nuc) {
+  int i = pyne_cram_transmute_nucid_to_i(nuc);
+  if (i >= 0)
+    return i;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unordered_map<Nuc, int>::iterator it = others_.find(nuc);
+  if (it != others_.end())
+    return it->second;
+  if (size_ == kCapacity)
+    throw ValueError("too many nuclides for the nuclide registry");
+  i = Add(nuc);
+  others_[nuc] = i;
+  return i;
+}
+
+int NucRegistry::Add(Nuc nuc) {
+  nucs_.push_back(nuc);
+  double nan = std::numeric_limits<double>::quiet_NaN();
+  masses_.push_back(masses_loaded_ ? AtomicMassOf(nuc) : nan);
+  consts_.push_back(consts_loaded_ ? DecayConstOf(nuc) : nan);
+  q_vals_.push_back(q_vals_loaded_ ? QValOf(nuc) : nan);
+  return size_++;
+}
+
+void NucRegistry::Load(std::vector<double>* data, std::atomic<bool>* loaded,
+                       Lookup lookup) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (*loaded)
+    return;
+  for (int i = 0; i < size_; ++i) {
+    (*data)[i] = lookup(nucs_[i]);
+  }
+  *loaded = true;
+}
+
+Nuc NucRegistry::Id(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unordered_map<std::string, Nuc>::iterator it = names_.find(name);
+  if (it != names_.end())
+    return it->second;
+  Nuc nuc = pyne::nucname::id(name);
+  names_[name] = nuc;
+  return nuc;
+}
+
+}  // namespace cyclus
@@ -0,0 +1,108 @@
+#ifndef CYCLUS_SRC_NUC_REGISTRY_H_
+#define CYCLUS_SRC_NUC_REGISTRY_H_
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "composition.h"
+
+namespace cyclus {
+
+/// A process-wide registry that gives every nuclide a dense integer index and
+/// keeps its nuclear data in flat arrays indexed by it, so that the kernel
+/// looks nuclear data up by array access rather than through pyne's maps and
+/// string parsing. The nuclides known to the decay solver are registered up
+/// front with their solver index; any other nuclide is given the next index the
+/// first time it is seen. Indexes are never reassigned and so may be kept by
+/// callers. Each kind of data is loaded for all registered nuclides the first
+/// time it is asked for, so that, e.g., looking up atomic masses never loads
+/// decay data. Data is taken from the nuclear data image (see NucImage) if
+/// there is one, and from pyne otherwise.
+class NucRegistry {
+ public:
+  /// The most nuclides that may be registered.
+  static const int kCapacity = 16384;
+
+  /// Returns the registry shared by the whole process.
+  static NucRegistry& Instance();
+
+  /// Returns the index of nuc, registering it if it has not been seen.
+  ///
+  /// @throws ValueError if the registry is full
+  int Index(Nuc nuc);
+
+  /// The number of nuclides registered.
+  inline int size() const { return size_; }
+
+  /// Returns the nuclide with index i.
+  inline Nuc nuc(int i) const { return nucs_[i]; }
+
+  /// Returns the atomic mass in g/mol of the nuclide with index i.
+  inline double atomic_mass(int i) {
+    if (!masses_loaded_)
+      Load(&masses_, &masses_loaded_, AtomicMassOf);
+    return masses_[i];
+  }
+
+  /// Returns the decay constant in 1/s of the nuclide with index i, which is
+  /// NaN for nuclides without decay data.
+  inline double decay_const(int i) {
+    if (!consts_loaded_)
+      Load(&consts_, &consts_loaded_, DecayConstOf);
+    return consts_[i];
+  }
+
+  /// Returns the energy released per decay in MeV of the nuclide with index
+  /// i, which is zero for nuclides without a Q value.
+  inline double q_val(int i) {
+    if (!q_vals_loaded_)
+      Load(&q_vals_, &q_vals_loaded_, QValOf);
+    return q_vals_[i];
+  }
+
+  /// Returns the atomic mass in g/mol of nuc.
+  inline double AtomicMass(Nuc nuc) { return atomic_mass(Index(nuc)); }
+
+  /// Returns the decay constant in 1/s of nuc.
+  inline double DecayConst(Nuc nuc) { return decay_const(Index(nuc)); }
+
+  /// Returns the id of the nuclide with the given name, in any form accepted by
+  /// pyne::nucname::id. Each distinct name is parsed only once.
+  Nuc Id(const std::string& name);
+
+ private:
+  typedef double (*Lookup)(Nuc);
+
+  NucRegistry();
+
+  static double AtomicMassOf(Nuc nuc);
+  static double DecayConstOf(Nuc nuc);
+  static double QValOf(Nuc nuc);
+
+  /// Looks data up for every registered nuclide.
+  void Load(std::vector<double>* data, std::atomic<bool>* loaded,
+            Lookup lookup);
+
+  /// Registers nuc with the next index; mutex_ must be held.
+  int Add(Nuc nuc);
+
+  std::mutex mutex_;
+  std::atomic<int> size_;
+  // reserved to kCapacity so that elements never move once written
+  std::vector<Nuc> nucs_;
+  std::vector<double> masses_;
+  std::vector<double> consts_;
+  std::vector<double> q_vals_;
+  std::atomic<bool> masses_loaded_;
+  std::atomic<bool> consts_loaded_;
+  std::atomic<bool> q_vals_loaded_;
+  std::unordered_map<Nuc, int> others_;
+  std::unordered_map<std::string, Nuc> names_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_NUC_REGISTRY_H_
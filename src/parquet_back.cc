@@ -0,0 +1,598 @@
+#include "parquet_back.h"
+#if CYCLUS_HAS_PARQUET
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <sstream>
+#include <typeinfo>
+
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <parquet/arrow/reader.h>
+
+#include "blob.h"
+#include "datum.h"
+#include "error.h"
+#include "logger.h"
+#include "recorder.h"
+
+namespace fs = boost::filesystem;
+
+namespace cyclus {
+
+namespace {
+
+// schema metadata key holding the DbTypes of a table's columns
+const char* kDbTypesKey = "cyclus_dbtypes";
+
+void Check(const arrow::Status& s, const std::string& what) {
+  if (!s.ok())
+    throw IOError(what + ": " + s.ToString());
+}
+
+template <typename T>
+T Unwrap(arrow::Result<T> r, const std::string& what) {
+  Check(r.status(), what);
+  return std::move(r).ValueOrDie();
+}
+
+// Converts values of type T to and from Arrow arrays, recursing into the
+// element types of containers.
+template <typename T>
+struct ArrowCodec;
+
+template <typename T, typename ArrowT, typename BuilderT, typename ArrayT>
+struct PrimitiveCodec {
+  static std::shared_ptr<arrow::DataType> type() {
+    return arrow::TypeTraits<ArrowT>::type_singleton();
+  }
+  static void Append(arrow::ArrayBuilder* b, const T& x) {
+    Check(static_cast<BuilderT*>(b)->Append(x), "appending a value");
+  }
+  static T Get(const arrow::Array& a, int64_t i) {
+    return static_cast<const ArrayT&>(a).Value(i);
+  }
+};
+
+template <>
+struct ArrowCodec<int> : PrimitiveCodec<int, arrow::Int32Type,
+                                        arrow::Int32Builder,
+                                        arrow::Int32Array> {};
+
+template <>
+struct ArrowCodec<bool> : PrimitiveCodec<bool, arrow::BooleanType,
+                                         arrow::BooleanBuilder,
+                                         arrow::BooleanArray> {};
+
+template <>
+struct ArrowCodec<float> : PrimitiveCodec<float, arrow::FloatType,
+                                          arrow::FloatBuilder,
+                                          arrow::FloatArray> {};
+
+template <>
+struct ArrowCodec<double> : PrimitiveCodec<double, arrow::DoubleType,
+                                           arrow::DoubleBuilder,
+                                           arrow::DoubleArray> {};
+
+template <>
+struct ArrowCodec<std::string> {
+  static std::shared_ptr<arrow::DataType> type() { return arrow::utf8(); }
+  static void Append(arrow::ArrayBuilder* b, const std::string& x) {
+    Check(static_cast<arrow::StringBuilder*>(b)->Append(x.data(), x.size()),
+          "appending a string");
+  }
+  static std::string Get(const arrow::Array& a, int64_t i) {
+    return static_cast<const arrow::StringArray&>(a).GetString(i);
+  }
+};
+
+template <>
+struct ArrowCodec<Blob> {
+  static std::shared_ptr<arrow::DataType> type() { return arrow::binary(); }
+  static void Append(arrow::ArrayBuilder* b, const Blob& x) {
+    const std::string& s = x.str();
+    Check(static_cast<arrow::BinaryBuilder*>(b)->Append(s.data(), s.size()),
+          "appending a blob");
+  }
+  static Blob Get(const arrow::Array& a, int64_t i) {
+    return Blob(static_cast<const arrow::BinaryArray&>(a).GetString(i));
+  }
+};
+
+template <>
+struct ArrowCodec<boost::uuids::uuid> {
+  static std::shared_ptr<arrow::DataType> type() {
+    return arrow::fixed_size_binary(16);
+  }
+  static void Append(arrow::ArrayBuilder* b, const boost::uuids::uuid& x) {
+    Check(static_cast<arrow::FixedSizeBinaryBuilder*>(b)->Append(x.data),
+          "appending a uuid");
+  }
+  static boost::uuids::uuid Get(const arrow::Array& a, int64_t i) {
+    boost::uuids::uuid x;
+    memcpy(x.data,
+           static_cast<const arrow::FixedSizeBinaryArray&>(a).GetValue(i), 16);
+    return x;
+  }
+};
+
+// vectors, lists, and sets
+template <typename C>
+struct SeqCodec {
+  typedef typename C::value_type V;
+  static std::shared_ptr<arrow::DataType> type() {
+    return arrow::list(ArrowCodec<V>::type());
+  }
+  static void Append(arrow::ArrayBuilder* b, const C& x) {
+    arrow::ListBuilder* lb = static_cast<arrow::ListBuilder*>(b);
+    Check(lb->Append(), "appending a list");
+    typename C::const_iterator it;
+    for (it = x.begin(); it != x.end(); ++it)
+      ArrowCodec<V>::Append(lb->value_builder(), *it);
+  }
+  static C Get(const arrow::Array& a, int64_t i) {
+    const arrow::ListArray& la = static_cast<const arrow::ListArray&>(a);
+    const arrow::Array& vals = *la.values();
+    int64_t start = la.value_offset(i);
+    int64_t end = start + la.value_length(i);
+    C x;
+    for (int64_t j = start; j < end; ++j)
+      x.insert(x.end(), ArrowCodec<V>::Get(vals, j));
+    return x;
+  }
+};
+
+template <typename V>
+struct ArrowCodec<std::vector<V> > : SeqCodec<std::vector<V> > {};
+
+template <typename V>
+struct ArrowCodec<std::list<V> > : SeqCodec<std::list<V> > {};
+
+template <typename V>
+struct ArrowCodec<std::set<V> > : SeqCodec<std::set<V> > {};
+
+template <typename K, typename V>
+struct ArrowCodec<std::map<K, V> > {
+  static std::shared_ptr<arrow::DataType> type() {
+    return arrow::map(ArrowCodec<K>::type(), ArrowCodec<V>::type());
+  }
+  static void Append(arrow::ArrayBuilder* b, const std::map<K, V>& x) {
+    arrow::MapBuilder* mb = static_cast<arrow::MapBuilder*>(b);
+    Check(mb->Append(), "appending a map");
+    typename std::map<K, V>::const_iterator it;
+    for (it = x.begin(); it != x.end(); ++it) {
+      ArrowCodec<K>::Append(mb->key_builder(), it->first);
+      ArrowCodec<V>::Append(mb->item_builder(), it->second);
+    }
+  }
+  static std::map<K, V> Get(const arrow::Array& a, int64_t i) {
+    const arrow::MapArray& ma = static_cast<const arrow::MapArray&>(a);
+    const arrow::Array& keys = *ma.keys();
+    const arrow::Array& items = *ma.items();
+    int64_t start = ma.value_offset(i);
+    int64_t end = start + ma.value_length(i);
+    std::map<K, V> x;
+    for (int64_t j = start; j < end; ++j)
+      x.insert(x.end(), std::make_pair(ArrowCodec<K>::Get(keys, j),
+                                       ArrowCodec<V>::Get(items, j)));
+    return x;
+  }
+};
+
+template <typename A, typename B>
+struct ArrowCodec<std::pair<A, B> > {
+  static std::shared_ptr<arrow::DataType> type() {
+    return arrow::struct_({arrow::field("first", ArrowCodec<A>::type()),
+                           arrow::field("second", ArrowCodec<B>::type())});
+  }
+  static void Append(arrow::ArrayBuilder* b, const std::pair<A, B>& x) {
+    arrow::StructBuilder* sb = static_cast<arrow::StructBuilder*>(b);
+    Check(sb->Append(), "appending a pair");
+    ArrowCodec<A>::Append(sb->field_builder(0), x.first);
+    ArrowCodec<B>::Append(sb->field_builder(1), x.second);
+  }
+  static std::pair<A, B> Get(const arrow::Array& a, int64_t i) {
+    const arrow::StructArray& sa = static_cast<const arrow::StructArray&>(a);
+    return std::make_pair(ArrowCodec<A>::Get(*sa.field(0), i),
+                          ArrowCodec<B>::Get(*sa.field(1), i));
+  }
+};
+
+// The value types supported, as (DbTypes, C++ type).
+#define CYCLUS_COMMA ,
+#define CYCLUS_PARQUET_TYPES(X) \
+  X(INT, int) \
+  X(BOOL, bool) \
+  X(DOUBLE, double) \
+  X(FLOAT, float) \
+  X(BLOB, Blob) \
+  X(STRING, std::string) \
+  X(UUID, boost::uuids::uuid) \
+  X(SET_INT, std::set<int>) \
+  X(SET_STRING, std::set<std::string>) \
+  X(LIST_INT, std::list<int>) \
+  X(LIST_STRING, std::list<std::string>) \
+  X(VECTOR_INT, std::vector<int>) \
+  X(VECTOR_DOUBLE, std::vector<double>) \
+  X(VECTOR_STRING, std::vector<std::string>) \
+  X(MAP_INT_DOUBLE, std::map<int CYCLUS_COMMA double>) \
+  X(MAP_INT_INT, std::map<int CYCLUS_COMMA int>) \
+  X(MAP_INT_STRING, std::map<int CYCLUS_COMMA std::string>) \
+  X(MAP_STRING_INT, std::map<std::string CYCLUS_COMMA int>) \
+  X(MAP_STRING_DOUBLE, std::map<std::string CYCLUS_COMMA double>) \
+  X(MAP_STRING_STRING, std::map<std::string CYCLUS_COMMA std::string>) \
+  X(MAP_STRING_VECTOR_DOUBLE, \
+    std::map<std::string CYCLUS_COMMA std::vector<double> >) \
+  X(MAP_STRING_MAP_INT_DOUBLE, \
+    std::map<std::string CYCLUS_COMMA std::map<int CYCLUS_COMMA double> >) \
+  X(MAP_STRING_PAIR_DOUBLE_MAP_INT_DOUBLE, \
+    std::map<std::string CYCLUS_COMMA \
+             std::pair<double CYCLUS_COMMA \
+                       std::map<int CYCLUS_COMMA double> > >) \
+  X(MAP_INT_MAP_STRING_DOUBLE, \
+    std::map<int CYCLUS_COMMA std::map<std::string CYCLUS_COMMA double> >) \
+  X(MAP_STRING_VECTOR_PAIR_INT_PAIR_STRING_STRING, \
+    std::map<std::string CYCLUS_COMMA \
+             std::vector<std::pair<int CYCLUS_COMMA \
+                                   std::pair<std::string CYCLUS_COMMA \
+                                             std::string> > > >) \
+  X(MAP_STRING_PAIR_STRING_VECTOR_DOUBLE, \
+    std::map<std::string CYCLUS_COMMA \
+             std::pair<std::string CYCLUS_COMMA std::vector<double> > >) \
+  X(LIST_PAIR_INT_INT, std::list<std::pair<int CYCLUS_COMMA int> >) \
+  X(MAP_STRING_MAP_STRING_INT, \
+    std::map<std::string CYCLUS_COMMA \
+             std::map<std::string CYCLUS_COMMA int> >) \
+  X(VECTOR_PAIR_PAIR_DOUBLE_DOUBLE_MAP_STRING_DOUBLE, \
+    std::vector<std::pair<std::pair<double CYCLUS_COMMA double> CYCLUS_COMMA \
+                          std::map<std::string CYCLUS_COMMA double> > >) \
+  X(MAP_PAIR_STRING_STRING_INT, \
+    std::map<std::pair<std::string CYCLUS_COMMA std::string> CYCLUS_COMMA \
+             int>)
+
+struct TypeInfoLess {
+  bool operator()(const std::type_info* a, const std::type_info* b) const {
+    return a->before(*b);
+  }
+};
+
+typedef std::map<const std::type_info*, DbTypes, TypeInfoLess> TypeMap;
+
+TypeMap MakeTypeMap() {
+  TypeMap m;
+#define CYCLUS_TYPEID(D, T) m[&typeid(T)] = D;
+  CYCLUS_PARQUET_TYPES(CYCLUS_TYPEID)
+#undef CYCLUS_TYPEID
+  return m;
+}
+
+DbTypes Type(const boost::spirit::hold_any& v) {
+  static const TypeMap types = MakeTypeMap();
+  TypeMap::const_iterator it = types.find(&v.type());
+  if (it == types.end()) {
+    throw ValueError(std::string("unsupported parquet backend type ") +
+                     v.type().name());
+  }
+  return it->second;
+}
+
+std::shared_ptr<arrow::DataType> ArrowType(DbTypes type) {
+#define CYCLUS_ARROWTYPE(D, T) \
+  case D: \
+    return ArrowCodec<T>::type();
+  switch (type) {
+    CYCLUS_PARQUET_TYPES(CYCLUS_ARROWTYPE)
+    default:
+      throw ValueError("attempted to use unsupported parquet backend type");
+  }
+#undef CYCLUS_ARROWTYPE
+}
+
+void AppendVal(DbTypes type, arrow::ArrayBuilder* b,
+               const boost::spirit::hold_any& v) {
+#define CYCLUS_APPENDVAL(D, T) \
+  case D: \
+    ArrowCodec<T>::Append(b, v.cast<T>()); \
+    break;
+  switch (type) {
+    CYCLUS_PARQUET_TYPES(CYCLUS_APPENDVAL)
+    default:
+      throw ValueError("attempted to record unsupported parquet backend type");
+  }
+#undef CYCLUS_APPENDVAL
+}
+
+boost::spirit::hold_any GetVal(DbTypes type, const arrow::Array& a,
+                               int64_t i) {
+  boost::spirit::hold_any v;
+#define CYCLUS_GETVAL(D, T) \
+  case D: \
+    v = ArrowCodec<T>::Get(a, i); \
+    break;
+  switch (type) {
+    CYCLUS_PARQUET_TYPES(CYCLUS_GETVAL)
+    default:
+      throw ValueError("attempted to read unsupported parquet backend type");
+  }
+#undef CYCLUS_GETVAL
+  return v;
+}
+
+bool Matches(DbTypes type, const boost::spirit::hold_any& v,
+             std::vector<Cond*>* conds) {
+#define CYCLUS_MATCHES(D, T) \
+  case D: { \
+    T x = v.cast<T>(); \
+    return CmpConds<T>(&x, conds); \
+  }
+  switch (type) {
+    CYCLUS_PARQUET_TYPES(CYCLUS_MATCHES)
+    default:
+      throw ValueError("attempted to compare unsupported parquet backend type");
+  }
+#undef CYCLUS_MATCHES
+}
+
+#undef CYCLUS_PARQUET_TYPES
+#undef CYCLUS_COMMA
+
+std::unique_ptr<parquet::arrow::FileReader> OpenPart(const std::string& path) {
+  std::shared_ptr<arrow::io::ReadableFile> in = Unwrap(
+      arrow::io::ReadableFile::Open(path), "could not open " + path);
+  parquet::arrow::FileReaderBuilder builder;
+  Check(builder.Open(in), "could not open " + path);
+  std::unique_ptr<parquet::arrow::FileReader> reader;
+  Check(builder.Build(&reader), "could not read " + path);
+  return reader;
+}
+
+}  // namespace
+
+ParquetBack::ParquetBack(std::string path)
+    : path_(path),
+      batch_rows_(kParquetBatchRows),
+      closed_(false) {
+  boost::system::error_code ec;
+  fs::create_directories(path_, ec);
+  if (!fs::is_directory(path_))
+    throw IOError("could not create the parquet output directory '" + path_ +
+                  "'.");
+}
+
+ParquetBack::~ParquetBack() {
+  try {
+    Close();
+  } catch (Error err) {
+    CLOG(LEV_ERROR) << "Error in ParquetBack destructor: " << err.what();
+  }
+}
+
+std::string ParquetBack::Name() {
+  return path_;
+}
+
+void ParquetBack::Notify(const DatumGroups& groups) {
+  DatumGroups::const_iterator it;
+  for (it = groups.begin(); it != groups.end(); ++it) {
+    std::string name = it->title();
+    Table& t = tables_[name];
+    if (t.schema == NULL)
+      CreateTable(name, it->front(), &t);
+
+    int ncols = t.types.size();
+    DatumGroups::Group::const_iterator d;
+    for (d = it->begin(); d != it->end(); ++d) {
+      const Datum::Vals& vals = (*d)->vals();
+      if (vals.size() != ncols) {
+        throw ValueError("datum of table '" + name + "' has a different "
+                         "number of columns than the table.");
+      }
+      for (int col = 0; col < ncols; ++col)
+        AppendVal(t.types[col], t.builders[col].get(), vals[col].second);
+      if (++t.nbuffered >= batch_rows_)
+        WriteBatch(name, &t);
+    }
+  }
+}
+
+void ParquetBack::CreateTable(const std::string& name, Datum* d, Table* t) {
+  const Datum::Vals& vals = d->vals();
+  std::vector<std::shared_ptr<arrow::Field> > fields;
+  std::stringstream dbtypes;
+  for (int i = 0; i < vals.size(); ++i) {
+    DbTypes type = Type(vals[i].second);
+    std::shared_ptr<arrow::DataType> arrow_type = ArrowType(type);
+    t->fields.push_back(vals[i].first);
+    t->types.push_back(type);
+    fields.push_back(arrow::field(vals[i].first, arrow_type));
+    std::unique_ptr<arrow::ArrayBuilder> b;
+    Check(arrow::MakeBuilder(arrow::default_memory_pool(), arrow_type, &b),
+          "could not create the columns of table '" + name + "'");
+    t->builders.push_back(std::shared_ptr<arrow::ArrayBuilder>(b.release()));
+    dbtypes << (i == 0 ? "" : ",") << type;
+  }
+  t->schema = arrow::schema(fields, arrow::key_value_metadata(
+      std::vector<std::string>(1, kDbTypesKey),
+      std::vector<std::string>(1, dbtypes.str())));
+  t->nparts = Parts(name).size();
+}
+
+void ParquetBack::WriteBatch(const std::string& name, Table* t) {
+  if (t->nbuffered == 0)
+    return;
+
+  if (t->writer == NULL) {
+    fs::path dir = fs::path(path_) / name;
+    boost::system::error_code ec;
+    fs::create_directories(dir, ec);
+    char part[32];
+    snprintf(part, sizeof(part), "part-%05d.parquet", t->nparts);
+    std::string fname = (dir / part).string();
+    t->out = Unwrap(arrow::io::FileOutputStream::Open(fname),
+                    "could not create " + fname);
+    t->writer = Unwrap(parquet::arrow::FileWriter::Open(
+                           *t->schema, arrow::default_memory_pool(), t->out),
+                       "could not create " + fname);
+  }
+
+  std::vector<std::shared_ptr<arrow::Array> > cols(t->builders.size());
+  for (int i = 0; i < cols.size(); ++i)
+    Check(t->builders[i]->Finish(&cols[i]),
+          "could not finish the rows of table '" + name + "'");
+  std::shared_ptr<arrow::Table> tbl = arrow::Table::Make(t->schema, cols,
+                                                         t->nbuffered);
+  Check(t->writer->WriteTable(*tbl, t->nbuffered),
+        "could not write the rows of table '" + name + "' to '" + path_ +
+        "'");
+  t->nbuffered = 0;
+}
+
+void ParquetBack::FinishPart(const std::string& name, Table* t) {
+  WriteBatch(name, t);
+  if (t->writer == NULL)
+    return;
+  Check(t->writer->Close(), "could not finish a part of table '" + name +
+                            "' in '" + path_ + "'");
+  if (!t->out->closed())
+    Check(t->out->Close(), "could not close a part of table '" + name + "'");
+  t->writer.reset();
+  t->out.reset();
+  ++t->nparts;
+}
+
+void ParquetBack::Close() {
+  if (closed_)
+    return;
+  std::map<std::string, Table>::iterator it;
+  for (it = tables_.begin(); it != tables_.end(); ++it)
+    FinishPart(it->first, &it->second);
+  closed_ = true;
+}
+
+std::vector<std::string> ParquetBack::Parts(const std::string& table) {
+  std::vector<std::string> parts;
+  fs::path dir = fs::path(path_) / table;
+  if (!fs::is_directory(dir))
+    return parts;
+  fs::directory_iterator end;
+  for (fs::directory_iterator it(dir); it != end; ++it) {
+    if (it->path().extension() == ".parquet")
+      parts.push_back(it->path().string());
+  }
+  std::sort(parts.begin(), parts.end());
+  return parts;
+}
+
+QueryResult ParquetBack::GetTableInfo(const std::string& table) {
+  QueryResult info;
+  std::map<std::string, Table>::iterator t = tables_.find(table);
+  if (t != tables_.end() && t->second.schema != NULL) {
+    info.fields = t->second.fields;
+    info.types = t->second.types;
+    return info;
+  }
+
+  std::vector<std::string> parts = Parts(table);
+  if (parts.empty())
+    throw ValueError("Invalid table name " + table);
+  std::shared_ptr<arrow::Schema> schema;
+  Check(OpenPart(parts[0])->GetSchema(&schema),
+        "could not read the schema of " + parts[0]);
+  int key = schema->metadata() == NULL ? -1 :
+            schema->metadata()->FindKey(kDbTypesKey);
+  if (key < 0)
+    throw IOError(parts[0] + " was not written by cyclus.");
+  std::stringstream dbtypes(schema->metadata()->value(key));
+  std::string type;
+  for (int i = 0; std::getline(dbtypes, type, ','); ++i) {
+    info.fields.push_back(schema->field(i)->name());
+    info.types.push_back(
+        static_cast<DbTypes>(boost::lexical_cast<int>(type)));
+  }
+  return info;
+}
+
+QueryResult ParquetBack::Query(std::string table, std::vector<Cond>* conds) {
+  std::map<std::string, Table>::iterator t = tables_.find(table);
+  if (t != tables_.end())
+    FinishPart(table, &t->second);
+
+  QueryResult qr = GetTableInfo(table);
+  int nfields = qr.fields.size();
+  std::vector<std::vector<Cond*> > colconds(nfields);
+  if (conds != NULL) {
+    for (int i = 0; i < conds->size(); ++i) {
+      Cond* cond = &(*conds)[i];
+      int col = std::find(qr.fields.begin(), qr.fields.end(), cond->field) -
+                qr.fields.begin();
+      if (col == nfields) {
+        throw KeyError("table '" + table + "' has no field '" + cond->field +
+                       "' in '" + path_ + "'.");
+      }
+      colconds[col].push_back(cond);
+    }
+  }
+
+  std::vector<std::string> parts = Parts(table);
+  for (int p = 0; p < parts.size(); ++p) {
+    std::shared_ptr<arrow::Table> tbl;
+    Check(OpenPart(parts[p])->ReadTable(&tbl), "could not read " + parts[p]);
+    arrow::TableBatchReader batches(*tbl);
+    std::shared_ptr<arrow::RecordBatch> batch;
+    for (Check(batches.ReadNext(&batch), "could not read " + parts[p]);
+         batch != NULL;
+         Check(batches.ReadNext(&batch), "could not read " + parts[p])) {
+      for (int64_t i = 0; i < batch->num_rows(); ++i) {
+        QueryRow row(nfields);
+        bool selected = true;
+        for (int j = 0; j < nfields && selected; ++j) {
+          row[j] = GetVal(qr.types[j], *batch->column(j), i);
+          selected = colconds[j].empty() ||
+                     Matches(qr.types[j], row[j], &colconds[j]);
+        }
+        if (selected)
+          qr.rows.push_back(row);
+      }
+    }
+  }
+  return qr;
+}
+
+std::map<std::string, DbTypes> ParquetBack::ColumnTypes(std::string table) {
+  QueryResult qr = GetTableInfo(table);
+  std::map<std::string, DbTypes> rtn;
+  for (int i = 0; i < qr.fields.size(); ++i)
+    rtn[qr.fields[i]] = qr.types[i];
+  return rtn;
+}
+
+std::list<ColumnInfo> ParquetBack::Schema(std::string table) {
+  std::list<ColumnInfo> schema;
+  QueryResult qr = GetTableInfo(table);
+  for (int i = 0; i < qr.fields.size(); ++i) {
+    schema.push_back(ColumnInfo(table, qr.fields[i], i, qr.types[i],
+                                std::vector<int>()));
+  }
+  return schema;
+}
+
+std::set<std::string> ParquetBack::Tables() {
+  std::set<std::string> rtn;
+  std::map<std::string, Table>::iterator t;
+  for (t = tables_.begin(); t != tables_.end(); ++t)
+    rtn.insert(t->first);
+  fs::directory_iterator end;
+  for (fs::directory_iterator it(path_); it != end; ++it) {
+    std::string name = it->path().filename().string();
+    if (fs::is_directory(it->path()) && !Parts(name).empty())
+      rtn.insert(name);
+  }
+  return rtn;
+}
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_HAS_PARQUET
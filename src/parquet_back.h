@@ -0,0 +1,128 @@
+#ifndef CYCLUS_SRC_PARQUET_BACK_H_
+#define CYCLUS_SRC_PARQUET_BACK_H_
+
+#include "platform.h"
+#if CYCLUS_HAS_PARQUET
+
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <parquet/arrow/writer.h>
+
+#include "query_backend.h"
+
+namespace cyclus {
+
+/// Default number of rows of a table buffered before they are written to its
+/// Parquet file as a row group.
+static int const kParquetBatchRows = 65536;
+
+/// A backend that writes each table as columnar Arrow record batches to
+/// Parquet files, so that output can be read directly by Arrow and pandas.
+/// The output path is a directory holding a directory of part files per
+/// table, e.g. "out.parquet/Transactions/part-00000.parquet", which pyarrow
+/// and pandas read as a single dataset.
+///
+/// Columns map to Arrow types as follows: int to int32, float and double to
+/// float32 and float64, bool to boolean, strings to utf8, Blobs to binary,
+/// and uuids to 16-byte fixed size binary. Vectors, sets, and lists become
+/// list columns, maps become map columns, and pairs become structs with
+/// "first" and "second" fields, nested as deeply as the type requires. The
+/// value types supported are those of the sqlite backend. The DbTypes of a
+/// table's columns are kept in the "cyclus_dbtypes" schema metadata of its
+/// files, so that queries return values of their original C++ types.
+///
+/// Rows are buffered in Arrow builders and written as a row group every
+/// batch_rows() rows. A part file is finished when the table is queried or
+/// the backend is closed; rows recorded after a query go to a new part.
+/// Rows still buffered when the process dies are lost.
+class ParquetBack : public FullBackend {
+ public:
+  /// Creates a backend writing to the directory at path, which is created if
+  /// it doesn't exist. Tables already in it may be queried, and rows recorded
+  /// to them are written to new parts.
+  explicit ParquetBack(std::string path);
+
+  virtual ~ParquetBack();
+
+  using RecBackend::Notify;
+
+  /// Appends the rows of each table to its buffers, writing a row group
+  /// whenever batch_rows() rows have been buffered.
+  virtual void Notify(const DatumGroups& groups);
+
+  /// Sets the number of rows of a table written to each row group. Values
+  /// less than one are treated as one.
+  void set_batch_rows(int n) { batch_rows_ = n < 1 ? 1 : n; }
+
+  /// Returns the number of rows of a table written to each row group.
+  int batch_rows() const { return batch_rows_; }
+
+  /// Returns the path of the output directory.
+  virtual std::string Name();
+
+  /// Does nothing; rows are written a row group at a time.
+  virtual void Flush() {}
+
+  /// Writes the buffered rows and finishes every open part file.
+  virtual void Close();
+
+  using QueryableBackend::Query;
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds);
+
+  virtual std::map<std::string, DbTypes> ColumnTypes(std::string table);
+
+  virtual std::list<ColumnInfo> Schema(std::string table);
+
+  virtual std::set<std::string> Tables();
+
+ private:
+  /// The columns, buffers, and open part file of a table recorded to.
+  struct Table {
+    Table() : nbuffered(0), nparts(0) {}
+
+    std::vector<std::string> fields;
+    std::vector<DbTypes> types;
+    std::shared_ptr<arrow::Schema> schema;
+    std::vector<std::shared_ptr<arrow::ArrayBuilder> > builders;
+    int64_t nbuffered;
+
+    /// The number of the next part file.
+    int nparts;
+    std::shared_ptr<arrow::io::FileOutputStream> out;
+    std::unique_ptr<parquet::arrow::FileWriter> writer;
+  };
+
+  /// Sets up the columns and buffers of d's table.
+  void CreateTable(const std::string& name, Datum* d, Table* t);
+
+  /// Writes the buffered rows of a table as a row group, opening a new part
+  /// file if none is open.
+  void WriteBatch(const std::string& name, Table* t);
+
+  /// Writes the buffered rows of a table and finishes its open part file, if
+  /// any, so that it can be read.
+  void FinishPart(const std::string& name, Table* t);
+
+  /// Returns the paths of the part files of a table, in order.
+  std::vector<std::string> Parts(const std::string& table);
+
+  /// Reads the fields and types of a table from its first part file.
+  QueryResult GetTableInfo(const std::string& table);
+
+  std::string path_;
+  std::map<std::string, Table> tables_;
+  int batch_rows_;
+  bool closed_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_HAS_PARQUET
+#endif  // CYCLUS_SRC_PARQUET_BACK_H_
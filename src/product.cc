@@ -7,16 +7,14 @@ namespace cyclus {
 
 const ResourceType Product::kType = "Product";
 
-std::map<std::string, int> Product::qualids_;
-int Product::next_qualid_ = 1;
-
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Product::Ptr Product::Create(Agent* creator, double quantity,
                              std::string quality) {
-  if (qualids_.count(quality) == 0) {
-    qualids_[quality] = next_qualid_++;
+  bool added = false;
+  int qualid = creator->context()->ids().InternQuality(quality, &added);
+  if (added) {
     creator->context()->NewDatum("Products")
-        ->AddVal("QualId", qualids_[quality])
+        ->AddVal("QualId", qualid)
         ->AddVal("Quality", quality)
         ->Record();
   }
@@ -74,7 +72,8 @@ Resource::Ptr Product::ExtractRes(double qty) {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Product::Product(Context* ctx, double quantity, std::string quality)
-    : quality_(quality),
+    : Resource(ctx),
+      quality_(quality),
       quantity_(quantity),
       tracker_(ctx, this),
       ctx_(ctx) {}
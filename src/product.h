@@ -1,9 +1,10 @@
 #ifndef CYCLUS_SRC_PRODUCT_H_
 #define CYCLUS_SRC_PRODUCT_H_
 
-#include <boost/shared_ptr.hpp>
+#include <boost/intrusive_ptr.hpp>
 
 #include "context.h"
+#include "mem_usage.h"
 #include "resource.h"
 #include "res_tracker.h"
 
@@ -15,13 +16,13 @@ namespace cyclus {
 /// and is a catch-all for non-standard resources.  It implements the Resource
 /// class interface in a simple way usable for things such as: bananas,
 /// man-hours, water, buying power, etc.
-class Product : public Resource {
+class Product : public Resource,
+                private MemCounted<Product, MemUsage::PRODUCT> {
   friend class SimInit;
   friend class ::SimInitTest;
 
  public:
-  typedef
-  boost::shared_ptr<Product> Ptr;
+  typedef boost::intrusive_ptr<Product> Ptr;
   static const ResourceType kType;
 
   /// Creates a new product that is "live" and tracked. creator is a
@@ -36,7 +37,7 @@ class Product : public Resource {
 
   /// Returns 0 (for now).
   virtual int qual_id() const {
-    return qualids_[quality_];
+    return ids()->QualityId(quality_);
   }
 
   /// Returns Product::kType.
@@ -77,10 +78,6 @@ class Product : public Resource {
   /// @param quality the resource quality
   Product(Context* ctx, double quantity, std::string quality);
 
-  // map<quality, quality_id>
-  static std::map<std::string, int> qualids_;
-  static int next_qualid_;
-
   Context* ctx_;
   std::string quality_;
   double quantity_;
@@ -20,6 +20,8 @@ ProgSolver::ProgSolver(std::string solver_t)
       tmax_(ProgSolver::kDefaultTimeout),
       verbose_(false),
       mps_(false),
+      persistent_(false),
+      iface_(NULL),
       ExchangeSolver(false) {}
 
 ProgSolver::ProgSolver(std::string solver_t, bool exclusive_orders)
@@ -27,6 +29,8 @@ ProgSolver::ProgSolver(std::string solver_t, bool exclusive_orders)
       tmax_(ProgSolver::kDefaultTimeout),
       verbose_(false),
       mps_(false),
+      persistent_(false),
+      iface_(NULL),
       ExchangeSolver(exclusive_orders) {}
 
 ProgSolver::ProgSolver(std::string solver_t, double tmax)
@@ -34,6 +38,8 @@ ProgSolver::ProgSolver(std::string solver_t, double tmax)
       tmax_(tmax),
       verbose_(false),
       mps_(false),
+      persistent_(false),
+      iface_(NULL),
       ExchangeSolver(false) {}
 
 ProgSolver::ProgSolver(std::string solver_t, double tmax, bool exclusive_orders,
@@ -42,9 +48,41 @@ ProgSolver::ProgSolver(std::string solver_t, double tmax, bool exclusive_orders,
       tmax_(tmax),
       verbose_(verbose),
       mps_(mps),
-      ExchangeSolver(exclusive_orders) {}
+      persistent_(false),
+      iface_(NULL),
+      ExchangeSolver(exclusive_orders) {
+  // every subgraph would be written to the same file
+  if (mps_)
+    decompose(false);
+}
+
+ProgSolver::~ProgSolver() {
+  Reset();
+}
+
+ExchangeSolver* ProgSolver::Clone() {
+  ProgSolver* s = new ProgSolver(solver_t_, tmax_, exclusive_orders_,
+                                 verbose_, mps_);
+  s->sim_ctx(sim_ctx_);
+  s->persistent(persistent_);
+  s->cbc_options(cbc_opts_);
+  return s;
+}
+
+void ProgSolver::persistent(bool p) {
+  persistent_ = p;
+  if (persistent_) {
+    decompose(false);
+  } else {
+    Reset();
+  }
+}
 
-ProgSolver::~ProgSolver() {}
+void ProgSolver::Reset() {
+  delete iface_;
+  iface_ = NULL;
+  prev_soln_.clear();
+}
 
 void ProgSolver::WriteMPS() {
   std::stringstream ss;
@@ -53,8 +91,13 @@ void ProgSolver::WriteMPS() {
 }
 
 double ProgSolver::SolveGraph() {
-  SolverFactory sf(solver_t_, tmax_);
-  iface_ = sf.get();
+  // a persistent interface is only kept once it holds a solved program
+  bool loaded = persistent_ && iface_ != NULL;
+  if (!loaded) {
+    Reset();
+    SolverFactory sf(solver_t_, tmax_);
+    iface_ = sf.get();
+  }
   try {
     // get greedy solution
     GreedySolver greedy(exclusive_orders_);
@@ -64,33 +107,54 @@ double ProgSolver::SolveGraph() {
     // translate graph to iface_ instance
     double pseudo_cost = PseudoCost(); // from ExchangeSolver API
     ProgTranslator xlator(graph_, iface_, exclusive_orders_, pseudo_cost);
-    xlator.ToProg();
+    xlator.Translate();
+    bool warm = loaded && xlator.Update(prev_ctx_);
+    if (loaded && !warm) {
+      // the program's structure changed, so start over with a fresh interface
+      Reset();
+      SolverFactory sf(solver_t_, tmax_);
+      iface_ = sf.get();
+      xlator = ProgTranslator(graph_, iface_, exclusive_orders_, pseudo_cost);
+      xlator.Translate();
+    }
+    if (!warm)
+      xlator.Populate();
     if (mps_)
       WriteMPS();
 
     // set noise level
-    CoinMessageHandler h;
-    h.setLogLevel(0);
+    handler_.setLogLevel(0);
     if (verbose_) {
       Report(iface_);
-      h.setLogLevel(4);
+      handler_.setLogLevel(4);
     }
-    iface_->passInMessageHandler(&h);
+    iface_->passInMessageHandler(&handler_);
     if (verbose_) {
       std::cout << "Solving problem, message handler has log level of "
                 << iface_->messageHandler()->logLevel() << "\n";
+      if (warm)
+        std::cout << "Warm starting from the previous solve\n";
     }
 
     // solve and back translate
-    SolveProg(iface_, greedy_obj, verbose_);
+    const double* incumbent = warm && !prev_soln_.empty() ? &prev_soln_[0]
+                                                          : NULL;
+    SolveProg(iface_, greedy_obj, verbose_, warm, incumbent, cbc_opts_);
 
     xlator.FromProg();
+
+    if (persistent_) {
+      prev_ctx_ = xlator.ctx();
+      const double* soln = iface_->getColSolution();
+      prev_soln_.assign(soln, soln + iface_->getNumCols());
+    }
   } catch(...) {
-    delete iface_;
+    Reset();
     throw;
   }
   double ret = iface_->getObjValue();
-  delete iface_;
+  if (!persistent_)
+    Reset();
   return ret;
 }
 
@@ -4,11 +4,15 @@
 #if CYCLUS_HAS_COIN
 
 #include <string>
+#include <vector>
 
+#include "CoinMessageHandler.hpp"
 #include "OsiSolverInterface.hpp"
 
 #include "exchange_graph.h"
 #include "exchange_solver.h"
+#include "prog_translator.h"
+#include "solver_factory.h"
 
 namespace cyclus {
 
@@ -35,6 +39,29 @@ class ProgSolver: public ExchangeSolver {
   /// @}
   virtual ~ProgSolver();
 
+  /// @brief returns a new solver with the same configuration
+  virtual ExchangeSolver* Clone();
+
+  /// @brief get/set whether the solver interface is kept alive between
+  /// solves. When persistent, a program with the same dimensions and
+  /// sparsity pattern as the previous one is updated in place and warm
+  /// started from the previous basis, with the previous solution offered as
+  /// an incumbent for mixed-integer programs. Any other program is loaded
+  /// into a fresh interface. Persistence turns off graph decomposition, since
+  /// every subgraph would otherwise replace the previous program. Default
+  /// false.
+  /// @{
+  void persistent(bool p);
+  inline bool persistent() const { return persistent_; }
+  /// @}
+
+  /// @brief get/set the options that mixed-integer programs, i.e., those
+  /// with exclusive orders, are solved by Cbc with
+  /// @{
+  inline void cbc_options(const CbcOptions& o) { cbc_opts_ = o; }
+  inline const CbcOptions& cbc_options() const { return cbc_opts_; }
+  /// @}
+
  protected:
   /// @brief the ProgSolver solves an ExchangeGraph...
   virtual double SolveGraph();
@@ -42,10 +69,22 @@ class ProgSolver: public ExchangeSolver {
  private:
   void WriteMPS();
 
+  /// deletes the solver interface and anything kept from its last solve
+  void Reset();
+
   std::string solver_t_;
   double tmax_;
-  bool verbose_, mps_;
+  bool verbose_, mps_, persistent_;
+  CbcOptions cbc_opts_;
   OsiSolverInterface* iface_;
+
+  /// the interface holds a pointer to the handler, so it must live as long
+  /// as a persistent interface does
+  CoinMessageHandler handler_;
+
+  /// the program and solution of the last persistent solve
+  ProgTranslatorContext prev_ctx_;
+  std::vector<double> prev_soln_;
 };
 
 }  // namespace cyclus
@@ -3,6 +3,7 @@
 #include <algorithm>
 
 #include "CoinPackedVector.hpp"
+#include "OsiClpSolverInterface.hpp"
 #include "OsiSolverInterface.hpp"
 
 #include "cyc_limits.h"
@@ -110,17 +111,89 @@ void ProgTranslator::Populate() {
 
   
   if (excl_) {
-    std::vector<Arc>& arcs = g_->arcs();
-    for (int i = 0; i != arcs.size(); i++) {
-      Arc& a = arcs[i];
-      if (a.exclusive()) {
-        iface_->setInteger(g_->arc_ids()[a]);
+    const FlatExchangeGraph& f = g_->flat();
+    for (int i = 0; i != f.arc_exclusive.size(); i++) {
+      if (f.arc_exclusive[i]) {
+        iface_->setInteger(i);
       }
     }
   }
 
 }
 
+bool ProgTranslator::Update(const ProgTranslatorContext& prev) {
+  // elements can only be changed in place by clp
+  OsiClpSolverInterface* clp = dynamic_cast<OsiClpSolverInterface*>(iface_);
+  const CoinPackedMatrix& m = ctx_.m;
+  const CoinPackedMatrix& pm = prev.m;
+  int ncols = m.getNumCols();
+  int nrows = m.getNumRows();
+  if (clp == NULL || ncols != pm.getNumCols() || nrows != pm.getNumRows() ||
+      ncols != iface_->getNumCols() || nrows != iface_->getNumRows() ||
+      m.isColOrdered() != pm.isColOrdered()) {
+    return false;
+  }
+
+  // the sparsity patterns must match exactly
+  const CoinBigIndex* starts = m.getVectorStarts();
+  const CoinBigIndex* pstarts = pm.getVectorStarts();
+  const int* lens = m.getVectorLengths();
+  const int* plens = pm.getVectorLengths();
+  const int* inds = m.getIndices();
+  const int* pinds = pm.getIndices();
+  for (int i = 0; i != m.getMajorDim(); i++) {
+    if (lens[i] != plens[i] ||
+        !std::equal(inds + starts[i], inds + starts[i] + lens[i],
+                    pinds + pstarts[i])) {
+      return false;
+    }
+  }
+
+  CLOG(LEV_DEBUG1) << "Updating program with " << ncols << " columns and "
+                   << nrows << " rows in place.";
+  const double* vals = m.getElements();
+  const double* pvals = pm.getElements();
+  for (int i = 0; i != m.getMajorDim(); i++) {
+    for (int k = 0; k != lens[i]; k++) {
+      double val = vals[starts[i] + k];
+      if (val == pvals[pstarts[i] + k])
+        continue;
+      int j = inds[starts[i] + k];
+      if (m.isColOrdered()) {
+        clp->modifyCoefficient(j, i, val);
+      } else {
+        clp->modifyCoefficient(i, j, val);
+      }
+    }
+  }
+
+  for (int i = 0; i != ncols; i++) {
+    if (ctx_.obj_coeffs[i] != prev.obj_coeffs[i])
+      iface_->setObjCoeff(i, ctx_.obj_coeffs[i]);
+    if (ctx_.col_lbs[i] != prev.col_lbs[i])
+      iface_->setColLower(i, ctx_.col_lbs[i]);
+    if (ctx_.col_ubs[i] != prev.col_ubs[i])
+      iface_->setColUpper(i, ctx_.col_ubs[i]);
+  }
+  for (int i = 0; i != nrows; i++) {
+    if (ctx_.row_lbs[i] != prev.row_lbs[i])
+      iface_->setRowLower(i, ctx_.row_lbs[i]);
+    if (ctx_.row_ubs[i] != prev.row_ubs[i])
+      iface_->setRowUpper(i, ctx_.row_ubs[i]);
+  }
+
+  const FlatExchangeGraph& f = g_->flat();
+  for (int i = 0; i != ncols; i++) {
+    bool integer = excl_ && i < f.arc_exclusive.size() && f.arc_exclusive[i];
+    if (integer && !iface_->isInteger(i)) {
+      iface_->setInteger(i);
+    } else if (!integer && iface_->isInteger(i)) {
+      iface_->setContinuous(i);
+    }
+  }
+  return true;
+}
+
 void ProgTranslator::ToProg() {
   Translate();
   Populate();
@@ -139,33 +212,38 @@ void ProgTranslator::XlateGrp_(ExchangeNodeGroup* grp, bool request) {
     cap_rows.push_back(CoinPackedVector());
   }
 
+  const FlatExchangeGraph& f = g_->flat();
+  std::vector<Arc>& arcs = g_->arcs();
   std::vector<ExchangeNode::Ptr>& nodes = grp->nodes();
   for (int i = 0; i != nodes.size(); i++) {
-    std::map<Arc, std::vector<double> >& ucap_map = nodes[i]->unit_capacities;
-    std::map<Arc, std::vector<double> >::iterator cap_it;
+    int n = f.node_id(nodes[i].get());
+    if (n < 0)
+      continue;
 
     // add each arc
-    for (cap_it = ucap_map.begin(); cap_it != ucap_map.end(); ++cap_it) {
-      const Arc& a = cap_it->first;
-      std::vector<double>& ucaps = cap_it->second;
-      int arc_id = g_->arc_ids()[a];
+    for (int k = f.adj_start[n]; k != f.adj_start[n + 1]; k++) {
+      int arc_id = f.adj[k];
+      const Arc& a = arcs[arc_id];
+      bool unode = f.arc_unode[arc_id] == n;
+      const std::vector<int>& start = unode ? f.ucap_start : f.vcap_start;
+      const std::vector<double>& ucaps = unode ? f.ucaps : f.vcaps;
 
       // add each unit capacity coefficient
-      for (int j = 0; j != ucaps.size(); j++) {
+      for (int j = start[arc_id]; j != start[arc_id + 1]; j++) {
         double coeff = ucaps[j];
-        if (excl_ && a.exclusive()) {
-          coeff *= a.excl_val();
+        if (excl_ && f.arc_exclusive[arc_id]) {
+          coeff *= f.arc_excl_val[arc_id];
         }
 
-        cap_rows[j].insert(arc_id, coeff);
+        cap_rows[j - start[arc_id]].insert(arc_id, coeff);
       }
 
       if (request) {
         CheckPref(a.pref());
         ctx_.obj_coeffs[arc_id] = ExchangeSolver::Cost(a, excl_);
         ctx_.col_lbs[arc_id] = 0;
-        ctx_.col_ubs[arc_id] = (excl_ && a.exclusive()) ? 1 :
-                               std::min(nodes[i]->qty, inf);
+        ctx_.col_ubs[arc_id] = (excl_ && f.arc_exclusive[arc_id]) ? 1 :
+                               std::min(f.node_qty[n], inf);
       }
     }
   }
@@ -197,9 +275,11 @@ void ProgTranslator::XlateGrp_(ExchangeNodeGroup* grp, bool request) {
       CoinPackedVector excl_row;
       std::vector<ExchangeNode::Ptr>& nodes = exngs[i];
       for (int j = 0; j != nodes.size(); j++) {
-        std::vector<Arc>& arcs = g_->node_arc_map()[nodes[j]];
-        for (int k = 0; k != arcs.size(); k++) {
-          excl_row.insert(g_->arc_ids()[arcs[k]], 1.0);
+        int n = f.node_id(nodes[j].get());
+        if (n < 0)
+          continue;
+        for (int k = f.adj_start[n]; k != f.adj_start[n + 1]; k++) {
+          excl_row.insert(f.adj[k], 1.0);
         }
       }
       if (excl_row.getNumElements() > 0) {
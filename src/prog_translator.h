@@ -63,6 +63,17 @@ class ProgTranslator {
   /// Context
   void Populate();
 
+  /// @brief updates a solver interface that already holds the program in
+  /// prev to the translators Context, changing only the objective
+  /// coefficients, bounds, matrix elements, and integrality that differ. This
+  /// keeps the interface's basis so that the next solve is warm started.
+  /// Translate() must have been called first.
+  /// @param prev the Context that was last loaded into the interface
+  /// @return false, leaving the interface unchanged, if the program's
+  /// dimensions or sparsity pattern differ from prev (Populate() must be used
+  /// instead)
+  bool Update(const ProgTranslatorContext& prev);
+
   /// @brief translates graph into mathematic program via iface. This method is
   /// equivalent to calling Translate(), then Populate().
   void ToProg();
@@ -1,5 +1,47 @@
 #include "pyhooks.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+
+#include "env.h"
+
+namespace cyclus {
+namespace {
+
+/// whether the event loop hook has work to do
+std::atomic<bool> event_loop_pending(true);
+
+/// the least seconds between calls of the hook, or a negative number until
+/// it is first asked for
+std::atomic<double> event_loop_interval(-1);
+
+/// when the hook was last called
+std::chrono::steady_clock::time_point event_loop_last;
+
+}  // namespace
+
+void PyNotifyEventLoop(void) {
+  event_loop_pending.store(true, std::memory_order_release);
+}
+
+double EventLoopInterval(void) {
+  double secs = event_loop_interval.load();
+  if (secs < 0) {
+    std::string env = Env::GetEnv("CYCLUS_EVENT_LOOP_INTERVAL");
+    secs = env.empty() ? 0 : std::max(std::atof(env.c_str()), 0.0);
+    event_loop_interval = secs;
+  }
+  return secs;
+}
+
+void SetEventLoopInterval(double secs) {
+  event_loop_interval = std::max(secs, 0.0);
+}
+
+}  // namespace cyclus
+
 #ifdef CYCLUS_WITH_PYTHON
 #include <stdlib.h>
 
@@ -56,6 +98,10 @@ void PyStart(void) {
   if (!PY_INTERP_INIT) {
     PyAppendInitTab();
     Py_Initialize();
+#if PY_VERSION_HEX < 0x03070000
+    // the GIL is only created on demand before Python 3.7
+    PyEval_InitThreads();
+#endif
     PyImportInit();
     atexit(PyStop);
     PY_INTERP_INIT = true;
@@ -72,31 +118,106 @@ void PyStop(void) {
   };
 };
 
-void EventLoop(void) { CyclusEventLoopHook(); };
+PyGilRelease::PyGilRelease() : state_(NULL) {
+#if PY_VERSION_HEX >= 0x03040000
+  if (PY_INTERP_INIT && Py_IsInitialized() && PyGILState_Check()) {
+    state_ = PyEval_SaveThread();
+  }
+#endif
+}
 
-std::string PyFindModule(std::string lib) { return CyclusPyFindModule(lib); };
+PyGilRelease::~PyGilRelease() {
+  if (state_ != NULL) {
+    PyEval_RestoreThread(static_cast<PyThreadState*>(state_));
+  }
+}
+
+PyGilAcquire::PyGilAcquire() : acquired_(false), state_(0) {
+  if (PY_INTERP_INIT && Py_IsInitialized()) {
+    state_ = PyGILState_Ensure();
+    acquired_ = true;
+  }
+}
+
+PyGilAcquire::~PyGilAcquire() {
+  if (acquired_) {
+    PyGILState_Release(static_cast<PyGILState_STATE>(state_));
+  }
+}
+
+/// Returns whether the event loop hook should be called now, clearing the
+/// pending work if so. Called only from the thread the simulation runs on.
+static bool EventLoopDue(void) {
+  if (!event_loop_pending.load(std::memory_order_acquire))
+    return false;
+  double interval = EventLoopInterval();
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (interval > 0 &&
+      event_loop_last.time_since_epoch().count() != 0 &&
+      std::chrono::duration<double>(now - event_loop_last).count() <
+          interval) {
+    return false;
+  }
+  event_loop_last = now;
+  // cleared before the hook runs, so that work queued meanwhile isn't lost
+  event_loop_pending.store(false, std::memory_order_release);
+  return true;
+}
+
+void EventLoop(void) {
+  if (!EventLoopDue())
+    return;
+  PyGilAcquire gil;
+  CyclusEventLoopHook();
+};
+
+std::string PyFindModule(std::string lib) {
+  PyGilAcquire gil;
+  return CyclusPyFindModule(lib);
+};
 
 Agent* MakePyAgent(std::string lib, std::string agent, void* ctx) {
+  PyGilAcquire gil;
   return CyclusMakePyAgent(lib, agent, ctx);
 };
 
 void InitFromPyAgent(Agent* src, Agent* dst, void* ctx) {
+  PyGilAcquire gil;
   CyclusInitFromPyAgent(src, dst, ctx);
 };
 
-void ClearPyAgentRefs(void) { CyclusClearPyAgentRefs(); };
+void ClearPyAgentRefs(void) {
+  PyGilAcquire gil;
+  CyclusClearPyAgentRefs();
+};
 
-void PyDelAgent(int i) { CyclusPyDelAgent(i); };
+void PyDelAgent(int i) {
+  PyGilAcquire gil;
+  CyclusPyDelAgent(i);
+};
 
 namespace toolkit {
-std::string PyToJson(std::string infile) { return CyclusPyToJson(infile); };
+std::string PyToJson(std::string infile) {
+  PyGilAcquire gil;
+  return CyclusPyToJson(infile);
+};
 
-std::string JsonToPy(std::string infile) { return CyclusJsonToPy(infile); };
+std::string JsonToPy(std::string infile) {
+  PyGilAcquire gil;
+  return CyclusJsonToPy(infile);
+};
 
 void PyCallListeners(std::string tstype, Agent* agent, void* cpp_ctx, int time, boost::spirit::hold_any value){
+    PyGilAcquire gil;
     CyclusPyCallListeners(tstype, agent, cpp_ctx, time, value);
 };
 
+void PyCallBatchListeners(const std::string& tsname, int time,
+                          std::vector<int>* ids, std::vector<double>* values) {
+  PyGilAcquire gil;
+  CyclusPyCallBatchListeners(tsname, time, ids, values);
+};
+
 }  // namespace toolkit
 }  // namespace cyclus
 #else   // else CYCLUS_WITH_PYTHON
@@ -116,6 +237,14 @@ void PyStart(void) {};
 
 void PyStop(void) {};
 
+PyGilRelease::PyGilRelease() : state_(NULL) {}
+
+PyGilRelease::~PyGilRelease() {}
+
+PyGilAcquire::PyGilAcquire() : acquired_(false), state_(0) {}
+
+PyGilAcquire::~PyGilAcquire() {}
+
 void EventLoop(void) {};
 
 std::string PyFindModule(std::string lib) { return std::string(""); };
@@ -143,6 +272,9 @@ std::string JsonToPy(std::string infile) {
 
 void PyCallListeners(std::string tsname, Agent* agent, void* cpp_ctx, int time, boost::spirit::hold_any value) {};
 
+void PyCallBatchListeners(const std::string& tsname, int time,
+                          std::vector<int>* ids, std::vector<double>* values) {};
+
 } // namespace toolkit
 } // namespace cyclus
 #endif  // ends CYCLUS_WITH_PYTHON
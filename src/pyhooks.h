@@ -2,6 +2,7 @@
 #define CYCLUS_SRC_PYHOOKS_H_
 
 #include <string>
+#include <vector>
 
 #include "any.hpp"
 
@@ -34,9 +35,64 @@ void PyStart(void);
 /// not installed with Cyclus. This may safely be called many times.
 void PyStop(void);
 
+/// Releases the Python global interpreter lock (GIL) while it is in scope,
+/// if the interpreter is running and the calling thread holds the lock, so
+/// that Python threads, e.g. those of cyclus.server, run while C++ works.
+/// Python agents and the hooks below take the lock back whenever they are
+/// called. This is a no-op when Python was not installed with Cyclus.
+class PyGilRelease {
+ public:
+  PyGilRelease();
+  ~PyGilRelease();
+
+ private:
+  PyGilRelease(const PyGilRelease&);
+  PyGilRelease& operator=(const PyGilRelease&);
+
+  void* state_;
+};
+
+/// Holds the Python global interpreter lock while it is in scope, taking it
+/// if the calling thread doesn't have it and the interpreter is running.
+/// This is a no-op when Python was not installed with Cyclus.
+class PyGilAcquire {
+ public:
+  PyGilAcquire();
+  ~PyGilAcquire();
+
+ private:
+  PyGilAcquire(const PyGilAcquire&);
+  PyGilAcquire& operator=(const PyGilAcquire&);
+
+  bool acquired_;
+  int state_;
+};
+
 // Add some simple shims that attach C++ to Python C hooks
+
+/// Calls the Python event loop hook, which runs the actions of an attached
+/// cyclus.server, if it has work to do, i.e., if PyNotifyEventLoop has been
+/// called since it last ran, and if at least EventLoopInterval seconds have
+/// passed since then. Otherwise it returns at once, without taking the
+/// Python global interpreter lock. The hook runs once at first, so that a
+/// server attached before the simulation starts gets to arm it.
 void EventLoop(void);
 
+/// Marks that the Python event loop hook has work to do, e.g., because an
+/// action was queued. It is safe to call from any thread, with or without
+/// the Python global interpreter lock.
+void PyNotifyEventLoop(void);
+
+/// Returns the least number of wall-clock seconds between calls of the
+/// Python event loop hook. It is 0, i.e. the hook runs at every time step
+/// with work to do, unless set with SetEventLoopInterval or the
+/// CYCLUS_EVENT_LOOP_INTERVAL environment variable.
+double EventLoopInterval(void);
+
+/// Sets the least number of wall-clock seconds between calls of the Python
+/// event loop hook.
+void SetEventLoopInterval(double secs);
+
 /// Finds a Python module and returns its filename.
 std::string PyFindModule(std::string);
 
@@ -64,6 +120,11 @@ std::string JsonToPy(std::string);
 /// Calls the Python listeners
 void PyCallListeners(std::string tsname, Agent* agent, void* cpp_ctx, int time, boost::spirit::hold_any value);
 
+/// Calls the batched Python listeners of a time series with the agent ids and
+/// values recorded to it during a time step
+void PyCallBatchListeners(const std::string& tsname, int time,
+                          std::vector<int>* ids, std::vector<double>* values);
+
 }  // ends namespace toolkit
 }  // ends namespace cyclus
 #endif  // ends CYCLUS_SRC_PYHOOKS_H_
@@ -1,5 +1,6 @@
 """Header for Cyclus Python Input Files."""
 from libcpp.string cimport string as std_string
+from libcpp.vector cimport vector as std_vector
 from libcpp.typeinfo cimport type_info
 from cpython.pycapsule cimport PyCapsule_New, PyCapsule_GetPointer
 
@@ -62,3 +63,7 @@ cdef public void py_del_agent "CyclusPyDelAgent" (int i) except +
 
 cdef public void py_call_listeners "CyclusPyCallListeners" (std_string cpp_tsname,
                             Agent* cpp_agent, void* cpp_ctx, int time, hold_any cpp_value) except +
+
+cdef public void py_call_batch_listeners "CyclusPyCallBatchListeners" (
+        std_string cpp_tsname, int time, std_vector[int]* cpp_ids,
+        std_vector[double]* cpp_values) except +
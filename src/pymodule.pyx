@@ -2,11 +2,15 @@
 from __future__ import print_function, unicode_literals
 from libcpp.cast cimport reinterpret_cast, dynamic_cast
 from libcpp.string cimport string as std_string
+from libcpp.vector cimport vector as std_vector
+from libc.string cimport memcpy
 from cpython.exc cimport PyErr_CheckSignals
 from cpython.pycapsule cimport PyCapsule_New, PyCapsule_GetPointer
 
 from importlib import import_module
 
+import numpy as np
+
 import cyclus.lib as cyclib
 import cyclus.typesystem as ts
 
@@ -96,3 +100,21 @@ cdef public void py_call_listeners "CyclusPyCallListeners" (std_string cpp_tsnam
     py_value = ts.capsule_any_to_py(value)
     cyclib.call_listeners(py_tsname, py_agent, time, py_value)
     PyErr_CheckSignals()
+
+
+cdef public void py_call_batch_listeners "CyclusPyCallBatchListeners" (
+        std_string cpp_tsname, int time, std_vector[int]* cpp_ids,
+        std_vector[double]* cpp_values) except +:
+    """Calls the batched python time series listeners with the agent ids and
+    values of a time step, as arrays.
+    """
+    cdef size_t n = cpp_ids.size()
+    ids = np.empty(n, dtype=np.intc)
+    values = np.empty(n, dtype=np.float64)
+    cdef int[::1] ids_view = ids
+    cdef double[::1] values_view = values
+    if n > 0:
+        memcpy(&ids_view[0], &cpp_ids[0][0], n * sizeof(int))
+        memcpy(&values_view[0], &cpp_values[0][0], n * sizeof(double))
+    cyclib.call_batch_listeners(std_string_to_py(cpp_tsname), time, ids, values)
+    PyErr_CheckSignals()
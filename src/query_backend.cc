@@ -0,0 +1,910 @@
+#include "query_backend.h"
+
+#include <utility>
+
+#include <boost/uuid/uuid.hpp>
+
+#include "lineage_index.h"
+
+namespace cyclus {
+
+namespace {
+
+/// The number of rows read from a cursor at a time by the default Aggregate.
+const int kAggBatchRows = 10000;
+
+bool Comparable(DbTypes t) {
+  switch (t) {
+    case BOOL:
+    case INT:
+    case FLOAT:
+    case DOUBLE:
+    case STRING:
+    case VL_STRING:
+    case UUID:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool Summable(DbTypes t) {
+  return t == BOOL || t == INT || t == FLOAT || t == DOUBLE;
+}
+
+template <typename T>
+int Compare(const boost::spirit::hold_any& a,
+            const boost::spirit::hold_any& b) {
+  const T& x = a.cast<T>();
+  const T& y = b.cast<T>();
+  return x < y ? -1 : (y < x ? 1 : 0);
+}
+
+int CompareVals(const boost::spirit::hold_any& a,
+                const boost::spirit::hold_any& b, DbTypes t) {
+  switch (t) {
+    case BOOL:
+      return Compare<bool>(a, b);
+    case INT:
+      return Compare<int>(a, b);
+    case FLOAT:
+      return Compare<float>(a, b);
+    case DOUBLE:
+      return Compare<double>(a, b);
+    case STRING:
+    case VL_STRING:
+      return Compare<std::string>(a, b);
+    case UUID:
+      return Compare<boost::uuids::uuid>(a, b);
+    default:
+      throw ValueError("values of this type cannot be compared");
+  }
+}
+
+double ToDouble(const boost::spirit::hold_any& v, DbTypes t) {
+  switch (t) {
+    case BOOL:
+      return v.cast<bool>() ? 1 : 0;
+    case INT:
+      return v.cast<int>();
+    case FLOAT:
+      return v.cast<float>();
+    case DOUBLE:
+      return v.cast<double>();
+    default:
+      throw ValueError("values of this type cannot be summed");
+  }
+}
+
+/// How a column of a classic table is rebuilt from its compact table.
+enum CompactSource {
+  COMPACT_COPY,  ///< the column of the compact table with the given name
+  COMPACT_LOOKUP,  ///< the column of the lookup table with the given name
+  COMPACT_DELTA,  ///< ResourceId less the given column of the compact table
+  COMPACT_PARENT,  ///< as COMPACT_DELTA, except that 0 stays 0
+};
+
+struct CompactCol {
+  const char* field;
+  const char* src;
+  CompactSource how;
+};
+
+struct CompactTable {
+  const char* table;
+  const char* compact;
+  const char* lookup;
+  /// the id column shared by the compact table and its lookup table
+  const char* key;
+  const CompactCol* cols;
+  int ncols;
+};
+
+// these mirror ResourcesWriter and TransactionsWriter
+const CompactCol kResourcesCols[] = {
+    {"ResourceId", "ResourceId", COMPACT_COPY},
+    {"ObjId", "ObjIdDelta", COMPACT_DELTA},
+    {"Type", "Type", COMPACT_LOOKUP},
+    {"TimeCreated", "TimeCreated", COMPACT_COPY},
+    {"Quantity", "Quantity", COMPACT_COPY},
+    {"Units", "Units", COMPACT_LOOKUP},
+    {"QualId", "QualId", COMPACT_COPY},
+    {"Parent1", "Parent1Delta", COMPACT_PARENT},
+    {"Parent2", "Parent2Delta", COMPACT_PARENT},
+};
+
+const CompactCol kTransactionsCols[] = {
+    {"TransactionId", "TransactionId", COMPACT_COPY},
+    {"SenderId", "SenderId", COMPACT_COPY},
+    {"ReceiverId", "ReceiverId", COMPACT_COPY},
+    {"ResourceId", "ResourceId", COMPACT_COPY},
+    {"Commodity", "Commodity", COMPACT_LOOKUP},
+    {"Time", "Time", COMPACT_COPY},
+};
+
+const CompactTable kCompactTables[] = {
+    {"Resources", "CompactResources", "ResourceTypes", "TypeId",
+     kResourcesCols, sizeof(kResourcesCols) / sizeof(*kResourcesCols)},
+    {"Transactions", "CompactTransactions", "Commodities", "CommodityId",
+     kTransactionsCols, sizeof(kTransactionsCols) / sizeof(*kTransactionsCols)},
+};
+
+/// A classic table of one row per nuclide rebuilt from its dense table,
+/// whose rows hold the values of all their nuclides in an array (see
+/// NuclideIndex).
+struct DenseTable {
+  const char* table;
+  const char* dense;
+  /// the columns the dense table holds unchanged
+  const char* const* keys;
+  int nkeys;
+  /// the array column of the dense table
+  const char* data;
+  /// the value column of the classic table
+  const char* value;
+};
+
+// these mirror CompositionsWriter and InventoryWriter
+const char* const kCompositionsKeys[] = {"QualId"};
+const char* const kInventoryKeys[] = {"AgentId", "Time", "InventoryName"};
+
+const DenseTable kDenseTables[] = {
+    {"Compositions", "DenseCompositions", kCompositionsKeys, 1, "MassFracs",
+     "MassFrac"},
+    {"ExplicitInventory", "DenseInventory", kInventoryKeys, 3, "Masses",
+     "Quantity"},
+};
+
+const CompactTable* FindCompact(const std::string& table) {
+  int n = sizeof(kCompactTables) / sizeof(*kCompactTables);
+  for (int i = 0; i < n; ++i) {
+    if (table == kCompactTables[i].table) {
+      return &kCompactTables[i];
+    }
+  }
+  return NULL;
+}
+
+const DenseTable* FindDense(const std::string& table) {
+  int n = sizeof(kDenseTables) / sizeof(*kDenseTables);
+  for (int i = 0; i < n; ++i) {
+    if (table == kDenseTables[i].table) {
+      return &kDenseTables[i];
+    }
+  }
+  return NULL;
+}
+
+bool IsKey(const DenseTable& dt, const std::string& field) {
+  return std::find(dt.keys, dt.keys + dt.nkeys, field) != dt.keys + dt.nkeys;
+}
+
+const CompactCol* FindCol(const CompactTable& ct, const std::string& field) {
+  for (int i = 0; i < ct.ncols; ++i) {
+    if (field == ct.cols[i].field) {
+      return &ct.cols[i];
+    }
+  }
+  return NULL;
+}
+
+int FieldIndex(const QueryResult& qr, const std::string& field) {
+  std::vector<std::string>::const_iterator it =
+      std::find(qr.fields.begin(), qr.fields.end(), field);
+  if (it == qr.fields.end()) {
+    throw KeyError("no field '" + field + "' in query result");
+  }
+  return it - qr.fields.begin();
+}
+
+const ColumnInfo* FindInfo(const std::list<ColumnInfo>& schema,
+                           const std::string& col) {
+  std::list<ColumnInfo>::const_iterator it;
+  for (it = schema.begin(); it != schema.end(); ++it) {
+    if (it->col == col) {
+      return &(*it);
+    }
+  }
+  throw KeyError("no column '" + col + "' in compact table");
+}
+
+bool Satisfies(const boost::spirit::hold_any& v, DbTypes t, Cond* c) {
+  switch (t) {
+    case INT: {
+      int x = v.cast<int>();
+      return CmpCond(&x, c);
+    }
+    case DOUBLE: {
+      double x = v.cast<double>();
+      return CmpCond(&x, c);
+    }
+    case STRING:
+    case VL_STRING: {
+      std::string x = v.cast<std::string>();
+      return CmpCond(&x, c);
+    }
+    default:
+      throw ValueError("cannot test conditions on field '" + c->field + "'");
+  }
+}
+
+// rebuilds the rows of the classic table of a dense table, one per nuclide
+// with a non-zero value in the array of each dense row
+QueryResult ExpandDense(QueryableBackend* b, const DenseTable& dt,
+                        std::vector<Cond>* conds,
+                        std::vector<std::string>* fields) {
+  std::vector<Cond> pass;
+  std::vector<Cond> sim;
+  std::vector<Cond> post;
+  if (conds != NULL) {
+    for (int i = 0; i < conds->size(); ++i) {
+      const Cond& c = (*conds)[i];
+      if (c.field == "SimId") {
+        pass.push_back(c);
+        sim.push_back(c);
+      } else if (IsKey(dt, c.field)) {
+        pass.push_back(c);
+      } else {
+        post.push_back(c);
+      }
+    }
+  }
+  QueryResult rows = b->Query(dt.dense, pass.empty() ? NULL : &pass);
+  QueryResult index = b->Query("NuclideIndex", sim.empty() ? NULL : &sim);
+
+  // the nuclide at each position of the arrays of each simulation
+  int isim = FieldIndex(index, "SimId");
+  int ipos = FieldIndex(index, "NucIndex");
+  int inuc = FieldIndex(index, "NucId");
+  std::map<boost::uuids::uuid, std::vector<int> > nucs;
+  for (int i = 0; i < index.rows.size(); ++i) {
+    std::vector<int>& v =
+        nucs[index.rows[i][isim].cast<boost::uuids::uuid>()];
+    int pos = index.rows[i][ipos].cast<int>();
+    if (pos >= v.size()) {
+      v.resize(pos + 1, 0);
+    }
+    v[pos] = index.rows[i][inuc].cast<int>();
+  }
+
+  QueryResult qr;
+  int rsim = FieldIndex(rows, "SimId");
+  int rdata = FieldIndex(rows, dt.data);
+  qr.fields.push_back("SimId");
+  qr.types.push_back(rows.types[rsim]);
+  std::vector<int> src(dt.nkeys);
+  for (int j = 0; j < dt.nkeys; ++j) {
+    src[j] = FieldIndex(rows, dt.keys[j]);
+    qr.fields.push_back(dt.keys[j]);
+    qr.types.push_back(rows.types[src[j]]);
+  }
+  qr.fields.push_back("NucId");
+  qr.types.push_back(INT);
+  qr.fields.push_back(dt.value);
+  qr.types.push_back(DOUBLE);
+  std::vector<int> post_cols(post.size());
+  for (int k = 0; k < post.size(); ++k) {
+    post_cols[k] = FieldIndex(qr, post[k].field);
+  }
+
+  for (int i = 0; i < rows.rows.size(); ++i) {
+    const QueryRow& row = rows.rows[i];
+    const std::vector<int>& ids = nucs[row[rsim].cast<boost::uuids::uuid>()];
+    const std::vector<double>& vals =
+        row[rdata].cast<std::vector<double> >();
+    size_t n = vals.size();
+    if (n > ids.size()) {
+      throw ValueError("table NuclideIndex is missing a nuclide used by " +
+                       std::string(dt.dense));
+    }
+    for (size_t k = 0; k < n; ++k) {
+      double val = vals[k];
+      if (val == 0) {
+        continue;
+      }
+      QueryRow r;
+      r.push_back(row[rsim]);
+      for (int j = 0; j < dt.nkeys; ++j) {
+        r.push_back(row[src[j]]);
+      }
+      r.push_back(ids[k]);
+      r.push_back(val);
+
+      bool keep = true;
+      for (int p = 0; keep && p < post.size(); ++p) {
+        keep = Satisfies(r[post_cols[p]], qr.types[post_cols[p]], &post[p]);
+      }
+      if (keep) {
+        qr.rows.push_back(r);
+      }
+    }
+  }
+
+  if (fields != NULL) {
+    qr.Project(*fields);
+  }
+  return qr;
+}
+
+}  // namespace
+
+Aggregator::Aggregator(const std::vector<std::string>& group_by,
+                       const std::vector<Agg>& aggs,
+                       const std::map<std::string, DbTypes>& types)
+    : group_by_(group_by),
+      aggs_(aggs) {
+  std::vector<std::string> names = group_by;
+  for (int i = 0; i < aggs.size(); ++i) {
+    if (aggs[i].opcode != AGG_COUNT) {
+      names.push_back(aggs[i].field);
+    }
+  }
+  for (int i = 0; i < names.size(); ++i) {
+    std::map<std::string, DbTypes>::const_iterator it = types.find(names[i]);
+    if (it == types.end()) {
+      throw KeyError("table has no field '" + names[i] + "' to aggregate");
+    }
+    if (std::find(fields_.begin(), fields_.end(), names[i]) == fields_.end()) {
+      fields_.push_back(names[i]);
+      types_.push_back(it->second);
+    }
+  }
+
+  for (int i = 0; i < group_by.size(); ++i) {
+    if (!Comparable(types_[i])) {
+      throw ValueError("cannot group by field '" + group_by[i] + "'");
+    }
+  }
+  for (int i = 0; i < aggs.size(); ++i) {
+    if (aggs[i].opcode == AGG_COUNT) {
+      agg_cols_.push_back(-1);
+      continue;
+    }
+    int col = std::find(fields_.begin(), fields_.end(), aggs[i].field) -
+              fields_.begin();
+    agg_cols_.push_back(col);
+    bool ok = aggs[i].opcode == AGG_SUM ? Summable(types_[col])
+                                        : Comparable(types_[col]);
+    if (!ok) {
+      throw ValueError("cannot aggregate field '" + aggs[i].field + "' with " +
+                       aggs[i].op);
+    }
+  }
+  std::vector<DbTypes> keytypes(types_.begin(),
+                                types_.begin() + group_by.size());
+  groups_ = std::map<QueryRow, Group, RowLess>(RowLess(keytypes));
+}
+
+void Aggregator::Add(const QueryRow& row) {
+  std::vector<int> cols(fields_.size());
+  for (int i = 0; i < cols.size(); ++i) {
+    cols[i] = i;
+  }
+  Add(row, cols);
+}
+
+void Aggregator::Add(const QueryRow& row, const std::vector<int>& cols) {
+  QueryRow key(group_by_.size());
+  for (int i = 0; i < key.size(); ++i) {
+    key[i] = row[cols[i]];
+  }
+  std::map<QueryRow, Group, RowLess>::iterator it = groups_.find(key);
+  if (it == groups_.end()) {
+    Group g;
+    g.count = 0;
+    g.sums.assign(aggs_.size(), 0);
+    g.extremes.resize(aggs_.size());
+    it = groups_.insert(std::make_pair(key, g)).first;
+  }
+
+  Group& g = it->second;
+  for (int i = 0; i < aggs_.size(); ++i) {
+    int col = agg_cols_[i];
+    if (col < 0) {
+      continue;
+    }
+    const boost::spirit::hold_any& v = row[cols[col]];
+    switch (aggs_[i].opcode) {
+      case AGG_SUM: {
+        g.sums[i] += ToDouble(v, types_[col]);
+        break;
+      }
+      case AGG_MIN: {
+        if (g.count == 0 || CompareVals(v, g.extremes[i], types_[col]) < 0) {
+          g.extremes[i] = v;
+        }
+        break;
+      }
+      case AGG_MAX: {
+        if (g.count == 0 || CompareVals(v, g.extremes[i], types_[col]) > 0) {
+          g.extremes[i] = v;
+        }
+        break;
+      }
+      default: {
+        break;
+      }
+    }
+  }
+  ++g.count;
+}
+
+void Aggregator::Merge(const Aggregator& other) {
+  std::map<QueryRow, Group, RowLess>::const_iterator it;
+  for (it = other.groups_.begin(); it != other.groups_.end(); ++it) {
+    std::map<QueryRow, Group, RowLess>::iterator mine =
+        groups_.find(it->first);
+    if (mine == groups_.end()) {
+      groups_.insert(*it);
+    } else {
+      MergeGroup(it->second, &mine->second);
+    }
+  }
+}
+
+void Aggregator::MergeGroup(const Group& other, Group* g) const {
+  for (int i = 0; i < aggs_.size(); ++i) {
+    int col = agg_cols_[i];
+    if (aggs_[i].opcode == AGG_SUM) {
+      g->sums[i] += other.sums[i];
+    } else if (aggs_[i].opcode == AGG_MIN &&
+               CompareVals(other.extremes[i], g->extremes[i],
+                           types_[col]) < 0) {
+      g->extremes[i] = other.extremes[i];
+    } else if (aggs_[i].opcode == AGG_MAX &&
+               CompareVals(other.extremes[i], g->extremes[i],
+                           types_[col]) > 0) {
+      g->extremes[i] = other.extremes[i];
+    }
+  }
+  g->count += other.count;
+}
+
+QueryResult Aggregator::Result() const {
+  QueryResult qr;
+  for (int i = 0; i < group_by_.size(); ++i) {
+    qr.fields.push_back(group_by_[i]);
+    qr.types.push_back(types_[i]);
+  }
+  for (int i = 0; i < aggs_.size(); ++i) {
+    qr.fields.push_back(aggs_[i].name());
+    switch (aggs_[i].opcode) {
+      case AGG_COUNT: {
+        qr.types.push_back(INT);
+        break;
+      }
+      case AGG_SUM: {
+        qr.types.push_back(DOUBLE);
+        break;
+      }
+      default: {
+        qr.types.push_back(types_[agg_cols_[i]]);
+        break;
+      }
+    }
+  }
+
+  std::map<QueryRow, Group, RowLess>::const_iterator it;
+  for (it = groups_.begin(); it != groups_.end(); ++it) {
+    const Group& g = it->second;
+    QueryRow row = it->first;
+    for (int i = 0; i < aggs_.size(); ++i) {
+      switch (aggs_[i].opcode) {
+        case AGG_COUNT: {
+          row.push_back(g.count);
+          break;
+        }
+        case AGG_SUM: {
+          row.push_back(g.sums[i]);
+          break;
+        }
+        default: {
+          row.push_back(g.extremes[i]);
+          break;
+        }
+      }
+    }
+    qr.rows.push_back(row);
+  }
+  return qr;
+}
+
+bool Aggregator::RowLess::operator()(const QueryRow& a,
+                                     const QueryRow& b) const {
+  for (int i = 0; i < types_.size(); ++i) {
+    int c = CompareVals(a[i], b[i], types_[i]);
+    if (c != 0) {
+      return c < 0;
+    }
+  }
+  return false;
+}
+
+QueryResult QueryableBackend::Aggregate(std::string table,
+                                        std::vector<Cond>* conds,
+                                        std::vector<std::string>* group_by,
+                                        const std::vector<Agg>& aggs) {
+  Aggregator agg(group_by == NULL ? std::vector<std::string>() : *group_by,
+                 aggs, ColumnTypes(table));
+  std::vector<std::string> fields = agg.fields();
+  QueryCursor::Ptr cursor = Cursor(table, conds, &fields);
+  for (QueryResult batch = cursor->Next(kAggBatchRows); !batch.rows.empty();
+       batch = cursor->Next(kAggBatchRows)) {
+    for (int i = 0; i < batch.rows.size(); ++i) {
+      agg.Add(batch.rows[i]);
+    }
+  }
+  return agg.Result();
+}
+
+namespace {
+
+// reads the parents, children, and transactions of resources from the
+// lineage index of a backend, a page at a time, or from its Resources and
+// Transactions tables if it has no index
+class LineageReader {
+ public:
+  LineageReader(QueryableBackend* b, std::vector<Cond>* conds)
+      : b_(b),
+        indexed_(b->Tables().count("LineageIndex") > 0) {
+    if (conds != NULL)
+      conds_ = *conds;
+  }
+
+  const LineageEntry& Entry(int id) {
+    std::map<int, LineageEntry>::iterator it = entries_.find(id);
+    if (it != entries_.end())
+      return it->second;
+    if (indexed_) {
+      ReadPage(id / LineageIndexer::kPageSize);
+      return entries_[id];
+    }
+
+    LineageEntry& e = entries_[id];
+    QueryResult qr = Query("Resources", "ResourceId", id, "Parent1", "Parent2");
+    for (int i = 0; i < qr.rows.size(); ++i) {
+      AddIds(qr, i, &e.parents);
+    }
+    const char* parents[] = {"Parent1", "Parent2"};
+    for (int j = 0; j < 2; ++j) {
+      qr = Query("Resources", parents[j], id, "ResourceId", NULL);
+      for (int i = 0; i < qr.rows.size(); ++i) {
+        AddIds(qr, i, &e.children);
+      }
+    }
+    qr = Query("Transactions", "ResourceId", id, "TransactionId", NULL);
+    for (int i = 0; i < qr.rows.size(); ++i) {
+      AddIds(qr, i, &e.transactions);
+    }
+    Unique(&e.parents);
+    Unique(&e.children);
+    Unique(&e.transactions);
+    return e;
+  }
+
+ private:
+  void ReadPage(int page) {
+    if (!pages_.insert(page).second)
+      return;
+    std::vector<Cond> conds(conds_);
+    conds.push_back(Cond("Page", "==", page));
+    std::vector<std::string> fields(1, "Data");
+    QueryResult qr = b_->Query("LineageIndex", &conds, &fields);
+    for (int i = 0; i < qr.rows.size(); ++i) {
+      LineageIndexer::DecodePage(qr.GetVal<Blob>(0, i), &entries_);
+    }
+  }
+
+  // the field values, or both fields' values, of the rows of a table in
+  // which key is id
+  QueryResult Query(const char* table, const char* key, int id,
+                    const char* field, const char* field2) {
+    std::vector<Cond> conds(conds_);
+    conds.push_back(Cond(key, "==", id));
+    std::vector<std::string> fields(1, field);
+    if (field2 != NULL)
+      fields.push_back(field2);
+    return b_->Query(table, &conds, &fields);
+  }
+
+  // adds the non-zero ids of a row of a query result
+  static void AddIds(const QueryResult& qr, int row, std::vector<int>* ids) {
+    for (int i = 0; i < qr.fields.size(); ++i) {
+      int id = qr.rows[row][i].cast<int>();
+      if (id != 0)
+        ids->push_back(id);
+    }
+  }
+
+  static void Unique(std::vector<int>* ids) {
+    std::sort(ids->begin(), ids->end());
+    ids->erase(std::unique(ids->begin(), ids->end()), ids->end());
+  }
+
+  QueryableBackend* b_;
+  std::vector<Cond> conds_;
+  bool indexed_;
+  std::set<int> pages_;
+  std::map<int, LineageEntry> entries_;
+};
+
+// follows the parents, if up, or the children of a resource breadth first
+Lineage Trace(QueryableBackend* b, int resource_id, int max_depth,
+              std::vector<Cond>* conds, bool up) {
+  LineageReader reader(b, conds);
+  Lineage l;
+  std::set<int> seen;
+  std::set<int> transactions;
+  std::vector<int> frontier(1, resource_id);
+  seen.insert(resource_id);
+  for (int depth = 1; !frontier.empty(); ++depth) {
+    std::vector<int> next;
+    for (int i = 0; i < frontier.size(); ++i) {
+      const LineageEntry& e = reader.Entry(frontier[i]);
+      transactions.insert(e.transactions.begin(), e.transactions.end());
+      if (max_depth >= 0 && depth > max_depth)
+        continue;
+      const std::vector<int>& relatives = up ? e.parents : e.children;
+      for (int j = 0; j < relatives.size(); ++j) {
+        if (!seen.insert(relatives[j]).second)
+          continue;
+        next.push_back(relatives[j]);
+        l.resources.push_back(relatives[j]);
+        l.depths.push_back(depth);
+      }
+    }
+    frontier.swap(next);
+  }
+  l.transactions.assign(transactions.begin(), transactions.end());
+  return l;
+}
+
+}  // namespace
+
+Lineage QueryableBackend::Ancestors(int resource_id, int max_depth,
+                                    std::vector<Cond>* conds) {
+  return Trace(this, resource_id, max_depth, conds, true);
+}
+
+Lineage QueryableBackend::Descendants(int resource_id, int max_depth,
+                                      std::vector<Cond>* conds) {
+  return Trace(this, resource_id, max_depth, conds, false);
+}
+
+QueryResult CompactExpander::Query(std::string table,
+                                   std::vector<Cond>* conds,
+                                   std::vector<std::string>* fields) {
+  if (!Expanded(table)) {
+    return b_->Query(table, conds, fields);
+  }
+  const DenseTable* dt = FindDense(table);
+  if (dt != NULL) {
+    return ExpandDense(b_, *dt, conds, fields);
+  }
+  const CompactTable& ct = *FindCompact(table);
+
+  std::vector<Cond> pass;
+  std::vector<Cond> sim;
+  std::vector<Cond> post;
+  if (conds != NULL) {
+    for (int i = 0; i < conds->size(); ++i) {
+      const Cond& c = (*conds)[i];
+      const CompactCol* col = FindCol(ct, c.field);
+      if (c.field == "SimId") {
+        pass.push_back(c);
+        sim.push_back(c);
+      } else if (col != NULL && col->how == COMPACT_COPY) {
+        pass.push_back(c);
+      } else {
+        post.push_back(c);
+      }
+    }
+  }
+  QueryResult rows = b_->Query(ct.compact, pass.empty() ? NULL : &pass);
+  QueryResult lookup = b_->Query(ct.lookup, sim.empty() ? NULL : &sim);
+
+  int lsim = FieldIndex(lookup, "SimId");
+  int lkey = FieldIndex(lookup, ct.key);
+  std::map<std::pair<boost::uuids::uuid, int>, int> entries;
+  for (int i = 0; i < lookup.rows.size(); ++i) {
+    entries[std::make_pair(lookup.rows[i][lsim].cast<boost::uuids::uuid>(),
+                           lookup.rows[i][lkey].cast<int>())] = i;
+  }
+
+  QueryResult qr;
+  int rsim = FieldIndex(rows, "SimId");
+  int rkey = FieldIndex(rows, ct.key);
+  qr.fields.push_back("SimId");
+  qr.types.push_back(rows.types[rsim]);
+  std::vector<int> src(ct.ncols);
+  int rid = -1;
+  for (int j = 0; j < ct.ncols; ++j) {
+    const CompactCol& col = ct.cols[j];
+    qr.fields.push_back(col.field);
+    if (col.how == COMPACT_LOOKUP) {
+      src[j] = FieldIndex(lookup, col.src);
+      qr.types.push_back(lookup.types[src[j]]);
+    } else {
+      src[j] = FieldIndex(rows, col.src);
+      qr.types.push_back(col.how == COMPACT_COPY ? rows.types[src[j]] : INT);
+    }
+    if (col.how == COMPACT_DELTA || col.how == COMPACT_PARENT) {
+      rid = FieldIndex(rows, "ResourceId");
+    }
+  }
+  std::vector<int> post_cols(post.size());
+  for (int k = 0; k < post.size(); ++k) {
+    post_cols[k] = FieldIndex(qr, post[k].field);
+  }
+
+  for (int i = 0; i < rows.rows.size(); ++i) {
+    const QueryRow& row = rows.rows[i];
+    std::map<std::pair<boost::uuids::uuid, int>, int>::iterator it =
+        entries.find(std::make_pair(row[rsim].cast<boost::uuids::uuid>(),
+                                    row[rkey].cast<int>()));
+    if (it == entries.end()) {
+      throw ValueError("table " + std::string(ct.lookup) +
+                       " is missing an id used by " + ct.compact);
+    }
+    const QueryRow& entry = lookup.rows[it->second];
+
+    QueryRow r;
+    r.push_back(row[rsim]);
+    for (int j = 0; j < ct.ncols; ++j) {
+      switch (ct.cols[j].how) {
+        case COMPACT_COPY: {
+          r.push_back(row[src[j]]);
+          break;
+        }
+        case COMPACT_LOOKUP: {
+          r.push_back(entry[src[j]]);
+          break;
+        }
+        case COMPACT_DELTA: {
+          r.push_back(row[rid].cast<int>() - row[src[j]].cast<int>());
+          break;
+        }
+        case COMPACT_PARENT: {
+          int d = row[src[j]].cast<int>();
+          r.push_back(d == 0 ? 0 : row[rid].cast<int>() - d);
+          break;
+        }
+      }
+    }
+
+    bool keep = true;
+    for (int k = 0; keep && k < post.size(); ++k) {
+      keep = Satisfies(r[post_cols[k]], qr.types[post_cols[k]], &post[k]);
+    }
+    if (keep) {
+      qr.rows.push_back(r);
+    }
+  }
+
+  if (fields != NULL) {
+    qr.Project(*fields);
+  }
+  return qr;
+}
+
+std::map<std::string, DbTypes> CompactExpander::ColumnTypes(
+    std::string table) {
+  if (!Expanded(table)) {
+    return b_->ColumnTypes(table);
+  }
+  const DenseTable* dt = FindDense(table);
+  if (dt != NULL) {
+    std::map<std::string, DbTypes> dense = b_->ColumnTypes(dt->dense);
+    std::map<std::string, DbTypes> types;
+    if (dense.count("SimId") > 0) {
+      types["SimId"] = dense["SimId"];
+    }
+    for (int j = 0; j < dt->nkeys; ++j) {
+      types[dt->keys[j]] = dense[dt->keys[j]];
+    }
+    types["NucId"] = INT;
+    types[dt->value] = DOUBLE;
+    return types;
+  }
+  const CompactTable& ct = *FindCompact(table);
+  std::map<std::string, DbTypes> compact = b_->ColumnTypes(ct.compact);
+  std::map<std::string, DbTypes> lookup = b_->ColumnTypes(ct.lookup);
+  std::map<std::string, DbTypes> types;
+  if (compact.count("SimId") > 0) {
+    types["SimId"] = compact["SimId"];
+  }
+  for (int j = 0; j < ct.ncols; ++j) {
+    const CompactCol& col = ct.cols[j];
+    if (col.how == COMPACT_COPY) {
+      types[col.field] = compact[col.src];
+    } else if (col.how == COMPACT_LOOKUP) {
+      types[col.field] = lookup[col.src];
+    } else {
+      types[col.field] = INT;
+    }
+  }
+  return types;
+}
+
+std::list<ColumnInfo> CompactExpander::Schema(std::string table) {
+  if (!Expanded(table)) {
+    return b_->Schema(table);
+  }
+  const DenseTable* dt = FindDense(table);
+  if (dt != NULL) {
+    std::list<ColumnInfo> dense = b_->Schema(dt->dense);
+    std::list<ColumnInfo> schema;
+    std::list<ColumnInfo>::iterator it;
+    for (it = dense.begin(); it != dense.end(); ++it) {
+      if (it->col == "SimId" || IsKey(*dt, it->col)) {
+        schema.push_back(*it);
+        schema.back().table = table;
+        schema.back().index = schema.size() - 1;
+      }
+    }
+    schema.push_back(ColumnInfo(table, "NucId", schema.size(), INT,
+                                std::vector<int>()));
+    schema.push_back(ColumnInfo(table, dt->value, schema.size(), DOUBLE,
+                                std::vector<int>()));
+    return schema;
+  }
+  const CompactTable& ct = *FindCompact(table);
+  std::list<ColumnInfo> compact = b_->Schema(ct.compact);
+  std::list<ColumnInfo> lookup = b_->Schema(ct.lookup);
+  std::list<ColumnInfo> schema;
+  std::list<ColumnInfo>::iterator it;
+  for (it = compact.begin(); it != compact.end(); ++it) {
+    if (it->col == "SimId") {
+      schema.push_back(*it);
+      schema.back().table = table;
+      schema.back().index = 0;
+    }
+  }
+  for (int j = 0; j < ct.ncols; ++j) {
+    const CompactCol& col = ct.cols[j];
+    ColumnInfo info = *FindInfo(col.how == COMPACT_LOOKUP ? lookup : compact,
+                                col.src);
+    info.table = table;
+    info.col = col.field;
+    info.index = schema.size();
+    schema.push_back(info);
+  }
+  return schema;
+}
+
+std::set<std::string> CompactExpander::Tables() {
+  std::set<std::string> tables = b_->Tables();
+  int n = sizeof(kCompactTables) / sizeof(*kCompactTables);
+  for (int i = 0; i < n; ++i) {
+    if (tables.count(kCompactTables[i].compact) > 0) {
+      tables.insert(kCompactTables[i].table);
+    }
+  }
+  n = sizeof(kDenseTables) / sizeof(*kDenseTables);
+  for (int i = 0; i < n; ++i) {
+    if (tables.count(kDenseTables[i].dense) > 0) {
+      tables.insert(kDenseTables[i].table);
+    }
+  }
+  return tables;
+}
+
+const char* CompactExpander::Source(const std::string& table) {
+  const CompactTable* ct = FindCompact(table);
+  if (ct != NULL) {
+    return ct->compact;
+  }
+  const DenseTable* dt = FindDense(table);
+  return dt == NULL ? NULL : dt->dense;
+}
+
+bool CompactExpander::Expanded(const std::string& table) {
+  const char* src = Source(table);
+  if (src == NULL) {
+    return false;
+  }
+  std::set<std::string> tables = b_->Tables();
+  return tables.count(table) == 0 && tables.count(src) > 0;
+}
+
+}  // namespace cyclus
@@ -1,11 +1,16 @@
 #ifndef CYCLUS_SRC_QUERY_BACKEND_H_
 #define CYCLUS_SRC_QUERY_BACKEND_H_
 
+#include <algorithm>
 #include <climits>
 #include <list>
 #include <map>
 #include <set>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
 
+#include <boost/shared_ptr.hpp>
 #include <boost/uuid/sha1.hpp>
 
 #include "blob.h"
@@ -399,6 +404,54 @@ class Cond {
   boost::spirit::hold_any val;
 };
 
+/// Represents aggregation operation codes.
+enum AggOpCode {
+  AGG_COUNT,
+  AGG_SUM,
+  AGG_MIN,
+  AGG_MAX
+};
+
+/// Represents an aggregate computed over the rows matched by a query (see
+/// QueryableBackend::Aggregate).
+class Agg {
+ public:
+  Agg() {}
+
+  /// @param op one of "count", "sum", "min", "max"
+  /// @param field the column aggregated, which count ignores
+  Agg(std::string op, std::string field = "")
+      : op(op),
+        field(field) {
+    if (op == "count")
+      opcode = AGG_COUNT;
+    else if (op == "sum")
+      opcode = AGG_SUM;
+    else if (op == "min")
+      opcode = AGG_MIN;
+    else if (op == "max")
+      opcode = AGG_MAX;
+    else
+      throw ValueError("aggregate '" + op + "' not valid for field '" +
+                       field + "'.");
+  }
+
+  /// Returns the name of the aggregate's column in a result, e.g.,
+  /// "sum(Quantity)", or "count" for counts.
+  std::string name() const {
+    return opcode == AGG_COUNT ? op : op + "(" + field + ")";
+  }
+
+  /// One of: "count", "sum", "min", "max"
+  std::string op;
+
+  /// table column name
+  std::string field;
+
+  /// The AggOpCode cooresponding to op.
+  AggOpCode opcode;
+};
+
 typedef std::vector<boost::spirit::hold_any> QueryRow;
 
 /// Meta data and results of a query.
@@ -457,6 +510,115 @@ class QueryResult {
 
     return rows[row][field_idx].cast<T>();
   }
+
+  /// Retrieves a value from a specific row and the field (column) at index
+  /// field_idx of fields, as found by FieldIndexes. This skips the search of
+  /// the fields by name that GetVal(std::string, int) does, which adds up for
+  /// code reading many fields, e.g., the InitFrom methods generated by cycpp.
+  template <class T>
+  T GetVal(int field_idx, int row = 0) {
+    if (row >= rows.size()) {
+      std::string field = field_idx >= 0 && field_idx < fields.size() ?
+                          fields[field_idx] : "";
+      if (rows.empty())
+        throw StateError("No rows found during query for field " + field);
+      throw KeyError("index larger than number of query rows for field "
+                     + field);
+    }
+    return rows[row][field_idx].cast<T>();
+  }
+
+  /// Returns the index in fields of each of the given names, in order.
+  ///
+  /// @throws KeyError if the result has no such field
+  std::vector<int> FieldIndexes(const std::vector<std::string>& names) const {
+    std::map<std::string, int> idx;
+    for (int i = fields.size() - 1; i >= 0; --i) {
+      idx[fields[i]] = i;
+    }
+    std::vector<int> found(names.size());
+    for (int i = 0; i < names.size(); ++i) {
+      std::map<std::string, int>::const_iterator it = idx.find(names[i]);
+      if (it == idx.end()) {
+        throw KeyError("query result has no such field " + names[i]);
+      }
+      found[i] = it->second;
+    }
+    return found;
+  }
+
+  /// Keeps only the given fields, in the given order, dropping every other
+  /// column from the fields, types, and rows.
+  ///
+  /// @throws KeyError if the result has no such field
+  void Project(const std::vector<std::string>& keep) {
+    std::vector<int> idx;
+    std::vector<int> uses(fields.size(), 0);
+    std::vector<DbTypes> kept_types;
+    for (int i = 0; i < keep.size(); ++i) {
+      int j = std::find(fields.begin(), fields.end(), keep[i]) -
+              fields.begin();
+      if (j == fields.size()) {
+        throw KeyError("query result has no such field " + keep[i]);
+      }
+      idx.push_back(j);
+      uses[j]++;
+      kept_types.push_back(types[j]);
+    }
+
+    // values used by a single output column are moved rather than copied
+    for (int r = 0; r < rows.size(); ++r) {
+      QueryRow row(idx.size());
+      for (int i = 0; i < idx.size(); ++i) {
+        if (uses[idx[i]] == 1) {
+          row[i].swap(rows[r][idx[i]]);
+        } else {
+          row[i] = rows[r][idx[i]];
+        }
+      }
+      rows[r].swap(row);
+    }
+    fields = keep;
+    types = kept_types;
+  }
+};
+
+/// Iterates over the rows of a query a batch at a time, so that tables larger
+/// than memory can be processed.  Cursors are created by
+/// QueryableBackend::Cursor and must not outlive the backend that made them.
+class QueryCursor {
+ public:
+  typedef boost::shared_ptr<QueryCursor> Ptr;
+
+  virtual ~QueryCursor() {}
+
+  /// Returns up to n more rows of the query, in the order Query would return
+  /// them.  The fields and types of the result are always set; its rows are
+  /// empty once the cursor is exhausted.
+  virtual QueryResult Next(int n) = 0;
+};
+
+/// A cursor over a query result that has already been fully read.
+class ResultCursor : public QueryCursor {
+ public:
+  explicit ResultCursor(const QueryResult& qr) : qr_(qr), pos_(0) {}
+
+  virtual QueryResult Next(int n) {
+    QueryResult batch;
+    batch.fields = qr_.fields;
+    batch.types = qr_.types;
+    size_t end = pos_ + std::min<size_t>(std::max(n, 0),
+                                         qr_.rows.size() - pos_);
+    for (; pos_ < end; ++pos_) {
+      batch.rows.push_back(QueryRow());
+      batch.rows.back().swap(qr_.rows[pos_]);
+    }
+    return batch;
+  }
+
+ private:
+  QueryResult qr_;
+  size_t pos_;
 };
 
 /// Represents column information.
@@ -473,6 +635,95 @@ struct ColumnInfo {
   std::vector<int> shape;
 };
 
+/// Computes the aggregates of QueryableBackend::Aggregate from the rows of a
+/// query, keeping only one set of running aggregates per group. Backends
+/// that cannot aggregate natively add the rows of a cursor to one, and those
+/// that read a table in parts may aggregate each part on its own and merge
+/// the parts afterwards.
+///
+/// Groups and the least and greatest values are only defined for columns of
+/// type BOOL, INT, FLOAT, DOUBLE, STRING, VL_STRING, and UUID, and sums only
+/// for those of type BOOL, INT, FLOAT, and DOUBLE.
+class Aggregator {
+ public:
+  /// @param group_by the fields the rows are grouped by, in order
+  /// @param aggs the aggregates computed for each group
+  /// @param types the types of the columns of the table
+  /// @throws KeyError if the table has no field named
+  /// @throws ValueError if a field cannot be grouped by or aggregated
+  Aggregator(const std::vector<std::string>& group_by,
+             const std::vector<Agg>& aggs,
+             const std::map<std::string, DbTypes>& types);
+
+  /// Returns the fields of the rows added: those grouped by, followed by
+  /// those aggregated that are not among them.
+  const std::vector<std::string>& fields() const { return fields_; }
+
+  /// Adds a row with the values of fields(), in order.
+  void Add(const QueryRow& row);
+
+  /// Adds a row whose value of the i-th field of fields() is row[cols[i]].
+  void Add(const QueryRow& row, const std::vector<int>& cols);
+
+  /// Adds the rows added to other, which must have been made with the same
+  /// arguments as this.
+  void Merge(const Aggregator& other);
+
+  /// Returns the fields grouped by followed by the aggregates, named by
+  /// Agg::name, with one row per group in ascending order of the groups.
+  /// Counts are INT, sums DOUBLE, and the least and greatest values have the
+  /// type of their column. There are no rows if none were added.
+  QueryResult Result() const;
+
+ private:
+  /// The running aggregates of a group: its number of rows, and the sum, or
+  /// least or greatest value, of each aggregate.
+  struct Group {
+    int count;
+    std::vector<double> sums;
+    QueryRow extremes;
+  };
+
+  /// Orders rows by each of their values in turn.
+  class RowLess {
+   public:
+    RowLess() {}
+    explicit RowLess(const std::vector<DbTypes>& types) : types_(types) {}
+    bool operator()(const QueryRow& a, const QueryRow& b) const;
+
+   private:
+    std::vector<DbTypes> types_;
+  };
+
+  /// Updates the aggregates of g with those of another group of the same
+  /// rows.
+  void MergeGroup(const Group& other, Group* g) const;
+
+  std::vector<std::string> group_by_;
+  std::vector<Agg> aggs_;
+  std::vector<std::string> fields_;
+  std::vector<DbTypes> types_;
+  /// the index in fields_ of the field of each aggregate, or -1 for counts.
+  std::vector<int> agg_cols_;
+  std::map<QueryRow, Group, RowLess> groups_;
+};
+
+/// The resources reached by following the lineage of a resource, i.e., the
+/// resources it was made from or made into, in turn (see
+/// QueryableBackend::Ancestors), and the transactions that moved them.
+struct Lineage {
+  /// the ids of the resources reached, nearest first, without the resource
+  /// itself
+  std::vector<int> resources;
+
+  /// the number of generations between the resource and each one reached
+  std::vector<int> depths;
+
+  /// the ids of the transactions of the resource and of those reached, in
+  /// increasing order
+  std::vector<int> transactions;
+};
+
 /// Interface implemented by backends that support rudimentary querying.
 class QueryableBackend {
  public:
@@ -482,6 +733,50 @@ class QueryableBackend {
   /// conditions.  Conditions are AND'd together.  conds may be NULL.
   virtual QueryResult Query(std::string table, std::vector<Cond>* conds) = 0;
 
+  /// Return a set of rows from the specificed table that match all given
+  /// conditions, with only the named fields, in the given order.  Conditions
+  /// may refer to fields that are not returned.  conds may be NULL, and if
+  /// fields is NULL every field is returned.
+  ///
+  /// Backends should override this so that unneeded columns are never
+  /// decoded; the default queries every column and then drops the rest.
+  ///
+  /// @throws KeyError if the table has no such field
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds,
+                            std::vector<std::string>* fields) {
+    QueryResult qr = Query(table, conds);
+    if (fields != NULL) {
+      qr.Project(*fields);
+    }
+    return qr;
+  }
+
+  /// Return a cursor over the rows that Query(table, conds, fields) would
+  /// return.  conds and fields are copied and need not outlive the call.
+  ///
+  /// Backends should override this so that rows are read lazily; the default
+  /// runs the whole query up front and hands out its rows in batches.
+  ///
+  /// @throws KeyError if the table has no such field
+  virtual QueryCursor::Ptr Cursor(std::string table, std::vector<Cond>* conds,
+                                  std::vector<std::string>* fields) {
+    return QueryCursor::Ptr(new ResultCursor(Query(table, conds, fields)));
+  }
+
+  /// Return the aggregates of the rows of the specified table that match all
+  /// given conditions, grouped by the values of the group_by fields, as
+  /// described by Aggregator::Result.  conds may be NULL, and if group_by is
+  /// NULL or empty all matching rows form a single group.
+  ///
+  /// Backends should override this so that rows are aggregated where they
+  /// are stored; the default adds the rows of a cursor to an Aggregator.
+  ///
+  /// @throws KeyError if the table has no such field
+  /// @throws ValueError if a field cannot be grouped by or aggregated
+  virtual QueryResult Aggregate(std::string table, std::vector<Cond>* conds,
+                                std::vector<std::string>* group_by,
+                                const std::vector<Agg>& aggs);
+
   /// Return a map of column names of the specified table to the associated
   /// database type.
   virtual std::map<std::string, DbTypes> ColumnTypes(std::string table) = 0;
@@ -491,6 +786,23 @@ class QueryableBackend {
 
   /// Return a set of all table names currently in the database.
   virtual std::set<std::string> Tables() = 0;
+
+  /// Return the ancestors of a resource: the resources it was made from,
+  /// those they were made from, and so on, up to max_depth generations back
+  /// or all of them if max_depth is negative. The conditions, e.g., on the
+  /// SimId of a database that holds several simulations, apply to every row
+  /// read.  conds may be NULL.
+  ///
+  /// If the database has a lineage index (see LineageIndexer), only the
+  /// pages of it that hold the resources reached are read. Otherwise the
+  /// Resources and Transactions tables are queried for each one.
+  virtual Lineage Ancestors(int resource_id, int max_depth,
+                            std::vector<Cond>* conds);
+
+  /// Return the descendants of a resource: the resources made from it, those
+  /// made from them, and so on, as Ancestors does.
+  virtual Lineage Descendants(int resource_id, int max_depth,
+                              std::vector<Cond>* conds);
 };
 
 /// Interface implemented by backends that support recording and querying.
@@ -508,15 +820,39 @@ class CondInjector: public QueryableBackend {
         to_inject_(to_inject) {}
 
   virtual QueryResult Query(std::string table, std::vector<Cond>* conds) {
+    return Query(table, conds, NULL);
+  }
+
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds,
+                            std::vector<std::string>* fields) {
     if (conds == NULL) {
-      return b_->Query(table, &to_inject_);
+      return b_->Query(table, &to_inject_, fields);
     }
 
     std::vector<Cond> c = *conds;
     for (int i = 0; i < to_inject_.size(); ++i) {
       c.push_back(to_inject_[i]);
     }
-    return b_->Query(table, &c);
+    return b_->Query(table, &c, fields);
+  }
+
+  virtual QueryCursor::Ptr Cursor(std::string table, std::vector<Cond>* conds,
+                                  std::vector<std::string>* fields) {
+    std::vector<Cond> c = to_inject_;
+    if (conds != NULL) {
+      c.insert(c.begin(), conds->begin(), conds->end());
+    }
+    return b_->Cursor(table, &c, fields);
+  }
+
+  virtual QueryResult Aggregate(std::string table, std::vector<Cond>* conds,
+                                std::vector<std::string>* group_by,
+                                const std::vector<Agg>& aggs) {
+    std::vector<Cond> c = to_inject_;
+    if (conds != NULL) {
+      c.insert(c.begin(), conds->begin(), conds->end());
+    }
+    return b_->Aggregate(table, &c, group_by, aggs);
   }
 
   virtual std::map<std::string, DbTypes> ColumnTypes(std::string table) {
@@ -548,6 +884,22 @@ class PrefixInjector: public QueryableBackend {
     return b_->Query(prefix_ + table, conds);
   }
 
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds,
+                            std::vector<std::string>* fields) {
+    return b_->Query(prefix_ + table, conds, fields);
+  }
+
+  virtual QueryCursor::Ptr Cursor(std::string table, std::vector<Cond>* conds,
+                                  std::vector<std::string>* fields) {
+    return b_->Cursor(prefix_ + table, conds, fields);
+  }
+
+  virtual QueryResult Aggregate(std::string table, std::vector<Cond>* conds,
+                                std::vector<std::string>* group_by,
+                                const std::vector<Agg>& aggs) {
+    return b_->Aggregate(prefix_ + table, conds, group_by, aggs);
+  }
+
   virtual std::map<std::string, DbTypes> ColumnTypes(std::string table) {
     return b_->ColumnTypes(table);
   }
@@ -563,6 +915,62 @@ class PrefixInjector: public QueryableBackend {
   std::string prefix_;
 };
 
+/// Wrapper class for QueryableBackends that serves the classic Resources and
+/// Transactions tables of databases recorded with compact output (see
+/// SimInfo::compact_output), rebuilding their rows from the compact tables
+/// and lookup tables, for backends that do not provide them themselves.
+/// Likewise, the Compositions and ExplicitInventory tables of databases
+/// recorded with dense output (see SimInfo::dense_output) are rebuilt from
+/// the DenseCompositions and DenseInventory tables and the NuclideIndex, with
+/// a row for each nuclide of non-zero value. Conditions on columns that the
+/// compact or dense tables hold unchanged are passed on to the wrapped
+/// backend and the rest are applied to the rebuilt rows. Every other table is
+/// passed through untouched.
+class CompactExpander: public QueryableBackend {
+ public:
+  explicit CompactExpander(QueryableBackend* b) : b_(b) {}
+
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds) {
+    return Query(table, conds, NULL);
+  }
+
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds,
+                            std::vector<std::string>* fields);
+
+  virtual QueryCursor::Ptr Cursor(std::string table, std::vector<Cond>* conds,
+                                  std::vector<std::string>* fields) {
+    if (!Expanded(table)) {
+      return b_->Cursor(table, conds, fields);
+    }
+    return QueryableBackend::Cursor(table, conds, fields);
+  }
+
+  virtual QueryResult Aggregate(std::string table, std::vector<Cond>* conds,
+                                std::vector<std::string>* group_by,
+                                const std::vector<Agg>& aggs) {
+    if (!Expanded(table)) {
+      return b_->Aggregate(table, conds, group_by, aggs);
+    }
+    return QueryableBackend::Aggregate(table, conds, group_by, aggs);
+  }
+
+  virtual std::map<std::string, DbTypes> ColumnTypes(std::string table);
+
+  virtual std::list<ColumnInfo> Schema(std::string table);
+
+  virtual std::set<std::string> Tables();
+
+  /// Returns the table that the classic table of the given name is rebuilt
+  /// from when it is not stored, or NULL if it is never rebuilt.
+  static const char* Source(const std::string& table);
+
+  /// Returns whether table is a classic table that is rebuilt here.
+  bool Expanded(const std::string& table);
+
+ private:
+  QueryableBackend* b_;
+};
+
 /// Compares a condiontion for a single value
 template <typename T>
 inline bool CmpCond(T* x, Cond* cond) {
@@ -683,9 +1091,219 @@ class Digest {
   }
 };
 
+/// A set of digests, stored in an open-addressing hash table. Digests are
+/// already hashes, so their first words are used as the hash directly. This
+/// is much faster to search than a std::set<Digest> for the millions of keys
+/// a large database may hold.
+class DigestSet {
+ public:
+  DigestSet() : size_(0) {}
+
+  /// Returns 1 if the digest is in the set and 0 otherwise.
+  inline size_t count(const Digest& d) const {
+    if (size_ == 0)
+      return 0;
+    size_t mask = used_.size() - 1;
+    for (size_t i = Slot(d) & mask; used_[i]; i = (i + 1) & mask) {
+      if (slots_[i] == d)
+        return 1;
+    }
+    return 0;
+  }
+
+  /// Adds the digest to the set, returning whether it was not there already.
+  inline bool insert(const Digest& d) {
+    if (10 * (size_ + 1) > 7 * used_.size())
+      Grow();
+    size_t mask = used_.size() - 1;
+    size_t i = Slot(d) & mask;
+    for (; used_[i]; i = (i + 1) & mask) {
+      if (slots_[i] == d)
+        return false;
+    }
+    slots_[i] = d;
+    used_[i] = 1;
+    ++size_;
+    return true;
+  }
+
+  inline void clear() {
+    slots_.clear();
+    used_.clear();
+    size_ = 0;
+  }
+
+  inline size_t size() const { return size_; }
+
+ private:
+  inline static size_t Slot(const Digest& d) {
+    return static_cast<size_t>((static_cast<uint64_t>(d.val[1]) << 32) |
+                               d.val[0]);
+  }
+
+  void Grow() {
+    std::vector<Digest> slots;
+    std::vector<char> used;
+    slots.swap(slots_);
+    used.swap(used_);
+    size_t n = used.empty() ? 64 : 2 * used.size();
+    slots_.resize(n);
+    used_.assign(n, 0);
+    size_ = 0;
+    for (size_t i = 0; i < used.size(); ++i) {
+      if (used[i])
+        insert(slots[i]);
+    }
+  }
+
+  std::vector<Digest> slots_;
+  std::vector<char> used_;
+  size_t size_;
+};
+
+/// The hash functions that keys of variable length values may be computed
+/// with. Databases record the one they were written with, so this may only be
+/// appended to.
+enum VLHash {
+  /// SHA1, used by all databases written before the hash was recorded.
+  VL_HASH_SHA1 = 1,
+  /// 128-bit MurmurHash3 (x64 variant), with the number of bytes hashed as
+  /// the fifth word of the digest.
+  VL_HASH_MURMUR3 = 2,
+};
+
+/// An incremental 128-bit MurmurHash3 (x64 variant). It is not
+/// cryptographic, but is several times faster than SHA1 and collisions
+/// between distinct values remain vanishingly unlikely. The digest does not
+/// depend on how the bytes are split between calls to process_bytes.
+class Murmur3 {
+ public:
+  Murmur3() { reset(); }
+
+  inline void reset() {
+    h1_ = 0;
+    h2_ = 0;
+    len_ = 0;
+    nbuf_ = 0;
+  }
+
+  inline void process_bytes(const void* data, size_t n) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    len_ += n;
+    if (nbuf_ > 0) {
+      size_t k = std::min(16 - nbuf_, n);
+      memcpy(buf_ + nbuf_, p, k);
+      nbuf_ += k;
+      p += k;
+      n -= k;
+      if (nbuf_ < 16)
+        return;
+      Block(buf_);
+      nbuf_ = 0;
+    }
+    for (; n >= 16; n -= 16, p += 16)
+      Block(p);
+    memcpy(buf_, p, n);
+    nbuf_ = n;
+  }
+
+  /// Sets d to the digest of the bytes processed so far.
+  inline void get_digest(unsigned int (&d)[CYCLUS_SHA1_NINT]) const {
+    uint64_t h1 = h1_;
+    uint64_t h2 = h2_;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    for (size_t i = nbuf_; i > 8; --i)
+      k2 = (k2 << 8) | buf_[i - 1];
+    for (size_t i = std::min<size_t>(nbuf_, 8); i > 0; --i)
+      k1 = (k1 << 8) | buf_[i - 1];
+    if (nbuf_ > 8) {
+      k2 *= kC2;
+      k2 = Rotl(k2, 33);
+      k2 *= kC1;
+      h2 ^= k2;
+    }
+    if (nbuf_ > 0) {
+      k1 *= kC1;
+      k1 = Rotl(k1, 31);
+      k1 *= kC2;
+      h1 ^= k1;
+    }
+    h1 ^= len_;
+    h2 ^= len_;
+    h1 += h2;
+    h2 += h1;
+    h1 = Fmix(h1);
+    h2 = Fmix(h2);
+    h1 += h2;
+    h2 += h1;
+    d[0] = static_cast<unsigned int>(h1);
+    d[1] = static_cast<unsigned int>(h1 >> 32);
+    d[2] = static_cast<unsigned int>(h2);
+    d[3] = static_cast<unsigned int>(h2 >> 32);
+    d[4] = static_cast<unsigned int>(len_);
+  }
+
+ private:
+  static const uint64_t kC1 = 0x87c37b91114253d5ULL;
+  static const uint64_t kC2 = 0x4cf5ad432745937fULL;
+
+  inline static uint64_t Rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+  }
+
+  inline static uint64_t Fmix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+  }
+
+  inline void Block(const unsigned char* p) {
+    uint64_t k1;
+    uint64_t k2;
+    memcpy(&k1, p, 8);
+    memcpy(&k2, p + 8, 8);
+    k1 *= kC1;
+    k1 = Rotl(k1, 31);
+    k1 *= kC2;
+    h1_ ^= k1;
+    h1_ = Rotl(h1_, 27);
+    h1_ += h2_;
+    h1_ = h1_ * 5 + 0x52dce729;
+    k2 *= kC2;
+    k2 = Rotl(k2, 33);
+    k2 *= kC1;
+    h2_ ^= k2;
+    h2_ = Rotl(h2_, 31);
+    h2_ += h1_;
+    h2_ = h2_ * 5 + 0x38495ab5;
+  }
+
+  uint64_t h1_;
+  uint64_t h2_;
+  uint64_t len_;
+  unsigned char buf_[16];
+  size_t nbuf_;
+};
+
+/// Hashes values into digests, which Hdf5Back uses as the keys of variable
+/// length values. Despite its name, it may use any of the VLHash functions;
+/// it uses SHA1 unless told otherwise.
 class Sha1 {
  public:
-  Sha1() { hash_ = boost::uuids::detail::sha1(); }
+  explicit Sha1(VLHash algo = VL_HASH_SHA1) { hash_.algo = algo; }
+
+  /// The hash function used.
+  /// \{
+  inline VLHash algo() const { return hash_.algo; }
+  inline void algo(VLHash a) {
+    hash_.algo = a;
+    hash_.reset();
+  }
+  /// \}
 
   /// Clears the current hash value to its default state.
   inline void Clear() { hash_.reset(); }
@@ -1057,12 +1675,34 @@ class Sha1 {
 
   Digest digest() {
     Digest d;
-    hash_.get_digest(d.val);
+    if (hash_.algo == VL_HASH_MURMUR3)
+      hash_.murmur3.get_digest(d.val);
+    else
+      hash_.sha1.get_digest(d.val);
     return d;
   }
 
  private:
-  boost::uuids::detail::sha1 hash_;
+  /// Passes the bytes to the selected hash function.
+  struct Engine {
+    VLHash algo;
+    boost::uuids::detail::sha1 sha1;
+    Murmur3 murmur3;
+
+    inline void reset() {
+      sha1.reset();
+      murmur3.reset();
+    }
+
+    inline void process_bytes(const void* data, size_t n) {
+      if (algo == VL_HASH_MURMUR3)
+        murmur3.process_bytes(data, n);
+      else
+        sha1.process_bytes(data, n);
+    }
+  };
+
+  Engine hash_;
 };
 
 }  // namespace cyclus
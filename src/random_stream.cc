@@ -0,0 +1,64 @@
+#include "random_stream.h"
+
+namespace cyclus {
+
+namespace {
+
+// the multipliers and key increments (Weyl constants) of Philox4x32
+const uint32_t kM0 = 0xD2511F53;
+const uint32_t kM1 = 0xCD9E8D57;
+const uint32_t kW0 = 0x9E3779B9;
+const uint32_t kW1 = 0xBB67AE85;
+const int kRounds = 10;
+
+}  // namespace
+
+RandomStream::RandomStream(uint64_t key, uint32_t id0, uint32_t id1,
+                           uint32_t id2)
+    : used_(4) {
+  key_[0] = static_cast<uint32_t>(key);
+  key_[1] = static_cast<uint32_t>(key >> 32);
+  ctr_[0] = 0;
+  ctr_[1] = id0;
+  ctr_[2] = id1;
+  ctr_[3] = id2;
+}
+
+RandomStream::result_type RandomStream::operator()() {
+  if (used_ == 4) {
+    Philox(ctr_, key_, block_);
+    ++ctr_[0];
+    used_ = 0;
+  }
+  return block_[used_++];
+}
+
+double RandomStream::Uniform() {
+  uint64_t hi = (*this)() >> 5;
+  uint64_t lo = (*this)() >> 6;
+  return (hi * 67108864.0 + lo) / 9007199254740992.0;
+}
+
+void RandomStream::Philox(const uint32_t ctr[4], const uint32_t key[2],
+                          uint32_t out[4]) {
+  uint32_t c[4] = {ctr[0], ctr[1], ctr[2], ctr[3]};
+  uint32_t k[2] = {key[0], key[1]};
+  for (int r = 0; r < kRounds; ++r) {
+    uint64_t p0 = static_cast<uint64_t>(kM0) * c[0];
+    uint64_t p1 = static_cast<uint64_t>(kM1) * c[2];
+    uint32_t hi0 = static_cast<uint32_t>(p0 >> 32);
+    uint32_t hi1 = static_cast<uint32_t>(p1 >> 32);
+    c[0] = hi1 ^ c[1] ^ k[0];
+    c[1] = static_cast<uint32_t>(p1);
+    c[2] = hi0 ^ c[3] ^ k[1];
+    c[3] = static_cast<uint32_t>(p0);
+    k[0] += kW0;
+    k[1] += kW1;
+  }
+  out[0] = c[0];
+  out[1] = c[1];
+  out[2] = c[2];
+  out[3] = c[3];
+}
+
+}  // namespace cyclus
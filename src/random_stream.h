@@ -0,0 +1,51 @@
+#ifndef CYCLUS_SRC_RANDOM_STREAM_H_
+#define CYCLUS_SRC_RANDOM_STREAM_H_
+
+#include <stdint.h>
+
+namespace cyclus {
+
+/// A stream of pseudo-random numbers from the Philox4x32-10 counter-based
+/// generator of Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3"
+/// (SC11). Each block of four numbers is a keyed bijection of its position
+/// in the stream, so a stream has no state beyond its key, its id, and how
+/// far it has been read: the numbers of a stream depend on nothing else, such
+/// as the order or the thread in which streams are read. Streams with
+/// different keys or ids are statistically independent.
+///
+/// A stream is a uniform random bit generator, and so can be used with the
+/// distributions of <random>. Those distributions are implemented
+/// differently by different standard libraries, though, while Uniform gives
+/// the same numbers everywhere.
+class RandomStream {
+ public:
+  typedef uint32_t result_type;
+
+  /// Creates the stream with the given key and the three part id.
+  RandomStream(uint64_t key, uint32_t id0, uint32_t id1, uint32_t id2);
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return 0xffffffff; }
+
+  /// Returns the next number of the stream, uniform over all 32 bit values.
+  result_type operator()();
+
+  /// Returns a number uniform over [0, 1), from the next two numbers of the
+  /// stream, with 53 random bits.
+  double Uniform();
+
+  /// Computes the Philox4x32-10 block out for counter ctr and key key.
+  static void Philox(const uint32_t ctr[4], const uint32_t key[2],
+                     uint32_t out[4]);
+
+ private:
+  uint32_t key_[2];
+  /// the position of the next block in ctr_[0], followed by the id
+  uint32_t ctr_[4];
+  uint32_t block_[4];
+  int used_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_RANDOM_STREAM_H_
@@ -36,8 +36,21 @@ class RecBackend {
 
   virtual ~RecBackend() {}
 
-  /// Used to pass a list of new/collected Datum objects
-  virtual void Notify(DatumList data) = 0;
+  /// Used to pass a list of new/collected Datum objects. By default, this
+  /// groups them and passes them to Notify(const DatumGroups&).
+  virtual void Notify(DatumList data) {
+    DatumGroups groups;
+    groups.Build(data, data.size());
+    Notify(groups);
+  }
+
+  /// Used by the Recorder to pass new/collected Datum objects grouped by
+  /// table. By default, this passes them to Notify(DatumList) in the order
+  /// they were recorded. Backends must override at least one of the two, and
+  /// should override this one to avoid copying the Datum objects.
+  virtual void Notify(const DatumGroups& groups) {
+    Notify(groups.list());
+  }
 
   /// Used to uniquely identify a backend - particularly if there are more
   /// than one in a simulation.
@@ -1,32 +1,172 @@
 #include "recorder.h"
 
+#include <chrono>
+#include <typeinfo>
+
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include "blob.h"
 #include "datum.h"
 #include "logger.h"
+#include "pyhooks.h"
 #include "rec_backend.h"
+#include "tracer.h"
 
 namespace cyclus {
 
-Recorder::Recorder() : index_(0), inject_sim_id_(true) {
+namespace {
+
+// the recorder the calling thread is staging Datum objects for, and where
+// they are staged (see Recorder::StartStaging)
+thread_local Recorder* staging_rec = NULL;
+thread_local DatumList* staging_buf = NULL;
+
+template <typename T>
+size_t VecBytes(const boost::spirit::hold_any& v) {
+  return v.cast<std::vector<T> >().size() * sizeof(T);
+}
+
+// an estimate of the size of a value, in bytes
+size_t ValBytes(const boost::spirit::hold_any& v) {
+  const std::type_info& t = v.type();
+  if (t == typeid(int) || t == typeid(float)) {
+    return 4;
+  } else if (t == typeid(double)) {
+    return 8;
+  } else if (t == typeid(bool)) {
+    return 1;
+  } else if (t == typeid(std::string)) {
+    return v.cast<std::string>().size();
+  } else if (t == typeid(Blob)) {
+    return v.cast<Blob>().str().size();
+  } else if (t == typeid(boost::uuids::uuid)) {
+    return 16;
+  } else if (t == typeid(std::vector<int>)) {
+    return VecBytes<int>(v);
+  } else if (t == typeid(std::vector<double>)) {
+    return VecBytes<double>(v);
+  } else if (t == typeid(std::vector<std::string>)) {
+    const std::vector<std::string>& vec = v.cast<std::vector<std::string> >();
+    size_t n = 0;
+    for (int i = 0; i < vec.size(); ++i)
+      n += vec[i].size();
+    return n;
+  }
+  return sizeof(void*);
+}
+
+}  // namespace
+
+const std::string& DatumGroups::Group::title() const {
+  return front()->title();
+}
+
+void DatumGroups::Build(const DatumList& data, size_t n) {
+  index_.clear();
+  which_.resize(n);
+  groups_.clear();
+  ndata_ = n;
+  data_ = n == 0 ? NULL : &data[0];
+
+  // number the tables in order of appearance and count their rows
+  std::vector<size_t> counts;
+  for (size_t i = 0; i < n; ++i) {
+    const void* t = data[i]->table_;
+    std::unordered_map<const void*, size_t>::iterator it = index_.find(t);
+    if (it == index_.end()) {
+      it = index_.insert(std::make_pair(t, counts.size())).first;
+      counts.push_back(0);
+    }
+    which_[i] = it->second;
+    ++counts[it->second];
+  }
+
+  sorted_.resize(n);
+  std::vector<size_t> next(counts.size());
+  groups_.resize(counts.size());
+  size_t start = 0;
+  for (size_t g = 0; g < counts.size(); ++g) {
+    next[g] = start;
+    groups_[g].begin_ = &sorted_[0] + start;
+    start += counts[g];
+    groups_[g].end_ = &sorted_[0] + start;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    sorted_[next[which_[i]]++] = data[i];
+  }
+}
+
+DatumList DatumGroups::list() const {
+  return DatumList(data_, data_ + ndata_);
+}
+
+Recorder::Recorder()
+    : index_(0),
+      inject_sim_id_(true),
+      async_(false),
+      has_pending_(false),
+      flush_pending_(false),
+      stop_writer_(false),
+      silent_(false),
+      silent_sink_(NULL),
+      collect_stats_(false),
+      tracer_(NULL),
+      npooled_(0),
+      nwritten_(0) {
   uuid_ = boost::uuids::random_generator()();
   set_dump_count(kDefaultDumpCount);
 }
 
-Recorder::Recorder(bool inject_sim_id) : index_(0), inject_sim_id_(inject_sim_id) {
+Recorder::Recorder(bool inject_sim_id)
+    : index_(0),
+      inject_sim_id_(inject_sim_id),
+      async_(false),
+      has_pending_(false),
+      flush_pending_(false),
+      stop_writer_(false),
+      silent_(false),
+      silent_sink_(NULL),
+      collect_stats_(false),
+      tracer_(NULL),
+      npooled_(0),
+      nwritten_(0) {
   uuid_ = boost::uuids::random_generator()();
   set_dump_count(kDefaultDumpCount);
 }
 
-Recorder::Recorder(unsigned int dump_count) : index_(0), inject_sim_id_(true) {
+Recorder::Recorder(unsigned int dump_count)
+    : index_(0),
+      inject_sim_id_(true),
+      async_(false),
+      has_pending_(false),
+      flush_pending_(false),
+      stop_writer_(false),
+      silent_(false),
+      silent_sink_(NULL),
+      collect_stats_(false),
+      tracer_(NULL),
+      npooled_(0),
+      nwritten_(0) {
   uuid_ = boost::uuids::random_generator()();
   set_dump_count(dump_count);
 }
 
-Recorder::Recorder(boost::uuids::uuid simid) : index_(0), uuid_(simid), \
-                                               inject_sim_id_(true) {
+Recorder::Recorder(boost::uuids::uuid simid)
+    : index_(0),
+      uuid_(simid),
+      inject_sim_id_(true),
+      async_(false),
+      has_pending_(false),
+      flush_pending_(false),
+      stop_writer_(false),
+      silent_(false),
+      silent_sink_(NULL),
+      collect_stats_(false),
+      tracer_(NULL),
+      npooled_(0),
+      nwritten_(0) {
   set_dump_count(kDefaultDumpCount);
 }
 
@@ -36,10 +176,15 @@ Recorder::~Recorder() {
   } catch (Error err) {
     CLOG(LEV_ERROR) << "Error in Recorder destructor: " << err.what();
   }
+  StopWriter();
 
-  for (int i = 0; i < data_.size(); ++i) {
-    delete data_[i];
-  }
+  ResetBuffer(&data_, 0);
+  ResetBuffer(&pending_, 0);
+  ClearPool();
+  std::map<std::string, Table>::iterator it;
+  for (it = tables_.begin(); it != tables_.end(); ++it)
+    delete it->second.sink;
+  delete silent_sink_;
 }
 
 unsigned int Recorder::dump_count() {
@@ -51,70 +196,431 @@ boost::uuids::uuid Recorder::sim_id() {
 }
 
 void Recorder::set_dump_count(unsigned int count) {
-  for (int i = 0; i < data_.size(); ++i) {
-    delete data_[i];
+  WaitForWriter();
+  ResetBuffer(&data_, count);
+  ResetBuffer(&pending_, async_ ? count : 0);
+  ClearPool();
+  index_ = 0;
+  dump_count_ = count;
+}
+
+void Recorder::ResetBuffer(DatumList* buf, unsigned int count) {
+  for (int i = 0; i < buf->size(); ++i) {
+    delete (*buf)[i];
   }
-  data_.clear();
-  data_.reserve(count);
-  for (int i = 0; i < count; ++i) {
-    Datum* d = new Datum(this, "");
-    if (inject_sim_id_) {
-      d->AddVal("SimId", uuid_);
+  buf->assign(count, NULL);
+}
+
+void Recorder::ClearPool() {
+  // table entries are kept since Table pointers handed out must stay valid.
+  std::map<std::string, Table>::iterator it;
+  for (it = tables_.begin(); it != tables_.end(); ++it) {
+    DatumList& pool = it->second.pool;
+    for (int i = 0; i < pool.size(); ++i) {
+      delete pool[i];
     }
-    data_.push_back(d);
+    pool.clear();
+  }
+  npooled_ = 0;
+}
+
+void Recorder::Recycle(DatumList* buf, int n) {
+  // at most two full buffers worth of datum objects are kept around; this
+  // is enough to never allocate when the mix of tables is steady.
+  unsigned int max_pooled = 2 * (async_ ? 2 : 1) * dump_count_;
+  for (int i = 0; i < n; ++i) {
+    Datum* d = (*buf)[i];
+    if (d == NULL) {
+      continue;
+    }
+    (*buf)[i] = NULL;
+    if (npooled_ >= max_pooled || d->table_ == NULL) {
+      delete d;
+      continue;
+    }
+    d->table_->pool.push_back(d);
+    npooled_++;
+  }
+}
+
+const char* Recorder::Intern(const std::string& s) {
+  std::unique_lock<std::mutex> lock(stage_mu_, std::defer_lock);
+  if (staged() != NULL)
+    lock.lock();
+  return interned_.insert(s).first->c_str();
+}
+
+void Recorder::set_async(bool x) {
+  if (x == async_) {
+    return;
+  }
+
+  if (x) {
+    ResetBuffer(&pending_, dump_count_);
+    stop_writer_ = false;
+    async_ = x;
+    writer_ = std::thread(&Recorder::WriterLoop, this);
+  } else {
+    WaitForWriter();
+    StopWriter();
+    Recycle(&pending_, pending_.size());
+    ResetBuffer(&pending_, 0);
+    async_ = x;
+  }
+}
+
+Recorder::Table* Recorder::GetTable(const std::string& title) {
+  std::unique_lock<std::mutex> lock(stage_mu_, std::defer_lock);
+  if (staged() != NULL)
+    lock.lock();
+  std::map<std::string, Table>::iterator it = tables_.find(title);
+  if (it == tables_.end()) {
+    it = tables_.insert(std::make_pair(title, Table())).first;
+    it->second.title = title;
+    UpdateSkip(&it->second);
+  }
+  return &it->second;
+}
+
+void Recorder::set_collect_stats(bool x) {
+  WaitForWriter();
+  collect_stats_ = x;
+}
+
+std::map<std::string, TableStats> Recorder::stats() {
+  WaitForWriter();
+  std::map<std::string, TableStats> stats;
+  std::map<std::string, Table>::iterator it;
+  for (it = tables_.begin(); it != tables_.end(); ++it) {
+    if (it->second.stats.rows > 0)
+      stats[it->first] = it->second.stats;
+  }
+  return stats;
+}
+
+void Recorder::RecordStats() {
+  std::map<std::string, TableStats> all = stats();
+  std::map<std::string, TableStats>::iterator it;
+  for (it = all.begin(); it != all.end(); ++it) {
+    const TableStats& st = it->second;
+    std::map<std::string, double> secs = st.notify_secs;
+    if (secs.empty())
+      secs[""] = 0;
+    std::map<std::string, double>::iterator b;
+    for (b = secs.begin(); b != secs.end(); ++b) {
+      NewDatum("RecorderStats")
+          ->AddVal("Table", it->first)
+          ->AddVal("Backend", b->first)
+          ->AddVal("Rows", static_cast<int>(st.rows))
+          ->AddVal("Bytes", static_cast<double>(st.bytes))
+          ->AddVal("NotifyTime", b->second)
+          ->Record();
+    }
+  }
+}
+
+void Recorder::FilterTables(const std::set<std::string>& allow,
+                            const std::set<std::string>& deny) {
+  allow_ = allow;
+  deny_ = deny;
+  std::map<std::string, Table>::iterator it;
+  for (it = tables_.begin(); it != tables_.end(); ++it)
+    UpdateSkip(&it->second);
+}
+
+void Recorder::set_silent(bool x) {
+  silent_ = x;
+  if (silent_ && silent_sink_ == NULL) {
+    silent_sink_ = new Datum(this, "");
+    silent_sink_->skip_ = true;
+  }
+  std::map<std::string, Table>::iterator it;
+  for (it = tables_.begin(); it != tables_.end(); ++it)
+    UpdateSkip(&it->second);
+}
+
+bool Recorder::Records(const std::string& title) const {
+  return ((allow_.empty() && !silent_) || allow_.count(title) > 0) &&
+         deny_.count(title) == 0;
+}
+
+void Recorder::UpdateSkip(Table* t) {
+  t->skip = !Records(t->title);
+  if (t->skip && t->sink == NULL) {
+    t->sink = new Datum(this, t->title);
+    t->sink->skip_ = true;
   }
-  dump_count_ = count;
 }
 
 Datum* Recorder::NewDatum(std::string title) {
-  Datum* d = data_[index_];
-  d->title_ = title;
-  if (inject_sim_id_) {
-    d->vals_.resize(1);
-    d->shapes_.resize(1);
-    d->fields_.resize(1);
+  if (silent_ && allow_.count(title) == 0)
+    return silent_sink_;
+  return NewDatum(GetTable(title));
+}
+
+Datum* Recorder::NewDatum(Table* t) {
+  if (t->skip)
+    return t->sink;
+
+  DatumList* staging = staged();
+  std::unique_lock<std::mutex> lock(stage_mu_, std::defer_lock);
+  if (staging != NULL)
+    lock.lock();
+  Datum* d = NULL;
+  if (!t->pool.empty()) {
+    d = t->pool.back();
+    t->pool.pop_back();
+    npooled_--;
   } else {
-    d->vals_.resize(0);
-    d->shapes_.resize(0);
-    d->fields_.resize(0);
+    d = new Datum(this, t->title);
+    d->table_ = t;
+    if (inject_sim_id_) {
+      d->AddVal("SimId", uuid_);
+    }
   }
+  d->n_ = inject_sim_id_ ? 1 : 0;
 
+  if (staging != NULL) {
+    staging->push_back(d);
+    return d;
+  }
+  data_[index_] = d;
   index_++;
   return d;
 }
 
 void Recorder::AddDatum(Datum* d) {
+  if (staged() != NULL) {
+    return;
+  }
   if (index_ >= data_.size()) {
-    NotifyBackends();
+    if (async_) {
+      HandOff();
+    } else {
+      NotifyBackends();
+    }
+  }
+}
+
+DatumList* Recorder::staged() {
+  return staging_rec == this ? staging_buf : NULL;
+}
+
+void Recorder::StartStaging(DatumList* staged) {
+  staging_rec = this;
+  staging_buf = staged;
+}
+
+void Recorder::StopStaging() {
+  staging_rec = NULL;
+  staging_buf = NULL;
+}
+
+void Recorder::Commit(DatumList* staged) {
+  for (int i = 0; i < staged->size(); ++i) {
+    data_[index_] = (*staged)[i];
+    index_++;
+    AddDatum((*staged)[i]);
   }
+  staged->clear();
+}
+
+void Recorder::Discard(DatumList* staged) {
+  for (int i = 0; i < staged->size(); ++i) {
+    delete (*staged)[i];
+  }
+  staged->clear();
 }
 
 void Recorder::Flush() {
+  WaitForWriter();
+  Recycle(&pending_, pending_.size());
   if (index_ == 0)
     return;
-  DatumList tmp = data_;
-  tmp.resize(index_);
+  for (int i = 0; i < index_; ++i) {
+    data_[i]->Trim();
+  }
+  int n = index_;
   index_ = 0;
-  std::list<RecBackend*>::iterator it;
-  for (it = backs_.begin(); it != backs_.end(); it++) {
-    (*it)->Notify(tmp);
-    (*it)->Flush();
+  groups_.Build(data_, n);
+  Notify(groups_, true);
+  Recycle(&data_, n);
+}
+
+void Recorder::FlushAsync() {
+  if (!async_) {
+    Flush();
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mu_);
+  cv_.wait(lock, [this] { return !has_pending_; });
+  if (writer_err_) {
+    std::exception_ptr err = writer_err_;
+    writer_err_ = std::exception_ptr();
+    std::rethrow_exception(err);
   }
+  Recycle(&pending_, pending_.size());
+  pending_.resize(data_.size());
+  for (int i = 0; i < index_; ++i) {
+    data_[i]->Trim();
+  }
+  data_.swap(pending_);
+  // only the recorded part of the buffer is handed off
+  pending_.resize(index_);
+  has_pending_ = true;
+  flush_pending_ = true;
+  index_ = 0;
+  cv_.notify_all();
+}
+
+size_t Recorder::queue_depth() {
+  std::lock_guard<std::mutex> lock(mu_);
+  return index_ + (has_pending_ ? pending_.size() : 0);
 }
 
 void Recorder::NotifyBackends() {
   index_ = 0;
+  for (int i = 0; i < data_.size(); ++i) {
+    data_[i]->Trim();
+  }
+  groups_.Build(data_, data_.size());
+  Notify(groups_, false);
+  Recycle(&data_, data_.size());
+}
+
+void Recorder::Notify(const DatumGroups& groups, bool flush) {
+  TraceSpan span(tracer_, flush ? "Flush" : "Notify", "recorder");
+  // backends are C++, so Python threads may run while they write
+  PyGilRelease nogil;
+  nwritten_ += groups.ndata();
   std::list<RecBackend*>::iterator it;
+  if (!collect_stats_) {
+    for (it = backs_.begin(); it != backs_.end(); it++) {
+      (*it)->Notify(groups);
+      if (flush)
+        (*it)->Flush();
+    }
+    return;
+  }
+
+  std::vector<double> bytes(groups.size(), 0);
+  double total = 0;
+  for (size_t g = 0; g < groups.size(); ++g) {
+    const DatumGroups::Group& group = groups[g];
+    for (size_t i = 0; i < group.size(); ++i) {
+      const Datum::Vals& vals = group[i]->vals_;
+      for (size_t j = 0; j < vals.size(); ++j)
+        bytes[g] += ValBytes(vals[j].second);
+    }
+    total += bytes[g];
+    TableStats& st = group.front()->table_->stats;
+    st.rows += group.size();
+    st.bytes += static_cast<uint64_t>(bytes[g]);
+  }
+
   for (it = backs_.begin(); it != backs_.end(); it++) {
-    (*it)->Notify(data_);
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    (*it)->Notify(groups);
+    double secs = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start).count();
+    std::string name = (*it)->Name();
+    for (size_t g = 0; g < groups.size(); ++g) {
+      double share = total > 0 ? bytes[g] / total : 1.0 / groups.size();
+      groups[g].front()->table_->stats.notify_secs[name] += secs * share;
+    }
+    if (flush)
+      (*it)->Flush();
+  }
+}
+
+void Recorder::HandOff() {
+  std::unique_lock<std::mutex> lock(mu_);
+  cv_.wait(lock, [this] { return !has_pending_; });
+  if (writer_err_) {
+    std::exception_ptr err = writer_err_;
+    writer_err_ = std::exception_ptr();
+    std::rethrow_exception(err);
+  }
+  // the writer is done with the previous buffer, so its datum objects can be
+  // reused before it becomes the recording buffer again. It may be short
+  // after an asynchronous flush.
+  Recycle(&pending_, pending_.size());
+  pending_.resize(data_.size());
+  for (int i = 0; i < data_.size(); ++i) {
+    data_[i]->Trim();
+  }
+  data_.swap(pending_);
+  has_pending_ = true;
+  index_ = 0;
+  cv_.notify_all();
+}
+
+void Recorder::WaitForWriter() {
+  if (!async_) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mu_);
+  cv_.wait(lock, [this] { return !has_pending_; });
+  if (writer_err_) {
+    std::exception_ptr err = writer_err_;
+    writer_err_ = std::exception_ptr();
+    std::rethrow_exception(err);
+  }
+}
+
+void Recorder::StopWriter() {
+  if (!writer_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_writer_ = true;
   }
+  cv_.notify_all();
+  writer_.join();
+}
+
+void Recorder::WriterLoop() {
+  std::unique_lock<std::mutex> lock(mu_);
+  while (true) {
+    cv_.wait(lock, [this] { return has_pending_ || stop_writer_; });
+    if (!has_pending_) {
+      return;
+    }
+
+    // backends are only ever touched by one thread at a time: the recording
+    // thread waits for has_pending_ to clear before notifying them itself.
+    bool flush = flush_pending_;
+    lock.unlock();
+    try {
+      pending_groups_.Build(pending_, pending_.size());
+      Notify(pending_groups_, flush);
+    } catch (...) {
+      lock.lock();
+      writer_err_ = std::current_exception();
+      lock.unlock();
+    }
+    lock.lock();
+    has_pending_ = false;
+    flush_pending_ = false;
+    cv_.notify_all();
+  }
+}
+
+void Recorder::set_tracer(Tracer* t) {
+  WaitForWriter();
+  tracer_ = t;
 }
 
 void Recorder::RegisterBackend(RecBackend* b) {
+  WaitForWriter();
   backs_.push_back(b);
 }
 
 void Recorder::Close() {
+  if (collect_stats_)
+    RecordStats();
   Flush();
   backs_.clear();
 }
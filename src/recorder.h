@@ -1,8 +1,17 @@
 #ifndef CYCLUS_SRC_RECORDER_H_
 #define CYCLUS_SRC_RECORDER_H_
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
 #include <list>
+#include <map>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_io.hpp>
@@ -13,6 +22,7 @@ namespace cyclus {
 
 class Datum;
 class Recorder;
+class Tracer;
 class RecBackend;
 
 typedef std::vector<Datum*> DatumList;
@@ -20,6 +30,87 @@ typedef std::vector<Datum*> DatumList;
 /// default number of Datum objects to collect before flushing to backends.
 static unsigned int const kDefaultDumpCount = 10000;
 
+/// A read-only view of a list of Datum objects grouped by table. The
+/// Recorder groups each flush once and hands the same groups to every
+/// backend, so that backends need not copy or regroup the Datum objects.
+/// Groups are only valid during the call they are passed to.
+class DatumGroups {
+ public:
+  /// The Datum objects of one table, in the order they were recorded.
+  class Group {
+   public:
+    typedef Datum* const* const_iterator;
+
+    /// The title of the table.
+    const std::string& title() const;
+
+    inline const_iterator begin() const { return begin_; }
+    inline const_iterator end() const { return end_; }
+    inline size_t size() const { return end_ - begin_; }
+    inline Datum* front() const { return *begin_; }
+    inline Datum* operator[](size_t i) const { return begin_[i]; }
+
+   private:
+    friend class DatumGroups;
+    Datum* const* begin_;
+    Datum* const* end_;
+  };
+
+  typedef std::vector<Group>::const_iterator const_iterator;
+
+  DatumGroups() : ndata_(0), data_(NULL) {}
+
+  /// Groups the first n Datum objects of data. Tables are ordered by their
+  /// first Datum object. Storage is reused between calls.
+  void Build(const DatumList& data, size_t n);
+
+  /// The number of tables.
+  inline size_t size() const { return groups_.size(); }
+
+  /// The total number of Datum objects in all tables.
+  inline size_t ndata() const { return ndata_; }
+
+  inline const Group& operator[](size_t i) const { return groups_[i]; }
+  inline const_iterator begin() const { return groups_.begin(); }
+  inline const_iterator end() const { return groups_.end(); }
+
+  /// Returns a copy of the Datum objects in the order they were recorded.
+  DatumList list() const;
+
+ private:
+  /// the Datum objects, sorted by table
+  DatumList sorted_;
+  std::vector<Group> groups_;
+  size_t ndata_;
+
+  /// the first ndata_ Datum objects passed to Build, in recorded order
+  Datum* const* data_;
+
+  /// scratch space for Build: the index of each table and of each Datum's
+  /// table.
+  std::unordered_map<const void*, size_t> index_;
+  std::vector<size_t> which_;
+};
+
+/// Output counters of one table, kept while the Recorder collects them (see
+/// Recorder::set_collect_stats).
+struct TableStats {
+  TableStats() : rows(0), bytes(0) {}
+
+  /// the number of rows sent to the backends
+  uint64_t rows;
+
+  /// an estimate of the size of the values of those rows, in bytes. Numbers,
+  /// strings, blobs, uuids, and vectors of numbers or strings are counted by
+  /// size; other values count as the size of a pointer.
+  uint64_t bytes;
+
+  /// the seconds each backend, by name, spent in Notify on the table. A
+  /// backend is notified of many tables at once, so its time is shared
+  /// among them in proportion to their bytes.
+  std::map<std::string, double> notify_secs;
+};
+
 /// Collects and manages output data generation for the cyclus core and agents
 /// during a simulation.  By default, datum managers are auto-initialized with a
 /// unique uuid simulation id.
@@ -46,6 +137,22 @@ class Recorder {
   friend class Datum;
 
  public:
+  /// A table (i.e. datum title) known to the recorder along with the flushed
+  /// Datum objects of that title that are available for reuse.
+  struct Table {
+    Table() : skip(false), sink(NULL) {}
+
+    std::string title;
+    DatumList pool;
+
+    /// whether the table is filtered out, in which case sink is the no-op
+    /// datum handed out for it.
+    bool skip;
+    Datum* sink;
+
+    TableStats stats;
+  };
+
   /// create a new recorder with default dump frequency, random
   /// simulation id, and simulation id injection.
   Recorder();
@@ -91,8 +198,29 @@ class Recorder {
     inject_sim_id_ = x;
     set_dump_count(dump_count_);
   };
- 
-  /// Creates a new datum namespaced under the specified title.
+
+  /// returns whether or not full datum buffers are written to backends by a
+  /// background writer thread.
+  bool async() { return async_; }
+
+  /// Enables or disables asynchronous recording.  When enabled, each full
+  /// buffer of dump_count Datum objects is handed off to a dedicated writer
+  /// thread that notifies the backends while the simulation keeps recording
+  /// into a second buffer.  At most one buffer is in flight at a time; if the
+  /// writer falls behind, recording blocks until it catches up.  Flush and
+  /// Close wait for the writer and so retain their synchronous semantics.
+  /// Errors thrown by a backend on the writer thread are rethrown from the
+  /// next Record, Flush, or Close call.
+  ///
+  /// @warning backends are called from the writer thread while the
+  /// simulation runs and must not share unsynchronized state with it (e.g.
+  /// backends implemented in Python).
+  void set_async(bool x);
+
+  /// Creates a new datum namespaced under the specified title.  Datum objects
+  /// are recycled per title once they have been flushed to the backends, so
+  /// recording rows of a table reuses the storage of its earlier rows
+  /// rather than allocating anew.
   ///
   /// @warning choose title carefully to not conflict with Datum objects from other
   /// agents. Also note that a static title (e.g. an unchanging string) will
@@ -100,6 +228,95 @@ class Recorder {
   /// (e.g. the same table).
   Datum* NewDatum(std::string title);
 
+  /// Creates a new datum for table t, skipping the title lookup.
+  Datum* NewDatum(Table* t);
+
+  /// Restricts the tables recorded. If allow is not empty, only the tables in
+  /// it are recorded, and tables in deny are never recorded. NewDatum returns
+  /// a no-op datum for the tables filtered out: its values are neither
+  /// stored nor sent to the backends, and recording it does nothing.
+  ///
+  /// @warning simulations can't be restarted from databases missing the
+  /// tables that hold their state (e.g. Info, AgentEntry, or agent state
+  /// tables).
+  void FilterTables(const std::set<std::string>& allow,
+                    const std::set<std::string>& deny);
+
+  /// Sets whether the recorder is silent, i.e., records only the tables
+  /// explicitly allowed by FilterTables, and so nothing at all if none are.
+  /// NewDatum then hands out one shared no-op datum for every other table
+  /// without even looking the table up, so that the simulation runs as if it
+  /// had no output, e.g., to measure its throughput. Off by default.
+  void set_silent(bool x);
+
+  /// Returns whether the recorder is silent; see set_silent.
+  bool silent() const { return silent_; }
+
+  /// The tables recorded, or all if empty, and the tables never recorded.
+  /// \{
+  const std::set<std::string>& allowed_tables() const { return allow_; }
+  const std::set<std::string>& denied_tables() const { return deny_; }
+  /// \}
+
+  /// Returns whether Datum objects of the table are recorded.
+  bool Records(const std::string& title) const;
+
+  /// Returns whether output counters are kept per table.
+  bool collect_stats() const { return collect_stats_; }
+
+  /// Enables or disables keeping output counters per table. When enabled,
+  /// the counters are recorded to the RecorderStats table on Close, one row
+  /// per table and backend.
+  void set_collect_stats(bool x);
+
+  /// Returns the tracer that the writes to the backends are traced to, or
+  /// NULL if they aren't traced (the default).
+  Tracer* tracer() const { return tracer_; }
+
+  /// Sets the tracer that the writes to the backends are traced to.
+  void set_tracer(Tracer* t);
+
+  /// Returns the number of Datum objects sent to the backends so far. May be
+  /// called from any thread.
+  uint64_t rows_written() const { return nwritten_.load(); }
+
+  /// Returns the number of Datum objects recorded but not yet written to the
+  /// backends, including those the writer thread is writing. Must be called
+  /// from the thread that records.
+  size_t queue_depth();
+
+  /// Returns the output counters of the tables recorded, by title.
+  std::map<std::string, TableStats> stats();
+
+  /// Records the output counters of each table to the RecorderStats table.
+  void RecordStats();
+
+  /// Returns the table for title, creating it if necessary.  The returned
+  /// pointer remains valid for the lifetime of the recorder.
+  Table* GetTable(const std::string& title);
+
+  /// Returns a pointer to a recorder-owned copy of s (e.g. a field name) that
+  /// remains valid for the lifetime of the recorder.
+  const char* Intern(const std::string& s);
+
+  /// Makes the calling thread stage the Datum objects it creates in staged,
+  /// rather than adding them to the recorder's buffer, until StopStaging is
+  /// called. Many threads may stage Datum objects at once, as long as no
+  /// other thread uses the recorder meanwhile. Staged Datum objects are only
+  /// recorded once they are committed.
+  void StartStaging(DatumList* staged);
+
+  /// Makes the calling thread stop staging Datum objects.
+  void StopStaging();
+
+  /// Adds the Datum objects in staged to the recorder in order, as though
+  /// they had been created and recorded now, and clears staged.
+  void Commit(DatumList* staged);
+
+  /// Deletes the Datum objects in staged without recording them, and clears
+  /// staged.
+  void Discard(DatumList* staged);
+
   /// Registers b to receive Datum notifications for all Datum objects collected
   /// by the Recorder and to receive a flush notification when there
   /// are no more Datum objects.
@@ -110,20 +327,106 @@ class Recorder {
   /// Flushes all buffered Datum objects and flushes all registered backends.
   void Flush();
 
+  /// Like Flush, but when recording asynchronously the buffered Datum objects
+  /// are written and the backends flushed by the writer thread while
+  /// recording continues. Datum objects created afterwards are only written
+  /// once the flush is complete.
+  void FlushAsync();
+
   /// Flushes all buffered Datum objects and flushes all registered backends.
-  /// Unregisters all backends and resets.
+  /// Unregisters all backends and resets. Output counters, if collected, are
+  /// recorded first.
   void Close();
 
  private:
   void NotifyBackends();
+
+  /// notifies every backend of groups, flushing each afterwards if flush is
+  /// true, and updates the output counters of their tables.
+  void Notify(const DatumGroups& groups, bool flush);
   void AddDatum(Datum* d);
 
+  /// deletes all Datum objects in buf and resizes it to count empty slots.
+  void ResetBuffer(DatumList* buf, unsigned int count);
+
+  /// moves the first n Datum objects of buf into the per-title pool of
+  /// recyclable datums, leaving empty slots behind.
+  void Recycle(DatumList* buf, int n);
+
+  /// deletes all pooled Datum objects.
+  void ClearPool();
+
+  /// hands the full data_ buffer off to the writer thread, blocking until
+  /// the previously handed off buffer has been written.
+  void HandOff();
+
+  /// blocks until the writer thread has no buffer in flight and rethrows
+  /// any error it encountered.
+  void WaitForWriter();
+
+  /// stops and joins the writer thread, if running.
+  void StopWriter();
+
+  /// body of the background writer thread.
+  void WriterLoop();
+
   DatumList data_;
   int index_;
   std::list<RecBackend*> backs_;
   unsigned int dump_count_;
   boost::uuids::uuid uuid_;
   bool inject_sim_id_;
+
+  bool async_;
+  /// buffer being written by the writer thread (or idle spare when
+  /// has_pending_ is false).
+  DatumList pending_;
+  bool has_pending_;
+  /// whether the backends are flushed once pending_ has been written.
+  bool flush_pending_;
+  bool stop_writer_;
+  std::exception_ptr writer_err_;
+  std::thread writer_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+
+  /// the groups of the flush being written by the recording thread and by the
+  /// writer thread, respectively.
+  DatumGroups groups_;
+  DatumGroups pending_groups_;
+
+  /// all tables seen so far, keyed by title.
+  std::map<std::string, Table> tables_;
+
+  /// the table filter; see FilterTables.
+  std::set<std::string> allow_;
+  std::set<std::string> deny_;
+
+  /// whether only allowed tables are recorded; see set_silent.
+  bool silent_;
+
+  /// the no-op datum shared by all tables filtered out while silent.
+  Datum* silent_sink_;
+
+  /// sets whether the table is skipped, according to the filter.
+  void UpdateSkip(Table* t);
+
+  bool collect_stats_;
+  Tracer* tracer_;
+  unsigned int npooled_;
+
+  /// the number of Datum objects sent to the backends.
+  std::atomic<uint64_t> nwritten_;
+
+  /// field names and titles interned for the lifetime of the recorder.
+  std::set<std::string> interned_;
+
+  /// the staging buffer of the calling thread, or NULL if it is not staging
+  /// Datum objects for this recorder.
+  DatumList* staged();
+
+  /// guards tables_, their pools, and interned_ while threads are staging.
+  std::mutex stage_mu_;
 };
 
 }  // namespace cyclus
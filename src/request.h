@@ -2,12 +2,17 @@
 #define CYCLUS_SRC_REQUEST_H_
 
 #include <functional>
+#include <mutex>
 #include <ostream>
 #include <string>
 
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 
+#include "block_pool.h"
+#include "commodity_registry.h"
+#include "request_target.h"
+
 namespace cyclus {
 
 class Material;
@@ -28,7 +33,20 @@ template <class T> class RequestPortfolio;
 /// A Request is templated its resource.
 template <class T> class Request {
  public:
-  typedef std::function<double(boost::shared_ptr<T>)> cost_function_t;
+  typedef std::function<double(typename T::Ptr)> cost_function_t;
+
+  /// Requests are allocated from the exchange's block pool (see
+  /// BlockPool::Exchange).
+  /// @{
+  static void* operator new(std::size_t size) {
+    return BlockPool::Exchange()->Alloc(size);
+  }
+  static void operator delete(void* p, std::size_t size) {
+    if (p != NULL) {
+      BlockPool::Exchange()->Free(p, size);
+    }
+  }
+  /// @}
 
   /// @brief a factory method for a request
   /// @param target the target resource associated with this request
@@ -42,15 +60,15 @@ template <class T> class Request {
   /// i.e., in its entirety by a single offer
   /// @param cost_function a standard function object that returns the cost of a
   /// potential resource when called.
-  inline static Request<T>* Create(boost::shared_ptr<T> target,
+  inline static Request<T>* Create(typename T::Ptr target,
                                    Trader* requester,
                                    typename RequestPortfolio<T>::Ptr portfolio,
                                    std::string commodity,
                                    double preference,
                                    bool exclusive,
                                    cost_function_t cost_function) {
-    return new Request<T>(target, requester, portfolio, commodity, preference,
-                          exclusive, cost_function);
+    return new Request<T>(target, NULL, requester, portfolio, commodity,
+                          preference, exclusive, cost_function);
   }
   /// @brief a factory method for a request
   /// @param target the target resource associated with this request
@@ -62,7 +80,7 @@ template <class T> class Request {
   /// @param exclusive a flag denoting that this request must be met
   /// exclusively,
   /// i.e., in its entirety by a single offer
-  inline static Request<T>* Create(boost::shared_ptr<T> target,
+  inline static Request<T>* Create(typename T::Ptr target,
                                    Trader* requester,
                                    typename RequestPortfolio<T>::Ptr portfolio,
                                    std::string commodity = "",
@@ -74,18 +92,19 @@ template <class T> class Request {
 
   /// @brief a factory method for a bid for a bid without a portfolio
   /// @warning this factory should generally only be used for testing
-  inline static Request<T>* Create(boost::shared_ptr<T> target,
+  inline static Request<T>* Create(typename T::Ptr target,
                                    Trader* requester,
                                    std::string commodity,
                                    double preference,
                                    bool exclusive,
                                    cost_function_t cost_function) {
-    return new Request<T>(target, requester, commodity, preference, exclusive,
-                          cost_function);
+    return new Request<T>(target, NULL, requester,
+                          typename RequestPortfolio<T>::Ptr(), commodity,
+                          preference, exclusive, cost_function);
   }
   /// @brief a factory method for a bid for a bid without a portfolio
   /// @warning this factory should generally only be used for testing
-  inline static Request<T>* Create(boost::shared_ptr<T> target,
+  inline static Request<T>* Create(typename T::Ptr target,
                                    Trader* requester,
                                    std::string commodity = "",
                                    double preference = kDefaultPref,
@@ -93,8 +112,65 @@ template <class T> class Request {
     return Create(target, requester, commodity, preference, exclusive, NULL);
   }
 
-  /// @return this request's target
-  inline boost::shared_ptr<T> target() const { return target_; }
+  /// @brief a factory method for a request for the resource that target
+  /// describes, which is made only if the request's target is asked for
+  /// (see RequestTarget)
+  /// @param target the description of the resource requested
+  /// @param requester the requester
+  /// @param portfolio the porftolio of which this request is a part
+  /// @param commodity the commodity associated with this request
+  /// @param preference the preference associated with this request (relative to
+  /// others in the portfolio)
+  /// @param exclusive a flag denoting that this request must be met
+  /// exclusively, i.e., in its entirety by a single offer
+  /// @param cost_function a standard function object that returns the cost of a
+  /// potential resource when called.
+  inline static Request<T>* Create(const RequestTarget& target,
+                                   Trader* requester,
+                                   typename RequestPortfolio<T>::Ptr portfolio,
+                                   std::string commodity = "",
+                                   double preference = kDefaultPref,
+                                   bool exclusive = false,
+                                   cost_function_t cost_function = NULL) {
+    return new Request<T>(typename T::Ptr(), &target, requester, portfolio,
+                          commodity, preference, exclusive, cost_function);
+  }
+
+  /// @brief a factory method for a described request without a portfolio
+  /// @warning this factory should generally only be used for testing
+  inline static Request<T>* Create(const RequestTarget& target,
+                                   Trader* requester,
+                                   std::string commodity = "",
+                                   double preference = kDefaultPref,
+                                   bool exclusive = false,
+                                   cost_function_t cost_function = NULL) {
+    return new Request<T>(typename T::Ptr(), &target, requester,
+                          typename RequestPortfolio<T>::Ptr(), commodity,
+                          preference, exclusive, cost_function);
+  }
+
+  /// @return this request's target. The target of a request made from a
+  /// description is made on the first call.
+  inline typename T::Ptr target() const {
+    if (described_) {
+      std::call_once(made_, [this] { target_ = MakeTarget<T>(desc_); });
+    }
+    return target_;
+  }
+
+  /// @return the quantity of this request's target, without making it
+  inline double target_quantity() const {
+    return described_ ? desc_.quantity : target_->quantity();
+  }
+
+  /// @return the composition of this request's target, without making it.
+  /// Only requests for materials have one.
+  inline Composition::Ptr target_comp() const {
+    return described_ ? desc_.comp : target_->comp();
+  }
+
+  /// @return whether this request was made from a description of its target
+  inline bool described() const { return described_; }
 
   /// @return the requester associated with this request
   inline Trader* requester() const { return requester_; }
@@ -102,6 +178,10 @@ template <class T> class Request {
   /// @return the commodity associated with this request
   inline std::string commodity() const { return commodity_; }
 
+  /// @return the id of the commodity associated with this request (see
+  /// CommodityRegistry)
+  inline int commodity_id() const { return commod_id_; }
+
   /// @return the preference value for this request
   inline double preference() const { return preference_; }
 
@@ -117,54 +197,31 @@ template <class T> class Request {
   inline cost_function_t cost_function() const { return cost_function_; }
 
  private:
-  /// @brief constructors are private to require use of factory methods
-  Request(boost::shared_ptr<T> target, Trader* requester, std::string commodity,
-          double preference, bool exclusive, cost_function_t cost_function)
-      : target_(target),
-        requester_(requester),
-        commodity_(commodity),
-        preference_(preference),
-        exclusive_(exclusive),
-        cost_function_(cost_function) {}
-
-  /// @brief constructors are private to require use of factory methods
-  Request(boost::shared_ptr<T> target, Trader* requester,
-          std::string commodity = "", double preference = kDefaultPref,
-          bool exclusive = false)
-      : target_(target),
-        requester_(requester),
-        commodity_(commodity),
-        preference_(preference),
-        exclusive_(exclusive),
-        cost_function_(NULL) {}
-
-  Request(boost::shared_ptr<T> target, Trader* requester,
-          typename RequestPortfolio<T>::Ptr portfolio, std::string commodity,
-          double preference, bool exclusive, cost_function_t cost_function)
+  /// @brief constructors are private to require use of factory methods. desc
+  /// describes the target if target is NULL.
+  Request(typename T::Ptr target, const RequestTarget* desc,
+          Trader* requester, typename RequestPortfolio<T>::Ptr portfolio,
+          std::string commodity, double preference, bool exclusive,
+          cost_function_t cost_function)
       : target_(target),
+        desc_(desc != NULL ? *desc : RequestTarget(0)),
+        described_(desc != NULL),
         requester_(requester),
         commodity_(commodity),
+        commod_id_(CommodityRegistry::Intern(commodity)),
         preference_(preference),
         portfolio_(portfolio),
         exclusive_(exclusive),
         cost_function_(cost_function) {}
 
-  Request(boost::shared_ptr<T> target, Trader* requester,
-          typename RequestPortfolio<T>::Ptr portfolio,
-          std::string commodity = "", double preference = kDefaultPref,
-          bool exclusive = false)
-      : target_(target),
-        requester_(requester),
-        commodity_(commodity),
-        preference_(preference),
-        portfolio_(portfolio),
-        exclusive_(exclusive),
-        cost_function_(NULL) {}
-
-  boost::shared_ptr<T> target_;
+  mutable typename T::Ptr target_;
+  RequestTarget desc_;
+  bool described_;
+  mutable std::once_flag made_;
   Trader* requester_;
   double preference_;
   std::string commodity_;
+  int commod_id_;
   boost::weak_ptr<RequestPortfolio<T>> portfolio_;
   bool exclusive_;
   cost_function_t cost_function_;
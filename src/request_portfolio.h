@@ -10,6 +10,7 @@
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include "block_pool.h"
 #include "capacity_constraint.h"
 #include "error.h"
 #include "logger.h"
@@ -21,7 +22,7 @@ class Trader;
 
 /// @brief accumulator sum for request quantities
 template <class T> inline double SumQty(double total, Request<T>* r) {
-  return total += r->target()->quantity();
+  return total += r->target_quantity();
 }
 
 /// @brief provide coefficients for default mass constraints
@@ -34,10 +35,10 @@ template <class T> struct QtyCoeffConverter : public Converter<T> {
       : coeffs(coeffs) {}
 
   inline virtual double convert(
-      boost::shared_ptr<T> offer,
+      typename T::Ptr offer,
       Arc const* a,
       ExchangeTranslationContext<T> const* ctx) const {
-    return offer->quantity() * coeffs.at(ctx->node_to_request.at(a->unode()));
+    return offer->quantity() * coeffs.at(ctx->request(a->unode()));
   }
 
   virtual bool operator==(Converter<T>& other) const {
@@ -87,7 +88,20 @@ class RequestPortfolio
     : public boost::enable_shared_from_this<RequestPortfolio<T>> {
  public:
   typedef boost::shared_ptr<RequestPortfolio<T>> Ptr;
-  typedef std::function<double(boost::shared_ptr<T>)> cost_function_t;
+  typedef std::function<double(typename T::Ptr)> cost_function_t;
+
+  /// Portfolios are allocated from the exchange's block pool (see
+  /// BlockPool::Exchange).
+  /// @{
+  static void* operator new(std::size_t size) {
+    return BlockPool::Exchange()->Alloc(size);
+  }
+  static void operator delete(void* p, std::size_t size) {
+    if (p != NULL) {
+      BlockPool::Exchange()->Free(p, size);
+    }
+  }
+  /// @}
 
   RequestPortfolio() : requester_(NULL), qty_(0) {}
 
@@ -112,7 +126,7 @@ class RequestPortfolio
   /// bidder may evaluate many potential resources.
   /// @throws KeyError if a request is added from a different requester than the
   /// original or if the request quantity is different than the original
-  Request<T>* AddRequest(boost::shared_ptr<T> target, Trader* requester,
+  Request<T>* AddRequest(typename T::Ptr target, Trader* requester,
                          std::string commodity, double preference,
                          bool exclusive, cost_function_t cost_function) {
     Request<T>* r =
@@ -135,7 +149,7 @@ class RequestPortfolio
   /// i.e., in its entirety by a single offer
   /// @throws KeyError if a request is added from a different requester than the
   /// original or if the request quantity is different than the original
-  Request<T>* AddRequest(boost::shared_ptr<T> target, Trader* requester,
+  Request<T>* AddRequest(typename T::Ptr target, Trader* requester,
                          std::string commodity = "",
                          double preference = kDefaultPref,
                          bool exclusive = false) {
@@ -143,6 +157,34 @@ class RequestPortfolio
                       NULL);
   }
 
+  /// @brief add a request for the resource that target describes, which is
+  /// made only if the request's target is asked for (see RequestTarget)
+  /// @param target the description of the resource requested
+  /// @param requester the requester
+  /// @param commodity the commodity associated with this request
+  /// @param preference the preference associated with this request (relative to
+  /// others in the portfolio)
+  /// @param exclusive a flag denoting that this request must be met
+  /// exclusively, i.e., in its entirety by a single offer
+  /// @param cost_function The cost function that the requester sets so that the
+  /// bidder may evaluate many potential resources.
+  /// @throws KeyError if a request is added from a different requester than the
+  /// original
+  Request<T>* AddRequest(const RequestTarget& target, Trader* requester,
+                         std::string commodity = "",
+                         double preference = kDefaultPref,
+                         bool exclusive = false,
+                         cost_function_t cost_function = NULL) {
+    Request<T>* r =
+        Request<T>::Create(target, requester, this->shared_from_this(),
+                           commodity, preference, exclusive, cost_function);
+    VerifyRequester_(r);
+    requests_.push_back(r);
+    mass_coeffs_[r] = 1;
+    qty_ += target.quantity;
+    return r;
+  }
+
   /// @brief adds a collection of requests (already having been registered with
   /// this portfolio) as multicommodity requests
   /// @param rs the collection of requests to add
@@ -153,8 +195,8 @@ class RequestPortfolio
     Request<T>* r;
     for (int i = 0; i < rs.size(); i++) {
       r = rs[i];
-      qty = r->target()->quantity();
-      mass_coeffs_[r] = r->target()->quantity() / avg_qty;
+      qty = r->target_quantity();
+      mass_coeffs_[r] = qty / avg_qty;
       qty_ -= qty;
     }
     qty_ += avg_qty;
@@ -0,0 +1,18 @@
+#include "request_target.h"
+
+#include "material.h"
+#include "product.h"
+
+namespace cyclus {
+
+template <>
+Material::Ptr MakeTarget<Material>(const RequestTarget& t) {
+  return Material::CreateUntracked(t.quantity, t.comp);
+}
+
+template <>
+Product::Ptr MakeTarget<Product>(const RequestTarget& t) {
+  return Product::CreateUntracked(t.quantity, t.quality);
+}
+
+}  // namespace cyclus
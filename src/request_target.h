@@ -0,0 +1,54 @@
+#ifndef CYCLUS_SRC_REQUEST_TARGET_H_
+#define CYCLUS_SRC_REQUEST_TARGET_H_
+
+#include <string>
+
+#include <boost/intrusive_ptr.hpp>
+
+#include "composition.h"
+#include "error.h"
+
+namespace cyclus {
+
+class Material;
+class Product;
+
+/// A description of the resource that a request asks for: its quantity and,
+/// optionally, the composition of a material or the quality of a product.
+/// Requests made from a description (see Request::Create) hold no resource
+/// of their own, so that exchanges with many requests, e.g., those of
+/// MatlBuyPolicy, don't allocate a resource for each one. The resource is
+/// only made if a bidder asks for the request's target (see
+/// Request::target); bidders that need no more than the quantity or the
+/// composition should use Request::target_quantity and Request::target_comp
+/// instead.
+struct RequestTarget {
+  explicit RequestTarget(double quantity,
+                         Composition::Ptr comp = Composition::Ptr(),
+                         std::string quality = "")
+      : quantity(quantity),
+        comp(comp),
+        quality(quality) {}
+
+  double quantity;
+  Composition::Ptr comp;
+  std::string quality;
+};
+
+/// Makes the untracked resource of type T that t describes.
+///
+/// @throws ValueError if T is neither Material nor Product
+template <class T>
+boost::intrusive_ptr<T> MakeTarget(const RequestTarget& t) {
+  throw ValueError("only material and product requests can be described");
+}
+
+template <>
+boost::intrusive_ptr<Material> MakeTarget<Material>(const RequestTarget& t);
+
+template <>
+boost::intrusive_ptr<Product> MakeTarget<Product>(const RequestTarget& t);
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_REQUEST_TARGET_H_
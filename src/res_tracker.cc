@@ -1,6 +1,11 @@
 #include "res_tracker.h"
 
+#include <algorithm>
+#include <unordered_map>
+
+#include "agent.h"
 #include "recorder.h"
+#include "table_writer.h"
 
 namespace cyclus {
 
@@ -22,11 +27,7 @@ void ResTracker::Create(Agent* creator) {
 
   parent1_ = 0;
   parent2_ = 0;
-  Record();
-  ctx_->NewDatum("ResCreators")
-      ->AddVal("ResourceId", res_->state_id())
-      ->AddVal("AgentId", creator->id())
-      ->Record();
+  Record(creator);
 }
 
 void ResTracker::Modify() {
@@ -64,21 +65,150 @@ void ResTracker::Absorb(ResTracker* absorbed) {
   Record();
 }
 
-void ResTracker::Record() {
+void ResTracker::Record(Agent* creator) {
   res_->BumpStateId();
-  ctx_->NewDatum("Resources")
-      ->AddVal("ResourceId", res_->state_id())
-      ->AddVal("ObjId", res_->obj_id())
-      ->AddVal("Type", res_->type())
-      ->AddVal("TimeCreated", ctx_->time())
-      ->AddVal("Quantity", res_->quantity())
-      ->AddVal("Units", res_->units())
-      ->AddVal("QualId", res_->qual_id())
-      ->AddVal("Parent1", parent1_)
-      ->AddVal("Parent2", parent2_)
-      ->Record();
+  ResCoalescer* c = ctx_->coalescer();
+  if (c != NULL) {
+    c->Add(res_->Clone(), ctx_->time(), parent1_, parent2_,
+           creator == NULL ? -1 : creator->id());
+    return;
+  }
+
+  ctx_->tables().resources.Record(res_->state_id(), res_->obj_id(),
+                                 res_->type(), ctx_->time(), res_->quantity(),
+                                 res_->units(), res_->qual_id(), parent1_,
+                                 parent2_);
 
   res_->Record(ctx_);
+  if (creator != NULL) {
+    ctx_->tables().res_creators.Record(res_->state_id(), creator->id());
+  }
+}
+
+void ResCoalescer::Add(Resource::Ptr r, int time, int parent1, int parent2,
+                       int creator) {
+  Row row = {r, time, parent1, parent2, creator};
+  std::lock_guard<std::mutex> lock(mu_);
+  rows_.push_back(row);
+}
+
+void ResCoalescer::Pin(int state_id) {
+  std::lock_guard<std::mutex> lock(mu_);
+  pinned_.insert(state_id);
+}
+
+size_t ResCoalescer::size() {
+  std::lock_guard<std::mutex> lock(mu_);
+  return rows_.size();
+}
+
+namespace {
+
+bool StateIdLess(const Resource::Ptr& a, const Resource::Ptr& b) {
+  return a->state_id() < b->state_id();
+}
+
+/// adds id to the parents in ps unless it is zero or already there. Returns
+/// false if there is no room left.
+bool AddParent(int id, int* ps, int* n) {
+  if (id == 0 || (*n > 0 && ps[0] == id) || (*n > 1 && ps[1] == id)) {
+    return true;
+  } else if (*n == 2) {
+    return false;
+  }
+  ps[(*n)++] = id;
+  return true;
+}
+
+}  // namespace
+
+void ResCoalescer::Flush(Context* ctx) {
+  std::vector<Row> rows;
+  std::unordered_set<int> pinned;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    rows.swap(rows_);
+    pinned.swap(pinned_);
+  }
+
+  // parents always have smaller state ids than their children, even when
+  // rows were buffered from several threads
+  std::vector<int> order(rows.size());
+  for (int i = 0; i < rows.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&rows](int a, int b) {
+    return StateIdLess(rows[a].snap, rows[b].snap);
+  });
+
+  std::unordered_map<int, int> index;
+  for (int i = 0; i < rows.size(); ++i) {
+    index[rows[i].snap->state_id()] = i;
+  }
+  std::vector<bool> keep(rows.size(), true);
+  for (int i = 0; i < rows.size(); ++i) {
+    const Row& r = rows[i];
+    int ps[2] = {r.parent1, r.parent2};
+    for (int k = 0; k < 2; ++k) {
+      std::unordered_map<int, int>::iterator it = index.find(ps[k]);
+      if (it != index.end()) {
+        keep[it->second] = false;  // superseded or absorbed
+      }
+    }
+  }
+  for (int i = 0; i < rows.size(); ++i) {
+    const Row& r = rows[i];
+    if (r.creator >= 0 || (r.parent1 == 0 && r.parent2 == 0) ||
+        pinned.count(r.snap->state_id()) > 0) {
+      keep[i] = true;
+    }
+  }
+
+  // point parents past dropped rows, whose own parents have been rewritten
+  // already since they come earlier in the order
+  for (int j = 0; j < order.size(); ++j) {
+    Row& r = rows[order[j]];
+    int orig[2] = {r.parent1, r.parent2};
+    int ps[2];
+    int n = 0;
+    bool fits = true;
+    for (int k = 0; k < 2 && fits; ++k) {
+      std::unordered_map<int, int>::iterator it = index.find(orig[k]);
+      if (it == index.end() || keep[it->second]) {
+        fits = AddParent(orig[k], ps, &n);
+      } else {
+        const Row& p = rows[it->second];
+        fits = AddParent(p.parent1, ps, &n) && AddParent(p.parent2, ps, &n);
+      }
+    }
+    if (fits) {
+      r.parent1 = n > 0 ? ps[0] : 0;
+      r.parent2 = n > 1 ? ps[1] : 0;
+      continue;
+    }
+    for (int k = 0; k < 2; ++k) {
+      std::unordered_map<int, int>::iterator it = index.find(orig[k]);
+      if (it != index.end()) {
+        keep[it->second] = true;
+      }
+    }
+  }
+
+  ResourcesWriter& resources = ctx->tables().resources;
+  for (int j = 0; j < order.size(); ++j) {
+    const Row& r = rows[order[j]];
+    if (!keep[order[j]]) {
+      continue;
+    }
+    const Resource::Ptr& s = r.snap;
+    resources.Record(s->state_id(), s->obj_id(), s->type(), r.time,
+                     s->quantity(), s->units(), s->qual_id(), r.parent1,
+                     r.parent2);
+    s->Record(ctx);
+    if (r.creator >= 0) {
+      ctx->tables().res_creators.Record(s->state_id(), r.creator);
+    }
+  }
 }
 
 }  // namespace cyclus
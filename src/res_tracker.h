@@ -1,7 +1,9 @@
 #ifndef CYCLUS_SRC_RES_TRACKER_H_
 #define CYCLUS_SRC_RES_TRACKER_H_
 
+#include <mutex>
 #include <string>
+#include <unordered_set>
 #include <vector>
 #include <boost/shared_ptr.hpp>
 
@@ -44,7 +46,9 @@ class ResTracker {
   void Modify();
 
  private:
-  void Record();
+  /// records the current state of the tracked resource, and its creator if
+  /// not NULL, or hands it to the context's ResCoalescer if there is one.
+  void Record(Agent* creator = NULL);
 
   int parent1_;
   int parent2_;
@@ -53,6 +57,46 @@ class ResTracker {
   Context* ctx_;
 };
 
+/// Buffers the Resources rows recorded by ResTrackers during a time step, when
+/// resource tracking is coalesced (see Context::coalescer), and writes out
+/// only the rows needed to keep every resource's lineage: the last state of
+/// each resource that was not absorbed into another, every creation, and
+/// every state that was pinned because it is referred to elsewhere, e.g. by
+/// a transaction. The parents of the rows written skip over the dropped
+/// intermediate states to their nearest recorded ancestors, except where a
+/// row would end up with more than two parents; such intermediates are kept.
+///
+/// @warning state ids of dropped states are never recorded, so archetypes
+/// that record resource state ids in their own tables should pin them.
+class ResCoalescer {
+ public:
+  /// Buffers the row for the current state of r (a snapshot from
+  /// Resource::Clone) with the given parents and creator id (or -1).
+  void Add(Resource::Ptr r, int time, int parent1, int parent2, int creator);
+
+  /// Marks the given state as referenced elsewhere so that it is kept.
+  void Pin(int state_id);
+
+  /// Writes out the buffered rows that are kept and discards the rest.
+  void Flush(Context* ctx);
+
+  /// The number of buffered rows.
+  size_t size();
+
+ private:
+  struct Row {
+    Resource::Ptr snap;
+    int time;
+    int parent1;
+    int parent2;
+    int creator;
+  };
+
+  std::mutex mu_;
+  std::vector<Row> rows_;
+  std::unordered_set<int> pinned_;
+};
+
 }  // namespace cyclus
 
 #endif  // CYCLUS_SRC_RES_TRACKER_H_
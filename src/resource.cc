@@ -1,13 +1,16 @@
 #include "resource.h"
 
+#include "context.h"
+
 namespace cyclus {
 
-int Resource::nextstate_id_ = 1;
-int Resource::nextobj_id_ = 1;
+Resource::Resource(Context* ctx)
+    : ids_(ctx != NULL ? &ctx->ids() : NULL),
+      state_id_(ids()->Next(IdAllocator::RESOURCE_STATE)),
+      obj_id_(ids()->Next(IdAllocator::RESOURCE_OBJ)) {}
 
 void Resource::BumpStateId() {
-  state_id_ = nextstate_id_;
-  nextstate_id_++;
+  state_id_ = ids()->Next(IdAllocator::RESOURCE_STATE);
 }
 
 }  // namespace cyclus
@@ -3,7 +3,10 @@
 
 #include <string>
 #include <vector>
-#include <boost/shared_ptr.hpp>
+#include <boost/intrusive_ptr.hpp>
+
+#include "id_allocator.h"
+#include "intrusive_base.h"
 
 class SimInitTest;
 
@@ -16,14 +19,23 @@ typedef std::string ResourceType;
 /// Resource defines an abstract interface implemented by types that are
 /// offered, requested, and transferred between simulation agents. Resources
 /// represent the lifeblood of a simulation.
-class Resource {
+///
+/// Resources are reference counted in place (see IntrusiveBase), so that a
+/// resource and its count take a single allocation and handles to it are
+/// copied without touching a separate control block.
+class Resource : IntrusiveBase<Resource> {
   friend class SimInit;
   friend class ::SimInitTest;
 
  public:
-  typedef boost::shared_ptr<Resource> Ptr;
+  typedef boost::intrusive_ptr<Resource> Ptr;
 
-  Resource() : state_id_(nextstate_id_++), obj_id_(nextobj_id_++) {}
+  /// Creates a resource whose ids are handed out by the current id
+  /// allocator (see IdAllocator::current).
+  Resource()
+      : ids_(NULL),
+        state_id_(ids()->Next(IdAllocator::RESOURCE_STATE)),
+        obj_id_(ids()->Next(IdAllocator::RESOURCE_OBJ)) {}
 
   virtual ~Resource() {}
 
@@ -79,9 +91,21 @@ class Resource {
   /// @return a new resource object with same state id and quantity == quantity
   virtual Ptr ExtractRes(double quantity) = 0;
 
+ protected:
+  /// Creates a resource whose ids are handed out by the id allocator of ctx,
+  /// or by the current one if ctx is NULL.
+  explicit Resource(Context* ctx);
+
+  /// Returns the allocator handing out this resource's ids.
+  inline IdAllocator* ids() const {
+    return ids_ != NULL ? ids_ : IdAllocator::current();
+  }
+
  private:
-  static int nextstate_id_;
-  static int nextobj_id_;
+  // the allocator of the resource's simulation, or NULL for the current one;
+  // it hands out ids atomically so that resources may be created by
+  // thread-safe traders while bids and requests are collected in parallel
+  IdAllocator* ids_;
   int state_id_;
   int obj_id_;
 };
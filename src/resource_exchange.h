@@ -2,15 +2,26 @@
 #define CYCLUS_SRC_RESOURCE_EXCHANGE_H_
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
 #include <functional>
+#include <future>
+#include <map>
 #include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include "agent_profiler.h"
 #include "bid_portfolio.h"
 #include "context.h"
 #include "exchange_context.h"
 #include "product.h"
 #include "material.h"
 #include "request_portfolio.h"
+#include "task_scheduler.h"
+#include "toolkit/spatial_index.h"
 #include "trader.h"
 #include "trader_management.h"
 
@@ -26,6 +37,19 @@ inline static void AdjustPrefs(Agent* m, PrefMap<Material>::type& prefs) {
 inline static void AdjustPrefs(Agent* m, PrefMap<Product>::type& prefs) {
   m->AdjustProductPrefs(prefs);
 }
+template<class T>
+inline static bool ChangePrefs(Agent* m, const typename PrefMap<T>::type& prefs,
+                               PrefChanges<T>* changes) {
+  return false;
+}
+inline static bool ChangePrefs(Agent* m, const PrefMap<Material>::type& prefs,
+                               PrefChanges<Material>* changes) {
+  return m->ChangeMatlPrefs(prefs, changes);
+}
+inline static bool ChangePrefs(Agent* m, const PrefMap<Product>::type& prefs,
+                               PrefChanges<Product>* changes) {
+  return m->ChangeProductPrefs(prefs, changes);
+}
 inline static void AdjustPrefs(Trader* t, PrefMap<Material>::type& prefs) {
   t->AdjustMatlPrefs(prefs);
 }
@@ -57,16 +81,32 @@ inline static void AdjustPrefs(Trader* t, PrefMap<Product>::type& prefs) {
 /// exchng.AddAllBids();
 /// exchng.AdjustAll();
 /// @endcode
+///
+/// Requests and bids of traders that declare their callbacks thread-safe (see
+/// Trader::ThreadSafeExchange) are collected on up to threads() threads. All
+/// other traders are queried serially on the calling thread.
+///
+/// If the context limits the distance of trades (see
+/// Context::max_trade_distance), traders placed on the map are only asked to
+/// bid on the requests of unplaced traders and of placed traders within that
+/// distance, so that far-apart traders never add arcs to the exchange.
 template <class T>
 class ResourceExchange {
  public:
   /// @brief default constructor
   ///
   /// @param ctx the simulation context
-  ResourceExchange(Context* ctx) {
+  ResourceExchange(Context* ctx) : threads_(1) {
     sim_ctx_ = ctx;
   }
 
+  /// @brief sets the number of threads used to query thread-safe traders. The
+  /// default is 1, i.e., all traders are queried serially.
+  void set_threads(int n) { threads_ = n < 1 ? 1 : n; }
+
+  /// @brief the number of threads used to query thread-safe traders
+  int threads() const { return threads_; }
+
   inline ExchangeContext<T>& ex_ctx() {
     return ex_ctx_;
   }
@@ -74,21 +114,54 @@ class ResourceExchange {
   /// @brief queries traders and collects all requests for bids
   void AddAllRequests() {
     InitTraders();
-    std::for_each(
-        traders_.begin(),
-        traders_.end(),
-        std::bind1st(std::mem_fun(&cyclus::ResourceExchange<T>::AddRequests_),
-                     this));
+    std::vector<std::set<typename RequestPortfolio<T>::Ptr> > rps;
+    std::vector<Trader*> traders(traders_.begin(), traders_.end());
+    QueryAll(traders,
+             [](Trader* t) { return StartRequests<T>(t); },
+             [](Trader* t) { return QueryRequests<T>(t); },
+             AgentProfiler::REQUESTS, &rps);
+    for (int i = 0; i != rps.size(); i++) {
+      typename std::set<typename RequestPortfolio<T>::Ptr>::iterator it;
+      for (it = rps[i].begin(); it != rps[i].end(); ++it) {
+        ex_ctx_.AddRequestPortfolio(*it);
+      }
+    }
   }
 
   /// @brief queries traders and collects all responses to requests for bids
   void AddAllBids() {
     InitTraders();
-    std::for_each(
-        traders_.begin(),
-        traders_.end(),
-        std::bind1st(std::mem_fun(&cyclus::ResourceExchange<T>::AddBids_),
-                     this));
+    LocalizeRequests();
+    std::vector<std::set<typename BidPortfolio<T>::Ptr> > bps;
+    typename CommodMap<T>::type& commod_requests = ex_ctx_.commod_requests;
+    std::map<Trader*, typename CommodMap<T>::type>& local = local_requests_;
+    auto requests = [&commod_requests, &local](Trader* t)
+        -> typename CommodMap<T>::type& {
+      typename std::map<Trader*, typename CommodMap<T>::type>::iterator it =
+          local.find(t);
+      return it == local.end() ? commod_requests : it->second;
+    };
+
+    // traders that name the commodities they bid on are only asked when
+    // there are requests for them
+    std::vector<Trader*> bidders;
+    typename std::set<Trader*, trader_compare>::iterator t;
+    for (t = traders_.begin(); t != traders_.end(); ++t) {
+      const std::set<std::string>* commods =
+          sim_ctx_->bid_commods(*t, T::kType);
+      if (commods == NULL || Requested(*commods, requests(*t)))
+        bidders.push_back(*t);
+    }
+    QueryAll(bidders,
+             [&requests](Trader* t) { return StartBids<T>(t, requests(t)); },
+             [&requests](Trader* t) { return QueryBids<T>(t, requests(t)); },
+             AgentProfiler::BIDS, &bps);
+    for (int i = 0; i != bps.size(); i++) {
+      typename std::set<typename BidPortfolio<T>::Ptr>::iterator it;
+      for (it = bps[i].begin(); it != bps[i].end(); ++it) {
+        ex_ctx_.AddBidPortfolio(*it);
+      }
+    }
   }
 
   /// @brief adjust preferences for requests given bid responses
@@ -110,43 +183,206 @@ class ResourceExchange {
  private:
   void InitTraders() {
     if (traders_.size() == 0) {
-      std::set<Trader*> orig = sim_ctx_->traders();
+      const std::set<Trader*>& orig = sim_ctx_->traders(T::kType);
       std::set<Trader*>::iterator it;
       for (it = orig.begin(); it != orig.end(); ++it) {
-        traders_.insert(*it);
+        // sleeping agents sit out the exchange
+        Agent* m = (*it)->manager();
+        if (m == NULL || !sim_ctx_->asleep(m))
+          traders_.insert(*it);
+      }
+    }
+  }
+
+  /// @brief sets local_requests_ to the requests offered to each placed
+  /// trader, if the context limits the distance of trades. The requests of
+  /// each commodity keep their order in the exchange context.
+  void LocalizeRequests() {
+    local_requests_.clear();
+    double km = sim_ctx_->max_trade_distance();
+    toolkit::SpatialIndex& positions = sim_ctx_->positions();
+    if (km <= 0 || positions.size() == 0)
+      return;
+
+    // the requests of each placed requester, and of all unplaced ones under
+    // -1, with their commodities and places among its requests
+    typedef std::pair<int, Request<T>*> Placed;
+    std::map<int, std::vector<std::pair<std::string, Placed> > > by_agent;
+    typename CommodMap<T>::type::iterator it;
+    for (it = ex_ctx_.commod_requests.begin();
+         it != ex_ctx_.commod_requests.end(); ++it) {
+      for (int i = 0; i != it->second.size(); i++) {
+        Request<T>* r = it->second[i];
+        int id = r->requester()->manager()->id();
+        by_agent[positions.Has(id) ? id : -1].push_back(
+            std::make_pair(it->first, Placed(i, r)));
+      }
+    }
+
+    typename std::set<Trader*, trader_compare>::iterator t;
+    for (t = traders_.begin(); t != traders_.end(); ++t) {
+      Agent* m = (*t)->manager();
+      if (m == NULL || !positions.Has(m->id()))
+        continue;
+      std::vector<int> near = positions.Near(m->id(), km);
+      near.push_back(-1);
+      std::map<std::string, std::vector<Placed> > picked;
+      for (int i = 0; i != near.size(); i++) {
+        typename std::map<int, std::vector<std::pair<std::string, Placed> > >::
+            iterator reqs = by_agent.find(near[i]);
+        if (reqs == by_agent.end())
+          continue;
+        for (int j = 0; j != reqs->second.size(); j++) {
+          picked[reqs->second[j].first].push_back(reqs->second[j].second);
+        }
+      }
+      typename CommodMap<T>::type& local = local_requests_[*t];
+      typename std::map<std::string, std::vector<Placed> >::iterator p;
+      for (p = picked.begin(); p != picked.end(); ++p) {
+        std::sort(p->second.begin(), p->second.end());
+        std::vector<Request<T>*>& reqs = local[p->first];
+        for (int j = 0; j != p->second.size(); j++) {
+          reqs.push_back(p->second[j].second);
+        }
       }
     }
   }
 
-  /// @brief queries a given facility agent for
-  void AddRequests_(Trader* t) {
-    std::set<typename RequestPortfolio<T>::Ptr> rp = QueryRequests<T>(t);
-    typename std::set<typename RequestPortfolio<T>::Ptr>::iterator it;
-    for (it = rp.begin(); it != rp.end(); ++it) {
-      ex_ctx_.AddRequestPortfolio(*it);
+  /// @brief returns whether there are requests of any of commods
+  static bool Requested(const std::set<std::string>& commods,
+                        const typename CommodMap<T>::type& requests) {
+    std::set<std::string>::const_iterator c;
+    for (c = commods.begin(); c != commods.end(); ++c) {
+      typename CommodMap<T>::type::const_iterator r = requests.find(*c);
+      if (r != requests.end() && !r->second.empty())
+        return true;
     }
+    return false;
   }
 
-  /// @brief queries a given facility agent for
-  void AddBids_(Trader* t) {
-    std::set<typename BidPortfolio<T>::Ptr> bp =
-        QueryBids<T>(t, ex_ctx_.commod_requests);
-    typename std::set<typename BidPortfolio<T>::Ptr>::iterator it;
-    for (it = bp.begin(); it != bp.end(); ++it) {
-      ex_ctx_.AddBidPortfolio(*it);
+  /// @brief sets (*results)[i] to query(t) for the ith trader, t, of traders.
+  /// First, start(t) is called for every trader, in order, and the traders
+  /// that return a valid future are queried only once it is ready. Then the
+  /// thread-safe traders are queried, on up to threads_ threads, and all
+  /// others serially, in order, waiting on the futures as their traders come
+  /// up, so that the work of every future overlaps. Each thread-safe trader
+  /// draws the resource ids it hands out from a block reserved for it in
+  /// trader order beforehand, so that they do not depend on how the threads
+  /// are scheduled unless it creates more than kIdsPerQuery resources. If
+  /// any starts, futures, or queries throw, the exception of the first such
+  /// trader is rethrown once all queries are done. Queries are profiled as
+  /// call if the context profiles agents.
+  template <class Start, class Query, class Result>
+  void QueryAll(const std::vector<Trader*>& traders, Start start, Query query,
+                AgentProfiler::Call call, std::vector<Result>* results) {
+    AgentProfiler* prof = sim_ctx_->profiler();
+    int n = traders.size();
+    results->clear();
+    results->resize(n);
+    std::vector<std::exception_ptr> errs(n);
+
+    std::vector<std::future<void> > started(n);
+    for (int i = 0; i != n; i++) {
+      try {
+        ProfileCall p(prof, traders[i]->manager(), call);
+        started[i] = start(traders[i]);
+      } catch (...) {
+        errs[i] = std::current_exception();
+      }
+    }
+
+    std::vector<int> parallel;
+    if (threads_ > 1) {
+      for (int i = 0; i != n; i++) {
+        if (!errs[i] && !started[i].valid() &&
+            traders[i]->ThreadSafeExchange())
+          parallel.push_back(i);
+      }
+    }
+    if (parallel.size() < 2)
+      parallel.clear();
+
+    typedef IdAllocator::Block Block;
+    std::vector<Block> states;
+    std::vector<Block> objs;
+    states.reserve(parallel.size());
+    objs.reserve(parallel.size());
+    for (int k = 0; k != parallel.size(); k++) {
+      states.push_back(Block(&sim_ctx_->ids(), IdAllocator::RESOURCE_STATE,
+                             kIdsPerQuery));
+      states.back().Reserve();
+      objs.push_back(Block(&sim_ctx_->ids(), IdAllocator::RESOURCE_OBJ,
+                           kIdsPerQuery));
+      objs.back().Reserve();
+    }
+
+    std::atomic<int> next(0);
+    IdAllocator* ids = IdAllocator::current();
+    auto worker = [&]() {
+      IdAllocator::Scope scope(ids);
+      for (int k = next++; k < parallel.size(); k = next++) {
+        int i = parallel[k];
+        try {
+          IdAllocator::BlockScope state_ids(&states[k]);
+          IdAllocator::BlockScope obj_ids(&objs[k]);
+          ProfileCall p(prof, traders[i]->manager(), call);
+          (*results)[i] = query(traders[i]);
+        } catch (...) {
+          errs[i] = std::current_exception();
+        }
+      }
+    };
+    if (!parallel.empty()) {
+      sim_ctx_->scheduler()->RunWorkers(
+          std::min<int>(threads_, parallel.size()), worker);
+    }
+
+    std::vector<bool> done(n, false);
+    for (int k = 0; k != parallel.size(); k++) {
+      done[parallel[k]] = true;
+    }
+    for (int i = 0; i != n; i++) {
+      if (started[i].valid()) {
+        try {
+          started[i].get();
+        } catch (...) {
+          errs[i] = std::current_exception();
+        }
+      }
+      if (errs[i])
+        std::rethrow_exception(errs[i]);
+      if (!done[i]) {
+        ProfileCall p(prof, traders[i]->manager(), call);
+        (*results)[i] = query(traders[i]);
+      }
     }
   }
 
   /// @brief allows a trader and its parents to adjust any preferences in the
-  /// system
+  /// system. Parents that implement the sparse ChangeMatlPrefs or
+  /// ChangeProductPrefs hooks only see a const view of the preferences, and
+  /// only the changes they return are applied.
   void AdjustPrefs_(Trader* t) {
-    typename PrefMap<T>::type& prefs = ex_ctx_.trader_prefs[t];
-    AdjustPrefs(t, prefs);
+    AgentProfiler* prof = sim_ctx_->profiler();
+    typename PrefMap<T>::type& prefs = prefs_[t];
+    ex_ctx_.ViewPrefs(t, &prefs);
+    {
+      ProfileCall p(prof, t->manager(), AgentProfiler::PREFS);
+      AdjustPrefs(t, prefs);
+    }
     Agent* m = t->manager()->parent();
     while (m != NULL) {
-      AdjustPrefs(m, prefs);
+      ProfileCall p(prof, m, AgentProfiler::PREFS);
+      changes_.clear();
+      if (ChangePrefs(m, static_cast<const typename PrefMap<T>::type&>(prefs),
+                      &changes_)) {
+        changes_.ApplyTo(prefs);
+      } else {
+        AdjustPrefs(m, prefs);
+      }
       m = m->parent();
     }
+    ex_ctx_.StorePrefs(t, prefs);
   }
 
   struct trader_compare {
@@ -169,6 +405,23 @@ class ResourceExchange {
 
   Context* sim_ctx_;
   ExchangeContext<T> ex_ctx_;
+
+  // the requests offered to each placed trader when the distance of trades
+  // is limited; every other trader is offered all of them
+  std::map<Trader*, typename CommodMap<T>::type> local_requests_;
+
+  // the preferences of each trader while they are adjusted, which the
+  // python archetypes cache by address within a time step
+  std::map<Trader*, typename PrefMap<T>::type> prefs_;
+
+  // reused by AdjustPrefs_ to collect each parent's sparse changes
+  PrefChanges<T> changes_;
+
+  int threads_;
+
+  // the resource ids reserved for each thread-safe trader queried in
+  // parallel, of each kind
+  static const int kIdsPerQuery = 16;
 };
 
 }  // namespace cyclus
@@ -1,10 +1,33 @@
 #include "sim_init.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <list>
+#include <map>
+#include <set>
+#include <thread>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/uuid/uuid.hpp>
+
+#include "blob.h"
+#include "auction_solver.h"
+#include "binary_state.h"
+#include "env.h"
+#include "flow_solver.h"
 #include "greedy_preconditioner.h"
 #include "greedy_solver.h"
 #include "platform.h"
 #include "prog_solver.h"
 #include "region.h"
+#include "res_tracker.h"
+#include "staging_back.h"
+#include "state_image.h"
+#include "task_scheduler.h"
+#include "tracer.h"
 
 namespace cyclus {
 
@@ -14,7 +37,362 @@ class Dummy : public Region {
   Dummy* Clone() { return NULL; }
 };
 
-SimInit::SimInit() : rec_(NULL), ctx_(NULL) {}
+InitPhase::~InitPhase() {
+  double secs = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start_).count();
+  SimInit::init_timings().push_back(std::make_pair(name_, secs));
+}
+
+namespace {
+
+// Writes the value v to w if it holds a T, and returns whether it did.
+template <class T>
+bool PutAs(const boost::spirit::hold_any& v, BinaryWriter* w) {
+  if (v.type() != BOOST_SP_TYPEID(T)) {
+    return false;
+  }
+  w->Put(v.cast<T>());
+  return true;
+}
+
+// Writes the value v to w if it holds one of the types commonly found in
+// agent state, and returns whether it did.
+bool PutVal(const boost::spirit::hold_any& v, BinaryWriter* w) {
+  using std::list;
+  using std::map;
+  using std::set;
+  using std::string;
+  using std::vector;
+  return PutAs<int>(v, w) || PutAs<bool>(v, w) || PutAs<double>(v, w) ||
+         PutAs<float>(v, w) || PutAs<string>(v, w) || PutAs<Blob>(v, w) ||
+         PutAs<boost::uuids::uuid>(v, w) || PutAs<vector<int> >(v, w) ||
+         PutAs<vector<double> >(v, w) || PutAs<vector<string> >(v, w) ||
+         PutAs<set<int> >(v, w) || PutAs<set<string> >(v, w) ||
+         PutAs<list<int> >(v, w) || PutAs<list<string> >(v, w) ||
+         PutAs<map<int, int> >(v, w) || PutAs<map<int, double> >(v, w) ||
+         PutAs<map<int, string> >(v, w) || PutAs<map<string, int> >(v, w) ||
+         PutAs<map<string, double> >(v, w) ||
+         PutAs<map<string, string> >(v, w);
+}
+
+// Serializes the titles, fields, and values of the datums recorded for an
+// agent's state, other than the time they were recorded at, to bytes, which
+// are equal for two states only if the states are. Returns false if a value
+// cannot be serialized.
+bool SerializeState(const DatumList& state, std::string* bytes) {
+  std::string buf;
+  BinaryWriter w(&buf);
+  for (int i = 0; i < state.size(); ++i) {
+    Datum* d = state[i];
+    w.Put(d->title());
+    const Datum::Vals& vals = d->vals();
+    w.PutRaw<boost::uint32_t>(vals.size());
+    for (int j = 0; j < vals.size(); ++j) {
+      std::string field = vals[j].first;
+      if (field == "SimId" || field == "SimTime") {
+        continue;
+      }
+      w.Put(field);
+      if (!PutVal(vals[j].second, &w)) {
+        return false;
+      }
+    }
+  }
+  bytes->swap(buf);
+  return true;
+}
+
+// Serializes the kernel state of m that its Snapshot does not cover, i.e.,
+// what Agent::Snapshot records, along with the resource states in its
+// inventories.
+std::string KernelState(Agent* m, const Inventories& invs) {
+  std::string buf;
+  BinaryWriter w(&buf);
+  w.Put(m->prototype());
+  w.Put(m->lifetime());
+  Inventories::const_iterator it;
+  for (it = invs.begin(); it != invs.end(); ++it) {
+    w.Put(it->first);
+    w.PutRaw<boost::uint32_t>(it->second.size());
+    for (int i = 0; i < it->second.size(); ++i) {
+      w.Put(it->second[i]->state_id());
+    }
+  }
+  return buf;
+}
+
+// Adds the staged state of m to the image, with its binary state in place of
+// the datums of its archetype's own state if it has one.
+void AddToImage(Agent* m, const DatumList& state, StateImageWriter* image) {
+  std::string binary;
+  BinaryWriter w(&binary);
+  if (!m->SnapshotBinary(&w)) {
+    image->Add(m->id(), state);
+    return;
+  }
+  std::string info = "AgentState" + AgentSpec(m->spec()).Sanitize() + "Info";
+  DatumList base;
+  for (int i = 0; i < state.size(); ++i) {
+    if (state[i]->title() != info) {
+      base.push_back(state[i]);
+    }
+  }
+  image->Add(m->id(), base, binary);
+}
+
+// Stages the state of m to be copied into a forked simulation, putting its
+// archetype's own state in (*binary)[m->id()] instead if it has a binary form.
+void StageForFork(Agent* m, std::map<int, std::string>* binary) {
+  m->Agent::Snapshot(DbInit(m, true));
+  std::string buf;
+  BinaryWriter w(&buf);
+  if (m->SnapshotBinary(&w)) {
+    (*binary)[m->id()].swap(buf);
+  } else {
+    m->Snapshot(DbInit(m));
+  }
+}
+
+}  // namespace
+
+/// Reads each agent state table of a simulation once per snapshot time and
+/// hands out the rows of single agents from memory. Backends without indices
+/// (e.g. Hdf5Back) scan a whole table for every query, so querying the state
+/// tables once per agent would make initialization quadratic in the number
+/// of agents. The state of agents found in a StateImage is read from the
+/// image instead, and so is the binary state of agents that have one (see
+/// Agent::SnapshotBinary).
+class AgentStateCache {
+ public:
+  explicit AgentStateCache(QueryableBackend* b)
+      : b_(b),
+        image_(NULL),
+        binary_(NULL),
+        proto_min_(0),
+        proto_max_(-1) {}
+
+  /// Sets the image taken at the snapshot being restarted from, or NULL.
+  void image(StateImage* img) { image_ = img; }
+
+  /// Sets the binary states of agents by id, or NULL.
+  void binary(const std::map<int, std::string>* states) { binary_ = states; }
+
+  /// Points *begin and *end at the binary state of agent id at time t, or of
+  /// a prototype if t is -1. Returns false if there is none.
+  bool Binary(int id, int t, const char** begin, const char** end) {
+    if (binary_ != NULL) {
+      std::map<int, std::string>::const_iterator it = binary_->find(id);
+      if (it != binary_->end()) {
+        *begin = it->second.data();
+        *end = *begin + it->second.size();
+        return true;
+      }
+    }
+    return t != -1 && image_ != NULL && image_->Binary(id, begin, end);
+  }
+
+  /// Sets the range of the ids of the prototypes, whose state is read
+  /// regardless of the time it was recorded.
+  void prototypes(int min_id, int max_id) {
+    proto_min_ = min_id;
+    proto_max_ = max_id;
+  }
+
+  /// Sets qr to the rows of table recorded for agent id at time t, or for a
+  /// prototype at any time if t is -1. Returns false if the table cannot be
+  /// read in bulk (e.g. it doesn't exist), in which case the agent's rows are
+  /// to be queried from the backend instead.
+  bool Rows(const std::string& table, int id, int t, QueryResult* qr) {
+    // the image holds the full state of every agent alive at the snapshot,
+    // including those whose state is recorded at an earlier time
+    if (t != -1 && image_ != NULL && image_->Rows(id, table, qr)) {
+      return true;
+    }
+
+    Table& tbl = Load(table, t);
+    if (!tbl.ok) {
+      return false;
+    }
+    qr->fields = tbl.fields;
+    qr->types = tbl.types;
+    qr->rows.clear();
+    std::map<int, std::vector<QueryRow> >::iterator it = tbl.rows.find(id);
+    if (it != tbl.rows.end()) {
+      qr->rows = it->second;
+    }
+    return true;
+  }
+
+ private:
+  struct Table {
+    bool ok;
+    std::vector<std::string> fields;
+    std::vector<DbTypes> types;
+    std::map<int, std::vector<QueryRow> > rows;  // by agent id
+  };
+
+  Table& Load(const std::string& table, int t) {
+    std::pair<std::string, int> key(table, t);
+    std::map<std::pair<std::string, int>, Table>::iterator it =
+        tables_.find(key);
+    if (it != tables_.end()) {
+      return it->second;
+    }
+
+    Table& tbl = tables_[key];
+    tbl.ok = false;
+    std::vector<Cond> conds;
+    if (t == -1) {
+      conds.push_back(Cond("AgentId", ">=", proto_min_));
+      conds.push_back(Cond("AgentId", "<=", proto_max_));
+    } else {
+      conds.push_back(Cond("SimTime", "==", t));
+    }
+    QueryResult qr;
+    try {
+      qr = b_->Query(table, &conds);
+    } catch (std::exception err) {
+      return tbl;
+    }  // table doesn't exist or isn't agent state
+
+    int col = std::find(qr.fields.begin(), qr.fields.end(), "AgentId") -
+              qr.fields.begin();
+    if (!qr.rows.empty() && col == qr.fields.size()) {
+      return tbl;
+    }
+    for (int i = 0; i < qr.rows.size(); ++i) {
+      std::vector<QueryRow>& rows = tbl.rows[qr.rows[i][col].cast<int>()];
+      rows.push_back(QueryRow());
+      rows.back().swap(qr.rows[i]);
+    }
+    tbl.fields.swap(qr.fields);
+    tbl.types.swap(qr.types);
+    tbl.ok = true;
+    return tbl;
+  }
+
+  QueryableBackend* b_;
+  StateImage* image_;
+  const std::map<int, std::string>* binary_;
+  int proto_min_;
+  int proto_max_;
+  std::map<std::pair<std::string, int>, Table> tables_;
+};
+
+namespace {
+
+/// Serves the queries of a single agent's InitFrom from an AgentStateCache.
+/// Queries with conditions of their own go to the backend.
+class AgentStateView : public QueryableBackend {
+ public:
+  AgentStateView(AgentStateCache* cache, QueryableBackend* b,
+                 std::string prefix, int id, int t)
+      : cache_(cache),
+        b_(b),
+        prefix_(prefix),
+        id_(id),
+        t_(t) {}
+
+  using QueryableBackend::Query;
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds) {
+    QueryResult qr;
+    if (conds == NULL && cache_->Rows(prefix_ + table, id_, t_, &qr)) {
+      return qr;
+    }
+
+    std::vector<Cond> c;
+    if (conds != NULL) {
+      c = *conds;
+    }
+    c.push_back(Cond("AgentId", "==", id_));
+    if (t_ != -1) {
+      c.push_back(Cond("SimTime", "==", t_));
+    }
+    return b_->Query(prefix_ + table, &c);
+  }
+
+  virtual std::map<std::string, DbTypes> ColumnTypes(std::string table) {
+    return b_->ColumnTypes(table);
+  }
+
+  virtual std::list<ColumnInfo> Schema(std::string table) {
+    return b_->Schema(table);
+  }
+
+  virtual std::set<std::string> Tables() { return b_->Tables(); }
+
+ private:
+  AgentStateCache* cache_;
+  QueryableBackend* b_;
+  std::string prefix_;
+  int id_;
+  int t_;
+};
+
+/// Replaces the values of the named fields in the results of every query.
+class OverrideBack : public QueryableBackend {
+ public:
+  OverrideBack(QueryableBackend* b,
+               const std::map<std::string, boost::spirit::hold_any>& vals)
+      : b_(b),
+        vals_(vals) {}
+
+  using QueryableBackend::Query;
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds) {
+    QueryResult qr = b_->Query(table, conds);
+    for (int j = 0; j < qr.fields.size(); ++j) {
+      std::map<std::string, boost::spirit::hold_any>::iterator it =
+          vals_.find(qr.fields[j]);
+      if (it == vals_.end()) {
+        continue;
+      }
+      for (int i = 0; i < qr.rows.size(); ++i) {
+        qr.rows[i][j] = it->second;
+      }
+    }
+    return qr;
+  }
+
+  virtual std::map<std::string, DbTypes> ColumnTypes(std::string table) {
+    return b_->ColumnTypes(table);
+  }
+
+  virtual std::list<ColumnInfo> Schema(std::string table) {
+    return b_->Schema(table);
+  }
+
+  virtual std::set<std::string> Tables() { return b_->Tables(); }
+
+ private:
+  QueryableBackend* b_;
+  std::map<std::string, boost::spirit::hold_any> vals_;
+};
+
+/// Converts s to the type of the value like.
+boost::spirit::hold_any ParseAs(const boost::spirit::hold_any& like,
+                                const std::string& field,
+                                const std::string& s) {
+  try {
+    if (like.type() == BOOST_SP_TYPEID(int)) {
+      return boost::spirit::hold_any(boost::lexical_cast<int>(s));
+    } else if (like.type() == BOOST_SP_TYPEID(double)) {
+      return boost::spirit::hold_any(boost::lexical_cast<double>(s));
+    } else if (like.type() == BOOST_SP_TYPEID(float)) {
+      return boost::spirit::hold_any(boost::lexical_cast<float>(s));
+    } else if (like.type() == BOOST_SP_TYPEID(bool)) {
+      return boost::spirit::hold_any(s == "true" || s == "1");
+    } else if (like.type() == BOOST_SP_TYPEID(std::string)) {
+      return boost::spirit::hold_any(s);
+    }
+  } catch (const boost::bad_lexical_cast&) {
+    throw ValueError("invalid value '" + s + "' for field " + field);
+  }
+  throw ValueError("field " + field + " is not of a type that can be set");
+}
+
+}  // namespace
+
+SimInit::SimInit() : rec_(NULL), ctx_(NULL), cache_(NULL) {}
 
 SimInit::~SimInit() {
   if (ctx_ != NULL) {
@@ -41,20 +419,275 @@ void SimInit::Restart(QueryableBackend* b, boost::uuids::uuid sim_id, int t) {
   ctx_->InitSim(si_);  // explicitly force this to show up in the new simulations output db
 }
 
+int SimInit::LatestCheckpoint(QueryableBackend* b,
+                              boost::uuids::uuid* sim_id) {
+  QueryResult qr;
+  try {
+    qr = b->Query("Checkpoints", NULL);
+  } catch (std::exception err) {}  // table doesn't exist
+
+  bool any = sim_id->is_nil();
+  int t = -1;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    boost::uuids::uuid id = qr.GetVal<boost::uuids::uuid>("SimId", i);
+    if (!any && id != *sim_id) {
+      continue;
+    }
+    // checkpoints of the most recently written simulation win
+    if (id != *sim_id) {
+      *sim_id = id;
+      t = -1;
+    }
+    t = std::max(t, qr.GetVal<int>("Time", i));
+  }
+  return t;
+}
+
 void SimInit::Branch(QueryableBackend* b, boost::uuids::uuid prev_sim_id,
                      int t, boost::uuids::uuid new_sim_id) {
   throw Error("simulation branching feature not implemented");
 }
 
+void SimInit::Fork(Context* ctx, Recorder* r, int seed) {
+  InitPhase phase("Fork");
+  int t = ctx->time();
+  Recorder tmprec;
+  rec_ = &tmprec;  // use dummy recorder to avoid re-recording
+  ctx_ = new Context(&ti_, rec_);
+  ctx_->ids().CopyFrom(&ctx->ids());  // for the product qualities
+  t_ = t;
+  simid_ = ctx->sim_id();
+
+  si_ = ctx->sim_info();
+  si_.parent_sim = simid_;
+  si_.parent_type = "fork";
+  si_.branch_time = t;
+  if (seed >= 0)
+    si_.seed = seed;
+  ctx_->InitSim(si_);
+  ti_.threads(ctx->ti_->threads());
+
+  ExchangeSolver* solver = ctx->solver()->Clone();
+  if (solver == NULL) {
+    throw Error("cannot fork a simulation whose solver cannot be copied");
+  }
+  solver->decompose(ctx->solver()->decompose());
+  solver->threads(ctx->solver()->threads());
+  ctx_->solver(solver);
+
+  // compositions are immutable and shared with the forked simulation
+  std::map<std::string, Composition::Ptr>::iterator rit;
+  for (rit = ctx->recipes_.begin(); rit != ctx->recipes_.end(); ++rit) {
+    ctx_->AddRecipe(rit->first, rit->second);
+  }
+
+  // the agents are copied through their own Snapshot and InitFrom, by way of
+  // their state staged in memory
+  std::map<std::string, std::function<Agent*()> > lazy = ctx->lazy_protos_;
+  std::map<std::string, std::function<Agent*()> >::iterator lit;
+  for (lit = lazy.begin(); lit != lazy.end(); ++lit) {
+    ctx->GetPrototype(lit->first);
+  }
+  std::vector<Agent*> live = ctx->live_agents();
+
+  DatumList state;
+  std::map<int, std::string> binary;
+  ctx->rec_->StartStaging(&state);
+  try {
+    std::map<std::string, Agent*>::iterator pit;
+    for (pit = ctx->protos_.begin(); pit != ctx->protos_.end(); ++pit) {
+      StageForFork(pit->second, &binary);
+    }
+    for (int i = 0; i < live.size(); ++i) {
+      StageForFork(live[i], &binary);
+    }
+  } catch (...) {
+    ctx->rec_->StopStaging();
+    ctx->rec_->Discard(&state);
+    throw;
+  }
+  ctx->rec_->StopStaging();
+
+  StagingBack sb(&state);
+  AgentStateCache cache(&sb);
+  cache.binary(&binary);
+  b_ = &sb;
+  cache_ = &cache;
+  try {
+    std::map<std::string, Agent*>::iterator pit;
+    for (pit = ctx->protos_.begin(); pit != ctx->protos_.end(); ++pit) {
+      AgentSpec spec(pit->second->spec());
+      Agent* m = DynamicModule::Make(ctx_, spec);
+      m->id_ = pit->second->id();
+      InitAgentState(m, spec, t);
+      ctx_->AddPrototype(pit->first, m);
+    }
+
+    std::map<int, int> parentmap;
+    std::map<int, Agent*> unbuilt;
+    for (int i = 0; i < live.size(); ++i) {
+      AgentSpec spec(live[i]->spec());
+      Agent* m = DynamicModule::Make(ctx_, spec);
+      m->prototype_ = live[i]->prototype();
+      m->id_ = live[i]->id();
+      m->enter_time_ = live[i]->enter_time();
+      InitAgentState(m, spec, t);
+      unbuilt[m->id()] = m;
+      parentmap[m->id()] = live[i]->parent_id();
+    }
+    ConnectAgents(&unbuilt, parentmap);
+  } catch (...) {
+    cache_ = NULL;
+    b_ = NULL;
+    ctx->rec_->Discard(&state);
+    throw;
+  }
+  cache_ = NULL;
+  b_ = NULL;
+  ctx->rec_->Discard(&state);
+
+  for (int i = 0; i < live.size(); ++i) {
+    Inventories invs = live[i]->SnapshotInv();
+    Inventories::iterator it;
+    for (it = invs.begin(); it != invs.end(); ++it) {
+      std::vector<Resource::Ptr>& inv = it->second;
+      for (int j = 0; j < inv.size(); ++j) {
+        inv[j] = CopyResource(ctx_, inv[j]);
+      }
+    }
+    agents_[live[i]->id()]->InitInv(invs);
+  }
+
+  // the builds and decommissionings of the current timestep are still to
+  // come
+  Timer* ti = ctx->ti_;
+  std::map<int, std::vector<Timer::BuildBatch> >::iterator bit;
+  for (bit = ti->build_queue_.lower_bound(t); bit != ti->build_queue_.end();
+       ++bit) {
+    for (int i = 0; i < bit->second.size(); ++i) {
+      const Timer::BuildBatch& batch = bit->second[i];
+      Agent* parent = batch.parent == NULL ? NULL :
+                      agents_[batch.parent->id()];
+      ctx_->SchedBuilds(parent, ti->proto_names_[batch.proto], batch.count,
+                        std::vector<int>(1, bit->first));
+    }
+  }
+  std::map<int, std::vector<Agent*> >::iterator dit;
+  for (dit = ti->decom_queue_.lower_bound(t); dit != ti->decom_queue_.end();
+       ++dit) {
+    for (int i = 0; i < dit->second.size(); ++i) {
+      if (dit->second[i] != NULL) {
+        ctx_->SchedDecom(agents_[dit->second[i]->id()], dit->first);
+      }
+    }
+  }
+
+  // the copy numbers its objects on from where ctx is, like a restart would
+  ctx_->ids().CopyFrom(&ctx->ids());
+  ctx_->trans_id_ = ctx->trans_id_.load();
+
+  // delete all buffered data that we don't want to be recorded in the
+  // output db
+  rec_->Flush();
+  rec_ = r;
+  ctx_->rec_ = r;
+  ctx_->InitSim(si_);
+}
+
+void SimInit::SetState(Context* ctx, std::string prototype,
+                       const std::map<std::string, std::string>& values) {
+  std::vector<Agent*> agents(1, ctx->GetPrototype(prototype));
+  const std::vector<Agent*>& live = ctx->AgentsOfPrototype(prototype);
+  agents.insert(agents.end(), live.begin(), live.end());
+
+  for (int i = 0; i < agents.size(); ++i) {
+    std::set<std::string> fields = SetAgentState(agents[i], values);
+    std::map<std::string, std::string>::const_iterator v;
+    for (v = values.begin(); v != values.end(); ++v) {
+      if (fields.count(v->first) == 0) {
+        throw KeyError("prototype " + prototype + " has no state variable " +
+                       v->first);
+      }
+    }
+  }
+}
+
+std::set<std::string> SimInit::SetAgentState(
+    Agent* m, const std::map<std::string, std::string>& values) {
+  Recorder* rec = m->context()->rec_;
+  DatumList state;
+  rec->StartStaging(&state);
+  try {
+    m->Agent::Snapshot(DbInit(m, true));
+    m->Snapshot(DbInit(m));
+  } catch (...) {
+    rec->StopStaging();
+    rec->Discard(&state);
+    throw;
+  }
+  rec->StopStaging();
+
+  std::set<std::string> fields;
+  std::map<std::string, boost::spirit::hold_any> vals;
+  try {
+    for (int i = 0; i < state.size(); ++i) {
+      const Datum::Vals& dvals = state[i]->vals();
+      for (int j = 0; j < dvals.size(); ++j) {
+        std::string field = dvals[j].first;
+        fields.insert(field);
+        std::map<std::string, std::string>::const_iterator v =
+            values.find(field);
+        if (v != values.end() && vals.count(field) == 0) {
+          vals[field] = ParseAs(dvals[j].second, field, v->second);
+        }
+      }
+    }
+
+    StagingBack sb(&state);
+    OverrideBack ob(&sb, vals);
+    PrefixInjector pi(&ob, "AgentState");
+    m->Agent::InitFrom(&pi);
+    pi = PrefixInjector(&ob, "AgentState" + AgentSpec(m->spec()).Sanitize());
+    m->InitFrom(&pi);
+  } catch (...) {
+    rec->Discard(&state);
+    throw;
+  }
+  rec->Discard(&state);
+  return fields;
+}
+
 void SimInit::InitBase(QueryableBackend* b, boost::uuids::uuid simid, int t) {
+  InitPhase phase("SimInit");
   ctx_ = new Context(&ti_, rec_);
 
   std::vector<Cond> conds;
   conds.push_back(Cond("SimId", "==", simid));
-  b_ = new CondInjector(b, conds);
+  // databases recorded with compact output may lack the classic resource
+  // and transaction tables that resources are restored from
+  expander_.reset(new CompactExpander(b));
+  b_ = new CondInjector(expander_.get(), conds);
   t_ = t;
   simid_ = simid;
 
+  // agent state is read a table at a time while initializing, or from the
+  // state image of the snapshot if one was taken; prototypes loaded lazily
+  // later on query the backend directly
+  AgentStateCache cache(b_);
+  cache_ = &cache;
+  boost::scoped_ptr<StateImage> image;
+  std::string image_dir = Env::GetEnv("CYCLUS_STATE_IMAGE");
+  std::string image_path = StateImage::Path(image_dir, simid, t);
+  if (!image_dir.empty() && boost::filesystem::exists(image_path)) {
+    try {
+      image.reset(new StateImage(image_path));
+      cache.image(image.get());
+    } catch (const IOError& err) {
+      Warn<IO_WARNING>(std::string(err.what()) +
+                       "; restarting from the database instead");
+    }
+  }
+
   // this sequence is imporant!!!
   LoadInfo();
   LoadRecipes();
@@ -65,24 +698,155 @@ void SimInit::InitBase(QueryableBackend* b, boost::uuids::uuid simid, int t) {
   LoadBuildSched();
   LoadDecomSched();
   LoadNextIds();
+  cache_ = NULL;
 
   // delete all buffered data that we don't want to be re-recorded in the
   // output db
   rec_->Flush();
 }
 
+void SimInit::LoadCompiled(QueryableBackend* b, boost::uuids::uuid sim_id,
+                           Recorder* r) {
+  std::vector<Cond> conds;
+  conds.push_back(Cond("SimId", "==", sim_id));
+  std::set<std::string> tables = b->Tables();
+  std::set<std::string>::iterator it;
+  for (it = tables.begin(); it != tables.end(); ++it) {
+    QueryResult qr;
+    try {
+      qr = b->Query(*it, &conds);
+    } catch (std::exception err) {
+      continue;
+    }  // not a simulation table (okay)
+
+    // the recorder injects its own simulation id
+    std::vector<int> cols;
+    for (int j = 0; j < qr.fields.size(); ++j) {
+      if (qr.fields[j] != "SimId") {
+        cols.push_back(j);
+      }
+    }
+    Recorder::Table* t = r->GetTable(*it);
+    for (int i = 0; i < qr.rows.size(); ++i) {
+      Datum* d = r->NewDatum(t);
+      for (int j = 0; j < cols.size(); ++j) {
+        d->AddVal(r->Intern(qr.fields[cols[j]]), qr.rows[i][cols[j]]);
+      }
+      d->Record();
+    }
+  }
+  r->Flush();
+}
+
+InitTimings& SimInit::init_timings() {
+  static InitTimings timings;
+  return timings;
+}
+
+void SimInit::RecordInitTimings(Context* ctx) {
+  InitTimings& timings = init_timings();
+  for (int i = 0; i < timings.size(); ++i) {
+    ctx->NewDatum("InitTimings")
+        ->AddVal("Order", i)
+        ->AddVal("Phase", timings[i].first)
+        ->AddVal("Seconds", timings[i].second)
+        ->Record();
+  }
+}
+
 void SimInit::Snapshot(Context* ctx) {
+  TraceSpan span(ctx->tracer(), "Snapshot", "snapshot");
   ctx->NewDatum("Snapshots")
      ->AddVal("Time", ctx->time())
      ->Record();
 
   // snapshot all agent internal state
-  std::set<Agent*> mlist = ctx->agent_list_;
-  std::set<Agent*>::iterator it;
-  for (it = mlist.begin(); it != mlist.end(); ++it) {
-    Agent* m = *it;
-    if (m->enter_time() != -1) {
-      SimInit::SnapAgent(m);
+  bool delta = !Env::GetEnv("CYCLUS_DELTA_SNAPSHOTS").empty();
+  std::string image_dir = Env::GetEnv("CYCLUS_STATE_IMAGE");
+  std::string nthreads = Env::GetEnv("CYCLUS_SNAPSHOT_THREADS");
+  int threads = nthreads.empty() ? 1 : std::atoi(nthreads.c_str());
+  StateImageWriter image(ctx->time());
+  Recorder* rec = ctx->rec_;
+  std::vector<Agent*> agents = ctx->live_agents();
+  if (!delta && image_dir.empty() && threads < 2) {
+    for (int i = 0; i < agents.size(); ++i) {
+      SimInit::SnapAgent(agents[i]);
+    }
+    agents.clear();
+  }
+
+  // with delta snapshots, agents that track changes to their state and that
+  // report none, with unchanged inventories, are not snapshot at all. They
+  // are all asked, so that they track changes from this snapshot on.
+  if (delta) {
+    std::vector<Agent*> dirty;
+    for (int i = 0; i < agents.size(); ++i) {
+      Agent* m = agents[i];
+      bool clean = !m->SnapshotDirty() && image_dir.empty();
+      std::map<int, std::pair<std::string, int> >::iterator prev =
+          ctx->snap_states_.find(m->id());
+      clean = clean && prev != ctx->snap_states_.end() &&
+              prev->second.second != -1;
+      std::map<int, std::string>::iterator kern =
+          ctx->snap_kernel_.find(m->id());
+      clean = clean && kern != ctx->snap_kernel_.end() &&
+              kern->second == KernelState(m, m->SnapshotInv());
+      if (!clean) {
+        dirty.push_back(m);
+        continue;
+      }
+      ctx->NewDatum("SnapshotAgents")
+          ->AddVal("Time", ctx->time())
+          ->AddVal("AgentId", m->id())
+          ->AddVal("StateTime", prev->second.second)
+          ->Record();
+    }
+    agents.swap(dirty);
+  }
+
+  // agents are staged in batches, so that the state of a large fleet is not
+  // all held in memory at once
+  int batch = 64 * std::max(threads, 1);
+  for (int begin = 0; begin < agents.size(); begin += batch) {
+    std::vector<Agent*> slice(
+        agents.begin() + begin,
+        agents.begin() + std::min<int>(begin + batch, agents.size()));
+    std::vector<DatumList> states(slice.size());
+    StageAgents(slice, threads, &states);
+
+    for (int i = 0; i < slice.size(); ++i) {
+      Agent* m = slice[i];
+      DatumList& state = states[i];
+      if (!image_dir.empty()) {
+        AddToImage(m, state, &image);
+      }
+      if (!delta) {
+        rec->Commit(&state);
+        continue;
+      }
+
+      // a state that cannot be serialized is given a fresh time, so it never
+      // matches
+      std::string bytes;
+      bool serialized = SerializeState(state, &bytes);
+      std::map<int, std::pair<std::string, int> >::iterator prev =
+          ctx->snap_states_.find(m->id());
+      int state_time = ctx->time();
+      if (serialized && prev != ctx->snap_states_.end() &&
+          prev->second.second != -1 && prev->second.first == bytes) {
+        rec->Discard(&state);
+        state_time = prev->second.second;
+      } else {
+        rec->Commit(&state);
+        std::pair<std::string, int>& snap = ctx->snap_states_[m->id()];
+        snap.first.swap(bytes);
+        snap.second = serialized ? state_time : -1;
+      }
+      ctx->NewDatum("SnapshotAgents")
+          ->AddVal("Time", ctx->time())
+          ->AddVal("AgentId", m->id())
+          ->AddVal("StateTime", state_time)
+          ->Record();
     }
   }
 
@@ -90,33 +854,41 @@ void SimInit::Snapshot(Context* ctx) {
   ctx->NewDatum("NextIds")
       ->AddVal("Time", ctx->time())
       ->AddVal("Object", std::string("Agent"))
-      ->AddVal("NextId", Agent::next_id_)
+      ->AddVal("NextId", ctx->ids().next(IdAllocator::AGENT))
       ->Record();
   ctx->NewDatum("NextIds")
       ->AddVal("Time", ctx->time())
       ->AddVal("Object", std::string("Transaction"))
-      ->AddVal("NextId", ctx->trans_id_)
+      ->AddVal("NextId", ctx->trans_id_.load())
       ->Record();
   ctx->NewDatum("NextIds")
       ->AddVal("Time", ctx->time())
       ->AddVal("Object", std::string("Composition"))
-      ->AddVal("NextId", Composition::next_id_)
+      ->AddVal("NextId", Composition::next_id_.load())
       ->Record();
   ctx->NewDatum("NextIds")
       ->AddVal("Time", ctx->time())
       ->AddVal("Object", std::string("ResourceState"))
-      ->AddVal("NextId", Resource::nextstate_id_)
+      ->AddVal("NextId", ctx->ids().next(IdAllocator::RESOURCE_STATE))
       ->Record();
   ctx->NewDatum("NextIds")
       ->AddVal("Time", ctx->time())
       ->AddVal("Object", std::string("ResourceObj"))
-      ->AddVal("NextId", Resource::nextobj_id_)
+      ->AddVal("NextId", ctx->ids().next(IdAllocator::RESOURCE_OBJ))
       ->Record();
   ctx->NewDatum("NextIds")
       ->AddVal("Time", ctx->time())
       ->AddVal("Object", std::string("Product"))
-      ->AddVal("NextId", Product::next_qualid_)
+      ->AddVal("NextId", ctx->ids().next(IdAllocator::PRODUCT_QUALITY))
       ->Record();
+
+  if (!image_dir.empty()) {
+    try {
+      image.Write(StateImage::Path(image_dir, ctx->sim_id(), ctx->time()));
+    } catch (const IOError& err) {
+      Warn<IO_WARNING>(err.what());
+    }
+  }
 }
 
 void SimInit::SnapAgent(Agent* m) {
@@ -125,13 +897,109 @@ void SimInit::SnapAgent(Agent* m) {
   m->Agent::Snapshot(DbInit(m, true));
 
   m->Snapshot(DbInit(m));
+  SnapInventories(m);
+}
+
+void SimInit::StageAgents(const std::vector<Agent*>& agents, int threads,
+                          std::vector<DatumList>* states) {
+  Recorder* rec = agents.empty() ? NULL : agents[0]->context()->rec_;
+  std::vector<int> parallel;
+  if (threads > 1) {
+    for (int i = 0; i < agents.size(); ++i) {
+      if (agents[i]->ThreadSafeSnapshot()) {
+        parallel.push_back(i);
+      }
+    }
+  }
+
+  // the state of thread-safe agents is serialized concurrently into their
+  // own staged lists; inventories are always snapshot on this thread since
+  // they pin resource states and update the delta snapshot bookkeeping
+  std::vector<char> done(agents.size(), false);  // set from the workers
+  std::vector<std::exception_ptr> errs(agents.size());
+  if (parallel.size() > 1) {
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+      for (int k = next++; k < parallel.size(); k = next++) {
+        int i = parallel[k];
+        rec->StartStaging(&(*states)[i]);
+        try {
+          agents[i]->Agent::Snapshot(DbInit(agents[i], true));
+          agents[i]->Snapshot(DbInit(agents[i]));
+        } catch (...) {
+          errs[i] = std::current_exception();
+        }
+        rec->StopStaging();
+        done[i] = true;
+      }
+    };
+    agents[0]->context()->scheduler()->RunWorkers(
+        std::min<int>(threads, parallel.size()), worker);
+  }
+
+  for (int i = 0; i < agents.size(); ++i) {
+    if (!errs[i]) {
+      rec->StartStaging(&(*states)[i]);
+      try {
+        if (done[i]) {
+          SnapInventories(agents[i]);
+        } else {
+          SnapAgent(agents[i]);
+        }
+      } catch (...) {
+        errs[i] = std::current_exception();
+      }
+      rec->StopStaging();
+    }
+    if (errs[i]) {
+      for (int j = 0; j < agents.size(); ++j) {
+        rec->Discard(&(*states)[j]);
+      }
+      std::rethrow_exception(errs[i]);
+    }
+  }
+}
+
+void SimInit::SnapInventories(Agent* m) {
   Inventories invs = m->SnapshotInv();
   Context* ctx = m->context();
 
+  // with delta snapshots, an inventory holding the same resource states as
+  // when it was last recorded is recorded as a reference to that time
+  bool delta = m->enter_time() != -1 &&
+               !Env::GetEnv("CYCLUS_DELTA_SNAPSHOTS").empty();
+  if (delta) {
+    ctx->snap_kernel_[m->id()] = KernelState(m, invs);
+  }
   Inventories::iterator it;
   for (it = invs.begin(); it != invs.end(); ++it) {
     std::string name = it->first;
     std::vector<Resource::Ptr> inv = it->second;
+    std::vector<int> states(inv.size());
+    for (int i = 0; i < inv.size(); ++i) {
+      if (ctx->coalescer() != NULL) {
+        ctx->coalescer()->Pin(inv[i]->state_id());
+      }
+      states[i] = inv[i]->state_id();
+    }
+
+    if (delta && !inv.empty()) {
+      std::pair<int, std::string> key(m->id(), name);
+      std::map<std::pair<int, std::string>,
+               std::pair<std::vector<int>, int> >::iterator prev =
+          ctx->snap_invs_.find(key);
+      if (prev != ctx->snap_invs_.end() && prev->second.first == states) {
+        ctx->NewDatum("AgentStateInventoryRefs")
+            ->AddVal("AgentId", m->id())
+            ->AddVal("SimTime", ctx->time())
+            ->AddVal("InventoryName", name)
+            ->AddVal("StateTime", prev->second.second)
+            ->Record();
+        continue;
+      }
+      ctx->snap_invs_[key] = std::make_pair(states, ctx->time());
+    }
+
     for (int i = 0; i < inv.size(); ++i) {
       ctx->NewDatum("AgentStateInventories")
           ->AddVal("AgentId", m->id())
@@ -154,6 +1022,11 @@ void SimInit::LoadInfo() {
   si_ = SimInfo(dur, y0, m0, h, d);
 
   si_.parent_sim = qr.GetVal<boost::uuids::uuid>("ParentSimId");
+  // databases written before agents had random streams lack the seed
+  if (std::find(qr.fields.begin(), qr.fields.end(), "Seed") !=
+      qr.fields.end()) {
+    si_.seed = qr.GetVal<int>("Seed");
+  }
 
   qr = b_->Query("TimeStepDur", NULL);
   // TODO: when the backends support uint64_t, the int template here
@@ -168,6 +1041,93 @@ void SimInit::LoadInfo() {
   si_.explicit_inventory = qr.GetVal<bool>("RecordInventory");
   si_.explicit_inventory_compact = qr.GetVal<bool>("RecordInventoryCompact");
 
+  // databases written before decay transfer matrices were available lack
+  // this table
+  if (0 < b_->Tables().count("InfoDecayTransfer")) {
+    qr = b_->Query("InfoDecayTransfer", NULL);
+    si_.decay_transfer = qr.GetVal<bool>("DecayTransfer");
+  }
+
+  // databases written before the sparse decay solver was available lack
+  // this table
+  if (0 < b_->Tables().count("InfoSparseDecay")) {
+    qr = b_->Query("InfoSparseDecay", NULL);
+    si_.sparse_decay = qr.GetVal<bool>("SparseDecay");
+  }
+
+  // databases written before DRE timings were available lack this table
+  if (0 < b_->Tables().count("InfoDreTimings")) {
+    qr = b_->Query("InfoDreTimings", NULL);
+    si_.dre_timings = qr.GetVal<bool>("RecordDreTimings");
+  }
+
+  // databases written before regional exchanges were available lack this
+  // table
+  if (0 < b_->Tables().count("InfoDreRegions")) {
+    qr = b_->Query("InfoDreRegions", NULL);
+    si_.dre_regions = qr.GetVal<bool>("PartitionRegions");
+  }
+
+  // databases written before exchanges could be coarsened lack this table
+  if (0 < b_->Tables().count("InfoDreCoarsen")) {
+    qr = b_->Query("InfoDreCoarsen", NULL);
+    si_.dre_coarsen = qr.GetVal<std::string>("Coarsen");
+  }
+
+  // databases written before the task scheduler was available lack this
+  // table
+  if (0 < b_->Tables().count("InfoThreads")) {
+    qr = b_->Query("InfoThreads", NULL);
+    si_.threads = qr.GetVal<int>("Threads");
+  }
+
+  // databases written before the trade distance was an input lack this
+  // table
+  if (0 < b_->Tables().count("InfoTradeDistance")) {
+    qr = b_->Query("InfoTradeDistance", NULL);
+    si_.max_trade_distance = qr.GetVal<double>("MaxKilometers");
+  }
+
+  // databases written before compact output was available lack this table
+  if (0 < b_->Tables().count("InfoCompactOutput")) {
+    qr = b_->Query("InfoCompactOutput", NULL);
+    si_.compact_output = qr.GetVal<bool>("CompactOutput");
+  }
+
+  // databases written before dense output was available lack this table
+  if (0 < b_->Tables().count("InfoDenseOutput")) {
+    qr = b_->Query("InfoDenseOutput", NULL);
+    si_.dense_output = qr.GetVal<bool>("DenseOutput");
+  }
+
+  // databases written before checkpoints were available lack this table
+  if (0 < b_->Tables().count("InfoCheckpoints")) {
+    qr = b_->Query("InfoCheckpoints", NULL);
+    si_.checkpoint_steps = qr.GetVal<int>("Steps");
+    si_.checkpoint_secs = qr.GetVal<double>("Seconds");
+  }
+
+  // only written by simulations with a step schedule
+  if (0 < b_->Tables().count("InfoStepSchedule")) {
+    qr = b_->Query("InfoStepSchedule", NULL);
+    for (int i = 0; i < qr.rows.size(); ++i) {
+      si_.step_schedule[qr.GetVal<int>("Start", i)] =
+          qr.GetVal<int>("Length", i);
+    }
+  }
+
+  // only written by simulations that aggregate some time series
+  if (0 < b_->Tables().count("InfoTimeSeries")) {
+    qr = b_->Query("InfoTimeSeries", NULL);
+    for (int i = 0; i < qr.rows.size(); ++i) {
+      TimeSeriesAgg agg;
+      agg.mode = qr.GetVal<std::string>("Mode", i);
+      agg.period = qr.GetVal<int>("Period", i);
+      agg.by_institution = qr.GetVal<bool>("ByInstitution", i);
+      si_.timeseries[qr.GetVal<std::string>("Series", i)] = agg;
+    }
+  }
+
   ctx_->InitSim(si_);
 }
 
@@ -243,7 +1203,7 @@ ExchangeSolver* SimInit::LoadGreedySolver(bool exclusive,
 ExchangeSolver* SimInit::LoadCoinSolver(bool exclusive,
                                         std::set<std::string> tables) {
 #if CYCLUS_HAS_COIN
-  ExchangeSolver* solver;
+  ProgSolver* solver;
   double timeout;
   bool verbose, mps;
 
@@ -258,12 +1218,58 @@ ExchangeSolver* SimInit::LoadCoinSolver(bool exclusive,
   // set timeout to default if input value is non-positive
   timeout = timeout <= 0 ? ProgSolver::kDefaultTimeout : timeout;
   solver = new ProgSolver("cbc", timeout, exclusive, verbose, mps);
+  CbcOptions opts;
+  if (0 < tables.count("CbcSolverInfo")) {
+    QueryResult qr = b_->Query("CbcSolverInfo", NULL);
+    opts.threads = qr.GetVal<int>("Threads");
+    opts.seconds = qr.GetVal<double>("TimeLimit");
+    opts.gap = qr.GetVal<double>("Gap");
+    opts.presolve = qr.GetVal<bool>("Presolve");
+  }
+  solver->cbc_options(opts);
+  // keep and warm start the solver interface across time steps
+  if (Env::GetEnv("CYCLUS_PERSISTENT_COIN").size() > 0)
+    solver->persistent(true);
   return solver;
 #else
   throw cyclus::Error("Cyclus was not compiled with COIN support, cannot load solver.");
 #endif
 }
 
+ExchangeSolver* SimInit::LoadAuctionSolver(bool exclusive,
+                                           std::set<std::string> tables) {
+  double gap = AuctionSolver::kDefaultGap;
+  int threads = 0;
+  std::string solver_info = "AuctionSolverInfo";
+  if (0 < tables.count(solver_info)) {
+    QueryResult qr = b_->Query(solver_info, NULL);
+    if (qr.rows.size() > 0) {
+      gap = qr.GetVal<double>("Gap");
+      threads = qr.GetVal<int>("Threads");
+    }
+  }
+
+  // exchanges that aren't transportation problems are solved greedily, as
+  // the auction is meant for exchanges too large to solve exactly
+  AuctionSolver* solver = new AuctionSolver(
+      exclusive, gap, LoadGreedySolver(exclusive, tables));
+  if (threads > 0)
+    solver->threads(threads);
+  return solver;
+}
+
+ExchangeSolver* SimInit::LoadPluginSolver(bool exclusive,
+                                          std::set<std::string> tables) {
+  std::string solver_info = "PluginSolverInfo";
+  if (0 == tables.count(solver_info)) {
+    throw ValueError("a plugin solver requires a PluginSolverInfo table");
+  }
+  QueryResult qr = b_->Query(solver_info, NULL);
+  AgentSpec spec(qr.GetVal<std::string>("Spec"));
+  std::string options = qr.GetVal<std::string>("Options");
+  return DynamicModule::MakeSolver(spec, exclusive, options);
+}
+
 void SimInit::LoadSolverInfo() {
   using std::set;
   using std::string;
@@ -288,6 +1294,19 @@ void SimInit::LoadSolverInfo() {
     solver = LoadGreedySolver(exclusive_orders, tables);
   } else if (solver_name == "coin-or") {
     solver = LoadCoinSolver(exclusive_orders, tables);
+  } else if (solver_name == "min-cost-flow") {
+    // exchanges that aren't transportation problems fall back to coin-or, or
+    // to the greedy solver if coin-or isn't available
+#if CYCLUS_HAS_COIN
+    ExchangeSolver* fallback = LoadCoinSolver(exclusive_orders, tables);
+#else
+    ExchangeSolver* fallback = LoadGreedySolver(exclusive_orders, tables);
+#endif
+    solver = new FlowSolver(exclusive_orders, fallback);
+  } else if (solver_name == "auction") {
+    solver = LoadAuctionSolver(exclusive_orders, tables);
+  } else if (solver_name == "plugin") {
+    solver = LoadPluginSolver(exclusive_orders, tables);
   } else {
     throw ValueError("The name of the solver was not recognized, "
                      "got '" + solver_name + "'.");
@@ -297,31 +1316,86 @@ void SimInit::LoadSolverInfo() {
 }
 
 void SimInit::LoadPrototypes() {
+  bool lazy = !Env::GetEnv("CYCLUS_LAZY_PROTOTYPES").empty();
   QueryResult qr = b_->Query("Prototypes", NULL);
+  if (!qr.rows.empty()) {
+    int min_id = qr.GetVal<int>("AgentId");
+    int max_id = min_id;
+    for (int i = 1; i < qr.rows.size(); ++i) {
+      min_id = std::min(min_id, qr.GetVal<int>("AgentId", i));
+      max_id = std::max(max_id, qr.GetVal<int>("AgentId", i));
+    }
+    cache_->prototypes(min_id, max_id);
+  }
+
   for (int i = 0; i < qr.rows.size(); ++i) {
     std::string proto = qr.GetVal<std::string>("Prototype", i);
     int agentid = qr.GetVal<int>("AgentId", i);
     std::string impl = qr.GetVal<std::string>("Spec", i);
-    AgentSpec spec(impl);
+    if (lazy) {
+      ctx_->AddLazyPrototype(proto, [this, agentid, impl]() {
+        // keep the ids of agents built later the same as in a full load
+        int next_id = ctx_->ids().next(IdAllocator::AGENT);
+        Agent* m = LoadPrototype(agentid, impl);
+        ctx_->ids().next(IdAllocator::AGENT, next_id);
+        return m;
+      });
+    } else {
+      ctx_->AddPrototype(proto, LoadPrototype(agentid, impl));
+    }
+  }
+}
 
-    Agent* m = DynamicModule::Make(ctx_, spec);
-    m->id_ = agentid;
+Agent* SimInit::LoadPrototype(int agentid, std::string impl) {
+  AgentSpec spec(impl);
 
-    // note that we don't filter by SimTime here because prototypes remain
-    // static over the life of the simulation and we only snapshot them once
-    // when the simulation is initialized.
-    std::vector<Cond> conds;
-    conds.push_back(Cond("AgentId", "==", agentid));
-    CondInjector ci(b_, conds);
-    PrefixInjector pi(&ci, "AgentState");
+  Agent* m = DynamicModule::Make(ctx_, spec);
+  m->id_ = agentid;
 
+  // note that we don't filter by SimTime here because prototypes remain
+  // static over the life of the simulation and we only snapshot them once
+  // when the simulation is initialized.
+  InitAgentState(m, spec, -1);
+  return m;
+}
+
+void SimInit::InitAgentState(Agent* m, const AgentSpec& spec, int t) {
+  int id = m->id();
+  std::string impl_prefix = "AgentState" + spec.Sanitize();
+  if (cache_ != NULL) {
     // call manually without agent impl injected
-    m->Agent::InitFrom(&pi);
+    AgentStateView base(cache_, b_, "AgentState", id, t);
+    m->Agent::InitFrom(&base);
+    const char* begin;
+    const char* end;
+    if (cache_->Binary(id, t, &begin, &end)) {
+      BinaryReader r(begin, end);
+      try {
+        m->InitFromBinary(&r);
+        return;
+      } catch (const IOError& err) {
+        Warn<IO_WARNING>(std::string(err.what()) + "; initializing agent " +
+                         std::to_string(id) + " from the database instead");
+      }
+    }
+    AgentStateView impl(cache_, b_, impl_prefix, id, t);
+    m->InitFrom(&impl);
+    return;
+  }
 
-    pi = PrefixInjector(&ci, "AgentState" + spec.Sanitize());
-    m->InitFrom(&pi);
-    ctx_->AddPrototype(proto, m);
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", id));
+  if (t != -1) {
+    conds.push_back(Cond("SimTime", "==", t));
   }
+  CondInjector ci(b_, conds);
+  PrefixInjector pi(&ci, "AgentState");
+
+  // call manually without agent impl injected
+  m->Agent::InitFrom(&pi);
+
+  pi = PrefixInjector(&ci, impl_prefix);
+  m->InitFrom(&pi);
 }
 
 void SimInit::LoadInitialAgents() {
@@ -330,7 +1404,29 @@ void SimInit::LoadInitialAgents() {
   // to be done once; remember that we are initializing agents from a
   // simulation that was already started.
 
+  // with delta snapshots, agents whose state did not change since an earlier
+  // snapshot are initialized from the state recorded then
+  std::vector<Cond> tconds;
+  tconds.push_back(Cond("Time", "==", t_));
+  try {
+    QueryResult qr = b_->Query("SnapshotAgents", &tconds);
+    for (int i = 0; i < qr.rows.size(); ++i) {
+      state_times_[qr.GetVal<int>("AgentId", i)] =
+          qr.GetVal<int>("StateTime", i);
+    }
+  } catch (std::exception err) {}  // table doesn't exist (okay)
+
   // find all agents that are alive at the current timestep
+  std::set<int> exited;
+  std::vector<Cond> xconds;
+  xconds.push_back(Cond("ExitTime", "<", t_));
+  try {
+    QueryResult qexit = b_->Query("AgentExit", &xconds);
+    for (int i = 0; i < qexit.rows.size(); ++i) {
+      exited.insert(qexit.GetVal<int>("AgentId", i));
+    }
+  } catch (std::exception err) {}  // table doesn't exist (okay)
+
   std::vector<Cond> conds;
   conds.push_back(Cond("EnterTime", "<=", t_));
   QueryResult qentry = b_->Query("AgentEntry", &conds);
@@ -342,15 +1438,9 @@ void SimInit::LoadInitialAgents() {
       continue;
     }
     int id = qentry.GetVal<int>("AgentId", i);
-    std::vector<Cond> conds;
-    conds.push_back(Cond("AgentId", "==", id));
-    conds.push_back(Cond("ExitTime", "<", t_));
-    try {
-      QueryResult qexit = b_->Query("AgentExit", &conds);
-      if (qexit.rows.size() != 0) {
-        continue;  // agent was decomissioned before t_ - skip
-      }
-    } catch (std::exception err) {}  // table doesn't exist (okay)
+    if (exited.count(id) != 0) {
+      continue;  // agent was decomissioned before t_ - skip
+    }
 
     // if the agent wasn't decommissioned before t_ create and init it
 
@@ -367,19 +1457,18 @@ void SimInit::LoadInitialAgents() {
     parentmap[id] = qentry.GetVal<int>("ParentId", i);
 
     // agent-custom init
-    conds.pop_back();
-    conds.push_back(Cond("SimTime", "==", t_));
-    CondInjector ci(b_, conds);
-    PrefixInjector pi(&ci, "AgentState");
-    m->Agent::InitFrom(&pi);
-    pi = PrefixInjector(&ci, "AgentState" + spec.Sanitize());
-    m->InitFrom(&pi);
+    InitAgentState(m, spec, StateTime(id));
   }
 
+  ConnectAgents(&unbuilt, parentmap);
+}
+
+void SimInit::ConnectAgents(std::map<int, Agent*>* unbuilt,
+                            std::map<int, int>& parentmap) {
   // construct agent hierarchy starting at roots (no parent) down
-  std::map<int, Agent*>::iterator it = unbuilt.begin();
+  std::map<int, Agent*>::iterator it = unbuilt->begin();
   std::vector<Agent*> enter_list;
-  while (unbuilt.size() > 0) {
+  while (unbuilt->size() > 0) {
     int id = it->first;
     Agent* m = it->second;
     int parentid = parentmap[id];
@@ -388,19 +1477,19 @@ void SimInit::LoadInitialAgents() {
       m->Connect(NULL);
       agents_[id] = m;
       ++it;
-      unbuilt.erase(id);
+      unbuilt->erase(id);
       enter_list.push_back(m);
     } else if (agents_.count(parentid) > 0) {  // parent is built
       m->Connect(agents_[parentid]);
       agents_[id] = m;
       ++it;
-      unbuilt.erase(id);
+      unbuilt->erase(id);
       enter_list.push_back(m);
     } else {  // parent not built yet
       ++it;
     }
-    if (it == unbuilt.end()) {
-      it = unbuilt.begin();
+    if (it == unbuilt->end()) {
+      it = unbuilt->begin();
     }
   }
 
@@ -412,24 +1501,69 @@ void SimInit::LoadInitialAgents() {
 }
 
 void SimInit::LoadInventories() {
+  // read the inventories of all agents whose state was recorded at the same
+  // time at once
+  std::map<int, std::vector<Agent*> > by_time;
   std::map<int, Agent*>::iterator it;
   for (it = agents_.begin(); it != agents_.end(); ++it) {
-    Agent* m = it->second;
+    by_time[StateTime(it->first)].push_back(it->second);
+  }
+
+  std::map<int, std::vector<Agent*> >::iterator tit;
+  for (tit = by_time.begin(); tit != by_time.end(); ++tit) {
     std::vector<Cond> conds;
-    conds.push_back(Cond("SimTime", "==", t_));
-    conds.push_back(Cond("AgentId", "==", m->id()));
+    conds.push_back(Cond("SimTime", "==", tit->first));
     QueryResult qr;
     try {
       qr = b_->Query("AgentStateInventories", &conds);
     } catch (std::exception err) {return;}  // table doesn't exist (okay)
 
-    Inventories invs;
+    std::map<int, Inventories> invs;
     for (int i = 0; i < qr.rows.size(); ++i) {
+      int id = qr.GetVal<int>("AgentId", i);
       std::string inv_name = qr.GetVal<std::string>("InventoryName", i);
       int state_id = qr.GetVal<int>("ResourceId", i);
-      invs[inv_name].push_back(LoadResource(ctx_, b_, state_id));
+      invs[id][inv_name].push_back(LoadResource(ctx_, b_, state_id));
+    }
+    LoadInventoryRefs(tit->first, &invs);
+
+    std::vector<Agent*>& agents = tit->second;
+    for (int i = 0; i < agents.size(); ++i) {
+      agents[i]->InitInv(invs[agents[i]->id()]);
+    }
+  }
+}
+
+void SimInit::LoadInventoryRefs(int t, std::map<int, Inventories>* invs) {
+  std::vector<Cond> conds;
+  conds.push_back(Cond("SimTime", "==", t));
+  QueryResult qr;
+  try {
+    qr = b_->Query("AgentStateInventoryRefs", &conds);
+  } catch (std::exception err) {return;}  // table doesn't exist (okay)
+
+  // the inventories recorded at the same time are read at once
+  std::map<int, std::set<std::pair<int, std::string> > > refs;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    refs[qr.GetVal<int>("StateTime", i)].insert(std::make_pair(
+        qr.GetVal<int>("AgentId", i),
+        qr.GetVal<std::string>("InventoryName", i)));
+  }
+
+  std::map<int, std::set<std::pair<int, std::string> > >::iterator it;
+  for (it = refs.begin(); it != refs.end(); ++it) {
+    conds.clear();
+    conds.push_back(Cond("SimTime", "==", it->first));
+    QueryResult rows = b_->Query("AgentStateInventories", &conds);
+    for (int i = 0; i < rows.rows.size(); ++i) {
+      int id = rows.GetVal<int>("AgentId", i);
+      std::string inv_name = rows.GetVal<std::string>("InventoryName", i);
+      if (it->second.count(std::make_pair(id, inv_name)) == 0) {
+        continue;
+      }
+      int state_id = rows.GetVal<int>("ResourceId", i);
+      (*invs)[id][inv_name].push_back(LoadResource(ctx_, b_, state_id));
     }
-    m->InitInv(invs);
   }
 }
 
@@ -464,24 +1598,34 @@ void SimInit::LoadDecomSched() {
   }
 }
 
+int SimInit::StateTime(int id) {
+  std::map<int, int>::iterator it = state_times_.find(id);
+  return it == state_times_.end() ? t_ : it->second;
+}
+
 void SimInit::LoadNextIds() {
   std::vector<Cond> conds;
   conds.push_back(Cond("Time", "==", t_));
   QueryResult qr = b_->Query("NextIds", &conds);
   for (int i = 0; i < qr.rows.size(); ++i) {
     std::string obj = qr.GetVal<std::string>("Object", i);
+    int next = qr.GetVal<int>("NextId", i);
     if (obj == "Agent") {
-      Agent::next_id_ = qr.GetVal<int>("NextId", i);
+      ctx_->ids().next(IdAllocator::AGENT, next);
     } else if (obj == "Transaction") {
-      ctx_->trans_id_ = qr.GetVal<int>("NextId", i);
+      ctx_->trans_id_ = next;
     } else if (obj == "Composition") {
-      Composition::next_id_ = qr.GetVal<int>("NextId", i);
+      // composition ids are shared by the simulations of the process, so
+      // they only ever move forward
+      int cur = Composition::next_id_.load();
+      while (cur < next &&
+             !Composition::next_id_.compare_exchange_weak(cur, next)) {}
     } else if (obj == "ResourceState") {
-      Resource::nextstate_id_ = qr.GetVal<int>("NextId", i);
+      ctx_->ids().next(IdAllocator::RESOURCE_STATE, next);
     } else if (obj == "ResourceObj") {
-      Resource::nextobj_id_ = qr.GetVal<int>("NextId", i);
+      ctx_->ids().next(IdAllocator::RESOURCE_OBJ, next);
     } else if (obj == "Product") {
-      Product::next_qualid_ = qr.GetVal<int>("NextId", i);
+      ctx_->ids().next(IdAllocator::PRODUCT_QUALITY, next);
     } else {
       throw IOError("Unexpected value in NextIds table: " + obj);
     }
@@ -499,6 +1643,7 @@ Material::Ptr SimInit::BuildMaterial(QueryableBackend* b, int resid) {
   Material::Ptr m = ResCast<Material>(SimInit::LoadResource(&ctx, b, resid));
   m->tracker_.DontTrack();
   m->ctx_ = NULL;
+  m->ids_ = NULL;
   return m;
 }
 
@@ -513,6 +1658,7 @@ Product::Ptr SimInit::BuildProduct(QueryableBackend* b, int resid) {
   Product::Ptr p = ResCast<Product>(SimInit::LoadResource(&ctx, b, resid));
   p->tracker_.DontTrack();
   p->ctx_ = NULL;
+  p->ids_ = NULL;
   return p;
 }
 
@@ -537,6 +1683,27 @@ Resource::Ptr SimInit::LoadResource(Context* ctx, QueryableBackend* b, int state
   return r;
 }
 
+Resource::Ptr SimInit::CopyResource(Context* ctx, Resource::Ptr r) {
+  Agent* dummy = new Dummy(ctx);
+  Resource::Ptr copy;
+  if (r->type() == Material::kType) {
+    Material::Ptr src = ResCast<Material>(r);
+    Material::Ptr mat = Material::Create(dummy, src->quantity(), src->comp_);
+    mat->prev_decay_time_ = src->prev_decay_time_;
+    copy = mat;
+  } else if (r->type() == Product::kType) {
+    copy = Product::Create(dummy, r->quantity(), ResCast<Product>(r)->quality());
+  } else {
+    ctx->DelAgent(dummy);
+    throw ValueError("cannot copy resources of type " + r->type());
+  }
+  ctx->DelAgent(dummy);
+
+  copy->state_id_ = r->state_id();
+  copy->obj_id_ = r->obj_id();
+  return copy;
+}
+
 Material::Ptr SimInit::LoadMaterial(Context* ctx, QueryableBackend* b, int state_id) {
   // get special material object state
   std::vector<Cond> conds;
@@ -547,7 +1714,10 @@ Material::Ptr SimInit::LoadMaterial(Context* ctx, QueryableBackend* b, int state
   // get general resource object info
   conds.clear();
   conds.push_back(Cond("ResourceId", "==", state_id));
-  qr = b->Query("Resources", &conds);
+  std::vector<std::string> fields;
+  fields.push_back("Quantity");
+  fields.push_back("QualId");
+  qr = b->Query("Resources", &conds, &fields);
   double qty = qr.GetVal<double>("Quantity");
   int stateid = qr.GetVal<int>("QualId");
 
@@ -564,7 +1734,10 @@ Material::Ptr SimInit::LoadMaterial(Context* ctx, QueryableBackend* b, int state
 Composition::Ptr SimInit::LoadComposition(QueryableBackend* b, int stateid) {
   std::vector<Cond> conds;
   conds.push_back(Cond("QualId", "==", stateid));
-  QueryResult qr = b->Query("Compositions", &conds);
+  std::vector<std::string> fields;
+  fields.push_back("NucId");
+  fields.push_back("MassFrac");
+  QueryResult qr = b->Query("Compositions", &conds, &fields);
   CompMap cm;
   for (int i = 0; i < qr.rows.size(); ++i) {
     int nucid = qr.GetVal<int>("NucId", i);
@@ -591,8 +1764,8 @@ Product::Ptr SimInit::LoadProduct(Context* ctx, QueryableBackend* b, int state_i
   qr = b->Query("Products", &conds);
   std::string quality = qr.GetVal<std::string>("Quality");
 
-  // set static quality-stateid map to have same vals as db
-  Product::qualids_[quality] = stateid;
+  // give the quality the same id as in the db
+  ctx->ids().SetQuality(quality, stateid);
 
   Agent* dummy = new Dummy(ctx);
   Product::Ptr r = Product::Create(dummy, qty, quality);
@@ -1,6 +1,13 @@
 #ifndef CYCLUS_SRC_SIM_INIT_H_
 #define CYCLUS_SRC_SIM_INIT_H_
 
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
 #include <boost/uuid/uuid_io.hpp>
 
 #include "query_backend.h"
@@ -10,14 +17,34 @@
 
 namespace cyclus {
 
+class AgentStateCache;
 class Context;
 
+/// The wall-clock seconds spent in each startup phase of this process, in the
+/// order the phases finished.
+typedef std::vector<std::pair<std::string, double> > InitTimings;
+
+/// Times a startup phase (e.g. building the schema or loading prototypes) for
+/// as long as it lives and adds it to the process's init timings.
+class InitPhase {
+ public:
+  explicit InitPhase(std::string name)
+      : name_(name),
+        start_(std::chrono::steady_clock::now()) {}
+
+  ~InitPhase();
+
+ private:
+  std::string name_;
+  std::chrono::steady_clock::time_point start_;
+};
+
 /// Handles initialization of a simulation from the output database. After
-/// calling Init, Restart, or Branch, the initialized Context, Timer, and
-/// Recorder can be retrieved.
+/// calling Init, Restart, Branch, or Fork, the initialized Context, Timer,
+/// and Recorder can be retrieved.
 ///
-/// @warning the Init, Restart, and Branch methods are NOT idempotent. Only one
-/// simulation should ever be initialized per SimInit object.
+/// @warning the Init, Restart, Branch, and Fork methods are NOT idempotent.
+/// Only one simulation should ever be initialized per SimInit object.
 ///
 /// @warning the SimInit class manages the memory of the initialized Context,
 /// Timer, and Recorder.
@@ -30,6 +57,11 @@ class SimInit {
   /// Initialize a simulation with data from b for simulation id in r. SimInit
   /// does not take ownership of the recorder or backend. the configured
   /// context's recorder is set to r.
+  ///
+  /// If the CYCLUS_LAZY_PROTOTYPES environment variable is set, here and in
+  /// Restart, each prototype (and the archetype library it comes from) is
+  /// only loaded once an agent is first built from it. b must then outlive
+  /// the simulation.
   void Init(Recorder* r, QueryableBackend* b);
 
   /// EXPERIMENTAL (might not work properly). Restarts a simulation from time t
@@ -37,6 +69,12 @@ class SimInit {
   /// will run with a new simulation id.
   void Restart(QueryableBackend* b, boost::uuids::uuid sim_id, int t);
 
+  /// Returns the time of the latest complete checkpoint (see
+  /// SimInfo::checkpoint_steps) in b of the simulation *sim_id, or -1 if
+  /// there is none. If *sim_id is nil, the checkpoints of the simulation that
+  /// was written to b most recently are used, and *sim_id is set to its id.
+  static int LatestCheckpoint(QueryableBackend* b, boost::uuids::uuid* sim_id);
+
   /// NOT IMPLEMENTED. Initializes a simulation branched from prev_sim_id at
   /// time t with diverging state described in new_sim_id.
   ///
@@ -44,8 +82,74 @@ class SimInit {
   void Branch(QueryableBackend* b, boost::uuids::uuid prev_sim_id, int t,
               boost::uuids::uuid new_sim_id);
 
+  /// Initializes an independent copy of the simulation managed by ctx, as it
+  /// is at its current time, that records to r under r's simulation id.
+  /// Nothing is written to or read from a database: agents are copied through
+  /// their Snapshot and InitFrom methods by way of state staged in memory,
+  /// and resources are copied sharing their (immutable) compositions. The
+  /// copy starts at ctx's current time, so ctx must be between timesteps,
+  /// e.g. after Timer::RunUntil returns. SimInit does not take ownership of
+  /// the recorder, and ctx is left unchanged.
+  ///
+  /// Agents that are asleep in ctx are awake in the copy. The copy's id
+  /// allocator starts where ctx's is, so both number the objects they create
+  /// afterwards the same way.
+  ///
+  /// If seed is not negative, the copy draws its random numbers with it
+  /// rather than with the seed of ctx (see SimInfo::seed).
+  ///
+  /// @throws Error if the solver of ctx cannot be copied
+  void Fork(Context* ctx, Recorder* r, int seed = -1);
+
+  /// Sets state variables of the named prototype and of every agent built
+  /// from it in ctx. Each agent is reinitialized with its InitFrom methods
+  /// from its current state, as recorded by its Snapshot methods, with the
+  /// named fields of its state tables set to the given values. The values
+  /// are converted to the types of the fields.
+  ///
+  /// @throws KeyError if there is no such prototype, or its state has no
+  /// such field
+  /// @throws ValueError if a value cannot be converted to its field's type
+  static void SetState(Context* ctx, std::string prototype,
+                       const std::map<std::string, std::string>& values);
+
+  /// Records the initial state of the compiled simulation sim_id in b (see
+  /// cyclus --compile) to r as the initial state of r's own simulation.
+  /// Calling Init with r and a backend registered with it afterwards starts
+  /// the simulation without reading, validating, and translating its input
+  /// file again.
+  static void LoadCompiled(QueryableBackend* b, boost::uuids::uuid sim_id,
+                           Recorder* r);
+
+  /// Returns the startup phases timed so far in this process.
+  static InitTimings& init_timings();
+
+  /// Records the startup phases timed so far to the InitTimings table of the
+  /// simulation managed by ctx.
+  static void RecordInitTimings(Context* ctx);
+
   /// Records a snapshot of the current state of the simulation being managed by
   /// ctx into the simulation's output database.
+  ///
+  /// If the CYCLUS_DELTA_SNAPSHOTS environment variable is set, the state of
+  /// an agent is only recorded if it differs from the state recorded by the
+  /// previous snapshot, as judged by comparing its serialized state with the
+  /// one last recorded. The time each agent's current state was recorded is
+  /// kept in the SnapshotAgents table, from which Restart finds it. Agents
+  /// whose state holds values of types that cannot be serialized are always
+  /// recorded. An inventory holding the same resource states as when it was
+  /// last recorded is recorded as a reference to that time in the
+  /// AgentStateInventoryRefs table.
+  ///
+  /// If the CYCLUS_STATE_IMAGE environment variable names a directory, the
+  /// state of the agents is also written there as a StateImage, which
+  /// Restart maps into memory to initialize the agents instead of querying
+  /// the database for their state.
+  ///
+  /// If the CYCLUS_SNAPSHOT_THREADS environment variable is set to more than
+  /// one, the state of agents whose snapshots are thread-safe (see
+  /// Agent::ThreadSafeSnapshot) is serialized on that many threads. The
+  /// recorded data is the same as when snapshots are taken on one thread.
   static void Snapshot(Context* ctx);
 
   /// Records a snapshot of the agent's current internal state into the
@@ -82,29 +186,78 @@ class SimInit {
   void LoadRecipes();
   void LoadSolverInfo();
   void LoadPrototypes();
+  Agent* LoadPrototype(int agentid, std::string impl);
+
+  /// initializes m, whose id is already set, from the state recorded for it
+  /// at time t, or at any time if t is -1
+  void InitAgentState(Agent* m, const AgentSpec& spec, int t);
   void LoadInitialAgents();
+
+  /// connects the agents in unbuilt to their parents (by id in parentmap),
+  /// adds them to agents_, and notifies them that they entered the
+  /// simulation
+  void ConnectAgents(std::map<int, Agent*>* unbuilt,
+                     std::map<int, int>& parentmap);
   void LoadInventories();
+
+  /// adds the inventories recorded as references by the snapshot at time t
+  /// to invs, by agent id
+  void LoadInventoryRefs(int t, std::map<int, Inventories>* invs);
   void LoadBuildSched();
   void LoadDecomSched();
   void LoadNextIds();
 
+  /// returns the time at which the state that agent id had at t_ was
+  /// recorded, which differs from t_ only for delta snapshots
+  int StateTime(int id);
+
   void* LoadPreconditioner(std::string name);
   ExchangeSolver* LoadGreedySolver(bool exclusive, std::set<std::string> tables);
   ExchangeSolver* LoadCoinSolver(bool exclusive, std::set<std::string> tables);
+  ExchangeSolver* LoadAuctionSolver(bool exclusive,
+                                    std::set<std::string> tables);
+  ExchangeSolver* LoadPluginSolver(bool exclusive,
+                                   std::set<std::string> tables);
   static Resource::Ptr LoadResource(Context* ctx, QueryableBackend* b, int resid);
   static Material::Ptr LoadMaterial(Context* ctx, QueryableBackend* b, int resid);
   static Product::Ptr LoadProduct(Context* ctx, QueryableBackend* b, int resid);
   static Composition::Ptr LoadComposition(QueryableBackend* b, int stateid);
 
+  /// returns a copy of r, owned by ctx, with the same state and object ids
+  static Resource::Ptr CopyResource(Context* ctx, Resource::Ptr r);
+
+  /// stages the snapshot of each agent in the matching list of states,
+  /// serializing thread-safe agents on up to threads threads. If any agent
+  /// throws, everything staged is discarded and the exception of the first
+  /// such agent is rethrown.
+  static void StageAgents(const std::vector<Agent*>& agents, int threads,
+                          std::vector<DatumList>* states);
+
+  /// records a snapshot of the agent's inventories.
+  static void SnapInventories(Agent* m);
+
+  /// reinitializes m from its current state with the given field values,
+  /// and returns the names of the fields its state has
+  static std::set<std::string> SetAgentState(
+      Agent* m, const std::map<std::string, std::string>& values);
+
   // std::map<AgentId, Agent*>
   std::map<int, Agent*> agents_;
 
+  // std::map<AgentId, StateTime> for delta snapshots
+  std::map<int, int> state_times_;
+
+  /// the agent state tables read in bulk while initializing, or NULL
+  AgentStateCache* cache_;
+
   Context* ctx_;
   Recorder* rec_;
   Timer ti_;
   boost::uuids::uuid simid_;
   SimInfo si_;
   QueryableBackend* b_;
+  /// rebuilds the classic tables of compact output databases beneath b_
+  boost::scoped_ptr<CompactExpander> expander_;
   int t_;
 };
 
@@ -0,0 +1,41 @@
+#ifndef CYCLUS_SRC_SIM_OBSERVER_H_
+#define CYCLUS_SRC_SIM_OBSERVER_H_
+
+namespace cyclus {
+
+class Context;
+
+/// An observer of a running simulation, notified by the timer as each time
+/// step begins, as each of its phases ends, and as it ends. Observers are
+/// native hooks for monitors such as metrics exporters and early termination
+/// checks, which need neither Python nor the event loop of the Python
+/// server. Register them with Context::RegisterObserver.
+///
+/// Observers are called on the thread the simulation runs on, between
+/// phases, so they may read the simulation's state, and may call
+/// Context::KillSim to end the simulation after the current time step. Since
+/// they hold up the simulation while they run, observers that do much work
+/// should hand it to another thread. Time steps that the timer skips over
+/// because nothing can happen in them (see Timer::SleepUntil) aren't
+/// observed.
+class SimObserver {
+ public:
+  virtual ~SimObserver() {}
+
+  /// Called as time step time begins, before anything is built.
+  virtual void OnStepBegin(Context* ctx, int time) {}
+
+  /// Called as a phase of time step time ends, with the phase's name and the
+  /// seconds it took. The phases are, in order, "Build", "Tick",
+  /// "ResourceExchange", "Tock", "Decision", and "Decom".
+  virtual void OnPhaseEnd(Context* ctx, int time, const char* phase,
+                          double secs) {}
+
+  /// Called as time step time ends, once its output has been handed to the
+  /// recorder.
+  virtual void OnStepEnd(Context* ctx, int time) {}
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_SIM_OBSERVER_H_
@@ -1,6 +1,9 @@
 #include "solver_factory.h"
 
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #include "OsiClpSolverInterface.hpp"
 #include "OsiCbcSolverInterface.hpp"
@@ -120,23 +123,90 @@ void ReportProg(OsiSolverInterface* si) {
 }
 
 void SolveProg(OsiSolverInterface* si, double greedy_obj, bool verbose) {
+  SolveProg(si, greedy_obj, verbose, false, NULL);
+}
+
+void SolveProg(OsiSolverInterface* si, double greedy_obj, bool verbose,
+               bool warm, const double* incumbent) {
+  SolveProg(si, greedy_obj, verbose, warm, incumbent, CbcOptions());
+}
+
+namespace {
+
+// returns the arguments of CbcMain1 that solve a program with opts
+std::vector<std::string> CbcArgs(const CbcOptions& opts) {
+  std::vector<std::string> args;
+  args.push_back("exchng");
+  args.push_back("-log");
+  args.push_back("0");
+  if (opts.threads > 1) {
+    // Cbc reads counts over 100 as deterministic searches on the count less
+    // 100 threads
+    std::stringstream ss;
+    ss << 100 + opts.threads;
+    args.push_back("-threads");
+    args.push_back(ss.str());
+  }
+  if (opts.seconds > 0) {
+    std::stringstream ss;
+    ss << opts.seconds;
+    args.push_back("-seconds");
+    args.push_back(ss.str());
+  }
+  if (opts.gap >= 0) {
+    std::stringstream ss;
+    ss << opts.gap;
+    args.push_back("-ratioGap");
+    args.push_back(ss.str());
+  }
+  if (!opts.presolve) {
+    args.push_back("-presolve");
+    args.push_back("off");
+    args.push_back("-preprocess");
+    args.push_back("off");
+  }
+  args.push_back("-solve");
+  args.push_back("-quit");
+  return args;
+}
+
+}  // namespace
+
+void SolveProg(OsiSolverInterface* si, double greedy_obj, bool verbose,
+               bool warm, const double* incumbent, const CbcOptions& opts) {
   if (verbose)
     ReportProg(si);
 
   if (HasInt(si)) {
-    const char *argv[] = {"exchng", "-log", "0", "-solve", "-quit"};
-    int argc = 5;
+    // the root relaxation is warm started from si's basis, which the model
+    // copies
+    if (warm)
+      si->resolve();
+    std::vector<std::string> args = CbcArgs(opts);
+    std::vector<const char*> argv;
+    for (int i = 0; i != args.size(); i++)
+      argv.push_back(args[i].c_str());
     CbcModel model(*si);
     ObjValueHandler handler(greedy_obj);
     CbcMain0(model);
+    if (incumbent != NULL) {
+      int ncols = si->getNumCols();
+      const double* objs = si->getObjCoefficients();
+      double obj = 0;
+      for (int i = 0; i != ncols; i++)
+        obj += objs[i] * incumbent[i];
+      model.setBestSolution(incumbent, ncols, obj, true);  // checked
+    }
     model.passInEventHandler(&handler);
-    CbcMain1(argc, argv, model, CbcCallBack);
+    CbcMain1(argv.size(), &argv[0], model, CbcCallBack);
     si->setColSolution(model.getColSolution());
     if (verbose) {
       std::cout << "Greedy equivalent time: " << handler.time()
                 << " and obj " << handler.obj()
                 << " and found " << std::boolalpha << handler.found() << "\n";
     }
+  } else if (warm) {
+    si->resolve();
   } else {
     // no ints, just solve 'initial lp relaxation'
     si->initialSolve();
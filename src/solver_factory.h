@@ -33,6 +33,27 @@ class ObjValueHandler: public CbcEventHandler {
   bool found_;
 };
 
+/// @brief Options for Cbc, the branch and cut solver of mixed-integer
+/// programs.
+struct CbcOptions {
+  CbcOptions() : threads(1), seconds(0), gap(-1), presolve(true) {}
+
+  /// the number of threads Cbc searches with. Searches on more than one
+  /// thread are deterministic, and need a Cbc built with threads.
+  int threads;
+
+  /// the most seconds a search may take, or no limit if non-positive.
+  /// Searches stopped by the limit keep the best solution found so far.
+  double seconds;
+
+  /// the relative gap between the best solution and the best bound at which
+  /// a search stops, or Cbc's default if negative
+  double gap;
+
+  /// whether Cbc presolves and preprocesses programs
+  bool presolve;
+};
+
 /// A factory class that, given a configuration, returns a
 /// Coin::OsiSolverInterface for a solver.
 ///
@@ -64,6 +85,18 @@ void SolveProg(OsiSolverInterface* si);
 void SolveProg(OsiSolverInterface* si, bool verbose);
 void SolveProg(OsiSolverInterface* si, double greedy_obj);
 void SolveProg(OsiSolverInterface* si, double greedy_obj, bool verbose);
+
+/// Solves the program held by si. If warm is true, the LP is resolved from the
+/// basis that si already holds. A non-NULL incumbent, with one value per
+/// column of si, is offered to Cbc as a starting solution for mixed-integer
+/// programs; it is only used if it is feasible for the current program.
+void SolveProg(OsiSolverInterface* si, double greedy_obj, bool verbose,
+               bool warm, const double* incumbent);
+
+/// Solves the program held by si as above, solving mixed-integer programs
+/// with the Cbc options opts.
+void SolveProg(OsiSolverInterface* si, double greedy_obj, bool verbose,
+               bool warm, const double* incumbent, const CbcOptions& opts);
 bool HasInt(OsiSolverInterface* si);
 
 }  // namespace cyclus
@@ -0,0 +1,190 @@
+#include "sparse_cram.h"
+
+#include <atomic>
+#include <complex>
+#include <map>
+#include <sstream>
+#include <utility>
+
+#include "env.h"
+#include "error.h"
+
+extern "C" {
+#include "cram.hpp"
+}
+
+namespace cyclus {
+
+namespace {
+
+typedef std::complex<double> Complex;
+
+// the poles theta_k and residues alpha_k of the order 14 CRAM approximation
+// in partial fraction form, one of each conjugate pair, and its limit alpha0
+// at infinity, from M. Pusa, "Rational Approximations to the Matrix
+// Exponential in Burnup Calculations", Nucl. Sci. Eng. 169 (2011)
+const int kPoles = 7;
+const Complex kTheta[kPoles] = {
+  Complex(-8.8977731864688888199e0, 1.6630982619902085304e1),
+  Complex(-3.7032750494234480603e0, 1.3656371871483268171e1),
+  Complex(-2.0875863825013012510e-1, 1.0991260561901260913e1),
+  Complex(3.9933697105785685194e0, 6.0048316422350373178e0),
+  Complex(5.0893450605806245066e0, 3.5888240290270065102e0),
+  Complex(5.6231425727459771248e0, 1.1940690463439669766e0),
+  Complex(2.2697838292311127097e0, 8.4617379730402214019e0),
+};
+const Complex kAlpha[kPoles] = {
+  Complex(-7.1542880635890672853e-5, 1.4361043349541300111e-4),
+  Complex(9.4390253107361688779e-3, -1.7184791958483017511e-2),
+  Complex(-3.7636003878226968717e-1, 3.3518347029450104214e-1),
+  Complex(-2.3498232091082701191e1, -5.8083591297142074004e0),
+  Complex(4.6933274488831293047e1, 4.5643649768827760791e1),
+  Complex(-2.7875161940145646468e1, -1.0214733999056451434e2),
+  Complex(4.8071120988325088907e0, -1.3209793837428723881e0),
+};
+const double kAlpha0 = 1.8321743782540412751e-14;
+
+std::atomic<bool>& Enabled() {
+  static std::atomic<bool> enabled(
+      !Env::GetEnv("CYCLUS_SPARSE_DECAY").empty());
+  return enabled;
+}
+
+}  // namespace
+
+SparseCram& SparseCram::Instance() {
+  static SparseCram solver(
+      pyne_cram_transmute_info.n,
+      std::vector<int>(pyne_cram_transmute_info.i,
+                       pyne_cram_transmute_info.i +
+                       pyne_cram_transmute_info.nnz),
+      std::vector<int>(pyne_cram_transmute_info.j,
+                       pyne_cram_transmute_info.j +
+                       pyne_cram_transmute_info.nnz),
+      // pyne stores the negated rate matrix
+      [] {
+        std::vector<double> vals(pyne_cram_transmute_info.nnz);
+        for (int k = 0; k < pyne_cram_transmute_info.nnz; ++k) {
+          vals[k] = -pyne_cram_transmute_info.decay_matrix[k];
+        }
+        return vals;
+      }());
+  return solver;
+}
+
+bool SparseCram::enabled() {
+  return Enabled();
+}
+
+void SparseCram::enabled(bool e) {
+  Enabled() = e;
+}
+
+SparseCram::SparseCram(int n, const std::vector<int>& rows,
+                       const std::vector<int>& cols,
+                       const std::vector<double>& vals)
+    : n_(n) {
+  if (rows.size() != cols.size() || rows.size() != vals.size())
+    throw ValueError("decay matrix entries need a row, column and value each");
+
+  // gather the entries by row, leaving out the zeros pyne keeps for fill in
+  std::vector<double> diag(n, 0);
+  std::vector<std::map<int, double> > parents(n);
+  for (size_t k = 0; k < rows.size(); ++k) {
+    int i = rows[k];
+    int j = cols[k];
+    if (i < 0 || i >= n || j < 0 || j >= n) {
+      std::stringstream ss;
+      ss << "decay matrix entry (" << i << ", " << j << ") is out of range "
+         << "for " << n << " nuclides";
+      throw ValueError(ss.str());
+    }
+    if (vals[k] == 0) {
+      continue;
+    } else if (i == j) {
+      diag[i] += vals[k];
+    } else {
+      parents[i][j] += vals[k];
+    }
+  }
+
+  // order the nuclides parents first
+  std::vector<int> nparents(n);
+  std::vector<std::vector<int> > daughters(n);
+  for (int i = 0; i < n; ++i) {
+    nparents[i] = parents[i].size();
+    std::map<int, double>::iterator it;
+    for (it = parents[i].begin(); it != parents[i].end(); ++it) {
+      daughters[it->first].push_back(i);
+    }
+  }
+  order_.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    if (nparents[i] == 0)
+      order_.push_back(i);
+  }
+  for (size_t p = 0; p < order_.size(); ++p) {
+    const std::vector<int>& ds = daughters[order_[p]];
+    for (size_t k = 0; k < ds.size(); ++k) {
+      if (--nparents[ds[k]] == 0)
+        order_.push_back(ds[k]);
+    }
+  }
+  if (order_.size() != static_cast<size_t>(n)) {
+    throw ValueError("decay matrix has a nuclide that decays to itself");
+  }
+
+  pos_.resize(n);
+  for (int p = 0; p < n; ++p) {
+    pos_[order_[p]] = p;
+  }
+  diag_.resize(n);
+  row_start_.reserve(n + 1);
+  row_start_.push_back(0);
+  for (int p = 0; p < n; ++p) {
+    int i = order_[p];
+    diag_[p] = diag[i];
+    std::map<int, double>::iterator it;
+    for (it = parents[i].begin(); it != parents[i].end(); ++it) {
+      cols_.push_back(pos_[it->first]);
+      vals_.push_back(it->second);
+    }
+    row_start_.push_back(cols_.size());
+  }
+}
+
+void SparseCram::Expm(double t, int nvec, const double* n0,
+                      double* n1) const {
+  size_t len = static_cast<size_t>(n_) * nvec;
+  for (size_t k = 0; k < len; ++k) {
+    n1[k] = kAlpha0 * n0[k];
+  }
+
+  // solves (A t - theta I) x = n0 for each pole by substitution in parents
+  // first order, with x kept by position
+  std::vector<Complex> x(len);
+  for (int k = 0; k < kPoles; ++k) {
+    for (int p = 0; p < n_; ++p) {
+      int i = order_[p];
+      Complex* xp = &x[static_cast<size_t>(p) * nvec];
+      for (int v = 0; v < nvec; ++v) {
+        xp[v] = n0[static_cast<size_t>(i) * nvec + v];
+      }
+      for (int e = row_start_[p]; e < row_start_[p + 1]; ++e) {
+        double a = vals_[e] * t;
+        const Complex* xj = &x[static_cast<size_t>(cols_[e]) * nvec];
+        for (int v = 0; v < nvec; ++v) {
+          xp[v] -= a * xj[v];
+        }
+      }
+      Complex d = diag_[p] * t - kTheta[k];
+      double* out = &n1[static_cast<size_t>(i) * nvec];
+      for (int v = 0; v < nvec; ++v) {
+        xp[v] /= d;
+        out[v] += 2 * (kAlpha[k] * xp[v]).real();
+      }
+    }
+  }
+}
+
+}  // namespace cyclus
@@ -1,5 +1,9 @@
 #include "sqlite_back.h"
 
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iomanip>
 #include <sstream>
 
@@ -35,22 +39,284 @@ std::vector<std::string> split(const std::string& s, char delim) {
   return elems;
 }
 
+
+namespace {
+
+// Compact binary encoding for container column values.  All scalars are
+// written little-endian regardless of host byte order, strings and
+// containers are prefixed with their 32-bit element count.  Overloads are
+// declared before they are defined so that nested containers resolve to
+// them at template instantiation.
+void EncodeBin(std::string* buf, bool x);
+void EncodeBin(std::string* buf, int x);
+void EncodeBin(std::string* buf, float x);
+void EncodeBin(std::string* buf, double x);
+void EncodeBin(std::string* buf, const std::string& x);
+template <class A, class B>
+void EncodeBin(std::string* buf, const std::pair<A, B>& x);
+template <class T>
+void EncodeBin(std::string* buf, const std::vector<T>& x);
+template <class T>
+void EncodeBin(std::string* buf, const std::list<T>& x);
+template <class T>
+void EncodeBin(std::string* buf, const std::set<T>& x);
+template <class K, class V>
+void EncodeBin(std::string* buf, const std::map<K, V>& x);
+
+/// Tracks the read position while decoding a binary encoded value.
+class BinReader {
+ public:
+  BinReader(const char* data, int n) : pos_(data), end_(data + n) {}
+
+  const char* Take(size_t n) {
+    if (static_cast<size_t>(end_ - pos_) < n) {
+      throw ValueError("truncated binary value in sqlite database");
+    }
+    const char* p = pos_;
+    pos_ += n;
+    return p;
+  }
+
+  bool done() const { return pos_ == end_; }
+
+ private:
+  const char* pos_;
+  const char* end_;
+};
+
+void DecodeBin(BinReader* r, bool* x);
+void DecodeBin(BinReader* r, int* x);
+void DecodeBin(BinReader* r, float* x);
+void DecodeBin(BinReader* r, double* x);
+void DecodeBin(BinReader* r, std::string* x);
+template <class A, class B>
+void DecodeBin(BinReader* r, std::pair<A, B>* x);
+template <class T>
+void DecodeBin(BinReader* r, std::vector<T>* x);
+template <class T>
+void DecodeBin(BinReader* r, std::list<T>* x);
+template <class T>
+void DecodeBin(BinReader* r, std::set<T>* x);
+template <class K, class V>
+void DecodeBin(BinReader* r, std::map<K, V>* x);
+
+inline void PutU32(std::string* buf, uint32_t u) {
+  char b[4];
+  for (int i = 0; i < 4; ++i) {
+    b[i] = static_cast<char>((u >> (8 * i)) & 0xFF);
+  }
+  buf->append(b, 4);
+}
+
+inline void PutU64(std::string* buf, uint64_t u) {
+  char b[8];
+  for (int i = 0; i < 8; ++i) {
+    b[i] = static_cast<char>((u >> (8 * i)) & 0xFF);
+  }
+  buf->append(b, 8);
+}
+
+inline uint32_t GetU32(BinReader* r) {
+  const unsigned char* b = reinterpret_cast<const unsigned char*>(r->Take(4));
+  uint32_t u = 0;
+  for (int i = 0; i < 4; ++i) {
+    u |= static_cast<uint32_t>(b[i]) << (8 * i);
+  }
+  return u;
+}
+
+inline uint64_t GetU64(BinReader* r) {
+  const unsigned char* b = reinterpret_cast<const unsigned char*>(r->Take(8));
+  uint64_t u = 0;
+  for (int i = 0; i < 8; ++i) {
+    u |= static_cast<uint64_t>(b[i]) << (8 * i);
+  }
+  return u;
+}
+
+void EncodeBin(std::string* buf, bool x) {
+  buf->push_back(x ? 1 : 0);
+}
+
+void EncodeBin(std::string* buf, int x) {
+  PutU32(buf, static_cast<uint32_t>(x));
+}
+
+void EncodeBin(std::string* buf, float x) {
+  uint32_t u;
+  memcpy(&u, &x, sizeof(u));
+  PutU32(buf, u);
+}
+
+void EncodeBin(std::string* buf, double x) {
+  uint64_t u;
+  memcpy(&u, &x, sizeof(u));
+  PutU64(buf, u);
+}
+
+void EncodeBin(std::string* buf, const std::string& x) {
+  PutU32(buf, x.size());
+  buf->append(x);
+}
+
+template <class A, class B>
+void EncodeBin(std::string* buf, const std::pair<A, B>& x) {
+  EncodeBin(buf, x.first);
+  EncodeBin(buf, x.second);
+}
+
+template <class T>
+void EncodeBin(std::string* buf, const std::vector<T>& x) {
+  PutU32(buf, x.size());
+  typename std::vector<T>::const_iterator it;
+  for (it = x.begin(); it != x.end(); ++it) {
+    EncodeBin(buf, *it);
+  }
+}
+
+template <class T>
+void EncodeBin(std::string* buf, const std::list<T>& x) {
+  PutU32(buf, x.size());
+  typename std::list<T>::const_iterator it;
+  for (it = x.begin(); it != x.end(); ++it) {
+    EncodeBin(buf, *it);
+  }
+}
+
+template <class T>
+void EncodeBin(std::string* buf, const std::set<T>& x) {
+  PutU32(buf, x.size());
+  typename std::set<T>::const_iterator it;
+  for (it = x.begin(); it != x.end(); ++it) {
+    EncodeBin(buf, *it);
+  }
+}
+
+template <class K, class V>
+void EncodeBin(std::string* buf, const std::map<K, V>& x) {
+  PutU32(buf, x.size());
+  typename std::map<K, V>::const_iterator it;
+  for (it = x.begin(); it != x.end(); ++it) {
+    EncodeBin(buf, it->first);
+    EncodeBin(buf, it->second);
+  }
+}
+
+void DecodeBin(BinReader* r, bool* x) {
+  *x = *r->Take(1) != 0;
+}
+
+void DecodeBin(BinReader* r, int* x) {
+  *x = static_cast<int>(GetU32(r));
+}
+
+void DecodeBin(BinReader* r, float* x) {
+  uint32_t u = GetU32(r);
+  memcpy(x, &u, sizeof(u));
+}
+
+void DecodeBin(BinReader* r, double* x) {
+  uint64_t u = GetU64(r);
+  memcpy(x, &u, sizeof(u));
+}
+
+void DecodeBin(BinReader* r, std::string* x) {
+  uint32_t n = GetU32(r);
+  x->assign(r->Take(n), n);
+}
+
+template <class A, class B>
+void DecodeBin(BinReader* r, std::pair<A, B>* x) {
+  DecodeBin(r, &x->first);
+  DecodeBin(r, &x->second);
+}
+
+template <class T>
+void DecodeBin(BinReader* r, std::vector<T>* x) {
+  uint32_t n = GetU32(r);
+  x->resize(n);
+  for (uint32_t i = 0; i < n; ++i) {
+    DecodeBin(r, &(*x)[i]);
+  }
+}
+
+template <class T>
+void DecodeBin(BinReader* r, std::list<T>* x) {
+  uint32_t n = GetU32(r);
+  x->clear();
+  for (uint32_t i = 0; i < n; ++i) {
+    T item;
+    DecodeBin(r, &item);
+    x->push_back(item);
+  }
+}
+
+template <class T>
+void DecodeBin(BinReader* r, std::set<T>* x) {
+  uint32_t n = GetU32(r);
+  x->clear();
+  for (uint32_t i = 0; i < n; ++i) {
+    T item;
+    DecodeBin(r, &item);
+    x->insert(x->end(), item);
+  }
+}
+
+template <class K, class V>
+void DecodeBin(BinReader* r, std::map<K, V>* x) {
+  uint32_t n = GetU32(r);
+  x->clear();
+  for (uint32_t i = 0; i < n; ++i) {
+    K key;
+    DecodeBin(r, &key);
+    DecodeBin(r, &(*x)[key]);
+  }
+}
+
+// sqlite's default limit on the number of parameters bound to one statement.
+const int kMaxBoundParams = 999;
+
+}  // namespace
+
 SqliteBack::~SqliteBack() {
   try {
-    Flush();
+    Close();
     db_.close();
   } catch (Error err) {
     CLOG(LEV_ERROR) << "Error in SqliteBack destructor: " << err.what();
   }
 }
 
-SqliteBack::SqliteBack(std::string path) : db_(path) {
+SqliteBack::ReaderPool::~ReaderPool() {
+  std::map<std::thread::id, boost::shared_ptr<SqliteDb> >::iterator it;
+  for (it = conns.begin(); it != conns.end(); ++it) {
+    try {
+      it->second->close();
+    } catch (Error err) {
+      CLOG(LEV_ERROR) << "Error closing a sqlite reader: " << err.what();
+    }
+  }
+}
+
+SqliteBack::SqliteBack(std::string path, bool readonly)
+    : db_(path, readonly),
+      batch_rows_(kSqliteBatchRows),
+      index_tables_(DefaultIndexTables()),
+      index_on_create_(false),
+      index_lineage_(false),
+      readonly_(readonly),
+      owner_(std::this_thread::get_id()),
+      readers_(new ReaderPool()) {
   path_ = path;
   db_.open();
 
-  db_.Execute("PRAGMA synchronous=OFF;");
-  db_.Execute("PRAGMA journal_mode=MEMORY;");
-  db_.Execute("PRAGMA temp_store=MEMORY;");
+  if (readonly_) {
+    ConfigureReader(&db_);
+  } else {
+    db_.Execute("PRAGMA synchronous=OFF;");
+    db_.Execute("PRAGMA journal_mode=MEMORY;");
+    db_.Execute("PRAGMA temp_store=MEMORY;");
+  }
 
   // cache pre-existing table names
   SqlStatement::Ptr stmt;
@@ -60,25 +326,57 @@ SqliteBack::SqliteBack(std::string path) : db_(path) {
     tbl_names_.insert(stmt->GetText(0, NULL));
   }
 
-  if (tbl_names_.count("FieldTypes") == 0) {
+  if (tbl_names_.count("FieldTypes") == 0 && readonly_) {
+    format_version_ = kSqliteBinaryFormat;  // nothing to read anyway
+  } else if (tbl_names_.count("FieldTypes") == 0) {
     std::string cmd = "CREATE TABLE IF NOT EXISTS FieldTypes";
     cmd += "(TableName TEXT,Field TEXT,Type INTEGER);";
     db_.Execute(cmd);
+    format_version_ = kSqliteBinaryFormat;
+    db_.Execute("PRAGMA user_version=" +
+                boost::lexical_cast<std::string>(format_version_) + ";");
+  } else {
+    // databases written before the binary encoding existed never set the
+    // user version and so report 0 here.
+    stmt = db_.Prepare("PRAGMA user_version;");
+    format_version_ = stmt->Step() ? stmt->GetInt(0) : kSqliteXmlFormat;
+    if (format_version_ > kSqliteBinaryFormat) {
+      throw IOError("sqlite database '" + path + "' uses unsupported format "
+                    "version " + boost::lexical_cast<std::string>(
+                        format_version_));
+    }
   }
 }
 
-void SqliteBack::Notify(DatumList data) {
+int SqliteBack::format_version() {
+  return format_version_;
+}
+
+void SqliteBack::Notify(const DatumGroups& groups) {
+  if (readonly_) {
+    throw IOError("cannot write to read-only sqlite database " + path_);
+  }
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
   db_.Execute("BEGIN TRANSACTION;");
   try {
-    for (DatumList::iterator it = data.begin(); it != data.end(); ++it) {
-      std::string tbl = (*it)->title();
+    DatumGroups::const_iterator it;
+    for (it = groups.begin(); it != groups.end(); ++it) {
+      const std::string& tbl = it->title();
+      if (index_lineage_) {
+        lineage_.Add(*it);
+      }
       if (tbl_names_.count(tbl) == 0) {
-        CreateTable(*it);
+        CreateTable(it->front());
       }
       if (stmts_.count(tbl) == 0) {
-        BuildStmt(*it);
+        BuildStmt(it->front());
+      }
+      int batch = batch_sizes_[tbl];
+      for (int i = 0; i < it->size(); i += batch) {
+        WriteData(tbl, it->begin() + i,
+                  std::min<int>(batch, it->size() - i));
       }
-      WriteDatum(*it);
     }
   } catch (ValueError err) {
     db_.Execute("END TRANSACTION;");
@@ -86,11 +384,31 @@ void SqliteBack::Notify(DatumList data) {
   }
   db_.Execute("END TRANSACTION;");
   Flush();
+
+  double secs = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  CLOG(LEV_DEBUG1) << "SqliteBack inserted " << groups.ndata() << " rows in "
+                   << secs << " s ("
+                   << (secs > 0 ? groups.ndata() / secs : 0)
+                   << " rows/s, batches of up to " << batch_rows_ << ")";
+}
+
+void SqliteBack::set_batch_rows(int n) {
+  batch_rows_ = std::max(n, 1);
+  std::map<std::string, std::vector<DbTypes> >::iterator it;
+  for (it = schemas_.begin(); it != schemas_.end(); ++it) {
+    int ncols = std::max<int>(it->second.size(), 1);
+    batch_sizes_[it->first] =
+        std::max(1, std::min(batch_rows_, kMaxBoundParams / ncols));
+  }
 }
 
 void SqliteBack::Flush() { }
 
 std::list<ColumnInfo> SqliteBack::Schema(std::string table) {
+  if (Expanded(table)) {
+    return CompactExpander(this).Schema(table);
+  }
   std::list<ColumnInfo> schema;
   QueryResult qr = GetTableInfo(table);
   for (int i = 0; i < qr.fields.size(); ++i) {
@@ -101,42 +419,187 @@ std::list<ColumnInfo> SqliteBack::Schema(std::string table) {
 }
 
 QueryResult SqliteBack::Query(std::string table, std::vector<Cond>* conds) {
-  QueryResult q = GetTableInfo(table);
+  return Query(table, conds, NULL);
+}
 
-  std::stringstream sql;
-  sql << "SELECT * FROM " << table;
-  if (conds != NULL) {
-    sql << " WHERE ";
-    for (int i = 0; i < conds->size(); ++i) {
-      if (i > 0) {
-        sql << " AND ";
+/// Steps a prepared SELECT statement a batch of rows at a time.
+class SqliteBack::SqliteCursor : public QueryCursor {
+ public:
+  SqliteCursor(SqliteBack* back, SqlStatement::Ptr stmt,
+               const QueryResult& info)
+      : back_(back),
+        stmt_(stmt),
+        info_(info),
+        done_(false) {}
+
+  virtual QueryResult Next(int n) {
+    QueryResult batch;
+    batch.fields = info_.fields;
+    batch.types = info_.types;
+    // sqlite restarts a finished statement on the next step, so never step
+    // again once the end has been reached.
+    while (!done_ && static_cast<int>(batch.rows.size()) < n) {
+      if (!stmt_->Step()) {
+        done_ = true;
+        break;
       }
-      Cond c = (*conds)[i];
-      sql << c.field << " " << c.op << " ?";
+      batch.rows.push_back(back_->ReadRow(stmt_, info_.types));
     }
+    return batch;
   }
-  sql << ";";
 
-  SqlStatement::Ptr stmt = db_.Prepare(sql.str());
+ private:
+  SqliteBack* back_;
+  SqlStatement::Ptr stmt_;
+  QueryResult info_;
+  bool done_;
+};
+
+QueryResult SqliteBack::Query(std::string table, std::vector<Cond>* conds,
+                              std::vector<std::string>* fields) {
+  if (Expanded(table)) {
+    return CompactExpander(this).Query(table, conds, fields);
+  }
+  QueryResult q;
+  SqlStatement::Ptr stmt = PrepareQuery(table, conds, fields, &q);
+  while (stmt->Step()) {
+    q.rows.push_back(ReadRow(stmt, q.types));
+  }
+  return q;
+}
+
+QueryCursor::Ptr SqliteBack::Cursor(std::string table,
+                                    std::vector<Cond>* conds,
+                                    std::vector<std::string>* fields) {
+  if (Expanded(table)) {
+    return CompactExpander(this).Cursor(table, conds, fields);
+  }
+  QueryResult info;
+  SqlStatement::Ptr stmt = PrepareQuery(table, conds, fields, &info);
+  return QueryCursor::Ptr(new SqliteCursor(this, stmt, info));
+}
 
-  if (conds != NULL) {
-    for (int i = 0; i < conds->size(); ++i) {
-      boost::spirit::hold_any v = (*conds)[i].val;
-      Bind(v, Type(v), stmt, i+1);
+SqlStatement::Ptr SqliteBack::PrepareQuery(std::string table,
+                                           std::vector<Cond>* conds,
+                                           std::vector<std::string>* fields,
+                                           QueryResult* info) {
+  *info = GetTableInfo(table);
+  if (fields != NULL) {
+    info->Project(*fields);
+  }
+
+  std::stringstream sql;
+  sql << "SELECT ";
+  if (fields == NULL) {
+    sql << "*";
+  } else if (info->fields.empty()) {
+    sql << "1";  // rows with no columns
+  } else {
+    for (int i = 0; i < info->fields.size(); ++i) {
+      sql << (i > 0 ? "," : "") << info->fields[i];
     }
   }
+  sql << " FROM " << table << Where(conds) << ";";
 
-  for (int i = 0; stmt->Step(); ++i) {
-    QueryRow r;
-    for (int j = 0; j < q.fields.size(); ++j) {
-      r.push_back(ColAsVal(stmt, j, q.types[j]));
+  SqlStatement::Ptr stmt = conn().Prepare(sql.str());
+  BindConds(conds, stmt);
+  return stmt;
+}
+
+std::string SqliteBack::Where(std::vector<Cond>* conds) {
+  if (conds == NULL || conds->empty()) {
+    return "";
+  }
+  std::stringstream sql;
+  sql << " WHERE ";
+  for (int i = 0; i < conds->size(); ++i) {
+    if (i > 0) {
+      sql << " AND ";
     }
-    q.rows.push_back(r);
+    Cond c = (*conds)[i];
+    sql << c.field << " " << c.op << " ?";
   }
-  return q;
+  return sql.str();
+}
+
+void SqliteBack::BindConds(std::vector<Cond>* conds, SqlStatement::Ptr stmt) {
+  if (conds == NULL) {
+    return;
+  }
+  for (int i = 0; i < conds->size(); ++i) {
+    boost::spirit::hold_any v = (*conds)[i].val;
+    Bind(v, Type(v), stmt, i+1);
+  }
+}
+
+QueryResult SqliteBack::Aggregate(std::string table, std::vector<Cond>* conds,
+                                  std::vector<std::string>* group_by,
+                                  const std::vector<Agg>& aggs) {
+  if (Expanded(table)) {
+    return CompactExpander(this).Aggregate(table, conds, group_by, aggs);
+  }
+  // checks the fields and works out the columns of the result
+  std::vector<std::string> groups;
+  if (group_by != NULL) {
+    groups = *group_by;
+  }
+  QueryResult qr = Aggregator(groups, aggs, ColumnTypes(table)).Result();
+
+  std::stringstream cols;
+  for (int i = 0; i < groups.size(); ++i) {
+    cols << groups[i] << ",";
+  }
+  for (int i = 0; i < aggs.size(); ++i) {
+    switch (aggs[i].opcode) {
+      case AGG_COUNT: {
+        cols << "count(*),";
+        break;
+      }
+      case AGG_SUM: {
+        cols << "total(" << aggs[i].field << "),";  // always a REAL
+        break;
+      }
+      default: {
+        cols << aggs[i].op << "(" << aggs[i].field << "),";
+        break;
+      }
+    }
+  }
+  // the row count tells an empty table from a group without grouping
+  cols << "count(*)";
+
+  std::stringstream sql;
+  sql << "SELECT " << cols.str() << " FROM " << table << Where(conds);
+  if (!groups.empty()) {
+    std::string keys = boost::algorithm::join(groups, ",");
+    sql << " GROUP BY " << keys << " ORDER BY " << keys;
+  }
+  sql << ";";
+
+  SqlStatement::Ptr stmt = conn().Prepare(sql.str());
+  BindConds(conds, stmt);
+  while (stmt->Step()) {
+    if (stmt->GetInt(qr.fields.size()) == 0) {
+      continue;
+    }
+    qr.rows.push_back(ReadRow(stmt, qr.types));
+  }
+  return qr;
+}
+
+QueryRow SqliteBack::ReadRow(SqlStatement::Ptr stmt,
+                             const std::vector<DbTypes>& types) {
+  QueryRow r;
+  for (int j = 0; j < types.size(); ++j) {
+    r.push_back(ColAsVal(stmt, j, types[j]));
+  }
+  return r;
 }
 
 std::map<std::string, DbTypes> SqliteBack::ColumnTypes(std::string table) {
+  if (Expanded(table)) {
+    return CompactExpander(this).ColumnTypes(table);
+  }
   QueryResult qr = GetTableInfo(table);
   std::map<std::string, DbTypes> rtn;
   for (int i = 0; i < qr.fields.size(); ++i)
@@ -144,13 +607,20 @@ std::map<std::string, DbTypes> SqliteBack::ColumnTypes(std::string table) {
   return rtn;
 }
 
+bool SqliteBack::Expanded(const std::string& table) {
+  // the classic tables of compact output are views, and so never rebuilt
+  return CompactExpander::Source(table) != NULL &&
+         CompactExpander(this).Expanded(table);
+}
+
 std::set<std::string> SqliteBack::Tables() {
   using std::set;
   using std::string;
   set<string> rtn;
-  std::string sql = "SELECT name FROM sqlite_master WHERE type='table';";
+  std::string sql =
+      "SELECT name FROM sqlite_master WHERE type IN ('table', 'view');";
   SqlStatement::Ptr stmt;
-  stmt = db_.Prepare(sql);
+  stmt = conn().Prepare(sql);
   while (stmt->Step()) {
     rtn.insert(stmt->GetText(0, NULL));
   }
@@ -162,11 +632,35 @@ SqliteDb& SqliteBack::db() {
   return db_;
 }
 
+SqliteDb& SqliteBack::conn() {
+  if (!readonly_ || std::this_thread::get_id() == owner_) {
+    return db_;
+  }
+  std::lock_guard<std::mutex> lock(readers_->mu);
+  boost::shared_ptr<SqliteDb>& db =
+      readers_->conns[std::this_thread::get_id()];
+  if (db.get() == NULL) {
+    db.reset(new SqliteDb(path_, true));
+    db->open();
+    ConfigureReader(db.get());
+  }
+  return *db;
+}
+
+void SqliteBack::ConfigureReader(SqliteDb* db) {
+  db->Execute("PRAGMA query_only=ON;");
+  db->Execute("PRAGMA temp_store=MEMORY;");
+  db->Execute("PRAGMA mmap_size=" +
+              boost::lexical_cast<std::string>(kSqliteReadMmapSize) + ";");
+  db->Execute("PRAGMA cache_size=-" +
+              boost::lexical_cast<std::string>(kSqliteReadCacheKiB) + ";");
+}
+
 QueryResult SqliteBack::GetTableInfo(std::string table) {
   std::string sql = "SELECT Field,Type FROM FieldTypes WHERE TableName = '" +
                     table + "';";
   SqlStatement::Ptr stmt;
-  stmt = db_.Prepare(sql);
+  stmt = conn().Prepare(sql);
 
   int i = 0;
   QueryResult info;
@@ -188,17 +682,35 @@ void SqliteBack::BuildStmt(Datum* d) {
   std::string name = d->title();
   Datum::Vals vals = d->vals();
   std::vector<DbTypes> schema;
-
-  schema.push_back(Type(vals[0].second));
-  std::string insert = "INSERT INTO " + name + " VALUES (?";
-  for (int i = 1; i < vals.size(); ++i) {
+  for (int i = 0; i < vals.size(); ++i) {
     schema.push_back(Type(vals[i].second));
-    insert += ", ?";
   }
-  insert += ");";
-
   schemas_[name] = schema;
-  stmts_[name] = db_.Prepare(insert);
+
+  int ncols = std::max<int>(vals.size(), 1);
+  int nrows = std::max(1, std::min(batch_rows_, kMaxBoundParams / ncols));
+  batch_sizes_[name] = nrows;
+  InsertStmt(name, 1);
+  InsertStmt(name, nrows);
+}
+
+SqlStatement::Ptr SqliteBack::InsertStmt(const std::string& tbl, int nrows) {
+  std::map<int, SqlStatement::Ptr>& stmts = stmts_[tbl];
+  if (stmts.count(nrows) > 0) {
+    return stmts[nrows];
+  }
+
+  std::string row = "(?";
+  for (int i = 1; i < schemas_[tbl].size(); ++i) {
+    row += ", ?";
+  }
+  row += ")";
+  std::string insert = "INSERT INTO " + tbl + " VALUES " + row;
+  for (int i = 1; i < nrows; ++i) {
+    insert += ", " + row;
+  }
+  insert += ";";
+  return stmts[nrows] = db_.Prepare(insert);
 }
 
 void SqliteBack::CreateTable(Datum* d) {
@@ -230,16 +742,176 @@ void SqliteBack::CreateTable(Datum* d) {
 
   cmd += ");";
   db_.Execute(cmd);
+
+  if (index_on_create_ && Indexed(name)) {
+    CreateIndexes(name);
+  } else {
+    unindexed_.insert(name);
+  }
+  CreateCompactView(name);
 }
 
-void SqliteBack::WriteDatum(Datum* d) {
-  Datum::Vals vals = d->vals();
-  SqlStatement::Ptr stmt = stmts_[d->title()];
-  std::vector<DbTypes> schema = schemas_[d->title()];
+void SqliteBack::CreateCompactView(const std::string& compact) {
+  std::string view;
+  std::string select;
+  std::vector<std::pair<std::string, DbTypes> > cols;
+  cols.push_back(std::make_pair("SimId", UUID));
+  if (compact == "CompactResources") {
+    view = "Resources";
+    select =
+        "SELECT r.SimId AS SimId, r.ResourceId AS ResourceId, "
+        "r.ResourceId - r.ObjIdDelta AS ObjId, t.Type AS Type, "
+        "r.TimeCreated AS TimeCreated, r.Quantity AS Quantity, "
+        "t.Units AS Units, r.QualId AS QualId, "
+        "CASE r.Parent1Delta WHEN 0 THEN 0 "
+        "ELSE r.ResourceId - r.Parent1Delta END AS Parent1, "
+        "CASE r.Parent2Delta WHEN 0 THEN 0 "
+        "ELSE r.ResourceId - r.Parent2Delta END AS Parent2 "
+        "FROM CompactResources r JOIN ResourceTypes t "
+        "ON r.SimId = t.SimId AND r.TypeId = t.TypeId";
+    cols.push_back(std::make_pair("ResourceId", INT));
+    cols.push_back(std::make_pair("ObjId", INT));
+    cols.push_back(std::make_pair("Type", STRING));
+    cols.push_back(std::make_pair("TimeCreated", INT));
+    cols.push_back(std::make_pair("Quantity", DOUBLE));
+    cols.push_back(std::make_pair("Units", STRING));
+    cols.push_back(std::make_pair("QualId", INT));
+    cols.push_back(std::make_pair("Parent1", INT));
+    cols.push_back(std::make_pair("Parent2", INT));
+  } else if (compact == "CompactTransactions") {
+    view = "Transactions";
+    select =
+        "SELECT t.SimId AS SimId, t.TransactionId AS TransactionId, "
+        "t.SenderId AS SenderId, t.ReceiverId AS ReceiverId, "
+        "t.ResourceId AS ResourceId, c.Commodity AS Commodity, "
+        "t.Time AS Time "
+        "FROM CompactTransactions t JOIN Commodities c "
+        "ON t.SimId = c.SimId AND t.CommodityId = c.CommodityId";
+    cols.push_back(std::make_pair("TransactionId", INT));
+    cols.push_back(std::make_pair("SenderId", INT));
+    cols.push_back(std::make_pair("ReceiverId", INT));
+    cols.push_back(std::make_pair("ResourceId", INT));
+    cols.push_back(std::make_pair("Commodity", STRING));
+    cols.push_back(std::make_pair("Time", INT));
+  } else {
+    return;
+  }
 
-  for (int i = 0; i < vals.size(); ++i) {
-    boost::spirit::hold_any v = vals[i].second;
-    Bind(v, schema[i], stmt, i+1);
+  // sqlite resolves the lookup table when the view is read, and so it need
+  // not have been created yet
+  db_.Execute("CREATE VIEW IF NOT EXISTS " + view + " AS " + select + ";");
+  for (int i = 0; i < cols.size(); ++i) {
+    std::stringstream types;
+    types << "INSERT INTO FieldTypes VALUES ('" << view << "','"
+          << cols[i].first << "','" << cols[i].second << "');";
+    db_.Execute(types.str());
+  }
+}
+
+void SqliteBack::Close() {
+  if (!lineage_.empty()) {
+    lineage_.Write(this);
+  }
+  Flush();
+  std::set<std::string> tables;
+  std::set<std::string>::iterator it;
+  for (it = unindexed_.begin(); it != unindexed_.end(); ++it) {
+    if (Indexed(*it)) {
+      tables.insert(*it);
+    }
+  }
+  unindexed_.clear();
+  if (tables.empty()) {
+    return;
+  }
+  db_.Execute("BEGIN TRANSACTION;");
+  for (it = tables.begin(); it != tables.end(); ++it) {
+    CreateIndexes(*it);
+  }
+  db_.Execute("END TRANSACTION;");
+}
+
+std::set<std::string> SqliteBack::DefaultIndexTables() {
+  static const char* names[] = {
+      "AgentEntry", "AgentExit", "BuildSchedule", "Checkpoints",
+      "CompactResources", "CompactTransactions", "Compositions",
+      "DecomSchedule", "DenseCompositions", "DenseInventory", "ExplicitInventory", "ExplicitInventoryCompact",
+      "LineageIndex", "NextIds", "Products", "ResCreators", "Resources", "SnapshotAgents",
+      "Snapshots", "Transactions", "AgentState*"};
+  return std::set<std::string>(names, names + sizeof(names) / sizeof(*names));
+}
+
+void SqliteBack::CreateIndexes() {
+  Flush();
+  // unlike Tables, this leaves out views, which cannot be indexed
+  std::set<std::string> tables;
+  {
+    SqlStatement::Ptr stmt =
+        db_.Prepare("SELECT name FROM sqlite_master WHERE type='table';");
+    while (stmt->Step()) {
+      tables.insert(stmt->GetText(0, NULL));
+    }
+  }
+  db_.Execute("BEGIN TRANSACTION;");
+  std::set<std::string>::iterator it;
+  for (it = tables.begin(); it != tables.end(); ++it) {
+    if (Indexed(*it)) {
+      CreateIndexes(*it);
+    }
+  }
+  db_.Execute("END TRANSACTION;");
+  unindexed_.clear();
+}
+
+bool SqliteBack::Indexed(const std::string& table) const {
+  if (index_tables_.count(table) > 0) {
+    return true;
+  }
+  std::set<std::string>::const_iterator it;
+  for (it = index_tables_.begin(); it != index_tables_.end(); ++it) {
+    const std::string& s = *it;
+    if (!s.empty() && s[s.size() - 1] == '*' &&
+        table.compare(0, s.size() - 1, s, 0, s.size() - 1) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void SqliteBack::CreateIndexes(const std::string& table) {
+  static const char* keys[] = {"AgentId", "ResourceId", "ObjId", "QualId",
+                               "TransactionId", "Time", "SimTime", "Page"};
+  std::set<std::string> cols;
+  {
+    SqlStatement::Ptr stmt = db_.Prepare("PRAGMA table_info(" + table + ");");
+    while (stmt->Step()) {
+      cols.insert(stmt->GetText(1, NULL));
+    }
+  }
+  std::string simid = cols.count("SimId") > 0 ? "SimId, " : "";
+  for (int i = 0; i < sizeof(keys) / sizeof(*keys); ++i) {
+    if (cols.count(keys[i]) == 0) {
+      continue;
+    }
+    db_.Execute("CREATE INDEX IF NOT EXISTS " + table + "_" + keys[i] +
+                "_idx ON " + table + " (" + simid + keys[i] + ");");
+  }
+}
+
+void SqliteBack::WriteData(const std::string& tbl, Datum* const* rows,
+                           int nrows) {
+  SqlStatement::Ptr stmt = InsertStmt(tbl, nrows);
+  const std::vector<DbTypes>& schema = schemas_[tbl];
+  int ncols = schema.size();
+  for (int r = 0; r < nrows; ++r) {
+    const Datum::Vals& vals = rows[r]->vals();
+    if (vals.size() != ncols) {
+      throw ValueError("datum for table '" + tbl + "' has a different "
+                       "number of fields than the table");
+    }
+    for (int i = 0; i < vals.size(); ++i) {
+      Bind(vals[i].second, schema[i], stmt, r * ncols + i + 1);
+    }
   }
 
   stmt->Exec();
@@ -257,13 +929,17 @@ void SqliteBack::Bind(boost::spirit::hold_any v, DbTypes type, SqlStatement::Ptr
 #define CYCLUS_BINDVAL(D, T) \
     case D: { \
     T vect = v.cast<T>(); \
-    std::stringstream ss; \
-    { \
-      boost::archive::xml_oarchive ar(ss); \
-      ar & BOOST_SERIALIZATION_NVP(vect); \
+    std::string s; \
+    if (format_version_ >= kSqliteBinaryFormat) { \
+      EncodeBin(&s, vect); \
+    } else { \
+      std::stringstream ss; \
+      { \
+        boost::archive::xml_oarchive ar(ss); \
+        ar & BOOST_SERIALIZATION_NVP(vect); \
+      } \
+      s = ss.str(); \
     } \
-    v = vect; \
-    std::string s = ss.str(); \
     stmt->BindBlob(index, s.c_str(), s.size()); \
     break; \
     }
@@ -370,12 +1046,18 @@ boost::spirit::hold_any SqliteBack::ColAsVal(SqlStatement::Ptr stmt,
 #define CYCLUS_COMMA ,
 #define CYCLUS_LOADVAL(D, T) \
       case D: { \
-      char* data =  stmt->GetText(col, NULL); \
-      std::stringstream ss; \
-      ss << data; \
-      boost::archive::xml_iarchive ar(ss); \
+      int n; \
+      char* data =  stmt->GetText(col, &n); \
       T vect; \
-      ar & BOOST_SERIALIZATION_NVP(vect); \
+      if (format_version_ >= kSqliteBinaryFormat) { \
+        BinReader r(data, n); \
+        DecodeBin(&r, &vect); \
+      } else { \
+        std::stringstream ss; \
+        ss << data; \
+        boost::archive::xml_iarchive ar(ss); \
+        ar & BOOST_SERIALIZATION_NVP(vect); \
+      } \
       v = vect; \
       break; \
       }
@@ -3,13 +3,37 @@
 
 #include <string>
 #include <map>
+#include <mutex>
 #include <set>
+#include <thread>
 
+#include <boost/shared_ptr.hpp>
+
+#include "lineage_index.h"
 #include "query_backend.h"
 #include "sqlite_db.h"
 
 namespace cyclus {
 
+/// Encoding version of container (vector, set, list, map, pair) column values
+/// that stores them as boost::serialization xml archives.  Only databases
+/// created by older versions of cyclus use this format.
+static int const kSqliteXmlFormat = 0;
+
+/// Encoding version of container column values that stores them in a compact
+/// length-prefixed, little-endian binary form.  This is the default for all
+/// newly created databases.
+static int const kSqliteBinaryFormat = 1;
+
+/// Default largest number of rows inserted by a single INSERT statement.
+static int const kSqliteBatchRows = 128;
+
+/// Number of bytes of a database that read-only backends map into memory.
+static long long const kSqliteReadMmapSize = 1LL << 30;
+
+/// Size in KiB of the page cache of each read-only connection.
+static int const kSqliteReadCacheKiB = 256 * 1024;
+
 /// An Recorder backend that writes data to an sqlite database.  Identically
 /// named Datum objects have their data placed as rows in a single table.  Handles the
 /// following datum value types: int, float, double, std::string, cyclus::Blob.
@@ -18,14 +42,36 @@ class SqliteBack: public FullBackend {
  public:
   /// Creates a new sqlite backend that will write to the database file
   /// specified by path. If the file doesn't exist, a new one is created.
+  ///
+  /// A read-only backend instead opens an existing database for queries
+  /// only, with up to kSqliteReadMmapSize bytes of it mapped into memory and
+  /// a kSqliteReadCacheKiB page cache. Each thread that queries it does so
+  /// through a connection of its own, and so many threads may query it at
+  /// once, as long as none of them closes or deletes it.
+  ///
   /// @param path the filepath (including name) to write the sqlite file.
-  SqliteBack(std::string path);
+  /// @param readonly whether to open the database for queries only
+  /// @throw IOError if a read-only database does not exist
+  SqliteBack(std::string path, bool readonly = false);
 
   virtual ~SqliteBack();
 
+  using RecBackend::Notify;
+
   /// Writes Datum objects immediately to the database as a single transaction.
-  /// @param data group of Datum objects to write to the database together.
-  virtual void Notify(DatumList data);
+  /// Rows of each table are inserted up to batch_rows() at a time.
+  /// @param groups Datum objects to write to the database together.
+  /// @throw IOError if the backend is read-only
+  virtual void Notify(const DatumGroups& groups);
+
+  /// Sets the largest number of rows inserted by a single INSERT statement.
+  /// Values less than one are treated as one.  Tables with many columns may
+  /// use smaller batches so as to stay within sqlite's limit on the number of
+  /// bound parameters.
+  void set_batch_rows(int n);
+
+  /// Returns the largest number of rows inserted by a single statement.
+  int batch_rows() const { return batch_rows_; }
 
   /// Returns a unique name for this backend.
   std::string Name();
@@ -33,20 +79,104 @@ class SqliteBack: public FullBackend {
   /// Executes all pending commands.
   void Flush();
 
-  /// Closes the backend, if approriate.
-  void Close() {};
+  /// Writes the lineage index, if indexing lineage, and creates the indexes
+  /// of the tables this backend created that are to be indexed (see
+  /// index_tables) and have not been yet. Databases only read from are left
+  /// as they are.
+  void Close();
+
+  /// Returns the tables indexed by default: the core tables that restarts
+  /// and analyses query by agent, resource, and time, and all agent state
+  /// tables.
+  static std::set<std::string> DefaultIndexTables();
+
+  /// Sets the tables whose key columns are indexed, each with SimId in an
+  /// index of its own. The key columns are AgentId, ResourceId, ObjId,
+  /// QualId, TransactionId, Time, SimTime, and Page. A name ending in '*' stands
+  /// for all tables starting with the rest of it, and an empty set indexes
+  /// nothing. The default is DefaultIndexTables().
+  void index_tables(const std::set<std::string>& tables) {
+    index_tables_ = tables;
+  }
+
+  /// Returns the tables whose key columns are indexed.
+  const std::set<std::string>& index_tables() const { return index_tables_; }
+
+  /// Sets whether the lineage of the resources written is indexed, as the
+  /// LineageIndex table written when the backend is closed (see
+  /// LineageIndexer), so that Ancestors and Descendants read only the pages
+  /// of the resources they reach. The default is false.
+  void index_lineage(bool b) { index_lineage_ = b; }
+
+  /// Returns whether the lineage of the resources written is indexed.
+  bool index_lineage() const { return index_lineage_; }
+
+  /// Sets whether tables are indexed as soon as they are created, rather than
+  /// when the backend is closed, the default, which keeps writing rows fast.
+  void index_on_create(bool b) { index_on_create_ = b; }
+
+  /// Creates the missing indexes of every table in the database that is to
+  /// be indexed, including those written earlier by other backends.
+  void CreateIndexes();
 
   virtual QueryResult Query(std::string table, std::vector<Cond>* conds);
 
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds,
+                            std::vector<std::string>* fields);
+
+  /// Returns a cursor that steps through the matching rows as they are
+  /// requested instead of reading them all at once.
+  virtual QueryCursor::Ptr Cursor(std::string table, std::vector<Cond>* conds,
+                                  std::vector<std::string>* fields);
+
+  /// Aggregates the rows in sqlite, which only returns the aggregates.
+  virtual QueryResult Aggregate(std::string table, std::vector<Cond>* conds,
+                                std::vector<std::string>* group_by,
+                                const std::vector<Agg>& aggs);
+
   virtual std::map<std::string, DbTypes> ColumnTypes(std::string table);
 
+  /// Returns the names of the tables and of the views standing in for the
+  /// classic tables of compact output (see CreateCompactView).
   virtual std::set<std::string> Tables();
 
   /// Returns the underlying sqlite database. Only use this if you really know
   /// what you are doing.
   SqliteDb& db();
 
+  /// Returns whether the backend only queries its database.
+  bool readonly() const { return readonly_; }
+
+  /// Returns the encoding version (e.g. kSqliteBinaryFormat) used for
+  /// container column values in this database.  The version is stored in the
+  /// database's user_version pragma and is fixed when the database is created.
+  int format_version();
+
  private:
+  class SqliteCursor;
+
+  /// Returns the connection through which the calling thread queries the
+  /// database, which is db_ unless the backend is read-only and the thread
+  /// is not the one that created it.
+  SqliteDb& conn();
+
+  /// Sets the pragmas of a read-only connection.
+  static void ConfigureReader(SqliteDb* db);
+
+  /// Prepares and binds the SELECT statement for a query, and fills info
+  /// with the fields and types of the columns it returns.
+  SqlStatement::Ptr PrepareQuery(std::string table, std::vector<Cond>* conds,
+                                 std::vector<std::string>* fields,
+                                 QueryResult* info);
+
+  /// Returns the WHERE clause of the conditions, which is empty if conds is
+  /// NULL or empty.
+  std::string Where(std::vector<Cond>* conds);
+
+  /// Binds the values of the conditions to the parameters of a statement
+  /// with the clause returned by Where.
+  void BindConds(std::vector<Cond>* conds, SqlStatement::Ptr stmt);
+
   void Bind(boost::spirit::hold_any v, DbTypes type, SqlStatement::Ptr stmt, int index);
 
   QueryResult GetTableInfo(std::string table);
@@ -63,13 +193,40 @@ class SqliteBack: public FullBackend {
   /// supported sqlite datatype type in a hold_any object.
   boost::spirit::hold_any ColAsVal(SqlStatement::Ptr stmt, int col, DbTypes type);
 
+  /// converts the current row of stmt into a query row.
+  QueryRow ReadRow(SqlStatement::Ptr stmt, const std::vector<DbTypes>& types);
+
   /// Queue up a table-create command for d.
   void CreateTable(Datum* d);
 
+  /// Records the column types of d's table and prepares its INSERT
+  /// statements.
   void BuildStmt(Datum* d);
 
-  /// constructs an SQL INSERT command for d and queues it for db insertion.
-  void WriteDatum(Datum* d);
+  /// Returns a prepared INSERT statement for nrows rows of the table.
+  SqlStatement::Ptr InsertStmt(const std::string& tbl, int nrows);
+
+  /// Inserts nrows rows, which all belong to table tbl, with a single INSERT
+  /// statement.
+  void WriteData(const std::string& tbl, Datum* const* rows, int nrows);
+
+  /// Returns whether the key columns of table are to be indexed.
+  bool Indexed(const std::string& table) const;
+
+  /// Creates the missing indexes on the key columns of table.
+  void CreateIndexes(const std::string& table);
+
+  /// Creates the view that rebuilds the classic Resources or Transactions
+  /// table from the compact table of that name (see SimInfo::compact_output)
+  /// and its lookup table, if compact is one of those, and records the view's
+  /// field types so that it is queried like any table.
+  void CreateCompactView(const std::string& compact);
+
+  /// Returns whether table is the classic Compositions or ExplicitInventory
+  /// table of a database recorded with dense output, which is not stored but
+  /// rebuilt from its dense table by a CompactExpander when queried, since
+  /// sqlite cannot unpack the arrays of the dense table in a view.
+  bool Expanded(const std::string& table);
 
   /// An interface to a sqlite db managed by the SqliteBack class.
   SqliteDb db_;
@@ -80,8 +237,39 @@ class SqliteBack: public FullBackend {
   /// table names already existing (created) in the sqlite db.
   std::set<std::string> tbl_names_;
 
-  std::map<std::string, SqlStatement::Ptr> stmts_;
+  /// INSERT statements for each table, by number of rows.
+  std::map<std::string, std::map<int, SqlStatement::Ptr> > stmts_;
   std::map<std::string, std::vector<DbTypes> > schemas_;
+
+  /// the number of rows each table is inserted in batches of.
+  std::map<std::string, int> batch_sizes_;
+  int batch_rows_;
+
+  /// encoding version for container column values.
+  int format_version_;
+
+  std::set<std::string> index_tables_;
+  bool index_on_create_;
+
+  /// tables created by this backend and not indexed on creation.
+  std::set<std::string> unindexed_;
+
+  bool index_lineage_;
+  LineageIndexer lineage_;
+
+  /// the connections of threads other than owner_ to a read-only database,
+  /// shared by copies of the backend so that it stays copyable. They are
+  /// closed when the last copy is destroyed.
+  struct ReaderPool {
+    ~ReaderPool();
+
+    std::map<std::thread::id, boost::shared_ptr<SqliteDb> > conns;
+    std::mutex mu;
+  };
+
+  bool readonly_;
+  std::thread::id owner_;
+  boost::shared_ptr<ReaderPool> readers_;
 };
 
 }  // namespace cyclus
@@ -84,8 +84,8 @@ SqliteDb::SqliteDb(std::string path, bool readonly)
     : db_(NULL),
       isOpen_(false),
       path_(path),
-      readonly_(readonly),
-      overwrite_(false) {}
+      overwrite_(false),
+      readonly_(readonly) {}
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 SqliteDb::~SqliteDb() {}
@@ -118,8 +118,15 @@ void SqliteDb::open() {
     }
   }
 
-  if (readonly_ && sqlite3_open_v2(path_.c_str(), &db_, SQLITE_OPEN_READONLY,
-                                   NULL) == SQLITE_OK) {
+  // read-only connections are never shared between threads, and so need no
+  // locking of their own
+  if (readonly_) {
+    if (sqlite3_open_v2(path_.c_str(), &db_,
+                        SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX,
+                        NULL) != SQLITE_OK) {
+      sqlite3_close(db_);
+      throw IOError("Unable to open database " + path_ + " for reading");
+    }
     isOpen_ = true;
   } else if (sqlite3_open(path_.c_str(), &db_) == SQLITE_OK) {
     isOpen_ = true;
@@ -79,7 +79,8 @@ class SqliteDb {
   /// Creates a new Sqlite database to be stored at the specified path.
   ///
   /// @param path the path+name for the sqlite database file
-  /// @param readonly a boolean indicating true if db is readonly
+  /// @param readonly a boolean indicating true if db is readonly, in which
+  /// case the connection must only be used by one thread at a time
   SqliteDb(std::string path, bool readonly = false);
 
   virtual ~SqliteDb();
@@ -91,7 +92,8 @@ class SqliteDb {
   /// Opens the sqlite database by either opening/creating a file (default) or
   /// creating/overwriting a file (see the overwrite method).
   ///
-  /// @throw IOError if failed to open existing database
+  /// @throw IOError if failed to open existing database, or a read-only one
+  /// that does not exist
   void open();
 
   /// Instead of opening a file of the specified name (if it already exists),
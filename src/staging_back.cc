@@ -0,0 +1,144 @@
+#include "staging_back.h"
+
+#include <typeinfo>
+
+#include <boost/uuid/uuid.hpp>
+
+#include "error.h"
+
+namespace cyclus {
+
+namespace {
+
+DbTypes TypeOf(const boost::spirit::hold_any& v) {
+  const std::type_info& t = v.type();
+  if (t == typeid(int)) {
+    return INT;
+  } else if (t == typeid(double)) {
+    return DOUBLE;
+  } else if (t == typeid(float)) {
+    return FLOAT;
+  } else if (t == typeid(bool)) {
+    return BOOL;
+  } else if (t == typeid(std::string)) {
+    return STRING;
+  } else if (t == typeid(boost::uuids::uuid)) {
+    return UUID;
+  }
+  return BLOB;
+}
+
+template <typename T>
+bool Cmp(const boost::spirit::hold_any& v, Cond* c) {
+  T x = v.cast<T>();
+  return CmpCond<T>(&x, c);
+}
+
+bool Matches(const boost::spirit::hold_any& v, Cond* c) {
+  switch (TypeOf(v)) {
+    case INT:
+      return Cmp<int>(v, c);
+    case DOUBLE:
+      return Cmp<double>(v, c);
+    case FLOAT:
+      return Cmp<float>(v, c);
+    case BOOL:
+      return Cmp<bool>(v, c);
+    case STRING:
+      return Cmp<std::string>(v, c);
+    case UUID:
+      return Cmp<boost::uuids::uuid>(v, c);
+    default:
+      throw ValueError("cannot compare staged values of field '" + c->field +
+                       "'");
+  }
+}
+
+}  // namespace
+
+Datum* StagingBack::First(const std::string& table) {
+  for (int i = 0; i < staged_->size(); ++i) {
+    if ((*staged_)[i]->title() == table)
+      return (*staged_)[i];
+  }
+  return NULL;
+}
+
+QueryResult StagingBack::Query(std::string table, std::vector<Cond>* conds) {
+  QueryResult qr;
+  Datum* first = First(table);
+  if (first == NULL)
+    return qr;
+
+  const Datum::Vals& vals = first->vals();
+  std::map<std::string, int> index;
+  for (int i = 0; i < vals.size(); ++i) {
+    qr.fields.push_back(vals[i].first);
+    qr.types.push_back(TypeOf(vals[i].second));
+    index[vals[i].first] = i;
+  }
+
+  // resolve each condition to a column once rather than once per row
+  std::vector<std::pair<int, Cond*> > cols;
+  if (conds != NULL) {
+    for (int i = 0; i < conds->size(); ++i) {
+      Cond* c = &(*conds)[i];
+      std::map<std::string, int>::iterator it = index.find(c->field);
+      if (it == index.end()) {
+        throw KeyError("staged table '" + table + "' has no field '" +
+                       c->field + "'");
+      }
+      cols.push_back(std::make_pair(it->second, c));
+    }
+  }
+
+  for (int i = 0; i < staged_->size(); ++i) {
+    Datum* d = (*staged_)[i];
+    if (d->title() != table)
+      continue;
+    const Datum::Vals& row = d->vals();
+    bool keep = true;
+    for (int j = 0; j < cols.size() && keep; ++j)
+      keep = Matches(row[cols[j].first].second, cols[j].second);
+    if (!keep)
+      continue;
+    qr.rows.push_back(QueryRow());
+    for (int j = 0; j < row.size(); ++j)
+      qr.rows.back().push_back(row[j].second);
+  }
+  return qr;
+}
+
+std::map<std::string, DbTypes> StagingBack::ColumnTypes(std::string table) {
+  std::map<std::string, DbTypes> rtn;
+  Datum* d = First(table);
+  if (d == NULL)
+    return rtn;
+  const Datum::Vals& vals = d->vals();
+  for (int i = 0; i < vals.size(); ++i)
+    rtn[vals[i].first] = TypeOf(vals[i].second);
+  return rtn;
+}
+
+std::list<ColumnInfo> StagingBack::Schema(std::string table) {
+  std::list<ColumnInfo> rtn;
+  Datum* d = First(table);
+  if (d == NULL)
+    return rtn;
+  const Datum::Vals& vals = d->vals();
+  const Datum::Shapes& shapes = d->shapes();
+  for (int i = 0; i < vals.size(); ++i) {
+    rtn.push_back(ColumnInfo(table, vals[i].first, i, TypeOf(vals[i].second),
+                             shapes[i]));
+  }
+  return rtn;
+}
+
+std::set<std::string> StagingBack::Tables() {
+  std::set<std::string> rtn;
+  for (int i = 0; i < staged_->size(); ++i)
+    rtn.insert((*staged_)[i]->title());
+  return rtn;
+}
+
+}  // namespace cyclus
@@ -0,0 +1,52 @@
+#ifndef CYCLUS_SRC_STAGING_BACK_H_
+#define CYCLUS_SRC_STAGING_BACK_H_
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "query_backend.h"
+#include "recorder.h"
+
+namespace cyclus {
+
+/// A queryable view of Datum objects that have been staged with
+/// Recorder::StartStaging but not yet committed. It lets state that was just
+/// recorded be read back in memory, without first flushing it to and then
+/// querying it from an output database. The datums are neither copied nor
+/// owned and must outlive the backend.
+///
+/// Conditions are supported on int, float, double, bool, string, and uuid
+/// fields.
+class StagingBack : public QueryableBackend {
+ public:
+  /// @param staged the datums to query; later additions to the list are seen
+  /// by later queries.
+  explicit StagingBack(const DatumList* staged) : staged_(staged) {}
+
+  virtual ~StagingBack() {}
+
+  using QueryableBackend::Query;
+
+  /// @throws KeyError if a condition refers to a field the table lacks
+  /// @throws ValueError if a condition is on a field of an unsupported type
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds);
+
+  virtual std::map<std::string, DbTypes> ColumnTypes(std::string table);
+
+  virtual std::list<ColumnInfo> Schema(std::string table);
+
+  virtual std::set<std::string> Tables();
+
+ private:
+  /// Returns the first staged datum of the table, or NULL if there are none.
+  Datum* First(const std::string& table);
+
+  const DatumList* staged_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_STAGING_BACK_H_
@@ -0,0 +1,297 @@
+#include "state_image.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <set>
+#include <vector>
+
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#include "blob.h"
+#include "error.h"
+
+namespace cyclus {
+
+namespace {
+
+const char kMagic[] = "CYCIMG02";
+const std::size_t kMagicLen = 8;
+
+// magic, time, number of agents
+const std::size_t kHeaderLen = kMagicLen + 4 + 4;
+
+// agent id, offset and size of the datums, offset and size of the binary
+// state
+const std::size_t kEntryLen = 4 + 8 + 8 + 8 + 8;
+
+// Writes the type and value of v if v holds a T, and returns whether it did.
+template <class T>
+bool PutAs(const boost::spirit::hold_any& v, DbTypes type, BinaryWriter* buf) {
+  if (v.type() != BOOST_SP_TYPEID(T)) {
+    return false;
+  }
+  buf->PutRaw<boost::int32_t>(type);
+  buf->Put(v.cast<T>());
+  return true;
+}
+
+bool PutAny(const boost::spirit::hold_any& v, BinaryWriter* buf) {
+  using std::list;
+  using std::map;
+  using std::set;
+  using std::string;
+  using std::vector;
+  return PutAs<int>(v, INT, buf) || PutAs<bool>(v, BOOL, buf) ||
+         PutAs<double>(v, DOUBLE, buf) || PutAs<float>(v, FLOAT, buf) ||
+         PutAs<string>(v, STRING, buf) ||
+         PutAs<boost::uuids::uuid>(v, UUID, buf) ||
+         PutAs<Blob>(v, BLOB, buf) ||
+         PutAs<vector<int> >(v, VECTOR_INT, buf) ||
+         PutAs<vector<double> >(v, VECTOR_DOUBLE, buf) ||
+         PutAs<vector<string> >(v, VECTOR_STRING, buf) ||
+         PutAs<set<int> >(v, SET_INT, buf) ||
+         PutAs<set<string> >(v, SET_STRING, buf) ||
+         PutAs<list<int> >(v, LIST_INT, buf) ||
+         PutAs<list<string> >(v, LIST_STRING, buf) ||
+         PutAs<map<int, int> >(v, MAP_INT_INT, buf) ||
+         PutAs<map<int, double> >(v, MAP_INT_DOUBLE, buf) ||
+         PutAs<map<int, string> >(v, MAP_INT_STRING, buf) ||
+         PutAs<map<string, int> >(v, MAP_STRING_INT, buf) ||
+         PutAs<map<string, double> >(v, MAP_STRING_DOUBLE, buf) ||
+         PutAs<map<string, string> >(v, MAP_STRING_STRING, buf);
+}
+
+template <class T>
+boost::spirit::hold_any Get(BinaryReader* c) {
+  T v;
+  c->Get(&v);
+  return boost::spirit::hold_any(v);
+}
+
+boost::spirit::hold_any GetAny(BinaryReader* c, DbTypes type) {
+  using std::list;
+  using std::map;
+  using std::set;
+  using std::string;
+  using std::vector;
+  switch (type) {
+    case INT:
+      return Get<int>(c);
+    case BOOL:
+      return Get<bool>(c);
+    case DOUBLE:
+      return Get<double>(c);
+    case FLOAT:
+      return Get<float>(c);
+    case STRING:
+      return Get<string>(c);
+    case UUID:
+      return Get<boost::uuids::uuid>(c);
+    case BLOB:
+      return Get<Blob>(c);
+    case VECTOR_INT:
+      return Get<vector<int> >(c);
+    case VECTOR_DOUBLE:
+      return Get<vector<double> >(c);
+    case VECTOR_STRING:
+      return Get<vector<string> >(c);
+    case SET_INT:
+      return Get<set<int> >(c);
+    case SET_STRING:
+      return Get<set<string> >(c);
+    case LIST_INT:
+      return Get<list<int> >(c);
+    case LIST_STRING:
+      return Get<list<string> >(c);
+    case MAP_INT_INT:
+      return Get<map<int, int> >(c);
+    case MAP_INT_DOUBLE:
+      return Get<map<int, double> >(c);
+    case MAP_INT_STRING:
+      return Get<map<int, string> >(c);
+    case MAP_STRING_INT:
+      return Get<map<string, int> >(c);
+    case MAP_STRING_DOUBLE:
+      return Get<map<string, double> >(c);
+    case MAP_STRING_STRING:
+      return Get<map<string, string> >(c);
+    default:
+      throw IOError("state image holds a value of unknown type");
+  }
+}
+
+}  // namespace
+
+StateImageWriter::StateImageWriter(int time) : time_(time) {}
+
+bool StateImageWriter::Add(int agent_id, const DatumList& state,
+                           const std::string& binary) {
+  // record layout: number of datums, then for each datum its title, the size
+  // of its body, and a body of (field, type, value) triples
+  std::string rec;
+  BinaryWriter w(&rec);
+  w.PutRaw<boost::uint32_t>(state.size());
+  for (int i = 0; i < state.size(); ++i) {
+    Datum* d = state[i];
+    const Datum::Vals& vals = d->vals();
+    std::string body;
+    BinaryWriter b(&body);
+    b.PutRaw<boost::uint32_t>(vals.size());
+    for (int j = 0; j < vals.size(); ++j) {
+      b.Put(std::string(vals[j].first));
+      if (!PutAny(vals[j].second, &b)) {
+        return false;
+      }
+    }
+    w.Put(d->title());
+    w.PutRaw<boost::uint64_t>(body.size());
+    rec.append(body);
+  }
+
+  StateImageRecord r = {data_.size(), rec.size(), data_.size() + rec.size(),
+                        binary.size()};
+  records_[agent_id] = r;
+  data_.append(rec);
+  data_.append(binary);
+  return true;
+}
+
+void StateImageWriter::Write(const std::string& path) {
+  std::string head(kMagic, kMagicLen);
+  BinaryWriter w(&head);
+  w.PutRaw<boost::int32_t>(time_);
+  w.PutRaw<boost::uint32_t>(records_.size());
+  boost::uint64_t start = kHeaderLen + kEntryLen * records_.size();
+  std::map<int, StateImageRecord>::iterator it;
+  for (it = records_.begin(); it != records_.end(); ++it) {
+    w.PutRaw<boost::int32_t>(it->first);
+    w.PutRaw<boost::uint64_t>(start + it->second.offset);
+    w.PutRaw<boost::uint64_t>(it->second.size);
+    w.PutRaw<boost::uint64_t>(start + it->second.binary_offset);
+    w.PutRaw<boost::uint64_t>(it->second.binary_size);
+  }
+
+  // written aside and moved into place so that a restart never maps a
+  // partially written image
+  std::string tmp = path + ".tmp";
+  {
+    std::ofstream f(tmp.c_str(), std::ios::binary | std::ios::trunc);
+    f.write(head.data(), head.size());
+    f.write(data_.data(), data_.size());
+    if (!f) {
+      std::remove(tmp.c_str());
+      throw IOError("could not write state image " + path);
+    }
+  }
+  std::remove(path.c_str());
+  if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    throw IOError("could not write state image " + path);
+  }
+}
+
+StateImage::StateImage(const std::string& path) {
+  using boost::interprocess::read_only;
+  try {
+    file_ = boost::interprocess::file_mapping(path.c_str(), read_only);
+    region_ = boost::interprocess::mapped_region(file_, read_only);
+  } catch (boost::interprocess::interprocess_exception& err) {
+    throw IOError("could not map state image " + path + ": " + err.what());
+  }
+
+  const char* begin = static_cast<const char*>(region_.get_address());
+  std::size_t size = region_.get_size();
+  if (size < kHeaderLen || std::memcmp(begin, kMagic, kMagicLen) != 0) {
+    throw IOError(path + " is not a cyclus state image");
+  }
+
+  try {
+    BinaryReader c(begin + kMagicLen, begin + size);
+    time_ = c.GetRaw<boost::int32_t>();
+    boost::uint32_t n = c.GetRaw<boost::uint32_t>();
+    for (boost::uint32_t i = 0; i < n; ++i) {
+      int id = c.GetRaw<boost::int32_t>();
+      StateImageRecord r;
+      r.offset = c.GetRaw<boost::uint64_t>();
+      r.size = c.GetRaw<boost::uint64_t>();
+      r.binary_offset = c.GetRaw<boost::uint64_t>();
+      r.binary_size = c.GetRaw<boost::uint64_t>();
+      if (r.offset > size || r.size > size - r.offset ||
+          r.binary_offset > size || r.binary_size > size - r.binary_offset) {
+        throw IOError("record out of bounds");
+      }
+      records_[id] = r;
+    }
+  } catch (const IOError& err) {
+    throw IOError("invalid state image " + path + ": " + err.what());
+  }
+}
+
+bool StateImage::Rows(int agent_id, const std::string& table,
+                      QueryResult* qr) const {
+  std::map<int, StateImageRecord>::const_iterator it =
+      records_.find(agent_id);
+  if (it == records_.end()) {
+    return false;
+  }
+
+  qr->fields.clear();
+  qr->types.clear();
+  qr->rows.clear();
+  const char* rec =
+      static_cast<const char*>(region_.get_address()) + it->second.offset;
+  BinaryReader c(rec, rec + it->second.size);
+  boost::uint32_t ndatums = c.GetRaw<boost::uint32_t>();
+  bool found = false;
+  for (boost::uint32_t i = 0; i < ndatums; ++i) {
+    std::string title;
+    c.Get(&title);
+    boost::uint64_t len = c.GetRaw<boost::uint64_t>();
+    const char* body = c.Skip(len);
+    if (title != table) {
+      continue;
+    }
+
+    found = true;
+    BinaryReader b(body, body + len);
+    boost::uint32_t nvals = b.GetRaw<boost::uint32_t>();
+    bool first = qr->rows.empty();
+    qr->rows.push_back(QueryRow());
+    for (boost::uint32_t j = 0; j < nvals; ++j) {
+      std::string field;
+      b.Get(&field);
+      DbTypes type = static_cast<DbTypes>(b.GetRaw<boost::int32_t>());
+      qr->rows.back().push_back(GetAny(&b, type));
+      if (first) {
+        qr->fields.push_back(field);
+        qr->types.push_back(type);
+      }
+    }
+  }
+  return found || it->second.binary_size == 0;
+}
+
+bool StateImage::Binary(int agent_id, const char** begin,
+                        const char** end) const {
+  std::map<int, StateImageRecord>::const_iterator it =
+      records_.find(agent_id);
+  if (it == records_.end() || it->second.binary_size == 0) {
+    return false;
+  }
+  *begin = static_cast<const char*>(region_.get_address()) +
+           it->second.binary_offset;
+  *end = *begin + it->second.binary_size;
+  return true;
+}
+
+std::string StateImage::Path(const std::string& dir, boost::uuids::uuid simid,
+                             int t) {
+  return dir + "/" + boost::uuids::to_string(simid) + "-" +
+         boost::lexical_cast<std::string>(t) + ".cycimg";
+}
+
+}  // namespace cyclus
@@ -0,0 +1,107 @@
+#ifndef CYCLUS_SRC_STATE_IMAGE_H_
+#define CYCLUS_SRC_STATE_IMAGE_H_
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include <boost/cstdint.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/uuid/uuid.hpp>
+
+#include "binary_state.h"
+#include "query_backend.h"
+#include "recorder.h"
+
+namespace cyclus {
+
+/// Where the datums and the binary state of an agent are in a state image.
+struct StateImageRecord {
+  boost::uint64_t offset;
+  boost::uint64_t size;
+  boost::uint64_t binary_offset;
+  boost::uint64_t binary_size;
+};
+
+/// Lays out the state recorded for each agent at a snapshot in a single
+/// binary file, so that a restart can read it back without querying and
+/// decoding the state tables of the output database. The file starts with a
+/// header table giving the offset of each agent's record, and each record
+/// holds the agent's state datums contiguously. Values are stored in the
+/// byte order of the machine that wrote the image.
+///
+/// Only int, bool, float, double, string, uuid, and Blob values and vectors,
+/// sets, lists, and maps of the common int, double, and string combinations
+/// are supported. Agents with state of any other type are left out of the
+/// image and are restored from the database as usual.
+///
+/// A record may also hold the agent's state as written by its
+/// Agent::SnapshotBinary, which then takes the place of the datums of the
+/// archetype's own state and has no restriction on types.
+class StateImageWriter {
+ public:
+  /// @param time the time of the snapshot the image is taken at
+  explicit StateImageWriter(int time);
+
+  /// Adds the datums recorded for the agent's state to the image, along with
+  /// its binary state, if not empty. Returns false, leaving the agent out of
+  /// the image, if a value is of an unsupported type.
+  bool Add(int agent_id, const DatumList& state,
+           const std::string& binary = "");
+
+  /// Writes the image to the file at path, replacing any existing one.
+  /// @throws IOError if the file cannot be written
+  void Write(const std::string& path);
+
+  /// The number of agents in the image.
+  inline int size() const { return records_.size(); }
+
+ private:
+  int time_;
+  std::string data_;
+
+  /// the datums and the binary state of each agent in data_
+  std::map<int, StateImageRecord> records_;
+};
+
+/// A state image written by StateImageWriter and mapped into memory.
+class StateImage {
+ public:
+  /// @throws IOError if the file cannot be mapped or is not a state image
+  explicit StateImage(const std::string& path);
+
+  /// The time of the snapshot the image was taken at.
+  inline int time() const { return time_; }
+
+  /// Returns whether the image holds the state of the agent.
+  inline bool Has(int agent_id) const {
+    return records_.count(agent_id) > 0;
+  }
+
+  /// Sets qr to the rows of table recorded for the agent's state, as they
+  /// would be read from the output database. Returns false if the image does
+  /// not hold the agent's state, or if it holds the agent's binary state and
+  /// not table, whose rows are then to be read from the database.
+  /// @throws IOError if the agent's record is corrupt
+  bool Rows(int agent_id, const std::string& table, QueryResult* qr) const;
+
+  /// Points *begin and *end at the binary state of the agent. Returns false
+  /// if the image holds none.
+  bool Binary(int agent_id, const char** begin, const char** end) const;
+
+  /// The path of the image of the snapshot at time t of simulation simid in
+  /// the directory dir.
+  static std::string Path(const std::string& dir, boost::uuids::uuid simid,
+                          int t);
+
+ private:
+  boost::interprocess::file_mapping file_;
+  boost::interprocess::mapped_region region_;
+  int time_;
+  std::map<int, StateImageRecord> records_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_STATE_IMAGE_H_
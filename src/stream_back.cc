@@ -0,0 +1,409 @@
+#include "stream_back.h"
+
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <vector>
+#if !_WIN32
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <boost/uuid/uuid.hpp>
+
+#include "blob.h"
+#include "datum.h"
+#include "error.h"
+#include "logger.h"
+#include "query_backend.h"
+
+namespace cyclus {
+
+namespace {
+
+// the stream header: a magic string and the version of the format
+const char kHeader[] = "CYCSTRM\x01";
+const size_t kHeaderSize = sizeof(kHeader) - 1;
+
+#if defined(MSG_NOSIGNAL)
+// closed connections mustn't kill the process with SIGPIPE
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0;
+#endif
+
+void PutU32(std::string* s, uint32_t x) {
+  for (int i = 0; i < 4; ++i) {
+    s->push_back(static_cast<char>((x >> (8 * i)) & 0xff));
+  }
+}
+
+void PutU64(std::string* s, uint64_t x) {
+  for (int i = 0; i < 8; ++i) {
+    s->push_back(static_cast<char>((x >> (8 * i)) & 0xff));
+  }
+}
+
+void PutStr(std::string* s, const std::string& x) {
+  PutU32(s, x.size());
+  s->append(x);
+}
+
+void PutFloat(std::string* s, float x) {
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  PutU32(s, bits);
+}
+
+void PutDouble(std::string* s, double x) {
+  uint64_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  PutU64(s, bits);
+}
+
+// returns the type of a value if it can be streamed, or -1
+int StreamType(const boost::spirit::hold_any& v) {
+  const std::type_info& t = v.type();
+  if (t == typeid(bool)) {
+    return BOOL;
+  } else if (t == typeid(int)) {
+    return INT;
+  } else if (t == typeid(float)) {
+    return FLOAT;
+  } else if (t == typeid(double)) {
+    return DOUBLE;
+  } else if (t == typeid(std::string)) {
+    return STRING;
+  } else if (t == typeid(Blob)) {
+    return BLOB;
+  } else if (t == typeid(boost::uuids::uuid)) {
+    return UUID;
+  } else if (t == typeid(std::vector<int>)) {
+    return VECTOR_INT;
+  } else if (t == typeid(std::vector<double>)) {
+    return VECTOR_DOUBLE;
+  } else if (t == typeid(std::vector<std::string>)) {
+    return VECTOR_STRING;
+  } else if (t == typeid(std::map<int, double>)) {
+    return MAP_INT_DOUBLE;
+  }
+  return -1;
+}
+
+void PutVal(std::string* s, int type, const boost::spirit::hold_any& v) {
+  switch (type) {
+    case BOOL:
+      s->push_back(v.cast<bool>() ? 1 : 0);
+      break;
+    case INT:
+      PutU32(s, static_cast<uint32_t>(v.cast<int>()));
+      break;
+    case FLOAT:
+      PutFloat(s, v.cast<float>());
+      break;
+    case DOUBLE:
+      PutDouble(s, v.cast<double>());
+      break;
+    case STRING:
+      PutStr(s, v.cast<std::string>());
+      break;
+    case BLOB:
+      PutStr(s, v.cast<Blob>().str());
+      break;
+    case UUID: {
+      const boost::uuids::uuid& u = v.cast<boost::uuids::uuid>();
+      s->append(reinterpret_cast<const char*>(u.data), u.size());
+      break;
+    }
+    case VECTOR_INT: {
+      const std::vector<int>& x = v.cast<std::vector<int> >();
+      PutU32(s, x.size());
+      for (int i = 0; i < x.size(); ++i) {
+        PutU32(s, static_cast<uint32_t>(x[i]));
+      }
+      break;
+    }
+    case VECTOR_DOUBLE: {
+      const std::vector<double>& x = v.cast<std::vector<double> >();
+      PutU32(s, x.size());
+      for (int i = 0; i < x.size(); ++i) {
+        PutDouble(s, x[i]);
+      }
+      break;
+    }
+    case VECTOR_STRING: {
+      const std::vector<std::string>& x =
+          v.cast<std::vector<std::string> >();
+      PutU32(s, x.size());
+      for (int i = 0; i < x.size(); ++i) {
+        PutStr(s, x[i]);
+      }
+      break;
+    }
+    case MAP_INT_DOUBLE: {
+      const std::map<int, double>& x = v.cast<std::map<int, double> >();
+      PutU32(s, x.size());
+      std::map<int, double>::const_iterator it;
+      for (it = x.begin(); it != x.end(); ++it) {
+        PutU32(s, static_cast<uint32_t>(it->first));
+        PutDouble(s, it->second);
+      }
+      break;
+    }
+  }
+}
+
+}  // namespace
+
+StreamBack::StreamBack(const std::string& host, int port,
+                       size_t buffer_bytes)
+    : host_(host),
+      port_(port),
+      fd_(-1),
+      limit_(buffer_bytes),
+      overflow_(STREAM_BLOCK),
+      queued_(0),
+      sending_(false),
+      stop_(false),
+      broken_(false),
+      sent_(0),
+      dropped_(0) {
+#if _WIN32
+  throw IOError("the stream backend needs POSIX sockets");
+#else
+  std::stringstream ss;
+  ss << port;
+  struct addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* addrs = NULL;
+  int rc = getaddrinfo(host.c_str(), ss.str().c_str(), &hints, &addrs);
+  if (rc != 0) {
+    throw IOError("could not resolve " + Name() + ": " + gai_strerror(rc));
+  }
+  std::string err;
+  for (struct addrinfo* a = addrs; a != NULL && fd_ < 0; a = a->ai_next) {
+    fd_ = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd_ < 0) {
+      err = std::strerror(errno);
+      continue;
+    }
+    if (connect(fd_, a->ai_addr, a->ai_addrlen) != 0) {
+      err = std::strerror(errno);
+      close(fd_);
+      fd_ = -1;
+    }
+  }
+  freeaddrinfo(addrs);
+  if (fd_ < 0) {
+    throw IOError("could not connect to " + Name() + ": " + err);
+  }
+  if (!Write(std::string(kHeader, kHeaderSize))) {
+    err = std::strerror(errno);
+    close(fd_);
+    fd_ = -1;
+    throw IOError("could not stream to " + Name() + ": " + err);
+  }
+  sent_ = kHeaderSize;
+  thread_ = std::thread(&StreamBack::Send, this);
+  CLOG(LEV_INFO1) << "Streaming output to " << Name();
+#endif
+}
+
+StreamBack::~StreamBack() {
+  Close();
+}
+
+void StreamBack::Notify(const DatumGroups& groups) {
+  for (DatumGroups::const_iterator g = groups.begin(); g != groups.end();
+       ++g) {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      if (stop_ || broken_) {
+        dropped_++;
+        continue;
+      }
+    }
+
+    std::set<std::string> skipped;
+    std::string frame = Encode(*g, &skipped);
+    if (!skipped.empty() && warned_.insert(g->title()).second) {
+      std::stringstream ss;
+      std::set<std::string>::iterator it;
+      for (it = skipped.begin(); it != skipped.end(); ++it) {
+        ss << (it == skipped.begin() ? "" : ", ") << *it;
+      }
+      CLOG(LEV_WARN) << "the " << g->title() << " table is streamed to "
+                     << Name() << " without its columns of unsupported "
+                     << "types: " << ss.str();
+    }
+
+    std::unique_lock<std::mutex> lock(mu_);
+    if (queued_ + frame.size() > limit_ && queued_ > 0) {
+      if (overflow_ == STREAM_DROP) {
+        dropped_++;
+        continue;
+      }
+      while (!broken_ && queued_ > 0 && queued_ + frame.size() > limit_) {
+        cv_.wait(lock);
+      }
+    }
+    if (broken_) {
+      dropped_++;
+      continue;
+    }
+    queued_ += frame.size();
+    queue_.push_back(std::string());
+    queue_.back().swap(frame);
+    cv_.notify_all();
+  }
+}
+
+std::string StreamBack::Name() {
+  std::stringstream ss;
+  ss << "tcp://" << host_ << ":" << port_;
+  return ss.str();
+}
+
+void StreamBack::Flush() {
+  std::unique_lock<std::mutex> lock(mu_);
+  while (!queue_.empty() || sending_) {
+    cv_.wait(lock);
+  }
+}
+
+void StreamBack::Close() {
+#if !_WIN32
+  if (fd_ < 0) {
+    return;
+  }
+  Flush();
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  close(fd_);
+  fd_ = -1;
+#endif
+}
+
+uint64_t StreamBack::sent_bytes() {
+  std::lock_guard<std::mutex> lock(mu_);
+  return sent_;
+}
+
+uint64_t StreamBack::dropped() {
+  std::lock_guard<std::mutex> lock(mu_);
+  return dropped_;
+}
+
+std::string StreamBack::Encode(const DatumGroups::Group& rows,
+                               std::set<std::string>* skipped) {
+  std::string body;
+  PutStr(&body, rows.title());
+  const Datum::Vals& first = rows.front()->vals();
+  std::vector<int> types;
+  std::vector<int> cols;
+  for (int i = 0; i < first.size(); ++i) {
+    int type = StreamType(first[i].second);
+    types.push_back(type);
+    if (type < 0) {
+      skipped->insert(first[i].first);
+    } else {
+      cols.push_back(i);
+    }
+  }
+  PutU32(&body, cols.size());
+  for (int i = 0; i < cols.size(); ++i) {
+    PutStr(&body, first[cols[i]].first);
+    PutU32(&body, static_cast<uint32_t>(types[cols[i]]));
+  }
+
+  PutU32(&body, rows.size());
+  DatumGroups::Group::const_iterator it;
+  for (it = rows.begin(); it != rows.end(); ++it) {
+    const Datum::Vals& vals = (*it)->vals();
+    if (vals.size() != first.size()) {
+      throw ValueError("the rows of the " + rows.title() + " table don't "
+                       "have the same columns");
+    }
+    for (int i = 0; i < cols.size(); ++i) {
+      const boost::spirit::hold_any& v = vals[cols[i]].second;
+      if (StreamType(v) != types[cols[i]]) {
+        throw ValueError("the " + std::string(vals[cols[i]].first) +
+                         " column of the " + rows.title() + " table "
+                         "changes type");
+      }
+      PutVal(&body, types[cols[i]], v);
+    }
+  }
+
+  std::string frame;
+  frame.reserve(body.size() + 4);
+  PutU32(&frame, body.size());
+  frame.append(body);
+  return frame;
+}
+
+void StreamBack::Send() {
+  std::unique_lock<std::mutex> lock(mu_);
+  while (true) {
+    while (!stop_ && queue_.empty()) {
+      cv_.wait(lock);
+    }
+    if (queue_.empty()) {
+      return;
+    }
+    std::string frame;
+    frame.swap(queue_.front());
+    queue_.pop_front();
+    sending_ = true;
+    lock.unlock();
+    bool ok = Write(frame);
+    std::string err = ok ? "" : std::strerror(errno);
+    lock.lock();
+    sending_ = false;
+    queued_ -= frame.size();
+    if (ok) {
+      sent_ += frame.size();
+    } else {
+      if (!broken_) {
+        CLOG(LEV_WARN) << "lost the connection to " << Name() << ": " << err
+                       << "; the rest of the output is not streamed";
+      }
+      broken_ = true;
+      dropped_ += 1 + queue_.size();
+      queue_.clear();
+      queued_ = 0;
+    }
+    cv_.notify_all();
+  }
+}
+
+bool StreamBack::Write(const std::string& data) {
+#if !_WIN32
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = send(fd_, data.data() + sent, data.size() - sent,
+                     kSendFlags);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n <= 0) {
+      return false;
+    }
+    sent += n;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  // namespace cyclus
@@ -0,0 +1,138 @@
+#ifndef CYCLUS_SRC_STREAM_BACK_H_
+#define CYCLUS_SRC_STREAM_BACK_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "rec_backend.h"
+
+namespace cyclus {
+
+/// A recording backend that streams the output of a simulation to a TCP
+/// socket as it is flushed, e.g., for a live dashboard or a message bus
+/// bridge to consume instead of polling the output file. It only sends, so
+/// it is registered alongside a file backend rather than instead of one:
+///
+/// @code
+/// SqliteBack file("out.sqlite");
+/// StreamBack stream("localhost", 5556);
+/// rec.RegisterBackend(&file);
+/// rec.RegisterBackend(&stream);
+/// @endcode
+///
+/// Once connected, the backend sends the stream header, the 7 characters
+/// "CYCSTRM" and a version byte of 1, followed by one frame per table of
+/// each batch of rows it is notified of. All numbers are little endian. A
+/// frame is its length in bytes, not counting itself, as a u32, then the
+/// table name, the number of columns as a u32, the name and DbTypes of each
+/// column as a str and an i32, the number of rows as a u32, and the values of
+/// each row in column order. A str is its length as a u32 and its bytes.
+/// Values are encoded by type:
+///
+/// - BOOL: a u8
+/// - INT: an i32
+/// - FLOAT, DOUBLE: an f32, an f64
+/// - STRING, BLOB: a str
+/// - UUID: its 16 bytes
+/// - VECTOR_INT, VECTOR_DOUBLE, VECTOR_STRING: the number of elements as a
+///   u32, then each element as above
+/// - MAP_INT_DOUBLE: the number of items as a u32, then each key and value
+///   as an i32 and an f64
+///
+/// Columns of other types are left out of the frames of their table, with a
+/// warning. The columns of a table are those of the first row of each batch.
+///
+/// Frames are sent from a background thread, and at most buffer_bytes of
+/// them are queued. When the consumer falls that far behind, Notify either
+/// waits for the queue to drain (STREAM_BLOCK), holding up the simulation,
+/// or drops the frames that don't fit (STREAM_DROP), counting them. A frame
+/// larger than the buffer is queued alone. If the connection is lost, the
+/// backend warns once and drops every later frame, so that the simulation
+/// and its file output carry on.
+class StreamBack : public RecBackend {
+ public:
+  /// what Notify does with a frame when the queue is full
+  enum Overflow {
+    STREAM_BLOCK,  /// default flag, waiting for the queue to drain
+    STREAM_DROP  /// a flag for dropping the frame
+  };
+
+  /// The default number of bytes of frames that may be queued.
+  static const size_t kDefaultBufferBytes = 64 << 20;
+
+  /// Connects to the given host and TCP port and sends the stream header.
+  ///
+  /// @throws IOError if the host can't be connected to, or on platforms
+  /// without POSIX sockets
+  StreamBack(const std::string& host, int port,
+             size_t buffer_bytes = kDefaultBufferBytes);
+
+  /// Closes the backend.
+  virtual ~StreamBack();
+
+  /// what Notify does with a frame when the queue is full
+  /// @{
+  inline Overflow overflow() const { return overflow_; }
+  inline void overflow(Overflow o) { overflow_ = o; }
+  /// @}
+
+  /// Queues one frame for each group of rows.
+  virtual void Notify(const DatumGroups& groups);
+
+  /// Returns "tcp://<host>:<port>".
+  virtual std::string Name();
+
+  /// Waits until every queued frame has been sent or dropped.
+  virtual void Flush();
+
+  /// Flushes the backend and closes the connection. Later rows are dropped.
+  virtual void Close();
+
+  /// Returns the bytes sent so far, including the stream header.
+  uint64_t sent_bytes();
+
+  /// Returns the number of frames dropped so far.
+  uint64_t dropped();
+
+  /// Encodes a group of rows as a frame, leaving out the columns of types
+  /// that can't be streamed and adding their names to skipped.
+  static std::string Encode(const DatumGroups::Group& rows,
+                            std::set<std::string>* skipped);
+
+ private:
+  /// sends the queued frames until the backend is closed.
+  void Send();
+
+  /// writes all of data to the socket, returning false if it failed.
+  bool Write(const std::string& data);
+
+  std::string host_;
+  int port_;
+  int fd_;
+  size_t limit_;
+  Overflow overflow_;
+  std::thread thread_;
+
+  /// guards the members below, which are shared with the sending thread.
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<std::string> queue_;
+  size_t queued_;
+  bool sending_;
+  bool stop_;
+  bool broken_;
+  uint64_t sent_;
+  uint64_t dropped_;
+
+  /// the tables whose skipped columns have been warned of
+  std::set<std::string> warned_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_STREAM_BACK_H_
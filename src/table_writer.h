@@ -0,0 +1,378 @@
+#ifndef CYCLUS_SRC_TABLE_WRITER_H_
+#define CYCLUS_SRC_TABLE_WRITER_H_
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "composition.h"
+#include "error.h"
+#include "recorder.h"
+
+namespace cyclus {
+
+/// Records rows of a table whose schema is fixed at compile time.  The table
+/// and its field names are registered with the recorder once, when the writer
+/// is constructed, and every row is then written by copying the typed values
+/// straight into a recycled Datum for the table - no title lookup, field name
+/// copies, or hold_any boxing happen per row.
+///
+/// Example usage:
+///
+/// @code
+///
+/// TableWriter<int, double> w(rec, "Widgets", {"AgentId", "Mass"});
+/// ...
+/// w.Record(agent->id(), 42.0);
+///
+/// @endcode
+///
+/// Rows recorded through a writer are indistinguishable from those recorded
+/// with Recorder::NewDatum and may be mixed freely with them.
+template <typename... Ts>
+class TableWriter {
+ public:
+  /// @param rec the recorder to write rows to; it must outlive the writer.
+  /// @param title the table to record rows in.
+  /// @param fields the field name of each column, in the order of Ts.
+  /// @throws ValueError if the number of fields does not match the number of
+  /// column types.
+  TableWriter(Recorder* rec, const std::string& title,
+              const std::vector<std::string>& fields)
+      : rec_(rec),
+        table_(rec->GetTable(title)) {
+    if (fields.size() != sizeof...(Ts)) {
+      throw ValueError("table '" + title + "' has a different number of "
+                       "field names than column types");
+    }
+    for (int i = 0; i < fields.size(); ++i) {
+      fields_.push_back(rec->Intern(fields[i]));
+    }
+  }
+
+  /// Records a single row with the given column values.
+  void Record(const Ts&... vals) {
+    Datum* d = rec_->NewDatum(table_);
+    Add<0>(d, vals...);
+    d->Record();
+  }
+
+  /// Records n rows from column arrays. Row i holds the i-th value of every
+  /// column array, which must each hold at least n values. This is only a
+  /// convenience for callers that gather their rows by column; each row is
+  /// recorded just as Record would record it.
+  void RecordColumns(size_t n, const Ts*... cols) {
+    for (size_t i = 0; i < n; ++i) {
+      Datum* d = rec_->NewDatum(table_);
+      Add<0>(d, cols[i]...);
+      d->Record();
+    }
+  }
+
+  /// Returns the title of the table being written.
+  const std::string& title() const { return table_->title; }
+
+ private:
+  template <size_t I>
+  void Add(Datum* d) {}
+
+  template <size_t I, typename U, typename... Us>
+  void Add(Datum* d, const U& val, const Us&... rest) {
+    d->AddVal(fields_[I], val);
+    Add<I + 1>(d, rest...);
+  }
+
+  Recorder* rec_;
+  Recorder::Table* table_;
+  std::vector<const char*> fields_;
+};
+
+/// Assigns small integer ids to the distinct values of a dictionary encoded
+/// column, recording each value with its id in a lookup table the first time
+/// it is seen. Ids start at 1 and are only unique within a simulation.
+template <typename... Ts>
+class LookupWriter {
+ public:
+  /// @param fields the field name of the id column followed by those of the
+  /// value columns, in the order of Ts.
+  LookupWriter(Recorder* rec, const std::string& title,
+               const std::vector<std::string>& fields)
+      : rows_(rec, title, fields) {}
+
+  /// Returns the id of the given values, recording them if they are new.
+  /// This may be called from several threads at once.
+  int Id(const Ts&... vals) {
+    std::lock_guard<std::mutex> lock(mu_);
+    std::tuple<Ts...> key(vals...);
+    typename std::map<std::tuple<Ts...>, int>::iterator it = ids_.find(key);
+    if (it != ids_.end()) {
+      return it->second;
+    }
+    int id = ids_.size() + 1;
+    ids_[key] = id;
+    rows_.Record(id, vals...);
+    return id;
+  }
+
+ private:
+  TableWriter<int, Ts...> rows_;
+  std::mutex mu_;
+  std::map<std::tuple<Ts...>, int> ids_;
+};
+
+/// Records the rows of the Transactions table or, with compact output, the
+/// same rows in the CompactTransactions table, which holds the id of each
+/// commodity in the Commodities lookup table rather than its name.
+class TransactionsWriter {
+ public:
+  TransactionsWriter(Recorder* rec, bool compact)
+      : compact_(compact),
+        classic_(rec, "Transactions",
+                 {"TransactionId", "SenderId", "ReceiverId", "ResourceId",
+                  "Commodity", "Time"}),
+        rows_(rec, "CompactTransactions",
+              {"TransactionId", "SenderId", "ReceiverId", "ResourceId",
+               "CommodityId", "Time"}),
+        commods_(rec, "Commodities", {"CommodityId", "Commodity"}) {}
+
+  void Record(int id, int sender, int receiver, int rsrc,
+              const std::string& commod, int time) {
+    if (compact_) {
+      rows_.Record(id, sender, receiver, rsrc, commods_.Id(commod), time);
+    } else {
+      classic_.Record(id, sender, receiver, rsrc, commod, time);
+    }
+  }
+
+  /// Records n rows from column arrays, as TableWriter::RecordColumns does.
+  void RecordColumns(size_t n, const int* ids, const int* senders,
+                     const int* receivers, const int* rsrcs,
+                     const std::string* commods, const int* times) {
+    if (!compact_) {
+      classic_.RecordColumns(n, ids, senders, receivers, rsrcs, commods,
+                             times);
+      return;
+    }
+    std::vector<int> commod_ids(n);
+    for (size_t i = 0; i < n; ++i) {
+      commod_ids[i] = commods_.Id(commods[i]);
+    }
+    rows_.RecordColumns(n, ids, senders, receivers, rsrcs, &commod_ids[0],
+                        times);
+  }
+
+  /// Whether rows are recorded in the compact table.
+  inline bool compact() const { return compact_; }
+
+ private:
+  bool compact_;
+  TableWriter<int, int, int, int, std::string, int> classic_;
+  TableWriter<int, int, int, int, int, int> rows_;
+  LookupWriter<std::string> commods_;
+};
+
+/// Records the rows of the Resources table or, with compact output, the same
+/// rows in the CompactResources table. There the type and units of each
+/// resource are replaced by the id of the pair in the ResourceTypes lookup
+/// table, and its object and parent ids by how far they lie below its
+/// resource id (ObjIdDelta, Parent1Delta, and Parent2Delta), which is zero
+/// for no parent and otherwise small, since resources are mostly split and
+/// combined shortly after being made.
+class ResourcesWriter {
+ public:
+  ResourcesWriter(Recorder* rec, bool compact)
+      : compact_(compact),
+        classic_(rec, "Resources",
+                 {"ResourceId", "ObjId", "Type", "TimeCreated", "Quantity",
+                  "Units", "QualId", "Parent1", "Parent2"}),
+        rows_(rec, "CompactResources",
+              {"ResourceId", "ObjIdDelta", "TypeId", "TimeCreated",
+               "Quantity", "QualId", "Parent1Delta", "Parent2Delta"}),
+        types_(rec, "ResourceTypes", {"TypeId", "Type", "Units"}) {}
+
+  void Record(int id, int obj_id, const std::string& type, int time,
+              double qty, const std::string& units, int qual_id, int parent1,
+              int parent2) {
+    if (!compact_) {
+      classic_.Record(id, obj_id, type, time, qty, units, qual_id, parent1,
+                      parent2);
+      return;
+    }
+    rows_.Record(id, id - obj_id, types_.Id(type, units), time, qty, qual_id,
+                 parent1 == 0 ? 0 : id - parent1,
+                 parent2 == 0 ? 0 : id - parent2);
+  }
+
+  /// Whether rows are recorded in the compact table.
+  inline bool compact() const { return compact_; }
+
+ private:
+  bool compact_;
+  TableWriter<int, int, std::string, int, double, std::string, int, int, int>
+      classic_;
+  TableWriter<int, int, int, int, double, int, int, int> rows_;
+  LookupWriter<std::string, std::string> types_;
+};
+
+/// Assigns each nuclide of a simulation a position in the arrays of dense
+/// output (see SimInfo::dense_output), recording the nuclide with its
+/// position in the NuclideIndex table the first time it is seen. Positions
+/// start at 0, in the order nuclides are first seen, and are only unique
+/// within a simulation.
+class NuclideIndex {
+ public:
+  explicit NuclideIndex(Recorder* rec)
+      : rows_(rec, "NuclideIndex", {"NucIndex", "NucId"}) {}
+
+  /// Returns the values of the given nuclides as an array holding each at
+  /// the position of its nuclide, zero at every other position, and ending
+  /// at the last position of the nuclides given. This may be called from
+  /// several threads at once.
+  std::vector<double> Pack(const std::vector<Nuc>& nucs,
+                           const std::vector<double>& vals) {
+    std::vector<int> pos(nucs.size());
+    int n = 0;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      for (size_t i = 0; i < nucs.size(); ++i) {
+        std::map<Nuc, int>::iterator it = index_.find(nucs[i]);
+        if (it == index_.end()) {
+          int k = index_.size();
+          it = index_.insert(std::make_pair(nucs[i], k)).first;
+          rows_.Record(k, nucs[i]);
+        }
+        pos[i] = it->second;
+        n = std::max(n, pos[i] + 1);
+      }
+    }
+    std::vector<double> dense(n, 0.0);
+    for (size_t i = 0; i < nucs.size(); ++i) {
+      dense[pos[i]] += vals[i];
+    }
+    return dense;
+  }
+
+ private:
+  TableWriter<int, int> rows_;
+  std::mutex mu_;
+  std::map<Nuc, int> index_;
+};
+
+/// Records the rows of the Compositions table, one per nuclide of a
+/// composition, or, with dense output, a single row per composition in the
+/// DenseCompositions table, whose MassFracs array holds the mass fraction
+/// of every nuclide at its position in the NuclideIndex.
+class CompositionsWriter {
+ public:
+  /// @param dense the index of the nuclides of dense output, or NULL to
+  /// record the classic table
+  CompositionsWriter(Recorder* rec, NuclideIndex* dense)
+      : dense_(dense),
+        classic_(rec, "Compositions", {"QualId", "NucId", "MassFrac"}),
+        rows_(rec, "DenseCompositions", {"QualId", "MassFracs"}) {}
+
+  void Record(int qual_id, const std::vector<Nuc>& nucs,
+              const std::vector<double>& fracs) {
+    if (dense_ != NULL) {
+      rows_.Record(qual_id, dense_->Pack(nucs, fracs));
+      return;
+    }
+    for (size_t i = 0; i < nucs.size(); ++i) {
+      classic_.Record(qual_id, nucs[i], fracs[i]);
+    }
+  }
+
+  /// Whether rows are recorded in the dense table.
+  inline bool dense() const { return dense_ != NULL; }
+
+ private:
+  NuclideIndex* dense_;
+  TableWriter<int, int, double> classic_;
+  TableWriter<int, std::vector<double> > rows_;
+};
+
+/// Records the rows of the ExplicitInventory table, one per nuclide of an
+/// inventory, or, with dense output, a single row per inventory in the
+/// DenseInventory table, whose Masses array holds the mass of every nuclide
+/// at its position in the NuclideIndex.
+class InventoryWriter {
+ public:
+  /// @param dense the index of the nuclides of dense output, or NULL to
+  /// record the classic table
+  InventoryWriter(Recorder* rec, NuclideIndex* dense)
+      : dense_(dense),
+        classic_(rec, "ExplicitInventory",
+                 {"AgentId", "Time", "InventoryName", "NucId", "Quantity"}),
+        rows_(rec, "DenseInventory",
+              {"AgentId", "Time", "InventoryName", "Masses"}) {}
+
+  void Record(int agent, int time, const std::string& name,
+              const CompMap& mass) {
+    CompMap::const_iterator it;
+    if (dense_ == NULL) {
+      for (it = mass.begin(); it != mass.end(); ++it) {
+        classic_.Record(agent, time, name, it->first, it->second);
+      }
+      return;
+    }
+    std::vector<Nuc> nucs;
+    std::vector<double> vals;
+    nucs.reserve(mass.size());
+    vals.reserve(mass.size());
+    for (it = mass.begin(); it != mass.end(); ++it) {
+      nucs.push_back(it->first);
+      vals.push_back(it->second);
+    }
+    rows_.Record(agent, time, name, dense_->Pack(nucs, vals));
+  }
+
+  /// Whether rows are recorded in the dense table.
+  inline bool dense() const { return dense_ != NULL; }
+
+ private:
+  NuclideIndex* dense_;
+  TableWriter<int, int, std::string, int, double> classic_;
+  TableWriter<int, int, std::string, std::vector<double> > rows_;
+};
+
+/// Writers for the fixed-schema tables recorded by the cyclus kernel itself.
+/// Access them via Context::tables().
+struct CoreTables {
+  /// @param compact whether the Resources and Transactions tables are
+  /// recorded in their compact form (see SimInfo::compact_output).
+  /// @param dense whether the Compositions and ExplicitInventory tables are
+  /// recorded in their dense form (see SimInfo::dense_output).
+  explicit CoreTables(Recorder* rec, bool compact = false, bool dense = false)
+      : agent_entry(rec, "AgentEntry",
+                    {"AgentId", "Kind", "Spec", "Prototype", "ParentId",
+                     "Lifetime", "EnterTime"}),
+        nuclides(rec),
+        transactions(rec, compact),
+        resources(rec, compact),
+        res_creators(rec, "ResCreators", {"ResourceId", "AgentId"}),
+        material_info(rec, "MaterialInfo", {"ResourceId", "PrevDecayTime"}),
+        compositions(rec, dense ? &nuclides : NULL),
+        explicit_inventory(rec, dense ? &nuclides : NULL),
+        explicit_inventory_compact(rec, "ExplicitInventoryCompact",
+                                   {"AgentId", "Time", "InventoryName",
+                                    "Quantity", "Composition"}) {}
+
+  TableWriter<int, std::string, std::string, std::string, int, int, int>
+      agent_entry;
+  NuclideIndex nuclides;
+  TransactionsWriter transactions;
+  ResourcesWriter resources;
+  TableWriter<int, int> res_creators;
+  TableWriter<int, int> material_info;
+  CompositionsWriter compositions;
+  InventoryWriter explicit_inventory;
+  TableWriter<int, int, std::string, double, CompMap>
+      explicit_inventory_compact;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_TABLE_WRITER_H_
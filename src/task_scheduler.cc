@@ -0,0 +1,231 @@
+#include "task_scheduler.h"
+
+#include <algorithm>
+
+namespace cyclus {
+
+namespace {
+
+// the scheduler whose pool this thread is in, if any, and its index in it
+thread_local TaskScheduler* pool_of_thread = NULL;
+thread_local int index_in_pool = -1;
+
+}  // namespace
+
+TaskScheduler::TaskScheduler(int threads) : queued_(0), stop_(false) {
+  if (threads < 1)
+    threads = HardwareThreads();
+  for (int i = 0; i < threads; ++i) {
+    queues_.push_back(std::unique_ptr<Queue>(new Queue()));
+  }
+  for (int i = 0; i < threads - 1; ++i) {
+    workers_.push_back(std::thread(&TaskScheduler::Work, this, i));
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (int i = 0; i < workers_.size(); ++i) {
+    workers_[i].join();
+  }
+}
+
+int TaskScheduler::HardwareThreads() {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void TaskScheduler::ParallelFor(int n, const std::function<void(int)>& fn,
+                                int max_threads) {
+  if (n <= 0)
+    return;
+  int nthreads = max_threads > 0 ? std::min(max_threads, threads()) :
+                 threads();
+  std::atomic<int> next(0);
+  RunWorkers(std::min(nthreads, n), [&]() {
+    for (int i = next++; i < n; i = next++) {
+      try {
+        fn(i);
+      } catch (...) {
+        next = n;  // stop the other workers early
+        throw;
+      }
+    }
+  });
+}
+
+void TaskScheduler::RunWorkers(int n, const std::function<void()>& worker) {
+  n = std::min(n, threads());
+  if (n <= 1) {
+    worker();
+    return;
+  }
+
+  TaskGroup g(this);
+  for (int i = 1; i < n; ++i) {
+    g.Run(worker);
+  }
+  std::exception_ptr err;
+  try {
+    worker();
+  } catch (...) {
+    err = std::current_exception();
+  }
+  try {
+    g.Wait();
+  } catch (...) {
+    if (!err)
+      err = std::current_exception();
+  }
+  if (err)
+    std::rethrow_exception(err);
+}
+
+int TaskScheduler::QueueIndex() const {
+  return pool_of_thread == this ? index_in_pool : workers_.size();
+}
+
+void TaskScheduler::Push(const Task& t) {
+  Queue* q = queues_[QueueIndex()].get();
+  {
+    std::lock_guard<std::mutex> lock(q->mu);
+    q->tasks.push_back(t);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    ++queued_;
+  }
+  cv_.notify_one();
+}
+
+bool TaskScheduler::Pop(TaskGroup* group, Task* t) {
+  int own = QueueIndex();
+  int nqueues = queues_.size();
+  for (int k = 0; k < nqueues; ++k) {
+    Queue* q = queues_[(own + k) % nqueues].get();
+    std::lock_guard<std::mutex> lock(q->mu);
+    std::deque<Task>& tasks = q->tasks;
+    if (tasks.empty())
+      continue;
+    // the newest task of this thread's own queue, the oldest of another's
+    std::deque<Task>::iterator it = tasks.end();
+    if (k == 0) {
+      for (int i = tasks.size() - 1; i >= 0; --i) {
+        if (group == NULL || tasks[i].group == group) {
+          it = tasks.begin() + i;
+          break;
+        }
+      }
+    } else {
+      for (it = tasks.begin(); it != tasks.end(); ++it) {
+        if (group == NULL || it->group == group)
+          break;
+      }
+    }
+    if (it == tasks.end())
+      continue;
+    *t = *it;
+    tasks.erase(it);
+    --queued_;
+    return true;
+  }
+  return false;
+}
+
+void TaskScheduler::Work(int i) {
+  pool_of_thread = this;
+  index_in_pool = i;
+  Task t;
+  while (true) {
+    if (Pop(NULL, &t)) {
+      Run(t);
+      t.fn = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [this]() { return stop_ || queued_ > 0; });
+    if (stop_ && queued_ == 0)
+      return;
+  }
+}
+
+void TaskScheduler::Run(const Task& t) {
+  std::exception_ptr err;
+  try {
+    t.fn();
+  } catch (...) {
+    err = std::current_exception();
+  }
+  t.group->Finish(err);
+}
+
+TaskGroup::TaskGroup(TaskScheduler* s) : s_(s), pending_(0), queued_(0) {}
+
+TaskGroup::~TaskGroup() {
+  try {
+    Wait();
+  } catch (...) {
+  }
+}
+
+void TaskGroup::Run(const std::function<void()>& fn) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    ++pending_;
+  }
+  TaskScheduler::Task t;
+  t.fn = fn;
+  t.group = this;
+  s_->Push(t);
+  // counted once queued, so that Wait never misses it
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    ++queued_;
+  }
+  cv_.notify_all();
+}
+
+bool TaskGroup::RunPending() {
+  TaskScheduler::Task t;
+  if (!s_->Pop(this, &t))
+    return false;
+  TaskScheduler::Run(t);
+  return true;
+}
+
+void TaskGroup::Wait() {
+  while (true) {
+    int seen;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      seen = queued_;
+    }
+    while (RunPending()) {
+    }
+    // wait for the tasks running elsewhere, or for more to be queued
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [&]() { return pending_ == 0 || queued_ != seen; });
+    if (pending_ == 0)
+      break;
+  }
+  std::exception_ptr err;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    std::swap(err, err_);
+  }
+  if (err)
+    std::rethrow_exception(err);
+}
+
+void TaskGroup::Finish(std::exception_ptr err) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (err && !err_)
+    err_ = err;
+  --pending_;
+  cv_.notify_all();
+}
+
+}  // namespace cyclus
@@ -0,0 +1,161 @@
+#ifndef CYCLUS_SRC_TASK_SCHEDULER_H_
+#define CYCLUS_SRC_TASK_SCHEDULER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cyclus {
+
+class TaskGroup;
+
+/// A pool of threads that the parallel parts of a simulation share, so that
+/// running them never puts more threads to work than the pool has. Each
+/// Context owns one (see Context::scheduler), sized by the threads control
+/// parameter or the --threads command line option, and the kernel runs its
+/// thread-safe time listeners, traders and suppliers, exchange subproblems
+/// and snapshots on it. Archetypes may run their own work on it too.
+///
+/// Tasks are run in groups (see TaskGroup). Each thread of the pool has its
+/// own queue of tasks, running those it queued itself last in first out and
+/// stealing the oldest of another's when its own is empty, and threads
+/// outside of the pool queue theirs on a queue of their own. A thread
+/// waiting on a group runs the group's queued tasks itself meanwhile, so
+/// that tasks may wait on groups of their own without tying up the pool,
+/// but it never runs tasks of other groups, which may expect thread-local
+/// state that the waiting task has set up.
+///
+/// A pool of one thread runs every task on the thread waiting for it.
+class TaskScheduler {
+ public:
+  /// @param threads the number of threads work is run on, including the
+  /// thread waiting on it, or as many as the hardware supports if not
+  /// positive
+  explicit TaskScheduler(int threads = 0);
+
+  /// Stops the threads of the pool, which must have no tasks left.
+  ~TaskScheduler();
+
+  /// Returns the number of threads work is run on, at least 1.
+  inline int threads() const { return workers_.size() + 1; }
+
+  /// Returns the number of threads the hardware supports, at least 1.
+  static int HardwareThreads();
+
+  /// Calls fn(i) for every i in [0, n) on up to max_threads of the pool's
+  /// threads at once, or on all of them if not positive, including this
+  /// one, and returns when all calls have. Indexes are handed out one at a
+  /// time, in order, to the next thread free.
+  ///
+  /// @throws the first exception thrown by fn, once every call has returned
+  void ParallelFor(int n, const std::function<void(int)>& fn,
+                   int max_threads = 0);
+
+  /// Calls worker on n of the pool's threads, or as many as it has if
+  /// fewer, including this one, and returns when all calls have. The
+  /// workers usually share out the work among themselves, e.g. by taking
+  /// indexes from an atomic counter, so that those started late find none
+  /// left. Workers must not wait on each other, since they may run one after
+  /// the other.
+  ///
+  /// @throws the first exception thrown by worker, once every call has
+  /// returned
+  void RunWorkers(int n, const std::function<void()>& worker);
+
+ private:
+  friend class TaskGroup;
+
+  struct Task {
+    std::function<void()> fn;
+    TaskGroup* group;
+  };
+
+  struct Queue {
+    std::mutex mu;
+    std::deque<Task> tasks;
+  };
+
+  /// queues a task on the queue of this thread
+  void Push(const Task& t);
+
+  /// takes a task to run, of the group if not NULL, from the queue of this
+  /// thread and then from the others', returning whether there was one
+  bool Pop(TaskGroup* group, Task* t);
+
+  /// runs tasks on the ith thread of the pool until it is stopped
+  void Work(int i);
+
+  /// runs a task, reporting to its group
+  static void Run(const Task& t);
+
+  /// returns the queue of this thread
+  int QueueIndex() const;
+
+  std::vector<std::thread> workers_;
+
+  /// the queue of each thread of the pool, then the one of the threads
+  /// outside of it
+  std::vector<std::unique_ptr<Queue> > queues_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::atomic<int> queued_;
+  bool stop_;
+};
+
+/// A group of tasks run on a TaskScheduler, which may be waited on together.
+/// Tasks may queue more tasks on their group.
+///
+/// @code
+/// TaskGroup g(ctx->scheduler());
+/// for (int i = 0; i < n; ++i)
+///   g.Run([&, i]() { Work(i); });
+/// g.Wait();
+/// @endcode
+class TaskGroup {
+ public:
+  explicit TaskGroup(TaskScheduler* s);
+
+  /// Waits for the group's tasks, dropping any exception they threw.
+  ~TaskGroup();
+
+  /// Queues a task.
+  void Run(const std::function<void()>& fn);
+
+  /// Runs one of the group's queued tasks on this thread, returning whether
+  /// there was one.
+  bool RunPending();
+
+  /// Runs the group's queued tasks on this thread, and then waits for those
+  /// running on others.
+  ///
+  /// @throws the first exception thrown by a task of the group, after which
+  /// the group may be reused
+  void Wait();
+
+ private:
+  friend class TaskScheduler;
+
+  /// marks a task of the group done, having thrown err if not null
+  void Finish(std::exception_ptr err);
+
+  TaskScheduler* s_;
+
+  /// the tasks queued and not yet done, and the tasks ever queued
+  int pending_;
+  int queued_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::exception_ptr err_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_TASK_SCHEDULER_H_
@@ -1,6 +1,7 @@
 #ifndef CYCLUS_SRC_TIME_LISTENER_H_
 #define CYCLUS_SRC_TIME_LISTENER_H_
 
+#include <future>
 #include <string>
 
 #include "context.h"
@@ -34,6 +35,20 @@ class TimeListener: virtual public Ider {
   /// @param time is the current simulation timestep
   virtual void Tock() = 0;
 
+  /// Starts work that Tick needs, such as a call to an external code, which
+  /// may then run while other listeners tick. If the returned future is
+  /// valid, the timer waits for it, after starting that of every other
+  /// listener, and only then calls Tick, in the usual listener order. The
+  /// default returns no future.
+  ///
+  /// @warning the work of the future must not touch the simulation, i.e., it
+  /// may only modify the listener's own state, and must not create resources,
+  /// record data, or use the context. Leave those to Tick.
+  virtual std::future<void> StartTick() { return std::future<void>(); }
+
+  /// Starts work that Tock needs, as StartTick does for Tick.
+  virtual std::future<void> StartTock() { return std::future<void>(); }
+
   /// Simulation agents do their end-of-timestep decisions in the
   /// Decision method. The decision method allows for agents to
   /// make decision based on the operation of facilities during the
@@ -42,6 +57,27 @@ class TimeListener: virtual public Ider {
   ///
   /// @param time is the current simulation timestep
   virtual void Decision(){};
+
+  /// Whether this listener's Tick, Tock, and Decision may be called
+  /// concurrently with those of other listeners. Listeners that return true
+  /// are run on a pool of threads in each phase (see Timer::threads), before
+  /// all other listeners are run in their usual order. Data they record and
+  /// the builds and decommissionings they schedule are held back and applied
+  /// in the usual listener order once the phase is done, so that output does
+  /// not depend on how the listeners were scheduled.
+  ///
+  /// Registering and unregistering time listeners and putting them to sleep
+  /// are held back likewise. Transaction ids, recipes, and the registration
+  /// of traders are synchronized, and may be used from any thread.
+  ///
+  /// Listeners waiting on a future from StartTick or StartTock are run after
+  /// it is ready among the others, whether thread-safe or not.
+  ///
+  /// @warning thread-safe listeners may only modify their own state and the
+  /// resources they own. They may record data, create resources, schedule
+  /// builds and decommissionings, and use the context as above, but must not
+  /// add prototypes or interact with other agents directly.
+  virtual bool ThreadSafeTimeStep() { return false; }
 };
 
 }  // namespace cyclus
@@ -1,175 +1,450 @@
 // Implements the Timer class
 #include "timer.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
 #include <iostream>
 #include <string>
+#include <thread>
 
 #include "agent.h"
+#include "agent_profiler.h"
+#include "datum.h"
+#include "env.h"
 #include "error.h"
+#include "hw_counters.h"
 #include "logger.h"
+#include "mem_usage.h"
 #include "pyhooks.h"
+#include "res_tracker.h"
 #include "sim_init.h"
+#include "sim_observer.h"
+#include "table_writer.h"
+#include "task_scheduler.h"
+#include "toolkit/timeseries.h"
+#include "tracer.h"
 
 
 namespace cyclus {
 
+namespace {
+
+// the schedulings held back for the listener that the calling thread is
+// running concurrently with others, if any
+thread_local std::vector<std::function<void()> >* deferred = NULL;
+
+// Marks the listeners as being iterated over for as long as it lives.
+struct IterationGuard {
+  explicit IterationGuard(bool* iterating) : iterating(iterating) {
+    *iterating = true;
+  }
+  ~IterationGuard() { *iterating = false; }
+  bool* iterating;
+};
+
+// Runs a phase of a listener, timing it against its agent if profiling.
+void CallPhase(TimeListener* tl, void (TimeListener::*phase)(),
+               AgentProfiler* prof, AgentProfiler::Call call) {
+  if (prof == NULL) {
+    (tl->*phase)();
+    return;
+  }
+  ProfileCall pc(prof, dynamic_cast<Agent*>(tl), call);
+  (tl->*phase)();
+}
+
+}  // namespace
+
 void Timer::RunSim() {
   CLOG(LEV_INFO1) << "Simulation set to run from start="
                   << 0 << " to end=" << si_.duration;
   CLOG(LEV_INFO1) << "Beginning simulation";
+  PyGilRelease nogil;
+
+  RunUntil(si_.duration);
+
+  // windows cut short by the end of the simulation
+  if (ctx_->series_aggregator() != NULL) {
+    ctx_->series_aggregator()->Flush(ctx_, true);
+  }
+  if (ctx_->profiler() != NULL) {
+    ctx_->profiler()->Record(ctx_);
+  }
+  if (ctx_->hw_counters() != NULL) {
+    ctx_->hw_counters()->Record(ctx_);
+  }
+
+  ctx_->NewDatum("Finish")
+      ->AddVal("EarlyTerm", want_kill_.load())
+      ->AddVal("EndTime", time_-1)
+      ->Record();
+
+  SimInit::Snapshot(ctx_);  // always do a snapshot at the end of every simulation
 
+  if (ctx_->tracer() != NULL) {
+    ctx_->tracer()->Write();
+  }
+}
+
+void Timer::RunUntil(int end) {
+  // untracked resources created while running take ids from the simulation
+  IdAllocator::Scope ids(&ctx_->ids());
+  PyGilRelease nogil;
+  end = std::min(end, si_.duration);
   ExchangeManager<Material> matl_manager(ctx_);
   ExchangeManager<Product> genrsrc_manager(ctx_);
-  while (time_ < si_.duration) {
+  typedef std::chrono::steady_clock Clock;
+  int last_checkpoint = time_;
+  Clock::time_point last_checkpoint_clock = Clock::now();
+  while (time_ < end && !want_kill_) {
     CLOG(LEV_INFO1) << "Current time: " << time_;
-
-    if (want_snapshot_) {
+    Tracer* tracer = ctx_->tracer();
+    if (tracer != NULL) {
+      tracer->set_time(time_);
+    }
+    TraceSpan step(tracer, "Step", "timer");
+    step_ = NextStep(end) - time_;
+
+    bool checkpoint =
+        time_ > last_checkpoint &&
+        ((si_.checkpoint_steps > 0 &&
+          time_ - last_checkpoint >= si_.checkpoint_steps) ||
+         (si_.checkpoint_secs > 0 &&
+          std::chrono::duration<double>(Clock::now() - last_checkpoint_clock)
+              .count() >= si_.checkpoint_secs));
+    if (checkpoint) {
+      want_snapshot_ = false;
+      Checkpoint();
+      last_checkpoint = time_;
+      last_checkpoint_clock = Clock::now();
+    } else if (want_snapshot_) {
       want_snapshot_ = false;
       SimInit::Snapshot(ctx_);
     }
 
     // run through phases
+    StepBegin();
+    Clock::time_point phase_start = Clock::now();
+    WakeListeners();
     DoBuild();
+    PhaseEnd("Build", &phase_start);
     CLOG(LEV_INFO2) << "Beginning Tick for time: " << time_;
     DoTick();
+    PhaseEnd("Tick", &phase_start);
     CLOG(LEV_INFO2) << "Beginning DRE for time: " << time_;
     DoResEx(&matl_manager, &genrsrc_manager);
+    PhaseEnd("ResourceExchange", &phase_start);
     CLOG(LEV_INFO2) << "Beginning Tock for time: " << time_;
     DoTock();
+    PhaseEnd("Tock", &phase_start);
     CLOG(LEV_INFO2) << "Beginning Decision for time: " << time_;
     DoDecision();
+    PhaseEnd("Decision", &phase_start);
     DoDecom();
+    PhaseEnd("Decom", &phase_start);
+    if (ctx_->coalescer() != NULL) {
+      ctx_->coalescer()->Flush(ctx_);
+    }
+    toolkit::FlushTimeSeries(ctx_);
+    if (ctx_->series_aggregator() != NULL) {
+      ctx_->series_aggregator()->Flush(ctx_, false);
+    }
+    toolkit::FlushTimeSeriesBatches(time_);
+    if (ctx_->memory_period() > 0 && time_ % ctx_->memory_period() == 0) {
+      MemUsage::Record(ctx_);
+    }
 
 #ifdef CYCLUS_WITH_PYTHON
     EventLoop();
 #endif
+    StepEnd();
 
-    time_++;
+    // builds, decommissionings and wakeups scheduled during the step may
+    // have cut it short
+    time_ = NextStep(end);
 
     if (want_kill_) {
       break;
     }
+    SkipIdleSteps(end);
   }
+}
 
-  ctx_->NewDatum("Finish")
-      ->AddVal("EarlyTerm", want_kill_)
-      ->AddVal("EndTime", time_-1)
+void Timer::Checkpoint() {
+  CLOG(LEV_INFO1) << "Checkpoint at time: " << time_;
+  TraceSpan span(ctx_->tracer(), "Checkpoint", "timer");
+  CounterSpan counted(ctx_->hw_counters(), "timer", "Checkpoint");
+  SimInit::Snapshot(ctx_);
+  ctx_->rec_->FlushAsync();
+
+  // recorded after the flush, so this is only written once the snapshot is
+  ctx_->NewDatum("Checkpoints")
+      ->AddVal("Time", time_)
       ->Record();
+}
 
-  SimInit::Snapshot(ctx_);  // always do a snapshot at the end of every simulation
+void Timer::StepBegin() {
+  if (ctx_->observers().empty())
+    return;
+  // a copy, since observers may unregister themselves
+  std::vector<SimObserver*> obs = ctx_->observers();
+  for (int i = 0; i < obs.size(); ++i) {
+    obs[i]->OnStepBegin(ctx_, time_);
+  }
+}
+
+void Timer::PhaseEnd(const char* phase,
+                     std::chrono::steady_clock::time_point* start) {
+  if (ctx_->observers().empty())
+    return;
+  std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  double secs = std::chrono::duration<double>(now - *start).count();
+  std::vector<SimObserver*> obs = ctx_->observers();
+  for (int i = 0; i < obs.size(); ++i) {
+    obs[i]->OnPhaseEnd(ctx_, time_, phase, secs);
+  }
+  // the observers' own time isn't counted against the next phase
+  *start = std::chrono::steady_clock::now();
+}
+
+void Timer::StepEnd() {
+  if (ctx_->observers().empty())
+    return;
+  std::vector<SimObserver*> obs = ctx_->observers();
+  for (int i = 0; i < obs.size(); ++i) {
+    obs[i]->OnStepEnd(ctx_, time_);
+  }
 }
 
 void Timer::DoBuild() {
-  // build queued agents
-  std::vector<std::pair<std::string, Agent*> > build_list = build_queue_[time_];
+  TraceSpan span(ctx_->tracer(), "Build", "timer");
+  CounterSpan counted(ctx_->hw_counters(), "timer", "Build");
+  // build queued agents; builds can only be scheduled for later times, so
+  // the list is left unchanged while building
+  std::map<int, std::vector<BuildBatch> >::iterator it =
+      build_queue_.find(time_);
+  if (it == build_queue_.end()) {
+    return;
+  }
+  const std::vector<BuildBatch>& build_list = it->second;
   for (int i = 0; i < build_list.size(); ++i) {
-    Agent* m = ctx_->CreateAgent<Agent>(build_list[i].first);
-    Agent* parent = build_list[i].second;
-    CLOG(LEV_INFO3) << "Building a " << build_list[i].first
-                    << " from parent " << build_list[i].second;
-    m->Build(parent);
-    if (parent != NULL) {
-      parent->BuildNotify(m);
-    } else {
+    const BuildBatch& batch = build_list[i];
+    const std::string& name = proto_names_[batch.proto];
+    CLOG(LEV_INFO3) << "Building " << batch.count << " " << name
+                    << " from parent " << batch.parent;
+    if (batch.parent == NULL) {
       CLOG(LEV_DEBUG1) << "Hey! Listen! Built an Agent without a Parent.";
     }
+    ctx_->BuildAgents(name, batch.parent, batch.count);
   }
 }
 
 void Timer::DoTick() {
-  for (std::map<int, TimeListener*>::iterator agent = tickers_.begin();
-       agent != tickers_.end();
-       agent++) {
-    agent->second->Tick();
+  TraceSpan span(ctx_->tracer(), "Tick", "timer");
+  CounterSpan counted(ctx_->hw_counters(), "timer", "Tick");
+  RunPhase(&TimeListener::Tick, &TimeListener::StartTick);
+  if (ctx_->decay_sweep() && ctx_->decay_mode() == DECAY_LAZY) {
+    ctx_->SweepDecay();
+  }
+}
+
+void Timer::RunPhase(void (TimeListener::*phase)(),
+                     std::future<void> (TimeListener::*start)()) {
+  CompactTickers();
+  IterationGuard guard(&iterating_);
+  AgentProfiler* prof = ctx_->profiler();
+  AgentProfiler::Call call =
+      phase == &TimeListener::Tick ? AgentProfiler::TICK :
+      phase == &TimeListener::Tock ? AgentProfiler::TOCK :
+      AgentProfiler::DECISION;
+
+  int n = tickers_.size();
+  std::vector<std::future<void> > started(n);
+  std::vector<std::exception_ptr> errs(n);
+  if (start != NULL) {
+    for (int i = 0; i != n; i++) {
+      if (!awake(i))
+        continue;
+      try {
+        ProfileCall pc(prof, dynamic_cast<Agent*>(tickers_[i]), call);
+        started[i] = (tickers_[i]->*start)();
+      } catch (...) {
+        errs[i] = std::current_exception();
+      }
+    }
+  }
+
+  std::vector<int> parallel;
+  if (threads_ > 1) {
+    for (int i = 0; i != n; i++) {
+      if (awake(i) && !errs[i] && !started[i].valid() &&
+          tickers_[i]->ThreadSafeTimeStep())
+        parallel.push_back(i);
+    }
+  }
+  if (parallel.size() < 2) {
+    // listeners built during the phase are appended and so still reached
+    for (int i = 0; i < tickers_.size(); i++) {
+      if (i < n && started[i].valid()) {
+        try {
+          started[i].get();
+        } catch (...) {
+          errs[i] = std::current_exception();
+        }
+      }
+      if (i < n && errs[i])
+        std::rethrow_exception(errs[i]);
+      if (awake(i))
+        CallPhase(tickers_[i], phase, prof, call);
+    }
+    return;
+  }
+
+  std::vector<DatumList> staged(n);
+  std::vector<std::vector<std::function<void()> > > scheduled(n);
+  Recorder* rec = ctx_->rec_;
+  ctx_->tables();  // creates the shared table writers up front
+
+  std::atomic<int> next(0);
+  auto worker = [&]() {
+    IdAllocator::Scope ids(&ctx_->ids());
+    for (int k = next++; k < parallel.size(); k = next++) {
+      int i = parallel[k];
+      rec->StartStaging(&staged[i]);
+      deferred = &scheduled[i];
+      try {
+        CallPhase(tickers_[i], phase, prof, call);
+      } catch (...) {
+        errs[i] = std::current_exception();
+      }
+      deferred = NULL;
+      rec->StopStaging();
+    }
+  };
+  ctx_->scheduler()->RunWorkers(std::min<int>(threads_, parallel.size()),
+                                worker);
+
+  std::vector<bool> done(n, false);
+  for (int k = 0; k != parallel.size(); k++) {
+    done[parallel[k]] = true;
+  }
+  for (int i = 0; i < tickers_.size(); i++) {
+    if (i < n && started[i].valid()) {
+      try {
+        started[i].get();
+      } catch (...) {
+        errs[i] = std::current_exception();
+      }
+    }
+    if (i < n && errs[i]) {
+      for (int j = i; j != n; j++) {
+        rec->Discard(&staged[j]);
+      }
+      std::rethrow_exception(errs[i]);
+    }
+    if (i < n && done[i]) {
+      rec->Commit(&staged[i]);
+      for (int j = 0; j != scheduled[i].size(); j++) {
+        scheduled[i][j]();
+      }
+    } else if (awake(i)) {
+      CallPhase(tickers_[i], phase, prof, call);
+    }
+  }
+}
+
+void Timer::CompactTickers() {
+  if (ntombstones_ > 0) {
+    int k = 0;
+    for (int i = 0; i != tickers_.size(); i++) {
+      if (tickers_[i] != NULL) {
+        tickers_[k] = tickers_[i];
+        ticker_ids_[k] = ticker_ids_[i];
+        ticker_wakes_[k] = ticker_wakes_[i];
+        k++;
+      }
+    }
+    tickers_.resize(k);
+    ticker_ids_.resize(k);
+    ticker_wakes_.resize(k);
+    ntombstones_ = 0;
+  }
+  std::vector<TimeListener*> pending;
+  pending.swap(pending_tickers_);
+  for (int i = 0; i != pending.size(); i++) {
+    RegisterTimeListener(pending[i]);
   }
 }
 
 void Timer::DoResEx(ExchangeManager<Material>* matmgr,
                     ExchangeManager<Product>* genmgr) {
+  TraceSpan span(ctx_->tracer(), "ResourceExchange", "timer");
+  CounterSpan counted(ctx_->hw_counters(), "timer", "ResourceExchange");
   matmgr->Execute();
   genmgr->Execute();
 }
 
 void Timer::DoTock() {
-  for (std::map<int, TimeListener*>::iterator agent = tickers_.begin();
-       agent != tickers_.end();
-       agent++) {
-    agent->second->Tock();
-  }
+  TraceSpan span(ctx_->tracer(), "Tock", "timer");
+  CounterSpan counted(ctx_->hw_counters(), "timer", "Tock");
+  RunPhase(&TimeListener::Tock, &TimeListener::StartTock);
 
   if (si_.explicit_inventory || si_.explicit_inventory_compact) {
-    std::set<Agent*> ags = ctx_->agent_list_;
-    std::set<Agent*>::iterator it;
-    for (it = ags.begin(); it != ags.end(); ++it) {
-      Agent* a = *it;
-      if (a->enter_time() == -1) {
-        continue; // skip agents that aren't alive
-      }
-      RecordInventories(a);
+    std::vector<Agent*> ags = ctx_->live_agents();
+    for (int i = 0; i < ags.size(); ++i) {
+      RecordInventories(ags[i]);
     }
   }
 }
 
 void Timer::DoDecision() {
-  for (std::map<int, TimeListener*>::iterator agent = tickers_.begin();
-       agent != tickers_.end();
-       agent++) {
-    agent->second->Decision();
-  }
+  TraceSpan span(ctx_->tracer(), "Decision", "timer");
+  CounterSpan counted(ctx_->hw_counters(), "timer", "Decision");
+  RunPhase(&TimeListener::Decision);
 }
 
 void Timer::RecordInventories(Agent* a) {
-  Inventories invs = a->SnapshotInv();
-  Inventories::iterator it2;
-  for (it2 = invs.begin(); it2 != invs.end(); ++it2) {
-    std::string name = it2->first;
-    std::vector<Resource::Ptr> mats = it2->second;
-    if (mats.empty() || ResCast<Material>(mats[0]) == NULL) {
-      continue; // skip non-material inventories
-    }
-
-    Material::Ptr m = ResCast<Material>(mats[0]->Clone());
-    for (int i = 1; i < mats.size(); i++) {
-      m->Absorb(ResCast<Material>(mats[i]->Clone()));
-    }
-    RecordInventory(a, name, m);
+  InvSummaries invs = a->SummarizeInv();
+  InvSummaries::iterator it;
+  for (it = invs.begin(); it != invs.end(); ++it) {
+    RecordInventory(a, it->first, it->second);
   }
 }
 
-void Timer::RecordInventory(Agent* a, std::string name, Material::Ptr m) {
+void Timer::RecordInventory(Agent* a, const std::string& name,
+                            const InvSummary& inv) {
   if (si_.explicit_inventory) {
-    CompMap c = m->comp()->mass();
-    compmath::Normalize(&c, m->quantity());
-    CompMap::iterator it;
-    for (it = c.begin(); it != c.end(); ++it) {
-      ctx_->NewDatum("ExplicitInventory")
-          ->AddVal("AgentId", a->id())
-          ->AddVal("Time", time_)
-          ->AddVal("InventoryName", name)
-          ->AddVal("NucId", it->first)
-          ->AddVal("Quantity", it->second)
-          ->Record();
-    }
+    ctx_->tables().explicit_inventory.Record(a->id(), time_, name, inv.mass);
   }
 
   if (si_.explicit_inventory_compact) {
-    CompMap c = m->comp()->mass();
+    CompMap c = inv.mass;
     compmath::Normalize(&c, 1);
-    ctx_->NewDatum("ExplicitInventoryCompact")
-        ->AddVal("AgentId", a->id())
-        ->AddVal("Time", time_)
-        ->AddVal("InventoryName", name)
-        ->AddVal("Quantity", m->quantity())
-        ->AddVal("Composition", c)
-        ->Record();
+    ctx_->tables().explicit_inventory_compact.Record(a->id(), time_, name,
+                                                     inv.quantity, c);
   }
 }
 
 void Timer::DoDecom() {
-  // decommission queued agents
-  std::vector<Agent*> decom_list = decom_queue_[time_];
-  for (int i = 0; i < decom_list.size(); ++i) {
-    Agent* m = decom_list[i];
+  TraceSpan span(ctx_->tracer(), "Decom", "timer");
+  CounterSpan counted(ctx_->hw_counters(), "timer", "Decom");
+  // decommission queued agents. Decommissioning may schedule more
+  // decommissionings for this time, so the list is indexed afresh each time
+  // and only the agents queued up front are decommissioned.
+  std::map<int, std::vector<Agent*> >::iterator it = decom_queue_.find(time_);
+  if (it == decom_queue_.end()) {
+    return;
+  }
+  int n = it->second.size();
+  for (int i = 0; i < n; ++i) {
+    Agent* m = it->second[i];
+    if (m == NULL) {
+      continue;  // rescheduled for another time
+    }
+    decom_slots_.erase(m);
     if (m->parent() != NULL) {
       m->parent()->DecomNotify(m);
     }
@@ -178,49 +453,268 @@ void Timer::DoDecom() {
 }
 
 void Timer::RegisterTimeListener(TimeListener* agent) {
-  tickers_[agent->id()] = agent;
+  if (deferred != NULL) {
+    deferred->push_back([this, agent]() { RegisterTimeListener(agent); });
+    return;
+  }
+  int id = agent->id();
+  if (ticker_ids_.empty() || id > ticker_ids_.back()) {
+    // the usual case, since agents are built with increasing ids
+    tickers_.push_back(agent);
+    ticker_ids_.push_back(id);
+    ticker_wakes_.push_back(0);
+    return;
+  }
+
+  std::vector<int>::iterator it =
+      std::lower_bound(ticker_ids_.begin(), ticker_ids_.end(), id);
+  int i = it - ticker_ids_.begin();
+  if (*it == id) {
+    if (tickers_[i] == NULL)
+      ntombstones_--;
+    tickers_[i] = agent;
+  } else if (iterating_) {
+    // inserting would shift the listeners of the phase being run
+    pending_tickers_.push_back(agent);
+  } else {
+    tickers_.insert(tickers_.begin() + i, agent);
+    ticker_ids_.insert(it, id);
+    ticker_wakes_.insert(ticker_wakes_.begin() + i, 0);
+  }
+}
+
+void Timer::ReserveTimeListeners(int n) {
+  // at least double, so that many small batches still grow geometrically
+  size_t want = tickers_.size() + std::max(n, 0);
+  if (want > tickers_.capacity()) {
+    want = std::max(want, 2 * tickers_.capacity());
+    tickers_.reserve(want);
+    ticker_ids_.reserve(want);
+    ticker_wakes_.reserve(want);
+  }
 }
 
 void Timer::UnregisterTimeListener(TimeListener* tl) {
-  tickers_.erase(tl->id());
+  if (deferred != NULL) {
+    deferred->push_back([this, tl]() { UnregisterTimeListener(tl); });
+    return;
+  }
+  int i = TickerIndex(tl->id());
+  if (i >= 0) {
+    if (ticker_wakes_[i] > 0) {
+      ticker_wakes_[i] = 0;
+      nsleeping_--;
+    }
+    tickers_[i] = NULL;
+    ntombstones_++;
+  }
+  std::vector<TimeListener*>::iterator p = std::remove(
+      pending_tickers_.begin(), pending_tickers_.end(), tl);
+  pending_tickers_.erase(p, pending_tickers_.end());
 }
 
-void Timer::SchedBuild(Agent* parent, std::string proto_name, int t) {
+int Timer::TickerIndex(int id) {
+  std::vector<int>::iterator it =
+      std::lower_bound(ticker_ids_.begin(), ticker_ids_.end(), id);
+  int i = it - ticker_ids_.begin();
+  if (it == ticker_ids_.end() || *it != id || tickers_[i] == NULL) {
+    return -1;
+  }
+  return i;
+}
+
+void Timer::SleepUntil(TimeListener* tl, int t) {
+  if (deferred != NULL) {
+    deferred->push_back([this, tl, t]() { SleepUntil(tl, t); });
+    return;
+  }
+  int i = TickerIndex(tl->id());
+  if (i < 0) {
+    throw ValueError("Cannot put an unregistered time listener to sleep");
+  }
+  int& wake = ticker_wakes_[i];
   if (t <= time_) {
-    throw ValueError("Cannot schedule build for t < [current-time]");
+    if (wake > 0)
+      nsleeping_--;
+    wake = 0;
+    return;
+  }
+  if (wake == 0)
+    nsleeping_++;
+  wake = t;
+  wakeups_.push(Wakeup(t, tl->id()));
+}
+
+bool Timer::asleep(int id) {
+  int i = TickerIndex(id);
+  return i >= 0 && ticker_wakes_[i] > time_;
+}
+
+void Timer::WakeListeners() {
+  while (!wakeups_.empty() && wakeups_.top().first <= time_) {
+    Wakeup w = wakeups_.top();
+    wakeups_.pop();
+    int i = TickerIndex(w.second);
+    if (i >= 0 && ticker_wakes_[i] == w.first) {
+      ticker_wakes_[i] = 0;
+      nsleeping_--;
+    }
   }
-  build_queue_[t].push_back(std::make_pair(proto_name, parent));
+}
+
+void Timer::SkipIdleSteps(int end) {
+  int nlive = tickers_.size() - ntombstones_;
+  if (nlive == 0 || nsleeping_ < nlive || !pending_tickers_.empty() ||
+      want_snapshot_ || si_.explicit_inventory ||
+      si_.explicit_inventory_compact) {
+    return;
+  }
+  const std::set<Trader*>& traders = ctx_->traders();
+  std::set<Trader*>::const_iterator trader;
+  for (trader = traders.begin(); trader != traders.end(); ++trader) {
+    Agent* m = (*trader)->manager();
+    if (m == NULL || !asleep(m->id())) {
+      return;
+    }
+  }
+
+  int next = end;
+  int wake = NextWakeup();
+  if (wake >= 0)
+    next = std::min(next, wake);
+  std::map<int, std::vector<BuildBatch> >::iterator b =
+      build_queue_.lower_bound(time_);
+  if (b != build_queue_.end())
+    next = std::min(next, b->first);
+  std::map<int, std::vector<Agent*> >::iterator d =
+      decom_queue_.lower_bound(time_);
+  if (d != decom_queue_.end())
+    next = std::min(next, d->first);
+
+  if (next > time_) {
+    CLOG(LEV_INFO1) << "Every agent is asleep; skipping from time " << time_
+                    << " to " << next;
+    time_ = next;
+  }
+}
+
+int Timer::NextStep(int end) {
+  int next = time_ + 1;
+  const std::map<int, int>& sched = si_.step_schedule;
+  std::map<int, int>::const_iterator s = sched.upper_bound(time_);
+  if (s != sched.begin()) {
+    std::map<int, int>::const_iterator cur = s;
+    --cur;
+    int len = cur->second;
+    next = cur->first + ((time_ - cur->first) / len + 1) * len;
+    if (s != sched.end())
+      next = std::min(next, s->first);
+  }
+  if (next == time_ + 1)
+    return std::min(next, end);
+
+  int wake = NextWakeup();
+  if (wake > time_)
+    next = std::min(next, wake);
+  std::map<int, std::vector<BuildBatch> >::iterator b =
+      build_queue_.upper_bound(time_);
+  if (b != build_queue_.end())
+    next = std::min(next, b->first);
+  std::map<int, std::vector<Agent*> >::iterator d =
+      decom_queue_.upper_bound(time_);
+  if (d != decom_queue_.end())
+    next = std::min(next, d->first);
+  return std::min(next, end);
+}
+
+int Timer::NextWakeup() {
+  // drop stale entries so that the earliest one is a real wakeup
+  while (!wakeups_.empty()) {
+    int i = TickerIndex(wakeups_.top().second);
+    if (i >= 0 && ticker_wakes_[i] == wakeups_.top().first)
+      return wakeups_.top().first;
+    wakeups_.pop();
+  }
+  return -1;
+}
+
+void Timer::SchedBuild(Agent* parent, std::string proto_name, int t) {
+  SchedBuilds(parent, proto_name, 1, std::vector<int>(1, t));
+}
+
+void Timer::SchedBuilds(Agent* parent, const std::string& proto_name,
+                        int count, const std::vector<int>& times) {
+  for (int i = 0; i < times.size(); ++i) {
+    if (times[i] <= time_) {
+      throw ValueError("Cannot schedule build for t < [current-time]");
+    }
+  }
+  if (count < 1) {
+    return;
+  }
+  int proto = ProtoId(proto_name);
+  if (deferred != NULL) {
+    deferred->push_back([this, parent, proto, count, times]() {
+      for (int i = 0; i < times.size(); ++i) {
+        QueueBuilds(parent, proto, count, times[i]);
+      }
+    });
+    return;
+  }
+  for (int i = 0; i < times.size(); ++i) {
+    QueueBuilds(parent, proto, count, times[i]);
+  }
+}
+
+int Timer::ProtoId(const std::string& name) {
+  std::lock_guard<std::mutex> lock(proto_mu_);
+  std::pair<std::unordered_map<std::string, int>::iterator, bool> ins =
+      proto_ids_.insert(std::make_pair(name, proto_names_.size()));
+  if (ins.second) {
+    proto_names_.push_back(name);
+  }
+  return ins.first->second;
+}
+
+void Timer::QueueBuilds(Agent* parent, int proto, int count, int t) {
+  // consecutive builds of one prototype for the same parent share a batch
+  std::vector<BuildBatch>& queue = build_queue_[t];
+  if (!queue.empty() && queue.back().proto == proto &&
+      queue.back().parent == parent) {
+    queue.back().count += count;
+    return;
+  }
+  BuildBatch batch = {proto, parent, count};
+  queue.push_back(batch);
 }
 
 void Timer::SchedDecom(Agent* m, int t) {
   if (t < time_) {
     throw ValueError("Cannot schedule decommission for t < [current-time]");
   }
+  if (deferred != NULL) {
+    deferred->push_back(std::bind(&Timer::QueueDecom, this, m, t));
+    return;
+  }
+  QueueDecom(m, t);
+}
 
+void Timer::QueueDecom(Agent* m, int t) {
   // It is possible that a single agent may be scheduled for decommissioning
   // multiple times. If this happens, we cannot just add it to the queue again
   // - the duplicate entries will result in a double delete attempt and
-  // segfaults and otherwise bad things.  Remove previous decommissionings
-  // before scheduling this new one.
-  std::map<int, std::vector<Agent*> >::iterator it;
-  bool done = false;
-  for (it = decom_queue_.begin(); it != decom_queue_.end(); ++it) {
-    int t = it->first;
-    std::vector<Agent*> ags = it->second;
-    for (int i = 0; i < ags.size(); i++) {
-      if (ags[i] == m) {
-        CLOG(LEV_WARN) << "scheduled over previous decommissioning of " << m->id();
-        decom_queue_[t].erase(decom_queue_[t].begin()+i);
-        done = true;
-        break;
-      }
-    }
-    if (done) {
-      break;
-    }
+  // segfaults and otherwise bad things.  Previous decommissionings are looked
+  // up by agent and replaced with a NULL tombstone, which DoDecom skips.
+  std::vector<Agent*>& queue = decom_queue_[t];
+  std::pair<std::unordered_map<Agent*, DecomSlot>::iterator, bool> ins =
+      decom_slots_.insert(std::make_pair(m, DecomSlot(t, queue.size())));
+  if (!ins.second) {
+    CLOG(LEV_WARN) << "scheduled over previous decommissioning of " << m->id();
+    DecomSlot& prev = ins.first->second;
+    decom_queue_[prev.first][prev.second] = NULL;
+    prev = DecomSlot(t, queue.size());
   }
-
-  decom_queue_[t].push_back(m);
+  queue.push_back(m);
 }
 
 int Timer::time() {
@@ -229,8 +723,18 @@ int Timer::time() {
 
 void Timer::Reset() {
   tickers_.clear();
+  ticker_ids_.clear();
+  ticker_wakes_.clear();
+  wakeups_ = std::priority_queue<Wakeup, std::vector<Wakeup>,
+                                 std::greater<Wakeup> >();
+  pending_tickers_.clear();
+  ntombstones_ = 0;
+  nsleeping_ = 0;
   build_queue_.clear();
+  proto_names_.clear();
+  proto_ids_.clear();
   decom_queue_.clear();
+  decom_slots_.clear();
   si_ = SimInfo(0);
 }
 
@@ -239,9 +743,19 @@ void Timer::Initialize(Context* ctx, SimInfo si) {
     throw ValueError("Invalid month0; must be between 1 and 12 (inclusive).");
   }
 
+  std::map<int, int>::const_iterator step;
+  for (step = si.step_schedule.begin(); step != si.step_schedule.end();
+       ++step) {
+    if (step->first < 0 || step->second < 1) {
+      throw ValueError("Invalid step schedule; steps must start at times >= 0"
+                       " and be at least one time step long.");
+    }
+  }
+
   want_kill_ = false;
   ctx_ = ctx;
   time_ = 0;
+  step_ = 1;
   si_ = si;
 
   if (si.branch_time > -1) {
@@ -253,6 +767,18 @@ int Timer::dur() {
   return si_.duration;
 }
 
-Timer::Timer() : time_(0), si_(0), want_snapshot_(false), want_kill_(false) {}
+Timer::Timer()
+    : time_(0),
+      step_(1),
+      si_(0),
+      want_snapshot_(false),
+      want_kill_(false),
+      ntombstones_(0),
+      nsleeping_(0),
+      iterating_(false) {
+  std::string nthreads = Env::GetEnv("CYCLUS_TIMESTEP_THREADS");
+  threads(nthreads.empty() ? std::thread::hardware_concurrency() :
+          std::atoi(nthreads.c_str()));
+}
 
 }  // namespace cyclus
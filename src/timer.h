@@ -1,6 +1,13 @@
 #ifndef CYCLUS_SRC_TIMER_H_
 #define CYCLUS_SRC_TIMER_H_
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -9,6 +16,7 @@
 #include "product.h"
 #include "material.h"
 #include "infile_tree.h"
+#include "platform.h"
 #include "time_listener.h"
 #include "comp_math.h"
 
@@ -19,8 +27,19 @@ namespace cyclus {
 class Agent;
 
 /// Controls simulation timestepping and inter-timestep phases.
+///
+/// Time listeners that declare their phases thread-safe (see
+/// TimeListener::ThreadSafeTimeStep) are run on the threads of the context's
+/// scheduler (see Context::scheduler), or on at most the number given by the
+/// CYCLUS_TIMESTEP_THREADS environment variable, in the Tick, Tock, and
+/// Decision phases.
+///
+/// Time is counted in time steps of SimInfo::dt seconds, but the timer may
+/// take longer steps through the stretches of a step schedule (see
+/// SimInfo::step_schedule), running every phase once per step.
 class Timer {
   friend class ::SimInitTest;
+  friend class SimInit;
  public:
   Timer();
 
@@ -32,22 +51,52 @@ class Timer {
   /// resets all data (registered listeners, etc.) to empty or initial state
   void Reset();
 
-  /// Runs the simulation.
+  /// Runs the simulation. Checkpoints are taken as configured by
+  /// SimInfo::checkpoint_steps and SimInfo::checkpoint_secs.
+  ///
+  /// The Python global interpreter lock is released while the simulation
+  /// runs, and taken only while Python agents and hooks are called, so that
+  /// Python threads keep running alongside simulations run from Python.
   void RunSim();
 
+  /// Runs the timesteps before end, stopping early if the simulation ends
+  /// or is killed, and leaves the simulation between timesteps (see
+  /// SimInit::Fork). Calling RunSim afterwards finishes the simulation.
+  void RunUntil(int end);
+
   /// Registers an agent to receive tick/tock notifications every timestep.
   /// Agents should register from their Deploy method.
   void RegisterTimeListener(TimeListener* agent);
 
+  /// Makes room for n more time listeners, e.g., before a batch of agents
+  /// is built (see Context::BuildAgents).
+  void ReserveTimeListeners(int n);
+
   /// Removes an agent from receiving tick/tock notifications.
   /// Agents should unregister from their Decommission method.
   void UnregisterTimeListener(TimeListener* tl);
 
+  /// Puts a registered listener to sleep until timestep t. A sleeping
+  /// listener is skipped in the Tick, Tock, and Decision phases, and an agent
+  /// whose listener is asleep is left out of resource exchanges, until t.
+  /// Sleeping until the current time or earlier wakes the listener up.
+  /// Timesteps in which every listener and trader is asleep and nothing is
+  /// scheduled to be built or decommissioned are skipped over entirely.
+  void SleepUntil(TimeListener* tl, int t);
+
+  /// Returns true if the listener with the given id is registered and
+  /// asleep.
+  bool asleep(int id);
 
   /// Schedules the named prototype to be built for the specified parent at
   /// timestep t.
   void SchedBuild(Agent* parent, std::string proto_name, int t);
 
+  /// Schedules count agents of the named prototype to be built for the
+  /// specified parent at each of the given timesteps.
+  void SchedBuilds(Agent* parent, const std::string& proto_name, int count,
+                   const std::vector<int>& times);
+
   /// Schedules the given Agent to be decommissioned at the specified
   /// timestep t.
   void SchedDecom(Agent* m, int time);
@@ -64,12 +113,31 @@ class Timer {
   /// @return the current time
   int time();
 
+  /// Returns the length of the current step, in months (see
+  /// SimInfo::step_schedule).
+  inline int step() const { return step_; }
+
   /// Returns the duration of the simulation this Timer's timing.
   ///
   /// @return the duration, in months
   int dur();
 
+  /// @brief the number of threads used to run thread-safe time listeners,
+  /// which is always one in builds that count references to resources
+  /// non-atomically (see IntrusiveBase)
+  /// @{
+  inline int threads() const { return threads_; }
+  inline void threads(int n) {
+    threads_ = n < 1 || !CYCLUS_ATOMIC_REFCOUNT ? 1 : n;
+  }
+  /// @}
+
  private:
+  /// takes a snapshot, has it flushed to the output database in the
+  /// background, and marks it complete in the Checkpoints table once it is
+  /// written.
+  void Checkpoint();
+
   /// builds all agents queued for the current timestep.
   void DoBuild();
 
@@ -89,31 +157,137 @@ class Timer {
   /// notifications.
   void DoDecision();
 
+  /// notifies the observers registered on the context that the current time
+  /// step has begun.
+  void StepBegin();
+
+  /// notifies the observers that phase has ended, if it started at *start,
+  /// and sets *start to now.
+  void PhaseEnd(const char* phase,
+                std::chrono::steady_clock::time_point* start);
+
+  /// notifies the observers that the current time step has ended.
+  void StepEnd();
+
+  /// calls phase on every time listener, running the thread-safe ones
+  /// concurrently first and then the others in order. The data recorded and
+  /// the schedulings done by the thread-safe listeners are applied in
+  /// listener order afterwards. If any listener throws, the exception of the
+  /// first such listener is rethrown once all have run, and nothing done by
+  /// it or by later thread-safe listeners is applied.
+  ///
+  /// If start is not NULL, it is called on every listener before anything
+  /// else, and the listeners that return a valid future are run in order
+  /// with the others, once their future is ready.
+  void RunPhase(void (TimeListener::*phase)(),
+                std::future<void> (TimeListener::*start)() = NULL);
+
+  /// drops the tombstones from tickers_ and adds the pending listeners.
+  void CompactTickers();
+
+  /// returns the index of the listener with the given id in tickers_, or -1.
+  int TickerIndex(int id);
+
+  /// whether the listener at index i of tickers_ is to be run this timestep.
+  inline bool awake(int i) {
+    return tickers_[i] != NULL && ticker_wakes_[i] <= time_;
+  }
+
+  /// wakes the listeners whose sleep ends at the current time.
+  void WakeListeners();
+
+  /// advances time_ past the timesteps in which nothing can happen, up to
+  /// end at most.
+  void SkipIdleSteps(int end);
+
+  /// returns the time the step after the current one starts at: the end of
+  /// the current step of the step schedule, or the first time after the
+  /// current one that a build, decommissioning or wakeup is scheduled for,
+  /// or end, whichever is earliest.
+  int NextStep(int end);
+
+  /// returns the earliest time a sleeping listener wakes up at, or -1 if
+  /// none is asleep, dropping the stale entries of wakeups_.
+  int NextWakeup();
+
+  /// adds m to the decommissioning queue for time t.
+  void QueueDecom(Agent* m, int t);
+
   void RecordInventories(Agent* a);
-  void RecordInventory(Agent* a, std::string name, Material::Ptr m);
+  void RecordInventory(Agent* a, const std::string& name,
+                       const InvSummary& inv);
 
   /// decommissions all agents queued for the current timestep.
   void DoDecom();
 
+  /// returns the interned id of the named prototype.
+  int ProtoId(const std::string& name);
+
+  /// adds count builds of the interned prototype proto to the queue for t.
+  void QueueBuilds(Agent* parent, int proto, int count, int t);
+
   Context* ctx_;
 
   /// The current time, measured in months from when the simulation
   /// started.
   int time_;
 
-  SimInfo si_;
-
-  bool want_snapshot_;
-  bool want_kill_;
+  /// The length of the current step, in months.
+  int step_;
 
-  /// Concrete agents that desire to receive tick and tock notifications
-  std::map<int, TimeListener*> tickers_;
+  SimInfo si_;
 
-  // std::map<time,std::vector<std::pair<prototype, parent> > >
-  std::map<int, std::vector<std::pair<std::string, Agent*> > > build_queue_;
+  std::atomic<bool> want_snapshot_;
+  std::atomic<bool> want_kill_;
+  int threads_;
+
+  /// Concrete agents that desire to receive tick and tock notifications, in
+  /// id order. Unregistering a listener leaves a NULL tombstone in its place;
+  /// tombstones are compacted away at the start of the next phase.
+  std::vector<TimeListener*> tickers_;
+  std::vector<int> ticker_ids_;
+  int ntombstones_;
+
+  /// the time each listener in tickers_ sleeps until, or zero if awake.
+  std::vector<int> ticker_wakes_;
+  int nsleeping_;
+
+  /// (wake time, listener id) of the sleeping listeners, earliest first.
+  /// Entries are left in place when a listener is woken, unregistered, or
+  /// put back to sleep, and skipped once they no longer match ticker_wakes_.
+  typedef std::pair<int, int> Wakeup;
+  std::priority_queue<Wakeup, std::vector<Wakeup>, std::greater<Wakeup> >
+      wakeups_;
+
+  /// listeners registered during a phase that do not belong at the end of
+  /// tickers_; they are added at the start of the next phase.
+  std::vector<TimeListener*> pending_tickers_;
+
+  /// whether a phase is iterating over tickers_.
+  bool iterating_;
+
+  /// count builds of the interned prototype proto for parent.
+  struct BuildBatch {
+    int proto;
+    Agent* parent;
+    int count;
+  };
+
+  /// the builds queued for each time, in the order they were scheduled.
+  std::map<int, std::vector<BuildBatch> > build_queue_;
+
+  /// the names of the prototypes that builds were scheduled for, indexed
+  /// by an interned id, and the id of each name.
+  std::vector<std::string> proto_names_;
+  std::unordered_map<std::string, int> proto_ids_;
+  std::mutex proto_mu_;
 
   // std::map<time,std::vector<config> >
   std::map<int, std::vector<Agent*> > decom_queue_;
+
+  /// the time and index in decom_queue_ at which each agent is queued.
+  typedef std::pair<int, size_t> DecomSlot;
+  std::unordered_map<Agent*, DecomSlot> decom_slots_;
 };
 
 }  // namespace cyclus
@@ -1,5 +1,7 @@
 #include "building_manager.h"
 
+#include <cmath>
+
 #include "prog_translator.h"
 #include "CoinPackedVector.hpp"
 
@@ -18,76 +20,111 @@ BuildOrder::BuildOrder(int n, Builder* b, CommodityProducer* cp)
 std::vector<BuildOrder> BuildingManager::MakeBuildDecision(Commodity& commodity,
                                                            double demand) {
   std::vector<BuildOrder> orders;
-  if (demand > 0) {
-    OsiCbcSolverInterface iface;
-    ProgTranslatorContext ctx;
-    std::map<CommodityProducer*, Builder*> p_to_b;
-    std::map<int, CommodityProducer*> idx_to_p;
-    SetUp_(iface, ctx, p_to_b, idx_to_p, commodity, demand);
-    Solve_(iface, ctx, p_to_b, idx_to_p, orders);
+  if (demand <= 0) {
+    return orders;
   }
-  return orders;
-}
 
-void BuildingManager::SetUp_(OsiCbcSolverInterface& iface,
-                             ProgTranslatorContext& ctx,
-                             std::map<CommodityProducer*, Builder*>& p_to_b,
-                             std::map<int, CommodityProducer*>& idx_to_p,
-                             Commodity& commodity,
-                             double demand) {
-  CoinPackedVector caps;
+  Model cur;
   std::set<Builder*>::iterator bit;
   std::set<CommodityProducer*>::iterator pit;
-  CommodityProducer* p;
-  Builder* b;
-  int idx = 0;
-  double inf = iface.getInfinity();
   for (bit = builders_.begin(); bit != builders_.end(); ++bit) {
-    b = *bit;
+    Builder* b = *bit;
     for (pit = b->producers().begin(); pit != b->producers().end(); ++pit) {
-      p = *pit;
+      CommodityProducer* p = *pit;
       if (p->Produces(commodity)) {
-        ctx.obj_coeffs.push_back(p->Cost(commodity));
-        caps.insert(idx, p->Capacity(commodity));
-        ctx.col_lbs.push_back(0);
-        ctx.col_ubs.push_back(inf);
-        p_to_b[p] = b;
-        idx_to_p[idx] = p;
-        idx++;
+        cur.producers.push_back(p);
+        cur.builders.push_back(b);
+        cur.costs.push_back(p->Cost(commodity));
+        cur.caps.push_back(p->Capacity(commodity));
       }
     }
   }
+  if (cur.producers.empty()) {
+    return orders;
+  }
+
+  int i = Dominant_(cur);
+  if (i >= 0) {
+    int n = static_cast<int>(std::ceil(demand / cur.caps[i]));
+    orders.push_back(BuildOrder(n, cur.builders[i], cur.producers[i]));
+    return orders;
+  }
+
+  Model& m = models_[commodity.name()];
+  bool warm = m.iface.get() != NULL && m.producers == cur.producers &&
+              m.builders == cur.builders && m.costs == cur.costs &&
+              m.caps == cur.caps;
+  if (warm) {
+    m.iface->setRowLower(0, demand);
+  } else {
+    m = cur;
+    SetUp_(m, demand);
+  }
+  Solve_(m, warm, orders);
+  return orders;
+}
+
+int BuildingManager::Dominant_(const Model& m) {
+  int best = 0;
+  for (int i = 1; i < m.producers.size(); i++) {
+    if (m.costs[i] < m.costs[best] ||
+        (m.costs[i] == m.costs[best] && m.caps[i] > m.caps[best])) {
+      best = i;
+    }
+  }
+  if (m.caps[best] <= 0) {
+    return -1;
+  }
+  for (int i = 0; i < m.producers.size(); i++) {
+    if (m.caps[i] > m.caps[best]) {
+      return -1;
+    }
+  }
+  return best;
+}
+
+void BuildingManager::SetUp_(Model& m, double demand) {
+  m.iface.reset(new OsiCbcSolverInterface());
+  ProgTranslatorContext ctx;
+  CoinPackedVector caps;
+  double inf = m.iface->getInfinity();
+  int nvar = m.producers.size();
+  for (int i = 0; i != nvar; i++) {
+    ctx.obj_coeffs.push_back(m.costs[i]);
+    caps.insert(i, m.caps[i]);
+    ctx.col_lbs.push_back(0);
+    ctx.col_ubs.push_back(inf);
+  }
   ctx.row_ubs.push_back(inf);
   ctx.row_lbs.push_back(demand);
-  ctx.m.setDimensions(0, ctx.col_ubs.size());
+  ctx.m.setDimensions(0, nvar);
   ctx.m.appendRow(caps);
+
+  m.iface->setObjSense(1.0);  // minimize
+  m.iface->loadProblem(ctx.m, &ctx.col_lbs[0], &ctx.col_ubs[0],
+                       &ctx.obj_coeffs[0], &ctx.row_lbs[0], &ctx.row_ubs[0]);
+  for (int i = 0; i != nvar; i++) {
+    m.iface->setInteger(i);
+  }
 }
 
-void BuildingManager::Solve_(OsiCbcSolverInterface& iface,
-                             ProgTranslatorContext& ctx,
-                             std::map<CommodityProducer*, Builder*>& p_to_b,
-                             std::map<int, CommodityProducer*>& idx_to_p,
+void BuildingManager::Solve_(Model& m, bool warm,
                              std::vector<BuildOrder>& orders) {
-  int nvar = ctx.col_ubs.size();
-  iface.setObjSense(1.0);  // minimize
-  iface.loadProblem(ctx.m, &ctx.col_lbs[0], &ctx.col_ubs[0],
-                    &ctx.obj_coeffs[0], &ctx.row_lbs[0], &ctx.row_ubs[0]);
-  for (int i = 0; i != nvar; i++) {
-    iface.setInteger(i);
+  // a kept model resolves its relaxation from the last basis
+  if (warm) {
+    m.iface->resolve();
+  } else {
+    m.iface->initialSolve();
   }
-  iface.initialSolve();
-  iface.branchAndBound();
+  m.iface->branchAndBound();
 
-  const double* sol = iface.getColSolution();
+  const double* sol = m.iface->getColSolution();
+  int nvar = m.producers.size();
   int n;
-  CommodityProducer* p;
-  Builder* b;
   for (int i = 0; i != nvar; i++) {
     n = static_cast<int>(sol[i]);
     if (n > 0) {
-      p = idx_to_p[i];
-      b = p_to_b[p];
-      orders.push_back(BuildOrder(n, b, p));
+      orders.push_back(BuildOrder(n, m.builders[i], m.producers[i]));
     }
   }
 }
@@ -2,8 +2,11 @@
 #define CYCLUS_SRC_TOOLKIT_BUILDING_MANAGER_H_
 
 #include <map>
+#include <string>
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+
 #include "agent_managed.h"
 #include "builder.h"
 #include "commodity_producer.h"
@@ -11,9 +14,6 @@
 class OsiCbcSolverInterface;
 
 namespace cyclus {
-
-class ProgTranslatorContext;
-
 namespace toolkit {
 
 /// A struct for a build order: the number of producers to build.
@@ -43,6 +43,11 @@ struct BuildOrder {
 /// cost to build the object of type i, \f$\phi_i\f$ is the nameplate
 /// capacity of the object, and \f$\Phi\f$ is the capacity demand. Here
 /// the set I corresponds to all producers of a given commodity.
+///
+/// The program of each commodity is kept between decisions, so that when
+/// only the demand has changed, the solver is warm-started from its last
+/// solution rather than rebuilt. When one producer is both the cheapest and
+/// the largest, building enough of it is optimal, and no program is solved.
 class BuildingManager : public AgentManaged {
  public:
   BuildingManager(Agent* agent = NULL) : AgentManaged(agent) {}
@@ -70,20 +75,29 @@ class BuildingManager : public AgentManaged {
   }
 
  private:
+  /// The integer program of a commodity: its solver, and the producers,
+  /// with their builders, costs, and capacities, that its variables stand
+  /// for.
+  struct Model {
+    boost::shared_ptr<OsiCbcSolverInterface> iface;
+    std::vector<CommodityProducer*> producers;
+    std::vector<Builder*> builders;
+    std::vector<double> costs;
+    std::vector<double> caps;
+  };
+
   std::set<Builder*> builders_;
 
-  void SetUp_(OsiCbcSolverInterface& iface,
-              ProgTranslatorContext& ctx,
-              std::map<CommodityProducer*, Builder*>& p_to_b,
-              std::map<int, CommodityProducer*>& idx_to_p,
-              Commodity& commodity,
-              double demand);
-
-  void Solve_(OsiCbcSolverInterface& iface,
-              ProgTranslatorContext& ctx,
-              std::map<CommodityProducer*, Builder*>& p_to_b,
-              std::map<int, CommodityProducer*>& idx_to_p,
-              std::vector<BuildOrder>& orders);
+  /// the program last solved for each commodity
+  std::map<std::string, Model> models_;
+
+  /// Returns the index of the producer in m that is both the cheapest and
+  /// the largest, or -1 if there is none.
+  int Dominant_(const Model& m);
+
+  void SetUp_(Model& m, double demand);
+
+  void Solve_(Model& m, bool warm, std::vector<BuildOrder>& orders);
 };
 
 }  // namespace toolkit
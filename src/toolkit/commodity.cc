@@ -1,13 +1,17 @@
 #include "commodity.h"
 
+#include "commodity_registry.h"
+
 namespace cyclus {
 namespace toolkit {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-Commodity::Commodity() : name_("") {}
+Commodity::Commodity() : name_(""), id_(0) {}
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-Commodity::Commodity(std::string name) : name_(name) {}
+Commodity::Commodity(std::string name)
+    : name_(name),
+      id_(CommodityRegistry::Intern(name)) {}
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 std::string Commodity::name() const {
@@ -16,7 +20,7 @@ std::string Commodity::name() const {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 bool Commodity::operator==(const Commodity& other) const {
-  return (name_ == other.name());
+  return id_ == other.id_;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
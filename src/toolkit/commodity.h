@@ -21,7 +21,10 @@ class Commodity {
   /// The commodity's name
   std::string name() const;
 
-  /// Equality operator
+  /// The id of the commodity's name (see CommodityRegistry)
+  inline int id() const { return id_; }
+
+  /// Equality operator, which compares ids
   bool operator==(const Commodity& other) const;
 
   /// Inequality operator
@@ -30,6 +33,9 @@ class Commodity {
  private:
   /// The name of the commodity
   std::string name_;
+
+  /// The id of the commodity's name
+  int id_;
 };
 
 /// A comparator so that commodities may be used in maps
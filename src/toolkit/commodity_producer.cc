@@ -1,5 +1,7 @@
 #include "commodity_producer.h"
 
+#include "commodity_producer_manager.h"
+
 namespace cyclus {
 namespace toolkit {
 
@@ -14,7 +16,20 @@ CommodityProducer::CommodityProducer(double default_capacity,
       default_capacity_(default_capacity),
       default_cost_(default_cost) {}
 
-CommodityProducer::~CommodityProducer() {}
+CommodityProducer::~CommodityProducer() {
+  std::set<CommodityProducerManager*> managers = managers_;
+  std::set<CommodityProducerManager*>::iterator it;
+  for (it = managers.begin(); it != managers.end(); ++it) {
+    (*it)->Unregister(this);
+  }
+}
+
+void CommodityProducer::Changed_(const Commodity& commodity) {
+  std::set<CommodityProducerManager*>::iterator it;
+  for (it = managers_.begin(); it != managers_.end(); ++it) {
+    (*it)->Changed_(commodity);
+  }
+}
 
 std::set<Commodity, CommodityCompare> CommodityProducer::ProducedCommodities() {
   std::set<Commodity, CommodityCompare> commodities;
@@ -11,6 +11,8 @@
 namespace cyclus {
 namespace toolkit {
 
+class CommodityProducerManager;
+
 /// A container to hold information about a commodity
 struct CommodInfo {
   CommodInfo(double default_capacity = 0,
@@ -50,6 +52,7 @@ class CommodityProducer : public AgentManaged {
   /// @param capacity the production capacity
   inline void SetCapacity(const Commodity& commodity, double capacity) {
     commodities_[commodity].capacity = capacity;
+    Changed_(commodity);
   }
 
   /// Set the production cost for a given commodity
@@ -71,12 +74,14 @@ class CommodityProducer : public AgentManaged {
   /// @param info the information describing the commodity
   inline void Add(const Commodity& commodity, const CommodInfo& info) {
     commodities_.insert(std::make_pair(commodity, info));
+    Changed_(commodity);
   }
 
   /// Unregister a commodity as being produced by this object
   /// @param commodity the commodity being produced
   inline void Rm(const Commodity& commodity) {
     commodities_.erase(commodity);
+    Changed_(commodity);
   }
 
   /// @return the set of commodities produced by this producers
@@ -87,9 +92,19 @@ class CommodityProducer : public AgentManaged {
   void Copy(CommodityProducer* source);
 
  private:
+  friend class CommodityProducerManager;
+
+  /// tells the managers of this producer that its capacity for a commodity
+  /// may have changed
+  void Changed_(const Commodity& commodity);
+
   /// A collection of commodities and their production capacities
   std::map<Commodity, CommodInfo, CommodityCompare> commodities_;
 
+  /// The managers this producer is registered with, which keep totals of
+  /// its capacities
+  std::set<CommodityProducerManager*> managers_;
+
   /// A default production capacity
   double default_capacity_;
 
@@ -3,8 +3,36 @@
 namespace cyclus {
 namespace toolkit {
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+CommodityProducerManager::~CommodityProducerManager() {
+  std::set<CommodityProducer*>::iterator it;
+  for (it = producers_.begin(); it != producers_.end(); ++it) {
+    (*it)->managers_.erase(this);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CommodityProducerManager::Register(CommodityProducer* producer) {
+  producers_.insert(producer);
+  producer->managers_.insert(this);
+  totals_.clear();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CommodityProducerManager::Unregister(CommodityProducer* producer) {
+  if (producers_.erase(producer) > 0) {
+    producer->managers_.erase(this);
+    totals_.clear();
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 double CommodityProducerManager::TotalCapacity(Commodity& commodity) {
+  std::map<Commodity, double, CommodityCompare>::iterator cached =
+      totals_.find(commodity);
+  if (cached != totals_.end()) {
+    return cached->second;
+  }
   double total = 0.0;
   std::set<CommodityProducer*>::iterator it;
   CommodityProducer* p;
@@ -13,6 +41,7 @@ double CommodityProducerManager::TotalCapacity(Commodity& commodity) {
     if (p->Produces(commodity))
       total += p->Capacity(commodity);
   }
+  totals_[commodity] = total;
   return total;
 }
 
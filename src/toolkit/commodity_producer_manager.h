@@ -1,6 +1,7 @@
 #ifndef CYCLUS_SRC_TOOLKIT_COMMODITY_PRODUCER_MANAGER_H_
 #define CYCLUS_SRC_TOOLKIT_COMMODITY_PRODUCER_MANAGER_H_
 
+#include <map>
 #include <set>
 
 #include "agent_managed.h"
@@ -14,31 +15,41 @@ namespace toolkit {
 class CommodityProducerManager : public AgentManaged {
  public:
   CommodityProducerManager(Agent* agent = NULL) : AgentManaged(agent) {}
-  virtual ~CommodityProducerManager() {}
+  virtual ~CommodityProducerManager();
 
-  /// @return the total production capacity for a commodity amongst producers
+  /// @return the total production capacity for a commodity amongst
+  /// producers. Totals are kept between calls, and only summed again once a
+  /// producer of the commodity changes its capacity or is registered or
+  /// unregistered.
   /// @param commodity the commodity in question
   double TotalCapacity(Commodity& commodity);
 
   /// Register a commodity producer with the manager
   /// @param producer the producer
-  inline void Register(CommodityProducer* producer) {
-    producers_.insert(producer);
-  }
+  void Register(CommodityProducer* producer);
 
   /// Unregister a commodity producer with the manager
   /// @param producer the producer
-  inline void Unregister(CommodityProducer* producer) {
-    producers_.erase(producer);
-  }
+  void Unregister(CommodityProducer* producer);
 
   inline const std::set<CommodityProducer*>& producers() const {
     return producers_;
   }
 
  private:
+  friend class CommodityProducer;
+
+  /// forgets the total capacity for a commodity
+  inline void Changed_(const Commodity& commodity) {
+    totals_.erase(commodity);
+  }
+
   /// The set of managed producers
   std::set<CommodityProducer*> producers_;
+
+  /// The total capacities of the commodities asked for since they last
+  /// changed
+  std::map<Commodity, double, CommodityCompare> totals_;
 };
 
 }  // namespace toolkit
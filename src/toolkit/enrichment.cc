@@ -129,5 +129,107 @@ double SwuRequired(double product_qty, const Assays& assays) {
   return swu;
 }
 
+namespace {
+
+// Throws unless there is an assay for each amount, and each is in [0, 1).
+void CheckBatch(const std::vector<double>& product_qty,
+                const std::vector<double>& product_assay) {
+  if (product_qty.size() != product_assay.size()) {
+    std::stringstream msg;
+    msg << "There are " << product_qty.size() << " product amounts but "
+        << product_assay.size() << " product assays.";
+    throw ValueError(msg.str());
+  }
+  for (int i = 0; i < product_assay.size(); ++i) {
+    // ValueFunc throws for the same assays
+    if (product_assay[i] < 0 || product_assay[i] >= 1) {
+      ValueFunc(product_assay[i]);
+    }
+  }
+}
+
+// The kernels of FeedQty and TailsQty, which differ only in the assay the
+// product assay is measured from.
+std::vector<double> Batch(const std::vector<double>& product_qty,
+                          const std::vector<double>& product_assay,
+                          double from, double feed, double tails) {
+  CheckBatch(product_qty, product_assay);
+  int n = product_qty.size();
+  std::vector<double> out(n);
+  const double* p = n > 0 ? &product_qty[0] : NULL;
+  const double* xp = n > 0 ? &product_assay[0] : NULL;
+  double* o = n > 0 ? &out[0] : NULL;
+  double k = 1 / (feed - tails);
+  for (int i = 0; i < n; ++i) {
+    o[i] = p[i] * (xp[i] - from) * k;
+  }
+  return out;
+}
+
+}  // namespace
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+std::vector<double> FeedQty(const std::vector<double>& product_qty,
+                            const std::vector<double>& product_assay,
+                            double feed, double tails) {
+  return Batch(product_qty, product_assay, tails, feed, tails);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+std::vector<double> TailsQty(const std::vector<double>& product_qty,
+                             const std::vector<double>& product_assay,
+                             double feed, double tails) {
+  return Batch(product_qty, product_assay, feed, feed, tails);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+std::vector<double> SwuRequired(const std::vector<double>& product_qty,
+                                const std::vector<double>& product_assay,
+                                double feed, double tails) {
+  CheckBatch(product_qty, product_assay);
+  double vf = ValueFunc(feed);
+  double vt = ValueFunc(tails);
+  double k = 1 / (feed - tails);
+  int n = product_qty.size();
+  std::vector<double> out(n);
+  const double* p = n > 0 ? &product_qty[0] : NULL;
+  const double* xp = n > 0 ? &product_assay[0] : NULL;
+  double* swu = n > 0 ? &out[0] : NULL;
+  for (int i = 0; i < n; ++i) {
+    double x = xp[i];
+    double f = p[i] * (x - tails) * k;
+    double t = p[i] * (x - feed) * k;
+    double vp = (1 - 2 * x) * std::log(1 / x - 1);
+    swu[i] = p[i] * vp + t * vt - f * vf;
+  }
+  return out;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double AssayCache::Atom(Material::Ptr mat) {
+  int id = mat->comp()->id();
+  std::map<int, double>::iterator it = atom_.find(id);
+  if (it != atom_.end()) {
+    return it->second;
+  }
+  return atom_[id] = UraniumAssayAtom(mat);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double AssayCache::Mass(Material::Ptr mat) {
+  int id = mat->comp()->id();
+  std::map<int, double>::iterator it = mass_.find(id);
+  if (it != mass_.end()) {
+    return it->second;
+  }
+  return mass_[id] = UraniumAssayMass(mat);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void AssayCache::clear() {
+  atom_.clear();
+  mass_.clear();
+}
+
 }  // namespace toolkit
 }  // namespace cyclus
@@ -1,7 +1,9 @@
 #ifndef CYCLUS_SRC_TOOLKIT_ENRICHMENT_H_
 #define CYCLUS_SRC_TOOLKIT_ENRICHMENT_H_
 
+#include <map>
 #include <set>
+#include <vector>
 
 #include "material.h"
 
@@ -72,6 +74,55 @@ double TailsQty(double product_qty, const Assays& assays);
 /// @return the amount of swu required to enrich the product
 double SwuRequired(double product_qty, const Assays& assays);
 
+/// Batch versions of FeedQty, TailsQty, and SwuRequired for enriching many
+/// products from the same feed to the same tails, as an enrichment facility
+/// does when pricing the requests of a time step. The value functions of
+/// the feed and tails are computed once, and the loops over the products
+/// have no branches so that compilers can vectorize them.
+///
+/// @param product_qty the amounts of product Uranium
+/// @param product_assay the assays of the products, one per amount
+/// @param feed the feed assay
+/// @param tails the tails assay
+/// @return the quantities of feed or tails, or the swu, for each product
+/// @throws ValueError if the numbers of amounts and assays differ, or if
+/// an assay is outside [0, 1)
+/// @{
+std::vector<double> FeedQty(const std::vector<double>& product_qty,
+                            const std::vector<double>& product_assay,
+                            double feed, double tails);
+std::vector<double> TailsQty(const std::vector<double>& product_qty,
+                             const std::vector<double>& product_assay,
+                             double feed, double tails);
+std::vector<double> SwuRequired(const std::vector<double>& product_qty,
+                                const std::vector<double>& product_assay,
+                                double feed, double tails);
+/// @}
+
+/// Caches the uranium assays of materials by composition, for agents that
+/// query the assays of the same few feeds many times per time step.
+/// Compositions are immutable and a material gets a new one whenever its
+/// isotopics change, so cached assays never go stale, but the cache grows
+/// with the compositions seen until it is cleared.
+class AssayCache {
+ public:
+  /// @return the atom assay of a material, as UraniumAssayAtom
+  double Atom(Material::Ptr mat);
+
+  /// @return the mass assay of a material, as UraniumAssayMass
+  double Mass(Material::Ptr mat);
+
+  /// @return the number of compositions cached
+  int size() const { return atom_.size() + mass_.size(); }
+
+  /// Forgets every cached assay.
+  void clear();
+
+ private:
+  std::map<int, double> atom_;
+  std::map<int, double> mass_;
+};
+
 /// @param frac the fraction input, this will throw if the fraction
 /// value is not in [0,1)
 /// @return the value function for a given fraction in [0,1)
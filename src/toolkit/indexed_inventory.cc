@@ -0,0 +1,128 @@
+#include "indexed_inventory.h"
+
+#include <sstream>
+
+#include "enrichment.h"
+#include "error.h"
+
+namespace cyclus {
+namespace toolkit {
+
+IndexedInventory::IndexedInventory() : qty_(0) {}
+
+double IndexedInventory::quantity(const std::string& commod) const {
+  std::map<std::string, CommodIndex>::const_iterator it = commods_.find(commod);
+  return it == commods_.end() ? 0 : it->second.qty;
+}
+
+void IndexedInventory::Push(Material::Ptr m, const std::string& commod) {
+  Push(m, commod, UraniumAssay(m));
+}
+
+void IndexedInventory::Push(Material::Ptr m, const std::string& commod,
+                            double assay) {
+  int id = m->obj_id();
+  if (entries_.count(id) > 0) {
+    std::stringstream ss;
+    ss << "material " << id << " is already in the inventory";
+    throw KeyError(ss.str());
+  }
+  CommodIndex& ci = commods_[commod];
+  Entry& e = entries_[id];
+  e.mat = m;
+  e.commod = commod;
+  e.assay = assay;
+  e.by_assay = ci.by_assay.insert(std::make_pair(assay, id));
+  e.by_time = ci.by_time.insert(std::make_pair(m->prev_decay_time(), id));
+  ci.qty += m->quantity();
+  qty_ += m->quantity();
+}
+
+Material::Ptr IndexedInventory::Pop(int obj_id) {
+  std::map<int, Entry>::iterator it = entries_.find(obj_id);
+  if (it == entries_.end()) {
+    std::stringstream ss;
+    ss << "material " << obj_id << " is not in the inventory";
+    throw KeyError(ss.str());
+  }
+  Entry& e = it->second;
+  Material::Ptr m = e.mat;
+  std::map<std::string, CommodIndex>::iterator cit = commods_.find(e.commod);
+  CommodIndex& ci = cit->second;
+  ci.by_assay.erase(e.by_assay);
+  ci.by_time.erase(e.by_time);
+  ci.qty -= m->quantity();
+  qty_ -= m->quantity();
+  if (ci.by_assay.empty()) {
+    commods_.erase(cit);
+  }
+  entries_.erase(it);
+  if (entries_.empty()) {
+    // no sums of rounding errors once empty
+    qty_ = 0;
+  }
+  return m;
+}
+
+Material::Ptr IndexedInventory::ClosestAssay(const std::string& commod,
+                                             double assay) const {
+  std::map<std::string, CommodIndex>::const_iterator cit =
+      commods_.find(commod);
+  if (cit == commods_.end()) {
+    return Material::Ptr();
+  }
+  const AssayIndex& idx = cit->second.by_assay;
+  AssayIndex::const_iterator above = idx.lower_bound(assay);
+  AssayIndex::const_iterator best = above;
+  if (above == idx.end()) {
+    best = --above;
+  } else if (above != idx.begin()) {
+    AssayIndex::const_iterator below = above;
+    --below;
+    // the first of the lower assay, which was pushed first
+    AssayIndex::const_iterator first = idx.lower_bound(below->first);
+    if (assay - below->first <= above->first - assay) {
+      best = first;
+    }
+  }
+  return entries_.find(best->second)->second.mat;
+}
+
+std::vector<Material::Ptr> IndexedInventory::AssayRange(
+    const std::string& commod, double lo, double hi) const {
+  std::vector<Material::Ptr> mats;
+  std::map<std::string, CommodIndex>::const_iterator cit =
+      commods_.find(commod);
+  if (cit == commods_.end()) {
+    return mats;
+  }
+  const AssayIndex& idx = cit->second.by_assay;
+  AssayIndex::const_iterator it = idx.lower_bound(lo);
+  AssayIndex::const_iterator end = idx.upper_bound(hi);
+  for (; it != end; ++it) {
+    mats.push_back(entries_.find(it->second)->second.mat);
+  }
+  return mats;
+}
+
+Material::Ptr IndexedInventory::Oldest(const std::string& commod) const {
+  std::map<std::string, CommodIndex>::const_iterator cit =
+      commods_.find(commod);
+  if (cit == commods_.end()) {
+    return Material::Ptr();
+  }
+  return entries_.find(cit->second.by_time.begin()->second)->second.mat;
+}
+
+double IndexedInventory::Assay(int obj_id) const {
+  std::map<int, Entry>::const_iterator it = entries_.find(obj_id);
+  if (it == entries_.end()) {
+    std::stringstream ss;
+    ss << "material " << obj_id << " is not in the inventory";
+    throw KeyError(ss.str());
+  }
+  return it->second.assay;
+}
+
+}  // namespace toolkit
+}  // namespace cyclus
@@ -0,0 +1,124 @@
+#ifndef CYCLUS_SRC_TOOLKIT_INDEXED_INVENTORY_H_
+#define CYCLUS_SRC_TOOLKIT_INDEXED_INVENTORY_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "material.h"
+
+namespace cyclus {
+namespace toolkit {
+
+/// IndexedInventory holds materials by commodity, and indexes those of each
+/// commodity by their uranium assay and by the time they were last decayed.
+/// It answers the questions archetypes ask of their inventories when bidding
+/// - which material is closest to a requested assay, which are within a
+/// range of assays, which is the oldest - in logarithmic rather than linear
+/// time, without computing any assay more than once.
+///
+/// @code
+/// class YourAgent : public cyclus::Facility {
+///  public:
+///   void AcceptMatlTrades(...) {
+///     inventory_.Push(mat, commod);
+///   }
+///
+///   std::set<BidPortfolio<Material>::Ptr> GetMatlBids(...) {
+///     ...
+///     Material::Ptr best = inventory_.ClosestAssay(
+///         commod, UraniumAssay(req->target()));
+///     ...
+///   }
+///
+///  private:
+///   cyclus::toolkit::IndexedInventory inventory_;
+/// };
+/// @endcode
+///
+/// Materials are indexed as they are pushed, so they must not be changed
+/// while they are held; pop a material before transmuting, decaying, or
+/// splitting it, and push what is left back.
+class IndexedInventory {
+ public:
+  IndexedInventory();
+
+  /// Returns the number of materials held.
+  inline int count() const { return entries_.size(); }
+
+  /// Returns whether no materials are held.
+  inline bool empty() const { return entries_.empty(); }
+
+  /// Returns the total quantity of the materials held.
+  inline double quantity() const { return qty_; }
+
+  /// Returns the total quantity of the materials of a commodity held.
+  double quantity(const std::string& commod) const;
+
+  /// Returns whether the material with the given object id is held.
+  inline bool Has(int obj_id) const { return entries_.count(obj_id) > 0; }
+
+  /// Adds a material of a commodity, indexing it by its uranium assay (see
+  /// UraniumAssay) or by the given assay.
+  ///
+  /// @throws KeyError if the material is already held
+  /// @{
+  void Push(Material::Ptr m, const std::string& commod);
+  void Push(Material::Ptr m, const std::string& commod, double assay);
+  /// @}
+
+  /// Removes and returns the material with the given object id.
+  ///
+  /// @throws KeyError if the material isn't held
+  Material::Ptr Pop(int obj_id);
+
+  /// Returns the material of a commodity whose assay is closest to the
+  /// given one, preferring the lower of two equally close, or a null
+  /// pointer if none of the commodity are held. The material is not
+  /// removed.
+  Material::Ptr ClosestAssay(const std::string& commod, double assay) const;
+
+  /// Returns the materials of a commodity whose assays are within [lo, hi],
+  /// in order of increasing assay.
+  std::vector<Material::Ptr> AssayRange(const std::string& commod, double lo,
+                                        double hi) const;
+
+  /// Returns the material of a commodity that was decayed longest ago, or
+  /// a null pointer if none of the commodity are held.
+  Material::Ptr Oldest(const std::string& commod) const;
+
+  /// Returns the assay a held material is indexed by.
+  ///
+  /// @throws KeyError if the material isn't held
+  double Assay(int obj_id) const;
+
+ private:
+  typedef std::multimap<double, int> AssayIndex;
+  typedef std::multimap<int, int> TimeIndex;
+
+  /// a held material and where it is in the indexes of its commodity
+  struct Entry {
+    Material::Ptr mat;
+    std::string commod;
+    double assay;
+    AssayIndex::iterator by_assay;
+    TimeIndex::iterator by_time;
+  };
+
+  /// the indexes of the materials of a commodity
+  struct CommodIndex {
+    CommodIndex() : qty(0) {}
+    AssayIndex by_assay;
+    TimeIndex by_time;
+    double qty;
+  };
+
+  std::map<int, Entry> entries_;
+  std::map<std::string, CommodIndex> commods_;
+  double qty_;
+};
+
+}  // namespace toolkit
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_TOOLKIT_INDEXED_INVENTORY_H_
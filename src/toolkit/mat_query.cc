@@ -1,4 +1,5 @@
 #include "mat_query.h"
+#include "nuc_registry.h"
 #include "pyne.h"
 
 #include <cmath>
@@ -17,13 +18,12 @@ double MatQuery::mass(Nuc nuc) {
 }
 
 double MatQuery::moles(Nuc nuc) {
-  return mass(nuc) / (pyne::atomic_mass(nuc) * units::g);
+  return mass(nuc) / (compmath::AtomicMass(nuc) * units::g);
 }
 
 double MatQuery::mass_frac(Nuc nuc) {
-  CompMap v = m_->comp()->mass();
-  compmath::Normalize(&v);
-  return v[nuc];
+  const CompVec& v = m_->comp()->mass_vec();
+  return v.Get(nuc) * compmath::NormFactor(compmath::Sum(v));
 }
 
 double MatQuery::mass_frac(std::set<Nuc> nucs) {
@@ -36,9 +36,8 @@ double MatQuery::mass_frac(std::set<Nuc> nucs) {
 }
 
 double MatQuery::atom_frac(Nuc nuc) {
-  CompMap v = m_->comp()->atom();
-  compmath::Normalize(&v);
-  return v[nuc];
+  const CompVec& v = m_->comp()->atom_vec();
+  return v.Get(nuc) * compmath::NormFactor(compmath::Sum(v));
 }
 
 double MatQuery::atom_frac(std::set<Nuc> nucs) {
@@ -56,19 +55,19 @@ double MatQuery::atom_frac(std::set<Nuc> nucs) {
 }
 
 double MatQuery::mass(std::string nuc) {
-  return mass(pyne::nucname::id(nuc));
+  return mass(NucRegistry::Instance().Id(nuc));
 }
 
 double MatQuery::moles(std::string nuc) {
-  return moles(pyne::nucname::id(nuc));
+  return moles(NucRegistry::Instance().Id(nuc));
 }
 
 double MatQuery::mass_frac(std::string nuc) {
-  return mass_frac(pyne::nucname::id(nuc));
+  return mass_frac(NucRegistry::Instance().Id(nuc));
 }
 
 double MatQuery::atom_frac(std::string nuc) {
-  return atom_frac(pyne::nucname::id(nuc));
+  return atom_frac(NucRegistry::Instance().Id(nuc));
 }
 
 bool MatQuery::AlmostEq(Material::Ptr other, double threshold) {
@@ -19,7 +19,9 @@ MatlBuyPolicy::MatlBuyPolicy() :
     throughput_(std::numeric_limits<double>::max()),
     quantize_(-1),
     fill_to_(1),
-    req_when_under_(1) {
+    req_when_under_(1),
+    ports_amt_(0),
+    ports_stale_(true) {
   Warn<EXPERIMENTAL_WARNING>(
       "MatlBuyPolicy is experimental and its API may be subject to change");
 }
@@ -58,6 +60,7 @@ MatlBuyPolicy& MatlBuyPolicy::Init(Agent* manager, ResBuf<Material>* buf,
   Trader::manager_ = manager;
   buf_ = buf;
   name_ = name;
+  ports_stale_ = true;
   return *this;
 }
 
@@ -66,6 +69,7 @@ MatlBuyPolicy& MatlBuyPolicy::Init(Agent* manager, ResBuf<Material>* buf,
   Trader::manager_ = manager;
   buf_ = buf;
   name_ = name;
+  ports_stale_ = true;
   set_throughput(throughput);
   return *this;
 }
@@ -76,6 +80,7 @@ MatlBuyPolicy& MatlBuyPolicy::Init(Agent* manager, ResBuf<Material>* buf,
   Trader::manager_ = manager;
   buf_ = buf;
   name_ = name;
+  ports_stale_ = true;
   set_fill_to(fill_to);
   set_req_when_under(req_when_under);
   return *this;
@@ -88,6 +93,7 @@ MatlBuyPolicy& MatlBuyPolicy::Init(Agent* manager, ResBuf<Material>* buf,
   Trader::manager_ = manager;
   buf_ = buf;
   name_ = name;
+  ports_stale_ = true;
   set_fill_to(fill_to);
   set_req_when_under(req_when_under);
   set_quantize(quantize);
@@ -111,6 +117,7 @@ MatlBuyPolicy& MatlBuyPolicy::Set(std::string commod, Composition::Ptr c,
   d.comp = c;
   d.pref = pref;
   commod_details_[commod] = d;
+  ports_stale_ = true;
   return *this;
 }
 
@@ -132,6 +139,17 @@ void MatlBuyPolicy::Stop() {
   manager()->context()->UnregisterTrader(this);
 }
 
+bool MatlBuyPolicy::TradesResource(const ResourceType& type) {
+  return type == Material::kType;
+}
+
+bool MatlBuyPolicy::BidCommods(const ResourceType& type,
+                               std::set<std::string>* commods) {
+  // buy policies only request
+  commods->clear();
+  return true;
+}
+
 std::set<RequestPortfolio<Material>::Ptr> MatlBuyPolicy::GetMatlRequests() {
   rsrc_commods_.clear();
   std::set<RequestPortfolio<Material>::Ptr> ports;
@@ -140,6 +158,11 @@ std::set<RequestPortfolio<Material>::Ptr> MatlBuyPolicy::GetMatlRequests() {
   if (!make_req || amt < eps())
     return ports;
 
+  if (!ports_stale_ && amt == ports_amt_) {
+    LGH(INFO3) << "requesting " << amt << " kg again";
+    return ports_;
+  }
+
   bool excl = Excl();
   double req_amt = ReqQty();
   int n_req = NReq();
@@ -155,8 +178,10 @@ std::set<RequestPortfolio<Material>::Ptr> MatlBuyPolicy::GetMatlRequests() {
       std::string commod = it->first;
       CommodDetail d = it->second;
       LG(INFO3) << "  - one " << amt << " kg request of " << commod;
-      Material::Ptr m = Material::CreateUntracked(req_amt, d.comp);
-      grps[i].push_back(port->AddRequest(m, this, commod, d.pref, excl));
+      // bidders rarely need more than the quantity and composition, so the
+      // target material is only made if one asks for it
+      grps[i].push_back(port->AddRequest(RequestTarget(req_amt, d.comp), this,
+                                         commod, d.pref, excl));
     }
 
     // if there's more than one commodity, then make them mutual
@@ -168,7 +193,10 @@ std::set<RequestPortfolio<Material>::Ptr> MatlBuyPolicy::GetMatlRequests() {
     }
     ports.insert(port);
   }
-  
+
+  ports_ = ports;
+  ports_amt_ = amt;
+  ports_stale_ = false;
   return ports;
 }
 
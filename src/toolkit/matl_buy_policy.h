@@ -144,6 +144,9 @@ class MatlBuyPolicy : public Trader {
 
   /// Trader Methods
   /// @{
+  virtual bool TradesResource(const ResourceType& type);
+  virtual bool BidCommods(const ResourceType& type,
+                          std::set<std::string>* commods);
   virtual std::set<RequestPortfolio<Material>::Ptr> GetMatlRequests();
   virtual void AcceptMatlTrades(
       const std::vector<std::pair<Trade<Material>, Material::Ptr> >& resps);
@@ -167,6 +170,14 @@ class MatlBuyPolicy : public Trader {
   double fill_to_, req_when_under_, quantize_, throughput_;
   std::map<Material::Ptr, std::string> rsrc_commods_;
   std::map<std::string, CommodDetail> commod_details_;
+
+  /// the portfolios last requested, which are requested again as long as the
+  /// total quantity to request and the policy's configuration are unchanged,
+  /// since the requests of a policy in steady state are the same every time
+  /// step
+  std::set<RequestPortfolio<Material>::Ptr> ports_;
+  double ports_amt_;
+  bool ports_stale_;
 };
 
 }  // namespace toolkit
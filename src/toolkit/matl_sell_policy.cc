@@ -1,5 +1,8 @@
 #include "matl_sell_policy.h"
 
+#include <map>
+#include <utility>
+
 #include "error.h"
 
 #define LG(X) LOG(LEV_##X, "selpol")
@@ -16,7 +19,9 @@ MatlSellPolicy::MatlSellPolicy() :
     name_(""),
     quantize_(-1),
     throughput_(std::numeric_limits<double>::max()),
-    ignore_comp_(false) {
+    ignore_comp_(false),
+    batch_(false),
+    parallel_(false) {
   Warn<EXPERIMENTAL_WARNING>(
       "MatlSellPolicy is experimental and its API may be subject to change");
 }
@@ -91,6 +96,19 @@ MatlSellPolicy& MatlSellPolicy::Init(Agent* manager, ResBuf<Material>* buf,
 
 MatlSellPolicy& MatlSellPolicy::Set(std::string commod) {
   commods_.insert(commod);
+  // the context keeps the commodities a trader bids on as it registers
+  if (manager() != NULL && manager()->context()->traders().count(this) > 0)
+    manager()->context()->RegisterTrader(this);
+  return *this;
+}
+
+MatlSellPolicy& MatlSellPolicy::BatchBids(bool batch) {
+  batch_ = batch;
+  return *this;
+}
+
+MatlSellPolicy& MatlSellPolicy::ParallelTrades(bool parallel) {
+  parallel_ = parallel;
   return *this;
 }
 
@@ -113,6 +131,16 @@ void MatlSellPolicy::Stop() {
 }
 
 
+bool MatlSellPolicy::TradesResource(const ResourceType& type) {
+  return type == Material::kType;
+}
+
+bool MatlSellPolicy::BidCommods(const ResourceType& type,
+                                std::set<std::string>* commods) {
+  *commods = commods_;
+  return true;
+}
+
 double MatlSellPolicy::Limit() const {
   double bcap = buf_->quantity();
   double limit = Excl() ?                                               \
@@ -135,6 +163,12 @@ std::set<BidPortfolio<Material>::Ptr> MatlSellPolicy::GetMatlBids(
   LGH(INFO3) << "bidding out " << limit << " kg";
   
   bool excl = Excl();
+  // in batches, offers are shared by every bid of the same quantity and
+  // composition
+  std::map<std::pair<Composition::Ptr, double>, Material::Ptr> offers;
+  Composition::Ptr buf_comp;
+  if (batch_ && !ignore_comp_)
+    buf_comp = buf_->Peek()->comp();
   std::string commod;
   Request<Material>* req;
   Material::Ptr m, offer;
@@ -151,15 +185,23 @@ std::set<BidPortfolio<Material>::Ptr> MatlSellPolicy::GetMatlBids(
         commod_requests.at(commod);
     for (rit = requests.begin(); rit != requests.end(); ++rit) {
       req = *rit;
-      qty = std::min(req->target()->quantity(), limit);
+      qty = std::min(req->target_quantity(), limit);
       nbids = excl ? static_cast<int>(std::floor(qty / quantize_)) : 1;
       qty = excl ? quantize_ : qty;
       for (int i = 0; i < nbids; i++) {
-        m = buf_->Pop();
-        buf_->Push(m);
-        offer = ignore_comp_ ? \
-                Material::CreateUntracked(qty, req->target()->comp()) : \
-                Material::CreateUntracked(qty, m->comp());
+        if (batch_) {
+          Composition::Ptr c = ignore_comp_ ? req->target_comp() : buf_comp;
+          Material::Ptr& shared = offers[std::make_pair(c, qty)];
+          if (!shared)
+            shared = Material::CreateUntracked(qty, c);
+          offer = shared;
+        } else {
+          m = buf_->Pop();
+          buf_->Push(m);
+          offer = ignore_comp_ ? \
+                  Material::CreateUntracked(qty, req->target_comp()) : \
+                  Material::CreateUntracked(qty, m->comp());
+        }
         port->AddBid(req, offer, this, excl);
         LG(INFO3) << "  - bid " << qty << " kg on a request for " << commod;
       }
@@ -178,7 +220,7 @@ void MatlSellPolicy::GetMatlTrades(
     LGH(INFO3) << " sending " << qty << " kg of " << it->request->commodity();
     Material::Ptr mat = buf_->Pop(qty, cyclus::eps_rsrc());
     if (ignore_comp_)
-      mat->Transmute(it->request->target()->comp());
+      mat->Transmute(it->request->target_comp());
     responses.push_back(std::make_pair(*it, mat));
   }
 }
@@ -89,9 +89,25 @@ class MatlSellPolicy : public Trader {
   /// Instructs the policy to empty its buffer with offers on the given
   /// commodity.  This must be called at least once or the policy will do
   /// nothing.  The policy can offer on an arbitrary number of commodities by
-  /// calling Set multiple times.
+  /// calling Set multiple times, including after Start.
   MatlSellPolicy& Set(std::string commod);
 
+  /// Instructs the policy to bid in batches: the offers of a time step are
+  /// made once per quantity (and, when the policy ignores its buffer's
+  /// composition, per requested composition) and shared by every bid that
+  /// offers them, instead of a new offer being made for each bid. Offers are
+  /// then made of the composition of the material next in line in the
+  /// buffer. With many requesters, and exclusive bids in particular, this
+  /// makes far fewer materials. The capacity of the policy is still
+  /// constrained once for its whole portfolio.
+  MatlSellPolicy& BatchBids(bool batch = true);
+
+  /// Declares that the policy's buffer isn't touched by anything but the
+  /// policy while trades are executed, so that the policy may pop the
+  /// materials of its trades concurrently with other suppliers (see
+  /// Trader::ThreadSafeTrades). Off by default.
+  MatlSellPolicy& ParallelTrades(bool parallel = true);
+
   /// Registers this policy as a trader in the current simulation.  This
   /// function must be called for the policy to begin participating in resource
   /// exchange. Init MUST be called prior to calling this function.  Start is
@@ -110,9 +126,19 @@ class MatlSellPolicy : public Trader {
 
   /// whether trades will be denoted as exclusive or not
   inline bool Excl() const { return quantize_ > 0; }
+
+  /// whether bids are made in batches (see BatchBids)
+  inline bool batch_bids() const { return batch_; }
+
+  /// whether trades may be executed concurrently (see ParallelTrades)
+  inline bool parallel_trades() const { return parallel_; }
   
   /// Trader Methods
   /// @{
+  virtual bool TradesResource(const ResourceType& type);
+  virtual bool BidCommods(const ResourceType& type,
+                          std::set<std::string>* commods);
+  virtual bool ThreadSafeTrades() { return parallel_; }
   virtual std::set<BidPortfolio<Material>::Ptr> GetMatlBids(
       CommodMap<Material>::type& commod_requests);
   virtual void GetMatlTrades(
@@ -131,6 +157,8 @@ class MatlSellPolicy : public Trader {
   double throughput_;
   std::string name_;
   bool ignore_comp_;
+  bool batch_;
+  bool parallel_;
 };
 
 }  // namespace toolkit
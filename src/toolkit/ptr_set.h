@@ -0,0 +1,123 @@
+#ifndef CYCLUS_SRC_TOOLKIT_PTR_SET_H_
+#define CYCLUS_SRC_TOOLKIT_PTR_SET_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+namespace cyclus {
+namespace toolkit {
+
+/// A set of raw pointers kept in a single open-addressing table with linear
+/// probing. Lookups, insertions, and removals take constant time on average
+/// and never allocate except when the table grows, which makes it a cheap
+/// membership index for containers such as ResBuf.
+class PtrSet {
+ public:
+  PtrSet() : n_(0) {}
+
+  /// The number of pointers in the set.
+  inline size_t size() const { return n_; }
+
+  inline bool empty() const { return n_ == 0; }
+
+  /// Returns 1 if p is in the set and 0 otherwise.
+  inline size_t count(const void* p) const {
+    if (n_ == 0) {
+      return 0;
+    }
+    for (size_t i = Slot(p); slots_[i] != NULL; i = Next(i)) {
+      if (slots_[i] == p) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  /// Adds p, which must not be NULL, to the set. Returns false if it was
+  /// already present.
+  inline bool insert(const void* p) {
+    // keep the table at most half full so that probe runs stay short
+    if (2 * (n_ + 1) > slots_.size()) {
+      Grow();
+    }
+    size_t i = Slot(p);
+    for (; slots_[i] != NULL; i = Next(i)) {
+      if (slots_[i] == p) {
+        return false;
+      }
+    }
+    slots_[i] = p;
+    n_++;
+    return true;
+  }
+
+  /// Removes p from the set, if present.
+  inline void erase(const void* p) {
+    if (n_ == 0) {
+      return;
+    }
+    size_t i = Slot(p);
+    for (; slots_[i] != p; i = Next(i)) {
+      if (slots_[i] == NULL) {
+        return;
+      }
+    }
+
+    // shift later members of the probe run back into the hole so that no
+    // tombstones are needed
+    size_t j = i;
+    while (true) {
+      j = Next(j);
+      if (slots_[j] == NULL) {
+        break;
+      }
+      size_t home = Slot(slots_[j]);
+      bool movable = (i <= j) ? (home <= i || home > j)
+                              : (home <= i && home > j);
+      if (movable) {
+        slots_[i] = slots_[j];
+        i = j;
+      }
+    }
+    slots_[i] = NULL;
+    n_--;
+  }
+
+  inline void clear() {
+    slots_.clear();
+    n_ = 0;
+  }
+
+ private:
+  inline size_t Slot(const void* p) const {
+    uint64_t x = reinterpret_cast<uintptr_t>(p);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x & (slots_.size() - 1);
+  }
+
+  inline size_t Next(size_t i) const { return (i + 1) & (slots_.size() - 1); }
+
+  void Grow() {
+    std::vector<const void*> old(slots_.empty() ? 16 : 2 * slots_.size(),
+                                 static_cast<const void*>(NULL));
+    old.swap(slots_);
+    n_ = 0;
+    for (size_t i = 0; i < old.size(); ++i) {
+      if (old[i] != NULL) {
+        insert(old[i]);
+      }
+    }
+  }
+
+  /// a power of two number of slots, NULL where empty
+  std::vector<const void*> slots_;
+  size_t n_;
+};
+
+}  // namespace toolkit
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_TOOLKIT_PTR_SET_H_
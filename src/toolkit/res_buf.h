@@ -1,16 +1,17 @@
 #ifndef CYCLUS_SRC_TOOLKIT_RES_BUF_H_
 #define CYCLUS_SRC_TOOLKIT_RES_BUF_H_
 
+#include <cmath>
 #include <iomanip>
 #include <limits>
 #include <list>
-#include <set>
 #include <vector>
 
 #include "cyc_arithmetic.h"
 #include "cyc_limits.h"
 #include "error.h"
 #include "product.h"
+#include "ptr_set.h"
 #include "material.h"
 #include "resource.h"
 #include "res_manip.h"
@@ -61,7 +62,7 @@ typedef std::vector<Product::Ptr> ProdVec;
 template <class T>
 class ResBuf {
  public:
-  ResBuf() : cap_(INFINITY), qty_(0) { }
+  ResBuf() : cap_(INFINITY), qty_(0), qty_err_(0) { }
 
   virtual ~ResBuf() {}
 
@@ -91,12 +92,12 @@ class ResBuf {
 
   /// Returns the total resource quantity of constituent resource
   /// objects in the buffer. Never throws.
-  inline double quantity() const { return qty_; }
+  inline double quantity() const { return qty_ + qty_err_; }
 
   /// Returns the quantity of space remaining in this buffer.
   /// This is effectively the difference between the capacity and the quantity
   /// and is never negative. Never throws.
-  inline double space() const { return std::max(0.0, cap_ - qty_); }
+  inline double space() const { return std::max(0.0, cap_ - quantity()); }
 
   /// Returns true if there are no resources in the buffer.
   inline bool empty() const { return rs_.empty(); }
@@ -118,32 +119,30 @@ class ResBuf {
       throw ValueError(ss.str());
     }
 
-    std::vector<typename T::Ptr> rs;
-    typename T::Ptr r;
-    typename T::Ptr tmp;
-    double left = qty;
-    double quan;
-    while (left > 0 && count() > 0) {
-      r = rs_.front();
-      rs_.pop_front();
-      quan = r->quantity();
-      if (quan > left) {
-        // too big - split the res before popping
-        tmp = boost::dynamic_pointer_cast<T>(r->ExtractRes(left));
-        rs_.push_front(r);
-        r = tmp;
-      } else {
-        rs_present_.erase(r);
-      }
-
-      qty_ -= r->quantity();
-      rs.push_back(r);
-      left -= quan;
+    typename T::Ptr popped;
+    Take(qty, &popped);
+    if (popped == NULL) {
+      throw Error("cannot squash zero resources together");
     }
+    return popped;
+  }
 
-    UpdateQty();
-
-    return Squash(rs);
+  /// Pops the specified quantity from the buffer and absorbs it into the
+  /// given resource, which must not be held by the buffer. The result is
+  /// the same as into->Absorb(Pop(qty)), but the popped resources are
+  /// absorbed one by one as they are removed, without gathering them first.
+  /// Popping zero leaves into unchanged.
+  ///
+  /// @throws ValueError the specified pop quantity is larger than the
+  /// buffer's current inventory.
+  void PopInto(double qty, typename T::Ptr into) {
+    if (qty > this->quantity()) {
+      std::stringstream ss;
+      ss << std::setprecision(17) << "removal quantity " << qty
+         << " larger than buff quantity " << this->quantity();
+      throw ValueError(ss.str());
+    }
+    Take(qty, &into);
   }
 
   /// Same behavior as Pop(double) except a non-zero eps may be specified.  eps
@@ -179,10 +178,10 @@ class ResBuf {
     std::vector<typename T::Ptr> rs;
     for (int i = 0; i < n; i++) {
       typename T::Ptr r = rs_.front();
-      qty_ -= r->quantity();
+      AddQty(-r->quantity());
       rs_.pop_front();
       rs.push_back(r);
-      rs_present_.erase(r);
+      rs_present_.erase(r.get());
     }
 
     UpdateQty();
@@ -213,8 +212,8 @@ class ResBuf {
 
     typename T::Ptr r = rs_.front();
     rs_.pop_front();
-    rs_present_.erase(r);
-    qty_ -= r->quantity();
+    rs_present_.erase(r.get());
+    AddQty(-r->quantity());
     UpdateQty();
     return r;
   }
@@ -227,8 +226,8 @@ class ResBuf {
 
     typename T::Ptr r = rs_.back();
     rs_.pop_back();
-    rs_present_.erase(r);
-    qty_ -= r->quantity();
+    rs_present_.erase(r.get());
+    AddQty(-r->quantity());
     UpdateQty();
     return r;
   }
@@ -252,13 +251,13 @@ class ResBuf {
       ss << "resource pushing breaks capacity limit: space=" << space()
          << ", rsrc->quantity()=" << r->quantity();
       throw ValueError(ss.str());
-    } else if (rs_present_.count(m) == 1) {
+    } else if (rs_present_.count(m.get()) == 1) {
       throw KeyError("duplicate resource push attempted");
     }
 
     rs_.push_back(m);
-    rs_present_.insert(m);
-    qty_ += r->quantity();
+    rs_present_.insert(m.get());
+    AddQty(r->quantity());
     UpdateQty();
   }
 
@@ -294,36 +293,97 @@ class ResBuf {
     }
 
     for (int i = 0; i < rss.size(); i++) {
-      if (rs_present_.count(rss.at(i)) == 1) {
+      if (rs_present_.count(rss.at(i).get()) == 1) {
         throw KeyError("Duplicate resource pushing attempted");
       }
     }
 
     for (int i = 0; i < rss.size(); i++) {
       rs_.push_back(rss[i]);
-      rs_present_.insert(rss[i]);
+      rs_present_.insert(rss[i].get());
     }
-    qty_ += tot_qty;
+    AddQty(tot_qty);
+  }
+
+  /// Returns the quantity held and adds the mass of each nuclide held, in
+  /// kg, to mass without copying any resources. Only available for material
+  /// buffers; see Material::SumMass.
+  double SumMass(CompMap* mass) const {
+    std::vector<Material::Ptr> mats(rs_.begin(), rs_.end());
+    return Material::SumMass(mats, mass);
+  }
+
+  /// Returns the total decay heat of the materials held without copying any
+  /// resources. Only available for material buffers; see
+  /// Material::DecayHeat.
+  double DecayHeat() const {
+    std::vector<Material::Ptr> mats(rs_.begin(), rs_.end());
+    return Material::DecayHeat(mats);
   }
 
  private:
+  /// removes qty from the front of the buffer, splitting the last resource
+  /// if needed, and absorbs each removed resource into *acc in order. If
+  /// *acc is NULL, the first removed resource becomes *acc.
+  void Take(double qty, typename T::Ptr* acc) {
+    double left = qty;
+    while (left > 0 && count() > 0) {
+      typename T::Ptr r = rs_.front();
+      double quan = r->quantity();
+      if (quan > left) {
+        // too big - split the res rather than popping it
+        r = ExtractRes(r, left);
+      } else {
+        rs_.pop_front();
+        rs_present_.erase(r.get());
+      }
+
+      AddQty(-r->quantity());
+      left -= quan;
+      if (*acc == NULL) {
+        *acc = r;
+      } else {
+        AbsorbRes(*acc, r);
+      }
+    }
+
+    UpdateQty();
+  }
+
   void UpdateQty() {
     int n = rs_.size();
     if (n == 0) {
       qty_ = 0;
+      qty_err_ = 0;
     } else if (n == 1) {
       qty_ = rs_.front()->quantity();
+      qty_err_ = 0;
+    }
+  }
+
+  /// adds q to the total quantity with compensated (Neumaier) summation, so
+  /// that rounding errors do not build up over many pushes and pops.
+  void AddQty(double q) {
+    double t = qty_ + q;
+    if (std::abs(qty_) >= std::abs(q)) {
+      qty_err_ += (qty_ - t) + q;
+    } else {
+      qty_err_ += (q - t) + qty_;
     }
+    qty_ = t;
   }
 
+  /// the running total quantity and the rounding error lost from it.
   double qty_;
+  double qty_err_;
 
   /// Maximum quantity of resources this buffer can hold
   double cap_;
 
   /// List of constituent resource objects forming the buffer's inventory
   std::list<typename T::Ptr> rs_;
-  std::set<typename T::Ptr> rs_present_;
+  /// the resources held, for constant-time duplicate checks.
+  PtrSet rs_present_;
 };
 
 }  // namespace toolkit
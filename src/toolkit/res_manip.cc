@@ -45,6 +45,29 @@ Resource::Ptr Squash(std::vector<Resource::Ptr> rs) {
   throw Error("cannot squash resource type " + rs[0]->type());
 }
   
+void AbsorbRes(Product::Ptr into, Product::Ptr r) {
+  into->Absorb(r);
+}
+
+void AbsorbRes(Material::Ptr into, Material::Ptr r) {
+  into->Absorb(r);
+}
+
+void AbsorbRes(Resource::Ptr into, Resource::Ptr r) {
+  Material::Ptr m = ::cyclus::ResCast<Material>(into);
+  if (m != NULL) {
+    m->Absorb(::cyclus::ResCast<Material>(r));
+    return;
+  }
+  Product::Ptr p = ::cyclus::ResCast<Product>(into);
+  if (p != NULL) {
+    p->Absorb(::cyclus::ResCast<Product>(r));
+    return;
+  }
+
+  throw Error("cannot squash resource type " + into->type());
+}
+
 std::vector<Resource::Ptr> ResCast(std::vector<Material::Ptr> rs) {
   std::vector<Resource::Ptr> casted;
   for (int i = 0; i < rs.size(); ++i) {
@@ -20,6 +20,28 @@ Material::Ptr Squash(std::vector<Material::Ptr> ms);
 /// resource.
 Resource::Ptr Squash(std::vector<Resource::Ptr> rs);
 
+/// Absorbs r into into. Same as squashing the two, without building a vector.
+/// The Resource overload dispatches on the resource type like Squash does.
+/// @{
+void AbsorbRes(Product::Ptr into, Product::Ptr r);
+void AbsorbRes(Material::Ptr into, Material::Ptr r);
+void AbsorbRes(Resource::Ptr into, Resource::Ptr r);
+/// @}
+
+/// Extracts the given quantity from r and returns it as a resource of r's
+/// own type, without the downcast needed after Resource::ExtractRes.
+/// @{
+inline Product::Ptr ExtractRes(Product::Ptr r, double qty) {
+  return r->Extract(qty);
+}
+inline Material::Ptr ExtractRes(Material::Ptr r, double qty) {
+  return r->ExtractQty(qty);
+}
+inline Resource::Ptr ExtractRes(Resource::Ptr r, double qty) {
+  return r->ExtractRes(qty);
+}
+/// @}
+
 /// Casts a vector of Materials into a vector of Resources.
 std::vector<Resource::Ptr> ResCast(std::vector<Material::Ptr> rs);
 
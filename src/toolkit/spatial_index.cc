@@ -0,0 +1,174 @@
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include "error.h"
+#include "position.h"
+
+namespace cyclus {
+namespace toolkit {
+
+namespace {
+
+// the radius of the earth that Position::Distance uses, in kilometers
+const double kEarthRadius = 6372.8;
+
+inline double Radians(double deg) { return deg * M_PI / 180; }
+inline double Degrees(double rad) { return rad * 180 / M_PI; }
+
+}  // namespace
+
+SpatialIndex::SpatialIndex(double cell_deg) : cell_deg_(cell_deg) {
+  if (cell_deg <= 0 || cell_deg > 180) {
+    std::stringstream ss;
+    ss << "the cells of a spatial index must be within (0, 180] degrees, not "
+       << cell_deg;
+    throw ValueError(ss.str());
+  }
+  ncols_ = static_cast<int>(std::ceil(360 / cell_deg));
+}
+
+void SpatialIndex::Insert(int id, const Position& p) {
+  Erase(id);
+  Point pt(p.latitude(), p.longitude());
+  points_[id] = pt;
+  cells_[CellOf(pt)].insert(id);
+}
+
+bool SpatialIndex::Erase(int id) {
+  std::map<int, Point>::iterator it = points_.find(id);
+  if (it == points_.end()) {
+    return false;
+  }
+  std::map<Cell, std::set<int> >::iterator cit = cells_.find(CellOf(it->second));
+  cit->second.erase(id);
+  if (cit->second.empty()) {
+    cells_.erase(cit);
+  }
+  points_.erase(it);
+  return true;
+}
+
+Position SpatialIndex::position(int id) const {
+  std::map<int, Point>::const_iterator it = points_.find(id);
+  if (it == points_.end()) {
+    std::stringstream ss;
+    ss << "id " << id << " is not in the spatial index";
+    throw KeyError(ss.str());
+  }
+  return Position(it->second.first, it->second.second);
+}
+
+std::vector<int> SpatialIndex::Within(const Position& center,
+                                      double km) const {
+  std::vector<int> ids;
+  if (km < 0 || points_.empty()) {
+    return ids;
+  }
+  double lat = center.latitude();
+  double lon = center.longitude();
+  double d = km / kEarthRadius;
+  double lat_lo = lat - Degrees(d);
+  double lat_hi = lat + Degrees(d);
+  double lon_lo = -180;
+  double lon_hi = 180;
+  if (lat_lo > -90 && lat_hi < 90 && d < M_PI / 2) {
+    // the widest the circle gets in longitude, which is at a latitude
+    // nearer the pole than its center's
+    double dlon = Degrees(std::asin(std::sin(d) / std::cos(Radians(lat))));
+    if (dlon < 180) {
+      lon_lo = lon - dlon;
+      lon_hi = lon + dlon;
+      if (lon_lo < -180) {
+        lon_lo += 360;
+      }
+      if (lon_hi > 180) {
+        lon_hi -= 360;
+      }
+    }
+  }
+  const std::map<int, Point>& points = points_;
+  Collect(CellOf(Point(lat_lo, 0)).first, CellOf(Point(lat_hi, 0)).first,
+          lon_lo, lon_hi,
+          [&points, &center, km](int id) {
+            const Point& p = points.find(id)->second;
+            return Position(p.first, p.second).Distance(center) <= km;
+          },
+          &ids);
+  return ids;
+}
+
+std::vector<int> SpatialIndex::Near(int id, double km) const {
+  return Within(position(id), km);
+}
+
+std::vector<int> SpatialIndex::InRegion(double lat_lo, double lat_hi,
+                                        double lon_lo, double lon_hi) const {
+  std::vector<int> ids;
+  if (lat_lo > lat_hi || points_.empty()) {
+    return ids;
+  }
+  const std::map<int, Point>& points = points_;
+  bool wraps = lon_lo > lon_hi;
+  Collect(CellOf(Point(lat_lo, 0)).first, CellOf(Point(lat_hi, 0)).first,
+          lon_lo, lon_hi,
+          [&](int id) {
+            const Point& p = points.find(id)->second;
+            bool in_lon = wraps ? p.second >= lon_lo || p.second <= lon_hi
+                                : p.second >= lon_lo && p.second <= lon_hi;
+            return in_lon && p.first >= lat_lo && p.first <= lat_hi;
+          },
+          &ids);
+  return ids;
+}
+
+SpatialIndex::Cell SpatialIndex::CellOf(const Point& p) const {
+  int nrows = static_cast<int>(std::ceil(180 / cell_deg_));
+  int row = static_cast<int>(std::floor((p.first + 90) / cell_deg_));
+  int col = static_cast<int>(std::floor((p.second + 180) / cell_deg_));
+  row = std::max(0, std::min(nrows - 1, row));
+  col = std::max(0, std::min(ncols_ - 1, col));
+  return Cell(row, col);
+}
+
+template <class Keep>
+void SpatialIndex::Scan(int row, int lo, int hi, Keep keep,
+                        std::vector<int>* ids) const {
+  std::map<Cell, std::set<int> >::const_iterator it =
+      cells_.lower_bound(Cell(row, lo));
+  std::map<Cell, std::set<int> >::const_iterator end =
+      cells_.upper_bound(Cell(row, hi));
+  for (; it != end; ++it) {
+    std::set<int>::const_iterator id;
+    for (id = it->second.begin(); id != it->second.end(); ++id) {
+      if (keep(*id)) {
+        ids->push_back(*id);
+      }
+    }
+  }
+}
+
+template <class Keep>
+void SpatialIndex::Collect(int row_lo, int row_hi, double lon_lo,
+                           double lon_hi, Keep keep,
+                           std::vector<int>* ids) const {
+  int col_lo = CellOf(Point(0, lon_lo)).second;
+  int col_hi = CellOf(Point(0, lon_hi)).second;
+  for (int row = row_lo; row <= row_hi; ++row) {
+    if (lon_lo <= lon_hi) {
+      Scan(row, col_lo, col_hi, keep, ids);
+    } else if (col_lo <= col_hi) {
+      // the ends of the range share a cell, so it covers the whole row
+      Scan(row, 0, ncols_ - 1, keep, ids);
+    } else {
+      Scan(row, col_lo, ncols_ - 1, keep, ids);
+      Scan(row, 0, col_hi, keep, ids);
+    }
+  }
+  std::sort(ids->begin(), ids->end());
+}
+
+}  // namespace toolkit
+}  // namespace cyclus
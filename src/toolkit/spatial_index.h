@@ -0,0 +1,99 @@
+#ifndef CYCLUS_SRC_TOOLKIT_SPATIAL_INDEX_H_
+#define CYCLUS_SRC_TOOLKIT_SPATIAL_INDEX_H_
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace cyclus {
+namespace toolkit {
+
+class Position;
+
+/// SpatialIndex places ids, such as those of agents, at Positions on a grid
+/// of latitude-longitude cells, so that the ids within a distance of a
+/// position, or within a region, are found by visiting only the cells that
+/// could hold them rather than every id. Distances are great-circle
+/// distances in kilometers, as Position::Distance computes them.
+///
+/// The context keeps an index of the agents that have placed themselves on
+/// the map, which the resource exchange uses to only offer requests to
+/// nearby bidders (see Context::max_trade_distance):
+///
+/// @code
+/// void YourAgent::EnterNotify() {
+///   cyclus::Facility::EnterNotify();
+///   context()->positions().Insert(id(), Position(latitude, longitude));
+/// }
+/// @endcode
+class SpatialIndex {
+ public:
+  /// @param cell_deg the side of the grid cells in degrees, which should be
+  /// on the order of the distances queried
+  explicit SpatialIndex(double cell_deg = 1);
+
+  /// Returns the number of ids placed.
+  inline int size() const { return points_.size(); }
+
+  /// Returns whether an id is placed.
+  inline bool Has(int id) const { return points_.count(id) > 0; }
+
+  /// Places an id at a position, moving it if it was already placed.
+  void Insert(int id, const Position& p);
+
+  /// Removes an id, returning whether it was placed.
+  bool Erase(int id);
+
+  /// Returns the position of an id.
+  ///
+  /// @throws KeyError if the id isn't placed
+  Position position(int id) const;
+
+  /// Returns the ids within km kilometers of a position, in increasing
+  /// order.
+  std::vector<int> Within(const Position& center, double km) const;
+
+  /// Returns the ids within km kilometers of a placed id, including itself,
+  /// in increasing order.
+  ///
+  /// @throws KeyError if the id isn't placed
+  std::vector<int> Near(int id, double km) const;
+
+  /// Returns the ids in a region of latitudes [lat_lo, lat_hi] and
+  /// longitudes [lon_lo, lon_hi], in increasing order. A region with lon_lo
+  /// greater than lon_hi spans the antimeridian.
+  std::vector<int> InRegion(double lat_lo, double lat_hi, double lon_lo,
+                            double lon_hi) const;
+
+ private:
+  /// a latitude and longitude in degrees
+  typedef std::pair<double, double> Point;
+
+  /// the row and column of a cell
+  typedef std::pair<int, int> Cell;
+
+  Cell CellOf(const Point& p) const;
+
+  /// adds the ids in the cells of row whose columns are within [lo, hi] to
+  /// ids, if they pass keep
+  template <class Keep>
+  void Scan(int row, int lo, int hi, Keep keep, std::vector<int>* ids) const;
+
+  /// adds the ids in the cells of rows [row_lo, row_hi] and longitudes
+  /// [lon_lo, lon_hi], wrapping around the antimeridian if lon_lo > lon_hi,
+  /// to ids if they pass keep, and sorts them
+  template <class Keep>
+  void Collect(int row_lo, int row_hi, double lon_lo, double lon_hi,
+               Keep keep, std::vector<int>* ids) const;
+
+  double cell_deg_;
+  int ncols_;
+  std::map<int, Point> points_;
+  std::map<Cell, std::set<int> > cells_;
+};
+
+}  // namespace toolkit
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_TOOLKIT_SPATIAL_INDEX_H_
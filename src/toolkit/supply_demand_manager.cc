@@ -1,10 +1,32 @@
 #include "supply_demand_manager.h"
 
+#include <cmath>
+#include <limits>
+
 #include "error.h"
 
 namespace cyclus {
 namespace toolkit {
 
+// the time steps past which demands are evaluated rather than kept
+static const int kMaxDemandSteps = 1 << 20;
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double SupplyDemandManager::Demand(Commodity& commodity, int time) {
+  DemandCurve& d = demand_functions_[commodity];
+  if (time < 0 || time >= kMaxDemandSteps) {
+    return d.function->value(time);
+  }
+  if (time >= d.values.size()) {
+    d.values.resize(time + 1, std::numeric_limits<double>::quiet_NaN());
+  }
+  double& v = d.values[time];
+  if (std::isnan(v)) {
+    v = d.function->value(time);
+  }
+  return v;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 double SupplyDemandManager::Supply(Commodity& commodity) {
   double value = 0.0;
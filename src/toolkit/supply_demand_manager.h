@@ -8,6 +8,7 @@
 
 #include <map>
 #include <set>
+#include <vector>
 
 namespace cyclus {
 namespace toolkit {
@@ -31,7 +32,9 @@ class SupplyDemandManager : public AgentManaged {
   /// @param demand a smart pointer to the demand function
   inline void RegisterCommodity(Commodity& commodity,
                                 SymFunction::Ptr demand) {
-    demand_functions_.insert(std::make_pair(commodity, demand));
+    DemandCurve d;
+    d.function = demand;
+    demand_functions_.insert(std::make_pair(commodity, d));
   }
 
   /// @return true if the demand for a commodity is managed by this entity
@@ -51,27 +54,35 @@ class SupplyDemandManager : public AgentManaged {
     managers_.erase(cpm);
   }
 
-  /// The demand for a commodity at a given time
+  /// The demand for a commodity at a given time. The demand function is
+  /// only evaluated the first time a time step's demand is asked for, and
+  /// the demand is looked up afterwards.
   /// @param commodity the commodity
   /// @param time the time
-  inline double Demand(Commodity& commodity, int time) {
-    return demand_functions_[commodity]->value(time);
-  }
+  double Demand(Commodity& commodity, int time);
 
   /// Returns the demand function for a commodity
   /// @param commodity the commodity being queried
   inline SymFunction::Ptr DemandFunction(Commodity& commodity) {
-    return demand_functions_[commodity];
+    return demand_functions_[commodity].function;
   }
 
-  /// Returns the current supply of a commodity
+  /// Returns the current supply of a commodity, as totalled by the producer
+  /// managers
   /// @param commodity the commodity
   /// @return the current supply of the commodity
   double Supply(Commodity& commodity);
 
  private:
+  /// A demand function and its values at the time steps evaluated so far,
+  /// which are NaN for those not yet evaluated
+  struct DemandCurve {
+    SymFunction::Ptr function;
+    std::vector<double> values;
+  };
+
   /// A container of all demand functions known to the manager
-  std::map<Commodity, SymFunction::Ptr, CommodityCompare> demand_functions_;
+  std::map<Commodity, DemandCurve, CommodityCompare> demand_functions_;
 
   /// A container of all production managers known to the manager
   std::set<CommodityProducerManager*> managers_;
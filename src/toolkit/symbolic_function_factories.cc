@@ -3,9 +3,61 @@
 
 #include "symbolic_function_factories.h"
 
+#include <algorithm>
+#include <limits>
+
 namespace cyclus {
 namespace toolkit {
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+SymFunction::Ptr SymbFunctionFactory::Compile(SymFunction::Ptr f, int ntab) {
+  boost::shared_ptr<CompiledFunction> c(new CompiledFunction());
+  double inf = std::numeric_limits<double>::infinity();
+  Flatten(f, 0, 0, -inf, inf, c.get());
+  c->table_.reserve(std::max(ntab, 0));
+  for (int i = 0; i < ntab; i++) {
+    c->table_.push_back(c->value(i));
+  }
+
+  LOG(LEV_DEBUG2, "Funct") << "A function has been compiled: " << c->Print();
+  return c;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void SymbFunctionFactory::Flatten(SymFunction::Ptr f, double xoff,
+                                  double yoff, double lo, double hi,
+                                  CompiledFunction* out) {
+  if (LinearFunction* l = dynamic_cast<LinearFunction*>(f.get())) {
+    out->Add(lo, CompiledFunction::LINEAR, xoff, l->slope(),
+             l->intercept() + yoff, 0);
+  } else if (ExponentialFunction* e =
+                 dynamic_cast<ExponentialFunction*>(f.get())) {
+    out->Add(lo, CompiledFunction::EXPONENTIAL, xoff, e->constant(),
+             e->exponent(), e->intercept() + yoff);
+  } else if (PiecewiseFunction* p = dynamic_cast<PiecewiseFunction*>(f.get())) {
+    // piecewise functions are 0 before their first piece
+    const std::list<PiecewiseFunction::PiecewiseFunctionInfo>& fs =
+        p->functions_;
+    double first = fs.empty() ? hi : std::min(hi, xoff + fs.front().xoffset);
+    if (lo < first) {
+      out->Add(lo, CompiledFunction::LINEAR, 0, 0, yoff, 0);
+    }
+    std::list<PiecewiseFunction::PiecewiseFunctionInfo>::const_iterator it, next;
+    for (it = fs.begin(); it != fs.end(); it = next) {
+      next = it;
+      ++next;
+      double begin = xoff + it->xoffset;
+      double end = next == fs.end() ? hi : xoff + next->xoffset;
+      if (std::max(lo, begin) < std::min(hi, end)) {
+        Flatten(it->function, begin, yoff + it->yoffset, std::max(lo, begin),
+                std::min(hi, end), out);
+      }
+    }
+  } else {
+    out->Add(lo, CompiledFunction::OTHER, xoff, 0, 0, yoff, f);
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 SymFunction::Ptr LinFunctionFactory::GetFunctionPtr(std::string params) {
   std::stringstream ss(params);
@@ -21,6 +21,21 @@ class SymbFunctionFactory {
   ///  @param params a string of required parameters for the function
   ///  @return a FunctionPtr to the constructed function
   virtual SymFunction::Ptr GetFunctionPtr(std::string params) = 0;
+
+  /// Compiles a function into one that gives the same values much faster,
+  /// flattening piecewise functions, however nested, into a single table of
+  /// pieces (see CompiledFunction).
+  ///  @param f the function
+  ///  @param ntab the number of integer arguments, starting at 0, whose
+  ///  values are tabulated, e.g. the time steps of a simulation
+  ///  @return the compiled function
+  static SymFunction::Ptr Compile(SymFunction::Ptr f, int ntab = 0);
+
+ private:
+  /// Appends the pieces of the function x -> f(x - xoff) + yoff over
+  /// [lo, hi) to out.
+  static void Flatten(SymFunction::Ptr f, double xoff, double yoff, double lo,
+                      double hi, CompiledFunction* out);
 };
 
 /// A concrete factory for linear functions
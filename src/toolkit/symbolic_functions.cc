@@ -1,5 +1,7 @@
 #include "symbolic_functions.h"
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <math.h>
 #include <sstream>
@@ -62,5 +64,61 @@ std::string PiecewiseFunction::Print() {
   return ss.str();
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double CompiledFunction::value(double x) {
+  if (x >= 0 && x < static_cast<double>(table_.size()) &&
+      std::floor(x) == x) {
+    return table_[static_cast<size_t>(x)];
+  }
+  int i = std::upper_bound(starts_.begin(), starts_.end(), x) -
+          starts_.begin() - 1;
+  if (i < 0) {
+    // only for NaN, which precedes nothing
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  switch (forms_[i]) {
+    case LINEAR:
+      return a_[i] * (x - x0_[i]) + b_[i];
+    case EXPONENTIAL:
+      return a_[i] * exp(b_[i] * (x - x0_[i])) + c_[i];
+    default:
+      return others_[i]->value(x - x0_[i]) + c_[i];
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+std::string CompiledFunction::Print() {
+  std::stringstream ss("");
+  ss << "Compiled function of " << starts_.size() << " pieces:";
+  for (int i = 0; i < starts_.size(); i++) {
+    ss << " * from " << starts_[i] << ", ";
+    switch (forms_[i]) {
+      case LINEAR:
+        ss << "y = " << a_[i] << " * (x - " << x0_[i] << ") + " << b_[i];
+        break;
+      case EXPONENTIAL:
+        ss << "y = " << a_[i] << " * exp(" << b_[i] << " * (x - " << x0_[i]
+           << ")) + " << c_[i];
+        break;
+      default:
+        ss << others_[i]->Print() << " at (" << x0_[i] << "," << c_[i]
+           << ")";
+    }
+  }
+  return ss.str();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CompiledFunction::Add(double x, Form form, double x0, double a, double b,
+                           double c, SymFunction::Ptr other) {
+  starts_.push_back(x);
+  forms_.push_back(form);
+  x0_.push_back(x0);
+  a_.push_back(a);
+  b_.push_back(b);
+  c_.push_back(c);
+  others_.push_back(other);
+}
+
 }  // namespace toolkit
 }  // namespace cyclus
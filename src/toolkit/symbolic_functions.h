@@ -3,6 +3,7 @@
 
 #include <list>
 #include <string>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 
@@ -13,6 +14,7 @@ namespace toolkit {
 class LinearFunction;
 class ExponentialFunction;
 class PiecewiseFunction;
+class SymbFunctionFactory;
 
 /// Abstract base class for symbolic functions
 class SymFunction {
@@ -44,6 +46,12 @@ class LinearFunction : public SymFunction {
   /// Print a string of the function
   virtual std::string Print();
 
+  /// @return the slope
+  inline double slope() const { return slope_; }
+
+  /// @return the intercept
+  inline double intercept() const { return intercept_; }
+
  private:
   /// The slope
   double slope_;
@@ -71,6 +79,15 @@ class ExponentialFunction : public SymFunction {
   /// Print a string of the function
   virtual std::string Print();
 
+  /// @return the leading constant
+  inline double constant() const { return constant_; }
+
+  /// @return the exponent multiplier
+  inline double exponent() const { return exponent_; }
+
+  /// @return the intercept
+  inline double intercept() const { return intercept_; }
+
  private:
   /// The constant factor
   double constant_;
@@ -108,6 +125,56 @@ class PiecewiseFunction : public SymFunction {
   std::list<PiecewiseFunctionInfo> functions_;
 
   friend class PiecewiseFunctionFactory;
+  friend class SymbFunctionFactory;
+};
+
+/// A function flattened for fast evaluation, made by
+/// SymbFunctionFactory::Compile. The pieces of a function, including those
+/// of nested piecewise functions, are kept in contiguous arrays ordered by
+/// where they start, so that evaluation is a binary search over the
+/// breakpoints followed by a closed form, rather than a walk down a list
+/// of virtual calls. The values at the first integer arguments may also be
+/// tabulated, so that they are looked up.
+class CompiledFunction : public SymFunction {
+ public:
+  /// Evaluation for an double argument
+  virtual double value(double x);
+
+  /// Print a string of the function
+  virtual std::string Print();
+
+  /// @return the number of pieces
+  inline int npieces() const { return starts_.size(); }
+
+ private:
+  friend class SymbFunctionFactory;
+
+  /// the forms of the pieces
+  enum Form {
+    /// a * (x - x0) + b
+    LINEAR,
+    /// a * exp(b * (x - x0)) + c
+    EXPONENTIAL,
+    /// others_[i]->value(x - x0) + c
+    OTHER
+  };
+
+  /// Appends a piece that starts at x.
+  void Add(double x, Form form, double x0, double a, double b, double c,
+           SymFunction::Ptr other = SymFunction::Ptr());
+
+  /// where each piece starts, in ascending order; the first piece starts at
+  /// -inf
+  std::vector<double> starts_;
+  std::vector<int> forms_;
+  std::vector<double> x0_;
+  std::vector<double> a_;
+  std::vector<double> b_;
+  std::vector<double> c_;
+  std::vector<SymFunction::Ptr> others_;
+
+  /// the values at 0, 1, ..., if tabulated
+  std::vector<double> table_;
 };
 
 }  // namespace toolkit
@@ -1,10 +1,229 @@
 #include "timeseries.h"
 
+#include <algorithm>
+
+#include "error.h"
+
 namespace cyclus {
 namespace toolkit {
 
 std::map<std::string, std::vector<time_series_listener_t> > TIME_SERIES_LISTENERS;
 
+std::atomic<int> TIME_SERIES_NLISTENERS(0);
+
+namespace {
+
+std::map<std::string, TimeSeriesListeners>& ListenerTable() {
+  static std::map<std::string, TimeSeriesListeners> table;
+  return table;
+}
+
+// the number of series with batched Python listeners
+int& NBatched() {
+  static int n = 0;
+  return n;
+}
+
+// the rows of the time series handles of each context, by the order they
+// were registered in
+struct HandleRows {
+  HandleRows() : next(0) {}
+  int next;
+  std::map<int, TimeSeriesRows*> rows;
+};
+
+std::mutex& HandleMutex() {
+  static std::mutex mu;
+  return mu;
+}
+
+std::map<Context*, HandleRows>& HandleTable() {
+  static std::map<Context*, HandleRows> table;
+  return table;
+}
+
+}  // namespace
+
+TimeSeriesListeners* FindTimeSeriesListeners(const std::string& tsname) {
+  std::map<std::string, TimeSeriesListeners>::iterator it =
+      ListenerTable().find(tsname);
+  return it == ListenerTable().end() ? NULL : &it->second;
+}
+
+TimeSeriesListeners* GetTimeSeriesListeners(const std::string& tsname) {
+  return &ListenerTable()[tsname];
+}
+
+void SetPyTimeSeriesListeners(const std::string& tsname, bool has) {
+  TimeSeriesListeners* l = GetTimeSeriesListeners(tsname);
+  if (l->py != has)
+    TIME_SERIES_NLISTENERS += has ? 1 : -1;
+  l->py = has;
+}
+
+void SetPyBatchTimeSeriesListeners(const std::string& tsname, bool has) {
+  TimeSeriesListeners* l = GetTimeSeriesListeners(tsname);
+  if (l->py_batched != has) {
+    TIME_SERIES_NLISTENERS += has ? 1 : -1;
+    NBatched() += has ? 1 : -1;
+  }
+  l->py_batched = has;
+}
+
+void FlushTimeSeriesBatches(int time) {
+  if (NBatched() == 0)
+    return;
+  std::vector<int> ids;
+  std::vector<double> values;
+  std::map<std::string, TimeSeriesListeners>::iterator it;
+  for (it = ListenerTable().begin(); it != ListenerTable().end(); ++it) {
+    TimeSeriesListeners& l = it->second;
+    if (!l.py_batched || l.batch_ids.empty())
+      continue;
+    ids.clear();
+    values.clear();
+    {
+      std::lock_guard<std::mutex> lock(l.batch_mu);
+      ids.swap(l.batch_ids);
+      values.swap(l.batch_values);
+    }
+    PyCallBatchListeners(it->first, time, &ids, &values);
+  }
+}
+
+void ClearTimeSeriesListeners() {
+  NBatched() = 0;
+  ListenerTable().clear();
+  TIME_SERIES_LISTENERS.clear();
+  TIME_SERIES_NLISTENERS = 0;
+}
+
+int RegisterTimeSeriesRows(Context* ctx, TimeSeriesRows* rows) {
+  std::lock_guard<std::mutex> lock(HandleMutex());
+  HandleRows& h = HandleTable()[ctx];
+  int key = h.next++;
+  h.rows[key] = rows;
+  return key;
+}
+
+void UnregisterTimeSeriesRows(Context* ctx, int key) {
+  std::lock_guard<std::mutex> lock(HandleMutex());
+  std::map<Context*, HandleRows>::iterator it = HandleTable().find(ctx);
+  if (it == HandleTable().end())
+    return;
+  it->second.rows.erase(key);
+  if (it->second.rows.empty())
+    HandleTable().erase(it);
+}
+
+void FlushTimeSeries(Context* ctx) {
+  std::vector<TimeSeriesRows*> rows;
+  {
+    std::lock_guard<std::mutex> lock(HandleMutex());
+    std::map<Context*, HandleRows>::iterator it = HandleTable().find(ctx);
+    if (it == HandleTable().end())
+      return;
+    std::map<int, TimeSeriesRows*>::iterator r;
+    for (r = it->second.rows.begin(); r != it->second.rows.end(); ++r) {
+      rows.push_back(r->second);
+    }
+  }
+  for (int i = 0; i < rows.size(); ++i) {
+    rows[i]->Flush(ctx);
+  }
+}
+
+TimeSeriesAggregator::TimeSeriesAggregator(
+    const std::map<std::string, TimeSeriesAgg>& aggs)
+    : aggs_(aggs) {
+  std::map<std::string, TimeSeriesAgg>::const_iterator it;
+  for (it = aggs_.begin(); it != aggs_.end(); ++it) {
+    const std::string& mode = it->second.mode;
+    if (mode != "all" && mode != "sample" && mode != "sum" && mode != "min" &&
+        mode != "max" && mode != "mean") {
+      throw ValueError("unknown mode '" + mode + "' of time series " +
+                       it->first);
+    }
+    if (it->second.period < 1) {
+      throw ValueError("the period of time series " + it->first +
+                       " must be positive");
+    }
+  }
+}
+
+void TimeSeriesAggregator::Accumulate(const std::string& series,
+                                      const TimeSeriesAgg& agg,
+                                      cyclus::Agent* agent, int time,
+                                      double value) {
+  int id = agent->id();
+  if (agg.by_institution && agent->parent() != NULL)
+    id = agent->parent()->id();
+  int start = time - time % agg.period;
+
+  std::pair<std::string, int> key(series, id);
+  std::map<std::pair<std::string, int>, Window>::iterator it =
+      windows_.find(key);
+  if (it != windows_.end() && it->second.start != start) {
+    // the window ended without being flushed
+    Record(agent->context(), series, id, it->second);
+    windows_.erase(it);
+    it = windows_.end();
+  }
+  if (it == windows_.end()) {
+    Window w = {start, 0, 0, value, value};
+    it = windows_.insert(std::make_pair(key, w)).first;
+  }
+  Window& w = it->second;
+  w.n++;
+  w.sum += value;
+  w.min = std::min(w.min, value);
+  w.max = std::max(w.max, value);
+}
+
+void TimeSeriesAggregator::Flush(Context* ctx, bool all) {
+  int time = ctx->time();
+  std::map<std::pair<std::string, int>, Window>::iterator it;
+  for (it = windows_.begin(); it != windows_.end();) {
+    int period = aggs_[it->first.first].period;
+    if (all || it->second.start + period - 1 <= time) {
+      Record(ctx, it->first.first, it->first.second, it->second);
+      windows_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void TimeSeriesAggregator::Record(Context* ctx, const std::string& series,
+                                  int id, const Window& w) {
+  const std::string& mode = aggs_[series].mode;
+  double value = w.sum;
+  if (mode == "min") {
+    value = w.min;
+  } else if (mode == "max") {
+    value = w.max;
+  } else if (mode == "mean") {
+    value = w.sum / w.n;
+  }
+  ctx->NewDatum("TimeSeries" + series)
+      ->AddVal("AgentId", id)
+      ->AddVal("Time", w.start)
+      ->AddVal("Value", value)
+      ->Record();
+}
+
+std::string TimeSeriesName(TimeSeriesType t) {
+  switch (t) {
+    case POWER:
+      return "Power";
+    case ENRICH_SWU:
+      return "EnrichmentSWU";
+    case ENRICH_FEED:
+      return "EnrichmentFeed";
+  }
+  throw ValueError("unknown time series type");
+}
+
 template <>
 void RecordTimeSeries<POWER>(cyclus::Agent* agent, double value) {
   RecordTimeSeries<double>("Power", agent, value);
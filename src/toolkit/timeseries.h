@@ -1,8 +1,12 @@
 #ifndef CYCLUS_SRC_TOOLKIT_TIMESERIES_H_
 #define CYCLUS_SRC_TOOLKIT_TIMESERIES_H_
 
+#include <atomic>
 #include <string>
 #include <map>
+#include <mutex>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <functional>
 
@@ -12,6 +16,7 @@
 #include "agent.h"
 #include "context.h"
 #include "any.hpp"
+#include "error.h"
 
 namespace cyclus {
 namespace toolkit {
@@ -36,30 +41,378 @@ typedef boost::variant<
     std::function<void(cyclus::Agent*, int, std::string, std::string)>
     > time_series_listener_t;
 
+/// Listeners added directly to this map are still called, but looking them
+/// up costs a map search per value recorded. Prefer AddTimeSeriesListener.
 extern std::map<std::string, std::vector<time_series_listener_t> > TIME_SERIES_LISTENERS;
 
+/// A function called with the agent, time, value, and name of each value
+/// recorded to a time series.
+template <typename T>
+using TimeSeriesListener =
+    std::function<void(cyclus::Agent*, int, T, std::string)>;
+
+/// The listeners of one time series, by the type of their values.
+struct TimeSeriesListeners {
+  TimeSeriesListeners() : py(false), py_batched(false) {}
+
+  std::vector<TimeSeriesListener<bool> > bools;
+  std::vector<TimeSeriesListener<int> > ints;
+  std::vector<TimeSeriesListener<float> > floats;
+  std::vector<TimeSeriesListener<double> > doubles;
+  std::vector<TimeSeriesListener<std::string> > strings;
+
+  /// whether Python listeners are registered to the series
+  bool py;
+
+  /// whether batched Python listeners are registered to the series
+  bool py_batched;
+
+  /// the agent ids and values recorded to the series during the current time
+  /// step, for the batched Python listeners
+  std::mutex batch_mu;
+  std::vector<int> batch_ids;
+  std::vector<double> batch_values;
+};
+
+/// @brief the listeners of a series for values of a type
+/// @{
+inline std::vector<TimeSeriesListener<bool> >& ListenersOf(
+    TimeSeriesListeners& l, bool*) { return l.bools; }
+inline std::vector<TimeSeriesListener<int> >& ListenersOf(
+    TimeSeriesListeners& l, int*) { return l.ints; }
+inline std::vector<TimeSeriesListener<float> >& ListenersOf(
+    TimeSeriesListeners& l, float*) { return l.floats; }
+inline std::vector<TimeSeriesListener<double> >& ListenersOf(
+    TimeSeriesListeners& l, double*) { return l.doubles; }
+inline std::vector<TimeSeriesListener<std::string> >& ListenersOf(
+    TimeSeriesListeners& l, std::string*) { return l.strings; }
+/// @}
+
+/// The number of listeners registered to any time series, including
+/// series with Python listeners. Recording a value costs a single check
+/// of it when nothing listens.
+extern std::atomic<int> TIME_SERIES_NLISTENERS;
+
+/// Returns the listeners registered to a time series, or NULL if none ever
+/// were.
+TimeSeriesListeners* FindTimeSeriesListeners(const std::string& tsname);
+
+/// Returns the listeners of a time series, adding them if needed.
+TimeSeriesListeners* GetTimeSeriesListeners(const std::string& tsname);
+
+/// Registers a listener to the values of type T recorded to a time series.
+/// Listeners must be registered before the simulation runs; recording values
+/// takes no locks.
+template <typename T>
+void AddTimeSeriesListener(const std::string& tsname,
+                           TimeSeriesListener<T> fn) {
+  ListenersOf(*GetTimeSeriesListeners(tsname), static_cast<T*>(NULL))
+      .push_back(fn);
+  ++TIME_SERIES_NLISTENERS;
+}
+
+/// Sets whether Python listeners are registered to a time series. Called by
+/// the Python bindings when their listener lists change.
+void SetPyTimeSeriesListeners(const std::string& tsname, bool has);
+
+/// Sets whether batched Python listeners are registered to a time series.
+/// Rather than being called with each value, these are called once per time
+/// step with the ids of the agents and the values recorded that step, as
+/// arrays. Only numeric values are batched.
+void SetPyBatchTimeSeriesListeners(const std::string& tsname, bool has);
+
+/// Calls the batched Python listeners of each time series that had values
+/// recorded since the last call. The timer calls this at the end of every
+/// time step.
+void FlushTimeSeriesBatches(int time);
+
+/// Removes all the listeners of all time series.
+void ClearTimeSeriesListeners();
+
+/// @brief adds a value to the batch of a series, if it is a number
+/// @{
+template <typename T>
+void AddToTimeSeriesBatch(TimeSeriesListeners* l, cyclus::Agent* agent,
+                          const T& value, std::true_type) {
+  std::lock_guard<std::mutex> lock(l->batch_mu);
+  l->batch_ids.push_back(agent->id());
+  l->batch_values.push_back(static_cast<double>(value));
+}
+
+template <typename T>
+void AddToTimeSeriesBatch(TimeSeriesListeners* l, cyclus::Agent* agent,
+                          const T& value, std::false_type) {}
+/// @}
+
+/// Reduces the values of the time series that aren't recorded value by value
+/// (see SimInfo::timeseries) in memory, and records one row per window of
+/// time steps. Windows start at multiples of their period. Each row holds
+/// the id of the agent (or institution) the window is for, the first time
+/// step of the window, and the reduced value, as a double.
+class TimeSeriesAggregator {
+ public:
+  /// @throws ValueError if a mode is unknown or a period isn't positive
+  explicit TimeSeriesAggregator(const std::map<std::string, TimeSeriesAgg>& aggs);
+
+  /// Takes a value of a series recorded by the agent at the given time.
+  /// Returns false if the value should be recorded as usual, i.e. if the
+  /// series records all its values, or the value is sampled.
+  template <typename T>
+  bool Add(const std::string& series, cyclus::Agent* agent, int time,
+           const T& value) {
+    std::map<std::string, TimeSeriesAgg>::const_iterator it =
+        aggs_.find(series);
+    if (it == aggs_.end() || it->second.mode == "all")
+      return false;
+    const TimeSeriesAgg& agg = it->second;
+    if (agg.mode == "sample")
+      return time % agg.period != 0;
+    return Reduce(series, agg, agent, time, value,
+                  std::is_arithmetic<T>());
+  }
+
+  /// Records the windows that have ended by the end of the current time
+  /// step, or all of them if all is true.
+  void Flush(Context* ctx, bool all);
+
+ private:
+  struct Window {
+    int start;
+    int n;
+    double sum;
+    double min;
+    double max;
+  };
+
+  /// Adds a numeric value to its window.
+  template <typename T>
+  bool Reduce(const std::string& series, const TimeSeriesAgg& agg,
+              cyclus::Agent* agent, int time, const T& value,
+              std::true_type) {
+    Accumulate(series, agg, agent, time, static_cast<double>(value));
+    return true;
+  }
+
+  /// Values that aren't numbers can only be sampled, and are otherwise
+  /// recorded as usual.
+  template <typename T>
+  bool Reduce(const std::string& series, const TimeSeriesAgg& agg,
+              cyclus::Agent* agent, int time, const T& value,
+              std::false_type) {
+    return false;
+  }
+
+  void Accumulate(const std::string& series, const TimeSeriesAgg& agg,
+                  cyclus::Agent* agent, int time, double value);
+
+  /// Records a window of a series for the agent (or institution) id.
+  void Record(Context* ctx, const std::string& series, int id,
+              const Window& w);
+
+  std::map<std::string, TimeSeriesAgg> aggs_;
+
+  /// the open windows, by series and agent (or institution) id
+  std::map<std::pair<std::string, int>, Window> windows_;
+};
+
+/// Calls the listeners of a time series with a value recorded to it.
+template <typename T>
+void NotifyTimeSeriesListeners(const std::string& tsname,
+                               cyclus::Agent* agent, int time,
+                               const T& value) {
+  if (TIME_SERIES_NLISTENERS.load(std::memory_order_relaxed) > 0) {
+    TimeSeriesListeners* l = FindTimeSeriesListeners(tsname);
+    if (l != NULL) {
+      const std::vector<TimeSeriesListener<T> >& fns =
+          ListenersOf(*l, static_cast<T*>(NULL));
+      for (int i = 0; i < fns.size(); ++i) {
+        fns[i](agent, time, value, tsname);
+      }
+      if (l->py)
+        PyCallListeners(tsname, agent, agent->context(), time, value);
+      if (l->py_batched)
+        AddToTimeSeriesBatch(l, agent, value, std::is_arithmetic<T>());
+    }
+  }
+  if (!TIME_SERIES_LISTENERS.empty()) {
+    std::map<std::string, std::vector<time_series_listener_t> >::iterator it =
+        TIME_SERIES_LISTENERS.find(tsname);
+    if (it != TIME_SERIES_LISTENERS.end()) {
+      const std::vector<time_series_listener_t>& vec = it->second;
+      for (int i = 0; i < vec.size(); ++i) {
+        boost::get<TimeSeriesListener<T> >(vec[i])(agent, time, value, tsname);
+      }
+    }
+  }
+}
+
 /// Records a per-time step quantity for a given type
 template <TimeSeriesType T>
 void RecordTimeSeries(cyclus::Agent* agent, double value);
 
+/// Returns the name of the time series of a type, e.g. "Power" for POWER.
+std::string TimeSeriesName(TimeSeriesType t);
+
 /// Records a per-time step quantity for a string
 template <typename T>
 void RecordTimeSeries(std::string tsname, cyclus::Agent* agent, T value) {
   std::string tblname = "TimeSeries" + tsname;
   int time = agent->context()->time();
-  agent->context()->NewDatum(tblname)
-       ->AddVal("AgentId", agent->id())
-       ->AddVal("Time", time)
-       ->AddVal("Value", value)
-       ->Record();
-  std::vector<time_series_listener_t> vec = TIME_SERIES_LISTENERS[tsname];
-  for (auto f=vec.begin(); f != vec.end(); ++f){
-    std::function<void(cyclus::Agent*, int, T, std::string)> fn = boost::get<std::function<void(cyclus::Agent*, int, T, std::string)> >(*f);
-    fn(agent, time, value, tsname); 
+  TimeSeriesAggregator* agg = agent->context()->series_aggregator();
+  if (agg == NULL || !agg->Add(tsname, agent, time, value)) {
+    agent->context()->NewDatum(tblname)
+         ->AddVal("AgentId", agent->id())
+         ->AddVal("Time", time)
+         ->AddVal("Value", value)
+         ->Record();
   }
-  PyCallListeners(tsname, agent, agent->context(), time, value);
+  NotifyTimeSeriesListeners(tsname, agent, time, value);
 }
 
+/// The rows of a time series buffered by a TimeSeries handle until the end
+/// of the time step.
+class TimeSeriesRows {
+ public:
+  virtual ~TimeSeriesRows() {}
+
+  /// Records the buffered rows to the context and forgets them.
+  virtual void Flush(Context* ctx) = 0;
+};
+
+/// Registers rows to be flushed with those of a context, returning the key
+/// to unregister them with. Rows are flushed in the order they were
+/// registered.
+int RegisterTimeSeriesRows(Context* ctx, TimeSeriesRows* rows);
+
+/// Stops flushing the rows registered under a key.
+void UnregisterTimeSeriesRows(Context* ctx, int key);
+
+/// Records the rows buffered by the TimeSeries handles of a context. The
+/// timer calls this at the end of every time step and of the simulation.
+void FlushTimeSeries(Context* ctx);
+
+/// A handle for recording an agent's values of a time series. Unlike
+/// RecordTimeSeries, which makes and records a datum per value, looking up
+/// the table by its name each time, a handle looks its table up once and
+/// appends each value to columns that are recorded in bulk at the end of
+/// the time step. Values are aggregated (see SimInfo::timeseries) and
+/// passed to the series' listeners as they are recorded, as with
+/// RecordTimeSeries.
+///
+/// Handles are best bound once per agent, as it enters the simulation:
+///
+/// @code
+/// class Reactor : public cyclus::Facility {
+///   void EnterNotify() {
+///     cyclus::Facility::EnterNotify();
+///     power_.Bind(this, cyclus::toolkit::POWER);
+///   }
+///
+///   void Tock() {
+///     power_.Record(power_cap);
+///   }
+///
+///   cyclus::toolkit::TimeSeries<double> power_;
+/// };
+/// @endcode
+///
+/// Copies of handles, such as those made as agents are cloned, are unbound.
+/// A handle must not outlive its agent's context.
+template <typename T>
+class TimeSeries {
+ public:
+  TimeSeries() : agent_(NULL), key_(-1) {}
+
+  TimeSeries(cyclus::Agent* agent, const std::string& tsname)
+      : agent_(NULL), key_(-1) {
+    Bind(agent, tsname);
+  }
+
+  TimeSeries(const TimeSeries& other) : agent_(NULL), key_(-1) {}
+
+  TimeSeries& operator=(const TimeSeries& other) {
+    Unbind();
+    return *this;
+  }
+
+  ~TimeSeries() { Unbind(); }
+
+  /// Binds the handle to an agent's values of a time series, flushing the
+  /// values recorded to a series it was bound to before.
+  void Bind(cyclus::Agent* agent, const std::string& tsname) {
+    Unbind();
+    agent_ = agent;
+    tsname_ = tsname;
+    rows_.table = agent->context()->GetTable("TimeSeries" + tsname);
+    rows_.agent_id = agent->id();
+    key_ = RegisterTimeSeriesRows(agent->context(), &rows_);
+  }
+
+  /// Binds the handle to an agent's values of a time series of a type.
+  void Bind(cyclus::Agent* agent, TimeSeriesType type) {
+    Bind(agent, TimeSeriesName(type));
+  }
+
+  /// Flushes the values recorded and unbinds the handle.
+  void Unbind() {
+    if (agent_ == NULL)
+      return;
+    rows_.Flush(agent_->context());
+    UnregisterTimeSeriesRows(agent_->context(), key_);
+    agent_ = NULL;
+    key_ = -1;
+  }
+
+  /// Returns whether the handle is bound to a series.
+  inline bool bound() const { return agent_ != NULL; }
+
+  /// Returns the name of the series the handle is bound to.
+  inline const std::string& name() const { return tsname_; }
+
+  /// Records a value of the series at the current time step.
+  ///
+  /// @throws StateError if the handle isn't bound
+  void Record(const T& value) {
+    if (agent_ == NULL)
+      throw StateError("values can't be recorded to an unbound time series");
+    Context* ctx = agent_->context();
+    int time = ctx->time();
+    TimeSeriesAggregator* agg = ctx->series_aggregator();
+    if (agg == NULL || !agg->Add(tsname_, agent_, time, value)) {
+      rows_.times.push_back(time);
+      rows_.values.push_back(value);
+    }
+    NotifyTimeSeriesListeners(tsname_, agent_, time, value);
+  }
+
+ private:
+  struct Rows : public TimeSeriesRows {
+    Rows() : table(NULL), agent_id(-1) {}
+
+    virtual void Flush(Context* ctx) {
+      for (int i = 0; i < times.size(); ++i) {
+        ctx->NewDatum(table)
+            ->AddVal("AgentId", agent_id)
+            ->AddVal("Time", times[i])
+            ->AddVal("Value", values[i])
+            ->Record();
+      }
+      times.clear();
+      values.clear();
+    }
+
+    Recorder::Table* table;
+    int agent_id;
+    std::vector<int> times;
+    std::vector<T> values;
+  };
+
+  cyclus::Agent* agent_;
+  std::string tsname_;
+  int key_;
+  Rows rows_;
+};
+
 }  // namespace toolkit
 }  // namespace cyclus
 
@@ -0,0 +1,75 @@
+#include "tracer.h"
+
+#include <fstream>
+#include <iomanip>
+
+#include "error.h"
+
+namespace cyclus {
+
+Tracer::Tracer(std::string path)
+    : path_(path), start_(Clock::now()), time_(-1) {
+  threads_.push_back(std::this_thread::get_id());
+}
+
+int Tracer::ThreadId() {
+  std::thread::id id = std::this_thread::get_id();
+  for (int i = 0; i < threads_.size(); ++i) {
+    if (threads_[i] == id)
+      return i;
+  }
+  threads_.push_back(id);
+  return threads_.size() - 1;
+}
+
+void Tracer::Add(const char* name, const char* cat, Clock::time_point start,
+                 Clock::time_point end) {
+  Span s;
+  s.name = name;
+  s.cat = cat;
+  s.ts = std::chrono::duration<double, std::micro>(start - start_).count();
+  s.dur = std::chrono::duration<double, std::micro>(end - start).count();
+  s.time = time_;
+  std::lock_guard<std::mutex> lock(mu_);
+  s.tid = ThreadId();
+  spans_.push_back(s);
+}
+
+int Tracer::size() {
+  std::lock_guard<std::mutex> lock(mu_);
+  return spans_.size();
+}
+
+void Tracer::Write(std::ostream* out) {
+  std::ofstream f;
+  if (out == NULL) {
+    f.open(path_.c_str());
+    if (!f.is_open()) {
+      throw IOError("could not open trace file '" + path_ + "'");
+    }
+    out = &f;
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+  std::ostream& o = *out;
+  o << std::fixed << std::setprecision(3);
+  o << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  o << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+    << "\"args\":{\"name\":\"cyclus\"}}";
+  for (int i = 0; i < threads_.size(); ++i) {
+    o << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+      << ",\"args\":{\"name\":\""
+      << (i == 0 ? std::string("main") : "worker " + std::to_string(i))
+      << "\"}}";
+  }
+  for (int i = 0; i < spans_.size(); ++i) {
+    const Span& s = spans_[i];
+    o << ",\n{\"name\":\"" << s.name << "\",\"cat\":\"" << s.cat
+      << "\",\"ph\":\"X\",\"ts\":" << s.ts << ",\"dur\":" << s.dur
+      << ",\"pid\":1,\"tid\":" << s.tid << ",\"args\":{\"time\":" << s.time
+      << "}}";
+  }
+  o << "\n]}\n";
+}
+
+}  // namespace cyclus
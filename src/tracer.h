@@ -0,0 +1,97 @@
+#ifndef CYCLUS_SRC_TRACER_H_
+#define CYCLUS_SRC_TRACER_H_
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cyclus {
+
+/// Collects spans of time in a simulation, such as the phases of each time
+/// step, the phases of each resource exchange, snapshots, and the writes of
+/// the recorder to its backends, and writes them as Chrome trace-event JSON.
+/// The file can be opened in chrome://tracing or https://ui.perfetto.dev to
+/// see where time goes across time steps, which aggregated timings hide.
+///
+/// Each span is a complete ("X") event on the thread it ran on, and carries
+/// the time step it ran at as its "time" argument. Spans are kept in memory
+/// and written by Write; a run of many time steps with tracing on takes a
+/// few hundred bytes per step.
+///
+/// Tracing is turned on with Context::trace.
+class Tracer {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  /// Creates a tracer that writes to path.
+  explicit Tracer(std::string path);
+
+  /// Returns the path the trace is written to.
+  const std::string& path() const { return path_; }
+
+  /// Sets the time step that spans are tagged with.
+  void set_time(int t) { time_ = t; }
+
+  /// Adds a span of the calling thread named name in category cat, that
+  /// started at start and ended at end. Spans may be added from many threads
+  /// at once. name and cat must outlive the tracer.
+  void Add(const char* name, const char* cat, Clock::time_point start,
+           Clock::time_point end);
+
+  /// Returns the number of spans added.
+  int size();
+
+  /// Writes the trace to out, or to path() if out is NULL.
+  void Write(std::ostream* out = NULL);
+
+ private:
+  struct Span {
+    const char* name;
+    const char* cat;
+    double ts;  ///< start, in microseconds since the tracer was created
+    double dur;  ///< in microseconds
+    int tid;
+    int time;
+  };
+
+  /// Returns a small id of the calling thread, the thread that created the
+  /// tracer being 0. Must be called with mu_ held.
+  int ThreadId();
+
+  std::string path_;
+  Clock::time_point start_;
+  std::atomic<int> time_;
+  std::mutex mu_;
+  std::vector<Span> spans_;
+  std::vector<std::thread::id> threads_;
+};
+
+/// Adds a span to a tracer from its creation until it goes out of scope, if
+/// tracer isn't NULL.
+class TraceSpan {
+ public:
+  TraceSpan(Tracer* tracer, const char* name, const char* cat)
+      : tracer_(tracer), name_(name), cat_(cat) {
+    if (tracer_ != NULL)
+      start_ = Tracer::Clock::now();
+  }
+
+  ~TraceSpan() {
+    if (tracer_ != NULL)
+      tracer_->Add(name_, cat_, start_, Tracer::Clock::now());
+  }
+
+ private:
+  Tracer* tracer_;
+  const char* name_;
+  const char* cat_;
+  Tracer::Clock::time_point start_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_TRACER_H_
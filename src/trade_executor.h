@@ -1,12 +1,24 @@
 #ifndef CYCLUS_SRC_TRADE_EXECUTOR_H_
 #define CYCLUS_SRC_TRADE_EXECUTOR_H_
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
 #include <map>
 #include <set>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "agent_profiler.h"
 #include "context.h"
+#include "id_allocator.h"
+#include "recorder.h"
+#include "res_tracker.h"
+#include "table_writer.h"
+#include "task_scheduler.h"
 #include "trade.h"
 #include "trader.h"
 #include "trader_management.h"
@@ -43,11 +55,34 @@ struct TradeExecutionContext {
 ///     #. Collecting responses for the group of trades from each supplier
 ///     #. Grouping all responses by requester (receiver)
 ///     #. Sending all grouped responses to their respective requester
+///
+/// ExecuteTrades groups trades by sorting a single flat array of them, rather
+/// than by filling the maps of a TradeExecutionContext, and hands each
+/// supplier and requester its contiguous run of the array. Suppliers and
+/// requesters are visited, and transactions are recorded, in the same order as
+/// the grouping functions below would produce.
+///
+/// If given more than one thread, and a context, the responses of suppliers
+/// whose trade callbacks are thread-safe (see Trader::ThreadSafeTrades) are
+/// collected on up to threads() threads before the other suppliers are
+/// visited. What they record is committed in supplier order, so the output
+/// is the same as when responses are collected serially, save for the ids
+/// of the resources they create.
 template <class T>
 class TradeExecutor {
  public:
+  typedef std::pair<Trade<T>, typename T::Ptr> Response;
+
   explicit TradeExecutor(const std::vector< Trade<T> >& trades)
-      : trades_(trades) {}
+      : trades_(trades), ctx_(NULL), profiler_(NULL), threads_(1) {}
+
+  /// @brief sets the number of threads that the responses of thread-safe
+  /// suppliers are collected on. The default is 1, i.e., all suppliers are
+  /// visited serially.
+  void set_threads(int n) { threads_ = n < 1 ? 1 : n; }
+
+  /// @brief the number of threads that thread-safe suppliers respond on
+  int threads() const { return threads_; }
 
   /// @brief execute all trades, collecting responders from bidders and sending
   /// responses to requesters
@@ -62,45 +97,51 @@ class TradeExecutor {
   /// @brief execute all trades, collecting responders from bidders and sending
   /// responses to requesters
   void ExecuteTrades(Context* ctx) {
-    GroupTradesBySupplier(trade_ctx_, trades_);
-    GetTradeResponses(trade_ctx_);
+    ctx_ = ctx;
+    profiler_ = ctx == NULL ? NULL : ctx->profiler();
+    GetResponses();
     if (ctx != NULL) {
       RecordTrades(ctx);
     }
-    SendTradeResources(trade_ctx_);
+    SendResponses();
   }
 
-  /// @brief Record all trades with the appropriate backends
+  /// @brief Record all trades with the appropriate backends, grouped by
+  /// supplier and requester
   ///
   /// @param ctx the Context through which communication with backends will
   /// occur
   void RecordTrades(Context* ctx) {
-    // record all trades
-    typename std::map<std::pair<Trader*, Trader*>,
-        std::vector< std::pair<Trade<T>, typename T::Ptr> > >::iterator m_it;
-    for (m_it = trade_ctx_.all_trades.begin();
-         m_it != trade_ctx_.all_trades.end(); ++m_it) {
-      Agent* supplier = m_it->first.first->manager();
-      Agent* requester = m_it->first.second->manager();
-      typename std::vector< std::pair<Trade<T>, typename T::Ptr> >&
-          trades = m_it->second;
-      typename std::vector< std::pair<Trade<T>, typename T::Ptr> >::iterator
-          v_it;
-      for (v_it = trades.begin(); v_it != trades.end(); ++v_it) {
-        Trade<T>& trade = v_it->first;
-        typename T::Ptr rsrc =  v_it->second;
-        ctx->NewDatum("Transactions")
-            ->AddVal("TransactionId", ctx->NextTransactionID())
-            ->AddVal("SenderId", supplier->id())
-            ->AddVal("ReceiverId", requester->id())
-            ->AddVal("ResourceId", rsrc->state_id())
-            ->AddVal("Commodity", trade.request->commodity())
-            ->AddVal("Time", ctx->time())
-            ->Record();
+    std::vector<int> order = Order(SupplierRequesterLess(responses_));
+    int n = order.size();
+    std::vector<int> ids(n);
+    std::vector<int> senders(n);
+    std::vector<int> receivers(n);
+    std::vector<int> rsrcs(n);
+    std::vector<std::string> commods(n);
+    std::vector<int> times(n, ctx->time());
+    for (int i = 0; i != n; ++i) {
+      const Response& r = responses_[order[i]];
+      ids[i] = ctx->NextTransactionID();
+      senders[i] = r.first.bid->bidder()->manager()->id();
+      receivers[i] = r.first.request->requester()->manager()->id();
+      rsrcs[i] = r.second->state_id();
+      if (ctx->coalescer() != NULL) {
+        ctx->coalescer()->Pin(rsrcs[i]);
       }
+      commods[i] = r.first.request->commodity();
+    }
+    if (n > 0) {
+      ctx->tables().transactions.RecordColumns(
+          n, &ids[0], &senders[0], &receivers[0], &rsrcs[0], &commods[0],
+          &times[0]);
     }
   }
 
+  /// @brief the responses of all suppliers, in supplier order, once trades
+  /// have been executed
+  inline const std::vector<Response>& responses() const { return responses_; }
+
   inline const TradeExecutionContext<T>& trade_ctx() const {
     return trade_ctx_;
   }
@@ -109,8 +150,168 @@ class TradeExecutor {
   }
 
  private:
+  /// orders responses by requester
+  struct RequesterLess {
+    explicit RequesterLess(const std::vector<Response>& r) : r(r) {}
+    bool operator()(int lhs, int rhs) const {
+      return std::less<Trader*>()(r[lhs].first.request->requester(),
+                                  r[rhs].first.request->requester());
+    }
+    const std::vector<Response>& r;
+  };
+
+  /// orders responses by supplier, then requester
+  struct SupplierRequesterLess {
+    explicit SupplierRequesterLess(const std::vector<Response>& r) : r(r) {}
+    bool operator()(int lhs, int rhs) const {
+      Trader* ls = r[lhs].first.bid->bidder();
+      Trader* rs = r[rhs].first.bid->bidder();
+      if (ls != rs)
+        return std::less<Trader*>()(ls, rs);
+      return std::less<Trader*>()(r[lhs].first.request->requester(),
+                                  r[rhs].first.request->requester());
+    }
+    const std::vector<Response>& r;
+  };
+
+  /// returns the positions of responses_ stably sorted by comp
+  template <class Comp>
+  std::vector<int> Order(Comp comp) const {
+    std::vector<int> order(responses_.size());
+    for (int i = 0; i != order.size(); ++i) {
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), comp);
+    return order;
+  }
+
+  /// collects the responses of each supplier to its run of the trades sorted
+  /// by supplier
+  void GetResponses() {
+    std::vector<const Trade<T>*> sorted(trades_.size());
+    for (int i = 0; i != trades_.size(); ++i) {
+      sorted[i] = &trades_[i];
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), SupplierLess);
+
+    std::vector<Trader*> suppliers;
+    std::vector<std::vector< Trade<T> > > slices;
+    for (int i = 0; i != sorted.size();) {
+      Trader* supplier = sorted[i]->bid->bidder();
+      suppliers.push_back(supplier);
+      slices.push_back(std::vector< Trade<T> >());
+      for (; i != sorted.size() && sorted[i]->bid->bidder() == supplier; ++i) {
+        slices.back().push_back(*sorted[i]);
+      }
+    }
+    int n = suppliers.size();
+    std::vector<std::vector<Response> > rs(n);
+    std::vector<bool> done(n, false);
+    RespondConcurrently(suppliers, slices, &rs, &done);
+
+    responses_.clear();
+    responses_.reserve(trades_.size());
+    for (int i = 0; i != n; ++i) {
+      if (!done[i]) {
+        ProfileCall p(profiler_, suppliers[i]->manager(),
+                      AgentProfiler::TRADES);
+        PopulateTradeResponses(suppliers[i], slices[i], rs[i]);
+      }
+      responses_.insert(responses_.end(), rs[i].begin(), rs[i].end());
+    }
+  }
+
+  /// sets (*rs)[i] to the responses of the ith supplier to slices[i], and
+  /// (*done)[i] to true, for the thread-safe suppliers, on up to threads_
+  /// threads, if there are at least two of them. The data each records is
+  /// committed in supplier order. If any throws, nothing that it or later
+  /// suppliers recorded is committed, and the exception of the first such
+  /// supplier is rethrown.
+  void RespondConcurrently(
+      const std::vector<Trader*>& suppliers,
+      const std::vector<std::vector< Trade<T> > >& slices,
+      std::vector<std::vector<Response> >* rs, std::vector<bool>* done) {
+    if (ctx_ == NULL || threads_ < 2)
+      return;
+    int n = suppliers.size();
+    std::vector<int> parallel;
+    for (int i = 0; i != n; ++i) {
+      if (suppliers[i]->ThreadSafeTrades())
+        parallel.push_back(i);
+    }
+    if (parallel.size() < 2)
+      return;
+
+    std::vector<DatumList> staged(n);
+    std::vector<std::exception_ptr> errs(n);
+    Recorder* rec = ctx_->rec_;
+    ctx_->tables();  // creates the shared table writers up front
+
+    std::atomic<int> next(0);
+    IdAllocator* ids = IdAllocator::current();
+    auto worker = [&]() {
+      IdAllocator::Scope scope(ids);
+      for (int k = next++; k < parallel.size(); k = next++) {
+        int i = parallel[k];
+        rec->StartStaging(&staged[i]);
+        try {
+          ProfileCall p(profiler_, suppliers[i]->manager(),
+                        AgentProfiler::TRADES);
+          PopulateTradeResponses(suppliers[i], slices[i], (*rs)[i]);
+        } catch (...) {
+          errs[i] = std::current_exception();
+        }
+        rec->StopStaging();
+      }
+    };
+    ctx_->scheduler()->RunWorkers(std::min<int>(threads_, parallel.size()),
+                                  worker);
+
+    for (int k = 0; k != parallel.size(); ++k) {
+      int i = parallel[k];
+      if (errs[i]) {
+        for (int j = k; j != parallel.size(); ++j) {
+          rec->Discard(&staged[parallel[j]]);
+        }
+        std::rethrow_exception(errs[i]);
+      }
+      rec->Commit(&staged[i]);
+      (*done)[i] = true;
+    }
+  }
+
+  /// sends each requester its run of the responses sorted by requester
+  void SendResponses() {
+    std::vector<int> order = Order(RequesterLess(responses_));
+    std::vector<Response> slice;
+    for (int i = 0; i != order.size();) {
+      Trader* requester = responses_[order[i]].first.request->requester();
+      slice.clear();
+      for (; i != order.size() &&
+             responses_[order[i]].first.request->requester() == requester;
+           ++i) {
+        slice.push_back(responses_[order[i]]);
+      }
+      ProfileCall p(profiler_, requester->manager(), AgentProfiler::ACCEPT);
+      AcceptTrades(requester, slice);
+    }
+  }
+
+  static bool SupplierLess(const Trade<T>* lhs, const Trade<T>* rhs) {
+    return std::less<Trader*>()(lhs->bid->bidder(), rhs->bid->bidder());
+  }
+
   const std::vector< Trade<T> >& trades_;
+  std::vector<Response> responses_;
   TradeExecutionContext<T> trade_ctx_;
+
+  /// the context trades are executed in, if any
+  Context* ctx_;
+
+  /// the profiler of the context trades are executed in, if any
+  AgentProfiler* profiler_;
+
+  int threads_;
 };
 
 /// @brief populates suppliers_, requesters_, and trades_by_supplier_
@@ -1,6 +1,7 @@
 #ifndef CYCLUS_SRC_TRADER_H_
 #define CYCLUS_SRC_TRADER_H_
 
+#include <future>
 #include <set>
 
 #include "bid_portfolio.h"
@@ -29,6 +30,86 @@ class Trader {
     return manager_;
   }
 
+  /// @brief whether this trader's request and bid callbacks (GetMatlRequests,
+  /// GetProductRequests, GetMatlBids, and GetProductBids) may be called
+  /// concurrently with those of other traders. Traders that return true may be
+  /// queried on a pool of threads while an exchange collects requests and
+  /// bids; results are merged in the usual trader order either way.
+  ///
+  /// @warning thread-safe callbacks may only modify the trader's own state and
+  /// the portfolios they return. In particular, they must not record data,
+  /// create tracked resources or products of a new quality, build or
+  /// decommission agents, or insert into the commod_requests map (use find()
+  /// rather than operator[]).
+  virtual bool ThreadSafeExchange() { return false; }
+
+  /// @brief whether this trader's GetMatlTrades and GetProductTrades may be
+  /// called concurrently with those of other suppliers. The responses of
+  /// thread-safe suppliers are prepared on a pool of threads (see
+  /// ExchangeManager::threads) before those of the others, and the data they
+  /// record is held back and recorded in the usual supplier order. Requesters
+  /// always accept their trades serially, in order, afterwards.
+  ///
+  /// @warning thread-safe trade callbacks may only modify the trader's own
+  /// state and the resources it owns. They may create resources and record
+  /// data, but must not build or decommission agents or interact with other
+  /// agents directly.
+  virtual bool ThreadSafeTrades() { return false; }
+
+  /// @brief whether this trader requests or bids on resources of a type,
+  /// Material::kType or Product::kType. Exchanges only query the traders that
+  /// take part in them, and an exchange that no trader takes part in isn't
+  /// run at all. The default is true for every type.
+  ///
+  /// @warning this is asked as the trader is registered with the context
+  /// (see Context::RegisterTrader), and the answer is kept until the trader
+  /// is registered again.
+  virtual bool TradesResource(const ResourceType& type) { return true; }
+
+  /// @brief sets commods to the commodities of resource type type that this
+  /// trader bids on and returns true, or returns false, the default, if it
+  /// may bid on any commodity. A trader that names its commodities is only
+  /// asked for bids (see StartMatlBids and GetMatlBids) at exchanges with
+  /// requests for at least one of them, and never if it names none.
+  ///
+  /// @warning as with TradesResource, this is asked as the trader is
+  /// registered, so traders whose commodities change must register again.
+  virtual bool BidCommods(const ResourceType& type,
+                          std::set<std::string>* commods) {
+    return false;
+  }
+
+  /// @brief starts work that GetMatlRequests needs, such as a call to an
+  /// external code, which may then run while other traders are queried. If
+  /// the returned future is valid, the exchange waits for it, after starting
+  /// that of every other trader, and only then calls GetMatlRequests on the
+  /// main thread, in the usual trader order. The default returns no future.
+  ///
+  /// @warning the work of the future must not touch the simulation, i.e., it
+  /// may only modify the trader's own state, and must not create resources
+  /// or record data. Leave those to GetMatlRequests.
+  virtual std::future<void> StartMatlRequests() {
+    return std::future<void>();
+  }
+
+  /// @brief starts work that GetProductRequests needs (see StartMatlRequests)
+  virtual std::future<void> StartProductRequests() {
+    return std::future<void>();
+  }
+
+  /// @brief starts work that GetMatlBids needs (see StartMatlRequests). The
+  /// commod_requests are the same as those then passed to GetMatlBids.
+  virtual std::future<void> StartMatlBids(
+      CommodMap<Material>::type& commod_requests) {
+    return std::future<void>();
+  }
+
+  /// @brief starts work that GetProductBids needs (see StartMatlRequests)
+  virtual std::future<void> StartProductBids(
+      CommodMap<Product>::type& commod_requests) {
+    return std::future<void>();
+  }
+
   /// @brief default implementation for material requests
   virtual std::set<RequestPortfolio<Material>::Ptr>
       GetMatlRequests() {
@@ -1,6 +1,8 @@
 #ifndef CYCLUS_SRC_TRADER_MANAGEMENT_H_
 #define CYCLUS_SRC_TRADER_MANAGEMENT_H_
 
+#include <future>
+
 #include "error.h"
 #include "exchange_context.h"
 #include "product.h"
@@ -46,6 +48,39 @@ inline std::set<BidPortfolio<Product>::Ptr>
   return t->GetProductBids(map);
 }
 
+template<class T>
+inline static std::future<void> StartRequests(Trader* t) {
+  throw StateError("Non-specialized version of StartRequests not supported");
+}
+
+template<>
+inline std::future<void> StartRequests<Material>(Trader* t) {
+  return t->StartMatlRequests();
+}
+
+template<>
+inline std::future<void> StartRequests<Product>(Trader* t) {
+  return t->StartProductRequests();
+}
+
+template<class T>
+inline static std::future<void> StartBids(
+    Trader* t, typename CommodMap<T>::type& map) {
+  throw StateError("Non-specialized version of StartBids not supported");
+}
+
+template<>
+inline std::future<void> StartBids<Material>(
+    Trader* t, CommodMap<Material>::type& map) {
+  return t->StartMatlBids(map);
+}
+
+template<>
+inline std::future<void> StartBids<Product>(
+    Trader* t, CommodMap<Product>::type& map) {
+  return t->StartProductBids(map);
+}
+
 template<class T>
 inline static void PopulateTradeResponses(
     Trader* trader,
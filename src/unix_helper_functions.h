@@ -30,9 +30,7 @@ void DynamicModule::SetConstructor() {
 
   if (!ctor_) {
     std::stringstream ss;
-    std::string agent = ctor_name_;
-    agent.erase(0, 9);  // len(Construct) == 9
-    ss << "Could not find agent " << agent << " in module library "
+    ss << "Could not find " << kind_ << " " << name_ << " in module library "
        << path_.c_str() << " (" << dlerror() << ").";
     throw IOError(ss.str());
   }
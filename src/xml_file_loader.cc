@@ -2,14 +2,23 @@
 #include "xml_file_loader.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
 #include <fstream>
+#include <functional>
 #include <set>
 #include <streambuf>
+#include <stdint.h>
+#include <thread>
 
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <libxml++/libxml++.h>
 
 #include "agent.h"
+#include "auction_solver.h"
 #include "blob.h"
 #include "context.h"
 #include "cyc_std.h"
@@ -18,10 +27,18 @@
 #include "exchange_solver.h"
 #include "greedy_preconditioner.h"
 #include "greedy_solver.h"
+#include "hdf5_back.h"
 #include "infile_tree.h"
+#include "json_infile_tree.h"
 #include "logger.h"
+#include "nuc_registry.h"
 #include "sim_init.h"
+#include "sqlite_back.h"
+#include "staging_back.h"
+#include "task_scheduler.h"
 #include "toolkit/infile_converters.h"
+#include "version.h"
+#include "xml_stream_reader.h"
 
 namespace cyclus {
 
@@ -60,20 +77,73 @@ std::string LoadStringFromFile(std::string file, std::string format) {
   return input.str();
 }
 
+namespace {
+
+// Whether the input file is read as a stream rather than all at once.
+bool StreamInput(const std::string& file, const std::string& format) {
+  std::string ext = fs::path(file).extension().string();
+  return format == "none" && ext != ".json" && ext != ".py" &&
+         !Env::GetEnv("CYCLUS_STREAM_INPUT").empty();
+}
+
+// Whether the input file is JSON that is read as it is rather than converted
+// to XML.
+bool NativeJson(const std::string& file, const std::string& format) {
+  std::string ext = fs::path(file).extension().string();
+  return (format == "json" || (format == "none" && ext == ".json")) &&
+         !Env::GetEnv("CYCLUS_NATIVE_JSON").empty();
+}
+
+// Returns the text of a JSON input, which is the input itself for formats
+// other than "none".
+std::string LoadJson(const std::string& file, const std::string& format) {
+  if (format != "none") {
+    return file;
+  }
+  std::stringstream ss;
+  LoadRawStringstreamFromFile(ss, file);
+  return ss.str();
+}
+
+// Wraps top-level elements in a root element of the given name.
+std::string Wrap(const std::string& root, const std::string& xml) {
+  return "<" + root + ">" + xml + "</" + root + ">";
+}
+
+}  // namespace
+
 std::vector<AgentSpec> ParseSpecs(std::string infile, std::string format) {
+  XMLParser parser;
+  boost::scoped_ptr<InfileTree> xqe;
   std::stringstream input;
-  LoadStringstreamFromFile(input, infile, format);
-  XMLParser parser_;
-  parser_.Init(input);
-  InfileTree xqe(parser_);
+  if (NativeJson(infile, format)) {
+    xqe.reset(new JsonInfileTree(LoadJson(infile, format)));
+  } else if (StreamInput(infile, format)) {
+    // only the archetypes are needed, not the whole input
+    XMLStreamReader reader(infile);
+    std::string name, xml;
+    while (reader.Next(&name, &xml)) {
+      if (name == "archetypes") {
+        break;
+      }
+      xml.clear();
+    }
+    input << Wrap(reader.root(), xml);
+  } else {
+    LoadStringstreamFromFile(input, infile, format);
+  }
+  if (!xqe) {
+    parser.Init(input);
+    xqe.reset(new InfileTree(parser));
+  }
 
   std::vector<AgentSpec> specs;
   std::set<std::string> unique;
 
   std::string p = "/simulation/archetypes/spec";
-  int n = xqe.NMatches(p);
+  int n = xqe->NMatches(p);
   for (int i = 0; i < n; ++i) {
-    AgentSpec spec(xqe.SubTree(p, i));
+    AgentSpec spec(xqe->SubTree(p, i));
     if (unique.count(spec.str()) == 0) {
       specs.push_back(spec);
       unique.insert(spec.str());
@@ -87,6 +157,68 @@ std::vector<AgentSpec> ParseSpecs(std::string infile, std::string format) {
   return specs;
 }
 
+namespace {
+
+// Returns the key identifying the master schema built from the given
+// template and specs, or an empty string if it cannot be cached because a
+// module is not a shared library on disk.
+std::string SchemaCacheKey(const std::string& master,
+                           std::vector<AgentSpec>& specs) {
+  std::stringstream key;
+  key << version::core() << " " << std::hash<std::string>()(master);
+  try {
+    for (int i = 0; i < specs.size(); ++i) {
+      std::string lib = Env::FindModule(specs[i].LibPath(), specs[i].lib());
+      if (boost::starts_with(lib, "<py>")) {
+        return "";
+      }
+      key << " " << specs[i].str() << "=" << specs[i].alias() << "@" << lib
+          << ":" << fs::last_write_time(lib) << ":" << fs::file_size(lib);
+    }
+  } catch (const std::exception& e) {
+    return "";
+  }
+  return key.str();
+}
+
+// Reads a cached master schema whose first line must match key.
+bool ReadCachedSchema(const fs::path& file, const std::string& key,
+                      std::string* master) {
+  std::ifstream in(file.string().c_str());
+  std::string line;
+  if (!in || !std::getline(in, line) || line != key) {
+    return false;
+  }
+  std::stringstream ss;
+  ss << in.rdbuf();
+  *master = ss.str();
+  return true;
+}
+
+// Writes a master schema to the cache. The file is written under a temporary
+// name and then moved into place so that concurrent runs never read a
+// partially written schema. Failures leave the cache unchanged.
+void WriteCachedSchema(const fs::path& file, const std::string& key,
+                       const std::string& master) {
+  boost::system::error_code errc;
+  fs::path tmp = file;
+  tmp += "." + fs::unique_path().string();
+  {
+    std::ofstream out(tmp.string().c_str());
+    out << key << "\n" << master;
+    if (!out) {
+      fs::remove(tmp, errc);
+      return;
+    }
+  }
+  fs::rename(tmp, file, errc);
+  if (errc) {
+    fs::remove(tmp, errc);
+  }
+}
+
+}  // namespace
+
 std::string BuildMasterSchema(std::string schema_path, std::string infile, std::string format) {
   Timer ti;
   Recorder rec;
@@ -98,6 +230,23 @@ std::string BuildMasterSchema(std::string schema_path, std::string infile, std::
 
   std::vector<AgentSpec> specs = ParseSpecs(infile, format);
 
+  // reuse a schema built by an earlier run from the same template and modules
+  std::string cache_dir = Env::GetEnv("CYCLUS_SCHEMA_CACHE");
+  std::string key;
+  fs::path cache_file;
+  if (!cache_dir.empty()) {
+    key = SchemaCacheKey(master, specs);
+  }
+  if (!key.empty()) {
+    std::stringstream name;
+    name << "master-" << std::hex << std::hash<std::string>()(key) << ".rng";
+    cache_file = fs::path(cache_dir) / name.str();
+    std::string cached;
+    if (ReadCachedSchema(cache_file, key, &cached)) {
+      return cached;
+    }
+  }
+
   std::map<std::string, std::string> subschemas;
 
   // force element types to exist so we always replace the config string
@@ -123,6 +272,11 @@ std::string BuildMasterSchema(std::string schema_path, std::string infile, std::
     }
   }
 
+  if (!key.empty()) {
+    boost::system::error_code errc;
+    fs::create_directories(cache_dir, errc);
+    WriteCachedSchema(cache_file, key, master);
+  }
   return master;
 }
 
@@ -137,15 +291,15 @@ Composition::Ptr ReadRecipe(InfileTree* qe) {
     throw IOError(basis_str + " basis is not 'mass' or 'atom'.");
   }
 
-  double value;
-  int key;
-  std::string query = "nuclide";
-  int nnucs = qe->NMatches(query);
+  std::vector<std::string> fields;
+  fields.push_back("id");
+  fields.push_back("comp");
+  std::vector<std::vector<std::string> > nucs =
+      qe->GetStrings("nuclide", fields);
   CompMap v;
-  for (int i = 0; i < nnucs; i++) {
-    InfileTree* nuclide = qe->SubTree(query, i);
-    key = pyne::nucname::id(nuclide->GetString("id"));
-    value = strtod(nuclide->GetString("comp").c_str(), NULL);
+  for (int i = 0; i < nucs.size(); i++) {
+    int key = NucRegistry::Instance().Id(nucs[i][0]);
+    double value = strtod(nucs[i][1].c_str(), NULL);
     v[key] = value;
     CLOG(LEV_DEBUG3) << "  Nuclide: " << key << " Value: " << v[key];
   }
@@ -157,23 +311,110 @@ Composition::Ptr ReadRecipe(InfileTree* qe) {
   }
 }
 
+namespace {
+
+// identifies a recipe library file and its format version
+const char kRecipeLibraryMagic[8] = {'C', 'Y', 'C', 'R', 'E', 'C', 'P', '1'};
+
+template <class T>
+void WriteRaw(std::ostream& out, const T& val) {
+  out.write(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+template <class T>
+T ReadRaw(std::istream& in) {
+  T val;
+  in.read(reinterpret_cast<char*>(&val), sizeof(T));
+  return val;
+}
+
+}  // namespace
+
+void WriteRecipeLibrary(std::string path,
+                        const std::map<std::string, Composition::Ptr>& recipes) {
+  std::ofstream out(path.c_str(), std::ios::binary);
+  if (!out) {
+    throw IOError("The file '" + path + "' could not be written.");
+  }
+  out.write(kRecipeLibraryMagic, sizeof(kRecipeLibraryMagic));
+  WriteRaw<uint32_t>(out, recipes.size());
+  std::map<std::string, Composition::Ptr>::const_iterator it;
+  for (it = recipes.begin(); it != recipes.end(); ++it) {
+    WriteRaw<uint32_t>(out, it->first.size());
+    out.write(it->first.data(), it->first.size());
+    const CompMap& v = it->second->mass();
+    WriteRaw<uint32_t>(out, v.size());
+    CompMap::const_iterator nuc;
+    for (nuc = v.begin(); nuc != v.end(); ++nuc) {
+      WriteRaw<int32_t>(out, nuc->first);
+      WriteRaw<double>(out, nuc->second);
+    }
+  }
+  if (!out) {
+    throw IOError("The file '" + path + "' could not be written.");
+  }
+}
+
+std::map<std::string, Composition::Ptr> ReadRecipeLibrary(std::string path) {
+  std::ifstream in(path.c_str(), std::ios::binary);
+  if (!in) {
+    throw IOError("The file '" + path + "' could not be loaded.");
+  }
+  char magic[sizeof(kRecipeLibraryMagic)];
+  in.read(magic, sizeof(magic));
+  if (!in || !std::equal(magic, magic + sizeof(magic), kRecipeLibraryMagic)) {
+    throw IOError("The file '" + path + "' is not a recipe library.");
+  }
+
+  std::map<std::string, Composition::Ptr> recipes;
+  uint32_t nrecipes = ReadRaw<uint32_t>(in);
+  for (uint32_t i = 0; in && i < nrecipes; ++i) {
+    std::string name(ReadRaw<uint32_t>(in), '\0');
+    in.read(&name[0], name.size());
+    uint32_t nnucs = ReadRaw<uint32_t>(in);
+    CompMap v;
+    for (uint32_t j = 0; in && j < nnucs; ++j) {
+      int nuc = ReadRaw<int32_t>(in);
+      v[nuc] = ReadRaw<double>(in);
+    }
+    recipes[name] = Composition::CreateFromMass(v);
+  }
+  if (!in) {
+    throw IOError("The recipe library '" + path + "' is truncated.");
+  }
+  return recipes;
+}
+
 XMLFileLoader::XMLFileLoader(Recorder* r,
                              QueryableBackend* b,
                              std::string schema_file,
                              const std::string input_file,
                              const std::string format, bool ms_print) : b_(b), rec_(r) {
+  InitPhase phase("ReadInput");
   ctx_ = new Context(&ti_, rec_);
 
   schema_path_ = schema_file;
   file_ = input_file;
   format_ = format;
-  std::stringstream input;
-  LoadStringstreamFromFile(input, file_, format);
-  parser_ = boost::shared_ptr<XMLParser>(new XMLParser());
-  parser_->Init(input);
   ms_print_ = ms_print;
+  stream_ = StreamInput(file_, format_);
+  std::string nthreads = Env::GetEnv("CYCLUS_LOAD_THREADS");
+  load_threads_ = nthreads.empty() ? 1 : std::atoi(nthreads.c_str());
+  parser_ = boost::shared_ptr<XMLParser>(new XMLParser());
   std::stringstream ss;
-  parser_->Document()->write_to_stream_formatted(ss);
+  if (NativeJson(file_, format_)) {
+    // the input is read in place, so it is recorded as written
+    ss << LoadJson(file_, format_);
+    json_ = JsonInfileTree::Parse(ss.str());
+  } else if (stream_) {
+    // the input is parsed as it is loaded, so it is recorded as written
+    LoadRawStringstreamFromFile(ss, file_);
+  } else {
+    std::stringstream input;
+    LoadStringstreamFromFile(input, file_, format);
+    parser_->Init(input);
+    parser_->Document()->write_to_stream_formatted(ss);
+  }
   ctx_->NewDatum("InputFiles")
       ->AddVal("Data", Blob(ss.str()))
       ->Record();
@@ -188,32 +429,132 @@ std::string XMLFileLoader::master_schema() {
 }
 
 void XMLFileLoader::LoadSim() {
-  std::stringstream ss(master_schema());
+  if (stream_) {
+    StreamSim();
+    return;
+  }
+  // native JSON input is checked without the master schema, which is then
+  // only built to be printed
+  std::stringstream ss;
+  if (!json_ || ms_print_) {
+    InitPhase phase("BuildSchema");
+    ss.str(master_schema());
+  }
   if(ms_print_){
-    std::cout << master_schema() << std::endl;
+    std::cout << ss.str() << std::endl;
+  }
+  {
+    InitPhase phase("Validate");
+    if (json_) {
+      boost::scoped_ptr<InfileTree> xqe(NewTree());
+      ValidateJsonInput(xqe.get());
+    } else {
+      parser_->Validate(ss);
+    }
+  }
+  {
+    InitPhase phase("LoadSettings");
+    LoadControlParams();  // must be first
+    LoadSolver();
+    LoadRecipes();
+  }
+  {
+    InitPhase phase("LoadSpecs");
+    LoadSpecs();
+  }
+  LoadInitialAgents();  // must be last
+  {
+    InitPhase phase("Snapshot");
+    SimInit::Snapshot(ctx_);
+    rec_->Flush();
+  }
+}
+
+void XMLFileLoader::StreamSim() {
+  std::string schema = master_schema();
+  if (ms_print_) {
+    std::cout << schema << std::endl;
+  }
+  XMLStreamReader reader(file_);
+  reader.SetSchema(schema);
+
+  // facility prototypes make up the bulk of large inputs and are loaded one
+  // at a time as they are read. Everything else is gathered into a skeleton
+  // of the input for the usual loaders. Facilities can only be loaded once
+  // the control parameters and archetypes are known, so any read before
+  // those are held back until then.
+  std::string skeleton;
+  std::vector<std::string> pending;
+  bool control = false;
+  bool archetypes = false;
+  bool ready = false;
+  std::string name, xml;
+  while (reader.Next(&name, &xml)) {
+    if (name == "facility") {
+      if (ready) {
+        LoadPrototype(xml);
+      } else {
+        pending.push_back(xml);
+      }
+      continue;
+    }
+
+    skeleton += xml;
+    control = control || name == "control";
+    archetypes = archetypes || name == "archetypes";
+    if (!ready && control && archetypes) {
+      ready = true;
+      parser_->Init(Wrap(reader.root(), skeleton));
+      LoadControlParams();  // must be first
+      LoadSpecs();
+      for (int i = 0; i < pending.size(); ++i) {
+        LoadPrototype(pending[i]);
+      }
+      pending.clear();
+    }
+  }
+
+  parser_->Init(Wrap(reader.root(), skeleton));
+  if (!ready) {
+    LoadControlParams();  // must be first
+    LoadSpecs();
   }
-  parser_->Validate(ss);
-  LoadControlParams();  // must be first
   LoadSolver();
   LoadRecipes();
-  LoadSpecs();
+  for (int i = 0; i < pending.size(); ++i) {
+    LoadPrototype(pending[i]);
+  }
   LoadInitialAgents();  // must be last
   SimInit::Snapshot(ctx_);
   rec_->Flush();
 }
 
+InfileTree* XMLFileLoader::NewTree() {
+  if (json_) {
+    return new JsonInfileTree(json_);
+  }
+  return new InfileTree(*parser_);
+}
+
+void XMLFileLoader::LoadPrototype(const std::string& xml) {
+  XMLParser parser;
+  parser.Init(xml);
+  InfileTree qe(parser);
+  LoadPrototype(&qe);
+}
+
 void XMLFileLoader::LoadSolver() {
   using std::string;
-  InfileTree xqe(*parser_);
+  boost::scoped_ptr<InfileTree> xqe(NewTree());
   InfileTree* qe;
   std::string query = "/*/commodity";
 
   std::map<std::string, double> commod_priority;
   std::string name;
   double priority;
-  int num_commods = xqe.NMatches(query);
+  int num_commods = xqe->NMatches(query);
   for (int i = 0; i < num_commods; i++) {
-    qe = xqe.SubTree(query, i);
+    qe = xqe->SubTree(query, i);
     name = qe->GetString("name");
     priority = OptionalQuery<double>(qe, "solution_priority", -1);
     commod_priority[name] = priority;
@@ -232,10 +573,13 @@ void XMLFileLoader::LoadSolver() {
   string config = "config";
   string greedy = "greedy";
   string coinor = "coin-or";
+  string flow = "min-cost-flow";
+  string auction = "auction";
+  string plugin = "plugin";
   string solver_name = greedy;
   bool exclusive = ExchangeSolver::kDefaultExclusive;
-  if (xqe.NMatches("/*/control/solver") == 1) {
-    qe = xqe.SubTree("/*/control/solver");
+  if (xqe->NMatches("/*/control/solver") == 1) {
+    qe = xqe->SubTree("/*/control/solver");
     if (qe->NMatches(config) == 1) {
       solver_name = qe->SubTree(config)->GetElementName(0);
     }
@@ -268,22 +612,66 @@ void XMLFileLoader::LoadSolver() {
   // now load the actual solver
   if (solver_name == greedy) {
     query = string("/*/control/solver/config/greedy/preconditioner");
-    string precon_name = cyclus::OptionalQuery<string>(&xqe, query, greedy);
+    string precon_name = cyclus::OptionalQuery<string>(xqe.get(), query, greedy);
     ctx_->NewDatum("GreedySolverInfo")
       ->AddVal("Preconditioner", precon_name)
       ->Record();
   } else if (solver_name == coinor) {
     query = string("/*/control/solver/config/coin-or/timeout");
-    double timeout = cyclus::OptionalQuery<double>(&xqe, query, -1);
+    double timeout = cyclus::OptionalQuery<double>(xqe.get(), query, -1);
     query = string("/*/control/solver/config/coin-or/verbose");
-    bool verbose = cyclus::OptionalQuery<bool>(&xqe, query, false);
+    bool verbose = cyclus::OptionalQuery<bool>(xqe.get(), query, false);
     query = string("/*/control/solver/config/coin-or/mps");
-    bool mps = cyclus::OptionalQuery<bool>(&xqe, query, false);
+    bool mps = cyclus::OptionalQuery<bool>(xqe.get(), query, false);
     ctx_->NewDatum("CoinSolverInfo")
       ->AddVal("Timeout", timeout)
       ->AddVal("Verbose", verbose)
       ->AddVal("Mps", mps)
       ->Record();
+    query = string("/*/control/solver/config/coin-or/threads");
+    int threads = cyclus::OptionalQuery<int>(xqe.get(), query, 1);
+    query = string("/*/control/solver/config/coin-or/time_limit");
+    double time_limit = cyclus::OptionalQuery<double>(xqe.get(), query, 0);
+    query = string("/*/control/solver/config/coin-or/gap");
+    double gap = cyclus::OptionalQuery<double>(xqe.get(), query, -1);
+    query = string("/*/control/solver/config/coin-or/presolve");
+    bool presolve = cyclus::OptionalQuery<bool>(xqe.get(), query, true);
+    ctx_->NewDatum("CbcSolverInfo")
+      ->AddVal("Threads", threads)
+      ->AddVal("TimeLimit", time_limit)
+      ->AddVal("Gap", gap)
+      ->AddVal("Presolve", presolve)
+      ->Record();
+  } else if (solver_name == flow) {
+    // the options of the coin-or solver that exchanges fall back to
+    query = string("/*/control/solver/config/min-cost-flow/timeout");
+    double timeout = cyclus::OptionalQuery<double>(xqe.get(), query, -1);
+    query = string("/*/control/solver/config/min-cost-flow/verbose");
+    bool verbose = cyclus::OptionalQuery<bool>(xqe.get(), query, false);
+    ctx_->NewDatum("CoinSolverInfo")
+      ->AddVal("Timeout", timeout)
+      ->AddVal("Verbose", verbose)
+      ->AddVal("Mps", false)
+      ->Record();
+  } else if (solver_name == auction) {
+    query = string("/*/control/solver/config/auction/gap");
+    double gap = cyclus::OptionalQuery<double>(xqe.get(), query,
+                                               AuctionSolver::kDefaultGap);
+    query = string("/*/control/solver/config/auction/threads");
+    int threads = cyclus::OptionalQuery<int>(xqe.get(), query, 0);
+    ctx_->NewDatum("AuctionSolverInfo")
+      ->AddVal("Gap", gap)
+      ->AddVal("Threads", threads)
+      ->Record();
+  } else if (solver_name == plugin) {
+    query = string("/*/control/solver/config/plugin/spec");
+    string spec = xqe->GetString(query);
+    query = string("/*/control/solver/config/plugin/options");
+    string options = cyclus::OptionalQuery<string>(xqe.get(), query, "");
+    ctx_->NewDatum("PluginSolverInfo")
+      ->AddVal("Spec", spec)
+      ->AddVal("Options", options)
+      ->Record();
   } else {
     throw ValueError("unknown solver name: " + solver_name);
   }
@@ -312,18 +700,36 @@ void XMLFileLoader::ProcessCommodities(
 }
 
 void XMLFileLoader::LoadRecipes() {
-  InfileTree xqe(*parser_);
+  boost::scoped_ptr<InfileTree> xqe(NewTree());
 
   std::string query = "/*/recipe";
-  int num_recipes = xqe.NMatches(query);
+  int num_recipes = xqe->NMatches(query);
   for (int i = 0; i < num_recipes; i++) {
-    InfileTree* qe = xqe.SubTree(query, i);
+    InfileTree* qe = xqe->SubTree(query, i);
     std::string name = qe->GetString("name");
     CLOG(LEV_DEBUG3) << "loading recipe: " << name;
     Composition::Ptr comp = ReadRecipe(qe);
     comp->Record(ctx_);
     ctx_->AddRecipe(name, comp);
   }
+
+  // relative library paths are relative to the input file
+  query = "/*/recipe_library";
+  int num_libs = xqe->NMatches(query);
+  for (int i = 0; i < num_libs; i++) {
+    fs::path path(xqe->GetString(query, i));
+    if (path.is_relative() && format_ == "none") {
+      path = fs::path(file_).parent_path() / path;
+    }
+    CLOG(LEV_DEBUG3) << "loading recipe library: " << path.string();
+    std::map<std::string, Composition::Ptr> recipes =
+        ReadRecipeLibrary(path.string());
+    std::map<std::string, Composition::Ptr>::iterator it;
+    for (it = recipes.begin(); it != recipes.end(); ++it) {
+      it->second->Record(ctx_);
+      ctx_->AddRecipe(it->first, it->second);
+    }
+  }
 }
 
 void XMLFileLoader::LoadSpecs() {
@@ -333,54 +739,173 @@ void XMLFileLoader::LoadSpecs() {
   }
 }
 
+namespace {
+
+// Translates the input of a newly constructed prototype and initializes it
+// from the result. The translated rows are staged in staged, and anything
+// recorded while initializing is staged in late, so that they can be
+// committed around the prototype's registration.
+void InitPrototype(Recorder* rec, InfileTree* qe, Agent* agent,
+                   AgentSpec spec, DatumList* staged, DatumList* late) {
+  rec->StartStaging(staged);
+  try {
+    // call manually without agent impl injected to keep all Agent state
+    // in a single, consolidated db table
+    agent->Agent::InfileToDb(qe, DbInit(agent, true));
+
+    agent->InfileToDb(qe, DbInit(agent));
+  } catch (...) {
+    rec->StopStaging();
+    throw;
+  }
+  rec->StopStaging();
+
+  // read the prototype's state back from memory rather than making a round
+  // trip through the output database.
+  std::vector<Cond> conds;
+  conds.push_back(Cond("SimId", "==", rec->sim_id()));
+  conds.push_back(Cond("SimTime", "==", static_cast<int>(0)));
+  conds.push_back(Cond("AgentId", "==", agent->id()));
+  StagingBack sb(staged);
+  CondInjector ci(&sb, conds);
+  PrefixInjector pi(&ci, "AgentState");
+
+  rec->StartStaging(late);
+  try {
+    // call manually without agent impl injected
+    agent->Agent::InitFrom(&pi);
+
+    pi = PrefixInjector(&ci, "AgentState" + spec.Sanitize());
+    agent->InitFrom(&pi);
+  } catch (...) {
+    rec->StopStaging();
+    throw;
+  }
+  rec->StopStaging();
+}
+
+// Whether the archetype of spec is implemented in Python, and so must not be
+// initialized concurrently with other agents.
+bool IsPySpec(AgentSpec spec) {
+  try {
+    return boost::starts_with(Env::FindModule(spec.LibPath(), spec.lib()),
+                              "<py>");
+  } catch (const Error& e) {
+    // e.g. archetypes registered manually for testing
+    return false;
+  }
+}
+
+}  // namespace
+
+void XMLFileLoader::LoadPrototype(InfileTree* qe) {
+  std::vector<InfileTree*> qes(1, qe);
+  LoadPrototypes(qes);
+}
+
+void XMLFileLoader::LoadPrototypes(const std::vector<InfileTree*>& qes) {
+  // agents are constructed in input order so that their ids do not depend on
+  // how they are initialized
+  int n = qes.size();
+  std::vector<Agent*> agents(n);
+  std::vector<AgentSpec> specs(n);
+  for (int i = 0; i < n; ++i) {
+    std::string alias = qes[i]->SubTree("config")->GetElementName(0);
+    specs[i] = specs_[alias];
+    agents[i] = DynamicModule::Make(ctx_, specs[i]);
+  }
+
+  std::vector<DatumList> staged(n);
+  std::vector<DatumList> late(n);
+  std::vector<std::exception_ptr> errs(n);
+  std::vector<char> done(n, false);
+
+  std::vector<int> parallel;
+  if (load_threads_ > 1 && n > 1) {
+    std::map<std::string, bool> py;
+    for (int i = 0; i < n; ++i) {
+      std::string s = specs[i].str();
+      if (py.count(s) == 0) {
+        py[s] = IsPySpec(specs[i]);
+      }
+      if (!py[s]) {
+        parallel.push_back(i);
+      }
+    }
+  }
+  if (parallel.size() > 1) {
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+      for (int k = next++; k < parallel.size(); k = next++) {
+        int i = parallel[k];
+        try {
+          InitPrototype(rec_, qes[i], agents[i], specs[i], &staged[i],
+                        &late[i]);
+        } catch (...) {
+          errs[i] = std::current_exception();
+        }
+        done[i] = true;
+      }
+    };
+    ctx_->scheduler()->RunWorkers(
+        std::min<int>(load_threads_, parallel.size()), worker);
+  }
+
+  // register the prototypes in input order, initializing the rest as they
+  // come, so that the output matches a serial load
+  for (int i = 0; i < n; ++i) {
+    if (!done[i]) {
+      try {
+        InitPrototype(rec_, qes[i], agents[i], specs[i], &staged[i],
+                      &late[i]);
+      } catch (...) {
+        errs[i] = std::current_exception();
+      }
+    }
+    if (errs[i]) {
+      // the prototypes not yet registered are owned by no one else
+      for (int j = i; j < n; ++j) {
+        rec_->Discard(&staged[j]);
+        rec_->Discard(&late[j]);
+        ctx_->DelAgent(agents[j]);
+      }
+      std::rethrow_exception(errs[i]);
+    }
+
+    std::string prototype = qes[i]->GetString("name");
+    rec_->Commit(&late[i]);
+    ctx_->AddPrototype(prototype, agents[i]);
+
+    // the staged rows reach the output backends with the next flush
+    rec_->Commit(&staged[i]);
+  }
+}
+
 void XMLFileLoader::LoadInitialAgents() {
   std::map<std::string, std::string> schema_paths;
   schema_paths["Region"] = "/*/region";
   schema_paths["Inst"] = "/*/region/institution";
   schema_paths["Facility"] = "/*/facility";
 
-  InfileTree xqe(*parser_);
+  boost::scoped_ptr<InfileTree> xqe(NewTree());
 
   // create prototypes
-  std::string prototype;  // defined here for force-create AgentExit tbl
-  std::map<std::string, std::string>::iterator it;
-  for (it = schema_paths.begin(); it != schema_paths.end(); it++) {
-    int num_agents = xqe.NMatches(it->second);
-    for (int i = 0; i < num_agents; i++) {
-      InfileTree* qe = xqe.SubTree(it->second, i);
-      prototype = qe->GetString("name");
-      std::string alias = qe->SubTree("config")->GetElementName(0);
-      AgentSpec spec = specs_[alias];
-
-      Agent* agent = DynamicModule::Make(ctx_, spec);
-
-      // call manually without agent impl injected to keep all Agent state in a
-      // single, consolidated db table
-      agent->Agent::InfileToDb(qe, DbInit(agent, true));
-
-      agent->InfileToDb(qe, DbInit(agent));
-      rec_->Flush();
-
-      std::vector<Cond> conds;
-      conds.push_back(Cond("SimId", "==", rec_->sim_id()));
-      conds.push_back(Cond("SimTime", "==", static_cast<int>(0)));
-      conds.push_back(Cond("AgentId", "==", agent->id()));
-      CondInjector ci(b_, conds);
-      PrefixInjector pi(&ci, "AgentState");
-
-      // call manually without agent impl injected
-      agent->Agent::InitFrom(&pi);
-
-      pi = PrefixInjector(&ci, "AgentState" + spec.Sanitize());
-      agent->InitFrom(&pi);
-      ctx_->AddPrototype(prototype, agent);
+  {
+    InitPhase phase("InitPrototypes");
+    std::vector<InfileTree*> protos;
+    std::map<std::string, std::string>::iterator it;
+    for (it = schema_paths.begin(); it != schema_paths.end(); it++) {
+      std::vector<InfileTree*> qes = xqe->SubTrees(it->second);
+      protos.insert(protos.end(), qes.begin(), qes.end());
     }
+    LoadPrototypes(protos);
   }
 
   // build initial agent instances
-  int nregions = xqe.NMatches(schema_paths["Region"]);
+  InitPhase phase("BuildAgents");
+  int nregions = xqe->NMatches(schema_paths["Region"]);
   for (int i = 0; i < nregions; ++i) {
-    InfileTree* qe = xqe.SubTree(schema_paths["Region"], i);
+    InfileTree* qe = xqe->SubTree(schema_paths["Region"], i);
     std::string region_proto = qe->GetString("name");
     Agent* reg = BuildAgent(region_proto, NULL);
 
@@ -390,15 +915,14 @@ void XMLFileLoader::LoadInitialAgents() {
       std::string inst_proto = qe2->GetString("name");
       Agent* inst = BuildAgent(inst_proto, reg);
 
-      int nfac = qe2->NMatches("initialfacilitylist/entry");
-      for (int k = 0; k < nfac; ++k) {
-        InfileTree* qe3 = qe2->SubTree("initialfacilitylist/entry", k);
+      std::vector<InfileTree*> facs =
+          qe2->SubTrees("initialfacilitylist/entry");
+      for (int k = 0; k < facs.size(); ++k) {
+        InfileTree* qe3 = facs[k];
         std::string fac_proto = qe3->GetString("prototype");
 
         int number = atoi(qe3->GetString("number").c_str());
-        for (int z = 0; z < number; ++z) {
-          Agent* fac = BuildAgent(fac_proto, inst);
-        }
+        ctx_->BuildAgents(fac_proto, inst, number);
       }
     }
   }
@@ -413,10 +937,36 @@ Agent* XMLFileLoader::BuildAgent(std::string proto, Agent* parent) {
   return m;
 }
 
+namespace {
+
+/// Reads the chunking and compression options under qe, taking those that
+/// aren't given from base.
+Hdf5Layout ReadHdf5Layout(InfileTree* qe, const Hdf5Layout& base) {
+  Hdf5Layout l = base;
+  l.chunk_rows = OptionalQuery<int>(qe, "chunk_rows", l.chunk_rows);
+  l.deflate = OptionalQuery<int>(qe, "deflate", l.deflate);
+  l.shuffle = OptionalQuery<bool>(qe, "shuffle", l.shuffle);
+  l.filter = OptionalQuery<int>(qe, "filter", l.filter);
+  l.adaptive_width = OptionalQuery<int>(qe, "adaptive_width",
+                                        l.adaptive_width);
+  if (qe->NMatches("filter_opts") == 1) {
+    InfileTree* opts = qe->SubTree("filter_opts");
+    int n = opts->NMatches("val");
+    l.filter_opts.clear();
+    for (int i = 0; i < n; ++i) {
+      l.filter_opts.push_back(strtoul(opts->GetString("val", i).c_str(),
+                                      NULL, 10));
+    }
+  }
+  return l;
+}
+
+}  // namespace
+
 void XMLFileLoader::LoadControlParams() {
-  InfileTree xqe(*parser_);
+  boost::scoped_ptr<InfileTree> xqe(NewTree());
   std::string query = "/*/control";
-  InfileTree* qe = xqe.SubTree(query);
+  InfileTree* qe = xqe->SubTree(query);
 
   std::string handle;
   if (qe->NMatches("simhandle") > 0) {
@@ -439,6 +989,18 @@ void XMLFileLoader::LoadControlParams() {
 
   si.explicit_inventory = OptionalQuery<bool>(qe, "explicit_inventory", false);
   si.explicit_inventory_compact = OptionalQuery<bool>(qe, "explicit_inventory_compact", false);
+  si.dre_timings = OptionalQuery<bool>(qe, "dre_timings", false);
+  si.dre_regions = OptionalQuery<bool>(qe, "dre_regions", false);
+  si.dre_coarsen = OptionalQuery<std::string>(qe, "dre_coarsen", "");
+  si.threads = OptionalQuery<int>(qe, "threads", 0);
+  si.max_trade_distance = OptionalQuery<double>(qe, "max_trade_distance", 0);
+  si.compact_output = OptionalQuery<bool>(qe, "compact_output", false);
+  si.dense_output = OptionalQuery<bool>(qe, "dense_output", false);
+  si.checkpoint_steps = OptionalQuery<int>(qe, "checkpoint_steps", 0);
+  si.checkpoint_secs = OptionalQuery<double>(qe, "checkpoint_seconds", 0);
+  si.decay_transfer = OptionalQuery<bool>(qe, "decay_transfer", false);
+  si.sparse_decay = OptionalQuery<bool>(qe, "sparse_decay", false);
+  si.seed = OptionalQuery<int>(qe, "seed", 0);
 
   // get time step duration
   si.dt = OptionalQuery<int>(qe, "dt", kDefaultTimeStepDur);
@@ -451,6 +1013,74 @@ void XMLFileLoader::LoadControlParams() {
   double eps_rsrc_ = OptionalQuery<double>(qe, "tolerance_resource", 1e-6);
   cy_eps_rsrc = si.eps_rsrc = eps_rsrc_;
 
+  // lengths of the steps taken through quiescent stretches
+  if (qe->NMatches("step_schedule") == 1) {
+    InfileTree* sqe = qe->SubTree("step_schedule");
+    for (int i = 0; i < sqe->NMatches("step"); ++i) {
+      InfileTree* stqe = sqe->SubTree("step", i);
+      si.step_schedule[Query<int>(stqe, "start")] =
+          Query<int>(stqe, "length");
+    }
+  }
+
+  // time series recorded at a coarser cadence
+  if (qe->NMatches("timeseries") == 1) {
+    InfileTree* tsqe = qe->SubTree("timeseries");
+    for (int i = 0; i < tsqe->NMatches("series"); ++i) {
+      InfileTree* sqe = tsqe->SubTree("series", i);
+      TimeSeriesAgg agg;
+      agg.mode = sqe->GetString("mode");
+      agg.period = OptionalQuery<int>(sqe, "period", agg.period);
+      agg.by_institution = OptionalQuery<bool>(sqe, "by_institution",
+                                               agg.by_institution);
+      si.timeseries[sqe->GetString("name")] = agg;
+    }
+  }
+
+  // tables filtered out; those recorded given on the command line take
+  // precedence, and those skipped add to the command line's
+  std::set<std::string> allow = rec_->allowed_tables();
+  std::set<std::string> deny = rec_->denied_tables();
+  if (allow.empty() && qe->NMatches("record_tables") == 1) {
+    InfileTree* tqe = qe->SubTree("record_tables");
+    for (int i = 0; i < tqe->NMatches("val"); ++i)
+      allow.insert(tqe->GetString("val", i));
+  }
+  if (qe->NMatches("skip_tables") == 1) {
+    InfileTree* tqe = qe->SubTree("skip_tables");
+    for (int i = 0; i < tqe->NMatches("val"); ++i)
+      deny.insert(tqe->GetString("val", i));
+  }
+  rec_->FilterTables(allow, deny);
+
+  // hdf5 table layouts, which must be set before any table is created
+  Hdf5Back* h5back = dynamic_cast<Hdf5Back*>(b_);
+  if (h5back != NULL && qe->NMatches("hdf5") == 1) {
+    InfileTree* h5qe = qe->SubTree("hdf5");
+    Hdf5Layout layout = ReadHdf5Layout(h5qe, h5back->layout());
+    h5back->set_layout(layout);
+    int ntables = h5qe->NMatches("table");
+    for (int i = 0; i < ntables; ++i) {
+      InfileTree* tqe = h5qe->SubTree("table", i);
+      h5back->set_layout(tqe->GetString("name"), ReadHdf5Layout(tqe, layout));
+    }
+  }
+
+  // sqlite indexes, which are created when the output is closed unless
+  // asked for as tables are created
+  SqliteBack* sqlback = dynamic_cast<SqliteBack*>(b_);
+  if (sqlback != NULL && qe->NMatches("sqlite") == 1) {
+    InfileTree* sqe = qe->SubTree("sqlite");
+    if (sqe->NMatches("index_tables") == 1) {
+      InfileTree* tqe = sqe->SubTree("index_tables");
+      std::set<std::string> tables;
+      for (int i = 0; i < tqe->NMatches("val"); ++i)
+        tables.insert(tqe->GetString("val", i));
+      sqlback->index_tables(tables);
+    }
+    sqlback->index_on_create(OptionalQuery<bool>(sqe, "index_on_create",
+                                                 false));
+  }
 
   ctx_->InitSim(si);
 }
@@ -9,6 +9,7 @@
 #include "composition.h"
 #include "dynamic_module.h"
 #include "infile_tree.h"
+#include "json_infile_tree.h"
 #include "xml_parser.h"
 #include "timer.h"
 #include "recorder.h"
@@ -35,13 +36,25 @@ std::vector<AgentSpec> ParseSpecs(std::string infile, std::string format="none")
 
 /// Builds and returns a master cyclus input xml schema that includes the
 /// sub-schemas defined by all installed cyclus modules (e.g. facility agents).
-/// This is used to validate simulation input files.
+/// This is used to validate simulation input files. If the CYCLUS_SCHEMA_CACHE
+/// environment variable names a directory, the schema is cached there and
+/// reused until the template, specs, or archetype libraries change.
 std::string BuildMasterSchema(std::string schema_path, std::string infile,
                               std::string format="none");
 
 /// Creates a composition from the recipe in the query engine.
 Composition::Ptr ReadRecipe(InfileTree* qe);
 
+/// Writes the given recipes, by name, to a binary recipe library file that
+/// inputs may reference with a recipe_library element. Compositions are
+/// stored by normalized mass in the native byte order.
+void WriteRecipeLibrary(std::string path,
+                        const std::map<std::string, Composition::Ptr>& recipes);
+
+/// Reads the recipes of a binary recipe library file written by
+/// WriteRecipeLibrary.
+std::map<std::string, Composition::Ptr> ReadRecipeLibrary(std::string path);
+
 /// Handles initialization of a database with information from
 /// a cyclus xml input file.
 ///
@@ -61,6 +74,14 @@ class XMLFileLoader {
 
   /// Load an entire simulation from the inputfile.
   ///
+  /// If the CYCLUS_STREAM_INPUT environment variable is set, xml input files
+  /// are validated and loaded as they are read rather than parsed into memory
+  /// whole, and facility prototypes are created as soon as they are read.
+  ///
+  /// If the CYCLUS_NATIVE_JSON environment variable is set, json input files
+  /// are read in place by a JsonInfileTree rather than converted to xml, and
+  /// are checked by ValidateJsonInput rather than the master schema.
+  ///
   /// @param use_flat_schema whether or not to use the flat schema
   virtual void LoadSim();
 
@@ -74,18 +95,43 @@ class XMLFileLoader {
   /// Method to load the simulation control parameters.
   void LoadControlParams();
 
-  /// Method to load recipes from either the primary input file
-  /// or a recipeBook catalog.
+  /// Method to load recipes from the primary input file and from the binary
+  /// recipe libraries it references.
   void LoadRecipes();
 
   /// loads a specific recipe
   void LoadRecipe(InfileTree* qe);
 
   /// Creates all initial agent instances from the input file.
+  ///
+  /// If the CYCLUS_LOAD_THREADS environment variable is greater than one,
+  /// prototypes are initialized from their input concurrently on that many
+  /// threads (see LoadPrototypes).
   virtual void LoadInitialAgents();
 
+  /// Creates and registers the prototype defined by an agent element of the
+  /// input file.
+  void LoadPrototype(InfileTree* qe);
+  void LoadPrototype(const std::string& xml);
+
+  /// Creates and registers the prototypes defined by the given agent elements
+  /// of the input file. The prototypes are constructed and registered in the
+  /// given order, so agent ids and output are the same as with LoadPrototype,
+  /// but with more than one load thread the input of C++ prototypes is
+  /// translated and read back concurrently in between.
+  ///
+  /// @warning concurrently initialized archetypes must only modify their own
+  /// state in InfileToDb and InitFrom.
+  void LoadPrototypes(const std::vector<InfileTree*>& qes);
+
+  /// Loads the simulation while streaming the input file.
+  void StreamSim();
+
   virtual std::string master_schema();
 
+  /// Returns a new infile tree for the whole input, which the caller owns.
+  InfileTree* NewTree();
+
   /// Processes commodity priorities, such that any without a defined priority
   /// (i.e., are nonpositive), are given priority lower than the last known
   /// commodity
@@ -112,11 +158,20 @@ class XMLFileLoader {
   /// the parser
   boost::shared_ptr<XMLParser> parser_;
 
+  /// the json input, if it is read in place rather than by the parser
+  boost::shared_ptr<const Json::Value> json_;
+
   /// the input file name
   std::string file_;
 
   /// the input file format
   std::string format_;
+
+  /// whether the input file is streamed rather than parsed whole
+  bool stream_;
+
+  /// the number of threads prototypes are initialized on
+  int load_threads_;
 };
 
 }  // namespace cyclus
@@ -1,5 +1,7 @@
 #include "xml_flat_loader.h"
 
+#include <boost/scoped_ptr.hpp>
+
 #include "agent.h"
 #include "context.h"
 #include "env.h"
@@ -45,12 +47,12 @@ std::string XMLFlatLoader::master_schema() {
 }
 
 void XMLFlatLoader::LoadInitialAgents() {
-  InfileTree xqe(*parser_);
+  boost::scoped_ptr<InfileTree> xqe(NewTree());
 
   // create prototypes
-  int num_protos = xqe.NMatches("/*/prototype");
+  int num_protos = xqe->NMatches("/*/prototype");
   for (int i = 0; i < num_protos; i++) {
-    InfileTree* qe = xqe.SubTree("/*/prototype", i);
+    InfileTree* qe = xqe->SubTree("/*/prototype", i);
     std::string prototype = qe->GetString("name");
     std::string alias = qe->SubTree("config")->GetElementName(0);
     AgentSpec spec = specs_[alias];
@@ -80,13 +82,13 @@ void XMLFlatLoader::LoadInitialAgents() {
   }
 
   // retrieve agent hierarchy and initial inventories
-  int num_agents = xqe.NMatches("/*/agent");
+  int num_agents = xqe->NMatches("/*/agent");
   std::map<std::string, std::string> protos;  // map<name, prototype>
   std::map<std::string, std::string> parents;  // map<agent, parent>
   std::set<std::string> agents;  // set<agent_name>
   std::map<std::string, InfileTree*> invs;  // map<agent, qe>;
   for (int i = 0; i < num_agents; i++) {
-    InfileTree* qe = xqe.SubTree("/*/agent", i);
+    InfileTree* qe = xqe->SubTree("/*/agent", i);
     std::string name = qe->GetString("name");
     std::string proto = qe->GetString("prototype");
     std::string parent = OptionalQuery<std::string>(qe, "parent", "");
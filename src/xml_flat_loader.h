@@ -1,6 +1,7 @@
 #ifndef CYCLUS_SRC_XML_FLAT_LOADER_H_
 #define CYCLUS_SRC_XML_FLAT_LOADER_H_
 
+#include "error.h"
 #include "xml_file_loader.h"
 
 namespace cyclus {
@@ -18,7 +19,12 @@ class XMLFlatLoader : public XMLFileLoader {
   XMLFlatLoader(Recorder* r, QueryableBackend* b, std::string schema_path, 
                 const std::string load_filename="", const std::string format="none",
                 bool ms_print=false)
-      : XMLFileLoader(r, b, schema_path, load_filename, format, ms_print) {}
+      : XMLFileLoader(r, b, schema_path, load_filename, format, ms_print) {
+    if (json_) {
+      throw ValidationError("json input is only read in place with the "
+                            "nested schema; unset CYCLUS_NATIVE_JSON");
+    }
+  }
 
   /// Creates all initial agent instances from the input file.
   void LoadInitialAgents();
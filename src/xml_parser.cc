@@ -1,6 +1,7 @@
 #include "xml_parser.h"
 
 #include <stdlib.h>
+#include <mutex>
 #include <string>
 #include <libxml++/libxml++.h>
 
@@ -44,9 +45,27 @@ void XMLParser::Init(const std::stringstream& xml_input_snippet) {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void XMLParser::Validate(const std::stringstream& xml_schema_snippet) {
-  RelaxNGValidator validator;
-  validator.parse_memory(xml_schema_snippet.str());
-  validator.Validate(this->Document());
+  // compiling a schema is far more expensive than validating against it, so
+  // the most recently compiled one is kept for the next validation.
+  static std::mutex mu;
+  static std::string last_schema;
+  static RelaxNGValidator* last = NULL;
+
+  std::string schema = xml_schema_snippet.str();
+  std::lock_guard<std::mutex> lock(mu);
+  if (last == NULL || schema != last_schema) {
+    RelaxNGValidator* validator = new RelaxNGValidator();
+    try {
+      validator->parse_memory(schema);
+    } catch (...) {
+      delete validator;
+      throw;
+    }
+    delete last;
+    last = validator;
+    last_schema.swap(schema);
+  }
+  last->Validate(this->Document());
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
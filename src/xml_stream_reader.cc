@@ -0,0 +1,94 @@
+#include "xml_stream_reader.h"
+
+#include <libxml/relaxng.h>
+#include <libxml/tree.h>
+#include <libxml/xmlreader.h>
+
+#include "error.h"
+
+namespace cyclus {
+
+XMLStreamReader::XMLStreamReader(const std::string& file)
+    : reader_(NULL),
+      schema_(NULL),
+      skip_(false) {
+  // xml:base attributes added by XIncludes cannot be validated, so they are
+  // never added in the first place
+  reader_ = xmlReaderForFile(file.c_str(), NULL,
+                             XML_PARSE_XINCLUDE | XML_PARSE_NOBASEFIX |
+                             XML_PARSE_NOXINCNODE | XML_PARSE_HUGE);
+  if (reader_ == NULL) {
+    throw IOError("The file '" + file + "' could not be loaded.");
+  }
+}
+
+XMLStreamReader::~XMLStreamReader() {
+  xmlFreeTextReader(reader_);
+  if (schema_ != NULL) {
+    xmlRelaxNGFree(schema_);
+  }
+}
+
+void XMLStreamReader::SetSchema(const std::string& schema) {
+  xmlRelaxNGParserCtxtPtr ctxt =
+      xmlRelaxNGNewMemParserCtxt(schema.c_str(), schema.size());
+  xmlRelaxNG* parsed = xmlRelaxNGParse(ctxt);
+  xmlRelaxNGFreeParserCtxt(ctxt);
+  if (parsed == NULL) {
+    throw ValidationError("Schema could not be parsed");
+  } else if (xmlTextReaderRelaxNGSetSchema(reader_, parsed) != 0) {
+    xmlRelaxNGFree(parsed);
+    throw ValidationError("Schema could not be used to validate the stream");
+  }
+  if (schema_ != NULL) {
+    xmlRelaxNGFree(schema_);
+  }
+  schema_ = parsed;
+}
+
+bool XMLStreamReader::Advance() {
+  int ret = skip_ ? xmlTextReaderNext(reader_) : xmlTextReaderRead(reader_);
+  skip_ = false;
+  if (ret < 0) {
+    throw ValidationError("Error loading xml stream");
+  } else if (ret == 0 && schema_ != NULL && xmlTextReaderIsValid(reader_) != 1) {
+    throw ValidationError("Document failed schema validation");
+  }
+  return ret == 1;
+}
+
+bool XMLStreamReader::Next(std::string* name, std::string* xml) {
+  while (Advance()) {
+    if (xmlTextReaderNodeType(reader_) != XML_READER_TYPE_ELEMENT) {
+      continue;
+    }
+    const char* n =
+        reinterpret_cast<const char*>(xmlTextReaderConstName(reader_));
+    int depth = xmlTextReaderDepth(reader_);
+    if (depth == 0) {
+      root_ = n;
+      continue;
+    } else if (depth != 1) {
+      continue;
+    }
+
+    xmlNodePtr node = xmlTextReaderExpand(reader_);
+    if (node == NULL) {
+      throw ValidationError("Error loading xml element '" + std::string(n) +
+                            "'");
+    }
+    *name = n;
+    xmlBufferPtr buf = xmlBufferCreate();
+    xmlNodeDump(buf, node->doc, node, 0, 0);
+    xml->assign(reinterpret_cast<const char*>(xmlBufferContent(buf)),
+                xmlBufferLength(buf));
+    xmlBufferFree(buf);
+
+    // the element has been handed out whole, so its children are skipped
+    skip_ = true;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace cyclus
@@ -0,0 +1,67 @@
+#ifndef CYCLUS_SRC_XML_STREAM_READER_H_
+#define CYCLUS_SRC_XML_STREAM_READER_H_
+
+#include <string>
+
+struct _xmlTextReader;
+struct _xmlRelaxNG;
+typedef _xmlTextReader xmlTextReader;
+typedef _xmlRelaxNG xmlRelaxNG;
+
+namespace cyclus {
+
+/// Reads an xml file one top-level element at a time, so that documents far
+/// larger than memory can be processed. Only the element being handed out is
+/// ever held in memory; the rest of the document is read as it is needed.
+/// XIncludes are processed as the document is read.
+///
+/// Example usage:
+///
+/// @code
+///
+/// XMLStreamReader r("input.xml");
+/// r.SetSchema(rng);
+/// std::string name, xml;
+/// while (r.Next(&name, &xml)) {
+///   ... handle the child element of the root named name ...
+/// }
+///
+/// @endcode
+class XMLStreamReader {
+ public:
+  /// Opens an xml file for reading.
+  /// @throws IOError if the file cannot be opened
+  explicit XMLStreamReader(const std::string& file);
+
+  ~XMLStreamReader();
+
+  /// Validates the document against a RelaxNG schema as it is read. This must
+  /// be called before the first call to Next.
+  /// @throws ValidationError if the schema cannot be parsed
+  void SetSchema(const std::string& schema);
+
+  /// Reads the next child element of the root element.
+  /// @param name set to the name of the element
+  /// @param xml set to the serialized element, including its children
+  /// @return false once the end of the document has been reached
+  /// @throws ValidationError if the document is malformed or fails
+  /// validation
+  bool Next(std::string* name, std::string* xml);
+
+  /// The name of the root element, once Next has been called.
+  const std::string& root() const { return root_; }
+
+ private:
+  /// reads or, if the reader is on an element that was handed out, skips to
+  /// the next node.
+  bool Advance();
+
+  xmlTextReader* reader_;
+  xmlRelaxNG* schema_;
+  std::string root_;
+  bool skip_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_XML_STREAM_READER_H_
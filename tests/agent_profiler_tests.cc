@@ -0,0 +1,99 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "agent_profiler.h"
+#include "context.h"
+#include "recorder.h"
+#include "timer.h"
+#include "test_agents/test_facility.h"
+
+using cyclus::AgentProfiler;
+using cyclus::Context;
+using cyclus::ProfileCall;
+
+namespace {
+
+class RowBack : public cyclus::RecBackend {
+ public:
+  virtual void Notify(cyclus::DatumList data) {
+    for (int i = 0; i < data.size(); ++i) {
+      if (data[i]->title() == "AgentProfile")
+        rows.push_back(data[i]->vals());
+    }
+  }
+  virtual std::string Name() { return "RowBack"; }
+  virtual void Flush() {}
+  virtual void Close() {}
+
+  std::vector<cyclus::Datum::Vals> rows;
+};
+
+}  // namespace
+
+TEST(AgentProfilerTests, ByPrototype) {
+  cyclus::Timer ti;
+  cyclus::Recorder rec;
+  RowBack back;
+  rec.RegisterBackend(&back);
+  Context ctx(&ti, &rec);
+  EXPECT_EQ(NULL, ctx.profiler());
+  ctx.profile_agents(true);
+  AgentProfiler* prof = ctx.profiler();
+  ASSERT_TRUE(prof != NULL);
+
+  TestFacility* a = new TestFacility(&ctx);
+  TestFacility* b = new TestFacility(&ctx);
+  TestFacility* c = new TestFacility(&ctx);
+  a->prototype("fast");
+  b->prototype("fast");
+  c->prototype("slow");
+  prof->Add(a, AgentProfiler::TICK, 10);
+  prof->Add(b, AgentProfiler::TICK, 20);
+  prof->Add(a, AgentProfiler::BIDS, 5);
+  prof->Add(c, AgentProfiler::TOCK, 1000);
+  {
+    ProfileCall pc(prof, c, AgentProfiler::DECISION);
+  }
+  {
+    ProfileCall pc(NULL, c, AgentProfiler::DECISION);  // not profiling
+  }
+
+  std::map<std::string, AgentProfiler::Entry> e = prof->entries();
+  ASSERT_EQ(2, e.size());
+  EXPECT_EQ(a->spec(), e["fast"].spec);
+  EXPECT_EQ(2, e["fast"].totals[AgentProfiler::TICK].calls);
+  EXPECT_EQ(30, e["fast"].totals[AgentProfiler::TICK].ticks);
+  EXPECT_EQ(1, e["fast"].totals[AgentProfiler::BIDS].calls);
+  EXPECT_EQ(0, e["fast"].totals[AgentProfiler::TOCK].calls);
+  EXPECT_EQ(1, e["slow"].totals[AgentProfiler::TOCK].calls);
+  EXPECT_EQ(1, e["slow"].totals[AgentProfiler::DECISION].calls);
+
+  std::stringstream ss;
+  prof->Summarize(ss, 1);
+  EXPECT_NE(std::string::npos, ss.str().find("slow"));
+  EXPECT_EQ(std::string::npos, ss.str().find("fast"));
+
+  prof->Record(&ctx);
+  rec.Flush();
+  // one row per prototype and call made: fast Tick and Bids, slow Tock and
+  // Decision
+  ASSERT_EQ(4, back.rows.size());
+  cyclus::Datum::Vals& v = back.rows[0];
+  ASSERT_EQ(6, v.size());
+  EXPECT_STREQ("Prototype", v[1].first);
+  EXPECT_EQ("fast", v[1].second.cast<std::string>());
+  EXPECT_EQ("Tick", v[3].second.cast<std::string>());
+  EXPECT_EQ(2, v[4].second.cast<int>());
+  EXPECT_LE(0, v[5].second.cast<double>());
+  EXPECT_EQ("Bids", back.rows[1][3].second.cast<std::string>());
+  EXPECT_EQ("slow", back.rows[2][1].second.cast<std::string>());
+
+  ctx.profile_agents(false);
+  EXPECT_EQ(NULL, ctx.profiler());
+  delete a;
+  delete b;
+  delete c;
+}
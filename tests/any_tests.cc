@@ -0,0 +1,59 @@
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "any.hpp"
+
+using boost::spirit::hold_any;
+
+TEST(AnyTests, SmallStorage) {
+  EXPECT_TRUE(boost::spirit::detail::get_table<int>::is_small::value);
+  EXPECT_TRUE(boost::spirit::detail::get_table<std::string>::is_small::value);
+  EXPECT_FALSE((boost::spirit::detail::get_table<
+                std::map<std::string, int> >::is_small::value));
+
+  // strings too long for their own small buffer
+  std::string s(100, 'a');
+  hold_any a(s);
+  hold_any b(a);
+  EXPECT_EQ(s, a.cast<std::string>());
+  EXPECT_EQ(s, b.cast<std::string>());
+
+  b = 42;
+  EXPECT_EQ(42, b.cast<int>());
+  EXPECT_EQ(42, *reinterpret_cast<const int*>(b.castsmallvoid()));
+  b = s;
+  EXPECT_EQ(s, b.cast<std::string>());
+}
+
+typedef std::map<std::string, int> StrIntMap;
+
+TEST(AnyTests, Move) {
+  StrIntMap m;
+  m["a"] = 1;
+  hold_any big(m);
+  hold_any small(std::string("x"));
+
+  hold_any moved(std::move(big));
+  EXPECT_TRUE(big.empty());
+  EXPECT_EQ(1, moved.cast<StrIntMap>().at("a"));
+
+  big = std::move(small);
+  EXPECT_TRUE(small.empty());
+  EXPECT_EQ("x", big.cast<std::string>());
+
+  big.swap(moved);
+  EXPECT_EQ("x", moved.cast<std::string>());
+  EXPECT_EQ(1, big.cast<StrIntMap>().at("a"));
+
+  // values survive being moved around by a growing vector
+  std::vector<hold_any> v;
+  for (int i = 0; i < 100; i++) {
+    v.push_back(hold_any(std::string(40, 'a' + i % 26)));
+  }
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(std::string(40, 'a' + i % 26), v[i].cast<std::string>());
+  }
+}
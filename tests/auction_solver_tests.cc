@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+
+#include "auction_solver.h"
+#include "error.h"
+#include "exchange_graph.h"
+#include "exchange_test_cases.h"
+#include "flow_solver.h"
+
+using cyclus::AddArc;
+using cyclus::AddRequest;
+using cyclus::AddSupply;
+using cyclus::Arc;
+using cyclus::AuctionSolver;
+using cyclus::ExchangeGraph;
+using cyclus::ExchangeNode;
+using cyclus::Flow;
+using cyclus::FlowSolver;
+
+namespace {
+
+// builds a connected exchange of n requests of 1 to 3 for n / 2 supplies of
+// 1 to 4, each request bidding on three supplies with pseudo-random
+// preferences
+void BuildExchange(ExchangeGraph* g, int n) {
+  std::vector<ExchangeNode::Ptr> supplies;
+  for (int i = 0; i < n / 2; i++) {
+    supplies.push_back(AddSupply(g, 1 + i % 4, n + i));
+  }
+  for (int i = 0; i < n; i++) {
+    ExchangeNode::Ptr u = AddRequest(g, 1 + i % 3, i);
+    for (int j = 0; j < 3; j++) {
+      int s = (i * 7 + j * 13) % supplies.size();
+      AddArc(g, u, supplies[s], 1 + (i * 31 + j * 17) % 10);
+    }
+  }
+}
+
+}  // namespace
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(AuctionSolverTests, Optimal) {
+  ExchangeGraph g;
+  ExchangeNode::Ptr r1 = AddRequest(&g, 1, 1);
+  ExchangeNode::Ptr r2 = AddRequest(&g, 1, 2);
+  ExchangeNode::Ptr s1 = AddSupply(&g, 1, 3);
+  ExchangeNode::Ptr s2 = AddSupply(&g, 1, 4);
+  Arc a11 = AddArc(&g, r1, s1, 2);
+  Arc a12 = AddArc(&g, r1, s2, 1.9);
+  Arc a21 = AddArc(&g, r2, s1, 1.5);
+
+  AuctionSolver s(false, 1e-6, NULL);
+  double obj = s.Solve(&g);
+  EXPECT_GT(s.rounds(), 0);
+  EXPECT_NEAR(0, Flow(g, a11), 1e-9);
+  EXPECT_NEAR(1, Flow(g, a12), 1e-9);
+  EXPECT_NEAR(1, Flow(g, a21), 1e-9);
+  EXPECT_NEAR(1 / 1.9 + 1 / 1.5, obj, 1e-9);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(AuctionSolverTests, Unmet) {
+  ExchangeGraph g;
+  ExchangeNode::Ptr r = AddRequest(&g, 3, 1);
+  ExchangeNode::Ptr v = AddSupply(&g, 1, 2);
+  Arc a = AddArc(&g, r, v, 2);
+
+  AuctionSolver s(false, AuctionSolver::kDefaultGap, NULL);
+  s.graph(&g);
+  double pseudo = s.PseudoCost();
+  double obj = s.Solve();
+  EXPECT_DOUBLE_EQ(1, Flow(g, a));
+  EXPECT_DOUBLE_EQ(0.5 + 2 * pseudo, obj);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(AuctionSolverTests, Gap) {
+  double gap = 1e-3;
+  ExchangeGraph g;
+  BuildExchange(&g, 200);
+  AuctionSolver s(false, gap, NULL);
+  double obj = s.Solve(&g);
+
+  ExchangeGraph exact;
+  BuildExchange(&exact, 200);
+  FlowSolver fs(false, NULL);
+  double opt = fs.Solve(&exact);
+
+  EXPECT_LE(opt - 1e-9 * opt, obj);
+  EXPECT_GE(opt * (1 + gap), obj);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(AuctionSolverTests, Threads) {
+  // rounds are split over threads for large enough exchanges, which mustn't
+  // change the solution
+  ExchangeGraph g1;
+  BuildExchange(&g1, 5000);
+  AuctionSolver s1(false, AuctionSolver::kDefaultGap, NULL);
+  s1.decompose(false);
+  s1.threads(1);
+  double obj1 = s1.Solve(&g1);
+
+  ExchangeGraph g2;
+  BuildExchange(&g2, 5000);
+  AuctionSolver s2(false, AuctionSolver::kDefaultGap, NULL);
+  s2.decompose(false);
+  s2.threads(2);
+  double obj2 = s2.Solve(&g2);
+
+  EXPECT_EQ(s1.rounds(), s2.rounds());
+  EXPECT_DOUBLE_EQ(obj1, obj2);
+  ASSERT_EQ(g1.matches().size(), g2.matches().size());
+  for (int i = 0; i != g1.matches().size(); i++) {
+    EXPECT_DOUBLE_EQ(g1.matches()[i].second, g2.matches()[i].second);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(AuctionSolverTests, NoSupply) {
+  ExchangeGraph g;
+  ExchangeNode::Ptr r = AddRequest(&g, 1, 1);
+  ExchangeNode::Ptr v = AddSupply(&g, 0, 2);
+  AddArc(&g, r, v, 1);
+
+  AuctionSolver s(false, AuctionSolver::kDefaultGap, NULL);
+  s.graph(&g);
+  double pseudo = s.PseudoCost();
+  EXPECT_DOUBLE_EQ(pseudo, s.Solve());
+  EXPECT_TRUE(g.matches().empty());
+  EXPECT_LT(s.rounds(), 10);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(AuctionSolverTests, BadGap) {
+  EXPECT_THROW(AuctionSolver(false, 0, NULL), cyclus::ValueError);
+}
@@ -0,0 +1,177 @@
+#!/usr/bin/env python
+"""Runs the microbenchmarks of cyclus_bench and a few end-to-end scaling
+scenarios, and compares their times to a stored baseline, failing if any has
+regressed by more than a threshold.
+
+Store a baseline on the machine the checks run on::
+
+    $ python bench_check.py --bench ./cyclus_bench --cyclus ./cyclus \\
+          --baseline baseline.json --update
+
+and check against it::
+
+    $ python bench_check.py --bench ./cyclus_bench --cyclus ./cyclus \\
+          --baseline baseline.json --threshold 0.1
+
+The build has ``bench-baseline`` and ``bench-check`` targets that do this.
+Times are the median of several repetitions, and only benchmarks that take
+longer than --min-time seconds in the baseline are checked, since shorter
+ones are mostly noise. Baselines are only comparable on the machine they were
+stored on.
+"""
+from __future__ import print_function, unicode_literals
+import argparse
+import json
+import os
+import platform
+import subprocess
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import scaling  # noqa: E402
+
+# (name, facilities, commodities, time steps) of the end-to-end scenarios
+SCENARIOS = [
+    ('e2e/small', 30, 3, 50),
+    ('e2e/medium', 300, 10, 50),
+]
+
+UNITS = {'ns': 1e-9, 'us': 1e-6, 'ms': 1e-3, 's': 1.0}
+
+
+def median(xs):
+    xs = sorted(xs)
+    n = len(xs)
+    return xs[n // 2] if n % 2 else 0.5 * (xs[n // 2 - 1] + xs[n // 2])
+
+
+def run_micro(bench, reps, bench_filter=None):
+    """Returns the median real time of each microbenchmark, in seconds."""
+    fd, out = tempfile.mkstemp(suffix='.json')
+    os.close(fd)
+    cmd = [bench, '--benchmark_out=' + out, '--benchmark_out_format=json',
+           '--benchmark_repetitions={0}'.format(reps),
+           '--benchmark_report_aggregates_only=true']
+    if bench_filter:
+        cmd.append('--benchmark_filter=' + bench_filter)
+    with open(os.devnull, 'w') as devnull:
+        subprocess.check_call(cmd, stdout=devnull)
+    with open(out) as f:
+        data = json.load(f)
+    os.remove(out)
+    results = {}
+    for b in data['benchmarks']:
+        if b.get('aggregate_name', 'median') != 'median':
+            continue
+        name = b.get('run_name', b['name'].rsplit('_median', 1)[0])
+        results['micro/' + name] = b['real_time'] * UNITS[b['time_unit']]
+    return results
+
+
+def run_e2e(cyclus, reps):
+    """Returns the median wall time of each end-to-end scenario, in
+    seconds.
+    """
+    d = tempfile.mkdtemp()
+    results = {}
+    for name, nfacs, ncommods, nsteps in SCENARIOS:
+        infile = os.path.join(d, 'bench.xml')
+        outfile = os.path.join(d, 'bench.sqlite')
+        with open(infile, 'w') as f:
+            f.write(scaling.generate(nfacs, ncommods, 1, nsteps))
+        walls = []
+        for _ in range(reps):
+            walls.append(scaling.run(cyclus, infile, outfile)[0])
+        results[name] = median(walls)
+        os.remove(infile)
+        os.remove(outfile)
+    os.rmdir(d)
+    return results
+
+
+def compare(baseline, results, threshold, min_time):
+    """Prints each result against its baseline and returns the names of
+    those that regressed.
+    """
+    regressed = []
+    width = max(len(n) for n in results) if results else 10
+    print('{0:<{w}} {1:>12} {2:>12} {3:>8}'.format(
+        'benchmark', 'baseline', 'current', 'change', w=width))
+    for name in sorted(results):
+        cur = results[name]
+        if name not in baseline:
+            print('{0:<{w}} {1:>12} {2:12.6g} {3:>8}'.format(
+                name, '-', cur, 'new', w=width))
+            continue
+        base = baseline[name]
+        change = cur / base - 1 if base > 0 else 0.0
+        flag = ''
+        if base >= min_time and change > threshold:
+            flag = '  REGRESSED'
+            regressed.append(name)
+        print('{0:<{w}} {1:12.6g} {2:12.6g} {3:+7.1%}{4}'.format(
+            name, base, cur, change, flag, w=width))
+    for name in sorted(set(baseline) - set(results)):
+        print('{0:<{w}} {1:12.6g} {2:>12} {3:>8}'.format(
+            name, baseline[name], '-', 'missing', w=width))
+    return regressed
+
+
+def main(args=None):
+    p = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    p.add_argument('--bench', default=None, help='cyclus_bench executable')
+    p.add_argument('--cyclus', default=None,
+                   help='cyclus executable, for the end-to-end scenarios')
+    p.add_argument('--baseline', required=True, help='baseline JSON file')
+    p.add_argument('--update', action='store_true', default=False,
+                   help='store the results as the baseline')
+    p.add_argument('--threshold', type=float, default=0.1,
+                   help='the fraction by which a benchmark may slow down')
+    p.add_argument('--min-time', type=float, default=1e-6, dest='min_time',
+                   help='the shortest baseline time, in seconds, checked')
+    p.add_argument('--reps', type=int, default=5,
+                   help='repetitions of each benchmark')
+    p.add_argument('--filter', default=None,
+                   help='regex of the microbenchmarks to run')
+    ns = p.parse_args(args)
+
+    if not ns.update and not os.path.exists(ns.baseline):
+        print('no baseline at {0}; store one with --update (or the '
+              'bench-baseline target) first'.format(ns.baseline))
+        return 1
+
+    results = {}
+    start = time.time()
+    if ns.bench:
+        results.update(run_micro(ns.bench, ns.reps, ns.filter))
+    if ns.cyclus:
+        results.update(run_e2e(ns.cyclus, ns.reps))
+    print('ran {0} benchmarks in {1:.1f} s\n'.format(len(results),
+                                                     time.time() - start))
+
+    if ns.update:
+        with open(ns.baseline, 'w') as f:
+            json.dump({'machine': platform.node(), 'results': results}, f,
+                      indent=1, sort_keys=True)
+        print('stored baseline at ' + ns.baseline)
+        return 0
+
+    with open(ns.baseline) as f:
+        stored = json.load(f)
+    if stored.get('machine') != platform.node():
+        print('warning: the baseline was stored on {0}, not this '
+              'machine\n'.format(stored.get('machine')))
+    regressed = compare(stored['results'], results, ns.threshold,
+                        ns.min_time)
+    if regressed:
+        print('\n{0} benchmarks regressed by more than {1:.0%}: {2}'.format(
+            len(regressed), ns.threshold, ', '.join(regressed)))
+        return 1
+    print('\nno regressions beyond {0:.0%}'.format(ns.threshold))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
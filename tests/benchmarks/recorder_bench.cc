@@ -0,0 +1,84 @@
+#include <cstdio>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "hdf5_back.h"
+#include "query_backend.h"
+#include "recorder.h"
+#include "sqlite_back.h"
+
+using cyclus::Hdf5Back;
+using cyclus::Recorder;
+using cyclus::SqliteBack;
+
+namespace {
+
+// Records n rows shaped like those of the Transactions table.
+void RecordRows(Recorder* rec, int n) {
+  for (int i = 0; i < n; ++i) {
+    rec->NewDatum("Transactions")
+        ->AddVal("TransactionId", i)
+        ->AddVal("SenderId", i % 17)
+        ->AddVal("ReceiverId", i % 23)
+        ->AddVal("ResourceId", i)
+        ->AddVal("Commodity", std::string("uox"))
+        ->AddVal("Time", i / 100)
+        ->Record();
+  }
+}
+
+template <class Back>
+void RecordTo(benchmark::State& state, const char* path) {
+  int n = state.range(0);
+  for (auto _ : state) {
+    std::remove(path);
+    Back back(path);
+    Recorder rec;
+    rec.RegisterBackend(&back);
+    RecordRows(&rec, n);
+    rec.Close();
+  }
+  std::remove(path);
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+void BM_RecorderSqlite(benchmark::State& state) {
+  RecordTo<SqliteBack>(state, "bench.sqlite");
+}
+BENCHMARK(BM_RecorderSqlite)->Arg(10000)->Arg(100000)
+    ->Unit(benchmark::kMillisecond);
+
+void BM_RecorderHdf5(benchmark::State& state) {
+  RecordTo<Hdf5Back>(state, "bench.h5");
+}
+BENCHMARK(BM_RecorderHdf5)->Arg(10000)->Arg(100000)
+    ->Unit(benchmark::kMillisecond);
+
+void BM_Hdf5BackQuery(benchmark::State& state) {
+  const char* path = "bench_query.h5";
+  int n = state.range(0);
+  std::remove(path);
+  {
+    Hdf5Back back(path);
+    Recorder rec;
+    rec.RegisterBackend(&back);
+    RecordRows(&rec, n);
+    rec.Close();
+  }
+
+  {
+    Hdf5Back back(path);
+    std::vector<cyclus::Cond> conds;
+    conds.push_back(cyclus::Cond("SenderId", "==", 3));
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(back.Query("Transactions", &conds));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+  std::remove(path);
+}
+BENCHMARK(BM_Hdf5BackQuery)->Arg(10000)->Arg(100000)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
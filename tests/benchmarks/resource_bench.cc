@@ -0,0 +1,101 @@
+#include <benchmark/benchmark.h>
+
+#include "comp_math.h"
+#include "composition.h"
+#include "material.h"
+#include "toolkit/res_buf.h"
+
+using cyclus::CompMap;
+using cyclus::Composition;
+using cyclus::Material;
+
+namespace {
+
+// A composition of n nuclides, e.g. a spent fuel with its fission products.
+CompMap MakeComp(int n) {
+  static const int zs[] = {38, 40, 42, 44, 46, 52, 54, 55, 56, 58, 60, 62,
+                           64, 90, 92, 93, 94, 95, 96};
+  static const int nz = sizeof(zs) / sizeof(zs[0]);
+  CompMap m;
+  for (int i = 0; m.size() < n; ++i) {
+    int z = zs[i % nz];
+    int a = 2 * z + 10 + i / nz;
+    m[z * 10000000 + a * 10000] = 1.0 + i;
+  }
+  return m;
+}
+
+void BM_MaterialExtractQty(benchmark::State& state) {
+  Composition::Ptr c = Composition::CreateFromMass(MakeComp(state.range(0)));
+  Material::Ptr m = Material::CreateUntracked(1e9, c);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(m->ExtractQty(1.0));
+  }
+}
+BENCHMARK(BM_MaterialExtractQty)->Arg(2)->Arg(100)->Arg(1000);
+
+void BM_MaterialAbsorb(benchmark::State& state) {
+  Composition::Ptr c1 = Composition::CreateFromMass(MakeComp(state.range(0)));
+  Composition::Ptr c2 = Composition::CreateFromMass(MakeComp(state.range(0) / 2));
+  Material::Ptr m = Material::CreateUntracked(1.0, c1);
+  for (auto _ : state) {
+    // alternate compositions so that each absorb mixes them anew
+    m->Absorb(Material::CreateUntracked(1.0, c2));
+    m->Absorb(Material::CreateUntracked(1.0, c1));
+  }
+  state.SetItemsProcessed(2 * state.iterations());
+}
+BENCHMARK(BM_MaterialAbsorb)->Arg(2)->Arg(100)->Arg(1000);
+
+void BM_CompositionDecay(benchmark::State& state) {
+  CompMap m;
+  m[922350000] = 0.04;
+  m[922380000] = 0.95;
+  m[942390000] = 0.01;
+  m[551370000] = 0.001;
+  m[380900000] = 0.001;
+  Composition::Ptr c = Composition::CreateFromMass(m);
+  int dt = 1;
+  for (auto _ : state) {
+    // a different delta every time, so that decayed compositions aren't
+    // served from the decay chain cache
+    benchmark::DoNotOptimize(c->Decay(dt++));
+  }
+}
+BENCHMARK(BM_CompositionDecay);
+
+void BM_CompMathAdd(benchmark::State& state) {
+  CompMap a = MakeComp(state.range(0));
+  CompMap b = MakeComp(state.range(0) / 2);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cyclus::compmath::Add(a, b));
+  }
+}
+BENCHMARK(BM_CompMathAdd)->Arg(2)->Arg(100)->Arg(1000);
+
+void BM_CompMathNormalize(benchmark::State& state) {
+  CompMap a = MakeComp(state.range(0));
+  for (auto _ : state) {
+    cyclus::compmath::Normalize(&a, 2.0);
+    cyclus::compmath::Normalize(&a, 1.0);
+    benchmark::DoNotOptimize(a);
+  }
+}
+BENCHMARK(BM_CompMathNormalize)->Arg(2)->Arg(100)->Arg(1000);
+
+void BM_ResBufPushPop(benchmark::State& state) {
+  int n = state.range(0);
+  Composition::Ptr c = Composition::CreateFromMass(MakeComp(10));
+  cyclus::toolkit::ResBuf<Material> buf;
+  for (int i = 0; i < n; ++i) {
+    buf.Push(Material::CreateUntracked(1.0, c));
+  }
+  for (auto _ : state) {
+    // pop a quantity spanning several resources, splitting the last one
+    Material::Ptr m = buf.Pop(2.5);
+    buf.Push(m);
+  }
+}
+BENCHMARK(BM_ResBufPushPop)->Arg(10)->Arg(1000);
+
+}  // namespace
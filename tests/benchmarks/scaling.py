@@ -0,0 +1,231 @@
+#!/usr/bin/env python
+"""Generates synthetic scenarios of any size from the archetypes in agents/
+and runs them end to end, to measure how cyclus scales.
+
+Generate an input file::
+
+    $ python scaling.py generate -f 1000 -c 10 -r 5 -t 120 -o big.xml
+
+Run a series of sizes, printing a table of timings and writing them to a CSV
+file::
+
+    $ python scaling.py run -f 10 100 1000 -c 10 -t 120 --csv scaling.csv
+
+Each run is measured for its wall time, the peak resident memory of the
+cyclus process, the time spent in each startup phase (InitTimings), and the
+total time spent in each phase of the resource exchange (DreTimings).
+"""
+from __future__ import print_function, unicode_literals
+import argparse
+import csv
+import os
+import sqlite3
+import subprocess
+import sys
+import tempfile
+import time
+
+# nuclides that recipes are made of
+NUCS = ['922350000', '922380000', '942390000', '942400000', '551370000',
+        '380900000', '541350000', '10010000', '80160000', '922340000']
+
+DRE_PHASES = ['Requests', 'Bids', 'Preferences', 'Translation', 'Solve',
+              'BackTranslation', 'Trades']
+
+
+def recipe(name, i):
+    """Returns a recipe of a few nuclides that differs with i."""
+    nucs = ''.join(
+        '    <nuclide><id>{0}</id><comp>{1}</comp></nuclide>\n'.format(
+            NUCS[(i + j) % len(NUCS)], 1 + (i * 7 + j) % 5)
+        for j in range(2 + i % 4))
+    return ('  <recipe>\n    <name>{0}</name>\n    <basis>mass</basis>\n{1}'
+            '  </recipe>\n').format(name, nucs)
+
+
+def facility(name, arch, params):
+    """Returns a facility prototype of the archetype with the parameters."""
+    body = ''.join('        <{0}>{1}</{0}>\n'.format(k, v) for k, v in params)
+    return ('  <facility>\n    <name>{0}</name>\n    <config>\n      <{1}>\n'
+            '{2}      </{1}>\n    </config>\n  </facility>\n').format(
+                name, arch, body)
+
+
+def generate(facilities, commodities=1, recipes=1, timesteps=100, prey=0,
+             predators=0):
+    """Returns the XML of a scenario with about the given number of
+    facilities trading the given number of commodities for the given number
+    of time steps.
+
+    Each commodity is made by Source facilities and converted to the next
+    commodity by KFacility facilities, and Sink facilities take every
+    commodity, so that all commodities are traded at every time step. A third
+    of the facilities are of each kind. Materials are made from the given
+    number of recipes. Prey and Predator facilities, which are built and
+    decommissioned as the simulation runs, may be added to stress deployment.
+    """
+    commods = ['commod{0}'.format(c) for c in range(commodities)]
+    recipe_names = ['recipe{0}'.format(r) for r in range(recipes)]
+    protos = []
+    counts = []
+    xml_facs = []
+    nper = max(1, facilities // (3 * commodities))
+    for c, commod in enumerate(commods):
+        rec = recipe_names[c % recipes]
+        xml_facs.append(facility('Source{0}'.format(c), 'Source', [
+            ('commod', commod), ('recipe_name', rec), ('capacity', 10)]))
+        xml_facs.append(facility('KFacility{0}'.format(c), 'KFacility', [
+            ('in_commod', commod), ('in_capacity', 5), ('k_factor_in', 1),
+            ('out_commod', commods[(c + 1) % commodities]),
+            ('recipe_name', rec), ('out_capacity', 5), ('k_factor_out', 1)]))
+        xml_facs.append(facility('Sink{0}'.format(c), 'Sink', [
+            ('in_commods', '<val>{0}</val>'.format(commod)),
+            ('capacity', 10)]))
+        for kind in ('Source', 'KFacility', 'Sink'):
+            protos.append('{0}{1}'.format(kind, c))
+            counts.append(nper)
+    if prey > 0 or predators > 0:
+        xml_facs.append(facility('Prey', 'Prey', [
+            ('birth_freq', 2), ('nchildren', 1), ('birth_and_death', 0),
+            ('commod', 'wabbit')]))
+        xml_facs.append(facility('Predator', 'Predator', [
+            ('hunt_cap', 2), ('hunt_freq', 3), ('full', 2), ('lifespan', 6),
+            ('commod', 'wabbit'), ('success', 0.5), ('birth_and_death', 0),
+            ('prey', 'Prey')]))
+        protos += ['Prey', 'Predator']
+        counts += [prey, predators]
+
+    entries = ''.join(
+        '        <entry><prototype>{0}</prototype><number>{1}</number>'
+        '</entry>\n'.format(p, n) for p, n in zip(protos, counts) if n > 0)
+    return ''.join([
+        '<!-- generated by scaling.py: {0} facilities, {1} commodities, '
+        '{2} recipes, {3} time steps -->\n'.format(
+            sum(counts), commodities, recipes, timesteps),
+        '<simulation>\n  <control>\n',
+        '    <duration>{0}</duration>\n'.format(timesteps),
+        '    <startmonth>1</startmonth>\n    <startyear>2000</startyear>\n',
+        '  </control>\n\n  <archetypes>\n',
+        ''.join('    <spec><lib>agents</lib><name>{0}</name></spec>\n'.format(a)
+                for a in ['Source', 'Sink', 'KFacility', 'Prey', 'Predator',
+                          'NullRegion', 'NullInst']),
+        '  </archetypes>\n\n',
+        ''.join(xml_facs),
+        '\n  <region>\n    <name>SingleRegion</name>\n',
+        '    <config> <NullRegion/> </config>\n    <institution>\n',
+        '      <name>SingleInstitution</name>\n',
+        '      <initialfacilitylist>\n', entries,
+        '      </initialfacilitylist>\n',
+        '      <config> <NullInst/> </config>\n    </institution>\n',
+        '  </region>\n\n',
+        ''.join(recipe(name, r) for r, name in enumerate(recipe_names)),
+        '</simulation>\n'])
+
+
+def query_timings(db):
+    """Returns the startup and exchange phase timings recorded to db."""
+    timings = {}
+    conn = sqlite3.connect(db)
+    try:
+        for phase, secs in conn.execute(
+                'SELECT Phase, Seconds FROM InitTimings ORDER BY "Order"'):
+            timings['init_' + phase] = secs
+        for phase in DRE_PHASES:
+            secs = conn.execute(
+                'SELECT SUM({0}) FROM DreTimings'.format(phase)).fetchone()[0]
+            timings['dre_' + phase] = secs or 0.0
+    except sqlite3.OperationalError:
+        pass  # tables not recorded
+    finally:
+        conn.close()
+    return timings
+
+
+def run(cyclus, infile, outfile, extra_args=()):
+    """Runs cyclus on infile and returns its wall time in seconds, its peak
+    resident memory in MB, and its phase timings.
+    """
+    if os.path.exists(outfile):
+        os.remove(outfile)
+    env = dict(os.environ, CYCLUS_DRE_TIMINGS='1')
+    cmd = [cyclus, '--profile-startup', '-o', outfile, infile]
+    cmd += list(extra_args)
+    with open(os.devnull, 'w') as devnull:
+        start = time.time()
+        p = subprocess.Popen(cmd, stdout=devnull, env=env)
+        _, status, usage = os.wait4(p.pid, 0)
+        wall = time.time() - start
+    if status != 0:
+        raise RuntimeError('{0} failed with status {1}'.format(
+            ' '.join(cmd), status))
+    # ru_maxrss is in kB on Linux and in bytes on Mac
+    scale = 1024.0 ** 2 if sys.platform == 'darwin' else 1024.0
+    return wall, usage.ru_maxrss / scale, query_timings(outfile)
+
+
+def main(args=None):
+    p = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    sub = p.add_subparsers(dest='cmd')
+    for name in ('generate', 'run'):
+        s = sub.add_parser(name)
+        s.add_argument('-f', '--facilities', type=int, nargs='+',
+                       default=[100], help='numbers of facilities')
+        s.add_argument('-c', '--commodities', type=int, default=1)
+        s.add_argument('-r', '--recipes', type=int, default=1)
+        s.add_argument('-t', '--timesteps', type=int, default=100)
+        s.add_argument('--prey', type=int, default=0,
+                       help='number of Prey facilities')
+        s.add_argument('--predators', type=int, default=0,
+                       help='number of Predator facilities')
+    sub.choices['generate'].add_argument('-o', '--output', default='-',
+                                         help='input file to write')
+    r = sub.choices['run']
+    r.add_argument('--cyclus', default='cyclus', help='cyclus executable')
+    r.add_argument('--csv', default=None, help='CSV file to write results to')
+    r.add_argument('--keep', default=None,
+                   help='directory to keep inputs and outputs in')
+    ns, extra = p.parse_known_args(args)
+
+    if ns.cmd == 'generate':
+        for n in ns.facilities:
+            xml = generate(n, ns.commodities, ns.recipes, ns.timesteps,
+                           ns.prey, ns.predators)
+            if ns.output == '-':
+                sys.stdout.write(xml)
+            else:
+                with open(ns.output, 'w') as f:
+                    f.write(xml)
+        return
+
+    d = ns.keep or tempfile.mkdtemp()
+    rows = []
+    for n in ns.facilities:
+        infile = os.path.join(d, 'scaling-{0}.xml'.format(n))
+        outfile = os.path.join(d, 'scaling-{0}.sqlite'.format(n))
+        with open(infile, 'w') as f:
+            f.write(generate(n, ns.commodities, ns.recipes, ns.timesteps,
+                             ns.prey, ns.predators))
+        wall, rss, timings = run(ns.cyclus, infile, outfile, extra)
+        row = dict(facilities=n, commodities=ns.commodities,
+                   recipes=ns.recipes, timesteps=ns.timesteps, wall=wall,
+                   peak_rss_mb=rss)
+        row.update(timings)
+        rows.append(row)
+        print('{0:>8} facilities: {1:8.2f} s, {2:8.1f} MB, solve {3:.2f} s'
+              .format(n, wall, rss, timings.get('dre_Solve', 0.0)))
+        if ns.keep is None:
+            os.remove(infile)
+            os.remove(outfile)
+
+    if ns.csv is not None:
+        fields = []
+        for row in rows:
+            fields += [k for k in sorted(row) if k not in fields]
+        with open(ns.csv, 'w') as f:
+            w = csv.DictWriter(f, fields)
+            w.writeheader()
+            w.writerows(rows)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,85 @@
+#include <benchmark/benchmark.h>
+
+#include "exchange_graph.h"
+#include "greedy_solver.h"
+#include "platform.h"
+#if CYCLUS_HAS_COIN
+#include "prog_solver.h"
+#endif
+
+using cyclus::Arc;
+using cyclus::ExchangeGraph;
+using cyclus::ExchangeNode;
+using cyclus::ExchangeNodeGroup;
+using cyclus::ExchangeSolver;
+using cyclus::RequestGroup;
+
+namespace {
+
+// Builds a graph of nreqs requesters, each asking for 1 unit from narcs of
+// nsups suppliers, which can each supply 2 units. Arcs and preferences are
+// pseudo-random but the same for every call.
+ExchangeGraph* MakeGraph(int nreqs, int nsups, int narcs) {
+  ExchangeGraph* g = new ExchangeGraph();
+  std::vector<ExchangeNode::Ptr> sups;
+  for (int i = 0; i < nsups; ++i) {
+    ExchangeNode::Ptr v(new ExchangeNode());
+    ExchangeNodeGroup::Ptr gv(new ExchangeNodeGroup());
+    gv->AddExchangeNode(v);
+    gv->AddCapacity(2);
+    g->AddSupplyGroup(gv);
+    sups.push_back(v);
+  }
+
+  unsigned int seed = 12345;
+  for (int i = 0; i < nreqs; ++i) {
+    ExchangeNode::Ptr u(new ExchangeNode(1));
+    RequestGroup::Ptr gu(new RequestGroup(1));
+    gu->AddExchangeNode(u);
+    gu->AddCapacity(1);
+    g->AddRequestGroup(gu);
+    for (int j = 0; j < narcs; ++j) {
+      seed = seed * 1103515245 + 12345;
+      ExchangeNode::Ptr v = sups[(seed >> 8) % nsups];
+      Arc a(u, v);
+      if (u->prefs.count(a) > 0)
+        continue;  // already connected
+      u->prefs[a] = 1 + (seed >> 16) % 10;
+      u->unit_capacities[a].push_back(1);
+      v->unit_capacities[a].push_back(1);
+      g->AddArc(a);
+    }
+  }
+  return g;
+}
+
+void Solve(benchmark::State& state, ExchangeSolver* s) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    ExchangeGraph* g = MakeGraph(state.range(0), state.range(0) / 4 + 1,
+                                 state.range(1));
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(s->Solve(g));
+    state.PauseTiming();
+    delete g;
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_GreedySolverSolve(benchmark::State& state) {
+  cyclus::GreedySolver s(false);
+  Solve(state, &s);
+}
+BENCHMARK(BM_GreedySolverSolve)
+    ->Args({10, 3})->Args({100, 5})->Args({1000, 5})->Args({1000, 50});
+
+#if CYCLUS_HAS_COIN
+void BM_ProgSolverSolve(benchmark::State& state) {
+  cyclus::ProgSolver s("cbc", false);
+  Solve(state, &s);
+}
+BENCHMARK(BM_ProgSolverSolve)->Args({10, 3})->Args({100, 5});
+#endif  // CYCLUS_HAS_COIN
+
+}  // namespace
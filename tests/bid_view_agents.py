@@ -0,0 +1,25 @@
+"""Archetypes for testing vectorized bidding"""
+from __future__ import print_function, unicode_literals
+
+import numpy as np
+
+from cyclus.pyagents import Source
+import cyclus.typesystem as ts
+
+
+class ArraySource(Source):
+    """A source that bids on the requests for its commodity through a
+    vectorized view of them.
+    """
+    vectorized_exchange = True
+
+    def get_material_bids(self, requests):
+        assert isinstance(requests, ts.RequestView)
+        if self.commod not in requests.commodities:
+            return None
+        c = requests.commodities.index(self.commod)
+        reqs = requests.data[requests.data['commodity'] == c]
+        print("Bid on", len(reqs), "of", len(requests), "requests")
+        return {'request': reqs['request'],
+                'qty': np.minimum(reqs['qty'], self.capacity),
+                'constraints': self.capacity}
@@ -0,0 +1,88 @@
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "binary_state.h"
+#include "blob.h"
+#include "error.h"
+
+using cyclus::BinaryReader;
+using cyclus::BinaryWriter;
+
+TEST(BinaryStateTests, RoundTrip) {
+  std::vector<bool> bits;
+  bits.push_back(true);
+  bits.push_back(false);
+  std::map<std::string, std::vector<double> > hist;
+  hist["u235"].push_back(0.05);
+  hist["u238"];
+  std::list<std::pair<int, std::string> > pairs;
+  pairs.push_back(std::make_pair(3, std::string("three")));
+  std::set<int> ids;
+  ids.insert(4);
+  ids.insert(1);
+
+  std::string buf;
+  BinaryWriter w(&buf);
+  w.PutRaw<boost::uint64_t>(42);
+  w.Put(7);
+  w.Put(true);
+  w.Put(2.5);
+  w.Put(1.5f);
+  w.Put(std::string("spam"));
+  w.Put(cyclus::Blob("eggs"));
+  w.Put(bits);
+  w.Put(hist);
+  w.Put(pairs);
+  w.Put(ids);
+
+  BinaryReader r(buf.data(), buf.data() + buf.size());
+  EXPECT_EQ(42, r.GetRaw<boost::uint64_t>());
+  int i;
+  r.Get(&i);
+  EXPECT_EQ(7, i);
+  bool b;
+  r.Get(&b);
+  EXPECT_TRUE(b);
+  double d;
+  r.Get(&d);
+  EXPECT_DOUBLE_EQ(2.5, d);
+  float f;
+  r.Get(&f);
+  EXPECT_FLOAT_EQ(1.5, f);
+  std::string s;
+  r.Get(&s);
+  EXPECT_EQ("spam", s);
+  cyclus::Blob blob;
+  r.Get(&blob);
+  EXPECT_EQ("eggs", blob.str());
+  std::vector<bool> bits2(5, true);
+  r.Get(&bits2);
+  EXPECT_EQ(bits, bits2);
+  std::map<std::string, std::vector<double> > hist2;
+  hist2["pu239"].push_back(1);  // replaced, not merged
+  r.Get(&hist2);
+  EXPECT_EQ(hist, hist2);
+  std::list<std::pair<int, std::string> > pairs2;
+  r.Get(&pairs2);
+  EXPECT_EQ(pairs, pairs2);
+  std::set<int> ids2;
+  r.Get(&ids2);
+  EXPECT_EQ(ids, ids2);
+  EXPECT_TRUE(r.done());
+  EXPECT_THROW(r.Get(&i), cyclus::IOError);
+}
+
+TEST(BinaryStateTests, Truncated) {
+  std::string buf;
+  BinaryWriter w(&buf);
+  w.Put(std::string("truncated"));
+  BinaryReader r(buf.data(), buf.data() + buf.size() - 1);
+  std::string s;
+  EXPECT_THROW(r.Get(&s), cyclus::IOError);
+}
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "block_pool.h"
+#include "env.h"
+#include "exchange_graph.h"
+#include "material.h"
+#include "product.h"
+#include "request.h"
+
+using cyclus::BlockPool;
+using cyclus::Composition;
+using cyclus::ExchangeNode;
+using cyclus::Material;
+using cyclus::Product;
+using cyclus::Request;
+using cyclus::Resource;
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(BlockPoolTests, Reuse) {
+  BlockPool pool("CYCLUS_NO_TEST_POOL", 4);
+  ASSERT_TRUE(pool.enabled());
+
+  void* a = pool.Alloc(10);
+  void* b = pool.Alloc(10);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(a) % alignof(std::max_align_t));
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(b) % alignof(std::max_align_t));
+
+  // blocks of a size are carved out of the same chunk, in order
+  std::size_t align = alignof(std::max_align_t);
+  EXPECT_EQ(static_cast<char*>(a) + (10 + align - 1) / align * align,
+            static_cast<char*>(b));
+
+  pool.Free(a, 10);
+  EXPECT_EQ(a, pool.Alloc(12));
+
+  // blocks of other sizes come from other chunks
+  void* c = pool.Alloc(100);
+  EXPECT_NE(a, c);
+  EXPECT_NE(b, c);
+
+  // more blocks than one chunk holds
+  std::vector<void*> many;
+  for (int i = 0; i < 9; ++i) {
+    many.push_back(pool.Alloc(100));
+  }
+  std::sort(many.begin(), many.end());
+  EXPECT_EQ(many.end(), std::unique(many.begin(), many.end()));
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(BlockPoolTests, ExchangeObjects) {
+  if (!cyclus::Env::GetEnv("CYCLUS_NO_EXCHANGE_POOL").empty()) {
+    return;
+  }
+  ExchangeNode* n = new ExchangeNode(1.0);
+  delete n;
+  ExchangeNode* m = new ExchangeNode(2.0);
+  EXPECT_EQ(n, m);
+  EXPECT_DOUBLE_EQ(2.0, m->qty);
+  delete m;
+
+  Product::Ptr p = Product::CreateUntracked(1, "bananas");
+  Request<Product>* r = Request<Product>::Create(p, NULL, "c");
+  delete r;
+  Request<Product>* s = Request<Product>::Create(p, NULL, "d");
+  EXPECT_EQ(r, s);
+  EXPECT_EQ("d", s->commodity());
+  delete s;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(BlockPoolTests, Materials) {
+  if (!cyclus::Env::GetEnv("CYCLUS_NO_RESOURCE_POOL").empty()) {
+    return;
+  }
+  cyclus::CompMap v;
+  v[922350000] = 1;
+  Composition::Ptr c = Composition::CreateFromMass(v);
+
+  Material::Ptr m = Material::CreateUntracked(1, c);
+  Material* first = m.get();
+  Resource::Ptr r = m;
+  m.reset();
+  EXPECT_DOUBLE_EQ(1, r->quantity());  // still held through r
+
+  r.reset();
+  m = Material::CreateUntracked(2, c);
+  EXPECT_EQ(first, m.get());
+  EXPECT_DOUBLE_EQ(2, m->quantity());
+}
@@ -0,0 +1,75 @@
+#include <stdint.h>
+
+#include <gtest/gtest.h>
+
+#include "column_store.h"
+#include "error.h"
+#include "recorder.h"
+
+using cyclus::ColumnStore;
+using cyclus::Recorder;
+
+TEST(ColumnStoreTests, TypedColumns) {
+  Recorder r(false);
+  ColumnStore store;
+  r.RegisterBackend(&store);
+  for (int i = 0; i < 3; ++i) {
+    r.NewDatum("Widgets")
+        ->AddVal("Id", i)
+        ->AddVal("Mass", 1.5 * i)
+        ->AddVal("Big", i > 1)
+        ->AddVal("Name", std::string("w"))
+        ->Record();
+  }
+  r.Flush();
+
+  EXPECT_EQ(1, store.Tables().count("Widgets"));
+  EXPECT_EQ(3, store.nrows("Widgets"));
+  EXPECT_EQ(0, store.nrows("Gadgets"));
+  EXPECT_TRUE(store.table("Gadgets") == NULL);
+
+  ColumnStore::Table& tbl = *store.table("Widgets");
+  ASSERT_EQ(4, tbl.size());
+  EXPECT_EQ("Id", tbl[0].name());
+  EXPECT_EQ(cyclus::INT, tbl[0].type());
+  EXPECT_EQ(sizeof(int64_t), tbl[0].itemsize());
+  const int64_t* ids =
+      reinterpret_cast<const int64_t*>(&(*tbl[0].buffer())[0]);
+  EXPECT_EQ(0, ids[0]);
+  EXPECT_EQ(2, ids[2]);
+  const double* mass = reinterpret_cast<const double*>(&(*tbl[1].buffer())[0]);
+  EXPECT_DOUBLE_EQ(3.0, mass[2]);
+  EXPECT_EQ(cyclus::BOOL, tbl[2].type());
+  EXPECT_TRUE(tbl[3].boxed());
+  ASSERT_EQ(3, tbl[3].values().size());
+  EXPECT_EQ("w", tbl[3].values()[0].cast<std::string>());
+
+  store.Drop("Widgets");
+  EXPECT_TRUE(store.Tables().empty());
+}
+
+TEST(ColumnStoreTests, BuffersAreSnapshots) {
+  Recorder r(false);
+  ColumnStore store;
+  r.RegisterBackend(&store);
+  r.NewDatum("Widgets")->AddVal("Id", 1)->Record();
+  r.Flush();
+
+  ColumnStore::Column::Buffer buf = (*store.table("Widgets"))[0].buffer();
+  r.NewDatum("Widgets")->AddVal("Id", 2)->Record();
+  r.Flush();
+  EXPECT_EQ(sizeof(int64_t), buf->size());
+  EXPECT_EQ(2, store.nrows("Widgets"));
+}
+
+TEST(ColumnStoreTests, MismatchedDatum) {
+  Recorder r(false);
+  ColumnStore store;
+  r.RegisterBackend(&store);
+  r.NewDatum("Widgets")->AddVal("Id", 1)->Record();
+  r.Flush();
+
+  r.NewDatum("Widgets")->AddVal("Id", 2.0)->Record();
+  EXPECT_THROW(r.Flush(), cyclus::ValueError);
+  EXPECT_EQ(1, store.nrows("Widgets"));
+}
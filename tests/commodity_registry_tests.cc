@@ -0,0 +1,38 @@
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "commodity_registry.h"
+#include "error.h"
+#include "exchange_graph.h"
+#include "toolkit/commodity.h"
+
+using cyclus::CommodityRegistry;
+using cyclus::ExchangeNode;
+
+TEST(CommodityRegistryTests, Intern) {
+  EXPECT_EQ(0, CommodityRegistry::Intern(""));
+  int n = CommodityRegistry::size();
+  int id = CommodityRegistry::Intern("registry-test-fuel");
+  EXPECT_EQ(n, id);
+  EXPECT_EQ(id, CommodityRegistry::Intern("registry-test-fuel"));
+  EXPECT_EQ(n + 1, CommodityRegistry::size());
+  EXPECT_EQ("registry-test-fuel", CommodityRegistry::Name(id));
+  EXPECT_THROW(CommodityRegistry::Name(-1), cyclus::KeyError);
+  EXPECT_THROW(CommodityRegistry::Name(n + 1), cyclus::KeyError);
+}
+
+TEST(CommodityRegistryTests, Users) {
+  int id = CommodityRegistry::Intern("registry-test-waste");
+
+  ExchangeNode by_name(1, false, "registry-test-waste", 3);
+  ExchangeNode by_id(1, false, id, 3);
+  EXPECT_EQ(id, by_name.commod_id());
+  EXPECT_EQ("registry-test-waste", by_id.commod);
+  EXPECT_EQ(0, ExchangeNode().commod_id());
+
+  cyclus::toolkit::Commodity c("registry-test-waste");
+  EXPECT_EQ(id, c.id());
+  EXPECT_EQ(c, cyclus::toolkit::Commodity("registry-test-waste"));
+  EXPECT_NE(c, cyclus::toolkit::Commodity());
+}
@@ -4,10 +4,12 @@
 #include "composition.h"
 #include "cyc_limits.h"
 #include "error.h"
+#include "pyne.h"
 
 namespace cm = cyclus::compmath;
 using cyclus::Composition;
 using cyclus::CompMap;
+using cyclus::CompVec;
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST(CompMathTests, SubSame) {
@@ -252,3 +254,72 @@ TEST(CompMathTests, Add) {
     EXPECT_DOUBLE_EQ(it->second, expect[it->first]);
   }
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(CompMathTests, CompVecMatchesCompMap) {
+  CompMap v1;
+  v1[1] = 1.0;
+  v1[3] = 3.0;
+  v1[4] = 4.0;
+
+  CompMap v2;
+  v2[2] = 2.2;
+  v2[3] = 3.3;
+  v2[5] = 5.5;
+
+  CompVec cv1(v1);
+  CompVec cv2(v2);
+  EXPECT_EQ(v1, cv1.ToMap());
+  EXPECT_DOUBLE_EQ(3.0, cv1.Get(3));
+  EXPECT_DOUBLE_EQ(0, cv1.Get(2));
+
+  EXPECT_EQ(cm::Add(v1, v2), cm::Add(cv1, cv2).ToMap());
+  EXPECT_EQ(cm::Sub(v1, v2), cm::Sub(cv1, cv2).ToMap());
+  EXPECT_EQ(cm::Add(v1, v1), cm::Add(cv1, cv1).ToMap());
+  EXPECT_DOUBLE_EQ(cm::Sum(v2), cm::Sum(cv2));
+
+  CompMap n1(v1);
+  cm::Normalize(&n1, 2.0);
+  CompMap n2(v2);
+  cm::Normalize(&n2, 3.0);
+  CompVec combined = cm::Combine(cv1, cm::NormFactor(cm::Sum(cv1), 2.0),
+                                 cv2, -cm::NormFactor(cm::Sum(cv2), 3.0));
+  EXPECT_EQ(cm::Sub(n1, n2), combined.ToMap());
+
+  CompMap t = cm::Sub(v1, v1);
+  cm::ApplyThreshold(&t, 0);
+  CompVec ct = cm::Sub(cv1, cv1);
+  cm::ApplyThreshold(&ct, 0);
+  EXPECT_TRUE(ct.empty());
+  EXPECT_EQ(t, ct.ToMap());
+  EXPECT_THROW(cm::ApplyThreshold(&ct, -1), cyclus::ValueError);
+
+  cm::Normalize(&cv2, 2.0);
+  cm::Normalize(&v2, 2.0);
+  EXPECT_EQ(v2, cv2.ToMap());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(CompMathTests, AtomicMasses) {
+  CompMap v;
+  v[10010000] = 2;  // not known to the decay solver
+  v[922350000] = 1;
+  v[922380000] = 3;
+  CompVec mass(v);
+
+  double masses[3];
+  cm::AtomicMasses(&mass.nucs()[0], mass.size(), masses);
+  for (size_t i = 0; i < mass.size(); ++i) {
+    EXPECT_DOUBLE_EQ(pyne::atomic_mass(mass.nucs()[i]), masses[i]);
+    EXPECT_DOUBLE_EQ(masses[i], cm::AtomicMass(mass.nucs()[i]));
+  }
+
+  CompVec atom = cm::MassToAtom(mass);
+  ASSERT_EQ(mass.nucs(), atom.nucs());
+  for (size_t i = 0; i < atom.size(); ++i) {
+    EXPECT_DOUBLE_EQ(mass.vals()[i] / masses[i], atom.vals()[i]);
+  }
+  CompVec back = cm::AtomToMass(atom);
+  EXPECT_TRUE(cm::AlmostEq(mass.ToMap(), back.ToMap(), 1e-12));
+  EXPECT_TRUE(cm::MassToAtom(CompVec()).empty());
+}
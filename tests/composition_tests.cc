@@ -2,21 +2,27 @@
 
 #include <gtest/gtest.h>
 
+#include "column_store.h"
 #include "context.h"
 #include "composition.h"
 #include "comp_math.h"
 #include "env.h"
+#include "error.h"
 #include "pyne.h"
+#include "test_context.h"
 
+using cyclus::ColumnStore;
+using cyclus::CompInterner;
 using cyclus::Composition;
 using cyclus::CompMap;
+using cyclus::TestContext;
 using pyne::nucname::id;
 
 class TestComp : public Composition {
  public:
   TestComp() {}
-  Composition::Chain DecayLine() {
-    return *decay_line_.get();
+  std::map<int, Composition::Ptr> DecayLine() {
+    return decay_line_->Live();
   }
 };
 
@@ -50,6 +56,30 @@ TEST(CompositionTests, create_mass) {
                    2 / pyne::atomic_mass(922350000) * pyne::atomic_mass(922330000));
 }
 
+TEST(CompositionTests, create_vec) {
+  cyclus::Env::SetNucDataPath();
+
+  CompMap v;
+  v[922350000] = 2;
+  v[922330000] = 1;
+  Composition::Ptr c = Composition::CreateFromMass(cyclus::CompVec(v));
+
+  EXPECT_EQ(v, c->mass());
+  EXPECT_EQ(2, c->mass_vec().size());
+  EXPECT_EQ(922330000, c->atom_vec().nucs()[0]);
+  EXPECT_DOUBLE_EQ(c->atom().at(922350000), c->atom_vec().Get(922350000));
+  EXPECT_DOUBLE_EQ(2 / pyne::atomic_mass(922350000),
+                   c->atom_vec().Get(922350000));
+
+  Composition::Ptr a = Composition::CreateFromAtom(v);
+  EXPECT_EQ(v, a->atom_vec().ToMap());
+  EXPECT_DOUBLE_EQ(a->mass().at(922330000), a->mass_vec().Get(922330000));
+
+  v[922350000] = -1;
+  EXPECT_THROW(Composition::CreateFromMass(cyclus::CompVec(v)),
+               cyclus::ValueError);
+}
+
 TEST(CompositionTests, lineage) {
   cyclus::Env::SetNucDataPath();
 
@@ -72,6 +102,28 @@ TEST(CompositionTests, lineage) {
   EXPECT_EQ(dec4, dec5);
 }
 
+TEST(CompositionTests, lineage_expiry) {
+  cyclus::Env::SetNucDataPath();
+
+  TestComp c;
+  uint64_t swept = Composition::decay_chain_swept();
+  Composition::Ptr kept = c.Decay(1);
+  for (int dt = 2; dt < 100; dt++) {
+    c.Decay(dt);  // held by nothing once returned
+  }
+
+  // the decays no longer held expired and most were swept from the chain
+  std::map<int, Composition::Ptr> chain = c.DecayLine();
+  EXPECT_EQ(1, chain.size());
+  EXPECT_EQ(kept, chain[1]);
+  EXPECT_LT(90, Composition::decay_chain_swept() - swept);
+  EXPECT_EQ(kept, c.Decay(1));
+
+  // expired decays are calculated again
+  Composition::Ptr again = c.Decay(2);
+  EXPECT_EQ(2, c.DecayLine().size());
+}
+
 TEST(CompositionTests, decay) {
   cyclus::Env::SetNucDataPath();
 
@@ -94,3 +146,207 @@ TEST(CompositionTests, decay) {
   EXPECT_NEAR(v[id("U238")], newv[id("U238")], 1e-4);
 }
 
+
+TEST(CompositionTests, max_decay_const) {
+  cyclus::Env::SetNucDataPath();
+
+  CompMap v;
+  v[id("U238")] = 10;
+  v[id("Cs137")] = 1;
+  v[id("Pb208")] = 1;
+  Composition::Ptr c = Composition::CreateFromAtom(v);
+  EXPECT_DOUBLE_EQ(pyne::decay_const(id("Cs137")), c->max_decay_const());
+  EXPECT_DOUBLE_EQ(c->max_decay_const(), c->max_decay_const());
+
+  v.erase(id("Cs137"));
+  v.erase(id("U238"));
+  EXPECT_DOUBLE_EQ(0, Composition::CreateFromAtom(v)->max_decay_const());
+}
+
+TEST(CompositionTests, decay_cache) {
+  cyclus::DecayCache& cache = cyclus::DecayCache::Instance();
+  size_t capacity = cache.capacity();
+  cache.Clear();
+
+  CompMap v;
+  v[id("Cs137")] = 1;
+  v[id("U238")] = 10;
+  Composition::Ptr c1 = Composition::CreateFromAtom(v);
+  v[id("Cs137")] = 2;
+  v[id("U238")] = 20;
+  Composition::Ptr c2 = Composition::CreateFromAtom(v);
+
+  // separately created compositions with the same content share a result
+  Composition::Ptr d1 = c1->Decay(12);
+  EXPECT_EQ(0, cache.hits());
+  EXPECT_EQ(1, cache.misses());
+  Composition::Ptr d2 = c2->Decay(12);
+  EXPECT_EQ(1, cache.hits());
+  EXPECT_EQ(1, cache.size());
+  EXPECT_NE(d1, d2);
+
+  const cyclus::CompVec& a1 = d1->atom_vec();
+  const cyclus::CompVec& a2 = d2->atom_vec();
+  ASSERT_EQ(a1.size(), a2.size());
+  EXPECT_EQ(a1.nucs(), a2.nucs());
+  for (size_t i = 0; i < a1.size(); ++i) {
+    EXPECT_DOUBLE_EQ(2 * a1.vals()[i], a2.vals()[i]);
+  }
+
+  // the least recently used result is evicted
+  cache.capacity(1);
+  c1->Decay(24);
+  EXPECT_EQ(1, cache.size());
+  c2->Decay(12);  // cached along c2's own decay line
+  EXPECT_EQ(2, cache.misses());
+  Composition::CreateFromAtom(v)->Decay(12);
+  EXPECT_EQ(3, cache.misses());
+
+  cache.capacity(0);
+  EXPECT_EQ(0, cache.size());
+  cache.capacity(capacity);
+  cache.Clear();
+}
+
+TEST(CompositionTests, decay_batch) {
+  cyclus::DecayCache::Instance().Clear();
+
+  CompMap v;
+  v[id("Cs137")] = 1;
+  v[id("U238")] = 10;
+  Composition::Ptr c1 = Composition::CreateFromAtom(v);
+  Composition::Ptr c2 = Composition::CreateFromAtom(v);
+  v[id("Cs137")] = 3;
+  Composition::Ptr c3 = Composition::CreateFromAtom(v);
+
+  std::vector<Composition::Ptr> comps;
+  std::vector<int> deltas;
+  comps.push_back(c1);
+  deltas.push_back(12);
+  comps.push_back(c1);
+  deltas.push_back(12);
+  comps.push_back(c2);
+  deltas.push_back(12);
+  comps.push_back(c3);
+  deltas.push_back(12);
+  comps.push_back(c3);
+  deltas.push_back(24);
+
+  std::vector<Composition::Ptr> decayed =
+      Composition::Decay(comps, deltas, kDefaultTimeStepDur);
+  ASSERT_EQ(5, decayed.size());
+  EXPECT_EQ(decayed[0], decayed[1]);
+  EXPECT_NE(decayed[0], decayed[2]);
+  EXPECT_EQ(decayed[0], c1->Decay(12));
+  EXPECT_EQ(decayed[4], c3->Decay(24));
+  EXPECT_EQ(3, cyclus::DecayCache::Instance().size());
+
+  // results match decaying each composition on its own
+  cyclus::DecayCache::Instance().Clear();
+  v[id("Cs137")] = 1;
+  Composition::Ptr fresh = Composition::CreateFromAtom(v);
+  EXPECT_EQ(decayed[0]->atom_vec().nucs(), fresh->Decay(12)->atom_vec().nucs());
+  EXPECT_EQ(decayed[2]->atom_vec().vals(), fresh->Decay(12)->atom_vec().vals());
+
+  deltas.pop_back();
+  EXPECT_THROW(Composition::Decay(comps, deltas, kDefaultTimeStepDur),
+               cyclus::ValueError);
+  cyclus::DecayCache::Instance().Clear();
+}
+
+TEST(CompositionTests, decay_transfer) {
+  cyclus::DecayCache::Instance().Clear();
+  cyclus::DecayTransfer& transfer = cyclus::DecayTransfer::Instance();
+  transfer.Clear();
+
+  CompMap v;
+  v[id("Cs137")] = 1;
+  v[id("U238")] = 10;
+  v[id("Pu239")] = 3;
+  cyclus::CompVec direct =
+      Composition::CreateFromAtom(v)->Decay(120)->atom_vec();
+
+  cyclus::DecayCache::Instance().Clear();
+  cyclus::CompVec product = Composition::CreateFromAtom(v)
+                                ->Decay(120, kDefaultTimeStepDur, true)
+                                ->atom_vec();
+  EXPECT_EQ(3, transfer.ncolumns());
+
+  // later decays of the same nuclides for the same time reuse the columns
+  v[id("Cs137")] = 5;
+  Composition::CreateFromAtom(v)->Decay(120, kDefaultTimeStepDur, true);
+  EXPECT_EQ(3, transfer.ncolumns());
+
+  cyclus::CompMap d = direct.ToMap();
+  cyclus::CompMap p = product.ToMap();
+  EXPECT_NEAR(d[id("Cs137")], p[id("Cs137")], 1e-12);
+  EXPECT_NEAR(d[id("U238")], p[id("U238")], 1e-12);
+  EXPECT_NEAR(d[id("Pu239")], p[id("Pu239")], 1e-12);
+  EXPECT_NEAR(d[id("Ba137")], p[id("Ba137")], 1e-12);
+  EXPECT_GT(p[id("Ba137")], 0);
+
+  transfer.Clear();
+  EXPECT_EQ(0, transfer.ncolumns());
+  cyclus::DecayCache::Instance().Clear();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(CompositionTests, interning) {
+  TestContext tc;
+  ColumnStore store;
+  tc.recorder()->RegisterBackend(&store);
+  CompInterner& interner = tc.get()->comp_interner();
+
+  CompMap v;
+  v[id("U235")] = 1;
+  v[id("U238")] = 3;
+  Composition::Ptr c1 = Composition::CreateFromMass(v);
+  v[id("U235")] = 2;
+  v[id("U238")] = 6 * (1 + 1e-15);
+  Composition::Ptr c2 = Composition::CreateFromMass(v);
+  v[id("U238")] = 5;
+  Composition::Ptr c3 = Composition::CreateFromMass(v);
+  ASSERT_NE(c1->id(), c2->id());
+
+  EXPECT_EQ(c1->id(), interner.Intern(c1.get()));
+  EXPECT_EQ(c1->id(), interner.Intern(c2.get()));
+  EXPECT_EQ(c3->id(), interner.Intern(c3.get()));
+  EXPECT_EQ(2, interner.size());
+
+  c1->Record(tc.get());
+  c2->Record(tc.get());
+  c3->Record(tc.get());
+  tc.recorder()->Flush();
+  EXPECT_EQ(4, store.nrows("Compositions"));
+
+  interner.enabled(false);
+  EXPECT_EQ(c2->id(), interner.Intern(c2.get()));
+  tc.recorder()->Close();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(CompositionTests, RecordShared) {
+  CompMap v;
+  v[id("U235")] = 1;
+  v[id("U238")] = 3;
+  Composition::Ptr c = Composition::CreateFromMass(v);
+
+  // e.g. the simulations of an ensemble, sharing their recipes
+  TestContext tc1;
+  TestContext tc2;
+  ColumnStore store1;
+  ColumnStore store2;
+  tc1.recorder()->RegisterBackend(&store1);
+  tc2.recorder()->RegisterBackend(&store2);
+  tc2.get()->comp_interner().enabled(false);
+  for (int i = 0; i < 2; ++i) {
+    c->Record(tc1.get());
+    c->Record(tc2.get());
+  }
+  tc1.recorder()->Flush();
+  tc2.recorder()->Flush();
+  EXPECT_EQ(2, store1.nrows("Compositions"));
+  EXPECT_EQ(2, store2.nrows("Compositions"));
+  tc1.recorder()->Close();
+  tc2.recorder()->Close();
+}
@@ -1,7 +1,12 @@
+#include <algorithm>
+
 #include <gtest/gtest.h>
 
 #include "context.h"
+#include "env.h"
+#include "rec_backend.h"
 #include "recorder.h"
+#include "sparse_cram.h"
 #include "test_agents/test_facility.h"
 #include "timer.h"
 
@@ -79,6 +84,44 @@ TEST_F(ContextTests, EnterLeave) {
   EXPECT_TRUE(ctx->traders().empty());
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ContextTests, AgentIndexes) {
+  std::string proto = TestFacility::proto_name();
+  std::string spec = TestFacility::spec();
+  EXPECT_TRUE(ctx->live_agents().empty());
+  EXPECT_TRUE(ctx->AgentsOfPrototype(proto).empty());
+
+  Agent* a = fac->Clone();
+  Agent* b = fac->Clone();
+  Agent* c = fac->Clone();
+  EXPECT_EQ(4, ctx->agents().size());
+  EXPECT_TRUE(ctx->live_agents().empty());
+
+  a->Build(NULL);
+  b->Build(NULL);
+  c->Build(NULL);
+  EXPECT_EQ(3, ctx->live_agents().size());
+  EXPECT_EQ(3, ctx->AgentsOfPrototype(proto).size());
+  EXPECT_EQ(3, ctx->AgentsOfSpec(spec).size());
+  EXPECT_EQ(3, ctx->AgentsOfKind("Facility").size());
+  EXPECT_TRUE(ctx->AgentsOfKind("Inst").empty());
+  EXPECT_TRUE(ctx->AgentsOfPrototype("nothing").empty());
+
+  a->Decommission();
+  EXPECT_EQ(3, ctx->agents().size());
+  const std::vector<Agent*>& left = ctx->AgentsOfPrototype(proto);
+  ASSERT_EQ(2, left.size());
+  EXPECT_EQ(1, std::count(left.begin(), left.end(), b));
+  EXPECT_EQ(1, std::count(left.begin(), left.end(), c));
+
+  b->Decommission();
+  c->Decommission();
+  EXPECT_EQ(1, ctx->agents().size());
+  EXPECT_TRUE(ctx->live_agents().empty());
+  EXPECT_TRUE(ctx->AgentsOfPrototype(proto).empty());
+  EXPECT_TRUE(ctx->AgentsOfKind("Facility").empty());
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(ContextTests, CreateAgent) {
   Timer ti;
@@ -121,6 +164,211 @@ TEST_F(ContextTests, DoubleAgentNameThrow) {
                cyclus::KeyError);
   bool overwrite = true;
   ASSERT_NO_THROW(ctx->AddPrototype("dunkin donuts", m2, overwrite));
-  
+
+  delete ctx;
+}
+
+TEST_F(ContextTests, LazyPrototype) {
+  Timer ti;
+  Recorder rec;
+  Context* ctx = new Context(&ti, &rec);
+
+  int ninit = 0;
+  ctx->AddLazyPrototype("dunkin donuts", [&]() {
+    ninit++;
+    return new DonutShop(ctx, "old fashion");
+  });
+  EXPECT_EQ(0, ninit);
+  ASSERT_THROW(ctx->AddPrototype("dunkin donuts",
+                                 new DonutShop(ctx, "apple fritter")),
+               cyclus::KeyError);
+  ASSERT_THROW(ctx->GetPrototype("krispy kreme"), cyclus::KeyError);
+
+  DonutShop* d;
+  ASSERT_NO_THROW(d = ctx->CreateAgent<DonutShop>("dunkin donuts"));
+  EXPECT_EQ("old fashion", d->donut_of_the_day);
+  ASSERT_NO_THROW(d = ctx->CreateAgent<DonutShop>("dunkin donuts"));
+  EXPECT_EQ(1, ninit);
+
+  delete ctx;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ContextTests, SimSettings) {
+  EXPECT_EQ(cyclus::DECAY_MANUAL, ctx->decay_mode());
+
+  cyclus::SimInfo si(12, 2015, 1, "", "lazy");
+  si.dt = 86400;
+  ctx->InitSim(si);
+  EXPECT_EQ(cyclus::DECAY_LAZY, ctx->decay_mode());
+  EXPECT_EQ(86400, ctx->dt());
+  EXPECT_EQ(12, ctx->duration());
+  EXPECT_EQ(&ctx->sim_info(), &ctx->sim_info());
+
+  Context never_ctx(&ti, &rec);
+  never_ctx.InitSim(cyclus::SimInfo(12, 2015, 1, "", "never"));
+  EXPECT_EQ(cyclus::DECAY_NEVER, never_ctx.decay_mode());
+}
+
+TEST_F(ContextTests, SparseDecay) {
+  cyclus::SimInfo si(12);
+  si.sparse_decay = true;
+  ctx->InitSim(si);
+  EXPECT_TRUE(cyclus::SparseCram::enabled());
+
+  // the solver is shared by the process, so the last simulation wins
+  Context other(&ti, &rec);
+  other.InitSim(cyclus::SimInfo(12));
+  EXPECT_FALSE(cyclus::SparseCram::enabled());
+}
+
+TEST_F(ContextTests, MaxTradeDistance) {
+  cyclus::SimInfo si(12);
+  si.max_trade_distance = 500;
+  ctx->InitSim(si);
+  EXPECT_DOUBLE_EQ(500, ctx->max_trade_distance());
+  EXPECT_DOUBLE_EQ(500, ctx->sim_info().max_trade_distance);
+
+  // the environment overrides the input file
+  setenv("CYCLUS_MAX_TRADE_DISTANCE", "20", 1);
+  Context env_ctx(&ti, &rec);
+  env_ctx.InitSim(si);
+  unsetenv("CYCLUS_MAX_TRADE_DISTANCE");
+  EXPECT_DOUBLE_EQ(20, env_ctx.max_trade_distance());
+  EXPECT_DOUBLE_EQ(20, env_ctx.sim_info().max_trade_distance);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ContextTests, Random) {
+  cyclus::SimInfo si(12);
+  si.seed = 7;
+  ctx->InitSim(si);
+  TestFacility other(ctx);
+
+  // the same arguments give the same numbers
+  cyclus::RandomStream a = ctx->random(fac);
+  cyclus::RandomStream b = ctx->random(fac);
+  uint32_t first = a();
+  EXPECT_EQ(first, b());
+  EXPECT_NE(first, ctx->random(fac, 1)());
+  EXPECT_NE(first, ctx->random(&other)());
+
+  // keyed by the seed, the agent, the time step, and the stream
+  EXPECT_EQ(first, cyclus::RandomStream(7, fac->id(), ctx->time(), 0)());
+  EXPECT_NE(first, cyclus::RandomStream(8, fac->id(), ctx->time(), 0)());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ContextTests, AgentMemoryReused) {
+  if (!cyclus::Env::GetEnv("CYCLUS_NO_AGENT_POOL").empty()) {
+    return;
+  }
+  DonutShop proto(ctx, "boston cream");
+  Agent* a = proto.Clone();
+  Agent* b = proto.Clone();
+  EXPECT_NE(a, b);
+  ctx->DelAgent(a);
+  Agent* c = proto.Clone();
+  EXPECT_EQ(a, c);
+  EXPECT_EQ("boston cream", dynamic_cast<DonutShop*>(c)->donut_of_the_day);
+  ctx->DelAgent(b);
+  ctx->DelAgent(c);
+}
+
+namespace {
+
+// collects the ids of the agents entering the simulation
+class EntryBack : public cyclus::RecBackend {
+ public:
+  virtual void Notify(cyclus::DatumList data) {
+    for (int i = 0; i < data.size(); ++i) {
+      if (data[i]->title() == "AgentEntry") {
+        ids.push_back(data[i]->vals()[1].second.cast<int>());
+      }
+    }
+  }
+  virtual std::string Name() { return "entries"; }
+  virtual void Flush() {}
+  virtual void Close() {}
+
+  std::vector<int> ids;
+};
+
+// refuses to be the parent of more than two agents
+class SmallShop : public DonutShop {
+ public:
+  explicit SmallShop(Context* ctx) : DonutShop(ctx, "glazed") {}
+
+  virtual void BuildNotify(Agent* m) {
+    if (children().size() > 2) {
+      throw cyclus::ValueError("the shop is full");
+    }
+  }
+};
+
+}  // namespace
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ContextTests, BuildAgents) {
+  EntryBack back;
+  Timer ti;
+  Recorder rec;
+  rec.RegisterBackend(&back);
+  Context* ctx = new Context(&ti, &rec);
+
+  Agent* proto = new DonutShop(ctx, "cruller");
+  proto->prototype("tim hortons");
+  ctx->AddPrototype("tim hortons", proto);
+  Agent* parent = ctx->CreateAgent<Agent>("tim hortons");
+  parent->Build(NULL);
+
+  std::vector<Agent*> built = ctx->BuildAgents("tim hortons", parent, 3);
+  ASSERT_EQ(3, built.size());
+  for (int i = 0; i < built.size(); ++i) {
+    EXPECT_EQ(parent->id() + 1 + i, built[i]->id());
+    EXPECT_EQ(parent, built[i]->parent());
+    EXPECT_EQ(0, built[i]->enter_time());
+    EXPECT_EQ("cruller",
+              dynamic_cast<DonutShop*>(built[i])->donut_of_the_day);
+  }
+  EXPECT_EQ(3, parent->children().size());
+  EXPECT_EQ(4, ctx->AgentsOfPrototype("tim hortons").size());
+  EXPECT_TRUE(ctx->BuildAgents("tim hortons", parent, 0).empty());
+  EXPECT_THROW(ctx->BuildAgents("dunkin donuts", parent, 1),
+               cyclus::KeyError);
+
+  // the rows of the batch follow those of the agents built one by one
+  rec.Flush();
+  ASSERT_EQ(4, back.ids.size());
+  EXPECT_EQ(parent->id(), back.ids[0]);
+  for (int i = 0; i < built.size(); ++i) {
+    EXPECT_EQ(built[i]->id(), back.ids[i + 1]);
+  }
+  rec.Close();
+  delete ctx;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ContextTests, BuildAgentsFails) {
+  EntryBack back;
+  Timer ti;
+  Recorder rec;
+  rec.RegisterBackend(&back);
+  Context* ctx = new Context(&ti, &rec);
+
+  Agent* proto = new DonutShop(ctx, "cruller");
+  proto->prototype("tim hortons");
+  ctx->AddPrototype("tim hortons", proto);
+  Agent* parent = new SmallShop(ctx);
+  parent->prototype("small shop");
+  parent->Build(NULL);
+
+  // the agents built before the failure keep their rows
+  EXPECT_THROW(ctx->BuildAgents("tim hortons", parent, 5), cyclus::ValueError);
+  EXPECT_EQ(3, parent->children().size());
+  rec.Flush();
+  ASSERT_EQ(4, back.ids.size());
+  EXPECT_EQ(parent->id(), back.ids[0]);
+  rec.Close();
   delete ctx;
 }
@@ -24,7 +24,8 @@ from cycpp import VarDecorationFilter, VarDeclarationFilter, ExecFilter, \
 # pass 3 Filters
 from cycpp import CloneFilter, InitFromCopyFilter, \
         InitFromDbFilter, InfileToDbFilter, SchemaFilter, SnapshotFilter, \
-        SnapshotInvFilter, InitInvFilter, DefaultPragmaFilter, AnnotationsFilter
+        SnapshotInvFilter, InitInvFilter, DefaultPragmaFilter, AnnotationsFilter, \
+        SnapshotDirtyFilter, SnapshotBinaryFilter, InitFromBinaryFilter
 
 import cycpp
 
@@ -408,7 +409,8 @@ def test_ifdbfilter():
                 '  cycpp_shape_y = std::vector<int>(rawcycpp_shape_y, '
                                                    'rawcycpp_shape_y + 1);\n'
                 '  cyclus::QueryResult qr = b->Query("Info", NULL);\n'
-                '  x = qr.GetVal<int>("x");\n'
+                '  std::vector<int> cycpp_cols = qr.FieldIndexes({"x"});\n'
+                '  x = qr.GetVal<int>(cycpp_cols[0]);\n'
                 "WAKKA JAWAKA")
     yield assert_equal, exp_impl, impl
 
@@ -690,6 +692,83 @@ def test_snapshotfilter():
                 '  ->Record();\n')
     yield assert_equal, exp_impl, impl
 
+def test_snapshotdirtyfilter():
+    """Test SnapshotDirtyFilter"""
+    m = MockCodeGenMachine()
+    m.context['MyFactory']['track_changes'] = True
+    f = SnapshotDirtyFilter(m)
+    f.given_classname = 'MyFactory'
+
+    args = f.methodargs()
+    exp_args = ''
+    yield assert_equal, exp_args, args
+
+    impl = f.impl()
+    exp_impl = ('  bool dirty = false;\n'
+                '  if (x != cycpp_snap_x) {\n'
+                '    cycpp_snap_x = x;\n'
+                '    dirty = true;\n'
+                '  }\n'
+                '  dirty = true;  // y cannot be compared\n'
+                '  return dirty;\n')
+    yield assert_equal, exp_impl, impl
+
+    clsctx = m.context['MyFactory']
+    yield assert_true, f.tracked(clsctx, clsctx['vars']['x'])
+    yield assert_false, f.tracked(clsctx, clsctx['vars']['y'])
+    yield assert_false, f.tracked({'vars': clsctx['vars']},
+                                  clsctx['vars']['x'])
+
+def test_snapshotbinaryfilter():
+    """Test SnapshotBinaryFilter"""
+    m = MockCodeGenMachine()
+    f = SnapshotBinaryFilter(m)
+    f.given_classname = 'MyFactory'
+    yield assert_equal, 'cyclus::BinaryWriter* w', f.methodargs()
+
+    # y has its own snapshot code
+    yield assert_false, f.supported(m.context['MyFactory'])
+    del m.context['MyFactory']['vars']['y']
+    yield assert_true, f.supported(m.context['MyFactory'])
+
+    layout = f.layout(m.context['MyFactory'])
+    impl = f.impl()
+    exp_impl = ('  w->PutRaw<boost::uint64_t>({0});\n'
+                '  w->Put(x);\n'
+                '  return true;\n').format(layout)
+    yield assert_equal, exp_impl, impl
+
+    # the layout changes with the state variables
+    m.context['MyFactory']['vars']['x']['type'] = 'double'
+    yield assert_true, layout != f.layout(m.context['MyFactory'])
+    m.context['MyFactory']['vars']['z'] = {
+        'type': ('std::map', 'std::string', ('std::vector', 'double'))}
+    yield assert_true, f.supported(m.context['MyFactory'])
+    m.context['MyFactory']['vars']['z'] = {
+        'type': ('std::vector', 'mi6::Gadget')}
+    yield assert_false, f.supported(m.context['MyFactory'])
+
+def test_initfrombinaryfilter():
+    """Test InitFromBinaryFilter"""
+    m = MockCodeGenMachine()
+    del m.context['MyFactory']['vars']['y']
+    m.context['MyFactory']['vars']['inv'] = {
+        'type': ('cyclus::toolkit::ResBuf', 'cyclus::Material'),
+        'capacity': 'x'}
+    f = InitFromBinaryFilter(m)
+    f.given_classname = 'MyFactory'
+    yield assert_equal, 'cyclus::BinaryReader* r', f.methodargs()
+    yield assert_true, f.supported(m.context['MyFactory'])
+
+    impl = f.impl()
+    exp_impl = ('  if (r->GetRaw<boost::uint64_t>() != {0}) {{\n'
+                '    throw cyclus::IOError("binary state of MyFactory was '
+                'written by another build");\n'
+                '  }}\n'
+                '  r->Get(&x);\n'
+                '  inv.capacity(x);\n').format(f.layout(m.context['MyFactory']))
+    yield assert_equal, exp_impl, impl
+
 def test_sshinvfilter():
     """Test SnapshotInvFilter"""
     m = MockCodeGenMachine()
@@ -1,10 +1,15 @@
+#include <stdlib.h>
+
+#include <fstream>
 #include <string>
 #include <vector>
 
+#include <boost/filesystem.hpp>
 #include <gtest/gtest.h>
 
 #include "discovery.h"
 #include "env.h"
+#include "platform.h"
 
 TEST(DiscoveryTests, DiscoverArchetypes) {
   using std::string;
@@ -66,3 +71,44 @@ TEST(DiscoveryTests, DiscoverSpecsInInstallPath) {
   for (set<string>::iterator it = exp.begin(); it != exp.end(); ++it)
     EXPECT_EQ(1, obs.count(*it));
 }
+
+TEST(DiscoveryTests, DiscoverSpecsInDirIndex) {
+  namespace fs = boost::filesystem;
+  fs::path tmp = fs::temp_directory_path() / fs::unique_path();
+  fs::path mods = tmp / "mods";
+  fs::create_directories(mods);
+  std::string lib = (mods / (std::string("libfake") + SUFFIX)).string();
+  {
+    std::ofstream f(lib.c_str());
+    f << "no archetypes here";
+  }
+  setenv("CYCLUS_DISCOVERY_CACHE", (tmp / "cache").string().c_str(), 1);
+  EXPECT_TRUE(cyclus::DiscoverSpecsInDir(mods.string()).empty());
+
+  // an unchanged library is not rescanned; its indexed specs are used
+  fs::directory_iterator it(tmp / "cache");
+  ASSERT_TRUE(it != fs::directory_iterator());
+  std::string index = it->path().string();
+  Json::Value root;
+  {
+    std::ifstream f(index.c_str());
+    ASSERT_TRUE(Json::Reader().parse(f, root, false));
+  }
+  ASSERT_TRUE(root["libs"].isMember(lib));
+  root["libs"][lib]["specs"].append(":fake:Fake");
+  {
+    std::ofstream f(index.c_str());
+    f << Json::FastWriter().write(root);
+  }
+  EXPECT_EQ(1, cyclus::DiscoverSpecsInDir(mods.string()).count(":fake:Fake"));
+
+  // a changed library is
+  {
+    std::ofstream f(lib.c_str());
+    f << "still no archetypes here";
+  }
+  EXPECT_TRUE(cyclus::DiscoverSpecsInDir(mods.string()).empty());
+
+  unsetenv("CYCLUS_DISCOVERY_CACHE");
+  fs::remove_all(tmp);
+}
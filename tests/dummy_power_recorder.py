@@ -12,3 +12,9 @@ def echo_power(agent, time, value, commod):
     print("The power is {0}".format(value))
 
 lib.TIME_SERIES_LISTENERS["Power"].append(echo_power)
+
+
+def echo_power_batch(agent_ids, time, values, commod):
+    print("The batched power at {0} is {1}".format(time, list(values)))
+
+lib.TIME_SERIES_BATCH_LISTENERS["Power"].append(echo_power_batch)
@@ -38,6 +38,19 @@ TEST(DynamicLoadingTests, LoadLibError) {
   cyclus::PyStop();
 }
 
+TEST(DynamicLoadingTests, LoadSolverError) {
+  cyclus::PyStart();
+  EXPECT_THROW(DynamicModule::MakeSolver(AgentSpec("foo:foo:not_a_solver"),
+                                         true, ""),
+               cyclus::IOError);
+  // the library exists but doesn't export ConstructSolverTestFacility
+  EXPECT_THROW(DynamicModule::MakeSolver(
+                   AgentSpec("tests:TestFacility:TestFacility"), true, ""),
+               cyclus::IOError);
+  DynamicModule::CloseAll();
+  cyclus::PyStop();
+}
+
 TEST(DynamicLoadingTests, Exists) {
   cyclus::PyStart();
   EXPECT_TRUE(DynamicModule::Exists(AgentSpec("tests:TestFacility:TestFacility")));
@@ -0,0 +1,162 @@
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "exchange_coarsener.h"
+#include "exchange_graph.h"
+#include "greedy_solver.h"
+
+using cyclus::Arc;
+using cyclus::ExchangeCoarsener;
+using cyclus::ExchangeGraph;
+using cyclus::ExchangeNode;
+using cyclus::ExchangeNodeGroup;
+using cyclus::GreedySolver;
+using cyclus::Match;
+using cyclus::RequestGroup;
+
+namespace {
+
+// adds a request group of one request of qty, which the supplier bids all of
+// on, returning the arc between the two
+Arc AddRequest(ExchangeGraph* g, ExchangeNodeGroup::Ptr supplier, double qty,
+               bool exclusive) {
+  RequestGroup::Ptr rg(new RequestGroup(qty));
+  rg->AddCapacity(qty);
+  ExchangeNode::Ptr u(new ExchangeNode(qty, exclusive, "spam"));
+  rg->AddExchangeNode(u);
+  g->AddRequestGroup(rg);
+
+  ExchangeNode::Ptr v(new ExchangeNode(qty, false, "spam"));
+  supplier->AddExchangeNode(v);
+  Arc a(u, v);
+  a.pref(1);
+  u->prefs[a] = 1;
+  u->unit_capacities[a].push_back(1);
+  v->unit_capacities[a].push_back(1);
+  g->AddArc(a);
+  return a;
+}
+
+}  // namespace
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(ExchangeCoarsenerTests, Coarsen) {
+  ExchangeGraph fine;
+  ExchangeNodeGroup::Ptr supplier(new ExchangeNodeGroup());
+  supplier->AddCapacity(25);
+  fine.AddSupplyGroup(supplier);
+  std::vector<Arc> arcs;
+  for (int i = 0; i < 3; ++i) {
+    arcs.push_back(AddRequest(&fine, supplier, 10, false));
+  }
+  arcs.push_back(AddRequest(&fine, supplier, 10, false));  // another key
+  arcs.push_back(AddRequest(&fine, supplier, 10, true));  // exclusive
+  arcs.push_back(AddRequest(&fine, supplier, 5, false));  // smaller
+
+  std::vector<int> keys;
+  keys.push_back(1);
+  keys.push_back(1);
+  keys.push_back(1);
+  keys.push_back(2);
+  keys.push_back(1);
+  EXPECT_THROW(ExchangeCoarsener().Coarsen(&fine, keys), cyclus::ValueError);
+  keys.push_back(1);
+
+  ExchangeCoarsener coarsener;
+  ExchangeGraph::Ptr coarse = coarsener.Coarsen(&fine, keys);
+  EXPECT_EQ(2, coarsener.merged());
+  ASSERT_EQ(4, coarse->request_groups().size());
+  ASSERT_EQ(1, coarse->supply_groups().size());
+  ASSERT_EQ(4, coarse->arcs().size());
+  EXPECT_EQ(25, coarse->supply_groups()[0]->capacities()[0]);
+  EXPECT_EQ(4, coarse->supply_groups()[0]->nodes().size());
+
+  RequestGroup::Ptr agg = coarse->request_groups()[0];
+  EXPECT_EQ(30, agg->qty());
+  EXPECT_EQ(30, agg->capacities()[0]);
+  ASSERT_EQ(1, agg->nodes().size());
+  EXPECT_EQ(30, agg->nodes()[0]->qty);
+  const Arc& a = coarse->arcs()[0];
+  EXPECT_EQ(agg->nodes()[0], a.unode());
+  EXPECT_EQ(30, a.vnode()->qty);
+  EXPECT_EQ(1, a.unode()->prefs[a]);
+  EXPECT_EQ(std::vector<double>(1, 1), a.vnode()->unit_capacities[a]);
+  EXPECT_TRUE(coarse->arcs()[2].exclusive());
+
+  // the merged requests are filled in order
+  std::vector<Match> matches;
+  matches.push_back(Match(coarse->arcs()[0], 25));
+  matches.push_back(Match(coarse->arcs()[3], 5));
+  std::vector<Match> refined;
+  coarsener.Refine(matches, &refined);
+  ASSERT_EQ(4, refined.size());
+  EXPECT_EQ(arcs[0], refined[0].first);
+  EXPECT_DOUBLE_EQ(10, refined[0].second);
+  EXPECT_EQ(arcs[1], refined[1].first);
+  EXPECT_DOUBLE_EQ(10, refined[1].second);
+  EXPECT_EQ(arcs[2], refined[2].first);
+  EXPECT_DOUBLE_EQ(5, refined[2].second);
+  EXPECT_EQ(arcs[5], refined[3].first);
+  EXPECT_DOUBLE_EQ(5, refined[3].second);
+
+  // or share the flow evenly
+  coarsener.split(ExchangeCoarsener::PROPORTIONAL);
+  refined.clear();
+  coarsener.Refine(matches, &refined);
+  ASSERT_EQ(4, refined.size());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(arcs[i], refined[i].first);
+    EXPECT_DOUBLE_EQ(25.0 / 3, refined[i].second);
+  }
+
+  matches.clear();
+  matches.push_back(Match(arcs[0], 1));
+  EXPECT_THROW(coarsener.Refine(matches, &refined), cyclus::KeyError);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(ExchangeCoarsenerTests, NoKeys) {
+  ExchangeGraph fine;
+  ExchangeNodeGroup::Ptr supplier(new ExchangeNodeGroup());
+  fine.AddSupplyGroup(supplier);
+  AddRequest(&fine, supplier, 10, false);
+  AddRequest(&fine, supplier, 10, false);
+
+  ExchangeCoarsener coarsener;
+  ExchangeGraph::Ptr coarse =
+      coarsener.Coarsen(&fine, std::vector<int>(2, -1));
+  EXPECT_EQ(0, coarsener.merged());
+  EXPECT_TRUE(coarse->SameProblem(fine));
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(ExchangeCoarsenerTests, Solve) {
+  // the solution of the coarse graph is that of the fine one
+  ExchangeGraph fine;
+  ExchangeNodeGroup::Ptr supplier(new ExchangeNodeGroup());
+  supplier->AddCapacity(45);
+  fine.AddSupplyGroup(supplier);
+  for (int i = 0; i < 5; ++i) {
+    AddRequest(&fine, supplier, 10, false);
+  }
+
+  ExchangeCoarsener coarsener;
+  ExchangeGraph::Ptr coarse =
+      coarsener.Coarsen(&fine, std::vector<int>(5, 1));
+  EXPECT_EQ(4, coarsener.merged());
+  GreedySolver solver;
+  solver.Solve(coarse.get());
+  std::vector<Match> refined;
+  coarsener.Refine(coarse->matches(), &refined);
+
+  GreedySolver fine_solver;
+  fine_solver.Solve(&fine);
+  const std::vector<Match>& exp = fine.matches();
+  ASSERT_EQ(exp.size(), refined.size());
+  for (int i = 0; i < exp.size(); ++i) {
+    EXPECT_EQ(exp[i].first, refined[i].first);
+    EXPECT_DOUBLE_EQ(exp[i].second, refined[i].second);
+  }
+}
@@ -224,3 +224,54 @@ TEST_F(ExchangeContextTests, AddBid2) {
   bidders.insert(fac2);
   EXPECT_EQ(bidders, context.bidders);
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ExchangeContextTests, FlatPrefs) {
+  ExchangeContext<Resource> context;
+  context.AddRequestPortfolio(rp1);
+  context.AddRequestPortfolio(rp2);
+
+  Bid<Resource>* bid1 = Bid<Resource>::Create(req1, get_mat(), fac2);
+  Bid<Resource>* bid2 = Bid<Resource>::Create(req2, get_mat(), fac1, false,
+                                              0.25);
+  Bid<Resource>* bid3 = Bid<Resource>::Create(req1, get_mat(), fac2);
+  context.AddBid(bid1);
+  context.AddBid(bid2);
+  context.AddBid(bid3);
+
+  EXPECT_EQ(3, context.narcs());
+  EXPECT_EQ(0, context.arc(bid1));
+  EXPECT_EQ(1, context.arc(bid2));
+  EXPECT_EQ(2, context.arc(bid3));
+  EXPECT_EQ(bid2, context.arc_bid(1));
+  EXPECT_DOUBLE_EQ(pref, context.pref(0));
+  EXPECT_DOUBLE_EQ(0.25, context.pref(1));
+
+  // fac1's arcs are grouped together, in the order they were added
+  std::pair<const int*, const int*> span = context.TraderArcs(fac1);
+  ASSERT_EQ(2, span.second - span.first);
+  EXPECT_EQ(0, span.first[0]);
+  EXPECT_EQ(2, span.first[1]);
+  span = context.TraderArcs(fac2);
+  ASSERT_EQ(1, span.second - span.first);
+  EXPECT_EQ(1, span.first[0]);
+
+  PrefMap<Resource>::type prefs;
+  context.ViewPrefs(fac1, &prefs);
+  ASSERT_EQ(1, prefs.size());
+  ASSERT_EQ(2, prefs[req1].size());
+  EXPECT_DOUBLE_EQ(pref, prefs[req1][bid3]);
+
+  prefs[req1][bid3] = 3;
+  prefs[req1].erase(bid1);
+  prefs[req2][bid2] = 4;
+  context.StorePrefs(fac1, prefs);
+  EXPECT_DOUBLE_EQ(0, context.pref(0));
+  EXPECT_DOUBLE_EQ(0.25, context.pref(1));
+  EXPECT_DOUBLE_EQ(3, context.pref(2));
+  EXPECT_DOUBLE_EQ(3, context.trader_prefs[fac1][req1][bid3]);
+
+  delete bid1;
+  delete bid2;
+  delete bid3;
+}
@@ -130,3 +130,178 @@ TEST(ExGraphTests, AddMatch) {
   ASSERT_EQ(1, g.matches().size());
   EXPECT_EQ(match, g.matches().at(0));
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(ExGraphTests, Flatten) {
+  ExchangeGraph g;
+
+  RequestGroup::Ptr req(new RequestGroup(2.0));
+  ExchangeNode::Ptr u(new ExchangeNode(1.5));
+  req->AddExchangeNode(u);
+  g.AddRequestGroup(req);
+
+  ExchangeNodeGroup::Ptr sup(new ExchangeNodeGroup());
+  ExchangeNode::Ptr v(new ExchangeNode());
+  ExchangeNode::Ptr w(new ExchangeNode(1.0, true));
+  sup->AddExchangeNode(v);
+  sup->AddExchangeNode(w);
+  g.AddSupplyGroup(sup);
+
+  Arc a(u, v);
+  Arc b(u, w);
+  u->prefs[a] = 2;
+  u->prefs[b] = 3;
+  u->unit_capacities[a].push_back(1);
+  v->unit_capacities[a].push_back(0.5);
+  v->unit_capacities[a].push_back(0.25);
+  g.AddArc(a);
+  g.AddArc(b);
+
+  const cyclus::FlatExchangeGraph& f = g.flat();
+  ASSERT_EQ(3, f.nodes.size());
+  EXPECT_EQ(0, f.node_id(u.get()));
+  EXPECT_EQ(1, f.node_id(v.get()));
+  EXPECT_EQ(2, f.node_id(w.get()));
+  EXPECT_EQ(-1, f.node_id(NULL));
+  ASSERT_EQ(2, f.groups.size());
+  EXPECT_EQ(req.get(), f.groups[f.node_group[0]]);
+  EXPECT_EQ(sup.get(), f.groups[f.node_group[2]]);
+  EXPECT_DOUBLE_EQ(1.5, f.node_qty[0]);
+
+  // arcs are numbered as in arc_ids()
+  EXPECT_EQ(g.arc_ids()[b], 1);
+  EXPECT_EQ(vector<int>({0, 0}), f.arc_unode);
+  EXPECT_EQ(vector<int>({1, 2}), f.arc_vnode);
+  EXPECT_EQ(vector<double>({2, 3}), f.arc_pref);
+  EXPECT_FALSE(f.arc_exclusive[0]);
+  EXPECT_TRUE(f.arc_exclusive[1]);
+  EXPECT_DOUBLE_EQ(b.excl_val(), f.arc_excl_val[1]);
+  EXPECT_EQ(vector<int>({0, 1, 1}), f.ucap_start);
+  EXPECT_EQ(vector<int>({0, 2, 2}), f.vcap_start);
+  EXPECT_EQ(vector<double>({0.5, 0.25}), f.vcaps);
+
+  // adjacency matches node_arc_map()
+  EXPECT_EQ(vector<int>({0, 2, 3, 4}), f.adj_start);
+  EXPECT_EQ(vector<int>({0, 1, 0, 1}), f.adj);
+
+  // adding an arc invalidates the layout
+  ExchangeNode::Ptr x(new ExchangeNode());
+  sup->AddExchangeNode(x);
+  g.AddArc(Arc(u, x));
+  EXPECT_EQ(3, g.flat().arc_unode.size());
+  EXPECT_EQ(4, g.flat().nodes.size());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void BuildSimpleGraph(ExchangeGraph* g, double pref) {
+  RequestGroup::Ptr req(new RequestGroup(2.0));
+  ExchangeNode::Ptr u(new ExchangeNode(2.0));
+  req->AddExchangeNode(u);
+  req->AddCapacity(2.0);
+  g->AddRequestGroup(req);
+
+  ExchangeNodeGroup::Ptr sup(new ExchangeNodeGroup());
+  ExchangeNode::Ptr v(new ExchangeNode(1.0));
+  ExchangeNode::Ptr w(new ExchangeNode(1.0));
+  sup->AddExchangeNode(v);
+  sup->AddExchangeNode(w);
+  sup->AddCapacity(1.5);
+  g->AddSupplyGroup(sup);
+
+  Arc a(u, v);
+  Arc b(u, w);
+  u->prefs[a] = 1;
+  u->prefs[b] = pref;
+  u->unit_capacities[a].push_back(1);
+  u->unit_capacities[b].push_back(1);
+  v->unit_capacities[a].push_back(1);
+  w->unit_capacities[b].push_back(1);
+  g->AddArc(a);
+  g->AddArc(b);
+}
+
+TEST(ExGraphTests, SameProblem) {
+  ExchangeGraph g, h, k;
+  BuildSimpleGraph(&g, 2);
+  BuildSimpleGraph(&h, 2);
+  BuildSimpleGraph(&k, 3);
+  EXPECT_TRUE(g.SameProblem(h));
+  EXPECT_FALSE(g.SameProblem(k));
+
+  // reordering the nodes of a group, as solvers do, does not change the
+  // problem
+  std::vector<ExchangeNode::Ptr>& nodes = h.supply_groups()[0]->nodes();
+  std::swap(nodes[0], nodes[1]);
+  EXPECT_TRUE(g.SameProblem(h));
+
+  h.supply_groups()[0]->capacities()[0] = 1.0;
+  EXPECT_FALSE(g.SameProblem(h));
+}
+
+TEST(ExGraphTests, Fingerprint) {
+  ExchangeGraph g, h, k;
+  BuildSimpleGraph(&g, 2);
+  BuildSimpleGraph(&h, 2);
+  BuildSimpleGraph(&k, 3);
+  EXPECT_EQ(g.Fingerprint(), h.Fingerprint());
+  EXPECT_NE(g.Fingerprint(), k.Fingerprint());
+
+  std::vector<ExchangeNode::Ptr>& nodes = h.supply_groups()[0]->nodes();
+  std::swap(nodes[0], nodes[1]);
+  EXPECT_EQ(g.Fingerprint(), h.Fingerprint());
+
+  h.supply_groups()[0]->capacities()[0] = 1.0;
+  EXPECT_NE(g.Fingerprint(), h.Fingerprint());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(ExGraphTests, Components) {
+  ExchangeGraph g;
+  EXPECT_TRUE(g.Components().empty());
+
+  // two requests of one group, each with its own supplier
+  RequestGroup::Ptr req(new RequestGroup());
+  ExchangeNode::Ptr u(new ExchangeNode());
+  ExchangeNode::Ptr w(new ExchangeNode());
+  req->AddExchangeNode(u);
+  req->AddExchangeNode(w);
+  g.AddRequestGroup(req);
+  ExchangeNodeGroup::Ptr sup1(new ExchangeNodeGroup());
+  ExchangeNode::Ptr v(new ExchangeNode());
+  sup1->AddExchangeNode(v);
+  g.AddSupplyGroup(sup1);
+  ExchangeNodeGroup::Ptr sup2(new ExchangeNodeGroup());
+  ExchangeNode::Ptr x(new ExchangeNode());
+  sup2->AddExchangeNode(x);
+  g.AddSupplyGroup(sup2);
+  g.AddArc(Arc(u, v));
+  g.AddArc(Arc(w, x));
+
+  // the shared request group joins both arcs
+  EXPECT_TRUE(g.Components().empty());
+
+  // an independent request and supplier, and a group with no arcs
+  RequestGroup::Ptr req2(new RequestGroup());
+  ExchangeNode::Ptr y(new ExchangeNode());
+  req2->AddExchangeNode(y);
+  g.AddRequestGroup(req2);
+  ExchangeNodeGroup::Ptr sup3(new ExchangeNodeGroup());
+  ExchangeNode::Ptr z(new ExchangeNode());
+  sup3->AddExchangeNode(z);
+  g.AddSupplyGroup(sup3);
+  ExchangeNodeGroup::Ptr idle(new ExchangeNodeGroup());
+  idle->AddExchangeNode(ExchangeNode::Ptr(new ExchangeNode()));
+  g.AddSupplyGroup(idle);
+  g.AddArc(Arc(y, z));
+
+  vector<ExchangeGraph::Ptr> comps = g.Components();
+  ASSERT_EQ(2, comps.size());
+  ASSERT_EQ(1, comps[0]->request_groups().size());
+  EXPECT_EQ(req, comps[0]->request_groups()[0]);
+  ASSERT_EQ(3, comps[0]->supply_groups().size());
+  EXPECT_EQ(idle, comps[0]->supply_groups()[2]);
+  EXPECT_EQ(2, comps[0]->arcs().size());
+  ASSERT_EQ(1, comps[1]->arcs().size());
+  EXPECT_EQ(y, comps[1]->arcs()[0].unode());
+  EXPECT_EQ(sup3, comps[1]->supply_groups()[0]);
+}
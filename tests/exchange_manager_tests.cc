@@ -1,10 +1,12 @@
 #include <gtest/gtest.h>
 
+#include "column_store.h"
 #include "exchange_manager.h"
 #include "greedy_solver.h"
 #include "material.h"
 #include "test_context.h"
 
+using cyclus::ColumnStore;
 using cyclus::ExchangeManager;
 using cyclus::GreedySolver;
 using cyclus::Material;
@@ -17,4 +19,65 @@ TEST(ExManagerTests, NullTest) {
   ExchangeManager<Material> manager(tc.get());
 
   EXPECT_NO_THROW(manager.Execute());
+  EXPECT_FALSE(manager.reused());
+}
+
+TEST(ExManagerTests, PartitionRegionsSetting) {
+  TestContext tc;
+  EXPECT_FALSE(ExchangeManager<Material>(tc.get()).partition_regions());
+
+  cyclus::SimInfo si(5);
+  si.dre_regions = true;
+  tc.get()->InitSim(si);
+  EXPECT_TRUE(ExchangeManager<Material>(tc.get()).partition_regions());
+}
+
+TEST(ExManagerTests, CoarsenSetting) {
+  TestContext tc;
+  EXPECT_FALSE(ExchangeManager<Material>(tc.get()).coarsen());
+
+  cyclus::SimInfo si(5);
+  si.dre_coarsen = "proportional";
+  tc.get()->InitSim(si);
+  ExchangeManager<Material> manager(tc.get());
+  EXPECT_TRUE(manager.coarsen());
+  EXPECT_EQ(cyclus::ExchangeCoarsener::PROPORTIONAL, manager.split());
+
+  // the environment overrides the input file
+  setenv("CYCLUS_DRE_COARSEN", "in_order", 1);
+  ExchangeManager<Material> env_manager(tc.get());
+  unsetenv("CYCLUS_DRE_COARSEN");
+  EXPECT_TRUE(env_manager.coarsen());
+  EXPECT_EQ(cyclus::ExchangeCoarsener::IN_ORDER, env_manager.split());
+}
+
+TEST(ExManagerTests, Timings) {
+  TestContext tc;
+  ColumnStore store;
+  tc.recorder()->RegisterBackend(&store);
+  GreedySolver* solver = new GreedySolver();
+  tc.get()->solver(solver);
+  ExchangeManager<Material> manager(tc.get());
+  manager.timings(true);
+
+  EXPECT_NO_THROW(manager.Execute());
+  tc.recorder()->Flush();
+  ASSERT_EQ(1, store.nrows("DreTimings"));
+  ColumnStore::Table& tbl = *store.table("DreTimings");
+  std::map<std::string, ColumnStore::Column*> cols;
+  for (int i = 0; i != tbl.size(); i++)
+    cols[tbl[i].name()] = &tbl[i];
+  ASSERT_EQ(1, cols.count("ResourceType"));
+  EXPECT_EQ(Material::kType,
+            cols["ResourceType"]->values()[0].cast<std::string>());
+  ASSERT_EQ(1, cols.count("NumArcs"));
+  EXPECT_EQ(0, reinterpret_cast<const int64_t*>(
+      &(*cols["NumArcs"]->buffer())[0])[0]);
+  EXPECT_EQ(1, cols.count("Solve"));
+
+  manager.timings(false);
+  EXPECT_NO_THROW(manager.Execute());
+  tc.recorder()->Flush();
+  EXPECT_EQ(1, store.nrows("DreTimings"));
+  tc.recorder()->Close();
 }
@@ -6,6 +6,48 @@
 
 namespace cyclus {
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Arc AddArc(ExchangeGraph* g, ExchangeNode::Ptr u, ExchangeNode::Ptr v,
+           double pref) {
+  Arc a(u, v);
+  u->prefs[a] = pref;
+  a.pref(pref);
+  u->unit_capacities[a].push_back(1);
+  v->unit_capacities[a].push_back(1);
+  g->AddArc(a);
+  return a;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+ExchangeNode::Ptr AddRequest(ExchangeGraph* g, double qty, int id) {
+  ExchangeNode::Ptr u(new ExchangeNode(qty, false, "commod", id));
+  RequestGroup::Ptr gu(new RequestGroup(qty));
+  gu->AddExchangeNode(u);
+  gu->AddCapacity(qty);
+  g->AddRequestGroup(gu);
+  return u;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+ExchangeNode::Ptr AddSupply(ExchangeGraph* g, double qty, int id) {
+  ExchangeNode::Ptr v(new ExchangeNode(qty, false, "commod", id));
+  ExchangeNodeGroup::Ptr gv(new ExchangeNodeGroup());
+  gv->AddExchangeNode(v);
+  gv->AddCapacity(qty);
+  g->AddSupplyGroup(gv);
+  return v;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double Flow(ExchangeGraph& g, const Arc& a) {
+  const std::vector<Match>& matches = g.matches();
+  for (int i = 0; i != matches.size(); i++) {
+    if (matches[i].first == a)
+      return matches[i].second;
+  }
+  return 0;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Case0::Construct(ExchangeGraph* g, bool exclusive_orders) {}
 
@@ -3,9 +3,23 @@
 
 #include <string>
 
+#include "exchange_graph.h"
+
 namespace cyclus {
 
-class ExchangeGraph;
+/// adds an arc from a bid node to a request node with a preference and unit
+/// capacities of 1
+Arc AddArc(ExchangeGraph* g, ExchangeNode::Ptr u, ExchangeNode::Ptr v,
+           double pref);
+
+/// adds a request group for qty with a single node
+ExchangeNode::Ptr AddRequest(ExchangeGraph* g, double qty, int id);
+
+/// adds a supply group for qty with a single node
+ExchangeNode::Ptr AddSupply(ExchangeGraph* g, double qty, int id);
+
+/// returns the flow matched along an arc, or 0 if there is none
+double Flow(ExchangeGraph& g, const Arc& a);
 
 /// ExchangeCase, a class that provides a virtual interface for constructing
 /// and testing a variety of ExchangeGraph/ExchangeSolver test instances.
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <gtest/gtest.h>
 
 #include "bid.h"
@@ -169,6 +171,53 @@ TEST(ExXlateTests, XlateCapacities) {
   TestVecEq(bexp, bnode->unit_capacities[arc]);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// counts its conversions, which depend on nothing but the offer
+struct CountingConverter : public Converter<Material> {
+  CountingConverter() : n(0) {}
+
+  virtual double convert(
+      Material::Ptr r,
+      Arc const * a = NULL,
+      ExchangeTranslationContext<Material> const *  ctx = NULL) const {
+    n++;
+    return r->quantity() * fraction;
+  }
+  virtual bool offer_only() const { return true; }
+
+  mutable int n;
+};
+
+TEST(ExXlateTests, XlateCapacitiesCached) {
+  Material::Ptr mat = get_mat(u235, qty);
+  Material::Ptr other = get_mat(u235, 2 * qty);
+  CountingConverter* counter = new CountingConverter();
+  Converter<Material>::Ptr c(counter);
+  std::set< CapacityConstraint<Material> > constrs;
+  constrs.insert(CapacityConstraint<Material>(qty, c));
+
+  ExchangeNode::Ptr u1(new ExchangeNode());
+  ExchangeNode::Ptr u2(new ExchangeNode());
+  ExchangeNode::Ptr v(new ExchangeNode());
+  Arc a1(u1, v);
+  Arc a2(u2, v);
+
+  ExchangeTranslationContext<Material> ctx;
+  TranslateCapacities<Material>(mat, constrs, u1, a1, ctx);
+  TranslateCapacities<Material>(mat, constrs, u2, a2, ctx);
+  EXPECT_EQ(1, counter->n);
+  EXPECT_DOUBLE_EQ(fraction, u1->unit_capacities[a1][0]);
+  EXPECT_DOUBLE_EQ(fraction, u2->unit_capacities[a2][0]);
+
+  TranslateCapacities<Material>(other, constrs, v, a1, ctx);
+  EXPECT_EQ(2, counter->n);
+
+  // conversions are only reused within a translation context
+  ExchangeTranslationContext<Material> fresh;
+  TranslateCapacities<Material>(mat, constrs, v, a2, fresh);
+  EXPECT_EQ(3, counter->n);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST(ExXlateTests, XlateReq) {
   TestContext tc;
@@ -433,6 +482,95 @@ TEST(ExXlateTests, SimpleXlate) {
   EXPECT_EQ(pref, a.unode()->prefs[a]);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(ExXlateTests, DirectXlate) {
+  TestContext tc;
+  TestFacility* trader = tc.trader();
+
+  RequestPortfolio<Material>::Ptr rport(new RequestPortfolio<Material>());
+  Request<Material>* req1 =
+      rport->AddRequest(get_mat(u235, qty), trader, "c", 1);
+  Request<Material>* req2 =
+      rport->AddRequest(get_mat(u235, qty), trader, "c", 2);
+
+  BidPortfolio<Material>::Ptr bport(new BidPortfolio<Material>());
+  Bid<Material>* bid = bport->AddBid(req2, get_mat(u235, qty), trader);
+
+  ExchangeContext<Material> ctx;
+  ctx.AddRequestPortfolio(rport);
+  ctx.AddBidPortfolio(bport);
+
+  // requests and bids numbered by the context are translated without maps
+  ExchangeTranslator<Material> xlator(&ctx);
+  ExchangeGraph::Ptr graph = xlator.Translate();
+  const ExchangeTranslationContext<Material>& xctx = xlator.translation_ctx();
+  EXPECT_TRUE(xctx.request_to_node.empty());
+  EXPECT_TRUE(xctx.node_to_request.empty());
+  EXPECT_TRUE(xctx.bid_to_node.empty());
+  EXPECT_TRUE(xctx.node_to_bid.empty());
+  ASSERT_EQ(2, xctx.request_nodes.size());
+  ASSERT_EQ(1, xctx.bid_nodes.size());
+  EXPECT_EQ(1, xctx.request_nodes[1]->index);
+  EXPECT_EQ(req2, xctx.request(xctx.request_nodes[1]));
+  EXPECT_EQ(bid, xctx.bid(xctx.bid_nodes[0]));
+
+  ASSERT_EQ(1, graph->arcs().size());
+  const Arc& a = graph->arcs()[0];
+  EXPECT_EQ(xctx.request_nodes[1], a.unode());
+  EXPECT_EQ(xctx.bid_nodes[0], a.vnode());
+
+  std::vector<Match> matches;
+  matches.push_back(std::make_pair(a, qty));
+  std::vector< Trade<Material> > obs;
+  xlator.BackTranslateSolution(matches, obs);
+  ASSERT_EQ(1, obs.size());
+  EXPECT_EQ(Trade<Material>(req2, bid, qty), obs[0]);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(ExXlateTests, PruneDominated) {
+  TestContext tc;
+  TestFacility* trader = tc.trader();
+
+  RequestPortfolio<Material>::Ptr rport(new RequestPortfolio<Material>());
+  Request<Material>* req =
+      rport->AddRequest(get_mat(u235, qty), trader, "c", 1);
+
+  // both exclusive bids offer the same material, so only one can be used
+  Material::Ptr offer = get_mat(u235, qty);
+  bool exclusive = true;
+  BidPortfolio<Material>::Ptr bport(new BidPortfolio<Material>());
+  bport->AddBid(req, offer, trader, exclusive, 1);
+  bport->AddBid(req, offer, trader, exclusive, 2);
+  bport->AddBid(req, get_mat(u235, qty), trader, exclusive, 0.5);
+
+  ExchangeContext<Material> ctx;
+  ctx.AddRequestPortfolio(rport);
+  ctx.AddBidPortfolio(bport);
+
+  ExchangeTranslator<Material> xlator(&ctx);
+  ExchangeGraph::Ptr graph = xlator.Translate();
+  EXPECT_EQ(1, xlator.pruned().dominated);
+  EXPECT_EQ(0, xlator.pruned().preference);
+  EXPECT_EQ(0, xlator.pruned().capacity);
+  ASSERT_EQ(2, graph->arcs().size());
+  std::vector<double> prefs;
+  for (int i = 0; i != graph->arcs().size(); i++) {
+    const Arc& a = graph->arcs()[i];
+    prefs.push_back(a.pref());
+    EXPECT_EQ(1, a.unode()->prefs.count(a));
+  }
+  std::sort(prefs.begin(), prefs.end());
+  EXPECT_DOUBLE_EQ(0.5, prefs[0]);
+  EXPECT_DOUBLE_EQ(2, prefs[1]);
+  EXPECT_EQ(2, graph->arcs()[0].unode()->prefs.size());
+
+  ExchangeTranslator<Material> keep(&ctx);
+  keep.prune(false);
+  EXPECT_EQ(3, keep.Translate()->arcs().size());
+  EXPECT_EQ(0, keep.pruned().dominated);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST(ExXlateTests, BackXlate) {
   TestContext tc;
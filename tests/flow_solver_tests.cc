@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "exchange_graph.h"
+#include "exchange_test_cases.h"
+#include "flow_solver.h"
+
+using cyclus::AddArc;
+using cyclus::AddRequest;
+using cyclus::AddSupply;
+using cyclus::Arc;
+using cyclus::ExchangeGraph;
+using cyclus::ExchangeNode;
+using cyclus::ExchangeSolver;
+using cyclus::Flow;
+using cyclus::FlowSolver;
+using cyclus::RequestGroup;
+
+namespace {
+
+class MockSolver : public ExchangeSolver {
+ public:
+  MockSolver() : i(0) {}
+  virtual double SolveGraph() { ++i; return 42; }
+  int i;
+};
+
+}  // namespace
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(FlowSolverTests, Optimal) {
+  // r1 slightly prefers s1, which r2 needs, so matching greedily by
+  // preference leaves r2 unmet
+  ExchangeGraph g;
+  ExchangeNode::Ptr r1 = AddRequest(&g, 1, 1);
+  ExchangeNode::Ptr r2 = AddRequest(&g, 1, 2);
+  ExchangeNode::Ptr s1 = AddSupply(&g, 1, 3);
+  ExchangeNode::Ptr s2 = AddSupply(&g, 1, 4);
+  Arc a11 = AddArc(&g, r1, s1, 2);
+  Arc a12 = AddArc(&g, r1, s2, 1.9);
+  Arc a21 = AddArc(&g, r2, s1, 1.5);
+
+  FlowSolver s(false, new MockSolver());
+  double obj = s.Solve(&g);
+  EXPECT_EQ(0, s.nfallbacks());
+  EXPECT_DOUBLE_EQ(0, Flow(g, a11));
+  EXPECT_DOUBLE_EQ(1, Flow(g, a12));
+  EXPECT_DOUBLE_EQ(1, Flow(g, a21));
+  EXPECT_DOUBLE_EQ(1 / 1.9 + 1 / 1.5, obj);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(FlowSolverTests, Unmet) {
+  ExchangeGraph g;
+  ExchangeNode::Ptr r = AddRequest(&g, 3, 1);
+  ExchangeNode::Ptr v = AddSupply(&g, 1, 2);
+  Arc a = AddArc(&g, r, v, 2);
+
+  FlowSolver s(false, NULL);
+  s.graph(&g);
+  double pseudo = s.PseudoCost();
+  double obj = s.Solve();
+  ASSERT_EQ(1, g.matches().size());
+  EXPECT_DOUBLE_EQ(1, Flow(g, a));
+  EXPECT_DOUBLE_EQ(0.5 + 2 * pseudo, obj);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(FlowSolverTests, Fallback) {
+  ExchangeGraph g;
+  ExchangeNode::Ptr r = AddRequest(&g, 1, 1);
+  ExchangeNode::Ptr v = AddSupply(&g, 1, 2);
+  AddArc(&g, r, v, 2);
+  // a second capacity makes this more than a transportation problem
+  g.supply_groups()[0]->AddCapacity(2);
+  g.arcs()[0].vnode()->unit_capacities[g.arcs()[0]].push_back(1);
+
+  MockSolver* fallback = new MockSolver();
+  FlowSolver s(false, fallback);
+  EXPECT_FALSE(s.IsTransportation(&g));
+  EXPECT_DOUBLE_EQ(42, s.Solve(&g));
+  EXPECT_EQ(1, fallback->i);
+  EXPECT_EQ(1, s.nfallbacks());
+  EXPECT_TRUE(g.matches().empty());
+
+  // the mock can't be copied, so neither can the solver
+  EXPECT_TRUE(s.Clone() == NULL);
+
+  FlowSolver strict(false, NULL);
+  EXPECT_THROW(strict.Solve(&g), cyclus::ValueError);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(FlowSolverTests, Exclusive) {
+  ExchangeGraph g;
+  ExchangeNode::Ptr r(new ExchangeNode(1, true, "commod", 1));
+  RequestGroup::Ptr gr(new RequestGroup(1));
+  gr->AddExchangeNode(r);
+  gr->AddCapacity(1);
+  g.AddRequestGroup(gr);
+  ExchangeNode::Ptr v = AddSupply(&g, 1, 2);
+  AddArc(&g, r, v, 1);
+
+  FlowSolver excl(true, new MockSolver());
+  EXPECT_FALSE(excl.IsTransportation(&g));
+  FlowSolver nonexcl(false, new MockSolver());
+  EXPECT_TRUE(nonexcl.IsTransportation(&g));
+}
@@ -0,0 +1,174 @@
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "exchange_graph.h"
+#include "graph_dump.h"
+#include "greedy_solver.h"
+
+using cyclus::Arc;
+using cyclus::ExchangeGraph;
+using cyclus::ExchangeNode;
+using cyclus::ExchangeNodeGroup;
+using cyclus::RequestGroup;
+
+namespace {
+
+// two requesters, one exclusive, and two suppliers, one with an exclusive
+// group of bids
+ExchangeGraph::Ptr MakeGraph() {
+  ExchangeGraph::Ptr g(new ExchangeGraph());
+  ExchangeNode::Ptr u1(new ExchangeNode(3, false, "fuel", 1));
+  ExchangeNode::Ptr u2(new ExchangeNode(2, true, "fuel", 2));
+  RequestGroup::Ptr r1(new RequestGroup(3));
+  r1->AddExchangeNode(u1);
+  r1->AddCapacity(3);
+  RequestGroup::Ptr r2(new RequestGroup(2));
+  r2->AddExchangeNode(u2);
+  r2->AddCapacity(2);
+  g->AddRequestGroup(r1);
+  g->AddRequestGroup(r2);
+
+  ExchangeNode::Ptr v1(new ExchangeNode(4, false, "fuel", 3));
+  ExchangeNode::Ptr v2(new ExchangeNode(2, true, "fuel", 4));
+  ExchangeNode::Ptr v3(new ExchangeNode(2, true, "fuel", 4));
+  ExchangeNodeGroup::Ptr s1(new ExchangeNodeGroup());
+  s1->AddExchangeNode(v1);
+  s1->AddCapacity(4);
+  ExchangeNodeGroup::Ptr s2(new ExchangeNodeGroup());
+  s2->AddExchangeNode(v2);
+  s2->AddExchangeNode(v3);
+  std::vector<ExchangeNode::Ptr> excl;
+  excl.push_back(v2);
+  excl.push_back(v3);
+  s2->AddExclGroup(excl);
+  s2->AddCapacity(2);
+  g->AddSupplyGroup(s1);
+  g->AddSupplyGroup(s2);
+
+  ExchangeNode::Ptr us[] = {u1, u1, u2, u2};
+  ExchangeNode::Ptr vs[] = {v1, v2, v1, v3};
+  for (int i = 0; i < 4; ++i) {
+    Arc a(us[i], vs[i]);
+    a.pref(i + 1);
+    us[i]->prefs[a] = i + 1;
+    us[i]->unit_capacities[a].push_back(1);
+    vs[i]->unit_capacities[a].push_back(1);
+    g->AddArc(a);
+  }
+  return g;
+}
+
+}  // namespace
+
+TEST(GraphDumpTests, RoundTrip) {
+  ExchangeGraph::Ptr g = MakeGraph();
+  std::stringstream ss;
+  cyclus::DumpGraph(ss, 7, "Material", *g);
+  cyclus::DumpGraph(ss, 8, "Product", *g);
+
+  int time;
+  std::string restype;
+  ExchangeGraph::Ptr loaded;
+  ASSERT_TRUE(cyclus::LoadGraph(ss, &time, &restype, &loaded));
+  EXPECT_EQ(7, time);
+  EXPECT_EQ("Material", restype);
+  EXPECT_TRUE(loaded->SameProblem(*g));
+  ASSERT_EQ(2, loaded->supply_groups().size());
+  EXPECT_EQ(1, loaded->supply_groups()[1]->excl_node_groups().size());
+  EXPECT_EQ(1, loaded->request_groups()[1]->excl_node_groups().size());
+  EXPECT_EQ("fuel", loaded->arcs()[0].unode()->commod);
+
+  cyclus::GreedySolver s1(false);
+  cyclus::GreedySolver s2(false);
+  EXPECT_DOUBLE_EQ(s1.Solve(g.get()), s2.Solve(loaded.get()));
+  EXPECT_EQ(g->matches().size(), loaded->matches().size());
+
+  ASSERT_TRUE(cyclus::LoadGraph(ss, &time, &restype, &loaded));
+  EXPECT_EQ(8, time);
+  EXPECT_EQ("Product", restype);
+  EXPECT_FALSE(cyclus::LoadGraph(ss, &time, &restype, &loaded));
+}
+
+TEST(GraphDumpTests, BadInput) {
+  int time;
+  std::string restype;
+  ExchangeGraph::Ptr g;
+  std::stringstream junk("not a graph");
+  EXPECT_THROW(cyclus::LoadGraph(junk, &time, &restype, &g),
+               cyclus::IOError);
+
+  std::stringstream ss;
+  cyclus::DumpGraph(ss, 1, "Material", *MakeGraph());
+  std::stringstream cut(ss.str().substr(0, ss.str().size() / 2));
+  EXPECT_THROW(cyclus::LoadGraph(cut, &time, &restype, &g), cyclus::IOError);
+}
+
+TEST(GraphDumpTests, Matches) {
+  ExchangeGraph::Ptr g = MakeGraph();
+  cyclus::GreedySolver s(false);
+  s.Solve(g.get());
+  ASSERT_FALSE(g->matches().empty());
+  std::stringstream ss;
+  cyclus::DumpGraph(ss, 3, "Material", *g);
+  cyclus::DumpMatches(ss, *g);
+  cyclus::DumpGraph(ss, 4, "Material", *g);
+
+  int time;
+  std::string restype;
+  ExchangeGraph::Ptr loaded;
+  ASSERT_TRUE(cyclus::LoadGraph(ss, &time, &restype, &loaded));
+  ASSERT_EQ(g->matches().size(), loaded->matches().size());
+  for (int i = 0; i < g->matches().size(); ++i) {
+    EXPECT_EQ(g->arc_ids()[g->matches()[i].first],
+              loaded->arc_ids()[loaded->matches()[i].first]);
+    EXPECT_DOUBLE_EQ(g->matches()[i].second, loaded->matches()[i].second);
+  }
+
+  // graphs dumped without their matches load unmatched
+  ASSERT_TRUE(cyclus::LoadGraph(ss, &time, &restype, &loaded));
+  EXPECT_EQ(4, time);
+  EXPECT_TRUE(loaded->matches().empty());
+  EXPECT_FALSE(cyclus::LoadGraph(ss, &time, &restype, &loaded));
+}
+
+TEST(GraphDumpTests, Commodities) {
+  // a requester of water, which the first supplier also offers
+  ExchangeGraph::Ptr g = MakeGraph();
+  ExchangeNode::Ptr u(new ExchangeNode(1, false, "water", 5));
+  RequestGroup::Ptr r(new RequestGroup(1));
+  r->AddExchangeNode(u);
+  r->AddCapacity(1);
+  g->AddRequestGroup(r);
+  ExchangeNode::Ptr v(new ExchangeNode(1, false, "water", 3));
+  g->supply_groups()[0]->AddExchangeNode(v);
+  Arc a(u, v);
+  a.pref(1);
+  u->prefs[a] = 1;
+  u->unit_capacities[a].push_back(1);
+  v->unit_capacities[a].push_back(1);
+  g->AddArc(a);
+  cyclus::GreedySolver s(false);
+  s.Solve(g.get());
+
+  std::set<std::string> commods;
+  commods.insert("water");
+  std::stringstream ss;
+  cyclus::DumpGraph(ss, 1, "Material", *g, commods);
+  cyclus::DumpMatches(ss, *g, commods);
+
+  int time;
+  std::string restype;
+  ExchangeGraph::Ptr loaded;
+  ASSERT_TRUE(cyclus::LoadGraph(ss, &time, &restype, &loaded));
+  ASSERT_EQ(1, loaded->request_groups().size());
+  ASSERT_EQ(1, loaded->supply_groups().size());
+  EXPECT_EQ(1, loaded->supply_groups()[0]->nodes().size());
+  EXPECT_EQ(4, loaded->supply_groups()[0]->capacities()[0]);
+  ASSERT_EQ(1, loaded->arcs().size());
+  EXPECT_EQ("water", loaded->arcs()[0].vnode()->commod);
+  ASSERT_EQ(1, loaded->matches().size());
+  EXPECT_DOUBLE_EQ(1, loaded->matches()[0].second);
+}
@@ -135,3 +135,31 @@ TEST(ConditionerTests, Conditioning) {
   EXPECT_EQ(g.request_groups().at(1)->nodes().at(1), n11);
   EXPECT_EQ(g.request_groups().at(1)->nodes().at(2), n13);
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(ConditionerTests, TiesKeepOrder) {
+  ExchangeGraph g;
+  std::map<std::string, double> weights;
+  weights["eggs"] = 1;
+  weights["spam"] = 1;
+  GreedyPreconditioner gp(weights);
+
+  std::vector<ExchangeNode::Ptr> exp;
+  RequestGroup::Ptr g1(new RequestGroup());
+  for (int i = 0; i != 4; i++) {
+    ExchangeNode::Ptr n(new ExchangeNode());
+    n->commod = i % 2 == 0 ? "eggs" : "spam";
+    g1->AddExchangeNode(n);
+    exp.push_back(n);
+  }
+  RequestGroup::Ptr g2(new RequestGroup());
+  g.AddRequestGroup(g1);
+  g.AddRequestGroup(g2);
+
+  // every node weighs the same, so the nodes keep their order
+  gp.Condition(&g);
+  EXPECT_EQ(exp, g1->nodes());
+  ASSERT_EQ(2, g.request_groups().size());
+  EXPECT_EQ(g1, g.request_groups()[0]);
+  EXPECT_EQ(g2, g.request_groups()[1]);
+}
@@ -1,3 +1,4 @@
+#include <boost/math/special_functions/next.hpp>
 #include <gtest/gtest.h>
 
 #include "exchange_graph.h"
@@ -83,3 +84,170 @@ TEST(GreedySolverTests, General) {
   EXPECT_EQ(g.request_groups()[1], gu1);
   EXPECT_EQ(g.request_groups()[0], gu2);
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// builds n independent copies of a request for 2 supplied by two bidders with
+// capacities of 1 and 1.5
+void BuildIndependentExchanges(ExchangeGraph* g, int n) {
+  for (int i = 0; i < n; i++) {
+    ExchangeNode::Ptr u(new ExchangeNode(2.0, false, "commod", i));
+    ExchangeNode::Ptr v(new ExchangeNode(1.0, false, "commod", 100 + i));
+    ExchangeNode::Ptr w(new ExchangeNode(1.5, false, "commod", 200 + i));
+    Arc a(u, v);
+    Arc b(u, w);
+    u->prefs[a] = 1 + i;
+    u->prefs[b] = 2;
+    a.pref(1 + i);
+    b.pref(2);
+
+    RequestGroup::Ptr req(new RequestGroup(2.0));
+    req->AddExchangeNode(u);
+    g->AddRequestGroup(req);
+    ExchangeNodeGroup::Ptr sv(new ExchangeNodeGroup());
+    sv->AddExchangeNode(v);
+    g->AddSupplyGroup(sv);
+    ExchangeNodeGroup::Ptr sw(new ExchangeNodeGroup());
+    sw->AddExchangeNode(w);
+    g->AddSupplyGroup(sw);
+    g->AddArc(a);
+    g->AddArc(b);
+  }
+}
+
+TEST(GreedySolverTests, Decomposed) {
+  int n = 8;
+  ExchangeGraph whole, parts;
+  BuildIndependentExchanges(&whole, n);
+  BuildIndependentExchanges(&parts, n);
+  ASSERT_EQ(n, parts.Components().size());
+
+  GreedySolver s(false);
+  s.decompose(false);
+  double obj = s.Solve(&whole);
+
+  GreedySolver t(false);
+  t.threads(4);
+  EXPECT_DOUBLE_EQ(obj, t.Solve(&parts));
+
+  // matches agree up to their order
+  std::map<std::pair<int, int>, double> wm, pm;
+  for (int i = 0; i < whole.matches().size(); i++) {
+    const Arc& a = whole.matches()[i].first;
+    wm[std::make_pair(a.unode()->agent_id, a.vnode()->agent_id)] =
+        whole.matches()[i].second;
+  }
+  for (int i = 0; i < parts.matches().size(); i++) {
+    const Arc& a = parts.matches()[i].first;
+    pm[std::make_pair(a.unode()->agent_id, a.vnode()->agent_id)] =
+        parts.matches()[i].second;
+  }
+  EXPECT_EQ(2 * n, wm.size());
+  EXPECT_EQ(wm, pm);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(GreedySolverTests, Partitioned) {
+  // requesters 1 and 3 and bidders 2 and 4 in regions 10 (1, 2) and 20 (3,
+  // 4), with the most preferred arc between regions
+  ExchangeNode::Ptr u1(new ExchangeNode(10.0, false, "commod", 1));
+  ExchangeNode::Ptr v2(new ExchangeNode(5.0, false, "commod", 2));
+  ExchangeNode::Ptr u3(new ExchangeNode(5.0, false, "commod", 3));
+  ExchangeNode::Ptr v4(new ExchangeNode(10.0, false, "commod", 4));
+  Arc a12(u1, v2);
+  Arc a34(u3, v4);
+  Arc a14(u1, v4);
+  u1->prefs[a12] = 1;
+  u3->prefs[a34] = 1;
+  u1->prefs[a14] = 10;
+  a12.pref(1);
+  a34.pref(1);
+  a14.pref(10);
+
+  ExchangeGraph g;
+  RequestGroup::Ptr r1(new RequestGroup(10.0));
+  r1->AddExchangeNode(u1);
+  g.AddRequestGroup(r1);
+  RequestGroup::Ptr r3(new RequestGroup(5.0));
+  r3->AddExchangeNode(u3);
+  g.AddRequestGroup(r3);
+  ExchangeNodeGroup::Ptr s2(new ExchangeNodeGroup());
+  s2->AddExchangeNode(v2);
+  s2->AddCapacity(5.0);
+  v2->unit_capacities[a12].push_back(1);
+  g.AddSupplyGroup(s2);
+  ExchangeNodeGroup::Ptr s4(new ExchangeNodeGroup());
+  s4->AddExchangeNode(v4);
+  g.AddSupplyGroup(s4);
+  g.AddArc(a12);
+  g.AddArc(a34);
+  g.AddArc(a14);
+
+  std::map<int, int> regions;
+  regions[1] = 10;
+  regions[2] = 10;
+  regions[3] = 20;
+  regions[4] = 20;
+
+  // each region trades within itself first, and the trade between them gets
+  // what is left
+  GreedySolver s(false);
+  s.SolvePartitioned(&g, regions);
+  std::map<std::pair<int, int>, double> flows;
+  for (int i = 0; i < g.matches().size(); i++) {
+    const Arc& a = g.matches()[i].first;
+    flows[std::make_pair(a.unode()->agent_id, a.vnode()->agent_id)] +=
+        g.matches()[i].second;
+  }
+  EXPECT_EQ(3, flows.size());
+  EXPECT_DOUBLE_EQ(5, flows[std::make_pair(1, 2)]);
+  EXPECT_DOUBLE_EQ(5, flows[std::make_pair(3, 4)]);
+  EXPECT_DOUBLE_EQ(5, flows[std::make_pair(1, 4)]);
+
+  // and the graph is left as it was
+  EXPECT_DOUBLE_EQ(10, u1->qty);
+  EXPECT_DOUBLE_EQ(10, v4->qty);
+  EXPECT_DOUBLE_EQ(10, r1->qty());
+  EXPECT_DOUBLE_EQ(5, s2->capacities()[0]);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(GreedySolverTests, ExclusiveFloor) {
+  // an exclusive request for 1 that its preferred bidder falls short of by
+  // 1e-6, and the other by a single ulp, which is treated as enough
+  ExchangeNode::Ptr u(new ExchangeNode(1.0, true, "commod", 1));
+  ExchangeNode::Ptr short_v(new ExchangeNode(5.0, false, "commod", 2));
+  ExchangeNode::Ptr ulp_v(new ExchangeNode(5.0, false, "commod", 3));
+  Arc a(u, short_v);
+  Arc b(u, ulp_v);
+  u->prefs[a] = 2;
+  u->prefs[b] = 1;
+  a.pref(2);
+  b.pref(1);
+  u->unit_capacities[a].push_back(1);
+  u->unit_capacities[b].push_back(1);
+  short_v->unit_capacities[a].push_back(1);
+  ulp_v->unit_capacities[b].push_back(1);
+
+  RequestGroup::Ptr req(new RequestGroup(1.0));
+  req->AddExchangeNode(u);
+  req->AddCapacity(1);
+  ExchangeNodeGroup::Ptr sv(new ExchangeNodeGroup());
+  sv->AddExchangeNode(short_v);
+  sv->AddCapacity(1 - 1e-6);
+  ExchangeNodeGroup::Ptr uv(new ExchangeNodeGroup());
+  uv->AddExchangeNode(ulp_v);
+  uv->AddCapacity(boost::math::float_prior(1.0));
+
+  ExchangeGraph g;
+  g.AddRequestGroup(req);
+  g.AddSupplyGroup(sv);
+  g.AddSupplyGroup(uv);
+  g.AddArc(a);
+  g.AddArc(b);
+
+  GreedySolver s(true);
+  s.Solve(&g);
+  ASSERT_EQ(1, g.matches().size());
+  EXPECT_EQ(ulp_v, g.matches()[0].first.vnode());
+  EXPECT_EQ(1.0, g.matches()[0].second);
+}
@@ -10,6 +10,7 @@
 #include "hdf5.h"
 #include "hdf5_back.h"
 #include "hdf5_hl.h"
+#include "table_writer.h"
 #include "tools.h"
 
 static const char* path = "testdb.h5";
@@ -254,3 +255,861 @@ TEST(Hdf5BackTest, Tables) {
   EXPECT_LE(1, tabs.size());
   EXPECT_EQ(1, tabs.count("IntTable"));
 }
+
+TEST(Hdf5BackTest, IndexedQuery) {
+  using cyclus::Cond;
+  using cyclus::Hdf5Back;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  const char* fname = "indexed.h5";
+  FileDeleter fd(fname);
+
+  // agents 0-2 each record a row at every time 0-9
+  {
+    Recorder m;
+    Hdf5Back back(fname);
+    m.RegisterBackend(&back);
+    for (int t = 0; t < 10; ++t) {
+      for (int a = 0; a < 3; ++a) {
+        m.NewDatum("Inventory")
+            ->AddVal("AgentId", a)
+            ->AddVal("Time", t)
+            ->AddVal("Quantity", 10.0 * t + a)
+            ->Record();
+      }
+      m.Flush();
+    }
+    m.Close();
+  }
+
+  hid_t file = H5Fopen(fname, H5F_ACC_RDONLY, H5P_DEFAULT);
+  EXPECT_LT(0, H5Lexists(file, "CyclusIndexes", H5P_DEFAULT));
+  EXPECT_LT(0, H5Lexists(file, "CyclusIndexes/Inventory:SimId", H5P_DEFAULT));
+  EXPECT_LT(0, H5Lexists(file, "CyclusIndexes/Inventory:AgentId",
+                         H5P_DEFAULT));
+  EXPECT_LT(0, H5Lexists(file, "CyclusIndexes/Inventory:Time", H5P_DEFAULT));
+  EXPECT_EQ(0, H5Lexists(file, "CyclusIndexes/Inventory:Quantity",
+                         H5P_DEFAULT));
+  H5Fclose(file);
+
+  Recorder m;
+  Hdf5Back back(fname);
+  EXPECT_EQ(0, back.Tables().count("CyclusIndexes"));
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", 1));
+  conds.push_back(Cond("Time", ">=", 7));
+  QueryResult qr = back.Query("Inventory", &conds);
+  ASSERT_EQ(3, qr.rows.size());
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    EXPECT_EQ(1, qr.GetVal<int>("AgentId", i));
+    EXPECT_EQ(7 + i, qr.GetVal<int>("Time", i));
+    EXPECT_DOUBLE_EQ(10.0 * (7 + i) + 1, qr.GetVal<double>("Quantity", i));
+  }
+
+  conds[0] = Cond("AgentId", "==", 42);
+  qr = back.Query("Inventory", &conds);
+  EXPECT_EQ(0, qr.rows.size());
+
+  // rows appended after the indexes were written must still be found
+  conds[0] = Cond("AgentId", "==", 1);
+  m.RegisterBackend(&back);
+  m.NewDatum("Inventory")
+      ->AddVal("AgentId", 1)
+      ->AddVal("Time", 10)
+      ->AddVal("Quantity", 101.0)
+      ->Record();
+  m.Flush();
+  qr = back.Query("Inventory", &conds);
+  ASSERT_EQ(4, qr.rows.size());
+  EXPECT_EQ(10, qr.GetVal<int>("Time", 3));
+  m.Close();
+}
+
+TEST(Hdf5BackTest, QueryThreads) {
+  using cyclus::Cond;
+  using cyclus::Hdf5Back;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  const char* fname = "threads.h5";
+  FileDeleter fd(fname);
+
+  // spans several chunks, with variable length values that are read from
+  // their own datasets while decoding
+  Recorder m;
+  Hdf5Back back(fname);
+  cyclus::Hdf5Layout layout;
+  layout.chunk_rows = 1024;  // spread the rows over several chunks
+  back.set_layout("Rows", layout);
+  m.RegisterBackend(&back);
+  int nrows = 2500;
+  for (int i = 0; i < nrows; ++i) {
+    std::stringstream name;
+    name << "row" << i;
+    m.NewDatum("Rows")
+        ->AddVal("Num", i)
+        ->AddVal("Name", name.str())
+        ->Record();
+  }
+  m.Flush();
+
+  EXPECT_EQ(1, back.query_threads());
+  QueryResult serial = back.Query("Rows", NULL);
+  back.set_query_threads(4);
+  EXPECT_EQ(4, back.query_threads());
+  QueryResult threaded = back.Query("Rows", NULL);
+  ASSERT_EQ(nrows, serial.rows.size());
+  ASSERT_EQ(nrows, threaded.rows.size());
+  for (int i = 0; i < nrows; ++i) {
+    EXPECT_EQ(i, threaded.GetVal<int>("Num", i));
+    EXPECT_EQ(serial.GetVal<std::string>("Name", i),
+              threaded.GetVal<std::string>("Name", i));
+  }
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("Num", ">=", 1000));
+  conds.push_back(Cond("Name", "!=", std::string("row1500")));
+  threaded = back.Query("Rows", &conds);
+  ASSERT_EQ(1499, threaded.rows.size());
+  EXPECT_EQ(1000, threaded.GetVal<int>("Num", 0));
+  EXPECT_EQ(1501, threaded.GetVal<int>("Num", 500));
+
+  back.set_query_threads(0);
+  EXPECT_EQ(1, back.query_threads());
+  m.Close();
+}
+
+TEST(Hdf5BackTest, Aggregate) {
+  using cyclus::Agg;
+  using cyclus::Cond;
+  using cyclus::Hdf5Back;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  const char* fname = "aggregate.h5";
+  FileDeleter fd(fname);
+
+  Recorder m;
+  Hdf5Back back(fname);
+  cyclus::Hdf5Layout layout;
+  layout.chunk_rows = 256;  // spread the rows over several chunks
+  back.set_layout("Rows", layout);
+  back.set_query_threads(4);
+  m.RegisterBackend(&back);
+  int nrows = 2500;
+  for (int i = 0; i < nrows; ++i) {
+    m.NewDatum("Rows")
+        ->AddVal("Num", i)
+        ->AddVal("Name", std::string(i % 3 == 0 ? "fizz" : "buzz"))
+        ->AddVal("Qty", 0.25 * i)
+        ->Record();
+  }
+  m.Flush();
+
+  std::vector<Agg> aggs;
+  aggs.push_back(Agg("count"));
+  aggs.push_back(Agg("sum", "Qty"));
+  aggs.push_back(Agg("max", "Num"));
+  std::vector<std::string> group_by;
+  group_by.push_back("Name");
+  std::vector<Cond> conds;
+  conds.push_back(Cond("Num", "<", 2000));
+  QueryResult qr = back.Aggregate("Rows", &conds, &group_by, aggs);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ("buzz", qr.GetVal<std::string>("Name", 0));
+  EXPECT_EQ(1333, qr.GetVal<int>("count", 0));
+  EXPECT_EQ(1999, qr.GetVal<int>("max(Num)", 0));
+  EXPECT_EQ("fizz", qr.GetVal<std::string>("Name", 1));
+  EXPECT_EQ(667, qr.GetVal<int>("count", 1));
+  EXPECT_EQ(1998, qr.GetVal<int>("max(Num)", 1));
+  EXPECT_DOUBLE_EQ(0.25 * 1999 * 2000 / 2,
+                   qr.GetVal<double>("sum(Qty)", 0) +
+                   qr.GetVal<double>("sum(Qty)", 1));
+
+  // the same as the generic aggregation of the rows of a cursor
+  QueryResult want = back.QueryableBackend::Aggregate("Rows", &conds,
+                                                      &group_by, aggs);
+  ASSERT_EQ(want.rows.size(), qr.rows.size());
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    EXPECT_EQ(want.GetVal<int>("count", i), qr.GetVal<int>("count", i));
+    EXPECT_DOUBLE_EQ(want.GetVal<double>("sum(Qty)", i),
+                     qr.GetVal<double>("sum(Qty)", i));
+  }
+
+  qr = back.Aggregate("Rows", NULL, NULL, aggs);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(nrows, qr.GetVal<int>("count"));
+  m.Close();
+}
+
+TEST(Hdf5BackTest, Cursor) {
+  using cyclus::Cond;
+  using cyclus::Hdf5Back;
+  using cyclus::QueryCursor;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  const char* fname = "cursor.h5";
+  FileDeleter fd(fname);
+
+  Recorder m;
+  Hdf5Back back(fname);
+  cyclus::Hdf5Layout layout;
+  layout.chunk_rows = 1024;  // spread the rows over several chunks
+  back.set_layout("Rows", layout);
+  m.RegisterBackend(&back);
+  int nrows = 2500;
+  for (int i = 0; i < nrows; ++i) {
+    std::stringstream name;
+    name << "row" << i;
+    m.NewDatum("Rows")
+        ->AddVal("Num", i)
+        ->AddVal("Name", name.str())
+        ->Record();
+  }
+  m.Flush();
+
+  // batches straddle chunk boundaries and are read on several threads
+  back.set_query_threads(2);
+  std::vector<Cond> conds;
+  conds.push_back(Cond("Num", "!=", 1500));
+  std::vector<std::string> fields;
+  fields.push_back("Name");
+  QueryCursor::Ptr cur = back.Cursor("Rows", &conds, &fields);
+  int n = 0;
+  for (QueryResult qr = cur->Next(700); !qr.rows.empty();
+       qr = cur->Next(700)) {
+    EXPECT_EQ(fields, qr.fields);
+    EXPECT_GE(700, qr.rows.size());
+    for (int i = 0; i < qr.rows.size(); ++i, ++n) {
+      std::stringstream name;
+      name << "row" << (n < 1500 ? n : n + 1);
+      EXPECT_EQ(name.str(), qr.GetVal<std::string>("Name", i));
+    }
+  }
+  EXPECT_EQ(nrows - 1, n);
+  EXPECT_EQ(0, cur->Next(700).rows.size());
+
+  fields.push_back("eggs");
+  EXPECT_THROW(back.Cursor("Rows", NULL, &fields), cyclus::KeyError);
+  m.Close();
+}
+
+TEST(Hdf5BackTest, Projection) {
+  using cyclus::Cond;
+  using cyclus::Hdf5Back;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  const char* fname = "projection.h5";
+  FileDeleter fd(fname);
+
+  Recorder m;
+  Hdf5Back back(fname);
+  m.RegisterBackend(&back);
+  for (int i = 0; i < 4; ++i) {
+    m.NewDatum("Proj")
+        ->AddVal("a", i)
+        ->AddVal("b", 2.0 * i)
+        ->AddVal("c", std::string("spam"))
+        ->Record();
+  }
+  m.Flush();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("b", ">=", 4.0));
+  std::vector<std::string> fields;
+  fields.push_back("c");
+  fields.push_back("a");
+  QueryResult qr = back.Query("Proj", &conds, &fields);
+  EXPECT_EQ(fields, qr.fields);
+  ASSERT_EQ(2, qr.types.size());
+  EXPECT_EQ(cyclus::VL_STRING, qr.types[0]);
+  EXPECT_EQ(cyclus::INT, qr.types[1]);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(2, qr.rows[0].size());
+  EXPECT_EQ("spam", qr.GetVal<std::string>("c", 0));
+  EXPECT_EQ(2, qr.GetVal<int>("a", 0));
+  EXPECT_EQ(3, qr.GetVal<int>("a", 1));
+
+  fields.push_back("eggs");
+  EXPECT_THROW(back.Query("Proj", NULL, &fields), cyclus::KeyError);
+  m.Close();
+}
+
+TEST(Hdf5BackTest, Layout) {
+  using cyclus::Hdf5Back;
+  using cyclus::Hdf5Layout;
+  using cyclus::Recorder;
+  const char* fname = "layout.h5";
+  FileDeleter fd(fname);
+
+  {
+    Hdf5Layout fast;
+    fast.deflate = 0;
+    fast.shuffle = false;
+    Recorder m;
+    Hdf5Back back(fname, true, fast);
+    Hdf5Layout big;
+    big.chunk_rows = 4096;
+    big.deflate = 3;
+    big.filter = 32767;  // not a registered filter, so it is skipped
+    back.set_layout("Big", big);
+    EXPECT_EQ(4096, back.layout("Big").chunk_rows);
+    EXPECT_EQ(0, back.layout("Small").deflate);
+    m.RegisterBackend(&back);
+    m.NewDatum("Small")->AddVal("x", 1)->Record();
+    for (int i = 0; i < 100; ++i) {
+      m.NewDatum("Big")->AddVal("x", i)->Record();
+    }
+    m.Close();
+  }
+
+  hid_t file = H5Fopen(fname, H5F_ACC_RDONLY, H5P_DEFAULT);
+  hid_t dset = H5Dopen2(file, "Small", H5P_DEFAULT);
+  hid_t plist = H5Dget_create_plist(dset);
+  hsize_t chunk = 0;
+  H5Pget_chunk(plist, 1, &chunk);
+  EXPECT_EQ(32, chunk);  // sized to the first write
+  EXPECT_EQ(0, H5Pget_nfilters(plist));
+  H5Pclose(plist);
+  H5Dclose(dset);
+
+  dset = H5Dopen2(file, "Big", H5P_DEFAULT);
+  plist = H5Dget_create_plist(dset);
+  H5Pget_chunk(plist, 1, &chunk);
+  EXPECT_EQ(4096, chunk);
+  ASSERT_EQ(2, H5Pget_nfilters(plist));
+  unsigned int flags;
+  size_t nelmts = 1;
+  unsigned int level = 0;
+  EXPECT_EQ(H5Z_FILTER_SHUFFLE, H5Pget_filter2(plist, 0, &flags, &nelmts,
+                                               &level, 0, NULL, NULL));
+  nelmts = 1;
+  EXPECT_EQ(H5Z_FILTER_DEFLATE, H5Pget_filter2(plist, 1, &flags, &nelmts,
+                                               &level, 0, NULL, NULL));
+  EXPECT_EQ(3, level);
+  H5Pclose(plist);
+  H5Dclose(dset);
+  H5Fclose(file);
+
+  Hdf5Back back(fname);
+  cyclus::QueryResult qr = back.Query("Big", NULL);
+  ASSERT_EQ(100, qr.rows.size());
+  EXPECT_EQ(99, qr.GetVal<int>("x", 99));
+}
+
+TEST(Hdf5BackTest, Murmur3Splits) {
+  std::string s = "the quick brown fox jumps over the lazy dog";
+  cyclus::Murmur3 whole;
+  whole.process_bytes(s.c_str(), s.size());
+  cyclus::Murmur3 parts;
+  parts.process_bytes(s.c_str(), 5);
+  parts.process_bytes(s.c_str() + 5, 17);
+  parts.process_bytes(s.c_str() + 22, s.size() - 22);
+  cyclus::Digest a;
+  cyclus::Digest b;
+  whole.get_digest(a.val);
+  parts.get_digest(b.val);
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(s.size(), a.val[4]);
+
+  cyclus::Sha1 h(cyclus::VL_HASH_MURMUR3);
+  h.Update(s);
+  EXPECT_EQ(a, h.digest());
+  h.Clear();
+  h.Update(std::string("the quick brown fox jumps over the lazy cat"));
+  EXPECT_NE(a, h.digest());
+}
+
+TEST(Hdf5BackTest, DigestSet) {
+  cyclus::DigestSet set;
+  cyclus::Sha1 h(cyclus::VL_HASH_MURMUR3);
+  for (int i = 0; i < 1000; ++i) {
+    h.Clear();
+    h.Update(std::vector<int>(1, i));
+    EXPECT_TRUE(set.insert(h.digest()));
+  }
+  EXPECT_EQ(1000, set.size());
+  h.Clear();
+  h.Update(std::vector<int>(1, 999));
+  EXPECT_FALSE(set.insert(h.digest()));
+  EXPECT_EQ(1, set.count(h.digest()));
+  h.Update(std::vector<int>(1, 999));
+  EXPECT_EQ(0, set.count(h.digest()));
+  set.clear();
+  EXPECT_EQ(0, set.size());
+  EXPECT_EQ(0, set.count(h.digest()));
+}
+
+TEST(Hdf5BackTest, VLHash) {
+  using cyclus::Hdf5Back;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  const char* fname = "vlhash.h5";
+  FileDeleter fd(fname);
+
+  {
+    Recorder m;
+    Hdf5Back back(fname);
+    EXPECT_EQ(cyclus::VL_HASH_MURMUR3, back.vl_hash());
+    m.RegisterBackend(&back);
+    m.NewDatum("Names")->AddVal("Name", std::string("spam"))->Record();
+    m.Close();
+  }
+
+  // databases written before the hash was recorded keep using SHA1
+  hid_t file = H5Fopen(fname, H5F_ACC_RDWR, H5P_DEFAULT);
+  H5Adelete(file, "cyclus_vl_hash");
+  H5Fclose(file);
+  {
+    Recorder m;
+    Hdf5Back back(fname);
+    EXPECT_EQ(cyclus::VL_HASH_SHA1, back.vl_hash());
+    m.RegisterBackend(&back);
+    m.NewDatum("Names")->AddVal("Name", std::string("eggs"))->Record();
+    m.NewDatum("Names")->AddVal("Name", std::string("eggs"))->Record();
+    m.Close();
+  }
+
+  Hdf5Back back(fname);
+  EXPECT_EQ(cyclus::VL_HASH_SHA1, back.vl_hash());
+  QueryResult qr = back.Query("Names", NULL);
+  ASSERT_EQ(3, qr.rows.size());
+  EXPECT_EQ("spam", qr.GetVal<std::string>("Name", 0));
+  EXPECT_EQ("eggs", qr.GetVal<std::string>("Name", 1));
+  EXPECT_EQ("eggs", qr.GetVal<std::string>("Name", 2));
+}
+
+TEST(Hdf5BackTest, WriteThreads) {
+  using cyclus::Hdf5Back;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  const char* serial_name = "write_serial.h5";
+  const char* threaded_name = "write_threads.h5";
+  FileDeleter fds(serial_name);
+  FileDeleter fdt(threaded_name);
+
+  // several tables in one flush, sharing variable length values
+  int ntables = 6;
+  int nrows = 200;
+  const char* names[] = {serial_name, threaded_name};
+  for (int f = 0; f < 2; ++f) {
+    Recorder m;
+    Hdf5Back back(names[f]);
+    EXPECT_EQ(1, back.write_threads());
+    back.set_write_threads(f == 0 ? 1 : 4);
+    m.RegisterBackend(&back);
+    for (int i = 0; i < nrows; ++i) {
+      for (int t = 0; t < ntables; ++t) {
+        std::stringstream tbl;
+        std::stringstream name;
+        tbl << "Table" << t;
+        name << "row" << i % 50;
+        std::map<std::string, int> counts;
+        counts[name.str()] = i;
+        counts["total"] = t;
+        m.NewDatum(tbl.str())
+            ->AddVal("Num", i)
+            ->AddVal("Name", name.str())
+            ->AddVal("Counts", counts)
+            ->Record();
+      }
+    }
+    m.Close();
+  }
+
+  Hdf5Back serial(serial_name);
+  Hdf5Back threaded(threaded_name);
+  for (int t = 0; t < ntables; ++t) {
+    std::stringstream tbl;
+    tbl << "Table" << t;
+    QueryResult sqr = serial.Query(tbl.str(), NULL);
+    QueryResult tqr = threaded.Query(tbl.str(), NULL);
+    ASSERT_EQ(nrows, sqr.rows.size());
+    ASSERT_EQ(nrows, tqr.rows.size());
+    for (int i = 0; i < nrows; ++i) {
+      EXPECT_EQ(i, tqr.GetVal<int>("Num", i));
+      EXPECT_EQ(sqr.GetVal<std::string>("Name", i),
+                tqr.GetVal<std::string>("Name", i));
+      typedef std::map<std::string, int> Counts;
+      EXPECT_EQ(sqr.GetVal<Counts>("Counts", i),
+                tqr.GetVal<Counts>("Counts", i));
+    }
+  }
+
+  threaded.set_write_threads(0);
+  EXPECT_EQ(1, threaded.write_threads());
+}
+
+TEST(Hdf5BackTest, Preallocation) {
+  using cyclus::Hdf5Back;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  const char* fname = "prealloc.h5";
+  FileDeleter fd(fname);
+
+  // a table appended to a few rows per flush
+  int nrows = 0;
+  {
+    Recorder m;
+    Hdf5Back back(fname);
+    m.RegisterBackend(&back);
+    for (int f = 0; f < 20; ++f) {
+      for (int i = 0; i < 3; ++i, ++nrows) {
+        m.NewDatum("Hot")->AddVal("Num", nrows)->Record();
+      }
+      m.Flush();
+      QueryResult qr = back.Query("Hot", NULL);
+      ASSERT_EQ(nrows, qr.rows.size());
+      EXPECT_EQ(nrows - 1, qr.GetVal<int>("Num", nrows - 1));
+    }
+    m.Close();
+  }
+
+  // the extent is trimmed to the rows written
+  hid_t file = H5Fopen(fname, H5F_ACC_RDONLY, H5P_DEFAULT);
+  hid_t dset = H5Dopen2(file, "Hot", H5P_DEFAULT);
+  hid_t dspace = H5Dget_space(dset);
+  EXPECT_EQ(nrows, H5Sget_simple_extent_npoints(dspace));
+  H5Sclose(dspace);
+  H5Dclose(dset);
+  H5Fclose(file);
+
+  // and appending to it again continues after the last row
+  {
+    Recorder m;
+    Hdf5Back back(fname);
+    m.RegisterBackend(&back);
+    m.NewDatum("Hot")->AddVal("Num", nrows)->Record();
+    m.Close();
+  }
+  Hdf5Back back(fname);
+  QueryResult qr = back.Query("Hot", NULL);
+  ASSERT_EQ(nrows + 1, qr.rows.size());
+  for (int i = 0; i <= nrows; ++i) {
+    EXPECT_EQ(i, qr.GetVal<int>("Num", i));
+  }
+}
+
+TEST(Hdf5BackTest, CompactOutput) {
+  using cyclus::Cond;
+  using cyclus::Hdf5Back;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  const char* fname = "compact.h5";
+  FileDeleter fd(fname);
+
+  Recorder m;
+  Hdf5Back back(fname);
+  m.RegisterBackend(&back);
+  cyclus::CoreTables tables(&m, true);
+  tables.resources.Record(5, 5, "Material", 1, 2.5, "kg", 7, 0, 0);
+  tables.resources.Record(8, 5, "Material", 2, 1.5, "kg", 7, 5, 0);
+  tables.transactions.Record(1, 20, 30, 8, "fuel", 2);
+  m.Flush();
+
+  std::set<std::string> names = back.Tables();
+  EXPECT_EQ(0, names.count("Resources"));
+  EXPECT_EQ(1, names.count("CompactResources"));
+
+  // the classic tables are rebuilt from the compact ones when queried
+  std::vector<Cond> conds;
+  conds.push_back(Cond("ObjId", "==", 5));
+  conds.push_back(Cond("Parent1", "!=", 0));
+  QueryResult qr = back.Query("Resources", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(8, qr.GetVal<int>("ResourceId"));
+  EXPECT_EQ("Material", qr.GetVal<std::string>("Type"));
+  EXPECT_EQ("kg", qr.GetVal<std::string>("Units"));
+  EXPECT_EQ(5, qr.GetVal<int>("Parent1"));
+  EXPECT_EQ(10, back.ColumnTypes("Resources").size());
+
+  qr = back.Query("Transactions", NULL);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ("fuel", qr.GetVal<std::string>("Commodity"));
+  m.Close();
+}
+
+TEST(Hdf5BackTest, DenseOutput) {
+  using cyclus::Cond;
+  using cyclus::Hdf5Back;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  const char* fname = "dense.h5";
+  FileDeleter fd(fname);
+
+  Recorder m;
+  Hdf5Back back(fname);
+  m.RegisterBackend(&back);
+  cyclus::CoreTables tables(&m, false, true);
+  cyclus::CompMap mass;
+  mass[922350000] = 1.0;
+  mass[922380000] = 3.0;
+  tables.explicit_inventory.Record(7, 1, "core", mass);
+  tables.explicit_inventory.Record(8, 1, "core", mass);
+  tables.compositions.Record(2, std::vector<cyclus::Nuc>(1, 922380000),
+                             std::vector<double>(1, 1.0));
+  m.Flush();
+
+  EXPECT_EQ(0, back.Tables().count("ExplicitInventory"));
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", 8));
+  conds.push_back(Cond("NucId", "==", 922380000));
+  QueryResult qr = back.Query("ExplicitInventory", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_DOUBLE_EQ(3.0, qr.GetVal<double>("Quantity"));
+  EXPECT_EQ(6, back.ColumnTypes("ExplicitInventory").size());
+
+  qr = back.Query("Compositions", NULL);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(922380000, qr.GetVal<int>("NucId"));
+  m.Close();
+}
+
+TEST(Hdf5BackTest, Swmr) {
+  using cyclus::Hdf5Back;
+  using cyclus::Hdf5Layout;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  const char* fname = "swmr.h5";
+  FileDeleter fd(fname);
+
+  {
+    Recorder m;
+    Hdf5Back back(fname, true, Hdf5Layout(), cyclus::HDF5_SWMR_WRITE);
+    m.RegisterBackend(&back);
+    m.NewDatum("Early")->AddVal("x", 1)->AddVal("s", std::string("a"))
+        ->Record();
+    m.Flush();  // starts SWMR writing
+    for (int i = 0; i < 10; ++i) {
+      m.NewDatum("Early")->AddVal("x", i)->AddVal("s", std::string("b"))
+          ->Record();
+      m.NewDatum("Late")->AddVal("y", i)->Record();
+      m.Flush();
+    }
+    QueryResult qr = back.Query("Late", NULL);
+    ASSERT_EQ(10, qr.rows.size());
+    m.Close();
+  }
+
+  Hdf5Back back(fname, false, Hdf5Layout(), cyclus::HDF5_SWMR_READ);
+  EXPECT_EQ(cyclus::HDF5_SWMR_READ, back.mode());
+  QueryResult qr = back.Query("Early", NULL);
+  ASSERT_EQ(11, qr.rows.size());
+  EXPECT_EQ("a", qr.GetVal<std::string>("s", 0));
+  EXPECT_EQ(9, qr.GetVal<int>("x", 10));
+  qr = back.Query("Late", NULL);
+  EXPECT_EQ(10, qr.rows.size());
+}
+
+TEST(Hdf5BackTest, VLCache) {
+  using cyclus::Hdf5Back;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  const char* fname = "vlcache.h5";
+  FileDeleter fd(fname);
+
+  typedef std::map<std::string, int> Counts;
+  int nrows = 300;
+  {
+    Recorder m;
+    Hdf5Back back(fname);
+    m.RegisterBackend(&back);
+    for (int i = 0; i < nrows; ++i) {
+      std::stringstream name;
+      name << "name" << i % 7;
+      Counts counts;
+      counts[name.str()] = i % 3;
+      m.NewDatum("Table")
+          ->AddVal("Num", i)
+          ->AddVal("Name", name.str())
+          ->AddVal("Counts", counts)
+          ->Record();
+    }
+    m.Close();
+  }
+
+  Hdf5Back back(fname);
+  EXPECT_EQ(Hdf5Back::kDefaultVLCacheSize, back.vl_cache_size());
+  back.set_query_threads(3);
+  QueryResult qr = back.Query("Table", NULL);
+  ASSERT_EQ(nrows, qr.rows.size());
+  // the distinct values of each chunk are read once, and then found by its
+  // rows
+  uint64_t misses = back.vl_cache_misses();
+  EXPECT_GT(back.vl_cache_hits(), 2 * nrows - misses);
+  for (int i = 0; i < nrows; ++i) {
+    std::stringstream name;
+    name << "name" << i % 7;
+    EXPECT_EQ(name.str(), qr.GetVal<std::string>("Name", i));
+    EXPECT_EQ(i % 3, qr.GetVal<Counts>("Counts", i)[name.str()]);
+  }
+
+  // later queries find every value decoded
+  back.Query("Table", NULL);
+  EXPECT_EQ(misses, back.vl_cache_misses());
+
+  // and without the cache values are read as they are needed
+  Hdf5Back uncached(fname);
+  uncached.set_vl_cache_size(0);
+  QueryResult uqr = uncached.Query("Table", NULL);
+  EXPECT_EQ(0, uncached.vl_cache_hits());
+  ASSERT_EQ(nrows, uqr.rows.size());
+  for (int i = 0; i < nrows; ++i) {
+    EXPECT_EQ(qr.GetVal<std::string>("Name", i),
+              uqr.GetVal<std::string>("Name", i));
+    EXPECT_EQ(qr.GetVal<Counts>("Counts", i), uqr.GetVal<Counts>("Counts", i));
+  }
+
+  // a cache smaller than the distinct values of a chunk still reads them
+  back.set_vl_cache_size(4);
+  qr = back.Query("Table", NULL);
+  ASSERT_EQ(nrows, qr.rows.size());
+  EXPECT_EQ("name6", qr.GetVal<std::string>("Name", 6));
+}
+
+TEST(Hdf5BackTest, AdaptiveWidth) {
+  using cyclus::Hdf5Back;
+  using cyclus::Hdf5Layout;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  const char* fname = "adaptive.h5";
+  FileDeleter fd(fname);
+
+  std::string longer(100, 'x');
+  std::string overflow(40, 'y');
+  {
+    Hdf5Layout l;
+    l.adaptive_width = 64;
+    Recorder m;
+    Hdf5Back back(fname, true, l);
+    m.RegisterBackend(&back);
+    for (int i = 0; i < 10; ++i) {
+      std::vector<int> shape(1, 4);
+      m.NewDatum("Table")
+          ->AddVal("Num", i)
+          ->AddVal("Name", "name" + std::to_string(i))
+          ->AddVal("Long", longer)
+          ->AddVal("Shaped", std::string("abcd"), &shape)
+          ->Record();
+    }
+    m.Flush();
+
+    // strings of up to 6 characters fit in 16, and those of 100 don't fit
+    // in 64
+    std::map<std::string, cyclus::DbTypes> types = back.ColumnTypes("Table");
+    EXPECT_EQ(cyclus::STRING, types["Name"]);
+    EXPECT_EQ(cyclus::VL_STRING, types["Long"]);
+    EXPECT_EQ(cyclus::STRING, types["Shaped"]);
+
+    // a longer name has the table rewritten with variable length names
+    for (int i = 10; i < 20; ++i) {
+      std::vector<int> shape(1, 4);
+      m.NewDatum("Table")
+          ->AddVal("Num", i)
+          ->AddVal("Name", i == 15 ? overflow : "name" + std::to_string(i))
+          ->AddVal("Long", longer)
+          ->AddVal("Shaped", std::string("abcd"), &shape)
+          ->Record();
+    }
+    m.Close();
+  }
+
+  Hdf5Back back(fname);
+  std::map<std::string, cyclus::DbTypes> types = back.ColumnTypes("Table");
+  EXPECT_EQ(cyclus::VL_STRING, types["Name"]);
+  EXPECT_EQ(cyclus::STRING, types["Shaped"]);
+  QueryResult qr = back.Query("Table", NULL);
+  ASSERT_EQ(20, qr.rows.size());
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ(i, qr.GetVal<int>("Num", i));
+    EXPECT_EQ(i == 15 ? overflow : "name" + std::to_string(i),
+              qr.GetVal<std::string>("Name", i));
+    EXPECT_EQ(longer, qr.GetVal<std::string>("Long", i));
+    EXPECT_EQ("abcd", qr.GetVal<std::string>("Shaped", i));
+  }
+}
+
+TEST(Hdf5BackTest, Shards) {
+  using cyclus::Hdf5Back;
+  using cyclus::Hdf5Shards;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  // the master is read from elsewhere than the directory of its shards
+  FileDeleter dir("shards");
+  boost::filesystem::create_directory("shards");
+  FileDeleter fd("shards/out.h5");
+  FileDeleter fd0("shards/out.shard0.h5");
+  FileDeleter fd1("shards/out.shard1.h5");
+  FileDeleter fd2("shards/out.shard2.h5");
+
+  typedef std::map<std::string, int> Counts;
+  int nrows[] = {30, 0, 17};
+  {
+    Hdf5Shards shards("shards/out.h5");
+    for (int s = 0; s < 3; ++s) {
+      Recorder m;
+      m.RegisterBackend(shards.NewShard());
+      for (int i = 0; i < nrows[s]; ++i) {
+        std::stringstream name;
+        name << "name" << (s + i) % 5;
+        Counts counts;
+        counts[name.str()] = s;
+        m.NewDatum("Table")
+            ->AddVal("Shard", s)
+            ->AddVal("Num", i)
+            ->AddVal("Name", name.str())
+            ->AddVal("Counts", counts)
+            ->Record();
+      }
+      m.NewDatum("Only" + std::to_string(s))->AddVal("Shard", s)->Record();
+      m.Close();
+    }
+    ASSERT_EQ(3, shards.shards().size());
+    EXPECT_EQ("shards/out.shard2.h5", shards.shards()[2]);
+    shards.Close();
+  }
+
+  {
+    Hdf5Back back("shards/out.h5");
+    std::set<std::string> tables = back.Tables();
+    EXPECT_EQ(1, tables.count("Table"));
+    EXPECT_EQ(1, tables.count("Only1"));
+    QueryResult qr = back.Query("Table", NULL);
+    ASSERT_EQ(nrows[0] + nrows[2], qr.rows.size());
+    int row = 0;
+    for (int s = 0; s < 3; ++s) {
+      for (int i = 0; i < nrows[s]; ++i, ++row) {
+        std::stringstream name;
+        name << "name" << (s + i) % 5;
+        EXPECT_EQ(s, qr.GetVal<int>("Shard", row));
+        EXPECT_EQ(i, qr.GetVal<int>("Num", row));
+        EXPECT_EQ(name.str(), qr.GetVal<std::string>("Name", row));
+        EXPECT_EQ(s, qr.GetVal<Counts>("Counts", row)[name.str()]);
+      }
+    }
+    std::vector<cyclus::Cond> conds;
+    conds.push_back(cyclus::Cond("Name", "==", std::string("name3")));
+    qr = back.Query("Table", &conds);
+    EXPECT_EQ(10, qr.rows.size());
+    EXPECT_EQ(2, back.Query("Only2", NULL).GetVal<int>("Shard"));
+  }
+
+  // shards whose tables differ aren't merged
+  {
+    Recorder m;
+    Hdf5Back b0("shards/out.shard0.h5");
+    m.RegisterBackend(&b0);
+    m.NewDatum("Odd")->AddVal("X", 1)->Record();
+    m.Close();
+  }
+  {
+    Recorder m;
+    Hdf5Back b1("shards/out.shard1.h5");
+    m.RegisterBackend(&b1);
+    m.NewDatum("Odd")->AddVal("X", 1.5)->Record();
+    m.Close();
+  }
+  std::vector<std::string> paths;
+  paths.push_back("shards/out.shard0.h5");
+  paths.push_back("shards/out.shard1.h5");
+  EXPECT_THROW(Hdf5Back::MergeShards("shards/out.h5", paths),
+               cyclus::IOError);
+}
@@ -0,0 +1,93 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "context.h"
+#include "hw_counters.h"
+#include "recorder.h"
+#include "timer.h"
+
+using cyclus::Context;
+using cyclus::CounterSpan;
+using cyclus::HwCounters;
+
+namespace {
+
+class RowBack : public cyclus::RecBackend {
+ public:
+  virtual void Notify(cyclus::DatumList data) {
+    for (int i = 0; i < data.size(); ++i) {
+      if (data[i]->title() == "HardwareCounters")
+        rows.push_back(data[i]->vals());
+    }
+  }
+  virtual std::string Name() { return "RowBack"; }
+  virtual void Flush() {}
+  virtual void Close() {}
+
+  std::vector<cyclus::Datum::Vals> rows;
+};
+
+// keeps the loop below from being optimized away
+volatile double sink;
+
+}  // namespace
+
+TEST(HwCountersTests, ByPhase) {
+  cyclus::Timer ti;
+  cyclus::Recorder rec;
+  RowBack back;
+  rec.RegisterBackend(&back);
+  Context ctx(&ti, &rec);
+  EXPECT_EQ(NULL, ctx.hw_counters());
+  ctx.count_hardware(true);
+  HwCounters* hw = ctx.hw_counters();
+  ASSERT_TRUE(hw != NULL);
+
+  for (int i = 0; i < 3; ++i) {
+    CounterSpan span(hw, "timer", "Tick");
+    double x = 0;
+    for (int j = 0; j < 100000; ++j)
+      x += j * 0.5;
+    sink = x;
+  }
+  {
+    CounterSpan span(hw, "dre", "Solve");
+  }
+  {
+    CounterSpan span(NULL, "dre", "Solve");
+  }
+
+  std::map<std::pair<std::string, std::string>, HwCounters::Total> totals =
+      hw->totals();
+  ASSERT_EQ(2, totals.size());
+  HwCounters::Total tick = totals[std::make_pair(std::string("timer"),
+                                                 std::string("Tick"))];
+  EXPECT_EQ(3, tick.calls);
+  EXPECT_LT(0, tick.seconds);
+  if (hw->available()) {
+    EXPECT_LT(100000, tick.values.instructions);
+    EXPECT_LT(0, tick.values.cycles);
+  } else {
+    EXPECT_EQ(0, tick.values.instructions);
+  }
+  EXPECT_EQ(1, (totals[std::make_pair(std::string("dre"),
+                                      std::string("Solve"))].calls));
+
+  hw->Record(&ctx);
+  rec.Flush();
+  ASSERT_EQ(2, back.rows.size());
+  EXPECT_EQ("Category", back.rows[0][0].first);
+  EXPECT_EQ("dre", back.rows[0][0].second.cast<std::string>());
+  EXPECT_EQ("Tick", back.rows[1][1].second.cast<std::string>());
+  EXPECT_EQ(3, back.rows[1][2].second.cast<int>());
+
+  std::stringstream ss;
+  hw->Summarize(ss);
+  EXPECT_NE(std::string::npos, ss.str().find("timer/Tick"));
+
+  ctx.count_hardware(false);
+  EXPECT_EQ(NULL, ctx.hw_counters());
+}
@@ -0,0 +1,121 @@
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "context.h"
+#include "id_allocator.h"
+#include "material.h"
+#include "product.h"
+#include "recorder.h"
+#include "timer.h"
+#include "test_agents/test_facility.h"
+
+using cyclus::IdAllocator;
+
+TEST(IdAllocatorTests, KindsAreIndependent) {
+  IdAllocator ids;
+  EXPECT_EQ(0, ids.Next(IdAllocator::AGENT));
+  EXPECT_EQ(1, ids.Next(IdAllocator::AGENT));
+  EXPECT_EQ(1, ids.Next(IdAllocator::RESOURCE_STATE));
+  EXPECT_EQ(1, ids.Next(IdAllocator::RESOURCE_OBJ));
+  EXPECT_EQ(10, ids.Reserve(IdAllocator::RESOURCE_OBJ, 8) + 8);
+  EXPECT_EQ(10, ids.next(IdAllocator::RESOURCE_OBJ));
+  ids.next(IdAllocator::AGENT, 42);
+  EXPECT_EQ(42, ids.Next(IdAllocator::AGENT));
+}
+
+TEST(IdAllocatorTests, Qualities) {
+  IdAllocator ids;
+  bool added = false;
+  EXPECT_EQ(0, ids.QualityId("water"));
+  EXPECT_EQ(1, ids.InternQuality("water", &added));
+  EXPECT_TRUE(added);
+  EXPECT_EQ(1, ids.InternQuality("water", &added));
+  EXPECT_FALSE(added);
+  ids.SetQuality("steam", 7);
+  EXPECT_EQ(7, ids.QualityId("steam"));
+
+  IdAllocator copy;
+  copy.CopyFrom(&ids);
+  EXPECT_EQ(1, copy.QualityId("water"));
+  EXPECT_EQ(ids.next(IdAllocator::PRODUCT_QUALITY),
+            copy.next(IdAllocator::PRODUCT_QUALITY));
+}
+
+TEST(IdAllocatorTests, BlocksAreUnique) {
+  IdAllocator ids;
+  std::vector<std::vector<int> > got(4);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < got.size(); ++t) {
+    workers.push_back(std::thread([&ids, &got, t]() {
+      IdAllocator::Block block(&ids, IdAllocator::RESOURCE_STATE, 16);
+      for (int i = 0; i < 100; ++i) {
+        got[t].push_back(block.Next());
+      }
+    }));
+  }
+  for (int t = 0; t < workers.size(); ++t) {
+    workers[t].join();
+  }
+  std::set<int> all;
+  for (int t = 0; t < got.size(); ++t) {
+    all.insert(got[t].begin(), got[t].end());
+  }
+  EXPECT_EQ(400, all.size());
+}
+
+TEST(IdAllocatorTests, BlockScopes) {
+  IdAllocator ids;
+  IdAllocator other;
+  IdAllocator::Block block(&ids, IdAllocator::RESOURCE_STATE, 4);
+  block.Reserve();
+  EXPECT_EQ(5, ids.next(IdAllocator::RESOURCE_STATE));
+  {
+    IdAllocator::BlockScope scope(&block);
+    EXPECT_EQ(1, ids.Next(IdAllocator::RESOURCE_STATE));
+    EXPECT_EQ(2, ids.Next(IdAllocator::RESOURCE_STATE));
+    // other kinds and allocators are unaffected
+    EXPECT_EQ(1, ids.Next(IdAllocator::RESOURCE_OBJ));
+    EXPECT_EQ(1, other.Next(IdAllocator::RESOURCE_STATE));
+  }
+  EXPECT_EQ(5, ids.Next(IdAllocator::RESOURCE_STATE));
+  EXPECT_EQ(3, block.Next());
+}
+
+TEST(IdAllocatorTests, ContextsNumberIndependently) {
+  cyclus::Timer ti1;
+  cyclus::Recorder rec1;
+  cyclus::Context ctx1(&ti1, &rec1);
+  cyclus::Timer ti2;
+  cyclus::Recorder rec2;
+  cyclus::Context ctx2(&ti2, &rec2);
+
+  TestFacility* a1 = new TestFacility(&ctx1);
+  TestFacility* a2 = new TestFacility(&ctx2);
+  EXPECT_EQ(a1->id(), a2->id());
+
+  cyclus::Material::Ptr m1 = cyclus::Material::Create(
+      a1, 1, cyclus::Composition::CreateFromMass(cyclus::CompMap()));
+  cyclus::Material::Ptr m2 = cyclus::Material::Create(
+      a2, 1, cyclus::Composition::CreateFromMass(cyclus::CompMap()));
+  EXPECT_EQ(m1->state_id(), m2->state_id());
+  EXPECT_EQ(m1->obj_id(), m2->obj_id());
+
+  cyclus::Product::Ptr p1 = cyclus::Product::Create(a1, 1, "bread");
+  cyclus::Product::Create(a2, 1, "cake");
+  cyclus::Product::Ptr p2 = cyclus::Product::Create(a2, 1, "bread");
+  EXPECT_EQ(1, p1->qual_id());
+  EXPECT_EQ(2, p2->qual_id());
+
+  {
+    IdAllocator::Scope scope(&ctx1.ids());
+    int next = ctx1.ids().next(IdAllocator::RESOURCE_STATE);
+    cyclus::Product::Ptr u = cyclus::Product::CreateUntracked(1, "bread");
+    EXPECT_EQ(next, u->state_id());
+    EXPECT_EQ(1, u->qual_id());
+  }
+  EXPECT_EQ(IdAllocator::current(), IdAllocator::current());
+  EXPECT_NE(&ctx1.ids(), IdAllocator::current());
+}
@@ -116,6 +116,21 @@ TEST_F(InfileTreeTest, low_level_queries) {
   EXPECT_EQ(qe2->GetString(content_node_), content_);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(InfileTreeTest, sub_trees) {
+  LoadParser();
+  cyclus::InfileTree engine(*parser_);
+  EXPECT_EQ(engine.SubTrees(content_node_).size(), ncontent_);
+  EXPECT_TRUE(engine.SubTrees("something_silly").empty());
+  std::vector<cyclus::InfileTree*> qes = engine.SubTrees(inner_node_);
+  ASSERT_EQ(qes.size(), 1);
+  EXPECT_EQ(qes[0]->GetElementName(), unknown_node_);
+  EXPECT_EQ(qes[0]->SubTree(unknown_node_)->GetString(content_node_), content_);
+
+  // repeated queries reuse their matches
+  EXPECT_EQ(engine.NMatches(content_node_), ncontent_);
+  EXPECT_EQ(engine.GetString(content_node_, ncontent_ - 1), content_);
+}
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(InfileTreeTest, optional_queries) {
@@ -0,0 +1,140 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "json_infile_tree.h"
+
+using cyclus::InfileTree;
+using cyclus::JsonInfileTree;
+
+namespace {
+
+const char* kInput =
+    "{\"simulation\": {"
+    "  \"control\": {\"duration\": 10, \"startmonth\": 1,"
+    "                \"startyear\": 2000, \"dre_timings\": true},"
+    "  \"archetypes\": {\"spec\": [{\"lib\": \"agents\", \"name\": \"Sink\"},"
+    "                            {\"name\": \"NullRegion\"},"
+    "                            {\"name\": \"NullInst\"}]},"
+    "  \"facility\": {\"name\": \"sink\", \"config\": {\"Sink\": null}},"
+    "  \"region\": {\"name\": \"reg\", \"config\": {\"NullRegion\": null},"
+    "    \"institution\": {\"name\": \"inst\","
+    "      \"config\": {\"NullInst\": null},"
+    "      \"initialfacilitylist\": {\"entry\": ["
+    "        {\"prototype\": \"sink\", \"number\": 2}]}}},"
+    "  \"recipe\": {\"name\": \"fuel\", \"basis\": \"mass\","
+    "    \"nuclide\": [{\"id\": \"U235\", \"comp\": 0.05},"
+    "                  {\"id\": \"U238\", \"comp\": 0.95}]}"
+    "}}";
+
+}  // namespace
+
+TEST(JsonInfileTreeTests, Queries) {
+  JsonInfileTree tree(kInput);
+
+  // members are elements in order of name, as with toolkit::JsonToXml
+  EXPECT_EQ(5, tree.NElements());
+  EXPECT_EQ("archetypes", tree.GetElementName(0));
+  EXPECT_EQ("region", tree.GetElementName(4));
+  EXPECT_THROW(tree.GetElementName(5), cyclus::ValueError);
+
+  EXPECT_EQ(3, tree.NMatches("/simulation/archetypes/spec"));
+  EXPECT_EQ(3, tree.NMatches("/*/archetypes/spec"));
+  EXPECT_EQ(3, tree.NMatches("archetypes/spec/name"));
+  EXPECT_EQ(1, tree.NMatches("."));
+  EXPECT_EQ(0, tree.NMatches("something_silly"));
+  EXPECT_EQ("NullInst", tree.GetString("archetypes/spec/name", 2));
+  EXPECT_THROW(tree.GetString("something_silly"), cyclus::KeyError);
+  EXPECT_THROW(tree.GetString("archetypes/spec/name", 3), cyclus::ValueError);
+  EXPECT_THROW(tree.GetString("control"), cyclus::ValueError);
+
+  // scalars read as the text they would convert to
+  InfileTree* control = tree.SubTree("/*/control");
+  EXPECT_EQ("10", control->GetString("duration"));
+  EXPECT_EQ("1", control->GetString("dre_timings"));
+  EXPECT_EQ(10, cyclus::Query<int>(control, "duration"));
+  EXPECT_TRUE(cyclus::OptionalQuery<bool>(control, "dre_timings", false));
+  EXPECT_EQ(5, cyclus::OptionalQuery<int>(control, "dt", 5));
+
+  InfileTree* fac = tree.SubTree("facility");
+  EXPECT_EQ("Sink", fac->SubTree("config")->GetElementName(0));
+  EXPECT_EQ(0, fac->SubTree("config/*")->NElements());
+
+  std::vector<InfileTree*> entries = tree.SubTrees(
+      "region/institution/initialfacilitylist/entry");
+  ASSERT_EQ(1, entries.size());
+  EXPECT_EQ("2", entries[0]->GetString("number"));
+
+  std::vector<std::string> fields;
+  fields.push_back("id");
+  fields.push_back("comp");
+  std::vector<std::vector<std::string> > nucs =
+      tree.SubTree("recipe")->GetStrings("nuclide", fields);
+  ASSERT_EQ(2, nucs.size());
+  EXPECT_EQ("U238", nucs[1][0]);
+  EXPECT_EQ("0.95", nucs[1][1]);
+  fields.push_back("mass");
+  EXPECT_THROW(tree.GetStrings("recipe/nuclide", fields), cyclus::KeyError);
+
+  EXPECT_THROW(tree.NMatches("//spec"), cyclus::ValueError);
+  EXPECT_THROW(tree.NMatches("spec[1]"), cyclus::ValueError);
+}
+
+TEST(JsonInfileTreeTests, Arrays) {
+  JsonInfileTree tree(
+      "{\"root\": {\"val\": [[1, 2], 3, null], \"empty\": [], \"s\": \"\"}}");
+  EXPECT_EQ(4, tree.NMatches("val"));
+  EXPECT_EQ("2", tree.GetString("val", 1));
+  EXPECT_EQ("3", tree.GetString("val", 2));
+  EXPECT_THROW(tree.GetString("val", 3), cyclus::ValueError);
+  EXPECT_EQ(1, tree.NMatches("empty"));
+  EXPECT_THROW(tree.GetString("empty"), cyclus::ValueError);
+  EXPECT_THROW(tree.GetString("s"), cyclus::ValueError);
+}
+
+TEST(JsonInfileTreeTests, BadDocuments) {
+  EXPECT_THROW(JsonInfileTree("{\"root\": "), cyclus::ValidationError);
+  EXPECT_THROW(JsonInfileTree("{\"a\": 1, \"b\": 2}"), cyclus::ValidationError);
+  EXPECT_THROW(JsonInfileTree("[1, 2]"), cyclus::ValidationError);
+}
+
+TEST(JsonInfileTreeTests, Validate) {
+  JsonInfileTree tree(kInput);
+  EXPECT_NO_THROW(cyclus::ValidateJsonInput(&tree));
+
+  std::string in(kInput);
+  std::string bad;
+
+  // missing required element
+  bad = in;
+  bad.replace(bad.find("\"startmonth\": 1,"), 16, "");
+  JsonInfileTree t1(bad);
+  EXPECT_THROW(cyclus::ValidateJsonInput(&t1), cyclus::ValidationError);
+
+  // value of the wrong type
+  bad = in;
+  bad.replace(bad.find("\"duration\": 10"), 14, "\"duration\": -10");
+  JsonInfileTree t2(bad);
+  EXPECT_THROW(cyclus::ValidateJsonInput(&t2), cyclus::ValidationError);
+
+  // unknown element
+  bad = in;
+  bad.replace(bad.find("\"dre_timings\""), 13, "\"dre_timing\"");
+  JsonInfileTree t3(bad);
+  EXPECT_THROW(cyclus::ValidateJsonInput(&t3), cyclus::ValidationError);
+
+  // configuration of an archetype that isn't in the input
+  bad = in;
+  bad.replace(bad.find("{\"Sink\": null}"), 14, "{\"Source\": null}");
+  JsonInfileTree t4(bad);
+  EXPECT_THROW(cyclus::ValidateJsonInput(&t4), cyclus::ValidationError);
+
+  // too many elements
+  bad = in;
+  bad.replace(bad.find("\"control\": {"), 12, "\"control\": [{");
+  bad.replace(bad.find("\"archetypes\""), 0, "{\"duration\": 1}], ");
+  JsonInfileTree t5(bad);
+  EXPECT_THROW(cyclus::ValidateJsonInput(&t5), cyclus::ValidationError);
+}
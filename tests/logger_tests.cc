@@ -0,0 +1,98 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "logger.h"
+
+using cyclus::Logger;
+
+TEST(LoggerTests, Format) {
+  std::ostringstream* os;
+  {
+    Logger l;
+    os = &l.Get(cyclus::LEV_INFO2, "toolongprefix");
+    EXPECT_EQ(" INFO2(toolon):  ", os->str());
+    os->str("");  // nothing printed
+  }
+  {
+    Logger l;
+    EXPECT_EQ(" ERROR(core  ):", l.Get(cyclus::LEV_ERROR, "core").str());
+    l.Get(cyclus::LEV_ERROR, "core").str("");
+  }
+}
+
+TEST(LoggerTests, AsyncSink) {
+  const char* path = "logger_tests_sink.log";
+  cyclus::LogLevel orig = Logger::ReportLevel();
+  Logger::ReportLevel() = cyclus::LEV_INFO1;
+  Logger::SetSink(path, 16);  // small, so that loggers wait for room
+  EXPECT_EQ(path, Logger::Sink());
+
+  int nthreads = 4;
+  int nlines = 1000;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < nthreads; ++t) {
+    workers.push_back(std::thread([t, nlines]() {
+      for (int i = 0; i < nlines; ++i) {
+        CLOG(cyclus::LEV_INFO1) << "thread " << t << " line " << i;
+      }
+    }));
+  }
+  for (int t = 0; t < nthreads; ++t) {
+    workers[t].join();
+  }
+  CLOG(cyclus::LEV_DEBUG1) << "not logged";
+  Logger::FlushLog();
+
+  std::ifstream f(path);
+  std::string line;
+  std::vector<int> next(nthreads, 0);
+  int n = 0;
+  while (std::getline(f, line)) {
+    int t, i;
+    ASSERT_EQ(2, sscanf(line.c_str(), " INFO1(core  ):thread %d line %d", &t,
+                        &i)) << line;
+    EXPECT_EQ(next[t]++, i);  // lines of a thread stay in order
+    ++n;
+  }
+  EXPECT_EQ(nthreads * nlines, n);
+
+  Logger::SetSink("");
+  EXPECT_EQ("", Logger::Sink());
+  Logger::ReportLevel() = orig;
+  std::remove(path);
+}
+
+namespace {
+
+int Counted(int* n) {
+  return ++*n;
+}
+
+}  // namespace
+
+// log statements more verbose than the compiled in level never run, whatever
+// the report level
+#pragma push_macro("CYCLUS_MIN_LOG_LEVEL")
+#undef CYCLUS_MIN_LOG_LEVEL
+#define CYCLUS_MIN_LOG_LEVEL 2  // LEV_INFO1
+TEST(LoggerTests, CompiledLevel) {
+  cyclus::LogLevel orig = Logger::ReportLevel();
+  Logger::ReportLevel() = cyclus::LEV_DEBUG5;
+  Logger::SetSink("logger_tests_level.log");
+  int n = 0;
+  CLOG(cyclus::LEV_DEBUG1) << Counted(&n);
+  LOG(cyclus::LEV_INFO2, "test") << Counted(&n);
+  MLOG(cyclus::LEV_DEBUG5) << Counted(&n);
+  EXPECT_EQ(0, n);
+  CLOG(cyclus::LEV_INFO1) << Counted(&n);
+  EXPECT_EQ(1, n);
+  Logger::SetSink("");
+  Logger::ReportLevel() = orig;
+  std::remove("logger_tests_level.log");
+}
+#pragma pop_macro("CYCLUS_MIN_LOG_LEVEL")
@@ -133,6 +133,43 @@ TEST_F(MaterialTest, AbsorbIntoZeroMaterial) {
   EXPECT_FLOAT_EQ(test_size_, same_as_test_mat->quantity());
 }
 
+TEST_F(MaterialTest, MixSharesComps) {
+  // a separately created composition with the same content
+  Composition::Ptr copy = Composition::CreateFromMass(test_comp_->mass());
+  Material::Ptr m = Material::CreateUntracked(test_size_, copy);
+  test_mat_->Absorb(m);
+  EXPECT_EQ(test_comp_, test_mat_->comp());
+  EXPECT_DOUBLE_EQ(2 * test_size_, test_mat_->quantity());
+
+  test_mat_->ExtractComp(test_size_, copy);
+  EXPECT_EQ(test_comp_, test_mat_->comp());
+
+  // absorbing nothing leaves the composition alone, and absorbing into
+  // nothing takes the other composition as is
+  diff_mat_->Absorb(Material::CreateUntracked(0, test_comp_));
+  EXPECT_EQ(diff_comp_, diff_mat_->comp());
+  Material::Ptr empty = Material::CreateUntracked(0, test_comp_);
+  empty->Absorb(diff_mat_);
+  EXPECT_EQ(diff_comp_, empty->comp());
+  EXPECT_DOUBLE_EQ(test_size_, empty->quantity());
+}
+
+TEST_F(MaterialTest, SumMass) {
+  std::vector<Material::Ptr> mats;
+  mats.push_back(test_mat_);
+  mats.push_back(ten_test_mat_);
+  mats.push_back(diff_mat_);
+  CompMap mass;
+  EXPECT_DOUBLE_EQ(12 * test_size_, Material::SumMass(mats, &mass));
+  ASSERT_EQ(3, mass.size());
+  EXPECT_DOUBLE_EQ((11 + 1.0 / 3) * test_size_, mass[u235_]);
+  EXPECT_DOUBLE_EQ(test_size_ / 3, mass[pb208_]);
+
+  // the materials themselves are left untouched
+  EXPECT_DOUBLE_EQ(test_size_, test_mat_->quantity());
+  EXPECT_EQ(test_comp_, ten_test_mat_->comp());
+}
+
 TEST_F(MaterialTest, ExtractMass) {
   double amt = test_size_ / 3;
   double diff = test_size_ - amt;
@@ -227,6 +264,31 @@ TEST_F(MaterialTest, DecayManual) {
   EXPECT_NE(am241_qty, mq.mass(am241_));
 }
 
+TEST_F(MaterialTest, DecayAll) {
+  Material::Ptr same = Material::Create(fac, 10, diff_comp_);
+  Material::Ptr single = Material::Create(fac, 1000, diff_comp_);
+  Material::Ptr other = Material::Create(fac, 1000, test_comp_);
+  cyclus::toolkit::MatQuery orig(other);
+  single->Decay(100);
+
+  std::vector<Material::Ptr> mats;
+  mats.push_back(tracked_mat_);
+  mats.push_back(same);
+  mats.push_back(tracked_mat_no_decay_);
+  mats.push_back(other);
+  Material::DecayAll(mats, 100);
+
+  // materials sharing a composition share its decayed composition
+  EXPECT_EQ(single->comp(), tracked_mat_->comp());
+  EXPECT_EQ(single->comp(), same->comp());
+  EXPECT_EQ(100, tracked_mat_->prev_decay_time());
+  EXPECT_EQ(diff_comp_, tracked_mat_no_decay_->comp());
+
+  cyclus::toolkit::MatQuery mq(other);
+  EXPECT_NE(orig.mass(u235_), mq.mass(u235_));
+  EXPECT_DOUBLE_EQ(1000, other->quantity());
+}
+
 TEST_F(MaterialTest, DecayLazy) {
   SimInfo si(100, 2015, 1, "", "lazy");
   cyclus::Context ctx(&ti, &rec);
@@ -258,6 +320,40 @@ TEST_F(MaterialTest, DecayLazy) {
   EXPECT_NE(am241_qty, mq.mass(am241_));
 }
 
+TEST_F(MaterialTest, DecaySweep) {
+  SimInfo si(100, 2015, 1, "", "lazy");
+  cyclus::Context ctx(&ti, &rec);
+  ctx.decay_sweep(true);
+  ctx.InitSim(si);
+  Agent* a = new TestFacility(&ctx);
+  Material::Ptr m = Material::Create(a, 1000, diff_comp_);
+  Material::Ptr clone = boost::dynamic_pointer_cast<Material>(m->Clone());
+
+  // the sweeps at the end of each Tick decay the material unobserved
+  ti.RunSim();
+  EXPECT_LT(0, m->prev_decay_time());
+  EXPECT_EQ(0, clone->prev_decay_time());
+
+  // the first observation in a time step brings the material up to date,
+  // and later ones take it as it is
+  Composition::Ptr c = m->comp();
+  EXPECT_EQ(ctx.time(), m->prev_decay_time());
+  EXPECT_EQ(c, m->comp());
+}
+
+TEST_F(MaterialTest, SweptOutlivesContext) {
+  Material::Ptr m;
+  {
+    cyclus::Context ctx(&ti, &rec);
+    ctx.decay_sweep(true);
+    ctx.InitSim(SimInfo(10, 2015, 1, "", "lazy"));
+    Agent* a = new TestFacility(&ctx);
+    m = Material::Create(a, 1000, diff_comp_);
+  }
+  // the material mustn't unregister itself from the deleted context
+  m.reset();
+}
+
 TEST_F(MaterialTest, DecayDefault) {
   cyclus::toolkit::MatQuery orig(tracked_mat_);
   double u235_qty = orig.mass(u235_);
@@ -412,4 +508,34 @@ TEST_F(MaterialTest, DecayHeatTest) {
   ASSERT_NEAR(3.614E-14 , dec_heat, 0.0005);
 }
 
+TEST_F(MaterialTest, DecayHeatBatch) {
+  CompMap v;
+  v[922350000] = 0.05;
+  v[922380000] = 0.94;
+  v[942390000] = 0.01;
+  Composition::Ptr c = Composition::CreateFromMass(v);
+
+  // the cached decay heat per kg matches pyne's for the same material
+  double expected = 0;
+  pyne::comp_map dh = pyne::Material(v, 1000).decay_heat();
+  for (pyne::comp_iter it = dh.begin(); it != dh.end(); ++it) {
+    expected += it->second;
+  }
+  EXPECT_NEAR(expected, c->decay_heat(), 1e-12 * expected);
+  EXPECT_EQ(c->decay_heat(), c->decay_heat());
+
+  std::vector<Material::Ptr> mats;
+  mats.push_back(Material::CreateUntracked(2, c));
+  mats.push_back(Material::CreateUntracked(3, c));
+  mats.push_back(diff_mat_);
+  double sum = 0;
+  for (int i = 0; i < mats.size(); i++) {
+    sum += mats[i]->DecayHeat();
+  }
+  EXPECT_NEAR(5 * c->decay_heat(), mats[0]->DecayHeat() + mats[1]->DecayHeat(),
+              1e-12 * sum);
+  EXPECT_NEAR(sum, Material::DecayHeat(mats), 1e-12 * sum);
+  EXPECT_DOUBLE_EQ(0, Material::DecayHeat(std::vector<Material::Ptr>()));
+}
+
 }  // namespace cyclus
@@ -0,0 +1,101 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "composition.h"
+#include "context.h"
+#include "exchange_graph.h"
+#include "material.h"
+#include "mem_usage.h"
+#include "recorder.h"
+#include "timer.h"
+
+using cyclus::Arc;
+using cyclus::Composition;
+using cyclus::ExchangeNode;
+using cyclus::Material;
+using cyclus::MemUsage;
+
+namespace {
+
+class RowBack : public cyclus::RecBackend {
+ public:
+  virtual void Notify(cyclus::DatumList data) {
+    for (int i = 0; i < data.size(); ++i) {
+      if (data[i]->title() == "MemoryUsage")
+        rows.push_back(data[i]->vals());
+    }
+  }
+  virtual std::string Name() { return "RowBack"; }
+  virtual void Flush() {}
+  virtual void Close() {}
+
+  std::vector<cyclus::Datum::Vals> rows;
+};
+
+}  // namespace
+
+TEST(MemUsageTests, Counts) {
+  MemUsage::Reset();
+  MemUsage::enabled(true);
+  cyclus::CompMap v;
+  v[922350000] = 1;
+  {
+    Composition::Ptr c = Composition::CreateFromMass(v);
+    Material::Ptr m1 = Material::CreateUntracked(1, c);
+    Material::Ptr m2 = Material::CreateUntracked(2, c);
+    EXPECT_EQ(1, MemUsage::Get(MemUsage::COMPOSITION).count);
+    EXPECT_EQ(2, MemUsage::Get(MemUsage::MATERIAL).count);
+    EXPECT_EQ(2 * sizeof(Material), MemUsage::Get(MemUsage::MATERIAL).bytes);
+
+    ExchangeNode::Ptr u(new ExchangeNode());
+    ExchangeNode::Ptr w(new ExchangeNode());
+    Arc a(u, w);
+    Arc copy(a);
+    EXPECT_EQ(2, MemUsage::Get(MemUsage::EXCHANGE_NODE).count);
+    EXPECT_EQ(2, MemUsage::Get(MemUsage::ARC).count);
+  }
+  MemUsage::Counts mats = MemUsage::Get(MemUsage::MATERIAL);
+  EXPECT_EQ(0, mats.count);
+  EXPECT_EQ(0, mats.bytes);
+  EXPECT_EQ(2, mats.peak_count);
+  EXPECT_EQ(0, MemUsage::Get(MemUsage::ARC).count);
+  EXPECT_EQ(0, MemUsage::Get(MemUsage::COMPOSITION).count);
+
+  // not counted while off
+  MemUsage::enabled(false);
+  Material::Ptr m = Material::CreateUntracked(1, Composition::CreateFromMass(v));
+  EXPECT_EQ(0, MemUsage::Get(MemUsage::MATERIAL).count);
+  MemUsage::Reset();
+}
+
+TEST(MemUsageTests, Record) {
+  MemUsage::Reset();
+  cyclus::Timer ti;
+  cyclus::Recorder rec;
+  RowBack back;
+  rec.RegisterBackend(&back);
+  cyclus::Context ctx(&ti, &rec);
+  EXPECT_EQ(0, ctx.memory_period());
+  ctx.sample_memory(5);
+  EXPECT_EQ(5, ctx.memory_period());
+  EXPECT_TRUE(MemUsage::enabled());
+
+  Material::Ptr m = Material::CreateUntracked(1, Composition::CreateFromMass(
+      cyclus::CompMap()));
+  MemUsage::Record(&ctx);
+  rec.Flush();
+  ASSERT_EQ(MemUsage::NUM_KINDS + 1, back.rows.size());
+  cyclus::Datum::Vals& v = back.rows[MemUsage::MATERIAL];
+  EXPECT_STREQ("Kind", v[2].first);
+  EXPECT_EQ("Material", v[2].second.cast<std::string>());
+  EXPECT_EQ(1, v[3].second.cast<int>());
+  cyclus::Datum::Vals& proc = back.rows.back();
+  EXPECT_EQ("Process", proc[2].second.cast<std::string>());
+  EXPECT_LE(0, proc[4].second.cast<double>());
+
+  ctx.sample_memory(0);
+  MemUsage::enabled(false);
+  MemUsage::Reset();
+}
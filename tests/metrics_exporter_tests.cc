@@ -0,0 +1,101 @@
+#include <cstring>
+#include <string>
+#if !_WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <gtest/gtest.h>
+
+#include "context.h"
+#include "metrics_exporter.h"
+#include "recorder.h"
+#include "timer.h"
+
+using cyclus::MetricsExporter;
+
+#if !_WIN32
+namespace {
+
+// Returns the response to an HTTP GET of path from the local port.
+std::string Get(int port, const std::string& path) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+  if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) !=
+      0) {
+    close(fd);
+    return "";
+  }
+  std::string req = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  send(fd, req.data(), req.size(), 0);
+  std::string resp;
+  char buf[4096];
+  ssize_t n;
+  while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+    resp.append(buf, n);
+  }
+  close(fd);
+  return resp;
+}
+
+}  // namespace
+
+TEST(MetricsExporterTests, Serve) {
+  cyclus::Timer ti;
+  cyclus::Recorder rec;
+  cyclus::Context ctx(&ti, &rec);
+  ti.Initialize(&ctx, cyclus::SimInfo(3));
+
+  MetricsExporter metrics(&ctx, &rec, 0);
+  ASSERT_GT(metrics.port(), 0);
+  ASSERT_EQ(1, ctx.observers().size());
+
+  for (int t = 0; t < 3; ++t) {
+    metrics.OnStepBegin(&ctx, t);
+    ctx.NextTransactionID();
+    ctx.NextTransactionID();
+    metrics.OnPhaseEnd(&ctx, t, "Tick", 1.0);
+    metrics.OnPhaseEnd(&ctx, t, "ResourceExchange", 0.5);
+    metrics.OnStepEnd(&ctx, t);
+  }
+
+  std::string text = metrics.Render();
+  EXPECT_NE(std::string::npos, text.find("# TYPE cyclus_steps counter\n"));
+  EXPECT_NE(std::string::npos, text.find("\ncyclus_steps_total 3\n"));
+  EXPECT_NE(std::string::npos, text.find("\ncyclus_time_step 2\n"));
+  EXPECT_NE(std::string::npos, text.find("\ncyclus_step_dre_seconds 0.5\n"));
+  EXPECT_NE(std::string::npos, text.find("\ncyclus_dre_seconds_total 1.5\n"));
+  EXPECT_NE(std::string::npos, text.find("\ncyclus_step_trades 2\n"));
+  EXPECT_NE(std::string::npos, text.find("\ncyclus_trades_total 6\n"));
+  EXPECT_NE(std::string::npos, text.find("\ncyclus_rows_written_total "));
+  EXPECT_NE(std::string::npos,
+            text.find("\ncyclus_resident_memory_bytes "));
+  EXPECT_EQ("# EOF\n", text.substr(text.size() - 6));
+
+  std::string resp = Get(metrics.port(), "/metrics");
+  EXPECT_EQ(0, resp.find("HTTP/1.1 200 OK\r\n"));
+  EXPECT_NE(std::string::npos,
+            resp.find("Content-Type: application/openmetrics-text"));
+  EXPECT_NE(std::string::npos, resp.find("\ncyclus_steps_total 3\n"));
+
+  resp = Get(metrics.port(), "/other");
+  EXPECT_EQ(0, resp.find("HTTP/1.1 404 Not Found\r\n"));
+}
+
+TEST(MetricsExporterTests, Unregisters) {
+  cyclus::Timer ti;
+  cyclus::Recorder rec;
+  cyclus::Context ctx(&ti, &rec);
+  {
+    MetricsExporter metrics(&ctx, &rec, 0);
+    EXPECT_EQ(1, ctx.observers().size());
+  }
+  EXPECT_EQ(0, ctx.observers().size());
+}
+#endif
@@ -157,4 +157,48 @@ TEST(MockTests, FiniteLifeDecommission) {
   EXPECT_EQ(life - 1, stmt->GetInt(0));
 }
 
+TEST(MockTests, Benchmark) {
+  cyclus::CompMap m;
+  m[id("U235")] = .05;
+  m[id("U238")] = .95;
+  Composition::Ptr fresh = Composition::CreateFromMass(m);
+
+  std::string config =
+      "<commod>enriched_u</commod>"
+      "<recipe_name>fresh_fuel</recipe_name>"
+      "<capacity>10</capacity>";
+
+  int dur = 10;
+  cyclus::MockSim sim(cyclus::AgentSpec(":agents:Source"), config, dur);
+  sim.AddSink("enriched_u").capacity(5).Finalize();
+  sim.AddSink("enriched_u").capacity(5).Finalize();
+  sim.AddRecipe("fresh_fuel", fresh);
+
+  MockBenchmark b = sim.Benchmark();
+  EXPECT_EQ(sim.agent->id(), b.agent_id);
+  EXPECT_EQ(dur, b.steps);
+  EXPECT_EQ(dur, b.phases["Tick"].calls);
+  EXPECT_EQ(dur, b.phases["ResourceExchange"].calls);
+  EXPECT_EQ(dur, b.callbacks["Tick"].calls);
+  EXPECT_EQ(dur, b.callbacks["Bids"].calls);
+  EXPECT_EQ(2 * dur, b.tables["Transactions"]);
+  EXPECT_EQ(0, b.tables.count("AgentProfile"));
+  EXPECT_LE(b.tables["Transactions"], b.rows);
+  EXPECT_LT(0, b.memory["Material"].peak_count);
+  EXPECT_FALSE(MemUsage::enabled());
+  EXPECT_TRUE(sim.context()->profiler() == NULL);
+
+  std::stringstream ss;
+  b.Write(ss);
+  std::string line;
+  std::getline(ss, line);
+  EXPECT_EQ("agent " + std::to_string(b.agent_id), line);
+  std::getline(ss, line);
+  EXPECT_EQ("steps 10", line);
+  std::getline(ss, line);
+  std::getline(ss, line);
+  EXPECT_EQ(0, line.find("phase Build 10 "));
+  EXPECT_NE(std::string::npos, ss.str().find("\ntable Transactions 20\n"));
+}
+
 }  // namespace cyclus
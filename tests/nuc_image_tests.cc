@@ -0,0 +1,64 @@
+#include <cstdio>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "nuc_image.h"
+#include "pyne.h"
+
+using cyclus::Nuc;
+using cyclus::NucImage;
+
+TEST(NucImageTests, PathFor) {
+  EXPECT_EQ("/a.b/nuc_data.img", NucImage::PathFor("/a.b/nuc_data.h5"));
+  EXPECT_EQ("/a.b/nuc_data.img", NucImage::PathFor("/a.b/nuc_data"));
+}
+
+TEST(NucImageTests, WriteAndRead) {
+  int u235 = pyne::nucname::id("U235");
+  int u238 = pyne::nucname::id("U238");
+  int pu239 = pyne::nucname::id("Pu239");
+  std::vector<Nuc> nucs;
+  nucs.push_back(pu239);
+  nucs.push_back(u235);
+  nucs.push_back(pu239);
+
+  std::string path = "nuc_image_tests.img";
+  NucImage::Write(path, nucs);
+  NucImage img(path);
+  EXPECT_EQ(2, img.size(NucImage::ATOMIC_MASS));
+
+  // covered nuclides have exactly pyne's values
+  double v;
+  ASSERT_TRUE(img.Get(NucImage::ATOMIC_MASS, u235, &v));
+  EXPECT_EQ(pyne::atomic_mass(u235), v);
+  ASSERT_TRUE(img.Get(NucImage::DECAY_CONST, pu239, &v));
+  EXPECT_EQ(pyne::decay_const(pu239), v);
+  ASSERT_TRUE(img.Get(NucImage::Q_VAL, pu239, &v));
+  EXPECT_EQ(pyne::q_val(pu239), v);
+  EXPECT_FALSE(img.Get(NucImage::ATOMIC_MASS, u238, &v));
+
+  std::vector<std::pair<Nuc, double> > children;
+  ASSERT_TRUE(img.Branches(pu239, &children));
+  ASSERT_EQ(pyne::decay_children(pu239).size(), children.size());
+  for (int i = 0; i < children.size(); i++) {
+    EXPECT_EQ(pyne::branch_ratio(pu239, children[i].first),
+              children[i].second);
+  }
+  EXPECT_FALSE(img.Branches(u238, &children));
+  std::remove(path.c_str());
+}
+
+TEST(NucImageTests, Invalid) {
+  std::string path = "nuc_image_tests_invalid.img";
+  {
+    std::ofstream f(path.c_str());
+    f << "not an image";
+  }
+  EXPECT_THROW(NucImage img(path), cyclus::IOError);
+  EXPECT_THROW(NucImage img("no_such_nuc_image.img"), cyclus::IOError);
+  std::remove(path.c_str());
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include "nuc_registry.h"
+#include "pyne.h"
+
+extern "C" {
+#include "cram.hpp"
+}
+
+using cyclus::NucRegistry;
+
+TEST(NucRegistryTests, Index) {
+  NucRegistry& reg = NucRegistry::Instance();
+  ASSERT_LE(pyne_cram_transmute_info.n, reg.size());
+  for (int i = 0; i < pyne_cram_transmute_info.n; ++i) {
+    EXPECT_EQ(i, reg.Index((pyne_cram_transmute_info.nucids)[i]));
+    EXPECT_EQ((pyne_cram_transmute_info.nucids)[i], reg.nuc(i));
+  }
+
+  // nuclides unknown to the decay solver get the next free index once
+  int h1 = 10010000;
+  int n = reg.size();
+  int i = reg.Index(h1);
+  EXPECT_LE(pyne_cram_transmute_info.n, i);
+  EXPECT_EQ(i, reg.Index(h1));
+  EXPECT_EQ(h1, reg.nuc(i));
+  EXPECT_GE(n + 1, reg.size());
+}
+
+TEST(NucRegistryTests, Data) {
+  NucRegistry& reg = NucRegistry::Instance();
+  int u235 = pyne::nucname::id("U235");
+  EXPECT_EQ(u235, reg.Id("U235"));
+  EXPECT_EQ(u235, reg.Id("U235"));
+  EXPECT_EQ(reg.Id("U-235"), reg.Id("92235"));
+  EXPECT_DOUBLE_EQ(pyne::atomic_mass(u235), reg.AtomicMass(u235));
+  EXPECT_DOUBLE_EQ(pyne::atomic_mass(u235),
+                   reg.atomic_mass(reg.Index(u235)));
+
+  int pu239 = pyne::nucname::id("Pu239");
+  EXPECT_DOUBLE_EQ(pyne::q_val(pu239), reg.q_val(reg.Index(pu239)));
+
+  // nuclides registered after the masses are loaded are looked up at once
+  int he3 = 20030000;
+  EXPECT_DOUBLE_EQ(pyne::atomic_mass(he3), reg.atomic_mass(reg.Index(he3)));
+}
@@ -0,0 +1,127 @@
+#include "platform.h"
+#if CYCLUS_HAS_PARQUET
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "boost/filesystem.hpp"
+#include "boost/uuid/uuid_generators.hpp"
+
+#include "blob.h"
+#include "parquet_back.h"
+#include "recorder.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+class DirDeleter {
+ public:
+  explicit DirDeleter(std::string path) : path_(path) {
+    fs::remove_all(path_);
+  }
+  ~DirDeleter() { fs::remove_all(path_); }
+
+ private:
+  std::string path_;
+};
+
+}  // namespace
+
+TEST(ParquetBackTest, ReadWrite) {
+  using cyclus::Blob;
+  using cyclus::ParquetBack;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  typedef std::map<std::string, std::vector<double> > VecMap;
+  typedef std::map<std::pair<std::string, std::string>, int> PairMap;
+  const char* path = "readwrite.parquet";
+  DirDeleter dd(path);
+
+  boost::uuids::uuid uid = boost::uuids::random_generator()();
+  std::vector<int> ints;
+  ints.push_back(3);
+  ints.push_back(1);
+  VecMap vecs;
+  vecs["a"].push_back(1.5);
+  vecs["b"];
+  PairMap pairs;
+  pairs[std::make_pair(std::string("x"), std::string("y"))] = 7;
+  {
+    Recorder m;
+    ParquetBack back(path);
+    back.set_batch_rows(2);  // several row groups
+    m.RegisterBackend(&back);
+    for (int i = 0; i < 5; ++i) {
+      m.NewDatum("Mixed")
+          ->AddVal("Num", i)
+          ->AddVal("Flag", i % 2 == 0)
+          ->AddVal("Val", i * 0.5)
+          ->AddVal("Name", std::string("spam"))
+          ->AddVal("Data", Blob(std::string("\0eggs", 5)))
+          ->AddVal("Id", uid)
+          ->AddVal("Ints", ints)
+          ->AddVal("Vecs", vecs)
+          ->AddVal("Pairs", pairs)
+          ->Record();
+    }
+    m.Close();
+  }
+
+  EXPECT_TRUE(fs::exists(fs::path(path) / "Mixed" / "part-00000.parquet"));
+  ParquetBack back(path);
+  EXPECT_EQ(1, back.Tables().count("Mixed"));
+  EXPECT_EQ(cyclus::MAP_PAIR_STRING_STRING_INT,
+            back.ColumnTypes("Mixed")["Pairs"]);
+  QueryResult qr = back.Query("Mixed", NULL);
+  ASSERT_EQ(5, qr.rows.size());
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(i, qr.GetVal<int>("Num", i));
+    EXPECT_EQ(i % 2 == 0, qr.GetVal<bool>("Flag", i));
+    EXPECT_DOUBLE_EQ(i * 0.5, qr.GetVal<double>("Val", i));
+    EXPECT_EQ("spam", qr.GetVal<std::string>("Name", i));
+    EXPECT_EQ(Blob(std::string("\0eggs", 5)), qr.GetVal<Blob>("Data", i));
+    EXPECT_EQ(uid, qr.GetVal<boost::uuids::uuid>("Id", i));
+    EXPECT_EQ(ints, qr.GetVal<std::vector<int> >("Ints", i));
+    EXPECT_EQ(vecs, qr.GetVal<VecMap>("Vecs", i));
+    EXPECT_EQ(pairs, qr.GetVal<PairMap>("Pairs", i));
+  }
+
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("Num", ">", 1));
+  conds.push_back(cyclus::Cond("Flag", "==", true));
+  qr = back.Query("Mixed", &conds);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(2, qr.GetVal<int>("Num", 0));
+  EXPECT_EQ(4, qr.GetVal<int>("Num", 1));
+}
+
+TEST(ParquetBackTest, QueryWhileRecording) {
+  using cyclus::ParquetBack;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  const char* path = "parts.parquet";
+  DirDeleter dd(path);
+
+  Recorder m;
+  ParquetBack back(path);
+  m.RegisterBackend(&back);
+  m.NewDatum("Rows")->AddVal("Num", 0)->Record();
+  m.Flush();
+  QueryResult qr = back.Query("Rows", NULL);
+  ASSERT_EQ(1, qr.rows.size());
+
+  // rows recorded after a query go to a new part
+  m.NewDatum("Rows")->AddVal("Num", 1)->Record();
+  m.Close();
+  EXPECT_TRUE(fs::exists(fs::path(path) / "Rows" / "part-00001.parquet"));
+  qr = back.Query("Rows", NULL);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(0, qr.GetVal<int>("Num", 0));
+  EXPECT_EQ(1, qr.GetVal<int>("Num", 1));
+}
+
+#endif  // CYCLUS_HAS_PARQUET
@@ -0,0 +1,20 @@
+"""Archetypes for testing vectorized preference adjustment"""
+from __future__ import print_function, unicode_literals
+
+from cyclus.pyagents import Sink
+import cyclus.typesystem as ts
+
+
+class RefusingSink(Sink):
+    """A sink that refuses every bid by setting the preferences of its
+    requests below zero, through a vectorized view of them.
+    """
+    vectorized_prefs = True
+
+    def adjust_material_prefs(self, prefs):
+        assert isinstance(prefs, ts.PrefView)
+        assert len(prefs.bids) == len(prefs)
+        assert len(prefs.request) == len(prefs)
+        print("Adjusted", len(prefs), "arcs of", len(prefs.requests),
+              "requests")
+        prefs.pref[:] = -1.0
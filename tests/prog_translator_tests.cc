@@ -279,6 +279,69 @@ TEST(ProgTranslatorTests, translation) {
   delete iface;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// builds a graph with one request and one supply, each with ntargets arcs
+ExchangeGraph* BuildUpdateGraph(double pref, double dem, int ntargets) {
+  ExchangeGraph* g = new ExchangeGraph();
+  RequestGroup::Ptr rg(new RequestGroup());
+  rg->AddCapacity(dem);
+  ExchangeNodeGroup::Ptr sg(new ExchangeNodeGroup());
+  sg->AddCapacity(10);
+  g->AddRequestGroup(rg);
+  g->AddSupplyGroup(sg);
+  for (int i = 0; i != ntargets; i++) {
+    ExchangeNode::Ptr u(new ExchangeNode());
+    ExchangeNode::Ptr v(new ExchangeNode());
+    rg->AddExchangeNode(u);
+    sg->AddExchangeNode(v);
+    Arc a(u, v);
+    a.pref(pref);
+    u->unit_capacities[a].push_back(1);
+    v->unit_capacities[a].push_back(1);
+    u->prefs[a] = pref;
+    g->AddArc(a);
+  }
+  return g;
+}
+
+TEST(ProgTranslatorTests, Update) {
+  SolverFactory sf("clp");
+  OsiSolverInterface* iface = sf.get();
+  CoinMessageHandler h;
+  h.setLogLevel(0);
+  iface->passInMessageHandler(&h);
+  double cost = 100;
+
+  ExchangeGraph* g1 = BuildUpdateGraph(1, 5, 2);
+  ProgTranslator pt1(g1, iface, cost);
+  pt1.ToProg();
+  iface->initialSolve();
+
+  // changed preferences and demand keep the structure
+  ExchangeGraph* g2 = BuildUpdateGraph(2, 6, 2);
+  ProgTranslator pt2(g2, iface, cost);
+  pt2.Translate();
+  EXPECT_TRUE(pt2.Update(pt1.ctx()));
+
+  OsiClpSolverInterface checkface;
+  checkface.loadProblem(pt2.ctx().m, &pt2.ctx().col_lbs[0],
+                        &pt2.ctx().col_ubs[0], &pt2.ctx().obj_coeffs[0],
+                        &pt2.ctx().row_lbs[0], &pt2.ctx().row_ubs[0]);
+  EXPECT_EQ(0, differentAgent(*iface, checkface));
+
+  // an extra arc does not
+  ExchangeGraph* g3 = BuildUpdateGraph(2, 6, 3);
+  ProgTranslator pt3(g3, iface, cost);
+  pt3.Translate();
+  EXPECT_FALSE(pt3.Update(pt2.ctx()));
+  EXPECT_EQ(0, differentAgent(*iface, checkface));
+
+  delete g1;
+  delete g2;
+  delete g3;
+  delete iface;
+}
+
 TEST(ProgTranslatorTests, depricated) {
 
   // confirm depricated error is thrown
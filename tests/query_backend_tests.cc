@@ -128,3 +128,100 @@ TEST(QueryBackendTest, CmpConds) {
   EXPECT_PRED2(CmpConds<int>, &x, &conds);
   EXPECT_PRED2(NotCmpConds<int>, &y, &conds);
 }
+
+TEST(QueryBackendTest, FieldIndexes) {
+  using cyclus::QueryResult;
+  using cyclus::QueryRow;
+
+  QueryResult qr;
+  qr.fields.push_back("a");
+  qr.fields.push_back("b");
+  qr.fields.push_back("a");
+  QueryRow row;
+  row.push_back(1);
+  row.push_back(std::string("two"));
+  row.push_back(3);
+  qr.rows.push_back(row);
+
+  std::vector<std::string> names;
+  names.push_back("b");
+  names.push_back("a");
+  std::vector<int> cols = qr.FieldIndexes(names);
+  ASSERT_EQ(2, cols.size());
+  EXPECT_EQ(1, cols[0]);
+  EXPECT_EQ(0, cols[1]);
+  EXPECT_EQ("two", qr.GetVal<std::string>(cols[0]));
+  EXPECT_EQ(qr.GetVal<int>("a"), qr.GetVal<int>(cols[1]));
+
+  names.push_back("c");
+  EXPECT_THROW(qr.FieldIndexes(names), cyclus::KeyError);
+  EXPECT_THROW(qr.GetVal<int>(cols[1], 1), cyclus::KeyError);
+}
+
+TEST(QueryBackendTest, Aggregator) {
+  using cyclus::Agg;
+  using cyclus::Aggregator;
+  using cyclus::QueryResult;
+  using cyclus::QueryRow;
+  std::map<std::string, cyclus::DbTypes> types;
+  types["Commod"] = cyclus::STRING;
+  types["Time"] = cyclus::INT;
+  types["Qty"] = cyclus::DOUBLE;
+  types["Comp"] = cyclus::VECTOR_INT;
+
+  std::vector<std::string> group_by;
+  group_by.push_back("Commod");
+  std::vector<Agg> aggs;
+  aggs.push_back(Agg("count"));
+  aggs.push_back(Agg("sum", "Qty"));
+  aggs.push_back(Agg("min", "Time"));
+  aggs.push_back(Agg("max", "Time"));
+  Aggregator a(group_by, aggs, types);
+  ASSERT_EQ(3, a.fields().size());
+  EXPECT_EQ("Commod", a.fields()[0]);
+  EXPECT_EQ("Qty", a.fields()[1]);
+  EXPECT_EQ("Time", a.fields()[2]);
+
+  const char* commods[] = {"uox", "mox", "uox", "uox", "mox"};
+  Aggregator b = a;
+  for (int i = 0; i < 5; ++i) {
+    QueryRow row;
+    row.push_back(std::string(commods[i]));
+    row.push_back(1.5 * i);
+    row.push_back(10 - i);
+    (i < 3 ? a : b).Add(row);
+  }
+  a.Merge(b);
+
+  QueryResult qr = a.Result();
+  ASSERT_EQ(5, qr.fields.size());
+  EXPECT_EQ("count", qr.fields[1]);
+  EXPECT_EQ("sum(Qty)", qr.fields[2]);
+  EXPECT_EQ(cyclus::INT, qr.types[1]);
+  EXPECT_EQ(cyclus::DOUBLE, qr.types[2]);
+  EXPECT_EQ(cyclus::INT, qr.types[3]);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ("mox", qr.GetVal<std::string>("Commod", 0));
+  EXPECT_EQ(2, qr.GetVal<int>("count", 0));
+  EXPECT_DOUBLE_EQ(7.5, qr.GetVal<double>("sum(Qty)", 0));
+  EXPECT_EQ(6, qr.GetVal<int>("min(Time)", 0));
+  EXPECT_EQ(9, qr.GetVal<int>("max(Time)", 0));
+  EXPECT_EQ("uox", qr.GetVal<std::string>("Commod", 1));
+  EXPECT_EQ(3, qr.GetVal<int>("count", 1));
+  EXPECT_DOUBLE_EQ(7.5, qr.GetVal<double>("sum(Qty)", 1));
+  EXPECT_EQ(7, qr.GetVal<int>("min(Time)", 1));
+  EXPECT_EQ(10, qr.GetVal<int>("max(Time)", 1));
+
+  // no rows give no groups
+  EXPECT_EQ(0, Aggregator(std::vector<std::string>(), aggs, types)
+                   .Result().rows.size());
+
+  EXPECT_THROW(Agg("avg", "Qty"), cyclus::ValueError);
+  aggs.push_back(Agg("sum", "Commod"));
+  EXPECT_THROW(Aggregator(group_by, aggs, types), cyclus::ValueError);
+  aggs.pop_back();
+  group_by.push_back("Comp");
+  EXPECT_THROW(Aggregator(group_by, aggs, types), cyclus::ValueError);
+  group_by.back() = "Nope";
+  EXPECT_THROW(Aggregator(group_by, aggs, types), cyclus::KeyError);
+}
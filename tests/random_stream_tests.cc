@@ -0,0 +1,70 @@
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "random_stream.h"
+
+using cyclus::RandomStream;
+
+TEST(RandomStreamTests, Philox) {
+  // known answers from the Random123 distribution
+  uint32_t out[4];
+  uint32_t zeros[4] = {0, 0, 0, 0};
+  RandomStream::Philox(zeros, zeros, out);
+  EXPECT_EQ(0x6627e8d5u, out[0]);
+  EXPECT_EQ(0xe169c58du, out[1]);
+  EXPECT_EQ(0xbc57ac4cu, out[2]);
+  EXPECT_EQ(0x9b00dbd8u, out[3]);
+
+  uint32_t ones[4] = {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff};
+  RandomStream::Philox(ones, ones, out);
+  EXPECT_EQ(0x408f276du, out[0]);
+  EXPECT_EQ(0x41c83b0eu, out[1]);
+  EXPECT_EQ(0xa20bc7c6u, out[2]);
+  EXPECT_EQ(0x6d5451fdu, out[3]);
+
+  uint32_t ctr[4] = {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344};
+  uint32_t key[2] = {0xa4093822, 0x299f31d0};
+  RandomStream::Philox(ctr, key, out);
+  EXPECT_EQ(0xd16cfe09u, out[0]);
+  EXPECT_EQ(0x94fdccebu, out[1]);
+  EXPECT_EQ(0x5001e420u, out[2]);
+  EXPECT_EQ(0x24126ea1u, out[3]);
+}
+
+TEST(RandomStreamTests, Stream) {
+  RandomStream a(42, 1, 2, 3);
+  uint32_t ctr[4] = {1, 1, 2, 3};
+  uint32_t key[2] = {42, 0};
+  uint32_t block[4];
+  RandomStream::Philox(ctr, key, block);
+  std::vector<uint32_t> first;
+  for (int i = 0; i < 8; ++i) {
+    first.push_back(a());
+  }
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(block[i], first[4 + i]);
+  }
+
+  RandomStream b(42, 1, 2, 3);
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_EQ(first[i], b());
+  }
+  RandomStream c(42, 1, 2, 4);
+  RandomStream d(43, 1, 2, 3);
+  EXPECT_NE(first[0], c());
+  EXPECT_NE(first[0], d());
+}
+
+TEST(RandomStreamTests, Uniform) {
+  RandomStream s(7, 0, 0, 0);
+  double sum = 0;
+  int n = 100000;
+  for (int i = 0; i < n; ++i) {
+    double u = s.Uniform();
+    ASSERT_GE(u, 0);
+    ASSERT_LT(u, 1);
+    sum += u;
+  }
+  EXPECT_NEAR(0.5, sum / n, 0.01);
+}
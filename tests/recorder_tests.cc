@@ -402,3 +402,296 @@ TEST(RawRecorderTest, Datum_addVal) {
   cyclus::Datum::Vals vals = back.data.back()->vals();
   EXPECT_EQ(d, back.data.back());
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+class GroupBack : public cyclus::RecBackend {
+ public:
+  using cyclus::RecBackend::Notify;
+
+  virtual void Notify(const cyclus::DatumGroups& groups) {
+    last = &groups;
+    for (int g = 0; g < groups.size(); ++g) {
+      titles.push_back(groups[g].title());
+      for (int i = 0; i < groups[g].size(); ++i) {
+        values.push_back(groups[g][i]->vals().back().second.cast<int>());
+      }
+    }
+  }
+
+  virtual std::string Name() { return "GroupBack"; }
+  virtual void Flush() {}
+  virtual void Close() {}
+
+  const cyclus::DatumGroups* last;
+  std::vector<std::string> titles;
+  std::vector<int> values;
+};
+
+TEST(RecorderTest, GroupedNotify) {
+  GroupBack back1;
+  GroupBack back2;
+  TestBack listback;
+  cyclus::Recorder m;
+  m.RegisterBackend(&back1);
+  m.RegisterBackend(&back2);
+  m.RegisterBackend(&listback);
+  m.NewDatum("B")->AddVal("i", 0)->Record();
+  m.NewDatum("A")->AddVal("i", 1)->Record();
+  m.NewDatum("B")->AddVal("i", 2)->Record();
+  m.NewDatum("A")->AddVal("i", 3)->Record();
+  m.NewDatum("C")->AddVal("i", 4)->Record();
+  m.Flush();
+
+  // tables in order of appearance, rows in recorded order
+  ASSERT_EQ(3, back1.titles.size());
+  EXPECT_EQ("B", back1.titles[0]);
+  EXPECT_EQ("A", back1.titles[1]);
+  EXPECT_EQ("C", back1.titles[2]);
+  int want[] = {0, 2, 1, 3, 4};
+  EXPECT_EQ(std::vector<int>(want, want + 5), back1.values);
+  EXPECT_EQ(back1.values, back2.values);
+
+  // the groups are built once and shared by the backends
+  EXPECT_EQ(back1.last, back2.last);
+
+  // backends that take plain lists still get the recorded order
+  ASSERT_EQ(5, listback.data.size());
+  EXPECT_EQ("A", listback.data[1]->title());
+  EXPECT_EQ("B", listback.data[2]->title());
+
+  // a list passed to a grouping backend is grouped for it
+  cyclus::DatumList data = listback.data;
+  back1.titles.clear();
+  back1.values.clear();
+  back1.Notify(data);
+  EXPECT_EQ(3, back1.titles.size());
+  EXPECT_EQ(std::vector<int>(want, want + 5), back1.values);
+}
+
+//
+// Async Recorder Test
+//
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+class CountBack : public cyclus::RecBackend {
+ public:
+  CountBack() : nrows(0), nflush(0) {}
+
+  virtual void Notify(cyclus::DatumList data) {
+    for (int i = 0; i < data.size(); ++i) {
+      values.push_back(data[i]->vals().back().second.cast<int>());
+    }
+    nrows += data.size();
+  }
+
+  virtual std::string Name() { return "CountBack"; }
+  virtual void Flush() { nflush++; }
+  virtual void Close() {}
+
+  int nrows;
+  int nflush;
+  std::vector<int> values;
+};
+
+class ThrowBack : public CountBack {
+ public:
+  virtual void Notify(cyclus::DatumList data) {
+    throw cyclus::IOError("disk full");
+  }
+};
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(AsyncRecorderTest, FlushWritesEverythingInOrder) {
+  CountBack back;
+  cyclus::Recorder m;
+  m.set_dump_count(3);
+  m.set_async(true);
+  EXPECT_TRUE(m.async());
+  m.RegisterBackend(&back);
+
+  for (int i = 0; i < 100; ++i) {
+    m.NewDatum("Foo")->AddVal("i", i)->Record();
+  }
+  m.Flush();
+
+  ASSERT_EQ(100, back.nrows);
+  EXPECT_EQ(1, back.nflush);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(i, back.values[i]);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(AsyncRecorderTest, ToggleAndClose) {
+  CountBack back;
+  cyclus::Recorder m;
+  m.set_dump_count(2);
+  m.RegisterBackend(&back);
+  m.set_async(true);
+  for (int i = 0; i < 5; ++i) {
+    m.NewDatum("Foo")->AddVal("i", i)->Record();
+  }
+  m.set_async(false);
+  EXPECT_FALSE(m.async());
+  EXPECT_EQ(4, back.nrows);
+
+  m.NewDatum("Foo")->AddVal("i", 5)->Record();
+  EXPECT_EQ(6, back.nrows);
+  m.Close();
+  EXPECT_EQ(6, back.nrows);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(AsyncRecorderTest, BackendErrorRethrown) {
+  ThrowBack back;
+  cyclus::Recorder m;
+  m.set_dump_count(1);
+  m.set_async(true);
+  m.RegisterBackend(&back);
+  m.NewDatum("Foo")->AddVal("i", 1)->Record();
+  EXPECT_THROW(m.Flush(), cyclus::IOError);
+  m.Close();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(RecorderTest, DatumReusedPerTitle) {
+  using cyclus::Datum;
+  using cyclus::Recorder;
+  TestBack back;
+  Recorder m;
+  m.set_dump_count(2);
+  m.RegisterBackend(&back);
+
+  Datum* a = m.NewDatum("Apples");
+  a->AddVal(std::string("count"), 1)->AddVal("name", std::string("fuji"))
+   ->Record();
+  Datum* p = m.NewDatum("Pears");
+  p->AddVal("count", 2)->Record();
+  ASSERT_EQ(1, back.notify_count);
+
+  // flushed datums are handed back out for their own table only
+  Datum* p2 = m.NewDatum("Pears");
+  EXPECT_EQ(p, p2);
+  p2->AddVal("count", 3)->AddVal("extra", 4.0)->Record();
+  Datum* a2 = m.NewDatum("Apples");
+  EXPECT_EQ(a, a2);
+  a2->AddVal(std::string("count"), 5)->Record();
+
+  ASSERT_EQ(2, back.notify_count);
+  ASSERT_EQ(3, p2->vals().size());
+  EXPECT_EQ(3, p2->vals()[1].second.cast<int>());
+  EXPECT_DOUBLE_EQ(4.0, p2->vals()[2].second.cast<double>());
+  ASSERT_EQ(2, a2->vals().size());
+  ASSERT_EQ(2, a2->fields().size());
+  EXPECT_STREQ("count", a2->vals()[1].first);
+  EXPECT_EQ(5, a2->vals()[1].second.cast<int>());
+}
+
+TEST(RecorderTest, FilterTables) {
+  using cyclus::Datum;
+  using cyclus::Recorder;
+  TestBack back;
+  Recorder m;
+  m.RegisterBackend(&back);
+
+  std::set<std::string> allow;
+  allow.insert("Kept");
+  allow.insert("Denied");
+  std::set<std::string> deny;
+  deny.insert("Denied");
+  m.FilterTables(allow, deny);
+  EXPECT_TRUE(m.Records("Kept"));
+  EXPECT_FALSE(m.Records("Denied"));
+  EXPECT_FALSE(m.Records("Other"));
+
+  m.NewDatum("Kept")->AddVal("x", 1)->Record();
+  Datum* skipped = m.NewDatum("Other");
+  skipped->AddVal("x", 2)->AddVal(std::string("y"), "spam")->Record();
+  EXPECT_EQ(0, skipped->vals().size());
+  EXPECT_EQ(skipped, m.NewDatum("Other"));
+  m.NewDatum("Denied")->AddVal("x", 3)->Record();
+  m.Flush();
+  ASSERT_EQ(1, back.data.size());
+  EXPECT_EQ("Kept", back.data[0]->title());
+
+  // tables seen before the filter changed follow it
+  m.FilterTables(std::set<std::string>(), deny);
+  EXPECT_TRUE(m.Records("Other"));
+  m.NewDatum("Other")->AddVal("x", 4)->Record();
+  m.Flush();
+  ASSERT_EQ(1, back.data.size());
+  EXPECT_EQ("Other", back.data[0]->title());
+}
+
+TEST(RecorderTest, Silent) {
+  using cyclus::Datum;
+  using cyclus::Recorder;
+  TestBack back;
+  Recorder m;
+  m.RegisterBackend(&back);
+  m.NewDatum("Seen")->AddVal("x", 1)->Record();
+
+  // nothing is recorded while silent unless it is allowed explicitly
+  m.set_silent(true);
+  EXPECT_TRUE(m.silent());
+  EXPECT_FALSE(m.Records("Seen"));
+  EXPECT_FALSE(m.Records("Other"));
+  Datum* skipped = m.NewDatum("Other");
+  skipped->AddVal("x", 2)->Record();
+  EXPECT_EQ(0, skipped->vals().size());
+  EXPECT_EQ(skipped, m.NewDatum("Unseen"));
+  m.NewDatum(m.GetTable("Seen"))->AddVal("x", 3)->Record();
+  m.Flush();
+  ASSERT_EQ(1, back.data.size());
+  EXPECT_EQ("Seen", back.data[0]->title());
+
+  std::set<std::string> allow;
+  allow.insert("Other");
+  m.FilterTables(allow, std::set<std::string>());
+  EXPECT_TRUE(m.Records("Other"));
+  m.NewDatum("Other")->AddVal("x", 4)->Record();
+  m.NewDatum("Seen")->AddVal("x", 5)->Record();
+  m.Flush();
+  ASSERT_EQ(1, back.data.size());
+  EXPECT_EQ("Other", back.data[0]->title());
+
+  m.set_silent(false);
+  EXPECT_FALSE(m.Records("Seen"));
+  m.FilterTables(std::set<std::string>(), std::set<std::string>());
+  EXPECT_TRUE(m.Records("Seen"));
+}
+
+TEST(RecorderTest, Stats) {
+  using cyclus::Recorder;
+  using cyclus::TableStats;
+  TestBack back;
+  Recorder m(false);
+  m.RegisterBackend(&back);
+  m.NewDatum("Untracked")->AddVal("x", 1)->Record();
+  m.Flush();
+  EXPECT_TRUE(m.stats().empty());
+
+  m.set_collect_stats(true);
+  for (int i = 0; i < 3; ++i) {
+    m.NewDatum("A")->AddVal("x", i)->AddVal("y", std::string("spam"))
+        ->Record();
+  }
+  m.NewDatum("B")->AddVal("z", 1.5)->Record();
+  m.Flush();
+
+  std::map<std::string, TableStats> stats = m.stats();
+  ASSERT_EQ(2, stats.size());
+  EXPECT_EQ(3, stats["A"].rows);
+  EXPECT_EQ(24, stats["A"].bytes);
+  EXPECT_EQ(1, stats["B"].rows);
+  EXPECT_EQ(8, stats["B"].bytes);
+  ASSERT_EQ(1, stats["A"].notify_secs.count("TestBack"));
+  EXPECT_LE(0, stats["A"].notify_secs["TestBack"]);
+
+  m.Close();
+  ASSERT_EQ(2, back.data.size());
+  EXPECT_EQ("RecorderStats", back.data[0]->title());
+  EXPECT_EQ("A", back.data[0]->vals()[0].second.cast<std::string>());
+  EXPECT_EQ("TestBack", back.data[0]->vals()[1].second.cast<std::string>());
+  EXPECT_EQ(3, back.data[0]->vals()[2].second.cast<int>());
+}
@@ -15,6 +15,7 @@ using cyclus::Composition;
 using cyclus::Product;
 using cyclus::Material;
 using cyclus::Request;
+using cyclus::RequestTarget;
 using cyclus::TestContext;
 using cyclus::Trader;
 using std::string;
@@ -33,6 +34,7 @@ TEST(RequestTests, Defaults) {
   Request<Material>* r = Request<Material>::Create(mat, fac);
 
   EXPECT_EQ("", r->commodity());
+  EXPECT_EQ(0, r->commodity_id());
   EXPECT_FALSE(r->exclusive());
   EXPECT_EQ(1., r->preference());
   EXPECT_EQ(1., cyclus::kDefaultPref);
@@ -55,6 +57,7 @@ TEST(RequestTests, MaterialGetSet) {
   Request<Material>* r = Request<Material>::Create(mat, fac, commod, pref);
 
   EXPECT_EQ(commod, r->commodity());
+  EXPECT_EQ(cyclus::CommodityRegistry::Intern(commod), r->commodity_id());
   EXPECT_EQ(fac, r->requester());
   EXPECT_EQ(mat, r->target());
   EXPECT_EQ(pref, r->preference());
@@ -106,3 +109,32 @@ TEST(RequestTests, FunctionPointer) {
 
   delete r;
 }
+
+TEST(RequestTests, Described) {
+  TestContext tc;
+  TestFacility* fac = tc.trader();
+
+  cyclus::CompMap cm;
+  cm[92235] = 1.0;
+  Composition::Ptr comp = Composition::CreateFromMass(cm);
+
+  Request<Material>* r =
+      Request<Material>::Create(RequestTarget(2.5, comp), fac, "name");
+  EXPECT_TRUE(r->described());
+  EXPECT_EQ(2.5, r->target_quantity());
+  EXPECT_EQ(comp, r->target_comp());
+
+  // the target is made once, when it is first asked for
+  Material::Ptr mat = r->target();
+  EXPECT_EQ(2.5, mat->quantity());
+  EXPECT_EQ(comp, mat->comp());
+  EXPECT_EQ(mat, r->target());
+  delete r;
+
+  Request<Product>* p =
+      Request<Product>::Create(RequestTarget(3, Composition::Ptr(), "qual"),
+                               fac);
+  EXPECT_EQ(3, p->target_quantity());
+  EXPECT_EQ("qual", p->target()->quality());
+  delete p;
+}
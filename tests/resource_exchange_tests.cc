@@ -1,5 +1,9 @@
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <set>
 #include <string>
+#include <thread>
 #include <math.h>
 
 #include <gtest/gtest.h>
@@ -12,12 +16,15 @@
 #include "exchange_context.h"
 #include "facility.h"
 #include "material.h"
+#include "product.h"
 #include "request.h"
 #include "request_portfolio.h"
 #include "resource_exchange.h"
 #include "resource_helpers.h"
 #include "test_context.h"
 #include "test_agents/test_facility.h"
+#include "toolkit/position.h"
+#include "toolkit/spatial_index.h"
 
 using cyclus::Bid;
 using cyclus::BidPortfolio;
@@ -27,12 +34,15 @@ using cyclus::Context;
 using cyclus::ExchangeContext;
 using cyclus::Facility;
 using cyclus::Material;
+using cyclus::Product;
 using cyclus::Agent;
+using cyclus::PrefChanges;
 using cyclus::PrefMap;
 using cyclus::Request;
 using cyclus::RequestPortfolio;
 using cyclus::ResourceExchange;
 using cyclus::TestContext;
+using cyclus::toolkit::Position;
 using std::set;
 using std::string;
 
@@ -101,14 +111,165 @@ class Bidder: public TestFacility {
     set<BidPortfolio<Material>::Ptr> bps;
     bps.insert(port_);
     bid_ctr_++;
+    offered_ = commod_requests[commod_];
     return bps;
   }
 
   BidPortfolio<Material>::Ptr port_;
+  std::vector<Request<Material>*> offered_;
   std::string commod_;
   int bid_ctr_;
 };
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// names the one commodity it bids on, and trades only resources of type_
+class NamedBidder: public Bidder {
+ public:
+  NamedBidder(Context* ctx, std::string commod,
+              std::string type = Material::kType)
+      : Bidder(ctx, commod),
+        type_(type) {}
+
+  virtual cyclus::Agent* Clone() {
+    NamedBidder* m = new NamedBidder(context(), commod_, type_);
+    m->InitFrom(this);
+    m->port_ = port_;
+    return m;
+  }
+
+  virtual bool TradesResource(const cyclus::ResourceType& type) {
+    return type == type_;
+  }
+
+  virtual bool BidCommods(const cyclus::ResourceType& type,
+                          set<string>* commods) {
+    commods->insert(commod_);
+    return true;
+  }
+
+  std::string type_;
+};
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+class ThreadSafeRequester: public Requester {
+ public:
+  ThreadSafeRequester(Context* ctx) : Requester(ctx) {}
+
+  virtual cyclus::Agent* Clone() {
+    ThreadSafeRequester* m = new ThreadSafeRequester(context());
+    m->InitFrom(this);
+    m->port_ = port_;
+    return m;
+  }
+
+  virtual bool ThreadSafeExchange() { return true; }
+};
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// creates two resources while it is queried for requests, after waiting for
+// longer the earlier it was cloned, and records their ids
+class IdRequester: public ThreadSafeRequester {
+ public:
+  IdRequester(Context* ctx, int wait_ms)
+      : ThreadSafeRequester(ctx), wait_ms_(wait_ms) {}
+
+  virtual cyclus::Agent* Clone() {
+    IdRequester* m = new IdRequester(context(), wait_ms_);
+    m->InitFrom(this);
+    m->port_ = port_;
+    return m;
+  }
+
+  set<RequestPortfolio<Material>::Ptr> GetMatlRequests() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms_));
+    ids_.clear();
+    for (int i = 0; i < 2; i++) {
+      Material::Ptr m = Material::CreateUntracked(1.0, port_->requests()[0]
+                                                       ->target()->comp());
+      ids_.push_back(m->state_id());
+      ids_.push_back(m->obj_id());
+    }
+    return Requester::GetMatlRequests();
+  }
+
+  int wait_ms_;
+  std::vector<int> ids_;
+};
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// prepares its bids in the background, waiting there (for up to 5 s) until as
+// many bidders have started as share its counter
+class AsyncBidder: public Bidder {
+ public:
+  AsyncBidder(Context* ctx, std::string commod, std::atomic<int>* started,
+              int n)
+      : Bidder(ctx, commod),
+        started_(started),
+        n_(n),
+        overlapped_(false),
+        ready_(false) {}
+
+  virtual cyclus::Agent* Clone() {
+    AsyncBidder* m = new AsyncBidder(context(), commod_, started_, n_);
+    m->InitFrom(this);
+    m->port_ = port_;
+    return m;
+  }
+
+  virtual std::future<void> StartMatlBids(
+      CommodMap<Material>::type& commod_requests) {
+    return std::async(std::launch::async, [this]() {
+      ++*started_;
+      for (int i = 0; i < 500 && *started_ < n_; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      overlapped_ = *started_ >= n_;
+      ready_ = true;
+    });
+  }
+
+  set<BidPortfolio<Material>::Ptr> GetMatlBids(
+      CommodMap<Material>::type& commod_requests) {
+    EXPECT_TRUE(ready_);
+    return Bidder::GetMatlBids(commod_requests);
+  }
+
+  std::atomic<int>* started_;
+  int n_;
+  bool overlapped_;
+  bool ready_;
+};
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// adjusts its children's preferences sparsely, doubling the preference of
+// the first bid of each request it is shown
+class SparseRequester: public Requester {
+ public:
+  SparseRequester(Context* ctx) : Requester(ctx), change_ctr_(0) {}
+
+  virtual cyclus::Agent* Clone() {
+    SparseRequester* m = new SparseRequester(context());
+    m->InitFrom(this);
+    m->port_ = port_;
+    return m;
+  }
+
+  virtual bool ChangeMatlPrefs(const PrefMap<Material>::type& prefs,
+                               PrefChanges<Material>* changes) {
+    PrefMap<Material>::type::const_iterator it;
+    for (it = prefs.begin(); it != prefs.end(); ++it) {
+      const std::map<Bid<Material>*, double>& bids = it->second;
+      changes->Set(it->first, bids.begin()->first, 2 * bids.begin()->second);
+    }
+    // an arc that is not in the exchange is ignored
+    changes->Set(NULL, NULL, 0);
+    change_ctr_++;
+    return true;
+  }
+
+  int change_ctr_;
+};
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 class ResourceExchangeTests: public ::testing::Test {
  protected:
@@ -169,6 +330,84 @@ TEST_F(ResourceExchangeTests, Requests) {
   clone->Decommission();
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ResourceExchangeTests, ParallelRequests) {
+  ThreadSafeRequester safe(tc.get());
+  std::vector<Facility*> clones;
+  std::vector<RequestPortfolio<Material>::Ptr> expected;
+  for (int i = 0; i < 8; i++) {
+    // every other requester is queried serially
+    Requester* r = i % 2 == 0 ?
+                   dynamic_cast<Requester*>(safe.Clone()) :
+                   dynamic_cast<Requester*>(reqr->Clone());
+    RequestPortfolio<Material>::Ptr rp(new RequestPortfolio<Material>());
+    rp->AddRequest(mat, r, commod, pref);
+    r->port_ = rp;
+    r->Build(NULL);
+    clones.push_back(r);
+    expected.push_back(rp);
+  }
+
+  exchng->set_threads(4);
+  EXPECT_EQ(4, exchng->threads());
+  exchng->AddAllRequests();
+
+  // portfolios are merged in trader order regardless of the threads used
+  EXPECT_EQ(expected, exchng->ex_ctx().requests);
+  for (int i = 0; i < clones.size(); i++) {
+    EXPECT_EQ(1, dynamic_cast<Requester*>(clones[i])->req_ctr_);
+    clones[i]->Decommission();
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ResourceExchangeTests, ParallelRequestIds) {
+  std::vector<Facility*> clones;
+  std::vector<IdRequester*> safe;
+  for (int i = 0; i < 8; i++) {
+    // the later a requester, the sooner it is done
+    IdRequester proto(tc.get(), 2 * (8 - i));
+    Requester* r = i % 2 == 0 ?
+                   dynamic_cast<Requester*>(proto.Clone()) :
+                   dynamic_cast<Requester*>(reqr->Clone());
+    RequestPortfolio<Material>::Ptr rp(new RequestPortfolio<Material>());
+    rp->AddRequest(mat, r, commod, pref);
+    r->port_ = rp;
+    r->Build(NULL);
+    clones.push_back(r);
+    if (i % 2 == 0)
+      safe.push_back(dynamic_cast<IdRequester*>(r));
+  }
+
+  // the ids of each run, relative to the first of the run
+  std::vector<std::vector<int> > runs;
+  cyclus::IdAllocator::Scope scope(&tc.get()->ids());
+  for (int run = 0; run < 2; run++) {
+    ResourceExchange<Material> exchange(tc.get());
+    exchange.set_threads(4);
+    exchange.AddAllRequests();
+    std::vector<int> ids;
+    for (int i = 0; i < safe.size(); i++) {
+      ids.insert(ids.end(), safe[i]->ids_.begin(), safe[i]->ids_.end());
+    }
+    ASSERT_EQ(4 * safe.size(), ids.size());
+    // state and object ids each increase in trader order
+    for (int i = 2; i < ids.size(); i++) {
+      EXPECT_LT(ids[i - 2], ids[i]);
+    }
+    int first_state = ids[0];
+    int first_obj = ids[1];
+    for (int i = 0; i < ids.size(); i++) {
+      ids[i] -= i % 2 == 0 ? first_state : first_obj;
+    }
+    runs.push_back(ids);
+  }
+  EXPECT_EQ(runs[0], runs[1]);
+  for (int i = 0; i < clones.size(); i++) {
+    clones[i]->Decommission();
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(ResourceExchangeTests, Bids) {
   ExchangeContext<Material>& ctx = exchng->ex_ctx();
@@ -223,6 +462,85 @@ TEST_F(ResourceExchangeTests, Bids) {
   clone->Decommission();
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ResourceExchangeTests, ParticipatingBidders) {
+  ExchangeContext<Material>& ctx = exchng->ex_ctx();
+  RequestPortfolio<Material>::Ptr rp(new RequestPortfolio<Material>());
+  req = rp->AddRequest(mat, reqr, commod, pref);
+  ctx.AddRequestPortfolio(rp);
+
+  NamedBidder* named = new NamedBidder(tc.get(), commod);
+  NamedBidder* other = new NamedBidder(tc.get(), "other");
+  NamedBidder* product = new NamedBidder(tc.get(), commod, Product::kType);
+  BidPortfolio<Material>::Ptr bp(new BidPortfolio<Material>());
+  bp->AddBid(req, mat, named);
+  named->port_ = bp;
+  other->port_ = BidPortfolio<Material>::Ptr(new BidPortfolio<Material>());
+  product->port_ = other->port_;
+
+  NamedBidder* b1 = dynamic_cast<NamedBidder*>(named->Clone());
+  NamedBidder* b2 = dynamic_cast<NamedBidder*>(other->Clone());
+  NamedBidder* b3 = dynamic_cast<NamedBidder*>(product->Clone());
+  b1->Build(NULL);
+  b2->Build(NULL);
+  b3->Build(NULL);
+  EXPECT_EQ(3, tc.get()->traders().size());
+  EXPECT_EQ(2, tc.get()->traders(Material::kType).size());
+  EXPECT_EQ(1, tc.get()->traders(Product::kType).size());
+  ASSERT_TRUE(tc.get()->bid_commods(b2, Material::kType) != NULL);
+  EXPECT_EQ(1, tc.get()->bid_commods(b2, Material::kType)->count("other"));
+
+  // only the bidder on the commodity requested is asked, and the product
+  // trader not at all
+  exchng->AddAllBids();
+  EXPECT_EQ(1, b1->bid_ctr_);
+  EXPECT_EQ(0, b2->bid_ctr_);
+  EXPECT_EQ(0, b3->bid_ctr_);
+  EXPECT_EQ(1, ctx.bids_by_request[req].size());
+
+  b1->Decommission();
+  b2->Decommission();
+  b3->Decommission();
+  EXPECT_TRUE(tc.get()->traders(Material::kType).empty());
+  EXPECT_TRUE(tc.get()->traders(Product::kType).empty());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ResourceExchangeTests, AsyncBids) {
+  ExchangeContext<Material>& ctx = exchng->ex_ctx();
+  RequestPortfolio<Material>::Ptr rp(new RequestPortfolio<Material>());
+  req = rp->AddRequest(mat, reqr, commod, pref);
+  ctx.AddRequestPortfolio(rp);
+
+  std::atomic<int> started(0);
+  std::vector<Bidder*> clones;
+  std::vector<BidPortfolio<Material>::Ptr> expected;
+  AsyncBidder async(tc.get(), commod, &started, 2);
+  Bidder sync(tc.get(), commod);
+  for (int i = 0; i < 4; i++) {
+    // every other bidder prepares its bids in the background
+    Bidder* b = dynamic_cast<Bidder*>(i % 2 == 0 ? async.Clone() :
+                                                    sync.Clone());
+    b->Build(NULL);
+    b->port_.reset(new BidPortfolio<Material>());
+    b->port_->AddBid(req, mat, b);
+    clones.push_back(b);
+    expected.push_back(b->port_);
+  }
+
+  exchng->AddAllBids();
+
+  // both background preparations ran at once, and bids keep trader order
+  EXPECT_EQ(2, started);
+  EXPECT_EQ(expected, ctx.bids);
+  for (int i = 0; i < clones.size(); i++) {
+    EXPECT_EQ(1, clones[i]->bid_ctr_);
+    if (i % 2 == 0)
+      EXPECT_TRUE(dynamic_cast<AsyncBidder*>(clones[i])->overlapped_);
+    clones[i]->Decommission();
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(ResourceExchangeTests, PrefCalls) {
   Facility* parent = dynamic_cast<Facility*>(reqr->Clone());
@@ -322,3 +640,97 @@ TEST_F(ResourceExchangeTests, PrefValues) {
   child->Decommission();
   parent->Decommission();
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ResourceExchangeTests, SparsePrefChanges) {
+  SparseRequester* sparse = new SparseRequester(tc.get());
+  Facility* parent = dynamic_cast<Facility*>(sparse->Clone());
+  Facility* child = dynamic_cast<Facility*>(reqr->Clone());
+  parent->Build(NULL);
+  child->Build(parent);
+  delete sparse;
+
+  SparseRequester* pcast = dynamic_cast<SparseRequester*>(parent);
+  Requester* ccast = dynamic_cast<Requester*>(child);
+
+  RequestPortfolio<Material>::Ptr rp1(new RequestPortfolio<Material>());
+  Request<Material>* preq = rp1->AddRequest(mat, pcast, commod, pref);
+  pcast->port_ = rp1;
+  RequestPortfolio<Material>::Ptr rp2(new RequestPortfolio<Material>());
+  Request<Material>* creq = rp2->AddRequest(mat, ccast, commod, pref);
+  ccast->port_ = rp2;
+
+  Bidder* bidr = new Bidder(tc.get(), commod);
+  BidPortfolio<Material>::Ptr bp(new BidPortfolio<Material>());
+  Bid<Material>* pbid = bp->AddBid(preq, mat, bidr);
+  Bid<Material>* cbid = bp->AddBid(creq, mat, bidr);
+  bidr->port_ = bp;
+
+  Facility* bclone = dynamic_cast<Facility*>(bidr->Clone());
+  bclone->Build(NULL);
+
+  EXPECT_NO_THROW(exchng->AddAllRequests());
+  EXPECT_NO_THROW(exchng->AddAllBids());
+  EXPECT_NO_THROW(exchng->AdjustAll());
+
+  // the parent's own request is adjusted by its (legacy) trader hook, while
+  // its child's request is squared by the child and doubled by the parent
+  ExchangeContext<Material>& context = exchng->ex_ctx();
+  EXPECT_DOUBLE_EQ(std::pow(pref, 2), context.trader_prefs[parent][preq][pbid]);
+  EXPECT_DOUBLE_EQ(2 * std::pow(pref, 2),
+                   context.trader_prefs[child][creq][cbid]);
+  EXPECT_EQ(1, pcast->change_ctr_);
+  EXPECT_EQ(1, pcast->pref_ctr_);
+  EXPECT_EQ(1, ccast->pref_ctr_);
+  EXPECT_EQ(1, context.trader_prefs[child].size());
+
+  child->Decommission();
+  parent->Decommission();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ResourceExchangeTests, MaxTradeDistance) {
+  Context* ctx = tc.get();
+  Requester* paris = new Requester(ctx);
+  Requester* new_york = new Requester(ctx);
+  Requester* nowhere = new Requester(ctx);
+  ctx->positions().Insert(paris->id(), Position(48.8566, 2.3522));
+  ctx->positions().Insert(new_york->id(), Position(40.7128, -74.0060));
+
+  // portfolios hold the requests of a single requester
+  RequestPortfolio<Material>::Ptr rp(new RequestPortfolio<Material>());
+  Request<Material>* far = rp->AddRequest(mat, new_york, commod, pref);
+  exchng->ex_ctx().AddRequestPortfolio(rp);
+  rp.reset(new RequestPortfolio<Material>());
+  Request<Material>* near = rp->AddRequest(mat, paris, commod, pref);
+  exchng->ex_ctx().AddRequestPortfolio(rp);
+  rp.reset(new RequestPortfolio<Material>());
+  Request<Material>* unplaced = rp->AddRequest(mat, nowhere, commod, pref);
+  exchng->ex_ctx().AddRequestPortfolio(rp);
+
+  Bidder* bidr = new Bidder(ctx, commod);
+  bidr->port_ = BidPortfolio<Material>::Ptr(new BidPortfolio<Material>());
+  Bidder* amsterdam = dynamic_cast<Bidder*>(bidr->Clone());
+  Bidder* roaming = dynamic_cast<Bidder*>(bidr->Clone());
+  amsterdam->Build(NULL);
+  roaming->Build(NULL);
+  ctx->positions().Insert(amsterdam->id(), Position(52.3676, 4.9041));
+
+  ctx->max_trade_distance(1000);
+  EXPECT_DOUBLE_EQ(1000, ctx->max_trade_distance());
+  exchng->AddAllBids();
+
+  // requests keep their order, less those too far away
+  std::vector<Request<Material>*> expected;
+  expected.push_back(near);
+  expected.push_back(unplaced);
+  EXPECT_EQ(expected, amsterdam->offered_);
+  EXPECT_EQ(exchng->ex_ctx().commod_requests[commod], roaming->offered_);
+  EXPECT_EQ(3, roaming->offered_.size());
+  EXPECT_EQ(far, roaming->offered_[0]);
+
+  int id = amsterdam->id();
+  amsterdam->Decommission();
+  EXPECT_FALSE(ctx->positions().Has(id));
+  roaming->Decommission();
+}
@@ -1,6 +1,10 @@
+#include <stdint.h>
+
 #include <gtest/gtest.h>
 
+#include "column_store.h"
 #include "context.h"
+#include "res_tracker.h"
 #include "recorder.h"
 #include "timer.h"
 #include "material.h"
@@ -99,3 +103,50 @@ TEST_F(ResourceTest, ProductExtractGraphid) {
   EXPECT_NE(p1->state_id(), p3->state_id());
 }
 
+
+TEST(ResCoalescerTests, DropsIntermediates) {
+  cyclus::Timer ti;
+  cyclus::Recorder rec;
+  cyclus::ColumnStore store;
+  rec.RegisterBackend(&store);
+  cyclus::Context ctx(&ti, &rec);
+  ctx.coalesce_resources(true);
+  cyclus::Agent* dummy = new Dummy(&ctx);
+
+  cyclus::CompMap v;
+  v[922350000] = 1;
+  cyclus::Composition::Ptr c = cyclus::Composition::CreateFromMass(v);
+  Material::Ptr src = Material::Create(dummy, 10, c);
+  Material::Ptr dst = Material::Create(dummy, 1, c);
+  int src0 = src->state_id();
+  int dst0 = dst->state_id();
+  dst->Absorb(src->ExtractQty(2));
+  dst->Absorb(src->ExtractQty(3));
+  EXPECT_EQ(8, ctx.coalescer()->size());
+
+  // only the creations and the final states of src and dst are kept, and
+  // dst's lineage skips the extracted pieces
+  ctx.coalescer()->Flush(&ctx);
+  EXPECT_EQ(0, ctx.coalescer()->size());
+  rec.Flush();
+  ASSERT_EQ(4, store.nrows("Resources"));
+  EXPECT_EQ(2, store.nrows("ResCreators"));
+  cyclus::ColumnStore::Table& tbl = *store.table("Resources");
+  std::map<std::string, const int64_t*> cols;
+  for (int i = 0; i < tbl.size(); ++i) {
+    if (!tbl[i].boxed()) {
+      cols[tbl[i].name()] =
+          reinterpret_cast<const int64_t*>(&(*tbl[i].buffer())[0]);
+    }
+  }
+  const int64_t* ids = cols["ResourceId"];
+  const int64_t* p1 = cols["Parent1"];
+  const int64_t* p2 = cols["Parent2"];
+  EXPECT_EQ(src->state_id(), ids[2]);
+  EXPECT_EQ(src0, p1[2]);
+  EXPECT_EQ(0, p2[2]);
+  EXPECT_EQ(dst->state_id(), ids[3]);
+  EXPECT_EQ(dst0, p1[3]);
+  EXPECT_EQ(src0, p2[3]);
+  ctx.coalesce_resources(false);
+}
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <boost/uuid/uuid_generators.hpp>
+
 #include "comp_math.h"
 #include "composition.h"
 #include "context.h"
@@ -8,6 +10,7 @@
 #include "pyhooks.h"
 #include "recorder.h"
 #include "sim_init.h"
+#include "sparse_cram.h"
 #include "sqlite_back.h"
 #include "timer.h"
 #include "toolkit/resource_buff.h"
@@ -74,6 +77,7 @@ class Inver : public cy::Facility {
     buf2.PushAll(invs["buf2"]);
     return invs;
   }
+  virtual bool ThreadSafeSnapshot() { return true; }
   virtual void Tick() { context()->Snapshot(); }
   virtual void Tock() {};
 
@@ -102,7 +106,12 @@ class SimInitTest : public ::testing::Test {
         ->AddVal("Solver", std::string("greedy")) // str constructor for macs
         ->AddVal("ExclusiveOrders", true)
         ->Record();
-    ctx->InitSim(cy::SimInfo(5));
+    cy::SimInfo info(5);
+    info.max_trade_distance = 500;
+    info.dre_regions = true;
+    info.dre_coarsen = "proportional";
+    info.sparse_decay = true;
+    ctx->InitSim(info);
 
     cy::CompMap v;
     v[922350000] = 1;
@@ -140,32 +149,63 @@ class SimInitTest : public ::testing::Test {
   }
 
   virtual void TearDown() {
+    // the decay solver is shared by the tests of the process
+    cy::SparseCram::enabled(false);
     rec.Close();
     delete ctx;
     delete b;
   }
 
   void resetnextids() {
-    Agent::next_id_ = 0;
-    cy::Resource::nextstate_id_ = 1;
-    cy::Resource::nextobj_id_ = 1;
     cy::Composition::next_id_ = 1;
-    cy::Product::next_qualid_ = 1;
   }
-  int agentid() { return Agent::next_id_; }
-  int stateid() { return cy::Resource::nextstate_id_; }
-  int objid() { return cy::Resource::nextobj_id_; }
+  int agentid(cy::Context* ctx) {
+    return ctx->ids().next(cy::IdAllocator::AGENT);
+  }
+  int stateid(cy::Context* ctx) {
+    return ctx->ids().next(cy::IdAllocator::RESOURCE_STATE);
+  }
+  int objid(cy::Context* ctx) {
+    return ctx->ids().next(cy::IdAllocator::RESOURCE_OBJ);
+  }
+  int prodid(cy::Context* ctx) {
+    return ctx->ids().next(cy::IdAllocator::PRODUCT_QUALITY);
+  }
   int compid() { return cy::Composition::next_id_; }
-  int prodid() { return cy::Product::next_qualid_; }
   int transid(cy::Context* ctx) { return ctx->trans_id_; }
+  void settime(cy::Timer* ti, int t) { ti->time_ = t; }
+  void setcheckpoints(cy::Timer* ti, int steps) {
+    ti->si_.checkpoint_steps = steps;
+  }
 
   cy::SimInfo siminfo(cy::Context* ctx) { return ctx->si_; }
-  std::set<Agent*> agent_list(cy::Context* ctx) { return ctx->agent_list_; }
-  std::map<int, cy::TimeListener*> tickers(cy::Timer* ti) { return ti->tickers_; }
+  std::set<Agent*> agent_list(cy::Context* ctx) {
+    return std::set<Agent*>(ctx->agents_.all().begin(),
+                            ctx->agents_.all().end());
+  }
+  std::map<int, cy::TimeListener*> tickers(cy::Timer* ti) {
+    std::map<int, cy::TimeListener*> m;
+    for (int i = 0; i < ti->tickers_.size(); i++) {
+      if (ti->tickers_[i] != NULL)
+        m[ti->ticker_ids_[i]] = ti->tickers_[i];
+    }
+    return m;
+  }
 
   std::map<int, std::vector<std::pair<std::string, Agent*> > >
   build_queue(cy::Timer* ti) {
-    return ti->build_queue_;
+    std::map<int, std::vector<std::pair<std::string, Agent*> > > q;
+    std::map<int, std::vector<cy::Timer::BuildBatch> >::iterator it;
+    for (it = ti->build_queue_.begin(); it != ti->build_queue_.end(); ++it) {
+      for (int i = 0; i < it->second.size(); i++) {
+        const cy::Timer::BuildBatch& b = it->second[i];
+        for (int k = 0; k < b.count; k++) {
+          q[it->first].push_back(
+              std::make_pair(ti->proto_names_[b.proto], b.parent));
+        }
+      }
+    }
+    return q;
   }
   std::map<int, std::vector<Agent*> > decom_queue(cy::Timer* ti) {
     return ti->decom_queue_;
@@ -178,30 +218,22 @@ class SimInitTest : public ::testing::Test {
 };
 
 TEST_F(SimInitTest, InitNextIds) {
-  // retrieve next ids from global static vars before overwriting them
-  int agent_id = agentid();
-  int rsrc_state_id = stateid();
-  int rsrc_obj_id = objid();
+  // retrieve the next composition id before overwriting it
   int comp_qual_id = compid();
-  int prod_qual_id = prodid();
-
   resetnextids();
-  ASSERT_EQ(0, agentid());
-  ASSERT_EQ(1, stateid());
-  ASSERT_EQ(1, objid());
   ASSERT_EQ(1, compid());
-  ASSERT_EQ(1, prodid());
 
   cy::SimInit si;
   si.Init(&rec, b);
   cy::Context* init_ctx = si.context();
 
   EXPECT_EQ(transid(ctx), transid(init_ctx));
-  EXPECT_EQ(agent_id, agentid());
-  EXPECT_EQ(rsrc_state_id, stateid());
-  EXPECT_EQ(rsrc_obj_id, objid());
-  EXPECT_EQ(comp_qual_id, compid());
-  EXPECT_EQ(prod_qual_id, prodid());
+  EXPECT_EQ(agentid(ctx), agentid(init_ctx));
+  EXPECT_EQ(stateid(ctx), stateid(init_ctx));
+  EXPECT_EQ(objid(ctx), objid(init_ctx));
+  // composition ids are shared by the process and only move forward
+  EXPECT_LE(comp_qual_id, compid());
+  EXPECT_EQ(prodid(ctx), prodid(init_ctx));
 }
 
 TEST_F(SimInitTest, InitSimInfo) {
@@ -220,6 +252,11 @@ TEST_F(SimInitTest, InitSimInfo) {
   EXPECT_EQ(si_orig.parent_sim, si_init.parent_sim);
   EXPECT_EQ(si_orig.parent_type, si_init.parent_type);
   EXPECT_EQ(si_orig.branch_time, si_init.branch_time);
+  EXPECT_DOUBLE_EQ(500, si_init.max_trade_distance);
+  EXPECT_DOUBLE_EQ(500, init_ctx->max_trade_distance());
+  EXPECT_TRUE(si_init.dre_regions);
+  EXPECT_EQ("proportional", si_init.dre_coarsen);
+  EXPECT_TRUE(si_init.sparse_decay);
 }
 
 TEST_F(SimInitTest, InitRecipes) {
@@ -440,3 +477,238 @@ TEST_F(SimInitTest, RestartSimInfo) {
   EXPECT_EQ("restart", info.parent_type);
   EXPECT_EQ(2, info.branch_time);
 }
+
+TEST_F(SimInitTest, Fork) {
+  cy::PyStart();
+  ti.RunUntil(1);
+  cy::Recorder forkrec;
+  cy::SimInit si;
+  si.Fork(ctx, &forkrec);
+  cy::SimInfo info = si.context()->sim_info();
+
+  EXPECT_EQ(1, si.context()->time());
+  EXPECT_EQ(rec.sim_id(), info.parent_sim);
+  EXPECT_EQ("fork", info.parent_type);
+  EXPECT_EQ(1, info.branch_time);
+  EXPECT_EQ(5, info.duration);
+
+  std::map<int, Agent*> byid;
+  std::map<int, Agent*> fork_byid;
+  std::set<Agent*> agents = agent_list(ctx);
+  std::set<Agent*> fork_agents = agent_list(si.context());
+  std::set<Agent*>::iterator it;
+  for (it = agents.begin(); it != agents.end(); ++it) {
+    byid[(*it)->id()] = *it;
+  }
+  for (it = fork_agents.begin(); it != fork_agents.end(); ++it) {
+    fork_byid[(*it)->id()] = *it;
+  }
+  ASSERT_EQ(4, byid.size());  // 2 deployed, 2 protos
+  ASSERT_EQ(4, fork_byid.size());
+
+  std::map<int, Agent*>::iterator i;
+  for (i = byid.begin(); i != byid.end(); ++i) {
+    Inver* agent = dynamic_cast<Inver*>(i->second);
+    Inver* fork_agent = dynamic_cast<Inver*>(fork_byid[i->first]);
+    ASSERT_TRUE(fork_agent != NULL);
+    EXPECT_NE(agent, fork_agent);
+    EXPECT_EQ(si.context(), fork_agent->context());
+    EXPECT_EQ(agent->val1, fork_agent->val1);
+    EXPECT_EQ(agent->prototype(), fork_agent->prototype());
+    EXPECT_EQ(agent->enter_time(), fork_agent->enter_time());
+    if (agent->enter_time() == -1) {
+      continue;
+    }
+
+    // resources are copied and their compositions shared
+    ASSERT_EQ(agent->buf2.count(), fork_agent->buf2.count());
+    cy::Material::Ptr mat = agent->buf2.Pop<cy::Material>();
+    cy::Material::Ptr fork_mat = fork_agent->buf2.Pop<cy::Material>();
+    EXPECT_NE(mat, fork_mat);
+    EXPECT_EQ(mat->state_id(), fork_mat->state_id());
+    EXPECT_EQ(mat->quantity(), fork_mat->quantity());
+    EXPECT_EQ(mat->comp(), fork_mat->comp());
+  }
+
+  EXPECT_EQ(build_queue(&ti).size(), build_queue(si.timer()).size());
+  EXPECT_EQ(decom_queue(&ti).size(), decom_queue(si.timer()).size());
+
+  // both simulations run on independently
+  EXPECT_NO_THROW(si.timer()->RunSim());
+  EXPECT_NO_THROW(ti.RunSim());
+  cy::PyStop();
+}
+
+TEST_F(SimInitTest, ParallelSnapshot) {
+  std::map<int, int> vals;
+  for (int i = 0; i < 6; ++i) {
+    Inver* a = ctx->CreateAgent<Inver>("proto1");
+    a->val1 = 100 + i;
+    a->Build(NULL);
+    vals[a->id()] = a->val1;
+  }
+
+  setenv("CYCLUS_SNAPSHOT_THREADS", "4", 1);
+  cy::SimInit::Snapshot(ctx);
+  unsetenv("CYCLUS_SNAPSHOT_THREADS");
+  rec.Flush();
+
+  // the agents deployed in SetUp were snapshot once before, and the new ones
+  // once here, each with its own state
+  std::map<int, int> counts;
+  cy::QueryResult qr = b->Query("AgentState_Inver_InverInfo", NULL);
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    int id = qr.GetVal<int>("AgentId", i);
+    counts[id]++;
+    if (vals.count(id) > 0) {
+      EXPECT_EQ(vals[id], qr.GetVal<int>("val1", i));
+    }
+  }
+  std::map<int, int>::iterator it;
+  for (it = vals.begin(); it != vals.end(); ++it) {
+    EXPECT_EQ(1, counts[it->first]);
+  }
+
+  std::vector<cy::Cond> conds;
+  conds.push_back(cy::Cond("AgentId", "==", vals.begin()->first));
+  qr = b->Query("AgentStateInventories", &conds);
+  EXPECT_EQ(3, qr.rows.size());
+}
+
+TEST_F(SimInitTest, DeltaSnapshotRestart) {
+  Inver* same = ctx->CreateAgent<Inver>("proto1");
+  same->val1 = 7;
+  same->Build(NULL);
+  Inver* changed = ctx->CreateAgent<Inver>("proto1");
+  changed->val1 = 8;
+  changed->Build(NULL);
+
+  // the second snapshot records the inventories as references to the first,
+  // and the third finds the state of the unchanged agent as it was recorded
+  // by the second
+  setenv("CYCLUS_DELTA_SNAPSHOTS", "1", 1);
+  for (int t = 1; t <= 3; ++t) {
+    settime(&ti, t);
+    if (t == 3) {
+      changed->val1 = 9;
+    }
+    cy::SimInit::Snapshot(ctx);
+  }
+  unsetenv("CYCLUS_DELTA_SNAPSHOTS");
+  rec.Flush();
+
+  std::vector<cy::Cond> conds;
+  conds.push_back(cy::Cond("AgentId", "==", same->id()));
+  cy::QueryResult qr = b->Query("AgentState_Inver_InverInfo", &conds);
+  EXPECT_EQ(2, qr.rows.size());
+  conds[0] = cy::Cond("AgentId", "==", changed->id());
+  qr = b->Query("AgentState_Inver_InverInfo", &conds);
+  EXPECT_EQ(3, qr.rows.size());
+
+  cy::PyStart();
+  cy::SimInit si;
+  si.Restart(b, rec.sim_id(), 3);
+  std::map<int, Inver*> byid;
+  std::set<Agent*> agents = agent_list(si.context());
+  std::set<Agent*>::iterator it;
+  for (it = agents.begin(); it != agents.end(); ++it) {
+    byid[(*it)->id()] = dynamic_cast<Inver*>(*it);
+  }
+  cy::PyStop();
+
+  ASSERT_TRUE(byid[same->id()] != NULL);
+  ASSERT_TRUE(byid[changed->id()] != NULL);
+  EXPECT_EQ(7, byid[same->id()]->val1);
+  EXPECT_EQ(9, byid[changed->id()]->val1);
+  EXPECT_EQ(1, byid[same->id()]->buf1.count());
+  EXPECT_EQ(2, byid[same->id()]->buf2.count());
+}
+
+TEST_F(SimInitTest, InventoryRefsRestart) {
+  Inver* kept = ctx->CreateAgent<Inver>("proto1");
+  kept->Build(NULL);
+  Inver* moved = ctx->CreateAgent<Inver>("proto1");
+  moved->Build(NULL);
+
+  setenv("CYCLUS_DELTA_SNAPSHOTS", "1", 1);
+  settime(&ti, 1);
+  cy::SimInit::Snapshot(ctx);
+  moved->buf2.Pop<cy::Material>();
+  settime(&ti, 2);
+  cy::SimInit::Snapshot(ctx);
+  unsetenv("CYCLUS_DELTA_SNAPSHOTS");
+  rec.Flush();
+
+  // both inventories of the kept agent refer back to the first snapshot,
+  // but only the unchanged one of the other agent does
+  std::vector<cy::Cond> conds;
+  conds.push_back(cy::Cond("SimTime", "==", 2));
+  conds.push_back(cy::Cond("AgentId", "==", kept->id()));
+  cy::QueryResult qr = b->Query("AgentStateInventoryRefs", &conds);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(1, qr.GetVal<int>("StateTime", 0));
+  EXPECT_EQ(1, qr.GetVal<int>("StateTime", 1));
+  conds[1] = cy::Cond("AgentId", "==", moved->id());
+  qr = b->Query("AgentStateInventoryRefs", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ("buf1", qr.GetVal<std::string>("InventoryName"));
+  qr = b->Query("AgentStateInventories", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ("buf2", qr.GetVal<std::string>("InventoryName"));
+
+  cy::PyStart();
+  cy::SimInit si;
+  si.Restart(b, rec.sim_id(), 2);
+  std::map<int, Inver*> byid;
+  std::set<Agent*> agents = agent_list(si.context());
+  std::set<Agent*>::iterator it;
+  for (it = agents.begin(); it != agents.end(); ++it) {
+    byid[(*it)->id()] = dynamic_cast<Inver*>(*it);
+  }
+  cy::PyStop();
+
+  Inver* pairs[2][2] = {{kept, byid[kept->id()]}, {moved, byid[moved->id()]}};
+  for (int i = 0; i < 2; ++i) {
+    Inver* agent = pairs[i][0];
+    Inver* init_agent = pairs[i][1];
+    ASSERT_TRUE(init_agent != NULL);
+    ASSERT_EQ(agent->buf1.count(), init_agent->buf1.count());
+    ASSERT_EQ(agent->buf2.count(), init_agent->buf2.count());
+    cy::Inventories invs = agent->SnapshotInv();
+    cy::Inventories init_invs = init_agent->SnapshotInv();
+    cy::Inventories::iterator inv;
+    for (inv = invs.begin(); inv != invs.end(); ++inv) {
+      for (int j = 0; j < inv->second.size(); ++j) {
+        cy::Resource::Ptr r = inv->second[j];
+        cy::Resource::Ptr init_r = init_invs[inv->first][j];
+        EXPECT_EQ(r->state_id(), init_r->state_id());
+        EXPECT_DOUBLE_EQ(r->quantity(), init_r->quantity());
+      }
+    }
+  }
+  EXPECT_EQ(1, byid[moved->id()]->buf2.count());
+}
+
+TEST_F(SimInitTest, RestartLatestCheckpoint) {
+  cy::PyStart();
+  setcheckpoints(&ti, 2);
+  ti.RunSim();
+  rec.Flush();
+
+  // only checkpoints count, not the snapshots the agents or the end of the
+  // simulation asked for
+  boost::uuids::uuid simid = boost::uuids::nil_uuid();
+  int t = cy::SimInit::LatestCheckpoint(b, &simid);
+  EXPECT_EQ(4, t);
+  EXPECT_EQ(rec.sim_id(), simid);
+  simid = rec.sim_id();
+  EXPECT_EQ(4, cy::SimInit::LatestCheckpoint(b, &simid));
+  simid = boost::uuids::random_generator()();
+  EXPECT_EQ(-1, cy::SimInit::LatestCheckpoint(b, &simid));
+
+  cy::SimInit si;
+  si.Restart(b, rec.sim_id(), t);
+  EXPECT_EQ(4, si.context()->time());
+  EXPECT_NO_THROW(si.timer()->RunSim());
+  cy::PyStop();
+}
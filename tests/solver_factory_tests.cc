@@ -145,6 +145,31 @@ TEST_F(SolverFactoryTests, Cbc) {
   EXPECT_DOUBLE_EQ(mip_obj_, si->getObjValue());
 }
 
+TEST_F(SolverFactoryTests, CbcOptions) {
+  if (!Env::allow_milps()) {
+    std::cout << "[  SKIPPED ] MILPS have been disabled.\n";
+    return;
+  }
+  sf_.solver_t("cbc");
+  OsiSolverInterface* si = sf_.get();
+  CoinMessageHandler h;
+  h.setLogLevel(0);
+  si->passInMessageHandler(&h);
+  Init(si);
+  si->setInteger(1);  // y
+  si->setInteger(2);  // z
+  CbcOptions opts;
+  opts.threads = 2;
+  opts.seconds = 60;
+  opts.gap = 0;
+  opts.presolve = false;
+  SolveProg(si, si->getInfinity(), false, false, NULL, opts);
+  const double* exp = &mip_exp_[0];
+  array_double_eq(&exp[0], si->getColSolution(), n_vars_);
+  EXPECT_DOUBLE_EQ(mip_obj_, si->getObjValue());
+  delete si;
+}
+
 TEST_F(SolverFactoryTests, CbcRedundant) {
   if (!Env::allow_milps()) {
     std::cout << "[  SKIPPED ] MILPS have been disabled.\n";
@@ -0,0 +1,92 @@
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "sparse_cram.h"
+
+using cyclus::SparseCram;
+
+namespace {
+
+// Returns the solver for the chain 0 -> 1 -> 2 with decay constants l0 and
+// l1, with the nuclides numbered backwards so that the chain isn't already
+// in parents first order.
+SparseCram Chain(double l0, double l1) {
+  std::vector<int> rows;
+  std::vector<int> cols;
+  std::vector<double> vals;
+  rows.push_back(2); cols.push_back(2); vals.push_back(-l0);
+  rows.push_back(1); cols.push_back(2); vals.push_back(l0);
+  rows.push_back(1); cols.push_back(1); vals.push_back(-l1);
+  rows.push_back(0); cols.push_back(1); vals.push_back(l1);
+  rows.push_back(0); cols.push_back(2); vals.push_back(0);
+  return SparseCram(3, rows, cols, vals);
+}
+
+}  // namespace
+
+TEST(SparseCramTests, Bateman) {
+  double l0 = 1e-3;
+  double l1 = 4e-4;
+  SparseCram s = Chain(l0, l1);
+  EXPECT_EQ(3, s.n());
+  EXPECT_EQ(5, s.nnz());
+
+  double t = 2500;
+  double n0[3] = {0, 0, 1};
+  double n1[3];
+  s.Expm(t, 1, n0, n1);
+
+  double e0 = std::exp(-l0 * t);
+  double e1 = std::exp(-l1 * t);
+  double parent = e0;
+  double daughter = l0 / (l1 - l0) * (e0 - e1);
+  EXPECT_NEAR(parent, n1[2], 1e-13);
+  EXPECT_NEAR(daughter, n1[1], 1e-13);
+  EXPECT_NEAR(1 - parent - daughter, n1[0], 1e-13);
+}
+
+TEST(SparseCramTests, Stiff) {
+  // a short lived daughter of a long lived parent stays in equilibrium
+  double l0 = 1e-9;
+  double l1 = 1e6;
+  SparseCram s = Chain(l0, l1);
+  double n0[3] = {0, 0, 1};
+  double n1[3];
+  s.Expm(3.15e7, 1, n0, n1);
+  EXPECT_NEAR(std::exp(-l0 * 3.15e7), n1[2], 1e-13);
+  EXPECT_NEAR(n1[2] * l0 / l1, n1[1], 1e-13);
+  EXPECT_NEAR(1, n1[0] + n1[1] + n1[2], 1e-13);
+}
+
+TEST(SparseCramTests, Batch) {
+  SparseCram s = Chain(1e-3, 4e-4);
+  double t = 1000;
+  double n0[6] = {0.5, 0, 0, 2, 1, 3};
+  double n1[6];
+  s.Expm(t, 2, n0, n1);
+
+  for (int v = 0; v < 2; ++v) {
+    double a[3] = {n0[v], n0[2 + v], n0[4 + v]};
+    double b[3];
+    s.Expm(t, 1, a, b);
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_DOUBLE_EQ(b[i], n1[2 * i + v]);
+    }
+  }
+}
+
+TEST(SparseCramTests, Errors) {
+  std::vector<int> rows(2);
+  std::vector<int> cols(2);
+  std::vector<double> vals(2, 1);
+  rows[0] = 0; cols[0] = 1;
+  rows[1] = 1; cols[1] = 0;
+  EXPECT_THROW(SparseCram(2, rows, cols, vals), cyclus::ValueError);
+  rows[1] = 2;
+  EXPECT_THROW(SparseCram(2, rows, cols, vals), cyclus::ValueError);
+  rows.pop_back();
+  EXPECT_THROW(SparseCram(2, rows, cols, vals), cyclus::ValueError);
+}
@@ -1,9 +1,12 @@
+#include <thread>
+
 #include "boost/lexical_cast.hpp"
 #include <boost/uuid/uuid_io.hpp>
 #include <gtest/gtest.h>
 
 #include "blob.h"
 #include "sqlite_back.h"
+#include "table_writer.h"
 
 #include "tools.h"
 
@@ -576,3 +579,503 @@ TEST_F(SqliteBackTests, ListPairIntInt) {
   EXPECT_EQ(std::make_pair(4, 2), l.front());
   EXPECT_EQ(std::make_pair(5, 3), l.back());
 }
+
+TEST_F(SqliteBackTests, BinaryFormatDefault) {
+  EXPECT_EQ(cyclus::kSqliteBinaryFormat, b->format_version());
+
+  std::map<std::string, std::vector<double> > m;
+  m["one"].push_back(1.5);
+  m["one"].push_back(-2.25);
+  m["two"];
+  r.NewDatum("foo")->AddVal("bar", m)->Record();
+  r.Close();
+
+  cyclus::QueryResult qr = b->Query("foo", NULL);
+  EXPECT_EQ(m, (qr.GetVal<std::map<std::string, std::vector<double> > >("bar")));
+}
+
+TEST(SqliteBackFormatTests, LegacyXmlFormat) {
+  std::string fpath = "sqlite_back_legacy_xml.sqlite";
+  FileDeleter fd(fpath);
+
+  // a database with a FieldTypes table but no user_version was written by a
+  // version of cyclus that predates the binary encoding.
+  {
+    cyclus::SqliteDb db(fpath);
+    db.open();
+    db.Execute("CREATE TABLE FieldTypes (TableName TEXT,Field TEXT,"
+               "Type INTEGER);");
+    db.close();
+  }
+
+  std::vector<int> v;
+  v.push_back(4);
+  v.push_back(2);
+  {
+    cyclus::Recorder rec;
+    cyclus::SqliteBack back(fpath);
+    EXPECT_EQ(cyclus::kSqliteXmlFormat, back.format_version());
+    rec.RegisterBackend(&back);
+    rec.NewDatum("foo")->AddVal("bar", v)->Record();
+    rec.Close();
+  }
+
+  cyclus::SqliteBack back(fpath);
+  EXPECT_EQ(cyclus::kSqliteXmlFormat, back.format_version());
+  cyclus::QueryResult qr = back.Query("foo", NULL);
+  EXPECT_EQ(v, qr.GetVal<std::vector<int> >("bar"));
+
+  cyclus::SqlStatement::Ptr stmt = back.db().Prepare("SELECT bar FROM foo;");
+  ASSERT_TRUE(stmt->Step());
+  std::string raw = stmt->GetText(0, NULL);
+  EXPECT_NE(std::string::npos, raw.find("<vect"));
+}
+
+TEST_F(SqliteBackTests, Projection) {
+  using cyclus::Cond;
+  using cyclus::QueryResult;
+  for (int i = 0; i < 4; ++i) {
+    r.NewDatum("monty")
+        ->AddVal("a", i)
+        ->AddVal("b", 2.0 * i)
+        ->AddVal("c", std::string("spam"))
+        ->Record();
+  }
+  r.Close();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("b", ">=", 4.0));
+  std::vector<std::string> fields;
+  fields.push_back("c");
+  fields.push_back("a");
+  QueryResult qr = b->Query("monty", &conds, &fields);
+  EXPECT_EQ(fields, qr.fields);
+  ASSERT_EQ(2, qr.types.size());
+  EXPECT_EQ(cyclus::STRING, qr.types[0]);
+  EXPECT_EQ(cyclus::INT, qr.types[1]);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(2, qr.rows[0].size());
+  EXPECT_EQ("spam", qr.GetVal<std::string>("c", 0));
+  EXPECT_EQ(2, qr.GetVal<int>("a", 0));
+  EXPECT_EQ(3, qr.GetVal<int>("a", 1));
+
+  // injectors pass the projection through to the wrapped backend
+  std::vector<Cond> inject;
+  inject.push_back(Cond("a", "==", 1));
+  cyclus::CondInjector ci(b, inject);
+  qr = ci.Query("monty", NULL, &fields);
+  EXPECT_EQ(fields, qr.fields);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(1, qr.GetVal<int>("a"));
+  cyclus::PrefixInjector pi(b, "mon");
+  qr = pi.Query("ty", &conds, &fields);
+  EXPECT_EQ(fields, qr.fields);
+  EXPECT_EQ(2, qr.rows.size());
+
+  fields.push_back("eggs");
+  EXPECT_THROW(b->Query("monty", NULL, &fields), cyclus::KeyError);
+}
+
+TEST_F(SqliteBackTests, Cursor) {
+  using cyclus::Cond;
+  using cyclus::QueryCursor;
+  using cyclus::QueryResult;
+  for (int i = 0; i < 5; ++i) {
+    r.NewDatum("monty")
+        ->AddVal("a", i)
+        ->AddVal("b", std::string("spam"))
+        ->Record();
+  }
+  r.Close();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("a", ">=", 1));
+  std::vector<std::string> fields;
+  fields.push_back("a");
+  QueryCursor::Ptr cur = b->Cursor("monty", &conds, &fields);
+  QueryResult qr = cur->Next(3);
+  EXPECT_EQ(fields, qr.fields);
+  ASSERT_EQ(3, qr.rows.size());
+  EXPECT_EQ(1, qr.GetVal<int>("a", 0));
+  EXPECT_EQ(3, qr.GetVal<int>("a", 2));
+  qr = cur->Next(3);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(4, qr.GetVal<int>("a", 0));
+  qr = cur->Next(3);
+  EXPECT_EQ(fields, qr.fields);
+  EXPECT_EQ(0, qr.rows.size());
+  EXPECT_EQ(0, cur->Next(3).rows.size());
+
+  // injectors return cursors from the wrapped backend
+  std::vector<Cond> inject;
+  inject.push_back(Cond("a", "<", 3));
+  cyclus::CondInjector ci(b, inject);
+  EXPECT_EQ(2, ci.Cursor("monty", &conds, NULL)->Next(10).rows.size());
+}
+
+TEST_F(SqliteBackTests, BatchedInsert) {
+  using cyclus::QueryResult;
+  EXPECT_EQ(cyclus::kSqliteBatchRows, b->batch_rows());
+  b->set_batch_rows(3);
+  EXPECT_EQ(3, b->batch_rows());
+
+  // one full batch per table plus remainders of different sizes
+  for (int i = 0; i < 10; ++i) {
+    r.NewDatum(i % 3 == 0 ? "eggs" : "spam")
+        ->AddVal("a", i)
+        ->AddVal("b", std::string("x"))
+        ->Record();
+  }
+  r.Close();
+
+  QueryResult qr = b->Query("spam", NULL);
+  ASSERT_EQ(6, qr.rows.size());
+  int spam[] = {1, 2, 4, 5, 7, 8};
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(spam[i], qr.GetVal<int>("a", i));
+  }
+  qr = b->Query("eggs", NULL);
+  ASSERT_EQ(4, qr.rows.size());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(3 * i, qr.GetVal<int>("a", i));
+  }
+
+  b->set_batch_rows(0);
+  EXPECT_EQ(1, b->batch_rows());
+}
+
+static std::set<std::string> Indexes(cyclus::SqliteBack* b) {
+  std::set<std::string> names;
+  cyclus::SqlStatement::Ptr stmt = b->db().Prepare(
+      "SELECT name FROM sqlite_master WHERE type='index';");
+  while (stmt->Step()) {
+    names.insert(stmt->GetText(0, NULL));
+  }
+  return names;
+}
+
+TEST_F(SqliteBackTests, Indexes) {
+  EXPECT_EQ(cyclus::SqliteBack::DefaultIndexTables(), b->index_tables());
+  std::set<std::string> tables;
+  tables.insert("Resources");
+  tables.insert("AgentState*");
+  b->index_tables(tables);
+
+  r.NewDatum("Resources")
+      ->AddVal("ResourceId", 1)
+      ->AddVal("Time", 2)
+      ->AddVal("Quantity", 3.0)
+      ->Record();
+  r.NewDatum("AgentStateFooInfo")
+      ->AddVal("AgentId", 4)
+      ->AddVal("SimTime", 5)
+      ->Record();
+  r.NewDatum("Other")
+      ->AddVal("AgentId", 6)
+      ->Record();
+  r.Flush();
+
+  // indexes are deferred until the backend is closed
+  EXPECT_EQ(0, Indexes(b).size());
+  b->Close();
+  std::set<std::string> idx = Indexes(b);
+  EXPECT_EQ(4, idx.size());
+  EXPECT_EQ(1, idx.count("Resources_ResourceId_idx"));
+  EXPECT_EQ(1, idx.count("Resources_Time_idx"));
+  EXPECT_EQ(1, idx.count("AgentStateFooInfo_AgentId_idx"));
+  EXPECT_EQ(1, idx.count("AgentStateFooInfo_SimTime_idx"));
+
+  // indexing an existing database
+  tables.insert("Other");
+  b->index_tables(tables);
+  b->CreateIndexes();
+  EXPECT_EQ(1, Indexes(b).count("Other_AgentId_idx"));
+  EXPECT_EQ(5, Indexes(b).size());
+}
+
+TEST_F(SqliteBackTests, IndexOnCreate) {
+  b->index_on_create(true);
+  r.NewDatum("Transactions")
+      ->AddVal("TransactionId", 1)
+      ->Record();
+  r.NewDatum("Other")
+      ->AddVal("AgentId", 2)
+      ->Record();
+  r.Flush();
+  std::set<std::string> idx = Indexes(b);
+  EXPECT_EQ(1, idx.size());
+  EXPECT_EQ(1, idx.count("Transactions_TransactionId_idx"));
+
+  b->index_tables(std::set<std::string>());
+  b->CreateIndexes();
+  EXPECT_EQ(1, Indexes(b).size());
+}
+
+TEST(SqliteBackReadOnlyTests, ConcurrentReaders) {
+  std::string fpath = "sqlite_back_readonly.sqlite";
+  FileDeleter fd(fpath);
+  EXPECT_THROW(cyclus::SqliteBack(fpath, true), cyclus::IOError);
+
+  {
+    cyclus::Recorder rec;
+    cyclus::SqliteBack back(fpath);
+    rec.RegisterBackend(&back);
+    for (int i = 0; i < 100; ++i) {
+      rec.NewDatum("monty")->AddVal("a", i)->Record();
+    }
+    rec.Close();
+  }
+
+  cyclus::SqliteBack back(fpath, true);
+  EXPECT_TRUE(back.readonly());
+  cyclus::Recorder rec;
+  rec.RegisterBackend(&back);
+  rec.NewDatum("monty")->AddVal("a", 100)->Record();
+  EXPECT_THROW(rec.Flush(), cyclus::IOError);
+
+  int counts[4];
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(std::thread([&back, &counts, t]() {
+      std::vector<cyclus::Cond> conds;
+      conds.push_back(cyclus::Cond("a", ">=", t * 10));
+      counts[t] = back.Query("monty", &conds).rows.size();
+    }));
+  }
+  for (int t = 0; t < 4; ++t) {
+    threads[t].join();
+    EXPECT_EQ(100 - t * 10, counts[t]);
+  }
+  EXPECT_EQ(100, back.Query("monty", NULL).rows.size());
+
+  // copies share the connections of the reading threads, which outlive them
+  std::thread reader([&back, &counts]() {
+    counts[0] = back.Query("monty", NULL).rows.size();
+    { cyclus::SqliteBack copy = back; }
+    counts[1] = back.Query("monty", NULL).rows.size();
+  });
+  reader.join();
+  EXPECT_EQ(100, counts[0]);
+  EXPECT_EQ(100, counts[1]);
+}
+
+TEST_F(SqliteBackTests, Aggregate) {
+  using cyclus::Agg;
+  using cyclus::Cond;
+  using cyclus::QueryResult;
+  for (int i = 0; i < 10; ++i) {
+    r.NewDatum("monty")
+        ->AddVal("a", i)
+        ->AddVal("b", std::string(i % 2 == 0 ? "even" : "odd"))
+        ->AddVal("c", 0.5 * i)
+        ->Record();
+  }
+  r.Flush();
+
+  std::vector<Agg> aggs;
+  aggs.push_back(Agg("count"));
+  aggs.push_back(Agg("sum", "c"));
+  aggs.push_back(Agg("min", "a"));
+  aggs.push_back(Agg("max", "b"));
+  std::vector<std::string> group_by;
+  group_by.push_back("b");
+  std::vector<Cond> conds;
+  conds.push_back(Cond("a", ">", 2));
+  QueryResult qr = b->Aggregate("monty", &conds, &group_by, aggs);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ("even", qr.GetVal<std::string>("b", 0));
+  EXPECT_EQ(3, qr.GetVal<int>("count", 0));
+  EXPECT_DOUBLE_EQ(9, qr.GetVal<double>("sum(c)", 0));
+  EXPECT_EQ(4, qr.GetVal<int>("min(a)", 0));
+  EXPECT_EQ("odd", qr.GetVal<std::string>("b", 1));
+  EXPECT_EQ(4, qr.GetVal<int>("count", 1));
+  EXPECT_EQ("odd", qr.GetVal<std::string>("max(b)", 1));
+
+  // the same as aggregating the rows of a query
+  cyclus::Aggregator agg(group_by, aggs, b->ColumnTypes("monty"));
+  std::vector<std::string> fields = agg.fields();
+  QueryResult rows = b->Query("monty", &conds, &fields);
+  for (int i = 0; i < rows.rows.size(); ++i) {
+    agg.Add(rows.rows[i]);
+  }
+  QueryResult want = agg.Result();
+  EXPECT_EQ(want.fields, qr.fields);
+  EXPECT_EQ(want.types, qr.types);
+
+  qr = b->Aggregate("monty", NULL, NULL, aggs);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(10, qr.GetVal<int>("count"));
+  EXPECT_DOUBLE_EQ(22.5, qr.GetVal<double>("sum(c)"));
+  conds[0] = Cond("a", ">", 20);
+  EXPECT_EQ(0, b->Aggregate("monty", &conds, NULL, aggs).rows.size());
+}
+
+TEST_F(SqliteBackTests, CompactOutput) {
+  cyclus::CoreTables tables(&r, true);
+  tables.resources.Record(5, 5, "Material", 1, 2.5, "kg", 7, 0, 0);
+  tables.resources.Record(8, 5, "Material", 2, 1.5, "kg", 7, 5, 0);
+  tables.resources.Record(9, 9, "Product", 2, 3.0, "tons", 11, 8, 6);
+  int ids[] = {1, 2};
+  int senders[] = {20, 21};
+  int receivers[] = {30, 31};
+  int rsrcs[] = {8, 9};
+  std::string commods[] = {"fuel", "fuel"};
+  int times[] = {2, 2};
+  tables.transactions.RecordColumns(2, ids, senders, receivers, rsrcs,
+                                    commods, times);
+  r.Flush();
+
+  std::set<std::string> names = b->Tables();
+  EXPECT_EQ(1, names.count("CompactResources"));
+  EXPECT_EQ(1, names.count("Resources"));
+  EXPECT_EQ(1, names.count("Transactions"));
+  EXPECT_EQ(2, b->Query("ResourceTypes", NULL).rows.size());
+  EXPECT_EQ(1, b->Query("Commodities", NULL).rows.size());
+
+  // the views and the expander rebuild the same classic rows
+  cyclus::CompactExpander x(b);
+  cyclus::QueryableBackend* backs[] = {b, &x};
+  for (int k = 0; k < 2; ++k) {
+    cyclus::QueryableBackend* q = backs[k];
+    std::vector<cyclus::Cond> conds;
+    conds.push_back(cyclus::Cond("Parent1", ">", 0));
+    cyclus::QueryResult qr = q->Query("Resources", &conds);
+    ASSERT_EQ(2, qr.rows.size());
+    EXPECT_EQ(8, qr.GetVal<int>("ResourceId", 0));
+    EXPECT_EQ(5, qr.GetVal<int>("ObjId", 0));
+    EXPECT_EQ("Material", qr.GetVal<std::string>("Type", 0));
+    EXPECT_EQ("kg", qr.GetVal<std::string>("Units", 0));
+    EXPECT_EQ(5, qr.GetVal<int>("Parent1", 0));
+    EXPECT_EQ(0, qr.GetVal<int>("Parent2", 0));
+    EXPECT_EQ(9, qr.GetVal<int>("ObjId", 1));
+    EXPECT_EQ("Product", qr.GetVal<std::string>("Type", 1));
+    EXPECT_EQ("tons", qr.GetVal<std::string>("Units", 1));
+    EXPECT_DOUBLE_EQ(3.0, qr.GetVal<double>("Quantity", 1));
+    EXPECT_EQ(6, qr.GetVal<int>("Parent2", 1));
+    EXPECT_EQ(cyclus::STRING, q->ColumnTypes("Resources")["Type"]);
+
+    qr = q->Query("Transactions", NULL);
+    ASSERT_EQ(2, qr.rows.size());
+    EXPECT_EQ("fuel", qr.GetVal<std::string>("Commodity", 1));
+    EXPECT_EQ(31, qr.GetVal<int>("ReceiverId", 1));
+
+    if (k == 0) {
+      b->db().Execute("DROP VIEW Resources;");
+      b->db().Execute("DROP VIEW Transactions;");
+    }
+  }
+  EXPECT_EQ(0, b->Tables().count("Resources"));
+  EXPECT_EQ(1, x.Tables().count("Resources"));
+}
+
+TEST_F(SqliteBackTests, LineageIndex) {
+  b->index_lineage(true);
+  cyclus::CoreTables tables(&r, true);
+  // 1 is split into 2 and 3, 2 is combined with 4 into 5, which is split
+  // into 6 and, on another page, 3000
+  tables.resources.Record(1, 1, "Material", 0, 4.0, "kg", 7, 0, 0);
+  tables.resources.Record(2, 1, "Material", 1, 1.0, "kg", 7, 1, 0);
+  tables.resources.Record(3, 3, "Material", 1, 3.0, "kg", 7, 1, 0);
+  tables.resources.Record(4, 4, "Material", 1, 2.0, "kg", 7, 0, 0);
+  tables.resources.Record(5, 1, "Material", 2, 3.0, "kg", 7, 2, 4);
+  tables.resources.Record(6, 1, "Material", 3, 1.0, "kg", 7, 5, 0);
+  tables.resources.Record(3000, 3000, "Material", 3, 2.0, "kg", 7, 5, 0);
+  int ids[] = {1, 2, 3};
+  int senders[] = {20, 21, 22};
+  int receivers[] = {30, 31, 32};
+  int rsrcs[] = {2, 5, 3000};
+  std::string commods[] = {"fuel", "fuel", "fuel"};
+  int times[] = {1, 2, 3};
+  tables.transactions.RecordColumns(3, ids, senders, receivers, rsrcs,
+                                    commods, times);
+  r.Flush();
+
+  // the Resources and Transactions tables are traversed until the index is
+  // written, which gives the same lineage
+  for (int k = 0; k < 2; ++k) {
+    EXPECT_EQ(k, b->Tables().count("LineageIndex"));
+    cyclus::Lineage l = b->Ancestors(6, -1, NULL);
+    ASSERT_EQ(4, l.resources.size());
+    EXPECT_EQ(5, l.resources[0]);
+    EXPECT_EQ(1, l.depths[0]);
+    EXPECT_EQ(2, l.resources[1]);
+    EXPECT_EQ(4, l.resources[2]);
+    EXPECT_EQ(2, l.depths[2]);
+    EXPECT_EQ(1, l.resources[3]);
+    EXPECT_EQ(3, l.depths[3]);
+    ASSERT_EQ(2, l.transactions.size());
+    EXPECT_EQ(1, l.transactions[0]);
+    EXPECT_EQ(2, l.transactions[1]);
+
+    l = b->Ancestors(6, 1, NULL);
+    ASSERT_EQ(1, l.resources.size());
+    EXPECT_EQ(std::vector<int>(1, 2), l.transactions);
+
+    l = b->Descendants(1, -1, NULL);
+    ASSERT_EQ(5, l.resources.size());
+    EXPECT_EQ(2, l.resources[0]);
+    EXPECT_EQ(3, l.resources[1]);
+    EXPECT_EQ(5, l.resources[2]);
+    EXPECT_EQ(6, l.resources[3]);
+    EXPECT_EQ(3000, l.resources[4]);
+    EXPECT_EQ(3, l.depths[4]);
+    EXPECT_EQ(3, l.transactions.size());
+
+    EXPECT_EQ(0, b->Descendants(3000, -1, NULL).resources.size());
+    if (k == 0) {
+      b->Close();
+    }
+  }
+  cyclus::QueryResult qr = b->Query("LineageIndex", NULL);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(0, qr.GetVal<int>("Page", 0));
+  EXPECT_EQ(6, qr.GetVal<int>("Resources", 0));
+  EXPECT_EQ(2, qr.GetVal<int>("Page", 1));
+  EXPECT_EQ(1, qr.GetVal<int>("Resources", 1));
+}
+
+TEST_F(SqliteBackTests, DenseOutput) {
+  cyclus::CoreTables tables(&r, false, true);
+  std::vector<cyclus::Nuc> nucs;
+  std::vector<double> fracs;
+  nucs.push_back(922350000);
+  fracs.push_back(0.25);
+  nucs.push_back(922380000);
+  fracs.push_back(0.75);
+  tables.compositions.Record(3, nucs, fracs);
+  cyclus::CompMap mass;
+  mass[922380000] = 2.0;
+  mass[942390000] = 1.0;
+  tables.explicit_inventory.Record(7, 1, "core", mass);
+  tables.explicit_inventory.Record(7, 2, "core", cyclus::CompMap());
+  r.Flush();
+
+  std::set<std::string> names = b->Tables();
+  EXPECT_EQ(1, names.count("DenseCompositions"));
+  EXPECT_EQ(0, names.count("Compositions"));
+  EXPECT_EQ(3, b->Query("NuclideIndex", NULL).rows.size());
+
+  // the classic tables are rebuilt, a row per nuclide
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("QualId", "==", 3));
+  conds.push_back(cyclus::Cond("MassFrac", ">", 0.5));
+  cyclus::QueryResult qr = b->Query("Compositions", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(922380000, qr.GetVal<int>("NucId"));
+  EXPECT_DOUBLE_EQ(0.75, qr.GetVal<double>("MassFrac"));
+  EXPECT_EQ(cyclus::DOUBLE, b->ColumnTypes("Compositions")["MassFrac"]);
+
+  qr = b->Query("ExplicitInventory", NULL);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(7, qr.GetVal<int>("AgentId", 0));
+  EXPECT_EQ("core", qr.GetVal<std::string>("InventoryName", 0));
+  EXPECT_EQ(922380000, qr.GetVal<int>("NucId", 0));
+  EXPECT_DOUBLE_EQ(2.0, qr.GetVal<double>("Quantity", 0));
+  EXPECT_EQ(942390000, qr.GetVal<int>("NucId", 1));
+  EXPECT_DOUBLE_EQ(1.0, qr.GetVal<double>("Quantity", 1));
+
+  std::vector<cyclus::Agg> aggs;
+  aggs.push_back(cyclus::Agg("sum", "Quantity"));
+  qr = b->Aggregate("ExplicitInventory", NULL, NULL, aggs);
+  EXPECT_DOUBLE_EQ(3.0, qr.GetVal<double>("sum(Quantity)"));
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "recorder.h"
+#include "staging_back.h"
+
+using cyclus::Cond;
+using cyclus::DatumList;
+using cyclus::QueryResult;
+using cyclus::Recorder;
+using cyclus::StagingBack;
+
+TEST(StagingBackTests, QueriesStagedData) {
+  Recorder r;
+  DatumList staged;
+  r.StartStaging(&staged);
+  for (int i = 0; i < 4; ++i) {
+    r.NewDatum("Widgets")
+        ->AddVal("AgentId", i % 2)
+        ->AddVal("Name", std::string(i < 2 ? "a" : "b"))
+        ->Record();
+  }
+  r.NewDatum("Gadgets")->AddVal("Mass", 1.5)->Record();
+  r.StopStaging();
+
+  StagingBack b(&staged);
+  EXPECT_EQ(2, b.Tables().size());
+  EXPECT_EQ(cyclus::INT, b.ColumnTypes("Widgets")["AgentId"]);
+  EXPECT_EQ(cyclus::STRING, b.ColumnTypes("Widgets")["Name"]);
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("SimId", "==", r.sim_id()));
+  conds.push_back(Cond("AgentId", "==", 1));
+  QueryResult qr = b.Query("Widgets", &conds);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ("a", qr.GetVal<std::string>("Name", 0));
+  EXPECT_EQ("b", qr.GetVal<std::string>("Name", 1));
+
+  conds.push_back(Cond("Name", "!=", std::string("a")));
+  EXPECT_EQ(1, b.Query("Widgets", &conds).rows.size());
+  EXPECT_DOUBLE_EQ(1.5, b.Query("Gadgets", NULL).GetVal<double>("Mass"));
+  EXPECT_TRUE(b.Query("Sprockets", NULL).rows.empty());
+
+  std::vector<Cond> bad;
+  bad.push_back(Cond("Bogus", "==", 1));
+  EXPECT_THROW(b.Query("Widgets", &bad), cyclus::KeyError);
+
+  r.Discard(&staged);
+  EXPECT_TRUE(staged.empty());
+}
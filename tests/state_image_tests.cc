@@ -0,0 +1,125 @@
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "blob.h"
+#include "error.h"
+#include "recorder.h"
+#include "state_image.h"
+
+using cyclus::DatumList;
+using cyclus::QueryResult;
+using cyclus::Recorder;
+using cyclus::StateImage;
+using cyclus::StateImageWriter;
+
+TEST(StateImageTests, RoundTrip) {
+  Recorder r;
+  DatumList a;
+  r.StartStaging(&a);
+  std::vector<std::string> names;
+  names.push_back("u235");
+  names.push_back("pu239");
+  std::map<std::string, double> fracs;
+  fracs["u235"] = 0.05;
+  for (int i = 0; i < 2; ++i) {
+    r.NewDatum("AgentStateWidget")
+        ->AddVal("AgentId", 7)
+        ->AddVal("Mass", 1.5 * i)
+        ->AddVal("On", i == 1)
+        ->AddVal("Names", names)
+        ->AddVal("Fracs", fracs)
+        ->AddVal("Raw", cyclus::Blob("abc"))
+        ->Record();
+  }
+  r.NewDatum("AgentStateGadget")->AddVal("AgentId", 7)->Record();
+  r.StopStaging();
+
+  DatumList b;
+  r.StartStaging(&b);
+  r.NewDatum("AgentStateWidget")
+      ->AddVal("AgentId", 8)
+      ->AddVal("Pairs", std::vector<std::vector<int> >())
+      ->Record();
+  r.StopStaging();
+
+  StateImageWriter w(12);
+  EXPECT_TRUE(w.Add(7, a));
+  EXPECT_FALSE(w.Add(8, b));
+  EXPECT_EQ(1, w.size());
+  std::string path = "state_image_test.cycimg";
+  w.Write(path);
+  r.Discard(&a);
+  r.Discard(&b);
+
+  StateImage img(path);
+  EXPECT_EQ(12, img.time());
+  EXPECT_TRUE(img.Has(7));
+  EXPECT_FALSE(img.Has(8));
+
+  QueryResult qr;
+  EXPECT_FALSE(img.Rows(8, "AgentStateWidget", &qr));
+  ASSERT_TRUE(img.Rows(7, "AgentStateWidget", &qr));
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(cyclus::DOUBLE, qr.types[2]);
+  EXPECT_EQ(r.sim_id(), qr.GetVal<boost::uuids::uuid>("SimId"));
+  EXPECT_EQ(7, qr.GetVal<int>("AgentId", 1));
+  EXPECT_DOUBLE_EQ(1.5, qr.GetVal<double>("Mass", 1));
+  EXPECT_FALSE(qr.GetVal<bool>("On", 0));
+  EXPECT_TRUE(qr.GetVal<bool>("On", 1));
+  EXPECT_EQ(names, qr.GetVal<std::vector<std::string> >("Names"));
+  EXPECT_EQ(fracs, (qr.GetVal<std::map<std::string, double> >("Fracs")));
+  EXPECT_EQ("abc", qr.GetVal<cyclus::Blob>("Raw").str());
+
+  ASSERT_TRUE(img.Rows(7, "AgentStateGadget", &qr));
+  EXPECT_EQ(1, qr.rows.size());
+  ASSERT_TRUE(img.Rows(7, "AgentStateSprocket", &qr));
+  EXPECT_TRUE(qr.rows.empty());
+  std::remove(path.c_str());
+}
+
+TEST(StateImageTests, Binary) {
+  Recorder r;
+  DatumList a;
+  r.StartStaging(&a);
+  r.NewDatum("AgentStateAgent")->AddVal("AgentId", 7)->Record();
+  r.StopStaging();
+
+  StateImageWriter w(3);
+  EXPECT_TRUE(w.Add(7, a, "binary state"));
+  EXPECT_TRUE(w.Add(8, a));
+  std::string path = "state_image_binary.cycimg";
+  w.Write(path);
+  r.Discard(&a);
+
+  StateImage img(path);
+  const char* begin;
+  const char* end;
+  ASSERT_TRUE(img.Binary(7, &begin, &end));
+  EXPECT_EQ("binary state", std::string(begin, end));
+  EXPECT_FALSE(img.Binary(8, &begin, &end));
+  EXPECT_FALSE(img.Binary(9, &begin, &end));
+
+  // tables an agent with binary state does not hold are left to the database
+  QueryResult qr;
+  ASSERT_TRUE(img.Rows(7, "AgentStateAgent", &qr));
+  EXPECT_EQ(1, qr.rows.size());
+  EXPECT_FALSE(img.Rows(7, "AgentStateWidgetInfo", &qr));
+  EXPECT_TRUE(img.Rows(8, "AgentStateWidgetInfo", &qr));
+  std::remove(path.c_str());
+}
+
+TEST(StateImageTests, Invalid) {
+  std::string path = "state_image_bad.cycimg";
+  {
+    std::ofstream f(path.c_str());
+    f << "not a state image";
+  }
+  EXPECT_THROW(StateImage img(path), cyclus::IOError);
+  std::remove(path.c_str());
+  EXPECT_THROW(StateImage img(path), cyclus::IOError);
+}
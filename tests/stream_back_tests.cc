@@ -0,0 +1,207 @@
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#if !_WIN32
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "query_backend.h"
+#include "recorder.h"
+#include "stream_back.h"
+
+using cyclus::Recorder;
+using cyclus::StreamBack;
+
+#if !_WIN32
+namespace {
+
+// listens on a free port of the loopback interface, returning the socket
+int Listen(int* port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t len = sizeof(addr);
+  bind(fd, reinterpret_cast<struct sockaddr*>(&addr), len);
+  listen(fd, 1);
+  getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len);
+  *port = ntohs(addr.sin_port);
+  return fd;
+}
+
+// accepts a connection on fd and reads it until it is closed
+void ReadAll(int fd, std::string* data) {
+  int conn = accept(fd, NULL, NULL);
+  char buf[4096];
+  ssize_t n;
+  while ((n = recv(conn, buf, sizeof(buf), 0)) > 0) {
+    data->append(buf, n);
+  }
+  close(conn);
+}
+
+class Reader {
+ public:
+  explicit Reader(const std::string& data) : data_(data), pos_(0) {}
+
+  uint32_t U32() {
+    uint32_t x = 0;
+    for (int i = 0; i < 4; ++i) {
+      x |= static_cast<uint32_t>(static_cast<unsigned char>(data_[pos_++]))
+           << (8 * i);
+    }
+    return x;
+  }
+
+  double Double() {
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; ++i) {
+      bits |= static_cast<uint64_t>(static_cast<unsigned char>(data_[pos_++]))
+              << (8 * i);
+    }
+    double x;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+  }
+
+  std::string Str() {
+    uint32_t n = U32();
+    pos_ += n;
+    return data_.substr(pos_ - n, n);
+  }
+
+  std::string Bytes(size_t n) {
+    pos_ += n;
+    return data_.substr(pos_ - n, n);
+  }
+
+  bool done() const { return pos_ >= data_.size(); }
+
+ private:
+  const std::string& data_;
+  size_t pos_;
+};
+
+}  // namespace
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(StreamBackTests, Stream) {
+  int port;
+  int lfd = Listen(&port);
+  std::string data;
+  std::thread reader(ReadAll, lfd, &data);
+
+  std::vector<double> fracs;
+  fracs.push_back(0.25);
+  fracs.push_back(0.75);
+  std::vector<std::string> names;
+  names.push_back("spam");
+  {
+    StreamBack back("127.0.0.1", port);
+    EXPECT_EQ("tcp://127.0.0.1:" + std::to_string(port), back.Name());
+    Recorder rec;
+    rec.RegisterBackend(&back);
+    for (int i = 0; i < 3; ++i) {
+      rec.NewDatum("Spam")
+          ->AddVal("Id", i)
+          ->AddVal("Fracs", fracs)
+          ->AddVal("Names", names)
+          ->Record();
+    }
+    rec.NewDatum("Eggs")->AddVal("Name", std::string("eggs"))->Record();
+    rec.Flush();
+    back.Close();
+    back.Close();
+    EXPECT_EQ(0, back.dropped());
+
+    // rows recorded after closing are dropped
+    rec.NewDatum("Eggs")->AddVal("Name", std::string("eggs"))->Record();
+    rec.Flush();
+    EXPECT_EQ(1, back.dropped());
+    rec.Close();
+    reader.join();
+    EXPECT_EQ(data.size(), back.sent_bytes());
+  }
+  close(lfd);
+
+  Reader r(data);
+  EXPECT_EQ(std::string("CYCSTRM\x01", 8), r.Bytes(8));
+
+  r.U32();  // the length of the frame
+  EXPECT_EQ("Spam", r.Str());
+  ASSERT_EQ(4, r.U32());
+  EXPECT_EQ("SimId", r.Str());
+  EXPECT_EQ(cyclus::UUID, r.U32());
+  EXPECT_EQ("Id", r.Str());
+  EXPECT_EQ(cyclus::INT, r.U32());
+  EXPECT_EQ("Fracs", r.Str());
+  EXPECT_EQ(cyclus::VECTOR_DOUBLE, r.U32());
+  EXPECT_EQ("Names", r.Str());
+  EXPECT_EQ(cyclus::VECTOR_STRING, r.U32());
+  ASSERT_EQ(3, r.U32());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(16, r.Bytes(16).size());
+    EXPECT_EQ(i, r.U32());
+    ASSERT_EQ(2, r.U32());
+    EXPECT_DOUBLE_EQ(0.25, r.Double());
+    EXPECT_DOUBLE_EQ(0.75, r.Double());
+    ASSERT_EQ(1, r.U32());
+    EXPECT_EQ("spam", r.Str());
+  }
+
+  r.U32();
+  EXPECT_EQ("Eggs", r.Str());
+  ASSERT_EQ(2, r.U32());
+  r.Str();
+  r.U32();
+  EXPECT_EQ("Name", r.Str());
+  EXPECT_EQ(cyclus::STRING, r.U32());
+  ASSERT_EQ(1, r.U32());
+  r.Bytes(16);
+  EXPECT_EQ("eggs", r.Str());
+  EXPECT_TRUE(r.done());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(StreamBackTests, Overflow) {
+  int port;
+  int lfd = Listen(&port);
+
+  // the frames don't fit a buffer of one byte, so all but the first are
+  // dropped until it is sent
+  StreamBack back("127.0.0.1", port, 1);
+  back.overflow(StreamBack::STREAM_DROP);
+  EXPECT_EQ(StreamBack::STREAM_DROP, back.overflow());
+  Recorder rec(false);
+  rec.RegisterBackend(&back);
+  rec.NewDatum("Spam")->AddVal("Id", 1)->Record();
+  rec.NewDatum("Eggs")->AddVal("Id", 2)->Record();
+  rec.Flush();
+  back.Flush();
+  EXPECT_LE(back.dropped(), 1);
+
+  std::string data;
+  std::thread reader(ReadAll, lfd, &data);
+  rec.Close();
+  back.Close();
+  reader.join();
+  close(lfd);
+  EXPECT_EQ(data.size(), back.sent_bytes());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(StreamBackTests, NoServer) {
+  int port;
+  int lfd = Listen(&port);
+  close(lfd);
+  EXPECT_THROW(StreamBack("127.0.0.1", port), cyclus::IOError);
+}
+#endif
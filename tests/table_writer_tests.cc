@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "rec_backend.h"
+#include "recorder.h"
+#include "table_writer.h"
+
+namespace {
+
+class RowBack : public cyclus::RecBackend {
+ public:
+  virtual void Notify(cyclus::DatumList data) {
+    for (int i = 0; i < data.size(); ++i) {
+      titles.push_back(data[i]->title());
+      rows.push_back(data[i]->vals());
+    }
+  }
+  virtual std::string Name() { return "RowBack"; }
+  virtual void Flush() {}
+  virtual void Close() {}
+
+  std::vector<std::string> titles;
+  std::vector<cyclus::Datum::Vals> rows;
+};
+
+}  // namespace
+
+TEST(TableWriterTest, MatchesNewDatum) {
+  using cyclus::Datum;
+  cyclus::Recorder rec;
+  RowBack back;
+  rec.RegisterBackend(&back);
+
+  cyclus::TableWriter<int, std::string, double> w(
+      &rec, "Widgets", {"AgentId", "Name", "Mass"});
+  EXPECT_EQ("Widgets", w.title());
+  w.Record(7, "bolt", 1.5);
+  rec.NewDatum("Widgets")
+      ->AddVal("AgentId", 7)
+      ->AddVal("Name", std::string("bolt"))
+      ->AddVal("Mass", 1.5)
+      ->Record();
+  w.Record(8, "nut", 2.5);
+  rec.Flush();
+
+  ASSERT_EQ(3, back.rows.size());
+  for (int i = 0; i < back.rows.size(); ++i) {
+    EXPECT_EQ("Widgets", back.titles[i]);
+    Datum::Vals& v = back.rows[i];
+    ASSERT_EQ(4, v.size());
+    EXPECT_STREQ("SimId", v[0].first);
+    EXPECT_EQ(rec.sim_id(), v[0].second.cast<boost::uuids::uuid>());
+    EXPECT_STREQ("AgentId", v[1].first);
+    EXPECT_STREQ("Name", v[2].first);
+    EXPECT_STREQ("Mass", v[3].first);
+  }
+  EXPECT_EQ(7, back.rows[0][1].second.cast<int>());
+  EXPECT_EQ("bolt", back.rows[0][2].second.cast<std::string>());
+  EXPECT_DOUBLE_EQ(1.5, back.rows[0][3].second.cast<double>());
+  EXPECT_EQ(7, back.rows[1][1].second.cast<int>());
+  EXPECT_EQ(8, back.rows[2][1].second.cast<int>());
+  EXPECT_EQ("nut", back.rows[2][2].second.cast<std::string>());
+  EXPECT_DOUBLE_EQ(2.5, back.rows[2][3].second.cast<double>());
+  rec.Close();
+}
+
+TEST(TableWriterTest, RecordColumns) {
+  cyclus::Recorder rec;
+  RowBack back;
+  rec.RegisterBackend(&back);
+
+  cyclus::TableWriter<int, std::string> w(&rec, "Widgets", {"AgentId", "Name"});
+  int ids[] = {7, 8, 9};
+  std::string names[] = {"bolt", "nut", "washer"};
+  w.RecordColumns(3, ids, names);
+  rec.Flush();
+
+  ASSERT_EQ(3, back.rows.size());
+  for (int i = 0; i < back.rows.size(); ++i) {
+    ASSERT_EQ(3, back.rows[i].size());
+    EXPECT_EQ(ids[i], back.rows[i][1].second.cast<int>());
+    EXPECT_EQ(names[i], back.rows[i][2].second.cast<std::string>());
+  }
+  rec.Close();
+}
+
+TEST(TableWriterTest, FieldCountMismatch) {
+  cyclus::Recorder rec;
+  typedef cyclus::TableWriter<int, double> Writer;
+  EXPECT_THROW(Writer(&rec, "Widgets", {"AgentId"}), cyclus::ValueError);
+  EXPECT_NO_THROW(Writer(&rec, "Widgets", {"AgentId", "Mass"}));
+}
+
+TEST(TableWriterTest, CompactResources) {
+  cyclus::Recorder rec;
+  RowBack back;
+  rec.RegisterBackend(&back);
+
+  cyclus::ResourcesWriter w(&rec, true);
+  EXPECT_TRUE(w.compact());
+  w.Record(5, 5, "Material", 1, 2.5, "kg", 7, 0, 0);
+  w.Record(8, 5, "Material", 2, 1.5, "kg", 7, 5, 0);
+  w.Record(9, 9, "Product", 2, 3.0, "tons", 11, 8, 6);
+  rec.Flush();
+
+  // each type and units pair is recorded once, before its first use
+  std::vector<std::string> titles;
+  titles.push_back("ResourceTypes");
+  titles.push_back("CompactResources");
+  titles.push_back("CompactResources");
+  titles.push_back("ResourceTypes");
+  titles.push_back("CompactResources");
+  EXPECT_EQ(titles, back.titles);
+  EXPECT_EQ(2, back.rows[3][1].second.cast<int>());
+  EXPECT_EQ("tons", back.rows[3][3].second.cast<std::string>());
+
+  cyclus::Datum::Vals& v = back.rows[4];
+  ASSERT_EQ(9, v.size());
+  EXPECT_EQ(9, v[1].second.cast<int>());
+  EXPECT_EQ(0, v[2].second.cast<int>());  // ObjIdDelta
+  EXPECT_EQ(2, v[3].second.cast<int>());  // TypeId
+  EXPECT_EQ(1, v[7].second.cast<int>());  // Parent1Delta
+  EXPECT_EQ(3, v[8].second.cast<int>());  // Parent2Delta
+  EXPECT_EQ(3, back.rows[2][2].second.cast<int>());
+  EXPECT_EQ(0, back.rows[2][8].second.cast<int>());
+  rec.Close();
+}
+
+TEST(TableWriterTest, DenseCompositions) {
+  cyclus::Recorder rec;
+  RowBack back;
+  rec.RegisterBackend(&back);
+
+  cyclus::NuclideIndex nucs(&rec);
+  cyclus::CompositionsWriter w(&rec, &nucs);
+  EXPECT_TRUE(w.dense());
+  std::vector<cyclus::Nuc> ids;
+  std::vector<double> fracs;
+  ids.push_back(922350000);
+  fracs.push_back(0.25);
+  ids.push_back(922380000);
+  fracs.push_back(0.75);
+  w.Record(3, ids, fracs);
+  w.Record(4, std::vector<cyclus::Nuc>(1, 922380000),
+           std::vector<double>(1, 1.0));
+  rec.Flush();
+
+  // each nuclide is indexed once, before its first use
+  std::vector<std::string> titles;
+  titles.push_back("NuclideIndex");
+  titles.push_back("NuclideIndex");
+  titles.push_back("DenseCompositions");
+  titles.push_back("DenseCompositions");
+  EXPECT_EQ(titles, back.titles);
+  EXPECT_EQ(1, back.rows[1][1].second.cast<int>());
+  EXPECT_EQ(922380000, back.rows[1][2].second.cast<int>());
+
+  std::vector<double> vals =
+      back.rows[2][2].second.cast<std::vector<double> >();
+  ASSERT_EQ(2, vals.size());
+  EXPECT_DOUBLE_EQ(0.25, vals[0]);
+  EXPECT_DOUBLE_EQ(0.75, vals[1]);
+
+  // arrays end at the last nuclide they hold
+  vals = back.rows[3][2].second.cast<std::vector<double> >();
+  ASSERT_EQ(2, vals.size());
+  EXPECT_DOUBLE_EQ(0, vals[0]);
+  EXPECT_DOUBLE_EQ(1, vals[1]);
+  rec.Close();
+}
@@ -0,0 +1,98 @@
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "task_scheduler.h"
+
+using cyclus::TaskGroup;
+using cyclus::TaskScheduler;
+
+TEST(TaskSchedulerTests, ParallelFor) {
+  TaskScheduler s(4);
+  EXPECT_EQ(4, s.threads());
+  std::vector<int> hits(1000, 0);
+  s.ParallelFor(hits.size(), [&](int i) { hits[i]++; });
+  for (int i = 0; i < hits.size(); ++i) {
+    ASSERT_EQ(1, hits[i]);
+  }
+  s.ParallelFor(0, [&](int i) { hits[i]++; });
+
+  // no more threads than asked for run at once
+  std::atomic<int> running(0);
+  std::atomic<int> most(0);
+  s.ParallelFor(200, [&](int i) {
+    int r = ++running;
+    int m = most;
+    while (r > m && !most.compare_exchange_weak(m, r)) {
+    }
+    std::this_thread::yield();
+    --running;
+  }, 2);
+  EXPECT_LE(most, 2);
+}
+
+TEST(TaskSchedulerTests, OneThread) {
+  TaskScheduler s(1);
+  EXPECT_EQ(1, s.threads());
+  std::thread::id self = std::this_thread::get_id();
+  std::set<std::thread::id> ids;
+  s.ParallelFor(10, [&](int i) { ids.insert(std::this_thread::get_id()); });
+  ASSERT_EQ(1, ids.size());
+  EXPECT_EQ(self, *ids.begin());
+
+  int n = 0;
+  TaskGroup g(&s);
+  g.Run([&]() { n++; });
+  g.Run([&]() { n++; });
+  g.Wait();
+  EXPECT_EQ(2, n);
+}
+
+TEST(TaskSchedulerTests, Errors) {
+  TaskScheduler s(3);
+  std::atomic<int> calls(0);
+  EXPECT_THROW(s.ParallelFor(100, [&](int i) {
+    calls++;
+    if (i == 10)
+      throw cyclus::ValueError("bad index");
+  }), cyclus::ValueError);
+  EXPECT_LT(calls, 100);
+
+  TaskGroup g(&s);
+  g.Run([]() { throw cyclus::StateError("bad task"); });
+  g.Run([]() {});
+  EXPECT_THROW(g.Wait(), cyclus::StateError);
+  // the group is reusable once waited on
+  g.Run([]() {});
+  EXPECT_NO_THROW(g.Wait());
+}
+
+TEST(TaskSchedulerTests, Nested) {
+  // every thread of the pool waits on work of its own, which it runs itself
+  // if no other thread is free
+  TaskScheduler s(3);
+  std::vector<std::atomic<int> > sums(20);
+  s.ParallelFor(sums.size(), [&](int i) {
+    sums[i] = 0;
+    s.ParallelFor(50, [&](int j) { sums[i] += j; });
+  });
+  for (int i = 0; i < sums.size(); ++i) {
+    EXPECT_EQ(50 * 49 / 2, sums[i]);
+  }
+
+  // tasks queue more tasks on their group
+  std::atomic<int> n(0);
+  TaskGroup g(&s);
+  for (int i = 0; i < 10; ++i) {
+    g.Run([&]() {
+      n++;
+      g.Run([&]() { n++; });
+    });
+  }
+  g.Wait();
+  EXPECT_EQ(20, n);
+}
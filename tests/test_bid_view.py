@@ -0,0 +1,62 @@
+import os
+import json
+import sqlite3
+import subprocess
+
+from nose.tools import assert_in, assert_true
+
+inputfile = {
+ 'simulation': {
+  'archetypes': {
+   'spec': [
+    {'lib': 'cyclus.pyagents', 'name': 'Sink'},
+    {'lib': 'bid_view_agents', 'name': 'ArraySource'},
+    {'lib': 'cyclus.pyagents', 'name': 'NullRegion'},
+    {'lib': 'cyclus.pyagents', 'name': 'NullInst'},
+   ],
+  },
+  'control': {'duration': 5, 'startmonth': 1, 'startyear': 2000},
+  'facility': [
+   {'config': {'ArraySource': {'capacity': 1.0, 'commod': 'commodity'}},
+    'name': 'Source'},
+   {'config': {'Sink': {'capacity': 1.0,
+                        'in_commods': {'val': 'commodity'}}},
+    'name': 'Sink'},
+  ],
+  'recipe': {'basis': 'mass', 'name': 'commod_recipe',
+             'nuclide': {'comp': 1, 'id': 'H1'}},
+  'region': {
+   'config': {'NullRegion': None},
+   'institution': {
+    'config': {'NullInst': None},
+    'initialfacilitylist': {'entry': [{'number': 1, 'prototype': 'Source'},
+                                      {'number': 1, 'prototype': 'Sink'}]},
+    'name': 'SingleInstitution',
+   },
+   'name': 'SingleRegion',
+  },
+ },
+}
+
+
+def test_bid_view():
+    for f in ('bid_view.json', 'bid_view.sqlite'):
+        if os.path.exists(f):
+            os.remove(f)
+    with open('bid_view.json', 'w') as f:
+        json.dump(inputfile, f)
+    env = dict(os.environ)
+    env['PYTHONPATH'] = "."
+    s = subprocess.check_output(['cyclus', '-o', 'bid_view.sqlite',
+                                 'bid_view.json'],
+                                universal_newlines=True, env=env)
+    # the source saw a view of the sink's request every time step
+    assert_in("Bid on 1 of 1 requests", s)
+    # and its bids were traded
+    conn = sqlite3.connect('bid_view.sqlite')
+    ntrans = conn.execute('SELECT COUNT(*) FROM Transactions').fetchone()[0]
+    conn.close()
+    assert_true(ntrans > 0)
+    for f in ('bid_view.json', 'bid_view.sqlite'):
+        if os.path.exists(f):
+            os.remove(f)
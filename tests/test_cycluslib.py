@@ -4,7 +4,8 @@ import subprocess
 from functools import wraps
 
 import nose
-from nose.tools import assert_equal, assert_less
+from nose.tools import assert_equal, assert_less, assert_true, assert_in
+import numpy as np
 
 from cyclus import lib
 
@@ -44,6 +45,36 @@ def test_conds_comp(db, fname, backend):
         assert_less(row, 0.00720000001)
 
 
+@dbtest
+def test_fields_comp(db, fname, backend):
+    conds = [('NucId', '==', 922350000)]
+    df = db.query("Compositions", conds, fields=['MassFrac', 'QualId'])
+    assert_less(0, len(df))
+    assert_equal(['MassFrac', 'QualId'], list(df.columns))
+
+
+@dbtest
+def test_query_dtypes(db, fname, backend):
+    df = db.query("Compositions", fields=['QualId', 'NucId', 'MassFrac'])
+    assert_less(0, len(df))
+    assert_equal(np.float64, df['MassFrac'].dtype)
+    assert_true(np.issubdtype(df['NucId'].dtype, np.integer))
+    assert_true(np.issubdtype(df['QualId'].dtype, np.integer))
+    ae = db.query("AgentEntry", fields=['Kind'])
+    assert_in('Region', list(ae['Kind']))
+
+
+@dbtest
+def test_cursor_comp(db, fname, backend):
+    conds = [('NucId', '==', 922350000)]
+    exp = db.query("Compositions", conds, fields=['MassFrac', 'QualId'])
+    cur = db.cursor("Compositions", conds, fields=['MassFrac', 'QualId'])
+    obs = list(cur.batches(2))
+    assert_less(0, len(obs))
+    assert_equal(len(exp), sum(len(df) for df in obs))
+    assert_equal(0, len(cur.next()))
+
+
 @dbtest
 def test_dbopen(db, fname, backend):
     db = lib.dbopen(fname)
@@ -0,0 +1,74 @@
+#! /usr/bin/env python
+"""Checks that sweeps run with --ensemble write every variant to the output
+file under its own simulation id, and that sweeps of Python archetypes fall
+back to running the variants in processes of their own.
+"""
+import os
+import sqlite3
+import subprocess
+import tempfile
+
+from nose.tools import assert_equal, assert_true
+from nose.plugins.skip import SkipTest
+
+from tools import cyclus_has_coin
+
+INPUT = os.path.join(os.path.dirname(__file__), "input")
+
+SWEEP = """# two variants of the minimal cycle, forked at the sweep time
+low FacilityA:out_capacity=1
+high FacilityA:out_capacity=2
+"""
+
+
+def write_sweep(d):
+    path = os.path.join(d, "sweep.txt")
+    with open(path, "w") as f:
+        f.write(SWEEP)
+    return path
+
+
+def run(args):
+    return subprocess.check_output(["cyclus"] + args,
+                                   stderr=subprocess.STDOUT,
+                                   universal_newlines=True)
+
+
+def test_ensemble():
+    if not cyclus_has_coin():
+        raise SkipTest("Cyclus does not have COIN")
+    d = tempfile.mkdtemp()
+    out = os.path.join(d, "ensemble.sqlite")
+    run(["--sweep", write_sweep(d), "--sweep-time", "10", "--ensemble",
+         "--jobs", "2", "-o", out, os.path.join(INPUT, "minimal_cycle.xml")])
+
+    conn = sqlite3.connect(out)
+    info = conn.execute("SELECT SimId, ParentSimId, BranchTime FROM Info"
+                        ).fetchall()
+    simids = set(row[0] for row in info)
+    assert_equal(len(simids), 3)
+    variants = [row for row in info if row[1] in simids]
+    assert_equal(len(variants), 2)
+    common = simids - set(row[0] for row in variants)
+    assert_equal(len(common), 1)
+    for simid, parent, branch in variants:
+        assert_equal(parent, list(common)[0])
+        n = conn.execute("SELECT COUNT(*) FROM Transactions WHERE SimId = ? "
+                         "AND Time >= ?", (simid, branch)).fetchone()[0]
+        assert_true(n > 0)
+    conn.close()
+
+
+def test_ensemble_python_falls_back():
+    if not cyclus_has_coin():
+        raise SkipTest("Cyclus does not have COIN")
+    d = tempfile.mkdtemp()
+    out = os.path.join(d, "ensemble.sqlite")
+    with open(os.path.join(d, "sweep.txt"), "w") as f:
+        f.write("a\nb\n")
+    s = run(["--sweep", os.path.join(d, "sweep.txt"), "--sweep-time", "10",
+             "--ensemble", "-o", out, os.path.join(INPUT, "null_sink.py")])
+    assert_true("cannot run Python archetypes" in s)
+    for name in ["a", "b"]:
+        assert_true(os.path.exists(os.path.join(d, "ensemble-" + name +
+                                                ".sqlite")))
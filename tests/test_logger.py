@@ -1,5 +1,6 @@
 """Tests Python wrapping on Env object."""
 from __future__ import print_function, unicode_literals
+import os
 
 from nose.tools import assert_equal, assert_true
 
@@ -36,3 +37,17 @@ def test_to_log_level_string():
     yield assert_equal, lib.LEV_ERROR, level
 
 
+
+
+def test_sink():
+    orig = LOGGER.report_level
+    LOGGER.report_level = lib.LEV_ERROR
+    fname = 'test_logger_sink.log'
+    LOGGER.sink = fname
+    yield assert_equal, fname, LOGGER.sink
+    LOGGER.flush()
+    LOGGER.sink = ''
+    yield assert_equal, '', LOGGER.sink
+    LOGGER.report_level = orig
+    if os.path.exists(fname):
+        os.remove(fname)
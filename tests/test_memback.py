@@ -217,6 +217,36 @@ def test_record_flush_thrice():
     rec.close()
 
 
+def test_columns():
+    n = 10
+    rec, back = make_rec_back()
+    for i in range(n):
+        d = rec.new_datum("test")
+        d.add_val("col0", i, type=ts.INT)
+        d.add_val("col1", 42.0*i, type=ts.DOUBLE)
+        d.add_val("col2", "wakka"*i, type=ts.VL_STRING)
+        d.record()
+    rec.flush()
+
+    cols = back.columns("test")
+    assert_equal(['col0', 'col1', 'col2'], list(cols.keys()))
+    assert_equal(np.int64, cols['col0'].dtype)
+    assert_false(cols['col0'].flags.writeable)
+    assert_true(np.array_equal(np.arange(n), cols['col0']))
+    assert_equal(["wakka"*i for i in range(n)], cols['col2'])
+
+    # arrays that have been handed out don't change when rows are added
+    d = rec.new_datum("test")
+    d.add_val("col0", n, type=ts.INT)
+    d.add_val("col1", 42.0*n, type=ts.DOUBLE)
+    d.add_val("col2", "wakka"*n, type=ts.VL_STRING)
+    d.record()
+    rec.flush()
+    assert_equal(n, len(cols['col0']))
+    assert_equal(n + 1, len(back.query("test")))
+    rec.close()
+
+
 def test_many_cols_one_table():
     n = 100
     rec, back = make_rec_back()
@@ -370,6 +400,37 @@ def test_query():
     obs.to_json()
 
 
+def test_new_rows():
+    rec, back = make_rec_back()
+    def record(n):
+        for i in range(n):
+            d = rec.new_datum("test")
+            d.add_val("col0", i, type=ts.INT)
+            d.add_val("col1", "wakka", type=ts.VL_STRING)
+            d.record()
+        rec.flush()
+
+    record(3)
+    obs = back.new_rows("test")
+    yield assert_equal, 3, len(obs["col0"])
+    obs = back.new_rows("test", client="other")
+    yield assert_equal, 3, len(obs["col0"])
+    # nothing new since the last call
+    obs = back.new_rows("test")
+    yield assert_equal, 0, len(obs["col0"])
+
+    record(2)
+    obs = back.new_rows("test")
+    yield assert_equal, [0, 1], list(obs["col0"])
+    yield assert_equal, ["wakka", "wakka"], list(obs["col1"])
+
+    back.reset_marks()
+    obs = back.new_rows("test")
+    yield assert_equal, 5, len(obs["col0"])
+    obs = back.new_rows("test", client="other")
+    yield assert_equal, 2, len(obs["col0"])
+    rec.close()
+
 
 if __name__ == "__main__":
     nose.runmodule()
\ No newline at end of file
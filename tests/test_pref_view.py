@@ -0,0 +1,62 @@
+import os
+import json
+import sqlite3
+import subprocess
+
+from nose.tools import assert_in, assert_equal
+
+inputfile = {
+ 'simulation': {
+  'archetypes': {
+   'spec': [
+    {'lib': 'cyclus.pyagents', 'name': 'Source'},
+    {'lib': 'pref_view_agents', 'name': 'RefusingSink'},
+    {'lib': 'cyclus.pyagents', 'name': 'NullRegion'},
+    {'lib': 'cyclus.pyagents', 'name': 'NullInst'},
+   ],
+  },
+  'control': {'duration': 5, 'startmonth': 1, 'startyear': 2000},
+  'facility': [
+   {'config': {'Source': {'capacity': 1.0, 'commod': 'commodity'}},
+    'name': 'Source'},
+   {'config': {'RefusingSink': {'capacity': 1.0,
+                                'in_commods': {'val': 'commodity'}}},
+    'name': 'Sink'},
+  ],
+  'recipe': {'basis': 'mass', 'name': 'commod_recipe',
+             'nuclide': {'comp': 1, 'id': 'H1'}},
+  'region': {
+   'config': {'NullRegion': None},
+   'institution': {
+    'config': {'NullInst': None},
+    'initialfacilitylist': {'entry': [{'number': 1, 'prototype': 'Source'},
+                                      {'number': 1, 'prototype': 'Sink'}]},
+    'name': 'SingleInstitution',
+   },
+   'name': 'SingleRegion',
+  },
+ },
+}
+
+
+def test_pref_view():
+    for f in ('pref_view.json', 'pref_view.sqlite'):
+        if os.path.exists(f):
+            os.remove(f)
+    with open('pref_view.json', 'w') as f:
+        json.dump(inputfile, f)
+    env = dict(os.environ)
+    env['PYTHONPATH'] = "."
+    s = subprocess.check_output(['cyclus', '-o', 'pref_view.sqlite',
+                                 'pref_view.json'],
+                                universal_newlines=True, env=env)
+    # the sink saw a view of the source's bid on its request every time step
+    assert_in("Adjusted 1 arcs of 1 requests", s)
+    # and refused it
+    conn = sqlite3.connect('pref_view.sqlite')
+    ntrans = conn.execute('SELECT COUNT(*) FROM Transactions').fetchone()[0]
+    conn.close()
+    assert_equal(0, ntrans)
+    for f in ('pref_view.json', 'pref_view.sqlite'):
+        if os.path.exists(f):
+            os.remove(f)
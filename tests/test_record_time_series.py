@@ -30,6 +30,8 @@ def test_record_time_series():
     env['PYTHONPATH'] = "."
     s = subprocess.check_output(['cyclus', '-o', 'dummy.h5', 'dummy.json'], universal_newlines=True, env=env)
     assert_in("The power is 10", s)
+    assert_in("The batched power at 0 is [10.0]", s)
+    assert_in("The batched power at 1 is [10.0]", s)
     if os.path.exists('dummy.json'):
         os.remove('dummy.json')
     if os.path.exists('dummy.h5'):
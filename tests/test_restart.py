@@ -0,0 +1,165 @@
+#! /usr/bin/env python
+"""Checks that simulations restarted from intermediate snapshots reproduce the
+output of the original run, and measures what restarting costs compared to
+running the whole simulation again.
+
+Run as a script to benchmark restarts of a scenario, e.g.::
+
+    python test_restart.py --input input/minimal_cycle.xml --times 10 25 40
+
+which prints the time taken by SimInit to restart from each snapshot and by
+the remaining run, next to the time of the full reference run.
+"""
+from __future__ import print_function
+
+import argparse
+import os
+import re
+import sqlite3
+import subprocess
+import tempfile
+import time
+import uuid
+
+from nose.tools import assert_equal
+from nose.plugins.skip import SkipTest
+
+from tools import cyclus_has_coin
+
+INPUT = os.path.join(os.path.dirname(__file__), "input")
+
+# tables compared after restarting, with the column that holds the time at
+# which each row was recorded
+TABLES = {
+    "AgentEntry": "EnterTime",
+    "AgentExit": "ExitTime",
+    "Resources": "TimeCreated",
+    "Transactions": "Time",
+}
+
+
+def checkpointed_input(ref_input, every, path):
+    """Writes a copy of ref_input to path that checkpoints every so many
+    timesteps."""
+    with open(ref_input) as f:
+        text = f.read()
+    text = text.replace("<control>", "<control><checkpoint_steps>{0}"
+                        "</checkpoint_steps>".format(every), 1)
+    with open(path, "w") as f:
+        f.write(text)
+
+
+def run(args):
+    """Runs cyclus with the given arguments, returning the wall time taken and
+    the startup timings it reports."""
+    start = time.time()
+    out = subprocess.check_output(["cyclus", "--profile-startup"] + args,
+                                  stderr=subprocess.STDOUT,
+                                  universal_newlines=True)
+    secs = time.time() - start
+    timings = dict((m.group(1), float(m.group(2))) for m in
+                   re.finditer(r"^  (\w+): ([0-9.e+-]+) s$", out, re.M))
+    return secs, timings
+
+
+def sim_id(db):
+    conn = sqlite3.connect(db)
+    simid = conn.execute("SELECT SimId FROM Info").fetchone()[0]
+    conn.close()
+    return simid
+
+
+def rows_from(db, table, timecol, t):
+    """Returns the rows of table recorded at or after time t, without their
+    simulation ids, in a canonical order."""
+    conn = sqlite3.connect(db)
+    try:
+        cur = conn.execute("SELECT * FROM {0} WHERE {1} >= ?".format(
+            table, timecol), (t,))
+    except sqlite3.OperationalError:
+        conn.close()
+        return []  # table doesn't exist
+    cols = [d[0] for d in cur.description]
+    keep = [i for i, c in enumerate(cols) if c != "SimId"]
+    rows = sorted(tuple(r[i] for i in keep) for r in cur.fetchall())
+    conn.close()
+    return rows
+
+
+def diff_restart(ref_db, restart_db, t):
+    """Returns the names of the tables whose rows from time t on differ
+    between the reference and restarted runs."""
+    return [tbl for tbl, col in sorted(TABLES.items())
+            if rows_from(ref_db, tbl, col, t) !=
+            rows_from(restart_db, tbl, col, t)]
+
+
+def benchmark(ref_input, times, every, workdir):
+    """Runs ref_input, restarts it from each of the times, and yields
+    (time, restart seconds, remaining run seconds, full run seconds, tables
+    that differ) for each."""
+    sim_input = os.path.join(workdir, "restart_input.xml")
+    ref_db = os.path.join(workdir, "restart_ref.sqlite")
+    checkpointed_input(ref_input, every, sim_input)
+    full, _ = run(["-o", ref_db, sim_input])
+    simid = sim_id(ref_db)
+    for t in times:
+        out = os.path.join(workdir, "restart_{0}.sqlite".format(t))
+        if os.path.exists(out):
+            os.remove(out)
+        spec = "{0}:{1}:{2}".format(ref_db, simid_str(simid), t)
+        secs, timings = run(["--restart", spec, "-o", out])
+        init = timings.get("SimInit", 0.0)
+        yield t, init, secs - init, full, diff_restart(ref_db, out, t)
+
+
+def simid_str(simid):
+    """Formats a simulation id read from sqlite as a uuid string."""
+    if isinstance(simid, (bytes, bytearray, memoryview)):
+        return str(uuid.UUID(bytes=bytes(simid)))
+    return str(simid)
+
+
+def test_restart():
+    """Restarts the minimal cycle from several checkpoints and checks that
+    each restarted run records the same data as the original from the
+    restart time on."""
+    if not cyclus_has_coin():
+        raise SkipTest("Cyclus does not have COIN")
+
+    ref_input = os.path.join(INPUT, "minimal_cycle.xml")
+    workdir = tempfile.mkdtemp()
+    for t, init, rest, full, diffs in benchmark(ref_input, [5, 20, 45], 5,
+                                                workdir):
+        yield assert_equal, [], diffs, "restart at {0}".format(t)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--input", default=os.path.join(INPUT,
+                                                        "minimal_cycle.xml"),
+                        help="the reference scenario")
+    parser.add_argument("--times", type=int, nargs="+", default=[10, 25, 40],
+                        help="the snapshot times to restart from")
+    parser.add_argument("--every", type=int, default=5,
+                        help="the number of timesteps between checkpoints; "
+                             "each restart time must be a multiple")
+    parser.add_argument("--workdir", default=None,
+                        help="where to write the outputs (default: a new "
+                             "temporary directory)")
+    ns = parser.parse_args()
+    workdir = ns.workdir or tempfile.mkdtemp()
+
+    print("{0:>6} {1:>12} {2:>12} {3:>12}  {4}".format(
+        "time", "restart [s]", "rest [s]", "full [s]", "differing tables"))
+    ok = True
+    for t, init, rest, full, diffs in benchmark(ns.input, ns.times, ns.every,
+                                                workdir):
+        ok = ok and not diffs
+        print("{0:>6} {1:>12.3f} {2:>12.3f} {3:>12.3f}  {4}".format(
+            t, init, rest, full, ", ".join(diffs) or "-"))
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
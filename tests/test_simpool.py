@@ -0,0 +1,32 @@
+"""Tests the warm simulation worker pool."""
+from __future__ import print_function, unicode_literals
+import os
+import tempfile
+
+from nose.tools import assert_equal, assert_true, assert_in
+
+from cyclus.simstate import SimPool
+
+INPUT = os.path.join(os.path.dirname(__file__), "input", "source_to_sink.xml")
+
+
+def test_sim_pool():
+    d = tempfile.mkdtemp()
+    outs = [os.path.join(d, "pool{0}.sqlite".format(i)) for i in range(3)]
+    with SimPool(nworkers=2,
+                 archetypes=[':agents:Source', ':agents:Sink',
+                             ':agents:NullRegion', ':agents:NullInst']) as pool:
+        futures = [pool.submit(INPUT, output_path=out, tables=['Transactions'])
+                   for out in outs]
+        results = [f.result() for f in futures]
+    pids = set()
+    for out, res in zip(outs, results):
+        assert_equal(out, res['output_path'])
+        assert_true(os.path.exists(out))
+        assert_in('Transactions', res['tables'])
+        assert_true(len(res['tables']['Transactions']) > 0)
+        pids.add(res['pid'])
+        os.remove(out)
+    # every simulation ran in one of the two workers
+    assert_true(len(pids) <= 2)
+    os.rmdir(d)
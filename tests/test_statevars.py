@@ -0,0 +1,46 @@
+"""Tests Python state variable descriptors."""
+from __future__ import print_function, unicode_literals
+
+import nose
+from nose.tools import assert_equal, assert_is, assert_true
+
+from cyclus import typesystem as ts
+
+import numpy as np
+
+
+class Holder(object):
+    """Holds a state variable the way archetypes do."""
+    x = ts.VectorDouble(name='x')
+
+    def __init__(self):
+        self.__dict__['x'] = Holder.x.copy()
+
+
+def test_vector_double_array():
+    h = Holder()
+    h.x = [1, 2, 3]
+    assert_true(isinstance(h.x, np.ndarray))
+    assert_equal(np.float64, h.x.dtype)
+    assert_equal([1.0, 2.0, 3.0], list(h.x))
+    # arrays of the right dtype are kept, not copied
+    a = np.arange(4, dtype=np.float64)
+    h.x = a
+    assert_is(a, h.x)
+
+
+def test_vector_int_array():
+    v = ts.VectorInt()
+    a = v.coerce([1, 2])
+    assert_equal(np.intc, a.dtype)
+    assert_is(None, v.coerce(None))
+
+
+def test_other_types_kept():
+    v = ts.VectorString()
+    val = ['a', 'b']
+    assert_is(val, v.coerce(val))
+
+
+if __name__ == "__main__":
+    nose.runmodule()
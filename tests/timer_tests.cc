@@ -1,11 +1,20 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 
+#include "column_store.h"
 #include "context.h"
 #include "facility.h"
 #include "greedy_preconditioner.h"
 #include "greedy_solver.h"
 #include "pyhooks.h"
 #include "recorder.h"
+#include "sim_observer.h"
 #include "timer.h"
 #include "sqlite_back.h"
 
@@ -97,6 +106,204 @@ class SnapperDec : public cyclus::Facility {
   bool snap;
 };
 
+class Worker : public cyclus::Facility {
+ public:
+  Worker(cyclus::Context* ctx, bool safe) : cyclus::Facility(ctx), safe(safe) {}
+  virtual ~Worker() {}
+
+  virtual cyclus::Agent* Clone() { return new Worker(context(), safe); }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() { return cyclus::Inventories(); }
+  virtual bool ThreadSafeTimeStep() { return safe; }
+
+  void Tick() {
+    context()->NewDatum("WorkerTicks")
+        ->AddVal("AgentId", id())
+        ->AddVal("Time", context()->time())
+        ->Record();
+    if (context()->time() == 1) {
+      context()->SchedDecom(this);
+    }
+  }
+  void Tock() {}
+  void Decision() {}
+  bool safe;
+};
+
+class Muter : public cyclus::Facility {
+ public:
+  Muter(cyclus::Context* ctx) : cyclus::Facility(ctx), target(NULL), ticks(0) {}
+  virtual ~Muter() {}
+
+  virtual cyclus::Agent* Clone() { return new Muter(context()); }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() { return cyclus::Inventories(); }
+
+  void Tick() {
+    ticks++;
+    if (target != NULL) {
+      context()->UnregisterTimeListener(target);
+      target = NULL;
+    }
+  }
+  void Tock() {}
+  void Decision() {}
+  Muter* target;
+  int ticks;
+};
+
+class Quitter : public cyclus::Facility {
+ public:
+  Quitter(cyclus::Context* ctx) : cyclus::Facility(ctx), ticks(0) {}
+  virtual ~Quitter() {}
+
+  virtual cyclus::Agent* Clone() { return new Quitter(context()); }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() { return cyclus::Inventories(); }
+  virtual bool ThreadSafeTimeStep() { return true; }
+
+  void Tick() {
+    ticks++;
+    context()->NextTransactionID();
+    cyclus::CompMap v;
+    v[922350000] = 1;
+    std::string name = "recipe" + std::to_string(id());
+    context()->AddRecipe(name, cyclus::Composition::CreateFromMass(v));
+    context()->GetRecipe(name);
+    context()->UnregisterTimeListener(this);
+  }
+  void Tock() {}
+  void Decision() {}
+  int ticks;
+};
+
+// tocks in the background first, waiting there (for up to 5 s) until as many
+// tockers have started as share its counter, and then records whether they
+// all had
+class AsyncTocker : public cyclus::Facility {
+ public:
+  AsyncTocker(cyclus::Context* ctx, std::atomic<int>* started, int n)
+      : cyclus::Facility(ctx), started(started), n(n), overlapped(false) {}
+  virtual ~AsyncTocker() {}
+
+  virtual cyclus::Agent* Clone() {
+    return new AsyncTocker(context(), started, n);
+  }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() { return cyclus::Inventories(); }
+
+  virtual std::future<void> StartTock() {
+    return std::async(std::launch::async, [this]() {
+      ++*started;
+      for (int i = 0; i < 500 && *started < n; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      overlapped = *started >= n;
+    });
+  }
+
+  void Tick() {}
+  void Tock() {
+    context()->NewDatum("AsyncTocks")
+        ->AddVal("AgentId", id())
+        ->AddVal("Overlapped", overlapped)
+        ->Record();
+    context()->UnregisterTimeListener(this);
+  }
+  void Decision() {}
+  std::atomic<int>* started;
+  int n;
+  bool overlapped;
+};
+
+class Retiree : public cyclus::Facility {
+ public:
+  Retiree(cyclus::Context* ctx) : cyclus::Facility(ctx) {}
+  virtual ~Retiree() {}
+
+  virtual cyclus::Agent* Clone() {
+    Retiree* m = new Retiree(context());
+    m->InitFrom(this);
+    return m;
+  }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() { return cyclus::Inventories(); }
+  virtual void Decommission() {
+    decom_times.push_back(context()->time());
+  }
+
+  void Tick() {}
+  void Tock() {}
+  void Decision() {}
+  static std::vector<int> decom_times;
+};
+
+std::vector<int> Retiree::decom_times;
+
+class Sleeper : public cyclus::Facility {
+ public:
+  Sleeper(cyclus::Context* ctx, int nap) : cyclus::Facility(ctx), nap(nap) {}
+  virtual ~Sleeper() {}
+
+  virtual cyclus::Agent* Clone() { return new Sleeper(context(), nap); }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() { return cyclus::Inventories(); }
+
+  void Tick() { ticks.push_back(context()->time()); }
+  void Tock() {
+    tocks.push_back(context()->time());
+    context()->SleepUntil(this, context()->time() + nap);
+  }
+  void Decision() {}
+
+  int nap;
+  std::vector<int> ticks;
+  std::vector<int> tocks;
+};
+
+class Stepper : public cyclus::Facility {
+ public:
+  Stepper(cyclus::Context* ctx) : cyclus::Facility(ctx) {}
+  virtual ~Stepper() {}
+
+  virtual cyclus::Agent* Clone() { return new Stepper(context()); }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() { return cyclus::Inventories(); }
+
+  void Tick() {
+    ticks.push_back(context()->time());
+    steps.push_back(context()->step());
+  }
+  void Tock() {}
+  void Decision() {}
+
+  std::vector<int> ticks;
+  std::vector<int> steps;
+};
+
+class StepObserver : public cyclus::SimObserver {
+ public:
+  StepObserver(int kill_at) : kill_at(kill_at) {}
+
+  virtual void OnStepBegin(cyclus::Context* ctx, int time) {
+    events.push_back("begin " + std::to_string(time));
+  }
+  virtual void OnPhaseEnd(cyclus::Context* ctx, int time, const char* phase,
+                          double secs) {
+    events.push_back(phase);
+    EXPECT_GE(secs, 0);
+  }
+  virtual void OnStepEnd(cyclus::Context* ctx, int time) {
+    events.push_back("end " + std::to_string(time));
+    if (time == kill_at) {
+      ctx->KillSim();
+    }
+  }
+
+  int kill_at;
+  std::vector<std::string> events;
+};
+
 TEST(TimerTests, BareSim) {
   cyclus::PyStart();
   cyclus::Recorder rec;
@@ -134,6 +341,48 @@ TEST(TimerTests, EarlyTermination) {
   cyclus::PyStop();
 }
 
+TEST(TimerTests, Observers) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  ti.Initialize(&ctx, cyclus::SimInfo(10));
+  Sleeper* s = new Sleeper(&ctx, 1);
+  s->Build(NULL);
+
+  StepObserver obs(1);
+  StepObserver removed(-1);
+  ctx.RegisterObserver(&obs);
+  ctx.RegisterObserver(&obs);  // registering again is a no-op
+  ctx.RegisterObserver(&removed);
+  ctx.UnregisterObserver(&removed);
+  ASSERT_EQ(1, ctx.observers().size());
+
+  ti.RunSim();
+  rec.Close();
+
+  const char* step[] = {"Build", "Tick", "ResourceExchange", "Tock",
+                        "Decision", "Decom"};
+  ASSERT_EQ(16, obs.events.size());
+  for (int t = 0; t < 2; ++t) {
+    EXPECT_EQ("begin " + std::to_string(t), obs.events[8 * t]);
+    for (int i = 0; i < 6; ++i) {
+      EXPECT_EQ(step[i], obs.events[8 * t + 1 + i]);
+    }
+    EXPECT_EQ("end " + std::to_string(t), obs.events[8 * t + 7]);
+  }
+  EXPECT_TRUE(removed.events.empty());
+
+  // the observer ended the simulation after time step 1
+  cyclus::QueryResult qr = b.Query("Finish", NULL);
+  EXPECT_TRUE(qr.GetVal<bool>("EarlyTerm"));
+  EXPECT_EQ(1, qr.GetVal<int>("EndTime"));
+  cyclus::PyStop();
+}
+
 TEST(TimerTests, DefaultSnapshotTick) {
   cyclus::PyStart();
   cyclus::Recorder rec;
@@ -227,6 +476,32 @@ TEST(TimerTests, CustomSnapshot) {
   cyclus::PyStop();
 }
 
+TEST(TimerTests, CheckpointSteps) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  cyclus::SimInfo si(10);
+  si.checkpoint_steps = 3;
+  ti.Initialize(&ctx, si);
+
+  ti.RunSim();
+  rec.Close();
+
+  // each checkpoint is a snapshot, along with the one at the end
+  cyclus::QueryResult qr = b.Query("Checkpoints", NULL);
+  ASSERT_EQ(3, qr.rows.size());
+  EXPECT_EQ(3, qr.GetVal<int>("Time", 0));
+  EXPECT_EQ(6, qr.GetVal<int>("Time", 1));
+  EXPECT_EQ(9, qr.GetVal<int>("Time", 2));
+  qr = b.Query("Snapshots", NULL);
+  EXPECT_EQ(4, qr.rows.size());
+  cyclus::PyStop();
+}
+
 TEST(TimerTests, NullParentDecomNoSegfault) {
   cyclus::PyStart();
   cyclus::Recorder rec;
@@ -260,3 +535,255 @@ TEST(TimerTests, DoubleDecom) {
   EXPECT_EQ(1, Dier::decom_count);
   cyclus::PyStop();
 }
+
+TEST(TimerTests, ThreadSafeListeners) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::ColumnStore store;
+  rec.RegisterBackend(&store);
+  ti.threads(4);
+  ti.Initialize(&ctx, cyclus::SimInfo(3));
+
+  std::vector<int> ids;
+  for (int i = 0; i < 20; i++) {
+    Worker* w = new Worker(&ctx, i % 5 != 0);
+    w->Build(NULL);
+    ids.push_back(w->id());
+  }
+
+  ti.RunSim();
+  rec.Flush();
+
+  // rows are recorded in listener order whichever thread ran the listener
+  ASSERT_EQ(40, store.nrows("WorkerTicks"));
+  cyclus::ColumnStore::Table& tbl = *store.table("WorkerTicks");
+  const int64_t* agents =
+      reinterpret_cast<const int64_t*>(&(*tbl[1].buffer())[0]);
+  const int64_t* times =
+      reinterpret_cast<const int64_t*>(&(*tbl[2].buffer())[0]);
+  for (int t = 0; t < 2; t++) {
+    for (int i = 0; i < ids.size(); i++) {
+      EXPECT_EQ(ids[i], agents[t * ids.size() + i]);
+      EXPECT_EQ(t, times[t * ids.size() + i]);
+    }
+  }
+  EXPECT_EQ(20, store.nrows("DecomSchedule"));
+  EXPECT_EQ(1, store.nrows("Finish"));
+  rec.Close();
+  cyclus::PyStop();
+}
+
+TEST(TimerTests, ThreadSafeContext) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  ti.threads(4);
+  ti.Initialize(&ctx, cyclus::SimInfo(3));
+
+  std::vector<Quitter*> qs;
+  for (int i = 0; i < 20; i++) {
+    qs.push_back(new Quitter(&ctx));
+    qs.back()->Build(NULL);
+  }
+
+  ti.RunSim();
+  EXPECT_EQ(20, ctx.ntransactions());
+  for (int i = 0; i < qs.size(); i++) {
+    EXPECT_EQ(1, qs[i]->ticks);
+    EXPECT_NO_THROW(ctx.GetRecipe("recipe" + std::to_string(qs[i]->id())));
+  }
+  cyclus::PyStop();
+}
+
+TEST(TimerTests, AsyncTock) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::ColumnStore store;
+  rec.RegisterBackend(&store);
+  ti.Initialize(&ctx, cyclus::SimInfo(3));
+
+  std::atomic<int> started(0);
+  std::vector<int> ids;
+  for (int i = 0; i < 6; i++) {
+    // every other listener tocks in the background first
+    if (i % 2 == 0) {
+      AsyncTocker* a = new AsyncTocker(&ctx, &started, 3);
+      a->Build(NULL);
+      ids.push_back(a->id());
+    } else {
+      (new Worker(&ctx, false))->Build(NULL);
+    }
+  }
+
+  ti.RunSim();
+  rec.Flush();
+
+  // all background tocks ran at once, and were finished in listener order
+  EXPECT_EQ(3, started);
+  ASSERT_EQ(3, store.nrows("AsyncTocks"));
+  cyclus::ColumnStore::Table& tbl = *store.table("AsyncTocks");
+  const int64_t* agents =
+      reinterpret_cast<const int64_t*>(&(*tbl[1].buffer())[0]);
+  const char* overlapped = &(*tbl[2].buffer())[0];
+  for (int i = 0; i < ids.size(); i++) {
+    EXPECT_EQ(ids[i], agents[i]);
+    EXPECT_TRUE(overlapped[i]);
+  }
+  rec.Close();
+  cyclus::PyStop();
+}
+
+TEST(TimerTests, UnregisterDuringPhase) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  ti.Initialize(&ctx, cyclus::SimInfo(3));
+
+  Muter* a = new Muter(&ctx);
+  a->Build(NULL);
+  Muter* b = new Muter(&ctx);
+  b->Build(NULL);
+  Muter* c = new Muter(&ctx);
+  c->Build(NULL);
+  a->target = b;
+
+  ti.RunSim();
+  EXPECT_EQ(3, a->ticks);
+  EXPECT_EQ(0, b->ticks);
+  EXPECT_EQ(3, c->ticks);
+
+  // a listener registered twice is still only ticked once
+  ctx.RegisterTimeListener(b);
+  ctx.RegisterTimeListener(b);
+  ti.Initialize(&ctx, cyclus::SimInfo(1));
+  ti.RunSim();
+  EXPECT_EQ(1, b->ticks);
+  cyclus::PyStop();
+}
+
+TEST(TimerTests, RescheduleDecom) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  ti.Initialize(&ctx, cyclus::SimInfo(5));
+
+  std::vector<Retiree*> rs;
+  for (int i = 0; i < 3; i++) {
+    rs.push_back(new Retiree(&ctx));
+    rs.back()->Build(NULL);
+  }
+  ctx.SchedDecom(rs[0], 1);
+  ctx.SchedDecom(rs[1], 1);
+  ctx.SchedDecom(rs[2], 2);
+  ctx.SchedDecom(rs[0], 3);
+  ctx.SchedDecom(rs[0], 4);
+  ctx.SchedDecom(rs[2], 1);
+
+  Retiree::decom_times.clear();
+  ti.RunSim();
+  std::vector<int> want;
+  want.push_back(1);
+  want.push_back(1);
+  want.push_back(4);
+  EXPECT_EQ(want, Retiree::decom_times);
+  cyclus::PyStop();
+}
+
+TEST(TimerTests, SleepUntil) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  ti.Initialize(&ctx, cyclus::SimInfo(10));
+
+  Sleeper* a = new Sleeper(&ctx, 4);
+  Sleeper* b = new Sleeper(&ctx, 3);
+  a->Build(NULL);
+  b->Build(NULL);
+
+  ti.RunSim();
+  int wanta[] = {0, 4, 8};
+  int wantb[] = {0, 3, 6, 9};
+  EXPECT_EQ(std::vector<int>(wanta, wanta + 3), a->ticks);
+  EXPECT_EQ(a->ticks, a->tocks);
+  EXPECT_EQ(std::vector<int>(wantb, wantb + 4), b->ticks);
+  EXPECT_EQ(b->ticks, b->tocks);
+  EXPECT_TRUE(ctx.asleep(b));
+  ctx.SleepUntil(b, ctx.time());  // wakes b up
+  EXPECT_FALSE(ctx.asleep(b));
+  cyclus::PyStop();
+}
+
+TEST(TimerTests, SchedBuilds) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  ti.Initialize(&ctx, cyclus::SimInfo(5));
+
+  Retiree* proto = new Retiree(&ctx);
+  proto->prototype("retiree");
+  ctx.AddPrototype("retiree", proto);
+  std::vector<int> times;
+  times.push_back(2);
+  times.push_back(4);
+  ctx.SchedBuilds(NULL, "retiree", 3, times);
+  ctx.SchedBuild(NULL, "retiree", 4);
+  EXPECT_THROW(ctx.SchedBuilds(NULL, "retiree", 1, std::vector<int>(1, 0)),
+               cyclus::ValueError);
+
+  ti.RunSim();
+  EXPECT_EQ(7, ctx.n_prototypes("retiree"));
+  cyclus::PyStop();
+}
+
+TEST(TimerTests, StepSchedule) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  cyclus::SimInfo si(40);
+  si.step_schedule[0] = 12;
+  si.step_schedule[24] = 1;
+  si.step_schedule[26] = 5;
+  ctx.InitSim(si);
+
+  Stepper* s = new Stepper(&ctx);
+  s->Build(NULL);
+  Retiree* proto = new Retiree(&ctx);
+  proto->prototype("retiree");
+  ctx.AddPrototype("retiree", proto);
+  ctx.SchedBuild(NULL, "retiree", 5);
+
+  ti.RunSim();
+  rec.Close();
+
+  // the build at 5 cuts the first step short, after which the steps keep
+  // to multiples of their length, and the last one is cut short by the end
+  int wantticks[] = {0, 5, 12, 24, 25, 26, 31, 36};
+  int wantsteps[] = {5, 7, 12, 1, 1, 5, 5, 4};
+  EXPECT_EQ(std::vector<int>(wantticks, wantticks + 8), s->ticks);
+  EXPECT_EQ(std::vector<int>(wantsteps, wantsteps + 8), s->steps);
+  EXPECT_EQ(1, ctx.n_prototypes("retiree"));
+  EXPECT_EQ(4 * ctx.dt(), ctx.step_secs());
+
+  cyclus::QueryResult qr = b.Query("Finish", NULL);
+  EXPECT_EQ(39, qr.GetVal<int>("EndTime"));
+  qr = b.Query("InfoStepSchedule", NULL);
+  EXPECT_EQ(3, qr.rows.size());
+
+  cyclus::Timer bad;
+  si.step_schedule[30] = 0;
+  EXPECT_THROW(bad.Initialize(&ctx, si), cyclus::ValueError);
+  cyclus::PyStop();
+}
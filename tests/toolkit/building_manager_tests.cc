@@ -54,6 +54,38 @@ TEST_F(BuildingManagerTests, problem) {
   EXPECT_EQ(order2.producer, helper.producer2);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(BuildingManagerTests, resolve) {
+  SetUpProblem();
+  manager.MakeBuildDecision(helper.commodity, 500);
+  // the kept program answers for the new demand
+  std::vector<BuildOrder> orders =
+      manager.MakeBuildDecision(helper.commodity, demand);
+  ASSERT_EQ(orders.size(), 2);
+  EXPECT_EQ(orders.at(0).number, build1);
+  EXPECT_EQ(orders.at(1).number, build2);
+
+  // and is rebuilt when a producer changes
+  helper.producer2->SetCost(helper.commodity, 3 * cost2);
+  orders = manager.MakeBuildDecision(helper.commodity, demand);
+  ASSERT_EQ(orders.size(), 1);
+  EXPECT_EQ(orders.at(0).number, 2);
+  EXPECT_EQ(orders.at(0).producer, helper.producer1);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(BuildingManagerTests, dominant) {
+  SetUpProblem();
+  // the largest producer is now also the cheapest
+  helper.producer1->SetCost(helper.commodity, cost2 / 2);
+  std::vector<BuildOrder> orders =
+      manager.MakeBuildDecision(helper.commodity, demand);
+  ASSERT_EQ(orders.size(), 1);
+  EXPECT_EQ(orders.at(0).number, 2);
+  EXPECT_EQ(orders.at(0).builder, &builder1);
+  EXPECT_EQ(orders.at(0).producer, helper.producer1);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(BuildingManagerTests, emptyorder) {
   SetUpProblem();
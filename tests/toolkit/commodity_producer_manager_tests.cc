@@ -40,6 +40,30 @@ TEST_F(CommodityProducerManagerTests, registerunregister) {
   EXPECT_EQ(manager.TotalCapacity(helper.commodity), 0.0);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(CommodityProducerManagerTests, changes) {
+  manager.Register(helper.producer1);
+  manager.Register(helper.producer2);
+  EXPECT_EQ(manager.TotalCapacity(helper.commodity),
+            helper.nproducers*helper.capacity);
+
+  // the kept total follows changes to the producers
+  helper.producer1->SetCapacity(helper.commodity, 2 * helper.capacity);
+  EXPECT_EQ(manager.TotalCapacity(helper.commodity), 3 * helper.capacity);
+  helper.producer2->Rm(helper.commodity);
+  EXPECT_EQ(manager.TotalCapacity(helper.commodity), 2 * helper.capacity);
+
+  // and forgets deleted producers
+  CommodityProducer* p = new CommodityProducer();
+  p->Add(helper.commodity, CommodInfo(1, 1));
+  manager.Register(p);
+  EXPECT_EQ(manager.TotalCapacity(helper.commodity),
+            2 * helper.capacity + 1);
+  delete p;
+  EXPECT_EQ(manager.producers().count(p), 0);
+  EXPECT_EQ(manager.TotalCapacity(helper.commodity), 2 * helper.capacity);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(CommodityProducerManagerTests, differentcommodity) {
   EXPECT_NO_THROW(manager.Register(helper.producer1));
@@ -98,5 +98,52 @@ TEST_F(EnrichmentTests, enrichmentcalcs) {
   EXPECT_NEAR(swu_, SwuRequired(product_qty, assays), 1e-8);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(EnrichmentTests, batchcalcs) {
+  std::vector<double> qtys;
+  std::vector<double> assays;
+  for (int i = 1; i <= 9; ++i) {
+    qtys.push_back(i * mass_u_);
+    assays.push_back(0.01 * i);
+  }
+  std::vector<double> feed = FeedQty(qtys, assays, feed_, tails_);
+  std::vector<double> tails = TailsQty(qtys, assays, feed_, tails_);
+  std::vector<double> swu = SwuRequired(qtys, assays, feed_, tails_);
+  ASSERT_EQ(qtys.size(), swu.size());
+  for (int i = 0; i < qtys.size(); ++i) {
+    Assays a(feed_, assays[i], tails_);
+    EXPECT_NEAR(FeedQty(qtys[i], a), feed[i], 1e-8);
+    EXPECT_NEAR(TailsQty(qtys[i], a), tails[i], 1e-8);
+    EXPECT_NEAR(SwuRequired(qtys[i], a), swu[i], 1e-8);
+  }
+
+  EXPECT_TRUE(SwuRequired(std::vector<double>(), std::vector<double>(),
+                          feed_, tails_).empty());
+  assays.pop_back();
+  EXPECT_THROW(FeedQty(qtys, assays, feed_, tails_), ValueError);
+  assays.push_back(1);
+  EXPECT_THROW(SwuRequired(qtys, assays, feed_, tails_), ValueError);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(EnrichmentTests, assaycache) {
+  AssayCache cache;
+  EXPECT_DOUBLE_EQ(UraniumAssayAtom(mat_by_atom_), cache.Atom(mat_by_atom_));
+  EXPECT_DOUBLE_EQ(UraniumAssayMass(mat_by_mass_), cache.Mass(mat_by_mass_));
+  EXPECT_DOUBLE_EQ(UraniumAssayAtom(mat_by_atom_), cache.Atom(mat_by_atom_));
+  EXPECT_EQ(2, cache.size());
+
+  // a material with a new composition is looked up anew
+  CompMap v;
+  v[922350000] = 0.2;
+  v[922380000] = 0.8;
+  mat_by_atom_->Transmute(Composition::CreateFromAtom(v));
+  EXPECT_NEAR(0.2, cache.Atom(mat_by_atom_), 1e-12);
+  EXPECT_EQ(3, cache.size());
+
+  cache.clear();
+  EXPECT_EQ(0, cache.size());
+}
+
 }  // namespace toolkit
 }  // namespace cyclus
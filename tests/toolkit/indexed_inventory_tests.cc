@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include "composition.h"
+#include "error.h"
+#include "material.h"
+#include "toolkit/indexed_inventory.h"
+
+namespace cyclus {
+namespace toolkit {
+
+namespace {
+
+// Returns a material of qty kg of uranium with the given U-235 fraction.
+Material::Ptr Uranium(double qty, double assay) {
+  CompMap v;
+  v[922350000] = assay;
+  v[922380000] = 1 - assay;
+  return Material::CreateUntracked(qty, Composition::CreateFromAtom(v));
+}
+
+}  // namespace
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(IndexedInventoryTest, PushPop) {
+  IndexedInventory inv;
+  Material::Ptr m1 = Uranium(10, 0.04);
+  Material::Ptr m2 = Uranium(5, 0.2);
+  inv.Push(m1, "leu");
+  inv.Push(m2, "heu");
+  EXPECT_EQ(2, inv.count());
+  EXPECT_DOUBLE_EQ(15, inv.quantity());
+  EXPECT_DOUBLE_EQ(10, inv.quantity("leu"));
+  EXPECT_DOUBLE_EQ(0, inv.quantity("nope"));
+  EXPECT_NEAR(0.04, inv.Assay(m1->obj_id()), 1e-12);
+  EXPECT_THROW(inv.Push(m1, "leu"), KeyError);
+
+  EXPECT_EQ(m1, inv.Pop(m1->obj_id()));
+  EXPECT_FALSE(inv.Has(m1->obj_id()));
+  EXPECT_DOUBLE_EQ(0, inv.quantity("leu"));
+  EXPECT_THROW(inv.Pop(m1->obj_id()), KeyError);
+  EXPECT_EQ(m2, inv.Pop(m2->obj_id()));
+  EXPECT_TRUE(inv.empty());
+  EXPECT_DOUBLE_EQ(0, inv.quantity());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(IndexedInventoryTest, Lookups) {
+  IndexedInventory inv;
+  Material::Ptr m1 = Uranium(1, 0.03);
+  Material::Ptr m2 = Uranium(1, 0.05);
+  Material::Ptr m3 = Uranium(1, 0.07);
+  Material::Ptr other = Uranium(1, 0.04);
+  inv.Push(m2, "leu", 0.05);
+  inv.Push(m1, "leu", 0.03);
+  inv.Push(m3, "leu", 0.07);
+  inv.Push(other, "other", 0.04);
+
+  EXPECT_EQ(m1, inv.ClosestAssay("leu", 0));
+  EXPECT_EQ(m1, inv.ClosestAssay("leu", 0.035));
+  EXPECT_EQ(m1, inv.ClosestAssay("leu", 0.04));  // ties go low
+  EXPECT_EQ(m2, inv.ClosestAssay("leu", 0.045));
+  EXPECT_EQ(m3, inv.ClosestAssay("leu", 1));
+  EXPECT_EQ(other, inv.ClosestAssay("other", 0.07));
+  EXPECT_FALSE(inv.ClosestAssay("nope", 0.05));
+
+  std::vector<Material::Ptr> mats = inv.AssayRange("leu", 0.04, 0.07);
+  ASSERT_EQ(2, mats.size());
+  EXPECT_EQ(m2, mats[0]);
+  EXPECT_EQ(m3, mats[1]);
+  EXPECT_TRUE(inv.AssayRange("leu", 0.08, 1).empty());
+
+  // all were made at the same time, so the first pushed is the oldest
+  EXPECT_EQ(m2, inv.Oldest("leu"));
+  inv.Pop(m2->obj_id());
+  EXPECT_EQ(m1, inv.Oldest("leu"));
+  EXPECT_EQ(m3, inv.ClosestAssay("leu", 0.06));
+  EXPECT_FALSE(inv.Oldest("nope"));
+}
+
+}  // namespace toolkit
+}  // namespace cyclus
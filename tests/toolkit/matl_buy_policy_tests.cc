@@ -126,5 +126,34 @@ TEST_F(MatlBuyPolicyTests, Reqs) {
   ASSERT_FLOAT_EQ(req->target()->quantity(), quantize);
 }
 
+TEST_F(MatlBuyPolicyTests, ReuseReqs) {
+  double cap = 5;
+  ResBuf<Material> buff;
+  buff.capacity(cap);
+  cyclus::Composition::Ptr c = cyclus::Composition::Ptr(new TestComp());
+  MatlBuyPolicy p;
+  p.Init(fac1, &buff, "").Set("foo", c);
+
+  // the same requests while nothing changes
+  std::set<RequestPortfolio<Material>::Ptr> obs = p.GetMatlRequests();
+  ASSERT_EQ(obs.size(), 1);
+  EXPECT_TRUE(p.GetMatlRequests() == obs);
+
+  // new ones once the buffer's space changes
+  buff.Push(Material::CreateUntracked(1, c));
+  std::set<RequestPortfolio<Material>::Ptr> obs2 = p.GetMatlRequests();
+  ASSERT_EQ(obs2.size(), 1);
+  EXPECT_FALSE(obs2 == obs);
+  ASSERT_FLOAT_EQ((*obs2.begin())->requests().at(0)->target()->quantity(),
+                  cap - 1);
+  EXPECT_TRUE(p.GetMatlRequests() == obs2);
+
+  // or the commodities do
+  p.Set("bar", c);
+  std::set<RequestPortfolio<Material>::Ptr> obs3 = p.GetMatlRequests();
+  EXPECT_FALSE(obs3 == obs2);
+  ASSERT_EQ((*obs3.begin())->requests().size(), 2);
+}
+
 }
 }
@@ -106,6 +106,43 @@ TEST_F(MatlSellPolicyTests, Bids) {
   delete req;
 }
 
+TEST_F(MatlSellPolicyTests, BatchBids) {
+  MatlSellPolicy p;
+  std::string commod("commod");
+  CommodMap<Material>::type reqs;
+  Request<Material>* req1 = Request<Material>::Create(mat1, fac1, commod);
+  Request<Material>* req2 = Request<Material>::Create(mat1, fac1, commod);
+  reqs[commod].push_back(req1);
+  reqs[commod].push_back(req2);
+
+  // requests of the same quantity share an offer
+  p.Init(NULL, &buff, "").Set(commod).BatchBids();
+  ASSERT_TRUE(p.batch_bids());
+  std::set<BidPortfolio<Material>::Ptr> obs = p.GetMatlBids(reqs);
+  ASSERT_EQ(obs.size(), 1);
+  const std::set<Bid<Material>*>& bids = (*obs.begin())->bids();
+  ASSERT_EQ(bids.size(), 2);
+  EXPECT_EQ((*bids.begin())->offer(), (*bids.rbegin())->offer());
+  ASSERT_FLOAT_EQ((*bids.begin())->offer()->quantity(), qty);
+  ASSERT_EQ((*bids.begin())->offer()->comp(), comp);
+  ASSERT_EQ((*obs.begin())->constraints().size(), 1);
+
+  // as do all the exclusive bids
+  p.Init(NULL, &buff, "", qty, true, qty / 3).Set(commod).BatchBids();
+  obs = p.GetMatlBids(reqs);
+  const std::set<Bid<Material>*>& excl = (*obs.begin())->bids();
+  ASSERT_EQ(excl.size(), 6);
+  std::set<Bid<Material>*>::const_iterator it;
+  for (it = excl.begin(); it != excl.end(); ++it) {
+    EXPECT_EQ((*excl.begin())->offer(), (*it)->offer());
+    EXPECT_TRUE((*it)->exclusive());
+  }
+  ASSERT_EQ((*excl.begin())->offer()->comp(), comp1);
+
+  delete req1;
+  delete req2;
+}
+
 TEST_F(MatlSellPolicyTests, Trades) {
   MatlSellPolicy p;
   std::string commod("commod");  
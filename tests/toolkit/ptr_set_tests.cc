@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+
+#include <set>
+#include <vector>
+
+#include "toolkit/ptr_set.h"
+
+namespace cyclus {
+namespace toolkit {
+
+TEST(PtrSetTests, InsertErase) {
+  std::vector<int> vals(1000);
+  PtrSet s;
+  EXPECT_TRUE(s.empty());
+  EXPECT_EQ(0, s.count(&vals[0]));
+  for (int i = 0; i < vals.size(); ++i) {
+    EXPECT_TRUE(s.insert(&vals[i]));
+  }
+  EXPECT_FALSE(s.insert(&vals[7]));
+  EXPECT_EQ(vals.size(), s.size());
+
+  // remove every third pointer and check that the rest are still found
+  for (int i = 0; i < vals.size(); i += 3) {
+    s.erase(&vals[i]);
+  }
+  s.erase(&vals[0]);  // absent
+  for (int i = 0; i < vals.size(); ++i) {
+    EXPECT_EQ(i % 3 == 0 ? 0 : 1, s.count(&vals[i])) << "i=" << i;
+  }
+  EXPECT_EQ(666, s.size());
+
+  s.clear();
+  EXPECT_TRUE(s.empty());
+  EXPECT_EQ(0, s.count(&vals[1]));
+  EXPECT_TRUE(s.insert(&vals[1]));
+}
+
+}  // namespace toolkit
+}  // namespace cyclus
@@ -146,6 +146,20 @@ TEST_F(ResBufTest, RemoveQty_DoubleWithSplit) {
   EXPECT_DOUBLE_EQ(filled_store_.quantity(), orig_qty - exact_qty_over);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ResBufTest, PopInto) {
+  Product::Ptr into = Product::CreateUntracked(5, "bananas");
+  double orig_qty = filled_store_.quantity();
+  ASSERT_NO_THROW(filled_store_.PopInto(mass1 + 2, into));
+  EXPECT_DOUBLE_EQ(5 + mass1 + 2, into->quantity());
+  EXPECT_EQ(1, filled_store_.count());
+  EXPECT_DOUBLE_EQ(orig_qty - mass1 - 2, filled_store_.quantity());
+
+  filled_store_.PopInto(0, into);
+  EXPECT_DOUBLE_EQ(5 + mass1 + 2, into->quantity());
+  EXPECT_THROW(filled_store_.PopInto(orig_qty, into), ValueError);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(ResBufTest, RemoveNum_ExceptionsFilled) {
   ProdVec manifest;
@@ -276,6 +290,17 @@ TEST_F(ResBufTest, Push_DuplicateEmpty) {
   EXPECT_DOUBLE_EQ(store_.quantity(), mat1_->quantity());
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ResBufTest, Push_CompensatedQuantity) {
+  // each tiny push alone is lost to rounding against the large quantity
+  store_.Push(Product::CreateUntracked(1, "bananas"));
+  for (int i = 0; i < 1000; ++i) {
+    store_.Push(Product::CreateUntracked(1e-16, "bananas"));
+  }
+  EXPECT_NEAR(1 + 1e-13, store_.quantity(), 1e-15);
+  EXPECT_EQ(1001, store_.count());
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(ResBufTest, PushAll_Empty) {
   ASSERT_NO_THROW(store_.capacity(cap));
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "toolkit/position.h"
+#include "toolkit/spatial_index.h"
+
+namespace cyclus {
+namespace toolkit {
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(SpatialIndexTest, InsertErase) {
+  SpatialIndex idx;
+  idx.Insert(1, Position(48.8566, 2.3522));
+  idx.Insert(2, Position(40.7128, -74.0060));
+  EXPECT_EQ(2, idx.size());
+  EXPECT_TRUE(idx.Has(1));
+  EXPECT_DOUBLE_EQ(48.8566, idx.position(1).latitude());
+
+  // moving an id leaves it in one place
+  idx.Insert(1, Position(52.3676, 4.9041));
+  EXPECT_EQ(2, idx.size());
+  EXPECT_DOUBLE_EQ(52.3676, idx.position(1).latitude());
+
+  EXPECT_TRUE(idx.Erase(1));
+  EXPECT_FALSE(idx.Erase(1));
+  EXPECT_FALSE(idx.Has(1));
+  EXPECT_THROW(idx.position(1), KeyError);
+  EXPECT_THROW(SpatialIndex(0), ValueError);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(SpatialIndexTest, Within) {
+  SpatialIndex idx;
+  Position paris(48.8566, 2.3522);
+  Position amsterdam(52.3676, 4.9041);
+  Position new_york(40.7128, -74.0060);
+  idx.Insert(3, paris);
+  idx.Insert(1, amsterdam);
+  idx.Insert(2, new_york);
+
+  std::vector<int> ids = idx.Within(paris, 1000);
+  ASSERT_EQ(2, ids.size());
+  EXPECT_EQ(1, ids[0]);
+  EXPECT_EQ(3, ids[1]);
+  EXPECT_EQ(ids, idx.Near(3, 1000));
+  EXPECT_EQ(1, idx.Within(paris, 100).size());
+  EXPECT_EQ(3, idx.Within(paris, paris.Distance(new_york) + 1).size());
+  EXPECT_TRUE(idx.Within(Position(0, 0), 100).empty());
+
+  // across the antimeridian and near the pole
+  idx.Insert(4, Position(0, 179.9));
+  idx.Insert(5, Position(89.9, 10));
+  ids = idx.Within(Position(0, -179.9), 50);
+  ASSERT_EQ(1, ids.size());
+  EXPECT_EQ(4, ids[0]);
+  ids = idx.Within(Position(89.9, -170), 50);
+  ASSERT_EQ(1, ids.size());
+  EXPECT_EQ(5, ids[0]);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(SpatialIndexTest, InRegion) {
+  SpatialIndex idx(5);
+  idx.Insert(1, Position(48.8566, 2.3522));
+  idx.Insert(2, Position(40.7128, -74.0060));
+  idx.Insert(3, Position(-33.8688, 151.2093));
+  idx.Insert(4, Position(21.3069, -157.8583));
+
+  std::vector<int> ids = idx.InRegion(30, 60, -80, 10);
+  ASSERT_EQ(2, ids.size());
+  EXPECT_EQ(1, ids[0]);
+  EXPECT_EQ(2, ids[1]);
+
+  // the Pacific, across the antimeridian
+  ids = idx.InRegion(-60, 60, 120, -120);
+  ASSERT_EQ(2, ids.size());
+  EXPECT_EQ(3, ids[0]);
+  EXPECT_EQ(4, ids[1]);
+}
+
+}  // namespace toolkit
+}  // namespace cyclus
@@ -165,6 +165,41 @@ TEST_F(SymbolicFunctionTests, piecewisefunc) {
   // output.close();
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(SymbolicFunctionTests, compiled) {
+  SymFunction::Ptr pw = GetPiecewiseFunction();
+  SymFunction::Ptr f = SymbFunctionFactory::Compile(pw);
+
+  // the same values as the function compiled, before and in every piece
+  EXPECT_DOUBLE_EQ(0, f->value(-1));
+  for (int i = 0; i < check_points.size() - 1; i++) {
+    int n = 50;
+    double eps = 0.00000001;
+    double range = check_points.at(i+1) - check_points.at(i) - eps;
+    double step = range/(n-1);
+
+    for (int j = 0; j < n; j++) {
+      double x = j*step + check_points.at(i);
+      EXPECT_DOUBLE_EQ(pw->value(x), f->value(x));
+    }
+  }
+
+  // nested piecewise functions are flattened
+  PiecewiseFunctionFactory pff;
+  pff.AddFunction(GetLinFunction(), 0);
+  pff.AddFunction(pw, 10, false);
+  SymFunction::Ptr nested = pff.GetFunctionPtr();
+  boost::shared_ptr<CompiledFunction> c =
+      boost::dynamic_pointer_cast<CompiledFunction>(
+          SymbFunctionFactory::Compile(nested, 20));
+  ASSERT_TRUE(c.get() != NULL);
+  EXPECT_EQ(2 + dynamic_cast<CompiledFunction*>(f.get())->npieces(),
+            c->npieces());
+  for (double x = -5; x < 40; x += 0.25) {
+    EXPECT_DOUBLE_EQ(nested->value(x), c->value(x));
+  }
+}
+
 TEST(BasicFunctionFactory, constructors) {
   BasicFunctionFactory bff;
   ASSERT_NO_THROW(bff.GetFunctionPtr("lin", "0 5"));
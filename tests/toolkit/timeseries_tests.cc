@@ -50,6 +50,166 @@ TEST(TimeSeriesTests, RawPower) {
   RecordTimeSeries<double>("Power", a, 42.0);
 }
 
+TEST(TimeSeriesTests, Listeners) {
+  TestContext tc;
+  Agent* a = new TestAgent(tc.get());
+  ClearTimeSeriesListeners();
+  EXPECT_EQ(0, TIME_SERIES_NLISTENERS.load());
+  RecordTimeSeries<double>("Power", a, 42.0);
+  EXPECT_TRUE(FindTimeSeriesListeners("Power") == NULL);
+
+  std::vector<double> got;
+  int nints = 0;
+  AddTimeSeriesListener<double>(
+      "Power", [&got](Agent*, int, double v, std::string) {
+        got.push_back(v);
+      });
+  AddTimeSeriesListener<int>(
+      "Power", [&nints](Agent*, int, int, std::string) { ++nints; });
+  EXPECT_EQ(2, TIME_SERIES_NLISTENERS.load());
+
+  RecordTimeSeries<double>("Power", a, 42.0);
+  RecordTimeSeries<double>("Other", a, 7.0);
+  RecordTimeSeries<POWER>(a, 43.0);
+  ASSERT_EQ(2, got.size());
+  EXPECT_DOUBLE_EQ(42.0, got[0]);
+  EXPECT_DOUBLE_EQ(43.0, got[1]);
+  EXPECT_EQ(0, nints);
+
+  // listeners added to the map directly are still called
+  TIME_SERIES_LISTENERS["Other"].push_back(
+      TimeSeriesListener<double>([&got](Agent*, int, double v, std::string) {
+        got.push_back(v);
+      }));
+  RecordTimeSeries<double>("Other", a, 7.0);
+  ASSERT_EQ(3, got.size());
+  EXPECT_DOUBLE_EQ(7.0, got[2]);
+
+  ClearTimeSeriesListeners();
+  RecordTimeSeries<double>("Power", a, 42.0);
+  EXPECT_EQ(3, got.size());
+}
+
+TEST(TimeSeriesTests, Batched) {
+  TestContext tc;
+  Agent* a = new TestAgent(tc.get());
+  ClearTimeSeriesListeners();
+  SetPyBatchTimeSeriesListeners("Power", true);
+  EXPECT_EQ(1, TIME_SERIES_NLISTENERS.load());
+
+  RecordTimeSeries<double>("Power", a, 42.0);
+  RecordTimeSeries<int>("Power", a, 7);
+  RecordTimeSeries<std::string>("Power", a, "not a number");
+  RecordTimeSeries<double>("Other", a, 1.0);
+  TimeSeriesListeners* l = FindTimeSeriesListeners("Power");
+  ASSERT_TRUE(l != NULL);
+  ASSERT_EQ(2, l->batch_values.size());
+  EXPECT_EQ(a->id(), l->batch_ids[0]);
+  EXPECT_DOUBLE_EQ(42.0, l->batch_values[0]);
+  EXPECT_DOUBLE_EQ(7.0, l->batch_values[1]);
+  EXPECT_TRUE(FindTimeSeriesListeners("Other") == NULL);
+
+  SetPyBatchTimeSeriesListeners("Power", false);
+  EXPECT_EQ(0, TIME_SERIES_NLISTENERS.load());
+  ClearTimeSeriesListeners();
+}
+
+TEST(TimeSeriesTests, Aggregated) {
+  Recorder rec;
+  Timer ti;
+  FakeContext ctx(&ti, &rec);
+  SqliteBack* back = new SqliteBack(":memory:");
+  rec.RegisterBackend(back);
+
+  SimInfo si(6);
+  si.timeseries["Power"].mode = "mean";
+  si.timeseries["Power"].period = 3;
+  si.timeseries["Feed"].mode = "sample";
+  si.timeseries["Feed"].period = 2;
+  ctx.InitSim(si);
+  ASSERT_TRUE(ctx.series_aggregator() != NULL);
+
+  Agent* a = new TestAgent(&ctx);
+  for (int t = 0; t < 5; ++t) {
+    ctx.time(t);
+    RecordTimeSeries<double>("Power", a, t);
+    RecordTimeSeries<double>("Feed", a, t);
+    ctx.series_aggregator()->Flush(&ctx, false);
+  }
+  ctx.series_aggregator()->Flush(&ctx, true);  // the cut short window
+  rec.Flush();
+
+  QueryResult qr = back->Query("TimeSeriesPower", NULL);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(a->id(), qr.GetVal<int>("AgentId", 0));
+  EXPECT_EQ(0, qr.GetVal<int>("Time", 0));
+  EXPECT_DOUBLE_EQ(1.0, qr.GetVal<double>("Value", 0));
+  EXPECT_EQ(3, qr.GetVal<int>("Time", 1));
+  EXPECT_DOUBLE_EQ(3.5, qr.GetVal<double>("Value", 1));
+
+  qr = back->Query("TimeSeriesFeed", NULL);
+  ASSERT_EQ(3, qr.rows.size());
+  EXPECT_EQ(0, qr.GetVal<int>("Time", 0));
+  EXPECT_EQ(2, qr.GetVal<int>("Time", 1));
+  EXPECT_EQ(4, qr.GetVal<int>("Time", 2));
+
+  si.timeseries["Power"].mode = "median";
+  EXPECT_THROW(TimeSeriesAggregator agg(si.timeseries), ValueError);
+  rec.Close();
+  delete back;
+}
+
+TEST(TimeSeriesTests, Handle) {
+  Recorder rec;
+  Timer ti;
+  FakeContext ctx(&ti, &rec);
+  SqliteBack* back = new SqliteBack(":memory:");
+  rec.RegisterBackend(back);
+  ClearTimeSeriesListeners();
+
+  Agent* a = new TestAgent(&ctx);
+  TimeSeries<double> power;
+  EXPECT_FALSE(power.bound());
+  EXPECT_THROW(power.Record(1.0), StateError);
+  power.Bind(a, POWER);
+  EXPECT_EQ("Power", power.name());
+
+  std::vector<double> got;
+  AddTimeSeriesListener<double>(
+      "Power", [&got](Agent*, int, double v, std::string) {
+        got.push_back(v);
+      });
+
+  // copies, e.g. of cloned agents, are unbound
+  TimeSeries<double> copy(power);
+  EXPECT_FALSE(copy.bound());
+
+  for (int t = 0; t < 3; ++t) {
+    ctx.time(t);
+    power.Record(10.0 * t);
+    // listeners hear of values as they are recorded
+    EXPECT_EQ(t + 1, got.size());
+    FlushTimeSeries(&ctx);
+  }
+  ctx.time(3);
+  power.Record(30.0);
+  power.Unbind();  // flushes what is left
+  EXPECT_FALSE(power.bound());
+  FlushTimeSeries(&ctx);
+  rec.Flush();
+
+  QueryResult qr = back->Query("TimeSeriesPower", NULL);
+  ASSERT_EQ(4, qr.rows.size());
+  for (int t = 0; t < 4; ++t) {
+    EXPECT_EQ(a->id(), qr.GetVal<int>("AgentId", t));
+    EXPECT_EQ(t, qr.GetVal<int>("Time", t));
+    EXPECT_DOUBLE_EQ(10.0 * t, qr.GetVal<double>("Value", t));
+  }
+
+  ClearTimeSeriesListeners();
+  rec.Close();
+  delete back;
+}
 
 }  // namespace toolkit
 }  // namespace cyclus
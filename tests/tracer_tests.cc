@@ -0,0 +1,61 @@
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "context.h"
+#include "recorder.h"
+#include "timer.h"
+#include "tracer.h"
+
+using cyclus::Tracer;
+using cyclus::TraceSpan;
+
+TEST(TracerTests, Spans) {
+  Tracer t("unused.json");
+  t.set_time(3);
+  {
+    TraceSpan span(&t, "Tick", "timer");
+  }
+  {
+    TraceSpan span(NULL, "Tock", "timer");  // not tracing
+  }
+  Tracer::Clock::time_point start = Tracer::Clock::now();
+  std::thread worker([&t, start]() {
+    t.Add("Bids", "dre", start, start + std::chrono::milliseconds(2));
+  });
+  worker.join();
+  EXPECT_EQ(2, t.size());
+
+  std::stringstream ss;
+  t.Write(&ss);
+  std::string json = ss.str();
+  EXPECT_EQ(0, json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+  EXPECT_NE(std::string::npos,
+            json.find("{\"name\":\"Tick\",\"cat\":\"timer\",\"ph\":\"X\""));
+  EXPECT_EQ(std::string::npos, json.find("Tock"));
+  EXPECT_NE(std::string::npos, json.find("\"dur\":2000.000,\"pid\":1,"
+                                         "\"tid\":1,\"args\":{\"time\":3}"));
+  EXPECT_NE(std::string::npos, json.find("\"args\":{\"name\":\"worker 1\"}"));
+  EXPECT_EQ("\n]}\n", json.substr(json.size() - 4));
+}
+
+TEST(TracerTests, Context) {
+  cyclus::Timer ti;
+  cyclus::Recorder rec;
+  cyclus::Context ctx(&ti, &rec);
+  EXPECT_EQ(NULL, ctx.tracer());
+  ctx.trace("trace.json");
+  ASSERT_TRUE(ctx.tracer() != NULL);
+  EXPECT_EQ("trace.json", ctx.tracer()->path());
+  EXPECT_EQ(ctx.tracer(), rec.tracer());
+
+  ctx.NewDatum("Spam")->AddVal("Eggs", 1)->Record();
+  rec.Flush();
+  EXPECT_EQ(1, ctx.tracer()->size());
+
+  ctx.trace("");
+  EXPECT_EQ(NULL, ctx.tracer());
+  EXPECT_EQ(NULL, rec.tracer());
+}
@@ -1,5 +1,7 @@
+#include <functional>
 #include <map>
 #include <set>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -7,6 +9,7 @@
 
 #include "agent.h"
 #include "bid.h"
+#include "column_store.h"
 #include "context.h"
 #include "material.h"
 #include "request.h"
@@ -19,6 +22,7 @@
 #include "trader.h"
 
 using cyclus::Bid;
+using cyclus::ColumnStore;
 using cyclus::Context;
 using cyclus::Material;
 using cyclus::Agent;
@@ -30,6 +34,29 @@ using cyclus::Trade;
 using cyclus::TradeExecutor;
 using cyclus::Trader;
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// responds to its trades on whichever thread it is asked on, noting the
+// thread and recording a row per call
+class ThreadSafeSupplier : public TestTrader {
+ public:
+  ThreadSafeSupplier(Context* ctx, TestObjFactory* fac)
+      : TestTrader(ctx, fac, false) {}
+
+  virtual bool ThreadSafeTrades() { return true; }
+
+  virtual void GetMatlTrades(
+      const std::vector< Trade<Material> >& trades,
+      std::vector<std::pair<Trade<Material>, Material::Ptr> >& responses) {
+    thread = std::this_thread::get_id();
+    context()->NewDatum("SupplierCalls")
+        ->AddVal("Offers", static_cast<int>(trades.size()))
+        ->Record();
+    TestTrader::GetMatlTrades(trades, responses);
+  }
+
+  std::thread::id thread;
+};
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 class TradeExecutorTests : public ::testing::Test {
  public:
@@ -168,6 +195,74 @@ TEST_F(TradeExecutorTests, NoThrowWriting) {
   EXPECT_NO_THROW(exec.RecordTrades(tc.get()));
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(TradeExecutorTests, GroupedResponses) {
+  TradeExecutor<Material> exec(trades);
+  exec.ExecuteTrades();
+
+  // responses are grouped by supplier, keeping each supplier's trade order
+  const std::vector< std::pair<Trade<Material>, Material::Ptr> >& obs =
+      exec.responses();
+  ASSERT_EQ(3, obs.size());
+  std::vector< std::pair<Trade<Material>, Material::Ptr> > exp;
+  if (std::less<Trader*>()(s1, s2)) {
+    exp.push_back(std::make_pair(t1, fac.mat));
+  }
+  exp.push_back(std::make_pair(t2, fac.mat));
+  exp.push_back(std::make_pair(t3, fac.mat));
+  if (!std::less<Trader*>()(s1, s2)) {
+    exp.push_back(std::make_pair(t1, fac.mat));
+  }
+  EXPECT_EQ(exp, obs);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(TradeExecutorTests, ParallelResponses) {
+  ColumnStore store;
+  tc.recorder()->RegisterBackend(&store);
+  ThreadSafeSupplier* p1 = new ThreadSafeSupplier(tc.get(), &fac);
+  ThreadSafeSupplier* p2 = new ThreadSafeSupplier(tc.get(), &fac);
+  Bid<Material>* pbid1 = Bid<Material>::Create(req1, fac.mat, p1);
+  Bid<Material>* pbid2 = Bid<Material>::Create(req2, fac.mat, p2);
+  Trade<Material> pt1(req1, pbid1, amt);
+  Trade<Material> pt2(req2, pbid2, amt);
+  std::vector< Trade<Material> > ptrades;
+  ptrades.push_back(pt1);
+  ptrades.push_back(pt2);
+  ptrades.push_back(t1);
+
+  TradeExecutor<Material> exec(ptrades);
+  exec.set_threads(4);
+  exec.ExecuteTrades(tc.get());
+
+  // the thread-safe suppliers respond on the workers, the other on the
+  // calling thread, and responses keep supplier order
+  EXPECT_NE(std::this_thread::get_id(), p1->thread);
+  EXPECT_NE(std::this_thread::get_id(), p2->thread);
+  EXPECT_EQ(1, p1->offer);
+  EXPECT_EQ(1, p2->offer);
+  EXPECT_EQ(1, s1->offer);
+  EXPECT_EQ(1, r1->accept);
+  EXPECT_EQ(1, r2->accept);
+  const std::vector< std::pair<Trade<Material>, Material::Ptr> >& obs =
+      exec.responses();
+  ASSERT_EQ(3, obs.size());
+  for (int i = 1; i < obs.size(); ++i) {
+    EXPECT_TRUE(std::less<Trader*>()(obs[i - 1].first.bid->bidder(),
+                                     obs[i].first.bid->bidder()));
+  }
+
+  // what the suppliers recorded on the workers is committed
+  tc.recorder()->Flush();
+  EXPECT_EQ(2, store.nrows("SupplierCalls"));
+
+  tc.recorder()->Close();
+  delete pbid2;
+  delete pbid1;
+  delete p2;
+  delete p1;
+}
+
 // This test was a part of a previous iteration of Trade testing, but its not
 // clear if this throwing behavior is what we want. I'm leaving it here for now
 // in case it needs to be picked up again. MJG - 11/26/13
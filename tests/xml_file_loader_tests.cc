@@ -273,3 +273,24 @@ TEST_F(XMLFileLoaderTests, ExplicitFormat) {
 TEST_F(XMLFileLoaderTests, throws) {
   EXPECT_THROW(XMLFileLoader file(&rec_, b_, schema_path, "blah"), cyclus::IOError);
 }
+
+TEST_F(XMLFileLoaderTests, RecipeLibrary) {
+  cyclus::CompMap v;
+  v[922350000] = 1;
+  v[922380000] = 3;
+  std::map<std::string, cyclus::Composition::Ptr> recipes;
+  recipes["leu"] = cyclus::Composition::CreateFromMass(v);
+  std::string lib = "recipes.cycrecipes";
+  cyclus::WriteRecipeLibrary(lib, recipes);
+
+  std::map<std::string, cyclus::Composition::Ptr> read =
+      cyclus::ReadRecipeLibrary(lib);
+  unlink(lib.c_str());
+  ASSERT_EQ(1, read.size());
+  ASSERT_EQ(1, read.count("leu"));
+  cyclus::CompMap m = read["leu"]->mass();
+  EXPECT_DOUBLE_EQ(0.25, m[922350000]);
+  EXPECT_DOUBLE_EQ(0.75, m[922380000]);
+
+  EXPECT_THROW(cyclus::ReadRecipeLibrary(recipe_file), cyclus::IOError);
+}
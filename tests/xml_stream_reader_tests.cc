@@ -0,0 +1,75 @@
+#include <fstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "xml_stream_reader.h"
+
+namespace fs = boost::filesystem;
+
+class XMLStreamReaderTest : public ::testing::Test {
+ public:
+  virtual void SetUp() {
+    path_ = (fs::temp_directory_path() / fs::unique_path("%%%%%%.xml")).string();
+  }
+
+  virtual void TearDown() { fs::remove(path_); }
+
+ protected:
+  void Write(const std::string& xml) {
+    std::ofstream f(path_.c_str());
+    f << xml;
+  }
+
+  std::string schema() {
+    return "<element name=\"simulation\" "
+           "xmlns=\"http://relaxng.org/ns/structure/1.0\">"
+           "<oneOrMore><element name=\"facility\"><element name=\"name\">"
+           "<text/></element></element></oneOrMore></element>";
+  }
+
+  std::string path_;
+};
+
+TEST_F(XMLStreamReaderTest, TopLevelElements) {
+  Write("<simulation><control><duration>2</duration></control>"
+        "<facility><name>a</name></facility><facility><name>b</name>"
+        "</facility></simulation>");
+  cyclus::XMLStreamReader r(path_);
+  std::string name, xml;
+  ASSERT_TRUE(r.Next(&name, &xml));
+  EXPECT_EQ("simulation", r.root());
+  EXPECT_EQ("control", name);
+  EXPECT_EQ("<control><duration>2</duration></control>", xml);
+  ASSERT_TRUE(r.Next(&name, &xml));
+  EXPECT_EQ("facility", name);
+  EXPECT_EQ("<facility><name>a</name></facility>", xml);
+  ASSERT_TRUE(r.Next(&name, &xml));
+  EXPECT_EQ("<facility><name>b</name></facility>", xml);
+  EXPECT_FALSE(r.Next(&name, &xml));
+}
+
+TEST_F(XMLStreamReaderTest, Validates) {
+  Write("<simulation><facility><name>a</name></facility></simulation>");
+  cyclus::XMLStreamReader r(path_);
+  r.SetSchema(schema());
+  std::string name, xml;
+  EXPECT_TRUE(r.Next(&name, &xml));
+  EXPECT_FALSE(r.Next(&name, &xml));
+
+  Write("<simulation><facility><bogus/></facility></simulation>");
+  cyclus::XMLStreamReader bad(path_);
+  bad.SetSchema(schema());
+  EXPECT_THROW(while (bad.Next(&name, &xml)) {}, cyclus::ValidationError);
+
+  Write("<simulation><facility>");
+  cyclus::XMLStreamReader broken(path_);
+  EXPECT_THROW(while (broken.Next(&name, &xml)) {}, cyclus::ValidationError);
+}
+
+TEST_F(XMLStreamReaderTest, MissingFile) {
+  EXPECT_THROW(cyclus::XMLStreamReader r("/nonexistent/input.xml"),
+               cyclus::IOError);
+}